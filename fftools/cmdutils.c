@@ -65,6 +65,9 @@ void uninit_opts(void)
     av_dict_free(&sws_dict);
     av_dict_free(&format_opts);
     av_dict_free(&codec_opts);
+
+    /* write out pending messages, anything logged later is printed directly */
+    av_log_set_flags(av_log_get_flags() & ~AV_LOG_ASYNC);
 }
 
 void log_callback_help(void *ptr, int level, const char *fmt, va_list vl)
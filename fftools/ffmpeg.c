@@ -545,7 +545,8 @@ void update_benchmark(const char *fmt, ...)
     }
 }
 
-static void print_report(int is_last_report, int64_t timer_start, int64_t cur_time, int64_t pts)
+static void print_report(Scheduler *sch, int is_last_report,
+                         int64_t timer_start, int64_t cur_time, int64_t pts)
 {
     AVBPrint buf, buf_script;
     int64_t total_size = of_filesize(output_files[0]);
@@ -669,6 +670,18 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
         av_bprintf(&buf_script, "speed=%4.3gx\n", speed);
     }
 
+    for (int i = 0; i < nb_input_files; i++) {
+        int64_t ra_size, ra_duration;
+
+        if (!ifile_readahead_stats(input_files[i], &ra_size, &ra_duration))
+            continue;
+
+        av_bprintf(&buf, " readahead=%.0fKiB/%.1fs",
+                   ra_size / 1024.0, ra_duration / (double)AV_TIME_BASE);
+        av_bprintf(&buf_script, "input_%d_readahead_size=%"PRId64"\n", i, ra_size);
+        av_bprintf(&buf_script, "input_%d_readahead_time_us=%"PRId64"\n", i, ra_duration);
+    }
+
     if (print_stats || is_last_report) {
         const char end = is_last_report ? '\n' : '\r';
         if (print_stats==1 && AV_LOG_INFO > av_log_get_level()) {
@@ -680,6 +693,18 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
     }
     av_bprint_finalize(&buf, NULL);
 
+    if (print_sched_stats && (progress_avio || is_last_report)) {
+        AVBPrint buf_sched;
+
+        av_bprint_init(&buf_sched, 0, AV_BPRINT_SIZE_UNLIMITED);
+        sch_print_stats(sch, &buf_sched);
+        if (progress_avio)
+            av_bprint_append_data(&buf_script, buf_sched.str, buf_sched.len);
+        else if (av_bprint_is_complete(&buf_sched))
+            av_log(NULL, AV_LOG_INFO, "%s", buf_sched.str);
+        av_bprint_finalize(&buf_sched, NULL);
+    }
+
     if (progress_avio) {
         av_bprintf(&buf_script, "progress=%s\n",
                    is_last_report ? "end" : "continue");
@@ -861,6 +886,10 @@ static int transcode(Scheduler *sch)
 
     atomic_store(&transcode_init_done, 1);
 
+    ret = sch_filter_pool_init(sch, filter_pool_threads);
+    if (ret < 0)
+        return ret;
+
     ret = sch_start(sch);
     if (ret < 0)
         return ret;
@@ -880,7 +909,7 @@ static int transcode(Scheduler *sch)
                 break;
 
         /* dump report by using the output first video and audio streams */
-        print_report(0, timer_start, cur_time, transcode_ts);
+        print_report(sch, 0, timer_start, cur_time, transcode_ts);
     }
 
     ret = sch_stop(sch, &transcode_ts);
@@ -894,7 +923,7 @@ static int transcode(Scheduler *sch)
     term_exit();
 
     /* dump report by using the first video and audio streams */
-    print_report(1, timer_start, av_gettime_relative(), transcode_ts);
+    print_report(sch, 1, timer_start, av_gettime_relative(), transcode_ts);
 
     return ret;
 }
@@ -992,6 +1021,7 @@ int main(int argc, char **argv)
     ret = transcode(sch);
     if (ret >= 0 && do_benchmark) {
         int64_t utime, stime, rtime;
+        AVBPrint bp;
         current_time = get_benchmark_time_stamps();
         utime = current_time.user_usec - ti.user_usec;
         stime = current_time.sys_usec  - ti.sys_usec;
@@ -999,6 +1029,11 @@ int main(int argc, char **argv)
         av_log(NULL, AV_LOG_INFO,
                "bench: utime=%0.3fs stime=%0.3fs rtime=%0.3fs\n",
                utime / 1000000.0, stime / 1000000.0, rtime / 1000000.0);
+
+        av_bprint_init(&bp, 0, AV_BPRINT_SIZE_AUTOMATIC);
+        sch_print_pool_stats(sch, &bp);
+        av_log(NULL, AV_LOG_INFO, "bench: pool %s\n", bp.str);
+        av_bprint_finalize(&bp, NULL);
     }
 
     ret = received_nb_signals                 ? 255 :
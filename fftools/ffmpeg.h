@@ -164,6 +164,8 @@ typedef struct OptionsContext {
     int rate_emu;
     float readrate;
     double readrate_initial_burst;
+    int64_t readahead_size;
+    int64_t readahead_time;
     int accurate_seek;
     int thread_queue_size;
     int input_sync_ref;
@@ -227,6 +229,7 @@ typedef struct OptionsContext {
     SpecifierOptList copy_initial_nonkeyframes;
     SpecifierOptList copy_prior_start;
     SpecifierOptList filters;
+    SpecifierOptList filter_priorities;
 #if FFMPEG_OPT_FILTER_SCRIPT
     SpecifierOptList filter_scripts;
 #endif
@@ -261,6 +264,7 @@ enum IFilterFlags {
     IFILTER_FLAG_REINIT         = (1 << 1),
     IFILTER_FLAG_CFR            = (1 << 2),
     IFILTER_FLAG_CROP           = (1 << 3),
+    IFILTER_FLAG_ADAPT          = (1 << 4),
 };
 
 typedef struct InputFilterOptions {
@@ -317,6 +321,8 @@ typedef struct OutputFilterOptions {
     AVDictionary       *swr_opts;
 
     const char         *nb_threads;
+    // priority in the shared filter pool
+    int                 priority;
 
     // A combination of OFilterFlags.
     unsigned            flags;
@@ -393,6 +399,8 @@ enum DecoderFlags {
     DECODER_FLAG_SEND_END_TS      = (1 << 4),
     // force bitexact decoding
     DECODER_FLAG_BITEXACT         = (1 << 5),
+    // minimize decoding delay
+    DECODER_FLAG_LOW_DELAY        = (1 << 6),
 };
 
 typedef struct DecoderOpts {
@@ -706,6 +714,9 @@ extern int debug_ts;
 extern int exit_on_error;
 extern int abort_on_flags;
 extern int print_stats;
+extern int print_sched_stats;
+extern int print_latency_stats;
+extern int low_latency;
 extern int64_t stats_period;
 extern int stdin_interaction;
 extern AVIOContext *progress_avio;
@@ -713,6 +724,8 @@ extern float max_error_rate;
 
 extern char *filter_nbthreads;
 extern int filter_complex_nbthreads;
+extern int filter_complex_priority;
+extern int filter_pool_threads;
 extern int vstats_version;
 extern int auto_conversion_filters;
 
@@ -866,6 +879,14 @@ int64_t of_filesize(OutputFile *of);
 
 int ifile_open(const OptionsContext *o, const char *filename, Scheduler *sch);
 void ifile_close(InputFile **f);
+/**
+ * Get the amount of data currently buffered by the readahead thread of the
+ * given input file.
+ *
+ * @return 1 if readahead is enabled for this file and the output parameters
+ *         were set, 0 otherwise
+ */
+int ifile_readahead_stats(InputFile *f, int64_t *size, int64_t *duration);
 
 int ist_use(InputStream *ist, int decoding_needed,
             const ViewSpecifier *vs, SchedulerNode *src);
@@ -22,6 +22,7 @@
 #include "libavutil/avstring.h"
 #include "libavutil/dict.h"
 #include "libavutil/error.h"
+#include "libavutil/hwcontext.h"
 #include "libavutil/log.h"
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
@@ -124,6 +125,17 @@ void dec_free(Decoder **pdec)
         return;
     dp = dp_from_dec(dec);
 
+    if (do_benchmark_all && dp->dec_ctx && dp->dec_ctx->hw_frames_ctx) {
+        AVHWFramesStats st;
+
+        av_hwframe_ctx_get_stats(dp->dec_ctx->hw_frames_ctx, &st);
+        av_log(dp, AV_LOG_INFO,
+               "bench: hw frames %"PRIu64" allocated, %"PRIu64" failed, "
+               "%"PRIu64" reused, %"PRIu64" created, max %d in use\n",
+               st.nb_allocated, st.nb_failed, st.nb_reused, st.nb_created,
+               st.max_in_use);
+    }
+
     avcodec_free_context(&dp->dec_ctx);
 
     av_frame_free(&dp->frame);
@@ -352,9 +364,9 @@ static int hwaccel_retrieve_data(AVCodecContext *avctx, AVFrame *input)
         return 0;
     }
 
-    output = av_frame_alloc();
-    if (!output)
-        return AVERROR(ENOMEM);
+    err = sch_frame_get(dp->sch, &output);
+    if (err < 0)
+        return err;
 
     output->format = output_format;
 
@@ -366,19 +378,17 @@ static int hwaccel_retrieve_data(AVCodecContext *avctx, AVFrame *input)
     }
 
     err = av_frame_copy_props(output, input);
-    if (err < 0) {
-        av_frame_unref(output);
+    if (err < 0)
         goto fail;
-    }
 
     av_frame_unref(input);
     av_frame_move_ref(input, output);
-    av_frame_free(&output);
+    sch_frame_release(dp->sch, &output);
 
     return 0;
 
 fail:
-    av_frame_free(&output);
+    sch_frame_release(dp->sch, &output);
     return err;
 }
 
@@ -657,14 +667,14 @@ static int transcode_subtitles(DecoderPriv *dp, const AVPacket *pkt,
     }
 
     if (!pkt) {
-        flush_pkt = av_packet_alloc();
-        if (!flush_pkt)
-            return AVERROR(ENOMEM);
+        ret = sch_packet_get(dp->sch, &flush_pkt);
+        if (ret < 0)
+            return ret;
     }
 
     ret = avcodec_decode_subtitle2(dp->dec_ctx, &subtitle, &got_output,
                                    pkt ? pkt : flush_pkt);
-    av_packet_free(&flush_pkt);
+    sch_packet_release(dp->sch, &flush_pkt);
 
     if (ret < 0) {
         av_log(dp, AV_LOG_ERROR, "Error decoding subtitles: %s\n",
@@ -1594,6 +1604,8 @@ static int dec_open(DecoderPriv *dp, AVDictionary **dec_opts,
     dp->dec_ctx->flags |= AV_CODEC_FLAG_COPY_OPAQUE;
     if (o->flags & DECODER_FLAG_BITEXACT)
         dp->dec_ctx->flags |= AV_CODEC_FLAG_BITEXACT;
+    if (o->flags & DECODER_FLAG_LOW_DELAY)
+        dp->dec_ctx->flags |= AV_CODEC_FLAG_LOW_DELAY;
 
     // we apply cropping outselves
     dp->apply_cropping          = dp->dec_ctx->apply_cropping;
@@ -17,6 +17,7 @@
  */
 
 #include <float.h>
+#include <stdatomic.h>
 #include <stdint.h>
 
 #include "ffmpeg.h"
@@ -27,11 +28,13 @@
 #include "libavutil/avstring.h"
 #include "libavutil/display.h"
 #include "libavutil/error.h"
+#include "libavutil/fifo.h"
 #include "libavutil/intreadwrite.h"
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "libavutil/parseutils.h"
 #include "libavutil/pixdesc.h"
+#include "libavutil/thread.h"
 #include "libavutil/time.h"
 #include "libavutil/timestamp.h"
 
@@ -96,6 +99,34 @@ typedef struct DemuxStream {
     uint64_t                 data_size;
 } DemuxStream;
 
+typedef struct ReadAheadEntry {
+    AVPacket *pkt;
+    // packet timestamp in AV_TIME_BASE, used to measure the buffered duration
+    int64_t   ts;
+} ReadAheadEntry;
+
+typedef struct ReadAhead {
+    pthread_t             thread;
+    int                   thread_started;
+
+    pthread_mutex_t       lock;
+    pthread_cond_t        cond;
+
+    // the fields below are protected by lock
+
+    // ReadAheadEntry; non-NULL iff readahead is enabled
+    AVFifo               *queue;
+    int64_t               ts_last;
+    // error returned by av_read_frame(), the reader thread does not read
+    // anything until it is cleared
+    int                   status;
+    int                   stop;
+
+    // may be read without holding lock
+    atomic_int_least64_t  bytes;
+    atomic_int_least64_t  duration;
+} ReadAhead;
+
 typedef struct Demuxer {
     InputFile             f;
 
@@ -128,6 +159,10 @@ typedef struct Demuxer {
     float                 readrate;
     double                readrate_initial_burst;
 
+    int64_t               readahead_size;
+    int64_t               readahead_time;
+    ReadAhead             ra;
+
     Scheduler            *sch;
 
     AVPacket             *pkt_heartbeat;
@@ -679,6 +714,205 @@ static int demux_thread_init(DemuxThreadContext *dt)
     return 0;
 }
 
+static int readahead_full(Demuxer *d)
+{
+    ReadAhead *ra = &d->ra;
+
+    return (d->readahead_size > 0 && atomic_load(&ra->bytes)    >= d->readahead_size) ||
+           (d->readahead_time > 0 && atomic_load(&ra->duration) >= d->readahead_time);
+}
+
+// must be called with ra->lock held
+static void readahead_update_duration(ReadAhead *ra)
+{
+    ReadAheadEntry head;
+    int64_t duration = 0;
+
+    if (av_fifo_peek(ra->queue, &head, 1, 0) >= 0 &&
+        head.ts != AV_NOPTS_VALUE && ra->ts_last != AV_NOPTS_VALUE)
+        duration = FFMAX(ra->ts_last - head.ts, 0);
+
+    atomic_store(&ra->duration, duration);
+}
+
+static void *readahead_thread(void *arg)
+{
+    Demuxer         *d = arg;
+    ReadAhead      *ra = &d->ra;
+    AVFormatContext *s = d->f.ctx;
+    AVPacket      *pkt = NULL;
+    char name[16];
+
+    snprintf(name, sizeof(name), "dmx%d:readahead", d->f.index);
+    ff_thread_setname(name);
+
+    while (1) {
+        ReadAheadEntry e;
+        int ret, stop;
+
+        pthread_mutex_lock(&ra->lock);
+        while (!ra->stop && (ra->status || readahead_full(d)))
+            pthread_cond_wait(&ra->cond, &ra->lock);
+        stop = ra->stop;
+        pthread_mutex_unlock(&ra->lock);
+
+        if (stop)
+            break;
+
+        ret = pkt ? 0 : sch_packet_get(d->sch, &pkt);
+        if (ret >= 0)
+            ret = av_read_frame(s, pkt);
+        if (ret == AVERROR(EAGAIN)) {
+            av_usleep(10000);
+            continue;
+        }
+
+        /* new streams appearing during demuxing are ignored, drop their
+         * packets here so that the demuxing thread never accesses
+         * s->streams while it may be reallocated */
+        if (ret >= 0 && pkt->stream_index >= d->f.nb_streams) {
+            report_new_stream(d, pkt);
+            av_packet_unref(pkt);
+            continue;
+        }
+
+        pthread_mutex_lock(&ra->lock);
+
+        if (ret >= 0) {
+            const AVStream *st = s->streams[pkt->stream_index];
+            int64_t ts = pkt->dts != AV_NOPTS_VALUE ? pkt->dts : pkt->pts;
+
+            e.pkt = pkt;
+            e.ts  = ts != AV_NOPTS_VALUE ?
+                    av_rescale_q(ts, st->time_base, AV_TIME_BASE_Q) : ra->ts_last;
+
+            ret = av_fifo_write(ra->queue, &e, 1);
+            if (ret >= 0) {
+                atomic_fetch_add(&ra->bytes, pkt->size);
+                ra->ts_last = e.ts;
+                readahead_update_duration(ra);
+                pkt = NULL;
+            }
+        }
+        if (ret < 0)
+            ra->status = ret;
+
+        pthread_cond_broadcast(&ra->cond);
+        pthread_mutex_unlock(&ra->lock);
+    }
+
+    sch_packet_release(d->sch, &pkt);
+
+    return NULL;
+}
+
+static void readahead_flush(Demuxer *d)
+{
+    ReadAhead *ra = &d->ra;
+    ReadAheadEntry e;
+
+    while (av_fifo_read(ra->queue, &e, 1) >= 0)
+        sch_packet_release(d->sch, &e.pkt);
+
+    ra->ts_last = AV_NOPTS_VALUE;
+    atomic_store(&ra->bytes,    0);
+    atomic_store(&ra->duration, 0);
+}
+
+static int readahead_start(Demuxer *d)
+{
+    ReadAhead *ra = &d->ra;
+    int ret;
+
+    ra->status = 0;
+    ra->stop   = 0;
+
+    ret = pthread_create(&ra->thread, NULL, readahead_thread, d);
+    if (ret) {
+        av_log(d, AV_LOG_ERROR, "Error creating the readahead thread: %s\n",
+               av_err2str(AVERROR(ret)));
+        return AVERROR(ret);
+    }
+    ra->thread_started = 1;
+
+    return 0;
+}
+
+static void readahead_stop(Demuxer *d)
+{
+    ReadAhead *ra = &d->ra;
+
+    if (!ra->thread_started)
+        return;
+
+    pthread_mutex_lock(&ra->lock);
+    ra->stop = 1;
+    pthread_cond_broadcast(&ra->cond);
+    pthread_mutex_unlock(&ra->lock);
+
+    pthread_join(ra->thread, NULL);
+    ra->thread_started = 0;
+
+    readahead_flush(d);
+}
+
+// allow the reader thread to continue after it returned an error,
+// must only be called after that error was received by read_packet()
+static void readahead_resume(Demuxer *d)
+{
+    ReadAhead *ra = &d->ra;
+
+    pthread_mutex_lock(&ra->lock);
+    ra->status  = 0;
+    ra->ts_last = AV_NOPTS_VALUE;
+    pthread_cond_broadcast(&ra->cond);
+    pthread_mutex_unlock(&ra->lock);
+}
+
+static int read_packet(Demuxer *d, AVPacket *pkt)
+{
+    ReadAhead *ra = &d->ra;
+    ReadAheadEntry e = { NULL };
+    int ret = 0;
+
+    if (!ra->thread_started)
+        return av_read_frame(d->f.ctx, pkt);
+
+    pthread_mutex_lock(&ra->lock);
+
+    while (!av_fifo_can_read(ra->queue) && !ra->status)
+        pthread_cond_wait(&ra->cond, &ra->lock);
+
+    if (av_fifo_read(ra->queue, &e, 1) >= 0) {
+        atomic_fetch_sub(&ra->bytes, e.pkt->size);
+        readahead_update_duration(ra);
+        pthread_cond_broadcast(&ra->cond);
+    } else
+        ret = ra->status;
+
+    pthread_mutex_unlock(&ra->lock);
+
+    if (e.pkt) {
+        av_packet_move_ref(pkt, e.pkt);
+        sch_packet_release(d->sch, &e.pkt);
+    }
+
+    return ret;
+}
+
+int ifile_readahead_stats(InputFile *f, int64_t *size, int64_t *duration)
+{
+    Demuxer *d = demuxer_from_ifile(f);
+
+    if (!d->ra.queue)
+        return 0;
+
+    *size     = atomic_load(&d->ra.bytes);
+    *duration = atomic_load(&d->ra.duration);
+
+    return 1;
+}
+
 static int input_thread(void *arg)
 {
     Demuxer   *d = arg;
@@ -699,11 +933,17 @@ static int input_thread(void *arg)
     d->read_started    = 1;
     d->wallclock_start = av_gettime_relative();
 
+    if (d->ra.queue) {
+        ret = readahead_start(d);
+        if (ret < 0)
+            goto finish;
+    }
+
     while (1) {
         DemuxStream *ds;
         unsigned send_flags = 0;
 
-        ret = av_read_frame(f->ctx, dt.pkt_demux);
+        ret = read_packet(d, dt.pkt_demux);
 
         if (ret == AVERROR(EAGAIN)) {
             av_usleep(10000);
@@ -730,8 +970,11 @@ static int input_thread(void *arg)
                 if (ret >= 0)
                     ret = seek_to_start(d, (Timestamp){ .ts = dt.pkt_demux->pts,
                                                         .tb = dt.pkt_demux->time_base });
-                if (ret >= 0)
+                if (ret >= 0) {
+                    if (d->ra.thread_started)
+                        readahead_resume(d);
                     continue;
+                }
 
                 /* fallthrough to the error path */
             }
@@ -739,15 +982,16 @@ static int input_thread(void *arg)
             break;
         }
 
-        if (do_pkt_dump) {
-            av_pkt_dump_log2(NULL, AV_LOG_INFO, dt.pkt_demux, do_hex_dump,
-                             f->ctx->streams[dt.pkt_demux->stream_index]);
-        }
-
         /* the following test is needed in case new streams appear
            dynamically in stream : we ignore them */
         ds = dt.pkt_demux->stream_index < f->nb_streams ?
              ds_from_ist(f->streams[dt.pkt_demux->stream_index]) : NULL;
+
+        if (do_pkt_dump) {
+            av_pkt_dump_log2(NULL, AV_LOG_INFO, dt.pkt_demux, do_hex_dump,
+                             ds ? ds->ist.st : f->ctx->streams[dt.pkt_demux->stream_index]);
+        }
+
         if (!ds || ds->discard || ds->finished) {
             report_new_stream(d, dt.pkt_demux);
             av_packet_unref(dt.pkt_demux);
@@ -782,6 +1026,7 @@ static int input_thread(void *arg)
         ret = 0;
 
 finish:
+    readahead_stop(d);
     demux_thread_uninit(&dt);
 
     return ret;
@@ -870,6 +1115,13 @@ void ifile_close(InputFile **pf)
 
     av_packet_free(&d->pkt_heartbeat);
 
+    if (d->ra.queue) {
+        readahead_flush(d);
+        av_fifo_freep2(&d->ra.queue);
+        pthread_mutex_destroy(&d->ra.lock);
+        pthread_cond_destroy(&d->ra.cond);
+    }
+
     av_freep(pf);
 }
 
@@ -1066,7 +1318,8 @@ int ist_filter_add(InputStream *ist, InputFilter *ifilter, int is_simple,
         return AVERROR(ENOMEM);
 
     opts->flags |= IFILTER_FLAG_AUTOROTATE * !!(ds->autorotate) |
-                   IFILTER_FLAG_REINIT     * !!(ds->reinit_filters);
+                   IFILTER_FLAG_REINIT     * !!(ds->reinit_filters) |
+                   IFILTER_FLAG_ADAPT      * (ds->reinit_filters == 2);
 
     return 0;
 }
@@ -1395,7 +1648,8 @@ static int ist_add(const OptionsContext *o, Demuxer *d, AVStream *st, AVDictiona
         ist->user_set_discard = ist->st->discard;
     }
 
-    ds->dec_opts.flags |= DECODER_FLAG_BITEXACT * !!o->bitexact;
+    ds->dec_opts.flags |= DECODER_FLAG_BITEXACT  * !!o->bitexact |
+                          DECODER_FLAG_LOW_DELAY * !!low_latency;
 
     av_dict_set_int(&ds->decoder_opts, "apply_cropping",
                     ds->apply_cropping && ds->apply_cropping != CROP_CONTAINER, 0);
@@ -1717,6 +1971,8 @@ int ifile_open(const OptionsContext *o, const char *filename, Scheduler *sch)
     ic->flags |= AVFMT_FLAG_NONBLOCK;
     if (o->bitexact)
         ic->flags |= AVFMT_FLAG_BITEXACT;
+    if (low_latency)
+        ic->flags |= AVFMT_FLAG_NOBUFFER;
     ic->interrupt_callback = int_cb;
 
     if (!av_dict_get(o->g->format_opts, "scan_all_pmts", NULL, AV_DICT_MATCH_CASE)) {
@@ -1863,6 +2119,37 @@ int ifile_open(const OptionsContext *o, const char *filename, Scheduler *sch)
                "since neither -readrate nor -re were given\n");
     }
 
+    if (o->readahead_size < 0 || o->readahead_time < 0) {
+        av_log(d, AV_LOG_ERROR, "Readahead size and time must be non-negative.\n");
+        return AVERROR(EINVAL);
+    }
+    d->readahead_size = o->readahead_size;
+    d->readahead_time = o->readahead_time;
+    if ((d->readahead_size || d->readahead_time) && low_latency) {
+        av_log(d, AV_LOG_WARNING, "Readahead is disabled in low latency mode\n");
+        d->readahead_size = d->readahead_time = 0;
+    }
+    if (d->readahead_size || d->readahead_time) {
+        d->ra.queue = av_fifo_alloc2(64, sizeof(ReadAheadEntry), AV_FIFO_FLAG_AUTO_GROW);
+        if (!d->ra.queue)
+            return AVERROR(ENOMEM);
+
+        ret = pthread_mutex_init(&d->ra.lock, NULL);
+        if (!ret) {
+            ret = pthread_cond_init(&d->ra.cond, NULL);
+            if (ret)
+                pthread_mutex_destroy(&d->ra.lock);
+        }
+        if (ret) {
+            av_fifo_freep2(&d->ra.queue);
+            return AVERROR(ret);
+        }
+
+        d->ra.ts_last = AV_NOPTS_VALUE;
+        atomic_init(&d->ra.bytes,    0);
+        atomic_init(&d->ra.duration, 0);
+    }
+
     /* Add all the streams from the given input file to the demuxer */
     for (int i = 0; i < ic->nb_streams; i++) {
         ret = ist_add(o, d, ic->streams[i], &opts_used);
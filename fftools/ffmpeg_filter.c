@@ -60,6 +60,8 @@ typedef struct FilterGraphPriv {
     const char      *graph_desc;
 
     char            *nb_threads;
+    // priority of this graph's jobs in the shared filter pool
+    int              priority;
 
     // frame for temporarily holding output from the filtergraph
     AVFrame         *frame;
@@ -147,6 +149,16 @@ typedef struct InputFilterPriv {
     int                 displaymatrix_applied;
     int32_t             displaymatrix[9];
 
+    // with IFILTER_FLAG_ADAPT, converts frames whose parameters differ from
+    // the configured ones, instead of reconfiguring the whole graph
+    struct {
+        AVFilterGraph   *graph;
+        AVFilterContext *src;
+        AVFilterContext *sink;
+        // props-only frame with the input parameters of this graph
+        AVFrame         *params;
+    } adapt;
+
     struct {
         AVFrame *frame;
 
@@ -1003,6 +1015,9 @@ void fg_free(FilterGraph **pfg)
         }
         av_frame_free(&ifp->sub2video.frame);
 
+        avfilter_graph_free(&ifp->adapt.graph);
+        av_frame_free(&ifp->adapt.params);
+
         av_frame_free(&ifp->frame);
         av_frame_free(&ifp->opts.fallback);
 
@@ -1086,6 +1101,7 @@ int fg_create(FilterGraph **pfg, char *graph_desc, Scheduler *sch)
     fgp->graph_desc = graph_desc;
     fgp->disable_conversions = !auto_conversion_filters;
     fgp->sch                 = sch;
+    fgp->priority            = filter_complex_priority;
 
     snprintf(fgp->log_name, sizeof(fgp->log_name), "fc#%d", fg->index);
 
@@ -1236,6 +1252,8 @@ int fg_create_simple(FilterGraph **pfg,
     if (ret < 0)
         return ret;
 
+    fgp->priority = opts->priority;
+
     if (opts->nb_threads) {
         av_freep(&fgp->nb_threads);
         fgp->nb_threads = av_strdup(opts->nb_threads);
@@ -1854,12 +1872,39 @@ static int configure_input_filter(FilterGraph *fg, AVFilterGraph *graph,
     }
 }
 
+static void print_filter_stats(FilterGraph *fg, AVFilterGraph *graph)
+{
+    for (unsigned i = 0; i < graph->nb_filters; i++) {
+        AVFilterContext *f = graph->filters[i];
+        const AVFilterStats *st = avfilter_get_stats(f);
+
+        av_log(fg, AV_LOG_INFO,
+               "bench: filter %s (%s): %"PRId64" activations %"PRId64" us, "
+               "frames %"PRId64"/%"PRId64", samples %"PRId64"/%"PRId64", "
+               "pool %"PRId64" bytes, max queue %"PRId64", "
+               "copies %"PRId64"\n",
+               f->name, f->filter->name, st->nb_activations, st->activate_time,
+               st->frames_in, st->frames_out, st->samples_in, st->samples_out,
+               st->pool_bytes, st->max_queued_frames, st->frame_copies);
+    }
+}
+
 static void cleanup_filtergraph(FilterGraph *fg, FilterGraphThread *fgt)
 {
+    if (do_benchmark_all && fgt->graph)
+        print_filter_stats(fg, fgt->graph);
+
     for (int i = 0; i < fg->nb_outputs; i++)
         ofp_from_ofilter(fg->outputs[i])->filter = NULL;
-    for (int i = 0; i < fg->nb_inputs; i++)
-        ifp_from_ifilter(fg->inputs[i])->filter = NULL;
+    for (int i = 0; i < fg->nb_inputs; i++) {
+        InputFilterPriv *ifp = ifp_from_ifilter(fg->inputs[i]);
+
+        ifp->filter = NULL;
+
+        // the graph will be configured for the current input parameters
+        avfilter_graph_free(&ifp->adapt.graph);
+        av_frame_free(&ifp->adapt.params);
+    }
     avfilter_graph_free(&fgt->graph);
 }
 
@@ -1889,13 +1934,35 @@ static int graph_is_meta(AVFilterGraph *graph)
 
 static int sub2video_frame(InputFilter *ifilter, AVFrame *frame, int buffer);
 
+typedef struct FilterPoolJob {
+    AVFilterContext      *ctx;
+    avfilter_action_func *func;
+    void                 *arg;
+} FilterPoolJob;
+
+static int filter_pool_job(void *opaque, int jobnr, int nb_jobs)
+{
+    FilterPoolJob *job = opaque;
+    return job->func(job->ctx, job->arg, jobnr, nb_jobs);
+}
+
+static int filter_pool_execute(AVFilterContext *ctx, avfilter_action_func *func,
+                               void *arg, int *ret, int nb_jobs)
+{
+    FilterGraphPriv *fgp = ctx->graph->opaque;
+    FilterPoolJob    job = { .ctx = ctx, .func = func, .arg = arg };
+
+    return sch_filter_pool_execute(fgp->sch, fgp->priority, filter_pool_job,
+                                   &job, ret, nb_jobs);
+}
+
 static int configure_filtergraph(FilterGraph *fg, FilterGraphThread *fgt)
 {
     FilterGraphPriv *fgp = fgp_from_fg(fg);
     AVBufferRef *hw_device;
     AVFilterInOut *inputs, *outputs, *cur;
     int ret, i, simple = filtergraph_is_simple(fg);
-    int have_input_eof = 0;
+    int have_input_eof = 0, pool_size;
     const char *graph_desc = fgp->graph_desc;
 
     cleanup_filtergraph(fg, fgt);
@@ -1936,6 +2003,15 @@ static int configure_filtergraph(FilterGraph *fg, FilterGraphThread *fgt)
         fgt->graph->nb_threads = filter_complex_nbthreads;
     }
 
+    pool_size = sch_filter_pool_size(fgp->sch);
+    if (pool_size) {
+        // slice jobs of all graphs run on the scheduler's shared pool
+        fgt->graph->opaque     = fgp;
+        fgt->graph->execute    = filter_pool_execute;
+        fgt->graph->nb_threads = fgt->graph->nb_threads > 0 ?
+                                 FFMIN(fgt->graph->nb_threads, pool_size) : pool_size;
+    }
+
     hw_device = hw_device_for_filter();
 
     ret = graph_parse(fg, fgt->graph, graph_desc, &inputs, &outputs, hw_device);
@@ -2714,6 +2790,228 @@ static int sub2video_frame(InputFilter *ifilter, AVFrame *frame, int buffer)
     return 0;
 }
 
+static int send_to_buffersrc(FilterGraph *fg, InputFilterPriv *ifp, AVFrame *frame)
+{
+    FrameData *fd;
+    int ret;
+
+    frame->pts       = av_rescale_q(frame->pts,      frame->time_base, ifp->time_base);
+    frame->duration  = av_rescale_q(frame->duration, frame->time_base, ifp->time_base);
+    frame->time_base = ifp->time_base;
+
+    if (ifp->displaymatrix_applied)
+        av_frame_remove_side_data(frame, AV_FRAME_DATA_DISPLAYMATRIX);
+
+    fd = frame_data(frame);
+    if (!fd)
+        return AVERROR(ENOMEM);
+    fd->wallclock[LATENCY_PROBE_FILTER_PRE] = av_gettime_relative();
+
+    ret = av_buffersrc_add_frame_flags(ifp->filter, frame,
+                                       AV_BUFFERSRC_FLAG_PUSH);
+    if (ret < 0) {
+        av_frame_unref(frame);
+        if (ret != AVERROR_EOF)
+            av_log(fg, AV_LOG_ERROR, "Error while filtering: %s\n", av_err2str(ret));
+        return ret;
+    }
+
+    return 0;
+}
+
+static int adapter_matches(const InputFilterPriv *ifp, const AVFrame *frame)
+{
+    const AVFrame *par = ifp->adapt.params;
+
+    if (par->format != frame->format ||
+        av_cmp_q(par->time_base, frame->time_base))
+        return 0;
+
+    if (ifp->type == AVMEDIA_TYPE_AUDIO)
+        return par->sample_rate == frame->sample_rate &&
+               !av_channel_layout_compare(&par->ch_layout, &frame->ch_layout);
+
+    return par->width       == frame->width      &&
+           par->height      == frame->height     &&
+           par->colorspace  == frame->colorspace &&
+           par->color_range == frame->color_range;
+}
+
+static int adapter_configure(FilterGraph *fg, InputFilterPriv *ifp,
+                             const AVFrame *frame)
+{
+    const int video = ifp->type == AVMEDIA_TYPE_VIDEO;
+    AVFilterGraph *graph;
+    AVFilterContext *last, *filter;
+    AVBufferSrcParameters *par;
+    char args[256];
+    int ret;
+
+    if (!avfilter_get_by_name(video ? "scale" : "aresample"))
+        return AVERROR_FILTER_NOT_FOUND;
+
+    graph = ifp->adapt.graph = avfilter_graph_alloc();
+    ifp->adapt.params = av_frame_alloc();
+    if (!graph || !ifp->adapt.params)
+        return AVERROR(ENOMEM);
+
+    ifp->adapt.src = avfilter_graph_alloc_filter(graph,
+        avfilter_get_by_name(video ? "buffer" : "abuffer"), "adapt_in");
+    if (!ifp->adapt.src)
+        return AVERROR(ENOMEM);
+
+    par = av_buffersrc_parameters_alloc();
+    if (!par)
+        return AVERROR(ENOMEM);
+
+    par->format              = frame->format;
+    par->time_base           = frame->time_base;
+    par->width               = frame->width;
+    par->height              = frame->height;
+    par->sample_aspect_ratio = frame->sample_aspect_ratio;
+    par->color_space         = frame->colorspace;
+    par->color_range         = frame->color_range;
+    par->sample_rate         = frame->sample_rate;
+    par->ch_layout           = frame->ch_layout;
+    ret = av_buffersrc_parameters_set(ifp->adapt.src, par);
+    av_freep(&par);
+    if (ret < 0)
+        return ret;
+
+    ret = avfilter_init_dict(ifp->adapt.src, NULL);
+    if (ret < 0)
+        return ret;
+    last = ifp->adapt.src;
+
+    if (video) {
+        snprintf(args, sizeof(args), "w=%d:h=%d:out_color_matrix=%d:out_range=%d",
+                 ifp->width, ifp->height, ifp->color_space, ifp->color_range);
+        ret = avfilter_graph_create_filter(&filter, avfilter_get_by_name("scale"),
+                                           "adapt_scale", args, NULL, graph);
+        if (ret < 0)
+            return ret;
+        ret = avfilter_link(last, 0, filter, 0);
+        if (ret < 0)
+            return ret;
+        last = filter;
+
+        snprintf(args, sizeof(args), "pix_fmts=%s", av_get_pix_fmt_name(ifp->format));
+        ret = avfilter_graph_create_filter(&filter, avfilter_get_by_name("format"),
+                                           "adapt_format", args, NULL, graph);
+    } else {
+        char layout[64];
+
+        ret = av_channel_layout_describe(&ifp->ch_layout, layout, sizeof(layout));
+        if (ret < 0)
+            return ret;
+
+        snprintf(args, sizeof(args), "osr=%d:osf=%s:ochl=%s", ifp->sample_rate,
+                 av_get_sample_fmt_name(ifp->format), layout);
+        ret = avfilter_graph_create_filter(&filter, avfilter_get_by_name("aresample"),
+                                           "adapt_resample", args, NULL, graph);
+    }
+    if (ret < 0)
+        return ret;
+    ret = avfilter_link(last, 0, filter, 0);
+    if (ret < 0)
+        return ret;
+    last = filter;
+
+    ret = avfilter_graph_create_filter(&ifp->adapt.sink,
+                                       avfilter_get_by_name(video ? "buffersink" : "abuffersink"),
+                                       "adapt_out", NULL, NULL, graph);
+    if (ret < 0)
+        return ret;
+    ret = avfilter_link(last, 0, ifp->adapt.sink, 0);
+    if (ret < 0)
+        return ret;
+
+    ret = avfilter_graph_config(graph, NULL);
+    if (ret < 0)
+        return ret;
+
+    ret = av_frame_copy_props(ifp->adapt.params, frame);
+    if (ret < 0)
+        return ret;
+    ifp->adapt.params->format      = frame->format;
+    ifp->adapt.params->width       = frame->width;
+    ifp->adapt.params->height      = frame->height;
+    ifp->adapt.params->sample_rate = frame->sample_rate;
+    ret = av_channel_layout_copy(&ifp->adapt.params->ch_layout, &frame->ch_layout);
+    if (ret < 0)
+        return ret;
+
+    av_log(fg, AV_LOG_INFO, "Input %s parameters changed, converting them to "
+           "the configured ones instead of reconfiguring the filter graph\n",
+           ifp->opts.name);
+
+    return 0;
+}
+
+// pass all frames available from the adapter to the filtergraph
+static int adapter_drain(FilterGraph *fg, InputFilterPriv *ifp, AVFrame *frame)
+{
+    int ret;
+
+    while (1) {
+        ret = av_buffersink_get_frame(ifp->adapt.sink, frame);
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
+            return 0;
+        if (ret < 0)
+            return ret;
+
+        frame->time_base = av_buffersink_get_time_base(ifp->adapt.sink);
+
+        ret = send_to_buffersrc(fg, ifp, frame);
+        if (ret < 0)
+            return ret;
+    }
+}
+
+static int adapter_close(FilterGraph *fg, InputFilterPriv *ifp)
+{
+    AVFrame *frame = av_frame_alloc();
+    int ret;
+
+    ret = frame ? av_buffersrc_add_frame(ifp->adapt.src, NULL) : AVERROR(ENOMEM);
+    if (ret >= 0)
+        ret = adapter_drain(fg, ifp, frame);
+
+    av_frame_free(&frame);
+    avfilter_graph_free(&ifp->adapt.graph);
+    av_frame_free(&ifp->adapt.params);
+
+    return ret;
+}
+
+static int send_frame_adapted(FilterGraph *fg, InputFilterPriv *ifp, AVFrame *frame)
+{
+    int ret;
+
+    if (ifp->adapt.graph && !adapter_matches(ifp, frame)) {
+        ret = adapter_close(fg, ifp);
+        if (ret < 0)
+            return ret;
+    }
+
+    if (!ifp->adapt.graph) {
+        ret = adapter_configure(fg, ifp, frame);
+        if (ret < 0) {
+            avfilter_graph_free(&ifp->adapt.graph);
+            av_frame_free(&ifp->adapt.params);
+            return ret;
+        }
+    }
+
+    ret = av_buffersrc_add_frame(ifp->adapt.src, frame);
+    if (ret < 0) {
+        av_frame_unref(frame);
+        return ret;
+    }
+
+    return adapter_drain(fg, ifp, frame);
+}
+
 static int send_eof(FilterGraphThread *fgt, InputFilter *ifilter,
                     int64_t pts, AVRational tb)
 {
@@ -2725,6 +3023,12 @@ static int send_eof(FilterGraphThread *fgt, InputFilter *ifilter,
 
     fgt->eof_in[ifp->index] = 1;
 
+    if (ifp->adapt.graph) {
+        ret = adapter_close(ifilter->graph, ifp);
+        if (ret < 0 && ret != AVERROR_EOF)
+            return ret;
+    }
+
     if (ifp->filter) {
         pts = av_rescale_q_rnd(pts, tb, ifp->time_base,
                                AV_ROUND_NEAR_INF | AV_ROUND_PASS_MINMAX);
@@ -2785,7 +3089,6 @@ static int send_frame(FilterGraph *fg, FilterGraphThread *fgt,
                       InputFilter *ifilter, AVFrame *frame)
 {
     InputFilterPriv *ifp = ifp_from_ifilter(ifilter);
-    FrameData       *fd;
     AVFrameSideData *sd;
     int need_reinit = 0, ret;
 
@@ -2821,6 +3124,21 @@ static int send_frame(FilterGraph *fg, FilterGraphThread *fgt,
         (ifp->hw_frames_ctx && ifp->hw_frames_ctx->data != frame->hw_frames_ctx->data))
         need_reinit |= HWACCEL_CHANGED;
 
+    /* convert the frame to the configured parameters rather than
+     * reconfiguring, when that is all that changed */
+    if ((ifp->opts.flags & IFILTER_FLAG_ADAPT) && fgt->graph &&
+        !frame->hw_frames_ctx && !(need_reinit & ~(AUDIO_CHANGED | VIDEO_CHANGED))) {
+        if (need_reinit) {
+            ret = send_frame_adapted(fg, ifp, frame);
+            if (ret != AVERROR_FILTER_NOT_FOUND)
+                return ret;
+        } else if (ifp->adapt.graph) {
+            ret = adapter_close(fg, ifp);
+            if (ret < 0)
+                return ret;
+        }
+    }
+
     if (need_reinit) {
         ret = ifilter_parameters_from_frame(ifilter, frame);
         if (ret < 0)
@@ -2882,28 +3200,7 @@ static int send_frame(FilterGraph *fg, FilterGraphThread *fgt,
         }
     }
 
-    frame->pts       = av_rescale_q(frame->pts,      frame->time_base, ifp->time_base);
-    frame->duration  = av_rescale_q(frame->duration, frame->time_base, ifp->time_base);
-    frame->time_base = ifp->time_base;
-
-    if (ifp->displaymatrix_applied)
-        av_frame_remove_side_data(frame, AV_FRAME_DATA_DISPLAYMATRIX);
-
-    fd = frame_data(frame);
-    if (!fd)
-        return AVERROR(ENOMEM);
-    fd->wallclock[LATENCY_PROBE_FILTER_PRE] = av_gettime_relative();
-
-    ret = av_buffersrc_add_frame_flags(ifp->filter, frame,
-                                       AV_BUFFERSRC_FLAG_PUSH);
-    if (ret < 0) {
-        av_frame_unref(frame);
-        if (ret != AVERROR_EOF)
-            av_log(fg, AV_LOG_ERROR, "Error while filtering: %s\n", av_err2str(ret));
-        return ret;
-    }
-
-    return 0;
+    return send_to_buffersrc(fg, ifp, frame);
 }
 
 static void fg_thread_set_name(const FilterGraph *fg)
@@ -3078,6 +3375,9 @@ finish:
     if (ret == AVERROR_EOF)
         ret = 0;
 
+    if (do_benchmark_all && fgt.graph)
+        print_filter_stats(fg, fgt.graph);
+
     fg_thread_uninit(&fgt);
 
     return ret;
@@ -61,19 +61,120 @@ static int64_t filesize(AVIOContext *pb)
     return ret;
 }
 
-static void mux_log_debug_ts(OutputStream *ost, const AVPacket *pkt)
+static const char *const latency_probe_desc[] = {
+    [LATENCY_PROBE_DEMUX]       = "demux",
+    [LATENCY_PROBE_DEC_PRE]     = "decode",
+    [LATENCY_PROBE_DEC_POST]    = "decode",
+    [LATENCY_PROBE_FILTER_PRE]  = "filter",
+    [LATENCY_PROBE_FILTER_POST] = "filter",
+    [LATENCY_PROBE_ENC_PRE]     = "encode",
+    [LATENCY_PROBE_ENC_POST]    = "encode",
+    [LATENCY_PROBE_NB]          = "mux",
+};
+
+static void latency_hist_add(LatencyHist *h, int64_t val)
+{
+    int idx;
+
+    val = FFMAX(val, 0);
+    if (val < 2 * LATENCY_HIST_SUB)
+        idx = val;
+    else {
+        const int e = av_log2(val);
+        idx = LATENCY_HIST_SUB * (e - LATENCY_HIST_SHIFT + 1) +
+              ((val >> (e - LATENCY_HIST_SHIFT)) & (LATENCY_HIST_SUB - 1));
+    }
+
+    h->buckets[FFMIN(idx, LATENCY_HIST_BUCKETS - 1)]++;
+    h->max = FFMAX(h->max, val);
+    h->count++;
+}
+
+// upper bound of the given quantile, in microseconds
+static int64_t latency_hist_quantile(const LatencyHist *h, double q)
+{
+    uint64_t target = FFMAX((uint64_t)ceil(q * h->count), 1), sum = 0;
+
+    for (int i = 0; i < LATENCY_HIST_BUCKETS; i++) {
+        int64_t upper;
+
+        sum += h->buckets[i];
+        if (sum < target)
+            continue;
+
+        if (i < 2 * LATENCY_HIST_SUB)
+            upper = i;
+        else {
+            const int e = i / LATENCY_HIST_SUB + LATENCY_HIST_SHIFT - 1;
+            upper = ((int64_t)(LATENCY_HIST_SUB + i % LATENCY_HIST_SUB + 1) << (e - LATENCY_HIST_SHIFT)) - 1;
+        }
+        return FFMIN(upper, h->max);
+    }
+
+    return h->max;
+}
+
+static void latency_update(LatencyStats *ls, const AVPacket *pkt)
 {
-    static const char *desc[] = {
-        [LATENCY_PROBE_DEMUX]       = "demux",
-        [LATENCY_PROBE_DEC_PRE]     = "decode",
-        [LATENCY_PROBE_DEC_POST]    = "decode",
-        [LATENCY_PROBE_FILTER_PRE]  = "filter",
-        [LATENCY_PROBE_FILTER_POST] = "filter",
-        [LATENCY_PROBE_ENC_PRE]     = "encode",
-        [LATENCY_PROBE_ENC_POST]    = "encode",
-        [LATENCY_PROBE_NB]          = "mux",
-    };
+    const FrameData *fd = (const FrameData*)pkt->opaque_ref->data;
+    int64_t now = av_gettime_relative();
+    int first = -1;
+
+    for (int i = 0; i < LATENCY_PROBE_NB; i++) {
+        int next;
+
+        if (fd->wallclock[i] == INT64_MIN)
+            continue;
+        if (first < 0)
+            first = i;
+
+        for (next = i + 1; next < LATENCY_PROBE_NB; next++)
+            if (fd->wallclock[next] != INT64_MIN)
+                break;
 
+        latency_hist_add(&ls->stage[i], (next < LATENCY_PROBE_NB ? fd->wallclock[next] : now) -
+                                        fd->wallclock[i]);
+        ls->stage_end[i] = next;
+    }
+
+    if (first >= 0)
+        latency_hist_add(&ls->total, now - fd->wallclock[first]);
+}
+
+static void latency_print(OutputStream *ost, const LatencyHist *h, const char *name)
+{
+    av_log(ost, AV_LOG_INFO, "  %-16s p50:%9.3fms p90:%9.3fms p99:%9.3fms max:%9.3fms\n",
+           name,
+           latency_hist_quantile(h, 0.50) / 1e3, latency_hist_quantile(h, 0.90) / 1e3,
+           latency_hist_quantile(h, 0.99) / 1e3, h->max / 1e3);
+}
+
+static void latency_report(OutputStream *ost, const LatencyStats *ls)
+{
+    if (!ls->total.count)
+        return;
+
+    av_log(ost, AV_LOG_INFO, "Latency over %"PRIu64" packets:\n", ls->total.count);
+    for (int i = 0; i < LATENCY_PROBE_NB; i++) {
+        const char *from = latency_probe_desc[i];
+        const char   *to = latency_probe_desc[ls->stage_end[i]];
+        char name[32];
+
+        if (!ls->stage[i].count)
+            continue;
+
+        if (!strcmp(from, to))
+            snprintf(name, sizeof(name), "%s:", from);
+        else
+            snprintf(name, sizeof(name), "%s-%s:", from, to);
+        latency_print(ost, &ls->stage[i], name);
+    }
+    latency_print(ost, &ls->total, "total:");
+}
+
+static void mux_log_debug_ts(OutputStream *ost, const AVPacket *pkt)
+{
+    const char *const *desc = latency_probe_desc;
     char latency[512];
 
     *latency = 0;
@@ -233,6 +334,9 @@ static int write_packet(Muxer *mux, OutputStream *ost, AVPacket *pkt)
     if (ms->stats.io)
         enc_stats_write(ost, &ms->stats, NULL, pkt, frame_num);
 
+    if (ms->latency && pkt->opaque_ref)
+        latency_update(ms->latency, pkt);
+
     ret = av_interleaved_write_frame(s, pkt);
     if (ret < 0) {
         av_log(ost, AV_LOG_ERROR,
@@ -733,6 +837,9 @@ static void mux_final_stats(Muxer *mux)
                atomic_load(&ost->packets_written), s);
 
         av_log(of, AV_LOG_VERBOSE, "\n");
+
+        if (ms->latency)
+            latency_report(ost, ms->latency);
     }
 
     av_log(of, AV_LOG_VERBOSE, "  Total: %"PRIu64" packets (%"PRIu64" bytes) muxed\n",
@@ -829,6 +936,7 @@ static void ost_free(OutputStream **post)
     av_packet_free(&ms->bsf_pkt);
 
     av_packet_free(&ms->pkt);
+    av_freep(&ms->latency);
 
     av_freep(&ost->kf.pts);
     av_expr_free(ost->kf.pexpr);
@@ -33,6 +33,26 @@
 #include "libavutil/dict.h"
 #include "libavutil/fifo.h"
 
+#define LATENCY_HIST_SHIFT    4
+#define LATENCY_HIST_SUB     (1 << LATENCY_HIST_SHIFT)
+#define LATENCY_HIST_BUCKETS (LATENCY_HIST_SUB * 40)
+
+typedef struct LatencyHist {
+    uint64_t count;
+    int64_t  max;
+    /* logarithmic buckets, LATENCY_HIST_SUB per power of two; values below
+     * 2 * LATENCY_HIST_SUB microseconds are exact */
+    uint64_t buckets[LATENCY_HIST_BUCKETS];
+} LatencyHist;
+
+typedef struct LatencyStats {
+    // time from LATENCY_PROBE_* i to the next probe present, or to muxing
+    LatencyHist stage[LATENCY_PROBE_NB];
+    int         stage_end[LATENCY_PROBE_NB];
+    // time from the first probe present to muxing
+    LatencyHist total;
+} LatencyStats;
+
 typedef struct MuxStream {
     OutputStream    ost;
 
@@ -78,6 +98,9 @@ typedef struct MuxStream {
     // combined size of all the packets sent to the muxer
     uint64_t        data_size_mux;
 
+    // only allocated with -stats_latency
+    LatencyStats   *latency;
+
     int             copy_initial_nonkeyframes;
     int             copy_prior_start;
     int             streamcopy_started;
@@ -981,6 +981,9 @@ ost_bind_filter(const Muxer *mux, MuxStream *ms, OutputFilter *ofilter,
             return ret;
     }
 
+    opt_match_per_stream_int(ost, &o->filter_priorities, mux->fc, ost->st,
+                             &opts.priority);
+
     if (threads_manual) {
         ret = av_opt_get(enc_ctx, "threads", 0, (uint8_t**)&opts.nb_threads);
         if (ret < 0)
@@ -1293,6 +1296,12 @@ static int ost_add(Muxer *mux, const OptionsContext *o, enum AVMediaType type,
     else av_assert0(0);
     av_log(ost, AV_LOG_VERBOSE, "\n");
 
+    if (print_latency_stats) {
+        ms->latency = av_mallocz(sizeof(*ms->latency));
+        if (!ms->latency)
+            return AVERROR(ENOMEM);
+    }
+
     ms->pkt = av_packet_alloc();
     if (!ms->pkt)
         return AVERROR(ENOMEM);
@@ -3294,6 +3303,8 @@ int of_open(const OptionsContext *o, const char *filename, Scheduler *sch)
 
     mux->limit_filesize    = o->limit_filesize;
     av_dict_copy(&mux->opts, o->g->format_opts, 0);
+    if (low_latency)
+        av_dict_set(&mux->opts, "flush_packets", "1", AV_DICT_DONT_OVERWRITE);
 
     if (!strcmp(filename, "-"))
         filename = "pipe:";
@@ -71,10 +71,15 @@ int debug_ts          = 0;
 int exit_on_error     = 0;
 int abort_on_flags    = 0;
 int print_stats       = -1;
+int print_sched_stats = 0;
+int print_latency_stats = 0;
+int low_latency = 0;
 int stdin_interaction = 1;
 float max_error_rate  = 2.0/3;
 char *filter_nbthreads;
 int filter_complex_nbthreads = 0;
+int filter_complex_priority = 0;
+int filter_pool_threads = 0;
 int vstats_version = 2;
 int auto_conversion_filters = 1;
 int64_t stats_period = 500000;
@@ -1399,6 +1404,9 @@ int ffmpeg_parse_options(int argc, char **argv, Scheduler *sch)
     /* configure terminal and setup signal handlers */
     term_init();
 
+    if (low_latency)
+        sch_set_dec_queue_size(sch, 1);
+
     /* create complex filtergraphs */
     for (int i = 0; i < go.nb_filtergraphs; i++) {
         ret = fg_create(NULL, go.filtergraphs[i], sch);
@@ -1639,6 +1647,12 @@ const OptionDef options[] = {
     { "readrate_initial_burst", OPT_TYPE_DOUBLE, OPT_OFFSET | OPT_EXPERT | OPT_INPUT,
         { .off = OFFSET(readrate_initial_burst) },
         "The initial amount of input to burst read before imposing any readrate", "seconds" },
+    { "readahead_size",         OPT_TYPE_INT64, OPT_OFFSET | OPT_EXPERT | OPT_INPUT,
+        { .off = OFFSET(readahead_size) },
+        "read input on a separate thread, buffering up to the specified number of bytes", "size" },
+    { "readahead_time",         OPT_TYPE_TIME, OPT_OFFSET | OPT_EXPERT | OPT_INPUT,
+        { .off = OFFSET(readahead_time) },
+        "read input on a separate thread, buffering up to the specified duration", "duration" },
     { "target",                 OPT_TYPE_FUNC, OPT_FUNC_ARG | OPT_PERFILE | OPT_EXPERT | OPT_OUTPUT,
         { .func_arg = opt_target },
         "specify target file type (\"vcd\", \"svcd\", \"dvd\", \"dv\" or \"dv50\" "
@@ -1708,6 +1722,12 @@ const OptionDef options[] = {
     { "filter_threads",         OPT_TYPE_FUNC, OPT_FUNC_ARG | OPT_EXPERT,
         { .func_arg = opt_filter_threads },
         "number of non-complex filter threads" },
+    { "filter_priority",        OPT_TYPE_INT, OPT_PERSTREAM | OPT_EXPERT | OPT_OUTPUT,
+        { .off = OFFSET(filter_priorities) },
+        "priority of the stream's filter jobs in the shared filter pool", "priority" },
+    { "filter_pool_threads",    OPT_TYPE_INT, OPT_EXPERT,
+        { &filter_pool_threads },
+        "number of threads in the filter pool shared by all filtergraphs", "nb_threads" },
 #if FFMPEG_OPT_FILTER_SCRIPT
     { "filter_script",          OPT_TYPE_STRING, OPT_PERSTREAM | OPT_EXPERT | OPT_OUTPUT,
         { .off = OFFSET(filter_scripts) },
@@ -1715,13 +1735,16 @@ const OptionDef options[] = {
 #endif
     { "reinit_filter",          OPT_TYPE_INT, OPT_PERSTREAM | OPT_INPUT | OPT_EXPERT,
         { .off = OFFSET(reinit_filters) },
-        "reinit filtergraph on input parameter changes", "" },
+        "reinit filtergraph on input parameter changes, or convert the frames if set to 2", "" },
     { "filter_complex",         OPT_TYPE_FUNC, OPT_FUNC_ARG | OPT_EXPERT,
         { .func_arg = opt_filter_complex },
         "create a complex filtergraph", "graph_description" },
     { "filter_complex_threads", OPT_TYPE_INT, OPT_EXPERT,
         { &filter_complex_nbthreads },
         "number of threads for -filter_complex" },
+    { "filter_complex_priority", OPT_TYPE_INT, OPT_EXPERT,
+        { &filter_complex_priority },
+        "priority of -filter_complex jobs in the shared filter pool", "priority" },
     { "lavfi",               OPT_TYPE_FUNC, OPT_FUNC_ARG | OPT_EXPERT,
         { .func_arg = opt_filter_complex },
         "create a complex filtergraph", "graph_description" },
@@ -1739,6 +1762,15 @@ const OptionDef options[] = {
     { "stats_period",        OPT_TYPE_FUNC, OPT_FUNC_ARG | OPT_EXPERT,
         { .func_arg = opt_stats_period },
         "set the period at which ffmpeg updates stats and -progress output", "time" },
+    { "stats_latency",       OPT_TYPE_BOOL, OPT_EXPERT,
+        { &print_latency_stats },
+        "print percentiles of the latency of each processing stage for every output stream" },
+    { "low_latency",         OPT_TYPE_BOOL, OPT_EXPERT,
+        { &low_latency },
+        "minimize buffering in the transcoding pipeline" },
+    { "stats_sched",         OPT_TYPE_BOOL, OPT_EXPERT,
+        { &print_sched_stats },
+        "add per-thread scheduling statistics to -progress output" },
     { "attach",              OPT_TYPE_FUNC, OPT_FUNC_ARG | OPT_PERFILE | OPT_EXPERT | OPT_OUTPUT,
         { .func_arg = opt_attach },
         "add an attachment to the output file", "filename" },
@@ -19,6 +19,7 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include <inttypes.h>
 #include <stdatomic.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -26,12 +27,14 @@
 #include "cmdutils.h"
 #include "ffmpeg_sched.h"
 #include "ffmpeg_utils.h"
+#include "objpool.h"
 #include "sync_queue.h"
 #include "thread_queue.h"
 
 #include "libavcodec/packet.h"
 
 #include "libavutil/avassert.h"
+#include "libavutil/bprint.h"
 #include "libavutil/error.h"
 #include "libavutil/fifo.h"
 #include "libavutil/frame.h"
@@ -39,11 +42,42 @@
 #include "libavutil/thread.h"
 #include "libavutil/threadmessage.h"
 #include "libavutil/time.h"
+#include "libavutil/trace.h"
 
 // 100 ms
 // FIXME: some other value? make this dynamic?
 #define SCHEDULE_TOLERANCE (100 * 1000)
 
+typedef struct SchPoolBatch {
+    SchPoolJobFunc      func;
+    void               *opaque;
+    int                *rets;
+    int                 priority;
+
+    int                 nb_jobs;
+    // index of the next job to hand out
+    int                 next_job;
+    int                 nb_done;
+
+    struct SchPoolBatch *next;
+} SchPoolBatch;
+
+// worker threads shared by all filtergraphs for running slice jobs
+typedef struct SchPool {
+    pthread_t          *threads;
+    unsigned         nb_threads;
+
+    pthread_mutex_t     lock;
+    // signalled when new batches are queued or on shutdown
+    pthread_cond_t      work_cond;
+    // signalled when the last job of some batch completes
+    pthread_cond_t      done_cond;
+
+    // batches with jobs not yet handed out, ordered by decreasing priority
+    SchPoolBatch       *queue;
+    int                 quit;
+} SchPool;
+
 enum QueueType {
     QUEUE_PACKETS,
     QUEUE_FRAMES,
@@ -54,6 +88,9 @@ typedef struct SchWaiter {
     pthread_cond_t      cond;
     atomic_int          choked;
 
+    // total time spent choked, in microseconds
+    atomic_int_least64_t wait_time;
+
     // the following are internal state of schedule_update_locked() and must not
     // be accessed outside of it
     int                 choked_prev;
@@ -69,6 +106,10 @@ typedef struct SchTask {
 
     pthread_t           thread;
     int                 thread_running;
+
+    // av_gettime_relative() when the thread started and exited, 0 if not yet
+    atomic_int_least64_t time_start;
+    atomic_int_least64_t time_end;
 } SchTask;
 
 typedef struct SchDecOutput {
@@ -88,6 +129,9 @@ typedef struct SchDec {
     SchTask             task;
     // Queue for receiving input packets, one stream.
     ThreadQueue        *queue;
+    // packets are also sent to the queue by a muxer, see
+    // sch_mux_sub_heartbeat_add()
+    int                 queue_multi_producer;
 
     // Queue for sending post-flush end timestamps back to the source
     AVThreadMessageQueue *queue_end_ts;
@@ -292,6 +336,8 @@ struct Scheduler {
 
     SchDec             *dec;
     unsigned         nb_dec;
+    // size of the decoder packet queues, 0 for the default
+    unsigned            dec_queue_size;
 
     SchEnc             *enc;
     unsigned         nb_enc;
@@ -302,6 +348,13 @@ struct Scheduler {
     SchFilterGraph     *filters;
     unsigned         nb_filters;
 
+    SchPool             pool;
+
+    // packet/frame shells shared by all tasks, for objects that are
+    // allocated in one thread and freed in another or allocated per item
+    ObjPool            *pkt_pool;
+    ObjPool            *frame_pool;
+
     char               *sdp_filename;
     int                 sdp_auto;
 
@@ -321,11 +374,14 @@ struct Scheduler {
  */
 static int waiter_wait(Scheduler *sch, SchWaiter *w)
 {
+    int64_t t0;
     int terminate;
 
     if (!atomic_load(&w->choked))
         return 0;
 
+    t0 = av_gettime_relative();
+
     pthread_mutex_lock(&w->lock);
 
     while (atomic_load(&w->choked) && !atomic_load(&sch->terminate))
@@ -335,6 +391,9 @@ static int waiter_wait(Scheduler *sch, SchWaiter *w)
 
     pthread_mutex_unlock(&w->lock);
 
+    atomic_fetch_add_explicit(&w->wait_time, av_gettime_relative() - t0,
+                              memory_order_relaxed);
+
     return terminate;
 }
 
@@ -353,6 +412,7 @@ static int waiter_init(SchWaiter *w)
     int ret;
 
     atomic_init(&w->choked, 0);
+    atomic_init(&w->wait_time, 0);
 
     ret = pthread_mutex_init(&w->lock, NULL);
     if (ret)
@@ -372,7 +432,7 @@ static void waiter_uninit(SchWaiter *w)
 }
 
 static int queue_alloc(ThreadQueue **ptq, unsigned nb_streams, unsigned queue_size,
-                       enum QueueType type)
+                       enum QueueType type, unsigned flags)
 {
     ThreadQueue *tq;
     ObjPool *op;
@@ -399,7 +459,7 @@ static int queue_alloc(ThreadQueue **ptq, unsigned nb_streams, unsigned queue_si
         return AVERROR(ENOMEM);
 
     tq = tq_alloc(nb_streams, queue_size, op,
-                  (type == QUEUE_PACKETS) ? pkt_move : frame_move);
+                  (type == QUEUE_PACKETS) ? pkt_move : frame_move, flags);
     if (!tq) {
         objpool_free(&op);
         return AVERROR(ENOMEM);
@@ -440,6 +500,9 @@ static void task_init(Scheduler *sch, SchTask *task, enum SchedulerNodeType type
 
     task->func      = func;
     task->func_arg  = func_arg;
+
+    atomic_init(&task->time_start, 0);
+    atomic_init(&task->time_end,   0);
 }
 
 static int64_t trailing_dts(const Scheduler *sch, int count_finished)
@@ -464,6 +527,26 @@ static int64_t trailing_dts(const Scheduler *sch, int count_finished)
     return min_dts == INT64_MAX ? AV_NOPTS_VALUE : min_dts;
 }
 
+static void pool_uninit(SchPool *pool)
+{
+    if (!pool->threads)
+        return;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->quit = 1;
+    pthread_cond_broadcast(&pool->work_cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (unsigned i = 0; i < pool->nb_threads; i++)
+        pthread_join(pool->threads[i], NULL);
+    av_freep(&pool->threads);
+    pool->nb_threads = 0;
+
+    pthread_cond_destroy(&pool->done_cond);
+    pthread_cond_destroy(&pool->work_cond);
+    pthread_mutex_destroy(&pool->lock);
+}
+
 void sch_free(Scheduler **psch)
 {
     Scheduler *sch = *psch;
@@ -498,7 +581,7 @@ void sch_free(Scheduler **psch)
             if (ms->pre_mux_queue.fifo) {
                 AVPacket *pkt;
                 while (av_fifo_read(ms->pre_mux_queue.fifo, &pkt, 1) >= 0)
-                    av_packet_free(&pkt);
+                    sch_packet_release(sch, &pkt);
                 av_fifo_freep2(&ms->pre_mux_queue.fifo);
             }
 
@@ -565,6 +648,11 @@ void sch_free(Scheduler **psch)
     }
     av_freep(&sch->filters);
 
+    pool_uninit(&sch->pool);
+
+    objpool_free(&sch->pkt_pool);
+    objpool_free(&sch->frame_pool);
+
     av_freep(&sch->sdp_filename);
 
     pthread_mutex_destroy(&sch->schedule_lock);
@@ -610,12 +698,228 @@ Scheduler *sch_alloc(void)
     if (ret)
         goto fail;
 
+    sch->pkt_pool   = objpool_alloc_shared_packets(256);
+    sch->frame_pool = objpool_alloc_shared_frames(64);
+    if (!sch->pkt_pool || !sch->frame_pool)
+        goto fail;
+
     return sch;
 fail:
     sch_free(&sch);
     return NULL;
 }
 
+int sch_packet_get(Scheduler *sch, AVPacket **pkt)
+{
+    return objpool_get(sch->pkt_pool, (void**)pkt);
+}
+
+void sch_packet_release(Scheduler *sch, AVPacket **pkt)
+{
+    objpool_release(sch->pkt_pool, (void**)pkt);
+}
+
+int sch_frame_get(Scheduler *sch, AVFrame **frame)
+{
+    return objpool_get(sch->frame_pool, (void**)frame);
+}
+
+void sch_frame_release(Scheduler *sch, AVFrame **frame)
+{
+    objpool_release(sch->frame_pool, (void**)frame);
+}
+
+void sch_print_pool_stats(Scheduler *sch, struct AVBPrint *bp)
+{
+    uint64_t pkt_hits, pkt_misses, frame_hits, frame_misses;
+
+    objpool_stats(sch->pkt_pool,   &pkt_hits,   &pkt_misses);
+    objpool_stats(sch->frame_pool, &frame_hits, &frame_misses);
+
+    av_bprintf(bp, "packets: hit=%"PRIu64" miss=%"PRIu64" "
+                   "frames: hit=%"PRIu64" miss=%"PRIu64,
+               pkt_hits, pkt_misses, frame_hits, frame_misses);
+}
+
+void sch_set_dec_queue_size(Scheduler *sch, unsigned queue_size)
+{
+    av_assert0(!sch->nb_dec);
+    sch->dec_queue_size = queue_size;
+}
+
+// must be called with pool->lock held; returns the job index or -1 if the
+// batch has no more jobs to hand out
+static int pool_batch_take_locked(SchPool *pool, SchPoolBatch *b)
+{
+    int jobnr;
+
+    if (b->next_job >= b->nb_jobs)
+        return -1;
+
+    jobnr = b->next_job++;
+    if (b->next_job == b->nb_jobs) {
+        SchPoolBatch **pb = &pool->queue;
+        while (*pb != b)
+            pb = &(*pb)->next;
+        *pb = b->next;
+    }
+
+    return jobnr;
+}
+
+// must be called with pool->lock held; releases it while running the job
+static void pool_batch_run_locked(SchPool *pool, SchPoolBatch *b, int jobnr)
+{
+    int ret;
+
+    pthread_mutex_unlock(&pool->lock);
+    ret = b->func(b->opaque, jobnr, b->nb_jobs);
+    pthread_mutex_lock(&pool->lock);
+
+    if (b->rets)
+        b->rets[jobnr] = ret;
+    if (++b->nb_done == b->nb_jobs)
+        pthread_cond_broadcast(&pool->done_cond);
+}
+
+static void *pool_worker(void *arg)
+{
+    SchPool *pool = arg;
+
+    ff_thread_setname("fpool");
+
+    pthread_mutex_lock(&pool->lock);
+    while (1) {
+        SchPoolBatch *b;
+
+        while (!pool->quit && !pool->queue)
+            pthread_cond_wait(&pool->work_cond, &pool->lock);
+        if (pool->quit)
+            break;
+
+        b = pool->queue;
+        pool_batch_run_locked(pool, b, pool_batch_take_locked(pool, b));
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+int sch_filter_pool_init(Scheduler *sch, int nb_threads)
+{
+    SchPool *pool = &sch->pool;
+    int ret;
+
+    av_assert0(!pool->threads);
+
+    if (nb_threads <= 0)
+        return 0;
+
+    ret = pthread_mutex_init(&pool->lock, NULL);
+    if (ret)
+        return AVERROR(ret);
+
+    ret = pthread_cond_init(&pool->work_cond, NULL);
+    if (ret) {
+        pthread_mutex_destroy(&pool->lock);
+        return AVERROR(ret);
+    }
+
+    ret = pthread_cond_init(&pool->done_cond, NULL);
+    if (ret) {
+        pthread_cond_destroy(&pool->work_cond);
+        pthread_mutex_destroy(&pool->lock);
+        return AVERROR(ret);
+    }
+
+    pool->threads = av_calloc(nb_threads, sizeof(*pool->threads));
+    if (!pool->threads) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+
+    for (; pool->nb_threads < nb_threads; pool->nb_threads++) {
+        ret = pthread_create(&pool->threads[pool->nb_threads], NULL,
+                             pool_worker, pool);
+        if (ret) {
+            ret = AVERROR(ret);
+            goto fail;
+        }
+    }
+
+    av_log(sch, AV_LOG_VERBOSE, "Created a shared filter pool with %d threads\n",
+           nb_threads);
+
+    return 0;
+fail:
+    if (!pool->threads) {
+        pthread_cond_destroy(&pool->done_cond);
+        pthread_cond_destroy(&pool->work_cond);
+        pthread_mutex_destroy(&pool->lock);
+        return ret;
+    }
+    pool_uninit(pool);
+    return ret;
+}
+
+int sch_filter_pool_size(const Scheduler *sch)
+{
+    return sch->pool.threads ? sch->pool.nb_threads + 1 : 0;
+}
+
+int sch_filter_pool_execute(Scheduler *sch, int priority,
+                            SchPoolJobFunc func, void *opaque,
+                            int *rets, int nb_jobs)
+{
+    SchPool *pool = &sch->pool;
+    SchPoolBatch b = {
+        .func     = func,
+        .opaque   = opaque,
+        .rets     = rets,
+        .priority = priority,
+        .nb_jobs  = nb_jobs,
+    };
+    SchPoolBatch **pb;
+    int jobnr;
+
+    if (nb_jobs <= 0)
+        return 0;
+
+    // nothing to share, run the job directly
+    if (!pool->threads || nb_jobs == 1) {
+        for (int i = 0; i < nb_jobs; i++) {
+            int ret = func(opaque, i, nb_jobs);
+            if (rets)
+                rets[i] = ret;
+        }
+        return 0;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+
+    // FIFO among batches of equal priority
+    for (pb = &pool->queue; *pb && (*pb)->priority >= priority; pb = &(*pb)->next)
+        ;
+    b.next = *pb;
+    *pb    = &b;
+
+    if (nb_jobs > 2)
+        pthread_cond_broadcast(&pool->work_cond);
+    else
+        pthread_cond_signal(&pool->work_cond);
+
+    // the calling thread works on its own batch rather than idling
+    while ((jobnr = pool_batch_take_locked(pool, &b)) >= 0)
+        pool_batch_run_locked(pool, &b, jobnr);
+
+    while (b.nb_done < b.nb_jobs)
+        pthread_cond_wait(&pool->done_cond, &pool->lock);
+
+    pthread_mutex_unlock(&pool->lock);
+
+    return 0;
+}
+
 int sch_sdp_filename(Scheduler *sch, const char *sdp_filename)
 {
     av_freep(&sch->sdp_filename);
@@ -769,7 +1073,9 @@ int sch_add_dec(Scheduler *sch, SchThreadFunc func, void *ctx, int send_end_ts)
     if (ret < 0)
         return ret;
 
-    ret = queue_alloc(&dec->queue, 1, 0, QUEUE_PACKETS);
+    // a decoder is fed by exactly one demuxer stream or encoder, see
+    // sch_connect(); sch_mux_sub_heartbeat_add() reverts this if needed
+    ret = queue_alloc(&dec->queue, 1, sch->dec_queue_size, QUEUE_PACKETS, TQ_FLAG_SPSC);
     if (ret < 0)
         return ret;
 
@@ -813,7 +1119,9 @@ int sch_add_enc(Scheduler *sch, SchThreadFunc func, void *ctx,
     if (!enc->send_pkt)
         return AVERROR(ENOMEM);
 
-    ret = queue_alloc(&enc->queue, 1, 0, QUEUE_FRAMES);
+    // an encoder is fed by exactly one filtergraph output or decoder, or by
+    // its sync queue under the sync queue lock
+    ret = queue_alloc(&enc->queue, 1, 0, QUEUE_FRAMES, TQ_FLAG_SPSC);
     if (ret < 0)
         return ret;
 
@@ -861,7 +1169,7 @@ int sch_add_filtergraph(Scheduler *sch, unsigned nb_inputs, unsigned nb_outputs,
     if (ret < 0)
         return ret;
 
-    ret = queue_alloc(&fg->queue, fg->nb_inputs + 1, 0, QUEUE_FRAMES);
+    ret = queue_alloc(&fg->queue, fg->nb_inputs + 1, 0, QUEUE_FRAMES, 0);
     if (ret < 0)
         return ret;
 
@@ -1102,7 +1410,7 @@ int sch_connect(Scheduler *sch, SchedulerNode src, SchedulerNode dst)
     return 0;
 }
 
-static int mux_task_start(SchMux *mux)
+static int mux_task_start(Scheduler *sch, SchMux *mux)
 {
     int ret = 0;
 
@@ -1145,7 +1453,7 @@ static int mux_task_start(SchMux *mux)
             if (pkt) {
                 if (!ms->init_eof)
                     ret = tq_send(mux->queue, min_stream, pkt);
-                av_packet_free(&pkt);
+                sch_packet_release(sch, &pkt);
                 if (ret == AVERROR_EOF)
                     ms->init_eof = 1;
                 else if (ret < 0)
@@ -1189,12 +1497,12 @@ static int mux_init(Scheduler *sch, SchMux *mux)
         /* SDP is written only after all the muxers are ready, so now we
          * start ALL the threads */
         for (unsigned i = 0; i < sch->nb_mux; i++) {
-            ret = mux_task_start(&sch->mux[i]);
+            ret = mux_task_start(sch, &sch->mux[i]);
             if (ret < 0)
                 return ret;
         }
     } else {
-        ret = mux_task_start(mux);
+        ret = mux_task_start(sch, mux);
         if (ret < 0)
             return ret;
     }
@@ -1248,6 +1556,7 @@ int sch_mux_sub_heartbeat_add(Scheduler *sch, unsigned mux_idx, unsigned stream_
 {
     SchMux       *mux;
     SchMuxStream *ms;
+    SchDec       *dec;
     int ret = 0;
 
     av_assert0(mux_idx < sch->nb_mux);
@@ -1263,6 +1572,17 @@ int sch_mux_sub_heartbeat_add(Scheduler *sch, unsigned mux_idx, unsigned stream_
     av_assert0(dec_idx < sch->nb_dec);
     ms->sub_heartbeat_dst[ms->nb_sub_heartbeat_dst - 1] = dec_idx;
 
+    // the muxer thread will send to the decoder queue concurrently with the
+    // decoder's source, so it cannot stay single-producer
+    dec = &sch->dec[dec_idx];
+    if (!dec->queue_multi_producer) {
+        tq_free(&dec->queue);
+        ret = queue_alloc(&dec->queue, 1, sch->dec_queue_size, QUEUE_PACKETS, 0);
+        if (ret < 0)
+            return ret;
+        dec->queue_multi_producer = 1;
+    }
+
     if (!mux->sub_heartbeat_pkt) {
         mux->sub_heartbeat_pkt = av_packet_alloc();
         if (!mux->sub_heartbeat_pkt)
@@ -1545,7 +1865,7 @@ static int start_prepare(Scheduler *sch)
         }
 
         ret = queue_alloc(&mux->queue, mux->nb_streams, mux->queue_size,
-                          QUEUE_PACKETS);
+                          QUEUE_PACKETS, 0);
         if (ret < 0)
             return ret;
     }
@@ -1662,6 +1982,54 @@ fail:
     return ret;
 }
 
+static void print_task_stats(AVBPrint *bp, const char *name, unsigned idx,
+                             const SchTask *task, const SchWaiter *w,
+                             ThreadQueue *tq, int64_t now)
+{
+    int64_t start = atomic_load(&task->time_start);
+    int64_t end   = atomic_load(&task->time_end);
+    int64_t wait  = w ? atomic_load(&w->wait_time) : 0;
+    ThreadQueueStats st;
+
+    if (!start)
+        return;
+
+    if (tq) {
+        tq_get_stats(tq, &st);
+        wait += st.recv_wait;
+    }
+
+    av_bprintf(bp, "sched_%s%u_busy_us=%"PRId64"\n", name, idx,
+               FFMAX((end ? end : now) - start - wait, 0));
+    av_bprintf(bp, "sched_%s%u_wait_us=%"PRId64"\n", name, idx, wait);
+    if (tq) {
+        av_bprintf(bp, "sched_%s%u_input_blocked_us=%"PRId64"\n", name, idx, st.send_wait);
+        av_bprintf(bp, "sched_%s%u_input_queued=%zu\n", name, idx, st.queued);
+        av_bprintf(bp, "sched_%s%u_input_size=%zu\n", name, idx, st.size);
+    }
+}
+
+void sch_print_stats(Scheduler *sch, AVBPrint *bp)
+{
+    int64_t now = av_gettime_relative();
+
+    for (unsigned i = 0; i < sch->nb_demux; i++)
+        print_task_stats(bp, "demux", i, &sch->demux[i].task,
+                         &sch->demux[i].waiter, NULL, now);
+    for (unsigned i = 0; i < sch->nb_dec; i++)
+        print_task_stats(bp, "dec", i, &sch->dec[i].task, NULL,
+                         sch->dec[i].queue, now);
+    for (unsigned i = 0; i < sch->nb_filters; i++)
+        print_task_stats(bp, "filter", i, &sch->filters[i].task,
+                         &sch->filters[i].waiter, sch->filters[i].queue, now);
+    for (unsigned i = 0; i < sch->nb_enc; i++)
+        print_task_stats(bp, "enc", i, &sch->enc[i].task, NULL,
+                         sch->enc[i].queue, now);
+    for (unsigned i = 0; i < sch->nb_mux; i++)
+        print_task_stats(bp, "mux", i, &sch->mux[i].task, NULL,
+                         sch->mux[i].queue, now);
+}
+
 int sch_wait(Scheduler *sch, uint64_t timeout_us, int64_t *transcode_ts)
 {
     int ret;
@@ -1725,7 +2093,9 @@ static int send_to_enc_thread(Scheduler *sch, SchEnc *enc, AVFrame *frame)
     if (enc->in_finished)
         return AVERROR_EOF;
 
+    FF_TRACE_BEGIN("sched", "enc_send", enc - sch->enc);
     ret = tq_send(enc->queue, 0, frame);
+    FF_TRACE_END("sched", "enc_send");
     if (ret < 0)
         enc->in_finished = 1;
 
@@ -1828,7 +2198,8 @@ static int send_to_enc(Scheduler *sch, SchEnc *enc, AVFrame *frame)
            send_to_enc_thread(sch, enc, frame);
 }
 
-static int mux_queue_packet(SchMux *mux, SchMuxStream *ms, AVPacket *pkt)
+static int mux_queue_packet(Scheduler *sch, SchMux *mux, SchMuxStream *ms,
+                            AVPacket *pkt)
 {
     PreMuxQueue *q = &ms->pre_mux_queue;
     AVPacket *tmp_pkt = NULL;
@@ -1852,9 +2223,9 @@ static int mux_queue_packet(SchMux *mux, SchMuxStream *ms, AVPacket *pkt)
     }
 
     if (pkt) {
-        tmp_pkt = av_packet_alloc();
-        if (!tmp_pkt)
-            return AVERROR(ENOMEM);
+        ret = sch_packet_get(sch, &tmp_pkt);
+        if (ret < 0)
+            return ret;
 
         av_packet_move_ref(tmp_pkt, pkt);
         q->data_size += tmp_pkt->size;
@@ -1881,7 +2252,7 @@ static int send_to_mux(Scheduler *sch, SchMux *mux, unsigned stream_idx,
         pthread_mutex_lock(&sch->mux_ready_lock);
 
         if (!atomic_load(&mux->mux_started)) {
-            int ret = mux_queue_packet(mux, ms, pkt);
+            int ret = mux_queue_packet(sch, mux, ms, pkt);
             queued = ret < 0 ? ret : 1;
         }
 
@@ -1899,7 +2270,9 @@ static int send_to_mux(Scheduler *sch, SchMux *mux, unsigned stream_idx,
         if (ms->init_eof)
             return AVERROR_EOF;
 
+        FF_TRACE_BEGIN("sched", "mux_send", stream_idx);
         ret = tq_send(mux->queue, stream_idx, pkt);
+        FF_TRACE_END("sched", "mux_send");
         if (ret < 0)
             return ret;
     } else
@@ -1922,6 +2295,17 @@ update_schedule:
     return 0;
 }
 
+static int send_to_dec(Scheduler *sch, SchDec *dec, AVPacket *pkt)
+{
+    int ret;
+
+    FF_TRACE_BEGIN("sched", "dec_send", dec - sch->dec);
+    ret = tq_send(dec->queue, 0, pkt);
+    FF_TRACE_END("sched", "dec_send");
+
+    return ret;
+}
+
 static int
 demux_stream_send_to_dst(Scheduler *sch, const SchedulerNode dst,
                          uint8_t *dst_finished, AVPacket *pkt, unsigned flags)
@@ -1942,7 +2326,7 @@ demux_stream_send_to_dst(Scheduler *sch, const SchedulerNode dst,
 
     ret = (dst.type == SCH_NODE_TYPE_MUX) ?
           send_to_mux(sch, &sch->mux[dst.idx], dst.idx_stream, pkt) :
-          tq_send(sch->dec[dst.idx].queue, 0, pkt);
+          send_to_dec(sch, &sch->dec[dst.idx], pkt);
     if (ret == AVERROR_EOF)
         goto finish;
 
@@ -2009,7 +2393,7 @@ static int demux_flush(Scheduler *sch, SchDemux *d, AVPacket *pkt)
 
             dec = &sch->dec[dst->idx];
 
-            ret = tq_send(dec->queue, 0, pkt);
+            ret = send_to_dec(sch, dec, pkt);
             if (ret < 0)
                 return ret;
 
@@ -2043,7 +2427,9 @@ int sch_demux_send(Scheduler *sch, unsigned demux_idx, AVPacket *pkt,
     av_assert0(demux_idx < sch->nb_demux);
     d = &sch->demux[demux_idx];
 
+    FF_TRACE_BEGIN("sched", "demux_wait", demux_idx);
     terminate = waiter_wait(sch, &d->waiter);
+    FF_TRACE_END("sched", "demux_wait");
     if (terminate)
         return AVERROR_EXIT;
 
@@ -2086,7 +2472,9 @@ int sch_mux_receive(Scheduler *sch, unsigned mux_idx, AVPacket *pkt)
     av_assert0(mux_idx < sch->nb_mux);
     mux = &sch->mux[mux_idx];
 
+    FF_TRACE_BEGIN("sched", "mux_receive", mux_idx);
     ret = tq_receive(mux->queue, &stream_idx, pkt);
+    FF_TRACE_END("sched", "mux_receive");
     pkt->stream_index = stream_idx;
     return ret;
 }
@@ -2180,7 +2568,9 @@ int sch_dec_receive(Scheduler *sch, unsigned dec_idx, AVPacket *pkt)
         dec->expect_end_ts = 0;
     }
 
+    FF_TRACE_BEGIN("sched", "dec_receive", dec_idx);
     ret = tq_receive(dec->queue, &dummy, pkt);
+    FF_TRACE_END("sched", "dec_receive");
     av_assert0(dummy <= 0);
 
     // got a flush packet, on the next call to this function the decoder
@@ -2194,8 +2584,14 @@ int sch_dec_receive(Scheduler *sch, unsigned dec_idx, AVPacket *pkt)
 static int send_to_filter(Scheduler *sch, SchFilterGraph *fg,
                           unsigned in_idx, AVFrame *frame)
 {
-    if (frame)
-        return tq_send(fg->queue, in_idx, frame);
+    if (frame) {
+        int ret;
+
+        FF_TRACE_BEGIN("sched", "filter_send", in_idx);
+        ret = tq_send(fg->queue, in_idx, frame);
+        FF_TRACE_END("sched", "filter_send");
+        return ret;
+    }
 
     if (!fg->inputs[in_idx].send_finished) {
         fg->inputs[in_idx].send_finished = 1;
@@ -2315,7 +2711,9 @@ int sch_enc_receive(Scheduler *sch, unsigned enc_idx, AVFrame *frame)
     av_assert0(enc_idx < sch->nb_enc);
     enc = &sch->enc[enc_idx];
 
+    FF_TRACE_BEGIN("sched", "enc_receive", enc_idx);
     ret = tq_receive(enc->queue, &dummy, frame);
+    FF_TRACE_END("sched", "enc_receive");
     av_assert0(dummy <= 0);
 
     return ret;
@@ -2334,7 +2732,7 @@ static int enc_send_to_dst(Scheduler *sch, const SchedulerNode dst,
 
     ret = (dst.type == SCH_NODE_TYPE_MUX) ?
           send_to_mux(sch, &sch->mux[dst.idx], dst.idx_stream, pkt) :
-          tq_send(sch->dec[dst.idx].queue, 0, pkt);
+          send_to_dec(sch, &sch->dec[dst.idx], pkt);
     if (ret == AVERROR_EOF)
         goto finish;
 
@@ -2424,14 +2822,20 @@ int sch_filter_receive(Scheduler *sch, unsigned fg_idx,
     }
 
     if (*in_idx == fg->nb_inputs) {
-        int terminate = waiter_wait(sch, &fg->waiter);
+        int terminate;
+
+        FF_TRACE_BEGIN("sched", "filter_wait", fg_idx);
+        terminate = waiter_wait(sch, &fg->waiter);
+        FF_TRACE_END("sched", "filter_wait");
         return terminate ? AVERROR_EOF : AVERROR(EAGAIN);
     }
 
     while (1) {
         int ret, idx;
 
+        FF_TRACE_BEGIN("sched", "filter_receive", fg_idx);
         ret = tq_receive(fg->queue, &idx, frame);
+        FF_TRACE_END("sched", "filter_receive");
         if (idx < 0)
             return AVERROR_EOF;
         else if (ret >= 0) {
@@ -2539,7 +2943,11 @@ static void *task_wrapper(void *arg)
     int ret;
     int err = 0;
 
+    atomic_store(&task->time_start, av_gettime_relative());
+
     ret = task->func(task->func_arg);
+
+    atomic_store(&task->time_end, av_gettime_relative());
     if (ret < 0)
         av_log(task->func_arg, AV_LOG_ERROR,
                "Task finished with error code: %d (%s)\n", ret, av_err2str(ret));
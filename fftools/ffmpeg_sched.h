@@ -149,6 +149,44 @@ int sch_stop(Scheduler *sch, int64_t *finish_ts);
  */
 int sch_wait(Scheduler *sch, uint64_t timeout_us, int64_t *transcode_ts);
 
+struct AVBPrint;
+
+/**
+ * Append per-task statistics to bp as "key=value" lines, in the format used
+ * for -progress output. For every task this reports the time spent working
+ * and waiting for input (or, for demuxers, waiting to be unchoked); for
+ * tasks with an input queue also the time senders spent blocked on it being
+ * full and its current occupancy.
+ *
+ * May be called from any thread while the scheduler is running or after it
+ * has been stopped.
+ */
+void sch_print_stats(Scheduler *sch, struct AVBPrint *bp);
+
+/**
+ * Get a blank packet/frame from the pool shared by all tasks, allocating a new
+ * one if the pool is empty. Meant for objects that are allocated for every
+ * packet/frame or that are passed between threads. May be called from any
+ * thread.
+ *
+ * @return 0 on success, a negative error code on allocation failure
+ */
+int sch_packet_get(Scheduler *sch, struct AVPacket **pkt);
+int sch_frame_get(Scheduler *sch, struct AVFrame **frame);
+
+/**
+ * Unreference the packet/frame and return it to the shared pool, or free it if
+ * the pool is full. *pkt / *frame is set to NULL.
+ */
+void sch_packet_release(Scheduler *sch, struct AVPacket **pkt);
+void sch_frame_release(Scheduler *sch, struct AVFrame **frame);
+
+/**
+ * Print the hit and miss counts of the shared packet and frame pools to bp,
+ * on a single line.
+ */
+void sch_print_pool_stats(Scheduler *sch, struct AVBPrint *bp);
+
 /**
  * Add a demuxer to the scheduler.
  *
@@ -259,6 +297,13 @@ int sch_add_mux(Scheduler *sch, SchThreadFunc func, int (*init)(void *),
  */
 #define DEFAULT_FRAME_THREAD_QUEUE_SIZE 8
 
+/**
+ * Set the size of the packet queues feeding decoders, instead of
+ * DEFAULT_PACKET_THREAD_QUEUE_SIZE. Must be called before any decoders are
+ * added.
+ */
+void sch_set_dec_queue_size(Scheduler *sch, unsigned queue_size);
+
 /**
  * Add a muxed stream for a previously added muxer.
  *
@@ -443,6 +488,41 @@ int sch_filter_send(Scheduler *sch, unsigned fg_idx, unsigned out_idx,
 
 int sch_filter_command(Scheduler *sch, unsigned fg_idx, struct AVFrame *frame);
 
+typedef int (*SchPoolJobFunc)(void *opaque, int jobnr, int nb_jobs);
+
+/**
+ * Create a pool of worker threads that is shared by all filtergraphs for
+ * running their slice-threaded jobs, so that the total number of filtering
+ * threads does not grow with the number of filtergraphs.
+ *
+ * @param nb_threads Number of worker threads. When 0, no pool is created and
+ *                   each filtergraph keeps its own threads.
+ */
+int sch_filter_pool_init(Scheduler *sch, int nb_threads);
+
+/**
+ * @return number of jobs the shared filter pool can run concurrently (its
+ *         worker threads plus the submitting thread), or 0 when there is no
+ *         pool
+ */
+int sch_filter_pool_size(const Scheduler *sch);
+
+/**
+ * Called by filtergraph tasks to run nb_jobs invocations of func on the shared
+ * filter pool. Blocks until all of them have completed; the calling thread
+ * executes jobs of its own batch while waiting.
+ *
+ * Pending batches with higher priority are served first, batches with equal
+ * priority in submission order.
+ *
+ * @param rets If non-NULL, the return value of job i is stored in rets[i].
+ *
+ * @retval 0 all jobs have completed
+ */
+int sch_filter_pool_execute(Scheduler *sch, int priority,
+                            SchPoolJobFunc func, void *opaque,
+                            int *rets, int nb_jobs);
+
 /**
  * Called by encoder tasks to obtain frames for encoding. Will wait for a frame
  * to become available and return it in frame.
@@ -32,6 +32,7 @@
 
 #include "libavutil/avstring.h"
 #include "libavutil/channel_layout.h"
+#include "libavutil/cpu.h"
 #include "libavutil/mathematics.h"
 #include "libavutil/mem.h"
 #include "libavutil/pixdesc.h"
@@ -44,6 +45,7 @@
 #include "libavdevice/avdevice.h"
 #include "libswscale/swscale.h"
 #include "libavutil/opt.h"
+#include "libavutil/parseutils.h"
 #include "libavutil/tx.h"
 #include "libswresample/swresample.h"
 
@@ -351,6 +353,11 @@ static int filter_nbthreads = 0;
 static int enable_vulkan = 0;
 static char *vulkan_params = NULL;
 static const char *hwaccel = NULL;
+static int mosaic = 0;
+static const char *mosaic_size = "480x270";
+static const char *mosaic_skip_frame = NULL;
+static char **mosaic_inputs = NULL;
+static int nb_mosaic_inputs = 0;
 
 /* current context */
 static int is_full_screen;
@@ -965,17 +972,24 @@ static void video_image_display(VideoState *is)
     SDL_Rect rect;
 
     vp = frame_queue_peek_last(&is->pictq);
-    if (vk_renderer) {
-        vk_renderer_display(vk_renderer, vp->frame);
-        return;
-    }
-
     if (is->subtitle_st) {
         if (frame_queue_nb_remaining(&is->subpq) > 0) {
             sp = frame_queue_peek(&is->subpq);
 
             if (vp->pts >= sp->pts + ((float) sp->sub.start_display_time / 1000)) {
-                if (!sp->uploaded) {
+                if (vk_renderer) {
+                    /* the renderer blends the subtitle on the GPU */
+                    if (!sp->uploaded) {
+                        if (!sp->width || !sp->height) {
+                            sp->width = vp->width;
+                            sp->height = vp->height;
+                        }
+                        if (vk_renderer_set_subtitle(vk_renderer, &sp->sub, sp->width, sp->height) < 0)
+                            sp = NULL;
+                        else
+                            sp->uploaded = 1;
+                    }
+                } else if (!sp->uploaded) {
                     uint8_t* pixels[4];
                     int pitch[4];
                     int i;
@@ -1015,6 +1029,13 @@ static void video_image_display(VideoState *is)
         }
     }
 
+    if (vk_renderer) {
+        if (!sp)
+            vk_renderer_set_subtitle(vk_renderer, NULL, 0, 0);
+        vk_renderer_display(vk_renderer, vp->frame);
+        return;
+    }
+
     calculate_display_rect(&rect, is->xleft, is->ytop, is->width, is->height, vp->width, vp->height, vp->sar);
     set_sdl_yuv_conversion_mode(vp->frame);
 
@@ -1317,6 +1338,9 @@ static void do_exit(VideoState *is)
     av_freep(&audio_codec_name);
     av_freep(&subtitle_codec_name);
     av_freep(&input_filename);
+    for (int i = 0; i < nb_mosaic_inputs; i++)
+        av_freep(&mosaic_inputs[i]);
+    av_freep(&mosaic_inputs);
     avformat_network_deinit();
     if (show_status)
         printf("\n");
@@ -1665,7 +1689,7 @@ retry:
                             || (is->vidclk.pts > (sp->pts + ((float) sp->sub.end_display_time / 1000)))
                             || (sp2 && is->vidclk.pts > (sp2->pts + ((float) sp2->sub.start_display_time / 1000))))
                     {
-                        if (sp->uploaded) {
+                        if (sp->uploaded && !vk_renderer) {
                             int i;
                             for (i = 0; i < sp->sub.num_rects; i++) {
                                 AVSubtitleRect *sub_rect = sp->sub.rects[i];
@@ -3617,21 +3641,95 @@ static int opt_show_mode(void *optctx, const char *opt, const char *arg)
 
 static int opt_input_file(void *optctx, const char *filename)
 {
-    if (input_filename) {
-        av_log(NULL, AV_LOG_FATAL,
-               "Argument '%s' provided as input filename, but '%s' was already specified.\n",
-                filename, input_filename);
-        return AVERROR(EINVAL);
-    }
+    int ret;
+
     if (!strcmp(filename, "-"))
         filename = "fd:";
-    input_filename = av_strdup(filename);
-    if (!input_filename)
+
+    /* more than one input is only accepted with -mosaic, which may still
+     * follow on the command line, so check that after parsing */
+    ret = GROW_ARRAY(mosaic_inputs, nb_mosaic_inputs);
+    if (ret < 0)
+        return ret;
+
+    mosaic_inputs[nb_mosaic_inputs - 1] = av_strdup(filename);
+    if (!mosaic_inputs[nb_mosaic_inputs - 1])
         return AVERROR(ENOMEM);
 
     return 0;
 }
 
+/* escape str for use as a filter option value inside a filtergraph */
+static void bprint_filter_arg(AVBPrint *bp, const char *str)
+{
+    AVBPrint arg;
+
+    av_bprint_init(&arg, 0, AV_BPRINT_SIZE_UNLIMITED);
+    av_bprint_escape(&arg, str, ":=\\'", AV_ESCAPE_MODE_BACKSLASH, AV_ESCAPE_FLAG_WHITESPACE);
+    av_bprint_escape(bp, arg.str, "[],;\\'", AV_ESCAPE_MODE_BACKSLASH, 0);
+    av_bprint_finalize(&arg, NULL);
+}
+
+/**
+ * Build a lavfi graph playing all the inputs side by side, each one decoded
+ * by its own movie source and scaled into a cell of a grid. The first input
+ * has the focus; the others may skip frames to save decoding time.
+ */
+static int mosaic_open(void)
+{
+    const int nb = nb_mosaic_inputs;
+    const int cols = ceil(sqrt(nb));
+    const int threads = FFMAX(1, av_cpu_count() / nb);
+    int w, h, ret;
+    AVBPrint bp;
+
+    ret = av_parse_video_size(&w, &h, mosaic_size);
+    if (ret < 0) {
+        av_log(NULL, AV_LOG_FATAL, "Invalid mosaic cell size: %s\n", mosaic_size);
+        return ret;
+    }
+
+    file_iformat = av_find_input_format("lavfi");
+    if (!file_iformat) {
+        av_log(NULL, AV_LOG_FATAL, "The lavfi input device is required for -mosaic\n");
+        return AVERROR(ENOSYS);
+    }
+
+    av_bprint_init(&bp, 0, AV_BPRINT_SIZE_UNLIMITED);
+    for (int i = 0; i < nb; i++) {
+        av_bprintf(&bp, "movie=filename=");
+        bprint_filter_arg(&bp, mosaic_inputs[i]);
+        av_bprintf(&bp, ":s=dv:dec_threads=%d", threads);
+        if (i && mosaic_skip_frame) {
+            av_bprintf(&bp, ":dec_opts=skip_frame=");
+            bprint_filter_arg(&bp, mosaic_skip_frame);
+        }
+        av_bprintf(&bp, ",scale=%d:%d:force_original_aspect_ratio=decrease,"
+                   "pad=%d:%d:-1:-1,setsar=1[m%d];", w, h, w, h, i);
+    }
+    if (nb == 1) {
+        av_bprintf(&bp, "[m0]null[out0]");
+    } else {
+        for (int i = 0; i < nb; i++)
+            av_bprintf(&bp, "[m%d]", i);
+        av_bprintf(&bp, "xstack=inputs=%d:fill=black:layout=", nb);
+        for (int i = 0; i < nb; i++)
+            av_bprintf(&bp, "%s%d_%d", i ? "|" : "", i % cols * w, i / cols * h);
+        av_bprintf(&bp, "[out0]");
+    }
+
+    ret = av_bprint_finalize(&bp, (char **)&input_filename);
+    if (ret < 0)
+        return ret;
+
+    av_log(NULL, AV_LOG_VERBOSE, "Mosaic filtergraph: %s\n", input_filename);
+
+    if (!window_title)
+        window_title = "ffplay mosaic";
+
+    return 0;
+}
+
 static int opt_codec(void *optctx, const char *opt, const char *arg)
 {
    const char *spec = strchr(opt, ':');
@@ -3712,6 +3810,9 @@ static const OptionDef options[] = {
     { "enable_vulkan",      OPT_TYPE_BOOL,            0, { &enable_vulkan }, "enable vulkan renderer" },
     { "vulkan_params",      OPT_TYPE_STRING, OPT_EXPERT, { &vulkan_params }, "vulkan configuration using a list of key=value pairs separated by ':'" },
     { "hwaccel",            OPT_TYPE_STRING, OPT_EXPERT, { &hwaccel }, "use HW accelerated decoding" },
+    { "mosaic",             OPT_TYPE_BOOL,            0, { &mosaic }, "play all the input files side by side in one window" },
+    { "mosaic_size",        OPT_TYPE_STRING, OPT_EXPERT, { &mosaic_size }, "set the size of each mosaic cell", "size" },
+    { "mosaic_skip_frame",  OPT_TYPE_STRING, OPT_EXPERT, { &mosaic_skip_frame }, "set the skip_frame decoder option of all mosaic inputs but the first", "discard" },
     { NULL, },
 };
 
@@ -3779,6 +3880,21 @@ int main(int argc, char **argv)
     if (ret < 0)
         exit(ret == AVERROR_EXIT ? 0 : 1);
 
+    if (nb_mosaic_inputs > 1 && !mosaic) {
+        av_log(NULL, AV_LOG_FATAL,
+               "Argument '%s' provided as input filename, but '%s' was already specified.\n",
+               mosaic_inputs[1], mosaic_inputs[0]);
+        exit(1);
+    }
+
+    if (mosaic && nb_mosaic_inputs) {
+        if (mosaic_open() < 0)
+            exit(1);
+    } else if (nb_mosaic_inputs) {
+        input_filename = mosaic_inputs[0];
+        mosaic_inputs[0] = NULL;
+    }
+
     if (!input_filename) {
         show_usage();
         av_log(NULL, AV_LOG_FATAL, "An input file must be specified\n");
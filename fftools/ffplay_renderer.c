@@ -55,6 +55,9 @@ struct VkRenderer {
 
     int (*display)(VkRenderer *renderer, AVFrame *frame);
 
+    int (*set_subtitle)(VkRenderer *renderer, const AVSubtitle *sub,
+                        int width, int height);
+
     int (*resize)(VkRenderer *renderer, int width, int height);
 
     void (*destroy)(VkRenderer *renderer);
@@ -85,6 +88,16 @@ typedef struct RendererContext {
     VkInstance inst;
 
     AVFrame *vk_frame;
+
+    // subtitle bitmaps, converted to RGBA and composed by the renderer
+    pl_tex sub_tex;
+    struct pl_overlay_part *sub_parts;
+    unsigned sub_parts_size;
+    int nb_sub_parts;
+    int sub_width;
+    int sub_height;
+    uint8_t *sub_buf;
+    unsigned sub_buf_size;
 } RendererContext;
 
 static void vk_log_cb(void *log_priv, enum pl_log_level level,
@@ -690,11 +703,105 @@ static int convert_frame(VkRenderer *renderer, AVFrame *frame)
     return ret;
 }
 
+static int set_subtitle(VkRenderer *renderer, const AVSubtitle *sub,
+                        int width, int height)
+{
+    RendererContext *ctx = (RendererContext *) renderer;
+    pl_gpu gpu = ctx->placebo_vulkan->gpu;
+    struct pl_overlay_part *parts;
+    size_t buf_size = 0;
+    uint8_t *dst;
+    int nb_parts = 0;
+
+    ctx->nb_sub_parts = 0;
+    if (!sub || !sub->num_rects || width <= 0 || height <= 0)
+        return 0;
+
+    for (unsigned i = 0; i < sub->num_rects; i++) {
+        AVSubtitleRect *rect = sub->rects[i];
+
+        rect->x = av_clip(rect->x, 0, width);
+        rect->y = av_clip(rect->y, 0, height);
+        rect->w = av_clip(rect->w, 0, width  - rect->x);
+        rect->h = av_clip(rect->h, 0, height - rect->y);
+        if (rect->type == SUBTITLE_BITMAP)
+            buf_size += (size_t)rect->w * rect->h * 4;
+    }
+    if (!buf_size)
+        return 0;
+
+    if (!pl_tex_recreate(gpu, &ctx->sub_tex, &(struct pl_tex_params) {
+            .w              = width,
+            .h              = height,
+            .format         = pl_find_named_fmt(gpu, "rgba8"),
+            .sampleable     = true,
+            .host_writable  = true,
+        })) {
+        av_log(renderer, AV_LOG_ERROR, "Failed to create subtitle texture\n");
+        return AVERROR_EXTERNAL;
+    }
+
+    parts = av_fast_realloc(ctx->sub_parts, &ctx->sub_parts_size,
+                            sub->num_rects * sizeof(*parts));
+    if (!parts)
+        return AVERROR(ENOMEM);
+    ctx->sub_parts = parts;
+
+    // every rect gets its own region, as the uploads may still be in flight
+    av_fast_malloc(&ctx->sub_buf, &ctx->sub_buf_size, buf_size);
+    if (!ctx->sub_buf)
+        return AVERROR(ENOMEM);
+    dst = ctx->sub_buf;
+
+    for (unsigned i = 0; i < sub->num_rects; i++) {
+        const AVSubtitleRect *rect = sub->rects[i];
+        const uint32_t *pal = (const uint32_t *) rect->data[1];
+        uint8_t *p = dst;
+
+        if (rect->type != SUBTITLE_BITMAP || !rect->w || !rect->h)
+            continue;
+
+        for (int y = 0; y < rect->h; y++) {
+            const uint8_t *src = rect->data[0] + y * rect->linesize[0];
+            for (int x = 0; x < rect->w; x++, p += 4) {
+                uint32_t argb = pal[src[x]];
+                p[0] = argb >> 16;
+                p[1] = argb >>  8;
+                p[2] = argb;
+                p[3] = argb >> 24;
+            }
+        }
+
+        if (!pl_tex_upload(gpu, &(struct pl_tex_transfer_params) {
+                .tex        = ctx->sub_tex,
+                .rc         = { rect->x, rect->y, 0,
+                                rect->x + rect->w, rect->y + rect->h, 1 },
+                .row_pitch  = rect->w * 4,
+                .ptr        = dst,
+            })) {
+            av_log(renderer, AV_LOG_ERROR, "Failed to upload subtitle\n");
+            return AVERROR_EXTERNAL;
+        }
+        dst = p;
+
+        parts[nb_parts++] = (struct pl_overlay_part) {
+            .src = { rect->x, rect->y, rect->x + rect->w, rect->y + rect->h },
+        };
+    }
+
+    ctx->nb_sub_parts = nb_parts;
+    ctx->sub_width    = width;
+    ctx->sub_height   = height;
+
+    return 0;
+}
+
 static int display(VkRenderer *renderer, AVFrame *frame)
 {
     struct pl_swapchain_frame swap_frame = {0};
     struct pl_frame pl_frame = {0};
     struct pl_frame target = {0};
+    struct pl_overlay overlay;
     RendererContext *ctx = (RendererContext *) renderer;
     int ret = 0;
     struct pl_color_space hint = {0};
@@ -710,6 +817,33 @@ static int display(VkRenderer *renderer, AVFrame *frame)
         return AVERROR_EXTERNAL;
     }
 
+    if (ctx->nb_sub_parts) {
+        // stretch the subtitle canvas over the source frame
+        float sx = (float) frame->width  / ctx->sub_width;
+        float sy = (float) frame->height / ctx->sub_height;
+
+        for (int i = 0; i < ctx->nb_sub_parts; i++) {
+            struct pl_overlay_part *part = &ctx->sub_parts[i];
+            part->dst = (pl_rect2df) {
+                part->src.x0 * sx, part->src.y0 * sy,
+                part->src.x1 * sx, part->src.y1 * sy,
+            };
+        }
+
+        overlay = (struct pl_overlay) {
+            .tex        = ctx->sub_tex,
+            .mode       = PL_OVERLAY_NORMAL,
+            .repr       = pl_color_repr_rgb,
+            .color      = pl_color_space_srgb,
+            .parts      = ctx->sub_parts,
+            .num_parts  = ctx->nb_sub_parts,
+        };
+        overlay.repr.alpha = PL_ALPHA_INDEPENDENT;
+
+        pl_frame.overlays     = &overlay;
+        pl_frame.num_overlays = 1;
+    }
+
     pl_color_space_from_avframe(&hint, frame);
     pl_swapchain_colorspace_hint(ctx->swapchain, &hint);
     if (!pl_swapchain_start_frame(ctx->swapchain, &swap_frame)) {
@@ -754,12 +888,15 @@ static void destroy(VkRenderer *renderer)
 
     av_frame_free(&ctx->vk_frame);
     av_freep(&ctx->transfer_formats);
+    av_freep(&ctx->sub_parts);
+    av_freep(&ctx->sub_buf);
     av_hwframe_constraints_free(&ctx->constraints);
     av_buffer_unref(&ctx->hw_frame_ref);
 
     if (ctx->placebo_vulkan) {
         for (int i = 0; i < FF_ARRAY_ELEMS(ctx->tex); i++)
             pl_tex_destroy(ctx->placebo_vulkan->gpu, &ctx->tex[i]);
+        pl_tex_destroy(ctx->placebo_vulkan->gpu, &ctx->sub_tex);
         pl_renderer_destroy(&ctx->renderer);
         pl_swapchain_destroy(&ctx->swapchain);
         pl_vulkan_destroy(&ctx->placebo_vulkan);
@@ -796,6 +933,7 @@ VkRenderer *vk_get_renderer(void)
     renderer->get_hw_dev = get_hw_dev;
     renderer->create = create;
     renderer->display = display;
+    renderer->set_subtitle = set_subtitle;
     renderer->resize = resize;
     renderer->destroy = destroy;
 
@@ -827,6 +965,12 @@ int vk_renderer_display(VkRenderer *renderer, AVFrame *frame)
     return renderer->display(renderer, frame);
 }
 
+int vk_renderer_set_subtitle(VkRenderer *renderer, const AVSubtitle *sub,
+                             int width, int height)
+{
+    return renderer->set_subtitle(renderer, sub, width, height);
+}
+
 int vk_renderer_resize(VkRenderer *renderer, int width, int height)
 {
     return renderer->resize(renderer, width, height);
@@ -21,6 +21,7 @@
 
 #include <SDL.h>
 
+#include "libavcodec/avcodec.h"
 #include "libavutil/frame.h"
 
 typedef struct VkRenderer VkRenderer;
@@ -34,6 +35,14 @@ int vk_renderer_get_hw_dev(VkRenderer *renderer, AVBufferRef **dev);
 
 int vk_renderer_display(VkRenderer *renderer, AVFrame *frame);
 
+/**
+ * Upload the bitmap rects of sub, positioned on a width x height canvas that
+ * is stretched over the video, and blend them over every frame displayed
+ * from now on. Pass NULL to stop displaying the subtitle.
+ */
+int vk_renderer_set_subtitle(VkRenderer *renderer, const AVSubtitle *sub,
+                             int width, int height);
+
 int vk_renderer_resize(VkRenderer *renderer, int width, int height);
 
 void vk_renderer_destroy(VkRenderer *renderer);
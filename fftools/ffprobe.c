@@ -89,6 +89,10 @@ typedef struct InputStream {
     AVStream *st;
 
     AVCodecContext *dec_ctx;
+
+    /* used instead of dec_ctx with -parse_frames */
+    AVCodecContext *parser_ctx;
+    AVCodecParserContext *parser;
 } InputStream;
 
 typedef struct InputFile {
@@ -104,6 +108,7 @@ const int program_birth_year = 2007;
 static int do_bitexact = 0;
 static int do_count_frames = 0;
 static int do_count_packets = 0;
+static int do_parse_frames = 0;
 static int do_read_frames  = 0;
 static int do_read_packets = 0;
 static int do_show_chapters = 0;
@@ -1790,6 +1795,109 @@ static const Writer json_writer = {
     .priv_class           = &json_class,
 };
 
+/* CBOR output */
+
+/*
+ * Binary output following RFC 8949. Sections are written as indefinite
+ * length maps and arrays, so nothing has to be buffered, and values are
+ * written without any text formatting.
+ */
+
+#define CBOR_MAJOR_UINT  0
+#define CBOR_MAJOR_NINT  1
+#define CBOR_MAJOR_TEXT  3
+#define CBOR_MAJOR_ARRAY 4
+#define CBOR_MAJOR_MAP   5
+
+#define CBOR_INDEFINITE  31
+#define CBOR_BREAK       0xff
+
+static void cbor_put_head(WriterContext *wctx, int major, uint64_t val)
+{
+    int n;
+
+    major <<= 5;
+    if (val < 24) {
+        writer_w8(wctx, major | val);
+        return;
+    } else if (val <= UINT8_MAX) {
+        writer_w8(wctx, major | 24);
+        n = 1;
+    } else if (val <= UINT16_MAX) {
+        writer_w8(wctx, major | 25);
+        n = 2;
+    } else if (val <= UINT32_MAX) {
+        writer_w8(wctx, major | 26);
+        n = 4;
+    } else {
+        writer_w8(wctx, major | 27);
+        n = 8;
+    }
+
+    while (n--)
+        writer_w8(wctx, (val >> (8 * n)) & 0xff);
+}
+
+static void cbor_put_text(WriterContext *wctx, const char *str)
+{
+    size_t len = strlen(str);
+
+    cbor_put_head(wctx, CBOR_MAJOR_TEXT, len);
+    if (len)
+        writer_put_str(wctx, str);
+}
+
+static void cbor_print_section_header(WriterContext *wctx, const void *data)
+{
+    const struct section *section = wctx->section[wctx->level];
+    const struct section *parent_section = wctx->level ?
+        wctx->section[wctx->level-1] : NULL;
+
+    if (parent_section && !(parent_section->flags & SECTION_FLAG_IS_ARRAY))
+        cbor_put_text(wctx, section->name);
+
+    if (section->flags & SECTION_FLAG_IS_ARRAY) {
+        writer_w8(wctx, CBOR_MAJOR_ARRAY << 5 | CBOR_INDEFINITE);
+    } else {
+        writer_w8(wctx, CBOR_MAJOR_MAP << 5 | CBOR_INDEFINITE);
+
+        /* this is required so the parser can distinguish between packets and frames */
+        if (parent_section && parent_section->id == SECTION_ID_PACKETS_AND_FRAMES) {
+            cbor_put_text(wctx, "type");
+            cbor_put_text(wctx, section->name);
+        }
+    }
+}
+
+static void cbor_print_section_footer(WriterContext *wctx)
+{
+    writer_w8(wctx, CBOR_BREAK);
+}
+
+static void cbor_print_str(WriterContext *wctx, const char *key, const char *value)
+{
+    cbor_put_text(wctx, key);
+    cbor_put_text(wctx, value);
+}
+
+static void cbor_print_int(WriterContext *wctx, const char *key, int64_t value)
+{
+    cbor_put_text(wctx, key);
+    if (value >= 0)
+        cbor_put_head(wctx, CBOR_MAJOR_UINT, value);
+    else
+        cbor_put_head(wctx, CBOR_MAJOR_NINT, -(uint64_t)(value + 1));
+}
+
+static const Writer cbor_writer = {
+    .name                 = "cbor",
+    .print_section_header = cbor_print_section_header,
+    .print_section_footer = cbor_print_section_footer,
+    .print_integer        = cbor_print_int,
+    .print_string         = cbor_print_str,
+    .flags = WRITER_FLAG_PUT_PACKETS_AND_FRAMES_IN_SAME_CHAPTER,
+};
+
 /* XML output */
 
 typedef struct XMLContext {
@@ -1976,6 +2084,7 @@ static void writer_register_all(void)
     writer_register(&flat_writer);
     writer_register(&ini_writer);
     writer_register(&json_writer);
+    writer_register(&cbor_writer);
     writer_register(&xml_writer);
 }
 
@@ -3000,6 +3109,83 @@ static void show_frame(WriterContext *w, AVFrame *frame, AVStream *stream,
     fflush(stdout);
 }
 
+/**
+ * Build a frame entry from a packet and its parser output, without decoding.
+ * Fields that are only known after decoding are taken from the stream
+ * parameters.
+ */
+static int parse_frame(WriterContext *w, InputFile *ifile,
+                       AVFrame *frame, const AVPacket *pkt)
+{
+    InputStream *ist = &ifile->streams[pkt->stream_index];
+    AVCodecParserContext *parser = ist->parser;
+    const AVCodecParameters *par = ist->st->codecpar;
+    const AVCodecDescriptor *desc = avcodec_descriptor_get(par->codec_id);
+    int key, ret;
+
+    if (!ist->parser_ctx || !pkt->data)
+        return 0;
+
+    if (parser) {
+        uint8_t *out;
+        int out_size;
+
+        av_parser_parse2(parser, ist->parser_ctx, &out, &out_size,
+                         pkt->data, pkt->size, pkt->pts, pkt->dts, pkt->pos);
+    }
+
+    if (par->codec_type != AVMEDIA_TYPE_VIDEO &&
+        par->codec_type != AVMEDIA_TYPE_AUDIO &&
+        par->codec_type != AVMEDIA_TYPE_SUBTITLE)
+        return 0;
+
+    nb_streams_frames[pkt->stream_index]++;
+    if (!do_show_frames || par->codec_type == AVMEDIA_TYPE_SUBTITLE)
+        return 0;
+
+    key = parser && parser->key_frame >= 0 ? parser->key_frame
+                                           : !!(pkt->flags & AV_PKT_FLAG_KEY);
+    if (key)
+        frame->flags |= AV_FRAME_FLAG_KEY;
+    frame->pts                   = pkt->pts;
+    frame->pkt_dts               = pkt->dts;
+    frame->best_effort_timestamp = pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+    frame->duration              = pkt->duration;
+    frame->opaque_ref            = av_buffer_ref(pkt->opaque_ref);
+    if (!frame->opaque_ref)
+        return AVERROR(ENOMEM);
+
+    if (par->codec_type == AVMEDIA_TYPE_VIDEO) {
+        frame->format              = parser && parser->format >= 0 ? parser->format : par->format;
+        frame->width               = parser && parser->width  > 0 ? parser->width  : par->width;
+        frame->height              = parser && parser->height > 0 ? parser->height : par->height;
+        frame->sample_aspect_ratio = par->sample_aspect_ratio;
+        frame->repeat_pict         = parser ? parser->repeat_pict : 0;
+        frame->color_range         = par->color_range;
+        frame->colorspace          = par->color_space;
+        frame->color_primaries     = par->color_primaries;
+        frame->color_trc           = par->color_trc;
+        frame->chroma_location     = par->chroma_location;
+        if (parser)
+            frame->pict_type = parser->pict_type;
+        else if (desc && (desc->props & AV_CODEC_PROP_INTRA_ONLY))
+            frame->pict_type = AV_PICTURE_TYPE_I;
+    } else {
+        frame->format      = par->format;
+        frame->sample_rate = par->sample_rate;
+        frame->nb_samples  = parser && parser->duration > 0 ? parser->duration : par->frame_size;
+        ret = av_channel_layout_copy(&frame->ch_layout, &par->ch_layout);
+        if (ret < 0)
+            goto end;
+    }
+
+    show_frame(w, frame, ist->st, ifile->fmt_ctx);
+    ret = 0;
+end:
+    av_frame_unref(frame);
+    return ret;
+}
+
 static av_always_inline int process_frame(WriterContext *w,
                                           InputFile *ifile,
                                           AVFrame *frame, const AVPacket *pkt,
@@ -3012,6 +3198,11 @@ static av_always_inline int process_frame(WriterContext *w,
     int ret = 0, got_frame = 0;
 
     clear_log(1);
+    if (do_parse_frames) {
+        ret = *packet_new ? parse_frame(w, ifile, frame, pkt) : 0;
+        *packet_new = 0;
+        return ret;
+    }
     if (dec_ctx) {
         switch (par->codec_type) {
         case AVMEDIA_TYPE_VIDEO:
@@ -3761,6 +3952,23 @@ static int open_input_file(InputFile *ifile, const char *filename,
             continue;
         }
 
+        if (do_parse_frames) {
+            ist->parser_ctx = avcodec_alloc_context3(NULL);
+            if (!ist->parser_ctx)
+                exit(1);
+
+            err = avcodec_parameters_to_context(ist->parser_ctx, stream->codecpar);
+            if (err < 0)
+                exit(1);
+
+            ist->parser_ctx->pkt_timebase = stream->time_base;
+
+            ist->parser = av_parser_init(stream->codecpar->codec_id);
+            if (ist->parser)
+                ist->parser->flags |= PARSER_FLAG_COMPLETE_FRAMES;
+            continue;
+        }
+
         codec = avcodec_find_decoder(stream->codecpar->codec_id);
         if (!codec) {
             av_log(NULL, AV_LOG_WARNING,
@@ -3818,8 +4026,11 @@ static void close_input_file(InputFile *ifile)
     int i;
 
     /* close decoder for each stream */
-    for (i = 0; i < ifile->nb_streams; i++)
+    for (i = 0; i < ifile->nb_streams; i++) {
         avcodec_free_context(&ifile->streams[i].dec_ctx);
+        avcodec_free_context(&ifile->streams[i].parser_ctx);
+        av_parser_close(ifile->streams[i].parser);
+    }
 
     av_freep(&ifile->streams);
     ifile->nb_streams = 0;
@@ -4401,7 +4612,7 @@ static const OptionDef real_options[] = {
     { "pretty",                OPT_TYPE_FUNC,        0, {.func_arg = opt_pretty},
       "prettify the format of displayed values, make it more human readable" },
     { "output_format",         OPT_TYPE_STRING,      0, { &output_format },
-      "set the output printing format (available formats are: default, compact, csv, flat, ini, json, xml)", "format" },
+      "set the output printing format (available formats are: default, compact, csv, flat, ini, json, cbor, xml)", "format" },
     { "print_format",          OPT_TYPE_STRING,      0, { &output_format }, "alias for -output_format (deprecated)" },
     { "of",                    OPT_TYPE_STRING,      0, { &output_format }, "alias for -output_format", "format" },
     { "select_streams",        OPT_TYPE_STRING,      0, { &stream_specifier }, "select the specified streams", "stream_specifier" },
@@ -4423,6 +4634,7 @@ static const OptionDef real_options[] = {
     { "show_chapters",         OPT_TYPE_FUNC,        0, { .func_arg = &opt_show_chapters }, "show chapters info" },
     { "count_frames",          OPT_TYPE_BOOL,        0, { &do_count_frames }, "count the number of frames per stream" },
     { "count_packets",         OPT_TYPE_BOOL,        0, { &do_count_packets }, "count the number of packets per stream" },
+    { "parse_frames",          OPT_TYPE_BOOL,        0, { &do_parse_frames }, "build frame entries from parsed packets instead of decoding" },
     { "show_program_version",  OPT_TYPE_FUNC,        0, { .func_arg = &opt_show_program_version },  "show ffprobe version" },
     { "show_library_versions", OPT_TYPE_FUNC,        0, { .func_arg = &opt_show_library_versions }, "show library versions" },
     { "show_versions",         OPT_TYPE_FUNC,        0, { .func_arg = &opt_show_versions }, "show program and library versions" },
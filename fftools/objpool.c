@@ -16,6 +16,7 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include <pthread.h>
 #include <stdint.h>
 
 #include "libavcodec/packet.h"
@@ -28,22 +29,47 @@
 #include "objpool.h"
 
 struct ObjPool {
-    void        *pool[32];
+    void       **pool;
+    unsigned int pool_size;
     unsigned int pool_count;
 
     ObjPoolCBAlloc alloc;
     ObjPoolCBReset reset;
     ObjPoolCBFree  free;
+
+    // shared pools may be used from any thread, pool_count and the stats
+    // are then protected by lock
+    int             shared;
+    pthread_mutex_t lock;
+
+    uint64_t        hits;
+    uint64_t        misses;
 };
 
-ObjPool *objpool_alloc(ObjPoolCBAlloc cb_alloc, ObjPoolCBReset cb_reset,
-                       ObjPoolCBFree cb_free)
+static ObjPool *pool_alloc(ObjPoolCBAlloc cb_alloc, ObjPoolCBReset cb_reset,
+                           ObjPoolCBFree cb_free, unsigned int size, int shared)
 {
     ObjPool *op = av_mallocz(sizeof(*op));
 
     if (!op)
         return NULL;
 
+    op->pool = av_calloc(size, sizeof(*op->pool));
+    if (!op->pool) {
+        av_freep(&op);
+        return NULL;
+    }
+    op->pool_size = size;
+
+    if (shared) {
+        if (pthread_mutex_init(&op->lock, NULL)) {
+            av_freep(&op->pool);
+            av_freep(&op);
+            return NULL;
+        }
+        op->shared = 1;
+    }
+
     op->alloc = cb_alloc;
     op->reset = cb_reset;
     op->free  = cb_free;
@@ -51,6 +77,12 @@ ObjPool *objpool_alloc(ObjPoolCBAlloc cb_alloc, ObjPoolCBReset cb_reset,
     return op;
 }
 
+ObjPool *objpool_alloc(ObjPoolCBAlloc cb_alloc, ObjPoolCBReset cb_reset,
+                       ObjPoolCBFree cb_free)
+{
+    return pool_alloc(cb_alloc, cb_reset, cb_free, 32, 0);
+}
+
 void objpool_free(ObjPool **pop)
 {
     ObjPool *op = *pop;
@@ -60,16 +92,33 @@ void objpool_free(ObjPool **pop)
 
     for (unsigned int i = 0; i < op->pool_count; i++)
         op->free(&op->pool[i]);
+    av_freep(&op->pool);
+
+    if (op->shared)
+        pthread_mutex_destroy(&op->lock);
 
     av_freep(pop);
 }
 
 int  objpool_get(ObjPool *op, void **obj)
 {
+    *obj = NULL;
+
+    if (op->shared)
+        pthread_mutex_lock(&op->lock);
+
     if (op->pool_count) {
         *obj = op->pool[--op->pool_count];
         op->pool[op->pool_count] = NULL;
+        op->hits++;
     } else
+        op->misses++;
+
+    if (op->shared)
+        pthread_mutex_unlock(&op->lock);
+
+    // allocate outside of the lock
+    if (!*obj)
         *obj = op->alloc();
 
     return *obj ? 0 : AVERROR(ENOMEM);
@@ -80,16 +129,38 @@ void objpool_release(ObjPool *op, void **obj)
     if (!*obj)
         return;
 
+    // resetting may free buffers, keep it outside of the lock
     op->reset(*obj);
 
-    if (op->pool_count < FF_ARRAY_ELEMS(op->pool))
+    if (op->shared)
+        pthread_mutex_lock(&op->lock);
+
+    if (op->pool_count < op->pool_size) {
         op->pool[op->pool_count++] = *obj;
-    else
+        *obj = NULL;
+    }
+
+    if (op->shared)
+        pthread_mutex_unlock(&op->lock);
+
+    if (*obj)
         op->free(obj);
 
     *obj = NULL;
 }
 
+void objpool_stats(ObjPool *op, uint64_t *hits, uint64_t *misses)
+{
+    if (op->shared)
+        pthread_mutex_lock(&op->lock);
+
+    *hits   = op->hits;
+    *misses = op->misses;
+
+    if (op->shared)
+        pthread_mutex_unlock(&op->lock);
+}
+
 static void *alloc_packet(void)
 {
     return av_packet_alloc();
@@ -129,3 +200,12 @@ ObjPool *objpool_alloc_frames(void)
 {
     return objpool_alloc(alloc_frame, reset_frame, free_frame);
 }
+
+ObjPool *objpool_alloc_shared_packets(unsigned int size)
+{
+    return pool_alloc(alloc_packet, reset_packet, free_packet, size, 1);
+}
+ObjPool *objpool_alloc_shared_frames(unsigned int size)
+{
+    return pool_alloc(alloc_frame, reset_frame, free_frame, size, 1);
+}
@@ -19,6 +19,8 @@
 #ifndef FFTOOLS_OBJPOOL_H
 #define FFTOOLS_OBJPOOL_H
 
+#include <stdint.h>
+
 typedef struct ObjPool ObjPool;
 
 typedef void* (*ObjPoolCBAlloc)(void);
@@ -31,7 +33,20 @@ ObjPool *objpool_alloc(ObjPoolCBAlloc cb_alloc, ObjPoolCBReset cb_reset,
 ObjPool *objpool_alloc_packets(void);
 ObjPool *objpool_alloc_frames(void);
 
+/**
+ * Allocate a pool holding up to size objects that may be used concurrently
+ * from multiple threads.
+ */
+ObjPool *objpool_alloc_shared_packets(unsigned int size);
+ObjPool *objpool_alloc_shared_frames(unsigned int size);
+
 int  objpool_get(ObjPool *op, void **obj);
 void objpool_release(ObjPool *op, void **obj);
 
+/**
+ * Get the number of objpool_get() calls served from the pool (hits) and
+ * by allocating a new object (misses).
+ */
+void objpool_stats(ObjPool *op, uint64_t *hits, uint64_t *misses);
+
 #endif // FFTOOLS_OBJPOOL_H
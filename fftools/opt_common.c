@@ -1317,6 +1317,12 @@ int opt_loglevel(void *optctx, const char *opt, const char *arg)
             } else {
                 flags |= AV_LOG_PRINT_LEVEL;
             }
+        } else if (av_strstart(token, "async", &arg)) {
+            if (cmd == '-') {
+                flags &= ~AV_LOG_ASYNC;
+            } else {
+                flags |= AV_LOG_ASYNC;
+            }
         } else {
             break;
         }
@@ -16,6 +16,7 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include <stdatomic.h>
 #include <stdint.h>
 #include <string.h>
 
@@ -25,6 +26,7 @@
 #include "libavutil/intreadwrite.h"
 #include "libavutil/mem.h"
 #include "libavutil/thread.h"
+#include "libavutil/time.h"
 
 #include "objpool.h"
 #include "thread_queue.h"
@@ -50,6 +52,23 @@ struct ThreadQueue {
 
     pthread_mutex_t lock;
     pthread_cond_t  cond;
+
+    size_t          queue_size;
+    // time spent blocked in tq_send()/tq_receive(), in microseconds
+    atomic_int_least64_t send_wait;
+    atomic_int_least64_t recv_wait;
+
+    /* TQ_FLAG_SPSC state; the ring slots own preallocated objects, so
+     * neither side touches the (non thread-safe) object pool while running */
+    int              spsc;
+    void           **ring;
+    size_t           ring_size;
+    // number of items written/read so far
+    atomic_size_t    ring_wr;
+    atomic_size_t    ring_rd;
+    atomic_int       spsc_finished;
+    // number of threads waiting on cond, the lock is only taken when nonzero
+    atomic_int       nb_waiting;
 };
 
 void tq_free(ThreadQueue **ptq)
@@ -66,6 +85,13 @@ void tq_free(ThreadQueue **ptq)
     }
     av_fifo_freep2(&tq->fifo);
 
+    if (tq->ring) {
+        for (size_t i = 0; i < tq->ring_size; i++)
+            if (tq->ring[i])
+                objpool_release(tq->obj_pool, &tq->ring[i]);
+        av_freep(&tq->ring);
+    }
+
     objpool_free(&tq->obj_pool);
 
     av_freep(&tq->finished);
@@ -77,7 +103,8 @@ void tq_free(ThreadQueue **ptq)
 }
 
 ThreadQueue *tq_alloc(unsigned int nb_streams, size_t queue_size,
-                      ObjPool *obj_pool, void (*obj_move)(void *dst, void *src))
+                      ObjPool *obj_pool, void (*obj_move)(void *dst, void *src),
+                      unsigned flags)
 {
     ThreadQueue *tq;
     int ret;
@@ -104,25 +131,153 @@ ThreadQueue *tq_alloc(unsigned int nb_streams, size_t queue_size,
         goto fail;
     tq->nb_streams = nb_streams;
 
+    tq->obj_pool = obj_pool;
+    tq->obj_move = obj_move;
+
+    tq->queue_size = queue_size;
+    atomic_init(&tq->send_wait, 0);
+    atomic_init(&tq->recv_wait, 0);
+
+    if (flags & TQ_FLAG_SPSC) {
+        av_assert0(nb_streams == 1);
+
+        tq->spsc = 1;
+
+        tq->ring = av_calloc(queue_size, sizeof(*tq->ring));
+        if (!tq->ring)
+            goto fail;
+        tq->ring_size = queue_size;
+
+        for (size_t i = 0; i < queue_size; i++) {
+            ret = objpool_get(obj_pool, &tq->ring[i]);
+            if (ret < 0)
+                goto fail;
+        }
+
+        atomic_init(&tq->ring_wr,       0);
+        atomic_init(&tq->ring_rd,       0);
+        atomic_init(&tq->spsc_finished, 0);
+        atomic_init(&tq->nb_waiting,    0);
+
+        return tq;
+    }
+
     tq->fifo = av_fifo_alloc2(queue_size, sizeof(FifoElem), 0);
     if (!tq->fifo)
         goto fail;
 
-    tq->obj_pool = obj_pool;
-    tq->obj_move = obj_move;
-
     return tq;
 fail:
     tq_free(&tq);
     return NULL;
 }
 
+/* A waiter increments nb_waiting before re-checking the queue state and the
+ * other side changes the state before checking nb_waiting, so at least one of
+ * them sees the other and no wakeup is lost. */
+static void spsc_wake(ThreadQueue *tq)
+{
+    if (atomic_load(&tq->nb_waiting)) {
+        pthread_mutex_lock(&tq->lock);
+        pthread_cond_broadcast(&tq->cond);
+        pthread_mutex_unlock(&tq->lock);
+    }
+}
+
+static int spsc_send(ThreadQueue *tq, void *data)
+{
+    size_t wr = atomic_load_explicit(&tq->ring_wr, memory_order_relaxed);
+    int finished = atomic_load(&tq->spsc_finished);
+
+    if (finished & FINISHED_SEND)
+        return AVERROR(EINVAL);
+
+    while (!(finished & FINISHED_RECV) &&
+           wr - atomic_load(&tq->ring_rd) == tq->ring_size) {
+        int64_t t0 = av_gettime_relative();
+
+        pthread_mutex_lock(&tq->lock);
+        atomic_fetch_add(&tq->nb_waiting, 1);
+        while (!(atomic_load(&tq->spsc_finished) & FINISHED_RECV) &&
+               wr - atomic_load(&tq->ring_rd) == tq->ring_size)
+            pthread_cond_wait(&tq->cond, &tq->lock);
+        atomic_fetch_sub(&tq->nb_waiting, 1);
+        pthread_mutex_unlock(&tq->lock);
+
+        atomic_fetch_add_explicit(&tq->send_wait, av_gettime_relative() - t0,
+                                  memory_order_relaxed);
+
+        finished = atomic_load(&tq->spsc_finished);
+    }
+
+    if (finished & FINISHED_RECV) {
+        atomic_fetch_or(&tq->spsc_finished, FINISHED_SEND);
+        return AVERROR_EOF;
+    }
+
+    tq->obj_move(tq->ring[wr % tq->ring_size], data);
+    atomic_store(&tq->ring_wr, wr + 1);
+
+    spsc_wake(tq);
+
+    return 0;
+}
+
+static int spsc_receive(ThreadQueue *tq, int *stream_idx, void *data)
+{
+    size_t rd = atomic_load_explicit(&tq->ring_rd, memory_order_relaxed);
+    int64_t t0;
+
+    while (1) {
+        // the producer sets FINISHED_SEND after its last write, so it must be
+        // loaded before the write index
+        int finished = atomic_load(&tq->spsc_finished);
+
+        // items left in the ring are discarded in tq_free()
+        if (finished & FINISHED_RECV)
+            return AVERROR_EOF;
+
+        if (rd != atomic_load(&tq->ring_wr)) {
+            tq->obj_move(data, tq->ring[rd % tq->ring_size]);
+            atomic_store(&tq->ring_rd, rd + 1);
+            spsc_wake(tq);
+
+            *stream_idx = 0;
+            return 0;
+        }
+
+        if (finished & FINISHED_SEND) {
+            /* return EOF to the consumer at most once */
+            atomic_fetch_or(&tq->spsc_finished, FINISHED_RECV);
+            spsc_wake(tq);
+            *stream_idx = 0;
+            return AVERROR_EOF;
+        }
+
+        t0 = av_gettime_relative();
+
+        pthread_mutex_lock(&tq->lock);
+        atomic_fetch_add(&tq->nb_waiting, 1);
+        while (!atomic_load(&tq->spsc_finished) &&
+               rd == atomic_load(&tq->ring_wr))
+            pthread_cond_wait(&tq->cond, &tq->lock);
+        atomic_fetch_sub(&tq->nb_waiting, 1);
+        pthread_mutex_unlock(&tq->lock);
+
+        atomic_fetch_add_explicit(&tq->recv_wait, av_gettime_relative() - t0,
+                                  memory_order_relaxed);
+    }
+}
+
 int tq_send(ThreadQueue *tq, unsigned int stream_idx, void *data)
 {
     int *finished;
     int ret;
 
     av_assert0(stream_idx < tq->nb_streams);
+
+    if (tq->spsc)
+        return spsc_send(tq, data);
     finished = &tq->finished[stream_idx];
 
     pthread_mutex_lock(&tq->lock);
@@ -132,8 +287,15 @@ int tq_send(ThreadQueue *tq, unsigned int stream_idx, void *data)
         goto finish;
     }
 
-    while (!(*finished & FINISHED_RECV) && !av_fifo_can_write(tq->fifo))
-        pthread_cond_wait(&tq->cond, &tq->lock);
+    if (!(*finished & FINISHED_RECV) && !av_fifo_can_write(tq->fifo)) {
+        int64_t t0 = av_gettime_relative();
+
+        while (!(*finished & FINISHED_RECV) && !av_fifo_can_write(tq->fifo))
+            pthread_cond_wait(&tq->cond, &tq->lock);
+
+        atomic_fetch_add_explicit(&tq->send_wait, av_gettime_relative() - t0,
+                                  memory_order_relaxed);
+    }
 
     if (*finished & FINISHED_RECV) {
         ret = AVERROR_EOF;
@@ -199,6 +361,9 @@ int tq_receive(ThreadQueue *tq, int *stream_idx, void *data)
 
     *stream_idx = -1;
 
+    if (tq->spsc)
+        return spsc_receive(tq, stream_idx, data);
+
     pthread_mutex_lock(&tq->lock);
 
     while (1) {
@@ -211,7 +376,12 @@ int tq_receive(ThreadQueue *tq, int *stream_idx, void *data)
             pthread_cond_broadcast(&tq->cond);
 
         if (ret == AVERROR(EAGAIN)) {
+            int64_t t0 = av_gettime_relative();
+
             pthread_cond_wait(&tq->cond, &tq->lock);
+
+            atomic_fetch_add_explicit(&tq->recv_wait, av_gettime_relative() - t0,
+                                      memory_order_relaxed);
             continue;
         }
 
@@ -227,6 +397,12 @@ void tq_send_finish(ThreadQueue *tq, unsigned int stream_idx)
 {
     av_assert0(stream_idx < tq->nb_streams);
 
+    if (tq->spsc) {
+        atomic_fetch_or(&tq->spsc_finished, FINISHED_SEND);
+        spsc_wake(tq);
+        return;
+    }
+
     pthread_mutex_lock(&tq->lock);
 
     /* mark the stream as send-finished;
@@ -242,6 +418,12 @@ void tq_receive_finish(ThreadQueue *tq, unsigned int stream_idx)
 {
     av_assert0(stream_idx < tq->nb_streams);
 
+    if (tq->spsc) {
+        atomic_fetch_or(&tq->spsc_finished, FINISHED_RECV);
+        spsc_wake(tq);
+        return;
+    }
+
     pthread_mutex_lock(&tq->lock);
 
     /* mark the stream as recv-finished;
@@ -252,3 +434,20 @@ void tq_receive_finish(ThreadQueue *tq, unsigned int stream_idx)
 
     pthread_mutex_unlock(&tq->lock);
 }
+
+void tq_get_stats(ThreadQueue *tq, ThreadQueueStats *stats)
+{
+    stats->send_wait = atomic_load_explicit(&tq->send_wait, memory_order_relaxed);
+    stats->recv_wait = atomic_load_explicit(&tq->recv_wait, memory_order_relaxed);
+    stats->size      = tq->queue_size;
+
+    if (tq->spsc) {
+        size_t rd = atomic_load(&tq->ring_rd);
+        stats->queued = atomic_load(&tq->ring_wr) - rd;
+        return;
+    }
+
+    pthread_mutex_lock(&tq->lock);
+    stats->queued = av_fifo_can_read(tq->fifo);
+    pthread_mutex_unlock(&tq->lock);
+}
@@ -19,12 +19,39 @@
 #ifndef FFTOOLS_THREAD_QUEUE_H
 #define FFTOOLS_THREAD_QUEUE_H
 
+#include <stdint.h>
 #include <string.h>
 
 #include "objpool.h"
 
 typedef struct ThreadQueue ThreadQueue;
 
+typedef struct ThreadQueueStats {
+    /**
+     * Total time in microseconds senders spent blocked on a full queue.
+     */
+    int64_t send_wait;
+    /**
+     * Total time in microseconds the receiver spent blocked on an empty queue.
+     */
+    int64_t recv_wait;
+    /**
+     * Number of items currently queued and the queue capacity.
+     */
+    size_t  queued;
+    size_t  size;
+} ThreadQueueStats;
+
+enum ThreadQueueFlags {
+    /**
+     * The queue has a single stream, and items are only ever sent by one
+     * thread at a time and received by one thread. Items are then passed
+     * through a lock-free ring buffer, with the lock only taken to sleep
+     * when the queue is empty or full.
+     */
+    TQ_FLAG_SPSC = (1 << 0),
+};
+
 /**
  * Allocate a queue for sending data between threads.
  *
@@ -35,9 +62,11 @@ typedef struct ThreadQueue ThreadQueue;
  * @param obj_pool object pool that will be used to allocate items stored in the
  *                 queue; the pool becomes owned by the queue
  * @param callback that moves the contents between two data pointers
+ * @param flags a combination of ThreadQueueFlags
  */
 ThreadQueue *tq_alloc(unsigned int nb_streams, size_t queue_size,
-                      ObjPool *obj_pool, void (*obj_move)(void *dst, void *src));
+                      ObjPool *obj_pool, void (*obj_move)(void *dst, void *src),
+                      unsigned flags);
 void         tq_free(ThreadQueue **tq);
 
 /**
@@ -78,4 +107,9 @@ int tq_receive(ThreadQueue *tq, int *stream_idx, void *data);
  */
 void tq_receive_finish(ThreadQueue *tq, unsigned int stream_idx);
 
+/**
+ * Get the queue statistics. May be called from any thread.
+ */
+void tq_get_stats(ThreadQueue *tq, ThreadQueueStats *stats);
+
 #endif // FFTOOLS_THREAD_QUEUE_H
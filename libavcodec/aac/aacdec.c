@@ -1120,15 +1120,19 @@ static av_cold int decode_close(AVCodecContext *avctx)
         }
     }
 
-    av_tx_uninit(&ac->mdct96);
-    av_tx_uninit(&ac->mdct120);
-    av_tx_uninit(&ac->mdct128);
-    av_tx_uninit(&ac->mdct480);
-    av_tx_uninit(&ac->mdct512);
-    av_tx_uninit(&ac->mdct768);
-    av_tx_uninit(&ac->mdct960);
-    av_tx_uninit(&ac->mdct1024);
-    av_tx_uninit(&ac->mdct_ltp);
+    for (int i = 0; i < ac->nb_td; i++) {
+        AACDecThreadContext *td = &ac->td[i];
+        av_tx_uninit(&td->mdct96);
+        av_tx_uninit(&td->mdct120);
+        av_tx_uninit(&td->mdct128);
+        av_tx_uninit(&td->mdct480);
+        av_tx_uninit(&td->mdct512);
+        av_tx_uninit(&td->mdct768);
+        av_tx_uninit(&td->mdct960);
+        av_tx_uninit(&td->mdct1024);
+        av_tx_uninit(&td->mdct_ltp);
+    }
+    av_freep(&ac->td);
 
     // Compiler will optimize this branch away.
     if (ac->is_fixed)
@@ -1139,13 +1143,13 @@ static av_cold int decode_close(AVCodecContext *avctx)
     return 0;
 }
 
-static av_cold int init_dsp(AVCodecContext *avctx)
+static av_cold int init_thread_dsp(AACDecContext *ac, AACDecThreadContext *td)
 {
-    AACDecContext *ac = avctx->priv_data;
     int is_fixed = ac->is_fixed, ret;
     float scale_fixed, scale_float;
     const float *const scalep = is_fixed ? &scale_fixed : &scale_float;
     enum AVTXType tx_type = is_fixed ? AV_TX_INT32_MDCT : AV_TX_FLOAT_MDCT;
+    const ptrdiff_t sample_size = is_fixed ? sizeof(int) : sizeof(float);
 
 #define MDCT_INIT(s, fn, len, sval)                                          \
     scale_fixed = (sval) * 128.0f;                                           \
@@ -1154,26 +1158,56 @@ static av_cold int init_dsp(AVCodecContext *avctx)
     if (ret < 0)                                                             \
         return ret
 
-    MDCT_INIT(ac->mdct96,   ac->mdct96_fn,     96, 1.0/96);
-    MDCT_INIT(ac->mdct120,  ac->mdct120_fn,   120, 1.0/120);
-    MDCT_INIT(ac->mdct128,  ac->mdct128_fn,   128, 1.0/128);
-    MDCT_INIT(ac->mdct480,  ac->mdct480_fn,   480, 1.0/480);
-    MDCT_INIT(ac->mdct512,  ac->mdct512_fn,   512, 1.0/512);
-    MDCT_INIT(ac->mdct768,  ac->mdct768_fn,   768, 1.0/768);
-    MDCT_INIT(ac->mdct960,  ac->mdct960_fn,   960, 1.0/960);
-    MDCT_INIT(ac->mdct1024, ac->mdct1024_fn, 1024, 1.0/1024);
+/* All 8 short windows of a frame, in_dist and out_dist are in samples */
+#define MDCT_INIT_SHORT(s, fn, len, sval, in_dist, out_dist)                 \
+    scale_fixed = (sval) * 128.0f;                                           \
+    scale_float = (sval) / 32768.0f;                                         \
+    ret = av_tx_init_batch(&s, &fn, tx_type, 1, len, scalep, 0, 8,           \
+                           (in_dist) * sample_size,                          \
+                           (out_dist) * sample_size);                        \
+    if (ret < 0)                                                             \
+        return ret
+
+    MDCT_INIT_SHORT(td->mdct96,  td->mdct96_fn,   96, 1.0/96,   96,  96);
+    MDCT_INIT_SHORT(td->mdct120, td->mdct120_fn, 120, 1.0/120, 128, 120);
+    MDCT_INIT_SHORT(td->mdct128, td->mdct128_fn, 128, 1.0/128, 128, 128);
+    MDCT_INIT(td->mdct480,  td->mdct480_fn,   480, 1.0/480);
+    MDCT_INIT(td->mdct512,  td->mdct512_fn,   512, 1.0/512);
+    MDCT_INIT(td->mdct768,  td->mdct768_fn,   768, 1.0/768);
+    MDCT_INIT(td->mdct960,  td->mdct960_fn,   960, 1.0/960);
+    MDCT_INIT(td->mdct1024, td->mdct1024_fn, 1024, 1.0/1024);
 #undef MDCT_INIT
+#undef MDCT_INIT_SHORT
 
     /* LTP forward MDCT */
     scale_fixed = -1.0;
     scale_float = -32786.0*2 + 36;
-    ret = av_tx_init(&ac->mdct_ltp, &ac->mdct_ltp_fn, tx_type, 0, 1024, scalep, 0);
+    ret = av_tx_init(&td->mdct_ltp, &td->mdct_ltp_fn, tx_type, 0, 1024, scalep, 0);
     if (ret < 0)
         return ret;
 
     return 0;
 }
 
+static av_cold int init_dsp(AVCodecContext *avctx)
+{
+    AACDecContext *ac = avctx->priv_data;
+    int nb_td = avctx->active_thread_type & FF_THREAD_SLICE ? avctx->thread_count : 1;
+    int ret;
+
+    ac->td = av_calloc(nb_td, sizeof(*ac->td));
+    if (!ac->td)
+        return AVERROR(ENOMEM);
+
+    for (ac->nb_td = 0; ac->nb_td < nb_td;) {
+        ret = init_thread_dsp(ac, &ac->td[ac->nb_td++]);
+        if (ret < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
 av_cold int ff_aac_decode_init(AVCodecContext *avctx)
 {
     AACDecContext *ac = avctx->priv_data;
@@ -2000,72 +2034,132 @@ static void apply_channel_coupling(AACDecContext *ac, ChannelElement *cc,
     }
 }
 
+typedef void (*imdct_and_window_fn)(AACDecContext *ac, AACDecThreadContext *td,
+                                    SingleChannelElement *sce);
+
+typedef struct ElementJobs {
+    AACDecContext *ac;
+    imdct_and_window_fn imdct_and_window;
+    int samples;
+    int nb_elems;
+    struct {
+        ChannelElement *che;
+        int type;
+        int id;
+    } elems[4 * MAX_ELEM_ID];
+} ElementJobs;
+
+/**
+ * Convert the spectral data of one channel element to samples, applying all
+ * supported tools as appropriate.
+ */
+static void element_to_sample(AACDecContext *ac, AACDecThreadContext *td,
+                              imdct_and_window_fn imdct_and_window,
+                              ChannelElement *che, int type, int i, int samples)
+{
+    if (type <= TYPE_CPE)
+        apply_channel_coupling(ac, che, type, i, BEFORE_TNS, ac->dsp.apply_dependent_coupling);
+    if (ac->oc[1].m4ac.object_type == AOT_AAC_LTP) {
+        if (che->ch[0].ics.predictor_present) {
+            if (che->ch[0].ics.ltp.present)
+                ac->dsp.apply_ltp(ac, td, &che->ch[0]);
+            if (che->ch[1].ics.ltp.present && type == TYPE_CPE)
+                ac->dsp.apply_ltp(ac, td, &che->ch[1]);
+        }
+    }
+    if (che->ch[0].tns.present)
+        ac->dsp.apply_tns(che->ch[0].coeffs,
+                          &che->ch[0].tns, &che->ch[0].ics, 1);
+    if (che->ch[1].tns.present)
+        ac->dsp.apply_tns(che->ch[1].coeffs,
+                          &che->ch[1].tns, &che->ch[1].ics, 1);
+    if (type <= TYPE_CPE)
+        apply_channel_coupling(ac, che, type, i, BETWEEN_TNS_AND_IMDCT, ac->dsp.apply_dependent_coupling);
+    if (type != TYPE_CCE || che->coup.coupling_point == AFTER_IMDCT) {
+        imdct_and_window(ac, td, &che->ch[0]);
+        if (ac->oc[1].m4ac.object_type == AOT_AAC_LTP)
+            ac->dsp.update_ltp(ac, td, &che->ch[0]);
+        if (type == TYPE_CPE) {
+            imdct_and_window(ac, td, &che->ch[1]);
+            if (ac->oc[1].m4ac.object_type == AOT_AAC_LTP)
+                ac->dsp.update_ltp(ac, td, &che->ch[1]);
+        }
+        if (ac->oc[1].m4ac.sbr > 0) {
+            ac->proc.sbr_apply(ac, che, type,
+                               che->ch[0].output,
+                               che->ch[1].output);
+        }
+    }
+    if (type <= TYPE_CCE)
+        apply_channel_coupling(ac, che, type, i, AFTER_IMDCT, ac->dsp.apply_independent_coupling);
+    ac->dsp.clip_output(ac, che, type, samples);
+    che->present = 0;
+}
+
+static int element_to_sample_job(AVCodecContext *avctx, void *arg,
+                                 int jobnr, int threadnr)
+{
+    ElementJobs *jobs = arg;
+    AACDecContext *ac = jobs->ac;
+
+    element_to_sample(ac, &ac->td[threadnr], jobs->imdct_and_window,
+                      jobs->elems[jobnr].che, jobs->elems[jobnr].type,
+                      jobs->elems[jobnr].id, jobs->samples);
+    return 0;
+}
+
 /**
  * Convert spectral data to samples, applying all supported tools as appropriate.
+ *
+ * Coupling channel elements are only read by the other elements, so once
+ * they are done the remaining elements are independent and can be converted
+ * in parallel.
  */
 static void spectral_to_sample(AACDecContext *ac, int samples)
 {
+    ElementJobs jobs;
     int i, type;
-    void (*imdct_and_window)(AACDecContext *ac, SingleChannelElement *sce);
+
+    jobs.ac       = ac;
+    jobs.samples  = samples;
+    jobs.nb_elems = 0;
     switch (ac->oc[1].m4ac.object_type) {
     case AOT_ER_AAC_LD:
-        imdct_and_window = ac->dsp.imdct_and_windowing_ld;
+        jobs.imdct_and_window = ac->dsp.imdct_and_windowing_ld;
         break;
     case AOT_ER_AAC_ELD:
-        imdct_and_window = ac->dsp.imdct_and_windowing_eld;
+        jobs.imdct_and_window = ac->dsp.imdct_and_windowing_eld;
         break;
     default:
         if (ac->oc[1].m4ac.frame_length_short)
-            imdct_and_window = ac->dsp.imdct_and_windowing_960;
+            jobs.imdct_and_window = ac->dsp.imdct_and_windowing_960;
         else
-            imdct_and_window = ac->dsp.imdct_and_windowing;
+            jobs.imdct_and_window = ac->dsp.imdct_and_windowing;
     }
     for (type = 3; type >= 0; type--) {
         for (i = 0; i < MAX_ELEM_ID; i++) {
             ChannelElement *che = ac->che[type][i];
             if (che && che->present) {
-                if (type <= TYPE_CPE)
-                    apply_channel_coupling(ac, che, type, i, BEFORE_TNS, ac->dsp.apply_dependent_coupling);
-                if (ac->oc[1].m4ac.object_type == AOT_AAC_LTP) {
-                    if (che->ch[0].ics.predictor_present) {
-                        if (che->ch[0].ics.ltp.present)
-                            ac->dsp.apply_ltp(ac, &che->ch[0]);
-                        if (che->ch[1].ics.ltp.present && type == TYPE_CPE)
-                            ac->dsp.apply_ltp(ac, &che->ch[1]);
-                    }
-                }
-                if (che->ch[0].tns.present)
-                    ac->dsp.apply_tns(che->ch[0].coeffs,
-                                      &che->ch[0].tns, &che->ch[0].ics, 1);
-                if (che->ch[1].tns.present)
-                    ac->dsp.apply_tns(che->ch[1].coeffs,
-                                      &che->ch[1].tns, &che->ch[1].ics, 1);
-                if (type <= TYPE_CPE)
-                    apply_channel_coupling(ac, che, type, i, BETWEEN_TNS_AND_IMDCT, ac->dsp.apply_dependent_coupling);
-                if (type != TYPE_CCE || che->coup.coupling_point == AFTER_IMDCT) {
-                    imdct_and_window(ac, &che->ch[0]);
-                    if (ac->oc[1].m4ac.object_type == AOT_AAC_LTP)
-                        ac->dsp.update_ltp(ac, &che->ch[0]);
-                    if (type == TYPE_CPE) {
-                        imdct_and_window(ac, &che->ch[1]);
-                        if (ac->oc[1].m4ac.object_type == AOT_AAC_LTP)
-                            ac->dsp.update_ltp(ac, &che->ch[1]);
-                    }
-                    if (ac->oc[1].m4ac.sbr > 0) {
-                        ac->proc.sbr_apply(ac, che, type,
-                                           che->ch[0].output,
-                                           che->ch[1].output);
-                    }
+                if (type == TYPE_CCE) {
+                    element_to_sample(ac, &ac->td[0], jobs.imdct_and_window,
+                                      che, type, i, samples);
+                } else {
+                    jobs.elems[jobs.nb_elems].che  = che;
+                    jobs.elems[jobs.nb_elems].type = type;
+                    jobs.elems[jobs.nb_elems].id   = i;
+                    jobs.nb_elems++;
                 }
-                if (type <= TYPE_CCE)
-                    apply_channel_coupling(ac, che, type, i, AFTER_IMDCT, ac->dsp.apply_independent_coupling);
-                ac->dsp.clip_output(ac, che, type, samples);
-                che->present = 0;
             } else if (che) {
                 av_log(ac->avctx, AV_LOG_VERBOSE, "ChannelElement %d.%d missing \n", type, i);
             }
         }
     }
+
+    if (jobs.nb_elems > 1)
+        ac->avctx->execute2(ac->avctx, element_to_sample_job, &jobs, NULL,
+                            jobs.nb_elems);
+    else if (jobs.nb_elems)
+        element_to_sample_job(ac->avctx, &jobs, 0, 0);
 }
 
 static int parse_adts_frame_header(AACDecContext *ac, GetBitContext *gb)
@@ -2547,7 +2641,8 @@ const FFCodec ff_aac_decoder = {
     .p.sample_fmts   = (const enum AVSampleFormat[]) {
         AV_SAMPLE_FMT_FLTP, AV_SAMPLE_FMT_NONE
     },
-    .p.capabilities  = AV_CODEC_CAP_CHANNEL_CONF | AV_CODEC_CAP_DR1,
+    .p.capabilities  = AV_CODEC_CAP_CHANNEL_CONF | AV_CODEC_CAP_DR1 |
+                       AV_CODEC_CAP_SLICE_THREADS,
     .caps_internal   = FF_CODEC_CAP_INIT_CLEANUP,
     .p.ch_layouts    = ff_aac_ch_layout,
     .flush = flush,
@@ -2569,7 +2664,8 @@ const FFCodec ff_aac_fixed_decoder = {
     .p.sample_fmts   = (const enum AVSampleFormat[]) {
         AV_SAMPLE_FMT_S32P, AV_SAMPLE_FMT_NONE
     },
-    .p.capabilities  = AV_CODEC_CAP_CHANNEL_CONF | AV_CODEC_CAP_DR1,
+    .p.capabilities  = AV_CODEC_CAP_CHANNEL_CONF | AV_CODEC_CAP_DR1 |
+                       AV_CODEC_CAP_SLICE_THREADS,
     .caps_internal   = FF_CODEC_CAP_INIT_CLEANUP,
     .p.ch_layouts    = ff_aac_ch_layout,
     .p.profiles      = NULL_IF_CONFIG_SMALL(ff_aac_profiles),
@@ -111,6 +111,48 @@ enum AACUSACLoudnessExt {
         DECLARE_ALIGNED(alignment, int,   RENAME_FIXED(name))[nb_elems]; \
         DECLARE_ALIGNED(alignment, float, name)[nb_elems];               \
     }
+/**
+ * Transforms and temporary buffers used to convert spectral data to samples.
+ * There is one per slice thread, as the buffers are overwritten and not all
+ * transforms may be run concurrently on the same context.
+ */
+typedef struct AACDecThreadContext {
+    /**
+     * @name temporary aligned temporary buffers
+     * (We do not want to have these on the stack.)
+     * @{
+     */
+    INTFLOAT_ALIGNED_UNION(32, buf_mdct, 1024);
+    INTFLOAT_ALIGNED_UNION(32, temp, 128);
+    /** @} */
+
+    /**
+     * @name Computed / set up during initialization
+     * The 96, 120 and 128 point transforms run all 8 short windows at once.
+     * @{
+     */
+    AVTXContext *mdct96;
+    AVTXContext *mdct120;
+    AVTXContext *mdct128;
+    AVTXContext *mdct480;
+    AVTXContext *mdct512;
+    AVTXContext *mdct768;
+    AVTXContext *mdct960;
+    AVTXContext *mdct1024;
+    AVTXContext *mdct_ltp;
+
+    av_tx_fn mdct96_fn;
+    av_tx_fn mdct120_fn;
+    av_tx_fn mdct128_fn;
+    av_tx_fn mdct480_fn;
+    av_tx_fn mdct512_fn;
+    av_tx_fn mdct768_fn;
+    av_tx_fn mdct960_fn;
+    av_tx_fn mdct1024_fn;
+    av_tx_fn mdct_ltp_fn;
+    /** @} */
+} AACDecThreadContext;
+
 /**
  * Long Term Prediction
  */
@@ -421,8 +463,10 @@ typedef struct AACDecDSP {
     void (*apply_tns)(void *_coef_param, TemporalNoiseShaping *tns,
                       IndividualChannelStream *ics, int decode);
 
-    void (*apply_ltp)(AACDecContext *ac, SingleChannelElement *sce);
-    void (*update_ltp)(AACDecContext *ac, SingleChannelElement *sce);
+    void (*apply_ltp)(AACDecContext *ac, AACDecThreadContext *td,
+                      SingleChannelElement *sce);
+    void (*update_ltp)(AACDecContext *ac, AACDecThreadContext *td,
+                       SingleChannelElement *sce);
 
     void (*apply_prediction)(AACDecContext *ac, SingleChannelElement *sce);
 
@@ -433,11 +477,16 @@ typedef struct AACDecDSP {
                                        SingleChannelElement *target,
                                        ChannelElement *cce, int index);
 
-    void (*imdct_and_windowing)(AACDecContext *ac, SingleChannelElement *sce);
-    void (*imdct_and_windowing_768)(AACDecContext *ac, SingleChannelElement *sce);
-    void (*imdct_and_windowing_960)(AACDecContext *ac, SingleChannelElement *sce);
-    void (*imdct_and_windowing_ld)(AACDecContext *ac, SingleChannelElement *sce);
-    void (*imdct_and_windowing_eld)(AACDecContext *ac, SingleChannelElement *sce);
+    void (*imdct_and_windowing)(AACDecContext *ac, AACDecThreadContext *td,
+                                SingleChannelElement *sce);
+    void (*imdct_and_windowing_768)(AACDecContext *ac, AACDecThreadContext *td,
+                                    SingleChannelElement *sce);
+    void (*imdct_and_windowing_960)(AACDecContext *ac, AACDecThreadContext *td,
+                                    SingleChannelElement *sce);
+    void (*imdct_and_windowing_ld)(AACDecContext *ac, AACDecThreadContext *td,
+                                   SingleChannelElement *sce);
+    void (*imdct_and_windowing_eld)(AACDecContext *ac, AACDecThreadContext *td,
+                                    SingleChannelElement *sce);
 
     void (*clip_output)(AACDecContext *ac, ChannelElement *che, int type, int samples);
 } AACDecDSP;
@@ -467,38 +516,12 @@ struct AACDecContext {
     int warned_remapping_once;
     /** @} */
 
-    /**
-     * @name temporary aligned temporary buffers
-     * (We do not want to have these on the stack.)
-     * @{
-     */
-    INTFLOAT_ALIGNED_UNION(32, buf_mdct, 1024);
-    INTFLOAT_ALIGNED_UNION(32, temp, 128);
-    /** @} */
-
     /**
      * @name Computed / set up during initialization
      * @{
      */
-    AVTXContext *mdct96;
-    AVTXContext *mdct120;
-    AVTXContext *mdct128;
-    AVTXContext *mdct480;
-    AVTXContext *mdct512;
-    AVTXContext *mdct768;
-    AVTXContext *mdct960;
-    AVTXContext *mdct1024;
-    AVTXContext *mdct_ltp;
-
-    av_tx_fn mdct96_fn;
-    av_tx_fn mdct120_fn;
-    av_tx_fn mdct128_fn;
-    av_tx_fn mdct480_fn;
-    av_tx_fn mdct512_fn;
-    av_tx_fn mdct768_fn;
-    av_tx_fn mdct960_fn;
-    av_tx_fn mdct1024_fn;
-    av_tx_fn mdct_ltp_fn;
+    AACDecThreadContext *td;     ///< one per slice thread
+    int nb_td;
     union {
         AVFixedDSPContext *RENAME_FIXED(fdsp);
         AVFloatDSPContext *fdsp;
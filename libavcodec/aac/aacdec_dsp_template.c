@@ -223,6 +223,7 @@ static void AAC_RENAME(apply_tns)(void *_coef_param, TemporalNoiseShaping *tns,
  *  coefficient from the predicted sample by LTP.
  */
 static inline void AAC_RENAME(windowing_and_mdct_ltp)(AACDecContext *ac,
+                                                      AACDecThreadContext *td,
                                                       INTFLOAT *out, INTFLOAT *in,
                                                       IndividualChannelStream *ics)
 {
@@ -243,13 +244,14 @@ static inline void AAC_RENAME(windowing_and_mdct_ltp)(AACDecContext *ac,
         ac->fdsp->vector_fmul_reverse(in + 1024 + 448, in + 1024 + 448, swindow, 128);
         memset(in + 1024 + 576, 0, 448 * sizeof(*in));
     }
-    ac->mdct_ltp_fn(ac->mdct_ltp, out, in, sizeof(INTFLOAT));
+    td->mdct_ltp_fn(td->mdct_ltp, out, in, sizeof(INTFLOAT));
 }
 
 /**
  * Apply the long term prediction
  */
-static void AAC_RENAME(apply_ltp)(AACDecContext *ac, SingleChannelElement *sce)
+static void AAC_RENAME(apply_ltp)(AACDecContext *ac, AACDecThreadContext *td,
+                                   SingleChannelElement *sce)
 {
     const LongTermPrediction *ltp = &sce->ics.ltp;
     const uint16_t *offsets = sce->ics.swb_offset;
@@ -257,7 +259,7 @@ static void AAC_RENAME(apply_ltp)(AACDecContext *ac, SingleChannelElement *sce)
 
     if (sce->ics.window_sequence[0] != EIGHT_SHORT_SEQUENCE) {
         INTFLOAT *predTime = sce->AAC_RENAME(output);
-        INTFLOAT *predFreq = ac->AAC_RENAME(buf_mdct);
+        INTFLOAT *predFreq = td->AAC_RENAME(buf_mdct);
         int16_t num_samples = 2048;
 
         if (ltp->lag < 1024)
@@ -266,7 +268,7 @@ static void AAC_RENAME(apply_ltp)(AACDecContext *ac, SingleChannelElement *sce)
             predTime[i] = AAC_MUL30(sce->AAC_RENAME(ltp_state)[i + 2048 - ltp->lag], ltp->AAC_RENAME(coef));
         memset(&predTime[i], 0, (2048 - i) * sizeof(*predTime));
 
-        AAC_RENAME(windowing_and_mdct_ltp)(ac, predFreq, predTime, &sce->ics);
+        AAC_RENAME(windowing_and_mdct_ltp)(ac, td, predFreq, predTime, &sce->ics);
 
         if (sce->tns.present)
             AAC_RENAME(apply_tns)(predFreq, &sce->tns, &sce->ics, 0);
@@ -281,7 +283,8 @@ static void AAC_RENAME(apply_ltp)(AACDecContext *ac, SingleChannelElement *sce)
 /**
  * Update the LTP buffer for next frame
  */
-static void AAC_RENAME(update_ltp)(AACDecContext *ac, SingleChannelElement *sce)
+static void AAC_RENAME(update_ltp)(AACDecContext *ac, AACDecThreadContext *td,
+                                    SingleChannelElement *sce)
 {
     IndividualChannelStream *ics = &sce->ics;
     INTFLOAT *saved     = sce->AAC_RENAME(saved);
@@ -293,22 +296,22 @@ static void AAC_RENAME(update_ltp)(AACDecContext *ac, SingleChannelElement *sce)
     if (ics->window_sequence[0] == EIGHT_SHORT_SEQUENCE) {
         memcpy(saved_ltp,       saved, 512 * sizeof(*saved_ltp));
         memset(saved_ltp + 576, 0,     448 * sizeof(*saved_ltp));
-        ac->fdsp->vector_fmul_reverse(saved_ltp + 448, ac->AAC_RENAME(buf_mdct) + 960,     &swindow[64],      64);
+        ac->fdsp->vector_fmul_reverse(saved_ltp + 448, td->AAC_RENAME(buf_mdct) + 960,     &swindow[64],      64);
 
         for (i = 0; i < 64; i++)
-            saved_ltp[i + 512] = AAC_MUL31(ac->AAC_RENAME(buf_mdct)[1023 - i], swindow[63 - i]);
+            saved_ltp[i + 512] = AAC_MUL31(td->AAC_RENAME(buf_mdct)[1023 - i], swindow[63 - i]);
     } else if (1 && ics->window_sequence[0] == LONG_START_SEQUENCE) {
-        memcpy(saved_ltp,       ac->AAC_RENAME(buf_mdct) + 512, 448 * sizeof(*saved_ltp));
+        memcpy(saved_ltp,       td->AAC_RENAME(buf_mdct) + 512, 448 * sizeof(*saved_ltp));
         memset(saved_ltp + 576, 0,                  448 * sizeof(*saved_ltp));
-        ac->fdsp->vector_fmul_reverse(saved_ltp + 448, ac->AAC_RENAME(buf_mdct) + 960,     &swindow[64],      64);
+        ac->fdsp->vector_fmul_reverse(saved_ltp + 448, td->AAC_RENAME(buf_mdct) + 960,     &swindow[64],      64);
 
         for (i = 0; i < 64; i++)
-            saved_ltp[i + 512] = AAC_MUL31(ac->AAC_RENAME(buf_mdct)[1023 - i], swindow[63 - i]);
+            saved_ltp[i + 512] = AAC_MUL31(td->AAC_RENAME(buf_mdct)[1023 - i], swindow[63 - i]);
     } else if (1) { // LONG_STOP or ONLY_LONG
-        ac->fdsp->vector_fmul_reverse(saved_ltp, ac->AAC_RENAME(buf_mdct) + 512,     &lwindow[512],     512);
+        ac->fdsp->vector_fmul_reverse(saved_ltp, td->AAC_RENAME(buf_mdct) + 512,     &lwindow[512],     512);
 
         for (i = 0; i < 512; i++)
-            saved_ltp[i + 512] = AAC_MUL31(ac->AAC_RENAME(buf_mdct)[1023 - i], lwindow[511 - i]);
+            saved_ltp[i + 512] = AAC_MUL31(td->AAC_RENAME(buf_mdct)[1023 - i], lwindow[511 - i]);
     }
 
     memcpy(sce->AAC_RENAME(ltp_state),      sce->AAC_RENAME(ltp_state)+1024,
@@ -322,7 +325,8 @@ static void AAC_RENAME(update_ltp)(AACDecContext *ac, SingleChannelElement *sce)
 /**
  * Conduct IMDCT and windowing.
  */
-static void AAC_RENAME(imdct_and_windowing)(AACDecContext *ac, SingleChannelElement *sce)
+static void AAC_RENAME(imdct_and_windowing)(AACDecContext *ac, AACDecThreadContext *td,
+                                            SingleChannelElement *sce)
 {
     IndividualChannelStream *ics = &sce->ics;
     INTFLOAT *in    = sce->AAC_RENAME(coeffs);
@@ -331,16 +335,14 @@ static void AAC_RENAME(imdct_and_windowing)(AACDecContext *ac, SingleChannelElem
     const INTFLOAT *swindow      = ics->use_kb_window[0] ? AAC_RENAME2(aac_kbd_short_128) : AAC_RENAME2(sine_128);
     const INTFLOAT *lwindow_prev = ics->use_kb_window[1] ? AAC_RENAME2(aac_kbd_long_1024) : AAC_RENAME2(sine_1024);
     const INTFLOAT *swindow_prev = ics->use_kb_window[1] ? AAC_RENAME2(aac_kbd_short_128) : AAC_RENAME2(sine_128);
-    INTFLOAT *buf  = ac->AAC_RENAME(buf_mdct);
-    INTFLOAT *temp = ac->AAC_RENAME(temp);
-    int i;
+    INTFLOAT *buf  = td->AAC_RENAME(buf_mdct);
+    INTFLOAT *temp = td->AAC_RENAME(temp);
 
     // imdct
     if (ics->window_sequence[0] == EIGHT_SHORT_SEQUENCE) {
-        for (i = 0; i < 1024; i += 128)
-            ac->mdct128_fn(ac->mdct128, buf + i, in + i, sizeof(INTFLOAT));
+        td->mdct128_fn(td->mdct128, buf, in, sizeof(INTFLOAT));
     } else {
-        ac->mdct1024_fn(ac->mdct1024, buf, in, sizeof(INTFLOAT));
+        td->mdct1024_fn(td->mdct1024, buf, in, sizeof(INTFLOAT));
     }
 
     /* window overlapping
@@ -386,7 +388,8 @@ static void AAC_RENAME(imdct_and_windowing)(AACDecContext *ac, SingleChannelElem
 /**
  * Conduct IMDCT and windowing for 768-point frames.
  */
-static void AAC_RENAME(imdct_and_windowing_768)(AACDecContext *ac, SingleChannelElement *sce)
+static void AAC_RENAME(imdct_and_windowing_768)(AACDecContext *ac, AACDecThreadContext *td,
+                                                SingleChannelElement *sce)
 {
     IndividualChannelStream *ics = &sce->ics;
     INTFLOAT *in    = sce->AAC_RENAME(coeffs);
@@ -395,16 +398,14 @@ static void AAC_RENAME(imdct_and_windowing_768)(AACDecContext *ac, SingleChannel
     const INTFLOAT *swindow      = ics->use_kb_window[0] ? AAC_RENAME(aac_kbd_short_96) : AAC_RENAME(sine_96);
     const INTFLOAT *lwindow_prev = ics->use_kb_window[1] ? AAC_RENAME(aac_kbd_long_768) : AAC_RENAME(sine_768);
     const INTFLOAT *swindow_prev = ics->use_kb_window[1] ? AAC_RENAME(aac_kbd_short_96) : AAC_RENAME(sine_96);
-    INTFLOAT *buf  = ac->AAC_RENAME(buf_mdct);
-    INTFLOAT *temp = ac->AAC_RENAME(temp);
-    int i;
+    INTFLOAT *buf  = td->AAC_RENAME(buf_mdct);
+    INTFLOAT *temp = td->AAC_RENAME(temp);
 
     // imdct
     if (ics->window_sequence[0] == EIGHT_SHORT_SEQUENCE) {
-        for (i = 0; i < 8; i++)
-            ac->mdct96_fn(ac->mdct96, buf + i * 96, in + i * 96, sizeof(INTFLOAT));
+        td->mdct96_fn(td->mdct96, buf, in, sizeof(INTFLOAT));
     } else {
-        ac->mdct768_fn(ac->mdct768, buf, in, sizeof(INTFLOAT));
+        td->mdct768_fn(td->mdct768, buf, in, sizeof(INTFLOAT));
     }
 
     /* window overlapping
@@ -451,7 +452,8 @@ static void AAC_RENAME(imdct_and_windowing_768)(AACDecContext *ac, SingleChannel
 /**
  * Conduct IMDCT and windowing.
  */
-static void AAC_RENAME(imdct_and_windowing_960)(AACDecContext *ac, SingleChannelElement *sce)
+static void AAC_RENAME(imdct_and_windowing_960)(AACDecContext *ac, AACDecThreadContext *td,
+                                                SingleChannelElement *sce)
 {
     IndividualChannelStream *ics = &sce->ics;
     INTFLOAT *in    = sce->AAC_RENAME(coeffs);
@@ -460,16 +462,14 @@ static void AAC_RENAME(imdct_and_windowing_960)(AACDecContext *ac, SingleChannel
     const INTFLOAT *swindow      = ics->use_kb_window[0] ? AAC_RENAME(aac_kbd_short_120) : AAC_RENAME(sine_120);
     const INTFLOAT *lwindow_prev = ics->use_kb_window[1] ? AAC_RENAME(aac_kbd_long_960) : AAC_RENAME(sine_960);
     const INTFLOAT *swindow_prev = ics->use_kb_window[1] ? AAC_RENAME(aac_kbd_short_120) : AAC_RENAME(sine_120);
-    INTFLOAT *buf  = ac->AAC_RENAME(buf_mdct);
-    INTFLOAT *temp = ac->AAC_RENAME(temp);
-    int i;
+    INTFLOAT *buf  = td->AAC_RENAME(buf_mdct);
+    INTFLOAT *temp = td->AAC_RENAME(temp);
 
     // imdct
     if (ics->window_sequence[0] == EIGHT_SHORT_SEQUENCE) {
-        for (i = 0; i < 8; i++)
-            ac->mdct120_fn(ac->mdct120, buf + i * 120, in + i * 128, sizeof(INTFLOAT));
+        td->mdct120_fn(td->mdct120, buf, in, sizeof(INTFLOAT));
     } else {
-        ac->mdct960_fn(ac->mdct960, buf, in, sizeof(INTFLOAT));
+        td->mdct960_fn(td->mdct960, buf, in, sizeof(INTFLOAT));
     }
 
     /* window overlapping
@@ -513,16 +513,17 @@ static void AAC_RENAME(imdct_and_windowing_960)(AACDecContext *ac, SingleChannel
     }
 }
 
-static void AAC_RENAME(imdct_and_windowing_ld)(AACDecContext *ac, SingleChannelElement *sce)
+static void AAC_RENAME(imdct_and_windowing_ld)(AACDecContext *ac, AACDecThreadContext *td,
+                                               SingleChannelElement *sce)
 {
     IndividualChannelStream *ics = &sce->ics;
     INTFLOAT *in    = sce->AAC_RENAME(coeffs);
     INTFLOAT *out   = sce->AAC_RENAME(output);
     INTFLOAT *saved = sce->AAC_RENAME(saved);
-    INTFLOAT *buf   = ac->AAC_RENAME(buf_mdct);
+    INTFLOAT *buf   = td->AAC_RENAME(buf_mdct);
 
     // imdct
-    ac->mdct512_fn(ac->mdct512, buf, in, sizeof(INTFLOAT));
+    td->mdct512_fn(td->mdct512, buf, in, sizeof(INTFLOAT));
 
     // window overlapping
     if (ics->use_kb_window[1]) {
@@ -538,12 +539,13 @@ static void AAC_RENAME(imdct_and_windowing_ld)(AACDecContext *ac, SingleChannelE
     memcpy(saved, buf + 256, 256 * sizeof(*saved));
 }
 
-static void AAC_RENAME(imdct_and_windowing_eld)(AACDecContext *ac, SingleChannelElement *sce)
+static void AAC_RENAME(imdct_and_windowing_eld)(AACDecContext *ac, AACDecThreadContext *td,
+                                                SingleChannelElement *sce)
 {
     UINTFLOAT *in   = sce->AAC_RENAME(coeffs);
     INTFLOAT *out   = sce->AAC_RENAME(output);
     INTFLOAT *saved = sce->AAC_RENAME(saved);
-    INTFLOAT *buf   = ac->AAC_RENAME(buf_mdct);
+    INTFLOAT *buf   = td->AAC_RENAME(buf_mdct);
     int i;
     const int n  = ac->oc[1].m4ac.frame_length_short ? 480 : 512;
     const int n2 = n >> 1;
@@ -563,9 +565,9 @@ static void AAC_RENAME(imdct_and_windowing_eld)(AACDecContext *ac, SingleChannel
     }
 
     if (n == 480)
-        ac->mdct480_fn(ac->mdct480, buf, in, sizeof(INTFLOAT));
+        td->mdct480_fn(td->mdct480, buf, in, sizeof(INTFLOAT));
     else
-        ac->mdct512_fn(ac->mdct512, buf, in, sizeof(INTFLOAT));
+        td->mdct512_fn(td->mdct512, buf, in, sizeof(INTFLOAT));
 
     for (i = 0; i < n; i+=2) {
         buf[i + 0] = -(UINTFLOAT)(USE_FIXED + 1)*buf[i + 0];
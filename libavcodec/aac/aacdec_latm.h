@@ -342,7 +342,8 @@ const FFCodec ff_aac_latm_decoder = {
     .p.sample_fmts   = (const enum AVSampleFormat[]) {
         AV_SAMPLE_FMT_FLTP, AV_SAMPLE_FMT_NONE
     },
-    .p.capabilities  = AV_CODEC_CAP_CHANNEL_CONF | AV_CODEC_CAP_DR1,
+    .p.capabilities  = AV_CODEC_CAP_CHANNEL_CONF | AV_CODEC_CAP_DR1 |
+                       AV_CODEC_CAP_SLICE_THREADS,
     .caps_internal   = FF_CODEC_CAP_INIT_CLEANUP,
     .p.ch_layouts    = ff_aac_ch_layout,
     .flush = flush,
@@ -1281,8 +1281,9 @@ static const float *complex_stereo_get_filter(ChannelElement *cpe, int is_prev)
     return ff_aac_usac_mdst_filt_cur[win][shape];
 }
 
-static void spectrum_decode(AACDecContext *ac, AACUSACConfig *usac,
-                            ChannelElement *cpe, int nb_channels)
+static void spectrum_decode(AACDecContext *ac, AACDecThreadContext *td,
+                            AACUSACConfig *usac, ChannelElement *cpe,
+                            int nb_channels)
 {
     AACUsacStereo *us = &cpe->us;
 
@@ -1340,8 +1341,8 @@ static void spectrum_decode(AACDecContext *ac, AACUSACConfig *usac,
         if (sce->tns.present && ((nb_channels == 1) || (us->tns_on_lr)))
             ac->dsp.apply_tns(sce->coeffs, &sce->tns, &sce->ics, 1);
 
-        ac->oc[1].m4ac.frame_length_short ? ac->dsp.imdct_and_windowing_768(ac, sce) :
-                                            ac->dsp.imdct_and_windowing(ac, sce);
+        ac->oc[1].m4ac.frame_length_short ? ac->dsp.imdct_and_windowing_768(ac, td, sce) :
+                                            ac->dsp.imdct_and_windowing(ac, td, sce);
     }
 }
 
@@ -1489,7 +1490,34 @@ static int decode_usac_core_coder(AACDecContext *ac, AACUSACConfig *usac,
         }
     }
 
-    spectrum_decode(ac, usac, che, core_nb_channels);
+    return 0;
+}
+
+typedef struct USACElementJobs {
+    AACDecContext *ac;
+    AACUSACConfig *usac;
+    int nb_elems;
+    struct {
+        AACUsacElemConfig *ec;
+        ChannelElement *che;
+        int nb_channels;
+    } elems[64];
+} USACElementJobs;
+
+static int element_to_sample_job(AVCodecContext *avctx, void *arg,
+                                 int jobnr, int threadnr)
+{
+    USACElementJobs *jobs = arg;
+    AACDecContext *ac = jobs->ac;
+    AACUsacElemConfig *ec = jobs->elems[jobnr].ec;
+    ChannelElement *che = jobs->elems[jobnr].che;
+    int nb_channels = jobs->elems[jobnr].nb_channels;
+    int core_nb_channels = nb_channels;
+
+    if (nb_channels > 1 && ec->stereo_config_index == 1)
+        core_nb_channels = 1;
+
+    spectrum_decode(ac, &ac->td[threadnr], jobs->usac, che, core_nb_channels);
 
     if (ac->oc[1].m4ac.sbr > 0) {
         ac->proc.sbr_apply(ac, che, nb_channels == 2 ? TYPE_CPE : TYPE_SCE,
@@ -1500,6 +1528,40 @@ static int decode_usac_core_coder(AACDecContext *ac, AACUSACConfig *usac,
     return 0;
 }
 
+/**
+ * Convert the spectral data of all elements decoded so far to samples.
+ * The elements are independent of each other, so this is done in parallel.
+ */
+static void elements_to_sample(USACElementJobs *jobs)
+{
+    AACDecContext *ac = jobs->ac;
+
+    if (jobs->nb_elems > 1)
+        ac->avctx->execute2(ac->avctx, element_to_sample_job, jobs, NULL,
+                            jobs->nb_elems);
+    else if (jobs->nb_elems)
+        element_to_sample_job(ac->avctx, jobs, 0, 0);
+
+    jobs->nb_elems = 0;
+}
+
+static int decode_usac_element(AACDecContext *ac, USACElementJobs *jobs,
+                               AACUsacElemConfig *ec, ChannelElement *che,
+                               GetBitContext *gb, int indep_flag, int nb_channels)
+{
+    int ret = decode_usac_core_coder(ac, jobs->usac, ec, che, gb,
+                                     indep_flag, nb_channels);
+    if (ret < 0)
+        return ret;
+
+    jobs->elems[jobs->nb_elems].ec          = ec;
+    jobs->elems[jobs->nb_elems].che         = che;
+    jobs->elems[jobs->nb_elems].nb_channels = nb_channels;
+    jobs->nb_elems++;
+
+    return 0;
+}
+
 static int parse_audio_preroll(AACDecContext *ac, GetBitContext *gb)
 {
     int ret = 0;
@@ -1663,6 +1725,7 @@ int ff_aac_usac_decode_frame(AVCodecContext *avctx, AACDecContext *ac,
     int audio_found = 0;
     int elem_id[3 /* SCE, CPE, LFE */] = { 0, 0, 0 };
     AVFrame *frame = ac->frame;
+    USACElementJobs jobs;
 
     int ratio_mult, ratio_dec;
     AACUSACConfig *usac = &ac->oc[1].usac;
@@ -1692,6 +1755,10 @@ int ff_aac_usac_decode_frame(AVCodecContext *avctx, AACDecContext *ac,
 
     indep_flag = get_bits1(gb);
 
+    jobs.ac       = ac;
+    jobs.usac     = usac;
+    jobs.nb_elems = 0;
+
     for (int i = 0; i < ac->oc[1].usac.nb_elems; i++) {
         int layout_id;
         int layout_type;
@@ -1723,8 +1790,7 @@ int ff_aac_usac_decode_frame(AVCodecContext *avctx, AACDecContext *ac,
         case ID_USAC_LFE:
             /* Fallthrough */
         case ID_USAC_SCE:
-            ret = decode_usac_core_coder(ac, &ac->oc[1].usac, e, che, gb,
-                                         indep_flag, 1);
+            ret = decode_usac_element(ac, &jobs, e, che, gb, indep_flag, 1);
             if (ret < 0)
                 return ret;
 
@@ -1732,8 +1798,7 @@ int ff_aac_usac_decode_frame(AVCodecContext *avctx, AACDecContext *ac,
             che->present = 1;
             break;
         case ID_USAC_CPE:
-            ret = decode_usac_core_coder(ac, &ac->oc[1].usac, e, che, gb,
-                                         indep_flag, 2);
+            ret = decode_usac_element(ac, &jobs, e, che, gb, indep_flag, 2);
             if (ret < 0)
                 return ret;
 
@@ -1741,6 +1806,8 @@ int ff_aac_usac_decode_frame(AVCodecContext *avctx, AACDecContext *ac,
             che->present = 1;
             break;
         case ID_USAC_EXT:
+            /* An audio preroll may reconfigure the decoder */
+            elements_to_sample(&jobs);
             ret = parse_ext_ele(ac, e, gb);
             if (ret < 0)
                 return ret;
@@ -1748,6 +1815,8 @@ int ff_aac_usac_decode_frame(AVCodecContext *avctx, AACDecContext *ac,
         }
     }
 
+    elements_to_sample(&jobs);
+
     if (audio_found)
         samples = ac->oc[1].m4ac.frame_length_short ? 768 : 1024;
 
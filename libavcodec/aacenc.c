@@ -826,6 +826,128 @@ static void copy_input_samples(AACEncContext *s, const AVFrame *frame)
     }
 }
 
+/**
+ * Per frame state of the channel element searches.
+ */
+typedef struct ElementSearchParams {
+    const FFPsyWindowInfo *windows;
+    int start_ch[AAC_MAX_CHANNELS];
+    int bitres_alloc[AAC_MAX_CHANNELS];
+    int cutoff[AAC_MAX_CHANNELS];
+    uint8_t tns_mode[AAC_MAX_CHANNELS];
+    uint8_t pred_mode[AAC_MAX_CHANNELS];
+} ElementSearchParams;
+
+/**
+ * Search the coding parameters of one channel element.
+ *
+ * Elements are independent once psy has allocated their bits, so they are
+ * searched concurrently, each thread using its own copy of the context for
+ * the scratch buffers of the coder.
+ */
+static int search_element(AVCodecContext *avctx, void *arg, int i, int threadnr)
+{
+    AACEncContext *s = avctx->priv_data;
+    AACEncContext *t = s->thread_ctx[threadnr];
+    ElementSearchParams *p = arg;
+    const FFPsyWindowInfo *wi = p->windows + p->start_ch[i];
+    const int start_ch = p->start_ch[i];
+    const int tag      = s->chan_map[i+1];
+    const int chans    = tag == TYPE_CPE ? 2 : 1;
+    ChannelElement *cpe = &s->cpe[i];
+    SingleChannelElement *sce;
+    int ch, w;
+
+    t->lambda             = s->lambda;
+    t->psy.bitres         = s->psy.bitres;
+    t->psy.bitres.alloc   = p->bitres_alloc[i];
+    t->psy.cutoff         = s->psy.cutoff;
+    t->random_state       = cpe->random_state;
+    t->cur_type           = tag;
+    p->tns_mode[i]        = 0;
+    p->pred_mode[i]       = 0;
+
+    for (ch = 0; ch < chans; ch++) {
+        t->cur_channel = start_ch + ch;
+        if (t->options.pns && t->coder->mark_pns)
+            t->coder->mark_pns(t, avctx, &cpe->ch[ch]);
+        t->coder->search_for_quantizers(avctx, t, &cpe->ch[ch], t->lambda);
+    }
+    if (chans > 1
+        && wi[0].window_type[0] == wi[1].window_type[0]
+        && wi[0].window_shape   == wi[1].window_shape) {
+
+        cpe->common_window = 1;
+        for (w = 0; w < wi[0].num_windows; w++) {
+            if (wi[0].grouping[w] != wi[1].grouping[w]) {
+                cpe->common_window = 0;
+                break;
+            }
+        }
+    }
+    for (ch = 0; ch < chans; ch++) { /* TNS and PNS */
+        sce = &cpe->ch[ch];
+        t->cur_channel = start_ch + ch;
+        if (t->options.tns && t->coder->search_for_tns)
+            t->coder->search_for_tns(t, sce);
+        if (t->options.tns && t->coder->apply_tns_filt)
+            t->coder->apply_tns_filt(t, sce);
+        if (sce->tns.present)
+            p->tns_mode[i] = 1;
+        if (t->options.pns && t->coder->search_for_pns)
+            t->coder->search_for_pns(t, avctx, sce);
+    }
+    t->cur_channel = start_ch;
+    if (t->options.intensity_stereo) { /* Intensity Stereo */
+        if (t->coder->search_for_is)
+            t->coder->search_for_is(t, avctx, cpe);
+        apply_intensity_stereo(cpe);
+    }
+    if (t->options.pred) { /* Prediction */
+        for (ch = 0; ch < chans; ch++) {
+            sce = &cpe->ch[ch];
+            t->cur_channel = start_ch + ch;
+            if (t->options.pred && t->coder->search_for_pred)
+                t->coder->search_for_pred(t, sce);
+            if (cpe->ch[ch].ics.predictor_present) p->pred_mode[i] = 1;
+        }
+        if (t->coder->adjust_common_pred)
+            t->coder->adjust_common_pred(t, cpe);
+        for (ch = 0; ch < chans; ch++) {
+            sce = &cpe->ch[ch];
+            t->cur_channel = start_ch + ch;
+            if (t->options.pred && t->coder->apply_main_pred)
+                t->coder->apply_main_pred(t, sce);
+        }
+        t->cur_channel = start_ch;
+    }
+    if (t->options.mid_side) { /* Mid/Side stereo */
+        if (t->options.mid_side == -1 && t->coder->search_for_ms)
+            t->coder->search_for_ms(t, cpe);
+        else if (cpe->common_window)
+            memset(cpe->ms_mask, 1, sizeof(cpe->ms_mask));
+        apply_mid_side_stereo(cpe);
+    }
+    adjust_frame_information(cpe, chans);
+    if (t->options.ltp) { /* LTP */
+        for (ch = 0; ch < chans; ch++) {
+            sce = &cpe->ch[ch];
+            t->cur_channel = start_ch + ch;
+            if (t->coder->search_for_ltp)
+                t->coder->search_for_ltp(t, sce, cpe->common_window);
+            if (sce->ics.ltp.present) p->pred_mode[i] = 1;
+        }
+        t->cur_channel = start_ch;
+        if (t->coder->adjust_common_ltp)
+            t->coder->adjust_common_ltp(t, cpe);
+    }
+
+    cpe->random_state = t->random_state;
+    p->cutoff[i]      = t->psy.cutoff;
+
+    return 0;
+}
+
 static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
                             const AVFrame *frame, int *got_packet_ptr)
 {
@@ -839,6 +961,7 @@ static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
     int ms_mode = 0, is_mode = 0, tns_mode = 0, pred_mode = 0;
     int chan_el_counter[4];
     FFPsyWindowInfo windows[AAC_MAX_CHANNELS];
+    ElementSearchParams search = { .windows = windows };
 
     /* add current frame to queue */
     if (frame) {
@@ -961,7 +1084,6 @@ static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
             put_bitstream_info(s, LIBAVCODEC_IDENT);
         start_ch = 0;
         target_bits = 0;
-        memset(chan_el_counter, 0, sizeof(chan_el_counter));
         for (i = 0; i < s->chan_map[0]; i++) {
             FFPsyWindowInfo* wi = windows + start_ch;
             const float *coeffs[2];
@@ -971,8 +1093,6 @@ static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
             cpe->common_window = 0;
             memset(cpe->is_mask, 0, sizeof(cpe->is_mask));
             memset(cpe->ms_mask, 0, sizeof(cpe->ms_mask));
-            put_bits(&s->pb, 3, tag);
-            put_bits(&s->pb, 4, chan_el_counter[tag]++);
             for (ch = 0; ch < chans; ch++) {
                 sce = &cpe->ch[ch];
                 coeffs[ch] = sce->coeffs;
@@ -985,6 +1105,7 @@ static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
                     if (sce->band_type[w] > RESERVED_BT)
                         sce->band_type[w] = 0;
             }
+            /* the psy bit reservoir state is updated element by element */
             s->psy.bitres.alloc = -1;
             s->psy.bitres.bits = s->last_frame_pb_count / s->channels;
             s->psy.model->analyze(&s->psy, start_ch, coeffs, wi);
@@ -994,82 +1115,30 @@ static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
                     * (s->lambda / (avctx->global_quality ? avctx->global_quality : 120));
                 s->psy.bitres.alloc /= chans;
             }
+            search.start_ch[i]     = start_ch;
+            search.bitres_alloc[i] = s->psy.bitres.alloc;
+            start_ch += chans;
+        }
+
+        avctx->execute2(avctx, search_element, &search, NULL, s->chan_map[0]);
+        /* the coder may have refined the psy bandwidth */
+        s->psy.cutoff = search.cutoff[s->chan_map[0] - 1];
+
+        memset(chan_el_counter, 0, sizeof(chan_el_counter));
+        for (i = 0; i < s->chan_map[0]; i++) {
+            tag      = s->chan_map[i+1];
+            chans    = tag == TYPE_CPE ? 2 : 1;
+            cpe      = &s->cpe[i];
+            start_ch = search.start_ch[i];
+            if (search.tns_mode[i])
+                tns_mode = 1;
+            if (search.pred_mode[i])
+                pred_mode = 1;
+            if (s->options.intensity_stereo && cpe->is_mode)
+                is_mode = 1;
             s->cur_type = tag;
-            for (ch = 0; ch < chans; ch++) {
-                s->cur_channel = start_ch + ch;
-                if (s->options.pns && s->coder->mark_pns)
-                    s->coder->mark_pns(s, avctx, &cpe->ch[ch]);
-                s->coder->search_for_quantizers(avctx, s, &cpe->ch[ch], s->lambda);
-            }
-            if (chans > 1
-                && wi[0].window_type[0] == wi[1].window_type[0]
-                && wi[0].window_shape   == wi[1].window_shape) {
-
-                cpe->common_window = 1;
-                for (w = 0; w < wi[0].num_windows; w++) {
-                    if (wi[0].grouping[w] != wi[1].grouping[w]) {
-                        cpe->common_window = 0;
-                        break;
-                    }
-                }
-            }
-            for (ch = 0; ch < chans; ch++) { /* TNS and PNS */
-                sce = &cpe->ch[ch];
-                s->cur_channel = start_ch + ch;
-                if (s->options.tns && s->coder->search_for_tns)
-                    s->coder->search_for_tns(s, sce);
-                if (s->options.tns && s->coder->apply_tns_filt)
-                    s->coder->apply_tns_filt(s, sce);
-                if (sce->tns.present)
-                    tns_mode = 1;
-                if (s->options.pns && s->coder->search_for_pns)
-                    s->coder->search_for_pns(s, avctx, sce);
-            }
-            s->cur_channel = start_ch;
-            if (s->options.intensity_stereo) { /* Intensity Stereo */
-                if (s->coder->search_for_is)
-                    s->coder->search_for_is(s, avctx, cpe);
-                if (cpe->is_mode) is_mode = 1;
-                apply_intensity_stereo(cpe);
-            }
-            if (s->options.pred) { /* Prediction */
-                for (ch = 0; ch < chans; ch++) {
-                    sce = &cpe->ch[ch];
-                    s->cur_channel = start_ch + ch;
-                    if (s->options.pred && s->coder->search_for_pred)
-                        s->coder->search_for_pred(s, sce);
-                    if (cpe->ch[ch].ics.predictor_present) pred_mode = 1;
-                }
-                if (s->coder->adjust_common_pred)
-                    s->coder->adjust_common_pred(s, cpe);
-                for (ch = 0; ch < chans; ch++) {
-                    sce = &cpe->ch[ch];
-                    s->cur_channel = start_ch + ch;
-                    if (s->options.pred && s->coder->apply_main_pred)
-                        s->coder->apply_main_pred(s, sce);
-                }
-                s->cur_channel = start_ch;
-            }
-            if (s->options.mid_side) { /* Mid/Side stereo */
-                if (s->options.mid_side == -1 && s->coder->search_for_ms)
-                    s->coder->search_for_ms(s, cpe);
-                else if (cpe->common_window)
-                    memset(cpe->ms_mask, 1, sizeof(cpe->ms_mask));
-                apply_mid_side_stereo(cpe);
-            }
-            adjust_frame_information(cpe, chans);
-            if (s->options.ltp) { /* LTP */
-                for (ch = 0; ch < chans; ch++) {
-                    sce = &cpe->ch[ch];
-                    s->cur_channel = start_ch + ch;
-                    if (s->coder->search_for_ltp)
-                        s->coder->search_for_ltp(s, sce, cpe->common_window);
-                    if (sce->ics.ltp.present) pred_mode = 1;
-                }
-                s->cur_channel = start_ch;
-                if (s->coder->adjust_common_ltp)
-                    s->coder->adjust_common_ltp(s, cpe);
-            }
+            put_bits(&s->pb, 3, tag);
+            put_bits(&s->pb, 4, chan_el_counter[tag]++);
             if (chans == 2) {
                 put_bits(&s->pb, 1, cpe->common_window);
                 if (cpe->common_window) {
@@ -1086,7 +1155,6 @@ static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
                 s->cur_channel = start_ch + ch;
                 encode_individual_channel(avctx, s, &cpe->ch[ch], cpe->common_window);
             }
-            start_ch += chans;
         }
 
         if (avctx->flags & AV_CODEC_FLAG_QSCALE) {
@@ -1193,6 +1261,12 @@ static av_cold int aac_encode_end(AVCodecContext *avctx)
     av_tx_uninit(&s->mdct128);
     ff_psy_end(&s->psy);
     ff_lpc_end(&s->lpc);
+    for (int i = 1; i < s->nb_thread_ctx; i++) {
+        if (s->thread_ctx[i])
+            ff_lpc_end(&s->thread_ctx[i]->lpc);
+        av_freep(&s->thread_ctx[i]);
+    }
+    av_freep(&s->thread_ctx);
     if (s->psypp)
         ff_psy_preprocess_end(s->psypp);
     av_freep(&s->buffer.samples);
@@ -1379,11 +1453,31 @@ static av_cold int aac_encode_init(AVCodecContext *avctx)
                            s->chan_map[0], grouping)) < 0)
         return ret;
     s->psypp = ff_psy_preprocess_init(avctx);
-    ff_lpc_init(&s->lpc, 2*avctx->frame_size, TNS_MAX_ORDER, FF_LPC_TYPE_LEVINSON);
+    if ((ret = ff_lpc_init(&s->lpc, 2*avctx->frame_size, TNS_MAX_ORDER, FF_LPC_TYPE_LEVINSON)) < 0)
+        return ret;
     s->random_state = 0x1f2e3d4c;
+    for (i = 0; i < s->chan_map[0]; i++)
+        s->cpe[i].random_state = s->random_state ^ (i * 0x9E3779B9U);
 
     ff_aacenc_dsp_init(&s->aacdsp);
 
+    /* the thread contexts share everything but the scratch buffers */
+    ret = avctx->active_thread_type & FF_THREAD_SLICE ?
+          FFMAX(avctx->thread_count, 1) : 1;
+    s->thread_ctx = av_calloc(ret, sizeof(*s->thread_ctx));
+    if (!s->thread_ctx)
+        return AVERROR(ENOMEM);
+    s->nb_thread_ctx = ret;
+    s->thread_ctx[0] = s;
+    for (i = 1; i < s->nb_thread_ctx; i++) {
+        AACEncContext *t = av_memdup(s, sizeof(*s));
+        if (!t)
+            return AVERROR(ENOMEM);
+        s->thread_ctx[i] = t;
+        if ((ret = ff_lpc_init(&t->lpc, 2*avctx->frame_size, TNS_MAX_ORDER, FF_LPC_TYPE_LEVINSON)) < 0)
+            return ret;
+    }
+
     ff_af_queue_init(avctx, &s->afq);
 
     return 0;
@@ -1423,7 +1517,8 @@ const FFCodec ff_aac_encoder = {
     .p.type         = AVMEDIA_TYPE_AUDIO,
     .p.id           = AV_CODEC_ID_AAC,
     .p.capabilities = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_DELAY |
-                      AV_CODEC_CAP_SMALL_LAST_FRAME,
+                      AV_CODEC_CAP_SMALL_LAST_FRAME |
+                      AV_CODEC_CAP_SLICE_THREADS,
     .priv_data_size = sizeof(AACEncContext),
     .init           = aac_encode_init,
     FF_CODEC_ENCODE_CB(aac_encode_frame),
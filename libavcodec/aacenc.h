@@ -156,6 +156,7 @@ typedef struct ChannelElement {
     uint8_t is_mask[128];     ///< Set if intensity stereo is used
     // shared
     SingleChannelElement ch[2];
+    int random_state;         ///< PNS noise generator state of the element
 } ChannelElement;
 
 struct AACEncContext;
@@ -253,6 +254,9 @@ typedef struct AACEncContext {
     struct {
         float *samples;
     } buffer;
+
+    struct AACEncContext **thread_ctx;           ///< per thread contexts for the element searches, the first is this one
+    int nb_thread_ctx;
 } AACEncContext;
 
 void ff_quantize_band_cost_cache_init(struct AACEncContext *s);
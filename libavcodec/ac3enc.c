@@ -658,64 +658,57 @@ static const uint8_t exp_strategy_reuse_tab[4][6] = {
 };
 
 /*
- * Calculate exponent strategies for all channels.
+ * Calculate exponent strategies for one channel.
  * Array arrangement is reversed to simplify the per-channel calculation.
  */
-static void compute_exp_strategy(AC3EncodeContext *s)
+static void compute_exp_strategy_ch(AC3EncodeContext *s, int ch)
 {
-    int ch, blk, blk1;
-
-    for (ch = !s->cpl_on; ch <= s->fbw_channels; ch++) {
-        uint8_t *exp_strategy = s->exp_strategy[ch];
-        uint8_t *exp          = s->blocks[0].exp[ch];
-        int exp_diff;
-
-        /* estimate if the exponent variation & decide if they should be
-           reused in the next frame */
-        exp_strategy[0] = EXP_NEW;
-        exp += AC3_MAX_COEFS;
-        for (blk = 1; blk < s->num_blocks; blk++, exp += AC3_MAX_COEFS) {
-            if (ch == CPL_CH) {
-                if (!s->blocks[blk-1].cpl_in_use) {
-                    exp_strategy[blk] = EXP_NEW;
-                    continue;
-                } else if (!s->blocks[blk].cpl_in_use) {
-                    exp_strategy[blk] = EXP_REUSE;
-                    continue;
-                }
-            } else if (s->blocks[blk].channel_in_cpl[ch] != s->blocks[blk-1].channel_in_cpl[ch]) {
+    uint8_t *exp_strategy = s->exp_strategy[ch];
+    uint8_t *exp          = s->blocks[0].exp[ch];
+    int blk, blk1, exp_diff;
+
+    if (ch == s->lfe_channel) {
+        exp_strategy[0] = EXP_D15;
+        for (blk = 1; blk < s->num_blocks; blk++)
+            exp_strategy[blk] = EXP_REUSE;
+        return;
+    }
+
+    /* estimate if the exponent variation & decide if they should be
+       reused in the next frame */
+    exp_strategy[0] = EXP_NEW;
+    exp += AC3_MAX_COEFS;
+    for (blk = 1; blk < s->num_blocks; blk++, exp += AC3_MAX_COEFS) {
+        if (ch == CPL_CH) {
+            if (!s->blocks[blk-1].cpl_in_use) {
                 exp_strategy[blk] = EXP_NEW;
                 continue;
+            } else if (!s->blocks[blk].cpl_in_use) {
+                exp_strategy[blk] = EXP_REUSE;
+                continue;
             }
-            exp_diff = s->mecc.sad[0](NULL, exp, exp - AC3_MAX_COEFS, 16, 16);
-            exp_strategy[blk] = EXP_REUSE;
-            if (ch == CPL_CH && exp_diff > (EXP_DIFF_THRESHOLD * (s->blocks[blk].end_freq[ch] - s->start_freq[ch]) / AC3_MAX_COEFS))
-                exp_strategy[blk] = EXP_NEW;
-            else if (ch > CPL_CH && exp_diff > EXP_DIFF_THRESHOLD)
-                exp_strategy[blk] = EXP_NEW;
-        }
-
-        /* now select the encoding strategy type : if exponents are often
-           recoded, we use a coarse encoding */
-        blk = 0;
-        while (blk < s->num_blocks) {
-            blk1 = blk + 1;
-            while (blk1 < s->num_blocks && exp_strategy[blk1] == EXP_REUSE)
-                blk1++;
-            exp_strategy[blk] = exp_strategy_reuse_tab[s->num_blks_code][blk1-blk-1];
-            blk = blk1;
+        } else if (s->blocks[blk].channel_in_cpl[ch] != s->blocks[blk-1].channel_in_cpl[ch]) {
+            exp_strategy[blk] = EXP_NEW;
+            continue;
         }
-    }
-    if (s->lfe_on) {
-        ch = s->lfe_channel;
-        s->exp_strategy[ch][0] = EXP_D15;
-        for (blk = 1; blk < s->num_blocks; blk++)
-            s->exp_strategy[ch][blk] = EXP_REUSE;
+        exp_diff = s->mecc.sad[0](NULL, exp, exp - AC3_MAX_COEFS, 16, 16);
+        exp_strategy[blk] = EXP_REUSE;
+        if (ch == CPL_CH && exp_diff > (EXP_DIFF_THRESHOLD * (s->blocks[blk].end_freq[ch] - s->start_freq[ch]) / AC3_MAX_COEFS))
+            exp_strategy[blk] = EXP_NEW;
+        else if (ch > CPL_CH && exp_diff > EXP_DIFF_THRESHOLD)
+            exp_strategy[blk] = EXP_NEW;
     }
 
-    /* for E-AC-3, determine frame exponent strategy */
-    if (CONFIG_EAC3_ENCODER && s->eac3)
-        ff_eac3_get_frame_exp_strategy(s);
+    /* now select the encoding strategy type : if exponents are often
+       recoded, we use a coarse encoding */
+    blk = 0;
+    while (blk < s->num_blocks) {
+        blk1 = blk + 1;
+        while (blk1 < s->num_blocks && exp_strategy[blk1] == EXP_REUSE)
+            blk1++;
+        exp_strategy[blk] = exp_strategy_reuse_tab[s->num_blks_code][blk1-blk-1];
+        blk = blk1;
+    }
 }
 
 
@@ -795,55 +788,59 @@ static void encode_exponents_blk_ch(uint8_t *exp, int nb_exps, int exp_strategy,
 
 
 /*
- * Encode exponents from original extracted form to what the decoder will see.
+ * Encode exponents of one channel from original extracted form to what the
+ * decoder will see.
  * This copies and groups exponents based on exponent strategy and reduces
  * deltas between adjacent exponent groups so that they can be differentially
  * encoded.
  */
-static void encode_exponents(AC3EncodeContext *s)
+static void encode_exponents_ch(AC3EncodeContext *s, int ch)
 {
-    int blk, blk1, ch, cpl;
-    uint8_t *exp, *exp_strategy;
-    int nb_coefs, num_reuse_blocks;
-
-    for (ch = !s->cpl_on; ch <= s->channels; ch++) {
-        exp          = s->blocks[0].exp[ch] + s->start_freq[ch];
-        exp_strategy = s->exp_strategy[ch];
-
-        cpl = (ch == CPL_CH);
-        blk = 0;
-        while (blk < s->num_blocks) {
-            AC3Block *block = &s->blocks[blk];
-            if (cpl && !block->cpl_in_use) {
-                exp += AC3_MAX_COEFS;
-                blk++;
-                continue;
-            }
-            nb_coefs = block->end_freq[ch] - s->start_freq[ch];
-            blk1 = blk + 1;
-
-            /* count the number of EXP_REUSE blocks after the current block
-               and set exponent reference block numbers */
-            s->exp_ref_block[ch][blk] = blk;
-            while (blk1 < s->num_blocks && exp_strategy[blk1] == EXP_REUSE) {
-                s->exp_ref_block[ch][blk1] = blk;
-                blk1++;
-            }
-            num_reuse_blocks = blk1 - blk - 1;
-
-            /* for the EXP_REUSE case we select the min of the exponents */
-            s->ac3dsp.ac3_exponent_min(exp-s->start_freq[ch], num_reuse_blocks,
-                                       AC3_MAX_COEFS);
+    uint8_t *exp          = s->blocks[0].exp[ch] + s->start_freq[ch];
+    uint8_t *exp_strategy = s->exp_strategy[ch];
+    int cpl = (ch == CPL_CH);
+    int blk = 0, blk1, nb_coefs, num_reuse_blocks;
 
-            encode_exponents_blk_ch(exp, nb_coefs, exp_strategy[blk], cpl);
+    while (blk < s->num_blocks) {
+        AC3Block *block = &s->blocks[blk];
+        if (cpl && !block->cpl_in_use) {
+            exp += AC3_MAX_COEFS;
+            blk++;
+            continue;
+        }
+        nb_coefs = block->end_freq[ch] - s->start_freq[ch];
+        blk1 = blk + 1;
 
-            exp += AC3_MAX_COEFS * (num_reuse_blocks + 1);
-            blk = blk1;
+        /* count the number of EXP_REUSE blocks after the current block
+           and set exponent reference block numbers */
+        s->exp_ref_block[ch][blk] = blk;
+        while (blk1 < s->num_blocks && exp_strategy[blk1] == EXP_REUSE) {
+            s->exp_ref_block[ch][blk1] = blk;
+            blk1++;
         }
+        num_reuse_blocks = blk1 - blk - 1;
+
+        /* for the EXP_REUSE case we select the min of the exponents */
+        s->ac3dsp.ac3_exponent_min(exp-s->start_freq[ch], num_reuse_blocks,
+                                   AC3_MAX_COEFS);
+
+        encode_exponents_blk_ch(exp, nb_coefs, exp_strategy[blk], cpl);
+
+        exp += AC3_MAX_COEFS * (num_reuse_blocks + 1);
+        blk = blk1;
     }
+}
 
-    /* reference block numbers have been changed, so reset ref_bap_set */
-    s->ref_bap_set = 0;
+
+static int process_exponents_ch(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    AC3EncodeContext *s = avctx->priv_data;
+    int ch = jobnr + !s->cpl_on;
+
+    compute_exp_strategy_ch(s, ch);
+    encode_exponents_ch(s, ch);
+
+    return 0;
 }
 
 
@@ -944,9 +941,17 @@ static void ac3_process_exponents(AC3EncodeContext *s)
 {
     extract_exponents(s);
 
-    compute_exp_strategy(s);
+    /* The strategy and final exponents of each channel only depend on the
+       exponents of that channel. */
+    s->avctx->execute2(s->avctx, process_exponents_ch, NULL, NULL,
+                       s->channels + s->cpl_on);
+
+    /* for E-AC-3, determine frame exponent strategy */
+    if (CONFIG_EAC3_ENCODER && s->eac3)
+        ff_eac3_get_frame_exp_strategy(s);
 
-    encode_exponents(s);
+    /* reference block numbers have been changed, so reset ref_bap_set */
+    s->ref_bap_set = 0;
 
     emms_c();
 }
@@ -1241,32 +1246,32 @@ static void count_frame_bits(AC3EncodeContext *s)
 
 
 /*
- * Calculate masking curve based on the final exponents.
+ * Calculate masking curve of one block based on the final exponents.
  * Also calculate the power spectral densities to use in future calculations.
  */
-static void bit_alloc_masking(AC3EncodeContext *s)
+static int bit_alloc_masking_blk(AVCodecContext *avctx, void *arg, int blk, int threadnr)
 {
-    int blk, ch;
+    AC3EncodeContext *s = avctx->priv_data;
+    AC3Block *block = &s->blocks[blk];
 
-    for (blk = 0; blk < s->num_blocks; blk++) {
-        AC3Block *block = &s->blocks[blk];
-        for (ch = !block->cpl_in_use; ch <= s->channels; ch++) {
-            /* We only need psd and mask for calculating bap.
-               Since we currently do not calculate bap when exponent
-               strategy is EXP_REUSE we do not need to calculate psd or mask. */
-            if (s->exp_strategy[ch][blk] != EXP_REUSE) {
-                ff_ac3_bit_alloc_calc_psd(block->exp[ch], s->start_freq[ch],
-                                          block->end_freq[ch], block->psd[ch],
-                                          block->band_psd[ch]);
-                ff_ac3_bit_alloc_calc_mask(&s->bit_alloc, block->band_psd[ch],
-                                           s->start_freq[ch], block->end_freq[ch],
-                                           ff_ac3_fast_gain_tab[s->fast_gain_code[ch]],
-                                           ch == s->lfe_channel,
-                                           DBA_NONE, 0, NULL, NULL, NULL,
-                                           block->mask[ch]);
-            }
+    for (int ch = !block->cpl_in_use; ch <= s->channels; ch++) {
+        /* We only need psd and mask for calculating bap.
+           Since we currently do not calculate bap when exponent
+           strategy is EXP_REUSE we do not need to calculate psd or mask. */
+        if (s->exp_strategy[ch][blk] != EXP_REUSE) {
+            ff_ac3_bit_alloc_calc_psd(block->exp[ch], s->start_freq[ch],
+                                      block->end_freq[ch], block->psd[ch],
+                                      block->band_psd[ch]);
+            ff_ac3_bit_alloc_calc_mask(&s->bit_alloc, block->band_psd[ch],
+                                       s->start_freq[ch], block->end_freq[ch],
+                                       ff_ac3_fast_gain_tab[s->fast_gain_code[ch]],
+                                       ch == s->lfe_channel,
+                                       DBA_NONE, 0, NULL, NULL, NULL,
+                                       block->mask[ch]);
         }
     }
+
+    return 0;
 }
 
 
@@ -1455,7 +1460,7 @@ static int ac3_compute_bit_allocation(AC3EncodeContext *s)
 
     s->exponent_bits = count_exponent_bits(s);
 
-    bit_alloc_masking(s);
+    s->avctx->execute2(s->avctx, bit_alloc_masking_blk, NULL, NULL, s->num_blocks);
 
     return cbr_bit_allocation(s);
 }
@@ -1599,34 +1604,44 @@ static void quantize_mantissas_blk_ch(AC3Mant *s, int32_t *fixed_coef,
 }
 
 
+/*
+ * Quantize the mantissas of one block.
+ */
+static int quantize_mantissas_blk(AVCodecContext *avctx, void *arg, int blk, int threadnr)
+{
+    AC3EncodeContext *s = avctx->priv_data;
+    AC3Block *block = &s->blocks[blk];
+    AC3Mant m = { 0 };
+    int ch, ch0 = 0, got_cpl;
+
+    got_cpl = !block->cpl_in_use;
+    for (ch = 1; ch <= s->channels; ch++) {
+        if (!got_cpl && ch > 1 && block->channel_in_cpl[ch-1]) {
+            ch0     = ch - 1;
+            ch      = CPL_CH;
+            got_cpl = 1;
+        }
+        quantize_mantissas_blk_ch(&m, block->fixed_coef[ch],
+                                  s->blocks[s->exp_ref_block[ch][blk]].exp[ch],
+                                  s->ref_bap[ch][blk], block->qmant[ch],
+                                  s->start_freq[ch], block->end_freq[ch]);
+        if (ch == CPL_CH)
+            ch = ch0;
+    }
+
+    return 0;
+}
+
+
 /**
  * Quantize mantissas using coefficients, exponents, and bit allocation pointers.
+ * The mantissa groups never span blocks, so the blocks are independent.
  *
  * @param s  AC-3 encoder private context
  */
 static void ac3_quantize_mantissas(AC3EncodeContext *s)
 {
-    int blk, ch, ch0=0, got_cpl;
-
-    for (blk = 0; blk < s->num_blocks; blk++) {
-        AC3Block *block = &s->blocks[blk];
-        AC3Mant m = { 0 };
-
-        got_cpl = !block->cpl_in_use;
-        for (ch = 1; ch <= s->channels; ch++) {
-            if (!got_cpl && ch > 1 && block->channel_in_cpl[ch-1]) {
-                ch0     = ch - 1;
-                ch      = CPL_CH;
-                got_cpl = 1;
-            }
-            quantize_mantissas_blk_ch(&m, block->fixed_coef[ch],
-                                      s->blocks[s->exp_ref_block[ch][blk]].exp[ch],
-                                      s->ref_bap[ch][blk], block->qmant[ch],
-                                      s->start_freq[ch], block->end_freq[ch]);
-            if (ch == CPL_CH)
-                ch = ch0;
-        }
-    }
+    s->avctx->execute2(s->avctx, quantize_mantissas_blk, NULL, NULL, s->num_blocks);
 }
 
 
@@ -2173,7 +2188,39 @@ av_cold int ff_ac3_encode_close(AVCodecContext *avctx)
     av_freep(&s->cpl_coord_buffer);
     av_freep(&s->fdsp);
 
-    av_tx_uninit(&s->tx);
+    if (s->mdct) {
+        for (int i = 0; i < s->nb_threads; i++)
+            av_tx_uninit(&s->mdct[i].tx);
+    }
+    av_freep(&s->mdct);
+
+    return 0;
+}
+
+
+/**
+ * Allocate the per thread MDCT contexts.
+ *
+ * @param type   transform type
+ * @param scale  transform scale
+ * @return       0 on success, negative error code on failure
+ */
+av_cold int ff_ac3_mdct_init(AVCodecContext *avctx, AC3EncodeContext *s,
+                             enum AVTXType type, const void *scale)
+{
+    s->nb_threads = avctx->active_thread_type & FF_THREAD_SLICE ?
+                    FFMAX(avctx->thread_count, 1) : 1;
+
+    s->mdct = av_calloc(s->nb_threads, sizeof(*s->mdct));
+    if (!s->mdct)
+        return AVERROR(ENOMEM);
+
+    for (int i = 0; i < s->nb_threads; i++) {
+        int ret = av_tx_init(&s->mdct[i].tx, &s->mdct[i].tx_fn, type, 0,
+                             AC3_BLOCK_SIZE, scale, 0);
+        if (ret < 0)
+            return ret;
+    }
 
     return 0;
 }
@@ -150,6 +150,18 @@ typedef struct AC3Block {
     int      end_freq[AC3_MAX_CHANNELS];        ///< end frequency bin                  (endmant)
 } AC3Block;
 
+/**
+ * MDCT state of one thread.
+ */
+typedef struct AC3MDCTContext {
+    AVTXContext *tx;                        ///< FFT context for MDCT calculation
+    av_tx_fn tx_fn;
+    union {
+        DECLARE_ALIGNED(32, float,   windowed_samples_float)[AC3_WINDOW_SIZE];
+        DECLARE_ALIGNED(32, int32_t, windowed_samples_fixed)[AC3_WINDOW_SIZE];
+    };
+} AC3MDCTContext;
+
 struct PutBitContext;
 
 /**
@@ -167,8 +179,8 @@ typedef struct AC3EncodeContext {
 #endif
     MECmpContext mecc;
     AC3DSPContext ac3dsp;                   ///< AC-3 optimized functions
-    AVTXContext *tx;                        ///< FFT context for MDCT calculation
-    av_tx_fn tx_fn;
+    AC3MDCTContext *mdct;                   ///< per thread MDCT contexts
+    int nb_threads;                         ///< number of threads the per channel and per block work is split over
 
     AC3Block blocks[AC3_MAX_BLOCKS];        ///< per-block info
 
@@ -262,10 +274,6 @@ typedef struct AC3EncodeContext {
         DECLARE_ALIGNED(32, float,   mdct_window_float)[AC3_BLOCK_SIZE];
         DECLARE_ALIGNED(32, int32_t, mdct_window_fixed)[AC3_BLOCK_SIZE];
     };
-    union {
-        DECLARE_ALIGNED(32, float,   windowed_samples_float)[AC3_WINDOW_SIZE];
-        DECLARE_ALIGNED(32, int32_t, windowed_samples_fixed)[AC3_WINDOW_SIZE];
-    };
 } AC3EncodeContext;
 
 extern const AVChannelLayout ff_ac3_ch_layouts[19];
@@ -274,6 +282,8 @@ extern const AVClass ff_ac3enc_class;
 extern const FFCodecDefault ff_ac3_enc_defaults[];
 
 int ff_ac3_encode_init(AVCodecContext *avctx);
+int ff_ac3_mdct_init(AVCodecContext *avctx, AC3EncodeContext *s,
+                     enum AVTXType type, const void *scale);
 int ff_ac3_float_encode_init(AVCodecContext *avctx);
 
 int ff_ac3_encode_close(AVCodecContext *avctx);
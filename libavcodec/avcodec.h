@@ -1595,7 +1595,8 @@ typedef struct AVCodecContext {
     /**
      * Which multithreading methods to use.
      * Use of FF_THREAD_FRAME will increase decoding delay by one frame per thread,
-     * so clients which cannot provide future frames should not use it.
+     * so clients which cannot provide future frames should not use it, unless
+     * FF_THREAD_LOW_DELAY is also set.
      *
      * - encoding: Set by user, otherwise the default is used.
      * - decoding: Set by user, otherwise the default is used.
@@ -1603,6 +1604,13 @@ typedef struct AVCodecContext {
     int thread_type;
 #define FF_THREAD_FRAME   1 ///< Decode more than one frame at once
 #define FF_THREAD_SLICE   2 ///< Decode more than one part of a single frame at once
+/**
+ * With FF_THREAD_FRAME, return each decoded frame as soon as it is complete
+ * whenever no more input is available, instead of waiting until a packet has
+ * been submitted to every thread. Decoding throughput is unchanged when the
+ * input is provided faster than it is decoded.
+ */
+#define FF_THREAD_LOW_DELAY 4
 
     /**
      * Which multithreading methods are in use by the codec.
@@ -2086,6 +2094,20 @@ typedef struct AVCodecContext {
      */
     AVFrameSideData  **decoded_side_data;
     int             nb_decoded_side_data;
+
+    /**
+     * Soft limit on the number of frames held by a frame threaded decoder,
+     * counting both reference frames and frames being decoded. When it is
+     * reached, no further packets are handed to idle threads until enough
+     * frames have been released, trading parallelism for memory. 0 means no
+     * limit.
+     *
+     * Only applies to decoders for which avcodec_get_frame_stats() succeeds.
+     *
+     * - encoding: unused
+     * - decoding: may be set by the caller at any time.
+     */
+    int max_decoder_frames;
 } AVCodecContext;
 
 /**
@@ -3072,6 +3094,30 @@ int avcodec_fill_audio_frame(AVFrame *frame, int nb_channels,
                              enum AVSampleFormat sample_fmt, const uint8_t *buf,
                              int buf_size, int align);
 
+/**
+ * Frame usage statistics of a decoder.
+ */
+typedef struct AVCodecFrameStats {
+    /**
+     * Number of frames currently held by the decoder, including reference
+     * frames and frames being decoded by frame threads, but not frames that
+     * were returned to the caller and are only referenced by the caller.
+     */
+    size_t nb_frames;
+    /**
+     * Highest value of nb_frames since the decoder was opened.
+     */
+    size_t peak_nb_frames;
+} AVCodecFrameStats;
+
+/**
+ * Get the frame usage statistics of an opened decoder.
+ *
+ * @return 0 on success, AVERROR(ENOSYS) if the decoder does not track its
+ *         frames
+ */
+int avcodec_get_frame_stats(const AVCodecContext *avctx, AVCodecFrameStats *stats);
+
 /**
  * Reset the internal codec state / flush internal buffers. Should be called
  * e.g. when seeking or when switching to a different stream.
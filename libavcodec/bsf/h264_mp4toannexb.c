@@ -68,7 +68,9 @@ static void count_or_copy(uint8_t **out, uint64_t *out_size,
         start_code_size = 3;
 
     if (copy) {
-        memcpy(*out + start_code_size, in, in_size);
+        /* the output may overlap the input when rewriting in place */
+        if (*out + start_code_size != in)
+            memmove(*out + start_code_size, in, in_size);
         if (start_code_size == 4) {
             AV_WB32(*out, 1);
         } else if (start_code_size) {
@@ -283,6 +285,7 @@ static int h264_mp4toannexb_filter(AVBSFContext *ctx, AVPacket *opkt)
     const uint8_t *buf_end;
     uint8_t *out;
     uint64_t out_size;
+    int in_place = 1;
     int ret;
     size_t extradata_size;
     uint8_t *extradata;
@@ -399,6 +402,9 @@ static int h264_mp4toannexb_filter(AVBSFContext *ctx, AVPacket *opkt)
             else
                 ps = PS_NONE;
             count_or_copy(&out, &out_size, buf, nal_size, ps, j);
+            /* the output can only be written over the input if it never
+             * gets ahead of the data that has not been read yet */
+            in_place &= out_size <= buf + nal_size - in->data;
             if (unit_type == H264_NAL_SLICE) {
                 new_idr  = 1;
                 sps_seen = 0;
@@ -413,23 +419,34 @@ static int h264_mp4toannexb_filter(AVBSFContext *ctx, AVPacket *opkt)
                 ret = AVERROR_INVALIDDATA;
                 goto fail;
             }
-            ret = av_new_packet(opkt, out_size);
-            if (ret < 0)
-                goto fail;
-            out = opkt->data;
+            in_place &= in->buf && av_buffer_is_writable(in->buf);
+            if (in_place) {
+                out = in->data;
+            } else {
+                ret = av_new_packet(opkt, out_size);
+                if (ret < 0)
+                    goto fail;
+                out = opkt->data;
+            }
         }
     }
 #undef LOG_ONCE
 
-    av_assert1(out_size == opkt->size);
-
     s->new_idr      = new_idr;
     s->idr_sps_seen = sps_seen;
     s->idr_pps_seen = pps_seen;
 
-    ret = av_packet_copy_props(opkt, in);
-    if (ret < 0)
-        goto fail;
+    if (in_place) {
+        av_packet_move_ref(opkt, in);
+        opkt->size = out_size;
+        memset(opkt->data + out_size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+    } else {
+        av_assert1(out_size == opkt->size);
+
+        ret = av_packet_copy_props(opkt, in);
+        if (ret < 0)
+            goto fail;
+    }
 
 fail:
     if (ret < 0)
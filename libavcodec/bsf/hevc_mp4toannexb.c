@@ -124,8 +124,9 @@ static int hevc_mp4toannexb_filter(AVBSFContext *ctx, AVPacket *out)
     HEVCBSFContext *s = ctx->priv_data;
     AVPacket *in;
     GetByteContext gb;
+    uint8_t *dst = NULL;
+    uint64_t out_size;
 
-    int got_irap = 0;
     int i, ret = 0;
 
     ret = ff_bsf_get_packet(ctx, &in);
@@ -138,49 +139,79 @@ static int hevc_mp4toannexb_filter(AVBSFContext *ctx, AVPacket *out)
         return 0;
     }
 
-    bytestream2_init(&gb, in->data, in->size);
+    /* the first pass validates the packet and computes the output size,
+     * the second one writes the output */
+    for (int j = 0; j < 2; j++) {
+        int got_irap = 0;
 
-    while (bytestream2_get_bytes_left(&gb)) {
-        uint32_t nalu_size = 0;
-        int      nalu_type;
-        int is_irap, add_extradata, extra_size, prev_size;
+        bytestream2_init(&gb, in->data, in->size);
+        out_size = 0;
 
-        if (bytestream2_get_bytes_left(&gb) < s->length_size) {
-            ret = AVERROR_INVALIDDATA;
-            goto fail;
-        }
-        for (i = 0; i < s->length_size; i++)
-            nalu_size = (nalu_size << 8) | bytestream2_get_byte(&gb);
-
-        if (nalu_size < 2 || nalu_size > bytestream2_get_bytes_left(&gb)) {
-            ret = AVERROR_INVALIDDATA;
-            goto fail;
-        }
+        while (bytestream2_get_bytes_left(&gb)) {
+            uint32_t nalu_size = 0;
+            int      nalu_type;
+            int is_irap, add_extradata, extra_size;
 
-        nalu_type = (bytestream2_peek_byte(&gb) >> 1) & 0x3f;
+            if (bytestream2_get_bytes_left(&gb) < s->length_size) {
+                ret = AVERROR_INVALIDDATA;
+                goto fail;
+            }
+            for (i = 0; i < s->length_size; i++)
+                nalu_size = (nalu_size << 8) | bytestream2_get_byte(&gb);
 
-        /* prepend extradata to IRAP frames */
-        is_irap = nalu_type >= HEVC_NAL_BLA_W_LP &&
-                  nalu_type <= HEVC_NAL_RSV_IRAP_VCL23;
-        add_extradata = is_irap && !got_irap;
-        extra_size    = add_extradata * ctx->par_out->extradata_size;
-        got_irap     |= is_irap;
+            if (nalu_size < 2 || nalu_size > bytestream2_get_bytes_left(&gb)) {
+                ret = AVERROR_INVALIDDATA;
+                goto fail;
+            }
 
-        if (FFMIN(INT_MAX, SIZE_MAX) < 4ULL + nalu_size + extra_size) {
-            ret = AVERROR_INVALIDDATA;
-            goto fail;
+            nalu_type = (bytestream2_peek_byte(&gb) >> 1) & 0x3f;
+
+            /* prepend extradata to IRAP frames */
+            is_irap = nalu_type >= HEVC_NAL_BLA_W_LP &&
+                      nalu_type <= HEVC_NAL_RSV_IRAP_VCL23;
+            add_extradata = is_irap && !got_irap;
+            extra_size    = add_extradata * ctx->par_out->extradata_size;
+            got_irap     |= is_irap;
+
+            if (j) {
+                if (extra_size)
+                    memcpy(dst, ctx->par_out->extradata, extra_size);
+                AV_WB32(dst + extra_size, 1);
+                bytestream2_get_buffer(&gb, dst + 4 + extra_size, nalu_size);
+                dst += 4 + nalu_size + extra_size;
+            } else {
+                bytestream2_skip(&gb, nalu_size);
+            }
+            out_size += 4 + nalu_size + extra_size;
         }
 
-        prev_size = out->size;
+        if (!j) {
+            if (out_size > INT_MAX - AV_INPUT_BUFFER_PADDING_SIZE) {
+                ret = AVERROR_INVALIDDATA;
+                goto fail;
+            }
 
-        ret = av_grow_packet(out, 4 + nalu_size + extra_size);
-        if (ret < 0)
-            goto fail;
+            /* with 4 byte lengths and no extradata to insert, only the
+             * lengths need to be replaced by start codes */
+            if (s->length_size == 4 && out_size == in->size &&
+                in->buf && av_buffer_is_writable(in->buf)) {
+                uint8_t *p = in->data;
+
+                while (p < in->data + in->size) {
+                    uint32_t nalu_size = AV_RB32(p);
+                    AV_WB32(p, 1);
+                    p += 4 + nalu_size;
+                }
+                av_packet_move_ref(out, in);
+                av_packet_free(&in);
+                return 0;
+            }
 
-        if (extra_size)
-            memcpy(out->data + prev_size, ctx->par_out->extradata, extra_size);
-        AV_WB32(out->data + prev_size + extra_size, 1);
-        bytestream2_get_buffer(&gb, out->data + prev_size + 4 + extra_size, nalu_size);
+            ret = av_new_packet(out, out_size);
+            if (ret < 0)
+                goto fail;
+            dst = out->data;
+        }
     }
 
     ret = av_packet_copy_props(out, in);
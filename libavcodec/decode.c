@@ -1895,6 +1895,17 @@ static av_cold void progress_frame_pool_free_entry_cb(FFRefStructOpaque opaque,
     av_frame_free(&progress->f);
 }
 
+int avcodec_get_frame_stats(const AVCodecContext *avctx, AVCodecFrameStats *stats)
+{
+    FFRefStructPool *pool = avctx->internal->progress_frame_pool;
+
+    if (!pool)
+        return AVERROR(ENOSYS);
+
+    ff_refstruct_pool_get_usage(pool, &stats->nb_frames, &stats->peak_nb_frames);
+    return 0;
+}
+
 int ff_decode_preinit(AVCodecContext *avctx)
 {
     AVCodecInternal *avci = avctx->internal;
@@ -23,10 +23,12 @@
 #include "libavutil/intreadwrite.h"
 #include "libavutil/intfloat.h"
 #include "libavutil/imgutils.h"
+#include "libavutil/mem.h"
 #include "libavutil/timecode.h"
 #include "avcodec.h"
 #include "codec_internal.h"
 #include "decode.h"
+#include "dpxdsp.h"
 
 enum DPX_TRC {
     DPX_TRC_USER_DEFINED       = 0,
@@ -84,74 +86,90 @@ static unsigned int read32(const uint8_t **ptr, int is_big)
     return temp;
 }
 
-static uint16_t read10in32_gray(const uint8_t **ptr, uint32_t *lbuf,
-                                int *n_datum, int is_big, int shift)
+typedef struct DPXDecContext {
+    DPXDSPContext dsp;
+
+    /* row buffers of the slice threads */
+    uint16_t *unpack_buf;
+    unsigned int unpack_buf_size;
+    int unpack_linesize;
+
+    /* layout of the 10 and 12-bit image data */
+    const uint8_t *data;
+    int stride;
+    int elements;
+    int bits;
+    int endian;
+    int packing;
+    int unpadded_10bit;
+    int shifts[3];
+    int nb_jobs;
+} DPXDecContext;
+
+static int decode_slice(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
 {
-    uint16_t temp;
-
-    if (*n_datum)
-        (*n_datum)--;
-    else {
-        *lbuf = read32(ptr, is_big);
-        *n_datum = 2;
-    }
-
-    temp = *lbuf >> shift & 0x3FF;
-    *lbuf = *lbuf >> 10;
-
-    return temp;
-}
-
-static uint16_t read10in32(const uint8_t **ptr, uint32_t *lbuf,
-                           int *n_datum, int is_big, int shift)
-{
-    if (*n_datum)
-        (*n_datum)--;
-    else {
-        *lbuf = read32(ptr, is_big);
-        *n_datum = 2;
-    }
-
-    *lbuf = *lbuf << 10 | *lbuf >> shift & 0x3FFFFF;
+    /* plane of each element of a pixel */
+    static const uint8_t planes[4][4] = {
+        { 0 }, { 0, 1 }, { 2, 0, 1 }, { 2, 0, 1, 3 },
+    };
+    DPXDecContext *s = avctx->priv_data;
+    AVFrame *p = arg;
+    const int elements = s->elements;
+    const int width    = avctx->width * elements;
+    const int start    = avctx->height *  jobnr      / s->nb_jobs;
+    const int end      = avctx->height * (jobnr + 1) / s->nb_jobs;
+    uint16_t *buf = s->unpack_buf + threadnr * s->unpack_linesize;
+
+    for (int y = start; y < end; y++) {
+        const uint16_t *src = buf;
+
+        if (s->bits == 10) {
+            const uint8_t *row = s->data + (ptrdiff_t)y * s->stride;
+            int skip = 0;
+
+            // unpadded rows start anywhere in a word
+            if (s->unpadded_10bit) {
+                int64_t first = (int64_t)y * width;
+                row  = s->data + first / 3 * 4;
+                skip = first % 3;
+            }
+            s->dsp.unpack10[s->endian](buf, row, (skip + width + 2) / 3, s->shifts);
+            src += skip;
+        } else if (s->packing) {
+            const uint8_t *row = s->data + (ptrdiff_t)y * s->stride;
+            const int shift = s->packing == 1 ? 4 : 0;
+
+            if (s->endian) {
+                for (int x = 0; x < width; x++)
+                    buf[x] = AV_RB16(row + 2 * x) >> shift & 0xFFF;
+            } else {
+                for (int x = 0; x < width; x++)
+                    buf[x] = AV_RL16(row + 2 * x) >> shift & 0xFFF;
+            }
+        } else {
+            s->dsp.unpack12[s->endian](buf, s->data + (ptrdiff_t)y * s->stride, width);
+        }
 
-    return *lbuf & 0x3FF;
-}
+        if (elements == 1) {
+            memcpy(p->data[0] + y * p->linesize[0], src, width * sizeof(*src));
+            continue;
+        }
+        for (int i = 0; i < elements; i++) {
+            const int plane = planes[elements - 1][i];
+            uint16_t *dst = (uint16_t *)(p->data[plane] + y * p->linesize[plane]);
 
-static uint16_t read12in32(const uint8_t **ptr, uint32_t *lbuf,
-                           int *n_datum, int is_big)
-{
-    if (*n_datum)
-        (*n_datum)--;
-    else {
-        *lbuf = read32(ptr, is_big);
-        *n_datum = 7;
+            for (int x = 0; x < avctx->width; x++)
+                dst[x] = src[x * elements + i];
+        }
     }
 
-    switch (*n_datum){
-    case 7: return *lbuf & 0xFFF;
-    case 6: return (*lbuf >> 12) & 0xFFF;
-    case 5: {
-            uint32_t c = *lbuf >> 24;
-            *lbuf = read32(ptr, is_big);
-            c |= *lbuf << 8;
-            return c & 0xFFF;
-            }
-    case 4: return (*lbuf >> 4) & 0xFFF;
-    case 3: return (*lbuf >> 16) & 0xFFF;
-    case 2: {
-            uint32_t c = *lbuf >> 28;
-            *lbuf = read32(ptr, is_big);
-            c |= *lbuf << 4;
-            return c & 0xFFF;
-            }
-    case 1: return (*lbuf >> 8) & 0xFFF;
-    default: return *lbuf >> 20;
-    }
+    return 0;
 }
 
 static int decode_frame(AVCodecContext *avctx, AVFrame *p,
                         int *got_frame, AVPacket *avpkt)
 {
+    DPXDecContext *s = avctx->priv_data;
     const uint8_t *buf = avpkt->data;
     int buf_size       = avpkt->size;
     uint8_t *ptr[AV_NUM_DATA_POINTERS];
@@ -166,9 +184,6 @@ static int decode_frame(AVCodecContext *avctx, AVFrame *p,
     int yuv, color_trc, color_spec;
     int encoding, need_align = 0, unpadded_10bit = 0;
 
-    unsigned int rgbBuffer = 0;
-    int n_datum = 0;
-
     if (avpkt->size <= 1634) {
         av_log(avctx, AV_LOG_ERROR, "Packet too small for DPX header\n");
         return AVERROR_INVALIDDATA;
@@ -636,72 +651,33 @@ static int decode_frame(AVCodecContext *avctx, AVFrame *p,
 
     switch (bits_per_color) {
     case 10:
-        for (x = 0; x < avctx->height; x++) {
-            uint16_t *dst[4] = {(uint16_t*)ptr[0],
-                                (uint16_t*)ptr[1],
-                                (uint16_t*)ptr[2],
-                                (uint16_t*)ptr[3]};
-            int shift = elements > 1 ? packing == 1 ? 22 : 20 : packing == 1 ? 2 : 0;
-            for (y = 0; y < avctx->width; y++) {
-                if (elements >= 3)
-                    *dst[2]++ = read10in32(&buf, &rgbBuffer,
-                                           &n_datum, endian, shift);
-                if (elements == 1)
-                    *dst[0]++ = read10in32_gray(&buf, &rgbBuffer,
-                                                &n_datum, endian, shift);
-                else
-                    *dst[0]++ = read10in32(&buf, &rgbBuffer,
-                                           &n_datum, endian, shift);
-                if (elements >= 2)
-                    *dst[1]++ = read10in32(&buf, &rgbBuffer,
-                                           &n_datum, endian, shift);
-                if (elements == 4)
-                    *dst[3]++ =
-                    read10in32(&buf, &rgbBuffer,
-                               &n_datum, endian, shift);
-            }
-            if (!unpadded_10bit)
-                n_datum = 0;
-            for (i = 0; i < elements; i++)
-                ptr[i] += p->linesize[i];
-        }
-        break;
     case 12:
-        for (x = 0; x < avctx->height; x++) {
-            uint16_t *dst[4] = {(uint16_t*)ptr[0],
-                                (uint16_t*)ptr[1],
-                                (uint16_t*)ptr[2],
-                                (uint16_t*)ptr[3]};
-            int shift = packing == 1 ? 4 : 0;
-            for (y = 0; y < avctx->width; y++) {
-                if (packing) {
-                    if (elements >= 3)
-                        *dst[2]++ = read16(&buf, endian) >> shift & 0xFFF;
-                    *dst[0]++ = read16(&buf, endian) >> shift & 0xFFF;
-                    if (elements >= 2)
-                        *dst[1]++ = read16(&buf, endian) >> shift & 0xFFF;
-                    if (elements == 4)
-                        *dst[3]++ = read16(&buf, endian) >> shift & 0xFFF;
-                } else {
-                    if (elements >= 3)
-                        *dst[2]++ = read12in32(&buf, &rgbBuffer,
-                                               &n_datum, endian);
-                    *dst[0]++ = read12in32(&buf, &rgbBuffer,
-                                           &n_datum, endian);
-                    if (elements >= 2)
-                        *dst[1]++ = read12in32(&buf, &rgbBuffer,
-                                               &n_datum, endian);
-                    if (elements == 4)
-                        *dst[3]++ = read12in32(&buf, &rgbBuffer,
-                                               &n_datum, endian);
-                }
-            }
-            n_datum = 0;
-            for (i = 0; i < elements; i++)
-                ptr[i] += p->linesize[i];
-            // Jump to next aligned position
-            buf += need_align;
+        s->data           = buf;
+        s->stride         = stride;
+        s->elements       = elements;
+        s->bits           = bits_per_color;
+        s->endian         = endian;
+        s->packing        = packing;
+        s->unpadded_10bit = unpadded_10bit;
+        if (elements == 1) {
+            s->shifts[0] = packing == 1 ? 2 : 0;
+            s->shifts[1] = s->shifts[0] + 10;
+            s->shifts[2] = s->shifts[0] + 20;
+        } else {
+            s->shifts[0] = packing == 1 ? 22 : 20;
+            s->shifts[1] = s->shifts[0] - 10;
+            s->shifts[2] = s->shifts[0] - 20;
         }
+
+        /* room for the samples before the row start and the SIMD overwrite */
+        s->unpack_linesize = FFALIGN(avctx->width * elements + 32, 16);
+        av_fast_malloc(&s->unpack_buf, &s->unpack_buf_size,
+                       (size_t)s->unpack_linesize * avctx->thread_count * sizeof(*s->unpack_buf));
+        if (!s->unpack_buf)
+            return AVERROR(ENOMEM);
+
+        s->nb_jobs = FFMIN(avctx->thread_count, avctx->height);
+        avctx->execute2(avctx, decode_slice, p, NULL, s->nb_jobs);
         break;
     case 32:
         if (elements == 1) {
@@ -764,11 +740,33 @@ static int decode_frame(AVCodecContext *avctx, AVFrame *p,
     return buf_size;
 }
 
+static av_cold int decode_init(AVCodecContext *avctx)
+{
+    DPXDecContext *s = avctx->priv_data;
+
+    ff_dpxdsp_init(&s->dsp);
+
+    return 0;
+}
+
+static av_cold int decode_end(AVCodecContext *avctx)
+{
+    DPXDecContext *s = avctx->priv_data;
+
+    av_freep(&s->unpack_buf);
+    s->unpack_buf_size = 0;
+
+    return 0;
+}
+
 const FFCodec ff_dpx_decoder = {
     .p.name         = "dpx",
     CODEC_LONG_NAME("DPX (Digital Picture Exchange) image"),
     .p.type         = AVMEDIA_TYPE_VIDEO,
     .p.id           = AV_CODEC_ID_DPX,
+    .priv_data_size = sizeof(DPXDecContext),
+    .init           = decode_init,
     FF_CODEC_DECODE_CB(decode_frame),
-    .p.capabilities = AV_CODEC_CAP_DR1,
+    .close          = decode_end,
+    .p.capabilities = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_SLICE_THREADS,
 };
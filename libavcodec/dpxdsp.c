@@ -0,0 +1,62 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/attributes.h"
+#include "libavutil/intreadwrite.h"
+#include "dpxdsp.h"
+
+#define UNPACK_FUNCS(suffix, RN32)                                          \
+static void unpack10_ ## suffix(uint16_t *dst, const uint8_t *src,         \
+                                int nb_words, const int shifts[3])          \
+{                                                                           \
+    const int s0 = shifts[0], s1 = shifts[1], s2 = shifts[2];               \
+                                                                            \
+    for (int i = 0; i < nb_words; i++) {                                    \
+        uint32_t w = RN32(src + 4 * i);                                     \
+        dst[3 * i    ] = w >> s0 & 0x3FF;                                   \
+        dst[3 * i + 1] = w >> s1 & 0x3FF;                                   \
+        dst[3 * i + 2] = w >> s2 & 0x3FF;                                   \
+    }                                                                       \
+}                                                                           \
+                                                                            \
+static void unpack12_ ## suffix(uint16_t *dst, const uint8_t *src,         \
+                                int nb_samples)                             \
+{                                                                           \
+    for (int i = 0; i < nb_samples; i += 8, src += 12, dst += 8) {          \
+        uint32_t w0 = RN32(src), w1 = RN32(src + 4), w2 = RN32(src + 8);    \
+        dst[0] =  w0        & 0xFFF;                                        \
+        dst[1] =  w0 >> 12  & 0xFFF;                                        \
+        dst[2] = (w0 >> 24 | w1 << 8) & 0xFFF;                              \
+        dst[3] =  w1 >> 4   & 0xFFF;                                        \
+        dst[4] =  w1 >> 16  & 0xFFF;                                        \
+        dst[5] = (w1 >> 28 | w2 << 4) & 0xFFF;                              \
+        dst[6] =  w2 >> 8   & 0xFFF;                                        \
+        dst[7] =  w2 >> 20;                                                 \
+    }                                                                       \
+}
+
+UNPACK_FUNCS(le, AV_RL32)
+UNPACK_FUNCS(be, AV_RB32)
+
+av_cold void ff_dpxdsp_init(DPXDSPContext *c)
+{
+    c->unpack10[0] = unpack10_le;
+    c->unpack10[1] = unpack10_be;
+    c->unpack12[0] = unpack12_le;
+    c->unpack12[1] = unpack12_be;
+}
@@ -0,0 +1,52 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVCODEC_DPXDSP_H
+#define AVCODEC_DPXDSP_H
+
+#include <stdint.h>
+
+typedef struct DPXDSPContext {
+    /**
+     * Unpack 32-bit words holding three 10-bit samples each. Sample i of
+     * a word is (word >> shifts[i]) & 0x3FF.
+     * Indexed by big endian.
+     *
+     * @param dst      3 * nb_words samples, written up to a multiple of 12
+     * @param src      words, read up to a multiple of 16 bytes
+     * @param nb_words number of words, at least 1
+     * @param shifts   in the range [0, 22]
+     */
+    void (*unpack10[2])(uint16_t *dst, const uint8_t *src, int nb_words,
+                        const int shifts[3]);
+
+    /**
+     * Unpack 12-bit samples stored from the least significant bits of
+     * consecutive 32-bit words, 8 samples in 3 words.
+     * Indexed by big endian.
+     *
+     * @param dst        samples, written up to a multiple of 8
+     * @param src        words, read up to a multiple of 12 bytes plus 4
+     * @param nb_samples number of samples, at least 1
+     */
+    void (*unpack12[2])(uint16_t *dst, const uint8_t *src, int nb_samples);
+} DPXDSPContext;
+
+void ff_dpxdsp_init(DPXDSPContext *c);
+
+#endif /* AVCODEC_DPXDSP_H */
@@ -20,6 +20,7 @@
 
 #include "config.h"
 
+#include <stdatomic.h>
 #include <stdbool.h>
 
 #include "libavutil/mem.h"
@@ -51,8 +52,19 @@ typedef struct ThreadInfo {
 typedef struct Queue {
     FFTask *head;
     FFTask *tail;
+    // number of queued tasks, readable without holding the lock
+    atomic_int nb_tasks;
 } Queue;
 
+// Tasks are spread over one set of priority queues per worker, each set with
+// its own lock. A worker serves its own queues first and steals from the other
+// workers' queues when they are empty, so workers only contend on a lock when
+// they happen to pick the same queue.
+typedef struct WorkerQueues {
+    AVMutex lock;
+    Queue *q;
+} WorkerQueues;
+
 struct FFExecutor {
     FFTaskCallbacks cb;
     int thread_count;
@@ -61,11 +73,18 @@ struct FFExecutor {
     ThreadInfo *threads;
     uint8_t *local_contexts;
 
+    WorkerQueues *wq;
+    int nb_wq;
+    atomic_uint next_wq;
+
+    // total number of queued tasks
+    atomic_int nb_pending;
+
+    // only used for putting idle workers to sleep and waking them up
     AVMutex lock;
     AVCond cond;
-    int die;
-
-    Queue *q;
+    atomic_int nb_sleeping;
+    atomic_int die;
 };
 
 static FFTask* remove_task(Queue *q)
@@ -76,6 +95,7 @@ static FFTask* remove_task(Queue *q)
         t->next = NULL;
         if (!q->head)
             q->tail = NULL;
+        atomic_fetch_sub_explicit(&q->nb_tasks, 1, memory_order_relaxed);
     }
     return t;
 }
@@ -87,22 +107,42 @@ static void add_task(Queue *q, FFTask *t)
         q->tail = q->head = t;
     else
         q->tail = q->tail->next = t;
+    atomic_fetch_add_explicit(&q->nb_tasks, 1, memory_order_relaxed);
 }
 
-static int run_one_task(FFExecutor *e, void *lc)
+static FFTask *get_task(FFExecutor *e, int self)
 {
-    FFTaskCallbacks *cb = &e->cb;
-    FFTask *t = NULL;
+    for (int p = 0; p < e->cb.priorities; p++) {
+        for (int i = 0; i < e->nb_wq; i++) {
+            WorkerQueues *wq = e->wq + (self + i) % e->nb_wq;
+            Queue *q = wq->q + p;
+            FFTask *t;
+
+            if (!atomic_load_explicit(&q->nb_tasks, memory_order_relaxed))
+                continue;
+
+            if (e->thread_count)
+                ff_mutex_lock(&wq->lock);
+            t = remove_task(q);
+            if (e->thread_count)
+                ff_mutex_unlock(&wq->lock);
+
+            if (t) {
+                atomic_fetch_sub(&e->nb_pending, 1);
+                return t;
+            }
+        }
+    }
+    return NULL;
+}
 
-    for (int i = 0; i < e->cb.priorities && !t; i++)
-        t = remove_task(e->q + i);
+static int run_one_task(FFExecutor *e, void *lc, int self)
+{
+    FFTaskCallbacks *cb = &e->cb;
+    FFTask *t = get_task(e, self);
 
     if (t) {
-        if (e->thread_count > 0)
-            ff_mutex_unlock(&e->lock);
         cb->run(t, lc, cb->user_data);
-        if (e->thread_count > 0)
-            ff_mutex_lock(&e->lock);
         return 1;
     }
     return 0;
@@ -113,18 +153,21 @@ static void *executor_worker_task(void *data)
 {
     ThreadInfo *ti = (ThreadInfo*)data;
     FFExecutor *e  = ti->e;
-    void *lc       = e->local_contexts + (ti - e->threads) * e->cb.local_context_size;
+    const int self = ti - e->threads;
+    void *lc       = e->local_contexts + self * e->cb.local_context_size;
 
-    ff_mutex_lock(&e->lock);
-    while (1) {
-        if (e->die) break;
+    while (!atomic_load(&e->die)) {
+        if (run_one_task(e, lc, self))
+            continue;
 
-        if (!run_one_task(e, lc)) {
-            //no task in one loop
+        //no task in one loop
+        ff_mutex_lock(&e->lock);
+        atomic_fetch_add(&e->nb_sleeping, 1);
+        while (!atomic_load(&e->die) && !atomic_load(&e->nb_pending))
             ff_cond_wait(&e->cond, &e->lock);
-        }
+        atomic_fetch_sub(&e->nb_sleeping, 1);
+        ff_mutex_unlock(&e->lock);
     }
-    ff_mutex_unlock(&e->lock);
     return NULL;
 }
 #endif
@@ -134,7 +177,7 @@ static void executor_free(FFExecutor *e, const int has_lock, const int has_cond)
     if (e->thread_count) {
         //signal die
         ff_mutex_lock(&e->lock);
-        e->die = 1;
+        atomic_store(&e->die, 1);
         ff_cond_broadcast(&e->cond);
         ff_mutex_unlock(&e->lock);
 
@@ -143,11 +186,18 @@ static void executor_free(FFExecutor *e, const int has_lock, const int has_cond)
     }
     if (has_cond)
         ff_cond_destroy(&e->cond);
-    if (has_lock)
+    if (has_lock) {
         ff_mutex_destroy(&e->lock);
+        for (int i = 0; i < e->nb_wq; i++)
+            ff_mutex_destroy(&e->wq[i].lock);
+    }
 
     av_free(e->threads);
-    av_free(e->q);
+    if (e->wq) {
+        for (int i = 0; i < e->nb_wq; i++)
+            av_free(e->wq[i].q);
+        av_free(e->wq);
+    }
     av_free(e->local_contexts);
 
     av_free(e);
@@ -169,10 +219,16 @@ FFExecutor* ff_executor_alloc(const FFTaskCallbacks *cb, int thread_count)
     if (!e->local_contexts)
         goto free_executor;
 
-    e->q = av_calloc(e->cb.priorities, sizeof(Queue));
-    if (!e->q)
+    e->wq = av_calloc(FFMAX(thread_count, 1), sizeof(*e->wq));
+    if (!e->wq)
         goto free_executor;
 
+    for (/* nothing */; e->nb_wq < FFMAX(thread_count, 1); e->nb_wq++) {
+        e->wq[e->nb_wq].q = av_calloc(e->cb.priorities, sizeof(Queue));
+        if (!e->wq[e->nb_wq].q)
+            goto free_executor;
+    }
+
     e->threads = av_calloc(FFMAX(thread_count, 1), sizeof(*e->threads));
     if (!e->threads)
         goto free_executor;
@@ -181,6 +237,14 @@ FFExecutor* ff_executor_alloc(const FFTaskCallbacks *cb, int thread_count)
         return e;
 
     has_lock = !ff_mutex_init(&e->lock, NULL);
+    for (int i = 0; i < e->nb_wq && has_lock; i++) {
+        if (ff_mutex_init(&e->wq[i].lock, NULL)) {
+            while (i--)
+                ff_mutex_destroy(&e->wq[i].lock);
+            ff_mutex_destroy(&e->lock);
+            has_lock = 0;
+        }
+    }
     has_cond = !ff_cond_init(&e->cond, NULL);
 
     if (!has_lock || !has_cond)
@@ -212,13 +276,28 @@ void ff_executor_free(FFExecutor **executor)
 
 void ff_executor_execute(FFExecutor *e, FFTask *t)
 {
-    if (e->thread_count)
-        ff_mutex_lock(&e->lock);
-    if (t)
-        add_task(e->q + t->priority % e->cb.priorities, t);
+    if (t) {
+        WorkerQueues *wq = e->wq;
+
+        if (e->thread_count) {
+            wq += atomic_fetch_add_explicit(&e->next_wq, 1, memory_order_relaxed) % e->nb_wq;
+            ff_mutex_lock(&wq->lock);
+        }
+        add_task(wq->q + t->priority % e->cb.priorities, t);
+        if (e->thread_count)
+            ff_mutex_unlock(&wq->lock);
+
+        atomic_fetch_add(&e->nb_pending, 1);
+    }
+
     if (e->thread_count) {
-        ff_cond_signal(&e->cond);
-        ff_mutex_unlock(&e->lock);
+        // a worker going to sleep increments nb_sleeping before checking
+        // nb_pending, so a task queued above is never missed by both sides
+        if (atomic_load(&e->nb_sleeping)) {
+            ff_mutex_lock(&e->lock);
+            ff_cond_signal(&e->cond);
+            ff_mutex_unlock(&e->lock);
+        }
     }
 
     if (!e->thread_count || !HAVE_THREADS) {
@@ -226,7 +305,7 @@ void ff_executor_execute(FFExecutor *e, FFTask *t)
             return;
         e->recursive = true;
         // We are running in a single-threaded environment, so we must handle all tasks ourselves
-        while (run_one_task(e, e->local_contexts))
+        while (run_one_task(e, e->local_contexts, 0))
             /* nothing */;
         e->recursive = false;
     }
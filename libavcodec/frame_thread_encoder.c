@@ -35,11 +35,14 @@
 #include "pthread_internal.h"
 
 #define MAX_THREADS 64
-/* There can be as many as MAX_THREADS + 1 outstanding tasks.
+/* The queue depth starts at thread_count and may grow up to twice that
+ * when a slow frame holds back the output of already finished ones, so
+ * there can be as many as 2 * MAX_THREADS + 1 outstanding tasks.
  * An additional + 1 is needed so that one can distinguish
- * the case of zero and MAX_THREADS + 1 outstanding tasks modulo
+ * the case of zero and 2 * MAX_THREADS + 1 outstanding tasks modulo
  * the number of buffers. */
-#define BUFFER_SIZE (MAX_THREADS + 2)
+#define MAX_DEPTH(threads) (2 * (threads))
+#define BUFFER_SIZE (MAX_DEPTH(MAX_THREADS) + 2)
 
 typedef struct{
     AVFrame  *indata;
@@ -65,6 +68,13 @@ typedef struct{
     unsigned task_index;
     unsigned finished_task_index;
 
+    /* Number of outstanding tasks after which the main thread waits for
+     * the oldest one; only accessed by the main thread. */
+    unsigned depth;
+    /* Statistics about the oldest task holding back finished ones */
+    unsigned hol_stalls;
+    uint64_t hol_idle_tasks;
+
     pthread_t worker[MAX_THREADS];
     atomic_int exit;
 } ThreadContext;
@@ -187,7 +197,8 @@ av_cold int ff_frame_thread_encoder_init(AVCodecContext *avctx)
         goto fail;
     atomic_init(&c->exit, 0);
 
-    c->max_tasks = avctx->thread_count + 2;
+    c->depth     = avctx->thread_count;
+    c->max_tasks = MAX_DEPTH(avctx->thread_count) + 2;
     for (unsigned j = 0; j < c->max_tasks; j++) {
         if (!(c->tasks[j].indata  = av_frame_alloc()) ||
             !(c->tasks[j].outdata = av_packet_alloc())) {
@@ -287,6 +298,12 @@ av_cold void ff_frame_thread_encoder_free(AVCodecContext *avctx)
 
         for (int i = 0; i < avctx->thread_count; i++)
             pthread_join(c->worker[i], NULL);
+
+        if (c->hol_stalls)
+            av_log(avctx, AV_LOG_VERBOSE, "Frame threads: %u head-of-line "
+                   "stalls with %"PRIu64" finished frames waiting, queue "
+                   "depth grown from %d to %u.\n", c->hol_stalls,
+                   c->hol_idle_tasks, avctx->thread_count, c->depth);
     }
 
     for (unsigned i = 0; i < c->max_tasks; i++) {
@@ -321,10 +338,30 @@ int ff_thread_video_encode_frame(AVCodecContext *avctx, AVPacket *pkt,
      * because it is only ever changed by the main thread. */
     if (c->task_index == c->finished_task_index ||
         (frame && !outtask->finished &&
-         (c->task_index - c->finished_task_index + c->max_tasks) % c->max_tasks <= avctx->thread_count)) {
+         (c->task_index - c->finished_task_index + c->max_tasks) % c->max_tasks <= c->depth)) {
             pthread_mutex_unlock(&c->finished_task_mutex);
             return 0;
         }
+    if (frame && !outtask->finished) {
+        /* The oldest task is still running. If younger ones have already
+         * finished, their threads are idle only because the output has to
+         * be in order; let more frames in rather than waiting. */
+        unsigned idle = 0;
+
+        for (unsigned i = (c->finished_task_index + 1) % c->max_tasks;
+             i != c->task_index; i = (i + 1) % c->max_tasks)
+            idle += c->tasks[i].finished;
+
+        if (idle) {
+            c->hol_stalls++;
+            c->hol_idle_tasks += idle;
+            if (c->depth < MAX_DEPTH(avctx->thread_count)) {
+                c->depth++;
+                pthread_mutex_unlock(&c->finished_task_mutex);
+                return 0;
+            }
+        }
+    }
     while (!outtask->finished) {
         pthread_cond_wait(&c->finished_task_cond, &c->finished_task_mutex);
     }
@@ -113,6 +113,14 @@ void ff_h264_draw_horiz_band(const H264Context *h, H264SliceContext *sl,
     if (!avctx->draw_horiz_band)
         return;
 
+    /* Rows are only reported while the frame is decoded on the caller's
+     * thread, and only in output order unless the caller opted into
+     * coded order. */
+    if (avctx->active_thread_type)
+        return;
+    if (avctx->has_b_frames && !(avctx->slice_flags & SLICE_FLAG_CODED_ORDER))
+        return;
+
     if (field_pic && h->first_field && !(avctx->slice_flags & SLICE_FLAG_ALLOW_FIELD))
         return;
 
@@ -1129,7 +1137,7 @@ const FFCodec ff_h264_decoder = {
     .init                  = h264_decode_init,
     .close                 = h264_decode_end,
     FF_CODEC_DECODE_CB(h264_decode_frame),
-    .p.capabilities        = AV_CODEC_CAP_DR1 |
+    .p.capabilities        = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_DRAW_HORIZ_BAND |
                              AV_CODEC_CAP_DELAY | AV_CODEC_CAP_SLICE_THREADS |
                              AV_CODEC_CAP_FRAME_THREADS,
     .hw_configs            = (const AVCodecHWConfigInternal *const []) {
@@ -88,46 +88,66 @@ static void hap_write_section_header(PutByteContext *pbc,
     }
 }
 
+static int compress_chunks_thread(AVCodecContext *avctx, void *arg,
+                                  int chunk_nb, int thread_nb)
+{
+    HapContext *ctx = avctx->priv_data;
+    HapChunk *chunk = &ctx->chunks[chunk_nb];
+    uint8_t *dst = arg;
+    uint8_t *chunk_src, *chunk_dst;
+    int ret;
+
+    chunk->uncompressed_size = ctx->tex_size / ctx->chunk_count;
+    chunk->uncompressed_offset = chunk_nb * chunk->uncompressed_size;
+    chunk->compressed_size = ctx->max_snappy;
+    chunk_src = ctx->tex_buf + chunk->uncompressed_offset;
+    /* Every chunk gets its own worst-case slot, packed afterwards. */
+    chunk_dst = dst + chunk_nb * ctx->max_snappy;
+
+    /* Compress with snappy too, write directly on packet buffer. */
+    ret = snappy_compress(chunk_src, chunk->uncompressed_size,
+                          chunk_dst, &chunk->compressed_size);
+    if (ret != SNAPPY_OK) {
+        av_log(avctx, AV_LOG_ERROR, "Snappy compress error.\n");
+        return AVERROR_BUG;
+    }
+
+    /* If there is no gain from snappy, just use the raw texture. */
+    if (chunk->compressed_size >= chunk->uncompressed_size) {
+        av_log(avctx, AV_LOG_VERBOSE,
+               "Snappy buffer bigger than uncompressed (%"SIZE_SPECIFIER" >= %"SIZE_SPECIFIER" bytes).\n",
+               chunk->compressed_size, chunk->uncompressed_size);
+        memcpy(chunk_dst, chunk_src, chunk->uncompressed_size);
+        chunk->compressor = HAP_COMP_NONE;
+        chunk->compressed_size = chunk->uncompressed_size;
+    } else {
+        chunk->compressor = HAP_COMP_SNAPPY;
+    }
+
+    return 0;
+}
+
 static int hap_compress_frame(AVCodecContext *avctx, uint8_t *dst)
 {
     HapContext *ctx = avctx->priv_data;
     int i, final_size = 0;
 
+    avctx->execute2(avctx, compress_chunks_thread, dst,
+                    ctx->chunk_results, ctx->chunk_count);
+
     for (i = 0; i < ctx->chunk_count; i++) {
         HapChunk *chunk = &ctx->chunks[i];
-        uint8_t *chunk_src, *chunk_dst;
-        int ret;
+
+        if (ctx->chunk_results[i] < 0)
+            return ctx->chunk_results[i];
 
         if (i == 0) {
             chunk->compressed_offset = 0;
         } else {
             chunk->compressed_offset = ctx->chunks[i-1].compressed_offset
                                        + ctx->chunks[i-1].compressed_size;
-        }
-        chunk->uncompressed_size = ctx->tex_size / ctx->chunk_count;
-        chunk->uncompressed_offset = i * chunk->uncompressed_size;
-        chunk->compressed_size = ctx->max_snappy;
-        chunk_src = ctx->tex_buf + chunk->uncompressed_offset;
-        chunk_dst = dst + chunk->compressed_offset;
-
-        /* Compress with snappy too, write directly on packet buffer. */
-        ret = snappy_compress(chunk_src, chunk->uncompressed_size,
-                              chunk_dst, &chunk->compressed_size);
-        if (ret != SNAPPY_OK) {
-            av_log(avctx, AV_LOG_ERROR, "Snappy compress error.\n");
-            return AVERROR_BUG;
-        }
-
-        /* If there is no gain from snappy, just use the raw texture. */
-        if (chunk->compressed_size >= chunk->uncompressed_size) {
-            av_log(avctx, AV_LOG_VERBOSE,
-                   "Snappy buffer bigger than uncompressed (%"SIZE_SPECIFIER" >= %"SIZE_SPECIFIER" bytes).\n",
-                   chunk->compressed_size, chunk->uncompressed_size);
-            memcpy(chunk_dst, chunk_src, chunk->uncompressed_size);
-            chunk->compressor = HAP_COMP_NONE;
-            chunk->compressed_size = chunk->uncompressed_size;
-        } else {
-            chunk->compressor = HAP_COMP_SNAPPY;
+            memmove(dst + chunk->compressed_offset, dst + i * ctx->max_snappy,
+                    chunk->compressed_size);
         }
 
         final_size += chunk->compressed_size;
@@ -2681,7 +2681,7 @@ static void hls_decode_neighbour(HEVCLocalContext *lc,
     lc->ctb_up_left_flag = ((x_ctb > 0) && (y_ctb > 0)  && (ctb_addr_in_slice-1 >= sps->ctb_width) && (pps->tile_id[ctb_addr_ts] == pps->tile_id[pps->ctb_addr_rs_to_ts[ctb_addr_rs-1 - sps->ctb_width]]));
 }
 
-static int hls_decode_entry(HEVCContext *s, GetBitContext *gb)
+static int hls_decode_entry(HEVCContext *s, const GetBitContext *gb, int pipelined)
 {
     HEVCLocalContext *const lc = &s->local_ctx[0];
     const HEVCLayerContext *const l = &s->layers[s->cur_layer];
@@ -2725,10 +2725,14 @@ static int hls_decode_entry(HEVCContext *s, GetBitContext *gb)
 
         ctb_addr_ts++;
         ff_hevc_save_states(lc, pps, ctb_addr_ts);
-        ff_hevc_hls_filters(lc, l, pps, x_ctb, y_ctb, ctb_size);
+        if (pipelined)
+            ff_thread_progress_report(&s->wpp_progress[0], ctb_addr_ts);
+        else
+            ff_hevc_hls_filters(lc, l, pps, x_ctb, y_ctb, ctb_size);
     }
 
-    if (x_ctb + ctb_size >= sps->width &&
+    if (!pipelined &&
+        x_ctb + ctb_size >= sps->width &&
         y_ctb + ctb_size >= sps->height)
         ff_hevc_hls_filter(lc, l, pps, x_ctb, y_ctb, ctb_size);
 
@@ -2856,27 +2860,10 @@ static int wpp_progress_init(HEVCContext *s, unsigned count)
     return 0;
 }
 
-static int hls_slice_data_wpp(HEVCContext *s, const H2645NAL *nal)
+static int local_ctx_alloc(HEVCContext *s, unsigned count)
 {
-    const HEVCPPS *const pps = s->pps;
-    const HEVCSPS *const sps = pps->sps;
-    const uint8_t *data = nal->data;
-    int length          = nal->size;
-    int *ret;
-    int64_t offset;
-    int64_t startheader, cmpt = 0;
-    int i, j, res = 0;
-
-    if (s->sh.slice_ctb_addr_rs + s->sh.num_entry_point_offsets * sps->ctb_width >= sps->ctb_width * sps->ctb_height) {
-        av_log(s->avctx, AV_LOG_ERROR, "WPP ctb addresses are wrong (%d %d %d %d)\n",
-            s->sh.slice_ctb_addr_rs, s->sh.num_entry_point_offsets,
-            sps->ctb_width, sps->ctb_height
-        );
-        return AVERROR_INVALIDDATA;
-    }
-
-    if (s->avctx->thread_count > s->nb_local_ctx) {
-        HEVCLocalContext *tmp = av_malloc_array(s->avctx->thread_count, sizeof(*s->local_ctx));
+    if (count > s->nb_local_ctx) {
+        HEVCLocalContext *tmp = av_malloc_array(count, sizeof(*s->local_ctx));
 
         if (!tmp)
             return AVERROR(ENOMEM);
@@ -2885,7 +2872,7 @@ static int hls_slice_data_wpp(HEVCContext *s, const H2645NAL *nal)
         av_free(s->local_ctx);
         s->local_ctx = tmp;
 
-        for (unsigned i = s->nb_local_ctx; i < s->avctx->thread_count; i++) {
+        for (unsigned i = s->nb_local_ctx; i < count; i++) {
             tmp = &s->local_ctx[i];
 
             memset(tmp, 0, sizeof(*tmp));
@@ -2895,9 +2882,35 @@ static int hls_slice_data_wpp(HEVCContext *s, const H2645NAL *nal)
             tmp->common_cabac_state = &s->cabac;
         }
 
-        s->nb_local_ctx = s->avctx->thread_count;
+        s->nb_local_ctx = count;
+    }
+
+    return 0;
+}
+
+static int hls_slice_data_wpp(HEVCContext *s, const H2645NAL *nal)
+{
+    const HEVCPPS *const pps = s->pps;
+    const HEVCSPS *const sps = pps->sps;
+    const uint8_t *data = nal->data;
+    int length          = nal->size;
+    int *ret;
+    int64_t offset;
+    int64_t startheader, cmpt = 0;
+    int i, j, res = 0;
+
+    if (s->sh.slice_ctb_addr_rs + s->sh.num_entry_point_offsets * sps->ctb_width >= sps->ctb_width * sps->ctb_height) {
+        av_log(s->avctx, AV_LOG_ERROR, "WPP ctb addresses are wrong (%d %d %d %d)\n",
+            s->sh.slice_ctb_addr_rs, s->sh.num_entry_point_offsets,
+            sps->ctb_width, sps->ctb_height
+        );
+        return AVERROR_INVALIDDATA;
     }
 
+    res = local_ctx_alloc(s, s->avctx->thread_count);
+    if (res < 0)
+        return res;
+
     offset = s->sh.data_offset;
 
     for (j = 0, cmpt = 0, startheader = offset + s->sh.entry_point_offset[0]; j < nal->skipped_bytes; j++) {
@@ -2958,6 +2971,92 @@ static int hls_slice_data_wpp(HEVCContext *s, const H2645NAL *nal)
     return res;
 }
 
+/*
+ * Slices without entry points have to be parsed serially, but the in-loop
+ * filters of a CTB only depend on the CTBs decoded up to its bottom right
+ * neighbour and on the filtering of the row above being two CTBs ahead,
+ * the same lag the decoder applies to WPP rows. Job 0 reconstructs the
+ * slice and reports the number of decoded CTBs in wpp_progress[0], each
+ * further job runs ff_hevc_hls_filter() over one CTB row, reporting its
+ * progress in wpp_progress[job]. The filters are thus applied to the same
+ * CTBs, in an order equivalent to the one of hls_decode_entry().
+ */
+static int hls_decode_entry_rows(AVCodecContext *avctx, void *arg,
+                                 int job, int thread)
+{
+    HEVCContext *const s = arg;
+    HEVCLocalContext *const lc = &s->local_ctx[1 + thread];
+    const HEVCLayerContext *const l = &s->layers[s->cur_layer];
+    const HEVCPPS   *const pps = s->pps;
+    const HEVCSPS   *const sps = pps->sps;
+    int ctb_size  = 1 << sps->log2_ctb_size;
+    int start     = s->sh.slice_ctb_addr_rs;
+    int first_row = FFMAX(start / sps->ctb_width - 1, 0);
+    int y_ctb     = first_row + job - 1;
+
+    if (!job) {
+        int ret = hls_decode_entry(s, s->rows_gb, 1);
+
+        /* only this job reports progress in wpp_progress[0] */
+        atomic_store(&s->rows_end,
+                     FFMAX(atomic_load(&s->wpp_progress[0].progress), 0));
+        ff_thread_progress_report(&s->wpp_progress[0], INT_MAX);
+        return ret;
+    }
+
+    for (int x_ctb = 0; x_ctb < sps->ctb_width; x_ctb++) {
+        /* the CTB whose decoding triggers the filtering in hls_decode_entry() */
+        int ctb_addr_rs = FFMIN(y_ctb + 1, sps->ctb_height - 1) * sps->ctb_width +
+                          FFMIN(x_ctb + 1, sps->ctb_width  - 1);
+
+        if (ctb_addr_rs >= start) {
+            ff_thread_progress_await(&s->wpp_progress[0], ctb_addr_rs + 1);
+            if (ctb_addr_rs >= atomic_load(&s->rows_end))
+                break;
+            if (job > 1)
+                ff_thread_progress_await(&s->wpp_progress[job - 1],
+                                         FFMIN(x_ctb + 2, sps->ctb_width));
+
+            ff_hevc_hls_filter(lc, l, pps, x_ctb << sps->log2_ctb_size,
+                               y_ctb << sps->log2_ctb_size, ctb_size);
+        }
+        ff_thread_progress_report(&s->wpp_progress[job], x_ctb + 1);
+    }
+    ff_thread_progress_report(&s->wpp_progress[job], INT_MAX);
+
+    return 0;
+}
+
+static int hls_slice_data_rows(HEVCContext *s, const GetBitContext *gb)
+{
+    const HEVCSPS *const sps = s->pps->sps;
+    int first_row = FFMAX(s->sh.slice_ctb_addr_rs / sps->ctb_width - 1, 0);
+    int nb_jobs   = 1 + sps->ctb_height - first_row;
+    int *ret, res;
+
+    /* local_ctx[0] carries the slice state, the filter jobs use the others */
+    res = local_ctx_alloc(s, s->avctx->thread_count + 1);
+    if (res < 0)
+        return res;
+
+    res = wpp_progress_init(s, nb_jobs);
+    if (res < 0)
+        return res;
+
+    ret = av_calloc(nb_jobs, sizeof(*ret));
+    if (!ret)
+        return AVERROR(ENOMEM);
+
+    s->rows_gb = gb;
+    atomic_store(&s->rows_end, INT_MAX);
+
+    s->avctx->execute2(s->avctx, hls_decode_entry_rows, s, ret, nb_jobs);
+
+    res = ret[0];
+    av_free(ret);
+    return res;
+}
+
 static int decode_slice_data(HEVCContext *s, const HEVCLayerContext *l,
                              const H2645NAL *nal, GetBitContext *gb)
 {
@@ -3009,7 +3108,12 @@ static int decode_slice_data(HEVCContext *s, const HEVCLayerContext *l,
         pps->num_tile_rows == 1 && pps->num_tile_columns == 1)
         return hls_slice_data_wpp(s, nal);
 
-    return hls_decode_entry(s, gb);
+    if (s->avctx->active_thread_type == FF_THREAD_SLICE  &&
+        s->avctx->thread_count > 1                       &&
+        pps->num_tile_rows == 1 && pps->num_tile_columns == 1)
+        return hls_slice_data_rows(s, gb);
+
+    return hls_decode_entry(s, gb, 0);
 }
 
 static int set_side_data(HEVCContext *s)
@@ -4022,6 +4126,7 @@ static av_cold int hevc_decode_init(AVCodecContext *avctx)
     s->eos = 1;
 
     atomic_init(&s->wpp_err, 0);
+    atomic_init(&s->rows_end, INT_MAX);
 
     if (!avctx->internal->is_copy) {
         const AVPacketSideData *sd;
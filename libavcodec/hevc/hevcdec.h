@@ -545,6 +545,10 @@ typedef struct HEVCContext {
 
     atomic_int wpp_err;
 
+    /** CTB row pipelining of the in-loop filters, see hls_decode_entry_rows() */
+    const GetBitContext *rows_gb;
+    atomic_int rows_end;        ///< number of reconstructed CTBs, in raster order
+
     const uint8_t *data;
 
     H2645Packet pkt;
@@ -614,8 +614,10 @@ start:
         if (!av_fifo_can_read(ctx->encode_fifo))
             return err;
 
-        // More frames can be buffered
-        if (av_fifo_can_write(ctx->encode_fifo) && !ctx->end_of_stream)
+        // More frames can be buffered, unless the caller asked for each
+        // packet as soon as its picture has been issued.
+        if (av_fifo_can_write(ctx->encode_fifo) && !ctx->end_of_stream &&
+            !(avctx->flags & AV_CODEC_FLAG_LOW_DELAY))
             return AVERROR(EAGAIN);
 
         av_fifo_read(ctx->encode_fifo, &pic, 1);
@@ -670,7 +672,11 @@ int ff_hw_base_init_gop_structure(FFHWBaseEncodeContext *ctx, AVCodecContext *av
                "reference frames.\n");
         return AVERROR(EINVAL);
     } else if (!(flags & FF_HW_FLAG_B_PICTURES) || ref_l1 < 1 ||
-               avctx->max_b_frames < 1 || prediction_pre_only) {
+               avctx->max_b_frames < 1 || prediction_pre_only ||
+               (avctx->flags & AV_CODEC_FLAG_LOW_DELAY)) {
+        if (avctx->max_b_frames > 0 && (avctx->flags & AV_CODEC_FLAG_LOW_DELAY))
+            av_log(avctx, AV_LOG_VERBOSE, "B-frames disabled in low-delay "
+                   "mode.\n");
         if (ctx->p_to_gpb)
            av_log(avctx, AV_LOG_VERBOSE, "Using intra and B-frames "
                   "(supported references: %d / %d).\n",
@@ -70,6 +70,7 @@
 #include "encode.h"
 #include "bytestream.h"
 #include "jpeg2000.h"
+#include "jpeg2000htenc.h"
 #include "version.h"
 #include "libavutil/common.h"
 #include "libavutil/mem.h"
@@ -109,6 +110,19 @@ typedef struct {
    double *layer_rates;
 } Jpeg2000Tile;
 
+/**
+ * A codeblock to be coded by tier-1, with its position in the
+ * tile-component coefficients.
+ */
+typedef struct {
+    Jpeg2000Tile *tile;
+    Jpeg2000Component *comp;
+    Jpeg2000Band *band;
+    Jpeg2000Cblk *cblk;
+    int x0, x1, y0, y1;
+    int bandpos, lev;
+} Jpeg2000CblkJob;
+
 typedef struct {
     AVClass *class;
     AVCodecContext *avctx;
@@ -134,6 +148,12 @@ typedef struct {
     Jpeg2000QuantStyle  qntsty;
 
     Jpeg2000Tile *tile;
+    Jpeg2000CblkJob *cblk_jobs;
+    int nb_cblk_jobs;
+    Jpeg2000T1Context *t1; ///< tier-1 contexts, one per thread
+    Jpeg2000HTEncContext *ht_t1; ///< HT block coder contexts, one per thread
+    int *dwt_ret;
+    int *cblk_ret;
     int layer_rates[100];
     uint8_t compression_rate_enc; ///< Is compression done using compression ratio?
 
@@ -144,6 +164,7 @@ typedef struct {
     int prog;
     int nlayers;
     char *lr_str;
+    int ht;
 } Jpeg2000EncoderContext;
 
 
@@ -307,7 +328,7 @@ static int put_siz(Jpeg2000EncoderContext *s)
 
     bytestream_put_be16(&s->buf, JPEG2000_SIZ);
     bytestream_put_be16(&s->buf, 38 + 3 * s->ncomponents); // Lsiz
-    bytestream_put_be16(&s->buf, 0); // Rsiz
+    bytestream_put_be16(&s->buf, s->ht ? 1 << 14 : 0); // Rsiz
     bytestream_put_be32(&s->buf, s->width); // width
     bytestream_put_be32(&s->buf, s->height); // height
     bytestream_put_be32(&s->buf, 0); // X0Siz
@@ -327,6 +348,39 @@ static int put_siz(Jpeg2000EncoderContext *s)
     return 0;
 }
 
+/**
+ * magnitude bitplanes used by the HT block coder, Rec. ITU-T T.814, A.3
+ */
+static int ht_magb(Jpeg2000EncoderContext *s)
+{
+    int i, magb = 0;
+
+    for (i = 0; i < s->codsty.nreslevels * 3 - 2; i++)
+        magb = FFMAX(magb, s->qntsty.expn[i] + s->qntsty.nguardbits - 1);
+    return magb;
+}
+
+static int put_cap(Jpeg2000EncoderContext *s)
+{
+    int magb = ht_magb(s), ccap15;
+
+    if (s->buf_end - s->buf < 10)
+        return -1;
+
+    // HT only, single HT set, no ROI, homogeneous codestream
+    ccap15 = s->codsty.transform == FF_DWT53 ? 0 : 1 << 5;
+    if (magb > 27)
+        ccap15 |= (magb - 27 + 3) / 4 + 19;
+    else if (magb > 8)
+        ccap15 |= magb - 8;
+
+    bytestream_put_be16(&s->buf, JPEG2000_CAP);
+    bytestream_put_be16(&s->buf, 8); // Lcap
+    bytestream_put_be32(&s->buf, 1 << (31 - 14)); // Pcap, Part 15
+    bytestream_put_be16(&s->buf, ccap15);
+    return 0;
+}
+
 static int put_cod(Jpeg2000EncoderContext *s)
 {
     Jpeg2000CodingStyle *codsty = &s->codsty;
@@ -354,7 +408,7 @@ static int put_cod(Jpeg2000EncoderContext *s)
     bytestream_put_byte(&s->buf, codsty->nreslevels - 1); // num of decomp. levels
     bytestream_put_byte(&s->buf, codsty->log2_cblk_width-2); // cblk width
     bytestream_put_byte(&s->buf, codsty->log2_cblk_height-2); // cblk height
-    bytestream_put_byte(&s->buf, 0); // cblk style
+    bytestream_put_byte(&s->buf, s->ht ? JPEG2000_CTSY_HTJ2K_F : 0); // cblk style
     bytestream_put_byte(&s->buf, codsty->transform == FF_DWT53); // transformation
     return 0;
 }
@@ -596,6 +650,7 @@ static void init_luts(void)
                                     << 1, 0);
     }
     ff_jpeg2000_init_tier1_luts();
+    ff_jpeg2000_ht_init_enc_tables();
 }
 
 /* tier-1 routines */
@@ -764,6 +819,93 @@ static void encode_cblk(Jpeg2000EncoderContext *s, Jpeg2000T1Context *t1, Jpeg20
     }
 }
 
+/**
+ * rate-distortion slope threshold of the codeblocks of a band
+ */
+static int64_t band_lambda(Jpeg2000EncoderContext *s, const Jpeg2000Band *band, int bandpos, int lev)
+{
+    int64_t dwt_norm = dwt_norms[s->codsty.transform == FF_DWT53][bandpos][lev] * (int64_t)band->i_stepsize >> 15;
+
+    return av_rescale(s->lambda, 1 << WMSEDEC_SHIFT, dwt_norm * dwt_norm);
+}
+
+/**
+ * distortion reduction, in the units of encode_cblk(), of reconstructing
+ * the samples from their bits above bitplane bpno
+ */
+static int64_t ht_disto(Jpeg2000T1Context *t1, int width, int height, int bpno)
+{
+    int shift = bpno + NMSEDEC_FRACBITS, x, y;
+    int64_t disto = 0;
+
+    for (y = 0; y < height; y++) {
+        for (x = 0; x < width; x++) {
+            int64_t a = FFABS(t1->data[y * t1->stride + x]);
+            int64_t r = a >> shift;
+
+            if (r) {
+                r = (2 * r + 1) << shift >> 1;
+                disto += r * (2 * a - r);
+            }
+        }
+    }
+    return disto << (WMSEDEC_SHIFT - 2 * NMSEDEC_FRACBITS);
+}
+
+/**
+ * code a codeblock with a single HT cleanup pass, the coded bitplanes
+ * being selected with the rate-distortion slope threshold of truncpasses()
+ */
+static int encode_cblk_ht(Jpeg2000EncoderContext *s, Jpeg2000T1Context *t1, Jpeg2000HTEncContext *ht,
+                          Jpeg2000Cblk *cblk, const Jpeg2000Band *band, int width, int height,
+                          int bandpos, int lev)
+{
+    int x, y, max = 0, bpno, best = -1, ret;
+    int rate = 0, best_rate = 0;
+    int64_t disto = 0, best_disto = 0;
+    int64_t lambda = band_lambda(s, band, bandpos, lev);
+
+    for (y = 0; y < height; y++)
+        for (x = 0; x < width; x++)
+            max = FFMAX(max, FFABS(t1->data[y * t1->stride + x]));
+
+    cblk->nonzerobits = max ? av_log2(max) + 1 - NMSEDEC_FRACBITS : 0;
+    cblk->npasses     = 0;
+    cblk->ninclpasses = 0;
+    if (cblk->nonzerobits <= 0)
+        return 0;
+
+    // every bitplane is worth its cost without a rate constraint
+    for (bpno = lambda ? cblk->nonzerobits - 1 : 0; bpno >= 0; bpno--) {
+        ret = ff_jpeg2000_ht_encode_cblk(ht, cblk->data + 1, 8192, t1->data, t1->stride,
+                                         width, height, bpno + NMSEDEC_FRACBITS);
+        if (ret < 0)
+            return ret;
+        rate  = ret;
+        disto = ht_disto(t1, width, height, bpno);
+        if (best < 0 || disto - best_disto >= (rate - best_rate) * lambda) {
+            best       = bpno;
+            best_rate  = rate;
+            best_disto = disto;
+        }
+    }
+
+    if (best) {
+        ret = ff_jpeg2000_ht_encode_cblk(ht, cblk->data + 1, 8192, t1->data, t1->stride,
+                                         width, height, best + NMSEDEC_FRACBITS);
+        if (ret < 0)
+            return ret;
+    }
+
+    cblk->nonzerobits           = best + 1;
+    cblk->npasses               = 1;
+    cblk->ninclpasses           = 1;
+    cblk->passes[0].rate        = best_rate;
+    cblk->passes[0].disto       = best_disto;
+    cblk->passes[0].flushed_len = 0;
+    return 0;
+}
+
 /* tier-2 routines: */
 
 static void putnumpasses(Jpeg2000EncoderContext *s, int n)
@@ -1384,8 +1526,7 @@ static void truncpasses(Jpeg2000EncoderContext *s, Jpeg2000Tile *tile)
                     Jpeg2000Band *band = reslevel->band + bandno;
                     Jpeg2000Prec *prec = band->prec + precno;
 
-                    int64_t dwt_norm = dwt_norms[codsty->transform == FF_DWT53][bandpos][lev] * (int64_t)band->i_stepsize >> 15;
-                    int64_t lambda_prime = av_rescale(s->lambda, 1 << WMSEDEC_SHIFT, dwt_norm * dwt_norm);
+                    int64_t lambda_prime = band_lambda(s, band, bandpos, lev);
                     for (cblkno = 0; cblkno < prec->nb_codeblocks_height * prec->nb_codeblocks_width; cblkno++){
                         Jpeg2000Cblk *cblk = prec->cblk + cblkno;
 
@@ -1402,84 +1543,163 @@ static void truncpasses(Jpeg2000EncoderContext *s, Jpeg2000Tile *tile)
     }
 }
 
-static int encode_tile(Jpeg2000EncoderContext *s, Jpeg2000Tile *tile, int tileno)
+/**
+ * list the codeblocks of all tiles, so that tier-1 can code them in parallel
+ */
+static int init_cblk_jobs(Jpeg2000EncoderContext *s)
 {
-    int compno, reslevelno, bandno, ret;
-    Jpeg2000T1Context t1;
+    int tileno, compno, reslevelno, bandno, pass;
     Jpeg2000CodingStyle *codsty = &s->codsty;
-    for (compno = 0; compno < s->ncomponents; compno++){
-        Jpeg2000Component *comp = s->tile[tileno].comp + compno;
 
-        t1.stride = (1<<codsty->log2_cblk_width) + 2;
+    for (pass = 0; pass < 2; pass++) {
+        Jpeg2000CblkJob *job = s->cblk_jobs;
 
-        av_log(s->avctx, AV_LOG_DEBUG,"dwt\n");
-        if ((ret = ff_dwt_encode(&comp->dwt, comp->i_data)) < 0)
-            return ret;
-        av_log(s->avctx, AV_LOG_DEBUG,"after dwt -> tier1\n");
+        for (tileno = 0; tileno < s->numXtiles * s->numYtiles; tileno++){
+            Jpeg2000Tile *tile = s->tile + tileno;
 
-        for (reslevelno = 0; reslevelno < codsty->nreslevels; reslevelno++){
-            Jpeg2000ResLevel *reslevel = comp->reslevel + reslevelno;
+            for (compno = 0; compno < s->ncomponents; compno++){
+                Jpeg2000Component *comp = tile->comp + compno;
+
+                for (reslevelno = 0; reslevelno < codsty->nreslevels; reslevelno++){
+                    Jpeg2000ResLevel *reslevel = comp->reslevel + reslevelno;
 
-            for (bandno = 0; bandno < reslevel->nbands ; bandno++){
-                Jpeg2000Band *band = reslevel->band + bandno;
-                Jpeg2000Prec *prec = band->prec; // we support only 1 precinct per band ATM in the encoder
-                int cblkx, cblky, cblkno=0, xx0, x0, xx1, y0, yy0, yy1, bandpos;
-                yy0 = bandno == 0 ? 0 : comp->reslevel[reslevelno-1].coord[1][1] - comp->reslevel[reslevelno-1].coord[1][0];
-                y0 = yy0;
-                yy1 = FFMIN(ff_jpeg2000_ceildivpow2(band->coord[1][0] + 1, band->log2_cblk_height) << band->log2_cblk_height,
-                            band->coord[1][1]) - band->coord[1][0] + yy0;
+                    for (bandno = 0; bandno < reslevel->nbands ; bandno++){
+                        Jpeg2000Band *band = reslevel->band + bandno;
+                        Jpeg2000Prec *prec = band->prec; // we support only 1 precinct per band ATM in the encoder
+                        int cblkx, cblky, cblkno=0, xx0, x0, xx1, y0, yy0, yy1;
 
-                if (band->coord[0][0] == band->coord[0][1] || band->coord[1][0] == band->coord[1][1])
-                    continue;
+                        if (band->coord[0][0] == band->coord[0][1] || band->coord[1][0] == band->coord[1][1])
+                            continue;
 
-                bandpos = bandno + (reslevelno > 0);
-
-                for (cblky = 0; cblky < prec->nb_codeblocks_height; cblky++){
-                    if (reslevelno == 0 || bandno == 1)
-                        xx0 = 0;
-                    else
-                        xx0 = comp->reslevel[reslevelno-1].coord[0][1] - comp->reslevel[reslevelno-1].coord[0][0];
-                    x0 = xx0;
-                    xx1 = FFMIN(ff_jpeg2000_ceildivpow2(band->coord[0][0] + 1, band->log2_cblk_width) << band->log2_cblk_width,
-                                band->coord[0][1]) - band->coord[0][0] + xx0;
-
-                    for (cblkx = 0; cblkx < prec->nb_codeblocks_width; cblkx++, cblkno++){
-                        int y, x;
-                        if (codsty->transform == FF_DWT53){
-                            for (y = yy0; y < yy1; y++){
-                                int *ptr = t1.data + (y-yy0)*t1.stride;
-                                for (x = xx0; x < xx1; x++){
-                                    *ptr++ = comp->i_data[(comp->coord[0][1] - comp->coord[0][0]) * y + x] * (1 << NMSEDEC_FRACBITS);
-                                }
-                            }
-                        } else{
-                            for (y = yy0; y < yy1; y++){
-                                int *ptr = t1.data + (y-yy0)*t1.stride;
-                                for (x = xx0; x < xx1; x++){
-                                    *ptr = (comp->i_data[(comp->coord[0][1] - comp->coord[0][0]) * y + x]);
-                                    *ptr = (int64_t)*ptr * (int64_t)(16384 * 65536 / band->i_stepsize) >> 15 - NMSEDEC_FRACBITS;
-                                    ptr++;
-                                }
+                        if (!pass) {
+                            s->nb_cblk_jobs += prec->nb_codeblocks_width * prec->nb_codeblocks_height;
+                            continue;
+                        }
+
+                        yy0 = bandno == 0 ? 0 : comp->reslevel[reslevelno-1].coord[1][1] - comp->reslevel[reslevelno-1].coord[1][0];
+                        y0 = yy0;
+                        yy1 = FFMIN(ff_jpeg2000_ceildivpow2(band->coord[1][0] + 1, band->log2_cblk_height) << band->log2_cblk_height,
+                                    band->coord[1][1]) - band->coord[1][0] + yy0;
+
+                        for (cblky = 0; cblky < prec->nb_codeblocks_height; cblky++){
+                            if (reslevelno == 0 || bandno == 1)
+                                xx0 = 0;
+                            else
+                                xx0 = comp->reslevel[reslevelno-1].coord[0][1] - comp->reslevel[reslevelno-1].coord[0][0];
+                            x0 = xx0;
+                            xx1 = FFMIN(ff_jpeg2000_ceildivpow2(band->coord[0][0] + 1, band->log2_cblk_width) << band->log2_cblk_width,
+                                        band->coord[0][1]) - band->coord[0][0] + xx0;
+
+                            for (cblkx = 0; cblkx < prec->nb_codeblocks_width; cblkx++, cblkno++){
+                                Jpeg2000Cblk *cblk = prec->cblk + cblkno;
+
+                                cblk->data   = av_malloc(1 + 8192);
+                                cblk->passes = av_malloc_array(JPEG2000_MAX_PASSES, sizeof(*cblk->passes));
+                                if (!cblk->data || !cblk->passes)
+                                    return AVERROR(ENOMEM);
+
+                                job->tile    = tile;
+                                job->comp    = comp;
+                                job->band    = band;
+                                job->cblk    = cblk;
+                                job->x0      = xx0;
+                                job->x1      = xx1;
+                                job->y0      = yy0;
+                                job->y1      = yy1;
+                                job->bandpos = bandno + (reslevelno > 0);
+                                job->lev     = codsty->nreslevels - reslevelno - 1;
+                                job++;
+
+                                xx0 = xx1;
+                                xx1 = FFMIN(xx1 + (1 << band->log2_cblk_width), band->coord[0][1] - band->coord[0][0] + x0);
                             }
+                            yy0 = yy1;
+                            yy1 = FFMIN(yy1 + (1 << band->log2_cblk_height), band->coord[1][1] - band->coord[1][0] + y0);
                         }
-                        if (!prec->cblk[cblkno].data)
-                            prec->cblk[cblkno].data = av_malloc(1 + 8192);
-                        if (!prec->cblk[cblkno].passes)
-                            prec->cblk[cblkno].passes = av_malloc_array(JPEG2000_MAX_PASSES, sizeof (*prec->cblk[cblkno].passes));
-                        if (!prec->cblk[cblkno].data || !prec->cblk[cblkno].passes)
-                            return AVERROR(ENOMEM);
-                        encode_cblk(s, &t1, prec->cblk + cblkno, tile, xx1 - xx0, yy1 - yy0,
-                                    bandpos, codsty->nreslevels - reslevelno - 1);
-                        xx0 = xx1;
-                        xx1 = FFMIN(xx1 + (1 << band->log2_cblk_width), band->coord[0][1] - band->coord[0][0] + x0);
                     }
-                    yy0 = yy1;
-                    yy1 = FFMIN(yy1 + (1 << band->log2_cblk_height), band->coord[1][1] - band->coord[1][0] + y0);
                 }
             }
         }
-        av_log(s->avctx, AV_LOG_DEBUG, "after tier1\n");
+
+        if (!pass) {
+            s->cblk_jobs = av_calloc(s->nb_cblk_jobs, sizeof(*s->cblk_jobs));
+            if (!s->cblk_jobs)
+                return AVERROR(ENOMEM);
+        }
     }
+    return 0;
+}
+
+static int dwt_encode_thread(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    Jpeg2000EncoderContext *s = avctx->priv_data;
+    Jpeg2000Component *comp = s->tile[jobnr / s->ncomponents].comp + jobnr % s->ncomponents;
+
+    return ff_dwt_encode(&comp->dwt, comp->i_data);
+}
+
+static int encode_cblk_thread(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    Jpeg2000EncoderContext *s = avctx->priv_data;
+    const Jpeg2000CblkJob *job = s->cblk_jobs + jobnr;
+    const Jpeg2000Component *comp = job->comp;
+    const Jpeg2000Band *band = job->band;
+    const int w = comp->coord[0][1] - comp->coord[0][0];
+    Jpeg2000T1Context *t1 = s->t1 + threadnr;
+    int y, x;
+
+    if (s->codsty.transform == FF_DWT53){
+        for (y = job->y0; y < job->y1; y++){
+            int *ptr = t1->data + (y-job->y0)*t1->stride;
+            for (x = job->x0; x < job->x1; x++){
+                *ptr++ = comp->i_data[w * y + x] * (1 << NMSEDEC_FRACBITS);
+            }
+        }
+    } else{
+        for (y = job->y0; y < job->y1; y++){
+            int *ptr = t1->data + (y-job->y0)*t1->stride;
+            for (x = job->x0; x < job->x1; x++){
+                *ptr = (comp->i_data[w * y + x]);
+                *ptr = (int64_t)*ptr * (int64_t)(16384 * 65536 / band->i_stepsize) >> 15 - NMSEDEC_FRACBITS;
+                ptr++;
+            }
+        }
+    }
+    if (s->ht)
+        return encode_cblk_ht(s, t1, s->ht_t1 + threadnr, job->cblk, band,
+                              job->x1 - job->x0, job->y1 - job->y0, job->bandpos, job->lev);
+    encode_cblk(s, t1, job->cblk, job->tile, job->x1 - job->x0, job->y1 - job->y0,
+                job->bandpos, job->lev);
+    return 0;
+}
+
+/**
+ * run the wavelet transform and tier-1 coding of all tiles,
+ * the tile-components and codeblocks being independent of each other
+ */
+static int encode_tiles_tier1(Jpeg2000EncoderContext *s)
+{
+    AVCodecContext *avctx = s->avctx;
+    int i, nb_comps = s->numXtiles * s->numYtiles * s->ncomponents;
+
+    av_log(avctx, AV_LOG_DEBUG,"dwt\n");
+    avctx->execute2(avctx, dwt_encode_thread, NULL, s->dwt_ret, nb_comps);
+    for (i = 0; i < nb_comps; i++)
+        if (s->dwt_ret[i] < 0)
+            return s->dwt_ret[i];
+    av_log(avctx, AV_LOG_DEBUG,"after dwt -> tier1\n");
+
+    avctx->execute2(avctx, encode_cblk_thread, NULL, s->cblk_ret, s->nb_cblk_jobs);
+    for (i = 0; i < s->nb_cblk_jobs; i++)
+        if (s->cblk_ret[i] < 0)
+            return s->cblk_ret[i];
+    av_log(avctx, AV_LOG_DEBUG, "after tier1\n");
+    return 0;
+}
+
+static int encode_tile(Jpeg2000EncoderContext *s, Jpeg2000Tile *tile, int tileno)
+{
+    int ret;
 
     av_log(s->avctx, AV_LOG_DEBUG, "rate control\n");
     if (s->compression_rate_enc)
@@ -1554,6 +1774,9 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
 
     reinit(s);
 
+    if ((ret = encode_tiles_tier1(s)) < 0)
+        return ret;
+
     if (s->format == CODEC_JP2) {
         av_assert0(s->buf == pkt->data);
 
@@ -1564,9 +1787,9 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
         chunkstart = s->buf;
         bytestream_put_be32(&s->buf, 0);
         bytestream_put_buffer(&s->buf, "ftyp", 4);
-        bytestream_put_buffer(&s->buf, "jp2\040\040", 4);
+        bytestream_put_buffer(&s->buf, s->ht ? "jph\040" : "jp2\040", 4);
         bytestream_put_be32(&s->buf, 0);
-        bytestream_put_buffer(&s->buf, "jp2\040", 4);
+        bytestream_put_buffer(&s->buf, s->ht ? "jph\040" : "jp2\040", 4);
         update_size(chunkstart, s->buf);
 
         jp2hstart = s->buf;
@@ -1635,6 +1858,8 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
     bytestream_put_be16(&s->buf, JPEG2000_SOC);
     if ((ret = put_siz(s)) < 0)
         return ret;
+    if (s->ht && (ret = put_cap(s)) < 0)
+        return ret;
     if ((ret = put_cod(s)) < 0)
         return ret;
     if ((ret = put_qcd(s, 0)) < 0)
@@ -1717,7 +1942,7 @@ static int parse_layer_rates(Jpeg2000EncoderContext *s)
 static av_cold int j2kenc_init(AVCodecContext *avctx)
 {
     static AVOnce init_static_once = AV_ONCE_INIT;
-    int i, ret;
+    int i, ret, nb_threads;
     Jpeg2000EncoderContext *s = avctx->priv_data;
     Jpeg2000CodingStyle *codsty = &s->codsty;
     Jpeg2000QuantStyle  *qntsty = &s->qntsty;
@@ -1749,7 +1974,8 @@ static av_cold int j2kenc_init(AVCodecContext *avctx)
     codsty->log2_cblk_height = 4;
     codsty->transform        = s->pred ? FF_DWT53 : FF_DWT97_INT;
 
-    qntsty->nguardbits       = 1;
+    // the HT cleanup pass needs a spare bitplane for its exponents
+    qntsty->nguardbits       = s->ht ? 2 : 1;
 
     if ((s->tile_width  & (s->tile_width -1)) ||
         (s->tile_height & (s->tile_height-1))) {
@@ -1786,8 +2012,29 @@ static av_cold int j2kenc_init(AVCodecContext *avctx)
     ff_thread_once(&init_static_once, init_luts);
 
     init_quantization(s);
+    if (s->ht && ht_magb(s) > 30) {
+        av_log(avctx, AV_LOG_ERROR, "Too many magnitude bitplanes for the HT block coder\n");
+        return AVERROR(EINVAL);
+    }
     if ((ret=init_tiles(s)) < 0)
         return ret;
+    if ((ret = init_cblk_jobs(s)) < 0)
+        return ret;
+
+    nb_threads = avctx->active_thread_type & FF_THREAD_SLICE ? FFMAX(avctx->thread_count, 1) : 1;
+    s->t1 = av_calloc(nb_threads, sizeof(*s->t1));
+    s->dwt_ret = av_calloc(s->numXtiles * s->numYtiles * s->ncomponents, sizeof(*s->dwt_ret));
+    s->cblk_ret = av_calloc(s->nb_cblk_jobs, sizeof(*s->cblk_ret));
+    if (!s->t1 || !s->dwt_ret || !s->cblk_ret)
+        return AVERROR(ENOMEM);
+    for (i = 0; i < nb_threads; i++)
+        s->t1[i].stride = (1<<codsty->log2_cblk_width) + 2;
+
+    if (s->ht) {
+        s->ht_t1 = av_calloc(nb_threads, sizeof(*s->ht_t1));
+        if (!s->ht_t1)
+            return AVERROR(ENOMEM);
+    }
 
     av_log(s->avctx, AV_LOG_DEBUG, "after init\n");
 
@@ -1799,6 +2046,11 @@ static int j2kenc_destroy(AVCodecContext *avctx)
     Jpeg2000EncoderContext *s = avctx->priv_data;
 
     cleanup(s);
+    av_freep(&s->cblk_jobs);
+    av_freep(&s->t1);
+    av_freep(&s->dwt_ret);
+    av_freep(&s->cblk_ret);
+    av_freep(&s->ht_t1);
     return 0;
 }
 
@@ -1824,6 +2076,7 @@ static const AVOption options[] = {
     { "pcrl",          NULL,                0,                     AV_OPT_TYPE_CONST,  { .i64 = JPEG2000_PGOD_PCRL }, 0,         0,           VE, .unit = "prog" },
     { "cprl",          NULL,                0,                     AV_OPT_TYPE_CONST,  { .i64 = JPEG2000_PGOD_CPRL }, 0,         0,           VE, .unit = "prog" },
     { "layer_rates",   "Layer Rates",       OFFSET(lr_str),        AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, VE },
+    { "ht",            "Use the HT block coder", OFFSET(ht),       AV_OPT_TYPE_BOOL,   { .i64 = 0           }, 0,         1,           VE, },
     { NULL }
 };
 
@@ -1839,7 +2092,7 @@ const FFCodec ff_jpeg2000_encoder = {
     .p.type         = AVMEDIA_TYPE_VIDEO,
     .p.id           = AV_CODEC_ID_JPEG2000,
     .p.capabilities = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_ENCODER_REORDERED_OPAQUE |
-                      AV_CODEC_CAP_FRAME_THREADS,
+                      AV_CODEC_CAP_FRAME_THREADS | AV_CODEC_CAP_SLICE_THREADS,
     .priv_data_size = sizeof(Jpeg2000EncoderContext),
     .init           = j2kenc_init,
     FF_CODEC_ENCODE_CB(encode_frame),
@@ -25,6 +25,8 @@
  * Discrete wavelet transform
  */
 
+#include <string.h>
+
 #include "libavutil/error.h"
 #include "libavutil/macros.h"
 #include "libavutil/mem.h"
@@ -74,6 +76,30 @@ static inline void extend97_int(int32_t *p, int i0, int i1)
     }
 }
 
+/* The vertical forward transforms work on groups of DWT_COLS columns at a
+ * time, stored interleaved so that every lifting step runs over whole rows
+ * of the group. This avoids a strided gather per column and lets the
+ * compiler vectorize the lifting steps. */
+#define DWT_COLS 8
+#define COL(p, k) ((p) + (k) * DWT_COLS)
+
+static void col_load(int *l, const int *t, int w, int lv)
+{
+    for (int i = 0; i < lv; i++)
+        memcpy(COL(l, i), t + w*i, DWT_COLS * sizeof(*l));
+}
+
+static void col_store(int *t, const int *l, int w, int lv, int mv)
+{
+    int i, j = 0;
+
+    // copy back and deinterleave
+    for (i =   mv; i < lv; i+=2, j++)
+        memcpy(t + w*j, COL(l, i), DWT_COLS * sizeof(*l));
+    for (i = 1-mv; i < lv; i+=2, j++)
+        memcpy(t + w*j, COL(l, i), DWT_COLS * sizeof(*l));
+}
+
 static void sd_1d53(int *p, int i0, int i1)
 {
     int i;
@@ -92,11 +118,44 @@ static void sd_1d53(int *p, int i0, int i1)
         p[2*i] += (p[2*i-1] + p[2*i+1] + 2) >> 2;
 }
 
+static void sd_cols53(int *p, int i0, int i1)
+{
+    int i, c;
+
+    if (i1 <= i0 + 1) {
+        if (i0 == 1)
+            for (c = 0; c < DWT_COLS; c++)
+                COL(p, 1)[c] *= 2;
+        return;
+    }
+
+    for (c = 0; c < DWT_COLS; c++) {
+        COL(p, i0 - 1)[c] = COL(p, i0 + 1)[c];
+        COL(p, i1    )[c] = COL(p, i1 - 2)[c];
+        COL(p, i0 - 2)[c] = COL(p, i0 + 2)[c];
+        COL(p, i1 + 1)[c] = COL(p, i1 - 3)[c];
+    }
+
+    for (i = ((i0+1)>>1) - 1; i < (i1+1)>>1; i++) {
+        int *d = COL(p, 2*i+1);
+        const int *a = COL(p, 2*i), *b = COL(p, 2*i+2);
+        for (c = 0; c < DWT_COLS; c++)
+            d[c] -= (a[c] + b[c]) >> 1;
+    }
+    for (i = ((i0+1)>>1); i < (i1+1)>>1; i++) {
+        int *d = COL(p, 2*i);
+        const int *a = COL(p, 2*i-1), *b = COL(p, 2*i+1);
+        for (c = 0; c < DWT_COLS; c++)
+            d[c] += (a[c] + b[c] + 2) >> 2;
+    }
+}
+
 static void dwt_encode53(DWTContext *s, int *t)
 {
     int lev,
         w = s->linelen[s->ndeclevels-1][0];
     int *line = s->i_linebuf;
+    int *cols = COL(s->i_colbuf, 3);
     line += 3;
 
     for (lev = s->ndeclevels-1; lev >= 0; lev--){
@@ -108,8 +167,14 @@ static void dwt_encode53(DWTContext *s, int *t)
         int *l;
 
         // VER_SD
+        for (lp = 0; lp + DWT_COLS <= lh; lp += DWT_COLS) {
+            col_load(COL(cols, mv), t + lp, w, lv);
+            sd_cols53(cols, mv, mv + lv);
+            col_store(t + lp, COL(cols, mv), w, lv, mv);
+        }
+
         l = line + mv;
-        for (lp = 0; lp < lh; lp++) {
+        for (; lp < lh; lp++) {
             int i, j = 0;
 
             for (i = 0; i < lv; i++)
@@ -246,6 +311,57 @@ static void sd_1d97_int(int *p, int i0, int i1)
         p[2 * i]     += (I_LFTG_DELTA * (p[2 * i - 1] + p[2 * i + 1]) + (1 << 15)) >> 16;
 }
 
+static void sd_cols97_int(int *p, int i0, int i1)
+{
+    int i, c;
+
+    if (i1 <= i0 + 1) {
+        if (i0 == 1)
+            for (c = 0; c < DWT_COLS; c++)
+                COL(p, 1)[c] = (COL(p, 1)[c] * I_LFTG_X + (1<<14)) >> 15;
+        else
+            for (c = 0; c < DWT_COLS; c++)
+                COL(p, 0)[c] = (COL(p, 0)[c] * I_LFTG_K + (1<<15)) >> 16;
+        return;
+    }
+
+    for (i = 1; i <= 4; i++) {
+        for (c = 0; c < DWT_COLS; c++) {
+            COL(p, i0 - i    )[c] = COL(p, i0 + i    )[c];
+            COL(p, i1 + i - 1)[c] = COL(p, i1 - i - 1)[c];
+        }
+    }
+    i0++; i1++;
+
+    for (i = (i0>>1) - 2; i < (i1>>1) + 1; i++) {
+        int *d = COL(p, 2*i+1);
+        const int *a = COL(p, 2*i), *b = COL(p, 2*i+2);
+        for (c = 0; c < DWT_COLS; c++) {
+            const int64_t sum = a[c] + b[c];
+            d[c] -= sum;
+            d[c] -= (I_LFTG_ALPHA_PRIME * sum + (1 << 15)) >> 16;
+        }
+    }
+    for (i = (i0>>1) - 1; i < (i1>>1) + 1; i++) {
+        int *d = COL(p, 2*i);
+        const int *a = COL(p, 2*i-1), *b = COL(p, 2*i+1);
+        for (c = 0; c < DWT_COLS; c++)
+            d[c] -= (I_LFTG_BETA  * (a[c] + b[c]) + (1 << 15)) >> 16;
+    }
+    for (i = (i0>>1) - 1; i < (i1>>1); i++) {
+        int *d = COL(p, 2*i+1);
+        const int *a = COL(p, 2*i), *b = COL(p, 2*i+2);
+        for (c = 0; c < DWT_COLS; c++)
+            d[c] += (I_LFTG_GAMMA * (a[c] + b[c]) + (1 << 15)) >> 16;
+    }
+    for (i = (i0>>1); i < (i1>>1); i++) {
+        int *d = COL(p, 2*i);
+        const int *a = COL(p, 2*i-1), *b = COL(p, 2*i+1);
+        for (c = 0; c < DWT_COLS; c++)
+            d[c] += (I_LFTG_DELTA * (a[c] + b[c]) + (1 << 15)) >> 16;
+    }
+}
+
 static void dwt_encode97_int(DWTContext *s, int *t)
 {
     int lev;
@@ -253,6 +369,7 @@ static void dwt_encode97_int(DWTContext *s, int *t)
     int h = s->linelen[s->ndeclevels-1][1];
     int i;
     int *line = s->i_linebuf;
+    int *cols = COL(s->i_colbuf, 5);
     line += 5;
 
     for (i = 0; i < w * h; i++)
@@ -267,8 +384,14 @@ static void dwt_encode97_int(DWTContext *s, int *t)
         int *l;
 
         // VER_SD
+        for (lp = 0; lp + DWT_COLS <= lh; lp += DWT_COLS) {
+            col_load(COL(cols, mv), t + lp, w, lv);
+            sd_cols97_int(cols, mv, mv + lv);
+            col_store(t + lp, COL(cols, mv), w, lv, mv);
+        }
+
         l = line + mv;
-        for (lp = 0; lp < lh; lp++) {
+        for (; lp < lh; lp++) {
             int i, j = 0;
 
             for (i = 0; i < lv; i++)
@@ -585,6 +708,14 @@ int ff_dwt_encode(DWTContext *s, void *t)
     if (s->ndeclevels == 0)
         return 0;
 
+    if (s->type != FF_DWT97 && !s->i_colbuf) {
+        int maxlen = FFMAX(s->linelen[s->ndeclevels-1][0],
+                           s->linelen[s->ndeclevels-1][1]);
+        s->i_colbuf = av_malloc_array((maxlen + 12) * DWT_COLS, sizeof(*s->i_colbuf));
+        if (!s->i_colbuf)
+            return AVERROR(ENOMEM);
+    }
+
     switch(s->type){
         case FF_DWT97:
             dwt_encode97_float(s, t); break;
@@ -623,4 +754,5 @@ void ff_dwt_destroy(DWTContext *s)
 {
     av_freep(&s->f_linebuf);
     av_freep(&s->i_linebuf);
+    av_freep(&s->i_colbuf);
 }
@@ -48,6 +48,7 @@ typedef struct DWTContext {
     uint8_t ndeclevels;                  ///< number of decomposition levels
     uint8_t type;                        ///< 0 for 9/7; 1 for 5/3
     int32_t *i_linebuf;                  ///< int buffer used by transform
+    int32_t *i_colbuf;                   ///< int buffer used by the vertical forward transform
     float   *f_linebuf;                  ///< float buffer used by transform
 } DWTContext;
 
@@ -0,0 +1,40 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVCODEC_JPEG2000HTDATA_H
+#define AVCODEC_JPEG2000HTDATA_H
+
+#include <stdint.h>
+
+/**
+ * MEL exponent table, Rec. ITU-T T.814, Table 2
+ */
+extern const uint8_t ff_jpeg2000_ht_mel_e[13];
+
+/**
+ * CxtVLC decoding tables for the initial line pair (table0) and the
+ * following ones (table1), indexed by (context << 7) | next 7 bits.
+ *
+ * Each entry packs, from the LSB: the u_off bit, the codeword length
+ * (3 bits), the significance pattern rho, the EMB pattern e_k and
+ * the EMB pattern e_1 (4 bits each).
+ */
+extern const uint16_t ff_jpeg2000_ht_cxt_vlc_table0[1024];
+extern const uint16_t ff_jpeg2000_ht_cxt_vlc_table1[1024];
+
+#endif /* AVCODEC_JPEG2000HTDATA_H */
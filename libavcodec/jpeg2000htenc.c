@@ -0,0 +1,559 @@
+/*
+ * HTJ2K block encoder
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * HT cleanup pass encoder, Rec. ITU-T T.814 | ISO/IEC 15444-15, 7.3.
+ *
+ * The three bit streams of the cleanup segment are produced at once: the
+ * MagSgn bits grow forward from the start of the segment, the MEL bits
+ * follow them and the VLC bits grow backward from its end. The quads are
+ * visited in the order the decoder parses them.
+ */
+
+#include <string.h>
+
+#include "libavutil/attributes.h"
+#include "libavutil/common.h"
+#include "libavutil/error.h"
+#include "jpeg2000htdata.h"
+#include "jpeg2000htenc.h"
+
+/**
+ * CxtVLC encoding tables, indexed by [table][context][rho][u_off][eps].
+ * An entry holds the codeword in its 7 LSBs, then its length on 3 bits
+ * and the EMB pattern e_k on 4 bits, the pattern e_1 being e_k & eps.
+ */
+static uint16_t enc_cxt_vlc[2][8][16][2][16];
+
+typedef struct MagSgnWriter {
+    uint8_t *buf;
+    int pos;
+    int max_bits;
+    int used_bits;
+    uint32_t tmp;
+} MagSgnWriter;
+
+typedef struct MelWriter {
+    uint8_t *buf;
+    int pos;
+    int remaining_bits;
+    int tmp;
+    int run;
+    int k;
+    int threshold;
+} MelWriter;
+
+typedef struct VlcWriter {
+    uint8_t *buf; ///< last byte of the buffer, the stream grows backward
+    int pos;
+    int used_bits;
+    int tmp;
+    int last_gt_8f;
+} VlcWriter;
+
+static av_cold void build_enc_table(uint16_t dst[8][16][2][16], const uint16_t *src)
+{
+    uint8_t cost[8][16][2][16];
+
+    memset(cost, 0xFF, sizeof(cost));
+
+    for (int i = 0; i < 1024; i++) {
+        int ctx  = i >> 7;
+        int val  = src[i];
+        int uoff = val & 1;
+        int len  = (val >> 1) & 7;
+        int rho  = (val >> 4) & 0xF;
+        int ek   = (val >> 8) & 0xF;
+        int e1   = (val >> 12) & 0xF;
+        int cwd  = i & ((1 << len) - 1);
+
+        if (!len)
+            continue;
+        /* each codeword is replicated over its unused MSBs */
+        if (cwd != (i & 0x7F))
+            continue;
+
+        for (int eps = 0; eps < 16; eps++) {
+            int c = len - av_popcount(ek);
+
+            if ((eps & ~rho) || (!uoff && eps) || (ek & eps) != e1)
+                continue;
+            if (c < cost[ctx][rho][uoff][eps]) {
+                cost[ctx][rho][uoff][eps] = c;
+                dst[ctx][rho][uoff][eps]  = cwd | len << 7 | ek << 10;
+            }
+        }
+    }
+}
+
+av_cold void ff_jpeg2000_ht_init_enc_tables(void)
+{
+    build_enc_table(enc_cxt_vlc[0], ff_jpeg2000_ht_cxt_vlc_table0);
+    build_enc_table(enc_cxt_vlc[1], ff_jpeg2000_ht_cxt_vlc_table1);
+}
+
+static void ms_init(MagSgnWriter *ms, uint8_t *buf)
+{
+    ms->buf       = buf;
+    ms->pos       = 0;
+    ms->max_bits  = 8;
+    ms->used_bits = 0;
+    ms->tmp       = 0;
+}
+
+/**
+ * Write bits LSB first, skipping the MSB of a byte following 0xFF.
+ */
+static void ms_encode(MagSgnWriter *ms, uint32_t cwd, int len)
+{
+    while (len > 0) {
+        int t = FFMIN(ms->max_bits - ms->used_bits, len);
+
+        ms->tmp       |= (cwd & ((1U << t) - 1)) << ms->used_bits;
+        ms->used_bits += t;
+        cwd          >>= t;
+        len           -= t;
+        if (ms->used_bits >= ms->max_bits) {
+            ms->buf[ms->pos++] = ms->tmp;
+            ms->max_bits  = ms->tmp == 0xFF ? 7 : 8;
+            ms->tmp       = 0;
+            ms->used_bits = 0;
+        }
+    }
+}
+
+/**
+ * Pad the last byte with 1s, which the decoder assumes past the end of
+ * the stream, so it can be dropped if it becomes 0xFF.
+ */
+static void ms_terminate(MagSgnWriter *ms)
+{
+    if (ms->used_bits) {
+        int t = ms->max_bits - ms->used_bits;
+
+        ms->tmp |= (0xFF & ((1U << t) - 1)) << ms->used_bits;
+        if (ms->tmp != 0xFF)
+            ms->buf[ms->pos++] = ms->tmp;
+    } else if (ms->max_bits == 7) {
+        ms->pos--;
+    }
+}
+
+static void mel_init(MelWriter *mel, uint8_t *buf)
+{
+    mel->buf            = buf;
+    mel->pos            = 0;
+    mel->remaining_bits = 8;
+    mel->tmp            = 0;
+    mel->run            = 0;
+    mel->k              = 0;
+    mel->threshold      = 1;
+}
+
+static void mel_emit_bit(MelWriter *mel, int bit)
+{
+    mel->tmp = (mel->tmp << 1) + bit;
+    if (!--mel->remaining_bits) {
+        mel->buf[mel->pos++] = mel->tmp;
+        mel->remaining_bits  = mel->tmp == 0xFF ? 7 : 8;
+        mel->tmp             = 0;
+    }
+}
+
+/**
+ * Adaptive run-length coding of a MEL symbol, Rec. ITU-T T.814, 7.3.3.
+ */
+static void mel_encode(MelWriter *mel, int sym)
+{
+    if (!sym) {
+        if (++mel->run >= mel->threshold) {
+            mel_emit_bit(mel, 1);
+            mel->run       = 0;
+            mel->k         = FFMIN(12, mel->k + 1);
+            mel->threshold = 1 << ff_jpeg2000_ht_mel_e[mel->k];
+        }
+    } else {
+        int t = ff_jpeg2000_ht_mel_e[mel->k];
+
+        mel_emit_bit(mel, 0);
+        while (t > 0)
+            mel_emit_bit(mel, (mel->run >> --t) & 1);
+        mel->run       = 0;
+        mel->k         = FFMAX(0, mel->k - 1);
+        mel->threshold = 1 << ff_jpeg2000_ht_mel_e[mel->k];
+    }
+}
+
+/**
+ * The last byte of the VLC stream (the first one written) is replaced by
+ * the suffix length, in which the decoder sees 0xFF, and the 4 LSBs of the
+ * byte before it are reserved for the suffix length as well.
+ */
+static void vlc_init(VlcWriter *vlc, uint8_t *buf, int size)
+{
+    vlc->buf        = buf + size - 1;
+    vlc->buf[0]     = 0xFF;
+    vlc->buf--;
+    vlc->pos        = 1;
+    vlc->used_bits  = 4;
+    vlc->tmp        = 0xF;
+    vlc->last_gt_8f = 1;
+}
+
+/**
+ * Write bits LSB first, backward, stuffing a 0 bit in the MSB of a byte
+ * whose 7 LSBs are set if the byte written before it exceeds 0x8F.
+ */
+static void vlc_encode(VlcWriter *vlc, int cwd, int len)
+{
+    while (len > 0) {
+        int avail = 8 - vlc->last_gt_8f - vlc->used_bits;
+        int t     = FFMIN(avail, len);
+
+        vlc->tmp       |= (cwd & ((1 << t) - 1)) << vlc->used_bits;
+        vlc->used_bits += t;
+        avail          -= t;
+        len            -= t;
+        cwd           >>= t;
+        if (!avail) {
+            if (vlc->last_gt_8f && vlc->tmp != 0x7F) {
+                vlc->last_gt_8f = 0;
+                continue;
+            }
+            *vlc->buf-- = vlc->tmp;
+            vlc->pos++;
+            vlc->last_gt_8f = vlc->tmp > 0x8F;
+            vlc->tmp        = 0;
+            vlc->used_bits  = 0;
+        }
+    }
+}
+
+/**
+ * Flush the MEL and VLC streams, sharing a byte between them if their
+ * remaining bits do not overlap.
+ */
+static void terminate_mel_vlc(MelWriter *mel, VlcWriter *vlc)
+{
+    int mel_mask, vlc_mask, fuse;
+
+    if (mel->run > 0)
+        mel_emit_bit(mel, 1);
+
+    mel->tmp <<= mel->remaining_bits;
+    mel_mask   = (0xFF << mel->remaining_bits) & 0xFF;
+    vlc_mask   = 0xFF >> (8 - vlc->used_bits);
+    if (!(mel_mask | vlc_mask))
+        return;
+
+    fuse = mel->tmp | vlc->tmp;
+    if (!(((fuse ^ mel->tmp) & mel_mask) | ((fuse ^ vlc->tmp) & vlc_mask)) &&
+        fuse != 0xFF && vlc->pos > 1) {
+        mel->buf[mel->pos++] = fuse;
+    } else {
+        mel->buf[mel->pos++] = mel->tmp;
+        *vlc->buf-- = vlc->tmp;
+        vlc->pos++;
+    }
+}
+
+/**
+ * Code an unsigned residual exponent offset u > 0, Rec. ITU-T T.814, 7.3.6.
+ * The prefix, suffix and extension are written separately as the decoder
+ * interleaves those of the two quads of a pair.
+ */
+static void vlc_encode_u_prefix(VlcWriter *vlc, int u)
+{
+    if (u == 1)
+        vlc_encode(vlc, 1, 1);
+    else if (u == 2)
+        vlc_encode(vlc, 2, 2);
+    else if (u <= 4)
+        vlc_encode(vlc, 4, 3);
+    else
+        vlc_encode(vlc, 0, 3);
+}
+
+static void vlc_encode_u_suffix(VlcWriter *vlc, int u)
+{
+    if (u == 3 || u == 4)
+        vlc_encode(vlc, u - 3, 1);
+    else if (u >= 5)
+        vlc_encode(vlc, u < 33 ? u - 5 : 28 + ((u - 33) & 3), 5);
+}
+
+static void vlc_encode_u_extension(VlcWriter *vlc, int u)
+{
+    if (u >= 33)
+        vlc_encode(vlc, (u - 33) >> 2, 4);
+}
+
+static void vlc_encode_u(VlcWriter *vlc, int u)
+{
+    vlc_encode_u_prefix(vlc, u);
+    vlc_encode_u_suffix(vlc, u);
+    vlc_encode_u_extension(vlc, u);
+}
+
+static void vlc_encode_u_pair(VlcWriter *vlc, int u1, int u2)
+{
+    vlc_encode_u_prefix(vlc, u1);
+    vlc_encode_u_prefix(vlc, u2);
+    vlc_encode_u_suffix(vlc, u1);
+    vlc_encode_u_suffix(vlc, u2);
+    vlc_encode_u_extension(vlc, u1);
+    vlc_encode_u_extension(vlc, u2);
+}
+
+/**
+ * Compute the MagSgn values and exponents of a line pair, the samples of a
+ * quad being stored column first.
+ */
+static void quantize_line_pair(Jpeg2000HTEncContext *s, int q, const int *data,
+                               int stride, int width, int rows, int shift)
+{
+    for (int y = 0; y < 2; y++) {
+        uint32_t *v = s->v + 4 * q + y;
+        uint8_t  *E = s->E + 4 * q + y;
+
+        for (int x = 0; x < width; x++) {
+            int val = y < rows ? data[y * stride + x] : 0;
+            uint32_t mu = FFABS(val) >> shift;
+
+            v[2 * x] = mu ? 2 * (mu - 1) + (val < 0) : 0;
+            E[2 * x] = mu ? av_log2(2 * mu - 1) + 1 : 0;
+        }
+        if (width & 1)
+            v[2 * width] = E[2 * width] = 0;
+    }
+}
+
+typedef struct Quad {
+    int rho;   ///< significance pattern
+    int emax;  ///< largest exponent
+} Quad;
+
+static av_always_inline Quad get_quad(const Jpeg2000HTEncContext *s, int q)
+{
+    const uint8_t *E = s->E + 4 * q;
+    Quad quad;
+
+    quad.rho  = !!E[0] | !!E[1] << 1 | !!E[2] << 2 | !!E[3] << 3;
+    quad.emax = FFMAX(FFMAX(E[0], E[1]), FFMAX(E[2], E[3]));
+    return quad;
+}
+
+/**
+ * Code the significance and EMB patterns of a quad.
+ *
+ * @return e_k
+ */
+static int encode_sig_emb(MelWriter *mel, VlcWriter *vlc, uint16_t table[8][16][2][16],
+                          const uint8_t *E, int context, int rho, int U, int uoff)
+{
+    int eps = 0, entry;
+
+    if (!context) {
+        mel_encode(mel, !!rho);
+        if (!rho)
+            return 0;
+    }
+    if (uoff)
+        for (int i = 0; i < 4; i++)
+            eps |= (E[i] == U) << i;
+
+    entry = table[context][rho][uoff][eps];
+    vlc_encode(vlc, entry & 0x7F, (entry >> 7) & 7);
+    return entry >> 10;
+}
+
+static void encode_mag_sgn(MagSgnWriter *ms, const Jpeg2000HTEncContext *s, int q,
+                           int U, int ek)
+{
+    for (int i = 0; i < 4; i++) {
+        if (s->E[4 * q + i]) {
+            int m = U - ((ek >> i) & 1);
+            ms_encode(ms, s->v[4 * q + i] & ((1U << m) - 1), m);
+        }
+    }
+}
+
+static av_always_inline int sig(const Jpeg2000HTEncContext *s, int n)
+{
+    return !!s->E[n];
+}
+
+/**
+ * Context of a quad outside of the initial line pair, Rec. ITU-T T.814, 7.3.5.
+ */
+static int quad_context(const Jpeg2000HTEncContext *s, int q, int qx, int qw)
+{
+    int n = 4 * (q - qw);
+    int context = sig(s, n + 1);
+
+    context += sig(s, n + 3) << 2;
+    if (qx > 0) {
+        context |= sig(s, n - 1);
+        context += (sig(s, 4 * q - 1) | sig(s, 4 * q - 2)) << 1;
+    }
+    if (qx < qw - 1)
+        context |= sig(s, n + 5) << 2;
+    return context;
+}
+
+/**
+ * Exponent predictor of a quad outside of the initial line pair.
+ */
+static int quad_kappa(const Jpeg2000HTEncContext *s, int q, int qx, int qw, int rho)
+{
+    int n = 4 * (q - qw);
+    int emax = FFMAX(s->E[n + 1], s->E[n + 3]);
+
+    if (av_popcount(rho) < 2)
+        return 1;
+    if (qx > 0)
+        emax = FFMAX(emax, s->E[n - 1]);
+    if (qx < qw - 1)
+        emax = FFMAX(emax, s->E[n + 5]);
+    return FFMAX(1, emax - 1);
+}
+
+int ff_jpeg2000_ht_encode_cblk(Jpeg2000HTEncContext *s, uint8_t *dst, int dst_size,
+                               const int *data, int stride, int width, int height,
+                               int shift)
+{
+    const int qw = (width  + 1) >> 1;
+    const int qh = (height + 1) >> 1;
+    MagSgnWriter ms;
+    MelWriter mel;
+    VlcWriter vlc;
+    int context = 0, significant = 0, q, Scup, len;
+
+    if (4 * qw * qh > JPEG2000_HT_MAX_SAMPLES)
+        return AVERROR(EINVAL);
+
+    for (int qy = 0; qy < qh; qy++)
+        quantize_line_pair(s, qy * qw, data + 2 * qy * stride, stride, width,
+                           height - 2 * qy, shift);
+    for (int n = 0; n < 4 * qw * qh; n++)
+        significant |= s->E[n];
+    if (!significant)
+        return 0;
+
+    ms_init(&ms, s->ms_buf);
+    mel_init(&mel, s->mel_buf);
+    vlc_init(&vlc, s->vlc_buf, sizeof(s->vlc_buf));
+
+    /* initial line pair, the quads are coded in pairs with kappa = 1 */
+    for (q = 0; q < qw; q += 2) {
+        Quad q1 = get_quad(s, q), q2 = { 0 };
+        int U1 = FFMAX(1, q1.emax), U2 = 1;
+        int u1 = q1.rho ? U1 - 1 : 0, u2 = 0;
+        int ek1, ek2 = 0;
+
+        ek1 = encode_sig_emb(&mel, &vlc, enc_cxt_vlc[0], s->E + 4 * q,
+                             context, q1.rho, U1, u1 > 0);
+        context = (q1.rho & 1) | (q1.rho >> 1 & 1);
+        context += (q1.rho >> 2 & 1) << 1;
+        context += (q1.rho >> 3 & 1) << 2;
+
+        if (q + 1 < qw) {
+            q2  = get_quad(s, q + 1);
+            U2  = FFMAX(1, q2.emax);
+            u2  = q2.rho ? U2 - 1 : 0;
+            ek2 = encode_sig_emb(&mel, &vlc, enc_cxt_vlc[0], s->E + 4 * (q + 1),
+                                 context, q2.rho, U2, u2 > 0);
+            context = (q2.rho & 1) | (q2.rho >> 1 & 1);
+            context += (q2.rho >> 2 & 1) << 1;
+            context += (q2.rho >> 3 & 1) << 2;
+        }
+
+        if (u1 > 0 && u2 > 0) {
+            mel_encode(&mel, u1 > 2 && u2 > 2);
+            if (u1 > 2 && u2 > 2) {
+                vlc_encode_u_pair(&vlc, u1 - 2, u2 - 2);
+            } else if (u1 > 2) {
+                vlc_encode_u_prefix(&vlc, u1);
+                vlc_encode(&vlc, u2 - 1, 1);
+                vlc_encode_u_suffix(&vlc, u1);
+                vlc_encode_u_extension(&vlc, u1);
+            } else {
+                vlc_encode_u_pair(&vlc, u1, u2);
+            }
+        } else if (u1 > 0) {
+            vlc_encode_u(&vlc, u1);
+        } else if (u2 > 0) {
+            vlc_encode_u(&vlc, u2);
+        }
+
+        encode_mag_sgn(&ms, s, q, U1, ek1);
+        if (q + 1 < qw)
+            encode_mag_sgn(&ms, s, q + 1, U2, ek2);
+    }
+
+    for (int qy = 1; qy < qh; qy++) {
+        for (int qx = 0; qx < qw; qx += 2) {
+            Quad quad[2] = { { 0 } };
+            int U[2] = { 1, 1 }, u[2] = { 0 }, ek[2] = { 0 };
+            int nb = FFMIN(2, qw - qx);
+
+            q = qy * qw + qx;
+            for (int i = 0; i < nb; i++) {
+                int kappa;
+
+                quad[i] = get_quad(s, q + i);
+                kappa   = quad_kappa(s, q + i, qx + i, qw, quad[i].rho);
+                U[i]    = FFMAX(kappa, quad[i].emax);
+                u[i]    = quad[i].rho ? U[i] - kappa : 0;
+                ek[i]   = encode_sig_emb(&mel, &vlc, enc_cxt_vlc[1], s->E + 4 * (q + i),
+                                         quad_context(s, q + i, qx + i, qw),
+                                         quad[i].rho, U[i], u[i] > 0);
+            }
+
+            if (u[0] > 0 && u[1] > 0)
+                vlc_encode_u_pair(&vlc, u[0], u[1]);
+            else if (u[0] > 0)
+                vlc_encode_u(&vlc, u[0]);
+            else if (u[1] > 0)
+                vlc_encode_u(&vlc, u[1]);
+
+            for (int i = 0; i < nb; i++)
+                encode_mag_sgn(&ms, s, q + i, U[i], ek[i]);
+        }
+    }
+
+    terminate_mel_vlc(&mel, &vlc);
+    ms_terminate(&ms);
+
+    Scup = mel.pos + vlc.pos;
+    len  = ms.pos + Scup;
+    if (Scup > 4079 || len > dst_size)
+        return AVERROR(EINVAL);
+
+    memcpy(dst, s->ms_buf, ms.pos);
+    memcpy(dst + ms.pos, s->mel_buf, mel.pos);
+    memcpy(dst + ms.pos + mel.pos, vlc.buf + 1, vlc.pos);
+
+    dst[len - 1] = Scup >> 4;
+    dst[len - 2] = (dst[len - 2] & 0xF0) | (Scup & 0xF);
+
+    return len;
+}
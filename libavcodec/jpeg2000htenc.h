@@ -0,0 +1,58 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVCODEC_JPEG2000HTENC_H
+#define AVCODEC_JPEG2000HTENC_H
+
+#include <stdint.h>
+
+/**
+ * HT block encoder as specified in Rec. ITU-T T.814 | ISO/IEC 15444-15,
+ * coding a codeblock with a single HT cleanup pass.
+ */
+
+#define JPEG2000_HT_MAX_SAMPLES 4096 ///< codeblock area, Rec. ITU-T T.800, Table A.18
+
+typedef struct Jpeg2000HTEncContext {
+    uint32_t v[JPEG2000_HT_MAX_SAMPLES]; ///< MagSgn values, in quad order
+    uint8_t  E[JPEG2000_HT_MAX_SAMPLES]; ///< exponents, 0 for insignificant samples
+    uint8_t  ms_buf [JPEG2000_HT_MAX_SAMPLES * 5];
+    uint8_t  mel_buf[JPEG2000_HT_MAX_SAMPLES / 2];
+    uint8_t  vlc_buf[JPEG2000_HT_MAX_SAMPLES];
+} Jpeg2000HTEncContext;
+
+void ff_jpeg2000_ht_init_enc_tables(void);
+
+/**
+ * Code the magnitudes of the samples above a given bitplane in a HT
+ * cleanup segment.
+ *
+ * The padded codeblock, that is (width + 1 & ~1) * (height + 1 & ~1),
+ * must not exceed JPEG2000_HT_MAX_SAMPLES, and the magnitudes shifted by
+ * shift must be less than 1 << 30.
+ *
+ * @param data   signed samples
+ * @param shift  number of bitplanes below the coded ones
+ * @return the size of the segment, 0 if no sample is significant or a
+ *         negative error code
+ */
+int ff_jpeg2000_ht_encode_cblk(Jpeg2000HTEncContext *s, uint8_t *dst, int dst_size,
+                               const int *data, int stride, int width, int height,
+                               int shift);
+
+#endif /* AVCODEC_JPEG2000HTENC_H */
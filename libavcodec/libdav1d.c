@@ -28,6 +28,7 @@
 #include "libavutil/mastering_display_metadata.h"
 #include "libavutil/imgutils.h"
 #include "libavutil/opt.h"
+#include "libavutil/thread.h"
 
 #include "atsc_a53.h"
 #include "av1_parse.h"
@@ -53,6 +54,8 @@ typedef struct Libdav1dContext {
     int tile_threads;
     int frame_threads;
     int max_frame_delay;
+    int thread_budget;
+    int reserved_threads;
     int apply_grain;
     int operating_point;
     int all_layers;
@@ -207,6 +210,32 @@ static av_cold int libdav1d_parse_extradata(AVCodecContext *c)
     return 0;
 }
 
+/* Threads reserved by all open decoders that set a thread budget */
+static AVMutex thread_budget_mutex = AV_MUTEX_INITIALIZER;
+static int threads_reserved;
+
+/* Reserve up to wanted threads from the process wide budget, at least one. */
+static av_cold int libdav1d_reserve_threads(Libdav1dContext *dav1d, int wanted)
+{
+    int avail;
+
+    ff_mutex_lock(&thread_budget_mutex);
+    avail = FFMAX(dav1d->thread_budget - threads_reserved, 1);
+    dav1d->reserved_threads = FFMIN(wanted, avail);
+    threads_reserved += dav1d->reserved_threads;
+    ff_mutex_unlock(&thread_budget_mutex);
+
+    return dav1d->reserved_threads;
+}
+
+static av_cold void libdav1d_release_threads(Libdav1dContext *dav1d)
+{
+    ff_mutex_lock(&thread_budget_mutex);
+    threads_reserved -= dav1d->reserved_threads;
+    dav1d->reserved_threads = 0;
+    ff_mutex_unlock(&thread_budget_mutex);
+}
+
 static av_cold int libdav1d_init(AVCodecContext *c)
 {
     Libdav1dContext *dav1d = c->priv_data;
@@ -240,6 +269,13 @@ static av_cold int libdav1d_init(AVCodecContext *c)
     s.strict_std_compliance = c->strict_std_compliance > 0;
 #endif
 
+    if (dav1d->thread_budget > 0) {
+        int wanted = threads ? threads : av_cpu_count();
+        threads = libdav1d_reserve_threads(dav1d, FFMIN(wanted, DAV1D_MAX_THREADS));
+        av_log(c, AV_LOG_VERBOSE, "Reserved %d of %d threads from the thread budget\n",
+               threads, dav1d->thread_budget);
+    }
+
 #if FF_DAV1D_VERSION_AT_LEAST(6,0)
     if (dav1d->frame_threads || dav1d->tile_threads)
         s.n_threads = FFMAX(dav1d->frame_threads, dav1d->tile_threads);
@@ -651,6 +687,7 @@ static av_cold int libdav1d_close(AVCodecContext *c)
     ff_dovi_ctx_unref(&dav1d->dovi);
     dav1d_data_unref(&dav1d->data);
     dav1d_close(&dav1d->c);
+    libdav1d_release_threads(dav1d);
 
     return 0;
 }
@@ -671,6 +708,7 @@ static const AVOption libdav1d_options[] = {
     { "tilethreads", "Tile threads", OFFSET(tile_threads), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, DAV1D_MAX_TILE_THREADS, VD | AV_OPT_FLAG_DEPRECATED },
     { "framethreads", "Frame threads", OFFSET(frame_threads), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, DAV1D_MAX_FRAME_THREADS, VD | AV_OPT_FLAG_DEPRECATED },
     { "max_frame_delay", "Max frame delay", OFFSET(max_frame_delay), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, DAV1D_MAX_FRAME_DELAY, VD },
+    { "thread_budget", "Total threads shared by all libdav1d decoders in the process", OFFSET(thread_budget), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, INT_MAX, VD },
     { "filmgrain", "Apply Film Grain", OFFSET(apply_grain), AV_OPT_TYPE_BOOL, { .i64 = -1 }, -1, 1, VD | AV_OPT_FLAG_DEPRECATED },
     { "oppoint",  "Select an operating point of the scalable bitstream", OFFSET(operating_point), AV_OPT_TYPE_INT, { .i64 = -1 }, -1, 31, VD },
     { "alllayers", "Output all spatial layers", OFFSET(all_layers), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, VD },
@@ -694,7 +732,7 @@ const FFCodec ff_libdav1d_decoder = {
     .flush          = libdav1d_flush,
     FF_CODEC_RECEIVE_FRAME_CB(libdav1d_receive_frame),
     .p.capabilities = AV_CODEC_CAP_DELAY | AV_CODEC_CAP_OTHER_THREADS,
-    .caps_internal  = FF_CODEC_CAP_SETS_FRAME_PROPS |
+    .caps_internal  = FF_CODEC_CAP_SETS_FRAME_PROPS | FF_CODEC_CAP_INIT_CLEANUP |
                       FF_CODEC_CAP_AUTO_THREADS,
     .p.priv_class   = &libdav1d_class,
     .p.wrapper_name = "libdav1d",
@@ -128,6 +128,15 @@ typedef struct X264Context {
     int roi_warned;
 
     int mb_info;
+
+    /**
+     * Pools for the per-macroblock quant_offsets and mb_info tables, which
+     * x264 holds on to until the frame leaves the lookahead.
+     */
+    AVBufferPool *qoffsets_pool;
+    AVBufferPool *mb_info_pool;
+    size_t        qoffsets_pool_size;
+    size_t        mb_info_pool_size;
 } X264Context;
 
 static void X264_log(void *p, int level, const char *fmt, va_list args)
@@ -292,13 +301,49 @@ static void reconfig_encoder(AVCodecContext *ctx, const AVFrame *frame)
     }
 }
 
+/* x264 releases the tables through a callback that only gets the data
+ * pointer, so the pool reference is stored in front of the data. */
+#define PROP_BUF_PADDING 64
+
+static void *prop_buf_get(AVBufferPool **pool, size_t *pool_size, size_t size)
+{
+    AVBufferRef *ref;
+
+    if (!*pool || *pool_size != size) {
+        av_buffer_pool_uninit(pool);
+        *pool = av_buffer_pool_init(PROP_BUF_PADDING + size, NULL);
+        if (!*pool)
+            return NULL;
+        *pool_size = size;
+    }
+
+    ref = av_buffer_pool_get(*pool);
+    if (!ref)
+        return NULL;
+    memcpy(ref->data, &ref, sizeof(ref));
+
+    return ref->data + PROP_BUF_PADDING;
+}
+
+static void prop_buf_free(void *data)
+{
+    AVBufferRef *ref;
+
+    memcpy(&ref, (uint8_t *)data - PROP_BUF_PADDING, sizeof(ref));
+    av_buffer_unref(&ref);
+}
+
 static void free_picture(x264_picture_t *pic)
 {
     for (int i = 0; i < pic->extra_sei.num_payloads; i++)
         av_free(pic->extra_sei.payloads[i].payload);
     av_freep(&pic->extra_sei.payloads);
-    av_freep(&pic->prop.quant_offsets);
-    av_freep(&pic->prop.mb_info);
+    if (pic->prop.quant_offsets)
+        prop_buf_free(pic->prop.quant_offsets);
+    if (pic->prop.mb_info)
+        prop_buf_free(pic->prop.mb_info);
+    pic->prop.quant_offsets = NULL;
+    pic->prop.mb_info = NULL;
     pic->extra_sei.num_payloads = 0;
 }
 
@@ -352,6 +397,7 @@ static int setup_mb_info(AVCodecContext *ctx, x264_picture_t *pic,
                          const AVFrame *frame,
                          const AVVideoHint *info)
 {
+    X264Context *x4 = ctx->priv_data;
     int mb_width = (frame->width + MB_SIZE - 1) / MB_SIZE;
     int mb_height = (frame->height + MB_SIZE - 1) / MB_SIZE;
 
@@ -362,7 +408,7 @@ static int setup_mb_info(AVCodecContext *ctx, x264_picture_t *pic,
     mbinfo_rects = (const AVVideoRect *)av_video_hint_rects(info);
     nb_rects = info->nb_rects;
 
-    mbinfo = av_calloc(mb_width * mb_height, sizeof(*mbinfo));
+    mbinfo = prop_buf_get(&x4->mb_info_pool, &x4->mb_info_pool_size, mb_width * mb_height * sizeof(*mbinfo));
     if (!mbinfo)
         return AVERROR(ENOMEM);
 
@@ -387,7 +433,7 @@ static int setup_mb_info(AVCodecContext *ctx, x264_picture_t *pic,
     }
 
     pic->prop.mb_info = mbinfo;
-    pic->prop.mb_info_free = av_free;
+    pic->prop.mb_info_free = prop_buf_free;
 
     return 0;
 }
@@ -427,9 +473,10 @@ static int setup_roi(AVCodecContext *ctx, x264_picture_t *pic,
     }
     nb_rois = size / roi_size;
 
-    qoffsets = av_calloc(mbx * mby, sizeof(*qoffsets));
+    qoffsets = prop_buf_get(&x4->qoffsets_pool, &x4->qoffsets_pool_size, mbx * mby * sizeof(*qoffsets));
     if (!qoffsets)
         return AVERROR(ENOMEM);
+    memset(qoffsets, 0, mbx * mby * sizeof(*qoffsets));
 
     // This list must be iterated in reverse because the first
     // region in the list applies when regions overlap.
@@ -445,7 +492,7 @@ static int setup_roi(AVCodecContext *ctx, x264_picture_t *pic,
         endx   = FFMIN(mbx, (roi->right + MB_SIZE - 1)/ MB_SIZE);
 
         if (roi->qoffset.den == 0) {
-            av_free(qoffsets);
+            prop_buf_free(qoffsets);
             av_log(ctx, AV_LOG_ERROR, "AVRegionOfInterest.qoffset.den must not be zero.\n");
             return AVERROR(EINVAL);
         }
@@ -460,7 +507,7 @@ static int setup_roi(AVCodecContext *ctx, x264_picture_t *pic,
     }
 
     pic->prop.quant_offsets = qoffsets;
-    pic->prop.quant_offsets_free = av_free;
+    pic->prop.quant_offsets_free = prop_buf_free;
 
     return 0;
 }
@@ -778,6 +825,9 @@ static av_cold int X264_close(AVCodecContext *avctx)
         x4->enc = NULL;
     }
 
+    av_buffer_pool_uninit(&x4->qoffsets_pool);
+    av_buffer_pool_uninit(&x4->mb_info_pool);
+
     return 0;
 }
 
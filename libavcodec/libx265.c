@@ -74,6 +74,10 @@ typedef struct libx265Context {
     ReorderedData *rd;
     int         nb_rd;
 
+    /* x265 copies the offsets on encode, so one table is reused */
+    float        *qoffsets;
+    unsigned int  qoffsets_size;
+
     /**
      * If the encoder does not support ROI then warn the first time we
      * encounter a frame with ROI side data.
@@ -138,6 +142,7 @@ static av_cold int libx265_encode_close(AVCodecContext *avctx)
 
     ctx->api->param_free(ctx->params);
     av_freep(&ctx->sei_data);
+    av_freep(&ctx->qoffsets);
 
     for (int i = 0; i < ctx->nb_rd; i++)
         rd_release(ctx, i);
@@ -590,7 +595,7 @@ static av_cold int libx265_encode_set_roi(libx265Context *ctx, const AVFrame *fr
             int nb_rois;
             const AVRegionOfInterest *roi;
             uint32_t roi_size;
-            float *qoffsets;         /* will be freed after encode is called. */
+            float *qoffsets;
 
             roi = (const AVRegionOfInterest*)sd->data;
             roi_size = roi->self_size;
@@ -600,9 +605,11 @@ static av_cold int libx265_encode_set_roi(libx265Context *ctx, const AVFrame *fr
             }
             nb_rois = sd->size / roi_size;
 
-            qoffsets = av_calloc(mbx * mby, sizeof(*qoffsets));
+            av_fast_malloc(&ctx->qoffsets, &ctx->qoffsets_size, mbx * mby * sizeof(*qoffsets));
+            qoffsets = ctx->qoffsets;
             if (!qoffsets)
                 return AVERROR(ENOMEM);
+            memset(qoffsets, 0, mbx * mby * sizeof(*qoffsets));
 
             // This list must be iterated in reverse because the first
             // region in the list applies when regions overlap.
@@ -618,7 +625,6 @@ static av_cold int libx265_encode_set_roi(libx265Context *ctx, const AVFrame *fr
                 endx   = FFMIN(mbx, (roi->right + mb_size - 1)/ mb_size);
 
                 if (roi->qoffset.den == 0) {
-                    av_free(qoffsets);
                     av_log(ctx, AV_LOG_ERROR, "AVRegionOfInterest.qoffset.den must not be zero.\n");
                     return AVERROR(EINVAL);
                 }
@@ -636,11 +642,19 @@ static av_cold int libx265_encode_set_roi(libx265Context *ctx, const AVFrame *fr
     return 0;
 }
 
+/* Unregistered user data payloads point into the frame side data, only
+ * the generated A/53 payloads are owned here. */
+static void free_sei_payloads(x265_sei *sei)
+{
+    for (int i = 0; i < sei->numPayloads; i++)
+        if (sei->payloads[i].payloadType == SEI_TYPE_USER_DATA_REGISTERED_ITU_T_T35)
+            av_free(sei->payloads[i].payload);
+}
+
 static void free_picture(libx265Context *ctx, x265_picture *pic)
 {
     x265_sei *sei = &pic->userSEI;
-    for (int i = 0; i < sei->numPayloads; i++)
-        av_free(sei->payloads[i].payload);
+    free_sei_payloads(sei);
 
 #if X265_BUILD >= 167
     av_free(pic->rpu.payload);
@@ -652,7 +666,7 @@ static void free_picture(libx265Context *ctx, x265_picture *pic)
         pic->userData = NULL;
     }
 
-    av_freep(&pic->quantOffsets);
+    pic->quantOffsets = NULL;
     sei->numPayloads = 0;
 }
 
@@ -773,11 +787,7 @@ static int libx265_encode_frame(AVCodecContext *avctx, AVPacket *pkt,
                 ctx->sei_data = tmp;
                 sei->payloads = ctx->sei_data;
                 sei_payload = &sei->payloads[sei->numPayloads];
-                sei_payload->payload = av_memdup(side_data->data, side_data->size);
-                if (!sei_payload->payload) {
-                    free_picture(ctx, &x265pic);
-                    return AVERROR(ENOMEM);
-                }
+                sei_payload->payload = side_data->data;
                 sei_payload->payloadSize = side_data->size;
                 /* Equal to libx265 USER_DATA_UNREGISTERED */
                 sei_payload->payloadType = SEI_TYPE_USER_DATA_UNREGISTERED;
@@ -816,9 +826,7 @@ static int libx265_encode_frame(AVCodecContext *avctx, AVPacket *pkt,
                                    pic ? &x265pic : NULL, &x265pic_solo_out);
 #endif
 
-    for (i = 0; i < sei->numPayloads; i++)
-        av_free(sei->payloads[i].payload);
-    av_freep(&x265pic.quantOffsets);
+    free_sei_payloads(sei);
 
     if (ret < 0)
         return AVERROR_EXTERNAL;
@@ -402,7 +402,7 @@ static int encode_table(AVCodecContext *avctx,
         PTable *slice_counts = sl->counts;
 
         for (int i = 0; i < 256; i++)
-            counts[i].prob = slice_counts[i].prob;
+            counts[i].prob += slice_counts[i].prob;
     }
 
     for (int i = 0; i < 256; i++) {
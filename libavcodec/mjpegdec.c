@@ -781,10 +781,11 @@ int ff_mjpeg_decode_sof(MJpegDecodeContext *s)
     return 0;
 }
 
-static inline int mjpeg_decode_dc(MJpegDecodeContext *s, int dc_index)
+static inline int mjpeg_decode_dc(MJpegDecodeContext *s, GetBitContext *gb,
+                                  int dc_index)
 {
     int code;
-    code = get_vlc2(&s->gb, s->vlcs[0][dc_index].table, 9, 2);
+    code = get_vlc2(gb, s->vlcs[0][dc_index].table, 9, 2);
     if (code < 0 || code > 16) {
         av_log(s->avctx, AV_LOG_WARNING,
                "mjpeg_decode_dc: bad vlc: %d:%d (%p)\n",
@@ -793,46 +794,47 @@ static inline int mjpeg_decode_dc(MJpegDecodeContext *s, int dc_index)
     }
 
     if (code)
-        return get_xbits(&s->gb, code);
+        return get_xbits(gb, code);
     else
         return 0;
 }
 
 /* decode block and dequantize */
-static int decode_block(MJpegDecodeContext *s, int16_t *block, int component,
+static int decode_block(MJpegDecodeContext *s, GetBitContext *gb, int *last_dc,
+                        int16_t *block, int component,
                         int dc_index, int ac_index, uint16_t *quant_matrix)
 {
     int code, i, j, level, val;
 
     /* DC coef */
-    val = mjpeg_decode_dc(s, dc_index);
+    val = mjpeg_decode_dc(s, gb, dc_index);
     if (val == 0xfffff) {
         av_log(s->avctx, AV_LOG_ERROR, "error dc\n");
         return AVERROR_INVALIDDATA;
     }
-    val = val * (unsigned)quant_matrix[0] + s->last_dc[component];
-    s->last_dc[component] = val;
+    val = val * (unsigned)quant_matrix[0] + last_dc[component];
+    last_dc[component] = val;
     block[0] = av_clip_int16(val);
     /* AC coefs */
     i = 0;
-    {OPEN_READER(re, &s->gb);
+    {OPEN_READER(re, gb);
     do {
-        UPDATE_CACHE(re, &s->gb);
-        GET_VLC(code, re, &s->gb, s->vlcs[1][ac_index].table, 9, 2);
+        UPDATE_CACHE(re, gb);
+        GET_VLC(code, re, gb, s->vlcs[1][ac_index].table, 9, 2);
 
         i += ((unsigned)code) >> 4;
             code &= 0xf;
         if (code) {
             if (code > MIN_CACHE_BITS - 16)
-                UPDATE_CACHE(re, &s->gb);
+                UPDATE_CACHE(re, gb);
 
             {
-                int cache = GET_CACHE(re, &s->gb);
+                int cache = GET_CACHE(re, gb);
                 int sign  = (~cache) >> 31;
                 level     = (NEG_USR32(sign ^ cache,code) ^ sign) - sign;
             }
 
-            LAST_SKIP_BITS(re, &s->gb, code);
+            LAST_SKIP_BITS(re, gb, code);
 
             if (i > 63) {
                 av_log(s->avctx, AV_LOG_ERROR, "error count: %d\n", i);
@@ -842,7 +844,7 @@ static int decode_block(MJpegDecodeContext *s, int16_t *block, int component,
             block[j] = level * quant_matrix[i];
         }
     } while (i < 63);
-    CLOSE_READER(re, &s->gb);}
+    CLOSE_READER(re, gb);}
 
     return 0;
 }
@@ -853,7 +855,7 @@ static int decode_dc_progressive(MJpegDecodeContext *s, int16_t *block,
 {
     unsigned val;
     s->bdsp.clear_block(block);
-    val = mjpeg_decode_dc(s, dc_index);
+    val = mjpeg_decode_dc(s, &s->gb, dc_index);
     if (val == 0xfffff) {
         av_log(s->avctx, AV_LOG_ERROR, "error dc\n");
         return AVERROR_INVALIDDATA;
@@ -1144,7 +1146,7 @@ static int ljpeg_decode_rgb_scan(MJpegDecodeContext *s, int nb_components, int p
                 topleft[i] = top[i];
                 top[i]     = buffer[mb_x][i];
 
-                dc = mjpeg_decode_dc(s, s->dc_index[i]);
+                dc = mjpeg_decode_dc(s, &s->gb, s->dc_index[i]);
                 if(dc == 0xFFFFF)
                     return -1;
 
@@ -1278,7 +1280,7 @@ static int ljpeg_decode_yuv_scan(MJpegDecodeContext *s, int predictor,
                     for(j=0; j<n; j++) {
                         int pred, dc;
 
-                        dc = mjpeg_decode_dc(s, s->dc_index[i]);
+                        dc = mjpeg_decode_dc(s, &s->gb, s->dc_index[i]);
                         if(dc == 0xFFFFF)
                             return -1;
                         if (   h * mb_x + x >= s->width
@@ -1345,7 +1347,7 @@ static int ljpeg_decode_yuv_scan(MJpegDecodeContext *s, int predictor,
                     for (j = 0; j < n; j++) {
                         int pred;
 
-                        dc = mjpeg_decode_dc(s, s->dc_index[i]);
+                        dc = mjpeg_decode_dc(s, &s->gb, s->dc_index[i]);
                         if(dc == 0xFFFFF)
                             return -1;
                         if (   h * mb_x + x >= s->width
@@ -1414,17 +1416,205 @@ static void shift_output(MJpegDecodeContext *s, uint8_t *ptr, int linesize)
     }
 }
 
+typedef struct ScanContext {
+    uint8_t *data[MAX_COMPONENTS];
+    int linesize[MAX_COMPONENTS];
+    int chroma_width, chroma_height;
+    int nb_components;
+    int bytes_per_pixel;
+} ScanContext;
+
+/* decode and IDCT all blocks of one sequential DCT MCU */
+static int decode_mcu(MJpegDecodeContext *s, const ScanContext *sc,
+                      GetBitContext *gb, int *last_dc, int16_t *block,
+                      int mb_x, int mb_y)
+{
+    for (int i = 0; i < sc->nb_components; i++) {
+        const int c = s->comp_index[i];
+        const int h = s->h_scount[i];
+        const int v = s->v_scount[i];
+        const int linesize = sc->linesize[c];
+        int x = 0, y = 0;
+
+        for (int j = 0; j < s->nb_blocks[i]; j++) {
+            s->bdsp.clear_block(block);
+            if (decode_block(s, gb, last_dc, block, i,
+                             s->dc_index[i], s->ac_index[i],
+                             s->quant_matrixes[s->quant_sindex[i]]) < 0) {
+                av_log(s->avctx, AV_LOG_ERROR,
+                       "error y=%d x=%d\n", mb_y, mb_x);
+                return AVERROR_INVALIDDATA;
+            }
+            if (   8*(h * mb_x + x) < ((c == 1) || (c == 2) ? sc->chroma_width  : s->width)
+                && 8*(v * mb_y + y) < ((c == 1) || (c == 2) ? sc->chroma_height : s->height)
+                && linesize) {
+                uint8_t *ptr = sc->data[c] +
+                               (((linesize * (v * mb_y + y) * 8) +
+                                 (h * mb_x + x) * 8 * sc->bytes_per_pixel) >> s->avctx->lowres);
+
+                s->idsp.idct_put(ptr, linesize, block);
+                if (s->bits & 7)
+                    shift_output(s, ptr, linesize);
+            }
+            if (++x == h) {
+                x = 0;
+                y++;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Split the entropy-coded data of the current scan at its restart markers,
+ * unescaping it into s->slice_buffer.
+ *
+ * @return the number of restart intervals found, or a negative error code
+ */
+static int split_restart_intervals(MJpegDecodeContext *s, int nb_intervals)
+{
+    const int bytes_to_start = get_bits_count(&s->gb) / 8;
+    const uint8_t *src, *end;
+    uint8_t *dst;
+    int n = 0;
+
+    if (!s->raw_scan_buffer || bytes_to_start < 0 ||
+        s->raw_scan_buffer_size < bytes_to_start)
+        return AVERROR_INVALIDDATA;
+    src = s->raw_scan_buffer + bytes_to_start;
+    end = s->raw_scan_buffer + s->raw_scan_buffer_size;
+
+    av_fast_padded_malloc(&s->slice_buffer, &s->slice_buffer_size, end - src);
+    if (!s->slice_buffer)
+        return AVERROR(ENOMEM);
+    if (av_reallocp_array(&s->slice_offset, nb_intervals + 1, sizeof(*s->slice_offset)) < 0 ||
+        av_reallocp_array(&s->slice_ret,    nb_intervals,     sizeof(*s->slice_ret)) < 0)
+        return AVERROR(ENOMEM);
+
+    dst = s->slice_buffer;
+    s->slice_offset[0] = 0;
+    while (src < end) {
+        const uint8_t *ff = memchr(src, 0xff, end - src);
+        uint8_t x;
+
+        if (!ff)
+            ff = end;
+        memcpy(dst, src, ff - src);
+        dst += ff - src;
+        src  = ff + 1;
+        while (src < end && *src == 0xff)
+            src++;
+        if (src >= end)
+            break;
+
+        x = *src++;
+        if (!x) {
+            *dst++ = 0xff;
+        } else if (x >= RST0 && x <= RST7) {
+            if (++n >= nb_intervals)
+                return AVERROR_INVALIDDATA;
+            s->slice_offset[n] = dst - s->slice_buffer;
+        } else {
+            break;
+        }
+    }
+    s->slice_offset[++n] = dst - s->slice_buffer;
+    memset(dst, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+
+    return n;
+}
+
+static int decode_restart_interval(AVCodecContext *avctx, void *arg,
+                                   int jobnr, int threadnr)
+{
+    MJpegDecodeContext *s = avctx->priv_data;
+    const ScanContext *sc = arg;
+    const int nb_mbs = s->mb_width * s->mb_height;
+    const int start  = jobnr * s->restart_interval;
+    const int end    = FFMIN(start + s->restart_interval, nb_mbs);
+    int last_dc[MAX_COMPONENTS];
+    GetBitContext gb;
+    int ret;
+
+    ret = init_get_bits8(&gb, s->slice_buffer + s->slice_offset[jobnr],
+                         s->slice_offset[jobnr + 1] - s->slice_offset[jobnr]);
+    if (ret < 0)
+        return ret;
+
+    for (int i = 0; i < sc->nb_components; i++)
+        last_dc[i] = 4 << s->bits;
+
+    for (int mb = start; mb < end; mb++) {
+        if (get_bits_left(&gb) < 0) {
+            av_log(avctx, AV_LOG_ERROR, "overread %d\n", -get_bits_left(&gb));
+            return AVERROR_INVALIDDATA;
+        }
+        ret = decode_mcu(s, sc, &gb, last_dc, s->slice_blocks[threadnr],
+                         mb % s->mb_width, mb / s->mb_width);
+        if (ret < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+/**
+ * Decode a sequential DCT scan with restart markers by handing every restart
+ * interval to a different slice thread; each interval starts with reset DC
+ * predictors and is byte aligned, so they are independent.
+ *
+ * @return 1 if the scan was decoded, 0 if it has to be decoded serially
+ */
+static int decode_scan_threaded(MJpegDecodeContext *s, const ScanContext *sc)
+{
+    AVCodecContext *avctx = s->avctx;
+    const int nb_mbs = s->mb_width * s->mb_height;
+    int nb_intervals, ret;
+
+    if (!(avctx->active_thread_type & FF_THREAD_SLICE) || avctx->thread_count <= 1 ||
+        !s->restart_interval || avctx->codec_id == AV_CODEC_ID_THP)
+        return 0;
+
+    nb_intervals = (nb_mbs + s->restart_interval - 1) / s->restart_interval;
+    if (nb_intervals < 2)
+        return 0;
+
+    ret = split_restart_intervals(s, nb_intervals);
+    if (ret == AVERROR(ENOMEM))
+        return ret;
+    if (ret != nb_intervals) {
+        av_log(avctx, AV_LOG_DEBUG, "Restart markers missing, decoding serially\n");
+        return 0;
+    }
+
+    if (!s->slice_blocks) {
+        s->slice_blocks = av_malloc_array(avctx->thread_count, sizeof(*s->slice_blocks));
+        if (!s->slice_blocks)
+            return AVERROR(ENOMEM);
+    }
+
+    avctx->execute2(avctx, decode_restart_interval, (void *)sc, s->slice_ret, nb_intervals);
+    for (int i = 0; i < nb_intervals; i++)
+        if (s->slice_ret[i] < 0)
+            return s->slice_ret[i];
+
+    skip_bits_long(&s->gb, get_bits_left(&s->gb));
+    return 1;
+}
+
 static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
                              int Al, const uint8_t *mb_bitmask,
                              int mb_bitmask_size,
                              const AVFrame *reference)
 {
-    int i, mb_x, mb_y, chroma_h_shift, chroma_v_shift, chroma_width, chroma_height;
-    uint8_t *data[MAX_COMPONENTS];
+    int i, mb_x, mb_y, chroma_h_shift, chroma_v_shift, ret;
     const uint8_t *reference_data[MAX_COMPONENTS];
-    int linesize[MAX_COMPONENTS];
     GetBitContext mb_bitmask_gb = {0}; // initialize to silence gcc warning
-    int bytes_per_pixel = 1 + (s->bits > 8);
+    ScanContext sc = {
+        .nb_components   = nb_components,
+        .bytes_per_pixel = 1 + (s->bits > 8),
+    };
 
     if (mb_bitmask) {
         if (mb_bitmask_size != (s->mb_width * s->mb_height + 7)>>3) {
@@ -1438,17 +1628,23 @@ static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
 
     av_pix_fmt_get_chroma_sub_sample(s->avctx->pix_fmt, &chroma_h_shift,
                                      &chroma_v_shift);
-    chroma_width  = AV_CEIL_RSHIFT(s->width,  chroma_h_shift);
-    chroma_height = AV_CEIL_RSHIFT(s->height, chroma_v_shift);
+    sc.chroma_width  = AV_CEIL_RSHIFT(s->width,  chroma_h_shift);
+    sc.chroma_height = AV_CEIL_RSHIFT(s->height, chroma_v_shift);
 
     for (i = 0; i < nb_components; i++) {
         int c   = s->comp_index[i];
-        data[c] = s->picture_ptr->data[c];
+        sc.data[c] = s->picture_ptr->data[c];
         reference_data[c] = reference ? reference->data[c] : NULL;
-        linesize[c] = s->linesize[c];
+        sc.linesize[c] = s->linesize[c];
         s->coefs_finished[c] |= 1;
     }
 
+    if (!s->progressive && !mb_bitmask) {
+        ret = decode_scan_threaded(s, &sc);
+        if (ret)
+            return FFMIN(ret, 0);
+    }
+
     for (mb_y = 0; mb_y < s->mb_height; mb_y++) {
         for (mb_x = 0; mb_x < s->mb_width; mb_x++) {
             const int copy_mb = mb_bitmask && !get_bits1(&mb_bitmask_gb);
@@ -1461,6 +1657,13 @@ static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
                        -get_bits_left(&s->gb));
                 return AVERROR_INVALIDDATA;
             }
+            if (!s->progressive && !copy_mb) {
+                ret = decode_mcu(s, &sc, &s->gb, s->last_dc, s->block, mb_x, mb_y);
+                if (ret < 0)
+                    return ret;
+                handle_rstn(s, nb_components);
+                continue;
+            }
             for (i = 0; i < nb_components; i++) {
                 uint8_t *ptr;
                 int n, h, v, x, y, c, j;
@@ -1472,35 +1675,18 @@ static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
                 x = 0;
                 y = 0;
                 for (j = 0; j < n; j++) {
-                    block_offset = (((linesize[c] * (v * mb_y + y) * 8) +
-                                     (h * mb_x + x) * 8 * bytes_per_pixel) >> s->avctx->lowres);
+                    block_offset = (((sc.linesize[c] * (v * mb_y + y) * 8) +
+                                     (h * mb_x + x) * 8 * sc.bytes_per_pixel) >> s->avctx->lowres);
 
-                    if (   8*(h * mb_x + x) < ((c == 1) || (c == 2) ? chroma_width  : s->width)
-                        && 8*(v * mb_y + y) < ((c == 1) || (c == 2) ? chroma_height : s->height)) {
-                        ptr = data[c] + block_offset;
+                    if (   8*(h * mb_x + x) < ((c == 1) || (c == 2) ? sc.chroma_width  : s->width)
+                        && 8*(v * mb_y + y) < ((c == 1) || (c == 2) ? sc.chroma_height : s->height)) {
+                        ptr = sc.data[c] + block_offset;
                     } else
                         ptr = NULL;
                     if (!s->progressive) {
-                        if (copy_mb) {
-                            if (ptr)
-                                mjpeg_copy_block(s, ptr, reference_data[c] + block_offset,
-                                                linesize[c], s->avctx->lowres);
-
-                        } else {
-                            s->bdsp.clear_block(s->block);
-                            if (decode_block(s, s->block, i,
-                                             s->dc_index[i], s->ac_index[i],
-                                             s->quant_matrixes[s->quant_sindex[i]]) < 0) {
-                                av_log(s->avctx, AV_LOG_ERROR,
-                                       "error y=%d x=%d\n", mb_y, mb_x);
-                                return AVERROR_INVALIDDATA;
-                            }
-                            if (ptr && linesize[c]) {
-                                s->idsp.idct_put(ptr, linesize[c], s->block);
-                                if (s->bits & 7)
-                                    shift_output(s, ptr, linesize[c]);
-                            }
-                        }
+                        if (ptr)
+                            mjpeg_copy_block(s, ptr, reference_data[c] + block_offset,
+                                             sc.linesize[c], s->avctx->lowres);
                     } else {
                         int block_idx  = s->block_stride[c] * (v * mb_y + y) +
                                          (h * mb_x + x);
@@ -2881,6 +3067,10 @@ av_cold int ff_mjpeg_decode_end(AVCodecContext *avctx)
     av_frame_free(&s->smv_frame);
 
     av_freep(&s->buffer);
+    av_freep(&s->slice_buffer);
+    av_freep(&s->slice_offset);
+    av_freep(&s->slice_ret);
+    av_freep(&s->slice_blocks);
     av_freep(&s->stereo3d);
     av_freep(&s->ljpeg_buffer);
     s->ljpeg_buffer_size = 0;
@@ -2937,7 +3127,8 @@ const FFCodec ff_mjpeg_decoder = {
     .close          = ff_mjpeg_decode_end,
     FF_CODEC_DECODE_CB(ff_mjpeg_decode_frame),
     .flush          = decode_flush,
-    .p.capabilities = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_FRAME_THREADS,
+    .p.capabilities = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_FRAME_THREADS |
+                      AV_CODEC_CAP_SLICE_THREADS,
     .p.max_lowres   = 3,
     .p.priv_class   = &mjpegdec_class,
     .p.profiles     = NULL_IF_CONFIG_SMALL(ff_mjpeg_profiles),
@@ -122,6 +122,13 @@ typedef struct MJpegDecodeContext {
     int restart_interval;
     int restart_count;
 
+    /* restart interval slice threading */
+    uint8_t *slice_buffer;          ///< unescaped scan data
+    unsigned int slice_buffer_size;
+    int *slice_offset;              ///< start of each interval in slice_buffer
+    int *slice_ret;
+    int16_t (*slice_blocks)[64];    ///< one block per thread
+
     int buggy_avid;
     int cs_itu601;
     int interlace_polarity;
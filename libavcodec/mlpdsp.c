@@ -24,31 +24,50 @@
 #include "mlpdsp.h"
 #include "mlp.h"
 
-static void mlp_filter_channel(int32_t *state, const int32_t *coeff,
-                               int firorder, int iirorder,
-                               unsigned int filter_shift, int32_t mask,
-                               int blocksize, int32_t *sample_buffer)
+/* The most recent filter outputs are kept in locals so that, with the
+ * orders known at compile time, the recursion does not go through memory. */
+static av_always_inline void filter_channel_template(int32_t *state, const int32_t *coeff,
+                                                     int firorder, int iirorder,
+                                                     unsigned int filter_shift, int32_t mask,
+                                                     int blocksize, int32_t *sample_buffer)
 {
     int32_t *firbuf = state;
     int32_t *iirbuf = state + MAX_BLOCKSIZE + MAX_FIR_ORDER;
-    const int32_t *fircoeff = coeff;
-    const int32_t *iircoeff = coeff + MAX_FIR_ORDER;
-    int i;
+    int32_t fircoeff[MAX_FIR_ORDER], firhist[MAX_FIR_ORDER];
+    int32_t iircoeff[MAX_IIR_ORDER], iirhist[MAX_IIR_ORDER];
+    int i, order;
+
+    for (order = 0; order < firorder; order++) {
+        fircoeff[order] = coeff[order];
+        firhist[order]  = firbuf[order];
+    }
+    for (order = 0; order < iirorder; order++) {
+        iircoeff[order] = coeff[MAX_FIR_ORDER + order];
+        iirhist[order]  = iirbuf[order];
+    }
 
     for (i = 0; i < blocksize; i++) {
         int32_t residual = *sample_buffer;
-        unsigned int order;
         int64_t accum = 0;
         int32_t result;
 
         for (order = 0; order < firorder; order++)
-            accum += (int64_t) firbuf[order] * fircoeff[order];
+            accum += (int64_t) firhist[order] * fircoeff[order];
         for (order = 0; order < iirorder; order++)
-            accum += (int64_t) iirbuf[order] * iircoeff[order];
+            accum += (int64_t) iirhist[order] * iircoeff[order];
 
         accum  = accum >> filter_shift;
         result = (accum + residual) & mask;
 
+        for (order = firorder - 1; order > 0; order--)
+            firhist[order] = firhist[order - 1];
+        for (order = iirorder - 1; order > 0; order--)
+            iirhist[order] = iirhist[order - 1];
+        if (firorder)
+            firhist[0] = result;
+        if (iirorder)
+            iirhist[0] = result - accum;
+
         *--firbuf = result;
         *--iirbuf = result - accum;
 
@@ -57,6 +76,39 @@ static void mlp_filter_channel(int32_t *state, const int32_t *coeff,
     }
 }
 
+#define FILTER_CHANNEL_IIR(fir)                                                 \
+    switch (iirorder) {                                                         \
+    case 0: filter_channel_template(state, coeff, fir, 0, filter_shift,         \
+                                    mask, blocksize, sample_buffer); return;    \
+    case 1: filter_channel_template(state, coeff, fir, 1, filter_shift,         \
+                                    mask, blocksize, sample_buffer); return;    \
+    case 2: filter_channel_template(state, coeff, fir, 2, filter_shift,         \
+                                    mask, blocksize, sample_buffer); return;    \
+    case 3: filter_channel_template(state, coeff, fir, 3, filter_shift,         \
+                                    mask, blocksize, sample_buffer); return;    \
+    case 4: filter_channel_template(state, coeff, fir, 4, filter_shift,         \
+                                    mask, blocksize, sample_buffer); return;    \
+    }                                                                           \
+    break
+
+static void mlp_filter_channel(int32_t *state, const int32_t *coeff,
+                               int firorder, int iirorder,
+                               unsigned int filter_shift, int32_t mask,
+                               int blocksize, int32_t *sample_buffer)
+{
+    switch (firorder) {
+    case 0: FILTER_CHANNEL_IIR(0);
+    case 1: FILTER_CHANNEL_IIR(1);
+    case 2: FILTER_CHANNEL_IIR(2);
+    case 3: FILTER_CHANNEL_IIR(3);
+    case 4: FILTER_CHANNEL_IIR(4);
+    case 5: FILTER_CHANNEL_IIR(5);
+    case 6: FILTER_CHANNEL_IIR(6);
+    case 7: FILTER_CHANNEL_IIR(7);
+    case 8: FILTER_CHANNEL_IIR(8);
+    }
+}
+
 void ff_mlp_rematrix_channel(int32_t *samples,
                              const int32_t *coeffs,
                              const uint8_t *bypassed_lsbs,
@@ -35,6 +35,7 @@
 #include "libavutil/mem.h"
 #include "libavutil/pixdesc.h"
 #include "libavutil/mathematics.h"
+#include "libavutil/time.h"
 #include "atsc_a53.h"
 #include "codec_desc.h"
 #include "encode.h"
@@ -1017,7 +1018,12 @@ static av_cold int nvenc_recalc_surfaces(AVCodecContext *avctx)
     }
 
     ctx->nb_surfaces = FFMAX(1, FFMIN(MAX_REGISTERED_FRAMES, ctx->nb_surfaces));
-    ctx->async_depth = FFMIN(ctx->async_depth, ctx->nb_surfaces - 1);
+    if (ctx->async_depth == NVENC_DELAY_AUTO) {
+        ctx->auto_async_depth = 1;
+        ctx->async_depth = FFMIN(1, ctx->nb_surfaces - 1);
+    } else {
+        ctx->async_depth = FFMIN(ctx->async_depth, ctx->nb_surfaces - 1);
+    }
 
     // Output in the worst case will only start when the surface buffer is completely full.
     // Hence we need to keep at least the max amount of surfaces plus the max reorder delay around.
@@ -1135,7 +1141,8 @@ static av_cold int nvenc_setup_rate_control(AVCodecContext *avctx)
     }
 
     if (ctx->rc_lookahead > 0) {
-        int lkd_bound = FFMIN(ctx->nb_surfaces, ctx->async_depth) -
+        int max_depth = ctx->auto_async_depth ? ctx->nb_surfaces - 1 : ctx->async_depth;
+        int lkd_bound = FFMIN(ctx->nb_surfaces, max_depth) -
                         ctx->encode_config.frameIntervalP - 4;
 
         if (lkd_bound < 0) {
@@ -2001,6 +2008,8 @@ av_cold int ff_nvenc_encode_close(AVCodecContext *avctx)
         }
         ctx->nb_registered_frames = 0;
     }
+    av_freep(&ctx->registered_frames);
+    ctx->max_registered_frames = 0;
 
     if (ctx->surfaces) {
         for (i = 0; i < ctx->nb_surfaces; ++i) {
@@ -2145,33 +2154,41 @@ static int nvenc_find_free_reg_resource(AVCodecContext *avctx)
     NvencContext *ctx = avctx->priv_data;
     NvencDynLoadFunctions *dl_fn = &ctx->nvenc_dload_funcs;
     NV_ENCODE_API_FUNCTION_LIST *p_nvenc = &dl_fn->nvenc_funcs;
+    NvencRegisteredFrame *reg;
     NVENCSTATUS nv_status;
+    int i, lru = -1;
 
-    int i, first_round;
-
-    if (ctx->nb_registered_frames == FF_ARRAY_ELEMS(ctx->registered_frames)) {
-        for (first_round = 1; first_round >= 0; first_round--) {
-            for (i = 0; i < ctx->nb_registered_frames; i++) {
-                if (!ctx->registered_frames[i].mapped) {
-                    if (ctx->registered_frames[i].regptr) {
-                        if (first_round)
-                            continue;
-                        nv_status = p_nvenc->nvEncUnregisterResource(ctx->nvencoder, ctx->registered_frames[i].regptr);
-                        if (nv_status != NV_ENC_SUCCESS)
-                            return nvenc_print_error(avctx, nv_status, "Failed unregistering unused input resource");
-                        ctx->registered_frames[i].ptr = NULL;
-                        ctx->registered_frames[i].regptr = NULL;
-                    }
-                    return i;
-                }
-            }
-        }
-    } else {
+    if (ctx->nb_registered_frames < ctx->max_registered_frames) {
+        reg = av_realloc_array(ctx->registered_frames, ctx->nb_registered_frames + 1,
+                               sizeof(*ctx->registered_frames));
+        if (!reg)
+            return AVERROR(ENOMEM);
+        ctx->registered_frames = reg;
+        memset(&reg[ctx->nb_registered_frames], 0, sizeof(*reg));
         return ctx->nb_registered_frames++;
     }
 
-    av_log(avctx, AV_LOG_ERROR, "Too many registered CUDA frames\n");
-    return AVERROR(ENOMEM);
+    /* evict the least recently used resource that is not currently mapped */
+    for (i = 0; i < ctx->nb_registered_frames; i++) {
+        reg = &ctx->registered_frames[i];
+        if (!reg->mapped && (lru < 0 || reg->last_used < ctx->registered_frames[lru].last_used))
+            lru = i;
+    }
+
+    if (lru < 0) {
+        av_log(avctx, AV_LOG_ERROR, "Too many registered CUDA frames\n");
+        return AVERROR(ENOMEM);
+    }
+
+    reg = &ctx->registered_frames[lru];
+    if (reg->regptr) {
+        nv_status = p_nvenc->nvEncUnregisterResource(ctx->nvencoder, reg->regptr);
+        if (nv_status != NV_ENC_SUCCESS)
+            return nvenc_print_error(avctx, nv_status, "Failed unregistering unused input resource");
+    }
+    memset(reg, 0, sizeof(*reg));
+
+    return lru;
 }
 
 static int nvenc_register_frame(AVCodecContext *avctx, const AVFrame *frame)
@@ -2185,12 +2202,21 @@ static int nvenc_register_frame(AVCodecContext *avctx, const AVFrame *frame)
     int i, idx, ret;
 
     for (i = 0; i < ctx->nb_registered_frames; i++) {
-        if (avctx->pix_fmt == AV_PIX_FMT_CUDA && ctx->registered_frames[i].ptr == frame->data[0])
-            return i;
-        else if (avctx->pix_fmt == AV_PIX_FMT_D3D11 && ctx->registered_frames[i].ptr == frame->data[0] && ctx->registered_frames[i].ptr_index == (intptr_t)frame->data[1])
-            return i;
+        NvencRegisteredFrame *r = &ctx->registered_frames[i];
+
+        if (r->ptr != frame->data[0] || r->pitch != frame->linesize[0])
+            continue;
+        if (avctx->pix_fmt == AV_PIX_FMT_D3D11 && r->ptr_index != (intptr_t)frame->data[1])
+            continue;
+
+        r->last_used = ++ctx->registered_frames_clock;
+        return i;
     }
 
+    /* keep every frame of a fixed size pool registered */
+    ctx->max_registered_frames = FFMAX3(ctx->max_registered_frames, MAX_REGISTERED_FRAMES,
+                                        frames_ctx->initial_pool_size + ctx->nb_surfaces);
+
     idx = nvenc_find_free_reg_resource(avctx);
     if (idx < 0)
         return idx;
@@ -2224,7 +2250,9 @@ static int nvenc_register_frame(AVCodecContext *avctx, const AVFrame *frame)
 
     ctx->registered_frames[idx].ptr       = frame->data[0];
     ctx->registered_frames[idx].ptr_index = reg.subResourceIndex;
+    ctx->registered_frames[idx].pitch     = frame->linesize[0];
     ctx->registered_frames[idx].regptr    = reg.registeredResource;
+    ctx->registered_frames[idx].last_used = ++ctx->registered_frames_clock;
     return idx;
 }
 
@@ -2459,6 +2487,33 @@ static int nvenc_retrieve_frame_data(AVCodecContext *avctx, NV_ENC_LOCK_BITSTREA
     return res;
 }
 
+/* A bitstream lock that had to wait for the hardware means the output was
+ * requested too early, while a long run of locks that returned immediately
+ * means frames are held back longer than the encode latency requires. */
+#define NVENC_LOCK_WAIT_US 500
+
+static void nvenc_update_async_depth(AVCodecContext *avctx, int64_t lock_time)
+{
+    NvencContext *ctx = avctx->priv_data;
+
+    if (!ctx->auto_async_depth)
+        return;
+
+    if (lock_time > NVENC_LOCK_WAIT_US) {
+        ctx->nb_fast_locks = 0;
+        if (ctx->async_depth < ctx->nb_surfaces - 1) {
+            ctx->async_depth++;
+            av_log(avctx, AV_LOG_DEBUG, "Increasing output delay to %d\n", ctx->async_depth);
+        }
+    } else if (++ctx->nb_fast_locks >= ctx->nb_surfaces) {
+        ctx->nb_fast_locks = 0;
+        if (ctx->async_depth > 1) {
+            ctx->async_depth--;
+            av_log(avctx, AV_LOG_DEBUG, "Decreasing output delay to %d\n", ctx->async_depth);
+        }
+    }
+}
+
 static int process_output_surface(AVCodecContext *avctx, AVPacket *pkt, NvencSurface *tmpoutsurf)
 {
     NvencContext *ctx = avctx->priv_data;
@@ -2467,6 +2522,7 @@ static int process_output_surface(AVCodecContext *avctx, AVPacket *pkt, NvencSur
 
     NV_ENC_LOCK_BITSTREAM lock_params = { 0 };
     NVENCSTATUS nv_status;
+    int64_t lock_start;
     int res = 0;
 
     enum AVPictureType pict_type;
@@ -2476,11 +2532,13 @@ static int process_output_surface(AVCodecContext *avctx, AVPacket *pkt, NvencSur
     lock_params.doNotWait = 0;
     lock_params.outputBitstream = tmpoutsurf->output_surface;
 
+    lock_start = av_gettime_relative();
     nv_status = p_nvenc->nvEncLockBitstream(ctx->nvencoder, &lock_params);
     if (nv_status != NV_ENC_SUCCESS) {
         res = nvenc_print_error(avctx, nv_status, "Failed locking bitstream buffer");
         goto error;
     }
+    nvenc_update_async_depth(avctx, av_gettime_relative() - lock_start);
 
     res = ff_get_encode_buffer(avctx, pkt, lock_params.bitstreamSizeInBytes, 0);
 
@@ -39,6 +39,7 @@ typedef void ID3D11Device;
 #include "avcodec.h"
 
 #define MAX_REGISTERED_FRAMES 64
+#define NVENC_DELAY_AUTO -1
 #define RC_MODE_DEPRECATED 0x800000
 #define RCD(rc_mode) ((rc_mode) | RC_MODE_DEPRECATED)
 
@@ -106,6 +107,17 @@ typedef struct NvencSurface
     NV_ENC_BUFFER_FORMAT format;
 } NvencSurface;
 
+typedef struct NvencRegisteredFrame
+{
+    void *ptr;
+    int ptr_index;
+    int pitch;
+    NV_ENC_REGISTERED_PTR regptr;
+    int mapped;
+    uint64_t last_used;
+    NV_ENC_MAP_INPUT_RESOURCE in_map;
+} NvencRegisteredFrame;
+
 typedef struct NvencFrameData
 {
     int64_t duration;
@@ -213,14 +225,15 @@ typedef struct NvencContext
     NV_ENC_SEI_PAYLOAD *sei_data;
     int sei_data_size;
 
-    struct {
-        void *ptr;
-        int ptr_index;
-        NV_ENC_REGISTERED_PTR regptr;
-        int mapped;
-        NV_ENC_MAP_INPUT_RESOURCE in_map;
-    } registered_frames[MAX_REGISTERED_FRAMES];
+    /* cache of registered input resources, evicted in LRU order */
+    NvencRegisteredFrame *registered_frames;
     int nb_registered_frames;
+    int max_registered_frames;
+    uint64_t registered_frames_clock;
+
+    /* adaptive output delay, see nvenc_update_async_depth() */
+    int auto_async_depth;
+    int nb_fast_locks;
 
     /* the actual data pixel format, different from
      * AVCodecContext.pix_fmt when using hwaccel frames on input */
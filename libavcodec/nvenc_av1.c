@@ -102,7 +102,9 @@ static const AVOption options[] = {
     { "yuv444",       "Convert to yuv444",                  0,                    AV_OPT_TYPE_CONST, { .i64 = NVENC_RGB_MODE_444 },       0, 0, VE, .unit = "rgb_mode" },
     { "disabled",     "Disables support, throws an error.", 0,                    AV_OPT_TYPE_CONST, { .i64 = NVENC_RGB_MODE_DISABLED },  0, 0, VE, .unit = "rgb_mode" },
     { "delay",        "Delay frame output by the given amount of frames",
-                                                            OFFSET(async_depth),  AV_OPT_TYPE_INT,   { .i64 = INT_MAX }, 0, INT_MAX, VE },
+                                                            OFFSET(async_depth),  AV_OPT_TYPE_INT,   { .i64 = INT_MAX }, NVENC_DELAY_AUTO, INT_MAX, VE, .unit = "delay" },
+    { "auto",         "Adapt the delay to the measured encode latency",
+                                                            0,                    AV_OPT_TYPE_CONST, { .i64 = NVENC_DELAY_AUTO },     0, 0, VE, .unit = "delay" },
     { "rc-lookahead", "Number of frames to look ahead for rate-control",
                                                             OFFSET(rc_lookahead), AV_OPT_TYPE_INT,   { .i64 = 0 }, 0, INT_MAX, VE },
     { "cq",           "Set target quality level (0 to 63, 0 means automatic) for constant quality mode in VBR rate control",
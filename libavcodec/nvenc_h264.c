@@ -136,7 +136,9 @@ static const AVOption options[] = {
     { "yuv444",       "Convert to yuv444",                  0,                    AV_OPT_TYPE_CONST, { .i64 = NVENC_RGB_MODE_444 },       0, 0, VE, .unit = "rgb_mode" },
     { "disabled",     "Disables support, throws an error.", 0,                    AV_OPT_TYPE_CONST, { .i64 = NVENC_RGB_MODE_DISABLED },  0, 0, VE, .unit = "rgb_mode" },
     { "delay",        "Delay frame output by the given amount of frames",
-                                                            OFFSET(async_depth),  AV_OPT_TYPE_INT,   { .i64 = INT_MAX }, 0, INT_MAX, VE },
+                                                            OFFSET(async_depth),  AV_OPT_TYPE_INT,   { .i64 = INT_MAX }, NVENC_DELAY_AUTO, INT_MAX, VE, .unit = "delay" },
+    { "auto",         "Adapt the delay to the measured encode latency",
+                                                            0,                    AV_OPT_TYPE_CONST, { .i64 = NVENC_DELAY_AUTO },     0, 0, VE, .unit = "delay" },
     { "no-scenecut",  "When lookahead is enabled, set this to 1 to disable adaptive I-frame insertion at scene cuts",
                                                             OFFSET(no_scenecut),  AV_OPT_TYPE_BOOL,  { .i64 = 0 }, 0,  1, VE },
     { "forced-idr",   "If forcing keyframes, force them as IDR frames.",
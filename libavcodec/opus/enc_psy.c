@@ -383,26 +383,48 @@ static int bands_dist(OpusPsyContext *s, CeltFrame *f, float *total_dist)
     return 0;
 }
 
+static int search_band_dist(AVCodecContext *avctx, void *arg, int job, int thread)
+{
+    OpusPsyContext *s = arg;
+    CeltFrame *f = &s->search_frames[thread];
+
+    memcpy(f, s->search_src, sizeof(*f));
+    f->pvq              = s->search_pvq[thread];
+    f->intensity_stereo = s->search_is[job];
+    f->dual_stereo      = s->search_ds[job];
+
+    return bands_dist(s, f, &s->search_dist[job]);
+}
+
+/* Every candidate starts from the state of f, which is left untouched.
+ * This also keeps the noise generator in sync with the decoder. */
+static void search_band_dists(OpusPsyContext *s, const CeltFrame *f, int nb)
+{
+    s->search_src = f;
+    s->avctx->execute2(s->avctx, search_band_dist, s, NULL, nb);
+}
+
 static void celt_search_for_dual_stereo(OpusPsyContext *s, CeltFrame *f)
 {
-    float td1, td2;
     f->dual_stereo = 0;
 
     if (s->avctx->ch_layout.nb_channels < 2)
         return;
 
-    bands_dist(s, f, &td1);
-    f->dual_stereo = 1;
-    bands_dist(s, f, &td2);
+    for (int i = 0; i < 2; i++) {
+        s->search_is[i] = f->intensity_stereo;
+        s->search_ds[i] = i;
+    }
+    search_band_dists(s, f, 2);
 
-    f->dual_stereo = td2 < td1;
-    s->dual_stereo_used += td2 < td1;
+    f->dual_stereo = s->search_dist[1] < s->search_dist[0];
+    s->dual_stereo_used += f->dual_stereo;
 }
 
 static void celt_search_for_intensity(OpusPsyContext *s, CeltFrame *f)
 {
-    int i, best_band = CELT_MAX_BANDS - 1;
-    float dist, best_dist = FLT_MAX;
+    int i, nb = 0, best_band = CELT_MAX_BANDS - 1;
+    float best_dist = FLT_MAX;
     /* TODO: fix, make some heuristic up here using the lambda value */
     float end_band = 0;
 
@@ -410,11 +432,16 @@ static void celt_search_for_intensity(OpusPsyContext *s, CeltFrame *f)
         return;
 
     for (i = f->end_band; i >= end_band; i--) {
-        f->intensity_stereo = i;
-        bands_dist(s, f, &dist);
-        if (best_dist > dist) {
-            best_dist = dist;
-            best_band = i;
+        s->search_is[nb] = i;
+        s->search_ds[nb] = f->dual_stereo;
+        nb++;
+    }
+    search_band_dists(s, f, nb);
+
+    for (i = 0; i < nb; i++) {
+        if (best_dist > s->search_dist[i]) {
+            best_dist = s->search_dist[i];
+            best_band = s->search_is[i];
         }
     }
 
@@ -554,6 +581,20 @@ av_cold int ff_opus_psy_init(OpusPsyContext *s, AVCodecContext *avctx,
         }
     }
 
+    s->nb_search_threads = avctx->active_thread_type & FF_THREAD_SLICE ?
+                           FFMAX(avctx->thread_count, 1) : 1;
+    s->search_frames = av_malloc_array(s->nb_search_threads, sizeof(*s->search_frames));
+    s->search_pvq    = av_calloc(s->nb_search_threads, sizeof(*s->search_pvq));
+    if (!s->search_frames || !s->search_pvq) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+
+    for (i = 0; i < s->nb_search_threads; i++) {
+        if ((ret = ff_celt_pvq_init(&s->search_pvq[i], 1)) < 0)
+            goto fail;
+    }
+
     for (i = 0; i < CELT_BLOCK_NB; i++) {
         float tmp;
         const int len = OPUS_BLOCK_SIZE(i);
@@ -575,6 +616,12 @@ av_cold int ff_opus_psy_init(OpusPsyContext *s, AVCodecContext *avctx,
 fail:
     av_freep(&s->inflection_points);
     av_freep(&s->dsp);
+    av_freep(&s->search_frames);
+    if (s->search_pvq) {
+        for (i = 0; i < s->nb_search_threads; i++)
+            ff_celt_pvq_uninit(&s->search_pvq[i]);
+    }
+    av_freep(&s->search_pvq);
 
     for (i = 0; i < CELT_BLOCK_NB; i++) {
         av_tx_uninit(&s->mdct[i]);
@@ -607,6 +654,13 @@ av_cold int ff_opus_psy_end(OpusPsyContext *s)
     for (i = 0; i < s->max_steps; i++)
         av_freep(&s->steps[i]);
 
+    av_freep(&s->search_frames);
+    if (s->search_pvq) {
+        for (i = 0; i < s->nb_search_threads; i++)
+            ff_celt_pvq_uninit(&s->search_pvq[i]);
+    }
+    av_freep(&s->search_pvq);
+
     av_log(s->avctx, AV_LOG_INFO, "Average Intensity Stereo band: %0.1f\n", s->avg_is_band);
     av_log(s->avctx, AV_LOG_INFO, "Dual Stereo used: %0.2f%%\n", ((float)s->dual_stereo_used/s->total_packets_out)*100.0f);
 
@@ -69,6 +69,15 @@ typedef struct OpusPsyContext {
 
     DECLARE_ALIGNED(32, float, scratch)[2048];
 
+    /* Band distortion searches, run in parallel on per thread frame copies */
+    CeltFrame *search_frames;
+    struct CeltPVQ **search_pvq;
+    int nb_search_threads;
+    const CeltFrame *search_src;
+    int   search_is  [CELT_MAX_BANDS + 1];
+    int   search_ds  [CELT_MAX_BANDS + 1];
+    float search_dist[CELT_MAX_BANDS + 1];
+
     /* Stats */
     float avg_is_band;
     int64_t dual_stereo_used;
@@ -27,6 +27,7 @@
 #include "libavutil/mathematics.h"
 #include "libavutil/mem.h"
 #include "libavutil/rational.h"
+#include "libavutil/thread.h"
 
 #include "defs.h"
 #include "packet.h"
@@ -80,15 +81,76 @@ void av_packet_free(AVPacket **pkt)
     av_freep(pkt);
 }
 
+/* Payloads up to 64 KiB (including padding) are served from shared pools,
+ * one per power of two size class, to avoid a malloc/free pair per packet.
+ * Each class has its own lock and keeps at most PACKET_POOL_MAX_IDLE bytes
+ * of idle buffers, the rest is freed when released. */
+#define PACKET_POOL_MIN_SHIFT 6
+#define PACKET_POOL_MAX_SHIFT 16
+#define PACKET_POOL_NB (PACKET_POOL_MAX_SHIFT - PACKET_POOL_MIN_SHIFT + 1)
+#define PACKET_POOL_MAX_IDLE (256 << 10)
+
+static AVBufferPool *packet_pools[PACKET_POOL_NB];
+static AVOnce packet_pools_once = AV_ONCE_INIT;
+
+static av_cold void packet_pools_init(void)
+{
+    for (int i = 0; i < PACKET_POOL_NB; i++) {
+        const int size = 1 << (PACKET_POOL_MIN_SHIFT + i);
+
+        packet_pools[i] = av_buffer_pool_init(size, NULL);
+        if (packet_pools[i])
+            av_buffer_pool_set_max_free(packet_pools[i], PACKET_POOL_MAX_IDLE / size);
+    }
+}
+
+static AVBufferRef *packet_pool_get(int size)
+{
+    int idx = 0;
+
+    if (size > 1 << PACKET_POOL_MAX_SHIFT)
+        return NULL;
+    if (size > 1 << PACKET_POOL_MIN_SHIFT)
+        idx = av_log2(size - 1) + 1 - PACKET_POOL_MIN_SHIFT;
+
+    ff_thread_once(&packet_pools_once, packet_pools_init);
+    if (!packet_pools[idx])
+        return NULL;
+
+    return av_buffer_pool_get(packet_pools[idx]);
+}
+
+void av_packet_pool_get_stats(AVBufferPoolStats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+
+    ff_thread_once(&packet_pools_once, packet_pools_init);
+    for (int i = 0; i < PACKET_POOL_NB; i++) {
+        AVBufferPoolStats pool_stats;
+
+        if (!packet_pools[i])
+            continue;
+        av_buffer_pool_get_stats(packet_pools[i], &pool_stats);
+        stats->nb_hits    += pool_stats.nb_hits;
+        stats->nb_misses  += pool_stats.nb_misses;
+        stats->nb_free    += pool_stats.nb_free;
+        stats->bytes_held += pool_stats.bytes_held;
+    }
+}
+
 static int packet_alloc(AVBufferRef **buf, int size)
 {
     int ret;
     if (size < 0 || size >= INT_MAX - AV_INPUT_BUFFER_PADDING_SIZE)
         return AVERROR(EINVAL);
 
-    ret = av_buffer_realloc(buf, size + AV_INPUT_BUFFER_PADDING_SIZE);
-    if (ret < 0)
-        return ret;
+    if (!*buf)
+        *buf = packet_pool_get(size + AV_INPUT_BUFFER_PADDING_SIZE);
+    if (!*buf) {
+        ret = av_buffer_realloc(buf, size + AV_INPUT_BUFFER_PADDING_SIZE);
+        if (ret < 0)
+            return ret;
+    }
 
     memset((*buf)->data + size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
 
@@ -690,6 +690,16 @@ void av_shrink_packet(AVPacket *pkt, int size);
  */
 int av_grow_packet(AVPacket *pkt, int grow_by);
 
+/**
+ * Get the usage statistics of the buffer pools from which av_new_packet()
+ * and the other functions allocating packet payloads take payloads of up to
+ * 64 KiB, summed over all pools.
+ * This function may be called simultaneously from multiple threads.
+ *
+ * @param stats filled with the current statistics
+ */
+void av_packet_pool_get_stats(AVBufferPoolStats *stats);
+
 /**
  * Initialize a reference-counted packet from av_malloc()ed data.
  *
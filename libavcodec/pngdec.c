@@ -215,31 +215,96 @@ static void png_put_interlaced_row(uint8_t *dst, int width,
     }
 }
 
+static av_always_inline int paeth_predict(int a, int b, int c)
+{
+    int p  = b - c;
+    int pc = a - c;
+    int pa = abs(p);
+    int pb = abs(pc);
+
+    pc = abs(p + pc);
+
+    /* written as selects so that compilers emit conditional moves,
+     * the branches are unpredictable on natural images */
+    p = pb <= pc ? b : c;
+    return pa <= pb && pa <= pc ? a : p;
+}
+
+/* Keeps the left and top-left neighbours of each channel in registers,
+ * so that the only loop-carried dependency is the one inherent to the
+ * filter instead of a store-to-load round trip through dst. */
+static av_always_inline void add_paeth_prediction_template(uint8_t *dst, uint8_t *src,
+                                                           uint8_t *top, int w, int bpp)
+{
+    int a[8], c[8];
+    int i, k;
+
+    for (k = 0; k < bpp; k++) {
+        a[k] = dst[k - bpp];
+        c[k] = top[k - bpp];
+    }
+
+    for (i = 0; i <= w - bpp; i += bpp) {
+        for (k = 0; k < bpp; k++) {
+            int b = top[i + k];
+
+            a[k] = dst[i + k] = paeth_predict(a[k], b, c[k]) + src[i + k];
+            c[k] = b;
+        }
+    }
+
+    for (; i < w; i++)
+        dst[i] = paeth_predict(dst[i - bpp], top[i], top[i - bpp]) + src[i];
+}
+
 void ff_add_png_paeth_prediction(uint8_t *dst, uint8_t *src, uint8_t *top,
                                  int w, int bpp)
 {
-    int i;
-    for (i = 0; i < w; i++) {
-        int a, b, c, p, pa, pb, pc;
+    switch (bpp) {
+    case 1: add_paeth_prediction_template(dst, src, top, w, 1); break;
+    case 2: add_paeth_prediction_template(dst, src, top, w, 2); break;
+    case 3: add_paeth_prediction_template(dst, src, top, w, 3); break;
+    case 4: add_paeth_prediction_template(dst, src, top, w, 4); break;
+    case 6: add_paeth_prediction_template(dst, src, top, w, 6); break;
+    case 8: add_paeth_prediction_template(dst, src, top, w, 8); break;
+    default:
+        for (int i = 0; i < w; i++)
+            dst[i] = paeth_predict(dst[i - bpp], top[i], top[i - bpp]) + src[i];
+    }
+}
 
-        a = dst[i - bpp];
-        b = top[i];
-        c = top[i - bpp];
+static av_always_inline void add_avg_prediction_template(uint8_t *dst, uint8_t *src,
+                                                         uint8_t *last, int size, int bpp)
+{
+    int a[8];
+    int i, k;
 
-        p  = b - c;
-        pc = a - c;
+    for (i = 0; i < bpp; i++)
+        a[i] = dst[i] = (last[i] >> 1) + src[i];
 
-        pa = abs(p);
-        pb = abs(pc);
-        pc = abs(p + pc);
+    for (; i <= size - bpp; i += bpp)
+        for (k = 0; k < bpp; k++)
+            a[k] = dst[i + k] = ((a[k] + last[i + k]) >> 1) + src[i + k];
 
-        if (pa <= pb && pa <= pc)
-            p = a;
-        else if (pb <= pc)
-            p = b;
-        else
-            p = c;
-        dst[i] = p + src[i];
+    for (; i < size; i++)
+        dst[i] = ((dst[i - bpp] + last[i]) >> 1) + src[i];
+}
+
+static void add_avg_prediction(uint8_t *dst, uint8_t *src, uint8_t *last,
+                               int size, int bpp)
+{
+    switch (bpp) {
+    case 1: add_avg_prediction_template(dst, src, last, size, 1); break;
+    case 2: add_avg_prediction_template(dst, src, last, size, 2); break;
+    case 3: add_avg_prediction_template(dst, src, last, size, 3); break;
+    case 4: add_avg_prediction_template(dst, src, last, size, 4); break;
+    case 6: add_avg_prediction_template(dst, src, last, size, 6); break;
+    case 8: add_avg_prediction_template(dst, src, last, size, 8); break;
+    default:
+        for (int i = 0; i < bpp; i++)
+            dst[i] = (last[i] >> 1) + src[i];
+        for (int i = bpp; i < size; i++)
+            dst[i] = ((dst[i - bpp] + last[i]) >> 1) + src[i];
     }
 }
 
@@ -309,12 +374,7 @@ void ff_png_filter_row(PNGDSPContext *dsp, uint8_t *dst, int filter_type,
         dsp->add_bytes_l2(dst, src, last, size);
         break;
     case PNG_FILTER_VALUE_AVG:
-        for (i = 0; i < bpp; i++) {
-            p      = (last[i] >> 1);
-            dst[i] = p + src[i];
-        }
-#define OP_AVG(x, s, l) (((((x) + (l)) >> 1) + (s)) & 0xff)
-        UNROLL_FILTER(OP_AVG);
+        add_avg_prediction(dst, src, last, size, bpp);
         break;
     case PNG_FILTER_VALUE_PAETH:
         for (i = 0; i < bpp; i++) {
@@ -41,6 +41,8 @@
 #include <zlib.h>
 
 #define IOBUF_SIZE 4096
+#define STRIPE_SIZE (1 << 18) ///< minimum amount of filtered data deflated by a slice job
+#define DICT_SIZE   (1 << 15) ///< deflate window, stripes are primed with as much of the preceding data
 
 typedef struct APNGFctlChunk {
     uint32_t sequence_number;
@@ -50,6 +52,20 @@ typedef struct APNGFctlChunk {
     uint8_t dispose_op, blend_op;
 } APNGFctlChunk;
 
+typedef struct PNGEncStripe {
+    uint8_t *buf;
+    unsigned buf_size;
+    int len;                     ///< size of the deflated data or a negative error code
+    uint32_t adler;              ///< Adler-32 of the filtered rows
+    uLong in_size;               ///< size of the filtered rows
+} PNGEncStripe;
+
+typedef struct PNGEncThread {
+    FFZStream zstream;           ///< raw deflate stream
+    uint8_t *crow_base;
+    uint8_t *dict;
+} PNGEncThread;
+
 typedef struct PNGEncContext {
     AVClass *class;
     LLVidEncDSPContext llvidencdsp;
@@ -69,6 +85,14 @@ typedef struct PNGEncContext {
     int bit_depth;
     int color_type;
     int bits_per_pixel;
+    int compression_level;
+
+    // slice threading
+    int nb_threads;
+    PNGEncThread *threads;
+    PNGEncStripe *stripes;
+    int nb_stripes;
+    int stripe_rows;
 
     // APNG
     uint32_t palette_checksum;   // Used to ensure a single unique palette
@@ -506,6 +530,109 @@ static int encode_headers(AVCodecContext *avctx, const AVFrame *pict)
     return 0;
 }
 
+static int deflate_stripe(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    PNGEncContext *s       = avctx->priv_data;
+    PNGEncThread *t        = &s->threads[threadnr];
+    PNGEncStripe *st       = &s->stripes[jobnr];
+    z_stream *const zstream = &t->zstream.zstream;
+    const AVFrame *const p = arg;
+    const int row_size     = (p->width * s->bits_per_pixel + 7) >> 3;
+    const int bpp          = s->bits_per_pixel >> 3;
+    const int y0           = jobnr * s->stripe_rows;
+    const int y1           = FFMIN(y0 + s->stripe_rows, p->height);
+    uint8_t *crow_buf      = t->crow_base + 15;
+    uint8_t *crow;
+    int y, ret;
+
+    deflateReset(zstream);
+
+    /* prime the window with the data the serial encoder would have
+     * deflated last, so that only the block boundaries cost bits */
+    if (y0) {
+        int dict_rows = FFMIN(y0, (DICT_SIZE + row_size) / (row_size + 1));
+        int dict_size = dict_rows * (row_size + 1);
+
+        for (y = y0 - dict_rows; y < y0; y++) {
+            const uint8_t *ptr = p->data[0] + y * p->linesize[0];
+            const uint8_t *top = y ? ptr - p->linesize[0] : NULL;
+            crow = png_choose_filter(s, crow_buf, ptr, top, row_size, bpp);
+            memcpy(t->dict + (y - y0 + dict_rows) * (row_size + 1), crow, row_size + 1);
+        }
+        if (dict_size > DICT_SIZE) {
+            ret = deflateSetDictionary(zstream, t->dict + dict_size - DICT_SIZE, DICT_SIZE);
+        } else
+            ret = deflateSetDictionary(zstream, t->dict, dict_size);
+        if (ret != Z_OK)
+            goto fail;
+    }
+
+    /* room for the zlib header is left in the first stripe and for the
+     * Adler-32 trailer in the last one */
+    zstream->next_out  = st->buf + 2 * !jobnr;
+    zstream->avail_out = st->buf_size - 6;
+    st->adler   = adler32(0, Z_NULL, 0);
+    st->in_size = 0;
+    for (y = y0; y < y1; y++) {
+        const uint8_t *ptr = p->data[0] + y * p->linesize[0];
+        const uint8_t *top = y ? ptr - p->linesize[0] : NULL;
+        crow = png_choose_filter(s, crow_buf, ptr, top, row_size, bpp);
+        st->adler    = adler32(st->adler, crow, row_size + 1);
+        st->in_size += row_size + 1;
+        zstream->next_in  = crow;
+        zstream->avail_in = row_size + 1;
+        ret = deflate(zstream, Z_NO_FLUSH);
+        if (ret != Z_OK || zstream->avail_in)
+            goto fail;
+    }
+    /* a sync flush ends the stripe on a byte boundary, so that the stripes
+     * can simply be concatenated */
+    ret = deflate(zstream, y1 == p->height ? Z_FINISH : Z_SYNC_FLUSH);
+    if (ret != (y1 == p->height ? Z_STREAM_END : Z_OK) || !zstream->avail_out)
+        goto fail;
+
+    st->len = zstream->next_out - st->buf;
+    return 0;
+fail:
+    st->len = AVERROR_EXTERNAL;
+    return st->len;
+}
+
+static int encode_frame_stripes(AVCodecContext *avctx, const AVFrame *pict)
+{
+    PNGEncContext *s = avctx->priv_data;
+    PNGEncStripe *last = &s->stripes[s->nb_stripes - 1];
+    const int level  = s->compression_level == Z_DEFAULT_COMPRESSION ? 6 : s->compression_level;
+    unsigned header;
+    uint32_t adler;
+
+    avctx->execute2(avctx, deflate_stripe, (void *)pict, NULL, s->nb_stripes);
+
+    for (int i = 0; i < s->nb_stripes; i++)
+        if (s->stripes[i].len < 0)
+            return s->stripes[i].len;
+
+    /* zlib header the serial encoder would write, RFC 1950 */
+    header  = (Z_DEFLATED | (MAX_WBITS - 8) << 4) << 8;
+    header |= (level < 2 ? 0 : level < 6 ? 1 : level == 6 ? 2 : 3) << 6;
+    header += 31 - header % 31;
+    AV_WB16(s->stripes[0].buf, header);
+
+    adler = s->stripes[0].adler;
+    for (int i = 1; i < s->nb_stripes; i++)
+        adler = adler32_combine(adler, s->stripes[i].adler, s->stripes[i].in_size);
+    AV_WB32(last->buf + last->len, adler);
+    last->len += 4;
+
+    for (int i = 0; i < s->nb_stripes; i++) {
+        if (s->bytestream_end - s->bytestream < s->stripes[i].len + 100)
+            return AVERROR_BUG;
+        png_write_image_data(avctx, s->stripes[i].buf, s->stripes[i].len);
+    }
+
+    return 0;
+}
+
 static int encode_frame(AVCodecContext *avctx, const AVFrame *pict)
 {
     PNGEncContext *s       = avctx->priv_data;
@@ -518,6 +645,9 @@ static int encode_frame(AVCodecContext *avctx, const AVFrame *pict)
     uint8_t *progressive_buf = NULL;
     uint8_t *top_buf         = NULL;
 
+    if (s->nb_stripes)
+        return encode_frame_stripes(avctx, pict);
+
     row_size = (pict->width * s->bits_per_pixel + 7) >> 3;
 
     crow_base = av_malloc((row_size + 32) << (s->filter_type == PNG_FILTER_VALUE_MIXED));
@@ -643,7 +773,8 @@ static int encode_png(AVCodecContext *avctx, AVPacket *pkt,
         avctx->height * (
             enc_row_size +
             12 * (((int64_t)enc_row_size + IOBUF_SIZE - 1) / IOBUF_SIZE) // IDAT * ceil(enc_row_size / IOBUF_SIZE)
-        );
+        ) +
+        s->nb_stripes * 64; // IDAT and flush overhead of each stripe
     if ((ret = add_icc_profile_size(avctx, pict, &max_packet_size)))
         return ret;
     ret = ff_alloc_packet(avctx, pkt, max_packet_size);
@@ -1100,10 +1231,60 @@ static int encode_apng(AVCodecContext *avctx, AVPacket *pkt,
     return 0;
 }
 
+static av_cold int png_init_stripes(AVCodecContext *avctx)
+{
+    PNGEncContext *s = avctx->priv_data;
+    const int row_size = (avctx->width * s->bits_per_pixel + 7) >> 3;
+    uLong bound;
+    int ret;
+
+    s->stripe_rows = FFMAX(1, STRIPE_SIZE / (row_size + 1));
+    if (avctx->height <= s->stripe_rows)
+        return 0;
+
+    s->threads = av_calloc(avctx->thread_count, sizeof(*s->threads));
+    if (!s->threads)
+        return AVERROR(ENOMEM);
+    s->nb_threads = avctx->thread_count;
+    for (int i = 0; i < s->nb_threads; i++) {
+        PNGEncThread *t = &s->threads[i];
+
+        ret = ff_deflate_init2(&t->zstream, s->compression_level, -MAX_WBITS, avctx);
+        if (ret < 0)
+            return ret;
+        t->crow_base = av_malloc((row_size + 32) << (s->filter_type == PNG_FILTER_VALUE_MIXED));
+        t->dict      = av_malloc(DICT_SIZE + row_size);
+        if (!t->crow_base || !t->dict)
+            return AVERROR(ENOMEM);
+    }
+
+    bound = deflateBound(&s->threads[0].zstream.zstream,
+                         (uLong)s->stripe_rows * (row_size + 1));
+    if (bound > INT_MAX - 32)
+        return AVERROR(EINVAL);
+
+    s->stripes = av_calloc((avctx->height + s->stripe_rows - 1) / s->stripe_rows,
+                           sizeof(*s->stripes));
+    if (!s->stripes)
+        return AVERROR(ENOMEM);
+    s->nb_stripes = (avctx->height + s->stripe_rows - 1) / s->stripe_rows;
+    for (int i = 0; i < s->nb_stripes; i++) {
+        PNGEncStripe *st = &s->stripes[i];
+
+        /* zlib header, sync flush marker and Adler-32 */
+        st->buf_size = bound + 32;
+        st->buf      = av_malloc(st->buf_size);
+        if (!st->buf)
+            return AVERROR(ENOMEM);
+    }
+
+    return 0;
+}
+
 static av_cold int png_enc_init(AVCodecContext *avctx)
 {
     PNGEncContext *s = avctx->priv_data;
-    int compression_level;
+    int compression_level, ret;
 
     switch (avctx->pix_fmt) {
     case AV_PIX_FMT_RGBA:
@@ -1184,7 +1365,16 @@ static av_cold int png_enc_init(AVCodecContext *avctx)
     compression_level = avctx->compression_level == FF_COMPRESSION_DEFAULT
                       ? Z_DEFAULT_COMPRESSION
                       : av_clip(avctx->compression_level, 0, 9);
-    return ff_deflate_init(&s->zstream, compression_level, avctx);
+    s->compression_level = compression_level;
+    ret = ff_deflate_init(&s->zstream, compression_level, avctx);
+    if (ret < 0)
+        return ret;
+
+    if (avctx->active_thread_type & FF_THREAD_SLICE && avctx->thread_count > 1 &&
+        !s->is_progressive)
+        return png_init_stripes(avctx);
+
+    return 0;
 }
 
 static av_cold int png_enc_close(AVCodecContext *avctx)
@@ -1192,6 +1382,15 @@ static av_cold int png_enc_close(AVCodecContext *avctx)
     PNGEncContext *s = avctx->priv_data;
 
     ff_deflate_end(&s->zstream);
+    for (int i = 0; i < s->nb_threads; i++) {
+        ff_deflate_end(&s->threads[i].zstream);
+        av_freep(&s->threads[i].crow_base);
+        av_freep(&s->threads[i].dict);
+    }
+    av_freep(&s->threads);
+    for (int i = 0; i < s->nb_stripes; i++)
+        av_freep(&s->stripes[i].buf);
+    av_freep(&s->stripes);
     av_frame_free(&s->last_frame);
     av_frame_free(&s->prev_frame);
     av_freep(&s->last_frame_packet);
@@ -1227,6 +1426,7 @@ const FFCodec ff_png_encoder = {
     .p.type         = AVMEDIA_TYPE_VIDEO,
     .p.id           = AV_CODEC_ID_PNG,
     .p.capabilities = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_FRAME_THREADS |
+                      AV_CODEC_CAP_SLICE_THREADS |
                       AV_CODEC_CAP_ENCODER_REORDERED_OPAQUE,
     .priv_data_size = sizeof(PNGEncContext),
     .init           = png_enc_init,
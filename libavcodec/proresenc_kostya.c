@@ -33,6 +33,7 @@
 #include "profiles.h"
 #include "bytestream.h"
 #include "proresdata.h"
+#include "proresencdsp.h"
 
 #define CFACTOR_Y422 2
 #define CFACTOR_Y444 3
@@ -61,6 +62,11 @@ enum {
     QUANT_MAT_DEFAULT,
 };
 
+enum {
+    QUANT_SEARCH_FULL = 0,
+    QUANT_SEARCH_FAST,
+};
+
 static const uint8_t prores_quant_matrices[][64] = {
     { // proxy
          4,  7,  9, 11, 13, 14, 15, 63,
@@ -221,6 +227,7 @@ struct TrellisNode {
 
 typedef struct ProresThreadData {
     DECLARE_ALIGNED(16, int16_t, blocks)[MAX_PLANES][64 * 4 * MAX_MBS_PER_SLICE];
+    DECLARE_ALIGNED(16, int16_t, levels)[64 * 4 * MAX_MBS_PER_SLICE];
     DECLARE_ALIGNED(16, uint16_t, emu_buf)[16 * 16];
     int16_t custom_q[64];
     int16_t custom_chroma_q[64];
@@ -230,6 +237,7 @@ typedef struct ProresThreadData {
 typedef struct ProresContext {
     AVClass *class;
     DECLARE_ALIGNED(16, int16_t, blocks)[MAX_PLANES][64 * 4 * MAX_MBS_PER_SLICE];
+    DECLARE_ALIGNED(16, int16_t, levels)[64 * 4 * MAX_MBS_PER_SLICE];
     DECLARE_ALIGNED(16, uint16_t, emu_buf)[16*16];
     int16_t quants[MAX_STORED_Q][64];
     int16_t quants_chroma[MAX_STORED_Q][64];
@@ -242,6 +250,7 @@ typedef struct ProresContext {
     void (*fdct)(FDCTDSPContext *fdsp, const uint16_t *src,
                  ptrdiff_t linesize, int16_t *block);
     FDCTDSPContext fdsp;
+    ProresEncDSPContext dsp;
 
     const AVFrame *pic;
     int mb_width, mb_height;
@@ -259,6 +268,7 @@ typedef struct ProresContext {
 
     char *vendor;
     int quant_sel;
+    int quant_search;
 
     int frame_size_upper_bound;
 
@@ -428,9 +438,8 @@ static void encode_dcs(PutBitContext *pb, int16_t *blocks,
     }
 }
 
-static void encode_acs(PutBitContext *pb, int16_t *blocks,
-                       int blocks_per_slice,
-                       const uint8_t *scan, const int16_t *qmat)
+static void encode_acs(PutBitContext *pb, const int16_t *levels,
+                       int blocks_per_slice, const uint8_t *scan)
 {
     int idx, i;
     int prev_run = 4;
@@ -442,7 +451,7 @@ static void encode_acs(PutBitContext *pb, int16_t *blocks,
 
     for (i = 1; i < 64; i++) {
         for (idx = scan[i]; idx < max_coeffs; idx += 64) {
-            level = blocks[idx] / qmat[scan[i]];
+            level = levels[idx];
             if (level) {
                 abs_level = FFABS(level);
                 encode_vlc_codeword(pb, ff_prores_run_to_cb[prev_run], run);
@@ -468,7 +477,8 @@ static void encode_slice_plane(ProresContext *ctx, PutBitContext *pb,
     int blocks_per_slice = mbs_per_slice * blocks_per_mb;
 
     encode_dcs(pb, blocks, blocks_per_slice, qmat[0]);
-    encode_acs(pb, blocks, blocks_per_slice, ctx->scantable, qmat);
+    ctx->dsp.quantize_ac(ctx->levels, blocks, qmat, blocks_per_slice);
+    encode_acs(pb, ctx->levels, blocks_per_slice, ctx->scantable);
 }
 
 static void put_alpha_diff(PutBitContext *pb, int cur, int prev, int abits)
@@ -663,8 +673,8 @@ static int estimate_dcs(int *error, int16_t *blocks, int blocks_per_slice,
     return bits;
 }
 
-static int estimate_acs(int *error, int16_t *blocks, int blocks_per_slice,
-                        const uint8_t *scan, const int16_t *qmat)
+static int estimate_acs(const int16_t *levels, int blocks_per_slice,
+                        const uint8_t *scan)
 {
     int idx, i;
     int prev_run = 4;
@@ -678,8 +688,7 @@ static int estimate_acs(int *error, int16_t *blocks, int blocks_per_slice,
 
     for (i = 1; i < 64; i++) {
         for (idx = scan[i]; idx < max_coeffs; idx += 64) {
-            level   = blocks[idx] / qmat[scan[i]];
-            *error += FFABS(blocks[idx]) % qmat[scan[i]];
+            level = levels[idx];
             if (level) {
                 abs_level = FFABS(level);
                 bits += estimate_vlc(ff_prores_run_to_cb[prev_run], run);
@@ -699,7 +708,6 @@ static int estimate_acs(int *error, int16_t *blocks, int blocks_per_slice,
 }
 
 static int estimate_slice_plane(ProresContext *ctx, int *error, int plane,
-                                const uint16_t *src, ptrdiff_t linesize,
                                 int mbs_per_slice,
                                 int blocks_per_mb,
                                 const int16_t *qmat, ProresThreadData *td)
@@ -709,12 +717,47 @@ static int estimate_slice_plane(ProresContext *ctx, int *error, int plane,
 
     blocks_per_slice = mbs_per_slice * blocks_per_mb;
 
-    bits  = estimate_dcs(error, td->blocks[plane], blocks_per_slice, qmat[0]);
-    bits += estimate_acs(error, td->blocks[plane], blocks_per_slice, ctx->scantable, qmat);
+    bits    = estimate_dcs(error, td->blocks[plane], blocks_per_slice, qmat[0]);
+    *error += ctx->dsp.quantize_ac(td->levels, td->blocks[plane], qmat,
+                                   blocks_per_slice);
+    bits   += estimate_acs(td->levels, blocks_per_slice, ctx->scantable);
 
     return FFALIGN(bits, 8);
 }
 
+/**
+ * Estimate the bits of the luma and chroma planes of a slice and their
+ * quantization error.
+ */
+static int estimate_slice(ProresContext *ctx, int *error, int q,
+                          int mbs_per_slice, const int *num_cblocks,
+                          ProresThreadData *td)
+{
+    const int16_t *qmat, *qmat_chroma;
+    int i, bits;
+
+    if (q < MAX_STORED_Q) {
+        qmat        = ctx->quants[q];
+        qmat_chroma = ctx->quants_chroma[q];
+    } else {
+        for (i = 0; i < 64; i++) {
+            td->custom_q[i]        = ctx->quant_mat[i] * q;
+            td->custom_chroma_q[i] = ctx->quant_chroma_mat[i] * q;
+        }
+        qmat        = td->custom_q;
+        qmat_chroma = td->custom_chroma_q;
+    }
+
+    *error = 0;
+    bits   = estimate_slice_plane(ctx, error, 0, mbs_per_slice,
+                                  num_cblocks[0], qmat, td); /* estimate luma plane */
+    for (i = 1; i < ctx->num_planes - !!ctx->alpha_bits; i++) /* estimate chroma plane */
+        bits += estimate_slice_plane(ctx, error, i, mbs_per_slice,
+                                     num_cblocks[i], qmat_chroma, td);
+
+    return bits;
+}
+
 static int est_alpha_diff(int cur, int prev, int abits)
 {
     const int dbits = (abits == 8) ? 4 : 7;
@@ -786,9 +829,8 @@ static int find_slice_quant(AVCodecContext *avctx,
     int error, bits, bits_limit;
     int mbs, prev, cur, new_score;
     int slice_bits[TRELLIS_WIDTH], slice_score[TRELLIS_WIDTH];
-    int overquant;
-    uint16_t *qmat;
-    uint16_t *qmat_chroma;
+    int overquant, last_quant;
+    const int slice_limit = ctx->bits_per_mb * mbs_per_slice;
     int linesize[4], line_add;
     int alpha_bits = 0;
 
@@ -837,59 +879,68 @@ static int find_slice_quant(AVCodecContext *avctx,
         alpha_bits = estimate_alpha_plane(ctx, src, linesize[3],
                                           mbs_per_slice, td->blocks[3]);
     // todo: maybe perform coarser quantising to fit into frame size when needed
+    last_quant = max_quant;
     for (q = min_quant; q <= max_quant; q++) {
-        bits  = alpha_bits;
-        error = 0;
-        bits += estimate_slice_plane(ctx, &error, 0,
-                                     src, linesize[0],
-                                     mbs_per_slice,
-                                     num_cblocks[0],
-                                     ctx->quants[q], td); /* estimate luma plane */
-        for (i = 1; i < ctx->num_planes - !!ctx->alpha_bits; i++) { /* estimate chroma plane */
-            bits += estimate_slice_plane(ctx, &error, i,
-                                         src, linesize[i],
-                                         mbs_per_slice,
-                                         num_cblocks[i],
-                                         ctx->quants_chroma[q], td);
-        }
+        bits = alpha_bits + estimate_slice(ctx, &error, q, mbs_per_slice,
+                                           num_cblocks, td);
         if (bits > 65000 * 8)
             error = SCORE_LIMIT;
 
         slice_bits[q]  = bits;
         slice_score[q] = error;
+
+        // the fast search does not look past the first quantiser that fits
+        if (ctx->quant_search == QUANT_SEARCH_FAST && bits <= slice_limit) {
+            last_quant = q;
+            break;
+        }
     }
-    if (slice_bits[max_quant] <= ctx->bits_per_mb * mbs_per_slice) {
-        slice_bits[max_quant + 1]  = slice_bits[max_quant];
-        slice_score[max_quant + 1] = slice_score[max_quant] + 1;
-        overquant = max_quant;
-    } else {
-        for (q = max_quant + 1; q < 128; q++) {
-            bits  = alpha_bits;
-            error = 0;
-            if (q < MAX_STORED_Q) {
-                qmat = ctx->quants[q];
-                qmat_chroma = ctx->quants_chroma[q];
+    for (q = last_quant + 1; q <= max_quant; q++) {
+        slice_bits[q]  = slice_bits[last_quant];
+        slice_score[q] = SCORE_LIMIT;
+    }
+    if (slice_bits[last_quant] <= slice_limit) {
+        slice_bits[max_quant + 1]  = slice_bits[last_quant];
+        slice_score[max_quant + 1] = slice_score[last_quant] + 1;
+        overquant = last_quant;
+    } else if (ctx->quant_search == QUANT_SEARCH_FAST) {
+        /* exponential then binary search for the first quantiser that fits,
+         * assuming the bits decrease when the quantiser increases */
+        int lo = max_quant, hi = -1, hi_bits = 0, hi_error = 0;
+
+        for (i = 1; hi < 0 && lo < 127; i <<= 1) {
+            q    = FFMIN(lo + i, 127);
+            bits = alpha_bits + estimate_slice(ctx, &error, q, mbs_per_slice,
+                                               num_cblocks, td);
+            if (bits <= slice_limit || q == 127) {
+                hi       = q;
+                hi_bits  = bits;
+                hi_error = error;
             } else {
-                qmat = td->custom_q;
-                qmat_chroma = td->custom_chroma_q;
-                for (i = 0; i < 64; i++) {
-                    qmat[i] = ctx->quant_mat[i] * q;
-                    qmat_chroma[i] = ctx->quant_chroma_mat[i] * q;
-                }
+                lo = q;
             }
-            bits += estimate_slice_plane(ctx, &error, 0,
-                                         src, linesize[0],
-                                         mbs_per_slice,
-                                         num_cblocks[0],
-                                         qmat, td);/* estimate luma plane */
-            for (i = 1; i < ctx->num_planes - !!ctx->alpha_bits; i++) { /* estimate chroma plane */
-                bits += estimate_slice_plane(ctx, &error, i,
-                                             src, linesize[i],
-                                             mbs_per_slice,
-                                             num_cblocks[i],
-                                             qmat_chroma, td);
+        }
+        while (hi - lo > 1) {
+            q    = (lo + hi) >> 1;
+            bits = alpha_bits + estimate_slice(ctx, &error, q, mbs_per_slice,
+                                               num_cblocks, td);
+            if (bits <= slice_limit) {
+                hi       = q;
+                hi_bits  = bits;
+                hi_error = error;
+            } else {
+                lo = q;
             }
-            if (bits <= ctx->bits_per_mb * mbs_per_slice)
+        }
+
+        slice_bits[max_quant + 1]  = hi_bits;
+        slice_score[max_quant + 1] = hi_error;
+        overquant = hi;
+    } else {
+        for (q = max_quant + 1; q < 128; q++) {
+            bits = alpha_bits + estimate_slice(ctx, &error, q, mbs_per_slice,
+                                               num_cblocks, td);
+            if (bits <= slice_limit)
                 break;
         }
 
@@ -1160,6 +1211,7 @@ static av_cold int encode_init(AVCodecContext *avctx)
     ctx->scantable = interlaced ? ff_prores_interlaced_scan
                                 : ff_prores_progressive_scan;
     ff_fdctdsp_init(&ctx->fdsp, avctx);
+    ff_proresencdsp_init(&ctx->dsp);
 
     mps = ctx->mbs_per_slice;
     if (mps & (mps - 1)) {
@@ -1360,6 +1412,12 @@ static const AVOption options[] = {
         0, 0, VE, .unit = "quant_mat" },
     { "alpha_bits", "bits for alpha plane", OFFSET(alpha_bits), AV_OPT_TYPE_INT,
         { .i64 = 16 }, 0, 16, VE },
+    { "quant_search", "quantiser search", OFFSET(quant_search), AV_OPT_TYPE_INT,
+        { .i64 = QUANT_SEARCH_FULL }, QUANT_SEARCH_FULL, QUANT_SEARCH_FAST, VE, .unit = "quant_search" },
+    { "full",          "evaluate all quantisers of the profile", 0, AV_OPT_TYPE_CONST,
+        { .i64 = QUANT_SEARCH_FULL }, 0, 0, VE, .unit = "quant_search" },
+    { "fast",          "stop at the first quantiser that fits the slice budget", 0, AV_OPT_TYPE_CONST,
+        { .i64 = QUANT_SEARCH_FAST }, 0, 0, VE, .unit = "quant_search" },
     { NULL }
 };
 
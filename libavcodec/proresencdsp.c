@@ -0,0 +1,51 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/attributes.h"
+#include "libavutil/common.h"
+#include "proresencdsp.h"
+
+static int prores_quantize_ac_c(int16_t *dst, const int16_t *src,
+                                const int16_t *qmat, int nb_blocks)
+{
+    uint64_t recip[64];
+    int error = 0;
+
+    /* as abs(src) is at most 2^15, multiplying it by 2^32 / qmat rounded
+     * up and dropping the fractional bits is exact */
+    for (int i = 1; i < 64; i++)
+        recip[i] = ((1ULL << 32) + qmat[i] - 1) / qmat[i];
+
+    for (int b = 0; b < nb_blocks; b++, src += 64, dst += 64) {
+        dst[0] = 0;
+        for (int i = 1; i < 64; i++) {
+            unsigned abs_level = FFABS(src[i]);
+            unsigned level     = abs_level * recip[i] >> 32;
+
+            dst[i] = src[i] < 0 ? -(int)level : level;
+            error += abs_level - level * qmat[i];
+        }
+    }
+
+    return error;
+}
+
+av_cold void ff_proresencdsp_init(ProresEncDSPContext *c)
+{
+    c->quantize_ac = prores_quantize_ac_c;
+}
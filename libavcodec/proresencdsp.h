@@ -0,0 +1,42 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVCODEC_PRORESENCDSP_H
+#define AVCODEC_PRORESENCDSP_H
+
+#include <stdint.h>
+
+typedef struct ProresEncDSPContext {
+    /**
+     * Quantize the AC coefficients of a run of 8x8 blocks, rounding
+     * towards zero. The DC coefficient of each block is set to 0.
+     *
+     * @param dst       quantized coefficients
+     * @param src       coefficients, 16-byte aligned
+     * @param qmat      quantizer of each coefficient, in the range [1, 32767]
+     * @param nb_blocks number of blocks, at least 1
+     * @return          sum of the quantization errors of the AC coefficients,
+     *                  that is of FFABS(src[i]) % qmat[i & 63]
+     */
+    int (*quantize_ac)(int16_t *dst, const int16_t *src,
+                       const int16_t *qmat, int nb_blocks);
+} ProresEncDSPContext;
+
+void ff_proresencdsp_init(ProresEncDSPContext *c);
+
+#endif /* AVCODEC_PRORESENCDSP_H */
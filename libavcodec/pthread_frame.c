@@ -49,6 +49,7 @@
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "libavutil/thread.h"
+#include "libavutil/trace.h"
 
 enum {
     /// Set when the thread is awaiting a packet.
@@ -280,6 +281,8 @@ static attribute_align_arg void *frame_worker_thread(void *arg)
             p->hwaccel_serializing = 1;
         }
 
+        FF_TRACE_BEGIN("codec", avctx->codec->name, p->avpkt->pts);
+
         ret = 0;
         while (ret >= 0) {
             AVFrame *frame;
@@ -305,6 +308,8 @@ static attribute_align_arg void *frame_worker_thread(void *arg)
             ff_thread_finish_setup(avctx);
 
 alloc_fail:
+        FF_TRACE_END("codec", avctx->codec->name);
+
         if (p->hwaccel_serializing) {
             /* wipe hwaccel state for thread-unsafe hwaccels to avoid stale
              * pointers lying around;
@@ -525,10 +530,12 @@ static int submit_packet(PerThreadContext *p, AVCodecContext *user_avctx,
 
     if (prev_thread) {
         if (atomic_load(&prev_thread->state) == STATE_SETTING_UP) {
+            FF_TRACE_BEGIN("codec", "await_setup", 0);
             pthread_mutex_lock(&prev_thread->progress_mutex);
             while (atomic_load(&prev_thread->state) == STATE_SETTING_UP)
                 pthread_cond_wait(&prev_thread->progress_cond, &prev_thread->progress_mutex);
             pthread_mutex_unlock(&prev_thread->progress_mutex);
+            FF_TRACE_END("codec", "await_setup");
         }
 
         /* codecs without delay might not be prepared to be called repeatedly here during
@@ -562,6 +569,38 @@ static int submit_packet(PerThreadContext *p, AVCodecContext *user_avctx,
     return 0;
 }
 
+/**
+ * Check whether the oldest thread in low delay mode has finished decoding
+ * and its output can be returned without waiting.
+ */
+static int output_ready(const AVCodecContext *avctx, FrameThreadContext *fctx)
+{
+    /* a full ring is drained right after submitting, so equal indices
+     * mean that no thread is busy here */
+    if (!(avctx->thread_type & FF_THREAD_LOW_DELAY) ||
+        fctx->next_finished == fctx->next_decoding)
+        return 0;
+
+    return atomic_load(&fctx->threads[fctx->next_finished].state) == STATE_INPUT_READY;
+}
+
+/**
+ * Check whether the decoder holds at least max_decoder_frames frames while
+ * some thread is busy, in which case no further packets are submitted.
+ */
+static int frame_limit_reached(const AVCodecContext *avctx, FrameThreadContext *fctx)
+{
+    FFRefStructPool *pool = avctx->internal->progress_frame_pool;
+    size_t in_use;
+
+    if (!avctx->max_decoder_frames || !pool ||
+        fctx->next_finished == fctx->next_decoding)
+        return 0;
+
+    ff_refstruct_pool_get_usage(pool, &in_use, NULL);
+    return in_use >= avctx->max_decoder_frames;
+}
+
 int ff_thread_receive_frame(AVCodecContext *avctx, AVFrame *frame)
 {
     FrameThreadContext *fctx = avctx->internal->thread_ctx;
@@ -575,30 +614,41 @@ int ff_thread_receive_frame(AVCodecContext *avctx, AVFrame *frame)
     while (!fctx->df.nb_f && !fctx->result) {
         PerThreadContext *p;
 
-        /* get a packet to be submitted to the next thread */
-        av_packet_unref(fctx->next_pkt);
-        ret = ff_decode_get_packet(avctx, fctx->next_pkt);
-        if (ret < 0 && ret != AVERROR_EOF)
-            goto finish;
-
-        ret = submit_packet(&fctx->threads[fctx->next_decoding], avctx,
-                            fctx->next_pkt);
-        if (ret < 0)
-             goto finish;
-
-        /* do not return any frames until all threads have something to do */
-        if (fctx->next_decoding != fctx->next_finished &&
-            !avctx->internal->draining)
-            continue;
+        if (frame_limit_reached(avctx, fctx)) {
+            /* too many frames are held, let the oldest thread finish first */
+        } else {
+            /* get a packet to be submitted to the next thread */
+            av_packet_unref(fctx->next_pkt);
+            ret = ff_decode_get_packet(avctx, fctx->next_pkt);
+
+            if (ret == AVERROR(EAGAIN) && output_ready(avctx, fctx)) {
+                /* no input for now, return the oldest frame that is already done */
+            } else {
+                if (ret < 0 && ret != AVERROR_EOF)
+                    goto finish;
+
+                ret = submit_packet(&fctx->threads[fctx->next_decoding], avctx,
+                                    fctx->next_pkt);
+                if (ret < 0)
+                     goto finish;
+
+                /* do not return any frames until all threads have something to do */
+                if (fctx->next_decoding != fctx->next_finished &&
+                    !avctx->internal->draining)
+                    continue;
+            }
+        }
 
         p                   = &fctx->threads[fctx->next_finished];
         fctx->next_finished = (fctx->next_finished + 1) % avctx->thread_count;
 
         if (atomic_load(&p->state) != STATE_INPUT_READY) {
+            FF_TRACE_BEGIN("codec", "await_output", 0);
             pthread_mutex_lock(&p->progress_mutex);
             while (atomic_load_explicit(&p->state, memory_order_relaxed) != STATE_INPUT_READY)
                 pthread_cond_wait(&p->output_cond, &p->progress_mutex);
             pthread_mutex_unlock(&p->progress_mutex);
+            FF_TRACE_END("codec", "await_output");
         }
 
         update_context_from_thread(avctx, p->avctx, 1);
@@ -661,10 +711,12 @@ void ff_thread_await_progress(const ThreadFrame *f, int n, int field)
         av_log(f->owner[field], AV_LOG_DEBUG,
                "thread awaiting %d field %d from %p\n", n, field, progress);
 
+    FF_TRACE_BEGIN("codec", "await_progress", n);
     pthread_mutex_lock(&p->progress_mutex);
     while (atomic_load_explicit(&progress[field], memory_order_relaxed) < n)
         pthread_cond_wait(&p->progress_cond, &p->progress_mutex);
     pthread_mutex_unlock(&p->progress_mutex);
+    FF_TRACE_END("codec", "await_progress");
 }
 
 void ff_thread_finish_setup(AVCodecContext *avctx) {
@@ -194,6 +194,8 @@ struct FFRefStructPool {
 
     /** The number of outstanding entries not in available_entries. */
     atomic_uintptr_t refcount;
+    /** The highest number of entries that were in use at the same time. */
+    atomic_uintptr_t peak_in_use;
     /**
      * This is a linked list of available entries;
      * the RefCount's opaque pointer is used as next pointer
@@ -249,6 +251,7 @@ static void pool_reset_entry(FFRefStructOpaque opaque, void *entry)
 
 static int refstruct_pool_get_ext(void *datap, FFRefStructPool *pool)
 {
+    uintptr_t in_use, peak;
     void *ret = NULL;
 
     memcpy(datap, &(void *){ NULL }, sizeof(void*));
@@ -284,7 +287,15 @@ static int refstruct_pool_get_ext(void *datap, FFRefStructPool *pool)
             }
         }
     }
-    atomic_fetch_add_explicit(&pool->refcount, 1, memory_order_relaxed);
+    // The pool holds a reference to itself, so the old value is the
+    // number of entries in use including the new one.
+    in_use = atomic_fetch_add_explicit(&pool->refcount, 1, memory_order_relaxed);
+    peak   = atomic_load_explicit(&pool->peak_in_use, memory_order_relaxed);
+    while (in_use > peak &&
+           !atomic_compare_exchange_weak_explicit(&pool->peak_in_use, &peak, in_use,
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed))
+        ;
 
     if (pool->pool_flags & FF_REFSTRUCT_POOL_FLAG_ZERO_EVERY_TIME)
         memset(ret, 0, pool->size);
@@ -301,6 +312,15 @@ void *ff_refstruct_pool_get(FFRefStructPool *pool)
     return ret;
 }
 
+void ff_refstruct_pool_get_usage(FFRefStructPool *pool,
+                                 size_t *in_use, size_t *peak_in_use)
+{
+    if (in_use)
+        *in_use = atomic_load_explicit(&pool->refcount, memory_order_relaxed) - 1;
+    if (peak_in_use)
+        *peak_in_use = atomic_load_explicit(&pool->peak_in_use, memory_order_relaxed);
+}
+
 /**
  * Hint: The content of pool_unref() and refstruct_pool_uninit()
  * could currently be merged; they are only separate functions
@@ -374,6 +394,7 @@ FFRefStructPool *ff_refstruct_pool_alloc_ext_c(size_t size, unsigned flags,
     }
 
     atomic_init(&pool->refcount, 1);
+    atomic_init(&pool->peak_in_use, 0);
 
     err = ff_mutex_init(&pool->mutex, NULL);
     if (err) {
@@ -278,6 +278,18 @@ FFRefStructPool *ff_refstruct_pool_alloc_ext(size_t size, unsigned flags,
  */
 void *ff_refstruct_pool_get(FFRefStructPool *pool);
 
+/**
+ * Get the number of objects of the pool that are currently in use and the
+ * highest number of objects that were in use at the same time.
+ *
+ * Must not be called after ff_refstruct_pool_uninit().
+ *
+ * @param in_use      if non-NULL, set to the number of objects in use
+ * @param peak_in_use if non-NULL, set to the peak number of objects in use
+ */
+void ff_refstruct_pool_get_usage(FFRefStructPool *pool,
+                                 size_t *in_use, size_t *peak_in_use);
+
 /**
  * Mark the pool as being available for freeing. It will actually be freed
  * only once all the allocated buffers associated with the pool are released.
@@ -125,6 +125,42 @@ int main(void)
                 "when \"size\" parameter is too large.\n" );
         ret = 1;
     }
+    /* test reuse of pooled payloads */
+    {
+        AVPacket pkts[8] = { 0 };
+        AVBufferPoolStats stats, stats2;
+        uint8_t *data;
+
+        av_packet_unref(avpkt_clone);
+        if (av_new_packet(avpkt_clone, 1000) < 0)
+            return 1;
+        data = avpkt_clone->data;
+        av_packet_unref(avpkt_clone);
+
+        av_packet_pool_get_stats(&stats);
+        if (av_new_packet(avpkt_clone, 1000) < 0)
+            return 1;
+        av_packet_pool_get_stats(&stats2);
+        if (avpkt_clone->data != data || stats2.nb_hits != stats.nb_hits + 1) {
+            printf("av_new_packet did not reuse a released payload\n");
+            ret = 1;
+        }
+
+        /* the 64 KiB class keeps at most 4 idle payloads */
+        for (int i = 0; i < FF_ARRAY_ELEMS(pkts); i++)
+            if (av_new_packet(&pkts[i], 60000) < 0)
+                return 1;
+        av_packet_pool_get_stats(&stats);
+        for (int i = 0; i < FF_ARRAY_ELEMS(pkts); i++)
+            av_packet_unref(&pkts[i]);
+        av_packet_pool_get_stats(&stats2);
+        if (stats2.nb_free != stats.nb_free + 4 ||
+            stats2.bytes_held != stats.bytes_held + 4 * 65536) {
+            printf("packet pool kept %zu idle payloads instead of 4\n",
+                   stats2.nb_free - stats.nb_free);
+            ret = 1;
+        }
+    }
     /*clean up*/
     av_packet_free(&avpkt_clone);
     av_packet_free(&avpkt);
@@ -54,6 +54,23 @@
 #include "mjpegdec.h"
 #include "thread.h"
 #include "get_bits.h"
+#include "lossless_videodsp.h"
+
+/* Per-thread state used while unpacking strips */
+typedef struct TiffSliceContext {
+    GetByteContext gb;
+    LZWState *lzw;
+
+    uint8_t *deinvert_buf;
+    int deinvert_buf_size;
+    uint8_t *yuv_line;
+    unsigned int yuv_line_size;
+} TiffSliceContext;
+
+typedef struct TiffStrip {
+    unsigned offset, size;
+    int ret;
+} TiffStrip;
 
 typedef struct TiffContext {
     AVClass *class;
@@ -107,7 +124,6 @@ typedef struct TiffContext {
     int strips, rps, sstype;
     int sot;
     int stripsizesoff, stripsize, stripoff, strippos;
-    LZWState *lzw;
 
     /* Tile support */
     int is_tiled;
@@ -116,10 +132,12 @@ typedef struct TiffContext {
 
     int is_jpeg;
 
-    uint8_t *deinvert_buf;
-    int deinvert_buf_size;
-    uint8_t *yuv_line;
-    unsigned int yuv_line_size;
+    TiffSliceContext *slice_ctx;
+    int nb_slice_ctx;
+    TiffStrip *strip_tab;
+    unsigned int strip_tab_size;
+
+    LLVidDSPContext llviddsp;
 
     int geotag_count;
     TiffGeoTag *geotags;
@@ -438,15 +456,15 @@ static void av_always_inline horizontal_fill(TiffContext *s,
     }
 }
 
-static int deinvert_buffer(TiffContext *s, const uint8_t *src, int size)
+static int deinvert_buffer(TiffSliceContext *sc, const uint8_t *src, int size)
 {
     int i;
 
-    av_fast_padded_malloc(&s->deinvert_buf, &s->deinvert_buf_size, size);
-    if (!s->deinvert_buf)
+    av_fast_padded_malloc(&sc->deinvert_buf, &sc->deinvert_buf_size, size);
+    if (!sc->deinvert_buf)
         return AVERROR(ENOMEM);
     for (i = 0; i < size; i++)
-        s->deinvert_buf[i] = ff_reverse[src[i]];
+        sc->deinvert_buf[i] = ff_reverse[src[i]];
 
     return 0;
 }
@@ -515,7 +533,8 @@ static int tiff_uncompress(uint8_t *dst, unsigned long *len, const uint8_t *src,
     return zret == Z_STREAM_END ? Z_OK : zret;
 }
 
-static int tiff_unpack_zlib(TiffContext *s, AVFrame *p, uint8_t *dst, int stride,
+static int tiff_unpack_zlib(TiffContext *s, TiffSliceContext *sc, AVFrame *p,
+                            uint8_t *dst, int stride,
                             const uint8_t *src, int size, int width, int lines,
                             int strip_start, int is_yuv)
 {
@@ -527,11 +546,11 @@ static int tiff_unpack_zlib(TiffContext *s, AVFrame *p, uint8_t *dst, int stride
     if (!zbuf)
         return AVERROR(ENOMEM);
     if (s->fill_order) {
-        if ((ret = deinvert_buffer(s, src, size)) < 0) {
+        if ((ret = deinvert_buffer(sc, src, size)) < 0) {
             av_free(zbuf);
             return ret;
         }
-        src = s->deinvert_buf;
+        src = sc->deinvert_buf;
     }
     ret = tiff_uncompress(zbuf, &outlen, src, size);
     if (ret != Z_OK) {
@@ -582,7 +601,8 @@ static int tiff_uncompress_lzma(uint8_t *dst, uint64_t *len, const uint8_t *src,
     return ret == LZMA_STREAM_END ? LZMA_OK : ret;
 }
 
-static int tiff_unpack_lzma(TiffContext *s, AVFrame *p, uint8_t *dst, int stride,
+static int tiff_unpack_lzma(TiffContext *s, TiffSliceContext *sc, AVFrame *p,
+                            uint8_t *dst, int stride,
                             const uint8_t *src, int size, int width, int lines,
                             int strip_start, int is_yuv)
 {
@@ -592,11 +612,11 @@ static int tiff_unpack_lzma(TiffContext *s, AVFrame *p, uint8_t *dst, int stride
     if (!buf)
         return AVERROR(ENOMEM);
     if (s->fill_order) {
-        if ((ret = deinvert_buffer(s, src, size)) < 0) {
+        if ((ret = deinvert_buffer(sc, src, size)) < 0) {
             av_free(buf);
             return ret;
         }
-        src = s->deinvert_buf;
+        src = sc->deinvert_buf;
     }
     ret = tiff_uncompress_lzma(buf, &outlen, src, size);
     if (ret != LZMA_OK) {
@@ -625,16 +645,17 @@ static int tiff_unpack_lzma(TiffContext *s, AVFrame *p, uint8_t *dst, int stride
 }
 #endif
 
-static int tiff_unpack_fax(TiffContext *s, uint8_t *dst, int stride,
+static int tiff_unpack_fax(TiffContext *s, TiffSliceContext *sc,
+                           uint8_t *dst, int stride,
                            const uint8_t *src, int size, int width, int lines)
 {
     int line;
     int ret;
 
     if (s->fill_order) {
-        if ((ret = deinvert_buffer(s, src, size)) < 0)
+        if ((ret = deinvert_buffer(sc, src, size)) < 0)
             return ret;
-        src = s->deinvert_buf;
+        src = sc->deinvert_buf;
     }
     ret = ff_ccitt_unpack(s->avctx, src, size, dst, lines, stride,
                           s->compr, s->fax_opts);
@@ -736,7 +757,8 @@ static int dng_decode_jpeg(AVCodecContext *avctx, AVFrame *frame,
     return 0;
 }
 
-static int tiff_unpack_strip(TiffContext *s, AVFrame *p, uint8_t *dst, int stride,
+static int tiff_unpack_strip(TiffContext *s, TiffSliceContext *sc, AVFrame *p,
+                             uint8_t *dst, int stride,
                              const uint8_t *src, int size, int strip_start, int lines)
 {
     PutByteContext pb;
@@ -758,12 +780,12 @@ static int tiff_unpack_strip(TiffContext *s, AVFrame *p, uint8_t *dst, int strid
     if (is_yuv) {
         int bytes_per_row = (((s->width - 1) / s->subsampling[0] + 1) * s->bpp *
                             s->subsampling[0] * s->subsampling[1] + 7) >> 3;
-        av_fast_padded_malloc(&s->yuv_line, &s->yuv_line_size, bytes_per_row);
-        if (s->yuv_line == NULL) {
+        av_fast_padded_malloc(&sc->yuv_line, &sc->yuv_line_size, bytes_per_row);
+        if (sc->yuv_line == NULL) {
             av_log(s->avctx, AV_LOG_ERROR, "Not enough memory\n");
             return AVERROR(ENOMEM);
         }
-        dst = s->yuv_line;
+        dst = sc->yuv_line;
         stride = 0;
 
         width = (s->width - 1) / s->subsampling[0] + 1;
@@ -776,18 +798,18 @@ static int tiff_unpack_strip(TiffContext *s, AVFrame *p, uint8_t *dst, int strid
     }
     av_assert0(!(s->is_bayer && is_yuv));
     if (p->format == AV_PIX_FMT_GRAY12) {
-        av_fast_padded_malloc(&s->yuv_line, &s->yuv_line_size, width);
-        if (s->yuv_line == NULL) {
+        av_fast_padded_malloc(&sc->yuv_line, &sc->yuv_line_size, width);
+        if (sc->yuv_line == NULL) {
             av_log(s->avctx, AV_LOG_ERROR, "Not enough memory\n");
             return AVERROR(ENOMEM);
         }
-        dst = s->yuv_line;
+        dst = sc->yuv_line;
         stride = 0;
     }
 
     if (s->compr == TIFF_DEFLATE || s->compr == TIFF_ADOBE_DEFLATE) {
 #if CONFIG_ZLIB
-        return tiff_unpack_zlib(s, p, dst, stride, src, size, width, lines,
+        return tiff_unpack_zlib(s, sc, p, dst, stride, src, size, width, lines,
                                 strip_start, is_yuv);
 #else
         av_log(s->avctx, AV_LOG_ERROR,
@@ -798,7 +820,7 @@ static int tiff_unpack_strip(TiffContext *s, AVFrame *p, uint8_t *dst, int strid
     }
     if (s->compr == TIFF_LZMA) {
 #if CONFIG_LZMA
-        return tiff_unpack_lzma(s, p, dst, stride, src, size, width, lines,
+        return tiff_unpack_lzma(s, sc, p, dst, stride, src, size, width, lines,
                                 strip_start, is_yuv);
 #else
         av_log(s->avctx, AV_LOG_ERROR,
@@ -808,19 +830,19 @@ static int tiff_unpack_strip(TiffContext *s, AVFrame *p, uint8_t *dst, int strid
     }
     if (s->compr == TIFF_LZW) {
         if (s->fill_order) {
-            if ((ret = deinvert_buffer(s, src, size)) < 0)
+            if ((ret = deinvert_buffer(sc, src, size)) < 0)
                 return ret;
-            ssrc = src = s->deinvert_buf;
+            ssrc = src = sc->deinvert_buf;
         }
         if (size > 1 && !src[0] && (src[1]&1)) {
             av_log(s->avctx, AV_LOG_ERROR, "Old style LZW is unsupported\n");
         }
-        if ((ret = ff_lzw_decode_init(s->lzw, 8, src, size, FF_LZW_TIFF)) < 0) {
+        if ((ret = ff_lzw_decode_init(sc->lzw, 8, src, size, FF_LZW_TIFF)) < 0) {
             av_log(s->avctx, AV_LOG_ERROR, "Error initializing LZW decoder\n");
             return ret;
         }
         for (line = 0; line < lines; line++) {
-            pixels = ff_lzw_decode(s->lzw, dst, width);
+            pixels = ff_lzw_decode(sc->lzw, dst, width);
             if (pixels < width) {
                 av_log(s->avctx, AV_LOG_ERROR, "Decoded only %i bytes of %i\n",
                        pixels, width);
@@ -844,11 +866,11 @@ static int tiff_unpack_strip(TiffContext *s, AVFrame *p, uint8_t *dst, int strid
         if (is_yuv || p->format == AV_PIX_FMT_GRAY12)
             return AVERROR_INVALIDDATA;
 
-        return tiff_unpack_fax(s, dst, stride, src, size, width, lines);
+        return tiff_unpack_fax(s, sc, dst, stride, src, size, width, lines);
     }
 
-    bytestream2_init(&s->gb, src, size);
-    bytestream2_init_writer(&pb, dst, is_yuv ? s->yuv_line_size : (stride * lines));
+    bytestream2_init(&sc->gb, src, size);
+    bytestream2_init_writer(&pb, dst, is_yuv ? sc->yuv_line_size : (stride * lines));
 
     is_dng = (s->tiff_type == TIFF_TYPE_DNG || s->tiff_type == TIFF_TYPE_CINEMADNG);
 
@@ -860,6 +882,7 @@ static int tiff_unpack_strip(TiffContext *s, AVFrame *p, uint8_t *dst, int strid
         }
         if (!s->is_bayer)
             return AVERROR_PATCHWELCOME;
+        bytestream2_init(&s->gb, src, size);
         if ((ret = dng_decode_jpeg(s->avctx, p, s->stripsize, 0, 0, s->width, s->height)) < 0)
             return ret;
         return 0;
@@ -874,7 +897,7 @@ static int tiff_unpack_strip(TiffContext *s, AVFrame *p, uint8_t *dst, int strid
             return AVERROR_INVALIDDATA;
         }
 
-        if (bytestream2_get_bytes_left(&s->gb) == 0 || bytestream2_get_eof(&pb))
+        if (bytestream2_get_bytes_left(&sc->gb) == 0 || bytestream2_get_eof(&pb))
             break;
         bytestream2_seek_p(&pb, stride * line, SEEK_SET);
         switch (s->compr) {
@@ -965,6 +988,85 @@ static int tiff_unpack_strip(TiffContext *s, AVFrame *p, uint8_t *dst, int strid
     return 0;
 }
 
+/* Undo the horizontal differencing predictor (Predictor = 2) */
+static void horizontal_predictor(TiffContext *s, uint8_t *dst, int stride, int lines)
+{
+    enum AVPixelFormat pix_fmt = s->avctx->pix_fmt;
+    int i, j, soff, ssize;
+    int is_le16, is_be16;
+
+    soff  = s->bpp >> 3;
+    if (s->planar)
+        soff  = FFMAX(soff / s->bppcount, 1);
+    ssize = s->width * soff;
+
+    is_le16 = pix_fmt == AV_PIX_FMT_RGB48LE   || pix_fmt == AV_PIX_FMT_RGBA64LE ||
+              pix_fmt == AV_PIX_FMT_GRAY16LE  || pix_fmt == AV_PIX_FMT_YA16LE   ||
+              pix_fmt == AV_PIX_FMT_GBRP16LE  || pix_fmt == AV_PIX_FMT_GBRAP16LE;
+    is_be16 = pix_fmt == AV_PIX_FMT_RGB48BE   || pix_fmt == AV_PIX_FMT_RGBA64BE ||
+              pix_fmt == AV_PIX_FMT_GRAY16BE  || pix_fmt == AV_PIX_FMT_YA16BE   ||
+              pix_fmt == AV_PIX_FMT_GBRP16BE  || pix_fmt == AV_PIX_FMT_GBRAP16BE;
+
+    if (soff == 2 && (HAVE_BIGENDIAN ? is_be16 : is_le16)) {
+        /* single native-endian 16-bit component */
+        for (i = 0; i < lines; i++) {
+            s->llviddsp.add_left_pred_int16((uint16_t *)dst, (const uint16_t *)dst,
+                                            0xFFFF, s->width, 0);
+            dst += stride;
+        }
+    } else if (is_le16) {
+        for (i = 0; i < lines; i++) {
+            for (j = soff; j < ssize; j += 2)
+                AV_WL16(dst + j, AV_RL16(dst + j) + AV_RL16(dst + j - soff));
+            dst += stride;
+        }
+    } else if (is_be16) {
+        for (i = 0; i < lines; i++) {
+            for (j = soff; j < ssize; j += 2)
+                AV_WB16(dst + j, AV_RB16(dst + j) + AV_RB16(dst + j - soff));
+            dst += stride;
+        }
+    } else if (soff == 1) {
+        for (i = 0; i < lines; i++) {
+            s->llviddsp.add_left_pred(dst, dst, ssize, 0);
+            dst += stride;
+        }
+    } else {
+        for (i = 0; i < lines; i++) {
+            for (j = soff; j < ssize; j++)
+                dst[j] += dst[j - soff];
+            dst += stride;
+        }
+    }
+}
+
+typedef struct TiffStripArgs {
+    AVFrame *frame;
+    uint8_t *dst;
+    int stride;
+    const uint8_t *data;
+} TiffStripArgs;
+
+static int decode_strip(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    TiffContext *s = avctx->priv_data;
+    const TiffStripArgs *a = arg;
+    TiffStrip *strip = &s->strip_tab[jobnr];
+    int start = jobnr * s->rps;
+    int lines = FFMIN(s->rps, s->height - start);
+    uint8_t *dst = a->dst + start * (ptrdiff_t)a->stride;
+
+    strip->ret = tiff_unpack_strip(s, &s->slice_ctx[threadnr], a->frame, dst, a->stride,
+                                   a->data + strip->offset, strip->size, start, lines);
+
+    /* Rows of a strip only depend on each other, so the predictor is
+     * undone here while they are still in cache. */
+    if (strip->ret >= 0 && s->predictor == 2)
+        horizontal_predictor(s, dst, a->stride, lines);
+
+    return 0;
+}
+
 static int dng_decode_tiles(AVCodecContext *avctx, AVFrame *frame,
                             const AVPacket *avpkt)
 {
@@ -1935,6 +2037,7 @@ static int decode_frame(AVCodecContext *avctx, AVFrame *p,
     int retry_for_subifd, retry_for_page;
     int is_dng;
     int has_tile_bits, has_strip_bits;
+    int nb_strips, nb_valid;
 
     bytestream2_init(&s->gb, avpkt->data, avpkt->size);
 
@@ -2180,8 +2283,24 @@ again:
 
     /* Handle TIFF images and DNG images with uncompressed strips (non-tiled) */
 
+    if (s->is_tiled) {
+        avpriv_report_missing_feature(avctx, "Tiled non-DNG images");
+        return AVERROR_PATCHWELCOME;
+    }
+
+    if (s->predictor == 2 && s->photometric == TIFF_PHOTOMETRIC_YCBCR) {
+        av_log(s->avctx, AV_LOG_ERROR, "predictor == 2 with YUV is unsupported");
+        return AVERROR_PATCHWELCOME;
+    }
+
+    nb_strips = (s->height + s->rps - 1) / s->rps;
+    av_fast_malloc(&s->strip_tab, &s->strip_tab_size, nb_strips * sizeof(*s->strip_tab));
+    if (!s->strip_tab)
+        return AVERROR(ENOMEM);
+
     planes = s->planar ? s->bppcount : 1;
     for (plane = 0; plane < planes; plane++) {
+        TiffStripArgs args;
         uint8_t *five_planes = NULL;
         int remaining = avpkt->size;
         int decoded_height;
@@ -2195,9 +2314,9 @@ again:
             if (!dst)
                 return AVERROR(ENOMEM);
         }
-        for (i = 0; i < s->height; i += s->rps) {
-            if (i)
-                dst += s->rps * stride;
+        /* Strips past an invalid size/offset entry are never decoded; the
+         * error is only reported if all strips before it decoded fine. */
+        for (nb_valid = 0; nb_valid < nb_strips; nb_valid++) {
             if (s->stripsizesoff)
                 ssize = ff_tget(&stripsizes, s->sstype, le);
             else
@@ -2208,14 +2327,21 @@ again:
             else
                 soff = s->stripoff;
 
-            if (soff > avpkt->size || ssize > avpkt->size - soff || ssize > remaining) {
-                av_log(avctx, AV_LOG_ERROR, "Invalid strip size/offset\n");
-                av_freep(&five_planes);
-                return AVERROR_INVALIDDATA;
-            }
+            if (soff > avpkt->size || ssize > avpkt->size - soff || ssize > remaining)
+                break;
             remaining -= ssize;
-            if ((ret = tiff_unpack_strip(s, p, dst, stride, avpkt->data + soff, ssize, i,
-                                         FFMIN(s->rps, s->height - i))) < 0) {
+            s->strip_tab[nb_valid].offset = soff;
+            s->strip_tab[nb_valid].size   = ssize;
+        }
+
+        args.frame  = p;
+        args.dst    = dst;
+        args.stride = stride;
+        args.data   = avpkt->data;
+        avctx->execute2(avctx, decode_strip, &args, NULL, nb_valid);
+
+        for (i = 0; i < nb_valid; i++) {
+            if ((ret = s->strip_tab[i].ret) < 0) {
                 if (avctx->err_recognition & AV_EF_EXPLODE) {
                     av_freep(&five_planes);
                     return ret;
@@ -2223,48 +2349,12 @@ again:
                 break;
             }
         }
-        decoded_height = FFMIN(i, s->height);
-
-        if (s->predictor == 2) {
-            if (s->photometric == TIFF_PHOTOMETRIC_YCBCR) {
-                av_log(s->avctx, AV_LOG_ERROR, "predictor == 2 with YUV is unsupported");
-                return AVERROR_PATCHWELCOME;
-            }
-            dst   = five_planes ? five_planes : p->data[plane];
-            soff  = s->bpp >> 3;
-            if (s->planar)
-                soff  = FFMAX(soff / s->bppcount, 1);
-            ssize = s->width * soff;
-            if (s->avctx->pix_fmt == AV_PIX_FMT_RGB48LE ||
-                s->avctx->pix_fmt == AV_PIX_FMT_RGBA64LE ||
-                s->avctx->pix_fmt == AV_PIX_FMT_GRAY16LE ||
-                s->avctx->pix_fmt == AV_PIX_FMT_YA16LE ||
-                s->avctx->pix_fmt == AV_PIX_FMT_GBRP16LE ||
-                s->avctx->pix_fmt == AV_PIX_FMT_GBRAP16LE) {
-                for (i = 0; i < decoded_height; i++) {
-                    for (j = soff; j < ssize; j += 2)
-                        AV_WL16(dst + j, AV_RL16(dst + j) + AV_RL16(dst + j - soff));
-                    dst += stride;
-                }
-            } else if (s->avctx->pix_fmt == AV_PIX_FMT_RGB48BE ||
-                       s->avctx->pix_fmt == AV_PIX_FMT_RGBA64BE ||
-                       s->avctx->pix_fmt == AV_PIX_FMT_GRAY16BE ||
-                       s->avctx->pix_fmt == AV_PIX_FMT_YA16BE ||
-                       s->avctx->pix_fmt == AV_PIX_FMT_GBRP16BE ||
-                       s->avctx->pix_fmt == AV_PIX_FMT_GBRAP16BE) {
-                for (i = 0; i < decoded_height; i++) {
-                    for (j = soff; j < ssize; j += 2)
-                        AV_WB16(dst + j, AV_RB16(dst + j) + AV_RB16(dst + j - soff));
-                    dst += stride;
-                }
-            } else {
-                for (i = 0; i < decoded_height; i++) {
-                    for (j = soff; j < ssize; j++)
-                        dst[j] += dst[j - soff];
-                    dst += stride;
-                }
-            }
+        if (i == nb_valid && nb_valid < nb_strips) {
+            av_log(avctx, AV_LOG_ERROR, "Invalid strip size/offset\n");
+            av_freep(&five_planes);
+            return AVERROR_INVALIDDATA;
         }
+        decoded_height = FFMIN(i * s->rps, s->height);
 
         /* Floating point predictor
            TIFF Technical Note 3 http://chriscox.org/TIFFTN3d1.pdf */
@@ -2417,10 +2507,20 @@ static av_cold int tiff_init(AVCodecContext *avctx)
     s->subsampling[0] =
     s->subsampling[1] = 1;
     s->avctx  = avctx;
-    ff_lzw_decode_open(&s->lzw);
-    if (!s->lzw)
+
+    s->nb_slice_ctx = avctx->active_thread_type & FF_THREAD_SLICE ? avctx->thread_count : 1;
+    s->slice_ctx = av_calloc(s->nb_slice_ctx, sizeof(*s->slice_ctx));
+    if (!s->slice_ctx) {
+        s->nb_slice_ctx = 0;
         return AVERROR(ENOMEM);
+    }
+    for (int i = 0; i < s->nb_slice_ctx; i++) {
+        ff_lzw_decode_open(&s->slice_ctx[i].lzw);
+        if (!s->slice_ctx[i].lzw)
+            return AVERROR(ENOMEM);
+    }
     ff_ccitt_unpack_init();
+    ff_llviddsp_init(&s->llviddsp);
 
     /* Allocate JPEG frame */
     s->jpgframe = av_frame_alloc();
@@ -2453,11 +2553,19 @@ static av_cold int tiff_end(AVCodecContext *avctx)
 
     free_geotags(s);
 
-    ff_lzw_decode_close(&s->lzw);
-    av_freep(&s->deinvert_buf);
-    s->deinvert_buf_size = 0;
-    av_freep(&s->yuv_line);
-    s->yuv_line_size = 0;
+    for (int i = 0; i < s->nb_slice_ctx; i++) {
+        TiffSliceContext *sc = &s->slice_ctx[i];
+
+        ff_lzw_decode_close(&sc->lzw);
+        av_freep(&sc->deinvert_buf);
+        sc->deinvert_buf_size = 0;
+        av_freep(&sc->yuv_line);
+        sc->yuv_line_size = 0;
+    }
+    av_freep(&s->slice_ctx);
+    s->nb_slice_ctx = 0;
+    av_freep(&s->strip_tab);
+    s->strip_tab_size = 0;
     av_frame_free(&s->jpgframe);
     av_packet_free(&s->jpkt);
     avcodec_free_context(&s->avctx_mjpeg);
@@ -2487,7 +2595,8 @@ const FFCodec ff_tiff_decoder = {
     .init           = tiff_init,
     .close          = tiff_end,
     FF_CODEC_DECODE_CB(decode_frame),
-    .p.capabilities = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_FRAME_THREADS,
+    .p.capabilities = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_FRAME_THREADS |
+                      AV_CODEC_CAP_SLICE_THREADS,
     .caps_internal  = FF_CODEC_CAP_INIT_CLEANUP | FF_CODEC_CAP_ICC_PROFILES |
                       FF_CODEC_CAP_SKIP_FRAME_FILL_PARAM,
     .p.priv_class   = &tiff_decoder_class,
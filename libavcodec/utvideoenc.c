@@ -24,6 +24,7 @@
  * Ut Video encoder
  */
 
+#include "libavutil/avassert.h"
 #include "libavutil/imgutils.h"
 #include "libavutil/intreadwrite.h"
 #include "libavutil/mem.h"
@@ -51,8 +52,19 @@ typedef struct UtvideoContext {
     int      frame_pred;
 
     ptrdiff_t slice_stride;
-    uint8_t  *slice_bits, *slice_buffer[4];
-    int       slice_bits_size;
+    uint8_t  *slice_buffer[4];
+    uint8_t  *pred_buffer[4];
+
+    /* Per-frame plane layout, set up before the slice jobs run */
+    const uint8_t *plane_src[4];
+    ptrdiff_t      plane_stride[4];
+    int            plane_width[4], plane_height[4];
+
+    /* Per slice and plane symbol counts, indexed by slice * planes + plane */
+    uint64_t (*counts)[256];
+    /* Per slice and plane coded data destination and size in the packet */
+    uint8_t  **slice_dst;
+    uint32_t  *slice_size;
 } UtvideoContext;
 
 typedef struct HuffEntry {
@@ -61,6 +73,12 @@ typedef struct HuffEntry {
     uint32_t code;
 } HuffEntry;
 
+typedef struct ThreadData {
+    const AVFrame *pic;
+    HuffEntry      he[4][256];
+    int            single_symbol[4];
+} ThreadData;
+
 /* Compare huffman tree nodes */
 static int ut_huff_cmp_len(const void *a, const void *b)
 {
@@ -80,9 +98,13 @@ static av_cold int utvideo_encode_close(AVCodecContext *avctx)
     UtvideoContext *c = avctx->priv_data;
     int i;
 
-    av_freep(&c->slice_bits);
-    for (i = 0; i < 4; i++)
+    for (i = 0; i < 4; i++) {
         av_freep(&c->slice_buffer[i]);
+        av_freep(&c->pred_buffer[i]);
+    }
+    av_freep(&c->counts);
+    av_freep(&c->slice_dst);
+    av_freep(&c->slice_size);
 
     return 0;
 }
@@ -188,10 +210,19 @@ static av_cold int utvideo_encode_init(AVCodecContext *avctx)
     }
 
     for (i = 0; i < c->planes; i++) {
-        c->slice_buffer[i] = av_malloc(c->slice_stride * (avctx->height + 2) +
-                                       AV_INPUT_BUFFER_PADDING_SIZE);
-        if (!c->slice_buffer[i]) {
-            av_log(avctx, AV_LOG_ERROR, "Cannot allocate temporary buffer 1.\n");
+        if (avctx->pix_fmt == AV_PIX_FMT_GBRAP ||
+            avctx->pix_fmt == AV_PIX_FMT_GBRP) {
+            c->slice_buffer[i] = av_malloc(c->slice_stride * avctx->height +
+                                           AV_INPUT_BUFFER_PADDING_SIZE);
+            if (!c->slice_buffer[i]) {
+                av_log(avctx, AV_LOG_ERROR, "Cannot allocate temporary buffer 1.\n");
+                return AVERROR(ENOMEM);
+            }
+        }
+        c->pred_buffer[i] = av_malloc(c->slice_stride * avctx->height +
+                                      AV_INPUT_BUFFER_PADDING_SIZE);
+        if (!c->pred_buffer[i]) {
+            av_log(avctx, AV_LOG_ERROR, "Cannot allocate temporary buffer 2.\n");
             return AVERROR(ENOMEM);
         }
     }
@@ -229,6 +260,12 @@ static av_cold int utvideo_encode_init(AVCodecContext *avctx)
         c->slices = avctx->slices;
     }
 
+    c->counts     = av_malloc_array(c->slices * c->planes, sizeof(*c->counts));
+    c->slice_dst  = av_calloc(c->slices * c->planes, sizeof(*c->slice_dst));
+    c->slice_size = av_calloc(c->slices * c->planes, sizeof(*c->slice_size));
+    if (!c->counts || !c->slice_dst || !c->slice_size)
+        return AVERROR(ENOMEM);
+
     /* Set compression mode */
     c->compression = COMP_HUFF;
 
@@ -253,7 +290,7 @@ static void mangle_rgb_planes(uint8_t *dst[4], ptrdiff_t dst_stride,
                               int width, int height)
 {
     int i, j;
-    int k = 2 * dst_stride;
+    int k = 0;
     const uint8_t *sg = src[0];
     const uint8_t *sb = src[1];
     const uint8_t *sr = src[2];
@@ -327,7 +364,7 @@ static void median_predict(UtvideoContext *c, const uint8_t *src, uint8_t *dst,
 }
 
 /* Count the usage of values in a plane */
-static void count_usage(uint8_t *src, int width,
+static void count_usage(const uint8_t *src, int width,
                         int height, uint64_t *counts)
 {
     int i, j;
@@ -362,8 +399,8 @@ static void calculate_codes(HuffEntry *he)
 }
 
 /* Write huffman bit codes to a memory block */
-static int write_huff_codes(uint8_t *src, uint8_t *dst, int dst_size,
-                            int width, int height, HuffEntry *he)
+static int write_huff_codes(const uint8_t *src, uint8_t *dst, int dst_size,
+                            int width, int height, const HuffEntry *he)
 {
     PutBitContext pb;
     int i, j;
@@ -392,56 +429,127 @@ static int write_huff_codes(uint8_t *src, uint8_t *dst, int dst_size,
     return put_bytes_output(&pb);
 }
 
-static int encode_plane(AVCodecContext *avctx, const uint8_t *src,
-                        uint8_t *dst, ptrdiff_t stride, int plane_no,
-                        int width, int height, PutByteContext *pb)
+static void slice_rows(const UtvideoContext *c, AVCodecContext *avctx,
+                       int plane_no, int n, int *sstart, int *send)
 {
-    UtvideoContext *c        = avctx->priv_data;
-    uint8_t  lengths[256];
-    uint64_t counts[256]     = { 0 };
+    const int cmask  = ~(!plane_no && avctx->pix_fmt == AV_PIX_FMT_YUV420P);
+    const int height = c->plane_height[plane_no];
 
-    HuffEntry he[256];
+    *sstart = height *  n      / c->slices & cmask;
+    *send   = height * (n + 1) / c->slices & cmask;
+}
 
-    uint32_t offset = 0, slice_len = 0;
-    const int cmask = ~(!plane_no && avctx->pix_fmt == AV_PIX_FMT_YUV420P);
-    int      i, sstart, send = 0;
-    int      symbol;
-    int      ret;
+/* Predict one slice of every plane and count its symbols */
+static int predict_slice(AVCodecContext *avctx, void *tdata, int n, int threadnr)
+{
+    UtvideoContext *c = avctx->priv_data;
+    const ThreadData *td = tdata;
+    int sstart, send;
 
-    /* Do prediction / make planes */
-    switch (c->frame_pred) {
-    case PRED_NONE:
-        for (i = 0; i < c->slices; i++) {
-            sstart = send;
-            send   = height * (i + 1) / c->slices & cmask;
-            av_image_copy_plane(dst + sstart * width, width,
-                                src + sstart * stride, stride,
-                                width, send - sstart);
-        }
-        break;
-    case PRED_LEFT:
-        for (i = 0; i < c->slices; i++) {
-            sstart = send;
-            send   = height * (i + 1) / c->slices & cmask;
-            c->llvidencdsp.sub_left_predict(dst + sstart * width, src + sstart * stride, stride, width, send - sstart);
+    /* In case of RGB, mangle the planes to Ut Video's format */
+    if (avctx->pix_fmt == AV_PIX_FMT_GBRAP || avctx->pix_fmt == AV_PIX_FMT_GBRP) {
+        const AVFrame *pic = td->pic;
+        uint8_t *dst[4];
+        uint8_t *src[4];
+
+        slice_rows(c, avctx, 0, n, &sstart, &send);
+        for (int i = 0; i < c->planes; i++) {
+            dst[i] = c->slice_buffer[i] + sstart * c->slice_stride;
+            src[i] = pic->data[i]       + sstart * pic->linesize[i];
         }
-        break;
-    case PRED_MEDIAN:
-        for (i = 0; i < c->slices; i++) {
-            sstart = send;
-            send   = height * (i + 1) / c->slices & cmask;
-            median_predict(c, src + sstart * stride, dst + sstart * width,
-                           stride, width, send - sstart);
+        mangle_rgb_planes(dst, c->slice_stride, src, c->planes,
+                          pic->linesize, avctx->width, send - sstart);
+    }
+
+    for (int i = 0; i < c->planes; i++) {
+        const int width  = c->plane_width[i];
+        const ptrdiff_t stride = c->plane_stride[i];
+        const uint8_t *src = c->plane_src[i];
+        uint8_t *dst = c->pred_buffer[i];
+        uint64_t *counts = c->counts[n * c->planes + i];
+
+        slice_rows(c, avctx, i, n, &sstart, &send);
+        src += sstart * stride;
+        dst += sstart * width;
+
+        switch (c->frame_pred) {
+        case PRED_NONE:
+            av_image_copy_plane(dst, width, src, stride, width, send - sstart);
+            break;
+        case PRED_LEFT:
+            c->llvidencdsp.sub_left_predict(dst, src, stride, width, send - sstart);
+            break;
+        case PRED_MEDIAN:
+            median_predict(c, src, dst, stride, width, send - sstart);
+            break;
         }
-        break;
-    default:
-        av_log(avctx, AV_LOG_ERROR, "Unknown prediction mode: %d\n",
-               c->frame_pred);
-        return AVERROR_OPTION_NOT_FOUND;
+
+        memset(counts, 0, sizeof(c->counts[0]));
+        count_usage(dst, width, send - sstart, counts);
     }
 
-    /* Count the usage of values */
-    count_usage(dst, width, height, counts);
+    return 0;
+}
+
+/* Huffman code one slice of every plane straight into the packet */
+static int encode_slice(AVCodecContext *avctx, void *tdata, int n, int threadnr)
+{
+    UtvideoContext *c = avctx->priv_data;
+    const ThreadData *td = tdata;
+    int sstart, send;
+
+    for (int i = 0; i < c->planes; i++) {
+        const int idx   = n * c->planes + i;
+        const int width = c->plane_width[i];
+        int size;
+
+        if (td->single_symbol[i])
+            continue;
+
+        slice_rows(c, avctx, i, n, &sstart, &send);
+        size = write_huff_codes(c->pred_buffer[i] + sstart * width,
+                                c->slice_dst[idx], c->slice_size[idx],
+                                width, send - sstart, td->he[i]);
+        av_assert1(size == c->slice_size[idx]);
+
+        /* Byteswap the written huffman codes */
+        c->bdsp.bswap_buf((uint32_t *) c->slice_dst[idx],
+                          (uint32_t *) c->slice_dst[idx],
+                          size >> 2);
+    }
+
+    return 0;
+}
+
+/*
+ * Write a plane's header (code lengths and slice end offsets) and reserve
+ * room for its slices. The size of every slice is known from its symbol
+ * counts, so the slices can then be coded in parallel at their final
+ * position in the packet.
+ */
+static int write_plane_header(AVCodecContext *avctx, ThreadData *td,
+                              int plane_no, PutByteContext *pb)
+{
+    UtvideoContext *c    = avctx->priv_data;
+    HuffEntry *he        = td->he[plane_no];
+    const int width      = c->plane_width[plane_no];
+    const int height     = c->plane_height[plane_no];
+    uint8_t  lengths[256];
+    uint64_t counts[256] = { 0 };
+    uint64_t offset      = 0;
+    uint8_t *data;
+    int      i, n;
+    int      symbol;
+    int      ret;
+
+    td->single_symbol[plane_no] = 0;
+
+    for (n = 0; n < c->slices; n++) {
+        const uint64_t *slice_counts = c->counts[n * c->planes + plane_no];
+
+        for (i = 0; i < 256; i++)
+            counts[i] += slice_counts[i];
+    }
 
     /* Check for a special case where only one symbol was used */
     for (symbol = 0; symbol < 256; symbol++) {
@@ -465,6 +573,7 @@ static int encode_plane(AVCodecContext *avctx, const uint8_t *src,
                     bytestream2_put_le32(pb, 0);
 
                 /* And that's all for that plane folks */
+                td->single_symbol[plane_no] = 1;
                 return 0;
             }
             break;
@@ -490,45 +599,31 @@ static int encode_plane(AVCodecContext *avctx, const uint8_t *src,
     /* Calculate the huffman codes themselves */
     calculate_codes(he);
 
-    send = 0;
-    for (i = 0; i < c->slices; i++) {
-        sstart  = send;
-        send    = height * (i + 1) / c->slices & cmask;
+    data = pb->buffer + 4 * c->slices;
+    for (n = 0; n < c->slices; n++) {
+        const uint64_t *slice_counts = c->counts[n * c->planes + plane_no];
+        const int idx = n * c->planes + plane_no;
+        uint64_t bits = 0;
 
-        /*
-         * Write the huffman codes to a buffer,
-         * get the offset in bytes.
-         */
-        offset += write_huff_codes(dst + sstart * width, c->slice_bits,
-                                   width * height + 4, width,
-                                   send - sstart, he);
+        for (i = 0; i < 256; i++)
+            bits += slice_counts[i] * lengths[i];
 
-        slice_len = offset - slice_len;
-
-        /* Byteswap the written huffman codes */
-        c->bdsp.bswap_buf((uint32_t *) c->slice_bits,
-                          (uint32_t *) c->slice_bits,
-                          slice_len >> 2);
+        /* Each slice is padded to a 32-bit boundary */
+        c->slice_size[idx] = (bits + 31) >> 5 << 2;
+        c->slice_dst[idx]  = data + offset;
+        offset += c->slice_size[idx];
 
         /* Write the offset to the stream */
         bytestream2_put_le32(pb, offset);
+    }
 
-        /* Seek to the data part of the packet */
-        bytestream2_seek_p(pb, 4 * (c->slices - i - 1) +
-                           offset - slice_len, SEEK_CUR);
-
-        /* Write the slices' data into the output packet */
-        bytestream2_put_buffer(pb, c->slice_bits, slice_len);
-
-        /* Seek back to the slice offsets */
-        bytestream2_seek_p(pb, -4 * (c->slices - i - 1) - offset,
-                           SEEK_CUR);
-
-        slice_len = offset;
+    if (bytestream2_get_bytes_left_p(pb) < offset) {
+        av_log(avctx, AV_LOG_ERROR, "Output buffer too small.\n");
+        return AVERROR_BUG;
     }
 
-    /* And at the end seek to the end of written slice(s) */
-    bytestream2_seek_p(pb, offset, SEEK_CUR);
+    /* And at the end seek to the end of the slices */
+    bytestream2_skip_p(pb, offset);
 
     return 0;
 }
@@ -537,6 +632,10 @@ static int utvideo_encode_frame(AVCodecContext *avctx, AVPacket *pkt,
                                 const AVFrame *pic, int *got_packet)
 {
     UtvideoContext *c = avctx->priv_data;
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(avctx->pix_fmt);
+    const int rgb = avctx->pix_fmt == AV_PIX_FMT_GBRAP ||
+                    avctx->pix_fmt == AV_PIX_FMT_GBRP;
+    ThreadData td;
     PutByteContext pb;
 
     uint32_t frame_info;
@@ -547,7 +646,7 @@ static int utvideo_encode_frame(AVCodecContext *avctx, AVPacket *pkt,
     int i, ret = 0;
 
     /* Allocate a new packet if needed, and set it to the pointer dst */
-    ret = ff_alloc_packet(avctx, pkt, (256 + 4 * c->slices + width * height)
+    ret = ff_alloc_packet(avctx, pkt, (256 + 8 * c->slices + width * height)
                                       * c->planes + 4);
 
     if (ret < 0)
@@ -557,73 +656,32 @@ static int utvideo_encode_frame(AVCodecContext *avctx, AVPacket *pkt,
 
     bytestream2_init_writer(&pb, dst, pkt->size);
 
-    av_fast_padded_malloc(&c->slice_bits, &c->slice_bits_size, width * height + 4);
+    /* Set up the planes that the slice jobs work on */
+    for (i = 0; i < c->planes; i++) {
+        const int shift_w = i && !rgb ? desc->log2_chroma_w : 0;
+        const int shift_h = i && !rgb ? desc->log2_chroma_h : 0;
 
-    if (!c->slice_bits) {
-        av_log(avctx, AV_LOG_ERROR, "Cannot allocate temporary buffer 2.\n");
-        return AVERROR(ENOMEM);
+        c->plane_src[i]    = rgb ? c->slice_buffer[i] : pic->data[i];
+        c->plane_stride[i] = rgb ? c->slice_stride    : pic->linesize[i];
+        c->plane_width[i]  = width  >> shift_w;
+        c->plane_height[i] = height >> shift_h;
     }
 
-    /* In case of RGB, mangle the planes to Ut Video's format */
-    if (avctx->pix_fmt == AV_PIX_FMT_GBRAP || avctx->pix_fmt == AV_PIX_FMT_GBRP)
-        mangle_rgb_planes(c->slice_buffer, c->slice_stride, pic->data,
-                          c->planes, pic->linesize, width, height);
+    td.pic = pic;
 
-    /* Deal with the planes */
-    switch (avctx->pix_fmt) {
-    case AV_PIX_FMT_GBRP:
-    case AV_PIX_FMT_GBRAP:
-        for (i = 0; i < c->planes; i++) {
-            ret = encode_plane(avctx, c->slice_buffer[i] + 2 * c->slice_stride,
-                               c->slice_buffer[i], c->slice_stride, i,
-                               width, height, &pb);
-
-            if (ret) {
-                av_log(avctx, AV_LOG_ERROR, "Error encoding plane %d.\n", i);
-                return ret;
-            }
-        }
-        break;
-    case AV_PIX_FMT_YUV444P:
-        for (i = 0; i < c->planes; i++) {
-            ret = encode_plane(avctx, pic->data[i], c->slice_buffer[0],
-                               pic->linesize[i], i, width, height, &pb);
+    avctx->execute2(avctx, predict_slice, &td, NULL, c->slices);
 
-            if (ret) {
-                av_log(avctx, AV_LOG_ERROR, "Error encoding plane %d.\n", i);
-                return ret;
-            }
-        }
-        break;
-    case AV_PIX_FMT_YUV422P:
-        for (i = 0; i < c->planes; i++) {
-            ret = encode_plane(avctx, pic->data[i], c->slice_buffer[0],
-                               pic->linesize[i], i, width >> !!i, height, &pb);
+    for (i = 0; i < c->planes; i++) {
+        ret = write_plane_header(avctx, &td, i, &pb);
 
-            if (ret) {
-                av_log(avctx, AV_LOG_ERROR, "Error encoding plane %d.\n", i);
-                return ret;
-            }
+        if (ret) {
+            av_log(avctx, AV_LOG_ERROR, "Error encoding plane %d.\n", i);
+            return ret;
         }
-        break;
-    case AV_PIX_FMT_YUV420P:
-        for (i = 0; i < c->planes; i++) {
-            ret = encode_plane(avctx, pic->data[i], c->slice_buffer[0],
-                               pic->linesize[i], i, width >> !!i, height >> !!i,
-                               &pb);
-
-            if (ret) {
-                av_log(avctx, AV_LOG_ERROR, "Error encoding plane %d.\n", i);
-                return ret;
-            }
-        }
-        break;
-    default:
-        av_log(avctx, AV_LOG_ERROR, "Unknown pixel format: %d\n",
-               avctx->pix_fmt);
-        return AVERROR_INVALIDDATA;
     }
 
+    avctx->execute2(avctx, encode_slice, &td, NULL, c->slices);
+
     /*
      * Write frame information (LE 32-bit unsigned)
      * into the output packet.
@@ -664,6 +722,7 @@ const FFCodec ff_utvideo_encoder = {
     .p.type         = AVMEDIA_TYPE_VIDEO,
     .p.id           = AV_CODEC_ID_UTVIDEO,
     .p.capabilities = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_FRAME_THREADS |
+                      AV_CODEC_CAP_SLICE_THREADS |
                       AV_CODEC_CAP_ENCODER_REORDERED_OPAQUE,
     .priv_data_size = sizeof(UtvideoContext),
     .p.priv_class   = &utvideo_class,
@@ -368,6 +368,28 @@ int ff_vvc_sad_avx2(const int16_t *src0, const int16_t *src1, int dx, int dy, in
 #define SAD_INIT() c->inter.sad = ff_vvc_sad_avx2
 #endif
 
+// SAO band filtering is the same as in HEVC and takes explicit strides, so
+// the HEVC functions are used for blocks up to 64 pixels wide.
+#define SAO_BAND_FILTER_FUNCS(bitd, opt)                                                                                   void ff_hevc_sao_band_filter_8_##bitd##_##opt(uint8_t *_dst, const uint8_t *_src, ptrdiff_t _stride_dst, ptrdiff_t _stride_src,                                                const int16_t *sao_offset_val, int sao_left_class, int width, int height);         void ff_hevc_sao_band_filter_16_##bitd##_##opt(uint8_t *_dst, const uint8_t *_src, ptrdiff_t _stride_dst, ptrdiff_t _stride_src,                                                const int16_t *sao_offset_val, int sao_left_class, int width, int height);        void ff_hevc_sao_band_filter_32_##bitd##_##opt(uint8_t *_dst, const uint8_t *_src, ptrdiff_t _stride_dst, ptrdiff_t _stride_src,                                                const int16_t *sao_offset_val, int sao_left_class, int width, int height);        void ff_hevc_sao_band_filter_48_##bitd##_##opt(uint8_t *_dst, const uint8_t *_src, ptrdiff_t _stride_dst, ptrdiff_t _stride_src,                                                const int16_t *sao_offset_val, int sao_left_class, int width, int height);        void ff_hevc_sao_band_filter_64_##bitd##_##opt(uint8_t *_dst, const uint8_t *_src, ptrdiff_t _stride_dst, ptrdiff_t _stride_src,                                                const int16_t *sao_offset_val, int sao_left_class, int width, int height);
+
+SAO_BAND_FILTER_FUNCS(8,  sse2)
+SAO_BAND_FILTER_FUNCS(10, sse2)
+SAO_BAND_FILTER_FUNCS(12, sse2)
+SAO_BAND_FILTER_FUNCS(8,   avx)
+SAO_BAND_FILTER_FUNCS(10,  avx)
+SAO_BAND_FILTER_FUNCS(12,  avx)
+SAO_BAND_FILTER_FUNCS(8,  avx2)
+SAO_BAND_FILTER_FUNCS(10, avx2)
+SAO_BAND_FILTER_FUNCS(12, avx2)
+
+#define SAO_BAND_INIT(bd, opt) do {                                  \
+    c->sao.band_filter[0] = ff_hevc_sao_band_filter_8_##bd##_##opt;  \
+    c->sao.band_filter[1] = ff_hevc_sao_band_filter_16_##bd##_##opt; \
+    c->sao.band_filter[2] = ff_hevc_sao_band_filter_32_##bd##_##opt; \
+    c->sao.band_filter[3] = ff_hevc_sao_band_filter_48_##bd##_##opt; \
+    c->sao.band_filter[4] = ff_hevc_sao_band_filter_64_##bd##_##opt; \
+} while (0)
+
 
 #endif // ARCH_X86_64
 
@@ -378,10 +400,17 @@ void ff_vvc_dsp_init_x86(VVCDSPContext *const c, const int bd)
 
     switch (bd) {
     case 8:
+        if (EXTERNAL_SSE2(cpu_flags)) {
+            SAO_BAND_INIT(8, sse2);
+        }
         if (EXTERNAL_SSE4(cpu_flags)) {
             MC_LINK_SSE4(8);
         }
+        if (EXTERNAL_AVX(cpu_flags)) {
+            SAO_BAND_INIT(8, avx);
+        }
         if (EXTERNAL_AVX2_FAST(cpu_flags)) {
+            SAO_BAND_INIT(8, avx2);
             ALF_INIT(8);
             AVG_INIT(8, avx2);
             MC_LINKS_AVX2(8);
@@ -391,10 +420,17 @@ void ff_vvc_dsp_init_x86(VVCDSPContext *const c, const int bd)
         }
         break;
     case 10:
+        if (EXTERNAL_SSE2(cpu_flags)) {
+            SAO_BAND_INIT(10, sse2);
+        }
         if (EXTERNAL_SSE4(cpu_flags)) {
             MC_LINK_SSE4(10);
         }
+        if (EXTERNAL_AVX(cpu_flags)) {
+            SAO_BAND_INIT(10, avx);
+        }
         if (EXTERNAL_AVX2_FAST(cpu_flags)) {
+            SAO_BAND_INIT(10, avx2);
             ALF_INIT(10);
             AVG_INIT(10, avx2);
             MC_LINKS_AVX2(10);
@@ -405,10 +441,17 @@ void ff_vvc_dsp_init_x86(VVCDSPContext *const c, const int bd)
         }
         break;
     case 12:
+        if (EXTERNAL_SSE2(cpu_flags)) {
+            SAO_BAND_INIT(12, sse2);
+        }
         if (EXTERNAL_SSE4(cpu_flags)) {
             MC_LINK_SSE4(12);
         }
+        if (EXTERNAL_AVX(cpu_flags)) {
+            SAO_BAND_INIT(12, avx);
+        }
         if (EXTERNAL_AVX2_FAST(cpu_flags)) {
+            SAO_BAND_INIT(12, avx2);
             ALF_INIT(12);
             AVG_INIT(12, avx2);
             MC_LINKS_AVX2(12);
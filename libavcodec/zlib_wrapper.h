@@ -53,6 +53,13 @@ void ff_inflate_end(FFZStream *zstream);
  */
 int ff_deflate_init(FFZStream *zstream, int level, void *logctx);
 
+/**
+ * Wrapper around deflateInit2() with the default memLevel and strategy.
+ * It works analogously to ff_deflate_init(); a negative window_bits
+ * selects a raw deflate stream without zlib header and trailer.
+ */
+int ff_deflate_init2(FFZStream *zstream, int level, int window_bits, void *logctx);
+
 /**
  * Wrapper around deflateEnd(). It works analogously to ff_inflate_end().
  */
@@ -22,6 +22,7 @@
  */
 
 #include <atomic>
+#include <mutex>
 #include <vector>
 using std::atomic;
 
@@ -105,28 +106,74 @@ static VANCLineNumber vanc_line_numbers[] = {
     {bmdModeUnknown, 0, -1, -1, -1}
 };
 
+/* Released frame buffers are kept for reuse, as allocating a new one for
+ * every frame means faulting in and zeroing a few megabytes each time. */
+#define DECKLINK_POOL_MAX     32
+/* Room in front of each buffer for its size and the free list link, a
+ * multiple of the av_malloc() alignment. */
+#define DECKLINK_BUFFER_HEADER 64
+
+struct decklink_buffer_header {
+    uint8_t *next;
+    unsigned int size;
+};
+
 class decklink_allocator : public IDeckLinkMemoryAllocator
 {
 public:
-        decklink_allocator(): _refs(1) { }
-        virtual ~decklink_allocator() { }
+        decklink_allocator(): _refs(1), _pool(NULL), _pool_count(0), _pool_size(0) { }
+        virtual ~decklink_allocator() { free_pool(); }
 
         // IDeckLinkMemoryAllocator methods
         virtual HRESULT STDMETHODCALLTYPE AllocateBuffer(unsigned int bufferSize, void* *allocatedBuffer)
         {
-            void *buf = av_malloc(bufferSize + AV_INPUT_BUFFER_PADDING_SIZE);
-            if (!buf)
-                return E_OUTOFMEMORY;
-            *allocatedBuffer = buf;
+            uint8_t *buf = NULL;
+
+            _mutex.lock();
+            if (bufferSize != _pool_size) {
+                free_pool();
+                _pool_size = bufferSize;
+            }
+            if (_pool) {
+                buf = _pool;
+                _pool = header(buf)->next;
+                _pool_count--;
+            }
+            _mutex.unlock();
+
+            if (!buf) {
+                buf = (uint8_t *)av_malloc(DECKLINK_BUFFER_HEADER + bufferSize + AV_INPUT_BUFFER_PADDING_SIZE);
+                if (!buf)
+                    return E_OUTOFMEMORY;
+                header(buf)->size = bufferSize;
+            }
+            *allocatedBuffer = buf + DECKLINK_BUFFER_HEADER;
             return S_OK;
         }
         virtual HRESULT STDMETHODCALLTYPE ReleaseBuffer(void* buffer)
         {
-            av_free(buffer);
+            uint8_t *buf = (uint8_t *)buffer - DECKLINK_BUFFER_HEADER;
+
+            _mutex.lock();
+            if (header(buf)->size == _pool_size && _pool_count < DECKLINK_POOL_MAX) {
+                header(buf)->next = _pool;
+                _pool = buf;
+                _pool_count++;
+                buf = NULL;
+            }
+            _mutex.unlock();
+
+            av_free(buf);
             return S_OK;
         }
         virtual HRESULT STDMETHODCALLTYPE Commit() { return S_OK; }
-        virtual HRESULT STDMETHODCALLTYPE Decommit() { return S_OK; }
+        virtual HRESULT STDMETHODCALLTYPE Decommit()
+        {
+            _mutex.lock();
+            free_pool();
+            _mutex.unlock();
+            return S_OK;
+        }
 
         // IUnknown methods
         virtual HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, LPVOID *ppv) { return E_NOINTERFACE; }
@@ -140,7 +187,25 @@ public:
         }
 
 private:
+        static struct decklink_buffer_header *header(uint8_t *buf)
+        {
+            return (struct decklink_buffer_header *)buf;
+        }
+        void free_pool(void)
+        {
+            while (_pool) {
+                uint8_t *next = header(_pool)->next;
+                av_free(_pool);
+                _pool = next;
+            }
+            _pool_count = 0;
+        }
+
         std::atomic<int>  _refs;
+        std::mutex        _mutex;
+        uint8_t          *_pool;
+        int               _pool_count;
+        unsigned int      _pool_size;
 };
 
 extern "C" {
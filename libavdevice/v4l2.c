@@ -52,7 +52,11 @@
 #include <libv4l2.h>
 #endif
 
-static const int desired_video_buffers = 256;
+#if CONFIG_LIBDRM
+#include <drm_fourcc.h>
+#include "libavutil/hwcontext.h"
+#include "libavutil/hwcontext_drm.h"
+#endif
 
 #define V4L_ALLFORMATS  3
 #define V4L_RAWFORMATS  1
@@ -99,6 +103,8 @@ struct video_data {
     atomic_int buffers_queued;
     void **buf_start;
     unsigned int *buf_len;
+    int *buf_fd;        /**< exported DMA-BUF of each buffer, if use_dmabuf */
+    int bytesperline;
     char *standard;
     v4l2_std_id std_id;
     int channel;
@@ -106,6 +112,14 @@ struct video_data {
     int list_format;    /**< Set by a private option. */
     int list_standard;  /**< Set by a private option. */
     char *framerate;    /**< Set by a private option. */
+    int desired_buffers; /**< Set by a private option. */
+
+    int use_dmabuf;     /**< Set by a private option. */
+    char *drm_device;   /**< Set by a private option. */
+    enum AVPixelFormat sw_format;
+    uint32_t drm_format;
+    AVBufferRef *device_ref;
+    AVBufferRef *frames_ref;
 
     int use_libv4l2;
     int (*open_f)(const char *file, int oflag, ...);
@@ -228,6 +242,9 @@ static int device_init(AVFormatContext *ctx, int *width, int *height,
     if (v4l2_ioctl(s->fd, VIDIOC_S_FMT, &fmt) < 0)
         res = AVERROR(errno);
 
+    s->bytesperline = s->multiplanar ? fmt.fmt.pix_mp.plane_fmt[0].bytesperline
+                                     : fmt.fmt.pix.bytesperline;
+
     if ((*width != fmt.fmt.pix.width) || (*height != fmt.fmt.pix.height)) {
         av_log(ctx, AV_LOG_INFO,
                "The V4L2 driver changed the video from %dx%d to %dx%d\n",
@@ -362,7 +379,7 @@ static int mmap_init(AVFormatContext *ctx)
     struct video_data *s = ctx->priv_data;
     struct v4l2_requestbuffers req = {
         .type   = s->buf_type,
-        .count  = desired_video_buffers,
+        .count  = s->desired_buffers,
         .memory = V4L2_MEMORY_MMAP
     };
 
@@ -388,6 +405,15 @@ static int mmap_init(AVFormatContext *ctx)
         av_freep(&s->buf_start);
         return AVERROR(ENOMEM);
     }
+    if (s->use_dmabuf) {
+        s->buf_fd = av_malloc_array(s->buffers, sizeof(*s->buf_fd));
+        if (!s->buf_fd) {
+            av_log(ctx, AV_LOG_ERROR, "Cannot allocate buffer descriptors\n");
+            av_freep(&s->buf_start);
+            av_freep(&s->buf_len);
+            return AVERROR(ENOMEM);
+        }
+    }
 
     for (i = 0; i < req.count; i++) {
         unsigned int buf_length, buf_offset;
@@ -424,6 +450,23 @@ static int mmap_init(AVFormatContext *ctx)
                    i, s->buf_len[i], s->frame_size);
             return AVERROR(ENOMEM);
         }
+
+        if (s->use_dmabuf) {
+            struct v4l2_exportbuffer expbuf = {
+                .type  = s->buf_type,
+                .index = i,
+                .flags = O_RDONLY,
+            };
+            if (v4l2_ioctl(s->fd, VIDIOC_EXPBUF, &expbuf) < 0) {
+                res = AVERROR(errno);
+                av_log(ctx, AV_LOG_ERROR, "ioctl(VIDIOC_EXPBUF): %s\n", av_err2str(res));
+                return res;
+            }
+            s->buf_fd[i]    = expbuf.fd;
+            s->buf_start[i] = NULL;
+            continue;
+        }
+
         s->buf_start[i] = v4l2_mmap(NULL, buf_length,
                                PROT_READ | PROT_WRITE, MAP_SHARED,
                                s->fd, buf_offset);
@@ -469,6 +512,178 @@ static void mmap_release_buffer(void *opaque, uint8_t *data)
     enqueue_buffer(s, &buf);
 }
 
+#if CONFIG_LIBDRM
+static const struct {
+    uint32_t v4l2_format;
+    uint32_t drm_format;
+} dmabuf_formats[] = {
+#ifdef DRM_FORMAT_R8
+    { V4L2_PIX_FMT_GREY,    DRM_FORMAT_R8       },
+#endif
+    { V4L2_PIX_FMT_RGB565,  DRM_FORMAT_RGB565   },
+    { V4L2_PIX_FMT_RGB24,   DRM_FORMAT_BGR888   },
+    { V4L2_PIX_FMT_BGR24,   DRM_FORMAT_RGB888   },
+    { V4L2_PIX_FMT_XRGB32,  DRM_FORMAT_BGRX8888 },
+    { V4L2_PIX_FMT_XBGR32,  DRM_FORMAT_XRGB8888 },
+    { V4L2_PIX_FMT_ARGB32,  DRM_FORMAT_BGRA8888 },
+    { V4L2_PIX_FMT_ABGR32,  DRM_FORMAT_ARGB8888 },
+    { V4L2_PIX_FMT_YUYV,    DRM_FORMAT_YUYV     },
+    { V4L2_PIX_FMT_YVYU,    DRM_FORMAT_YVYU     },
+    { V4L2_PIX_FMT_UYVY,    DRM_FORMAT_UYVY     },
+    { V4L2_PIX_FMT_NV12,    DRM_FORMAT_NV12     },
+    { V4L2_PIX_FMT_NV21,    DRM_FORMAT_NV21     },
+    { V4L2_PIX_FMT_NV16,    DRM_FORMAT_NV16     },
+    { V4L2_PIX_FMT_YUV420,  DRM_FORMAT_YUV420   },
+    { V4L2_PIX_FMT_YVU420,  DRM_FORMAT_YVU420   },
+    { V4L2_PIX_FMT_YUV422P, DRM_FORMAT_YUV422   },
+#if defined(V4L2_PIX_FMT_P010) && defined(DRM_FORMAT_P010)
+    { V4L2_PIX_FMT_P010,    DRM_FORMAT_P010     },
+#endif
+};
+
+static int dmabuf_init(AVFormatContext *ctx, enum AVCodecID codec_id)
+{
+    struct video_data *s = ctx->priv_data;
+    AVHWFramesContext *frames;
+    int i, res;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(dmabuf_formats); i++)
+        if (dmabuf_formats[i].v4l2_format == s->pixelformat)
+            break;
+    if (codec_id != AV_CODEC_ID_RAWVIDEO || s->sw_format == AV_PIX_FMT_NONE ||
+        i == FF_ARRAY_ELEMS(dmabuf_formats)) {
+        av_log(ctx, AV_LOG_ERROR, "DMA-BUF export is not supported for "
+               "V4L2 format 0x%08X.\n", s->pixelformat);
+        return AVERROR(EINVAL);
+    }
+    s->drm_format = dmabuf_formats[i].drm_format;
+
+    res = av_hwdevice_ctx_create(&s->device_ref, AV_HWDEVICE_TYPE_DRM,
+                                 s->drm_device, NULL, 0);
+    if (res < 0) {
+        av_log(ctx, AV_LOG_ERROR, "Failed to open DRM device %s.\n", s->drm_device);
+        return res;
+    }
+
+    s->frames_ref = av_hwframe_ctx_alloc(s->device_ref);
+    if (!s->frames_ref)
+        return AVERROR(ENOMEM);
+    frames = (AVHWFramesContext*)s->frames_ref->data;
+
+    frames->format    = AV_PIX_FMT_DRM_PRIME;
+    frames->sw_format = s->sw_format;
+    frames->width     = s->width;
+    frames->height    = s->height;
+
+    res = av_hwframe_ctx_init(s->frames_ref);
+    if (res < 0)
+        av_log(ctx, AV_LOG_ERROR, "Failed to initialise hardware frames "
+               "context: %s.\n", av_err2str(res));
+    return res;
+}
+
+static void dmabuf_release_desc(void *opaque, uint8_t *data)
+{
+    av_free(data);
+    /* the exported file descriptor stays open, only give the buffer back */
+    mmap_release_buffer(opaque, NULL);
+}
+
+static void dmabuf_free_frame(void *opaque, uint8_t *data)
+{
+    AVFrame *frame = (AVFrame*)data;
+
+    av_frame_free(&frame);
+}
+
+static int dmabuf_read_frame(AVFormatContext *ctx, AVPacket *pkt,
+                             struct v4l2_buffer *buf)
+{
+    struct video_data *s = ctx->priv_data;
+    const AVPixFmtDescriptor *pixdesc = av_pix_fmt_desc_get(s->sw_format);
+    int nb_planes = av_pix_fmt_count_planes(s->sw_format);
+    AVDRMFrameDescriptor *desc     = av_mallocz(sizeof(*desc));
+    struct buff_data *buf_descriptor = av_malloc(sizeof(*buf_descriptor));
+    AVFrame *frame = av_frame_alloc();
+    int linesizes[4];
+    ptrdiff_t offset = 0;
+    int i, res;
+
+    if (!desc || !buf_descriptor || !frame) {
+        res = AVERROR(ENOMEM);
+        goto fail;
+    }
+    buf_descriptor->index = buf->index;
+    buf_descriptor->s     = s;
+
+    av_image_fill_linesizes(linesizes, s->sw_format, s->width);
+
+    desc->nb_objects = 1;
+    desc->objects[0].fd              = s->buf_fd[buf->index];
+    desc->objects[0].size            = s->buf_len[buf->index];
+    desc->objects[0].format_modifier = DRM_FORMAT_MOD_LINEAR;
+    desc->nb_layers = 1;
+    desc->layers[0].format    = s->drm_format;
+    desc->layers[0].nb_planes = nb_planes;
+    /* single buffer formats: the planes follow each other, with the line
+     * size of the first plane given by the driver */
+    for (i = 0; i < nb_planes; i++) {
+        int h = i == 1 || i == 2 ? AV_CEIL_RSHIFT(s->height, pixdesc->log2_chroma_h)
+                                 : s->height;
+        ptrdiff_t pitch = s->bytesperline ? (ptrdiff_t)s->bytesperline * linesizes[i] / linesizes[0]
+                                          : linesizes[i];
+
+        desc->layers[0].planes[i].object_index = 0;
+        desc->layers[0].planes[i].offset       = offset;
+        desc->layers[0].planes[i].pitch        = pitch;
+        offset += pitch * h;
+    }
+
+    frame->buf[0] = av_buffer_create((uint8_t*)desc, sizeof(*desc),
+                                     dmabuf_release_desc, buf_descriptor, 0);
+    if (!frame->buf[0]) {
+        res = AVERROR(ENOMEM);
+        goto fail;
+    }
+    /* from now on the buffer is given back when the frame is freed */
+    buf_descriptor = NULL;
+
+    frame->hw_frames_ctx = av_buffer_ref(s->frames_ref);
+    if (!frame->hw_frames_ctx) {
+        res = AVERROR(ENOMEM);
+        goto fail;
+    }
+
+    frame->data[0] = (uint8_t*)desc;
+    frame->format  = AV_PIX_FMT_DRM_PRIME;
+    frame->width   = s->width;
+    frame->height  = s->height;
+
+    pkt->buf = av_buffer_create((uint8_t*)frame, sizeof(*frame),
+                                dmabuf_free_frame, NULL, 0);
+    if (!pkt->buf) {
+        res = AVERROR(ENOMEM);
+        goto fail;
+    }
+
+    pkt->data   = (uint8_t*)frame;
+    pkt->size   = sizeof(*frame);
+    pkt->flags |= AV_PKT_FLAG_TRUSTED;
+
+    return 0;
+
+fail:
+    av_log(ctx, AV_LOG_ERROR, "Failed to wrap a DMA-BUF in a frame\n");
+    if (buf_descriptor) {
+        av_free(buf_descriptor);
+        av_free(desc);
+        enqueue_buffer(s, buf);
+    }
+    av_frame_free(&frame);
+    return res;
+}
+#endif
+
 #if HAVE_CLOCK_GETTIME && defined(CLOCK_MONOTONIC)
 static int64_t av_gettime_monotonic(void)
 {
@@ -546,6 +761,14 @@ static int mmap_read_frame(AVFormatContext *ctx, AVPacket *pkt)
 
     pkt->size = 0;
 
+    /* Frames referencing DMA-BUFs cannot fall back to a copy, so wait for
+     * the caller to release one instead of running out of buffers. */
+    while (s->use_dmabuf && atomic_load(&s->buffers_queued) <= 1) {
+        if (ctx->flags & AVFMT_FLAG_NONBLOCK)
+            return AVERROR(EAGAIN);
+        av_usleep(1000);
+    }
+
     /* FIXME: Some special treatment might be needed in case of loss of signal... */
     while ((res = v4l2_ioctl(s->fd, VIDIOC_DQBUF, &buf)) < 0 && (errno == EINTR));
     if (res < 0) {
@@ -592,6 +815,17 @@ static int mmap_read_frame(AVFormatContext *ctx, AVPacket *pkt)
         }
     }
 
+#if CONFIG_LIBDRM
+    if (s->use_dmabuf) {
+        if (!bytesused) {
+            enqueue_buffer(s, &buf);
+            return AVERROR(EAGAIN);
+        }
+        res = dmabuf_read_frame(ctx, pkt, &buf);
+        if (res < 0)
+            return res;
+    } else
+#endif
     /* Image is at s->buff_start[buf.index] */
     if (atomic_load(&s->buffers_queued) == FFMAX(s->buffers / 8, 1)) {
         /* when we start getting low on queued buffers, fall back on copying data */
@@ -689,10 +923,14 @@ static void mmap_close(struct video_data *s)
      */
     v4l2_ioctl(s->fd, VIDIOC_STREAMOFF, &type);
     for (i = 0; i < s->buffers; i++) {
-        v4l2_munmap(s->buf_start[i], s->buf_len[i]);
+        if (s->buf_fd)
+            close(s->buf_fd[i]);
+        else
+            v4l2_munmap(s->buf_start[i], s->buf_len[i]);
     }
     av_freep(&s->buf_start);
     av_freep(&s->buf_len);
+    av_freep(&s->buf_fd);
 }
 
 static int v4l2_set_parameters(AVFormatContext *ctx)
@@ -940,6 +1178,14 @@ static int v4l2_read_header(AVFormatContext *ctx)
 
     avpriv_set_pts_info(st, 64, 1, 1000000); /* 64 bits pts in us */
 
+#if !CONFIG_LIBDRM
+    if (s->use_dmabuf) {
+        av_log(ctx, AV_LOG_ERROR, "libavdevice is not built with libdrm support.\n");
+        res = AVERROR(ENOSYS);
+        goto fail;
+    }
+#endif
+
     if (s->pixel_format) {
         const AVCodecDescriptor *desc = avcodec_descriptor_get_by_name(s->pixel_format);
 
@@ -999,6 +1245,16 @@ static int v4l2_read_header(AVFormatContext *ctx)
         s->frame_size = av_image_get_buffer_size(st->codecpar->format,
                                                  s->width, s->height, 1);
 
+#if CONFIG_LIBDRM
+    if (s->use_dmabuf) {
+        s->sw_format = st->codecpar->format;
+        if ((res = dmabuf_init(ctx, codec_id)) < 0)
+            goto fail;
+        codec_id = ctx->video_codec_id = AV_CODEC_ID_WRAPPED_AVFRAME;
+        st->codecpar->format = AV_PIX_FMT_DRM_PRIME;
+    }
+#endif
+
     if ((res = mmap_init(ctx)) ||
         (res = mmap_start(ctx)) < 0)
             goto fail;
@@ -1025,6 +1281,10 @@ static int v4l2_read_header(AVFormatContext *ctx)
     return 0;
 
 fail:
+#if CONFIG_LIBDRM
+    av_buffer_unref(&s->frames_ref);
+    av_buffer_unref(&s->device_ref);
+#endif
     v4l2_close(s->fd);
     return res;
 }
@@ -1049,6 +1309,10 @@ static int v4l2_read_close(AVFormatContext *ctx)
                "close.\n");
 
     mmap_close(s);
+#if CONFIG_LIBDRM
+    av_buffer_unref(&s->frames_ref);
+    av_buffer_unref(&s->device_ref);
+#endif
 
     ff_timefilter_destroy(s->timefilter);
     v4l2_close(s->fd);
@@ -1161,6 +1425,9 @@ static const AVOption options[] = {
     { "abs",          "use absolute timestamps (wall clock)",                     OFFSET(ts_mode),      AV_OPT_TYPE_CONST,  {.i64 = V4L_TS_ABS      }, 0, 2, DEC, .unit = "timestamps" },
     { "mono2abs",     "force conversion from monotonic to absolute timestamps",   OFFSET(ts_mode),      AV_OPT_TYPE_CONST,  {.i64 = V4L_TS_MONO2ABS }, 0, 2, DEC, .unit = "timestamps" },
     { "use_libv4l2",  "use libv4l2 (v4l-utils) conversion functions",             OFFSET(use_libv4l2),  AV_OPT_TYPE_BOOL,   {.i64 = 0}, 0, 1, DEC },
+    { "buffers",      "set number of capture buffers to request",                 OFFSET(desired_buffers), AV_OPT_TYPE_INT, {.i64 = 256}, 2, 256, DEC },
+    { "dmabuf",       "export buffers as DMA-BUFs in DRM_PRIME frames",            OFFSET(use_dmabuf),   AV_OPT_TYPE_BOOL,   {.i64 = 0}, 0, 1, DEC },
+    { "drm_device",   "DRM device for the DRM_PRIME frames",                       OFFSET(drm_device),   AV_OPT_TYPE_STRING, {.str = "/dev/dri/renderD128"}, 0, 0, DEC },
     { NULL },
 };
 
@@ -33,19 +33,14 @@
 #define fn(a)      fn2(a, SAMPLE_FORMAT)
 
 static ftype fn(fir_sample)(AudioAPContext *s, ftype sample, ftype *delay,
-                            ftype *coeffs, ftype *tmp, int *offset)
+                            const ftype *coeffs, int *offset)
 {
     const int order = s->order;
     ftype output;
 
     delay[*offset] = sample;
 
-    memcpy(tmp, coeffs + order - *offset, order * sizeof(ftype));
-#if DEPTH == 32
-    output = s->fdsp->scalarproduct_float(delay, tmp, s->kernel_size);
-#else
-    output = s->fdsp->scalarproduct_double(delay, tmp, s->kernel_size);
-#endif
+    output = s->dsp.fn(dot)(delay, coeffs + order - *offset, order);
 
     if (--(*offset) < 0)
         *offset = order - 1;
@@ -117,7 +112,6 @@ static ftype fn(process_sample)(AudioAPContext *s, ftype input, ftype desired, i
     ftype **itmpmp = (ftype **)&s->itmpmp[s->projection * ch];
     ftype **tmpmp = (ftype **)&s->tmpmp[s->projection * ch];
     ftype *tmpm = (ftype *)s->tmpm->extended_data[ch];
-    ftype *tmp = (ftype *)s->tmp->extended_data[ch];
     ftype *e = (ftype *)s->e->extended_data[ch];
     ftype *x = (ftype *)s->x->extended_data[ch];
     ftype *w = (ftype *)s->w->extended_data[ch];
@@ -134,16 +128,15 @@ static ftype fn(process_sample)(AudioAPContext *s, ftype input, ftype desired, i
     x[offset[2] + length] = x[offset[2]] = input;
     delay[offset[0] + order] = input;
 
-    output = fn(fir_sample)(s, input, delay, coeffs, tmp, offset);
+    output = fn(fir_sample)(s, input, delay, coeffs, offset);
     e[offset[1]] = e[offset[1] + projection] = desired - output;
 
     for (int i = 0; i < projection; i++) {
         const int iprojection = i * projection;
 
         for (int j = i; j < projection; j++) {
-            ftype sum = F(0.0);
-            for (int k = 0; k < order; k++)
-                sum += x[offset[2] + i + k] * x[offset[2] + j + k];
+            const ftype sum = s->dsp.fn(dot)(x + offset[2] + i, x + offset[2] + j, order);
+
             tmpm[iprojection + j] = sum;
             if (i != j)
                 tmpm[j * projection + i] = sum;
@@ -155,22 +148,15 @@ static ftype fn(process_sample)(AudioAPContext *s, ftype input, ftype desired, i
     fn(lup_decompose)(tmpmp, projection, tol, p);
     fn(lup_invert)(tmpmp, p, projection, itmpmp);
 
-    for (int i = 0; i < projection; i++) {
-        ftype sum = F(0.0);
-        for (int j = 0; j < projection; j++)
-            sum += itmpmp[i][j] * e[j + offset[1]];
-        w[i] = sum;
-    }
+    for (int i = 0; i < projection; i++)
+        w[i] = s->dsp.fn(dot)(itmpmp[i], e + offset[1], projection);
 
-    for (int i = 0; i < order; i++) {
-        ftype sum = F(0.0);
-        for (int j = 0; j < projection; j++)
-            sum += x[offset[2] + i + j] * w[j];
-        dcoeffs[i] = sum;
-    }
+    memset(dcoeffs, 0, order * sizeof(*dcoeffs));
+    for (int j = 0; j < projection; j++)
+        s->dsp.fn(axpy)(dcoeffs, x + offset[2] + j, w[j], order);
 
-    for (int i = 0; i < order; i++)
-        coeffs[i] = coeffs[i + order] = coeffs[i] + mu * dcoeffs[i];
+    s->dsp.fn(axpy)(coeffs, dcoeffs, mu, order);
+    memcpy(coeffs + order, coeffs, order * sizeof(*coeffs));
 
     if (--offset[1] < 0)
         offset[1] = projection - 1;
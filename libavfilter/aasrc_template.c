@@ -63,8 +63,6 @@
 #define fn2(a,b)   fn3(a,b)
 #define fn(a)      fn2(a, SAMPLE_FORMAT)
 
-#define MAX_NB_POLES 8
-
 typedef struct fn(complex_ftype) {
     ftype re, im;
 } fn(complex_ftype);
@@ -75,13 +73,12 @@ typedef struct fn(StateContext) {
     int   K1;
 
     ftype scale_factor;
-    ftype Log2MagP[MAX_NB_POLES];
-    ftype thetaP[MAX_NB_POLES];
-    ftype Log2MagP_Fsf[MAX_NB_POLES];
-    ftype thetaP_Fsf[MAX_NB_POLES];
-    ctype pInv[MAX_NB_POLES];
-    ctype pFixed[MAX_NB_POLES];
-    ctype rFixed[MAX_NB_POLES];
+    ftype Log2MagP[AASRC_NB_POLES];
+    ftype thetaP[AASRC_NB_POLES];
+    ftype Log2MagP_Fsf[AASRC_NB_POLES];
+    ftype thetaP_Fsf[AASRC_NB_POLES];
+    ctype pInv[AASRC_NB_POLES];
+    ctype rFixed[AASRC_NB_POLES];
 
     int   reset_index;
     int   reset_phasors;
@@ -91,14 +88,20 @@ typedef struct fn(StateContext) {
     ftype delta_t;
     ftype t_inc_frac;
     int   t_inc_int;
-    ctype *pAdv;
-    ctype pCur[MAX_NB_POLES];
-    ctype pAdvUp[MAX_NB_POLES];
-    ctype pAdvDown[MAX_NB_POLES];
-    ctype filter_state[MAX_NB_POLES];
-
-    ctype *hat;
+    const ftype *pAdv;
+    ftype pCur[2 * AASRC_NB_POLES];
+    DECLARE_ALIGNED(32, ftype, pFixed)[2 * AASRC_NB_POLES];
+    ftype filter_state[2 * AASRC_NB_POLES];
+    /* the phasor steps down, up and the identity */
+    DECLARE_ALIGNED(32, ftype, pAdvDown)[2 * AASRC_NB_POLES];
+    DECLARE_ALIGNED(32, ftype, pAdvUp)[2 * AASRC_NB_POLES];
+    DECLARE_ALIGNED(32, ftype, pAdvOne)[2 * AASRC_NB_POLES];
+
+    ftype *hat;
     int   hat_samples;
+#if DEPTH == 16
+    ftype *x;
+#endif
 } fn(StateContext);
 
 static void fn(complex_exponential)(ctype *x,
@@ -129,28 +132,50 @@ static void fn(vector_mul_complex)(ctype *x,
     }
 }
 
+static void fn(to_planar)(ftype *dst, const ctype *src, const int N)
+{
+    for (int n = 0; n < N; n++) {
+        dst[n] = src[n].re;
+        dst[AASRC_NB_POLES + n] = src[n].im;
+    }
+}
+
+static void fn(aasrc_set_ratio)(fn(StateContext) *stc, const double t_inc)
+{
+    ctype adv[AASRC_NB_POLES];
+
+    stc->t_inc_frac = t_inc - FLOOR(t_inc);
+    stc->t_inc_int = LRINT(t_inc - stc->t_inc_frac);
+
+    fn(complex_exponential)(adv, stc->Log2MagP_Fsf, stc->thetaP_Fsf, stc->t_inc_frac, stc->nb_poles);
+    fn(to_planar)(stc->pAdvDown, adv, stc->nb_poles);
+    fn(vector_mul_complex)(adv, adv, stc->pInv, stc->nb_poles);
+    fn(to_planar)(stc->pAdvUp, adv, stc->nb_poles);
+}
+
 static void fn(aasrc_prepare)(AVFilterContext *ctx, fn(StateContext) *stc,
                               const double t_inc)
 {
+    ctype pCur[AASRC_NB_POLES], pFixed[AASRC_NB_POLES];
+
     stc->scale_factor = (t_inc > 1.0) ? F(1.0) / t_inc : F(1.0);
     stc->K1 = 32;
     stc->out_idx = 0;
     stc->in_idx = 0;
     stc->delta_t = F(0.0);
     stc->reset_index = 0;
-    stc->t_inc_frac = t_inc - FLOOR(t_inc);
-    stc->t_inc_int = LRINT(t_inc - stc->t_inc_frac);
     stc->reset_phasors = 1;
     stc->nb_poles = FF_ARRAY_ELEMS(ps1);
 
     for (int n = 0; n < stc->nb_poles; n++) {
-        stc->pCur[n].re = F(1.0);
-        stc->pCur[n].im = F(0.0);
+        pCur[n].re = F(1.0);
+        pCur[n].im = F(0.0);
         stc->rFixed[n].re = rs1[n][0] * stc->scale_factor;
         stc->rFixed[n].im = rs1[n][1] * stc->scale_factor;
     }
 
-    fn(vector_mul_complex)(stc->pCur, stc->pCur, stc->rFixed, stc->nb_poles);
+    fn(vector_mul_complex)(pCur, pCur, stc->rFixed, stc->nb_poles);
+    fn(to_planar)(stc->pCur, pCur, stc->nb_poles);
 
     for (int n = 0; n < stc->nb_poles; n++) {
         stc->Log2MagP[n] = FLOG2(ps1[n][0]);
@@ -159,8 +184,6 @@ static void fn(aasrc_prepare)(AVFilterContext *ctx, fn(StateContext) *stc,
         stc->thetaP_Fsf[n] = stc->thetaP[n] * stc->scale_factor;
     }
 
-    stc->pAdv = NULL;
-
     for (int n = 0; n < stc->nb_poles; n++) {
         const ftype pInvMag = FEXP2(-stc->Log2MagP_Fsf[n]);
         const ftype pCos = FCOS(stc->thetaP_Fsf[n]);
@@ -170,12 +193,15 @@ static void fn(aasrc_prepare)(AVFilterContext *ctx, fn(StateContext) *stc,
         stc->pInv[n].re = pInvMag *  pCos;
         stc->pInv[n].im = pInvMag * -pSin;
 
-        stc->pFixed[n].re = pMag * pCos;
-        stc->pFixed[n].im = pMag * pSin;
+        pFixed[n].re = pMag * pCos;
+        pFixed[n].im = pMag * pSin;
+
+        stc->pAdvOne[n] = F(1.0);
     }
+    fn(to_planar)(stc->pFixed, pFixed, stc->nb_poles);
 
-    fn(complex_exponential)(stc->pAdvDown, stc->Log2MagP_Fsf, stc->thetaP_Fsf, stc->t_inc_frac, stc->nb_poles);
-    fn(vector_mul_complex)(stc->pAdvUp, stc->pAdvDown, stc->pInv, stc->nb_poles);
+    stc->pAdv = stc->pAdvOne;
+    fn(aasrc_set_ratio)(stc, t_inc);
 
     memset(stc->filter_state, 0, sizeof(stc->filter_state));
 }
@@ -199,6 +225,15 @@ static int fn(aasrc_init)(AVFilterContext *ctx)
     return 0;
 }
 
+static void fn(aasrc_update)(AVFilterContext *ctx)
+{
+    AASRCContext *s = ctx->priv;
+    fn(StateContext) *state = s->state;
+
+    for (int ch = 0; ch < s->channels; ch++)
+        fn(aasrc_set_ratio)(&state[ch], s->t_inc);
+}
+
 static void fn(aasrc)(AVFilterContext *ctx, AVFrame *in, AVFrame *out,
                       const int ch)
 {
@@ -212,85 +247,101 @@ static void fn(aasrc)(AVFilterContext *ctx, AVFrame *in, AVFrame *out,
     const ftype t_inc_frac = stc->t_inc_frac;
     const int t_inc_int = stc->t_inc_int;
     const int nb_poles = stc->nb_poles;
+    const int K1 = stc->K1;
     ftype delta_t = stc->delta_t;
     int in_idx = stc->in_idx;
+    const ftype *x;
+    int n = 0;
 
     if (stc->hat_samples < n_in_samples) {
-        stc->hat = av_realloc_f(stc->hat, n_in_samples, nb_poles * sizeof(*stc->hat));
+        stc->hat = av_realloc_f(stc->hat, n_in_samples, 2 * AASRC_NB_POLES * sizeof(*stc->hat));
         if (!stc->hat)
             return;
+#if DEPTH == 16
+        stc->x = av_realloc_f(stc->x, n_in_samples, sizeof(*stc->x));
+        if (!stc->x)
+            return;
+#endif
 
         stc->hat_samples = n_in_samples;
     }
 
-    for (int n = 0; n < nb_poles; n++) {
-        ctype *h = stc->hat + n * n_in_samples;
-        const ctype a = stc->pFixed[n];
-        ctype z = stc->filter_state[n];
-
-        for (int i = 0; i < n_in_samples; i++) {
-            ftype re, im, x;
-
 #if DEPTH == 16
-            x = src[i] / F(1<<(DEPTH-1));
+    for (int i = 0; i < n_in_samples; i++)
+        stc->x[i] = src[i] / F(1<<(DEPTH-1));
+    x = stc->x;
 #else
-            x = src[i];
+    x = src;
 #endif
-            re = z.re * a.re - z.im * a.im + x;
-            im = z.re * a.im + z.im * a.re;
 
-            h[i].re = z.re = re;
-            h[i].im = z.im = im;
-        }
+    s->dsp.fn2(filter, ftype)(stc->hat, stc->filter_state, stc->pFixed, x, n_in_samples);
 
-        stc->filter_state[n].re = isnormal(z.re) ? z.re : F(0.0);
-        stc->filter_state[n].im = isnormal(z.im) ? z.im : F(0.0);
+    for (int i = 0; i < 2 * AASRC_NB_POLES; i++) {
+        if (!isnormal(stc->filter_state[i]))
+            stc->filter_state[i] = F(0.0);
     }
 
-    for (int n = 0; n < n_out_samples && in_idx < n_in_samples; n++) {
-        ftype delta_t_frac, y = F(0.0);
-        ctype *h = stc->hat;
-        int frac_carry;
+    while (n < n_out_samples && in_idx < n_in_samples) {
+        const ftype *h[32], *adv[32];
+        ftype reset_delta_t = F(0.0);
+        int nb = 0, reset = 0;
 
-        if (stc->pAdv)
-            fn(vector_mul_complex)(stc->pCur, stc->pCur, stc->pAdv, nb_poles);
+        av_assert2(K1 <= FF_ARRAY_ELEMS(h));
 
-        {
-            const ctype *const pCur = stc->pCur;
+        /* gather outputs up to the next reset of the phasors */
+        while (nb < K1 && n + nb < n_out_samples && in_idx < n_in_samples) {
+            ftype delta_t_frac;
+            int frac_carry;
+
+            h[nb] = stc->hat + in_idx * 2 * AASRC_NB_POLES;
+            adv[nb++] = stc->pAdv;
+
+            if (stc->reset_phasors) {
+                if (stc->reset_index >= K1) {
+                    reset_delta_t = delta_t;
+                    stc->reset_index = 0;
+                    reset = 1;
+                }
 
-            for (int i = 0; i < nb_poles; i++) {
-                y += h[in_idx].re * pCur[i].re -
-                     h[in_idx].im * pCur[i].im;
-                h += n_in_samples;
+                stc->reset_index++;
             }
+
+            delta_t += t_inc_frac;
+            delta_t_frac = delta_t - FLOOR(delta_t);
+            frac_carry = LRINT(delta_t - delta_t_frac);
+            in_idx += frac_carry + t_inc_int;
+            delta_t = delta_t_frac;
+
+            stc->pAdv = (frac_carry == 0) ? stc->pAdvDown : stc->pAdvUp;
+
+            if (reset)
+                break;
         }
+
 #if DEPTH == 16
-        dst[n] = LRINT(y * F(1<<(DEPTH-1)));
+        {
+            ftype y[32];
+
+            s->dsp.fn2(interp, ftype)(y, h, adv, stc->pCur, nb);
+            for (int i = 0; i < nb; i++)
+                dst[n + i] = LRINT(y[i] * F(1<<(DEPTH-1)));
+        }
 #else
-        dst[n] = y;
+        s->dsp.fn2(interp, ftype)(dst + n, h, adv, stc->pCur, nb);
 #endif
 
-        if (stc->reset_phasors) {
-            if (stc->reset_index >= stc->K1) {
-                fn(complex_exponential)(stc->pCur, stc->Log2MagP_Fsf, stc->thetaP_Fsf, delta_t, nb_poles);
-                fn(vector_mul_complex)(stc->pCur, stc->rFixed, stc->pCur, nb_poles);
-                stc->reset_index = 0;
-            }
+        if (reset) {
+            ctype pCur[AASRC_NB_POLES];
 
-            stc->reset_index++;
+            fn(complex_exponential)(pCur, stc->Log2MagP_Fsf, stc->thetaP_Fsf, reset_delta_t, nb_poles);
+            fn(vector_mul_complex)(pCur, stc->rFixed, pCur, nb_poles);
+            fn(to_planar)(stc->pCur, pCur, nb_poles);
         }
 
-        delta_t += t_inc_frac;
-        delta_t_frac = delta_t - FLOOR(delta_t);
-        frac_carry = LRINT(delta_t - delta_t_frac);
-        in_idx += frac_carry + t_inc_int;
-        delta_t = delta_t_frac;
-
-        stc->pAdv = (frac_carry == 0) ? stc->pAdvDown : stc->pAdvUp;
-
-        stc->out_idx = n+1;
+        n += nb;
     }
 
+    stc->out_idx = n;
     stc->delta_t = delta_t;
     stc->in_idx = FFMAX(0, in_idx - n_in_samples);
 }
@@ -315,6 +366,9 @@ static void fn(aasrc_uninit)(AVFilterContext *ctx)
             fn(StateContext) *stc = &state[ch];
 
             av_freep(&stc->hat);
+#if DEPTH == 16
+            av_freep(&stc->x);
+#endif
         }
 
         av_freep(&s->state);
@@ -0,0 +1,122 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFILTER_AASRCDSP_H
+#define AVFILTER_AASRCDSP_H
+
+#include "libavutil/attributes.h"
+
+/**
+ * Number of complex one-pole filters of the aasrc filter bank.
+ */
+#define AASRC_NB_POLES 8
+
+/**
+ * Kernels of the aasrc filter. Complex values of all the poles are kept
+ * together as AASRC_NB_POLES real parts followed by AASRC_NB_POLES
+ * imaginary parts.
+ *
+ * The output of interp() sums the terms of the poles in the order
+ * ((t0 + t4) + (t2 + t6)) + ((t1 + t5) + (t3 + t7)).
+ *
+ * The poles and the phasor steps must be 32-byte aligned, other pointers
+ * need no alignment.
+ */
+typedef struct AASRCDSPContext {
+    /**
+     * Run the filter bank, state[k] = state[k] * poles[k] + src[i], over
+     * len input samples.
+     *
+     * @param hat   the states after each input sample
+     * @param state the filter states, updated
+     */
+    void (*filter_float)(float *hat, float *state, const float *poles,
+                         const float *src, int len);
+    void (*filter_double)(double *hat, double *state, const double *poles,
+                          const double *src, int len);
+
+    /**
+     * For each output sample n, multiply the phasors by adv[n] and store
+     * the real part of the sum of the products of h[n] with the phasors.
+     *
+     * @param phasors the phasors, updated
+     */
+    void (*interp_float)(float *dst, const float *const *h,
+                         const float *const *adv, float *phasors, int len);
+    void (*interp_double)(double *dst, const double *const *h,
+                          const double *const *adv, double *phasors, int len);
+} AASRCDSPContext;
+
+#define AASRC_FUNCS(ftype, name)                                            \
+static void filter_##name##_c(ftype *hat, ftype *state, const ftype *poles, \
+                              const ftype *src, int len)                    \
+{                                                                           \
+    const int N = AASRC_NB_POLES;                                           \
+                                                                            \
+    for (int i = 0; i < len; i++) {                                         \
+        const ftype x = src[i];                                             \
+                                                                            \
+        for (int k = 0; k < N; k++) {                                       \
+            const ftype re = state[k], im = state[N + k];                   \
+                                                                            \
+            state[k]     = re * poles[k] - im * poles[N + k] + x;           \
+            state[N + k] = re * poles[N + k] + im * poles[k];               \
+        }                                                                   \
+                                                                            \
+        for (int k = 0; k < 2 * N; k++)                                     \
+            hat[k] = state[k];                                              \
+        hat += 2 * N;                                                       \
+    }                                                                       \
+}                                                                           \
+                                                                            \
+static void interp_##name##_c(ftype *dst, const ftype *const *h,            \
+                              const ftype *const *adv, ftype *phasors,      \
+                              int len)                                      \
+{                                                                           \
+    const int N = AASRC_NB_POLES;                                           \
+                                                                            \
+    for (int n = 0; n < len; n++) {                                         \
+        const ftype *a = adv[n], *x = h[n];                                 \
+        ftype t[AASRC_NB_POLES];                                            \
+                                                                            \
+        for (int k = 0; k < N; k++) {                                       \
+            const ftype re = phasors[k] * a[k] - phasors[N + k] * a[N + k]; \
+            const ftype im = phasors[k] * a[N + k] + phasors[N + k] * a[k]; \
+                                                                            \
+            phasors[k]     = re;                                            \
+            phasors[N + k] = im;                                            \
+            t[k] = x[k] * re - x[N + k] * im;                               \
+        }                                                                   \
+                                                                            \
+        dst[n] = ((t[0] + t[4]) + (t[2] + t[6])) +                          \
+                 ((t[1] + t[5]) + (t[3] + t[7]));                           \
+    }                                                                       \
+}
+
+AASRC_FUNCS(float,  float)
+AASRC_FUNCS(double, double)
+
+static av_unused void ff_aasrc_init(AASRCDSPContext *dsp)
+{
+    dsp->filter_float  = filter_float_c;
+    dsp->filter_double = filter_double_c;
+    dsp->interp_float  = interp_float_c;
+    dsp->interp_double = interp_double_c;
+}
+
+#endif /* AVFILTER_AASRCDSP_H */
@@ -0,0 +1,104 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFILTER_ADAPTIVEDSP_H
+#define AVFILTER_ADAPTIVEDSP_H
+
+#include <stddef.h>
+
+#include "libavutil/attributes.h"
+
+/**
+ * Vector kernels shared by the aap, akalman, anlms and arls adaptive
+ * filters. Unlike AVFloatDSPContext they accept any length and pointers
+ * without particular alignment, as the filters operate on windows of a
+ * circular delay line.
+ */
+typedef struct AudioAdaptiveDSPContext {
+    /**
+     * Compute the scalar product of a and b.
+     */
+    float  (*dot_float)(const float *a, const float *b, int len);
+    double (*dot_double)(const double *a, const double *b, int len);
+
+    /**
+     * Compute y[i] += a * x[i].
+     */
+    void (*axpy_float)(float *y, const float *x, float a, int len);
+    void (*axpy_double)(double *y, const double *x, double a, int len);
+
+    /**
+     * Scale a matrix and add a scaled outer product to it:
+     * A[i][k] = A[i][k] * s + (u[i] * v[k]) * a.
+     *
+     * Every element is computed with the same operations, so a symmetric
+     * matrix stays exactly symmetric when u and v are the same vector.
+     *
+     * @param stride distance between rows of A in elements
+     * @param rows   number of rows of A and values of u
+     * @param len    number of columns of A and values of v
+     */
+    void (*rank1_float)(float *A, ptrdiff_t stride, const float *u, const float *v,
+                        float s, float a, int rows, int len);
+    void (*rank1_double)(double *A, ptrdiff_t stride, const double *u, const double *v,
+                         double s, double a, int rows, int len);
+} AudioAdaptiveDSPContext;
+
+#define ADAPTIVE_FUNCS(ftype, name)                                         \
+static ftype dot_##name##_c(const ftype *a, const ftype *b, int len)       \
+{                                                                           \
+    ftype sum = 0;                                                          \
+                                                                            \
+    for (int i = 0; i < len; i++)                                           \
+        sum += a[i] * b[i];                                                 \
+                                                                            \
+    return sum;                                                             \
+}                                                                           \
+                                                                            \
+static void axpy_##name##_c(ftype *y, const ftype *x, ftype a, int len)    \
+{                                                                           \
+    for (int i = 0; i < len; i++)                                           \
+        y[i] += a * x[i];                                                   \
+}                                                                           \
+                                                                            \
+static void rank1_##name##_c(ftype *A, ptrdiff_t stride,                   \
+                             const ftype *u, const ftype *v,                \
+                             ftype s, ftype a, int rows, int len)           \
+{                                                                           \
+    for (int i = 0; i < rows; i++, A += stride) {                           \
+        const ftype ui = u[i];                                              \
+                                                                            \
+        for (int k = 0; k < len; k++)                                       \
+            A[k] = A[k] * s + (ui * v[k]) * a;                              \
+    }                                                                       \
+}
+
+ADAPTIVE_FUNCS(float,  float)
+ADAPTIVE_FUNCS(double, double)
+
+static av_unused void ff_adaptive_init(AudioAdaptiveDSPContext *dsp)
+{
+    dsp->dot_float    = dot_float_c;
+    dsp->dot_double   = dot_double_c;
+    dsp->axpy_float   = axpy_float_c;
+    dsp->axpy_double  = axpy_double_c;
+    dsp->rank1_float  = rank1_float_c;
+    dsp->rank1_double = rank1_double_c;
+}
+
+#endif /* AVFILTER_ADAPTIVEDSP_H */
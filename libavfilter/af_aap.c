@@ -20,10 +20,10 @@
 
 #include "libavutil/channel_layout.h"
 #include "libavutil/common.h"
-#include "libavutil/float_dsp.h"
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
 
+#include "adaptivedsp.h"
 #include "audio.h"
 #include "avfilter.h"
 #include "formats.h"
@@ -57,7 +57,6 @@ typedef struct AudioAPContext {
     AVFrame *x;
     AVFrame *w;
     AVFrame *dcoeffs;
-    AVFrame *tmp;
     AVFrame *tmpm;
     AVFrame *itmpm;
 
@@ -68,7 +67,7 @@ typedef struct AudioAPContext {
 
     int (*filter_channels)(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs);
 
-    AVFloatDSPContext *fdsp;
+    AudioAdaptiveDSPContext dsp;
 } AudioAPContext;
 
 #define OFFSET(x) offsetof(AudioAPContext, x)
@@ -208,8 +207,6 @@ static int config_output(AVFilterLink *outlink)
         s->x = ff_get_audio_buffer(outlink, 2 * (s->projection + s->order));
     if (!s->w)
         s->w = ff_get_audio_buffer(outlink, s->projection);
-    if (!s->tmp)
-        s->tmp = ff_get_audio_buffer(outlink, s->kernel_size);
     if (!s->tmpm)
         s->tmpm = ff_get_audio_buffer(outlink, s->projection * s->projection);
     if (!s->itmpm)
@@ -221,7 +218,7 @@ static int config_output(AVFilterLink *outlink)
         s->itmpmp = av_calloc(s->projection * channels, sizeof(*s->itmpmp));
 
     if (!s->offset || !s->delay || !s->dcoeffs || !s->coeffs || !s->tmpmp || !s->itmpmp ||
-        !s->e || !s->p || !s->x || !s->w || !s->tmp || !s->tmpm || !s->itmpm)
+        !s->e || !s->p || !s->x || !s->w || !s->tmpm || !s->itmpm)
         return AVERROR(ENOMEM);
 
     switch (outlink->format) {
@@ -264,9 +261,7 @@ static av_cold int init(AVFilterContext *ctx)
 {
     AudioAPContext *s = ctx->priv;
 
-    s->fdsp = avpriv_float_dsp_alloc(0);
-    if (!s->fdsp)
-        return AVERROR(ENOMEM);
+    ff_adaptive_init(&s->dsp);
 
     return 0;
 }
@@ -275,8 +270,6 @@ static av_cold void uninit(AVFilterContext *ctx)
 {
     AudioAPContext *s = ctx->priv;
 
-    av_freep(&s->fdsp);
-
     av_frame_free(&s->offset);
     av_frame_free(&s->delay);
     av_frame_free(&s->dcoeffs);
@@ -285,7 +278,6 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_frame_free(&s->p);
     av_frame_free(&s->w);
     av_frame_free(&s->x);
-    av_frame_free(&s->tmp);
     av_frame_free(&s->tmpm);
     av_frame_free(&s->itmpm);
 
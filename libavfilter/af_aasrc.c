@@ -20,7 +20,9 @@
 
 #include "libavutil/avassert.h"
 #include "libavutil/mem.h"
+#include "libavutil/mem_internal.h"
 #include "libavutil/opt.h"
+#include "aasrcdsp.h"
 #include "audio.h"
 #include "formats.h"
 #include "avfilter.h"
@@ -31,6 +33,7 @@ typedef struct AASRCContext {
 
     int pass;
     int sample_rate;
+    double drift;
     int channels;
     double t_inc;
 
@@ -38,16 +41,21 @@ typedef struct AASRCContext {
 
     void *state;
 
+    AASRCDSPContext dsp;
+
     void (*do_aasrc)(AVFilterContext *ctx, AVFrame *in, AVFrame *out, const int ch);
+    void (*aasrc_update)(AVFilterContext *ctx);
     int (*nb_output_samples)(AVFilterContext *ctx);
     void (*aasrc_uninit)(AVFilterContext *ctx);
 } AASRCContext;
 
 #define OFFSET(x) offsetof(AASRCContext, x)
 #define FLAGS AV_OPT_FLAG_AUDIO_PARAM | AV_OPT_FLAG_FILTERING_PARAM
+#define TFLAGS AV_OPT_FLAG_AUDIO_PARAM | AV_OPT_FLAG_FILTERING_PARAM | AV_OPT_FLAG_RUNTIME_PARAM
 
 static const AVOption aasrc_options[] = {
     { "sample_rate", "set the sample rate", OFFSET(sample_rate), AV_OPT_TYPE_INT, {.i64=0}, 0, INT_MAX, FLAGS },
+    { "drift", "set the input clock drift in ppm", OFFSET(drift), AV_OPT_TYPE_DOUBLE, {.dbl=0}, -100000, 100000, TFLAGS },
     {NULL}
 };
 
@@ -111,6 +119,14 @@ static const double rs1[][2] =
     {  2.438749735037705e+00, -1.110054033101757e-15 },
 };
 
+static double get_t_inc(AVFilterContext *ctx)
+{
+    const AASRCContext *s = ctx->priv;
+
+    return ctx->inputs[0]->sample_rate * (1.0 + s->drift * 1e-6) /
+           ctx->outputs[0]->sample_rate;
+}
+
 #define DEPTH 16
 #include "aasrc_template.c"
 
@@ -136,24 +152,29 @@ static int config_input(AVFilterLink *inlink)
 
     outlink->time_base = (AVRational) {1, outlink->sample_rate};
     s->channels = inlink->ch_layout.nb_channels;
-    s->t_inc = inlink->sample_rate / ((double)outlink->sample_rate);
+    s->t_inc = get_t_inc(ctx);
+
+    ff_aasrc_init(&s->dsp);
 
     switch (inlink->format) {
     case AV_SAMPLE_FMT_S16P:
         s->do_aasrc = aasrc_s16p;
         s->aasrc_uninit = aasrc_uninit_s16p;
+        s->aasrc_update = aasrc_update_s16p;
         s->nb_output_samples = nb_output_samples_s16p;
         ret = aasrc_init_s16p(ctx);
         break;
     case AV_SAMPLE_FMT_FLTP:
         s->do_aasrc = aasrc_fltp;
         s->aasrc_uninit = aasrc_uninit_fltp;
+        s->aasrc_update = aasrc_update_fltp;
         s->nb_output_samples = nb_output_samples_fltp;
         ret = aasrc_init_fltp(ctx);
         break;
     case AV_SAMPLE_FMT_DBLP:
         s->do_aasrc = aasrc_dblp;
         s->aasrc_uninit = aasrc_uninit_dblp;
+        s->aasrc_update = aasrc_update_dblp;
         s->nb_output_samples = nb_output_samples_dblp;
         ret = aasrc_init_dblp(ctx);
         break;
@@ -244,6 +265,24 @@ static int activate(AVFilterContext *ctx)
     return FFERROR_NOT_READY;
 }
 
+static int process_command(AVFilterContext *ctx, const char *cmd, const char *args,
+                           char *res, int res_len, int flags)
+{
+    AASRCContext *s = ctx->priv;
+    int ret;
+
+    ret = ff_filter_process_command(ctx, cmd, args, res, res_len, flags);
+    if (ret < 0)
+        return ret;
+
+    if (s->aasrc_update) {
+        s->t_inc = get_t_inc(ctx);
+        s->aasrc_update(ctx);
+    }
+
+    return 0;
+}
+
 static av_cold void uninit(AVFilterContext *ctx)
 {
     AASRCContext *s = ctx->priv;
@@ -299,5 +338,6 @@ const AVFilter ff_af_aasrc = {
     FILTER_INPUTS(inputs),
     FILTER_OUTPUTS(outputs),
     FILTER_QUERY_FUNC2(query_formats),
+    .process_command = process_command,
     .flags           = AVFILTER_FLAG_SLICE_THREADS,
 };
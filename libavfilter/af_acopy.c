@@ -57,6 +57,7 @@ const AVFilter ff_af_acopy = {
     .name          = "acopy",
     .description   = NULL_IF_CONFIG_SMALL("Copy the input audio unchanged to the output."),
     .flags         = AVFILTER_FLAG_METADATA_ONLY,
+    .flags_internal = FF_FILTER_FLAG_FRAME_SIZE_PASSTHROUGH,
     FILTER_INPUTS(acopy_inputs),
     FILTER_OUTPUTS(ff_audio_default_filterpad),
 };
@@ -43,6 +43,7 @@ typedef struct DeclickChannel {
     int y_size;
     uint8_t *click;
     int *index;
+    int *first;
     unsigned *histogram;
     int histogram_size;
 } DeclickChannel;
@@ -231,9 +232,10 @@ static int config_input(AVFilterLink *inlink)
         c->tmp = av_calloc(s->ar_order, sizeof(*c->tmp));
         c->click = av_calloc(s->window_size, sizeof(*c->click));
         c->index = av_calloc(s->window_size, sizeof(*c->index));
+        c->first = av_calloc(s->window_size, sizeof(*c->first));
         c->interpolated = av_calloc(s->window_size, sizeof(*c->interpolated));
         if (!c->auxiliary || !c->acoefficients || !c->detection || !c->click ||
-            !c->index || !c->interpolated || !c->acorrelation || !c->tmp)
+            !c->index || !c->first || !c->interpolated || !c->acorrelation || !c->tmp)
             return AVERROR(ENOMEM);
     }
 
@@ -243,9 +245,36 @@ static int config_input(AVFilterLink *inlink)
 static void autocorrelation(const double *input, int order, int size,
                             double *output, double scale)
 {
-    int i, j;
+    int i = 0, j;
+
+    /* four lags at a time, sharing the loads and keeping each sum in order */
+    for (; i + 3 <= order && i + 3 < size; i += 4) {
+        double value0 = 0., value1 = 0., value2 = 0., value3 = 0.;
+
+        for (j = i; j < i + 3; j++) {
+            value0 += input[j] * input[j - i];
+            if (j >= i + 1)
+                value1 += input[j] * input[j - i - 1];
+            if (j >= i + 2)
+                value2 += input[j] * input[j - i - 2];
+        }
+
+        for (; j < size; j++) {
+            const double x = input[j];
+
+            value0 += x * input[j - i];
+            value1 += x * input[j - i - 1];
+            value2 += x * input[j - i - 2];
+            value3 += x * input[j - i - 3];
+        }
+
+        output[i + 0] = value0 * scale;
+        output[i + 1] = value1 * scale;
+        output[i + 2] = value2 * scale;
+        output[i + 3] = value3 * scale;
+    }
 
-    for (i = 0; i <= order; i++) {
+    for (; i <= order; i++) {
         double value = 0.;
 
         for (j = i; j < size; j++)
@@ -290,41 +319,32 @@ static double autoregression(const double *samples, int ar_order,
     return sqrt(alpha);
 }
 
-static int isfinite_array(double *samples, int nb_samples)
+static int is_silent(const double *samples, int nb_samples)
 {
-    int i;
-
-    for (i = 0; i < nb_samples; i++)
-        if (!isfinite(samples[i]))
+    for (int i = 0; i < nb_samples; i++)
+        if (samples[i] != 0.)
             return 0;
 
     return 1;
 }
 
-static int find_index(int *index, int value, int size)
+static int isfinite_array(double *samples, int nb_samples)
 {
-    int i, start, end;
-
-    if ((value < index[0]) || (value > index[size - 1]))
-        return 1;
-
-    i = start = 0;
-    end = size - 1;
+    int i;
 
-    while (start <= end) {
-        i = (end + start) / 2;
-        if (index[i] == value)
+    for (i = 0; i < nb_samples; i++)
+        if (!isfinite(samples[i]))
             return 0;
-        if (value < index[i])
-            end = i - 1;
-        if (value > index[i])
-            start = i + 1;
-    }
 
     return 1;
 }
 
-static int factorization(double *matrix, int n)
+/*
+ * LDL^T factorization of a matrix whose row i has no nonzero entries left
+ * of column first[i], with first[] non-decreasing. The factor keeps the same
+ * envelope, so only entries inside it are read or written.
+ */
+static int factorization(double *matrix, const int *first, int n)
 {
     int i, j, k;
 
@@ -333,7 +353,7 @@ static int factorization(double *matrix, int n)
         double value;
 
         value = matrix[in + i];
-        for (j = 0; j < i; j++)
+        for (j = first[i]; j < i; j++)
             value -= matrix[j * n + j] * matrix[in + j] * matrix[in + j];
 
         if (value == 0.) {
@@ -341,12 +361,12 @@ static int factorization(double *matrix, int n)
         }
 
         matrix[in + i] = value;
-        for (j = i + 1; j < n; j++) {
+        for (j = i + 1; j < n && first[j] <= i; j++) {
             const int jn = j * n;
             double x;
 
             x = matrix[jn + i];
-            for (k = 0; k < i; k++)
+            for (k = first[j]; k < i; k++)
                 x -= matrix[k * n + k] * matrix[in + k] * matrix[jn + k];
             matrix[jn + i] = x / matrix[in + i];
         }
@@ -356,12 +376,12 @@ static int factorization(double *matrix, int n)
 }
 
 static int do_interpolation(DeclickChannel *c, double *matrix,
-                            double *vector, int n, double *out)
+                            const int *first, double *vector, int n, double *out)
 {
     int i, j, ret;
     double *y;
 
-    ret = factorization(matrix, n);
+    ret = factorization(matrix, first, n);
     if (ret < 0)
         return ret;
 
@@ -375,14 +395,14 @@ static int do_interpolation(DeclickChannel *c, double *matrix,
         double value;
 
         value = vector[i];
-        for (j = 0; j < i; j++)
+        for (j = first[i]; j < i; j++)
             value -= matrix[in + j] * y[j];
         y[i] = value;
     }
 
     for (i = n - 1; i >= 0; i--) {
         out[i] = y[i] / matrix[i * n + i];
-        for (j = i + 1; j < n; j++)
+        for (j = i + 1; j < n && first[j] <= i; j++)
             out[i] -= matrix[j * n + i] * out[j];
     }
 
@@ -390,9 +410,11 @@ static int do_interpolation(DeclickChannel *c, double *matrix,
 }
 
 static int interpolation(DeclickChannel *c, const double *src, int ar_order,
-                         double *acoefficients, int *index, int nb_errors,
+                         double *acoefficients, const uint8_t *click,
+                         int *index, int nb_errors,
                          double *auxiliary, double *interpolated)
 {
+    int *first = c->first;
     double *vector, *matrix;
     int i, j;
 
@@ -408,29 +430,68 @@ static int interpolation(DeclickChannel *c, const double *src, int ar_order,
 
     autocorrelation(acoefficients, ar_order, ar_order + 1, auxiliary, 1.);
 
+    /* errors further apart than the AR order do not interact, so the
+     * matrix is banded and only the band is filled */
     for (i = 0; i < nb_errors; i++) {
         const int im = i * nb_errors;
+        int lo = i ? first[i - 1] : 0;
 
-        for (j = i; j < nb_errors; j++) {
-            if (abs(index[j] - index[i]) <= ar_order) {
-                matrix[j * nb_errors + i] = matrix[im + j] = auxiliary[abs(index[j] - index[i])];
-            } else {
-                matrix[j * nb_errors + i] = matrix[im + j] = 0;
-            }
-        }
+        while (index[i] - index[lo] > ar_order)
+            lo++;
+        first[i] = lo;
+
+        for (j = i; j < nb_errors && index[j] - index[i] <= ar_order; j++)
+            matrix[j * nb_errors + i] = matrix[im + j] = auxiliary[index[j] - index[i]];
     }
 
     for (i = 0; i < nb_errors; i++) {
         double value = 0.;
 
         for (j = -ar_order; j <= ar_order; j++)
-            if (find_index(index, index[i] - j, nb_errors))
+            if (!click[index[i] - j])
                 value -= src[index[i] - j] * auxiliary[abs(j)];
 
         vector[i] = value;
     }
 
-    return do_interpolation(c, matrix, vector, nb_errors, interpolated);
+    return do_interpolation(c, matrix, first, vector, nb_errors, interpolated);
+}
+
+static void ar_residual(double *detection, const double *acoefficients,
+                        const double *src, int ar_order, int size)
+{
+    int i;
+
+    memset(detection, 0, ar_order * sizeof(*detection));
+
+    /* four outputs at a time, each accumulated in a register */
+    for (i = ar_order; i + 4 <= size; i += 4) {
+        double value0 = 0., value1 = 0., value2 = 0., value3 = 0.;
+
+        for (int j = 0; j <= ar_order; j++) {
+            const double a = acoefficients[j];
+            const double *x = src + i - j;
+
+            value0 += a * x[0];
+            value1 += a * x[1];
+            value2 += a * x[2];
+            value3 += a * x[3];
+        }
+
+        detection[i + 0] = value0;
+        detection[i + 1] = value1;
+        detection[i + 2] = value2;
+        detection[i + 3] = value3;
+    }
+
+    for (; i < size; i++) {
+        double value = 0.;
+
+        for (int j = 0; j <= ar_order; j++)
+            value += acoefficients[j] * src[i - j];
+
+        detection[i] = value;
+    }
 }
 
 static int detect_clips(AudioDeclickContext *s, DeclickChannel *c,
@@ -492,13 +553,7 @@ static int detect_clicks(AudioDeclickContext *s, DeclickChannel *c,
     const double threshold = s->threshold;
     int i, j, nb_clicks = 0, prev = -1;
 
-    memset(detection, 0, s->window_size * sizeof(*detection));
-
-    for (i = s->ar_order; i < s->window_size; i++) {
-        for (j = 0; j <= s->ar_order; j++) {
-            detection[i] += acoefficients[j] * src[i - j];
-        }
-    }
+    ar_residual(detection, acoefficients, src, s->ar_order, s->window_size);
 
     for (i = 0; i < s->window_size; i++) {
         click[i] = fabs(detection[i]) > sigmae * threshold;
@@ -533,15 +588,9 @@ static int detect_surges(AudioDeclickContext *s, DeclickChannel *c,
 {
     const double threshold = s->threshold;
     const int size = s->nb_surge_samples * 2;
-    int i, j, nb_surges = 0;
+    int i, nb_surges = 0;
 
-    memset(detection, 0, s->window_size * sizeof(*detection));
-
-    for (i = s->ar_order; i < s->window_size; i++) {
-        for (j = 0; j <= s->ar_order; j++) {
-            detection[i] += acoefficients[j] * src[i - j];
-        }
-    }
+    ar_residual(detection, acoefficients, src, s->ar_order, s->window_size);
 
     for (i = 0; i < s->window_size; i++) {
         surge[i] = fabs(detection[i]) > sigmae * threshold;
@@ -581,37 +630,54 @@ static int filter_channel(AVFilterContext *ctx, void *arg, int ch, int nb_jobs)
     double *buf = (double *)s->buffer->extended_data[ch];
     const double *w = s->window_func_lut;
     DeclickChannel *c = &s->chan[ch];
+    int *index = c->index;
+    int j, ret, nb_errors = 0, fit = 1;
     double sigmae;
-    int j, ret;
 
-    sigmae = autoregression(src, s->ar_order, s->window_size, c->acoefficients, c->acorrelation, c->tmp);
+    if (s->mode == 1) {
+        /* clips are found without the AR model, so fit it only if needed */
+        nb_errors = s->detector(s, c, 0., c->detection, c->acoefficients,
+                                c->click, index, src, dst);
+        if (nb_errors < 0)
+            return nb_errors;
+        fit = nb_errors > 0;
+    }
 
-    if (isfinite_array(c->acoefficients, s->ar_order + 1)) {
-        double *interpolated = c->interpolated;
-        int *index = c->index;
-        int nb_errors;
+    if (fit) {
+        /* a silent window has no AR model, same as a non-finite fit */
+        if (is_silent(src, s->window_size)) {
+            memcpy(dst, src, s->window_size * sizeof(*dst));
+            nb_errors = 0;
+        } else {
+            sigmae = autoregression(src, s->ar_order, s->window_size, c->acoefficients, c->acorrelation, c->tmp);
+
+            if (!isfinite_array(c->acoefficients, s->ar_order + 1)) {
+                memcpy(dst, src, s->window_size * sizeof(*dst));
+                nb_errors = 0;
+            } else if (s->mode != 1) {
+                nb_errors = s->detector(s, c, sigmae, c->detection, c->acoefficients,
+                                        c->click, index, src, dst);
+            }
+        }
+    }
 
-        nb_errors = s->detector(s, c, sigmae, c->detection, c->acoefficients,
-                                c->click, index, src, dst);
-        if (nb_errors > 0) {
-            double *enabled = (double *)s->enabled->extended_data[0];
+    if (nb_errors > 0) {
+        double *enabled = (double *)s->enabled->extended_data[0];
+        double *interpolated = c->interpolated;
 
-            ret = interpolation(c, src, s->ar_order, c->acoefficients, index,
-                                nb_errors, c->auxiliary, interpolated);
-            if (ret < 0)
-                return ret;
+        ret = interpolation(c, src, s->ar_order, c->acoefficients, c->click,
+                            index, nb_errors, c->auxiliary, interpolated);
+        if (ret < 0)
+            return ret;
 
-            av_audio_fifo_peek(s->efifo, (void**)s->enabled->extended_data, s->window_size);
+        av_audio_fifo_peek(s->efifo, (void**)s->enabled->extended_data, s->window_size);
 
-            for (j = 0; j < nb_errors; j++) {
-                if (enabled[index[j]]) {
-                    dst[index[j]] = interpolated[j];
-                    is[index[j]] = 1;
-                }
+        for (j = 0; j < nb_errors; j++) {
+            if (enabled[index[j]]) {
+                dst[index[j]] = interpolated[j];
+                is[index[j]] = 1;
             }
         }
-    } else {
-        memcpy(dst, src, s->window_size * sizeof(*dst));
     }
 
     if (s->method == 0) {
@@ -802,6 +868,7 @@ static av_cold void uninit(AVFilterContext *ctx)
             av_freep(&c->tmp);
             av_freep(&c->click);
             av_freep(&c->index);
+            av_freep(&c->first);
             av_freep(&c->interpolated);
             av_freep(&c->matrix);
             c->matrix_size = 0;
@@ -27,6 +27,7 @@
 
 #include "libavutil/opt.h"
 #include "audio.h"
+#include "audiomixdsp.h"
 #include "avfilter.h"
 #include "filters.h"
 
@@ -45,13 +46,18 @@ typedef struct AudioFadeContext {
     int passthrough;
     int64_t pts;
 
-    void (*fade_samples)(uint8_t **dst, uint8_t * const *src,
+    AudioMixDSPContext dsp;
+
+    void (*fade_samples)(struct AudioFadeContext *s,
+                         uint8_t **dst, uint8_t * const *src,
                          int nb_samples, int channels, int direction,
                          int64_t start, int64_t range, int curve,
                          double silence, double unity);
-    void (*scale_samples)(uint8_t **dst, uint8_t * const *src,
+    void (*scale_samples)(struct AudioFadeContext *s,
+                          uint8_t **dst, uint8_t * const *src,
                           int nb_samples, int channels, double unity);
-    void (*crossfade_samples)(uint8_t **dst, uint8_t * const *cf0,
+    void (*crossfade_samples)(struct AudioFadeContext *s,
+                              uint8_t **dst, uint8_t * const *cf0,
                               uint8_t * const *cf1,
                               int nb_samples, int channels,
                               int curve0, int curve1);
@@ -63,6 +69,9 @@ enum CurveType { NONE = -1, TRI, QSIN, ESIN, HSIN, LOG, IPAR, QUA, CUB, SQU, CBR
 #define FLAGS AV_OPT_FLAG_AUDIO_PARAM|AV_OPT_FLAG_FILTERING_PARAM
 #define TFLAGS AV_OPT_FLAG_AUDIO_PARAM|AV_OPT_FLAG_FILTERING_PARAM|AV_OPT_FLAG_RUNTIME_PARAM
 
+/* Number of fade gains computed at once before being applied to all channels */
+#define FADE_BLOCK_SIZE 256
+
     static const enum AVSampleFormat sample_fmts[] = {
         AV_SAMPLE_FMT_S16, AV_SAMPLE_FMT_S16P,
         AV_SAMPLE_FMT_S32, AV_SAMPLE_FMT_S32P,
@@ -91,6 +100,8 @@ static int config_output(AVFilterLink *outlink)
     AVFilterContext *ctx = outlink->src;
     AudioFadeContext *s  = ctx->priv;
 
+    ff_audio_mix_init(&s->dsp);
+
     switch (outlink->format) {
     case AV_SAMPLE_FMT_DBL:  s->fade_samples = fade_samples_dbl;
                              s->scale_samples = scale_samples_dbl;
@@ -214,13 +225,13 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *buf)
             av_samples_set_silence(out_buf->extended_data, 0, nb_samples,
                                    out_buf->ch_layout.nb_channels, out_buf->format);
         } else {
-            s->scale_samples(out_buf->extended_data, buf->extended_data,
+            s->scale_samples(s, out_buf->extended_data, buf->extended_data,
                              nb_samples, buf->ch_layout.nb_channels,
                              s->silence);
         }
     } else if (( s->type && (cur_sample + nb_samples < s->start_sample)) ||
                (!s->type && (s->start_sample + s->nb_samples < cur_sample))) {
-        s->scale_samples(out_buf->extended_data, buf->extended_data,
+        s->scale_samples(s, out_buf->extended_data, buf->extended_data,
                          nb_samples, buf->ch_layout.nb_channels,
                          s->unity);
     } else {
@@ -231,7 +242,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *buf)
         else
             start = s->start_sample + s->nb_samples - cur_sample;
 
-        s->fade_samples(out_buf->extended_data, buf->extended_data,
+        s->fade_samples(s, out_buf->extended_data, buf->extended_data,
                         nb_samples, buf->ch_layout.nb_channels,
                         s->type ? -1 : 1, start,
                         s->nb_samples, s->curve, s->silence, s->unity);
@@ -395,7 +406,7 @@ static int activate(AVFilterContext *ctx)
                 return ret;
             }
 
-            s->crossfade_samples(out->extended_data, cf[0]->extended_data,
+            s->crossfade_samples(s, out->extended_data, cf[0]->extended_data,
                                  cf[1]->extended_data,
                                  s->nb_samples, out->ch_layout.nb_channels,
                                  s->curve, s->curve2);
@@ -417,7 +428,7 @@ static int activate(AVFilterContext *ctx)
                 return ret;
             }
 
-            s->fade_samples(out->extended_data, cf[0]->extended_data, s->nb_samples,
+            s->fade_samples(s, out->extended_data, cf[0]->extended_data, s->nb_samples,
                             outlink->ch_layout.nb_channels, -1, s->nb_samples - 1, s->nb_samples, s->curve, 0., 1.);
             out->pts = s->pts;
             s->pts += av_rescale_q(s->nb_samples,
@@ -437,7 +448,7 @@ static int activate(AVFilterContext *ctx)
                 return ret;
             }
 
-            s->fade_samples(out->extended_data, cf[1]->extended_data, s->nb_samples,
+            s->fade_samples(s, out->extended_data, cf[1]->extended_data, s->nb_samples,
                             outlink->ch_layout.nb_channels, 1, 0, s->nb_samples, s->curve2, 0., 1.);
             out->pts = s->pts;
             s->pts += av_rescale_q(s->nb_samples,
@@ -67,7 +67,6 @@ typedef struct DeNoiseChannel {
     double      band_noise[NB_PROFILE_BANDS];
     double      noise_band_auto_var[NB_PROFILE_BANDS];
     double      noise_band_sample[NB_PROFILE_BANDS];
-    double     *amt;
     double     *band_amt;
     double     *band_excit;
     double     *gain;
@@ -77,8 +76,8 @@ typedef struct DeNoiseChannel {
     double     *clean_data;
     double     *noisy_data;
     double     *out_samples;
-    double     *spread_function;
     double     *abs_var;
+    double     *rabs_var;
     double     *rel_var;
     double     *min_abs_var;
     void       *fft_in;
@@ -143,6 +142,9 @@ typedef struct AudioFFTDeNoiseContext {
     double *window;
     double *band_alpha;
     double *band_beta;
+    double *spread_scale;
+    double  spread_up;
+    double  spread_down;
 
     DeNoiseChannel *dnch;
 
@@ -315,18 +317,28 @@ static double limit_gain(double a, double b)
 static void spectral_flatness(AudioFFTDeNoiseContext *s, const double *const spectral,
                               double floor, int len, double *rnum, double *rden)
 {
-    double num = 0., den = 0.;
-    int size = 0;
+    double num = 0., den = 0., product = 1.;
+    int size = 0, exponent = 0;
 
+    /* sum the logs as the log of a product, kept in range with frexp() */
     for (int n = 0; n < len; n++) {
         const double v = spectral[n];
         if (v > floor) {
-            num += log(v);
+            int e;
+
+            product *= frexp(v, &e);
+            exponent += e;
             den += v;
             size++;
+            if (!(size & 511)) {
+                product = frexp(product, &e);
+                exponent += e;
+            }
         }
     }
 
+    num = log(product) + exponent * M_LN2;
+
     size = FFMAX(size, 1);
 
     num /= size;
@@ -358,6 +370,83 @@ static double get_power(double x, double y)
     return x*x + y*y;
 }
 
+/*
+ * Spread the band excitation over the neighbouring bands. The spreading
+ * falls off geometrically on each side, so the full band by band product
+ * reduces to one recursive pass in each direction.
+ */
+static void spread_bands(AudioFFTDeNoiseContext *s, const double *excit,
+                         double *amt, const double *scale)
+{
+    const double up = s->spread_up, down = s->spread_down;
+    const int nb_bands = s->number_of_bands;
+    double acc = 0.;
+
+    for (int i = 0; i < nb_bands; i++) {
+        amt[i] = acc;
+        acc = down * (acc + excit[i]);
+    }
+
+    acc = 0.;
+    for (int i = nb_bands - 1; i >= 0; i--) {
+        amt[i] += excit[i] + acc;
+        acc = up * (acc + excit[i]);
+        if (scale)
+            amt[i] *= scale[i];
+    }
+}
+
+static void smooth_gain(const double *gain, double *smoothed_gain,
+                        const int r, const int bin_count)
+{
+    int i = r;
+
+    /* four bins at a time to keep independent sums in flight */
+    for (; i + 4 <= bin_count - r; i += 4) {
+        const double gc0 = gain[i + 0], gc1 = gain[i + 1];
+        const double gc2 = gain[i + 2], gc3 = gain[i + 3];
+        double num0 = 0., num1 = 0., num2 = 0., num3 = 0.;
+        double den0 = 0., den1 = 0., den2 = 0., den3 = 0.;
+
+        for (int j = -r; j <= r; j++) {
+            const double *g = gain + i + j;
+            const double d0 = 1. - fabs(g[0] - gc0);
+            const double d1 = 1. - fabs(g[1] - gc1);
+            const double d2 = 1. - fabs(g[2] - gc2);
+            const double d3 = 1. - fabs(g[3] - gc3);
+
+            num0 += g[0] * d0;
+            num1 += g[1] * d1;
+            num2 += g[2] * d2;
+            num3 += g[3] * d3;
+            den0 += d0;
+            den1 += d1;
+            den2 += d2;
+            den3 += d3;
+        }
+
+        smoothed_gain[i + 0] = num0 / den0;
+        smoothed_gain[i + 1] = num1 / den1;
+        smoothed_gain[i + 2] = num2 / den2;
+        smoothed_gain[i + 3] = num3 / den3;
+    }
+
+    for (; i < bin_count - r; i++) {
+        const double gc = gain[i];
+        double num = 0., den = 0.;
+
+        for (int j = -r; j <= r; j++) {
+            const double g = gain[i + j];
+            const double d = 1. - fabs(g - gc);
+
+            num += g * d;
+            den += d;
+        }
+
+        smoothed_gain[i] = num / den;
+    }
+}
+
 static void process_frame(AVFilterContext *ctx,
                           AudioFFTDeNoiseContext *s, DeNoiseChannel *dnch,
                           double *prior, double *prior_band_excit, int track_noise)
@@ -365,6 +454,9 @@ static void process_frame(AVFilterContext *ctx,
     AVFilterLink *outlink = ctx->outputs[0];
     FilterLink      *outl = ff_filter_link(outlink);
     const double *abs_var = dnch->abs_var;
+    const double *rabs_var = dnch->rabs_var;
+    const double *min_abs_var = dnch->min_abs_var;
+    const double max_gain = dnch->max_gain;
     const double ratio = outl->frame_count_out ? s->ratio : 1.0;
     const double rratio = 1. - ratio;
     const int *bin2band = s->bin2band;
@@ -374,28 +466,31 @@ static void process_frame(AVFilterContext *ctx,
     double *smoothed_gain = dnch->smoothed_gain;
     AVComplexDouble *fft_data_dbl = dnch->fft_out;
     AVComplexFloat *fft_data_flt = dnch->fft_out;
+    double *clean_data = dnch->clean_data;
     double *gain = dnch->gain;
 
-    for (int i = 0; i < s->bin_count; i++) {
-        double sqr_new_gain, new_gain, power, mag_abs_var, new_mag_abs_var;
+    switch (s->format) {
+    case AV_SAMPLE_FMT_FLTP:
+        for (int i = 0; i < s->bin_count; i++)
+            noisy_data[i] = get_power(fft_data_flt[i].re, fft_data_flt[i].im);
+        break;
+    case AV_SAMPLE_FMT_DBLP:
+        for (int i = 0; i < s->bin_count; i++)
+            noisy_data[i] = get_power(fft_data_dbl[i].re, fft_data_dbl[i].im);
+        break;
+    default:
+        av_assert0(0);
+    }
 
-        switch (s->format) {
-        case AV_SAMPLE_FMT_FLTP:
-            noisy_data[i] = power = get_power(fft_data_flt[i].re, fft_data_flt[i].im);
-            break;
-        case AV_SAMPLE_FMT_DBLP:
-            noisy_data[i] = power = get_power(fft_data_dbl[i].re, fft_data_dbl[i].im);
-            break;
-        default:
-            av_assert0(0);
-        }
+    for (int i = 0; i < s->bin_count; i++) {
+        const double power = noisy_data[i];
+        const double mag_abs_var = power * rabs_var[i];
+        const double new_mag_abs_var = ratio * prior[i] + rratio * FFMAX(mag_abs_var - 1.0, 0.0);
+        const double new_gain = new_mag_abs_var / (1.0 + new_mag_abs_var);
+        const double sqr_new_gain = new_gain * new_gain;
 
-        mag_abs_var = power / abs_var[i];
-        new_mag_abs_var = ratio * prior[i] + rratio * fmax(mag_abs_var - 1.0, 0.0);
-        new_gain = new_mag_abs_var / (1.0 + new_mag_abs_var);
-        sqr_new_gain = new_gain * new_gain;
         prior[i] = mag_abs_var * sqr_new_gain;
-        dnch->clean_data[i] = power * sqr_new_gain;
+        clean_data[i] = power * sqr_new_gain;
         gain[i] = new_gain;
     }
 
@@ -414,13 +509,19 @@ static void process_frame(AVFilterContext *ctx,
         }
     }
 
-    for (int i = 0; i < s->number_of_bands; i++) {
+    for (int i = 0; i < s->number_of_bands; i++)
         band_excit[i] = 0.0;
-        band_amt[i] = 0.0;
-    }
 
-    for (int i = 0; i < s->bin_count; i++)
-        band_excit[bin2band[i]] += dnch->clean_data[i];
+    /* bins map to bands in ascending order, so sum each run in a register */
+    for (int i = 0, band = bin2band[0]; i < s->bin_count;) {
+        double sum = 0.0;
+
+        for (; i < s->bin_count && bin2band[i] == band; i++)
+            sum += clean_data[i];
+        band_excit[band] = sum;
+        if (i < s->bin_count)
+            band = bin2band[i];
+    }
 
     for (int i = 0; i < s->number_of_bands; i++) {
         band_excit[i] = fmax(band_excit[i],
@@ -429,46 +530,25 @@ static void process_frame(AVFilterContext *ctx,
         prior_band_excit[i] = band_excit[i];
     }
 
-    for (int j = 0, i = 0; j < s->number_of_bands; j++) {
-        for (int k = 0; k < s->number_of_bands; k++) {
-            band_amt[j] += dnch->spread_function[i++] * band_excit[k];
-        }
-    }
-
-    for (int i = 0; i < s->bin_count; i++)
-        dnch->amt[i] = band_amt[bin2band[i]];
+    spread_bands(s, band_excit, band_amt, s->spread_scale);
 
     for (int i = 0; i < s->bin_count; i++) {
-        if (dnch->amt[i] > abs_var[i]) {
+        const double amt = band_amt[bin2band[i]];
+
+        if (amt > abs_var[i]) {
             gain[i] = 1.0;
-        } else if (dnch->amt[i] > dnch->min_abs_var[i]) {
-            const double limit = sqrt(abs_var[i] / dnch->amt[i]);
+        } else if (amt > min_abs_var[i]) {
+            const double limit = sqrt(abs_var[i] / amt);
 
             gain[i] = limit_gain(gain[i], limit);
         } else {
-            gain[i] = limit_gain(gain[i], dnch->max_gain);
+            gain[i] = limit_gain(gain[i], max_gain);
         }
     }
 
     memcpy(smoothed_gain, gain, s->bin_count * sizeof(*smoothed_gain));
-    if (s->gain_smooth > 0) {
-        const int r = s->gain_smooth;
-
-        for (int i = r; i < s->bin_count - r; i++) {
-            const double gc = gain[i];
-            double num = 0., den = 0.;
-
-            for (int j = -r; j <= r; j++) {
-                const double g = gain[i + j];
-                const double d = 1. - fabs(g - gc);
-
-                num += g * d;
-                den += d;
-            }
-
-            smoothed_gain[i] = num / den;
-        }
-    }
+    if (s->gain_smooth > 0)
+        smooth_gain(gain, smoothed_gain, s->gain_smooth, s->bin_count);
 
     switch (s->format) {
     case AV_SAMPLE_FMT_FLTP:
@@ -600,6 +680,7 @@ static void set_parameters(AudioFFTDeNoiseContext *s, DeNoiseChannel *dnch, int
 
         for (int i = 0; i < s->bin_count; i++) {
             dnch->abs_var[i] = fmax(dnch->max_var * dnch->rel_var[i], 1.0);
+            dnch->rabs_var[i] = 1.0 / dnch->abs_var[i];
             dnch->min_abs_var[i] = dnch->gain_scale * dnch->abs_var[i];
         }
     }
@@ -622,7 +703,7 @@ static int config_input(AVFilterLink *inlink)
     AVFilterContext *ctx = inlink->dst;
     AudioFFTDeNoiseContext *s = ctx->priv;
     double wscale, sar, sum, sdiv;
-    int i, j, k, m, n, ret, tx_type;
+    int i, j, k, m, ret, tx_type;
     double dscale = 1.;
     float fscale = 1.f;
     void *scale;
@@ -706,7 +787,8 @@ static int config_input(AVFilterLink *inlink)
 
     s->band_alpha = av_calloc(s->number_of_bands, sizeof(*s->band_alpha));
     s->band_beta = av_calloc(s->number_of_bands, sizeof(*s->band_beta));
-    if (!s->band_alpha || !s->band_beta)
+    s->spread_scale = av_calloc(s->number_of_bands, sizeof(*s->spread_scale));
+    if (!s->band_alpha || !s->band_beta || !s->spread_scale)
         return AVERROR(ENOMEM);
 
     for (int ch = 0; ch < inlink->ch_layout.nb_channels; ch++) {
@@ -734,7 +816,6 @@ static int config_input(AVFilterLink *inlink)
 
         reduce_mean(dnch->band_noise);
 
-        dnch->amt = av_calloc(s->bin_count, sizeof(*dnch->amt));
         dnch->band_amt = av_calloc(s->number_of_bands, sizeof(*dnch->band_amt));
         dnch->band_excit = av_calloc(s->number_of_bands, sizeof(*dnch->band_excit));
         dnch->gain = av_calloc(s->bin_count, sizeof(*dnch->gain));
@@ -745,21 +826,19 @@ static int config_input(AVFilterLink *inlink)
         dnch->noisy_data = av_calloc(s->bin_count, sizeof(*dnch->noisy_data));
         dnch->out_samples = av_calloc(s->buffer_length, sizeof(*dnch->out_samples));
         dnch->abs_var = av_calloc(s->bin_count, sizeof(*dnch->abs_var));
+        dnch->rabs_var = av_calloc(s->bin_count, sizeof(*dnch->rabs_var));
         dnch->rel_var = av_calloc(s->bin_count, sizeof(*dnch->rel_var));
         dnch->min_abs_var = av_calloc(s->bin_count, sizeof(*dnch->min_abs_var));
         dnch->fft_in = av_calloc(s->fft_length2, s->sample_size);
         dnch->fft_out = av_calloc(s->fft_length2 + 1, s->complex_sample_size);
-        ret = av_tx_init(&dnch->fft, &dnch->tx_fn, tx_type, 0, s->fft_length2, scale, 0);
+        ret = av_tx_init(&dnch->fft, &dnch->tx_fn, tx_type, 0, s->fft_length2, scale, AV_TX_REUSE);
         if (ret < 0)
             return ret;
-        ret = av_tx_init(&dnch->ifft, &dnch->itx_fn, tx_type, 1, s->fft_length2, scale, 0);
+        ret = av_tx_init(&dnch->ifft, &dnch->itx_fn, tx_type, 1, s->fft_length2, scale, AV_TX_REUSE);
         if (ret < 0)
             return ret;
-        dnch->spread_function = av_calloc(s->number_of_bands * s->number_of_bands,
-                                          sizeof(*dnch->spread_function));
 
-        if (!dnch->amt ||
-            !dnch->band_amt ||
+        if (!dnch->band_amt ||
             !dnch->band_excit ||
             !dnch->gain ||
             !dnch->smoothed_gain ||
@@ -771,48 +850,29 @@ static int config_input(AVFilterLink *inlink)
             !dnch->fft_in ||
             !dnch->fft_out ||
             !dnch->abs_var ||
+            !dnch->rabs_var ||
             !dnch->rel_var ||
             !dnch->min_abs_var ||
-            !dnch->spread_function ||
             !dnch->fft ||
             !dnch->ifft)
             return AVERROR(ENOMEM);
     }
 
+    s->spread_up = pow(0.1, 2.5 / sdiv);
+    s->spread_down = pow(0.1, 1.0 / sdiv);
+
     for (int ch = 0; ch < inlink->ch_layout.nb_channels; ch++) {
         DeNoiseChannel *dnch = &s->dnch[ch];
         double *prior_band_excit = dnch->prior_band_excit;
         double min, max;
-        double p1, p2;
-
-        p1 = pow(0.1, 2.5 / sdiv);
-        p2 = pow(0.1, 1.0 / sdiv);
-        j = 0;
-        for (m = 0; m < s->number_of_bands; m++) {
-            for (n = 0; n < s->number_of_bands; n++) {
-                if (n < m) {
-                    dnch->spread_function[j++] = pow(p2, m - n);
-                } else if (n > m) {
-                    dnch->spread_function[j++] = pow(p1, n - m);
-                } else {
-                    dnch->spread_function[j++] = 1.0;
-                }
-            }
-        }
 
-        for (m = 0; m < s->number_of_bands; m++) {
+        for (m = 0; m < s->number_of_bands; m++)
             dnch->band_excit[m] = 0.0;
-            prior_band_excit[m] = 0.0;
-        }
 
         for (m = 0; m < s->bin_count; m++)
             dnch->band_excit[s->bin2band[m]] += 1.0;
 
-        j = 0;
-        for (m = 0; m < s->number_of_bands; m++) {
-            for (n = 0; n < s->number_of_bands; n++)
-                prior_band_excit[m] += dnch->spread_function[j++] * dnch->band_excit[n];
-        }
+        spread_bands(s, dnch->band_excit, prior_band_excit, NULL);
 
         min = pow(0.1, 2.5);
         max = pow(0.1, 1.0);
@@ -828,10 +888,8 @@ static int config_input(AVFilterLink *inlink)
         for (int i = 0; i < s->buffer_length; i++)
             dnch->out_samples[i] = 0;
 
-        j = 0;
         for (int i = 0; i < s->number_of_bands; i++)
-            for (int k = 0; k < s->number_of_bands; k++)
-                dnch->spread_function[j++] *= dnch->band_excit[i] / prior_band_excit[i];
+            s->spread_scale[i] = dnch->band_excit[i] / prior_band_excit[i];
     }
 
     j = 0;
@@ -1310,12 +1368,12 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_freep(&s->bin2band);
     av_freep(&s->band_alpha);
     av_freep(&s->band_beta);
+    av_freep(&s->spread_scale);
     av_frame_free(&s->winframe);
 
     if (s->dnch) {
         for (int ch = 0; ch < s->channels; ch++) {
             DeNoiseChannel *dnch = &s->dnch[ch];
-            av_freep(&dnch->amt);
             av_freep(&dnch->band_amt);
             av_freep(&dnch->band_excit);
             av_freep(&dnch->gain);
@@ -1325,8 +1383,8 @@ static av_cold void uninit(AVFilterContext *ctx)
             av_freep(&dnch->clean_data);
             av_freep(&dnch->noisy_data);
             av_freep(&dnch->out_samples);
-            av_freep(&dnch->spread_function);
             av_freep(&dnch->abs_var);
+            av_freep(&dnch->rabs_var);
             av_freep(&dnch->rel_var);
             av_freep(&dnch->min_abs_var);
             av_freep(&dnch->fft_in);
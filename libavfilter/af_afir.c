@@ -34,6 +34,8 @@
 #include "libavutil/frame.h"
 #include "libavutil/log.h"
 #include "libavutil/opt.h"
+#include "libavutil/samplefmt.h"
+#include "libavutil/time.h"
 
 #include "audio.h"
 #include "avfilter.h"
@@ -71,7 +73,10 @@ typedef struct AudioIR {
     int eof_coeffs;
     int have_coeffs;
     int nb_taps;
+    int norm_taps;
     int nb_segments;
+    int nb_partitions;
+    int nb_prepared;
     int max_offset;
     int64_t delay;
     double *ch_gain;
@@ -91,12 +96,15 @@ typedef struct AudioFIRContext {
     float ir_gain;
     int ir_format;
     int ir_load;
+    int ir_step;
     float max_ir_len;
     int minp;
     int maxp;
+    int64_t latency;
     int nb_irs;
     int prev_selir;
     int selir;
+    int next_selir;
     int precision;
     int format;
 
@@ -187,16 +195,16 @@ static int init_segment(AVFilterContext *ctx, AudioFIRSegment *seg, int selir,
 
     for (int ch = 0; ch < ctx->inputs[0]->ch_layout.nb_channels && part_size >= 1; ch++) {
         ret = av_tx_init(&seg->ctx[ch], &seg->ctx_fn, tx_type,
-                         0, 2 * part_size, &cscale,  0);
+                         0, 2 * part_size, &cscale, AV_TX_REUSE);
         if (ret < 0)
             return ret;
 
         ret = av_tx_init(&seg->tx[ch],  &seg->tx_fn,  tx_type,
-                         0, 2 * part_size, &scale,  0);
+                         0, 2 * part_size, &scale,  AV_TX_REUSE);
         if (ret < 0)
             return ret;
         ret = av_tx_init(&seg->itx[ch], &seg->itx_fn, tx_type,
-                         1, 2 * part_size, &iscale, 0);
+                         1, 2 * part_size, &iscale, AV_TX_REUSE);
         if (ret < 0)
             return ret;
     }
@@ -216,6 +224,38 @@ static int init_segment(AVFilterContext *ctx, AudioFIRSegment *seg, int selir,
     return 0;
 }
 
+static int init_segments(AVFilterContext *ctx, AudioIR *ir, int selir, int nb_taps)
+{
+    AudioFIRContext *s = ctx->priv;
+    int part_size, max_part_size;
+    int ret, left, offset = 0;
+
+    left = nb_taps;
+    part_size = s->minp;
+    max_part_size = s->maxp;
+
+    ir->seg = av_calloc(get_nb_segments(ctx, s, nb_taps), sizeof(*ir->seg));
+    if (!ir->seg)
+        return AVERROR(ENOMEM);
+
+    for (int i = 0; left > 0; i++) {
+        int step = (part_size == max_part_size) ? INT_MAX : 1 + (i == 0);
+        int nb_partitions = FFMIN(step, (left + part_size - 1) / part_size);
+
+        ret = init_segment(ctx, &ir->seg[i], selir, offset, nb_partitions, part_size, i);
+        if (ret < 0)
+            return ret;
+        ir->nb_segments = i + 1;
+        offset += nb_partitions * part_size;
+        ir->max_offset = offset;
+        left -= nb_partitions * part_size;
+        part_size *= 2;
+        part_size = FFMIN(part_size, max_part_size);
+    }
+
+    return 0;
+}
+
 #define DEPTH 32
 #include "afir_template.c"
 
@@ -320,6 +360,184 @@ static void uninit_segment(AVFilterContext *ctx, AudioFIRSegment *seg)
     seg->input_size = 0;
 }
 
+#define DEFAULT_PART_SIZE 8192
+#define MAX_PART_SIZE 65536
+#define TUNE_MIN_SAMPLES 16384
+
+/**
+ * Time the convolution of one channel with a zero IR of nb_taps
+ * taps split with the given partition sizes, giving up early once the
+ * cost per sample is known to be above max_cost.
+ *
+ * @param cost set to the cost of one sample in microseconds
+ */
+static int time_layout(AVFilterContext *ctx, int minp, int maxp, int nb_taps,
+                       double max_cost, double *cost)
+{
+    AudioFIRContext *s = ctx->priv;
+    const int nb_samples = FFMAX(2 * maxp, TUNE_MIN_SAMPLES);
+    AVFrame *in = NULL, *out = NULL;
+    AudioIR ir = { 0 };
+    int64_t elapsed = 0;
+    int ret = 0, n;
+
+    s->minp = s->min_part_size = minp;
+    s->maxp = s->max_part_size = maxp;
+
+    ret = init_segments(ctx, &ir, 0, nb_taps);
+    if (ret < 0)
+        goto fail;
+
+    for (int i = 0; i < ir.nb_segments; i++) {
+        AudioFIRSegment *seg = &ir.seg[i];
+
+        seg->coeff = ff_get_audio_buffer(ctx->inputs[0], seg->nb_partitions * seg->coeff_size * 2);
+        if (!seg->coeff) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+        av_samples_set_silence(seg->coeff->extended_data, 0, seg->coeff->nb_samples,
+                               s->nb_channels, s->format);
+    }
+
+    in  = ff_get_audio_buffer(ctx->inputs[0], minp);
+    out = ff_get_audio_buffer(ctx->inputs[0], minp);
+    if (!in || !out) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    av_samples_set_silence(in->extended_data, 0, minp, s->nb_channels, s->format);
+    av_samples_set_silence(out->extended_data, 0, minp, s->nb_channels, s->format);
+
+    switch (s->format) {
+    case AV_SAMPLE_FMT_FLTP:
+        n = time_quantums_float(ctx, s, &ir, in, out, nb_samples,
+                                max_cost * nb_samples, &elapsed);
+        break;
+    case AV_SAMPLE_FMT_DBLP:
+        n = time_quantums_double(ctx, s, &ir, in, out, nb_samples,
+                                 max_cost * nb_samples, &elapsed);
+        break;
+    default:
+        av_assert1(0);
+    }
+
+    *cost = elapsed / (double)n;
+
+fail:
+    for (int i = 0; i < ir.nb_segments; i++)
+        uninit_segment(ctx, &ir.seg[i]);
+    av_freep(&ir.seg);
+    av_frame_free(&in);
+    av_frame_free(&out);
+
+    return ret;
+}
+
+static int tune_partitions(AVFilterContext *ctx, int nb_taps)
+{
+    AudioFIRContext *s = ctx->priv;
+    const int auto_minp = !s->minp;
+    const int auto_maxp = !s->maxp;
+    const int sample_rate = ctx->inputs[0]->sample_rate;
+    int first_minp = s->minp, last_minp = s->minp;
+    int best_minp = 0, best_maxp = 0;
+    double best_cost = 0.;
+    int ret;
+
+    if (auto_minp) {
+        int max_minp = DEFAULT_PART_SIZE;
+
+        if (s->latency > 0)
+            max_minp = av_clip64(av_rescale(s->latency, sample_rate, AV_TIME_BASE), 1, MAX_PART_SIZE);
+        if (!auto_maxp)
+            max_minp = FFMIN(max_minp, s->maxp);
+
+        /* try the larger, usually cheaper, sizes first to bail out early on the others */
+        first_minp = 1 << av_log2(max_minp);
+        last_minp = FFMIN(first_minp, 16);
+    }
+
+    for (int minp = first_minp; minp >= last_minp; minp /= 2) {
+        int maxp = auto_maxp ? minp : FFMAX(s->maxp, minp);
+
+        while (maxp < 8)
+            maxp *= 2;
+
+        for (; maxp <= MAX_PART_SIZE; maxp *= 2) {
+            double cost;
+
+            ret = time_layout(ctx, minp, maxp, nb_taps, best_cost, &cost);
+            if (ret < 0)
+                return ret;
+
+            av_log(ctx, AV_LOG_DEBUG, "minp: %d maxp: %d: %.3f ns/sample\n",
+                   minp, maxp, cost * 1000.);
+
+            if (!best_minp || cost < best_cost) {
+                best_cost = cost;
+                best_minp = minp;
+                best_maxp = maxp;
+            }
+
+            /* larger partitions than the IR change nothing */
+            if (!auto_maxp || maxp >= nb_taps)
+                break;
+        }
+    }
+
+    s->minp = s->min_part_size = best_minp;
+    s->maxp = s->max_part_size = best_maxp;
+
+    av_log(ctx, AV_LOG_VERBOSE, "selected minp: %d maxp: %d (%.3f ns/sample)\n",
+           best_minp, best_maxp, best_cost * 1000.);
+
+    return 0;
+}
+
+static int init_xfade(AVFilterContext *ctx)
+{
+    AudioFIRContext *s = ctx->priv;
+    AVFilterLink *outlink = ctx->outputs[0];
+
+    s->fadein[0] = ff_get_audio_buffer(outlink, s->min_part_size);
+    s->fadein[1] = ff_get_audio_buffer(outlink, s->min_part_size);
+    if (!s->fadein[0] || !s->fadein[1])
+        return AVERROR(ENOMEM);
+
+    s->xfade[0] = ff_get_audio_buffer(outlink, s->min_part_size);
+    s->xfade[1] = ff_get_audio_buffer(outlink, s->min_part_size);
+    if (!s->xfade[0] || !s->xfade[1])
+        return AVERROR(ENOMEM);
+
+    switch (s->format) {
+    case AV_SAMPLE_FMT_FLTP:
+        for (int ch = 0; ch < s->nb_channels; ch++) {
+            float *dst0 = (float *)s->xfade[0]->extended_data[ch];
+            float *dst1 = (float *)s->xfade[1]->extended_data[ch];
+
+            for (int n = 0; n < s->min_part_size; n++) {
+                dst0[n] = (n + 1.f) / s->min_part_size;
+                dst1[n] = 1.f - dst0[n];
+            }
+        }
+        break;
+    case AV_SAMPLE_FMT_DBLP:
+        for (int ch = 0; ch < s->nb_channels; ch++) {
+            double *dst0 = (double *)s->xfade[0]->extended_data[ch];
+            double *dst1 = (double *)s->xfade[1]->extended_data[ch];
+
+            for (int n = 0; n < s->min_part_size; n++) {
+                dst0[n] = (n + 1.0) / s->min_part_size;
+                dst1[n] = 1.0 - dst0[n];
+            }
+        }
+        break;
+    }
+
+    return 0;
+}
+
 static int convert_coeffs(AVFilterContext *ctx, const int selir)
 {
     AudioFIRContext *s = ctx->priv;
@@ -331,10 +549,22 @@ static int convert_coeffs(AVFilterContext *ctx, const int selir)
         if (ir->nb_taps <= 0)
             return AVERROR(EINVAL);
 
+        if (!s->min_part_size || !s->max_part_size) {
+            ret = tune_partitions(ctx, ir->nb_taps);
+            if (ret < 0)
+                return ret;
+        }
+
         if (s->minp > s->maxp)
             s->maxp = s->minp;
     }
 
+    if (!s->xfade[0]) {
+        ret = init_xfade(ctx);
+        if (ret < 0)
+            return ret;
+    }
+
     if (!ir->ir) {
         ret = ff_inlink_consume_samples(ctx->inputs[1 + selir], ir->nb_taps, ir->nb_taps, &ir->ir);
         if (ret < 0)
@@ -355,6 +585,110 @@ static int convert_coeffs(AVFilterContext *ctx, const int selir)
     return ret;
 }
 
+static int prepare_partitions(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    AudioFIRContext *s = ctx->priv;
+    const int start = (s->nb_channels * jobnr) / nb_jobs;
+    const int end = (s->nb_channels * (jobnr+1)) / nb_jobs;
+    const int *range = arg;
+
+    for (int ch = start; ch < end; ch++) {
+        switch (s->format) {
+        case AV_SAMPLE_FMT_FLTP:
+            ir_convert_partitions_float(ctx, s, s->next_selir, ch, range[0], range[1]);
+            break;
+        case AV_SAMPLE_FMT_DBLP:
+            ir_convert_partitions_double(ctx, s, s->next_selir, ch, range[0], range[1]);
+            break;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Advance the preparation of the IR selected with irload=async by one
+ * step, and switch to it once it is complete. The setup is split in
+ * stages and the transforms are done at most ir_step partitions at a
+ * time, so that no single call stalls the filter for long.
+ */
+static int prepare_next_ir(AVFilterContext *ctx)
+{
+    AudioFIRContext *s = ctx->priv;
+    const int selir = s->next_selir;
+    AudioIR *ir = &s->irs[selir];
+    int range[2], ret;
+
+    if (!ir->eof_coeffs)
+        return 0;
+
+    if (!ir->ir) {
+        ir->nb_taps = ff_inlink_queued_samples(ctx->inputs[1 + selir]);
+        if (ir->nb_taps <= 0)
+            return AVERROR(EINVAL);
+
+        ret = ff_inlink_consume_samples(ctx->inputs[1 + selir], ir->nb_taps, ir->nb_taps, &ir->ir);
+        if (ret < 0)
+            return ret;
+        if (ret == 0)
+            return AVERROR_BUG;
+
+        return 0;
+    }
+
+    if (!ir->ch_gain) {
+        switch (s->format) {
+        case AV_SAMPLE_FMT_FLTP:
+            ret = ir_analyze_float(ctx, s, selir);
+            break;
+        case AV_SAMPLE_FMT_DBLP:
+            ret = ir_analyze_double(ctx, s, selir);
+            break;
+        }
+
+        return ret;
+    }
+
+    if (!ir->nb_segments)
+        return init_segments(ctx, ir, selir, ir->norm_taps);
+
+    if (!ir->norm_ir) {
+        switch (s->format) {
+        case AV_SAMPLE_FMT_FLTP:
+            ret = ir_setup_float(ctx, s, selir);
+            break;
+        case AV_SAMPLE_FMT_DBLP:
+            ret = ir_setup_double(ctx, s, selir);
+            break;
+        }
+
+        return ret;
+    }
+
+    range[0] = ir->nb_prepared;
+    range[1] = FFMIN(ir->nb_partitions, ir->nb_prepared + s->ir_step);
+    ff_filter_execute(ctx, prepare_partitions, range, NULL,
+                      FFMIN(s->nb_channels, ff_filter_get_nb_threads(ctx)));
+    ir->nb_prepared = range[1];
+
+    if (ir->nb_prepared < ir->nb_partitions)
+        return 0;
+
+    av_frame_free(&ir->ir);
+    av_frame_free(&ir->norm_ir);
+    ir->have_coeffs = 1;
+
+    av_log(ctx, AV_LOG_VERBOSE, "IR %d prepared, switching to it.\n", selir);
+
+    s->prev_selir = s->selir;
+    s->selir = selir;
+    s->next_selir = -1;
+    for (int ch = 0; ch < s->nb_channels; ch++)
+        s->loading[ch] = 1;
+
+    return 0;
+}
+
 static int check_ir(AVFilterLink *link, const int selir)
 {
     AVFilterContext *ctx = link->dst;
@@ -379,7 +713,7 @@ static int activate(AVFilterContext *ctx)
 {
     AudioFIRContext *s = ctx->priv;
     AVFilterLink *outlink = ctx->outputs[0];
-    int ret, status, available, wanted;
+    int ret, status, available, wanted, got_frame;
     AVFrame *in = NULL;
     int64_t pts;
 
@@ -389,7 +723,7 @@ static int activate(AVFilterContext *ctx)
         AudioIR *ir = &s->irs[i];
         const int selir = i;
 
-        if (s->ir_load && selir != s->selir)
+        if (s->ir_load && selir != s->selir && selir != s->next_selir)
             continue;
 
         if (!ir->eof_coeffs) {
@@ -400,10 +734,16 @@ static int activate(AVFilterContext *ctx)
             if (!ir->eof_coeffs) {
                 if (ff_outlink_frame_wanted(outlink))
                     ff_inlink_request_frame(ctx->inputs[1 + selir]);
+                /* keep filtering with the current IR meanwhile */
+                if (selir == s->next_selir)
+                    continue;
                 return 0;
             }
         }
 
+        if (selir == s->next_selir)
+            continue;
+
         if (!ir->have_coeffs && ir->eof_coeffs) {
             ret = convert_coeffs(ctx, selir);
             if (ret < 0)
@@ -414,6 +754,7 @@ static int activate(AVFilterContext *ctx)
     available = ff_inlink_queued_samples(ctx->inputs[0]);
     wanted = FFMAX(s->min_part_size, (available / s->min_part_size) * s->min_part_size);
     ret = ff_inlink_consume_samples(ctx->inputs[0], wanted, wanted, &in);
+    got_frame = ret > 0;
     if (ret > 0)
         ret = fir_frame(s, in, outlink);
 
@@ -423,6 +764,12 @@ static int activate(AVFilterContext *ctx)
     if (ret < 0)
         return ret;
 
+    if (got_frame && s->next_selir >= 0) {
+        ret = prepare_next_ir(ctx);
+        if (ret < 0)
+            return ret;
+    }
+
     if (ff_inlink_queued_samples(ctx->inputs[0]) >= s->min_part_size) {
         ff_filter_set_ready(ctx, 10);
         return 0;
@@ -499,41 +846,6 @@ static int config_output(AVFilterLink *outlink)
     if (!s->loading)
         return AVERROR(ENOMEM);
 
-    s->fadein[0] = ff_get_audio_buffer(outlink, s->min_part_size);
-    s->fadein[1] = ff_get_audio_buffer(outlink, s->min_part_size);
-    if (!s->fadein[0] || !s->fadein[1])
-        return AVERROR(ENOMEM);
-
-    s->xfade[0] = ff_get_audio_buffer(outlink, s->min_part_size);
-    s->xfade[1] = ff_get_audio_buffer(outlink, s->min_part_size);
-    if (!s->xfade[0] || !s->xfade[1])
-        return AVERROR(ENOMEM);
-
-    switch (s->format) {
-    case AV_SAMPLE_FMT_FLTP:
-        for (int ch = 0; ch < s->nb_channels; ch++) {
-            float *dst0 = (float *)s->xfade[0]->extended_data[ch];
-            float *dst1 = (float *)s->xfade[1]->extended_data[ch];
-
-            for (int n = 0; n < s->min_part_size; n++) {
-                dst0[n] = (n + 1.f) / s->min_part_size;
-                dst1[n] = 1.f - dst0[n];
-            }
-        }
-        break;
-    case AV_SAMPLE_FMT_DBLP:
-        for (int ch = 0; ch < s->nb_channels; ch++) {
-            double *dst0 = (double *)s->xfade[0]->extended_data[ch];
-            double *dst1 = (double *)s->xfade[1]->extended_data[ch];
-
-            for (int n = 0; n < s->min_part_size; n++) {
-                dst0[n] = (n + 1.0) / s->min_part_size;
-                dst1[n] = 1.0 - dst0[n];
-            }
-        }
-        break;
-    }
-
     return 0;
 }
 
@@ -572,6 +884,7 @@ static av_cold int init(AVFilterContext *ctx)
     AudioFIRContext *s = ctx->priv;
 
     s->prev_selir = FFMIN(s->nb_irs - 1, s->selir);
+    s->next_selir = -1;
     s->irs = av_calloc(s->nb_irs, sizeof(*s->irs));
     if (!s->irs)
         return AVERROR(ENOMEM);
@@ -621,6 +934,18 @@ static int process_command(AVFilterContext *ctx,
         return ret;
 
     s->selir = FFMIN(s->nb_irs - 1, s->selir);
+    if (s->ir_load == 2 && s->selir != prev_selir) {
+        if (s->selir == s->next_selir || !s->irs[s->selir].have_coeffs) {
+            /* keep the current IR until the new one is prepared */
+            s->next_selir = s->selir;
+            s->selir = prev_selir;
+            return 0;
+        }
+        s->next_selir = -1;
+    } else if (s->ir_load == 2) {
+        s->next_selir = -1;
+    }
+
     if (s->selir != prev_selir) {
         s->prev_selir = prev_selir;
 
@@ -646,17 +971,22 @@ static const AVOption afir_options[] = {
     {  "mono",  "single channel",    0,                  AV_OPT_TYPE_CONST, {.i64=0},    0,  0, AF, .unit = "irfmt" },
     {  "input", "same as input",     0,                  AV_OPT_TYPE_CONST, {.i64=1},    0,  0, AF, .unit = "irfmt" },
     { "maxir",  "set max IR length", OFFSET(max_ir_len), AV_OPT_TYPE_FLOAT, {.dbl=30}, 0.1, 60, AF },
-    { "minp",   "set min partition size", OFFSET(minp),  AV_OPT_TYPE_INT,   {.i64=8192}, 1, 65536, AF },
-    { "maxp",   "set max partition size", OFFSET(maxp),  AV_OPT_TYPE_INT,   {.i64=8192}, 8, 65536, AF },
+    { "minp",   "set min partition size", OFFSET(minp),  AV_OPT_TYPE_INT,   {.i64=8192}, 0, 65536, AF, .unit = "minp" },
+    {  "auto",  "time partition sizes",   0,             AV_OPT_TYPE_CONST, {.i64=0},    0,     0, AF, .unit = "minp" },
+    { "maxp",   "set max partition size", OFFSET(maxp),  AV_OPT_TYPE_INT,   {.i64=8192}, 0, 65536, AF, .unit = "maxp" },
+    {  "auto",  "time partition sizes",   0,             AV_OPT_TYPE_CONST, {.i64=0},    0,     0, AF, .unit = "maxp" },
+    { "latency", "set max latency for auto min partition size", OFFSET(latency), AV_OPT_TYPE_DURATION, {.i64=0}, 0, 10000000, AF },
     { "nbirs",  "set number of input IRs",OFFSET(nb_irs),AV_OPT_TYPE_INT,   {.i64=1},    1, INT_MAX, AF },
     { "ir",     "select IR",              OFFSET(selir), AV_OPT_TYPE_INT,   {.i64=0},    0, INT_MAX-1, AFR },
     { "precision", "set processing precision",    OFFSET(precision), AV_OPT_TYPE_INT,   {.i64=0}, 0, 2, AF, .unit = "precision" },
     {  "auto", "set auto processing precision",                   0, AV_OPT_TYPE_CONST, {.i64=0}, 0, 0, AF, .unit = "precision" },
     {  "float", "set single-floating point processing precision", 0, AV_OPT_TYPE_CONST, {.i64=1}, 0, 0, AF, .unit = "precision" },
     {  "double","set double-floating point processing precision", 0, AV_OPT_TYPE_CONST, {.i64=2}, 0, 0, AF, .unit = "precision" },
-    { "irload", "set IR loading type", OFFSET(ir_load), AV_OPT_TYPE_INT, {.i64=0}, 0, 1, AF, .unit = "irload" },
+    { "irload", "set IR loading type", OFFSET(ir_load), AV_OPT_TYPE_INT, {.i64=0}, 0, 2, AF, .unit = "irload" },
     {  "init",   "load all IRs on init", 0, AV_OPT_TYPE_CONST, {.i64=0}, 0, 0, AF, .unit = "irload" },
     {  "access", "load IR on access",    0, AV_OPT_TYPE_CONST, {.i64=1}, 0, 0, AF, .unit = "irload" },
+    {  "async",  "load IR on access without stalling", 0, AV_OPT_TYPE_CONST, {.i64=2}, 0, 0, AF, .unit = "irload" },
+    { "irstep", "set IR partitions prepared per frame", OFFSET(ir_step), AV_OPT_TYPE_INT, {.i64=8}, 1, INT_MAX, AF },
     { NULL }
 };
 
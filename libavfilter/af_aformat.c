@@ -145,6 +145,7 @@ const AVFilter ff_af_aformat = {
     .priv_class    = &aformat_class,
     .init          = init,
     .flags         = AVFILTER_FLAG_METADATA_ONLY,
+    .flags_internal = FF_FILTER_FLAG_FRAME_SIZE_PASSTHROUGH,
     FILTER_INPUTS(inputs),
     FILTER_OUTPUTS(ff_audio_default_filterpad),
     FILTER_QUERY_FUNC2(query_formats),
@@ -167,6 +168,7 @@ const AVFilter ff_af_anoformat = {
     .priv_class    = &anoformat_class,
     .init          = init,
     .flags         = AVFILTER_FLAG_METADATA_ONLY,
+    .flags_internal = FF_FILTER_FLAG_FRAME_SIZE_PASSTHROUGH,
     FILTER_INPUTS(inputs),
     FILTER_OUTPUTS(ff_audio_default_filterpad),
     FILTER_QUERY_FUNC2(query_formats),
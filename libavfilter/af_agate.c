@@ -28,6 +28,7 @@
 #include "libavutil/opt.h"
 #include "avfilter.h"
 #include "audio.h"
+#include "dynamicsdsp.h"
 #include "filters.h"
 #include "formats.h"
 
@@ -67,8 +68,9 @@ typedef struct AudioGateContext {
 
     AVFrame *in, *sc;
 
-    void (*gate)(AVFilterContext *ctx, AVFrame *out, const int nb_samples,
-                 AVFilterLink *inlink, AVFilterLink *sclink);
+    AudioDynamicsDSPContext dsp;
+
+    int (*gate)(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs);
 } AudioGateContext;
 
 #define OFFSET(x) offsetof(AudioGateContext, x)
@@ -101,6 +103,12 @@ static const AVOption agate_options[] = {
 
 AVFILTER_DEFINE_CLASS(agate);
 
+#define BLOCK_SIZE 256
+
+typedef struct ThreadData {
+    AVFrame *in, *sc, *out;
+} ThreadData;
+
 #define DEPTH 32
 #include "agate_template.c"
 
@@ -114,6 +122,8 @@ static int filter_frame(AVFilterLink *outlink)
     AudioGateContext *s = ctx->priv;
     AVFilterLink *inlink = ctx->inputs[0];
     AVFilterLink *sclink = s->sidechain ? ctx->inputs[1] : inlink;
+    int nb_jobs = 1;
+    ThreadData td;
     AVFrame *out;
 
     if (av_frame_is_writable(s->in)) {
@@ -128,7 +138,20 @@ static int filter_frame(AVFilterLink *outlink)
         av_frame_copy_props(out, s->in);
     }
 
-    s->gate(ctx, out, s->in->nb_samples, inlink, sclink);
+    td.in = s->in;
+    td.sc = s->sc ? s->sc : s->in;
+    td.out = out;
+    if (s->link == LINK_NONE) {
+        /* channels without a sidechain channel pass through unchanged */
+        if (out != s->in) {
+            for (int ch = sclink->ch_layout.nb_channels; ch < inlink->ch_layout.nb_channels; ch++)
+                memcpy(out->extended_data[ch], s->in->extended_data[ch],
+                       s->in->nb_samples * av_get_bytes_per_sample(out->format));
+        }
+        nb_jobs = FFMIN(FFMIN(inlink->ch_layout.nb_channels, sclink->ch_layout.nb_channels),
+                        ff_filter_get_nb_threads(ctx));
+    }
+    ff_filter_execute(ctx, s->gate, &td, NULL, nb_jobs);
 
     if (out != s->in)
         av_frame_free(&s->in);
@@ -179,24 +202,26 @@ static int config_output(AVFilterLink *outlink)
 {
     AVFilterContext *ctx = outlink->src;
     AVFilterLink *inlink = ctx->inputs[0];
+    AVFilterLink *sclink = ctx->nb_inputs > 1 ? ctx->inputs[1] : inlink;
     AudioGateContext *s = ctx->priv;
     double lin_threshold = s->threshold;
     double lin_knee_sqrt = sqrt(s->knee);
     size_t sample_size;
 
     switch (outlink->format) {
-    case AV_SAMPLE_FMT_FLT:
-        s->gate = gate_flt;
+    case AV_SAMPLE_FMT_FLTP:
+        s->gate = gate_fltp;
         sample_size = sizeof(float);
         break;
-    case AV_SAMPLE_FMT_DBL:
-        s->gate = gate_dbl;
+    case AV_SAMPLE_FMT_DBLP:
+        s->gate = gate_dblp;
         sample_size = sizeof(double);
         break;
     }
 
     if (!s->lin_slope)
-        s->lin_slope = av_calloc(inlink->ch_layout.nb_channels, sample_size);
+        s->lin_slope = av_calloc(FFMAX(inlink->ch_layout.nb_channels,
+                                       sclink->ch_layout.nb_channels), sample_size);
     if (!s->lin_slope)
         return AVERROR(ENOMEM);
 
@@ -220,6 +245,8 @@ static av_cold int init(AVFilterContext *ctx)
 {
     AudioGateContext *s = ctx->priv;
 
+    ff_dynamics_init(&s->dsp);
+
     if (s->sidechain) {
         AVFilterPad pad = { NULL };
 
@@ -272,8 +299,9 @@ const AVFilter ff_af_agate = {
     .uninit         = uninit,
     FILTER_INPUTS(ff_audio_default_filterpad),
     FILTER_OUTPUTS(outputs),
-    FILTER_SAMPLEFMTS(AV_SAMPLE_FMT_FLT, AV_SAMPLE_FMT_DBL),
+    FILTER_SAMPLEFMTS(AV_SAMPLE_FMT_FLTP, AV_SAMPLE_FMT_DBLP),
     .process_command = process_command,
     .flags          = AVFILTER_FLAG_SUPPORT_TIMELINE_INTERNAL |
+                      AVFILTER_FLAG_SLICE_THREADS |
                       AVFILTER_FLAG_DYNAMIC_INPUTS,
 };
@@ -19,10 +19,10 @@
  */
 
 #include "libavutil/common.h"
-#include "libavutil/float_dsp.h"
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
 
+#include "adaptivedsp.h"
 #include "audio.h"
 #include "avfilter.h"
 #include "formats.h"
@@ -49,14 +49,13 @@ typedef struct AudioKalmanContext {
     AVFrame *offset;
     AVFrame *delay;
     AVFrame *coeffs;
-    AVFrame *tmp;
-    AVFrame *P, *Pn, *r, *Ku, *IKu;
+    AVFrame *P, *r;
 
     AVFrame *frame[2];
 
     int (*filter_channels)(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs);
 
-    AVFloatDSPContext *fdsp;
+    AudioAdaptiveDSPContext dsp;
 } AudioKalmanContext;
 
 #define OFFSET(x) offsetof(AudioKalmanContext, x)
@@ -187,20 +186,12 @@ static int config_output(AVFilterLink *outlink)
         s->delay = ff_get_audio_buffer(outlink, 2 * s->kernel_size);
     if (!s->coeffs)
         s->coeffs = ff_get_audio_buffer(outlink, 2 * s->kernel_size);
-    if (!s->tmp)
-        s->tmp = ff_get_audio_buffer(outlink, s->kernel_size);
     if (!s->r)
         s->r = ff_get_audio_buffer(outlink, s->kernel_size);
     if (!s->P)
         s->P = ff_get_audio_buffer(outlink, s->kernel_size * s->kernel_size);
-    if (!s->Ku)
-        s->Ku = ff_get_audio_buffer(outlink, s->kernel_size * s->kernel_size);
-    if (!s->IKu)
-        s->IKu = ff_get_audio_buffer(outlink, s->kernel_size * s->kernel_size);
-    if (!s->Pn)
-        s->Pn = ff_get_audio_buffer(outlink, s->kernel_size * s->kernel_size);
-
-    if (!s->delay || !s->coeffs || !s->offset || !s->tmp || !s->P || !s->Pn || !s->r || !s->Ku || !s->IKu)
+
+    if (!s->delay || !s->coeffs || !s->offset || !s->P || !s->r)
         return AVERROR(ENOMEM);
 
     switch (outlink->format) {
@@ -235,9 +226,7 @@ static av_cold int init(AVFilterContext *ctx)
 {
     AudioKalmanContext *s = ctx->priv;
 
-    s->fdsp = avpriv_float_dsp_alloc(0);
-    if (!s->fdsp)
-        return AVERROR(ENOMEM);
+    ff_adaptive_init(&s->dsp);
 
     return 0;
 }
@@ -246,16 +235,11 @@ static av_cold void uninit(AVFilterContext *ctx)
 {
     AudioKalmanContext *s = ctx->priv;
 
-    av_freep(&s->fdsp);
     av_frame_free(&s->delay);
     av_frame_free(&s->coeffs);
     av_frame_free(&s->offset);
-    av_frame_free(&s->tmp);
     av_frame_free(&s->r);
     av_frame_free(&s->P);
-    av_frame_free(&s->Pn);
-    av_frame_free(&s->Ku);
-    av_frame_free(&s->IKu);
 }
 
 static const AVFilterPad inputs[] = {
@@ -37,6 +37,7 @@
 #define MAX_ORDER 3
 #define SQR(x) ((x) * (x))
 #define MAX_CHANNELS SQR(MAX_ORDER + 1)
+#define DECODE_BLOCK_SIZE 256
 
 enum A_NAME {
     A_W, A_Y, A_Z, A_X, A_V, A_T, A_R, A_S, A_U, A_Q, A_O, A_M, A_K, A_L, A_N, A_P,
@@ -1572,10 +1573,27 @@ static void calc_transform_mat(AVFilterContext *ctx, AmbisonicContext *s)
     LOG_MATRIX("transform", s->transform_mat, inputs, inputs)
 }
 
-static void near_field(AmbisonicContext *s, AVFrame *frame,
-                       const int out, const int add)
+typedef struct ThreadData {
+    const double *lf_gains;
+    const double *hf_gains;
+    int nb_channels;
+    int out_nf, add;
+    AVFrame *in, *out, *lf;
+} ThreadData;
+
+static int near_field(AVFilterContext *ctx, void *arg,
+                      const int jobnr, const int nb_jobs)
 {
-    for (int ch = 1 - out; ch < frame->ch_layout.nb_channels; ch++) {
+    AmbisonicContext *s = ctx->priv;
+    ThreadData *td = arg;
+    AVFrame *frame = td->in;
+    const int out = td->out_nf;
+    const int first = 1 - out;
+    const int nb_channels = frame->ch_layout.nb_channels - first;
+    const int start = first + (nb_channels * jobnr) / nb_jobs;
+    const int end = first + (nb_channels * (jobnr+1)) / nb_jobs;
+
+    for (int ch = start; ch < end; ch++) {
         int n, m;
 
         acn_to_level_order(ch, &n, &m);
@@ -1583,15 +1601,11 @@ static void near_field(AmbisonicContext *s, AVFrame *frame,
         if (!s->nf_process[n - 1])
             break;
 
-        s->nf_process[n - 1](&s->nf[out][ch], frame, ch, add, 1.);
+        s->nf_process[n - 1](&s->nf[out][ch], frame, ch, td->add, 1.);
     }
-}
 
-typedef struct ThreadData {
-    const double *gains_tab;
-    int nb_channels;
-    AVFrame *in, *out;
-} ThreadData;
+    return 0;
+}
 
 #define DEPTH 32
 #include "ambisonic_template.c"
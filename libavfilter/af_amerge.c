@@ -36,10 +36,14 @@
 typedef struct AMergeContext {
     const AVClass *class;
     int nb_inputs;
+    int min_channels;
     int *route; /**< channels routing, see copy_samples */
+    int *route_in; /**< input index of each routed channel */
+    int *route_ch; /**< channel index within its input of each routed channel */
     int bps;
+    int nb_ch;
     int *in;
-    uint8_t **ins;
+    uint8_t **ins; /**< per-job copy of the input pointers */
     AVFrame **inbuf;
 } AMergeContext;
 
@@ -49,6 +53,8 @@ typedef struct AMergeContext {
 static const AVOption amerge_options[] = {
     { "inputs", "specify the number of inputs", OFFSET(nb_inputs),
       AV_OPT_TYPE_INT, { .i64 = 2 }, 1, INT16_MAX, FLAGS },
+    { "min_channels", "set the minimum number of channels per thread job", OFFSET(min_channels),
+      AV_OPT_TYPE_INT, { .i64 = 16 }, 1, INT_MAX, FLAGS },
     { NULL }
 };
 
@@ -62,6 +68,8 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_freep(&s->ins);
     av_freep(&s->inbuf);
     av_freep(&s->route);
+    av_freep(&s->route_in);
+    av_freep(&s->route_ch);
 }
 
 static int query_formats(const AVFilterContext *ctx,
@@ -119,8 +127,13 @@ static int config_output(AVFilterLink *outlink)
         nb_ch += s->in[i];
     }
 
-    s->route = av_calloc(nb_ch, sizeof(*s->route));
-    if (!s->route)
+    s->nb_ch = nb_ch;
+    s->route    = av_calloc(nb_ch, sizeof(*s->route));
+    s->route_in = av_calloc(nb_ch, sizeof(*s->route_in));
+    s->route_ch = av_calloc(nb_ch, sizeof(*s->route_ch));
+    av_freep(&s->ins);
+    s->ins = av_calloc(s->nb_inputs * ff_filter_get_nb_threads(ctx), sizeof(*s->ins));
+    if (!s->route || !s->route_in || !s->route_ch || !s->ins)
         return AVERROR(ENOMEM);
 
     for (int i = 0, j = 0; i < s->nb_inputs; i++) {
@@ -142,6 +155,9 @@ static int config_output(AVFilterLink *outlink)
                 if (s->route[n] == s->route[j])
                     s->route[n] = (s->route[n] + 1) % nb_ch;
             }
+
+            s->route_in[j] = i;
+            s->route_ch[j] = c;
         }
     }
 
@@ -179,6 +195,59 @@ static inline void copy_samples(int nb_inputs, int in[],
     }
 }
 
+/**
+ * Merge the channels of one job: a range of output planes for planar
+ * formats, or a range of samples for packed formats.
+ */
+static int merge_channels(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    AMergeContext *s = ctx->priv;
+    AVFrame *outbuf = arg;
+    AVFrame **inbuf = s->inbuf;
+    const int nb_samples = outbuf->nb_samples;
+    uint8_t **ins = s->ins + jobnr * s->nb_inputs;
+    uint8_t *outs;
+    int start, end;
+
+    if (av_sample_fmt_is_planar(outbuf->format)) {
+        start = (s->nb_ch * jobnr) / nb_jobs;
+        end   = (s->nb_ch * (jobnr+1)) / nb_jobs;
+
+        for (int j = start; j < end; j++)
+            memcpy(outbuf->extended_data[s->route[j]],
+                   inbuf[s->route_in[j]]->extended_data[s->route_ch[j]],
+                   s->bps * nb_samples);
+
+        return 0;
+    }
+
+    start = (nb_samples * jobnr) / nb_jobs;
+    end   = (nb_samples * (jobnr+1)) / nb_jobs;
+
+    for (int i = 0; i < s->nb_inputs; i++)
+        ins[i] = inbuf[i]->data[0] + start * s->in[i] * s->bps;
+    outs = outbuf->data[0] + start * s->nb_ch * s->bps;
+
+    /* Unroll the most common sample formats: speed +~350% for the loop,
+       +~13% overall (including two common decoders) */
+    switch (s->bps) {
+    case 1:
+        copy_samples(s->nb_inputs, s->in, s->route, ins, &outs, end - start, 1, s->nb_ch);
+        break;
+    case 2:
+        copy_samples(s->nb_inputs, s->in, s->route, ins, &outs, end - start, 2, s->nb_ch);
+        break;
+    case 4:
+        copy_samples(s->nb_inputs, s->in, s->route, ins, &outs, end - start, 4, s->nb_ch);
+        break;
+    default:
+        copy_samples(s->nb_inputs, s->in, s->route, ins, &outs, end - start, s->bps, s->nb_ch);
+        break;
+    }
+
+    return 0;
+}
+
 static void free_frames(int nb_inputs, AVFrame **input_frames)
 {
     for (int i = 0; i < nb_inputs; i++)
@@ -191,7 +260,6 @@ static int try_push_frame(AVFilterContext *ctx, int nb_samples)
     AVFilterLink *outlink = ctx->outputs[0];
     const int nb_ch = outlink->ch_layout.nb_channels;
     AVFrame *outbuf, **inbuf = s->inbuf;
-    uint8_t *outs, **ins = s->ins;
     int ret;
 
     for (int i = 0; i < ctx->nb_inputs; i++) {
@@ -200,7 +268,6 @@ static int try_push_frame(AVFilterContext *ctx, int nb_samples)
             free_frames(i, inbuf);
             return ret;
         }
-        ins[i] = inbuf[i]->data[0];
     }
 
     outbuf = ff_get_audio_buffer(outlink, nb_samples);
@@ -209,7 +276,6 @@ static int try_push_frame(AVFilterContext *ctx, int nb_samples)
         return AVERROR(ENOMEM);
     }
 
-    outs = outbuf->data[0];
     outbuf->pts = inbuf[0]->pts;
 
     outbuf->nb_samples     = nb_samples;
@@ -223,36 +289,9 @@ static int try_push_frame(AVFilterContext *ctx, int nb_samples)
         return ret;
     }
 
-    while (nb_samples) {
-        if (av_sample_fmt_is_planar(outlink->format)) {
-            for (int i = 0, j = 0; i < s->nb_inputs; i++) {
-                for (int c = 0; c < s->in[i]; c++, j++)
-                    memcpy(outbuf->extended_data[s->route[j]],
-                           inbuf[i]->extended_data[c], s->bps * nb_samples);
-            }
-
-            break;
-        }
-
-        /* Unroll the most common sample formats: speed +~350% for the loop,
-           +~13% overall (including two common decoders) */
-        switch (s->bps) {
-        case 1:
-            copy_samples(s->nb_inputs, s->in, s->route, ins, &outs, nb_samples, 1, nb_ch);
-            break;
-        case 2:
-            copy_samples(s->nb_inputs, s->in, s->route, ins, &outs, nb_samples, 2, nb_ch);
-            break;
-        case 4:
-            copy_samples(s->nb_inputs, s->in, s->route, ins, &outs, nb_samples, 4, nb_ch);
-            break;
-        default:
-            copy_samples(s->nb_inputs, s->in, s->route, ins, &outs, nb_samples, s->bps, nb_ch);
-            break;
-        }
-
-        nb_samples = 0;
-    }
+    ff_filter_execute(ctx, merge_channels, outbuf, NULL,
+                      FFMIN(FFMAX(nb_ch / s->min_channels, 1),
+                            ff_filter_get_nb_threads(ctx)));
 
     free_frames(s->nb_inputs, inbuf);
     return ff_filter_frame(outlink, outbuf);
@@ -296,9 +335,8 @@ static av_cold int init(AVFilterContext *ctx)
     AMergeContext *s = ctx->priv;
 
     s->in = av_calloc(s->nb_inputs, sizeof(*s->in));
-    s->ins = av_calloc(s->nb_inputs, sizeof(*s->ins));
     s->inbuf = av_calloc(s->nb_inputs, sizeof(*s->inbuf));
-    if (!s->in || !s->ins || !s->inbuf)
+    if (!s->in || !s->inbuf)
         return AVERROR(ENOMEM);
 
     for (int i = 0; i < s->nb_inputs; i++) {
@@ -337,5 +375,6 @@ const AVFilter ff_af_amerge = {
     .inputs        = NULL,
     FILTER_OUTPUTS(amerge_outputs),
     FILTER_QUERY_FUNC2(query_formats),
-    .flags         = AVFILTER_FLAG_DYNAMIC_INPUTS,
+    .flags         = AVFILTER_FLAG_DYNAMIC_INPUTS |
+                     AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -52,6 +52,7 @@
 typedef struct InputContext {
     AVFrame *frame;
     uint8_t input_state;       /**< current state of each input */
+    uint8_t silent;            /**< current frame is digital silence */
     float input_scale;         /**< mixing scale factor for this input */
     float weight;              /**< custom weight for this input */
     float scale_norm;          /**< normalization factor for this input */
@@ -69,6 +70,7 @@ typedef struct MixContext {
     float *weights_opt;         /**< array of custom weights for every input */
     unsigned nb_weights;
     int normalize;              /**< if inputs are scaled */
+    int min_channels;           /**< minimum number of channels per job */
 
     int64_t eof_pts;
 
@@ -103,6 +105,8 @@ static const AVOption amix_options[] = {
             OFFSET(weights_opt), AV_OPT_TYPE_FLOAT|AR, {.arr=&def_weights}, INT_MIN, INT_MAX, A|F|T },
     { "normalize", "Scale inputs",
             OFFSET(normalize), AV_OPT_TYPE_BOOL, {.i64=1}, 0, 1, A|F|T },
+    { "min_channels", "Set the minimum number of channels per thread job.",
+            OFFSET(min_channels), AV_OPT_TYPE_INT, {.i64=16}, 1, INT_MAX, A|F },
     { NULL }
 };
 
@@ -224,6 +228,57 @@ static void free_frames(AVFilterContext *ctx)
         av_frame_free(&s->inputs[i].frame);
 }
 
+/**
+ * Mix the channels of one job: a range of planes for planar formats, or a
+ * range of interleaved samples, in blocks of 16 values, for packed formats.
+ */
+static int mix_channels(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    MixContext *s = ctx->priv;
+    AVFrame *out = arg;
+
+    for (int i = 0; i < s->nb_inputs; i++) {
+        InputContext *ic = &s->inputs[i];
+        int start, end, offset, len;
+
+        if (!ic->frame || ic->silent)
+            continue;
+
+        if (s->planar) {
+            start  = (s->nb_channels * jobnr) / nb_jobs;
+            end    = (s->nb_channels * (jobnr+1)) / nb_jobs;
+            offset = 0;
+            len    = FFALIGN(ic->frame->nb_samples, 16);
+        } else {
+            const int nb_blocks = FFALIGN(ic->frame->nb_samples * s->nb_channels, 16) / 16;
+
+            start  = 0;
+            end    = 1;
+            offset = ((nb_blocks * jobnr) / nb_jobs) * 16;
+            len    = ((nb_blocks * (jobnr+1)) / nb_jobs) * 16 - offset;
+            if (len <= 0)
+                continue;
+        }
+
+        if (out->format == AV_SAMPLE_FMT_FLT ||
+            out->format == AV_SAMPLE_FMT_FLTP) {
+            for (int p = start; p < end; p++) {
+                s->fdsp->vector_fmac_scalar((float *)out->extended_data[p] + offset,
+                                            (float *)ic->frame->extended_data[p] + offset,
+                                            ic->input_scale, len);
+            }
+        } else {
+            for (int p = start; p < end; p++) {
+                s->fdsp->vector_dmac_scalar((double *)out->extended_data[p] + offset,
+                                            (double *)ic->frame->extended_data[p] + offset,
+                                            ic->input_scale, len);
+            }
+        }
+    }
+
+    return 0;
+}
+
 /**
  * Read samples from the input, mix, and write to the output link.
  */
@@ -232,7 +287,7 @@ static int output_frame(AVFilterLink *outlink)
     AVFilterContext *ctx = outlink->src;
     MixContext      *s = ctx->priv;
     AVFrame *out;
-    int nb_samples, got_pts = 0;
+    int nb_samples;
 
     switch (s->duration_mode) {
     case DURATION_FIRST:
@@ -260,42 +315,29 @@ static int output_frame(AVFilterLink *outlink)
 
     calculate_scales(s);
 
+    /* silent inputs add nothing, so mixing scales with active inputs only */
+    for (int i = 0; i < s->nb_inputs; i++) {
+        InputContext *ic = &s->inputs[i];
+
+        ic->silent = ic->frame && ff_audio_frame_is_silent(ic->frame);
+    }
+
     out = ff_get_audio_buffer(outlink, nb_samples);
     if (!out) {
         free_frames(ctx);
         return AVERROR(ENOMEM);
     }
 
+    ff_filter_execute(ctx, mix_channels, out, NULL,
+                      FFMIN(FFMAX(s->nb_channels / s->min_channels, 1),
+                            ff_filter_get_nb_threads(ctx)));
+
     for (int i = 0; i < s->nb_inputs; i++) {
         InputContext *ic = &s->inputs[i];
 
         if (ic->frame) {
-            int planes, plane_size;
-
-            nb_samples = s->inputs[i].frame->nb_samples;
-            planes     = s->planar ? s->nb_channels : 1;
-            plane_size = nb_samples * (s->planar ? 1 : s->nb_channels);
-            plane_size = FFALIGN(plane_size, 16);
-
-            if (out->format == AV_SAMPLE_FMT_FLT ||
-                out->format == AV_SAMPLE_FMT_FLTP) {
-                for (int p = 0; p < planes; p++) {
-                    s->fdsp->vector_fmac_scalar((float *)out->extended_data[p],
-                                                (float *) ic->frame->extended_data[p],
-                                                ic->input_scale, plane_size);
-                }
-            } else {
-                for (int p = 0; p < planes; p++) {
-                    s->fdsp->vector_dmac_scalar((double *)out->extended_data[p],
-                                                (double *) ic->frame->extended_data[p],
-                                                ic->input_scale, plane_size);
-                }
-            }
-
-            if (!got_pts) {
-                got_pts = 1;
-                av_frame_copy_props(out, ic->frame);
-            }
+            av_frame_copy_props(out, ic->frame);
+            break;
         }
     }
 
@@ -451,5 +493,6 @@ const AVFilter ff_af_amix = {
     FILTER_SAMPLEFMTS(AV_SAMPLE_FMT_FLT, AV_SAMPLE_FMT_FLTP,
                       AV_SAMPLE_FMT_DBL, AV_SAMPLE_FMT_DBLP),
     .process_command = process_command,
-    .flags          = AVFILTER_FLAG_DYNAMIC_INPUTS,
+    .flags          = AVFILTER_FLAG_DYNAMIC_INPUTS |
+                      AVFILTER_FLAG_SLICE_THREADS,
 };
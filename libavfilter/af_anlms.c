@@ -24,6 +24,7 @@
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
 
+#include "adaptivedsp.h"
 #include "audio.h"
 #include "avfilter.h"
 #include "filters.h"
@@ -52,7 +53,6 @@ typedef struct AudioNLMSContext {
     AVFrame *offset;
     AVFrame *delay;
     AVFrame *coeffs;
-    AVFrame *tmp;
 
     AVFrame *frame[2];
 
@@ -61,6 +61,7 @@ typedef struct AudioNLMSContext {
     int (*filter_channels)(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs);
 
     AVFloatDSPContext *fdsp;
+    AudioAdaptiveDSPContext dsp;
 } AudioNLMSContext;
 
 #define OFFSET(x) offsetof(AudioNLMSContext, x)
@@ -189,9 +190,7 @@ static int config_output(AVFilterLink *outlink)
         s->delay = ff_get_audio_buffer(outlink, 2 * s->kernel_size);
     if (!s->coeffs)
         s->coeffs = ff_get_audio_buffer(outlink, 2 * s->kernel_size);
-    if (!s->tmp)
-        s->tmp = ff_get_audio_buffer(outlink, s->kernel_size);
-    if (!s->delay || !s->coeffs || !s->offset || !s->tmp)
+    if (!s->delay || !s->coeffs || !s->offset)
         return AVERROR(ENOMEM);
 
     switch (outlink->format) {
@@ -214,6 +213,8 @@ static av_cold int init(AVFilterContext *ctx)
     if (!s->fdsp)
         return AVERROR(ENOMEM);
 
+    ff_adaptive_init(&s->dsp);
+
     return 0;
 }
 
@@ -225,7 +226,6 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_frame_free(&s->delay);
     av_frame_free(&s->coeffs);
     av_frame_free(&s->offset);
-    av_frame_free(&s->tmp);
     av_frame_free(&s->frame[0]);
     av_frame_free(&s->frame[1]);
 }
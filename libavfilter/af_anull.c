@@ -27,10 +27,19 @@
 #include "filters.h"
 #include "libavutil/internal.h"
 
+static const AVFilterPad inputs[] = {
+    {
+        .name             = "default",
+        .type             = AVMEDIA_TYPE_AUDIO,
+        .get_buffer.audio = ff_null_get_audio_buffer,
+    },
+};
+
 const AVFilter ff_af_anull = {
     .name          = "anull",
     .description   = NULL_IF_CONFIG_SMALL("Pass the source unchanged to the output."),
     .flags         = AVFILTER_FLAG_METADATA_ONLY,
-    FILTER_INPUTS(ff_audio_default_filterpad),
+    .flags_internal = FF_FILTER_FLAG_FRAME_SIZE_PASSTHROUGH,
+    FILTER_INPUTS(inputs),
     FILTER_OUTPUTS(ff_audio_default_filterpad),
 };
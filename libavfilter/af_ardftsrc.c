@@ -31,6 +31,7 @@ typedef struct AudioRDFTSRCContext {
 
     int quality;
     int sample_rate;
+    float padding;
     int in_rdft_size;
     int out_rdft_size;
     int in_nb_samples;
@@ -67,6 +68,7 @@ static const AVOption ardftsrc_options[] = {
     { "sample_rate", "set the sample rate", OFFSET(sample_rate), AV_OPT_TYPE_INT, {.i64=0}, 0, INT_MAX, FLAGS },
     { "quality", "set the quality", OFFSET(quality), AV_OPT_TYPE_INT, {.i64=1024}, 1, INT32_MAX, FLAGS },
     { "bandwidth", "set the bandwidth", OFFSET(bandwidth), AV_OPT_TYPE_FLOAT, {.dbl=0.95}, 0, 1, FLAGS },
+    { "padding", "set the zero padding of the transforms", OFFSET(padding), AV_OPT_TYPE_FLOAT, {.dbl=0.5}, 0, 0.5, FLAGS },
     {NULL}
 };
 
@@ -123,7 +125,7 @@ static int config_input(AVFilterLink *inlink)
     AVFilterLink *outlink = ctx->outputs[0];
     AudioRDFTSRCContext *s = ctx->priv;
     int max_nb_samples, ret;
-    int64_t factor;
+    int64_t factor, pad;
 
     if (inlink->sample_rate == outlink->sample_rate)
         return 0;
@@ -136,15 +138,16 @@ static int config_input(AVFilterLink *inlink)
     factor = lrint(2.0*ceil(s->quality/(2.0*s->out_nb_samples)));
     max_nb_samples = 2*FFMAX(s->in_nb_samples, s->out_nb_samples);
     factor = FFMIN(factor, INT32_MAX/max_nb_samples);
-    s->in_nb_samples *= factor;
-    s->out_nb_samples *= factor;
-
-    s->in_rdft_size = s->in_nb_samples * 2;
-    s->out_rdft_size = s->out_nb_samples * 2;
+    /* the transforms keep 2*factor periods, pad of them are zero padding */
+    pad = av_clip64(lrint(factor * s->padding), 1, factor / 2);
+    s->in_rdft_size = s->in_nb_samples * 2 * factor;
+    s->out_rdft_size = s->out_nb_samples * 2 * factor;
+    s->in_nb_samples *= 2 * (factor - pad);
+    s->out_nb_samples *= 2 * (factor - pad);
     s->out_offset = s->trim_size = (s->out_rdft_size - s->out_nb_samples) >> 1;
     s->in_offset = s->flush_size = (s->in_rdft_size - s->in_nb_samples) >> 1;
     s->delay = av_rescale_q(s->in_offset, (AVRational){ 1, inlink->sample_rate }, inlink->time_base);
-    s->tr_nb_samples = FFMIN(s->in_nb_samples, s->out_nb_samples);
+    s->tr_nb_samples = FFMIN(s->in_rdft_size, s->out_rdft_size) / 2;
     s->taper_samples = lrint(s->tr_nb_samples * (1.0-s->bandwidth));
     av_log(ctx, AV_LOG_DEBUG, "factor: %"PRId64" | %d => %d | delay: %"PRId64"\n", factor, s->in_rdft_size, s->out_rdft_size, s->delay);
 
@@ -19,10 +19,10 @@
  */
 
 #include "libavutil/common.h"
-#include "libavutil/float_dsp.h"
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
 
+#include "adaptivedsp.h"
 #include "audio.h"
 #include "avfilter.h"
 #include "formats.h"
@@ -50,15 +50,14 @@ typedef struct AudioRLSContext {
     AVFrame *offset;
     AVFrame *delay;
     AVFrame *coeffs;
-    AVFrame *p, *dp;
-    AVFrame *gains;
-    AVFrame *u, *tmp;
+    AVFrame *p;
+    AVFrame *u;
 
     AVFrame *frame[2];
 
     int (*filter_channels)(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs);
 
-    AVFloatDSPContext *fdsp;
+    AudioAdaptiveDSPContext dsp;
 } AudioRLSContext;
 
 #define OFFSET(x) offsetof(AudioRLSContext, x)
@@ -186,18 +185,12 @@ static int config_output(AVFilterLink *outlink)
         s->delay = ff_get_audio_buffer(outlink, 2 * s->kernel_size);
     if (!s->coeffs)
         s->coeffs = ff_get_audio_buffer(outlink, 2 * s->kernel_size);
-    if (!s->gains)
-        s->gains = ff_get_audio_buffer(outlink, s->kernel_size);
     if (!s->p)
         s->p = ff_get_audio_buffer(outlink, s->kernel_size * s->kernel_size);
-    if (!s->dp)
-        s->dp = ff_get_audio_buffer(outlink, s->kernel_size * s->kernel_size);
     if (!s->u)
         s->u = ff_get_audio_buffer(outlink, s->kernel_size);
-    if (!s->tmp)
-        s->tmp = ff_get_audio_buffer(outlink, s->kernel_size);
 
-    if (!s->delay || !s->coeffs || !s->p || !s->dp || !s->gains || !s->offset || !s->u || !s->tmp)
+    if (!s->delay || !s->coeffs || !s->p || !s->offset || !s->u)
         return AVERROR(ENOMEM);
 
     for (int ch = 0; ch < s->offset->ch_layout.nb_channels; ch++) {
@@ -237,9 +230,7 @@ static av_cold int init(AVFilterContext *ctx)
 {
     AudioRLSContext *s = ctx->priv;
 
-    s->fdsp = avpriv_float_dsp_alloc(0);
-    if (!s->fdsp)
-        return AVERROR(ENOMEM);
+    ff_adaptive_init(&s->dsp);
 
     return 0;
 }
@@ -248,15 +239,11 @@ static av_cold void uninit(AVFilterContext *ctx)
 {
     AudioRLSContext *s = ctx->priv;
 
-    av_freep(&s->fdsp);
     av_frame_free(&s->delay);
     av_frame_free(&s->coeffs);
-    av_frame_free(&s->gains);
     av_frame_free(&s->offset);
     av_frame_free(&s->p);
-    av_frame_free(&s->dp);
     av_frame_free(&s->u);
-    av_frame_free(&s->tmp);
     av_frame_free(&s->frame[0]);
     av_frame_free(&s->frame[1]);
 }
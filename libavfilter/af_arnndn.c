@@ -32,12 +32,15 @@
  */
 
 #include "libavutil/avassert.h"
+#include "libavutil/crc.h"
 #include "libavutil/file_open.h"
 #include "libavutil/float_dsp.h"
 #include "libavutil/mem.h"
 #include "libavutil/mem_internal.h"
 #include "libavutil/opt.h"
+#include "libavutil/thread.h"
 #include "libavutil/tx.h"
+#include "af_arnndndsp.h"
 #include "avfilter.h"
 #include "audio.h"
 #include "filters.h"
@@ -66,6 +69,8 @@
 
 #define MAX_NEURONS 128
 
+#define BATCH_SIZE 4
+
 #define ACTIVATION_TANH    0
 #define ACTIVATION_SIGMOID 1
 #define ACTIVATION_RELU    2
@@ -89,7 +94,13 @@ typedef struct GRULayer {
     int activation;
 } GRULayer;
 
-typedef struct RNNModel {
+typedef struct RNNModel { /* read-only once loaded, shared between instances */
+    struct RNNModel *next;
+    unsigned refcount;
+    char *filename;
+    int64_t file_size;
+    uint32_t file_crc;
+
     int input_dense_size;
     const DenseLayer *input_dense;
 
@@ -131,6 +142,15 @@ typedef struct DenoiseState {
     RNNState rnn[2];
     AVTXContext *tx, *txi;
     av_tx_fn tx_fn, txi_fn;
+
+    /* analysis of the current frame */
+    int active;
+    DECLARE_ALIGNED(32, float, features)[MAX_NEURONS];
+    DECLARE_ALIGNED(32, float, gains)[MAX_NEURONS];
+    AVComplexFloat X[FREQ_SIZE];
+    AVComplexFloat P[FREQ_SIZE];
+    float Ex[NB_BANDS], Ep[NB_BANDS];
+    DECLARE_ALIGNED(32, float, Exp)[NB_BANDS];
 } DenoiseState;
 
 typedef struct AudioRNNContext {
@@ -148,12 +168,16 @@ typedef struct AudioRNNContext {
     RNNModel *model[2];
 
     AVFloatDSPContext *fdsp;
+    AudioRNNDSPContext dsp;
 } AudioRNNContext;
 
 #define F_ACTIVATION_TANH       0
 #define F_ACTIVATION_SIGMOID    1
 #define F_ACTIVATION_RELU       2
 
+static AVMutex model_cache_lock = AV_MUTEX_INITIALIZER;
+static RNNModel *model_cache;
+
 static void rnnoise_model_free(RNNModel *model)
 {
 #define FREE_MAYBE(ptr) do { if (ptr) free(ptr); } while (0)
@@ -181,6 +205,7 @@ static void rnnoise_model_free(RNNModel *model)
     FREE_GRU(denoise_gru);
     FREE_DENSE(denoise_output);
     FREE_DENSE(vad_output);
+    av_free(model->filename);
     av_free(model);
 }
 
@@ -256,8 +281,26 @@ static int rnnoise_model_from_file(FILE *f, RNNModel **rnn)
     } \
     } while (0)
 
+#define INPUT_ARRAY2(name, len0, len1) do { \
+    float *values = av_calloc(FFALIGN((len0), ARNNDN_ALIGN) * (len1), sizeof(float)); \
+    if (!values) { \
+        rnnoise_model_free(ret); \
+        return AVERROR(ENOMEM); \
+    } \
+    name = values; \
+    for (int k = 0; k < (len0); k++) { \
+        for (int j = 0; j < (len1); j++) { \
+            if (fscanf(f, "%d", &in) != 1) { \
+                rnnoise_model_free(ret); \
+                return AVERROR(EINVAL); \
+            } \
+            values[j * FFALIGN((len0), ARNNDN_ALIGN) + k] = in; \
+        } \
+    } \
+    } while (0)
+
 #define INPUT_ARRAY3(name, len0, len1, len2) do { \
-    float *values = av_calloc(FFALIGN((len0), 4) * FFALIGN((len1), 4) * (len2), sizeof(float)); \
+    float *values = av_calloc(FFALIGN((len0), ARNNDN_ALIGN) * FFALIGN((len1), ARNNDN_ALIGN) * (len2), sizeof(float)); \
     if (!values) { \
         rnnoise_model_free(ret); \
         return AVERROR(ENOMEM); \
@@ -270,7 +313,7 @@ static int rnnoise_model_from_file(FILE *f, RNNModel **rnn)
                     rnnoise_model_free(ret); \
                     return AVERROR(EINVAL); \
                 } \
-                values[j * (len2) * FFALIGN((len0), 4) + i * FFALIGN((len0), 4) + k] = in; \
+                values[j * (len2) * FFALIGN((len0), ARNNDN_ALIGN) + i * FFALIGN((len0), ARNNDN_ALIGN) + k] = in; \
             } \
         } \
     } \
@@ -290,7 +333,7 @@ static int rnnoise_model_from_file(FILE *f, RNNModel **rnn)
     ret->name ## _size = name->nb_neurons; \
     INPUT_ACTIVATION(name->activation); \
     NEW_LINE(); \
-    INPUT_ARRAY(name->input_weights, name->nb_inputs * name->nb_neurons); \
+    INPUT_ARRAY2(name->input_weights, name->nb_inputs, name->nb_neurons); \
     NEW_LINE(); \
     INPUT_ARRAY(name->bias, name->nb_neurons); \
     NEW_LINE(); \
@@ -348,8 +391,10 @@ static int config_input(AVFilterLink *inlink)
 {
     AVFilterContext *ctx = inlink->dst;
     AudioRNNContext *s = ctx->priv;
+    FilterLink *l = ff_filter_link(inlink);
     int ret = 0;
 
+    l->min_samples = l->max_samples = FRAME_SIZE;
     s->channels = inlink->ch_layout.nb_channels;
 
     if (!s->st)
@@ -372,15 +417,15 @@ static int config_input(AVFilterLink *inlink)
 
     for (int i = 0; i < s->channels; i++) {
         DenoiseState *st = &s->st[i];
-        float scale = 1.f;
+        float scale = 1.f, iscale = 1.f / WINDOW_SIZE;
 
         if (!st->tx)
-            ret = av_tx_init(&st->tx, &st->tx_fn, AV_TX_FLOAT_FFT, 0, WINDOW_SIZE, &scale, 0);
+            ret = av_tx_init(&st->tx, &st->tx_fn, AV_TX_FLOAT_RDFT, 0, WINDOW_SIZE, &scale, 0);
         if (ret < 0)
             return ret;
 
         if (!st->txi)
-            ret = av_tx_init(&st->txi, &st->txi_fn, AV_TX_FLOAT_FFT, 1, WINDOW_SIZE, &scale, 0);
+            ret = av_tx_init(&st->txi, &st->txi_fn, AV_TX_FLOAT_RDFT, 1, WINDOW_SIZE, &iscale, 0);
         if (ret < 0)
             return ret;
     }
@@ -406,37 +451,18 @@ static void biquad(float *y, float mem[2], const float *x,
 #define RNN_CLEAR(dst, n) (memset((dst), 0, (n)*sizeof(*(dst))))
 #define RNN_COPY(dst, src, n) (memcpy((dst), (src), (n)*sizeof(*(dst)) + 0*((dst)-(src)) ))
 
-static void forward_transform(DenoiseState *st, AVComplexFloat *out, const float *in)
+static void forward_transform(DenoiseState *st, AVComplexFloat *out, float *in)
 {
-    AVComplexFloat x[WINDOW_SIZE];
-    AVComplexFloat y[WINDOW_SIZE];
-
-    for (int i = 0; i < WINDOW_SIZE; i++) {
-        x[i].re = in[i];
-        x[i].im = 0;
-    }
-
-    st->tx_fn(st->tx, y, x, sizeof(AVComplexFloat));
-
-    RNN_COPY(out, y, FREQ_SIZE);
+    st->tx_fn(st->tx, out, in, sizeof(float));
 }
 
 static void inverse_transform(DenoiseState *st, float *out, const AVComplexFloat *in)
 {
-    AVComplexFloat x[WINDOW_SIZE];
-    AVComplexFloat y[WINDOW_SIZE];
+    AVComplexFloat x[FREQ_SIZE];
 
     RNN_COPY(x, in, FREQ_SIZE);
 
-    for (int i = FREQ_SIZE; i < WINDOW_SIZE; i++) {
-        x[i].re =  x[WINDOW_SIZE - i].re;
-        x[i].im = -x[WINDOW_SIZE - i].im;
-    }
-
-    st->txi_fn(st->txi, y, x, sizeof(AVComplexFloat));
-
-    for (int i = 0; i < WINDOW_SIZE; i++)
-        out[i] = y[i].re / WINDOW_SIZE;
+    st->txi_fn(st->txi, out, x, sizeof(AVComplexFloat));
 }
 
 static const uint8_t eband5ms[] = {
@@ -1248,138 +1274,188 @@ static inline float sigmoid_approx(float x)
     return .5f + .5f*tansig_approx(.5f*x);
 }
 
-static void compute_dense(const DenseLayer *layer, float *output, const float *input)
+/* sum[b] = w . x[b] for the nb vectors of a batch, x padded to BATCH_SIZE entries */
+static av_always_inline void batch_dot(const AudioRNNContext *s, float *sum, const float *w,
+                                       float *const *x, int nb, int len)
 {
-    const int N = layer->nb_neurons, M = layer->nb_inputs, stride = N;
-
-    for (int i = 0; i < N; i++) {
-        /* Compute update gate. */
-        float sum = layer->bias[i];
-
-        for (int j = 0; j < M; j++)
-            sum += layer->input_weights[j * stride + i] * input[j];
+    if (nb > 1)
+        s->dsp.dot4(sum, w, (const float *const *)x, len);
+    else
+        s->dsp.dot(sum, w, x[0], len);
+}
 
-        output[i] = WEIGHTS_SCALE * sum;
+static float activation(int type, float x)
+{
+    switch (type) {
+    case ACTIVATION_SIGMOID: return sigmoid_approx(x);
+    case ACTIVATION_TANH:    return tansig_approx(x);
+    case ACTIVATION_RELU:    return FFMAX(0, x);
+    default: av_assert0(0);
     }
+}
 
-    if (layer->activation == ACTIVATION_SIGMOID) {
-        for (int i = 0; i < N; i++)
-            output[i] = sigmoid_approx(output[i]);
-    } else if (layer->activation == ACTIVATION_TANH) {
-        for (int i = 0; i < N; i++)
-            output[i] = tansig_approx(output[i]);
-    } else if (layer->activation == ACTIVATION_RELU) {
-        for (int i = 0; i < N; i++)
-            output[i] = FFMAX(0, output[i]);
-    } else {
-        av_assert0(0);
+static void compute_dense(const AudioRNNContext *s, const DenseLayer *layer,
+                          float *const *output, float *const *input, int nb)
+{
+    const int N = layer->nb_neurons, AM = FFALIGN(layer->nb_inputs, ARNNDN_ALIGN);
+    float sum[BATCH_SIZE];
+
+    for (int i = 0; i < N; i++) {
+        batch_dot(s, sum, layer->input_weights + i * AM, input, nb, AM);
+        for (int b = 0; b < nb; b++)
+            output[b][i] = activation(layer->activation, WEIGHTS_SCALE * (layer->bias[i] + sum[b]));
     }
 }
 
-static void compute_gru(AudioRNNContext *s, const GRULayer *gru, float *state, const float *input)
+static void compute_gru(const AudioRNNContext *s, const GRULayer *gru,
+                        float *const *state, float *const *input, int nb)
 {
-    LOCAL_ALIGNED_32(float, z, [MAX_NEURONS]);
-    LOCAL_ALIGNED_32(float, r, [MAX_NEURONS]);
-    LOCAL_ALIGNED_32(float, h, [MAX_NEURONS]);
+    LOCAL_ALIGNED_32(float, z, [BATCH_SIZE], [MAX_NEURONS]);
+    LOCAL_ALIGNED_32(float, r, [BATCH_SIZE], [MAX_NEURONS]);
+    LOCAL_ALIGNED_32(float, h, [BATCH_SIZE], [MAX_NEURONS]);
     const int M = gru->nb_inputs;
     const int N = gru->nb_neurons;
-    const int AN = FFALIGN(N, 4);
-    const int AM = FFALIGN(M, 4);
+    const int AN = FFALIGN(N, ARNNDN_ALIGN);
+    const int AM = FFALIGN(M, ARNNDN_ALIGN);
     const int stride = 3 * AN, istride = 3 * AM;
+    float sum[BATCH_SIZE], rsum[BATCH_SIZE];
+    float *rstate[BATCH_SIZE];
 
     for (int i = 0; i < N; i++) {
         /* Compute update gate. */
-        float sum = gru->bias[i];
-
-        sum += s->fdsp->scalarproduct_float(gru->input_weights + i * istride, input, AM);
-        sum += s->fdsp->scalarproduct_float(gru->recurrent_weights + i * stride, state, AN);
-        z[i] = sigmoid_approx(WEIGHTS_SCALE * sum);
+        batch_dot(s, sum,  gru->input_weights + i * istride, input, nb, AM);
+        batch_dot(s, rsum, gru->recurrent_weights + i * stride, state, nb, AN);
+        for (int b = 0; b < nb; b++)
+            z[b][i] = sigmoid_approx(WEIGHTS_SCALE * (gru->bias[i] + sum[b] + rsum[b]));
     }
 
     for (int i = 0; i < N; i++) {
         /* Compute reset gate. */
-        float sum = gru->bias[N + i];
+        batch_dot(s, sum,  gru->input_weights + AM + i * istride, input, nb, AM);
+        batch_dot(s, rsum, gru->recurrent_weights + AN + i * stride, state, nb, AN);
+        for (int b = 0; b < nb; b++)
+            r[b][i] = sigmoid_approx(WEIGHTS_SCALE * (gru->bias[N + i] + sum[b] + rsum[b]));
+    }
 
-        sum += s->fdsp->scalarproduct_float(gru->input_weights + AM + i * istride, input, AM);
-        sum += s->fdsp->scalarproduct_float(gru->recurrent_weights + AN + i * stride, state, AN);
-        r[i] = sigmoid_approx(WEIGHTS_SCALE * sum);
+    /* The output uses the state scaled by the reset gate. */
+    for (int b = 0; b < nb; b++) {
+        for (int j = 0; j < N; j++)
+            r[b][j] *= state[b][j];
+        memset(r[b] + N, 0, (AN - N) * sizeof(**r));
     }
+    for (int b = 0; b < BATCH_SIZE; b++)
+        rstate[b] = r[FFMIN(b, nb - 1)];
 
     for (int i = 0; i < N; i++) {
         /* Compute output. */
-        float sum = gru->bias[2 * N + i];
+        batch_dot(s, sum,  gru->input_weights + 2 * AM + i * istride, input, nb, AM);
+        batch_dot(s, rsum, gru->recurrent_weights + 2 * AN + i * stride, rstate, nb, AN);
+        for (int b = 0; b < nb; b++) {
+            const float out = activation(gru->activation,
+                                         WEIGHTS_SCALE * (gru->bias[2 * N + i] + sum[b] + rsum[b]));
 
-        sum += s->fdsp->scalarproduct_float(gru->input_weights + 2 * AM + i * istride, input, AM);
-        for (int j = 0; j < N; j++)
-            sum += gru->recurrent_weights[2 * AN + i * stride + j] * state[j] * r[j];
-
-        if (gru->activation == ACTIVATION_SIGMOID)
-            sum = sigmoid_approx(WEIGHTS_SCALE * sum);
-        else if (gru->activation == ACTIVATION_TANH)
-            sum = tansig_approx(WEIGHTS_SCALE * sum);
-        else if (gru->activation == ACTIVATION_RELU)
-            sum = FFMAX(0, WEIGHTS_SCALE * sum);
-        else
-            av_assert0(0);
-        h[i] = z[i] * state[i] + (1.f - z[i]) * sum;
+            h[b][i] = z[b][i] * state[b][i] + (1.f - z[b][i]) * out;
+        }
     }
 
-    RNN_COPY(state, h, N);
+    for (int b = 0; b < nb; b++)
+        RNN_COPY(state[b], h[b], N);
 }
 
 #define INPUT_SIZE 42
 
-static void compute_rnn(AudioRNNContext *s, RNNState *rnn, float *gains, float *vad, const float *input)
+/**
+ * Run the network for a batch of up to BATCH_SIZE channels. Every layer
+ * is evaluated for all channels of the batch at once, so each weight is
+ * loaded once per batch instead of once per channel.
+ */
+static void compute_rnn(const AudioRNNContext *s, DenoiseState *const *st, int nb)
 {
-    LOCAL_ALIGNED_32(float, dense_out,     [MAX_NEURONS]);
-    LOCAL_ALIGNED_32(float, noise_input,   [MAX_NEURONS * 3]);
-    LOCAL_ALIGNED_32(float, denoise_input, [MAX_NEURONS * 3]);
-
-    compute_dense(rnn->model->input_dense, dense_out, input);
-    compute_gru(s, rnn->model->vad_gru, rnn->vad_gru_state, dense_out);
-    compute_dense(rnn->model->vad_output, vad, rnn->vad_gru_state);
-
-    memcpy(noise_input, dense_out, rnn->model->input_dense_size * sizeof(float));
-    memcpy(noise_input + rnn->model->input_dense_size,
-           rnn->vad_gru_state, rnn->model->vad_gru_size * sizeof(float));
-    memcpy(noise_input + rnn->model->input_dense_size + rnn->model->vad_gru_size,
-           input, INPUT_SIZE * sizeof(float));
-
-    compute_gru(s, rnn->model->noise_gru, rnn->noise_gru_state, noise_input);
-
-    memcpy(denoise_input, rnn->vad_gru_state, rnn->model->vad_gru_size * sizeof(float));
-    memcpy(denoise_input + rnn->model->vad_gru_size,
-           rnn->noise_gru_state, rnn->model->noise_gru_size * sizeof(float));
-    memcpy(denoise_input + rnn->model->vad_gru_size + rnn->model->noise_gru_size,
-           input, INPUT_SIZE * sizeof(float));
-
-    compute_gru(s, rnn->model->denoise_gru, rnn->denoise_gru_state, denoise_input);
-    compute_dense(rnn->model->denoise_output, gains, rnn->denoise_gru_state);
+    LOCAL_ALIGNED_32(float, dense_out,     [BATCH_SIZE], [MAX_NEURONS]);
+    LOCAL_ALIGNED_32(float, noise_input,   [BATCH_SIZE], [MAX_NEURONS * 3]);
+    LOCAL_ALIGNED_32(float, denoise_input, [BATCH_SIZE], [MAX_NEURONS * 3]);
+    const RNNModel *model = st[0]->rnn[0].model;
+    float *features[BATCH_SIZE], *gains[BATCH_SIZE], *dense[BATCH_SIZE];
+    float *noise[BATCH_SIZE], *denoise[BATCH_SIZE];
+    float *vad_state[BATCH_SIZE], *noise_state[BATCH_SIZE], *denoise_state[BATCH_SIZE];
+    float vad_prob[BATCH_SIZE], *vad[BATCH_SIZE];
+
+    for (int b = 0; b < BATCH_SIZE; b++) {
+        const int n = FFMIN(b, nb - 1);
+        const RNNState *rnn = &st[n]->rnn[0];
+
+        features[b]      = st[n]->features;
+        gains[b]         = st[n]->gains;
+        dense[b]         = dense_out[n];
+        noise[b]         = noise_input[n];
+        denoise[b]       = denoise_input[n];
+        vad_state[b]     = rnn->vad_gru_state;
+        noise_state[b]   = rnn->noise_gru_state;
+        denoise_state[b] = rnn->denoise_gru_state;
+        vad[b]           = &vad_prob[n];
+    }
+
+    /* the padding of the layer inputs must be zero */
+    memset(dense_out, 0, nb * sizeof(*dense_out));
+    compute_dense(s, model->input_dense, dense, features, nb);
+    compute_gru(s, model->vad_gru, vad_state, dense, nb);
+    compute_dense(s, model->vad_output, vad, vad_state, nb);
+
+    for (int b = 0; b < nb; b++) {
+        float *dst = noise[b];
+
+        memcpy(dst, dense[b], model->input_dense_size * sizeof(float));
+        dst += model->input_dense_size;
+        memcpy(dst, vad_state[b], model->vad_gru_size * sizeof(float));
+        dst += model->vad_gru_size;
+        memcpy(dst, features[b], INPUT_SIZE * sizeof(float));
+        dst += INPUT_SIZE;
+        memset(dst, 0, (noise_input[b] + MAX_NEURONS * 3 - dst) * sizeof(float));
+    }
+
+    compute_gru(s, model->noise_gru, noise_state, noise, nb);
+
+    for (int b = 0; b < nb; b++) {
+        float *dst = denoise[b];
+
+        memcpy(dst, vad_state[b], model->vad_gru_size * sizeof(float));
+        dst += model->vad_gru_size;
+        memcpy(dst, noise_state[b], model->noise_gru_size * sizeof(float));
+        dst += model->noise_gru_size;
+        memcpy(dst, features[b], INPUT_SIZE * sizeof(float));
+        dst += INPUT_SIZE;
+        memset(dst, 0, (denoise_input[b] + MAX_NEURONS * 3 - dst) * sizeof(float));
+    }
+
+    compute_gru(s, model->denoise_gru, denoise_state, denoise, nb);
+    compute_dense(s, model->denoise_output, gains, denoise_state, nb);
 }
 
-static float rnnoise_channel(AudioRNNContext *s, DenoiseState *st, float *out, const float *in,
+static void rnnoise_analysis(AudioRNNContext *s, DenoiseState *st, const float *in,
                              int disabled)
 {
-    AVComplexFloat X[FREQ_SIZE];
-    AVComplexFloat P[WINDOW_SIZE];
-    float x[FRAME_SIZE];
-    float Ex[NB_BANDS], Ep[NB_BANDS];
-    LOCAL_ALIGNED_32(float, Exp, [NB_BANDS]);
-    float features[NB_FEATURES];
-    float g[NB_BANDS];
-    float gf[FREQ_SIZE];
-    float vad_prob = 0;
-    float *history = st->history;
     static const float a_hp[2] = {-1.99599, 0.99600};
     static const float b_hp[2] = {-2, 1};
+    float x[FRAME_SIZE];
     int silence;
 
     biquad(x, st->mem_hp_x, in, b_hp, a_hp, FRAME_SIZE);
-    silence = compute_frame_features(s, st, X, P, Ex, Ep, Exp, features, x);
+    silence = compute_frame_features(s, st, st->X, st->P, st->Ex, st->Ep, st->Exp,
+                                     st->features, x);
+    st->active = !silence && !disabled;
+}
 
-    if (!silence && !disabled) {
-        compute_rnn(s, &st->rnn[0], g, &vad_prob, features);
-        pitch_filter(X, P, Ex, Ep, Exp, g);
+static void rnnoise_denoise(AudioRNNContext *s, DenoiseState *const *batch, int nb)
+{
+    compute_rnn(s, batch, nb);
+
+    for (int b = 0; b < nb; b++) {
+        DenoiseState *st = batch[b];
+        AVComplexFloat *X = st->X;
+        float *g = st->gains;
+        float gf[FREQ_SIZE];
+
+        pitch_filter(X, st->P, st->Ex, st->Ep, st->Exp, g);
         for (int i = 0; i < NB_BANDS; i++) {
             float alpha = .6f;
 
@@ -1394,11 +1470,12 @@ static float rnnoise_channel(AudioRNNContext *s, DenoiseState *st, float *out, c
             X[i].im *= gf[i];
         }
     }
+}
 
-    frame_synthesis(s, st, out, X);
-    memcpy(history, in, FRAME_SIZE * sizeof(*history));
-
-    return vad_prob;
+static void rnnoise_synthesis(AudioRNNContext *s, DenoiseState *st, float *out, const float *in)
+{
+    frame_synthesis(s, st, out, st->X);
+    memcpy(st->history, in, FRAME_SIZE * sizeof(*st->history));
 }
 
 typedef struct ThreadData {
@@ -1414,11 +1491,30 @@ static int rnnoise_channels(AVFilterContext *ctx, void *arg, int jobnr, int nb_j
     const int start = (out->ch_layout.nb_channels * jobnr) / nb_jobs;
     const int end = (out->ch_layout.nb_channels * (jobnr+1)) / nb_jobs;
 
+    DenoiseState *batch[BATCH_SIZE];
+    int nb = 0;
+
+    for (int ch = start; ch < end; ch++) {
+        DenoiseState *st = &s->st[ch];
+
+        rnnoise_analysis(s, st, (const float *)in->extended_data[ch], ctx->is_disabled);
+        if (!st->active)
+            continue;
+
+        batch[nb++] = st;
+        if (nb == BATCH_SIZE) {
+            rnnoise_denoise(s, batch, nb);
+            nb = 0;
+        }
+    }
+
+    if (nb > 0)
+        rnnoise_denoise(s, batch, nb);
+
     for (int ch = start; ch < end; ch++) {
-        rnnoise_channel(s, &s->st[ch],
-                        (float *)out->extended_data[ch],
-                        (const float *)in->extended_data[ch],
-                        ctx->is_disabled);
+        rnnoise_synthesis(s, &s->st[ch],
+                          (float *)out->extended_data[ch],
+                          (const float *)in->extended_data[ch]);
     }
 
     return 0;
@@ -1468,9 +1564,50 @@ static int activate(AVFilterContext *ctx)
     return FFERROR_NOT_READY;
 }
 
+static int file_checksum(FILE *f, int64_t *size, uint32_t *crc)
+{
+    const AVCRC *table = av_crc_get_table(AV_CRC_32_IEEE);
+    uint8_t buf[4096];
+    size_t len;
+
+    *size = 0;
+    *crc = 0;
+    while ((len = fread(buf, 1, sizeof(buf), f)) > 0) {
+        *crc = av_crc(table, *crc, buf, len);
+        *size += len;
+    }
+
+    if (ferror(f))
+        return AVERROR(EIO);
+    rewind(f);
+
+    return 0;
+}
+
+static void release_model(RNNModel *model)
+{
+    if (!model)
+        return;
+
+    ff_mutex_lock(&model_cache_lock);
+    if (!--model->refcount) {
+        for (RNNModel **m = &model_cache; *m; m = &(*m)->next) {
+            if (*m == model) {
+                *m = model->next;
+                break;
+            }
+        }
+        rnnoise_model_free(model);
+    }
+    ff_mutex_unlock(&model_cache_lock);
+}
+
 static int open_model(AVFilterContext *ctx, RNNModel **model)
 {
     AudioRNNContext *s = ctx->priv;
+    uint32_t crc;
+    int64_t size;
+    RNNModel *m;
     int ret;
     FILE *f;
 
@@ -1482,11 +1619,42 @@ static int open_model(AVFilterContext *ctx, RNNModel **model)
         return AVERROR(EINVAL);
     }
 
-    ret = rnnoise_model_from_file(f, model);
+    ret = file_checksum(f, &size, &crc);
+    if (ret < 0) {
+        fclose(f);
+        return ret;
+    }
+
+    /* parsing a model is slow and its weights are never modified, so it is
+     * shared by all instances using the same unchanged file */
+    ff_mutex_lock(&model_cache_lock);
+    for (m = model_cache; m; m = m->next) {
+        if (!strcmp(m->filename, s->model_name) &&
+            m->file_size == size && m->file_crc == crc)
+            break;
+    }
+    if (m) {
+        m->refcount++;
+    } else if ((ret = rnnoise_model_from_file(f, &m)) >= 0) {
+        m->filename = av_strdup(s->model_name);
+        if (!m->filename) {
+            rnnoise_model_free(m);
+            ret = AVERROR(ENOMEM);
+        } else {
+            m->file_size = size;
+            m->file_crc  = crc;
+            m->refcount  = 1;
+            m->next = model_cache;
+            model_cache = m;
+        }
+    }
+    ff_mutex_unlock(&model_cache_lock);
     fclose(f);
-    if (!*model || ret < 0)
+    if (ret < 0)
         return ret;
 
+    *model = m;
+
     return 0;
 }
 
@@ -1498,6 +1666,7 @@ static av_cold int init(AVFilterContext *ctx)
     s->fdsp = avpriv_float_dsp_alloc(0);
     if (!s->fdsp)
         return AVERROR(ENOMEM);
+    ff_arnndn_init(&s->dsp);
 
     ret = open_model(ctx, &s->model[0]);
     if (ret < 0)
@@ -1523,7 +1692,7 @@ static void free_model(AVFilterContext *ctx, int n)
 {
     AudioRNNContext *s = ctx->priv;
 
-    rnnoise_model_free(s->model[n]);
+    release_model(s->model[n]);
     s->model[n] = NULL;
 
     for (int ch = 0; ch < s->channels && s->st; ch++) {
@@ -0,0 +1,91 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFILTER_ARNNDNDSP_H
+#define AVFILTER_ARNNDNDSP_H
+
+#include "libavutil/attributes.h"
+
+/**
+ * Weight rows and input vectors are padded with zeros to a multiple of
+ * this many values.
+ */
+#define ARNNDN_ALIGN 8
+
+/**
+ * Dot products of the dense and GRU layers of the arnndn filter.
+ *
+ * For every implementation dot4() computes each of its sums with exactly
+ * the same operations as dot(), so the result for one channel does not
+ * depend on how channels are batched. Both pointers must therefore always
+ * be set together.
+ */
+typedef struct AudioRNNDSPContext {
+    /**
+     * Compute the scalar product of w and x.
+     *
+     * @param len number of values, a multiple of ARNNDN_ALIGN
+     */
+    void (*dot)(float *sum, const float *w, const float *x, int len);
+
+    /**
+     * Compute the scalar products of w with each of the 4 vectors in x,
+     * loading the weights only once.
+     *
+     * @param len number of values, a multiple of ARNNDN_ALIGN
+     */
+    void (*dot4)(float *sum, const float *w, const float *const *x, int len);
+} AudioRNNDSPContext;
+
+static void dot_c(float *sum, const float *w, const float *x, int len)
+{
+    float s = 0.f;
+
+    for (int i = 0; i < len; i++)
+        s += w[i] * x[i];
+
+    *sum = s;
+}
+
+static void dot4_c(float *sum, const float *w, const float *const *x, int len)
+{
+    const float *x0 = x[0], *x1 = x[1], *x2 = x[2], *x3 = x[3];
+    float s0 = 0.f, s1 = 0.f, s2 = 0.f, s3 = 0.f;
+
+    for (int i = 0; i < len; i++) {
+        const float wi = w[i];
+
+        s0 += wi * x0[i];
+        s1 += wi * x1[i];
+        s2 += wi * x2[i];
+        s3 += wi * x3[i];
+    }
+
+    sum[0] = s0;
+    sum[1] = s1;
+    sum[2] = s2;
+    sum[3] = s3;
+}
+
+static av_unused void ff_arnndn_init(AudioRNNDSPContext *dsp)
+{
+    dsp->dot  = dot_c;
+    dsp->dot4 = dot4_c;
+}
+
+#endif /* AVFILTER_ARNNDNDSP_H */
@@ -47,6 +47,10 @@
 #define MEASURE_CONTRAST (1 << 13)
 #define MEASURE_TENERGY  (1 << 14)
 
+#define MEASURE_SUM      (MEASURE_MEAN | MEASURE_VARIANCE | MEASURE_CENTROID | MEASURE_SPREAD | \
+                          MEASURE_SKEWNESS | MEASURE_KURTOSIS | MEASURE_FLATNESS | MEASURE_CREST | \
+                          MEASURE_SLOPE | MEASURE_ROLLOFF)
+
 typedef struct ChannelSpectralStats {
     float mean;
     float variance;
@@ -238,13 +242,18 @@ static void set_metadata(AudioSpectralStatsContext *s, AVDictionary **metadata)
     }
 }
 
-static float spectral_mean(const float *const spectral, int size, int max_freq)
+static float spectral_sum(const float *const spectral, int size)
 {
     float sum = 0.f;
 
     for (int n = 0; n < size; n++)
         sum += spectral[n];
 
+    return sum;
+}
+
+static float spectral_mean(const float *const spectral, int size, int max_freq, float sum)
+{
     return sum / size;
 }
 
@@ -263,29 +272,25 @@ static float spectral_variance(const float *const spectral, int size, int max_fr
     return sum / size;
 }
 
-static float spectral_centroid(const float *const spectral, int size, int max_freq)
+static float spectral_centroid(const float *const spectral, int size, int max_freq, float sum)
 {
     const float scale = max_freq / (float)size;
-    float num = 0.f, den = 0.f;
+    float num = 0.f, den = sum;
 
-    for (int n = 0; n < size; n++) {
+    for (int n = 0; n < size; n++)
         num += spectral[n] * n * scale;
-        den += spectral[n];
-    }
 
     den += FLT_EPSILON;
     return num / den;
 }
 
-static float spectral_spread(const float *const spectral, int size, int max_freq, float centroid)
+static float spectral_spread(const float *const spectral, int size, int max_freq, float sum, float centroid)
 {
     const float scale = max_freq / (float)size;
-    float num = 0.f, den = 0.f;
+    float num = 0.f, den = sum;
 
-    for (int n = 0; n < size; n++) {
+    for (int n = 0; n < size; n++)
         num += spectral[n] * sqrf(n * scale - centroid);
-        den += spectral[n];
-    }
 
     den += FLT_EPSILON;
     return sqrtf(num / den);
@@ -296,30 +301,26 @@ static float cbrf(float a)
     return a * a * a;
 }
 
-static float spectral_skewness(const float *const spectral, int size, int max_freq, float centroid, float spread)
+static float spectral_skewness(const float *const spectral, int size, int max_freq, float sum, float centroid, float spread)
 {
     const float scale = max_freq / (float)size;
-    float num = 0.f, den = 0.f;
+    float num = 0.f, den = sum;
 
-    for (int n = 0; n < size; n++) {
+    for (int n = 0; n < size; n++)
         num += spectral[n] * cbrf(n * scale - centroid);
-        den += spectral[n];
-    }
 
     den *= cbrf(spread);
     den += FLT_EPSILON;
     return num / den;
 }
 
-static float spectral_kurtosis(const float *const spectral, int size, int max_freq, float centroid, float spread)
+static float spectral_kurtosis(const float *const spectral, int size, int max_freq, float sum, float centroid, float spread)
 {
     const float scale = max_freq / (float)size;
-    float num = 0.f, den = 0.f;
+    float num = 0.f, den = sum;
 
-    for (int n = 0; n < size; n++) {
+    for (int n = 0; n < size; n++)
         num += spectral[n] * sqrf(sqrf(n * scale - centroid));
-        den += spectral[n];
-    }
 
     den *= sqrf(sqrf(spread));
     den += FLT_EPSILON;
@@ -338,15 +339,12 @@ static float spectral_entropy(const float *const spectral, int size, int max_fre
     return -num / den;
 }
 
-static float spectral_flatness(const float *const spectral, int size, int max_freq)
+static float spectral_flatness(const float *const spectral, int size, int max_freq, float sum)
 {
-    float num = 0.f, den = 0.f;
+    float num = 0.f, den = sum;
 
-    for (int n = 0; n < size; n++) {
-        float v = spectral[n];
-        num += logf(v + FLT_EPSILON);
-        den += v;
-    }
+    for (int n = 0; n < size; n++)
+        num += logf(spectral[n] + FLT_EPSILON);
 
     num /= size;
     den /= size;
@@ -355,14 +353,12 @@ static float spectral_flatness(const float *const spectral, int size, int max_fr
     return num / den;
 }
 
-static float spectral_crest(const float *const spectral, int size, int max_freq)
+static float spectral_crest(const float *const spectral, int size, int max_freq, float sum)
 {
-    float max = 0.f, mean = 0.f;
+    float max = 0.f, mean = sum;
 
-    for (int n = 0; n < size; n++) {
+    for (int n = 0; n < size; n++)
         max = fmaxf(max, spectral[n]);
-        mean += spectral[n];
-    }
 
     mean /= size;
     mean += FLT_EPSILON;
@@ -380,14 +376,11 @@ static float spectral_flux(const float *const spectral, const float *const prev_
     return sqrtf(sum);
 }
 
-static float spectral_slope(const float *const spectral, int size, int max_freq)
+static float spectral_slope(const float *const spectral, int size, int max_freq, float sum)
 {
     const float mean_freq = size * 0.5f;
-    float mean_spectral = 0.f, num = 0.f, den = 0.f;
-
-    for (int n = 0; n < size; n++)
-        mean_spectral += spectral[n];
-    mean_spectral /= size;
+    const float mean_spectral = sum / size;
+    float num = 0.f, den = 0.f;
 
     for (int n = 0; n < size; n++) {
         num += ((n - mean_freq) / mean_freq) * (spectral[n] - mean_spectral);
@@ -411,14 +404,12 @@ static float spectral_decrease(const float *const spectral, int size, int max_fr
     return num / den;
 }
 
-static float spectral_rolloff(const float *const spectral, int size, int max_freq)
+static float spectral_rolloff(const float *const spectral, int size, int max_freq, float norm)
 {
     const float scale = max_freq / (float)size;
-    float norm = 0.f, sum = 0.f;
+    float sum = 0.f;
     int idx = 0.f;
 
-    for (int n = 0; n < size; n++)
-        norm += spectral[n];
     norm *= 0.85f;
 
     for (int n = 0; n < size; n++) {
@@ -474,9 +465,10 @@ static int filter_channel(AVFilterContext *ctx, void *arg, int jobnr, int nb_job
         ChannelSpectralStats *stats = &s->stats[ch];
         AVComplexFloat *fft_out = s->fft_out[ch];
         float *fft_in = s->fft_in[ch];
-        float *magnitude = s->magnitude[ch];
-        float *prev_magnitude = s->prev_magnitude[ch];
+        float *magnitude = s->prev_magnitude[ch];
+        float *prev_magnitude = s->magnitude[ch];
         const float scale = 1.f / win_size;
+        float sum = 0.f;
 
         memmove(window, &window[s->hop_size], offset * sizeof(float));
         memcpy(&window[offset], in->extended_data[ch], in->nb_samples * sizeof(float));
@@ -487,46 +479,49 @@ static int filter_channel(AVFilterContext *ctx, void *arg, int jobnr, int nb_job
 
         s->tx_fn(s->fft[ch], fft_out, fft_in, sizeof(*fft_in));
 
-        for (int n = 0; n < nb_bins; n++) {
-            fft_out[n].re *= scale;
-            fft_out[n].im *= scale;
-        }
-
+        /* the squared norm and sqrtf() vectorize, unlike hypotf() */
         for (int n = 0; n < nb_bins; n++)
-            magnitude[n] = hypotf(fft_out[n].re, fft_out[n].im);
+            magnitude[n] = sqrtf(fft_out[n].re * fft_out[n].re +
+                                 fft_out[n].im * fft_out[n].im) * scale;
+
+        /* the magnitude sum is shared by most of the measurements */
+        if (s->measure & MEASURE_SUM)
+            sum = spectral_sum(magnitude, nb_bins);
 
         if (s->measure & (MEASURE_MEAN | MEASURE_VARIANCE))
-            stats->mean     = spectral_mean(magnitude, nb_bins, in->sample_rate / 2);
+            stats->mean     = spectral_mean(magnitude, nb_bins, in->sample_rate / 2, sum);
         if (s->measure & MEASURE_VARIANCE)
             stats->variance = spectral_variance(magnitude, nb_bins, in->sample_rate / 2, stats->mean);
         if (s->measure & (MEASURE_SPREAD | MEASURE_KURTOSIS | MEASURE_SKEWNESS | MEASURE_CENTROID))
-            stats->centroid = spectral_centroid(magnitude, nb_bins, in->sample_rate / 2);
+            stats->centroid = spectral_centroid(magnitude, nb_bins, in->sample_rate / 2, sum);
         if (s->measure & (MEASURE_SPREAD | MEASURE_KURTOSIS | MEASURE_SKEWNESS))
-            stats->spread   = spectral_spread(magnitude, nb_bins, in->sample_rate / 2, stats->centroid);
+            stats->spread   = spectral_spread(magnitude, nb_bins, in->sample_rate / 2, sum, stats->centroid);
         if (s->measure & MEASURE_SKEWNESS)
-            stats->skewness = spectral_skewness(magnitude, nb_bins, in->sample_rate / 2, stats->centroid, stats->spread);
+            stats->skewness = spectral_skewness(magnitude, nb_bins, in->sample_rate / 2, sum, stats->centroid, stats->spread);
         if (s->measure & MEASURE_KURTOSIS)
-            stats->kurtosis = spectral_kurtosis(magnitude, nb_bins, in->sample_rate / 2, stats->centroid, stats->spread);
+            stats->kurtosis = spectral_kurtosis(magnitude, nb_bins, in->sample_rate / 2, sum, stats->centroid, stats->spread);
         if (s->measure & MEASURE_ENTROPY)
             stats->entropy  = spectral_entropy(magnitude, nb_bins, in->sample_rate / 2);
         if (s->measure & MEASURE_FLATNESS)
-            stats->flatness = spectral_flatness(magnitude, nb_bins, in->sample_rate / 2);
+            stats->flatness = spectral_flatness(magnitude, nb_bins, in->sample_rate / 2, sum);
         if (s->measure & MEASURE_CREST)
-            stats->crest    = spectral_crest(magnitude, nb_bins, in->sample_rate / 2);
+            stats->crest    = spectral_crest(magnitude, nb_bins, in->sample_rate / 2, sum);
         if (s->measure & MEASURE_FLUX)
             stats->flux     = spectral_flux(magnitude, prev_magnitude, nb_bins, in->sample_rate / 2);
         if (s->measure & MEASURE_SLOPE)
-            stats->slope    = spectral_slope(magnitude, nb_bins, in->sample_rate / 2);
+            stats->slope    = spectral_slope(magnitude, nb_bins, in->sample_rate / 2, sum);
         if (s->measure & MEASURE_DECREASE)
             stats->decrease = spectral_decrease(magnitude, nb_bins, in->sample_rate / 2);
         if (s->measure & MEASURE_ROLLOFF)
-            stats->rolloff  = spectral_rolloff(magnitude, nb_bins, in->sample_rate / 2);
+            stats->rolloff  = spectral_rolloff(magnitude, nb_bins, in->sample_rate / 2, sum);
         if (s->measure & MEASURE_CONTRAST)
             stats->contrast = spectral_contrast(magnitude, nb_bins, in->sample_rate / 2);
         if (s->measure & MEASURE_TENERGY)
             stats->total_energy = spectral_tenergy(magnitude, nb_bins, in->sample_rate / 2);
 
-        memcpy(prev_magnitude, magnitude, win_size * sizeof(float));
+        /* the current magnitudes become the previous ones of the next window */
+        s->magnitude[ch] = magnitude;
+        s->prev_magnitude[ch] = prev_magnitude;
     }
 
     return 0;
@@ -59,10 +59,23 @@
 #define MEASURE_ABS_PEAK_COUNT          (1 << 25)
 #define MEASURE_CLIP_COUNT              (1 << 26)
 
-#define MEASURE_PEAK                    (MEASURE_PEAK_LEVEL)
-#define MEASURE_MINMAX                  (MEASURE_MIN_LEVEL | MEASURE_MAX_LEVEL)
+/* groups of measurements sharing the same per-sample statistics */
+#define MEASURE_ABS_PEAKS               (MEASURE_ABS_PEAK_COUNT | MEASURE_CLIP_COUNT)
+#define MEASURE_LEVELS                  (MEASURE_MIN_LEVEL | MEASURE_MAX_LEVEL | MEASURE_PEAK_LEVEL | \
+                                         MEASURE_CREST_FACTOR | MEASURE_DYNAMIC_RANGE)
+#define MEASURE_RUNS                    (MEASURE_FLAT_FACTOR | MEASURE_PEAK_COUNT)
+#define MEASURE_RMS_WINDOW              (MEASURE_RMS_PEAK | MEASURE_RMS_TROUGH)
+#define MEASURE_SIGMA_X2                (MEASURE_RMS_LEVEL | MEASURE_CREST_FACTOR | MEASURE_RMS_WINDOW)
+#define MEASURE_DIFFERENCES             (MEASURE_MIN_DIFFERENCE | MEASURE_MAX_DIFFERENCE | \
+                                         MEASURE_MEAN_DIFFERENCE | MEASURE_RMS_DIFFERENCE)
+#define MEASURE_ZERO_RUNS               (MEASURE_ZERO_CROSSINGS | MEASURE_ZERO_CROSSINGS_RATE)
+#define MEASURE_NOISE                   (MEASURE_NOISE_FLOOR | MEASURE_NOISE_FLOOR_COUNT)
+#define MEASURE_MINMAX                  (MEASURE_MIN_LEVEL | MEASURE_MAX_LEVEL | MEASURE_PEAK_LEVEL | \
+                                         MEASURE_NUMBER_OF_SAMPLES)
 #define MEASURE_DENORMALS               (MEASURE_NUMBER_OF_NANS | MEASURE_NUMBER_OF_INFS | MEASURE_NUMBER_OF_DENORMALS)
 
+#define ASTATS_BLOCK_SIZE 256
+
 typedef struct ChannelStats {
     double last;
     double last_non_zero;
@@ -296,6 +309,311 @@ static double calc_noise_floor(double *ss, double x, double px,
     return r;
 }
 
+/* Statistics are accumulated over blocks of samples, d holding the raw and x
+ * the normalized values. The statistics are gathered by update_core(),
+ * instantiated with a constant selection so that the loop only contains the
+ * selected statistics: one fused pass when all of them are needed, one tight
+ * pass per statistic otherwise. */
+
+#define STAT_ABS_PEAKS      (1 << 0)
+#define STAT_LEVELS         (1 << 1)
+#define STAT_RUNS           (1 << 2)
+#define STAT_MIN_NON_ZERO   (1 << 3)
+#define STAT_ZERO_RUNS      (1 << 4)
+#define STAT_SIGMA_X        (1 << 5)
+#define STAT_SIGMA_X2       (1 << 6)
+#define STAT_RMS_WINDOW     (1 << 7)
+#define STAT_DIFFERENCES    (1 << 8)
+#define STAT_ENTROPY        (1 << 9)
+#define STAT_NOISE_FLOOR    (1 << 10)
+#define STAT_ALL            ((1 << 11) - 1)
+
+static av_always_inline void update_core(AudioStatsContext *s, ChannelStats *p,
+                                         const double *d, const double *x,
+                                         int nb_samples, const unsigned stats)
+{
+    const double mult = s->mult;
+    const int tc_samples = s->tc_samples;
+    const uint64_t nb_prev = p->nb_samples;
+    double abs_peak = p->abs_peak;
+    uint64_t abs_peak_count = p->abs_peak_count, clip_count = p->clip_count;
+    double min = p->min, nmin = p->nmin, min_run = p->min_run, min_runs = p->min_runs;
+    double max = p->max, nmax = p->nmax, max_run = p->max_run, max_runs = p->max_runs;
+    uint64_t min_count = p->min_count, max_count = p->max_count;
+    double min_non_zero = p->min_non_zero;
+    double last_non_zero = p->last_non_zero;
+    uint64_t zero_runs = p->zero_runs;
+    double sigma_x = p->sigma_x, sigma_x2 = p->sigma_x2;
+    double avg_sigma_x2 = p->avg_sigma_x2;
+    double min_sigma_x2 = p->min_sigma_x2, max_sigma_x2 = p->max_sigma_x2;
+    double min_diff = p->min_diff, max_diff = p->max_diff;
+    double diff1_sum = p->diff1_sum, diff1_sum_x2 = p->diff1_sum_x2;
+    double sigma_ax = p->sigma_ax, sigma_log2_ax = p->sigma_log2_ax;
+    double *win_samples = p->win_samples;
+    double *sorted_samples = p->sorted_samples;
+    double min_noise_floor = p->noise_floor;
+    uint64_t noise_floor_count = p->noise_floor_count;
+    int sorted_front = p->sorted_front;
+    int sorted_back = p->sorted_back;
+    int win_pos = p->win_pos;
+    double last = p->last;
+
+    for (int n = 0; n < nb_samples; n++) {
+        const double v = d[n];
+
+        if (stats & STAT_ABS_PEAKS) {
+            const double abs_x = fabs(x[n]);
+
+            if (abs_peak < abs_x) {
+                abs_peak = abs_x;
+                abs_peak_count = 1;
+            } else if (abs_peak == abs_x) {
+                abs_peak_count++;
+            }
+            clip_count += abs_x > 1.0;
+        }
+
+        if (stats & STAT_RUNS) {
+            if (v < min) {
+                min = v;
+                nmin = x[n];
+                min_run = 1;
+                min_runs = 0;
+                min_count = 1;
+            } else if (v == min) {
+                min_count++;
+                min_run = v == last ? min_run + 1 : 1;
+            } else if (last == min) {
+                min_runs += min_run * min_run;
+            }
+
+            if (v > max) {
+                max = v;
+                nmax = x[n];
+                max_run = 1;
+                max_runs = 0;
+                max_count = 1;
+            } else if (v == max) {
+                max_count++;
+                max_run = v == last ? max_run + 1 : 1;
+            } else if (last == max) {
+                max_runs += max_run * max_run;
+            }
+        } else if (stats & STAT_LEVELS) {
+            if (v < min) {
+                min = v;
+                nmin = x[n];
+            }
+            if (v > max) {
+                max = v;
+                nmax = x[n];
+            }
+        }
+
+        if (stats & STAT_MIN_NON_ZERO) {
+            if (v != 0 && FFABS(v) < min_non_zero)
+                min_non_zero = FFABS(v);
+        }
+
+        if (stats & STAT_ZERO_RUNS) {
+            if (v != 0) {
+                zero_runs += FFSIGN(v) != FFSIGN(last_non_zero);
+                last_non_zero = v;
+            }
+        }
+
+        if (stats & STAT_SIGMA_X)
+            sigma_x += x[n];
+        if (stats & STAT_SIGMA_X2)
+            sigma_x2 += x[n] * x[n];
+
+        if (stats & STAT_RMS_WINDOW) {
+            avg_sigma_x2 = avg_sigma_x2 * mult + (1.0 - mult) * x[n] * x[n];
+            if (nb_prev + n >= tc_samples) {
+                max_sigma_x2 = FFMAX(max_sigma_x2, avg_sigma_x2);
+                min_sigma_x2 = FFMIN(min_sigma_x2, avg_sigma_x2);
+            }
+        }
+
+        if (stats & STAT_DIFFERENCES) {
+            if (!isnan(last)) {
+                min_diff = FFMIN(min_diff, fabs(v - last));
+                max_diff = FFMAX(max_diff, fabs(v - last));
+                diff1_sum += fabs(v - last);
+                diff1_sum_x2 += (v - last) * (v - last);
+            }
+        }
+
+        if (stats & STAT_ENTROPY) {
+            sigma_ax += fabs(x[n]);
+            if (fabs(x[n]) > 1e-16)
+                sigma_log2_ax += log2(fabs(x[n]));
+        }
+
+        if (stats & STAT_NOISE_FLOOR) {
+            const double drop = win_samples[win_pos];
+            double noise_floor;
+
+            win_samples[win_pos] = x[n];
+            win_pos++;
+
+            if (win_pos >= tc_samples)
+                win_pos = 0;
+
+            noise_floor = calc_noise_floor(sorted_samples, x[n], drop,
+                                           tc_samples, &sorted_front, &sorted_back);
+            if (nb_prev + n + 1 >= tc_samples) {
+                if (isnan(min_noise_floor) || noise_floor < min_noise_floor) {
+                    min_noise_floor = noise_floor;
+                    noise_floor_count = 1;
+                } else if (noise_floor == min_noise_floor) {
+                    noise_floor_count++;
+                }
+            }
+        }
+
+        last = v;
+    }
+
+    if (stats & STAT_ABS_PEAKS) {
+        p->abs_peak = abs_peak;
+        p->abs_peak_count = abs_peak_count;
+        p->clip_count = clip_count;
+    }
+    if (stats & (STAT_LEVELS | STAT_RUNS)) {
+        p->min = min;
+        p->nmin = nmin;
+        p->max = max;
+        p->nmax = nmax;
+    }
+    if (stats & STAT_RUNS) {
+        p->min_run = min_run;
+        p->min_runs = min_runs;
+        p->min_count = min_count;
+        p->max_run = max_run;
+        p->max_runs = max_runs;
+        p->max_count = max_count;
+    }
+    if (stats & STAT_MIN_NON_ZERO)
+        p->min_non_zero = min_non_zero;
+    if (stats & STAT_ZERO_RUNS) {
+        p->last_non_zero = last_non_zero;
+        p->zero_runs = zero_runs;
+    }
+    if (stats & STAT_SIGMA_X)
+        p->sigma_x = sigma_x;
+    if (stats & STAT_SIGMA_X2)
+        p->sigma_x2 = sigma_x2;
+    if (stats & STAT_RMS_WINDOW) {
+        p->avg_sigma_x2 = avg_sigma_x2;
+        p->min_sigma_x2 = min_sigma_x2;
+        p->max_sigma_x2 = max_sigma_x2;
+    }
+    if (stats & STAT_DIFFERENCES) {
+        p->min_diff = min_diff;
+        p->max_diff = max_diff;
+        p->diff1_sum = diff1_sum;
+        p->diff1_sum_x2 = diff1_sum_x2;
+    }
+    if (stats & STAT_ENTROPY) {
+        p->sigma_ax = sigma_ax;
+        p->sigma_log2_ax = sigma_log2_ax;
+    }
+    if (stats & STAT_NOISE_FLOOR) {
+        p->noise_floor = min_noise_floor;
+        p->noise_floor_count = noise_floor_count;
+        p->sorted_front = sorted_front;
+        p->sorted_back = sorted_back;
+        p->win_pos = win_pos;
+    }
+}
+
+#define DEFINE_UPDATE_CORE(name, stats)                                    \
+static void update_##name(AudioStatsContext *s, ChannelStats *p,           \
+                          const double *d, const double *x, int nb_samples) \
+{                                                                          \
+    update_core(s, p, d, x, nb_samples, stats);                            \
+}
+
+DEFINE_UPDATE_CORE(all,           STAT_ALL)
+DEFINE_UPDATE_CORE(abs_peaks,     STAT_ABS_PEAKS)
+DEFINE_UPDATE_CORE(levels,        STAT_LEVELS)
+DEFINE_UPDATE_CORE(runs,          STAT_RUNS)
+DEFINE_UPDATE_CORE(min_non_zero,  STAT_MIN_NON_ZERO)
+DEFINE_UPDATE_CORE(zero_runs,     STAT_ZERO_RUNS)
+DEFINE_UPDATE_CORE(sigma_x,       STAT_SIGMA_X)
+DEFINE_UPDATE_CORE(sigma_x2,      STAT_SIGMA_X2)
+DEFINE_UPDATE_CORE(rms_window,    STAT_RMS_WINDOW)
+DEFINE_UPDATE_CORE(differences,   STAT_DIFFERENCES)
+DEFINE_UPDATE_CORE(entropy,       STAT_ENTROPY)
+DEFINE_UPDATE_CORE(noise_floor,   STAT_NOISE_FLOOR)
+
+static unsigned core_stats(uint32_t mask)
+{
+    unsigned stats = 0;
+
+    if (mask & MEASURE_ABS_PEAKS)
+        stats |= STAT_ABS_PEAKS;
+    if (mask & MEASURE_LEVELS)
+        stats |= STAT_LEVELS;
+    if (mask & MEASURE_RUNS)
+        stats |= STAT_RUNS;
+    if (mask & MEASURE_DYNAMIC_RANGE)
+        stats |= STAT_MIN_NON_ZERO;
+    if (mask & MEASURE_ZERO_RUNS)
+        stats |= STAT_ZERO_RUNS;
+    if (mask & MEASURE_DC_OFFSET)
+        stats |= STAT_SIGMA_X;
+    if (mask & MEASURE_SIGMA_X2)
+        stats |= STAT_SIGMA_X2;
+    if (mask & MEASURE_RMS_WINDOW)
+        stats |= STAT_RMS_WINDOW;
+    if (mask & MEASURE_DIFFERENCES)
+        stats |= STAT_DIFFERENCES;
+    if (mask & MEASURE_ENTROPY)
+        stats |= STAT_ENTROPY;
+    if (mask & MEASURE_NOISE)
+        stats |= STAT_NOISE_FLOOR;
+
+    return stats;
+}
+
+static void update_block(AudioStatsContext *s, ChannelStats *p,
+                         const double *d, const double *x, int nb_samples, uint32_t mask)
+{
+    const unsigned stats = core_stats(mask);
+
+    if (stats == STAT_ALL) {
+        update_all(s, p, d, x, nb_samples);
+    } else {
+        if (stats & STAT_ABS_PEAKS)
+            update_abs_peaks(s, p, d, x, nb_samples);
+        if (stats & STAT_RUNS)
+            update_runs(s, p, d, x, nb_samples);
+        else if (stats & STAT_LEVELS)
+            update_levels(s, p, d, x, nb_samples);
+        if (stats & STAT_MIN_NON_ZERO)
+            update_min_non_zero(s, p, d, x, nb_samples);
+        if (stats & STAT_ZERO_RUNS)
+            update_zero_runs(s, p, d, x, nb_samples);
+        if (stats & STAT_SIGMA_X)
+            update_sigma_x(s, p, d, x, nb_samples);
+        if (stats & STAT_SIGMA_X2)
+            update_sigma_x2(s, p, d, x, nb_samples);
+        if (stats & STAT_RMS_WINDOW)
+            update_rms_window(s, p, d, x, nb_samples);
+        if (stats & STAT_DIFFERENCES)
+            update_differences(s, p, d, x, nb_samples);
+        if (stats & STAT_ENTROPY)
+            update_entropy(s, p, d, x, nb_samples);
+        if (stats & STAT_NOISE_FLOOR)
+            update_noise_floor(s, p, d, x, nb_samples);
+    }
+
+    p->last = d[nb_samples - 1];
+    p->nb_samples += nb_samples;
+}
+
 #define DEPTH 16
 #include "astats_template.c"
 
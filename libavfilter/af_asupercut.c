@@ -60,6 +60,7 @@ typedef struct ASuperCutContext {
 #define BIQUAD_SVF 0
 #define BIQUAD_WDF 0
 #define BIQUAD_ZDF 0
+#define BIQUAD_LANES 0
 
 #undef DEPTH
 #define DEPTH 32
@@ -736,25 +736,37 @@ static int yae_adjust_position(ATempoContext *atempo)
                                                                         \
         scalar_type *out     = (scalar_type *)dst;                      \
         scalar_type *out_end = (scalar_type *)dst_end;                  \
+        const int channels = atempo->channels;                          \
+                                                                        \
+        /* number of samples that fit into the destination buffer,   */ \
+        /* the first n0 of which precede the start of the stream and */ \
+        /* are passed through unchanged:                              */ \
+        const int64_t n  = FFMIN(overlap, (out_end - out) / channels);  \
+        const int64_t n0 = av_clip64(-frag->position[0], 0, n);         \
         int64_t i;                                                      \
                                                                         \
-        for (i = 0; i < overlap && out < out_end;                       \
-             i++, atempo->position[1]++, wa++, wb++) {                  \
-            float w0 = *wa;                                             \
-            float w1 = *wb;                                             \
-            int j;                                                      \
+        memcpy(out, aaa, n0 * channels * sizeof(scalar_type));          \
+        aaa += n0 * channels;                                           \
+        bbb += n0 * channels;                                           \
+        out += n0 * channels;                                           \
+                                                                        \
+        for (i = n0; i < n; i++) {                                      \
+            const float w0 = wa[i];                                     \
+            const float w1 = wb[i];                                     \
                                                                         \
-            for (j = 0; j < atempo->channels;                           \
-                 j++, aaa++, bbb++, out++) {                            \
-                float t0 = (float)*aaa;                                 \
-                float t1 = (float)*bbb;                                 \
+            for (int j = 0; j < channels; j++) {                        \
+                float t0 = (float)aaa[j];                               \
+                float t1 = (float)bbb[j];                               \
                                                                         \
-                *out =                                                  \
-                    frag->position[0] + i < 0 ?                         \
-                    *aaa :                                              \
-                    (scalar_type)(t0 * w0 + t1 * w1);                   \
+                out[j] = (scalar_type)(t0 * w0 + t1 * w1);              \
             }                                                           \
+                                                                        \
+            aaa += channels;                                            \
+            bbb += channels;                                            \
+            out += channels;                                            \
         }                                                               \
+                                                                        \
+        atempo->position[1] += n;                                       \
         dst = (uint8_t *)out;                                           \
     } while (0)
 
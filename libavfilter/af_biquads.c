@@ -29,7 +29,9 @@
 #include "libavutil/channel_layout.h"
 #include "libavutil/ffmath.h"
 #include "libavutil/mem.h"
+#include "libavutil/mem_internal.h"
 #include "libavutil/opt.h"
+#include "af_biquadsdsp.h"
 #include "audio.h"
 #include "avfilter.h"
 #include "filters.h"
@@ -62,18 +64,6 @@ enum WidthType {
     NB_WTYPE,
 };
 
-enum TransformType {
-    DI,
-    DII,
-    TDI,
-    TDII,
-    LATT,
-    SVF,
-    ZDF,
-    WDF,
-    NB_TTYPE,
-};
-
 typedef struct BiquadsContext {
     const AVClass *class;
 
@@ -120,6 +110,12 @@ typedef struct BiquadsContext {
     void (*clip_reset)(AVFilterContext *ctx, void *st, const int nb_channels);
     void (*filter)(void *st, const void *ibuf, void *obuf, int len,
                    int ch, int disabled);
+
+    BiquadsDSPContext dsp;
+    DECLARE_ALIGNED(16, double, lanes_coeffs)[BQ_NB_COEFFS * BIQUADS_DSP_LANES];
+    void (*init_lanes)(void *st, int transform_type, void *coeffs);
+    void (*filter_lanes)(struct BiquadsContext *s, uint8_t **dst, uint8_t **src,
+                         int len, const int *chs);
 } BiquadsContext;
 
 #define CLIP_RESET 1
@@ -131,6 +127,7 @@ typedef struct BiquadsContext {
 #define BIQUAD_SVF 1
 #define BIQUAD_WDF 1
 #define BIQUAD_ZDF 1
+#define BIQUAD_LANES 1
 
 #define DEPTH 8
 #include "biquads_template.c"
@@ -448,6 +445,7 @@ static int config_filter(AVFilterLink *outlink, int reset)
     const double cos_w0 = cos(w0);
     const double sin_w0 = sin(w0);
     double alpha, beta, width;
+    int ret;
 
     s->bypass = (((w0 > M_PI || w0 <= 0.) && reset) || (s->width <= 0.)) && (s->filter_type != biquad && s->filter_type != transform);
     if (s->bypass) {
@@ -864,6 +862,24 @@ static int config_filter(AVFilterLink *outlink, int reset)
         av_assert0(0);
     }
 
+    s->filter_lanes = NULL;
+    if (!s->block_samples) {
+        switch (inlink->format) {
+        case AV_SAMPLE_FMT_FLTP:
+            if (s->dsp.filter_flt[s->transform_type]) {
+                s->init_lanes   = init_lanes_fltp;
+                s->filter_lanes = filter_lanes_fltp;
+            }
+            break;
+        case AV_SAMPLE_FMT_DBLP:
+            if (s->dsp.filter_dbl[s->transform_type]) {
+                s->init_lanes   = init_lanes_dblp;
+                s->filter_lanes = filter_lanes_dblp;
+            }
+            break;
+        }
+    }
+
     s->block_align = av_get_bytes_per_sample(inlink->format);
 
     if (s->transform_type == LATT)
@@ -875,8 +891,15 @@ static int config_filter(AVFilterLink *outlink, int reset)
     else if (s->transform_type == ZDF)
         convert_dir2zdf(s, inlink->sample_rate);
 
-    return s->init_state(ctx, &s->st, outlink->ch_layout.nb_channels,
-                         s->block_samples, reset, s->a, s->b, s->mix);
+    ret = s->init_state(ctx, &s->st, outlink->ch_layout.nb_channels,
+                        s->block_samples, reset, s->a, s->b, s->mix);
+    if (ret < 0)
+        return ret;
+
+    if (s->filter_lanes)
+        s->init_lanes(s->st, s->transform_type, s->lanes_coeffs);
+
+    return 0;
 }
 
 static int config_output(AVFilterLink *outlink)
@@ -886,6 +909,8 @@ static int config_output(AVFilterLink *outlink)
 
     s->nb_channels = outlink->ch_layout.nb_channels;
 
+    ff_biquads_dsp_init(&s->dsp);
+
     switch (outlink->format) {
     case AV_SAMPLE_FMT_U8P:
         s->init_state = init_biquad_u8p;
@@ -969,6 +994,8 @@ static int filter_channel(AVFilterContext *ctx, void *arg, int jobnr, int nb_job
     BiquadsContext *s = ctx->priv;
     const int start = (buf->ch_layout.nb_channels * jobnr) / nb_jobs;
     const int end = (buf->ch_layout.nb_channels * (jobnr+1)) / nb_jobs;
+    const int lanes = s->filter_lanes && !ctx->is_disabled;
+    int chs[BIQUADS_DSP_LANES], nb_chs = 0;
 
     for (int ch = start; ch < end; ch++) {
         enum AVChannel channel = av_channel_layout_channel_from_index(&inlink->ch_layout, ch);
@@ -980,6 +1007,16 @@ static int filter_channel(AVFilterContext *ctx, void *arg, int jobnr, int nb_job
             continue;
         }
 
+        if (lanes) {
+            chs[nb_chs++] = ch;
+            if (nb_chs == BIQUADS_DSP_LANES) {
+                s->filter_lanes(s, out_buf->extended_data, buf->extended_data,
+                                buf->nb_samples, chs);
+                nb_chs = 0;
+            }
+            continue;
+        }
+
         if (!s->block_samples) {
             s->filter(s->st, buf->extended_data[ch], out_buf->extended_data[ch], buf->nb_samples,
                       ch, ctx->is_disabled);
@@ -999,6 +1036,10 @@ static int filter_channel(AVFilterContext *ctx, void *arg, int jobnr, int nb_job
         }
     }
 
+    for (int n = 0; n < nb_chs; n++)
+        s->filter(s->st, buf->extended_data[chs[n]], out_buf->extended_data[chs[n]],
+                  buf->nb_samples, chs[n], 0);
+
     return 0;
 }
 
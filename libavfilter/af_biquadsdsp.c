@@ -0,0 +1,72 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/attributes.h"
+#include "af_biquadsdsp.h"
+
+#define L BIQUADS_DSP_LANES
+
+#define LANES_START(nb_state)                               \
+    ftype s[BIQUADS_DSP_NB_STATE][L];                       \
+    const ftype *a0  = k + BQ_A0  * L;                      \
+    const ftype *a1  = k + BQ_A1  * L;                      \
+    const ftype *a2  = k + BQ_A2  * L;                      \
+    const ftype *b0  = k + BQ_B0  * L;                      \
+    const ftype *b1  = k + BQ_B1  * L;                      \
+    const ftype *b2  = k + BQ_B2  * L;                      \
+    const ftype *wet = k + BQ_WET * L;                      \
+    const ftype *dry = k + BQ_DRY * L;                      \
+                                                            \
+    for (int n = 0; n < nb_state; n++)                      \
+        for (int l = 0; l < L; l++)                         \
+            s[n][l] = state[n * L + l];
+
+#define LANES_END(nb_state)                                 \
+    for (int n = 0; n < nb_state; n++)                      \
+        for (int l = 0; l < L; l++)                         \
+            state[n * L + l] = s[n][l];                     \
+    (void)a0; (void)a1; (void)a2;                           \
+    (void)b0; (void)b1; (void)b2;
+
+#define DEPTH 32
+#include "biquadsdsp_template.c"
+
+#undef DEPTH
+#define DEPTH 64
+#include "biquadsdsp_template.c"
+
+av_cold void ff_biquads_dsp_init(BiquadsDSPContext *dsp)
+{
+    dsp->filter_flt[DI]   = NULL;
+    dsp->filter_flt[DII]  = biquad_dii_flt;
+    dsp->filter_flt[TDI]  = biquad_tdi_flt;
+    dsp->filter_flt[TDII] = biquad_tdii_flt;
+    dsp->filter_flt[LATT] = biquad_latt_flt;
+    dsp->filter_flt[SVF]  = biquad_svf_flt;
+    dsp->filter_flt[ZDF]  = biquad_zdf_flt;
+    dsp->filter_flt[WDF]  = biquad_wdf_flt;
+
+    dsp->filter_dbl[DI]   = NULL;
+    dsp->filter_dbl[DII]  = biquad_dii_dbl;
+    dsp->filter_dbl[TDI]  = biquad_tdi_dbl;
+    dsp->filter_dbl[TDII] = biquad_tdii_dbl;
+    dsp->filter_dbl[LATT] = biquad_latt_dbl;
+    dsp->filter_dbl[SVF]  = biquad_svf_dbl;
+    dsp->filter_dbl[ZDF]  = biquad_zdf_dbl;
+    dsp->filter_dbl[WDF]  = biquad_wdf_dbl;
+}
@@ -0,0 +1,77 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFILTER_BIQUADSDSP_H
+#define AVFILTER_BIQUADSDSP_H
+
+#include <stddef.h>
+
+/* number of planar channels processed by one kernel call */
+#define BIQUADS_DSP_LANES 4
+
+/* number of per-lane state values kept between kernel calls */
+#define BIQUADS_DSP_NB_STATE 4
+
+enum TransformType {
+    DI,
+    DII,
+    TDI,
+    TDII,
+    LATT,
+    SVF,
+    ZDF,
+    WDF,
+    NB_TTYPE,
+};
+
+enum BiquadsDSPCoeff {
+    BQ_A0,
+    BQ_A1,
+    BQ_A2,
+    BQ_B0,
+    BQ_B1,
+    BQ_B2,
+    BQ_WET,
+    BQ_DRY,
+    BQ_NB_COEFFS,
+};
+
+/**
+ * Filter BIQUADS_DSP_LANES planar channels at once.
+ *
+ * @param len    number of samples per channel, a positive multiple of
+ *               BIQUADS_DSP_LANES
+ * @param state  BIQUADS_DSP_NB_STATE x BIQUADS_DSP_LANES values, lane minor,
+ *               16-byte aligned, updated in place
+ * @param coeffs BQ_NB_COEFFS x BIQUADS_DSP_LANES values, lane minor, 16-byte
+ *               aligned; the sign convention of each entry is the one used
+ *               by the corresponding scalar filter in biquads_template.c
+ */
+typedef void (*biquads_flt_fn)(float *const *dst, const float *const *src,
+                               ptrdiff_t len, float *state, const float *coeffs);
+typedef void (*biquads_dbl_fn)(double *const *dst, const double *const *src,
+                               ptrdiff_t len, double *state, const double *coeffs);
+
+typedef struct BiquadsDSPContext {
+    biquads_flt_fn filter_flt[NB_TTYPE];
+    biquads_dbl_fn filter_dbl[NB_TTYPE];
+} BiquadsDSPContext;
+
+void ff_biquads_dsp_init(BiquadsDSPContext *dsp);
+
+#endif /* AVFILTER_BIQUADSDSP_H */
@@ -67,11 +67,16 @@ typedef struct local_gain {
     double threshold;
 } local_gain;
 
+/* The queued elements are always stored contiguously, starting at
+ * elements[first]. The storage is twice max_size, so popping from the
+ * front just advances first, and the queue is only moved back to the
+ * start of the storage once it runs into the end. */
 typedef struct cqueue {
     double *elements;
     int size;
     int max_size;
     int nb_elements;
+    int first;
 } cqueue;
 
 typedef struct DynamicAudioNormalizerContext {
@@ -120,6 +125,7 @@ typedef struct DynamicAudioNormalizerContext {
 typedef struct ThreadData {
     AVFrame *in, *out;
     int enabled;
+    const local_gain *gain;
 } ThreadData;
 
 #define OFFSET(x) offsetof(DynamicAudioNormalizerContext, x)
@@ -189,8 +195,9 @@ static cqueue *cqueue_create(int size, int max_size)
     q->max_size = max_size;
     q->size = size;
     q->nb_elements = 0;
+    q->first = 0;
 
-    q->elements = av_malloc_array(max_size, sizeof(double));
+    q->elements = av_malloc_array(2 * max_size, sizeof(double));
     if (!q->elements) {
         av_free(q);
         return NULL;
@@ -220,7 +227,12 @@ static int cqueue_enqueue(cqueue *q, double element)
 {
     av_assert2(q->nb_elements < q->max_size);
 
-    q->elements[q->nb_elements] = element;
+    if (q->first + q->nb_elements >= 2 * q->max_size) {
+        memmove(q->elements, q->elements + q->first, q->nb_elements * sizeof(double));
+        q->first = 0;
+    }
+
+    q->elements[q->first + q->nb_elements] = element;
     q->nb_elements++;
 
     return 0;
@@ -229,15 +241,20 @@ static int cqueue_enqueue(cqueue *q, double element)
 static double cqueue_peek(cqueue *q, int index)
 {
     av_assert2(index < q->nb_elements);
-    return q->elements[index];
+    return q->elements[q->first + index];
+}
+
+static const double *cqueue_data(cqueue *q)
+{
+    return q->elements + q->first;
 }
 
 static int cqueue_dequeue(cqueue *q, double *element)
 {
     av_assert2(!cqueue_empty(q));
 
-    *element = q->elements[0];
-    memmove(&q->elements[0], &q->elements[1], (q->nb_elements - 1) * sizeof(double));
+    *element = q->elements[q->first];
+    q->first++;
     q->nb_elements--;
 
     return 0;
@@ -247,7 +264,7 @@ static int cqueue_pop(cqueue *q)
 {
     av_assert2(!cqueue_empty(q));
 
-    memmove(&q->elements[0], &q->elements[1], (q->nb_elements - 1) * sizeof(double));
+    q->first++;
     q->nb_elements--;
 
     return 0;
@@ -261,7 +278,8 @@ static void cqueue_resize(cqueue *q, int new_size)
     if (new_size > q->nb_elements) {
         const int side = (new_size - q->nb_elements) / 2;
 
-        memmove(q->elements + side, q->elements, sizeof(double) * q->nb_elements);
+        memmove(q->elements + side, q->elements + q->first, sizeof(double) * q->nb_elements);
+        q->first = 0;
         for (int i = 0; i < side; i++)
             q->elements[i] = q->elements[side];
         q->nb_elements = new_size - 1 - side;
@@ -413,23 +431,47 @@ static inline double bound(const double threshold, const double val)
     return erf(CONST * (val / threshold)) * threshold;
 }
 
+/* Same as fmax(max, fabs(x)) over all samples, but without a libm call
+ * per sample; samples that are NaN are skipped in the same way. */
+static double peak_magnitude(const double *data_ptr, int nb_samples, double max)
+{
+    double max1 = max, max2 = max, max3 = max;
+    int i;
+
+    for (i = 0; i < nb_samples - 3; i += 4) {
+        const double a0 = fabs(data_ptr[i + 0]);
+        const double a1 = fabs(data_ptr[i + 1]);
+        const double a2 = fabs(data_ptr[i + 2]);
+        const double a3 = fabs(data_ptr[i + 3]);
+
+        max  = a0 > max  ? a0 : max;
+        max1 = a1 > max1 ? a1 : max1;
+        max2 = a2 > max2 ? a2 : max2;
+        max3 = a3 > max3 ? a3 : max3;
+    }
+
+    for (; i < nb_samples; i++) {
+        const double a = fabs(data_ptr[i]);
+
+        max = a > max ? a : max;
+    }
+
+    max  = max1 > max  ? max1 : max;
+    max2 = max3 > max2 ? max3 : max2;
+
+    return max2 > max ? max2 : max;
+}
+
 static double find_peak_magnitude(AVFrame *frame, int channel)
 {
     const int nb_samples = frame->nb_samples;
     double max = DBL_EPSILON;
 
     if (channel == -1) {
-        for (int c = 0; c < frame->ch_layout.nb_channels; c++) {
-            double *data_ptr = (double *)frame->extended_data[c];
-
-            for (int i = 0; i < nb_samples; i++)
-                max = fmax(max, fabs(data_ptr[i]));
-        }
+        for (int c = 0; c < frame->ch_layout.nb_channels; c++)
+            max = peak_magnitude((const double *)frame->extended_data[c], nb_samples, max);
     } else {
-        double *data_ptr = (double *)frame->extended_data[channel];
-
-        for (int i = 0; i < nb_samples; i++)
-            max = fmax(max, fabs(data_ptr[i]));
+        max = peak_magnitude((const double *)frame->extended_data[channel], nb_samples, max);
     }
 
     return max;
@@ -491,10 +533,12 @@ static local_gain get_max_local_gain(DynamicAudioNormalizerContext *s, AVFrame *
 
 static double minimum_filter(cqueue *q)
 {
+    const double *data = cqueue_data(q);
+    const int size = cqueue_size(q);
     double min = DBL_MAX;
 
-    for (int i = 0; i < cqueue_size(q); i++) {
-        min = fmin(min, cqueue_peek(q, i));
+    for (int i = 0; i < size; i++) {
+        min = fmin(min, data[i]);
     }
 
     return min;
@@ -503,11 +547,14 @@ static double minimum_filter(cqueue *q)
 static double gaussian_filter(DynamicAudioNormalizerContext *s, cqueue *q, cqueue *tq)
 {
     const double *weights = s->weights;
+    const double *q_data = cqueue_data(q);
+    const double *tq_data = cqueue_data(tq);
+    const int size = cqueue_size(q);
     double result = 0.0, tsum = 0.0;
 
-    for (int i = 0; i < cqueue_size(q); i++) {
-        double tq_item = cqueue_peek(tq, i);
-        double q_item = cqueue_peek(q, i);
+    for (int i = 0; i < size; i++) {
+        double tq_item = tq_data[i];
+        double q_item = q_data[i];
 
         tsum   += tq_item * weights[i];
         result += tq_item * weights[i] * q_item;
@@ -577,13 +624,14 @@ static void update_gain_history(DynamicAudioNormalizerContext *s, int channel,
 static int update_gain_histories(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
     DynamicAudioNormalizerContext *s = ctx->priv;
-    AVFrame *analyze_frame = arg;
+    ThreadData *td = arg;
+    AVFrame *analyze_frame = td->in;
     const int channels = s->channels;
     const int start = (channels * jobnr) / nb_jobs;
     const int end = (channels * (jobnr+1)) / nb_jobs;
 
     for (int c = start; c < end; c++)
-        update_gain_history(s, c, get_max_local_gain(s, analyze_frame, c));
+        update_gain_history(s, c, td->gain ? *td->gain : get_max_local_gain(s, analyze_frame, c));
 
     return 0;
 }
@@ -717,6 +765,8 @@ static int analyze_frame(AVFilterContext *ctx, AVFilterLink *outlink, AVFrame **
     FilterLink *outl = ff_filter_link(outlink);
     DynamicAudioNormalizerContext *s = ctx->priv;
     AVFrame *analyze_frame;
+    local_gain gain;
+    ThreadData td;
 
     if (s->dc_correction || s->compress_factor > DBL_EPSILON) {
         int ret;
@@ -773,15 +823,16 @@ static int analyze_frame(AVFilterContext *ctx, AVFilterLink *outlink, AVFrame **
     s->var_values[VAR_SN] = outl->sample_count_in;
     s->var_values[VAR_T] = s->var_values[VAR_SN] * (double)1/outlink->sample_rate;
 
+    td.in = analyze_frame;
+    td.gain = NULL;
     if (s->channels_coupled) {
-        const local_gain gain = get_max_local_gain(s, analyze_frame, -1);
-        for (int c = 0; c < s->channels; c++)
-            update_gain_history(s, c, gain);
-    } else {
-        ff_filter_execute(ctx, update_gain_histories, analyze_frame, NULL,
-                          FFMIN(s->channels, ff_filter_get_nb_threads(ctx)));
+        gain = get_max_local_gain(s, analyze_frame, -1);
+        td.gain = &gain;
     }
 
+    ff_filter_execute(ctx, update_gain_histories, &td, NULL,
+                      FFMIN(s->channels, ff_filter_get_nb_threads(ctx)));
+
     return 0;
 }
 
@@ -793,16 +844,21 @@ static void amplify_channel(DynamicAudioNormalizerContext *s, AVFrame *in,
     const double *src_ptr = (const double *)in->extended_data[c];
     double *dst_ptr = (double *)frame->extended_data[c];
     const int nb_samples = frame->nb_samples;
+    const double step_size = 1.0 / nb_samples;
     double current_amplification_factor;
 
     cqueue_dequeue(s->gain_history_smoothed[c], &current_amplification_factor);
 
-    for (int i = 0; i < nb_samples && enabled && !bypass; i++) {
-        const double amplification_factor = fade(prev_amplification_factor,
-                                                 current_amplification_factor, i,
-                                                 nb_samples);
+    /* Same ramp as fade(), with the loop-invariant parts hoisted
+     * so that the loop vectorizes. */
+    if (enabled && !bypass) {
+        for (int i = 0; i < nb_samples; i++) {
+            const double f0 = 1.0 - (step_size * (i + 1.0));
+            const double f1 = 1.0 - f0;
 
-        dst_ptr[i] = src_ptr[i] * amplification_factor;
+            dst_ptr[i] = src_ptr[i] * (f0 * prev_amplification_factor +
+                                       f1 * current_amplification_factor);
+        }
     }
 
     s->prev_amplification_factor[c] = current_amplification_factor;
@@ -72,11 +72,11 @@ typedef struct FIREqualizerContext {
     av_tx_fn      analysis_rdft_fn;
     AVTXContext   *analysis_irdft;
     av_tx_fn      analysis_irdft_fn;
-    AVTXContext   *rdft;
+    AVTXContext   **rdft;
     av_tx_fn      rdft_fn;
-    AVTXContext   *irdft;
+    AVTXContext   **irdft;
     av_tx_fn      irdft_fn;
-    AVTXContext   *fft_ctx;
+    AVTXContext   **fft_ctx;
     av_tx_fn      fft_fn;
     AVTXContext   *cepstrum_rdft;
     av_tx_fn      cepstrum_rdft_fn;
@@ -85,6 +85,7 @@ typedef struct FIREqualizerContext {
     int           analysis_rdft_len;
     int           rdft_len;
     int           cepstrum_len;
+    int           nb_channels;
 
     float         *analysis_buf;
     float         *analysis_tbuf;
@@ -165,13 +166,20 @@ static void common_uninit(FIREqualizerContext *s)
 {
     av_tx_uninit(&s->analysis_rdft);
     av_tx_uninit(&s->analysis_irdft);
-    av_tx_uninit(&s->rdft);
-    av_tx_uninit(&s->irdft);
-    av_tx_uninit(&s->fft_ctx);
+    for (int ch = 0; ch < s->nb_channels; ch++) {
+        if (s->rdft)
+            av_tx_uninit(&s->rdft[ch]);
+        if (s->irdft)
+            av_tx_uninit(&s->irdft[ch]);
+        if (s->fft_ctx && ch < s->nb_channels / 2)
+            av_tx_uninit(&s->fft_ctx[ch]);
+    }
+    av_freep(&s->rdft);
+    av_freep(&s->irdft);
+    av_freep(&s->fft_ctx);
     av_tx_uninit(&s->cepstrum_rdft);
     av_tx_uninit(&s->cepstrum_irdft);
-    s->analysis_rdft = s->analysis_irdft = s->rdft = s->irdft = NULL;
-    s->fft_ctx = NULL;
+    s->analysis_rdft = s->analysis_irdft = NULL;
     s->cepstrum_rdft = NULL;
     s->cepstrum_irdft = NULL;
 
@@ -198,26 +206,26 @@ static av_cold void uninit(AVFilterContext *ctx)
 }
 
 static void fast_convolute(FIREqualizerContext *restrict s, const float *restrict kernel_buf, float *restrict conv_buf,
-                           OverlapIndex *restrict idx, float *restrict data, int nsamples)
+                           OverlapIndex *restrict idx, float *restrict data, int nsamples, int ch)
 {
     if (nsamples <= s->nsamples_max) {
         float *buf = conv_buf + idx->buf_idx * s->rdft_len;
         float *obuf = conv_buf + !idx->buf_idx * s->rdft_len + idx->overlap_idx;
-        float *tbuf = s->tx_buf;
+        float *tbuf = s->tx_buf + ch * 2 * (s->rdft_len + 2);
         int center = s->fir_len/2;
         int k;
 
         memset(buf, 0, center * sizeof(*data));
         memcpy(buf + center, data, nsamples * sizeof(*data));
         memset(buf + center + nsamples, 0, (s->rdft_len - nsamples - center) * sizeof(*data));
-        s->rdft_fn(s->rdft, tbuf, buf, sizeof(float));
+        s->rdft_fn(s->rdft[ch], tbuf, buf, sizeof(float));
 
         for (k = 0; k <= s->rdft_len/2; k++) {
             tbuf[2*k] *= kernel_buf[k];
             tbuf[2*k+1] *= kernel_buf[k];
         }
 
-        s->irdft_fn(s->irdft, buf, tbuf, sizeof(AVComplexFloat));
+        s->irdft_fn(s->irdft[ch], buf, tbuf, sizeof(AVComplexFloat));
         for (k = 0; k < s->rdft_len - idx->overlap_idx; k++)
             buf[k] += obuf[k];
         memcpy(data, buf, nsamples * sizeof(*data));
@@ -225,28 +233,28 @@ static void fast_convolute(FIREqualizerContext *restrict s, const float *restric
         idx->overlap_idx = nsamples;
     } else {
         while (nsamples > s->nsamples_max * 2) {
-            fast_convolute(s, kernel_buf, conv_buf, idx, data, s->nsamples_max);
+            fast_convolute(s, kernel_buf, conv_buf, idx, data, s->nsamples_max, ch);
             data += s->nsamples_max;
             nsamples -= s->nsamples_max;
         }
-        fast_convolute(s, kernel_buf, conv_buf, idx, data, nsamples/2);
-        fast_convolute(s, kernel_buf, conv_buf, idx, data + nsamples/2, nsamples - nsamples/2);
+        fast_convolute(s, kernel_buf, conv_buf, idx, data, nsamples/2, ch);
+        fast_convolute(s, kernel_buf, conv_buf, idx, data + nsamples/2, nsamples - nsamples/2, ch);
     }
 }
 
 static void fast_convolute_nonlinear(FIREqualizerContext *restrict s, const float *restrict kernel_buf,
                                      float *restrict conv_buf, OverlapIndex *restrict idx,
-                                     float *restrict data, int nsamples)
+                                     float *restrict data, int nsamples, int ch)
 {
     if (nsamples <= s->nsamples_max) {
         float *buf = conv_buf + idx->buf_idx * s->rdft_len;
         float *obuf = conv_buf + !idx->buf_idx * s->rdft_len + idx->overlap_idx;
-        float *tbuf = s->tx_buf;
+        float *tbuf = s->tx_buf + ch * 2 * (s->rdft_len + 2);
         int k;
 
         memcpy(buf, data, nsamples * sizeof(*data));
         memset(buf + nsamples, 0, (s->rdft_len - nsamples) * sizeof(*data));
-        s->rdft_fn(s->rdft, tbuf, buf, sizeof(float));
+        s->rdft_fn(s->rdft[ch], tbuf, buf, sizeof(float));
 
         for (k = 0; k < s->rdft_len + 2; k += 2) {
             float re, im;
@@ -256,7 +264,7 @@ static void fast_convolute_nonlinear(FIREqualizerContext *restrict s, const floa
             tbuf[k+1] = im;
         }
 
-        s->irdft_fn(s->irdft, buf, tbuf, sizeof(AVComplexFloat));
+        s->irdft_fn(s->irdft[ch], buf, tbuf, sizeof(AVComplexFloat));
         for (k = 0; k < s->rdft_len - idx->overlap_idx; k++)
             buf[k] += obuf[k];
         memcpy(data, buf, nsamples * sizeof(*data));
@@ -264,22 +272,22 @@ static void fast_convolute_nonlinear(FIREqualizerContext *restrict s, const floa
         idx->overlap_idx = nsamples;
     } else {
         while (nsamples > s->nsamples_max * 2) {
-            fast_convolute_nonlinear(s, kernel_buf, conv_buf, idx, data, s->nsamples_max);
+            fast_convolute_nonlinear(s, kernel_buf, conv_buf, idx, data, s->nsamples_max, ch);
             data += s->nsamples_max;
             nsamples -= s->nsamples_max;
         }
-        fast_convolute_nonlinear(s, kernel_buf, conv_buf, idx, data, nsamples/2);
-        fast_convolute_nonlinear(s, kernel_buf, conv_buf, idx, data + nsamples/2, nsamples - nsamples/2);
+        fast_convolute_nonlinear(s, kernel_buf, conv_buf, idx, data, nsamples/2, ch);
+        fast_convolute_nonlinear(s, kernel_buf, conv_buf, idx, data + nsamples/2, nsamples - nsamples/2, ch);
     }
 }
 
 static void fast_convolute2(FIREqualizerContext *restrict s, const float *restrict kernel_buf, AVComplexFloat *restrict conv_buf,
-                            OverlapIndex *restrict idx, float *restrict data0, float *restrict data1, int nsamples)
+                            OverlapIndex *restrict idx, float *restrict data0, float *restrict data1, int nsamples, int ch)
 {
     if (nsamples <= s->nsamples_max) {
         AVComplexFloat *buf = conv_buf + idx->buf_idx * s->rdft_len;
         AVComplexFloat *obuf = conv_buf + !idx->buf_idx * s->rdft_len + idx->overlap_idx;
-        AVComplexFloat *tbuf = (AVComplexFloat *)s->tx_buf;
+        AVComplexFloat *tbuf = (AVComplexFloat *)(s->tx_buf + ch * 2 * (s->rdft_len + 2));
         int center = s->fir_len/2;
         int k;
         float tmp;
@@ -290,7 +298,7 @@ static void fast_convolute2(FIREqualizerContext *restrict s, const float *restri
             buf[center+k].im = data1[k];
         }
         memset(buf + center + nsamples, 0, (s->rdft_len - nsamples - center) * sizeof(*buf));
-        s->fft_fn(s->fft_ctx, tbuf, buf, sizeof(AVComplexFloat));
+        s->fft_fn(s->fft_ctx[ch / 2], tbuf, buf, sizeof(AVComplexFloat));
 
         /* swap re <-> im, do backward fft using forward fft_ctx */
         /* normalize with 0.5f */
@@ -310,7 +318,7 @@ static void fast_convolute2(FIREqualizerContext *restrict s, const float *restri
         tbuf[k].re = 0.5f * kernel_buf[k] * tbuf[k].im;
         tbuf[k].im = 0.5f * kernel_buf[k] * tmp;
 
-        s->fft_fn(s->fft_ctx, buf, tbuf, sizeof(AVComplexFloat));
+        s->fft_fn(s->fft_ctx[ch / 2], buf, tbuf, sizeof(AVComplexFloat));
 
         for (k = 0; k < s->rdft_len - idx->overlap_idx; k++) {
             buf[k].re += obuf[k].re;
@@ -326,13 +334,13 @@ static void fast_convolute2(FIREqualizerContext *restrict s, const float *restri
         idx->overlap_idx = nsamples;
     } else {
         while (nsamples > s->nsamples_max * 2) {
-            fast_convolute2(s, kernel_buf, conv_buf, idx, data0, data1, s->nsamples_max);
+            fast_convolute2(s, kernel_buf, conv_buf, idx, data0, data1, s->nsamples_max, ch);
             data0 += s->nsamples_max;
             data1 += s->nsamples_max;
             nsamples -= s->nsamples_max;
         }
-        fast_convolute2(s, kernel_buf, conv_buf, idx, data0, data1, nsamples/2);
-        fast_convolute2(s, kernel_buf, conv_buf, idx, data0 + nsamples/2, data1 + nsamples/2, nsamples - nsamples/2);
+        fast_convolute2(s, kernel_buf, conv_buf, idx, data0, data1, nsamples/2, ch);
+        fast_convolute2(s, kernel_buf, conv_buf, idx, data0 + nsamples/2, data1 + nsamples/2, nsamples - nsamples/2, ch);
     }
 }
 
@@ -689,7 +697,7 @@ static int generate_kernel(AVFilterContext *ctx, const char *gain, const char *g
         memcpy(rdft_tbuf + s->rdft_len/2, s->analysis_buf + s->analysis_rdft_len - s->rdft_len/2, s->rdft_len/2 * sizeof(*s->analysis_buf));
         if (s->min_phase)
             generate_min_phase_kernel(s, rdft_tbuf);
-        s->rdft_fn(s->rdft, rdft_buf, rdft_tbuf, sizeof(float));
+        s->rdft_fn(s->rdft[0], rdft_buf, rdft_tbuf, sizeof(float));
 
         for (k = 0; k < s->rdft_len + 2; k++) {
             if (isnan(rdft_buf[k]) || isinf(rdft_buf[k])) {
@@ -751,15 +759,31 @@ static int config_input(AVFilterLink *inlink)
         return AVERROR(EINVAL);
     }
 
-    iscale = 0.5f;
-    if (((ret = av_tx_init(&s->rdft,  &s->rdft_fn,  AV_TX_FLOAT_RDFT, 0, 1 << rdft_bits, &scale,  0)) < 0) ||
-        ((ret = av_tx_init(&s->irdft, &s->irdft_fn, AV_TX_FLOAT_RDFT, 1, 1 << rdft_bits, &iscale, 0)) < 0))
-        return ret;
+    s->nb_channels = inlink->ch_layout.nb_channels;
+    s->rdft  = av_calloc(s->nb_channels, sizeof(*s->rdft));
+    s->irdft = av_calloc(s->nb_channels, sizeof(*s->irdft));
+    if (!s->rdft || !s->irdft)
+        return AVERROR(ENOMEM);
 
-    scale = 1.f;
-    if (s->fft2 && !s->multi && inlink->ch_layout.nb_channels > 1 &&
-        ((ret = av_tx_init(&s->fft_ctx, &s->fft_fn, AV_TX_FLOAT_FFT, 0, 1 << rdft_bits, &scale, 0)) < 0))
-        return ret;
+    for (int ch = 0; ch < s->nb_channels; ch++) {
+        iscale = 0.5f;
+        scale = 1.f;
+        if (((ret = av_tx_init(&s->rdft[ch],  &s->rdft_fn,  AV_TX_FLOAT_RDFT, 0, 1 << rdft_bits, &scale,  0)) < 0) ||
+            ((ret = av_tx_init(&s->irdft[ch], &s->irdft_fn, AV_TX_FLOAT_RDFT, 1, 1 << rdft_bits, &iscale, 0)) < 0))
+            return ret;
+    }
+
+    if (s->fft2 && !s->multi && s->nb_channels > 1) {
+        s->fft_ctx = av_calloc(s->nb_channels / 2, sizeof(*s->fft_ctx));
+        if (!s->fft_ctx)
+            return AVERROR(ENOMEM);
+
+        for (int ch = 0; ch < s->nb_channels / 2; ch++) {
+            scale = 1.f;
+            if ((ret = av_tx_init(&s->fft_ctx[ch], &s->fft_fn, AV_TX_FLOAT_FFT, 0, 1 << rdft_bits, &scale, 0)) < 0)
+                return ret;
+        }
+    }
 
     if (s->min_phase) {
         int cepstrum_bits = rdft_bits + 2;
@@ -815,7 +839,7 @@ static int config_input(AVFilterLink *inlink)
     s->kernel_tmp_buf = av_malloc_array((s->rdft_len * 2) * (s->multi ? inlink->ch_layout.nb_channels : 1), sizeof(*s->kernel_tmp_buf));
     s->kernel_tmp_tbuf = av_malloc_array(s->rdft_len, sizeof(*s->kernel_tmp_tbuf));
     s->kernel_buf = av_malloc_array((s->rdft_len * 2) * (s->multi ? inlink->ch_layout.nb_channels : 1), sizeof(*s->kernel_buf));
-    s->tx_buf = av_malloc_array(2 * (s->rdft_len + 2), sizeof(*s->kernel_buf));
+    s->tx_buf = av_malloc_array(2 * (s->rdft_len + 2) * inlink->ch_layout.nb_channels, sizeof(*s->kernel_buf));
     s->conv_buf   = av_calloc(2 * s->rdft_len * inlink->ch_layout.nb_channels, sizeof(*s->conv_buf));
     s->conv_idx   = av_calloc(inlink->ch_layout.nb_channels, sizeof(*s->conv_idx));
     if (!s->analysis_buf || !s->analysis_tbuf || !s->kernel_tmp_buf || !s->kernel_buf || !s->conv_buf || !s->conv_idx || !s->kernel_tmp_tbuf || !s->tx_buf)
@@ -830,32 +854,53 @@ static int config_input(AVFilterLink *inlink)
     return generate_kernel(ctx, SELECT_GAIN(s), SELECT_GAIN_ENTRY(s));
 }
 
-static int filter_frame(AVFilterLink *inlink, AVFrame *frame)
+static int convolute_channels(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    AVFilterContext *ctx = inlink->dst;
     FIREqualizerContext *s = ctx->priv;
-    int ch;
-
-    if (!s->min_phase) {
-        for (ch = 0; ch + 1 < inlink->ch_layout.nb_channels && s->fft_ctx; ch += 2) {
+    AVFrame *frame = arg;
+    const int nb_channels = frame->ch_layout.nb_channels;
+    /* with fft2, a pair of channels shares one complex transform */
+    const int nb_pairs = !s->min_phase && s->fft_ctx ? nb_channels / 2 : 0;
+    const int nb_units = nb_channels - nb_pairs;
+    const int start = (nb_units * jobnr) / nb_jobs;
+    const int end = (nb_units * (jobnr+1)) / nb_jobs;
+
+    for (int n = start; n < end; n++) {
+        int ch;
+
+        if (n < nb_pairs) {
+            ch = 2 * n;
             fast_convolute2(s, s->kernel_buf, (AVComplexFloat *)(s->conv_buf + 2 * ch * s->rdft_len),
                             s->conv_idx + ch, (float *) frame->extended_data[ch],
-                            (float *) frame->extended_data[ch+1], frame->nb_samples);
+                            (float *) frame->extended_data[ch+1], frame->nb_samples, ch);
+            continue;
         }
 
-        for ( ; ch < inlink->ch_layout.nb_channels; ch++) {
+        ch = n + nb_pairs;
+        if (!s->min_phase) {
             fast_convolute(s, s->kernel_buf + (s->multi ? ch * (s->rdft_len * 2) : 0),
-                        s->conv_buf + 2 * ch * s->rdft_len, s->conv_idx + ch,
-                        (float *) frame->extended_data[ch], frame->nb_samples);
-        }
-    } else {
-        for (ch = 0; ch < inlink->ch_layout.nb_channels; ch++) {
+                           s->conv_buf + 2 * ch * s->rdft_len, s->conv_idx + ch,
+                           (float *) frame->extended_data[ch], frame->nb_samples, ch);
+        } else {
             fast_convolute_nonlinear(s, s->kernel_buf + (s->multi ? ch * (s->rdft_len * 2) : 0),
                                      s->conv_buf + 2 * ch * s->rdft_len, s->conv_idx + ch,
-                                     (float *) frame->extended_data[ch], frame->nb_samples);
+                                     (float *) frame->extended_data[ch], frame->nb_samples, ch);
         }
     }
 
+    return 0;
+}
+
+static int filter_frame(AVFilterLink *inlink, AVFrame *frame)
+{
+    AVFilterContext *ctx = inlink->dst;
+    FIREqualizerContext *s = ctx->priv;
+    const int nb_channels = inlink->ch_layout.nb_channels;
+    const int nb_units = nb_channels - (!s->min_phase && s->fft_ctx ? nb_channels / 2 : 0);
+
+    ff_filter_execute(ctx, convolute_channels, frame, NULL,
+                      FFMIN(nb_units, ff_filter_get_nb_threads(ctx)));
+
     s->next_pts = AV_NOPTS_VALUE;
     if (frame->pts != AV_NOPTS_VALUE) {
         s->next_pts = frame->pts + av_rescale_q(frame->nb_samples, av_make_q(1, inlink->sample_rate), inlink->time_base);
@@ -965,4 +1010,5 @@ const AVFilter ff_af_firequalizer = {
     FILTER_OUTPUTS(firequalizer_outputs),
     FILTER_SINGLE_SAMPLEFMT(AV_SAMPLE_FMT_FLTP),
     .priv_class         = &firequalizer_class,
+    .flags              = AVFILTER_FLAG_SLICE_THREADS,
 };
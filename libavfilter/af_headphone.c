@@ -21,7 +21,6 @@
 #include <math.h>
 
 #include "libavutil/channel_layout.h"
-#include "libavutil/cpu.h"
 #include "libavutil/float_dsp.h"
 #include "libavutil/intmath.h"
 #include "libavutil/mem.h"
@@ -32,6 +31,7 @@
 #include "filters.h"
 #include "formats.h"
 #include "audio.h"
+#include "hrtfconv.h"
 
 #define TIME_DOMAIN      0
 #define FREQUENCY_DOMAIN 1
@@ -72,13 +72,11 @@ typedef struct HeadphoneContext {
 
     void *data_ir[2];
     void *temp_src[2];
-    void *out_tx[2];
-    void *in_tx[2];
-    void *temp_afft[2];
 
-    AVTXContext *tx_ctx[2], *itx_ctx[2];
-    av_tx_fn tx_fn[2], itx_fn[2];
+    HRTFConvContext conv;
     void *data_hrtf[2];
+    const void *conv_src[64];
+    int conv_offset[64];
 
     float  (*scalarproduct_flt)(const float  *v1, const float  *v2, int len);
     double (*scalarproduct_dbl)(const double *v1, const double *v2, size_t len);
@@ -187,6 +185,25 @@ static int headphone_frame(HeadphoneContext *s, AVFrame *in, AVFilterLink *outli
     td.in = in; td.out = out;
     td.n_clippings = n_clippings;
 
+    if (s->type == FREQUENCY_DOMAIN) {
+        const int planar = av_sample_fmt_is_planar(in->format);
+        const int in_channels = in->ch_layout.nb_channels;
+        const int sample_size = av_get_bytes_per_sample(in->format);
+        int nb_src = 0;
+
+        for (int i = 0; i < in_channels; i++) {
+            if (i == s->lfe_channel)
+                continue;
+            s->conv_src[nb_src] = planar ? in->extended_data[i] : in->data[0] + i * sample_size;
+            s->conv_offset[nb_src] = s->hrir_map[i] * s->atx_len;
+            nb_src++;
+        }
+
+        ff_hrtfconv_execute(ctx, &s->conv, s->conv_src, planar ? 1 : in_channels,
+                            nb_src, in->nb_samples,
+                            (const void *const *)s->data_hrtf, s->conv_offset);
+    }
+
     ff_filter_execute(ctx, s->convolute, &td, NULL, 2);
 
     if (n_clippings[0] + n_clippings[1] > 0) {
@@ -406,22 +423,13 @@ static av_cold void uninit(AVFilterContext *ctx)
 {
     HeadphoneContext *s = ctx->priv;
 
-    av_tx_uninit(&s->itx_ctx[0]);
-    av_tx_uninit(&s->itx_ctx[1]);
-    av_tx_uninit(&s->tx_ctx[0]);
-    av_tx_uninit(&s->tx_ctx[1]);
+    ff_hrtfconv_uninit(&s->conv);
     av_freep(&s->data_ir[0]);
     av_freep(&s->data_ir[1]);
     av_freep(&s->ringbuffer[0]);
     av_freep(&s->ringbuffer[1]);
     av_freep(&s->temp_src[0]);
     av_freep(&s->temp_src[1]);
-    av_freep(&s->out_tx[0]);
-    av_freep(&s->out_tx[1]);
-    av_freep(&s->in_tx[0]);
-    av_freep(&s->in_tx[1]);
-    av_freep(&s->temp_afft[0]);
-    av_freep(&s->temp_afft[1]);
     av_freep(&s->data_hrtf[0]);
     av_freep(&s->data_hrtf[1]);
 }
@@ -61,7 +61,7 @@ typedef struct PrevCrossover {
 
 typedef struct Crossover {
   PrevCrossover *previous;
-  size_t         pos;
+  size_t        *pos;
   double         coefs[3 *(N+1)];
 } Crossover;
 
@@ -73,10 +73,11 @@ typedef struct CompBand {
     double delay;
     double topfreq;
     Crossover filter;
+    AVFrame *band_buf;
     AVFrame *delay_buf;
     size_t delay_size;
-    ptrdiff_t delay_buf_ptr;
-    size_t delay_buf_cnt;
+    ptrdiff_t *delay_buf_ptr;
+    size_t *delay_buf_cnt;
 } CompBand;
 
 typedef struct MCompandContext {
@@ -86,7 +87,7 @@ typedef struct MCompandContext {
 
     int nb_bands;
     CompBand *bands;
-    AVFrame *band_buf1, *band_buf2, *band_buf3;
+    AVFrame *band_buf1, *band_buf2;
     int band_samples;
     size_t delay_buf_size;
 } MCompandContext;
@@ -108,7 +109,6 @@ static av_cold void uninit(AVFilterContext *ctx)
 
     av_frame_free(&s->band_buf1);
     av_frame_free(&s->band_buf2);
-    av_frame_free(&s->band_buf3);
 
     if (s->bands) {
         for (i = 0; i < s->nb_bands; i++) {
@@ -117,6 +117,10 @@ static av_cold void uninit(AVFilterContext *ctx)
             av_freep(&s->bands[i].volume);
             av_freep(&s->bands[i].transfer_fn.segments);
             av_freep(&s->bands[i].filter.previous);
+            av_freep(&s->bands[i].filter.pos);
+            av_freep(&s->bands[i].delay_buf_ptr);
+            av_freep(&s->bands[i].delay_buf_cnt);
+            av_frame_free(&s->bands[i].band_buf);
             av_frame_free(&s->bands[i].delay_buf);
         }
     }
@@ -304,7 +308,8 @@ static int crossover_setup(AVFilterLink *outlink, Crossover *p, double frequency
     square_quadratic(x + 6, p->coefs + 10);
 
     p->previous = av_calloc(outlink->ch_layout.nb_channels, sizeof(*p->previous));
-    if (!p->previous)
+    p->pos = av_calloc(outlink->ch_layout.nb_channels, sizeof(*p->pos));
+    if (!p->previous || !p->pos)
         return AVERROR(ENOMEM);
 
     return 0;
@@ -354,7 +359,10 @@ static int config_output(AVFilterLink *outlink)
         s->bands[i].attack_rate = av_calloc(outlink->ch_layout.nb_channels, sizeof(double));
         s->bands[i].decay_rate = av_calloc(outlink->ch_layout.nb_channels, sizeof(double));
         s->bands[i].volume = av_calloc(outlink->ch_layout.nb_channels, sizeof(double));
-        if (!s->bands[i].attack_rate || !s->bands[i].decay_rate || !s->bands[i].volume)
+        s->bands[i].delay_buf_ptr = av_calloc(outlink->ch_layout.nb_channels, sizeof(ptrdiff_t));
+        s->bands[i].delay_buf_cnt = av_calloc(outlink->ch_layout.nb_channels, sizeof(size_t));
+        if (!s->bands[i].attack_rate || !s->bands[i].decay_rate || !s->bands[i].volume ||
+            !s->bands[i].delay_buf_ptr || !s->bands[i].delay_buf_cnt)
             return AVERROR(ENOMEM);
 
         for (k = 0; k < FFMIN(nb_attacks / 2, outlink->ch_layout.nb_channels); k++) {
@@ -467,15 +475,16 @@ static int config_output(AVFilterLink *outlink)
 #define CONVOLVE _ _ _ _
 
 static void crossover(int ch, Crossover *p,
-                      double *ibuf, double *obuf_low,
+                      const double *ibuf, double *obuf_low,
                       double *obuf_high, size_t len)
 {
     double out_low, out_high;
+    size_t pos = p->pos[ch];
 
     while (len--) {
-        p->pos = p->pos ? p->pos - 1 : N - 1;
-#define _ out_low += p->coefs[j] * p->previous[ch][p->pos + j].in \
-            - p->coefs[2*N+2 + j] * p->previous[ch][p->pos + j].out_low, j++;
+        pos = pos ? pos - 1 : N - 1;
+#define _ out_low += p->coefs[j] * p->previous[ch][pos + j].in \
+            - p->coefs[2*N+2 + j] * p->previous[ch][pos + j].out_low, j++;
         {
             int j = 1;
             out_low = p->coefs[0] * *ibuf;
@@ -483,38 +492,43 @@ static void crossover(int ch, Crossover *p,
             *obuf_low++ = out_low;
         }
 #undef _
-#define _ out_high += p->coefs[j+N+1] * p->previous[ch][p->pos + j].in \
-            - p->coefs[2*N+2 + j] * p->previous[ch][p->pos + j].out_high, j++;
+#define _ out_high += p->coefs[j+N+1] * p->previous[ch][pos + j].in \
+            - p->coefs[2*N+2 + j] * p->previous[ch][pos + j].out_high, j++;
         {
             int j = 1;
             out_high = p->coefs[N+1] * *ibuf;
             CONVOLVE
             *obuf_high++ = out_high;
         }
-        p->previous[ch][p->pos + N].in = p->previous[ch][p->pos].in = *ibuf++;
-        p->previous[ch][p->pos + N].out_low = p->previous[ch][p->pos].out_low = out_low;
-        p->previous[ch][p->pos + N].out_high = p->previous[ch][p->pos].out_high = out_high;
+        p->previous[ch][pos + N].in = p->previous[ch][pos].in = *ibuf++;
+        p->previous[ch][pos + N].out_low = p->previous[ch][pos].out_low = out_low;
+        p->previous[ch][pos + N].out_high = p->previous[ch][pos].out_high = out_high;
     }
+
+    p->pos[ch] = pos;
 }
 
-static int mcompand_channel(MCompandContext *c, CompBand *l, double *ibuf, double *obuf, int len, int ch)
+static int mcompand_channel(MCompandContext *c, CompBand *l, const double *ibuf, double *obuf, int len, int ch)
 {
     int i;
 
     for (i = 0; i < len; i++) {
+        const double in = ibuf[i];
         double level_in_lin, level_out_lin, checkbuf;
         /* Maintain the volume fields by simulating a leaky pump circuit */
-        update_volume(l, fabs(ibuf[i]), ch);
+        update_volume(l, fabs(in), ch);
 
         /* Volume memory is updated: perform compand */
         level_in_lin = l->volume[ch];
         level_out_lin = get_volume(&l->transfer_fn, level_in_lin);
 
         if (c->delay_buf_size <= 0) {
-            checkbuf = ibuf[i] * level_out_lin;
+            checkbuf = in * level_out_lin;
             obuf[i] = checkbuf;
         } else {
             double *delay_buf = (double *)l->delay_buf->extended_data[ch];
+            ptrdiff_t *delay_buf_ptr = &l->delay_buf_ptr[ch];
+            size_t *delay_buf_cnt = &l->delay_buf_cnt[ch];
 
             /* FIXME: note that this lookahead algorithm is really lame:
                the response to a peak is released before the peak
@@ -529,21 +543,105 @@ static int mcompand_channel(MCompandContext *c, CompBand *l, double *ibuf, doubl
                vol to, is a constant equal to the difference between this
                band's delay and the longest delay of all the bands. */
 
-            if (l->delay_buf_cnt >= l->delay_size) {
+            if (*delay_buf_cnt >= l->delay_size) {
                 checkbuf =
-                    delay_buf[(l->delay_buf_ptr +
+                    delay_buf[(*delay_buf_ptr +
                                c->delay_buf_size -
                                l->delay_size) % c->delay_buf_size] * level_out_lin;
-                delay_buf[(l->delay_buf_ptr + c->delay_buf_size -
+                delay_buf[(*delay_buf_ptr + c->delay_buf_size -
                            l->delay_size) % c->delay_buf_size] = checkbuf;
             }
-            if (l->delay_buf_cnt >= c->delay_buf_size) {
-                obuf[i] = delay_buf[l->delay_buf_ptr];
+            if (*delay_buf_cnt >= c->delay_buf_size) {
+                obuf[i] = delay_buf[*delay_buf_ptr];
             } else {
-                l->delay_buf_cnt++;
+                obuf[i] = 0.0;
+                (*delay_buf_cnt)++;
             }
-            delay_buf[l->delay_buf_ptr++] = ibuf[i];
-            l->delay_buf_ptr %= c->delay_buf_size;
+            delay_buf[(*delay_buf_ptr)++] = in;
+            *delay_buf_ptr %= c->delay_buf_size;
+        }
+    }
+
+    return 0;
+}
+
+typedef struct ThreadData {
+    AVFrame *in, *out;
+} ThreadData;
+
+static int crossover_channels(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    MCompandContext *s = ctx->priv;
+    ThreadData *td = arg;
+    AVFrame *in = td->in;
+    const int nb_samples = in->nb_samples;
+    const int nb_channels = in->ch_layout.nb_channels;
+    const int start = (nb_channels * jobnr) / nb_jobs;
+    const int end = (nb_channels * (jobnr+1)) / nb_jobs;
+
+    for (int ch = start; ch < end; ch++) {
+        const double *src = (const double *)in->extended_data[ch];
+
+        for (int band = 0; band < s->nb_bands; band++) {
+            CompBand *b = &s->bands[band];
+            AVFrame *hbuf = band & 1 ? s->band_buf2 : s->band_buf1;
+            double *low = (double *)b->band_buf->extended_data[ch];
+            double *high = (double *)hbuf->extended_data[ch];
+
+            if (!src) {
+                memset(low, 0, nb_samples * sizeof(*low));
+            } else if (b->topfreq) {
+                crossover(ch, &b->filter, src, low, high, nb_samples);
+                src = high;
+            } else {
+                memcpy(low, src, nb_samples * sizeof(*low));
+                src = NULL;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int compand_bands(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    MCompandContext *s = ctx->priv;
+    ThreadData *td = arg;
+    AVFrame *in = td->in;
+    const int nb_channels = in->ch_layout.nb_channels;
+    const int nb_items = s->nb_bands * nb_channels;
+    const int start = (nb_items * jobnr) / nb_jobs;
+    const int end = (nb_items * (jobnr+1)) / nb_jobs;
+
+    for (int n = start; n < end; n++) {
+        const int ch = n % nb_channels;
+        CompBand *b = &s->bands[n / nb_channels];
+        double *buf = (double *)b->band_buf->extended_data[ch];
+
+        mcompand_channel(s, b, buf, buf, in->nb_samples, ch);
+    }
+
+    return 0;
+}
+
+static int mix_channels(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    MCompandContext *s = ctx->priv;
+    ThreadData *td = arg;
+    AVFrame *out = td->out;
+    const int nb_samples = out->nb_samples;
+    const int nb_channels = out->ch_layout.nb_channels;
+    const int start = (nb_channels * jobnr) / nb_jobs;
+    const int end = (nb_channels * (jobnr+1)) / nb_jobs;
+
+    for (int ch = start; ch < end; ch++) {
+        double *dst = (double *)out->extended_data[ch];
+
+        for (int band = 0; band < s->nb_bands; band++) {
+            const double *a = (const double *)s->bands[band].band_buf->extended_data[ch];
+
+            for (int i = 0; i < nb_samples; i++)
+                dst[i] += a[i];
         }
     }
 
@@ -555,8 +653,10 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     AVFilterContext  *ctx = inlink->dst;
     AVFilterLink *outlink = ctx->outputs[0];
     MCompandContext *s    = ctx->priv;
-    AVFrame *out, *abuf, *bbuf, *cbuf;
-    int ch, band, i;
+    const int nb_channels = outlink->ch_layout.nb_channels;
+    const int nb_threads = ff_filter_get_nb_threads(ctx);
+    ThreadData td;
+    AVFrame *out;
 
     out = ff_get_audio_buffer(outlink, in->nb_samples);
     if (!out) {
@@ -567,43 +667,40 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     if (s->band_samples < in->nb_samples) {
         av_frame_free(&s->band_buf1);
         av_frame_free(&s->band_buf2);
-        av_frame_free(&s->band_buf3);
 
         s->band_buf1 = ff_get_audio_buffer(outlink, in->nb_samples);
         s->band_buf2 = ff_get_audio_buffer(outlink, in->nb_samples);
-        s->band_buf3 = ff_get_audio_buffer(outlink, in->nb_samples);
-        s->band_samples = in->nb_samples;
-    }
-
-    for (ch = 0; ch < outlink->ch_layout.nb_channels; ch++) {
-        double *a, *dst = (double *)out->extended_data[ch];
+        if (!s->band_buf1 || !s->band_buf2)
+            goto fail;
 
-        for (band = 0, abuf = in, bbuf = s->band_buf2, cbuf = s->band_buf1; band < s->nb_bands; band++) {
+        for (int band = 0; band < s->nb_bands; band++) {
             CompBand *b = &s->bands[band];
 
-            if (b->topfreq) {
-                crossover(ch, &b->filter, (double *)abuf->extended_data[ch],
-                          (double *)bbuf->extended_data[ch], (double *)cbuf->extended_data[ch], in->nb_samples);
-            } else {
-                bbuf = abuf;
-                abuf = cbuf;
-            }
-
-            if (abuf == in)
-                abuf = s->band_buf3;
-            mcompand_channel(s, b, (double *)bbuf->extended_data[ch], (double *)abuf->extended_data[ch], out->nb_samples, ch);
-            a = (double *)abuf->extended_data[ch];
-            for (i = 0; i < out->nb_samples; i++) {
-                dst[i] += a[i];
-            }
-
-            FFSWAP(AVFrame *, abuf, cbuf);
+            av_frame_free(&b->band_buf);
+            b->band_buf = ff_get_audio_buffer(outlink, in->nb_samples);
+            if (!b->band_buf)
+                goto fail;
         }
+        s->band_samples = in->nb_samples;
     }
 
+    td.in = in;
+    td.out = out;
+    ff_filter_execute(ctx, crossover_channels, &td, NULL,
+                      FFMIN(nb_channels, nb_threads));
+    ff_filter_execute(ctx, compand_bands, &td, NULL,
+                      FFMIN(nb_channels * s->nb_bands, nb_threads));
+    ff_filter_execute(ctx, mix_channels, &td, NULL,
+                      FFMIN(nb_channels, nb_threads));
+
     out->pts = in->pts;
     av_frame_free(&in);
     return ff_filter_frame(outlink, out);
+fail:
+    s->band_samples = 0;
+    av_frame_free(&in);
+    av_frame_free(&out);
+    return AVERROR(ENOMEM);
 }
 
 static int request_frame(AVFilterLink *outlink)
@@ -644,4 +741,5 @@ const AVFilter ff_af_mcompand = {
     FILTER_INPUTS(mcompand_inputs),
     FILTER_OUTPUTS(mcompand_outputs),
     FILTER_SINGLE_SAMPLEFMT(AV_SAMPLE_FMT_DBLP),
+    .flags          = AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -28,22 +28,66 @@
 #include <math.h>
 #include <mysofa.h>
 
-#include "libavutil/cpu.h"
 #include "libavutil/mem.h"
 #include "libavutil/tx.h"
 #include "libavutil/channel_layout.h"
+#include "libavutil/cpu.h"
 #include "libavutil/float_dsp.h"
 #include "libavutil/intmath.h"
 #include "libavutil/opt.h"
+#include "libavutil/thread.h"
 #include "avfilter.h"
 #include "filters.h"
 #include "formats.h"
 #include "audio.h"
+#include "hrtfconv.h"
 
 #define TIME_DOMAIN      0
 #define FREQUENCY_DOMAIN 1
 
+/* parameters the prepared IR data depends on, compared with memcmp() */
+typedef struct SOFATablesKey {
+    int type;
+    int sample_rate;
+    int framesize;
+    int n_conv;
+    int azim, elev;
+    float radius;
+    float gain;
+    float speaker_azim[64];
+    float speaker_elev[64];
+} SOFATablesKey;
+
+typedef struct SOFATables {  /* IRs prepared for one configuration, read-only */
+    struct SOFATables *next;
+    unsigned refcount;
+    SOFATablesKey key;
+    int max_delay;
+    int *delay[2];
+    float *data_ir[2];
+    AVComplexFloat *data_hrtf[2];
+} SOFATables;
+
+typedef struct SOFACache {  /* one loaded SOFA file, shared between instances */
+    struct SOFACache *next;
+    unsigned refcount;
+    char *filename;
+    int normalize;
+    int minphase;
+    int interpolate;
+    float anglestep;
+    float radstep;
+    struct MYSOFA_HRTF *hrtf;
+    struct MYSOFA_LOOKUP *lookup;
+    struct MYSOFA_NEIGHBORHOOD *neighborhood;
+    SOFATables *tables;
+} SOFACache;
+
+static AVMutex sofa_cache_lock = AV_MUTEX_INITIALIZER;
+static SOFACache *sofa_cache;
+
 typedef struct MySofa {  /* contains data of one SOFA file */
+    SOFACache *cache;
     struct MYSOFA_HRTF *hrtf;
     struct MYSOFA_LOOKUP *lookup;
     struct MYSOFA_NEIGHBORHOOD *neighborhood;
@@ -86,6 +130,8 @@ typedef struct SOFAlizerContext {
     int n_tx;                   /* number of samples in one TX block */
     int atx_len;
     int nb_samples;
+    int tail;                   /* silent input samples left until the */
+                                /* ringbuffers are all zero again */
 
                                 /* netCDF variables */
     int *delay[2];              /* broadband delay for each channel/IR to be convolved */
@@ -93,9 +139,6 @@ typedef struct SOFAlizerContext {
     float *data_ir[2];          /* IRs for all channels to be convolved */
                                 /* (this excludes the LFE) */
     float *temp_src[2];
-    float *in_tx[2];            /* Array to hold input TX values */
-    AVComplexFloat *out_tx[2];  /* Array to hold output TX values */
-    AVComplexFloat *temp_atx[2];   /* Array to accumulate TX values prior to ITX */
 
                          /* control variables */
     float gain;          /* filter gain (in dB) */
@@ -112,73 +155,197 @@ typedef struct SOFAlizerContext {
 
     VirtualSpeaker vspkrpos[64];
 
-    AVTXContext *tx_ctx[2], *itx_ctx[2];
-    av_tx_fn tx_fn[2], itx_fn[2];
+    SOFATables *tables;         /* shared IR data in use */
+    HRTFConvContext conv;       /* batched convolution of all speakers */
     AVComplexFloat *data_hrtf[2];
+    const void *conv_src[64];
+    int conv_offset[64];
 
     AVFloatDSPContext *fdsp;
 } SOFAlizerContext;
 
-static int close_sofa(struct MySofa *sofa)
+static void free_sofa_cache(SOFACache *c)
 {
-    if (sofa->neighborhood)
-        mysofa_neighborhood_free(sofa->neighborhood);
-    sofa->neighborhood = NULL;
-    if (sofa->lookup)
-        mysofa_lookup_free(sofa->lookup);
-    sofa->lookup = NULL;
-    if (sofa->hrtf)
-        mysofa_free(sofa->hrtf);
-    sofa->hrtf = NULL;
+    if (c->neighborhood)
+        mysofa_neighborhood_free(c->neighborhood);
+    if (c->lookup)
+        mysofa_lookup_free(c->lookup);
+    if (c->hrtf)
+        mysofa_free(c->hrtf);
+    av_freep(&c->filename);
+    av_free(c);
+}
+
+static void free_sofa_tables(SOFATables *t)
+{
+    for (int i = 0; i < 2; i++) {
+        av_freep(&t->delay[i]);
+        av_freep(&t->data_ir[i]);
+        av_freep(&t->data_hrtf[i]);
+    }
+    av_free(t);
+}
+
+/* must be called with sofa_cache_lock held */
+static void release_tables(SOFAlizerContext *s)
+{
+    SOFATables **t;
+
+    if (!s->tables)
+        return;
+
+    for (t = &s->sofa.cache->tables; *t; t = &(*t)->next) {
+        if (*t == s->tables) {
+            if (!--(*t)->refcount) {
+                *t = s->tables->next;
+                free_sofa_tables(s->tables);
+            }
+            break;
+        }
+    }
+
+    s->tables = NULL;
+    s->delay[0] = s->delay[1] = NULL;
+    s->data_ir[0] = s->data_ir[1] = NULL;
+    s->data_hrtf[0] = s->data_hrtf[1] = NULL;
+}
+
+static void close_sofa(SOFAlizerContext *s)
+{
+    struct MySofa *sofa = &s->sofa;
+
     av_freep(&sofa->fir);
+    if (!sofa->cache)
+        return;
 
-    return 0;
+    ff_mutex_lock(&sofa_cache_lock);
+    release_tables(s);
+    if (!--sofa->cache->refcount) {
+        for (SOFACache **c = &sofa_cache; *c; c = &(*c)->next) {
+            if (*c == sofa->cache) {
+                *c = sofa->cache->next;
+                break;
+            }
+        }
+        free_sofa_cache(sofa->cache);
+    }
+    ff_mutex_unlock(&sofa_cache_lock);
+
+    sofa->cache = NULL;
+    sofa->hrtf = NULL;
+    sofa->lookup = NULL;
+    sofa->neighborhood = NULL;
 }
 
-static int preload_sofa(AVFilterContext *ctx, char *filename, int *samplingrate)
+static int load_sofa(AVFilterContext *ctx, const char *filename, SOFACache **pc)
 {
     struct SOFAlizerContext *s = ctx->priv;
     struct MYSOFA_HRTF *mysofa;
-    char *license;
+    SOFACache *c;
     int ret;
 
+    c = av_mallocz(sizeof(*c));
+    if (!c)
+        return AVERROR(ENOMEM);
+
+    c->filename    = av_strdup(filename);
+    c->normalize   = s->normalize;
+    c->minphase    = s->minphase;
+    c->interpolate = s->interpolate;
+    c->anglestep   = s->anglestep;
+    c->radstep     = s->radstep;
+    if (!c->filename) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+
     mysofa = mysofa_load(filename, &ret);
-    s->sofa.hrtf = mysofa;
+    c->hrtf = mysofa;
     if (ret || !mysofa) {
         av_log(ctx, AV_LOG_ERROR, "Can't find SOFA-file '%s'\n", filename);
-        return AVERROR(EINVAL);
+        ret = AVERROR(EINVAL);
+        goto fail;
     }
 
     ret = mysofa_check(mysofa);
     if (ret != MYSOFA_OK) {
         av_log(ctx, AV_LOG_ERROR, "Selected SOFA file is invalid. Please select valid SOFA file.\n");
-        return ret;
+        ret = AVERROR_INVALIDDATA;
+        goto fail;
     }
 
-    if (s->normalize)
-        mysofa_loudness(s->sofa.hrtf);
+    if (mysofa->DataSamplingRate.elements != 1) {
+        ret = AVERROR(EINVAL);
+        goto fail;
+    }
 
-    if (s->minphase)
-        mysofa_minphase(s->sofa.hrtf, 0.01f);
+    if (c->normalize)
+        mysofa_loudness(mysofa);
 
-    mysofa_tocartesian(s->sofa.hrtf);
+    if (c->minphase)
+        mysofa_minphase(mysofa, 0.01f);
 
-    s->sofa.lookup = mysofa_lookup_init(s->sofa.hrtf);
-    if (s->sofa.lookup == NULL)
-        return AVERROR(EINVAL);
+    mysofa_tocartesian(mysofa);
+
+    c->lookup = mysofa_lookup_init(mysofa);
+    if (c->lookup == NULL) {
+        ret = AVERROR(EINVAL);
+        goto fail;
+    }
+
+    if (c->interpolate)
+        c->neighborhood = mysofa_neighborhood_init_withstepdefine(mysofa,
+                                                                  c->lookup,
+                                                                  c->anglestep,
+                                                                  c->radstep);
 
-    if (s->interpolate)
-        s->sofa.neighborhood = mysofa_neighborhood_init_withstepdefine(s->sofa.hrtf,
-                                                                       s->sofa.lookup,
-                                                                       s->anglestep,
-                                                                       s->radstep);
+    *pc = c;
+    return 0;
+fail:
+    free_sofa_cache(c);
+    return ret;
+}
+
+static int preload_sofa(AVFilterContext *ctx, char *filename, int *samplingrate)
+{
+    struct SOFAlizerContext *s = ctx->priv;
+    struct MYSOFA_HRTF *mysofa;
+    SOFACache *c;
+    char *license;
+    int ret = 0;
+
+    /* loading and preprocessing a SOFA file is slow and its data is never
+     * modified afterwards, so it is shared by all instances using it */
+    ff_mutex_lock(&sofa_cache_lock);
+    for (c = sofa_cache; c; c = c->next) {
+        if (!strcmp(c->filename, filename) &&
+            c->normalize   == s->normalize &&
+            c->minphase    == s->minphase &&
+            c->interpolate == s->interpolate &&
+            c->anglestep   == s->anglestep &&
+            c->radstep     == s->radstep)
+            break;
+    }
+    if (c) {
+        c->refcount++;
+    } else if ((ret = load_sofa(ctx, filename, &c)) >= 0) {
+        c->refcount = 1;
+        c->next = sofa_cache;
+        sofa_cache = c;
+    }
+    ff_mutex_unlock(&sofa_cache_lock);
+    if (ret < 0)
+        return ret;
+
+    s->sofa.cache = c;
+    s->sofa.hrtf = mysofa = c->hrtf;
+    s->sofa.lookup = c->lookup;
+    s->sofa.neighborhood = c->neighborhood;
 
     s->sofa.fir = av_calloc(s->sofa.hrtf->N * s->sofa.hrtf->R, sizeof(*s->sofa.fir));
     if (!s->sofa.fir)
         return AVERROR(ENOMEM);
 
-    if (mysofa->DataSamplingRate.elements != 1)
-        return AVERROR(EINVAL);
     av_log(ctx, AV_LOG_DEBUG, "Original IR length: %d.\n", mysofa->N);
     *samplingrate = mysofa->DataSamplingRate.values[0];
     license = mysofa_getAttribute(mysofa->attributes, (char *)"License");
@@ -321,9 +488,6 @@ typedef struct ThreadData {
     int *n_clippings;
     float **ringbuffer;
     float **temp_src;
-    float **in_tx;
-    AVComplexFloat **out_tx;
-    AVComplexFloat **temp_atx;
 } ThreadData;
 
 static int sofalizer_convolute(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
@@ -433,7 +597,6 @@ static int sofalizer_fast_convolute(AVFilterContext *ctx, void *arg, int jobnr,
     AVFrame *in = td->in, *out = td->out;
     int offset = jobnr;
     int *write = &td->write[jobnr];
-    AVComplexFloat *hrtf = s->data_hrtf[jobnr]; /* get pointers to current HRTF data */
     int *n_clippings = &td->n_clippings[jobnr];
     float *ringbuffer = td->ringbuffer[jobnr];
     const int ir_samples = s->sofa.ir_samples; /* length of one IR */
@@ -445,18 +608,10 @@ static int sofalizer_fast_convolute(AVFilterContext *ctx, void *arg, int jobnr,
     const int buffer_length = s->buffer_length;
     /* -1 for AND instead of MODULO (applied to powers of 2): */
     const uint32_t modulo = (uint32_t)buffer_length - 1;
-    float *tx_in = s->in_tx[jobnr]; /* temporary array for TX input data */
-    AVComplexFloat *tx_out = s->out_tx[jobnr]; /* temporary array for TX output data */
-    AVComplexFloat *tx_acc = s->temp_atx[jobnr];
-    AVTXContext *itx_ctx = s->itx_ctx[jobnr];
-    av_tx_fn itx_fn = s->itx_fn[jobnr];
-    AVTXContext *tx_ctx = s->tx_ctx[jobnr];
-    av_tx_fn tx_fn = s->tx_fn[jobnr];
+    /* output of the batched convolution for this ear */
+    const float *conv_out = s->conv.out[jobnr];
     const int nb_samples = in->nb_samples;
     const float gain_lfe = s->gain_lfe;
-    const int n_conv = s->n_conv;
-    const int n_tx = s->n_tx;
-    AVComplexFloat *hrtf_offset;
     int wr = *write;
     int n_read;
     int i, j;
@@ -479,77 +634,33 @@ static int sofalizer_fast_convolute(AVFilterContext *ctx, void *arg, int jobnr,
     for (j = n_read; j < nb_samples; j++)
         dst[mult * j] = 0;
 
-    /* fill TX accumulation with 0 */
-    memset(tx_acc, 0, sizeof(AVComplexFloat) * (n_tx/2+1));
-
-    for (i = 0; i < n_conv; i++) {
-        const float *src = (const float *)in->extended_data[i * planar]; /* get pointer to audio input buffer */
-
-        if (i == s->lfe_channel) { /* LFE */
-            if (!planar) {
-                for (j = 0; j < nb_samples; j++) {
-                    /* apply gain to LFE signal and add to output buffer */
-                    dst[2 * j] += src[i + j * in_channels] * gain_lfe;
-                }
-            } else {
-                for (j = 0; j < nb_samples; j++) {
-                    /* apply gain to LFE signal and add to output buffer */
-                    dst[j] += src[j] * gain_lfe;
-                }
-            }
-            continue;
-        }
-
-        /* outer loop: go through all input channels to be convolved */
-        offset = i * s->atx_len;
-        hrtf_offset = hrtf + offset;
-
-        /* fill TX input with 0 (we want to zero-pad) */
-        memset(tx_in, 0, sizeof(*tx_in) * n_tx);
+    if (s->lfe_channel >= 0) { /* LFE */
+        const float *src = (const float *)in->extended_data[s->lfe_channel * planar];
 
+        i = s->lfe_channel;
         if (!planar) {
             for (j = 0; j < nb_samples; j++) {
-                /* prepare input for TX */
-                /* write all samples of current input channel to TX input array */
-                tx_in[j] = src[j * in_channels + i];
+                /* apply gain to LFE signal and add to output buffer */
+                dst[2 * j] += src[i + j * in_channels] * gain_lfe;
             }
         } else {
             for (j = 0; j < nb_samples; j++) {
-                /* prepare input for TX */
-                /* write all samples of current input channel to TX input array */
-                tx_in[j] = src[j];
+                /* apply gain to LFE signal and add to output buffer */
+                dst[j] += src[j] * gain_lfe;
             }
         }
-
-        /* transform input signal of current channel to frequency domain */
-        tx_fn(tx_ctx, tx_out, tx_in, sizeof(*tx_in));
-
-        for (j = 0; j < n_tx/2+1; j++) {
-            const AVComplexFloat *hcomplex = hrtf_offset + j;
-            const float re = tx_out[j].re;
-            const float im = tx_out[j].im;
-
-            /* complex multiplication of input signal and HRTFs */
-            /* output channel (real): */
-            tx_acc[j].re += re * hcomplex->re - im * hcomplex->im;
-            /* output channel (imag): */
-            tx_acc[j].im += re * hcomplex->im + im * hcomplex->re;
-        }
     }
 
-    /* transform output signal of current channel back to time domain */
-    itx_fn(itx_ctx, tx_in, tx_acc, sizeof(*tx_acc));
-
     for (j = 0; j < nb_samples; j++) {
         /* write output signal of current channel to output buffer */
-        dst[mult * j] += tx_in[j];
+        dst[mult * j] += conv_out[j];
     }
 
     for (j = 0; j < ir_samples - 1; j++) { /* overflow length is IR length - 1 */
         /* write the rest of output signal to overflow buffer */
         int write_pos = (wr + j) & modulo;
 
-        *(ringbuffer + write_pos) += tx_in[nb_samples + j];
+        *(ringbuffer + write_pos) += conv_out[nb_samples + j];
     }
 
     /* go through all samples of current output buffer: count clippings */
@@ -582,16 +693,41 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     }
     av_frame_copy_props(out, in);
 
+    /* convolution is linear: silent input with decayed state gives silence */
+    if (ff_audio_frame_is_silent(in)) {
+        if (!s->tail) {
+            av_samples_set_silence(out->extended_data, 0, out->nb_samples,
+                                   out->ch_layout.nb_channels, out->format);
+            av_frame_free(&in);
+            return ff_filter_frame(outlink, out);
+        }
+        s->tail = FFMAX(s->tail - in->nb_samples, 0);
+    } else {
+        s->tail = s->buffer_length;
+    }
+
     td.in = in; td.out = out; td.write = s->write;
     td.delay = s->delay; td.ir = s->data_ir; td.n_clippings = n_clippings;
     td.ringbuffer = s->ringbuffer; td.temp_src = s->temp_src;
-    td.in_tx = s->in_tx;
-    td.out_tx = s->out_tx;
-    td.temp_atx = s->temp_atx;
 
     if (s->type == TIME_DOMAIN) {
         ff_filter_execute(ctx, sofalizer_convolute, &td, NULL, 2);
     } else if (s->type == FREQUENCY_DOMAIN) {
+        const int planar = in->format == AV_SAMPLE_FMT_FLTP;
+        int nb_src = 0;
+
+        for (int i = 0; i < s->n_conv; i++) {
+            if (i == s->lfe_channel)
+                continue;
+            s->conv_src[nb_src] = planar ? (const float *)in->extended_data[i]
+                                         : (const float *)in->data[0] + i;
+            s->conv_offset[nb_src] = i * s->atx_len;
+            nb_src++;
+        }
+
+        ff_hrtfconv_execute(ctx, &s->conv, s->conv_src, planar ? 1 : s->n_conv,
+                            nb_src, in->nb_samples,
+                            (const void *const *)s->data_hrtf, s->conv_offset);
         ff_filter_execute(ctx, sofalizer_fast_convolute, &td, NULL, 2);
     }
 
@@ -711,52 +847,49 @@ static int getfilter_float(AVFilterContext *ctx, float x, float y, float z,
     return 0;
 }
 
-static int load_data(AVFilterContext *ctx, int azim, int elev, float radius, int sample_rate)
+/* prepare the IRs (and HRTFs) of all speakers, must be called with sofa_cache_lock held */
+static int build_tables(AVFilterContext *ctx, const SOFATablesKey *key, SOFATables **pt)
 {
     struct SOFAlizerContext *s = ctx->priv;
-    int n_samples;
-    int ir_samples;
-    int n_conv = s->n_conv; /* no. channels to convolve */
-    int n_tx;
+    const int n_samples = s->sofa.n_samples;
+    const int ir_samples = s->sofa.ir_samples;
+    const int n_conv = key->n_conv; /* no. channels to convolve */
+    const int sample_rate = key->sample_rate;
+    float gain_lin = expf((key->gain - 3 * n_conv) / 20 * M_LN10); /* gain - 3dB/channel */
     float delay_l; /* broadband delay for each IR */
     float delay_r;
-    int nb_input_channels = ctx->inputs[0]->ch_layout.nb_channels; /* no. input channels */
-    float gain_lin = expf((s->gain - 3 * nb_input_channels) / 20 * M_LN10); /* gain - 3dB/channel */
-    AVComplexFloat *data_hrtf_l = NULL;
-    AVComplexFloat *data_hrtf_r = NULL;
+    AVTXContext *tx_ctx = NULL;
+    av_tx_fn tx_fn;
     AVComplexFloat *tx_out_l = NULL;
     AVComplexFloat *tx_out_r = NULL;
     float *tx_in_l = NULL;
     float *tx_in_r = NULL;
     float *data_ir_l = NULL;
     float *data_ir_r = NULL;
+    SOFATables *t;
     int offset = 0; /* used for faster pointer arithmetics in for-loop */
-    int i, j, azim_orig = azim, elev_orig = elev;
+    int i, j, n_tx, atx_len;
     int ret = 0;
-    int n_current;
-    int n_max = 0;
 
-    av_log(ctx, AV_LOG_DEBUG, "IR length: %d.\n", s->sofa.hrtf->N);
-    s->sofa.ir_samples = s->sofa.hrtf->N;
-    s->sofa.n_samples = 1 << (32 - ff_clz(s->sofa.ir_samples));
-
-    n_samples = s->sofa.n_samples;
-    ir_samples = s->sofa.ir_samples;
+    t = av_mallocz(sizeof(*t));
+    if (!t)
+        return AVERROR(ENOMEM);
+    t->key = *key;
 
-    if (s->type == TIME_DOMAIN) {
-        s->data_ir[0] = av_calloc(n_samples, sizeof(float) * s->n_conv);
-        s->data_ir[1] = av_calloc(n_samples, sizeof(float) * s->n_conv);
+    if (key->type == TIME_DOMAIN) {
+        t->data_ir[0] = av_calloc(n_samples, sizeof(float) * n_conv);
+        t->data_ir[1] = av_calloc(n_samples, sizeof(float) * n_conv);
 
-        if (!s->data_ir[0] || !s->data_ir[1]) {
+        if (!t->data_ir[0] || !t->data_ir[1]) {
             ret = AVERROR(ENOMEM);
             goto fail;
         }
     }
 
-    s->delay[0] = av_calloc(s->n_conv, sizeof(int));
-    s->delay[1] = av_calloc(s->n_conv, sizeof(int));
+    t->delay[0] = av_calloc(n_conv, sizeof(int));
+    t->delay[1] = av_calloc(n_conv, sizeof(int));
 
-    if (!s->delay[0] || !s->delay[1]) {
+    if (!t->delay[0] || !t->delay[1]) {
         ret = AVERROR(ENOMEM);
         goto fail;
     }
@@ -769,38 +902,13 @@ static int load_data(AVFilterContext *ctx, int azim, int elev, float radius, int
         goto fail;
     }
 
-    if (s->type == TIME_DOMAIN) {
-        s->temp_src[0] = av_calloc(n_samples, sizeof(float));
-        s->temp_src[1] = av_calloc(n_samples, sizeof(float));
-        if (!s->temp_src[0] || !s->temp_src[1]) {
-            ret = AVERROR(ENOMEM);
-            goto fail;
-        }
-    }
-
-    s->speaker_azim = av_calloc(s->n_conv, sizeof(*s->speaker_azim));
-    s->speaker_elev = av_calloc(s->n_conv, sizeof(*s->speaker_elev));
-    if (!s->speaker_azim || !s->speaker_elev) {
-        ret = AVERROR(ENOMEM);
-        goto fail;
-    }
-
-    /* get speaker positions */
-    if ((ret = get_speaker_pos(ctx, s->speaker_azim, s->speaker_elev)) < 0) {
-        av_log(ctx, AV_LOG_ERROR, "Couldn't get speaker positions. Input channel configuration not supported.\n");
-        goto fail;
-    }
-
-    for (i = 0; i < s->n_conv; i++) {
+    for (i = 0; i < n_conv; i++) {
         float coordinates[3];
 
         /* load and store IRs and corresponding delays */
-        azim = (int)(s->speaker_azim[i] + azim_orig) % 360;
-        elev = (int)(s->speaker_elev[i] + elev_orig) % 90;
-
-        coordinates[0] = azim;
-        coordinates[1] = elev;
-        coordinates[2] = radius;
+        coordinates[0] = (int)(key->speaker_azim[i] + key->azim) % 360;
+        coordinates[1] = (int)(key->speaker_elev[i] + key->elev) % 90;
+        coordinates[2] = key->radius;
 
         mysofa_s2c(coordinates);
 
@@ -812,94 +920,37 @@ static int load_data(AVFilterContext *ctx, int azim, int elev, float radius, int
         if (ret < 0)
             goto fail;
 
-        s->delay[0][i] = delay_l * sample_rate;
-        s->delay[1][i] = delay_r * sample_rate;
+        t->delay[0][i] = delay_l * sample_rate;
+        t->delay[1][i] = delay_r * sample_rate;
 
-        s->sofa.max_delay = FFMAX3(s->sofa.max_delay, s->delay[0][i], s->delay[1][i]);
+        t->max_delay = FFMAX3(t->max_delay, t->delay[0][i], t->delay[1][i]);
     }
 
-    /* get size of ringbuffer (longest IR plus max. delay) */
-    /* then choose next power of 2 for performance optimization */
-    n_current = n_samples + s->sofa.max_delay;
-    /* length of longest IR plus max. delay */
-    n_max = FFMAX(n_max, n_current);
+    n_tx = 1 << (32 - ff_clz(n_samples + t->max_delay + key->framesize));
+    atx_len = FFALIGN(n_tx/2+1, av_cpu_max_align());
 
-    /* buffer length is longest IR plus max. delay -> next power of 2
-       (32 - count leading zeros gives required exponent)  */
-    s->buffer_length = 1 << (32 - ff_clz(n_max));
-    s->n_tx = n_tx = 1 << (32 - ff_clz(n_max + s->framesize));
-
-    if (s->type == FREQUENCY_DOMAIN) {
-        const size_t cpu_align = av_cpu_max_align();
-        float iscale = 1.f / s->n_tx;
+    if (key->type == FREQUENCY_DOMAIN) {
         float scale = 1.f;
 
-        s->atx_len = FFALIGN(n_tx/2+1, cpu_align);
-
-        av_tx_uninit(&s->tx_ctx[0]);
-        av_tx_uninit(&s->tx_ctx[1]);
-        ret = av_tx_init(&s->tx_ctx[0], &s->tx_fn[0], AV_TX_FLOAT_RDFT, 0, s->n_tx, &scale, 0);
-        if (ret < 0)
-            goto fail;
-        ret = av_tx_init(&s->tx_ctx[1], &s->tx_fn[1], AV_TX_FLOAT_RDFT, 0, s->n_tx, &scale, 0);
-        if (ret < 0)
-            goto fail;
-        av_tx_uninit(&s->itx_ctx[0]);
-        av_tx_uninit(&s->itx_ctx[1]);
-        ret = av_tx_init(&s->itx_ctx[0], &s->itx_fn[0], AV_TX_FLOAT_RDFT, 1, s->n_tx, &iscale, 0);
+        ret = av_tx_init(&tx_ctx, &tx_fn, AV_TX_FLOAT_RDFT, 0, n_tx, &scale, 0);
         if (ret < 0)
             goto fail;
-        ret = av_tx_init(&s->itx_ctx[1], &s->itx_fn[1], AV_TX_FLOAT_RDFT, 1, s->n_tx, &iscale, 0);
-        if (ret < 0)
-            goto fail;
-    }
-
-    if (s->type == TIME_DOMAIN) {
-        s->ringbuffer[0] = av_calloc(s->buffer_length, sizeof(float) * nb_input_channels);
-        s->ringbuffer[1] = av_calloc(s->buffer_length, sizeof(float) * nb_input_channels);
-    } else if (s->type == FREQUENCY_DOMAIN) {
-        /* get temporary HRTF memory for L and R channel */
-        data_hrtf_l = av_malloc_array(n_tx, sizeof(*data_hrtf_l) * n_conv);
-        data_hrtf_r = av_malloc_array(n_tx, sizeof(*data_hrtf_r) * n_conv);
-        if (!data_hrtf_r || !data_hrtf_l) {
-            ret = AVERROR(ENOMEM);
-            goto fail;
-        }
 
-        s->ringbuffer[0] = av_calloc(s->buffer_length, sizeof(float));
-        s->ringbuffer[1] = av_calloc(s->buffer_length, sizeof(float));
-        s->in_tx[0] = av_malloc_array(s->n_tx, sizeof(float));
-        s->in_tx[1] = av_malloc_array(s->n_tx, sizeof(float));
-        s->out_tx[0] = av_malloc_array(s->n_tx, sizeof(AVComplexFloat));
-        s->out_tx[1] = av_malloc_array(s->n_tx, sizeof(AVComplexFloat));
-        s->temp_atx[0] = av_malloc_array(s->n_tx, sizeof(AVComplexFloat));
-        s->temp_atx[1] = av_malloc_array(s->n_tx, sizeof(AVComplexFloat));
-        if (!s->in_tx[0] || !s->in_tx[1] ||
-            !s->out_tx[0] || !s->out_tx[1] ||
-            !s->temp_atx[0] || !s->temp_atx[1]) {
-            ret = AVERROR(ENOMEM);
-            goto fail;
-        }
-    }
-
-    if (!s->ringbuffer[0] || !s->ringbuffer[1]) {
-        ret = AVERROR(ENOMEM);
-        goto fail;
-    }
-
-    if (s->type == FREQUENCY_DOMAIN) {
+        t->data_hrtf[0] = av_malloc_array(n_tx * n_conv, sizeof(AVComplexFloat));
+        t->data_hrtf[1] = av_malloc_array(n_tx * n_conv, sizeof(AVComplexFloat));
         tx_out_l = av_calloc(n_tx, sizeof(*tx_out_l));
         tx_out_r = av_calloc(n_tx, sizeof(*tx_out_r));
         tx_in_l = av_calloc(n_tx, sizeof(*tx_in_l));
         tx_in_r = av_calloc(n_tx, sizeof(*tx_in_r));
-        if (!tx_in_l || !tx_in_r ||
+        if (!t->data_hrtf[0] || !t->data_hrtf[1] ||
+            !tx_in_l || !tx_in_r ||
             !tx_out_l || !tx_out_r) {
             ret = AVERROR(ENOMEM);
             goto fail;
         }
     }
 
-    for (i = 0; i < s->n_conv; i++) {
+    for (i = 0; i < n_conv; i++) {
         float *lir, *rir;
 
         offset = i * n_samples; /* no. samples already written */
@@ -907,52 +958,43 @@ static int load_data(AVFilterContext *ctx, int azim, int elev, float radius, int
         lir = data_ir_l + offset;
         rir = data_ir_r + offset;
 
-        if (s->type == TIME_DOMAIN) {
+        if (key->type == TIME_DOMAIN) {
             for (j = 0; j < ir_samples; j++) {
                 /* load reversed IRs of the specified source position
                  * sample-by-sample for left and right ear; and apply gain */
-                s->data_ir[0][offset + j] = lir[ir_samples - 1 - j] * gain_lin;
-                s->data_ir[1][offset + j] = rir[ir_samples - 1 - j] * gain_lin;
+                t->data_ir[0][offset + j] = lir[ir_samples - 1 - j] * gain_lin;
+                t->data_ir[1][offset + j] = rir[ir_samples - 1 - j] * gain_lin;
             }
-        } else if (s->type == FREQUENCY_DOMAIN) {
+        } else if (key->type == FREQUENCY_DOMAIN) {
             memset(tx_in_l, 0, n_tx * sizeof(*tx_in_l));
             memset(tx_in_r, 0, n_tx * sizeof(*tx_in_r));
 
-            offset = i * s->atx_len;
+            offset = i * atx_len;
             for (j = 0; j < ir_samples; j++) {
                 /* load non-reversed IRs of the specified source position
                  * sample-by-sample and apply gain,
                  * L channel is loaded to real part, R channel to imag part,
                  * IRs are shifted by L and R delay */
-                tx_in_l[s->delay[0][i] + j] = lir[j] * gain_lin;
-                tx_in_r[s->delay[1][i] + j] = rir[j] * gain_lin;
+                tx_in_l[t->delay[0][i] + j] = lir[j] * gain_lin;
+                tx_in_r[t->delay[1][i] + j] = rir[j] * gain_lin;
             }
 
             /* actually transform to frequency domain (IRs -> HRTFs) */
-            s->tx_fn[0](s->tx_ctx[0], tx_out_l, tx_in_l, sizeof(*tx_in_l));
-            memcpy(data_hrtf_l + offset, tx_out_l, (n_tx/2+1) * sizeof(*tx_out_l));
-            s->tx_fn[1](s->tx_ctx[1], tx_out_r, tx_in_r, sizeof(*tx_in_r));
-            memcpy(data_hrtf_r + offset, tx_out_r, (n_tx/2+1) * sizeof(*tx_out_r));
+            tx_fn(tx_ctx, tx_out_l, tx_in_l, sizeof(*tx_in_l));
+            memcpy(t->data_hrtf[0] + offset, tx_out_l, (n_tx/2+1) * sizeof(*tx_out_l));
+            tx_fn(tx_ctx, tx_out_r, tx_in_r, sizeof(*tx_in_r));
+            memcpy(t->data_hrtf[1] + offset, tx_out_r, (n_tx/2+1) * sizeof(*tx_out_r));
         }
     }
 
-    if (s->type == FREQUENCY_DOMAIN) {
-        s->data_hrtf[0] = av_malloc_array(n_tx * s->n_conv, sizeof(AVComplexFloat));
-        s->data_hrtf[1] = av_malloc_array(n_tx * s->n_conv, sizeof(AVComplexFloat));
-        if (!s->data_hrtf[0] || !s->data_hrtf[1]) {
-            ret = AVERROR(ENOMEM);
-            goto fail;
-        }
-
-        memcpy(s->data_hrtf[0], data_hrtf_l, /* copy HRTF data to */
-            sizeof(AVComplexFloat) * n_conv * n_tx); /* filter struct */
-        memcpy(s->data_hrtf[1], data_hrtf_r,
-            sizeof(AVComplexFloat) * n_conv * n_tx);
-    }
+    *pt = t;
+    t = NULL;
 
 fail:
-    av_freep(&data_hrtf_l); /* free temporary HRTF memory */
-    av_freep(&data_hrtf_r);
+    if (t)
+        free_sofa_tables(t);
+
+    av_tx_uninit(&tx_ctx);
 
     av_freep(&data_ir_l); /* free temprary IR memory */
     av_freep(&data_ir_r);
@@ -966,6 +1008,112 @@ fail:
     return ret;
 }
 
+static int load_data(AVFilterContext *ctx, int azim, int elev, float radius, int sample_rate)
+{
+    struct SOFAlizerContext *s = ctx->priv;
+    int n_conv = s->n_conv; /* no. channels to convolve */
+    int nb_input_channels = ctx->inputs[0]->ch_layout.nb_channels; /* no. input channels */
+    SOFATablesKey key;
+    SOFATables *t;
+    int ret = 0;
+    int n_max;
+
+    av_log(ctx, AV_LOG_DEBUG, "IR length: %d.\n", s->sofa.hrtf->N);
+    s->sofa.ir_samples = s->sofa.hrtf->N;
+    s->sofa.n_samples = 1 << (32 - ff_clz(s->sofa.ir_samples));
+
+    av_freep(&s->speaker_azim);
+    av_freep(&s->speaker_elev);
+    s->speaker_azim = av_calloc(s->n_conv, sizeof(*s->speaker_azim));
+    s->speaker_elev = av_calloc(s->n_conv, sizeof(*s->speaker_elev));
+    if (!s->speaker_azim || !s->speaker_elev)
+        return AVERROR(ENOMEM);
+
+    /* get speaker positions */
+    if ((ret = get_speaker_pos(ctx, s->speaker_azim, s->speaker_elev)) < 0) {
+        av_log(ctx, AV_LOG_ERROR, "Couldn't get speaker positions. Input channel configuration not supported.\n");
+        return ret;
+    }
+
+    memset(&key, 0, sizeof(key));
+    key.type        = s->type;
+    key.sample_rate = sample_rate;
+    key.framesize   = s->type == FREQUENCY_DOMAIN ? s->framesize : 0;
+    key.n_conv      = n_conv;
+    key.azim        = azim;
+    key.elev        = elev;
+    key.radius      = radius;
+    key.gain        = s->gain;
+    memcpy(key.speaker_azim, s->speaker_azim, n_conv * sizeof(*key.speaker_azim));
+    memcpy(key.speaker_elev, s->speaker_elev, n_conv * sizeof(*key.speaker_elev));
+
+    /* instances with the same file and configuration share the prepared IRs */
+    ff_mutex_lock(&sofa_cache_lock);
+    release_tables(s);
+    for (t = s->sofa.cache->tables; t; t = t->next) {
+        if (!memcmp(&t->key, &key, sizeof(key)))
+            break;
+    }
+    if (t) {
+        t->refcount++;
+    } else if ((ret = build_tables(ctx, &key, &t)) >= 0) {
+        t->refcount = 1;
+        t->next = s->sofa.cache->tables;
+        s->sofa.cache->tables = t;
+    }
+    ff_mutex_unlock(&sofa_cache_lock);
+    if (ret < 0)
+        return ret;
+
+    s->tables = t;
+    s->delay[0] = t->delay[0];
+    s->delay[1] = t->delay[1];
+    s->data_ir[0] = t->data_ir[0];
+    s->data_ir[1] = t->data_ir[1];
+    s->data_hrtf[0] = t->data_hrtf[0];
+    s->data_hrtf[1] = t->data_hrtf[1];
+    s->sofa.max_delay = t->max_delay;
+
+    /* get size of ringbuffer (longest IR plus max. delay) */
+    /* then choose next power of 2 for performance optimization */
+    n_max = s->sofa.n_samples + s->sofa.max_delay;
+
+    /* buffer length is longest IR plus max. delay -> next power of 2
+       (32 - count leading zeros gives required exponent)  */
+    s->buffer_length = 1 << (32 - ff_clz(n_max));
+    s->n_tx = 1 << (32 - ff_clz(n_max + s->framesize));
+
+    av_freep(&s->ringbuffer[0]);
+    av_freep(&s->ringbuffer[1]);
+    av_freep(&s->temp_src[0]);
+    av_freep(&s->temp_src[1]);
+    s->tail = 0;
+
+    if (s->type == TIME_DOMAIN) {
+        s->temp_src[0] = av_calloc(s->sofa.n_samples, sizeof(float));
+        s->temp_src[1] = av_calloc(s->sofa.n_samples, sizeof(float));
+        if (!s->temp_src[0] || !s->temp_src[1])
+            return AVERROR(ENOMEM);
+
+        s->ringbuffer[0] = av_calloc(s->buffer_length, sizeof(float) * nb_input_channels);
+        s->ringbuffer[1] = av_calloc(s->buffer_length, sizeof(float) * nb_input_channels);
+    } else if (s->type == FREQUENCY_DOMAIN) {
+        ret = ff_hrtfconv_init(ctx, &s->conv, s->n_tx, n_conv, 0);
+        if (ret < 0)
+            return ret;
+
+        s->atx_len = s->conv.atx_len;
+
+        s->ringbuffer[0] = av_calloc(s->buffer_length, sizeof(float));
+        s->ringbuffer[1] = av_calloc(s->buffer_length, sizeof(float));
+    }
+
+    if (!s->ringbuffer[0] || !s->ringbuffer[1])
+        return AVERROR(ENOMEM);
+
+    return 0;
+}
+
 static av_cold int init(AVFilterContext *ctx)
 {
     SOFAlizerContext *s = ctx->priv;
@@ -1001,10 +1149,13 @@ static int config_input(AVFilterLink *inlink)
 {
     AVFilterContext *ctx = inlink->dst;
     SOFAlizerContext *s = ctx->priv;
+    FilterLink *l = ff_filter_link(inlink);
     int ret;
 
-    if (s->type == FREQUENCY_DOMAIN)
+    if (s->type == FREQUENCY_DOMAIN) {
         s->nb_samples = s->framesize;
+        l->min_samples = l->max_samples = s->nb_samples;
+    }
 
     /* gain -3 dB per channel */
     s->gain_lfe = expf((s->gain - 3 * inlink->ch_layout.nb_channels + s->lfe_gain) / 20 * M_LN10);
@@ -1025,29 +1176,15 @@ static av_cold void uninit(AVFilterContext *ctx)
 {
     SOFAlizerContext *s = ctx->priv;
 
-    close_sofa(&s->sofa);
-    av_tx_uninit(&s->itx_ctx[0]);
-    av_tx_uninit(&s->itx_ctx[1]);
-    av_tx_uninit(&s->tx_ctx[0]);
-    av_tx_uninit(&s->tx_ctx[1]);
-    av_freep(&s->delay[0]);
-    av_freep(&s->delay[1]);
-    av_freep(&s->data_ir[0]);
-    av_freep(&s->data_ir[1]);
+    close_sofa(s);
+    ff_hrtfconv_uninit(&s->conv);
     av_freep(&s->ringbuffer[0]);
     av_freep(&s->ringbuffer[1]);
     av_freep(&s->speaker_azim);
     av_freep(&s->speaker_elev);
     av_freep(&s->temp_src[0]);
     av_freep(&s->temp_src[1]);
-    av_freep(&s->temp_atx[0]);
-    av_freep(&s->temp_atx[1]);
-    av_freep(&s->in_tx[0]);
-    av_freep(&s->in_tx[1]);
-    av_freep(&s->out_tx[0]);
-    av_freep(&s->out_tx[1]);
-    av_freep(&s->data_hrtf[0]);
-    av_freep(&s->data_hrtf[1]);
+    s->tail = 0;
     av_freep(&s->fdsp);
 }
 
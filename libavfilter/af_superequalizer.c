@@ -45,11 +45,12 @@ typedef struct SuperEqualizerContext {
     float aa;
     float iza;
     float *ires, *irest;
-    float *fsamples, *fsamples_out;
     int winlen, tabsize;
+    int nb_channels;
 
     AVFrame *in, *out;
-    AVTXContext *rdft, *irdft;
+    AVFrame *fsamples, *fsamples_out;
+    AVTXContext **rdft, **irdft;
     av_tx_fn tx_fn, itx_fn;
 } SuperEqualizerContext;
 
@@ -134,16 +135,7 @@ static void process_param(float *bc, EqParameter *param, float fs)
 
 static int equ_init(SuperEqualizerContext *s, int wb)
 {
-    float scale = 1.f, iscale = 1.f;
-    int i, j, ret;
-
-    ret = av_tx_init(&s->rdft, &s->tx_fn, AV_TX_FLOAT_RDFT, 0, 1 << wb, &scale, 0);
-    if (ret < 0)
-        return ret;
-
-    ret = av_tx_init(&s->irdft, &s->itx_fn, AV_TX_FLOAT_RDFT, 1, 1 << wb, &iscale, 0);
-    if (ret < 0)
-        return ret;
+    int i, j;
 
     s->aa = 96;
     s->winlen = (1 << (wb-1))-1;
@@ -151,9 +143,7 @@ static int equ_init(SuperEqualizerContext *s, int wb)
 
     s->ires     = av_calloc(s->tabsize + 2, sizeof(float));
     s->irest    = av_calloc(s->tabsize, sizeof(float));
-    s->fsamples = av_calloc(s->tabsize, sizeof(float));
-    s->fsamples_out = av_calloc(s->tabsize + 2, sizeof(float));
-    if (!s->ires || !s->irest || !s->fsamples || !s->fsamples_out)
+    if (!s->ires || !s->irest)
         return AVERROR(ENOMEM);
 
     for (i = 0; i <= M; i++) {
@@ -182,38 +172,32 @@ static void make_fir(SuperEqualizerContext *s, float *lbc, float *rbc, EqParamet
     for (; i < tabsize; i++)
         s->irest[i] = 0;
 
-    s->tx_fn(s->rdft, s->ires, s->irest, sizeof(float));
+    s->tx_fn(s->rdft[0], s->ires, s->irest, sizeof(float));
 }
 
-static int filter_frame(AVFilterLink *inlink, AVFrame *in)
+static int filter_channels(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    AVFilterContext *ctx = inlink->dst;
     SuperEqualizerContext *s = ctx->priv;
-    AVFilterLink *outlink = ctx->outputs[0];
+    AVFrame *in = s->in;
+    AVFrame *out = arg;
     const float *ires = s->ires;
-    float *fsamples_out = s->fsamples_out;
-    float *fsamples = s->fsamples;
-    int ch, i;
-
-    AVFrame *out = ff_get_audio_buffer(outlink, in->nb_samples);
-    float *src, *dst, *ptr;
-
-    if (!out) {
-        av_frame_free(&in);
-        return AVERROR(ENOMEM);
-    }
+    const int start = (in->ch_layout.nb_channels * jobnr) / nb_jobs;
+    const int end = (in->ch_layout.nb_channels * (jobnr+1)) / nb_jobs;
+    int i;
 
-    for (ch = 0; ch < in->ch_layout.nb_channels; ch++) {
-        ptr = (float *)out->extended_data[ch];
-        dst = (float *)s->out->extended_data[ch];
-        src = (float *)in->extended_data[ch];
+    for (int ch = start; ch < end; ch++) {
+        float *fsamples_out = (float *)s->fsamples_out->extended_data[ch];
+        float *fsamples = (float *)s->fsamples->extended_data[ch];
+        float *ptr = (float *)out->extended_data[ch];
+        float *dst = (float *)s->out->extended_data[ch];
+        const float *src = (const float *)in->extended_data[ch];
 
         for (i = 0; i < in->nb_samples; i++)
             fsamples[i] = src[i];
         for (; i < s->tabsize; i++)
             fsamples[i] = 0;
 
-        s->tx_fn(s->rdft, fsamples_out, fsamples, sizeof(float));
+        s->tx_fn(s->rdft[ch], fsamples_out, fsamples, sizeof(float));
 
         for (i = 0; i <= s->tabsize / 2; i++) {
             float re, im;
@@ -225,7 +209,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
             fsamples_out[i*2+1] = im;
         }
 
-        s->itx_fn(s->irdft, fsamples, fsamples_out, sizeof(AVComplexFloat));
+        s->itx_fn(s->irdft[ch], fsamples, fsamples_out, sizeof(AVComplexFloat));
 
         for (i = 0; i < s->winlen; i++)
             dst[i] += fsamples[i] / s->tabsize;
@@ -237,6 +221,26 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
             dst[i] = dst[i+s->winlen];
     }
 
+    return 0;
+}
+
+static int filter_frame(AVFilterLink *inlink, AVFrame *in)
+{
+    AVFilterContext *ctx = inlink->dst;
+    SuperEqualizerContext *s = ctx->priv;
+    AVFilterLink *outlink = ctx->outputs[0];
+    AVFrame *out = ff_get_audio_buffer(outlink, in->nb_samples);
+
+    if (!out) {
+        av_frame_free(&in);
+        return AVERROR(ENOMEM);
+    }
+
+    s->in = in;
+    ff_filter_execute(ctx, filter_channels, out, NULL,
+                      FFMIN(inlink->ch_layout.nb_channels, ff_filter_get_nb_threads(ctx)));
+    s->in = NULL;
+
     out->pts = in->pts;
     av_frame_free(&in);
 
@@ -276,11 +280,32 @@ static int config_input(AVFilterLink *inlink)
 {
     AVFilterContext *ctx = inlink->dst;
     SuperEqualizerContext *s = ctx->priv;
+    int ret;
 
     s->out = ff_get_audio_buffer(inlink, s->tabsize);
-    if (!s->out)
+    s->fsamples = ff_get_audio_buffer(inlink, s->tabsize);
+    s->fsamples_out = ff_get_audio_buffer(inlink, s->tabsize + 2);
+    if (!s->out || !s->fsamples || !s->fsamples_out)
+        return AVERROR(ENOMEM);
+
+    s->nb_channels = inlink->ch_layout.nb_channels;
+    s->rdft  = av_calloc(s->nb_channels, sizeof(*s->rdft));
+    s->irdft = av_calloc(s->nb_channels, sizeof(*s->irdft));
+    if (!s->rdft || !s->irdft)
         return AVERROR(ENOMEM);
 
+    for (int ch = 0; ch < s->nb_channels; ch++) {
+        float scale = 1.f, iscale = 1.f;
+
+        ret = av_tx_init(&s->rdft[ch], &s->tx_fn, AV_TX_FLOAT_RDFT, 0, s->tabsize, &scale, 0);
+        if (ret < 0)
+            return ret;
+
+        ret = av_tx_init(&s->irdft[ch], &s->itx_fn, AV_TX_FLOAT_RDFT, 1, s->tabsize, &iscale, 0);
+        if (ret < 0)
+            return ret;
+    }
+
     return 0;
 }
 
@@ -299,12 +324,18 @@ static av_cold void uninit(AVFilterContext *ctx)
     SuperEqualizerContext *s = ctx->priv;
 
     av_frame_free(&s->out);
+    av_frame_free(&s->fsamples);
+    av_frame_free(&s->fsamples_out);
     av_freep(&s->irest);
     av_freep(&s->ires);
-    av_freep(&s->fsamples);
-    av_freep(&s->fsamples_out);
-    av_tx_uninit(&s->rdft);
-    av_tx_uninit(&s->irdft);
+    for (int ch = 0; ch < s->nb_channels; ch++) {
+        if (s->rdft)
+            av_tx_uninit(&s->rdft[ch]);
+        if (s->irdft)
+            av_tx_uninit(&s->irdft[ch]);
+    }
+    av_freep(&s->rdft);
+    av_freep(&s->irdft);
 }
 
 static const AVFilterPad superequalizer_inputs[] = {
@@ -361,4 +392,5 @@ const AVFilter ff_af_superequalizer = {
     FILTER_INPUTS(superequalizer_inputs),
     FILTER_OUTPUTS(superequalizer_outputs),
     FILTER_SINGLE_SAMPLEFMT(AV_SAMPLE_FMT_FLTP),
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -30,6 +30,7 @@
 #include "filters.h"
 #include "formats.h"
 #include "window_func.h"
+#include "af_surrounddsp.h"
 
 enum SurroundChannel {
     SC_FL = 1, SC_FR, SC_FC, SC_LF, SC_BL, SC_BR, SC_BC, SC_SL, SC_SR,
@@ -38,6 +39,12 @@ enum SurroundChannel {
     SC_NB,
 };
 
+enum SurroundAccuracy {
+    ACCURACY_EXACT,
+    ACCURACY_FAST,
+    NB_ACCURACY,
+};
+
 static const int8_t ch_dif[SC_NB] = {
     [SC_FC]  =  0,
     [SC_LF]  =  0,
@@ -119,6 +126,7 @@ typedef struct AudioSurroundContext {
     int   win_func;
     float win_gain;
     float overlap;
+    int   accuracy;
 
     float *f_x;
     unsigned nb_f_x;
@@ -174,18 +182,20 @@ typedef struct AudioSurroundContext {
     av_tx_fn tx_fn, itx_fn;
     float *window_func_lut;
 
-    void (*filter)(AVFilterContext *ctx);
+    AudioSurroundDSPContext dsp;
+
+    void (*filter)(AVFilterContext *ctx, int start, int end);
     void (*set_input_levels)(AVFilterContext *ctx);
     void (*set_output_levels)(AVFilterContext *ctx);
     void (*set_smooth_levels)(AVFilterContext *ctx);
-    void (*upmix)(AVFilterContext *ctx, int ch);
+    void (*upmix)(AVFilterContext *ctx, int ch, int start, int end);
     int (*fft_channel)(AVFilterContext *ctx, AVFrame *out, int ch);
     int (*ifft_channel)(AVFilterContext *ctx, AVFrame *out, int ch);
-    void (*calculate_factors)(AVFilterContext *ctx, int ch, int chan);
-    void (*stereo_copy)(AVFilterContext *ctx, int ch, int chan);
-    void (*do_transform)(AVFilterContext *ctx, int ch);
-    void (*bypass_transform)(AVFilterContext *ctx, int ch, int is_lfe);
-    int (*transform_xy)(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs);
+    void (*calculate_factors)(AVFilterContext *ctx, int ch, int chan, int start, int end);
+    void (*stereo_copy)(AVFilterContext *ctx, int ch, int chan, int start, int end);
+    void (*do_transform)(AVFilterContext *ctx, int ch, int start, int end);
+    void (*bypass_transform)(AVFilterContext *ctx, int ch, int is_lfe, int start, int end);
+    void (*transform_xy)(AVFilterContext *ctx, int start, int end);
 } AudioSurroundContext;
 
 static int query_formats(const AVFilterContext *ctx,
@@ -221,19 +231,19 @@ static int query_formats(const AVFilterContext *ctx,
     return ff_channel_layouts_ref(layouts, &cfg_in[0]->channel_layouts);
 }
 
-static void stereo_upmix(AVFilterContext *ctx, int ch)
+static void stereo_upmix(AVFilterContext *ctx, int ch, int start, int end)
 {
     AudioSurroundContext *s = ctx->priv;
     const int chan = av_channel_layout_channel_from_index(&s->out_ch_layout, ch);
 
-    s->calculate_factors(ctx, ch, chan);
+    s->calculate_factors(ctx, ch, chan, start, end);
 
-    s->stereo_copy(ctx, ch, chan);
+    s->stereo_copy(ctx, ch, chan, start, end);
 
-    s->do_transform(ctx, ch);
+    s->do_transform(ctx, ch, start, end);
 }
 
-static void l2_1_upmix(AVFilterContext *ctx, int ch)
+static void l2_1_upmix(AVFilterContext *ctx, int ch, int start, int end)
 {
     AudioSurroundContext *s = ctx->priv;
     const int chan = av_channel_layout_channel_from_index(&s->out_ch_layout, ch);
@@ -241,58 +251,58 @@ static void l2_1_upmix(AVFilterContext *ctx, int ch)
     switch (chan) {
     case AV_CHAN_LOW_FREQUENCY:
     case AV_CHAN_LOW_FREQUENCY_2:
-        s->bypass_transform(ctx, ch, 1);
+        s->bypass_transform(ctx, ch, 1, start, end);
         return;
     default:
-        s->calculate_factors(ctx, ch, chan);
+        s->calculate_factors(ctx, ch, chan, start, end);
         break;
     }
 
-    s->stereo_copy(ctx, ch, chan);
+    s->stereo_copy(ctx, ch, chan, start, end);
 
-    s->do_transform(ctx, ch);
+    s->do_transform(ctx, ch, start, end);
 }
 
-static void surround_upmix(AVFilterContext *ctx, int ch)
+static void surround_upmix(AVFilterContext *ctx, int ch, int start, int end)
 {
     AudioSurroundContext *s = ctx->priv;
     const int chan = av_channel_layout_channel_from_index(&s->out_ch_layout, ch);
 
     switch (chan) {
     case AV_CHAN_FRONT_CENTER:
-        s->bypass_transform(ctx, ch, 0);
+        s->bypass_transform(ctx, ch, 0, start, end);
         return;
     default:
-        s->calculate_factors(ctx, ch, chan);
+        s->calculate_factors(ctx, ch, chan, start, end);
         break;
     }
 
-    s->stereo_copy(ctx, ch, chan);
+    s->stereo_copy(ctx, ch, chan, start, end);
 
-    s->do_transform(ctx, ch);
+    s->do_transform(ctx, ch, start, end);
 }
 
-static void l3_1_upmix(AVFilterContext *ctx, int ch)
+static void l3_1_upmix(AVFilterContext *ctx, int ch, int start, int end)
 {
     AudioSurroundContext *s = ctx->priv;
     const int chan = av_channel_layout_channel_from_index(&s->out_ch_layout, ch);
 
     switch (chan) {
     case AV_CHAN_FRONT_CENTER:
-        s->bypass_transform(ctx, ch, 0);
+        s->bypass_transform(ctx, ch, 0, start, end);
         return;
     case AV_CHAN_LOW_FREQUENCY:
     case AV_CHAN_LOW_FREQUENCY_2:
-        s->bypass_transform(ctx, ch, 1);
+        s->bypass_transform(ctx, ch, 1, start, end);
         return;
     default:
-        s->calculate_factors(ctx, ch, chan);
+        s->calculate_factors(ctx, ch, chan, start, end);
         break;
     }
 
-    s->stereo_copy(ctx, ch, chan);
+    s->stereo_copy(ctx, ch, chan, start, end);
 
-    s->do_transform(ctx, ch);
+    s->do_transform(ctx, ch, start, end);
 }
 
 #define DEPTH 32
@@ -384,6 +394,8 @@ fail:
         return AVERROR(EINVAL);
     }
 
+    ff_surround_init(&s->dsp);
+
     return 0;
 }
 
@@ -400,6 +412,30 @@ static int fft_channels(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
     return 0;
 }
 
+static int filter_bins(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    AudioSurroundContext *s = ctx->priv;
+    const int start = (s->rdft_size * jobnr) / nb_jobs;
+    const int end = (s->rdft_size * (jobnr+1)) / nb_jobs;
+
+    s->filter(ctx, start, end);
+    s->transform_xy(ctx, start, end);
+
+    return 0;
+}
+
+static int upmix_bins(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    AudioSurroundContext *s = ctx->priv;
+    const int start = (s->rdft_size * jobnr) / nb_jobs;
+    const int end = (s->rdft_size * (jobnr+1)) / nb_jobs;
+
+    for (int ch = 0; ch < s->nb_out_channels; ch++)
+        s->upmix(ctx, ch, start, end);
+
+    return 0;
+}
+
 static int ifft_channels(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
     AudioSurroundContext *s = ctx->priv;
@@ -407,11 +443,8 @@ static int ifft_channels(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs
     const int start = (out->ch_layout.nb_channels * jobnr) / nb_jobs;
     const int end = (out->ch_layout.nb_channels * (jobnr+1)) / nb_jobs;
 
-    for (int ch = start; ch < end; ch++) {
-        if (s->upmix)
-            s->upmix(ctx, ch);
+    for (int ch = start; ch < end; ch++)
         s->ifft_channel(ctx, out, ch);
-    }
 
     return 0;
 }
@@ -421,6 +454,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     AVFilterContext *ctx = inlink->dst;
     AVFilterLink *outlink = ctx->outputs[0];
     AudioSurroundContext *s = ctx->priv;
+    const int nb_bin_jobs = FFMIN(s->rdft_size, ff_filter_get_nb_threads(ctx));
     int nb_samples;
     AVFrame *out;
 
@@ -428,7 +462,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
                       FFMIN(inlink->ch_layout.nb_channels,
                             ff_filter_get_nb_threads(ctx)));
 
-    s->filter(ctx);
+    ff_filter_execute(ctx, filter_bins, NULL, NULL, nb_bin_jobs);
 
     if (in) {
         const int extra_samples = FFMIN(s->hop_size - in->nb_samples, s->flush_size);
@@ -449,10 +483,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
         return AVERROR(ENOMEM);
     }
 
-
-    ff_filter_execute(ctx, s->transform_xy, NULL, NULL,
-                      FFMIN(s->rdft_size,
-                            ff_filter_get_nb_threads(ctx)));
+    ff_filter_execute(ctx, upmix_bins, NULL, NULL, nb_bin_jobs);
 
     ff_filter_execute(ctx, ifft_channels, out, NULL,
                       FFMIN(outlink->ch_layout.nb_channels,
@@ -639,6 +670,9 @@ static const AVOption surround_options[] = {
     { "smooth",    "set output channels temporal smoothness strength", OFFSET(smooth),AV_OPT_TYPE_FLOAT|AR, {.arr=&def_smooth},0,1,TFLAGS },
     WIN_FUNC_OPTION("win_func", OFFSET(win_func), FLAGS, WFUNC_SINE),
     { "overlap", "set window overlap", OFFSET(overlap), AV_OPT_TYPE_FLOAT, {.dbl=0.5}, 0, 1, TFLAGS },
+    { "accuracy", "set accuracy of per-bin math", OFFSET(accuracy), AV_OPT_TYPE_INT, {.i64=ACCURACY_EXACT}, 0, NB_ACCURACY-1, TFLAGS, .unit = "accuracy" },
+    {  "exact",   "use libm functions",                       0, AV_OPT_TYPE_CONST, {.i64=ACCURACY_EXACT}, 0, 0, TFLAGS, .unit = "accuracy" },
+    {  "fast",    "use polynomial approximations",            0, AV_OPT_TYPE_CONST, {.i64=ACCURACY_FAST},  0, 0, TFLAGS, .unit = "accuracy" },
     { NULL }
 };
 
@@ -0,0 +1,131 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFILTER_SURROUNDDSP_H
+#define AVFILTER_SURROUNDDSP_H
+
+#include <float.h>
+#include <math.h>
+#include <stddef.h>
+
+#include "libavutil/attributes.h"
+#include "libavutil/common.h"
+#include "libavutil/tx.h"
+
+/**
+ * Per-bin kernels of the surround filter used with accuracy=fast.
+ * Results differ from the libm based path by about 1e-5. The C
+ * stereo_position() uses a polynomial arc tangent, the C power_factors()
+ * keeps expf(), which scalar code does not beat.
+ */
+typedef struct AudioSurroundDSPContext {
+    /**
+     * Compute the x, y and z positions of each bin from the left and
+     * right spectra, see stereo_position() in surround_template.c.
+     * len must be a multiple of 4.
+     */
+    void (*stereo_position)(float *x, float *y, float *z,
+                            const AVComplexFloat *l, const AVComplexFloat *r,
+                            ptrdiff_t len);
+
+    /**
+     * Compute the gain of each bin for one output channel.
+     *
+     * @param coeffs the negated x, y and z exponents followed by the
+     *               normalization numerator
+     * @param len    number of bins, a multiple of 4
+     */
+    void (*power_factors)(float *factor, const float *x, const float *y,
+                          const float *z, const float *coeffs, ptrdiff_t len);
+} AudioSurroundDSPContext;
+
+/* atan(t) * 2 / pi for t in [0, 1], Abramowitz & Stegun 4.4.49 */
+#define SURROUND_ATAN_C1  0.636534465f
+#define SURROUND_ATAN_C3 -0.210275193f
+#define SURROUND_ATAN_C5  0.114681322f
+#define SURROUND_ATAN_C7 -0.0541973511f
+#define SURROUND_ATAN_C9  0.0132640366f
+
+static av_always_inline float surround_isnormal(float x)
+{
+    const float a = fabsf(x);
+
+    return a >= FLT_MIN && a <= FLT_MAX ? x : 0.f;
+}
+
+static void stereo_position_c(float *x, float *y, float *z,
+                              const AVComplexFloat *l, const AVComplexFloat *r,
+                              ptrdiff_t len)
+{
+    for (int n = 0; n < len; n++) {
+        const float l_re = l[n].re, l_im = l[n].im;
+        const float r_re = r[n].re, r_im = r[n].im;
+        const float l_mag = sqrtf(l_re * l_re + l_im * l_im);
+        const float r_mag = sqrtf(r_re * r_re + r_im * r_im);
+        const float cor_re = l_re * r_re + l_im * r_im;
+        const float cor_im = r_re * l_im - r_im * l_re;
+        const float ax = fabsf(cor_re), ay = fabsf(cor_im);
+        const float mx = FFMAX(ax, ay), mn = FFMIN(ax, ay);
+        const float t = mn / FFMAX(mx, FLT_MIN);
+        const float t2 = t * t;
+        float a, x0, y0, z0;
+
+        /* |atan2(cor_im, cor_re)| in units of pi/2 */
+        a = t * (SURROUND_ATAN_C1 + t2 * (SURROUND_ATAN_C3 + t2 * (SURROUND_ATAN_C5 +
+            t2 * (SURROUND_ATAN_C7 + t2 *  SURROUND_ATAN_C9))));
+        if (ay > ax)
+            a = 1.f - a;
+        if (cor_re < 0.f)
+            a = 2.f - a;
+        if (mx <= FLT_EPSILON)
+            a = 0.f;
+
+        x0 = (r_mag - l_mag) / (r_mag + l_mag + FLT_EPSILON);
+        y0 = 1.f - a;
+        z0 = copysignf(1.f - 2.f * fabsf(fabsf(y0) - 0.5f), cor_im);
+
+        x[n] = av_clipf(surround_isnormal(x0), -1.f, 1.f);
+        y[n] = av_clipf(surround_isnormal(y0), -1.f, 1.f);
+        z[n] = av_clipf(surround_isnormal(z0), -1.f, 1.f);
+    }
+}
+
+static void power_factors_c(float *factor, const float *x, const float *y,
+                            const float *z, const float *coeffs, ptrdiff_t len)
+{
+    const float f_x = coeffs[0];
+    const float f_y = coeffs[1];
+    const float f_z = coeffs[2];
+    const float num = coeffs[3];
+
+    for (int n = 0; n < len; n++) {
+        const float ex = 1.f + expf(f_x * (x[n] - 0.5f));
+        const float ey = 1.f + expf(f_y * (y[n] - 0.5f));
+        const float ez = 1.f + expf(f_z * (z[n] - 0.5f));
+
+        factor[n] = surround_isnormal(num / (ex * ey * ez));
+    }
+}
+
+static av_unused void ff_surround_init(AudioSurroundDSPContext *dsp)
+{
+    dsp->stereo_position = stereo_position_c;
+    dsp->power_factors = power_factors_c;
+}
+
+#endif /* AVFILTER_SURROUNDDSP_H */
@@ -26,6 +26,7 @@
 #undef ftype
 #undef stype
 #undef SAMPLE_FORMAT
+#undef dsp_fn
 #if DEPTH == 16
 #define FCBRT cbrtf
 #define FSQRT sqrtf
@@ -59,6 +60,7 @@
 #define ftype float
 #define stype float
 #define SAMPLE_FORMAT flt
+#define dsp_fn(a) a##_float
 #else
 #define FCBRT cbrt
 #define FSQRT sqrt
@@ -70,6 +72,7 @@
 #define ftype double
 #define stype double
 #define SAMPLE_FORMAT dbl
+#define dsp_fn(a) a##_double
 #endif
 
 #define F(x) ((ftype)(x))
@@ -169,14 +172,28 @@ static ftype fn(fade_gain)(int curve, int64_t index, int64_t range, ftype silenc
     return silence + (unity - silence) * gain;
 }
 
-static void fn(fade_samplesp)(uint8_t **dst, uint8_t *const *src,
+static void fn(fade_samplesp)(AudioFadeContext *ctx,
+                              uint8_t **dst, uint8_t *const *src,
                               int nb_samples, int channels, int dir,
                               int64_t start, int64_t range,int curve,
                               double dsilence, double dunity)
 {
     const ftype silence = dsilence;
     const ftype unity = dunity;
+#ifdef dsp_fn
+    ftype gain[FADE_BLOCK_SIZE];
 
+    for (int i = 0; i < nb_samples; i += FADE_BLOCK_SIZE) {
+        const int len = FFMIN(nb_samples - i, FADE_BLOCK_SIZE);
+
+        for (int n = 0; n < len; n++)
+            gain[n] = fn(fade_gain)(curve,start+(i+n)*dir,range,silence,unity);
+
+        for (int c = 0; c < channels; c++)
+            ctx->dsp.dsp_fn(gain)((stype *)dst[c] + i, (const stype *)src[c] + i,
+                                  gain, len);
+    }
+#else
     for (int i = 0; i < nb_samples; i++) {
         const ftype gain = fn(fade_gain)(curve,start+i*dir,range,silence,unity);
         for (int c = 0; c < channels; c++) {
@@ -186,9 +203,11 @@ static void fn(fade_samplesp)(uint8_t **dst, uint8_t *const *src,
             d[i] = s[i] * gain;
         }
     }
+#endif
 }
 
-static void fn(fade_samples)(uint8_t **dst, uint8_t *const *src,
+static void fn(fade_samples)(AudioFadeContext *ctx,
+                             uint8_t **dst, uint8_t *const *src,
                              int nb_samples, int channels, int dir,
                              int64_t start, int64_t range, int curve,
                              double dsilence, double dunity)
@@ -205,12 +224,18 @@ static void fn(fade_samples)(uint8_t **dst, uint8_t *const *src,
     }
 }
 
-static void fn(scale_samplesp)(uint8_t **dst, uint8_t *const *src,
+static void fn(scale_samplesp)(AudioFadeContext *ctx,
+                               uint8_t **dst, uint8_t *const *src,
                                int nb_samples, int channels,
                                double dgain)
 {
     const ftype gain = dgain;
 
+#ifdef dsp_fn
+    for (int c = 0; c < channels; c++)
+        ctx->dsp.dsp_fn(scale)((stype *)dst[c], (const stype *)src[c],
+                               gain, nb_samples);
+#else
     for (int i = 0; i < nb_samples; i++) {
         for (int c = 0; c < channels; c++) {
             stype *d = (stype *)dst[c];
@@ -219,26 +244,50 @@ static void fn(scale_samplesp)(uint8_t **dst, uint8_t *const *src,
             d[i] = s[i] * gain;
         }
     }
+#endif
 }
 
-static void fn(scale_samples)(uint8_t **dst, uint8_t *const *src,
+static void fn(scale_samples)(AudioFadeContext *ctx,
+                              uint8_t **dst, uint8_t *const *src,
                               int nb_samples, int channels, double dgain)
 {
     const ftype gain = dgain;
     stype *d = (stype *)dst[0];
     const stype *s = (stype *)src[0];
 
+#ifdef dsp_fn
+    ctx->dsp.dsp_fn(scale)(d, s, gain, nb_samples * channels);
+#else
     for (int i = 0, k = 0; i < nb_samples; i++) {
         for (int c = 0; c < channels; c++, k++)
             d[k] = s[k] * gain;
     }
+#endif
 }
 
-static void fn(crossfade_samplesp)(uint8_t **dst, uint8_t *const *cf0,
+static void fn(crossfade_samplesp)(AudioFadeContext *ctx,
+                                   uint8_t **dst, uint8_t *const *cf0,
                                    uint8_t *const *cf1,
                                    int nb_samples, int channels,
                                    int curve0, int curve1)
 {
+#ifdef dsp_fn
+    ftype gain0[FADE_BLOCK_SIZE], gain1[FADE_BLOCK_SIZE];
+
+    for (int i = 0; i < nb_samples; i += FADE_BLOCK_SIZE) {
+        const int len = FFMIN(nb_samples - i, FADE_BLOCK_SIZE);
+
+        for (int n = 0; n < len; n++) {
+            gain0[n] = fn(fade_gain)(curve0, nb_samples-1-(i+n), nb_samples,F(0.0),F(1.0));
+            gain1[n] = fn(fade_gain)(curve1, i+n, nb_samples, F(0.0), F(1.0));
+        }
+
+        for (int c = 0; c < channels; c++)
+            ctx->dsp.dsp_fn(crossfade)((stype *)dst[c] + i,
+                                       (const stype *)cf0[c] + i, gain0,
+                                       (const stype *)cf1[c] + i, gain1, len);
+    }
+#else
     for (int i = 0; i < nb_samples; i++) {
         const ftype gain0 = fn(fade_gain)(curve0, nb_samples-1-i, nb_samples,F(0.0),F(1.0));
         const ftype gain1 = fn(fade_gain)(curve1, i, nb_samples, F(0.0), F(1.0));
@@ -250,9 +299,11 @@ static void fn(crossfade_samplesp)(uint8_t **dst, uint8_t *const *cf0,
             d[i] = s0[i] * gain0 + s1[i] * gain1;
         }
     }
+#endif
 }
 
-static void fn(crossfade_samples)(uint8_t **dst, uint8_t *const *cf0,
+static void fn(crossfade_samples)(AudioFadeContext *ctx,
+                                  uint8_t **dst, uint8_t *const *cf0,
                                   uint8_t *const *cf1,
                                   int nb_samples, int channels,
                                   int curve0, int curve1)
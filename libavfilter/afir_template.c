@@ -128,6 +128,10 @@ static ftype fn(ir_gain)(AVFilterContext *ctx, AudioFIRContext *s,
         for (int i = 0; i < cur_nb_taps; i++)
             sum += time[i];
         ch_gain = F(1.0) / sum;
+    } else if (ir_norm == F(1.0)) {
+        for (int i = 0; i < cur_nb_taps; i++)
+            sum += FABS(time[i]);
+        ch_gain = F(1.0) / sum;
     } else {
         for (int i = 0; i < cur_nb_taps; i++)
             sum += POW(FABS(time[i]), ir_norm);
@@ -178,7 +182,7 @@ static void fn(convert_channel)(AVFilterContext *ctx, AudioFIRContext *s, const
     av_log(ctx, AV_LOG_DEBUG, "input_offset: %d\n", seg->input_offset);
 }
 
-static int fn(ir_convert)(AVFilterContext *ctx, AudioFIRContext *s,
+static int fn(ir_analyze)(AVFilterContext *ctx, AudioFIRContext *s,
                           const int selir)
 {
     AudioIR *ir = &s->irs[selir];
@@ -212,6 +216,20 @@ static int fn(ir_convert)(AVFilterContext *ctx, AudioFIRContext *s,
 
     av_log(ctx, AV_LOG_DEBUG, "nb_taps: %d\n", nb_taps);
 
+    ir->norm_taps = nb_taps;
+    ir->delay = delay;
+
+    av_log(ctx, AV_LOG_DEBUG, "delay: %d\n", delay);
+
+    return 0;
+}
+
+static int fn(ir_setup)(AVFilterContext *ctx, AudioFIRContext *s,
+                        const int selir)
+{
+    AudioIR *ir = &s->irs[selir];
+    const int nb_taps = ir->norm_taps;
+
     if (!ir->norm_ir || ir->norm_ir->nb_samples < nb_taps) {
         av_frame_free(&ir->norm_ir);
         ir->norm_ir = ff_get_audio_buffer(ctx->inputs[0], FFALIGN(nb_taps, 8));
@@ -220,35 +238,24 @@ static int fn(ir_convert)(AVFilterContext *ctx, AudioFIRContext *s,
     }
 
     if (!ir->nb_segments) {
-        int part_size, max_part_size;
-        int ret, left, offset = 0;
+        int ret = init_segments(ctx, ir, selir, nb_taps);
+        if (ret < 0)
+            return ret;
+    }
 
-        left = nb_taps;
-        part_size = s->minp;
-        max_part_size = s->maxp;
+    av_log(ctx, AV_LOG_DEBUG, "nb_segments: %d\n", ir->nb_segments);
 
-        ir->seg = av_calloc(get_nb_segments(ctx, s, nb_taps), sizeof(*ir->seg));
-        if (!ir->seg)
-            return AVERROR(ENOMEM);
+    ir->nb_partitions = 0;
+    for (int n = 0; n < ir->nb_segments; n++) {
+        AudioFIRSegment *seg = &ir->seg[n];
 
-        for (int i = 0; left > 0; i++) {
-            int step = (part_size == max_part_size) ? INT_MAX : 1 + (i == 0);
-            int nb_partitions = FFMIN(step, (left + part_size - 1) / part_size);
-
-            ret = init_segment(ctx, &ir->seg[i], selir, offset, nb_partitions, part_size, i);
-            if (ret < 0)
-                return ret;
-            ir->nb_segments = i + 1;
-            offset += nb_partitions * part_size;
-            ir->max_offset = offset;
-            left -= nb_partitions * part_size;
-            part_size *= 2;
-            part_size = FFMIN(part_size, max_part_size);
-        }
+        if (!seg->coeff)
+            seg->coeff = ff_get_audio_buffer(ctx->inputs[0], seg->nb_partitions * seg->coeff_size * 2);
+        if (!seg->coeff)
+            return AVERROR(ENOMEM);
+        ir->nb_partitions += seg->nb_partitions;
     }
 
-    av_log(ctx, AV_LOG_DEBUG, "nb_segments: %d\n", ir->nb_segments);
-
     for (int ch = 0; ch < s->nb_channels; ch++) {
         const ftype *tsrc = (const ftype *)ir->ir->extended_data[!s->one2many * ch];
         ftype *time = (ftype *)ir->norm_ir->extended_data[ch];
@@ -258,28 +265,54 @@ static int fn(ir_convert)(AVFilterContext *ctx, AudioFIRContext *s,
             time[i] = F(0.0);
 
         fn(ir_scale)(ctx, s, nb_taps, ch, time, ir->ch_gain[ch]);
+    }
 
-        for (int n = 0; n < ir->nb_segments; n++) {
-            AudioFIRSegment *seg = &ir->seg[n];
+    ir->nb_prepared = 0;
 
-            if (!seg->coeff)
-                seg->coeff = ff_get_audio_buffer(ctx->inputs[0], seg->nb_partitions * seg->coeff_size * 2);
-            if (!seg->coeff)
-                return AVERROR(ENOMEM);
+    return 0;
+}
 
-            for (int i = 0; i < seg->nb_partitions; i++)
-                fn(convert_channel)(ctx, s, ch, seg, i, selir);
-        }
+/* Transform the partitions [start, end) of one channel, counting the
+ * partitions of all segments in order. */
+static void fn(ir_convert_partitions)(AVFilterContext *ctx, AudioFIRContext *s,
+                                      const int selir, const int ch,
+                                      int start, const int end)
+{
+    AudioIR *ir = &s->irs[selir];
+    int first = 0;
+
+    for (int n = 0; n < ir->nb_segments && start < end; n++) {
+        AudioFIRSegment *seg = &ir->seg[n];
+
+        for (; start < end && start - first < seg->nb_partitions; start++)
+            fn(convert_channel)(ctx, s, ch, seg, start - first, selir);
+        first += seg->nb_partitions;
     }
+}
+
+static int fn(ir_convert)(AVFilterContext *ctx, AudioFIRContext *s,
+                          const int selir)
+{
+    AudioIR *ir = &s->irs[selir];
+    int ret;
+
+    ret = fn(ir_analyze)(ctx, s, selir);
+    if (ret < 0)
+        return ret;
+
+    ret = fn(ir_setup)(ctx, s, selir);
+    if (ret < 0)
+        return ret;
+
+    for (int ch = 0; ch < s->nb_channels; ch++)
+        fn(ir_convert_partitions)(ctx, s, selir, ch, 0, ir->nb_partitions);
+    ir->nb_prepared = ir->nb_partitions;
 
     ir->have_coeffs = 1;
-    ir->delay = delay;
 
     av_frame_free(&ir->ir);
     av_frame_free(&ir->norm_ir);
 
-    av_log(ctx, AV_LOG_DEBUG, "delay: %d\n", delay);
-
     return 0;
 }
 
@@ -294,10 +327,9 @@ static void fn(fir_fadd)(AudioFIRContext *s, ftype *dst, const ftype *src, int n
 }
 
 static int fn(fir_quantum)(AVFilterContext *ctx, AVFrame *out, const int ch,
-                           int ioffset, int offset, const int selir)
+                           int ioffset, int offset, AudioIR *ir)
 {
     AudioFIRContext *s = ctx->priv;
-    AudioIR *ir = &s->irs[selir];
     const ftype *in = (const ftype *)s->in->extended_data[ch] + ioffset;
     ftype *blockout, *ptr = (ftype *)out->extended_data[ch] + offset;
     const int min_part_size = s->min_part_size;
@@ -409,12 +441,12 @@ static void fn(fir_quantums)(AVFilterContext *ctx, AudioFIRContext *s, AVFrame *
 
         if (ctx->is_disabled && !s->prev_is_disabled) {
             memset(src0, 0, min_part_size * sizeof(ftype));
-            fn(fir_quantum)(ctx, s->fadein[0], ch, offset, 0, selir);
+            fn(fir_quantum)(ctx, s->fadein[0], ch, offset, 0, &s->irs[selir]);
             for (int n = 0; n < min_part_size; n++)
                 dst[n] = xfade1[n] * src0[n] + xfade0[n] * in[n];
         } else if (!ctx->is_disabled && s->prev_is_disabled) {
             memset(src1, 0, min_part_size * sizeof(ftype));
-            fn(fir_quantum)(ctx, s->fadein[1], ch, offset, 0, selir);
+            fn(fir_quantum)(ctx, s->fadein[1], ch, offset, 0, &s->irs[selir]);
             for (int n = 0; n < min_part_size; n++)
                 dst[n] = xfade1[n] * in[n] + xfade0[n] * src1[n];
         } else {
@@ -431,8 +463,8 @@ static void fn(fir_quantums)(AVFilterContext *ctx, AudioFIRContext *s, AVFrame *
         memset(src0, 0, min_part_size * sizeof(ftype));
         memset(src1, 0, min_part_size * sizeof(ftype));
 
-        fn(fir_quantum)(ctx, s->fadein[0], ch, offset, 0, prev_selir);
-        fn(fir_quantum)(ctx, s->fadein[1], ch, offset, 0, selir);
+        fn(fir_quantum)(ctx, s->fadein[0], ch, offset, 0, &s->irs[prev_selir]);
+        fn(fir_quantum)(ctx, s->fadein[1], ch, offset, 0, &s->irs[selir]);
 
         if (s->loading[ch] > ir->max_offset) {
             for (int n = 0; n < min_part_size; n++)
@@ -442,6 +474,28 @@ static void fn(fir_quantums)(AVFilterContext *ctx, AudioFIRContext *s, AVFrame *
             memcpy(dst, src0, min_part_size * sizeof(ftype));
         }
     } else {
-        fn(fir_quantum)(ctx, out, ch, offset, offset, selir);
+        fn(fir_quantum)(ctx, out, ch, offset, offset, &s->irs[selir]);
+    }
+}
+
+static int fn(time_quantums)(AVFilterContext *ctx, AudioFIRContext *s, AudioIR *ir,
+                             AVFrame *in, AVFrame *out, int nb_samples,
+                             int64_t max_time, int64_t *elapsed)
+{
+    const int64_t start = av_gettime_relative();
+    int n;
+
+    s->in = in;
+    for (n = 0; n < nb_samples; n += s->min_part_size) {
+        fn(fir_quantum)(ctx, out, 0, 0, 0, ir);
+
+        *elapsed = av_gettime_relative() - start;
+        if (max_time > 0 && *elapsed > max_time) {
+            n += s->min_part_size;
+            break;
+        }
     }
+    s->in = NULL;
+
+    return n;
 }
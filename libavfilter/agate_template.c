@@ -28,14 +28,14 @@
 #define FLOG logf
 #define FMAX fmaxf
 #define ftype float
-#define SAMPLE_FORMAT flt
+#define SAMPLE_FORMAT fltp
 #else
 #define FABS fabs
 #define FEXP exp
 #define FLOG log
 #define FMAX fmax
 #define ftype double
-#define SAMPLE_FORMAT dbl
+#define SAMPLE_FORMAT dblp
 #endif
 
 #include "hermite.h"
@@ -70,100 +70,112 @@ static ftype fn(output_gain)(ftype lin_slope, ftype ratio, ftype thres,
     return FMAX(range, FEXP(gain - slope));
 }
 
-static void fn(gate)(AVFilterContext *ctx, AVFrame *out, const int nb_samples,
-                     AVFilterLink *inlink, AVFilterLink *sclink)
+static void fn(gate_block)(AudioGateContext *s, ftype *factor,
+                           ftype *lin_slopep, ftype scale,
+                           int nb_samples, int is_disabled)
 {
-    AudioGateContext *s = ctx->priv;
-    AVFrame *sc = s->sc ? s->sc : s->in;
-    AVFrame *in = s->in;
-    const ftype *scsrc = (const ftype *)sc->data[0];
-    const ftype *src = (const ftype *)in->data[0];
-    ftype *dst = (ftype *)out->data[0];
-    const int sc_nb_channels = sclink->ch_layout.nb_channels;
-    const int nb_channels = inlink->ch_layout.nb_channels;
     const ftype lin_knee_start = s->lin_knee_start;
     const ftype lin_knee_stop = s->lin_knee_stop;
     const ftype makeup = s->makeup;
     const ftype attack_coeff = s->attack_coeff;
     const ftype release_coeff = s->release_coeff;
-    const int is_disabled = ctx->is_disabled;
     const int detection = s->detection;
-    ftype *lin_slopep = s->lin_slope;
     const ftype ratio = s->ratio;
     const ftype range = s->range;
     const ftype knee_start = s->knee_start;
     const ftype knee_stop = s->knee_stop;
     const ftype level_in = s->level_in;
-    const ftype level_sc = s->level_sc;
     const ftype thres = s->thres;
     const ftype knee = s->knee;
-    const int link = s->link;
     const int direction = s->direction;
+    ftype lin_slope = *lin_slopep;
 
-    for (int n = 0; n < nb_samples; n++, src += nb_channels, dst += nb_channels, scsrc += sc_nb_channels) {
-        ftype abs_sample, factor, lin_slope;
+    for (int n = 0; n < nb_samples; n++) {
+        ftype abs_sample = factor[n];
         ftype gain = F(1.0);
         int detected;
 
-        switch (link) {
-        case LINK_MAX:
-        case LINK_AVG:
-            lin_slope = lin_slopep[0];
-            abs_sample = FABS(scsrc[0] * level_sc);
-            if (link == LINK_MAX) {
-                for (int c = 1; c < sc_nb_channels; c++)
-                    abs_sample = FMAX(FABS(scsrc[c] * level_sc), abs_sample);
-            } else {
-                for (int c = 1; c < sc_nb_channels; c++)
-                    abs_sample += FABS(scsrc[c] * level_sc);
-                abs_sample /= sc_nb_channels;
+        if (scale != F(1.0))
+            abs_sample /= scale;
+        if (detection)
+            abs_sample *= abs_sample;
+        lin_slope += (abs_sample - lin_slope) * (abs_sample > lin_slope ? attack_coeff : release_coeff);
+
+        if (direction)
+            detected = lin_slope > lin_knee_start;
+        else
+            detected = lin_slope < lin_knee_stop;
+
+        if (lin_slope > F(0.0) && detected)
+            gain = fn(output_gain)(lin_slope, ratio, thres,
+                                   knee, knee_start, knee_stop,
+                                   range, direction);
+
+        factor[n] = is_disabled ? F(1.0) : level_in * gain * makeup;
+    }
+
+    *lin_slopep = lin_slope;
+}
+
+static int fn(gate)(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    AudioGateContext *s = ctx->priv;
+    ThreadData *td = arg;
+    AVFrame *out = td->out;
+    AVFrame *in = td->in;
+    AVFrame *sc = td->sc;
+    const int nb_samples = in->nb_samples;
+    const int nb_channels = in->ch_layout.nb_channels;
+    const int sc_nb_channels = sc->ch_layout.nb_channels;
+    const int is_disabled = ctx->is_disabled;
+    const ftype level_sc = s->level_sc;
+    ftype *lin_slope = s->lin_slope;
+    ftype factor[BLOCK_SIZE];
+
+    if (s->link == LINK_NONE) {
+        const int channels = FFMIN(nb_channels, sc_nb_channels);
+        const int start = (channels * jobnr) / nb_jobs;
+        const int end = (channels * (jobnr+1)) / nb_jobs;
+
+        for (int c = start; c < end; c++) {
+            const ftype *scsrc = (const ftype *)sc->extended_data[c];
+            const ftype *src = (const ftype *)in->extended_data[c];
+            ftype *dst = (ftype *)out->extended_data[c];
+
+            for (int n = 0; n < nb_samples; n += BLOCK_SIZE) {
+                const int len = FFMIN(nb_samples - n, BLOCK_SIZE);
+
+                s->dsp.fn2(abs, ftype)(factor, scsrc + n, level_sc, len);
+                fn(gate_block)(s, factor, &lin_slope[c], F(1.0), len, is_disabled);
+                s->dsp.fn2(mul, ftype)(dst + n, src + n, factor, len);
             }
+        }
+    } else {
+        for (int n = 0; n < nb_samples; n += BLOCK_SIZE) {
+            const int len = FFMIN(nb_samples - n, BLOCK_SIZE);
+
+            s->dsp.fn2(abs, ftype)(factor, (const ftype *)sc->extended_data[0] + n, level_sc, len);
+            for (int c = 1; c < sc_nb_channels; c++) {
+                const ftype *scsrc = (const ftype *)sc->extended_data[c] + n;
 
-            if (detection)
-                abs_sample *= abs_sample;
-            lin_slope += (abs_sample - lin_slope) * (abs_sample > lin_slope ? attack_coeff : release_coeff);
-
-            if (direction)
-                detected = lin_slope > lin_knee_start;
-            else
-                detected = lin_slope < lin_knee_stop;
-
-            if (lin_slope > F(0.0) && detected)
-                gain = fn(output_gain)(lin_slope, ratio, thres,
-                                       knee, knee_start, knee_stop,
-                                       range, direction);
-
-            factor = is_disabled ? F(1.0) : level_in * gain * makeup;
-            for (int c = 0; c < nb_channels; c++)
-                dst[c] = src[c] * factor;
-            lin_slopep[0] = lin_slope;
-            break;
-        case LINK_NONE:
-            for (int c = 0; c < sc_nb_channels; c++) {
-                ftype lin_slope = lin_slopep[c];
-                ftype gain = F(1.0);
-
-                abs_sample = FABS(scsrc[c] * level_sc);
-                if (detection)
-                    abs_sample *= abs_sample;
-                lin_slope += (abs_sample - lin_slope) * (abs_sample > lin_slope ? attack_coeff : release_coeff);
-
-                if (direction)
-                    detected = lin_slope > lin_knee_start;
+                if (s->link == LINK_MAX)
+                    s->dsp.fn2(abs_max, ftype)(factor, scsrc, level_sc, len);
                 else
-                    detected = lin_slope < lin_knee_stop;
+                    s->dsp.fn2(abs_add, ftype)(factor, scsrc, level_sc, len);
+            }
 
-                if (lin_slope > F(0.0) && detected)
-                    gain = fn(output_gain)(lin_slope, ratio, thres,
-                                           knee, knee_start, knee_stop,
-                                           range, direction);
+            fn(gate_block)(s, factor, &lin_slope[0],
+                           s->link == LINK_AVG ? sc_nb_channels : 1,
+                           len, is_disabled);
 
-                factor = is_disabled ? F(1.0) : level_in * gain * makeup;
-                dst[c] = src[c] * factor;
+            for (int c = 0; c < nb_channels; c++) {
+                const ftype *src = (const ftype *)in->extended_data[c] + n;
+                ftype *dst = (ftype *)out->extended_data[c] + n;
 
-                lin_slopep[c] = lin_slope;
+                s->dsp.fn2(mul, ftype)(dst, src, factor, len);
             }
-            break;
         }
     }
+
+    return 0;
 }
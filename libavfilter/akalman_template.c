@@ -33,20 +33,14 @@
 #define fn(a)      fn2(a, SAMPLE_FORMAT)
 
 static ftype fn(fir_sample)(AudioKalmanContext *s, ftype sample, ftype *delay,
-                            ftype *coeffs, ftype *tmp, int *offset)
+                            const ftype *coeffs, int *offset)
 {
     const int order = s->order;
     ftype output;
 
     delay[*offset] = sample;
 
-    memcpy(tmp, coeffs + order - *offset, order * sizeof(ftype));
-
-#if DEPTH == 32
-    output = s->fdsp->scalarproduct_float(delay, tmp, s->kernel_size);
-#else
-    output = s->fdsp->scalarproduct_double(delay, tmp, s->kernel_size);
-#endif
+    output = s->dsp.fn(dot)(delay, coeffs + order - *offset, order);
 
     if (--(*offset) < 0)
         *offset = order - 1;
@@ -58,90 +52,36 @@ static ftype fn(process_sample)(AudioKalmanContext *s, ftype input, ftype desire
 {
     ftype *coeffs = (ftype *)s->coeffs->extended_data[ch];
     ftype *delay = (ftype *)s->delay->extended_data[ch];
-    ftype *tmp = (ftype *)s->tmp->extended_data[ch];
-    ftype *Pn = (ftype *)s->Pn->extended_data[ch];
-    ftype *Ku = (ftype *)s->Ku->extended_data[ch];
-    ftype *IKu = (ftype *)s->IKu->extended_data[ch];
     ftype *P = (ftype *)s->P->extended_data[ch];
     ftype *r = (ftype *)s->r->extended_data[ch];
     int *offsetp = (int *)s->offset->extended_data[ch];
     const int kernel_size = s->kernel_size;
     const ftype delta = s->delta;
     const int order = s->order;
-    int offset = *offsetp;
-    ftype output, e, R, ur = F(0.0);
+    const int offset = *offsetp;
+    const ftype *delayo = delay + offset;
+    ftype output, e, R, ur;
 
     delay[offset + order] = input;
 
-    output = fn(fir_sample)(s, input, delay, coeffs, tmp, offsetp);
+    output = fn(fir_sample)(s, input, delay, coeffs, offsetp);
     e = desired - output;
     R = e * e + 2e-10;
 
     for (int m = 0; m < order; m++) {
-        const int moffset = m * kernel_size;
-        const ftype *Pm = P + moffset;
-        ftype *Pnm = Pn + moffset;
+        ftype *Pm = P + m * kernel_size;
 
-        for (int n = 0; n < order; n++)
-            Pnm[n] = Pm[n];
-        Pnm[m] += delta;
+        Pm[m] += delta;
+        r[m] = s->dsp.fn(dot)(Pm, delayo, order);
     }
 
-    for (int m = 0; m < order; m++) {
-        const int moffset = m * kernel_size;
-        const ftype *delayo = delay + offset;
-        const ftype *Pnm = Pn + moffset;
-        ftype sum = F(0.0);
-
-        for (int n = 0; n < order; n++)
-            sum += Pnm[n] * delayo[n];
-        r[m] = sum;
-    }
+    ur = F(1.0) / (s->dsp.fn(dot)(delayo, r, order) + R);
 
-    for (int n = 0; n < order; n++)
-        ur += delay[offset + n] * r[n];
+    s->dsp.fn(axpy)(coeffs, r, ur * e, order);
+    memcpy(coeffs + order, coeffs, order * sizeof(*coeffs));
 
-    ur += R;
-    ur = F(1.0) / ur;
-    for (int n = 0; n < order; n++)
-        r[n] *= ur;
-
-    for (int n = 0; n < order; n++)
-        coeffs[n] = coeffs[order + n] = coeffs[n] + r[n] * e;
-
-    for (int m = 0; m < order; m++) {
-        const ftype *delayo = delay + offset;
-        const int moffset = m * kernel_size;
-        ftype *Kum = Ku + moffset;
-        const ftype rm = r[m];
-
-        for (int n = 0; n < order; n++)
-            Kum[n] = rm * delayo[n];
-    }
-
-    for (int m = 0; m < order; m++) {
-        const int moffset = m * kernel_size;
-        const ftype *Kum = Ku + moffset;
-        ftype *IKum = IKu + moffset;
-
-        for (int n = 0; n < order; n++)
-            IKum[n] = F(1.0) * (m == n) - Kum[n];
-    }
-
-    for (int m = 0; m < order; m++) {
-        const int moffset = m * kernel_size;
-        const ftype *IKum = IKu + moffset;
-        ftype *Pm = P + moffset;
-
-        for (int n = 0; n < order; n++) {
-            const ftype *Pnn = Pn + n;
-            ftype sum = F(0.0);
-
-            for (int k = 0; k < order; k++, Pnn += kernel_size)
-                sum += IKum[k] * Pnn[0];
-            Pm[n] = sum;
-        }
-    }
+    /* (I - K x^T) P with K = P x ur equals P - ur r r^T, as P is symmetric */
+    s->dsp.fn(rank1)(P, kernel_size, r, r, F(1.0), -ur, order, order);
 
     switch (s->output_mode) {
     case IN_MODE:       output = input;         break;
@@ -88,6 +88,7 @@ extern const AVFilter ff_af_apad;
 extern const AVFilter ff_af_aperms;
 extern const AVFilter ff_af_aphaser;
 extern const AVFilter ff_af_aphaseshift;
+extern const AVFilter ff_af_apipeline;
 extern const AVFilter ff_af_apsnr;
 extern const AVFilter ff_af_apsyclip;
 extern const AVFilter ff_af_apulsator;
@@ -427,6 +428,7 @@ extern const AVFilter ff_vf_perms;
 extern const AVFilter ff_vf_perspective;
 extern const AVFilter ff_vf_phase;
 extern const AVFilter ff_vf_photosensitivity;
+extern const AVFilter ff_vf_pipeline;
 extern const AVFilter ff_vf_pixdesctest;
 extern const AVFilter ff_vf_pixelize;
 extern const AVFilter ff_vf_pixscope;
@@ -440,6 +442,7 @@ extern const AVFilter ff_vf_pseudocolor;
 extern const AVFilter ff_vf_psnr;
 extern const AVFilter ff_vf_pullup;
 extern const AVFilter ff_vf_qp;
+extern const AVFilter ff_vf_qualitymetrics;
 extern const AVFilter ff_vf_random;
 extern const AVFilter ff_vf_readeia608;
 extern const AVFilter ff_vf_readvitc;
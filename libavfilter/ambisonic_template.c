@@ -93,30 +93,61 @@ static int fn(transform)(AVFilterContext *ctx, void *arg,
     return 0;
 }
 
-static int fn(multiply)(AVFilterContext *ctx, void *arg,
-                        const int jobnr, const int nb_jobs)
+static int fn(decode)(AVFilterContext *ctx, void *arg,
+                      const int jobnr, const int nb_jobs)
 {
     AmbisonicContext *s = ctx->priv;
     ThreadData *td = arg;
     AVFrame *out = td->out;
-    AVFrame *in = td->in;
-    const double *gains_tab = td->gains_tab;
+    AVFrame *hf = td->in;
+    AVFrame *lf = td->lf;
     const int nb_channels = td->nb_channels;
     const int outputs = ambisonic_tab[s->layout].speakers;
-    const int inputs = ambisonic_tab[s->layout].inputs;
+    const int inputs = FFMIN3(nb_channels, s->max_channels, ambisonic_tab[s->layout].inputs);
+    const int nb_samples = FFALIGN(hf->nb_samples, 16);
     const int start = (outputs * jobnr) / nb_jobs;
     const int end = (outputs * (jobnr+1)) / nb_jobs;
+    const ftype *lf_src[MAX_CHANNELS], *hf_src[MAX_CHANNELS];
+    ftype lf_mul[MAX_CHANNELS], hf_mul[MAX_CHANNELS];
+
+    for (int ch2 = 0; ch2 < inputs; ch2++) {
+        const int index = FFMIN(s->seq_map[ch2], nb_channels - 1);
+
+        hf_src[ch2] = (const ftype *)hf->extended_data[index];
+        if (lf)
+            lf_src[ch2] = (const ftype *)lf->extended_data[index];
+    }
 
     for (int ch = start; ch < end; ch++) {
         ftype *dst = (ftype *)out->extended_data[ch];
 
-        for (int ch2 = 0; ch2 < FFMIN3(nb_channels, s->max_channels, inputs); ch2++) {
-            const int index = FFMIN(s->seq_map[ch2], nb_channels - 1);
-            const ftype *src = (const ftype *)in->extended_data[index];
-            const ftype gain = gains_tab ? gains_tab[ch2] : F(1.0);
-            const ftype mul = s->norm_decode_mat[ch][ch2] * gain;
+        for (int ch2 = 0; ch2 < inputs; ch2++) {
+            const ftype hf_gain = td->hf_gains ? td->hf_gains[ch2] : F(1.0);
 
-            VECTOR_MAC_SCALAR(dst, src, mul, FFALIGN(in->nb_samples, 16));
+            hf_mul[ch2] = s->norm_decode_mat[ch][ch2] * hf_gain;
+            if (lf) {
+                const ftype lf_gain = td->lf_gains[ch2];
+
+                lf_mul[ch2] = s->norm_decode_mat[ch][ch2] * lf_gain;
+            }
+        }
+
+        /* Accumulate all inputs of both bands into one block of the
+         * speaker feed while it is still in L1. */
+        for (int n = 0; n < nb_samples; n += DECODE_BLOCK_SIZE) {
+            const int len = FFMIN(DECODE_BLOCK_SIZE, nb_samples - n);
+
+            if (lf) {
+                for (int ch2 = 0; ch2 < inputs; ch2++) {
+                    if (lf_mul[ch2] != F(0.0))
+                        VECTOR_MAC_SCALAR(dst + n, lf_src[ch2] + n, lf_mul[ch2], len);
+                }
+            }
+
+            for (int ch2 = 0; ch2 < inputs; ch2++) {
+                if (hf_mul[ch2] != F(0.0))
+                    VECTOR_MAC_SCALAR(dst + n, hf_src[ch2] + n, hf_mul[ch2], len);
+            }
         }
     }
 
@@ -181,10 +212,19 @@ static void fn(xover_process)(Xover *xover, const ftype *src, ftype *dst,
     xover->w[1] = isnormal(w1) ? w1 : F(0.0);
 }
 
-static void fn(xover)(AmbisonicContext *s,
-                      AVFrame *in, AVFrame *lf, AVFrame *hf)
+static int fn(xover)(AVFilterContext *ctx, void *arg,
+                     const int jobnr, const int nb_jobs)
 {
-    for (int ch = 0; ch < in->ch_layout.nb_channels; ch++) {
+    AmbisonicContext *s = ctx->priv;
+    ThreadData *td = arg;
+    AVFrame *in = td->in;
+    AVFrame *lf = td->lf;
+    AVFrame *hf = td->out;
+    const int nb_channels = in->ch_layout.nb_channels;
+    const int start = (nb_channels * jobnr) / nb_jobs;
+    const int end = (nb_channels * (jobnr+1)) / nb_jobs;
+
+    for (int ch = start; ch < end; ch++) {
         fn(xover_process)(&s->xover[0][ch],
                           (const ftype *)in->extended_data[ch],
                           (ftype *)lf->extended_data[ch], in->nb_samples);
@@ -193,6 +233,8 @@ static void fn(xover)(AmbisonicContext *s,
                           (const ftype *)in->extended_data[ch],
                           (ftype *)hf->extended_data[ch], in->nb_samples);
     }
+
+    return 0;
 }
 
 static int fn(level)(AVFilterContext *ctx, void *arg,
@@ -228,29 +270,38 @@ static void fn(process)(AVFilterContext *ctx,
 
     ff_filter_execute(ctx, fn(transform), in, NULL, FFMIN(nb_out_channels, nb_threads));
 
-    if (s->near_field == NF_IN)
-        near_field(s, s->rframe, 0, 0);
-
-    if (s->xover_freq > 0.) {
-        fn(xover)(s, s->rframe, s->frame2, s->rframe);
-
-        td.gains_tab = s->gains_tab[0];
-        td.nb_channels = in->ch_layout.nb_channels;
-        td.in = s->frame2;
-        td.out = out;
-
-        ff_filter_execute(ctx, fn(multiply), &td, NULL, FFMIN(out->ch_layout.nb_channels, nb_threads));
+    if (s->near_field == NF_IN) {
+        td.in = s->rframe;
+        td.out_nf = 0;
+        td.add = 0;
+        ff_filter_execute(ctx, near_field, &td, NULL, FFMIN(s->rframe->ch_layout.nb_channels, nb_threads));
     }
 
-    td.gains_tab = s->xover_freq > 0. ? s->gains_tab[1] : NULL;
     td.nb_channels = in->ch_layout.nb_channels;
     td.in = s->rframe;
     td.out = out;
+    td.lf = NULL;
+    td.lf_gains = NULL;
+    td.hf_gains = NULL;
 
-    ff_filter_execute(ctx, fn(multiply), &td, NULL, FFMIN(out->ch_layout.nb_channels, nb_threads));
+    if (s->xover_freq > 0.) {
+        td.lf = s->frame2;
+        td.out = s->rframe;
+        ff_filter_execute(ctx, fn(xover), &td, NULL, FFMIN(s->rframe->ch_layout.nb_channels, nb_threads));
 
-    if (s->near_field == NF_OUT)
-        near_field(s, out, 1, 1);
+        td.out = out;
+        td.lf_gains = s->gains_tab[0];
+        td.hf_gains = s->gains_tab[1];
+    }
+
+    ff_filter_execute(ctx, fn(decode), &td, NULL, FFMIN(out->ch_layout.nb_channels, nb_threads));
+
+    if (s->near_field == NF_OUT) {
+        td.in = out;
+        td.out_nf = 1;
+        td.add = 1;
+        ff_filter_execute(ctx, near_field, &td, NULL, FFMIN(out->ch_layout.nb_channels, nb_threads));
+    }
 
     ff_filter_execute(ctx, fn(level), out, NULL, FFMIN(out->ch_layout.nb_channels, nb_threads));
 }
@@ -34,20 +34,14 @@
 #define fn(a)      fn2(a, SAMPLE_FORMAT)
 
 static ftype fn(fir_sample)(AudioNLMSContext *s, ftype sample, ftype *delay,
-                            ftype *coeffs, ftype *tmp, int *offset)
+                            const ftype *coeffs, int *offset)
 {
     const int order = s->order;
     ftype output;
 
     delay[*offset] = sample;
 
-    memcpy(tmp, coeffs + order - *offset, order * sizeof(ftype));
-
-#if DEPTH == 32
-    output = s->fdsp->scalarproduct_float(delay, tmp, s->kernel_size);
-#else
-    output = s->fdsp->scalarproduct_double(delay, tmp, s->kernel_size);
-#endif
+    output = s->dsp.fn(dot)(delay, coeffs + order - *offset, order);
 
     if (--(*offset) < 0)
         *offset = order - 1;
@@ -56,7 +50,7 @@ static ftype fn(fir_sample)(AudioNLMSContext *s, ftype sample, ftype *delay,
 }
 
 static ftype fn(process_sample)(AudioNLMSContext *s, ftype input, ftype desired,
-                                ftype *delay, ftype *coeffs, ftype *tmp, int *offsetp)
+                                ftype *delay, ftype *coeffs, int *offsetp)
 {
     const int order = s->order;
     const ftype leakage = s->leakage;
@@ -67,7 +61,7 @@ static ftype fn(process_sample)(AudioNLMSContext *s, ftype input, ftype desired,
 
     delay[offset + order] = input;
 
-    output = fn(fir_sample)(s, input, delay, coeffs, tmp, offsetp);
+    output = fn(fir_sample)(s, input, delay, coeffs, offsetp);
     e = desired - output;
 
 #if DEPTH == 32
@@ -80,15 +74,12 @@ static ftype fn(process_sample)(AudioNLMSContext *s, ftype input, ftype desired,
     if (s->anlmf)
         b *= e * e;
 
-    memcpy(tmp, delay + offset, order * sizeof(ftype));
-
 #if DEPTH == 32
     s->fdsp->vector_fmul_scalar(coeffs, coeffs, a, s->kernel_size);
-    s->fdsp->vector_fmac_scalar(coeffs, tmp, b, s->kernel_size);
 #else
     s->fdsp->vector_dmul_scalar(coeffs, coeffs, a, s->kernel_size);
-    s->fdsp->vector_dmac_scalar(coeffs, tmp, b, s->kernel_size);
 #endif
+    s->dsp.fn(axpy)(coeffs, delay + offset, b, order);
 
     memcpy(coeffs + order, coeffs, order * sizeof(ftype));
 
@@ -114,12 +105,11 @@ static int fn(filter_channels)(AVFilterContext *ctx, void *arg, int jobnr, int n
         const ftype *desired = (const ftype *)s->frame[1]->extended_data[c];
         ftype *delay = (ftype *)s->delay->extended_data[c];
         ftype *coeffs = (ftype *)s->coeffs->extended_data[c];
-        ftype *tmp = (ftype *)s->tmp->extended_data[c];
         int *offset = (int *)s->offset->extended_data[c];
         ftype *output = (ftype *)out->extended_data[c];
 
         for (int n = 0; n < out->nb_samples; n++) {
-            output[n] = fn(process_sample)(s, input[n], desired[n], delay, coeffs, tmp, offset);
+            output[n] = fn(process_sample)(s, input[n], desired[n], delay, coeffs, offset);
             if (ctx->is_disabled)
                 output[n] = input[n];
         }
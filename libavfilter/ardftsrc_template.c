@@ -132,7 +132,7 @@ static int fn(src_init)(AVFilterContext *ctx)
         if (ret < 0)
             return ret;
 
-        stc->over = av_calloc(s->out_nb_samples, sizeof(*stc->over));
+        stc->over = av_calloc(s->out_rdft_size, sizeof(*stc->over));
         if (!stc->over)
             return AVERROR(ENOMEM);
 
@@ -190,11 +190,13 @@ static int fn(src)(AVFilterContext *ctx, AVFrame *in, AVFrame *out,
     const int offset = tr_nb_samples - taper_samples;
     const int write_samples = FFMIN(out_nb_samples, out->nb_samples-doffset);
     const int copy_samples = FFMIN(in_nb_samples, in->nb_samples-soffset);
+    const int over_samples = s->out_rdft_size - write_samples;
     const ttype *taper = s->taper;
 
 #if DEPTH == 16
+    /* the scaling to and from the s16 range is left to the caller */
     for (int n = 0; n < copy_samples; n++)
-        rdft0[in_offset+n] = src[n] / F(1<<(DEPTH-1));
+        rdft0[in_offset+n] = src[n];
 #else
     memcpy(rdft0 + in_offset, src, copy_samples * sizeof(*rdft0));
 #endif
@@ -203,24 +205,23 @@ static int fn(src)(AVFilterContext *ctx, AVFrame *in, AVFrame *out,
     stc->tx_fn(stc->tx_ctx, rdft1, rdft0, sizeof(*rdft0));
 
     memset(irdft0 + tr_nb_samples, 0, (s->out_rdft_size / 2 + 1 - tr_nb_samples) * sizeof(*irdft0));
-    memcpy(irdft0, rdft1, tr_nb_samples * sizeof(*irdft0));
+    memcpy(irdft0, rdft1, offset * sizeof(*irdft0));
     for (int n = 0, m = offset; n < taper_samples; n++, m++) {
-        irdft0[m].re *= taper[n].re;
-        irdft0[m].im *= taper[n].im;
+        irdft0[m].re = rdft1[m].re * taper[n].re;
+        irdft0[m].im = rdft1[m].im * taper[n].im;
     }
 
     stc->itx_fn(stc->itx_ctx, irdft1, irdft0, sizeof(*irdft0));
 
-#if DEPTH == 16
     for (int n = 0; n < write_samples; n++) {
-        dst[n] = av_clip_int16(lrintf((irdft1[n] + over[n]) * F(1<<(DEPTH-1))));
-    }
+#if DEPTH == 16
+        dst[n] = av_clip_int16(lrintf(irdft1[n] + over[n]));
 #else
-    memcpy(dst, irdft1, write_samples * sizeof(*dst));
-    for (int n = 0; n < write_samples; n++)
-        dst[n] += over[n];
+        dst[n] = irdft1[n] + over[n];
 #endif
-    memcpy(over, irdft1 + write_samples, sizeof(*over) * out_nb_samples);
+    }
+    memcpy(over, irdft1 + write_samples, sizeof(*over) * over_samples);
+    memset(over + over_samples, 0, sizeof(*over) * FFMAX(out_nb_samples - over_samples, 0));
 
     return 0;
 }
@@ -236,7 +237,7 @@ static int fn(flush)(AVFilterContext *ctx, AVFrame *out, const int ch)
 
 #if DEPTH == 16
     for (int n = 0; n < nb_samples; n++)
-        dst[n] = av_clip_int16(lrintf(over[n] * F(1<<(DEPTH-1))));
+        dst[n] = av_clip_int16(lrintf(over[n]));
 #else
     memcpy(dst, over, nb_samples * sizeof(*dst));
 #endif
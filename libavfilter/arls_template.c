@@ -33,20 +33,14 @@
 #define fn(a)      fn2(a, SAMPLE_FORMAT)
 
 static ftype fn(fir_sample)(AudioRLSContext *s, ftype sample, ftype *delay,
-                            ftype *coeffs, ftype *tmp, int *offset)
+                            const ftype *coeffs, int *offset)
 {
     const int order = s->order;
     ftype output;
 
     delay[*offset] = sample;
 
-    memcpy(tmp, coeffs + order - *offset, order * sizeof(ftype));
-
-#if DEPTH == 32
-    output = s->fdsp->scalarproduct_float(delay, tmp, s->kernel_size);
-#else
-    output = s->fdsp->scalarproduct_double(delay, tmp, s->kernel_size);
-#endif
+    output = s->dsp.fn(dot)(delay, coeffs + order - *offset, order);
 
     if (--(*offset) < 0)
         *offset = order - 1;
@@ -58,59 +52,31 @@ static ftype fn(process_sample)(AudioRLSContext *s, ftype input, ftype desired,
 {
     ftype *coeffs = (ftype *)s->coeffs->extended_data[ch];
     ftype *delay = (ftype *)s->delay->extended_data[ch];
-    ftype *gains = (ftype *)s->gains->extended_data[ch];
-    ftype *tmp = (ftype *)s->tmp->extended_data[ch];
     ftype *u = (ftype *)s->u->extended_data[ch];
     ftype *p = (ftype *)s->p->extended_data[ch];
-    ftype *dp = (ftype *)s->dp->extended_data[ch];
     int *offsetp = (int *)s->offset->extended_data[ch];
     const int kernel_size = s->kernel_size;
     const int order = s->order;
     const ftype lambda = s->lambda;
-    int offset = *offsetp;
-    ftype g = lambda;
-    ftype output, e;
+    const int offset = *offsetp;
+    const ftype *x = delay + offset;
+    ftype output, e, g;
 
     delay[offset + order] = input;
 
-    output = fn(fir_sample)(s, input, delay, coeffs, tmp, offsetp);
+    output = fn(fir_sample)(s, input, delay, coeffs, offsetp);
     e = desired - output;
 
-    for (int i = 0, pos = offset; i < order; i++, pos++) {
-        const int ikernel_size = i * kernel_size;
-
-        u[i] = F(0.0);
-        for (int k = 0, pos = offset; k < order; k++, pos++)
-            u[i] += p[ikernel_size + k] * delay[pos];
-
-        g += u[i] * delay[pos];
-    }
-
-    g = F(1.0) / g;
-
-    for (int i = 0; i < order; i++) {
-        const int ikernel_size = i * kernel_size;
+    for (int i = 0; i < order; i++)
+        u[i] = s->dsp.fn(dot)(p + i * kernel_size, x, order);
 
-        gains[i] = u[i] * g;
-        coeffs[i] = coeffs[order + i] = coeffs[i] + gains[i] * e;
-        tmp[i] = F(0.0);
-        for (int k = 0, pos = offset; k < order; k++, pos++)
-            tmp[i] += p[ikernel_size + k] * delay[pos];
-    }
+    g = F(1.0) / (lambda + s->dsp.fn(dot)(u, x, order));
 
-    for (int i = 0; i < order; i++) {
-        const int ikernel_size = i * kernel_size;
+    s->dsp.fn(axpy)(coeffs, u, g * e, order);
+    memcpy(coeffs + order, coeffs, order * sizeof(*coeffs));
 
-        for (int k = 0; k < order; k++)
-            dp[ikernel_size + k] = gains[i] * tmp[k];
-    }
-
-    for (int i = 0; i < order; i++) {
-        const int ikernel_size = i * kernel_size;
-
-        for (int k = 0; k < order; k++)
-            p[ikernel_size + k] = (p[ikernel_size + k] - (dp[ikernel_size + k] + dp[kernel_size * k + i]) * F(0.5)) * lambda;
-    }
+    /* P is symmetric, so P x x^T P is the outer product of u with itself */
+    s->dsp.fn(rank1)(p, kernel_size, u, u, lambda, -lambda * g, order, order);
 
     switch (s->output_mode) {
     case IN_MODE:       output = input;         break;
@@ -51,24 +51,6 @@
 #define fn2(a,b)   fn3(a,b)
 #define fn(a)      fn2(a, SAMPLE_FORMAT)
 
-static void fn(update_peak)(AudioStatsContext *s, ChannelStats *p, stype d)
-{
-    double n = SCALE(d);
-
-    if (n < p->nmin)
-        p->nmin = n;
-    if (n > p->nmax)
-        p->nmax = n;
-}
-
-static void fn(update_minmax)(AudioStatsContext *s, ChannelStats *p, stype d)
-{
-    if (d < p->min)
-        p->min = d;
-    if (d > p->max)
-        p->max = d;
-}
-
 static inline void fn(update_float_stat)(AudioStatsContext *s, ChannelStats *p, stype d)
 {
 #if (DEPTH == 32) || (DEPTH == 64)
@@ -80,109 +62,89 @@ static inline void fn(update_float_stat)(AudioStatsContext *s, ChannelStats *p,
 #endif
 }
 
-static inline void fn(update_stat)(AudioStatsContext *s, ChannelStats *p, stype src,
-                                   uint32_t mask)
+static void fn(update_bit_depth)(ChannelStats *p, const stype *src, ptrdiff_t stride,
+                                 const double *d, int nb_samples)
 {
-    int64_t fixed = FIXED(src);
-    double scaled = SCALE(src);
-    double abs_d = FFABS(scaled);
-    double drop, noise_floor;
-    double d = src;
-
-    if (p->abs_peak < abs_d) {
-        p->abs_peak = abs_d;
-        p->abs_peak_count = 1;
-    } else if (p->abs_peak == abs_d) {
-        p->abs_peak_count++;
-    }
-    p->clip_count += fabs(scaled) > 1.0;
-    if (d < p->min) {
-        p->min = d;
-        p->nmin = scaled;
-        p->min_run = 1;
-        p->min_runs = 0;
-        p->min_count = 1;
-    } else if (d == p->min) {
-        p->min_count++;
-        p->min_run = d == p->last ? p->min_run + 1 : 1;
-    } else if (p->last == p->min) {
-        p->min_runs += p->min_run * p->min_run;
+    uint64_t mask0 = p->mask[0], mask1 = p->mask[1], mask2 = p->mask[2], mask3 = p->mask[3];
+    int64_t lasti = p->lasti;
+    double last = p->last;
+
+    for (int n = 0; n < nb_samples; n++) {
+        const int64_t fixed = FIXED(src[n * stride]);
+
+        mask0 |= (fixed < 0) ? -fixed : fixed;
+        mask1 |= fixed;
+        mask2 &= fixed;
+        if (!isnan(last))
+            mask3 |= fixed ^ lasti;
+        lasti = fixed;
+        last = d[n];
     }
 
-    if (d != 0 && FFABS(d) < p->min_non_zero)
-        p->min_non_zero = FFABS(d);
+    p->mask[0] = mask0;
+    p->mask[1] = mask1;
+    p->mask[2] = mask2;
+    p->mask[3] = mask3;
+    p->lasti = lasti;
+}
 
-    if (d > p->max) {
-        p->max = d;
-        p->nmax = scaled;
-        p->max_run = 1;
-        p->max_runs = 0;
-        p->max_count = 1;
-    } else if (d == p->max) {
-        p->max_count++;
-        p->max_run = d == p->last ? p->max_run + 1 : 1;
-    } else if (p->last == p->max) {
-        p->max_runs += p->max_run * p->max_run;
-    }
+static void fn(update_minmax)(ChannelStats *p, const stype *src,
+                              ptrdiff_t stride, int nb_samples)
+{
+    double min = p->min, nmin = p->nmin;
+    double max = p->max, nmax = p->nmax;
 
-    if (d != 0) {
-        p->zero_runs += FFSIGN(d) != FFSIGN(p->last_non_zero);
-        p->last_non_zero = d;
-    }
+    for (int n = 0; n < nb_samples; n++) {
+        const double v = src[n * stride];
 
-    p->sigma_x += scaled;
-    p->sigma_ax += fabs(scaled);
-    if (fabs(scaled) > 1e-16)
-        p->sigma_log2_ax += log2(fabs(scaled));
-    p->sigma_x2 += scaled * scaled;
-    p->avg_sigma_x2 = p->avg_sigma_x2 * s->mult + (1.0 - s->mult) * scaled * scaled;
-    if (!isnan(p->last)) {
-        p->min_diff = FFMIN(p->min_diff, fabs(d - p->last));
-        p->max_diff = FFMAX(p->max_diff, fabs(d - p->last));
-        p->diff1_sum += fabs(d - p->last);
-        p->diff1_sum_x2 += (d - p->last) * (d - p->last);
+        if (v < min) {
+            min = v;
+            nmin = SCALE(src[n * stride]);
+        }
+        if (v > max) {
+            max = v;
+            nmax = SCALE(src[n * stride]);
+        }
     }
-    p->mask[0] |= (fixed < 0) ? -fixed : fixed;
-    p->mask[1] |= fixed;
-    p->mask[2] &= fixed;
-    if (!isnan(p->last))
-        p->mask[3] |= fixed ^ p->lasti;
-    p->lasti = fixed;
-    p->last = d;
 
-    drop = p->win_samples[p->win_pos];
-    p->win_samples[p->win_pos] = scaled;
-    p->win_pos++;
+    p->min = min;
+    p->nmin = nmin;
+    p->max = max;
+    p->nmax = nmax;
+    p->last = src[(nb_samples - 1) * stride];
+    p->nb_samples += nb_samples;
+}
 
-    if (p->win_pos >= s->tc_samples)
-        p->win_pos = 0;
+static void fn(update_stats)(AudioStatsContext *s, ChannelStats *p, const stype *src,
+                             ptrdiff_t stride, int nb_samples, uint32_t mask)
+{
+    double d[ASTATS_BLOCK_SIZE], x[ASTATS_BLOCK_SIZE];
 
-    if (p->nb_samples >= s->tc_samples) {
-        p->max_sigma_x2 = FFMAX(p->max_sigma_x2, p->avg_sigma_x2);
-        p->min_sigma_x2 = FFMIN(p->min_sigma_x2, p->avg_sigma_x2);
+    if (!(mask & ~MEASURE_MINMAX)) {
+        if (nb_samples > 0)
+            fn(update_minmax)(p, src, stride, nb_samples);
+        return;
     }
-    p->nb_samples++;
 
-    if (mask & MEASURE_NOISE_FLOOR) {
-        noise_floor = calc_noise_floor(p->sorted_samples, scaled, drop,
-                                       s->tc_samples, &p->sorted_front, &p->sorted_back);
-        if (p->nb_samples >= s->tc_samples) {
-            if (isnan(p->noise_floor)) {
-                p->noise_floor = noise_floor;
-                p->noise_floor_count = 1;
-            } else {
-                if (noise_floor < p->noise_floor) {
-                    p->noise_floor = noise_floor;
-                    p->noise_floor_count = 1;
-                } else if (noise_floor == p->noise_floor) {
-                    p->noise_floor_count++;
-                }
-            }
+    while (nb_samples > 0) {
+        const int nb = FFMIN(nb_samples, ASTATS_BLOCK_SIZE);
+
+        for (int n = 0; n < nb; n++) {
+            d[n] = src[n * stride];
+            x[n] = SCALE(src[n * stride]);
         }
-    }
 
-    if (mask & MEASURE_DENORMALS)
-        fn(update_float_stat)(s, p, scaled);
+        if (mask & MEASURE_BIT_DEPTH)
+            fn(update_bit_depth)(p, src, stride, d, nb);
+        if (mask & MEASURE_DENORMALS) {
+            for (int n = 0; n < nb; n++)
+                fn(update_float_stat)(s, p, src[n * stride]);
+        }
+        update_block(s, p, d, x, nb, mask);
+
+        src        += nb * stride;
+        nb_samples -= nb;
+    }
 }
 
 static int fn(filter_channels_planar)(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
@@ -195,35 +157,9 @@ static int fn(filter_channels_planar)(AVFilterContext *ctx, void *arg, int jobnr
     const int start = (channels * jobnr) / nb_jobs;
     const int end = (channels * (jobnr+1)) / nb_jobs;
     const uint32_t mask = s->measure_overall | s->measure_perchannel;
-    const int measure_denormals = mask == (mask & MEASURE_DENORMALS);
-    const int measure_minmax = mask == (mask & MEASURE_MINMAX);
-    const int measure_peak = mask == MEASURE_PEAK;
-
-    for (int c = start; c < end; c++) {
-        ChannelStats *p = &s->chstats[c];
-        const stype *src = (const stype *)data[c];
-
-        if (measure_peak) {
-            for (int n = 0; n < samples; n++)
-                fn(update_peak)(s, p, src[n]);
-            continue;
-        }
 
-        if (measure_minmax) {
-            for (int n = 0; n < samples; n++)
-                fn(update_minmax)(s, p, src[n]);
-            continue;
-        }
-
-        if (measure_denormals) {
-            for (int n = 0; n < samples; n++)
-                fn(update_float_stat)(s, p, src[n]);
-            continue;
-        }
-
-        for (int n = 0; n < samples; n++)
-            fn(update_stat)(s, p, src[n], mask);
-    }
+    for (int c = start; c < end; c++)
+        fn(update_stats)(s, &s->chstats[c], (const stype *)data[c], 1, samples, mask);
 
     return 0;
 }
@@ -238,36 +174,9 @@ static int fn(filter_channels_packed)(AVFilterContext *ctx, void *arg, int jobnr
     const int start = (in->ch_layout.nb_channels * jobnr) / nb_jobs;
     const int end = (in->ch_layout.nb_channels * (jobnr+1)) / nb_jobs;
     const uint32_t mask = s->measure_overall | s->measure_perchannel;
-    const int measure_denormals = mask == (mask & MEASURE_DENORMALS);
-    const int measure_minmax = mask == (mask & MEASURE_MINMAX);
-    const int measure_peak = mask == MEASURE_PEAK;
-
-    for (int c = start; c < end; c++) {
-        ChannelStats *p = &s->chstats[c];
-        const stype *src = (const stype *)data[0];
-        const stype * const srcend = src + samples * channels;
 
-        if (measure_peak) {
-            for (src += c; src < srcend; src += channels)
-                fn(update_peak)(s, p, src[0]);
-            continue;
-        }
-
-        if (measure_minmax) {
-            for (src += c; src < srcend; src += channels)
-                fn(update_minmax)(s, p, src[0]);
-            continue;
-        }
-
-        if (measure_denormals) {
-            for (src += c; src < srcend; src += channels)
-                fn(update_float_stat)(s, p, src[0]);
-            continue;
-        }
-
-        for (src += c; src < srcend; src += channels)
-            fn(update_stat)(s, p, src[0], mask);
-    }
+    for (int c = start; c < end; c++)
+        fn(update_stats)(s, &s->chstats[c], (const stype *)data[0] + c, channels, samples, mask);
 
     return 0;
 }
@@ -19,11 +19,14 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include <string.h>
+
 #include "libavutil/avassert.h"
 #include "libavutil/channel_layout.h"
 #include "libavutil/common.h"
 #include "libavutil/cpu.h"
 #include "libavutil/eval.h"
+#include "libavutil/samplefmt.h"
 
 #include "audio.h"
 #include "avfilter.h"
@@ -82,6 +85,9 @@ AVFrame *ff_default_get_audio_buffer(AVFilterLink *link, int nb_samples)
     if (!frame)
         return NULL;
 
+    for (int i = 0; i < FF_ARRAY_ELEMS(frame->buf) && frame->buf[i]; i++)
+        fffilterctx(link->src)->stats.pool_bytes += frame->buf[i]->size;
+
     frame->nb_samples = nb_samples;
     if (link->ch_layout.order != AV_CHANNEL_ORDER_UNSPEC &&
         av_channel_layout_copy(&frame->ch_layout, &link->ch_layout) < 0) {
@@ -108,6 +114,27 @@ AVFrame *ff_get_audio_buffer(AVFilterLink *link, int nb_samples)
     return ret;
 }
 
+int ff_audio_frame_is_silent(const AVFrame *frame)
+{
+    const int planar   = av_sample_fmt_is_planar(frame->format);
+    const int channels = frame->ch_layout.nb_channels;
+    const size_t size  = (size_t)frame->nb_samples * (planar ? 1 : channels) *
+                         av_get_bytes_per_sample(frame->format);
+    const uint8_t fill = av_get_packed_sample_fmt(frame->format) == AV_SAMPLE_FMT_U8 ? 0x80 : 0;
+
+    if (!size)
+        return 1;
+
+    for (int p = 0; p < (planar ? channels : 1); p++) {
+        const uint8_t *src = frame->extended_data[p];
+
+        if (src[0] != fill || memcmp(src, src + 1, size - 1))
+            return 0;
+    }
+
+    return 1;
+}
+
 int ff_parse_sample_rate(int *ret, const char *arg, void *log_ctx)
 {
     char *tail;
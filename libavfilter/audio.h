@@ -47,6 +47,16 @@ AVFrame *ff_null_get_audio_buffer(AVFilterLink *link, int nb_samples);
  */
 AVFrame *ff_get_audio_buffer(AVFilterLink *link, int nb_samples);
 
+/**
+ * Check whether all samples of an audio frame are digital silence.
+ *
+ * Returns early on the first non-silent sample, so the check is cheap for
+ * active audio. Negative zero is not treated as silence.
+ *
+ * @return 1 if the frame only contains silence, 0 otherwise
+ */
+int ff_audio_frame_is_silent(const AVFrame *frame);
+
 /**
  * Parse a sample rate.
  *
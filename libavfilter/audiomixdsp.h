@@ -0,0 +1,89 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFILTER_AUDIOMIXDSP_H
+#define AVFILTER_AUDIOMIXDSP_H
+
+#include "libavutil/attributes.h"
+
+/**
+ * Gain and mixing kernels for planar float and double audio, shared by
+ * the filters that apply per-sample gains or mix two signals. Pointers
+ * need no particular alignment, lengths may be anything, and dst may be
+ * the same as any of the sources.
+ */
+typedef struct AudioMixDSPContext {
+    /**
+     * Compute dst[i] = src[i] * gain.
+     */
+    void (*scale_float)(float *dst, const float *src, float gain, int len);
+    void (*scale_double)(double *dst, const double *src, double gain, int len);
+
+    /**
+     * Compute dst[i] = src[i] * gain[i].
+     */
+    void (*gain_float)(float *dst, const float *src, const float *gain, int len);
+    void (*gain_double)(double *dst, const double *src, const double *gain, int len);
+
+    /**
+     * Compute dst[i] = src0[i] * gain0[i] + src1[i] * gain1[i].
+     */
+    void (*crossfade_float)(float *dst, const float *src0, const float *gain0,
+                            const float *src1, const float *gain1, int len);
+    void (*crossfade_double)(double *dst, const double *src0, const double *gain0,
+                             const double *src1, const double *gain1, int len);
+} AudioMixDSPContext;
+
+#define AUDIO_MIX_FUNCS(ftype, name)                                        \
+static void scale_##name##_c(ftype *dst, const ftype *src,                  \
+                             ftype gain, int len)                           \
+{                                                                           \
+    for (int i = 0; i < len; i++)                                           \
+        dst[i] = src[i] * gain;                                             \
+}                                                                           \
+                                                                            \
+static void gain_##name##_c(ftype *dst, const ftype *src,                   \
+                            const ftype *gain, int len)                     \
+{                                                                           \
+    for (int i = 0; i < len; i++)                                           \
+        dst[i] = src[i] * gain[i];                                          \
+}                                                                           \
+                                                                            \
+static void crossfade_##name##_c(ftype *dst,                                \
+                                 const ftype *src0, const ftype *gain0,     \
+                                 const ftype *src1, const ftype *gain1,     \
+                                 int len)                                   \
+{                                                                           \
+    for (int i = 0; i < len; i++)                                           \
+        dst[i] = src0[i] * gain0[i] + src1[i] * gain1[i];                   \
+}
+
+AUDIO_MIX_FUNCS(float,  float)
+AUDIO_MIX_FUNCS(double, double)
+
+static av_unused void ff_audio_mix_init(AudioMixDSPContext *dsp)
+{
+    dsp->scale_float      = scale_float_c;
+    dsp->scale_double     = scale_double_c;
+    dsp->gain_float       = gain_float_c;
+    dsp->gain_double      = gain_double_c;
+    dsp->crossfade_float  = crossfade_float_c;
+    dsp->crossfade_double = crossfade_double_c;
+}
+
+#endif /* AVFILTER_AUDIOMIXDSP_H */
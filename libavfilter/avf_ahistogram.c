@@ -19,6 +19,7 @@
  */
 
 #include "libavutil/avassert.h"
+#include "libavutil/imgutils.h"
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "avfilter.h"
@@ -194,35 +195,74 @@ static int config_output(AVFilterLink *outlink)
     return 0;
 }
 
-static int filter_frame(AVFilterLink *inlink, AVFrame *in)
+/*
+ * Make s->out writable for the next picture. The sonogram rows are carried
+ * over from the previous picture, already scrolled by one row in scroll mode,
+ * so that a picture still referenced downstream costs a single copy of the
+ * sonogram instead of a full frame copy followed by a scroll in place.
+ */
+static int prepare_canvas(AVFilterLink *outlink)
 {
-    AVFilterContext *ctx = inlink->dst;
-    AVFilterLink *outlink = ctx->outputs[0];
-    AudioHistogramContext *s = ctx->priv;
-    const int nb_samples = in->nb_samples;
+    AudioHistogramContext *s = outlink->src->priv;
     const int H = s->histogram_h;
+    const int R = s->h - H;
+    const int shift = s->slide == SCROLL;
     const int w = s->w;
-    int c, y, n, p, bin, ret;
-    uint64_t acmax = 1;
-    AVFrame *clone;
+    AVFrame *prev = s->out;
+    int n, p;
 
-    if (!s->out || s->out->width  != outlink->w ||
-                   s->out->height != outlink->h) {
-        av_frame_free(&s->out);
-        s->out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
-        if (!s->out) {
-            av_frame_free(&in);
-            return AVERROR(ENOMEM);
+    if (prev && av_frame_is_writable(prev)) {
+        if (shift) {
+            for (p = 0; p < 4; p++) {
+                for (n = s->h - 1; n >= H + 2; n--) {
+                    memcpy(prev->data[p] +  n      * prev->linesize[p],
+                           prev->data[p] + (n - 1) * prev->linesize[p], w);
+                }
+            }
         }
+        return 0;
+    }
+
+    s->out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
+    if (!s->out) {
+        av_frame_free(&prev);
+        return AVERROR(ENOMEM);
+    }
+
+    if (!prev) {
         for (n = H; n < s->h; n++) {
             memset(s->out->data[0] + n * s->out->linesize[0], 0, w);
             memset(s->out->data[1] + n * s->out->linesize[0], 127, w);
             memset(s->out->data[2] + n * s->out->linesize[0], 127, w);
             memset(s->out->data[3] + n * s->out->linesize[0], 0, w);
         }
+        return 0;
     }
 
-    ret = ff_inlink_make_frame_writable(outlink, &s->out);
+    for (p = 0; p < 4 && R > 2 * shift; p++) {
+        av_image_copy_plane(s->out->data[p] + (H + 2 * shift) * s->out->linesize[p],
+                            s->out->linesize[p],
+                            prev->data[p] + (H + shift) * prev->linesize[p],
+                            prev->linesize[p], w, R - 2 * shift);
+    }
+    av_frame_free(&prev);
+
+    return 0;
+}
+
+static int filter_frame(AVFilterLink *inlink, AVFrame *in)
+{
+    AVFilterContext *ctx = inlink->dst;
+    AVFilterLink *outlink = ctx->outputs[0];
+    AudioHistogramContext *s = ctx->priv;
+    const int nb_samples = in->nb_samples;
+    const int H = s->histogram_h;
+    const int w = s->w;
+    int c, y, n, p, bin, ret;
+    uint64_t acmax = 1;
+    AVFrame *clone;
+
+    ret = prepare_canvas(outlink);
     if (ret < 0) {
         av_frame_free(&in);
         return ret;
@@ -417,12 +457,10 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
             }
         }
 
-        if (s->slide == SCROLL) {
+        if (s->slide == SCROLL && s->h - H > 1) {
             for (p = 0; p < 4; p++) {
-                for (y = s->h - 1; y >= H + 1; y--) {
-                    memmove(s->out->data[p] + (y  ) * s->out->linesize[p],
-                            s->out->data[p] + (y-1) * s->out->linesize[p], w);
-                }
+                memcpy(s->out->data[p] + (H + 1) * s->out->linesize[p],
+                       s->out->data[p] +  H      * s->out->linesize[p], w);
             }
         }
 
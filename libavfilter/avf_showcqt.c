@@ -26,6 +26,7 @@
 #include "libavutil/xga_font_data.h"
 #include "libavutil/eval.h"
 #include "libavutil/pixdesc.h"
+#include "libavutil/thread.h"
 #include "libavutil/time.h"
 #include "audio.h"
 #include "avfilter.h"
@@ -107,6 +108,53 @@ static const AVOption showcqt_options[] = {
 
 AVFILTER_DEFINE_CLASS(showcqt);
 
+typedef struct CQTKernel {
+    struct CQTKernel *next;
+    int refcount;
+    /* everything the kernel is computed from */
+    int sample_rate;
+    int fft_len;
+    int cqt_len;
+    int cqt_align;
+    double basefreq;
+    double endfreq;
+    double timeclamp;
+    char *tlength;
+    void (*permute_coeffs)(float *v, int len);
+    Coeffs *coeffs;
+} CQTKernel;
+
+static AVMutex kernel_cache_lock = AV_MUTEX_INITIALIZER;
+static CQTKernel *kernel_cache;
+
+static void free_kernel(CQTKernel *kernel)
+{
+    if (kernel->coeffs)
+        for (int k = 0; k < kernel->cqt_len; k++)
+            av_freep(&kernel->coeffs[k].val);
+    av_freep(&kernel->coeffs);
+    av_freep(&kernel->tlength);
+    av_free(kernel);
+}
+
+static void release_kernel(CQTKernel *kernel)
+{
+    if (!kernel)
+        return;
+
+    ff_mutex_lock(&kernel_cache_lock);
+    if (!--kernel->refcount) {
+        for (CQTKernel **k = &kernel_cache; *k; k = &(*k)->next) {
+            if (*k == kernel) {
+                *k = kernel->next;
+                break;
+            }
+        }
+        free_kernel(kernel);
+    }
+    ff_mutex_unlock(&kernel_cache_lock);
+}
+
 static void common_uninit(ShowCQTContext *s)
 {
     int k;
@@ -147,10 +195,9 @@ static void common_uninit(ShowCQTContext *s)
     av_frame_free(&s->axis_frame);
     av_frame_free(&s->sono_frame);
     av_tx_uninit(&s->fft_ctx);
-    if (s->coeffs)
-        for (k = 0; k < s->cqt_len; k++)
-            av_freep(&s->coeffs[k].val);
-    av_freep(&s->coeffs);
+    release_kernel(s->kernel);
+    s->kernel = NULL;
+    s->coeffs = NULL;
     av_freep(&s->fft_data);
     av_freep(&s->fft_input);
     av_freep(&s->fft_result);
@@ -296,7 +343,18 @@ static void cqt_calc(AVComplexFloat *dst, const AVComplexFloat *src, const Coeff
     }
 }
 
-static int init_cqt(ShowCQTContext *s)
+av_cold void ff_showcqt_init_dsp(ShowCQTContext *s)
+{
+    s->cqt_align = 1;
+    s->cqt_calc = cqt_calc;
+    s->permute_coeffs = NULL;
+
+#if ARCH_X86
+    ff_showcqt_init_x86(s);
+#endif
+}
+
+static int build_kernel(ShowCQTContext *s, Coeffs *coeffs)
 {
     const char *var_names[] = { "timeclamp", "tc", "frequency", "freq", "f", NULL };
     AVExpr *expr = NULL;
@@ -308,9 +366,6 @@ static int init_cqt(ShowCQTContext *s)
         goto error;
 
     ret = AVERROR(ENOMEM);
-    if (!(s->coeffs = av_calloc(s->cqt_len, sizeof(*s->coeffs))))
-        goto error;
-
     for (k = 0; k < s->cqt_len; k++) {
         double vars[] = { s->timeclamp, s->timeclamp, s->freq[k], s->freq[k], s->freq[k] };
         double flen, center, tlength;
@@ -326,10 +381,10 @@ static int init_cqt(ShowCQTContext *s)
         start = FFMAX(0, ceil(center - 0.5 * flen));
         end = FFMIN(s->fft_len, floor(center + 0.5 * flen));
 
-        s->coeffs[m].start = start & ~(s->cqt_align - 1);
-        s->coeffs[m].len = (end | (s->cqt_align - 1)) + 1 - s->coeffs[m].start;
-        nb_cqt_coeffs += s->coeffs[m].len;
-        if (!(s->coeffs[m].val = av_calloc(s->coeffs[m].len, sizeof(*s->coeffs[m].val))))
+        coeffs[m].start = start & ~(s->cqt_align - 1);
+        coeffs[m].len = (end | (s->cqt_align - 1)) + 1 - coeffs[m].start;
+        nb_cqt_coeffs += coeffs[m].len;
+        if (!(coeffs[m].val = av_calloc(coeffs[m].len, sizeof(*coeffs[m].val))))
             goto error;
 
         for (x = start; x <= end; x++) {
@@ -338,11 +393,11 @@ static int init_cqt(ShowCQTContext *s)
             /* nuttall window */
             double w = 0.355768 + 0.487396 * cos(y) + 0.144232 * cos(2*y) + 0.012604 * cos(3*y);
             w *= sign * (1.0 / s->fft_len);
-            s->coeffs[m].val[x - s->coeffs[m].start] = w;
+            coeffs[m].val[x - coeffs[m].start] = w;
         }
 
         if (s->permute_coeffs)
-            s->permute_coeffs(s->coeffs[m].val, s->coeffs[m].len);
+            s->permute_coeffs(coeffs[m].val, coeffs[m].len);
     }
 
     av_expr_free(expr);
@@ -351,13 +406,65 @@ static int init_cqt(ShowCQTContext *s)
 
 error:
     av_expr_free(expr);
-    if (s->coeffs)
-        for (k = 0; k < s->cqt_len; k++)
-            av_freep(&s->coeffs[k].val);
-    av_freep(&s->coeffs);
     return ret;
 }
 
+static int init_cqt(ShowCQTContext *s)
+{
+    const int rate = s->ctx->inputs[0]->sample_rate;
+    CQTKernel *kernel;
+    int ret = 0;
+
+    /* the kernel is expensive to compute for long transforms and is never
+     * modified afterwards, so it is shared by all instances that would
+     * compute the same one */
+    ff_mutex_lock(&kernel_cache_lock);
+    for (kernel = kernel_cache; kernel; kernel = kernel->next) {
+        if (kernel->sample_rate    == rate           &&
+            kernel->fft_len        == s->fft_len     &&
+            kernel->cqt_len        == s->cqt_len     &&
+            kernel->cqt_align      == s->cqt_align   &&
+            kernel->basefreq       == s->basefreq    &&
+            kernel->endfreq        == s->endfreq     &&
+            kernel->timeclamp      == s->timeclamp   &&
+            kernel->permute_coeffs == s->permute_coeffs &&
+            !strcmp(kernel->tlength, s->tlength))
+            break;
+    }
+    if (kernel) {
+        kernel->refcount++;
+    } else if (!(kernel = av_mallocz(sizeof(*kernel)))) {
+        ret = AVERROR(ENOMEM);
+    } else {
+        kernel->sample_rate    = rate;
+        kernel->fft_len        = s->fft_len;
+        kernel->cqt_len        = s->cqt_len;
+        kernel->cqt_align      = s->cqt_align;
+        kernel->basefreq       = s->basefreq;
+        kernel->endfreq        = s->endfreq;
+        kernel->timeclamp      = s->timeclamp;
+        kernel->permute_coeffs = s->permute_coeffs;
+        if (!(kernel->tlength = av_strdup(s->tlength)) ||
+            !(kernel->coeffs = av_calloc(s->cqt_len, sizeof(*kernel->coeffs))) ||
+            (ret = build_kernel(s, kernel->coeffs)) < 0) {
+            free_kernel(kernel);
+            ret = ret < 0 ? ret : AVERROR(ENOMEM);
+        } else {
+            kernel->refcount = 1;
+            kernel->next = kernel_cache;
+            kernel_cache = kernel;
+        }
+    }
+    ff_mutex_unlock(&kernel_cache_lock);
+    if (ret < 0)
+        return ret;
+
+    s->kernel = kernel;
+    s->coeffs = kernel->coeffs;
+
+    return 0;
+}
+
 static AVFrame *alloc_frame_empty(enum AVPixelFormat format, int w, int h)
 {
     AVFrame *out;
@@ -1400,9 +1507,7 @@ static int config_output(AVFilterLink *outlink)
         }
     }
 
-    s->cqt_align = 1;
-    s->cqt_calc = cqt_calc;
-    s->permute_coeffs = NULL;
+    ff_showcqt_init_dsp(s);
     s->draw_sono = draw_sono;
     if (s->format == AV_PIX_FMT_RGB24) {
         s->draw_bar = draw_bar_rgb;
@@ -1414,10 +1519,6 @@ static int config_output(AVFilterLink *outlink)
         s->update_sono = update_sono_yuv;
     }
 
-#if ARCH_X86
-    ff_showcqt_init_x86(s);
-#endif
-
     if ((ret = init_cqt(s)) < 0)
         return ret;
 
@@ -42,6 +42,8 @@ typedef union {
     YUVFloat yuv;
 } ColorFloat;
 
+struct CQTKernel;
+
 typedef struct ShowCQTContext {
     const AVClass       *class;
     AVFilterContext     *ctx;
@@ -59,7 +61,8 @@ typedef struct ShowCQTContext {
     double              *freq;
     AVTXContext         *fft_ctx;
     av_tx_fn            tx_fn;
-    Coeffs              *coeffs;
+    struct CQTKernel    *kernel;
+    const Coeffs        *coeffs;
     AVComplexFloat      *fft_data;
     AVComplexFloat      *fft_input;
     AVComplexFloat      *fft_result;
@@ -123,6 +126,7 @@ typedef struct ShowCQTContext {
     char                *cscheme;
 } ShowCQTContext;
 
+void ff_showcqt_init_dsp(ShowCQTContext *s);
 void ff_showcqt_init_x86(ShowCQTContext *s);
 
 #endif
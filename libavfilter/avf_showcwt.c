@@ -943,7 +943,6 @@ static int run_channel_cwt(AVFilterContext *ctx, int ch, int jobnr, int nb_jobs)
     AVComplexFloat *idst = (AVComplexFloat *)s->ifft_out->extended_data[jobnr];
     const int output_padding_size = s->output_padding_size;
     const int input_padding_size = s->input_padding_size;
-    const float scale = 1.f / input_padding_size;
     const int ihop_size = s->ihop_size;
     const int count = s->frequency_band_count;
     const int start = (count * jobnr) / nb_jobs;
@@ -976,7 +975,6 @@ static int run_channel_cwt(AVFilterContext *ctx, int ch, int jobnr, int nb_jobs)
             memcpy(srcx, fft_out+input_padding_size-offset, sizeof(*fft_out)*offset);
         }
 
-        s->fdsp->vector_fmul_scalar((float *)srcx, (const float *)srcx, scale, FFALIGN(kernel_range * 2, 4));
         s->fdsp->vector_fmul((float *)dstx, (const float *)srcx,
                              (const float *)kernel, FFALIGN(kernel_range * 2, 16));
 
@@ -1171,6 +1169,7 @@ static int compute_kernel(AVFilterContext *ctx)
 {
     ShowCWTContext *s = ctx->priv;
     const int size = s->input_padding_size;
+    const float scale = 1.f / size;
     const int osize = s->output_padding_size;
     const int output_sample_count = s->output_sample_count;
     const int fsize = s->frequency_band_count;
@@ -1244,8 +1243,8 @@ static int compute_kernel(AVFilterContext *ctx)
         }
 
         for (int n = 0; n < kernel_size; n++) {
-            kernel[n].re = tkernel[n+range+start];
-            kernel[n].im = tkernel[n+range+start];
+            kernel[n].re = tkernel[n+range+start] * scale;
+            kernel[n].im = tkernel[n+range+start] * scale;
         }
 
         range_min = FFMIN(range_min, kernel_size);
@@ -1260,8 +1259,8 @@ static int compute_kernel(AVFilterContext *ctx)
         }
 
         for (int n = 0; n < kernel_size; n++) {
-            dkernel[n].re = tdkernel[n+range+start];
-            dkernel[n].im = tdkernel[n+range+start];
+            dkernel[n].re = tdkernel[n+range+start] * scale;
+            dkernel[n].im = tdkernel[n+range+start] * scale;
         }
 
         s->dkernel[y] = dkernel;
@@ -1399,7 +1398,7 @@ static int config_output(AVFilterLink *outlink)
         return AVERROR(ENOMEM);
 
     for (int n = 0; n < s->nb_threads; n++) {
-        ret = av_tx_init(&s->fft[n], &s->tx_fn, AV_TX_FLOAT_FFT, 0, s->input_padding_size, &scale, 0);
+        ret = av_tx_init(&s->fft[n], &s->tx_fn, AV_TX_FLOAT_FFT, 0, s->input_padding_size, &scale, AV_TX_REUSE);
         if (ret < 0)
             return ret;
     }
@@ -1409,7 +1408,7 @@ static int config_output(AVFilterLink *outlink)
         return AVERROR(ENOMEM);
 
     for (int n = 0; n < s->nb_threads; n++) {
-        ret = av_tx_init(&s->ifft[n], &s->itx_fn, AV_TX_FLOAT_FFT, 1, s->output_padding_size, &scale, 0);
+        ret = av_tx_init(&s->ifft[n], &s->itx_fn, AV_TX_FLOAT_FFT, 1, s->output_padding_size, &scale, AV_TX_REUSE);
         if (ret < 0)
             return ret;
     }
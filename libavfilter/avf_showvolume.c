@@ -52,6 +52,8 @@ typedef struct ShowVolumeContext {
     int draw_volume;
     double *values;
     uint32_t *color_lut;
+    uint8_t fade_lut[256];
+    uint8_t fade_alpha_lut[256];
     float *max;
     int display_scale;
 
@@ -203,6 +205,16 @@ static int config_output(AVFilterLink *outlink)
     l->frame_rate = s->frame_rate;
     outlink->time_base = av_inv_q(l->frame_rate);
 
+    {
+        const uint32_t alpha = s->bgopacity * 255;
+        const float f = s->f;
+
+        for (int i = 0; i < 256; i++) {
+            s->fade_lut[i]       = FFMAX(i * f, 0);
+            s->fade_alpha_lut[i] = FFMAX(i * f, alpha);
+        }
+    }
+
     for (ch = 0; ch < inlink->ch_layout.nb_channels; ch++) {
         int i;
 
@@ -336,15 +348,15 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *insamples)
     if ((s->f < 1.) && (s->f > 0.)) {
         for (j = 0; j < outlink->h; j++) {
             uint8_t *dst = s->out->data[0] + j * s->out->linesize[0];
-            const uint32_t alpha = s->bgopacity * 255;
-            const float f = s->f;
+            const uint8_t *lut = s->fade_lut;
+            const uint8_t *alut = s->fade_alpha_lut;
             const int w = outlink->w;
 
             for (k = 0; k < w; k++) {
-                dst[k * 4 + 0] = FFMAX(dst[k * 4 + 0] * f, 0);
-                dst[k * 4 + 1] = FFMAX(dst[k * 4 + 1] * f, 0);
-                dst[k * 4 + 2] = FFMAX(dst[k * 4 + 2] * f, 0);
-                dst[k * 4 + 3] = FFMAX(dst[k * 4 + 3] * f, alpha);
+                dst[k * 4 + 0] = lut[dst[k * 4 + 0]];
+                dst[k * 4 + 1] = lut[dst[k * 4 + 1]];
+                dst[k * 4 + 2] = lut[dst[k * 4 + 2]];
+                dst[k * 4 + 3] = alut[dst[k * 4 + 3]];
             }
         }
     } else if (s->f == 0.) {
@@ -34,6 +34,8 @@
 #include "libavutil/pixdesc.h"
 #include "libavutil/rational.h"
 #include "libavutil/samplefmt.h"
+#include "libavutil/time.h"
+#include "libavutil/trace.h"
 
 #include "audio.h"
 #include "avfilter.h"
@@ -239,7 +241,12 @@ static void update_link_current_pts(FilterLinkInternal *li, int64_t pts)
 void ff_filter_set_ready(AVFilterContext *filter, unsigned priority)
 {
     FFFilterContext *ctxi = fffilterctx(filter);
-    ctxi->ready = FFMAX(ctxi->ready, priority);
+
+    if (priority <= ctxi->ready)
+        return;
+    ctxi->ready = priority;
+    if (filter->graph)
+        ff_filter_graph_update_ready(filter->graph, ctxi);
 }
 
 /**
@@ -446,6 +453,33 @@ int ff_filter_config_links(AVFilterContext *filter)
     return 0;
 }
 
+void ff_link_propagate_frame_size(AVFilterLink *link)
+{
+    FilterLink *l = ff_filter_link(link);
+    int samples;
+
+    if (link->type != AVMEDIA_TYPE_AUDIO)
+        return;
+    samples = l->min_samples == l->max_samples ? l->min_samples : 0;
+
+    while (link->src) {
+        AVFilterContext *src = link->src;
+        FilterLinkInternal *li;
+
+        if (!(src->filter->flags_internal & FF_FILTER_FLAG_FRAME_SIZE_PASSTHROUGH) ||
+            src->nb_inputs != 1 || !src->inputs[0] ||
+            src->inputs[0]->sample_rate != link->sample_rate)
+            break;
+
+        li = ff_link_internal(src->inputs[0]);
+        if (li->l.min_samples && !li->frame_size_inherited)
+            break;
+        li->l.min_samples = li->l.max_samples = samples;
+        li->frame_size_inherited = !!samples;
+        link = src->inputs[0];
+    }
+}
+
 #ifdef TRACE
 void ff_tlog_link(void *ctx, AVFilterLink *link, int end)
 {
@@ -708,6 +742,7 @@ AVFilterContext *ff_filter_alloc(const AVFilter *filter, const char *inst_name)
     ctx = av_mallocz(sizeof(*ctx));
     if (!ctx)
         return NULL;
+    ctx->ready_index = -1;
     ret = &ctx->p;
 
     ret->av_class = &avfilter_class;
@@ -1104,6 +1139,8 @@ int ff_filter_frame(AVFilterLink *link, AVFrame *frame)
         av_frame_free(&frame);
         return ret;
     }
+    li->l.max_queued_frames = FFMAX(li->l.max_queued_frames,
+                                    ff_framequeue_queued_frames(&li->fifo));
     ff_filter_set_ready(link->dst, 300);
     return 0;
 
@@ -1356,7 +1393,10 @@ static int filter_activate_default(AVFilterContext *filter)
      link_set_out_status().
 
    Filters are activated according to the ready field, set using the
-   ff_filter_set_ready(). Eventually, a priority queue will be used.
+   ff_filter_set_ready(), which keeps ready filters in a priority queue in
+   the graph; the most urgent one is activated first. Ties go to filters
+   that do not need writable input frames, then to the filter added to the
+   graph first.
    ff_filter_set_ready() is called whenever anything could cause progress to
    be possible. Marking a filter ready when it is not is not a problem,
    except for the small overhead it causes.
@@ -1421,19 +1461,58 @@ static int filter_activate_default(AVFilterContext *filter)
 int ff_filter_activate(AVFilterContext *filter)
 {
     FFFilterContext *ctxi = fffilterctx(filter);
+    int64_t start;
     int ret;
 
     /* Generic timeline support is not yet implemented but should be easy */
     av_assert1(!(filter->filter->flags & AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC &&
                  filter->filter->activate));
     ctxi->ready = 0;
+    if (filter->graph)
+        ff_filter_graph_update_ready(filter->graph, ctxi);
+    FF_TRACE_BEGIN("filter", filter->name, 0);
+    start = av_gettime_relative();
     ret = filter->filter->activate ? filter->filter->activate(filter) :
           filter_activate_default(filter);
+    ctxi->stats.activate_time += av_gettime_relative() - start;
+    FF_TRACE_END("filter", filter->name);
+    ctxi->stats.nb_activations++;
     if (ret == FFERROR_NOT_READY)
         ret = 0;
     return ret;
 }
 
+const AVFilterStats *avfilter_get_stats(AVFilterContext *filter)
+{
+    AVFilterStats *stats = &fffilterctx(filter)->stats;
+
+    stats->frames_in = stats->samples_in = stats->max_queued_frames = 0;
+    stats->frame_copies = 0;
+    for (unsigned i = 0; i < filter->nb_inputs; i++) {
+        const FilterLink *l = ff_filter_link(filter->inputs[i]);
+
+        if (!l)
+            continue;
+        stats->frames_in  += l->frame_count_out;
+        stats->samples_in += l->sample_count_out;
+        stats->max_queued_frames = FFMAX(stats->max_queued_frames,
+                                         l->max_queued_frames);
+        stats->frame_copies += l->frame_copies;
+    }
+
+    stats->frames_out = stats->samples_out = 0;
+    for (unsigned i = 0; i < filter->nb_outputs; i++) {
+        const FilterLink *l = ff_filter_link(filter->outputs[i]);
+
+        if (!l)
+            continue;
+        stats->frames_out  += l->frame_count_in;
+        stats->samples_out += l->sample_count_in;
+    }
+
+    return stats;
+}
+
 int ff_inlink_acknowledge_status(AVFilterLink *link, int *rstatus, int64_t *rpts)
 {
     FilterLinkInternal * const li = ff_link_internal(link);
@@ -1569,6 +1648,8 @@ int ff_inlink_make_frame_writable(AVFilterLink *link, AVFrame **rframe)
         return ret;
     }
 
+    ff_filter_link(link)->frame_copies++;
+
     av_frame_free(&frame);
     *rframe = out;
     return 0;
@@ -668,6 +668,70 @@ int avfilter_config_links(AVFilterContext *filter);
  */
 int avfilter_process_command(AVFilterContext *filter, const char *cmd, const char *arg, char *res, int res_len, int flags);
 
+/**
+ * Runtime statistics of a filter instance.
+ *
+ * The counters are maintained by libavfilter for every filter and are
+ * cumulative over the lifetime of the filter.
+ *
+ * sizeof(AVFilterStats) is not a part of the public ABI, new fields may be
+ * added to the end with a minor version bump.
+ */
+typedef struct AVFilterStats {
+    /**
+     * Number of times the filter was activated.
+     */
+    int64_t nb_activations;
+
+    /**
+     * Wall-clock time spent in the filter activate() callback, or in
+     * filter_frame() for filters without one, in microseconds.
+     */
+    int64_t activate_time;
+
+    /**
+     * Number of frames consumed on all inputs and produced on all outputs.
+     */
+    int64_t frames_in, frames_out;
+
+    /**
+     * Number of audio samples consumed on all inputs and produced on all
+     * outputs.
+     */
+    int64_t samples_in, samples_out;
+
+    /**
+     * Total size in bytes of the buffers the filter obtained from the
+     * default frame pools of its outputs.
+     */
+    int64_t pool_bytes;
+
+    /**
+     * Largest number of frames that were queued at once on any input.
+     */
+    int64_t max_queued_frames;
+
+    /**
+     * Number of input frames that had to be copied because they were not
+     * writable, e.g. because they were still referenced by another branch
+     * of a split.
+     */
+    int64_t frame_copies;
+} AVFilterStats;
+
+/**
+ * Get the runtime statistics of a filter instance.
+ *
+ * The returned structure is owned by the filter and stays valid until the
+ * filter is freed. It is updated as the graph runs, so it should only be
+ * accessed from the thread driving the graph, or concurrently only when
+ * approximate values are acceptable. Every call refreshes the link-derived
+ * counters.
+ *
+ * @return the statistics of the filter
+ */
+const AVFilterStats *avfilter_get_stats(AVFilterContext *filter);
+
 /**
  * Iterate over all registered filters.
  *
@@ -1335,6 +1399,33 @@ int avfilter_graph_segment_apply(AVFilterGraphSegment *seg, int flags,
  */
 void avfilter_graph_segment_free(AVFilterGraphSegment **seg);
 
+/**
+ * Create a copy of a graph segment associated with another filtergraph.
+ *
+ * This allows a filtergraph description to be parsed once and the result to
+ * be used as a template, which is then applied to any number of graphs,
+ * skipping the parsing step for each of them.
+ *
+ * Only the parameters are copied, i.e. filter names, instance names, options,
+ * pad labels and scale_sws_opts. The copy is creation-pending, as if it was
+ * returned by avfilter_graph_segment_parse().
+ *
+ * @param src   the segment to copy; it must not contain any filter instances,
+ *              i.e. avfilter_graph_segment_create_filters() must not have been
+ *              called on it
+ * @param graph filter graph the copy is associated with
+ * @param flags reserved for future use, caller must set to 0 for now
+ * @param dst   A pointer to the newly-created AVFilterGraphSegment is written
+ *              here on success. It must be freed with
+ *              avfilter_graph_segment_free().
+ *
+ * @retval "non-negative number" success
+ * @retval "negative error code" failure
+ */
+int avfilter_graph_segment_dup(const AVFilterGraphSegment *src,
+                               AVFilterGraph *graph, int flags,
+                               AVFilterGraphSegment **dst);
+
 /**
  * Send a command to one or more filter instances.
  *
@@ -25,8 +25,11 @@
 #ifndef AVFILTER_AVFILTER_INTERNAL_H
 #define AVFILTER_AVFILTER_INTERNAL_H
 
+#include <stdatomic.h>
 #include <stdint.h>
 
+#include "libavutil/thread.h"
+
 #include "avfilter.h"
 #include "filters.h"
 #include "framequeue.h"
@@ -85,6 +88,12 @@ typedef struct FilterLinkInternal {
         AVLINK_STARTINIT,       ///< started, but incomplete
         AVLINK_INIT             ///< complete
     } init_state;
+
+    /**
+     * True if min_samples/max_samples were forwarded from a downstream link
+     * by ff_link_propagate_frame_size() rather than set by the destination.
+     */
+    int frame_size_inherited;
 } FilterLinkInternal;
 
 static inline FilterLinkInternal *ff_link_internal(AVFilterLink *link)
@@ -110,12 +119,49 @@ typedef struct FFFilterContext {
      */
     unsigned ready;
 
+    /**
+     * Index of the filter in AVFilterGraph.filters.
+     */
+    unsigned graph_index;
+
+    /**
+     * Index of the filter in FFFilterGraph.ready_heap, -1 if the filter is
+     * not ready.
+     */
+    int ready_index;
+
+    /**
+     * Set if an input pad of the filter needs writable frames and is fed by
+     * a filter with several outputs. Among filters of the same readiness
+     * these are activated last, so that the other consumers of a shared
+     * frame can release it first and save a copy. Graphs without such a
+     * fan-out keep their activation order.
+     */
+    int needs_writable;
+
+    /**
+     * Priority passed to ff_filter_set_ready_async() and not yet applied,
+     * protected by the lock of the asynchronous wakeups in avfiltergraph.c.
+     */
+    unsigned ready_async;
+
+    /**
+     * Set by ff_filter_set_async_wait(), only accessed by the thread running
+     * the graph.
+     */
+    int async_wait;
+
     ///< parsed expression
     struct AVExpr *enable;
     ///< variable values for the enable expression
     double *var_values;
 
     struct AVFilterCommand *command_queue;
+
+    /**
+     * Runtime counters, see avfilter_get_stats().
+     */
+    AVFilterStats stats;
 } FFFilterContext;
 
 static inline FFFilterContext *fffilterctx(AVFilterContext *ctx)
@@ -140,11 +186,36 @@ typedef struct FFFilterGraph {
     struct FilterLinkInternal **sink_links;
     int sink_links_count;
 
+    /**
+     * Ready filters, as a binary heap ordered by decreasing ready value,
+     * then by increasing index in AVFilterGraph.filters. Allocated with the
+     * same size as AVFilterGraph.filters.
+     */
+    FFFilterContext **ready_heap;
+    unsigned nb_ready;
+
     unsigned disable_auto_convert;
 
+    /**
+     * FFFramePoolFlags applied to the default video buffer pools of all
+     * links in this graph.
+     */
+    int frame_pool_flags;
+
     void *thread;
     avfilter_execute_func *thread_execute;
     FFFrameQueueGlobal frame_queues;
+
+    /**
+     * Wakeups from threads other than the one running the graph, see
+     * ff_filter_set_ready_async(). nb_ready_async counts the filters with a
+     * pending ready_async and is only modified with the lock of the
+     * asynchronous wakeups held, nb_async_wait counts the filters with
+     * async_wait set.
+     */
+    AVCond  async_cond;
+    atomic_uint nb_ready_async;
+    unsigned nb_async_wait;
 } FFFilterGraph;
 
 static inline FFFilterGraph *fffiltergraph(AVFilterGraph *graph)
@@ -152,6 +223,12 @@ static inline FFFilterGraph *fffiltergraph(AVFilterGraph *graph)
     return (FFFilterGraph*)graph;
 }
 
+/**
+ * Update the position of a filter in the ready heap after its ready field
+ * changed, adding or removing it as needed.
+ */
+void ff_filter_graph_update_ready(AVFilterGraph *graph, FFFilterContext *ctxi);
+
 /**
  * Update the position of a link in the age heap.
  */
@@ -200,6 +277,13 @@ void ff_graph_thread_free(FFFilterGraph *graph);
  */
 int ff_filter_config_links(AVFilterContext *filter);
 
+/**
+ * Forward the fixed frame size of an audio link (min_samples == max_samples)
+ * upstream through filters flagged with FF_FILTER_FLAG_FRAME_SIZE_PASSTHROUGH,
+ * so that it is visible to whatever actually produces the frames.
+ */
+void ff_link_propagate_frame_size(AVFilterLink *link);
+
 /* misc trace functions */
 
 #define FF_TPRINTF_START(ctx, func) ff_tlog(NULL, "%-16s: ", #func)
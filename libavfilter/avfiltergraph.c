@@ -38,6 +38,7 @@
 #include "buffersink.h"
 #include "filters.h"
 #include "formats.h"
+#include "framepool.h"
 #include "framequeue.h"
 #include "video.h"
 
@@ -56,6 +57,10 @@ static const AVOption filtergraph_options[] = {
         AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, F|V },
     {"aresample_swr_opts"   , "default aresample filter options"    , OFFSET(aresample_swr_opts)    ,
         AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, F|A },
+    { "frame_pool_flags", "Default video buffer pool flags", offsetof(FFFilterGraph, frame_pool_flags), AV_OPT_TYPE_FLAGS,
+        { .i64 = 0 }, 0, INT_MAX, F|V, .unit = "frame_pool_flags" },
+        { "hugepages",   "back large buffers with transparent huge pages", 0, AV_OPT_TYPE_CONST, { .i64 = FF_FRAME_POOL_FLAG_HUGEPAGES }, .flags = F|V, .unit = "frame_pool_flags" },
+        { "first_touch", "leave new buffers uncleared so the writing thread places the pages", 0, AV_OPT_TYPE_CONST, { .i64 = FF_FRAME_POOL_FLAG_NO_ZERO }, .flags = F|V, .unit = "frame_pool_flags" },
     { NULL },
 };
 
@@ -87,23 +92,136 @@ AVFilterGraph *avfilter_graph_alloc(void)
     if (!graph)
         return NULL;
 
+    if (ff_cond_init(&graph->async_cond, NULL)) {
+        av_free(graph);
+        return NULL;
+    }
+
     ret = &graph->p;
     ret->av_class = &filtergraph_class;
     av_opt_set_defaults(ret);
     ff_framequeue_global_init(&graph->frame_queues);
+    atomic_init(&graph->nb_ready_async, 0);
 
     return ret;
 }
 
+/* Protects the asynchronous wakeups of all graphs, see
+ * ff_filter_set_ready_async(). Filters may be removed from their graph while
+ * their threads still run, so the lock cannot be part of the graph. */
+static AVMutex async_lock = AV_MUTEX_INITIALIZER;
+
+/* whether a should be activated before b */
+static int ready_before(const FFFilterContext *a, const FFFilterContext *b)
+{
+    if (a->ready != b->ready)
+        return a->ready > b->ready;
+    if (a->needs_writable != b->needs_writable)
+        return b->needs_writable;
+    return a->graph_index < b->graph_index;
+}
+
+static void ready_heap_bubble_up(FFFilterGraph *graph,
+                                 FFFilterContext *ctxi, int index)
+{
+    FFFilterContext **heap = graph->ready_heap;
+
+    while (index) {
+        int parent = (index - 1) >> 1;
+        if (!ready_before(ctxi, heap[parent]))
+            break;
+        heap[index] = heap[parent];
+        heap[index]->ready_index = index;
+        index = parent;
+    }
+    heap[index] = ctxi;
+    ctxi->ready_index = index;
+}
+
+static void ready_heap_bubble_down(FFFilterGraph *graph,
+                                   FFFilterContext *ctxi, int index)
+{
+    FFFilterContext **heap = graph->ready_heap;
+
+    while (1) {
+        int child = 2 * index + 1;
+        if (child >= graph->nb_ready)
+            break;
+        if (child + 1 < graph->nb_ready &&
+            ready_before(heap[child + 1], heap[child]))
+            child++;
+        if (!ready_before(heap[child], ctxi))
+            break;
+        heap[index] = heap[child];
+        heap[index]->ready_index = index;
+        index = child;
+    }
+    heap[index] = ctxi;
+    ctxi->ready_index = index;
+}
+
+static void ready_heap_remove(FFFilterGraph *graph, FFFilterContext *ctxi)
+{
+    int index = ctxi->ready_index;
+    FFFilterContext *last = graph->ready_heap[--graph->nb_ready];
+
+    ctxi->ready_index = -1;
+    if (index < graph->nb_ready) {
+        ready_heap_bubble_up  (graph, last, index);
+        ready_heap_bubble_down(graph, last, last->ready_index);
+    }
+}
+
+void ff_filter_graph_update_ready(AVFilterGraph *graph, FFFilterContext *ctxi)
+{
+    FFFilterGraph *graphi = fffiltergraph(graph);
+
+    if (!ctxi->ready) {
+        if (ctxi->ready_index >= 0)
+            ready_heap_remove(graphi, ctxi);
+        return;
+    }
+
+    if (ctxi->ready_index < 0) {
+        av_assert1(graphi->nb_ready < graph->nb_filters);
+        ctxi->ready_index = graphi->nb_ready++;
+    }
+    ready_heap_bubble_up  (graphi, ctxi, ctxi->ready_index);
+    ready_heap_bubble_down(graphi, ctxi, ctxi->ready_index);
+}
+
 void ff_filter_graph_remove_filter(AVFilterGraph *graph, AVFilterContext *filter)
 {
+    FFFilterGraph *graphi = fffiltergraph(graph);
     int i, j;
     for (i = 0; i < graph->nb_filters; i++) {
         if (graph->filters[i] == filter) {
+            FFFilterContext *ctxi = fffilterctx(filter);
+            FFFilterContext *moved;
+
+            if (ctxi->ready_index >= 0)
+                ready_heap_remove(graphi, ctxi);
+            if (ctxi->async_wait)
+                graphi->nb_async_wait--;
+            ctxi->async_wait = 0;
+
             FFSWAP(AVFilterContext*, graph->filters[i],
                    graph->filters[graph->nb_filters - 1]);
             graph->nb_filters--;
+
+            /* the last filter took the slot, fix its heap position */
+            moved = fffilterctx(graph->filters[i]);
+            moved->graph_index = i;
+            if (i < graph->nb_filters && moved->ready_index >= 0)
+                ff_filter_graph_update_ready(graph, moved);
+
+            /* no more asynchronous wakeups once the graph is unset */
+            ff_mutex_lock(&async_lock);
+            if (ctxi->ready_async)
+                graphi->nb_ready_async--;
+            ctxi->ready_async = 0;
             filter->graph = NULL;
+            ff_mutex_unlock(&async_lock);
             for (j = 0; j<filter->nb_outputs; j++)
                 if (filter->outputs[j])
                     ff_filter_link(filter->outputs[j])->graph = NULL;
@@ -127,6 +245,9 @@ void avfilter_graph_free(AVFilterGraph **graphp)
     ff_graph_thread_free(graphi);
 
     av_freep(&graphi->sink_links);
+    av_freep(&graphi->ready_heap);
+
+    ff_cond_destroy(&graphi->async_cond);
 
     av_opt_free(graph);
 
@@ -166,6 +287,7 @@ AVFilterContext *avfilter_graph_alloc_filter(AVFilterGraph *graph,
                                              const char *name)
 {
     AVFilterContext **filters, *s;
+    FFFilterContext **ready_heap;
     FFFilterGraph *graphi = fffiltergraph(graph);
 
     if (graph->thread_type && !graphi->thread_execute) {
@@ -185,10 +307,17 @@ AVFilterContext *avfilter_graph_alloc_filter(AVFilterGraph *graph,
         return NULL;
     graph->filters = filters;
 
+    ready_heap = av_realloc_array(graphi->ready_heap, graph->nb_filters + 1,
+                                  sizeof(*ready_heap));
+    if (!ready_heap)
+        return NULL;
+    graphi->ready_heap = ready_heap;
+
     s = ff_filter_alloc(filter, name);
     if (!s)
         return NULL;
 
+    fffilterctx(s)->graph_index = graph->nb_filters;
     graph->filters[graph->nb_filters++] = s;
 
     s->graph = graph;
@@ -256,6 +385,12 @@ static int graph_config_links(AVFilterGraph *graph, void *log_ctx)
         }
     }
 
+    for (i = 0; i < graph->nb_filters; i++) {
+        filt = graph->filters[i];
+        for (unsigned j = 0; j < filt->nb_inputs; j++)
+            ff_link_propagate_frame_size(filt->inputs[j]);
+    }
+
     return 0;
 }
 
@@ -1368,8 +1503,12 @@ static int graph_config_pointers(AVFilterGraph *graph, void *log_ctx)
 
     for (i = 0; i < graph->nb_filters; i++) {
         f = graph->filters[i];
+        fffilterctx(f)->needs_writable = 0;
         for (j = 0; j < f->nb_inputs; j++) {
             ff_link_internal(f->inputs[j])->age_index  = -1;
+            if (f->input_pads[j].flags & AVFILTERPAD_FLAG_NEEDS_WRITABLE &&
+                f->inputs[j]->src->nb_outputs > 1)
+                fffilterctx(f)->needs_writable = 1;
         }
         for (j = 0; j < f->nb_outputs; j++) {
             ff_link_internal(f->outputs[j])->age_index = -1;
@@ -1577,23 +1716,72 @@ int avfilter_graph_request_oldest(AVFilterGraph *graph)
     return 0;
 }
 
-int ff_filter_graph_run_once(AVFilterGraph *graph)
+void ff_filter_set_ready_async(AVFilterContext *filter, unsigned priority)
 {
-    FFFilterContext *ctxi;
-    unsigned i;
+    FFFilterContext *ctxi = fffilterctx(filter);
 
-    av_assert0(graph->nb_filters);
-    ctxi = fffilterctx(graph->filters[0]);
-    for (i = 1; i < graph->nb_filters; i++) {
-        FFFilterContext *ctxi_other = fffilterctx(graph->filters[i]);
+    ff_mutex_lock(&async_lock);
+    if (filter->graph && priority > ctxi->ready_async) {
+        FFFilterGraph *graphi = fffiltergraph(filter->graph);
 
-        if (ctxi_other->ready > ctxi->ready)
-            ctxi = ctxi_other;
+        if (!ctxi->ready_async)
+            graphi->nb_ready_async++;
+        ctxi->ready_async = priority;
+        ff_cond_signal(&graphi->async_cond);
     }
+    ff_mutex_unlock(&async_lock);
+}
+
+void ff_filter_set_async_wait(AVFilterContext *filter, int wait)
+{
+    FFFilterContext *ctxi = fffilterctx(filter);
+    FFFilterGraph *graphi = fffiltergraph(filter->graph);
+
+    wait = !!wait;
+    if (ctxi->async_wait == wait)
+        return;
+    ctxi->async_wait = wait;
+    if (wait)
+        graphi->nb_async_wait++;
+    else
+        graphi->nb_async_wait--;
+}
+
+/* Apply the pending ff_filter_set_ready_async() calls. If nothing is ready
+ * but a filter waits for its threads, wait for them to signal first. */
+static void graph_update_ready_async(FFFilterGraph *graphi)
+{
+    AVFilterGraph *graph = &graphi->p;
+
+    ff_mutex_lock(&async_lock);
+    while (!graphi->nb_ready && graphi->nb_async_wait && !graphi->nb_ready_async)
+        ff_cond_wait(&graphi->async_cond, &async_lock);
+    for (unsigned i = 0; graphi->nb_ready_async && i < graph->nb_filters; i++) {
+        FFFilterContext *ctxi = fffilterctx(graph->filters[i]);
+
+        if (ctxi->ready_async) {
+            unsigned priority = ctxi->ready_async;
+
+            ctxi->ready_async = 0;
+            graphi->nb_ready_async--;
+            ff_filter_set_ready(&ctxi->p, priority);
+        }
+    }
+    ff_mutex_unlock(&async_lock);
+}
+
+int ff_filter_graph_run_once(AVFilterGraph *graph)
+{
+    FFFilterGraph *graphi = fffiltergraph(graph);
+
+    av_assert0(graph->nb_filters);
 
-    if (!ctxi->ready)
+    if (graphi->nb_async_wait ||
+        atomic_load_explicit(&graphi->nb_ready_async, memory_order_relaxed))
+        graph_update_ready_async(graphi);
+    if (!graphi->nb_ready)
         return AVERROR(EAGAIN);
-    return ff_filter_activate(&ctxi->p);
+    return ff_filter_activate(&graphi->ready_heap[0]->p);
 }
 
 int avfilter_print_config_formats(AVBPrint *bp, const struct AVFilter *filter, int for_output, unsigned pad_index)
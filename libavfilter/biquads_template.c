@@ -613,3 +613,82 @@ static void fn(biquad_zdf)(void *st,
     stc->c[1] = isnormal(b1) ? b1 : F(0.0);
 }
 #endif
+
+#if BIQUAD_LANES && (DEPTH == 32 || DEPTH == 64)
+static void fn(init_lanes)(void *st, int transform_type, void *coeffs)
+{
+    const fn(BiquadContext) *stc = st;
+    ftype *k = coeffs;
+    ftype c[BQ_NB_COEFFS];
+
+    c[BQ_A0]  = stc->a[0];
+    c[BQ_A1]  = stc->a[1];
+    c[BQ_A2]  = stc->a[2];
+    c[BQ_B0]  = stc->b[0];
+    c[BQ_B1]  = stc->b[1];
+    c[BQ_B2]  = stc->b[2];
+    c[BQ_WET] = stc->mix;
+    c[BQ_DRY] = F(1.0) - stc->mix;
+
+    switch (transform_type) {
+    case DII:
+    case TDI:
+    case TDII:
+        c[BQ_A1] = -c[BQ_A1];
+        c[BQ_A2] = -c[BQ_A2];
+        break;
+    case WDF:
+        c[BQ_B1] = -c[BQ_B1];
+        c[BQ_B2] = -c[BQ_B2];
+        break;
+    }
+
+    for (int n = 0; n < BQ_NB_COEFFS; n++) {
+        for (int l = 0; l < BIQUADS_DSP_LANES; l++)
+            k[n * BIQUADS_DSP_LANES + l] = c[n];
+    }
+}
+
+static void fn(filter_lanes)(BiquadsContext *s, uint8_t **dst, uint8_t **src,
+                             int len, const int *chs)
+{
+    DECLARE_ALIGNED(16, ftype, lstate)[BIQUADS_DSP_NB_STATE * BIQUADS_DSP_LANES];
+    const int nb_samples = len & ~(BIQUADS_DSP_LANES - 1);
+    fn(BiquadContext) *state = s->st;
+    const stype *lsrc[BIQUADS_DSP_LANES];
+    stype *ldst[BIQUADS_DSP_LANES];
+
+    for (int l = 0; l < BIQUADS_DSP_LANES; l++) {
+        fn(BiquadContext) *stc = &state[chs[l]];
+
+        for (int n = 0; n < BIQUADS_DSP_NB_STATE; n++)
+            lstate[n * BIQUADS_DSP_LANES + l] = stc->c[n];
+        lsrc[l] = (const stype *)src[chs[l]];
+        ldst[l] = (stype *)dst[chs[l]];
+    }
+
+    if (nb_samples > 0) {
+#if DEPTH == 32
+        s->dsp.filter_flt[s->transform_type](ldst, lsrc, nb_samples, lstate,
+                                              (const ftype *)s->lanes_coeffs);
+#else
+        s->dsp.filter_dbl[s->transform_type](ldst, lsrc, nb_samples, lstate,
+                                              (const ftype *)s->lanes_coeffs);
+#endif
+    }
+
+    for (int l = 0; l < BIQUADS_DSP_LANES; l++) {
+        fn(BiquadContext) *stc = &state[chs[l]];
+
+        for (int n = 0; n < BIQUADS_DSP_NB_STATE; n++) {
+            const ftype v = lstate[n * BIQUADS_DSP_LANES + l];
+
+            stc->c[n] = (nb_samples < len || isnormal(v)) ? v : F(0.0);
+        }
+
+        if (nb_samples < len)
+            s->filter(s->st, lsrc[l] + nb_samples, ldst[l] + nb_samples,
+                      len - nb_samples, chs[l], 0);
+    }
+}
+#endif
@@ -0,0 +1,196 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#undef ftype
+#undef SUFFIX
+#if DEPTH == 32
+#define ftype float
+#define SUFFIX flt
+#else
+#define ftype double
+#define SUFFIX dbl
+#endif
+
+#define F(x) ((ftype)(x))
+
+#define fn3(a,b)   a##_##b
+#define fn2(a,b)   fn3(a,b)
+#define fn(a)      fn2(a, SUFFIX)
+
+static void fn(biquad_dii)(ftype *const *dst, const ftype *const *src,
+                           ptrdiff_t len, ftype *state, const ftype *k)
+{
+    LANES_START(2)
+
+    for (int i = 0; i < len; i++) {
+        for (int l = 0; l < L; l++) {
+            const ftype in = src[l][i];
+            ftype w0 = in + a1[l] * s[0][l] + a2[l] * s[1][l];
+            ftype out = b0[l] * w0 + b1[l] * s[0][l] + b2[l] * s[1][l];
+
+            s[1][l] = s[0][l];
+            s[0][l] = w0;
+            dst[l][i] = out * wet[l] + in * dry[l];
+        }
+    }
+
+    LANES_END(2)
+}
+
+static void fn(biquad_tdi)(ftype *const *dst, const ftype *const *src,
+                           ptrdiff_t len, ftype *state, const ftype *k)
+{
+    LANES_START(4)
+
+    for (int i = 0; i < len; i++) {
+        for (int l = 0; l < L; l++) {
+            const ftype in = src[l][i];
+            ftype t0, t1, t2, t3, t4, out;
+
+            t0 = in + s[0][l];
+            t1 = t0 * a1[l] + s[1][l];
+            t2 = t0 * a2[l];
+            t3 = t0 * b1[l] + s[3][l];
+            t4 = t0 * b2[l];
+            out = b0[l] * t0 + s[2][l];
+            s[0][l] = t1; s[1][l] = t2; s[2][l] = t3; s[3][l] = t4;
+            dst[l][i] = out * wet[l] + in * dry[l];
+        }
+    }
+
+    LANES_END(4)
+}
+
+static void fn(biquad_tdii)(ftype *const *dst, const ftype *const *src,
+                            ptrdiff_t len, ftype *state, const ftype *k)
+{
+    LANES_START(2)
+
+    for (int i = 0; i < len; i++) {
+        for (int l = 0; l < L; l++) {
+            const ftype in = src[l][i];
+            ftype out = b0[l] * in + s[0][l];
+
+            s[0][l] = b1[l] * in + s[1][l] + a1[l] * out;
+            s[1][l] = b2[l] * in + a2[l] * out;
+            dst[l][i] = out * wet[l] + in * dry[l];
+        }
+    }
+
+    LANES_END(2)
+}
+
+static void fn(biquad_latt)(ftype *const *dst, const ftype *const *src,
+                            ptrdiff_t len, ftype *state, const ftype *k)
+{
+    LANES_START(2)
+
+    for (int i = 0; i < len; i++) {
+        for (int l = 0; l < L; l++) {
+            const ftype in = src[l][i];
+            ftype t0, t1, out;
+
+            t0   = in - a2[l] * s[0][l];
+            t1   = t0 * a2[l] + s[0][l];
+            out  = t1 * b2[l];
+
+            t0   = t0 - a1[l] * s[1][l];
+            t1   = t0 * a1[l] + s[1][l];
+            out += t1 * b1[l];
+
+            out += t0 * b0[l];
+            s[0][l] = t1;
+            s[1][l] = t0;
+            dst[l][i] = out * wet[l] + in * dry[l];
+        }
+    }
+
+    LANES_END(2)
+}
+
+static void fn(biquad_svf)(ftype *const *dst, const ftype *const *src,
+                           ptrdiff_t len, ftype *state, const ftype *k)
+{
+    LANES_START(2)
+
+    for (int i = 0; i < len; i++) {
+        for (int l = 0; l < L; l++) {
+            const ftype in = src[l][i];
+            ftype out = b2[l] * in + s[0][l];
+            ftype t0  = b0[l] * in + a1[l] * s[0][l] + s[1][l];
+            ftype t1  = b1[l] * in + a2[l] * s[0][l];
+
+            s[0][l] = t0;
+            s[1][l] = t1;
+            dst[l][i] = out * wet[l] + in * dry[l];
+        }
+    }
+
+    LANES_END(2)
+}
+
+static void fn(biquad_wdf)(ftype *const *dst, const ftype *const *src,
+                           ptrdiff_t len, ftype *state, const ftype *k)
+{
+    LANES_START(2)
+
+    for (int i = 0; i < len; i++) {
+        for (int l = 0; l < L; l++) {
+            const ftype in = src[l][i];
+            ftype out, v0, v1;
+
+            out = in * b0[l] + s[0][l] + s[1][l];
+            v0 = in * b1[l] + out * a1[l] + s[1][l];
+            v1 = out * a2[l] + in * b2[l] - s[0][l];
+            s[0][l] = v0;
+            s[1][l] = v1;
+            dst[l][i] = out * wet[l] + in * dry[l];
+        }
+    }
+
+    LANES_END(2)
+}
+
+static void fn(biquad_zdf)(ftype *const *dst, const ftype *const *src,
+                           ptrdiff_t len, ftype *state, const ftype *k)
+{
+    LANES_START(2)
+
+    for (int i = 0; i < len; i++) {
+        for (int l = 0; l < L; l++) {
+            const ftype in = src[l][i];
+            const ftype v3 = in - s[1][l];
+            const ftype v1 = a0[l] * s[0][l] + a1[l] * v3;
+            const ftype v2 = s[1][l] + a1[l] * s[0][l] + a2[l] * v3;
+            ftype out;
+
+            s[0][l] = F(2.0) * v1 - s[0][l];
+            s[1][l] = F(2.0) * v2 - s[1][l];
+
+            out = b0[l] * in + b1[l] * v1 + b2[l] * v2;
+            dst[l][i] = out * wet[l] + in * dry[l];
+        }
+    }
+
+    LANES_END(2)
+}
+
+#undef F
+#undef fn
+#undef fn2
+#undef fn3
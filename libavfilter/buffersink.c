@@ -84,6 +84,9 @@ typedef struct BufferSinkContext {
     unsigned          nb_channel_layouts;
 
     AVFrame *peeked_frame;
+
+    int (*get_buffer)(void *opaque, AVFrame *frame, int flags);
+    void *get_buffer_opaque;
 } BufferSinkContext;
 
 int attribute_align_arg av_buffersink_get_frame(AVFilterContext *ctx, AVFrame *frame)
@@ -309,7 +312,91 @@ void av_buffersink_set_frame_size(AVFilterContext *ctx, unsigned frame_size)
     if (ctx->inputs && ctx->inputs[0]) {
         FilterLink *l = ff_filter_link(ctx->inputs[0]);
         l->min_samples = l->max_samples = buf->frame_size;
+        ff_link_propagate_frame_size(ctx->inputs[0]);
+    }
+}
+
+void av_buffersink_set_get_buffer(AVFilterContext *ctx,
+                                  int (*get_buffer)(void *opaque, AVFrame *frame, int flags),
+                                  void *opaque)
+{
+    BufferSinkContext *buf = ctx->priv;
+
+    buf->get_buffer        = get_buffer;
+    buf->get_buffer_opaque = opaque;
+}
+
+/**
+ * Ask the caller for a buffer. On failure NULL is returned and the link
+ * falls back to the default frame pool, so the callback may decline any
+ * request it cannot serve.
+ */
+static AVFrame *get_user_buffer(AVFilterLink *link, AVFrame *frame)
+{
+    BufferSinkContext *buf = link->dst->priv;
+    int ret;
+
+    ret = buf->get_buffer(buf->get_buffer_opaque, frame, 0);
+    if (ret < 0 || !frame->buf[0] || !frame->data[0]) {
+        if (ret >= 0)
+            av_log(link->dst, AV_LOG_WARNING,
+                   "get_buffer() callback did not return a refcounted frame\n");
+        av_frame_free(&frame);
+        return NULL;
+    }
+
+    return frame;
+}
+
+static AVFrame *get_video_buffer(AVFilterLink *link, int w, int h)
+{
+    BufferSinkContext *buf = link->dst->priv;
+    FilterLink *l = ff_filter_link(link);
+    AVFrame *frame;
+
+    if (!buf->get_buffer || l->hw_frames_ctx)
+        return NULL;
+
+    frame = av_frame_alloc();
+    if (!frame)
+        return NULL;
+
+    frame->format = link->format;
+    frame->width  = w;
+    frame->height = h;
+    frame->sample_aspect_ratio = link->sample_aspect_ratio;
+    frame->colorspace  = link->colorspace;
+    frame->color_range = link->color_range;
+
+    return get_user_buffer(link, frame);
+}
+
+static AVFrame *get_audio_buffer(AVFilterLink *link, int nb_samples)
+{
+    BufferSinkContext *buf = link->dst->priv;
+    AVFrame *frame;
+
+    if (!buf->get_buffer)
+        return NULL;
+
+    frame = av_frame_alloc();
+    if (!frame)
+        return NULL;
+
+    frame->format      = link->format;
+    frame->nb_samples  = nb_samples;
+    frame->sample_rate = link->sample_rate;
+    if (av_channel_layout_copy(&frame->ch_layout, &link->ch_layout) < 0) {
+        av_frame_free(&frame);
+        return NULL;
     }
+
+    frame = get_user_buffer(link, frame);
+    if (frame)
+        av_samples_set_silence(frame->extended_data, 0, nb_samples,
+                               frame->ch_layout.nb_channels, frame->format);
+
+    return frame;
 }
 
 #define MAKE_AVFILTERLINK_ACCESSOR(type, field) \
@@ -532,6 +619,14 @@ static const AVOption abuffersink_options[] = {
 AVFILTER_DEFINE_CLASS(buffersink);
 AVFILTER_DEFINE_CLASS(abuffersink);
 
+static const AVFilterPad inputs_video[] = {
+    {
+        .name             = "default",
+        .type             = AVMEDIA_TYPE_VIDEO,
+        .get_buffer.video = get_video_buffer,
+    },
+};
+
 const AVFilter ff_vsink_buffer = {
     .name          = "buffersink",
     .description   = NULL_IF_CONFIG_SMALL("Buffer video frames, and make them available to the end of the filter graph."),
@@ -540,16 +635,17 @@ const AVFilter ff_vsink_buffer = {
     .init          = init_video,
     .uninit        = uninit,
     .activate      = activate,
-    FILTER_INPUTS(ff_video_default_filterpad),
+    FILTER_INPUTS(inputs_video),
     .outputs       = NULL,
     FILTER_QUERY_FUNC2(vsink_query_formats),
 };
 
 static const AVFilterPad inputs_audio[] = {
     {
-        .name         = "default",
-        .type         = AVMEDIA_TYPE_AUDIO,
-        .config_props = config_input_audio,
+        .name             = "default",
+        .type             = AVMEDIA_TYPE_AUDIO,
+        .config_props     = config_input_audio,
+        .get_buffer.audio = get_audio_buffer,
     },
 };
 
@@ -98,6 +98,34 @@ int av_buffersink_get_frame_flags(AVFilterContext *ctx, AVFrame *frame, int flag
  */
 void av_buffersink_set_frame_size(AVFilterContext *ctx, unsigned frame_size);
 
+/**
+ * Set a callback providing the buffers the last filters of the graph write
+ * their output into, so frames can be produced directly in caller-owned
+ * memory (e.g. mapped GPU or encoder input buffers) without a final copy.
+ *
+ * The request travels upstream through filters that pass their input
+ * through unchanged, and reaches the filter that actually allocates the
+ * frame. Filters which output their input frame untouched never call it.
+ *
+ * On entry, frame->format and either frame->width/height (video) or
+ * frame->nb_samples/ch_layout/sample_rate (audio) are set. The callback
+ * must fill frame->buf[] and frame->data[]/linesize[] with writable,
+ * refcounted buffers in the same way av_frame_get_buffer() would, with
+ * every plane and linesize aligned to av_cpu_max_align(). It may return a
+ * negative error code to decline a request, in which case the frame is
+ * allocated from the internal pool instead. flags is currently unused and
+ * always 0.
+ *
+ * The callback may be invoked from any thread running the filter graph.
+ * It is not used for hardware frames.
+ *
+ * @param get_buffer the callback, or NULL to disable it
+ * @param opaque     user pointer passed to the callback
+ */
+void av_buffersink_set_get_buffer(AVFilterContext *ctx,
+                                  int (*get_buffer)(void *opaque, AVFrame *frame, int flags),
+                                  void *opaque);
+
 /**
  * @defgroup lavfi_buffersink_accessors Buffer sink accessors
  * Get the properties of the stream
@@ -321,6 +321,18 @@ unsigned av_buffersrc_get_nb_failed_requests(AVFilterContext *buffer_src)
     return ((BufferSourceContext *)buffer_src->priv)->nb_failed_requests;
 }
 
+int av_buffersrc_get_frame_size(AVFilterContext *buffer_src)
+{
+    FilterLink *l;
+
+    if (!buffer_src->nb_outputs || !buffer_src->outputs[0] ||
+        buffer_src->outputs[0]->type != AVMEDIA_TYPE_AUDIO)
+        return 0;
+
+    l = ff_filter_link(buffer_src->outputs[0]);
+    return l->min_samples == l->max_samples ? l->min_samples : 0;
+}
+
 #define OFFSET(x) offsetof(BufferSourceContext, x)
 #define A AV_OPT_FLAG_FILTERING_PARAM|AV_OPT_FLAG_AUDIO_PARAM
 #define V AV_OPT_FLAG_FILTERING_PARAM|AV_OPT_FLAG_VIDEO_PARAM
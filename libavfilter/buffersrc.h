@@ -63,6 +63,21 @@ enum {
  */
 unsigned av_buffersrc_get_nb_failed_requests(AVFilterContext *buffer_src);
 
+/**
+ * Get the number of samples per frame preferred by the filters consuming an
+ * audio buffer source.
+ *
+ * This is set when the filters downstream process audio in fixed-size
+ * blocks. Frames of exactly this size are passed through without being
+ * re-chunked; any other size still works but may be copied.
+ *
+ * Only valid after the graph has been configured.
+ *
+ * @return the preferred number of samples, or 0 if there is no preference
+ *         or the source is not an audio one
+ */
+int av_buffersrc_get_frame_size(AVFilterContext *buffer_src);
+
 /**
  * This structure contains the parameters describing the frames that will be
  * passed to this filter.
@@ -21,12 +21,25 @@
  * DNN common functions different backends.
  */
 
+#include <string.h>
+
 #include "libavutil/mem.h"
 #include "dnn_backend_common.h"
 
 #define DNN_ASYNC_SUCCESS (void *)0
 #define DNN_ASYNC_FAIL (void *)-1
 
+typedef struct DNNSharedEntry {
+    struct DNNSharedEntry *next;
+    char *key;
+    void *obj;
+    void (*destroy)(void *obj);
+    unsigned refcount;
+} DNNSharedEntry;
+
+static AVMutex shared_lock = AV_MUTEX_INITIALIZER;
+static DNNSharedEntry *shared_list;
+
 int ff_check_exec_params(void *ctx, DNNBackendType backend, DNNFunctionType func_type, DNNExecBaseParams *exec_params)
 {
     if (!exec_params) {
@@ -178,3 +191,69 @@ int ff_dnn_fill_gettingoutput_task(TaskItem *task, DNNExecBaseParams *exec_param
 
     return ff_dnn_fill_task(task, exec_params, backend_model, 0, 0);
 }
+
+int ff_dnn_shared_get(const char *key, void **obj,
+                      int (*create)(void **obj, void *opaque),
+                      void (*destroy)(void *obj), void *opaque)
+{
+    DNNSharedEntry *e;
+    int ret = 0;
+
+    ff_mutex_lock(&shared_lock);
+    for (e = shared_list; e; e = e->next) {
+        if (!strcmp(e->key, key))
+            break;
+    }
+
+    if (e) {
+        e->refcount++;
+    } else {
+        e = av_mallocz(sizeof(*e));
+        if (e)
+            e->key = av_strdup(key);
+        if (!e || !e->key) {
+            ret = AVERROR(ENOMEM);
+        } else if ((ret = create(&e->obj, opaque)) >= 0) {
+            e->destroy  = destroy;
+            e->refcount = 1;
+            e->next     = shared_list;
+            shared_list = e;
+        }
+        if (ret < 0) {
+            if (e)
+                av_free(e->key);
+            av_freep(&e);
+        }
+    }
+    ff_mutex_unlock(&shared_lock);
+
+    if (ret < 0)
+        return ret;
+
+    *obj = e->obj;
+
+    return 0;
+}
+
+void ff_dnn_shared_release(void *obj)
+{
+    if (!obj)
+        return;
+
+    ff_mutex_lock(&shared_lock);
+    for (DNNSharedEntry **e = &shared_list; *e; e = &(*e)->next) {
+        DNNSharedEntry *entry = *e;
+
+        if (entry->obj != obj)
+            continue;
+
+        if (!--entry->refcount) {
+            *e = entry->next;
+            entry->destroy(entry->obj);
+            av_free(entry->key);
+            av_free(entry);
+        }
+        break;
+    }
+    ff_mutex_unlock(&shared_lock);
+}
@@ -157,4 +157,32 @@ DNNAsyncStatusType ff_dnn_get_result_common(Queue *task_queue, AVFrame **in, AVF
  */
 int ff_dnn_fill_gettingoutput_task(TaskItem *task, DNNExecBaseParams *exec_params, void *backend_model, int input_height, int input_width, void *ctx);
 
+/**
+ * Get a backend object shared by all filter instances of the process.
+ *
+ * Loaded models are immutable once compiled, so instances configured
+ * identically reuse the same object instead of keeping their own copy.
+ * If no object is cached for the key, it is created by calling create()
+ * with the lock held, so concurrent instances never load it twice.
+ *
+ * @param key unique description of the object, including every option
+ *            the object depends on
+ * @param obj set to the shared object on success
+ * @param create function creating the object, returning 0 on success
+ *               or a negative error code
+ * @param destroy function freeing the object once it is no longer used
+ * @param opaque argument passed to create()
+ *
+ * @returns 0 if successful or error code otherwise.
+ */
+int ff_dnn_shared_get(const char *key, void **obj,
+                      int (*create)(void **obj, void *opaque),
+                      void (*destroy)(void *obj), void *opaque);
+
+/**
+ * Release a reference obtained with ff_dnn_shared_get(). The object is
+ * destroyed when the last reference is released.
+ */
+void ff_dnn_shared_release(void *obj);
+
 #endif
@@ -30,6 +30,7 @@
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "libavutil/avstring.h"
+#include "libavutil/bprint.h"
 #include "libavutil/detection_bbox.h"
 #include "safe_queue.h"
 #if HAVE_OPENVINO2
@@ -46,6 +47,7 @@ typedef struct OVModel{
     ov_core_t *core;
     ov_model_t *ov_model;
     ov_compiled_model_t *compiled_model;
+    int compiled_model_shared;
     ov_output_const_port_t* input_port;
     ov_preprocess_input_info_t* input_info;
     ov_output_const_port_t** output_ports;
@@ -135,6 +137,35 @@ static int ov2_map_error(ov_status_e status, const char **desc)
         *desc = "unknown error";
     return AVERROR_UNKNOWN;
 }
+
+typedef struct OVCompileParams {
+    ov_core_t *core;
+    ov_model_t *model;
+    const char *device;
+} OVCompileParams;
+
+static int create_core_ov(void **obj, void *opaque)
+{
+    return ov2_map_error(ov_core_create((ov_core_t **)obj), NULL);
+}
+
+static void free_core_ov(void *obj)
+{
+    ov_core_free(obj);
+}
+
+static int compile_model_ov(void **obj, void *opaque)
+{
+    OVCompileParams *params = opaque;
+    ov_status_e status = ov_core_compile_model(params->core, params->model, params->device,
+                                               0, (ov_compiled_model_t **)obj);
+    return ov2_map_error(status, NULL);
+}
+
+static void free_compiled_model_ov(void *obj)
+{
+    ov_compiled_model_free(obj);
+}
 #endif
 
 #if HAVE_OPENVINO2
@@ -553,12 +584,13 @@ static void dnn_free_model_ov(DNNModel **model)
     av_freep(&ov_model->output_ports);
     if (ov_model->preprocess)
         ov_preprocess_prepostprocessor_free(ov_model->preprocess);
-    if (ov_model->compiled_model)
+    if (ov_model->compiled_model_shared)
+        ff_dnn_shared_release(ov_model->compiled_model);
+    else if (ov_model->compiled_model)
         ov_compiled_model_free(ov_model->compiled_model);
     if (ov_model->ov_model)
         ov_model_free(ov_model->ov_model);
-    if (ov_model->core)
-        ov_core_free(ov_model->core);
+    ff_dnn_shared_release(ov_model->core);
 #else
     if (ov_model->exe_network)
         ie_exec_network_free(&ov_model->exe_network);
@@ -757,6 +789,35 @@ static int init_model_ov(OVModel *ov_model, const char *input_name, const char *
     }
     ov_model_free(tmp_ov_model);
 
+    //compile network
+    if (ctx->ov_option.input_resizable) {
+        // the model was reshaped to the input size of this instance
+        status = ov_core_compile_model(ov_model->core, ov_model->ov_model, device, 0, &ov_model->compiled_model);
+        if (status != OK) {
+            ret = ov2_map_error(status, NULL);
+            goto err;
+        }
+    } else {
+        OVCompileParams params = { ov_model->core, ov_model->ov_model, device };
+        AVBPrint key;
+
+        av_bprint_init(&key, 0, AV_BPRINT_SIZE_UNLIMITED);
+        av_bprintf(&key, "openvino|%s|%s|%s|%d|%d|%g|%g", ctx->model_filename, device,
+                   input_name ? input_name : "", ov_model->model.func_type,
+                   ctx->ov_option.layout, ctx->ov_option.scale, ctx->ov_option.mean);
+        for (int i = 0; i < nb_outputs; i++)
+            av_bprintf(&key, "|%s", output_names ? output_names[i] : "");
+        if (!av_bprint_is_complete(&key))
+            ret = AVERROR(ENOMEM);
+        else
+            ret = ff_dnn_shared_get(key.str, (void **)&ov_model->compiled_model,
+                                    compile_model_ov, free_compiled_model_ov, &params);
+        av_bprint_finalize(&key, NULL);
+        if (ret < 0)
+            goto err;
+        ov_model->compiled_model_shared = 1;
+    }
+
     //update output_port
     if (!ov_model->output_ports) {
         ov_model->output_ports = av_calloc(nb_outputs, sizeof(*ov_model->output_ports));
@@ -773,11 +834,11 @@ static int init_model_ov(OVModel *ov_model, const char *input_name, const char *
     for (int i = 0; i < nb_outputs; i++) {
         char *port_name;
         if (output_names)
-            status = ov_model_const_output_by_name(ov_model->ov_model, output_names[i],
-                                            &ov_model->output_ports[i]);
+            status = ov_compiled_model_output_by_name(ov_model->compiled_model, output_names[i],
+                                                      &ov_model->output_ports[i]);
         else
-            status = ov_model_const_output_by_index(ov_model->ov_model, i,
-                                            &ov_model->output_ports[i]);
+            status = ov_compiled_model_output_by_index(ov_model->compiled_model, i,
+                                                       &ov_model->output_ports[i]);
         if (status != OK) {
             av_log(ctx, AV_LOG_ERROR, "Failed to get output port %s.\n", output_names[i]);
             goto err;
@@ -791,12 +852,6 @@ static int init_model_ov(OVModel *ov_model, const char *input_name, const char *
         ov_free(port_name);
         port_name = NULL;
     }
-    //compile network
-    status = ov_core_compile_model(ov_model->core, ov_model->ov_model, device, 0, &ov_model->compiled_model);
-    if (status != OK) {
-        ret = ov2_map_error(status, NULL);
-        goto err;
-    }
     ov_preprocess_input_model_info_free(input_model_info);
     input_model_info = NULL;
     ov_layout_free(NCHW_layout);
@@ -1384,10 +1439,9 @@ static DNNModel *dnn_load_model_ov(DnnContext *ctx, DNNFunctionType func_type, A
     model = &ov_model->model;
 
 #if HAVE_OPENVINO2
-    status = ov_core_create(&core);
-    if (status != OK) {
+    // the core loads the device plugins, share it with all instances
+    if (ff_dnn_shared_get("openvino core", (void **)&core, create_core_ov, free_core_ov, NULL) < 0)
         goto err;
-    }
     ov_model->core = core;
 
     status = ov_core_read_model(core, ctx->model_filename, NULL, &ovmodel);
@@ -29,6 +29,8 @@
 extern "C" {
 #include "dnn_io_proc.h"
 #include "dnn_backend_common.h"
+#include "libavutil/avstring.h"
+#include "libavutil/imgutils.h"
 #include "libavutil/opt.h"
 #include "libavutil/mem.h"
 #include "queue.h"
@@ -39,6 +41,8 @@ typedef struct THModel {
     DNNModel model;
     DnnContext *ctx;
     torch::jit::Module *jit_model;
+    // the model runs on an accelerator, convert the frames there
+    int device_ioproc;
     SafeQueue *request_queue;
     Queue *task_queue;
     Queue *lltask_queue;
@@ -83,6 +87,11 @@ static int extract_lltask_from_task(TaskItem *task, Queue *lltask_queue)
     return 0;
 }
 
+static int is_packed_rgb(int format)
+{
+    return format == AV_PIX_FMT_RGB24 || format == AV_PIX_FMT_BGR24;
+}
+
 static void th_free_request(THInferRequest *request)
 {
     if (!request)
@@ -138,7 +147,7 @@ static void dnn_free_model_th(DNNModel **model)
         av_freep(&item);
     }
     ff_queue_destroy(th_model->task_queue);
-    delete th_model->jit_model;
+    ff_dnn_shared_release(th_model->jit_model);
     av_freep(&th_model);
     *model = NULL;
 }
@@ -187,12 +196,28 @@ static int fill_model_input_th(THModel *th_model, THRequestItem *request)
     channel_idx = dnn_get_channel_idx_by_layout(input.layout);
     input.dims[height_idx] = task->in_frame->height;
     input.dims[width_idx] = task->in_frame->width;
+    infer_request->input_tensor = new torch::Tensor();
+    infer_request->output = new torch::Tensor();
+
+    if (th_model->model.func_type == DFT_PROCESS_FRAME && task->do_ioproc &&
+        !th_model->model.frame_pre_proc && th_model->device_ioproc &&
+        is_packed_rgb(task->in_frame->format)) {
+        // Upload the 8-bit pixels and deinterleave/normalize them on the
+        // device, which transfers a quarter of the float planar data.
+        const AVFrame *frame = task->in_frame;
+        c10::Device device = (*th_model->jit_model->parameters().begin()).device();
+        torch::Tensor pixels = torch::from_blob(frame->data[0], {frame->height, frame->width, 3},
+                                                {frame->linesize[0], 3, 1}, torch::kUInt8);
+
+        *infer_request->input_tensor = pixels.to(device).permute({2, 0, 1}).unsqueeze(0)
+                                             .to(torch::kFloat32).div(255.f);
+        return 0;
+    }
+
     input.data = av_malloc(input.dims[height_idx] * input.dims[width_idx] *
                            input.dims[channel_idx] * sizeof(float));
     if (!input.data)
         return AVERROR(ENOMEM);
-    infer_request->input_tensor = new torch::Tensor();
-    infer_request->output = new torch::Tensor();
 
     switch (th_model->model.func_type) {
     case DFT_PROCESS_FRAME:
@@ -287,7 +312,17 @@ static void infer_completion_callback(void *args) {
 
     switch (th_model->model.func_type) {
     case DFT_PROCESS_FRAME:
-        if (task->do_ioproc) {
+        if (task->do_ioproc && th_model->device_ioproc && !th_model->model.frame_post_proc &&
+            is_packed_rgb(task->out_frame->format) && outputs.dims[0] == 1 && outputs.dims[1] == 3 &&
+            outputs.dims[2] == task->out_frame->height && outputs.dims[3] == task->out_frame->width) {
+            // Quantize and interleave on the device, only download 8-bit pixels.
+            torch::Tensor pixels = output->mul(255.f).round().clamp(0, 255).to(torch::kUInt8)
+                                          .squeeze(0).permute({1, 2, 0}).contiguous().to(torch::kCPU);
+
+            av_image_copy_plane(task->out_frame->data[0], task->out_frame->linesize[0],
+                                pixels.data_ptr<uint8_t>(), task->out_frame->width * 3,
+                                task->out_frame->width * 3, task->out_frame->height);
+        } else if (task->do_ioproc) {
             // Post process can only deal with CPU memory.
             if (output->device() != torch::kCPU)
                 *output = output->to(torch::kCPU);
@@ -416,12 +451,43 @@ static THInferRequest *th_create_inference_request(void)
     return request;
 }
 
+typedef struct THLoadParams {
+    const char *filename;
+    const c10::Device *device;
+} THLoadParams;
+
+static int load_jit_model(void **obj, void *opaque)
+{
+    THLoadParams *params = (THLoadParams *)opaque;
+    torch::jit::Module *jit_model = NULL;
+
+    try {
+        jit_model = new torch::jit::Module;
+        (*jit_model) = torch::jit::load(params->filename);
+        jit_model->to(*params->device);
+    } catch (const c10::Error& e) {
+        delete jit_model;
+        return DNN_GENERIC_ERROR;
+    }
+
+    *obj = jit_model;
+    return 0;
+}
+
+static void free_jit_model(void *obj)
+{
+    delete (torch::jit::Module *)obj;
+}
+
 static DNNModel *dnn_load_model_th(DnnContext *ctx, DNNFunctionType func_type, AVFilterContext *filter_ctx)
 {
     DNNModel *model = NULL;
     THModel *th_model = NULL;
     THRequestItem *item = NULL;
     const char *device_name = ctx->device ? ctx->device : "cpu";
+    THLoadParams params;
+    char *key;
+    int ret;
 
     th_model = (THModel *)av_mallocz(sizeof(THModel));
     if (!th_model)
@@ -436,16 +502,27 @@ static DNNModel *dnn_load_model_th(DnnContext *ctx, DNNFunctionType func_type, A
             goto fail;
         }
         at::detail::getXPUHooks().initXPU();
+    } else if (device.is_cuda()) {
+        if (!torch::cuda::is_available()) {
+            av_log(ctx, AV_LOG_ERROR, "No CUDA device found\n");
+            goto fail;
+        }
     } else if (!device.is_cpu()) {
         av_log(ctx, AV_LOG_ERROR, "Not supported device:\"%s\"\n", device_name);
         goto fail;
     }
+    th_model->device_ioproc = !device.is_cpu();
 
-    try {
-        th_model->jit_model = new torch::jit::Module;
-        (*th_model->jit_model) = torch::jit::load(ctx->model_filename);
-        th_model->jit_model->to(device);
-    } catch (const c10::Error& e) {
+    // the module is only used for inference, share it with all instances
+    key = av_asprintf("torch|%s|%s", ctx->model_filename, device_name);
+    if (!key)
+        goto fail;
+    params.filename = ctx->model_filename;
+    params.device   = &device;
+    ret = ff_dnn_shared_get(key, (void **)&th_model->jit_model,
+                            load_jit_model, free_jit_model, &params);
+    av_free(key);
+    if (ret < 0) {
         av_log(ctx, AV_LOG_ERROR, "Failed to load torch model\n");
         goto fail;
     }
@@ -0,0 +1,104 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFILTER_DYNAMICSDSP_H
+#define AVFILTER_DYNAMICSDSP_H
+
+#include <math.h>
+
+#include "libavutil/attributes.h"
+
+/**
+ * Block kernels of the acompressor and agate filters: the detector input
+ * is gathered from the sidechain planes, the envelope followers run on it
+ * in scalar code, and the resulting gains are applied to the input planes.
+ *
+ * All the operations are exact, so every implementation gives results
+ * identical to the C code. Any length and alignment is allowed.
+ */
+typedef struct AudioDynamicsDSPContext {
+    /**
+     * Compute dst[i] = |src[i] * level|.
+     */
+    void (*abs_float)(float *dst, const float *src, float level, int len);
+    void (*abs_double)(double *dst, const double *src, double level, int len);
+
+    /**
+     * Compute dst[i] = max(|src[i] * level|, dst[i]).
+     */
+    void (*abs_max_float)(float *dst, const float *src, float level, int len);
+    void (*abs_max_double)(double *dst, const double *src, double level, int len);
+
+    /**
+     * Compute dst[i] += |src[i] * level|.
+     */
+    void (*abs_add_float)(float *dst, const float *src, float level, int len);
+    void (*abs_add_double)(double *dst, const double *src, double level, int len);
+
+    /**
+     * Compute dst[i] = src[i] * gain[i]. dst may be equal to src.
+     */
+    void (*mul_float)(float *dst, const float *src, const float *gain, int len);
+    void (*mul_double)(double *dst, const double *src, const double *gain, int len);
+} AudioDynamicsDSPContext;
+
+#define DYNAMICS_FUNCS(ftype, name, FABS, FMAX)                             \
+static void abs_##name##_c(ftype *dst, const ftype *src,                    \
+                           ftype level, int len)                            \
+{                                                                           \
+    for (int i = 0; i < len; i++)                                           \
+        dst[i] = FABS(src[i] * level);                                      \
+}                                                                           \
+                                                                            \
+static void abs_max_##name##_c(ftype *dst, const ftype *src,                \
+                               ftype level, int len)                        \
+{                                                                           \
+    for (int i = 0; i < len; i++)                                           \
+        dst[i] = FMAX(FABS(src[i] * level), dst[i]);                        \
+}                                                                           \
+                                                                            \
+static void abs_add_##name##_c(ftype *dst, const ftype *src,                \
+                               ftype level, int len)                        \
+{                                                                           \
+    for (int i = 0; i < len; i++)                                           \
+        dst[i] += FABS(src[i] * level);                                     \
+}                                                                           \
+                                                                            \
+static void mul_##name##_c(ftype *dst, const ftype *src,                    \
+                           const ftype *gain, int len)                      \
+{                                                                           \
+    for (int i = 0; i < len; i++)                                           \
+        dst[i] = src[i] * gain[i];                                          \
+}
+
+DYNAMICS_FUNCS(float,  float,  fabsf, fmaxf)
+DYNAMICS_FUNCS(double, double, fabs,  fmax)
+
+static av_unused void ff_dynamics_init(AudioDynamicsDSPContext *dsp)
+{
+    dsp->abs_float      = abs_float_c;
+    dsp->abs_double     = abs_double_c;
+    dsp->abs_max_float  = abs_max_float_c;
+    dsp->abs_max_double = abs_max_double_c;
+    dsp->abs_add_float  = abs_add_float_c;
+    dsp->abs_add_double = abs_add_double_c;
+    dsp->mul_float      = mul_float_c;
+    dsp->mul_double     = mul_double_c;
+}
+
+#endif /* AVFILTER_DYNAMICSDSP_H */
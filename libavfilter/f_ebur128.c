@@ -37,7 +37,6 @@
 #include "libavutil/xga_font_data.h"
 #include "libavutil/opt.h"
 #include "libavutil/timestamp.h"
-#include "libswresample/swresample.h"
 #include "audio.h"
 #include "avfilter.h"
 #include "filters.h"
@@ -49,6 +48,9 @@
 #define HIST_GRAIN   100            ///< defines histogram precision
 #define HIST_SIZE  ((ABS_UP_THRES - ABS_THRES) * HIST_GRAIN + 1)
 
+#define TP_TAPS       12            ///< true-peak interpolation filter length per phase
+#define TP_MAX_FACTOR  4            ///< maximum true-peak over-sampling factor
+
 /**
  * A histogram is an array of HIST_SIZE hist_entry storing all the energies
  * recorded (with an accuracy of 1/HIST_GRAIN) of the loudnesses from ABS_THRES
@@ -95,11 +97,10 @@ typedef struct EBUR128Context {
     double *sample_peaks;           ///< sample peaks per channel
     double *true_peaks_per_frame;   ///< true peaks in a frame per channel
     double *sample_peaks_per_frame; ///< sample peaks in a frame per channel
-#if CONFIG_SWRESAMPLE
-    SwrContext *swr_ctx;            ///< over-sampling context for true peak metering
-    double *swr_buf;                ///< resampled audio data for true peak metering
-    int swr_linesize;
-#endif
+    int tp_factor;                  ///< over-sampling factor for true peak metering
+    int tp_max_samples;             ///< maximum number of samples interpolated at once
+    double tp_coeffs[TP_TAPS][TP_MAX_FACTOR]; ///< polyphase interpolation filter, one column per phase
+    double *tp_buf;                 ///< per channel filter history followed by the samples to interpolate
 
     /* video  */
     int do_video;                   ///< 1 if video output enabled, 0 otherwise
@@ -499,31 +500,35 @@ static int config_audio_out(AVFilterLink *outlink, EBUR128Context *ebur128)
             return AVERROR(ENOMEM);
     }
 
-#if CONFIG_SWRESAMPLE
     if (ebur128->peak_mode & PEAK_MODE_TRUE_PEAKS) {
-        int ret;
+        /* Over-sample to at least 192kHz, as BS.1770 Annex 2 does with its
+         * 4x interpolator at 48kHz. Each phase is a Hann windowed sinc
+         * normalized to unity DC gain; phase 0 is the input sample itself. */
+        ebur128->tp_factor = outlink->sample_rate < 96000  ? 4 :
+                             outlink->sample_rate < 192000 ? 2 : 1;
+        for (int p = 0; p < ebur128->tp_factor; p++) {
+            double sum = 0.0;
+
+            for (int j = 0; j < TP_TAPS; j++) {
+                const double d = j - (TP_TAPS / 2 - 1) - p / (double)ebur128->tp_factor;
+                const double w = 0.5 * (1.0 + cos(2.0 * M_PI * d / TP_TAPS));
+
+                ebur128->tp_coeffs[j][p] = d == 0.0 ? 1.0 : !p ? 0.0 : w * sin(M_PI * d) / (M_PI * d);
+                sum += ebur128->tp_coeffs[j][p];
+            }
+            for (int j = 0; j < TP_TAPS; j++)
+                ebur128->tp_coeffs[j][p] /= sum;
+        }
 
-        ebur128->swr_buf    = av_malloc_array(nb_channels, 19200 * sizeof(double));
+        ebur128->tp_max_samples = FFMAX(outlink->sample_rate / 10, 1);
+        ebur128->tp_buf     = av_calloc(nb_channels, (TP_TAPS - 1 + ebur128->tp_max_samples) *
+                                        sizeof(*ebur128->tp_buf));
         ebur128->true_peaks = av_calloc(nb_channels, sizeof(*ebur128->true_peaks));
         ebur128->true_peaks_per_frame = av_calloc(nb_channels, sizeof(*ebur128->true_peaks_per_frame));
-        ebur128->swr_ctx    = swr_alloc();
-        if (!ebur128->swr_buf || !ebur128->true_peaks ||
-            !ebur128->true_peaks_per_frame || !ebur128->swr_ctx)
+        if (!ebur128->tp_buf || !ebur128->true_peaks ||
+            !ebur128->true_peaks_per_frame)
             return AVERROR(ENOMEM);
-
-        av_opt_set_chlayout(ebur128->swr_ctx, "in_chlayout",    &outlink->ch_layout, 0);
-        av_opt_set_int(ebur128->swr_ctx, "in_sample_rate",       outlink->sample_rate, 0);
-        av_opt_set_sample_fmt(ebur128->swr_ctx, "in_sample_fmt", outlink->format, 0);
-
-        av_opt_set_chlayout(ebur128->swr_ctx, "out_chlayout",    &outlink->ch_layout, 0);
-        av_opt_set_int(ebur128->swr_ctx, "out_sample_rate",       192000, 0);
-        av_opt_set_sample_fmt(ebur128->swr_ctx, "out_sample_fmt", outlink->format, 0);
-
-        ret = swr_init(ebur128->swr_ctx);
-        if (ret < 0)
-            return ret;
     }
-#endif
 
     if (ebur128->peak_mode & PEAK_MODE_SAMPLES_PEAKS) {
         ebur128->sample_peaks_per_frame = av_calloc(nb_channels, sizeof(*ebur128->sample_peaks_per_frame));
@@ -574,12 +579,6 @@ static av_cold int init_ebur128(AVFilterContext *ctx, EBUR128Context *ebur128)
             ebur128->loglevel = AV_LOG_INFO;
     }
 
-    if (!CONFIG_SWRESAMPLE && (ebur128->peak_mode & PEAK_MODE_TRUE_PEAKS)) {
-        av_log(ctx, AV_LOG_ERROR,
-               "True-peak mode requires libswresample to be performed\n");
-        return AVERROR(EINVAL);
-    }
-
     // if meter is  +9 scale, scale range is from -18 LU to  +9 LU (or 3*9)
     // if meter is +18 scale, scale range is from -36 LU to +18 LU (or 3*18)
     ebur128->scale_range = 3 * ebur128->meter;
@@ -644,98 +643,168 @@ static int gate_update(struct integrator *integ, double power,
     return gate_hist_pos;
 }
 
-static int true_peaks_ebur128(EBUR128Context *ebur128, const uint8_t **samples,
-                              int nb_samples)
+static void true_peaks_channel(EBUR128Context *ebur128, const double *samples,
+                               int nb_samples, int ch)
 {
-#if CONFIG_SWRESAMPLE
-    if (ebur128->peak_mode & PEAK_MODE_TRUE_PEAKS && ebur128->idx_insample == 0) {
-        const double *swr_samples = ebur128->swr_buf;
-        const int nb_channels = ebur128->nb_channels;
-        int nb_out_samples = swr_get_out_samples(ebur128->swr_ctx, nb_samples);
-
-        while (nb_out_samples > 0) {
-            int ret = swr_convert(ebur128->swr_ctx, (uint8_t**)&ebur128->swr_buf, 19200,
-                                  samples, nb_samples);
-            if (ret <= 0)
-                return ret;
-            for (int ch = 0; ch < nb_channels; ch++)
-                ebur128->true_peaks_per_frame[ch] = 0.0;
-            for (int idx_insample = 0; idx_insample < ret; idx_insample++) {
-                for (int ch = 0; ch < nb_channels; ch++) {
-                    ebur128->true_peaks[ch] = FFMAX(ebur128->true_peaks[ch], fabs(*swr_samples));
-                    ebur128->true_peaks_per_frame[ch] = FFMAX(ebur128->true_peaks_per_frame[ch],
-                                                              fabs(*swr_samples));
-                    swr_samples++;
-                }
-            }
+    const int nb_channels = ebur128->nb_channels;
+    double *buf = ebur128->tp_buf + ch * (TP_TAPS - 1 + ebur128->tp_max_samples);
+    double peak = 0.0;
+
+    while (nb_samples > 0) {
+        const int nb = FFMIN(nb_samples, ebur128->tp_max_samples);
 
-            nb_out_samples -= ret;
-            nb_samples = 0;
+        for (int n = 0; n < nb; n++)
+            buf[TP_TAPS - 1 + n] = samples[n * nb_channels + ch];
+
+        /* all the phases of an input sample are computed at once, so the
+         * inner loop is independent across phases and vectorizes */
+        for (int n = 0; n < nb; n++) {
+            const double *src = buf + n;
+            double sum[TP_MAX_FACTOR] = { 0.0 };
+
+            for (int j = 0; j < TP_TAPS; j++) {
+                for (int p = 0; p < TP_MAX_FACTOR; p++)
+                    sum[p] += src[j] * ebur128->tp_coeffs[j][p];
+            }
+            for (int p = 0; p < TP_MAX_FACTOR; p++)
+                peak = FFMAX(peak, fabs(sum[p]));
         }
+
+        memmove(buf, buf + nb, (TP_TAPS - 1) * sizeof(*buf));
+        samples    += nb * nb_channels;
+        nb_samples -= nb;
     }
-#endif
-    return 0;
+
+    ebur128->true_peaks_per_frame[ch] = peak;
+    ebur128->true_peaks[ch] = FFMAX(ebur128->true_peaks[ch], peak);
 }
 
-static void process_ebur128(EBUR128Context *ebur128, const double *samples)
+static void filter_channel(EBUR128Context *ebur128, const double *samples,
+                           int nb_samples, int ch)
 {
     const int nb_channels = ebur128->nb_channels;
     const int bin_id_400  = ebur128->i400.cache_pos;
     const int bin_id_3000 = ebur128->i3000.cache_pos;
+    double *cache_400  = ebur128->i400.cache [ch];
+    double *cache_3000 = ebur128->i3000.cache[ch];
+    double *x = ebur128->x + ch * 3;
+    double *y = ebur128->y + ch * 3;
+    double *z = ebur128->z + ch * 3;
+    double sum_400, sum_3000, x1, x2, y1, y2, z1, z2;
+    const double pre_b0 = ebur128->pre_b[0], pre_b1 = ebur128->pre_b[1], pre_b2 = ebur128->pre_b[2];
+    const double pre_a1 = ebur128->pre_a[1], pre_a2 = ebur128->pre_a[2];
+    const double rlb_b0 = ebur128->rlb_b[0], rlb_b1 = ebur128->rlb_b[1], rlb_b2 = ebur128->rlb_b[2];
+    const double rlb_a1 = ebur128->rlb_a[1], rlb_a2 = ebur128->rlb_a[2];
+    int pos_400, pos_3000;
 
-#define MOVE_TO_NEXT_CACHED_ENTRY(time) do {                \
-    ebur128->i##time.cache_pos++;                           \
-    if (ebur128->i##time.cache_pos ==                       \
-        ebur128->i##time.cache_size) {                      \
-        ebur128->i##time.filled    = 1;                     \
-        ebur128->i##time.cache_pos = 0;                     \
-    }                                                       \
-} while (0)
-
-    MOVE_TO_NEXT_CACHED_ENTRY(400);
-    MOVE_TO_NEXT_CACHED_ENTRY(3000);
-
-    for (int ch = 0; ch < nb_channels; ch++) {
-        double bin;
+    if (ebur128->peak_mode & PEAK_MODE_SAMPLES_PEAKS) {
+        double peak = 0.0;
 
-        if (ebur128->peak_mode & PEAK_MODE_SAMPLES_PEAKS) {
-            ebur128->sample_peaks[ch] = FFMAX(ebur128->sample_peaks[ch], fabs(samples[ch]));
-            ebur128->sample_peaks_per_frame[ch] = FFMAX(ebur128->sample_peaks_per_frame[ch], fabs(samples[ch]));
-        }
+        for (int n = 0; n < nb_samples; n++)
+            peak = FFMAX(peak, fabs(samples[n * nb_channels + ch]));
+        ebur128->sample_peaks[ch] = FFMAX(ebur128->sample_peaks[ch], peak);
+        ebur128->sample_peaks_per_frame[ch] = FFMAX(ebur128->sample_peaks_per_frame[ch], peak);
+    }
 
-        ebur128->x[ch * 3] = samples[ch]; // set X[i]
+    if (!ebur128->ch_weighting[ch])
+        return;
 
-        if (!ebur128->ch_weighting[ch])
-            continue;
+    /* x[1], x[2]: X[i-1], X[i-2]; y[0], y[1]: Y[i-1], Y[i-2]; same for z */
+    x1 = x[1]; x2 = x[2];
+    y1 = y[0]; y2 = y[1];
+    z1 = z[0]; z2 = z[1];
+    sum_400  = ebur128->i400.sum [ch];
+    sum_3000 = ebur128->i3000.sum[ch];
+    pos_400  = bin_id_400;
+    pos_3000 = bin_id_3000;
 
+    for (int n = 0; n < nb_samples; n++) {
+        const double x0 = samples[n * nb_channels + ch];
         /* Y[i] = X[i]*b0 + X[i-1]*b1 + X[i-2]*b2 - Y[i-1]*a1 - Y[i-2]*a2 */
-#define FILTER(Y, X, NUM, DEN) do {                                         \
-        double *dst = ebur128->Y + ch*3;                                    \
-        double *src = ebur128->X + ch*3;                                    \
-        dst[2] = dst[1];                                                    \
-        dst[1] = dst[0];                                                    \
-        dst[0] = src[0]*NUM[0] + src[1]*NUM[1] + src[2]*NUM[2]              \
-                               - dst[1]*DEN[1] - dst[2]*DEN[2];             \
-} while (0)
+        const double y0 = x0*pre_b0 + x1*pre_b1 + x2*pre_b2 - y1*pre_a1 - y2*pre_a2; // pre-filter
+        const double z0 = y0*rlb_b0 + y1*rlb_b1 + y2*rlb_b2 - z1*rlb_a1 - z2*rlb_a2; // RLB-filter
+        const double bin = z0 * z0;
 
-        // TODO: merge both filters in one?
-        FILTER(y, x, ebur128->pre_b, ebur128->pre_a);  // apply pre-filter
-        ebur128->x[ch * 3 + 2] = ebur128->x[ch * 3 + 1];
-        ebur128->x[ch * 3 + 1] = ebur128->x[ch * 3    ];
-        FILTER(z, y, ebur128->rlb_b, ebur128->rlb_a);  // apply RLB-filter
-
-        bin = ebur128->z[ch * 3] * ebur128->z[ch * 3];
+        x2 = x1; x1 = x0;
+        y2 = y1; y1 = y0;
+        z2 = z1; z1 = z0;
 
         /* add the new value, and limit the sum to the cache size (400ms or 3s)
          * by removing the oldest one */
-        ebur128->i400.sum [ch] = ebur128->i400.sum [ch] + bin - ebur128->i400.cache [ch][bin_id_400];
-        ebur128->i3000.sum[ch] = ebur128->i3000.sum[ch] + bin - ebur128->i3000.cache[ch][bin_id_3000];
+        sum_400  = sum_400  + bin - cache_400 [pos_400];
+        sum_3000 = sum_3000 + bin - cache_3000[pos_3000];
 
         /* override old cache entry with the new value */
-        ebur128->i400.cache [ch][bin_id_400 ] = bin;
-        ebur128->i3000.cache[ch][bin_id_3000] = bin;
+        cache_400 [pos_400]  = bin;
+        cache_3000[pos_3000] = bin;
+
+        if (++pos_400 == ebur128->i400.cache_size)
+            pos_400 = 0;
+        if (++pos_3000 == ebur128->i3000.cache_size)
+            pos_3000 = 0;
     }
 
+    x[1] = x1; x[2] = x2;
+    y[0] = y1; y[1] = y2;
+    z[0] = z1; z[1] = z2;
+    ebur128->i400.sum [ch] = sum_400;
+    ebur128->i3000.sum[ch] = sum_3000;
+}
+
+typedef struct ThreadData {
+    EBUR128Context *ebur128;
+    const double *samples;
+    int nb_samples;
+    int tp_nb_samples;
+} ThreadData;
+
+static int filter_channels(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    ThreadData *td = arg;
+    EBUR128Context *ebur128 = td->ebur128;
+    const int start = (ebur128->nb_channels * jobnr) / nb_jobs;
+    const int end = (ebur128->nb_channels * (jobnr+1)) / nb_jobs;
+
+    for (int ch = start; ch < end; ch++) {
+        if (td->tp_nb_samples > 0)
+            true_peaks_channel(ebur128, td->samples, td->tp_nb_samples, ch);
+        filter_channel(ebur128, td->samples, td->nb_samples, ch);
+    }
+
+    return 0;
+}
+
+/**
+ * Filter and integrate samples [offset, offset + nb_samples) of a frame of
+ * interleaved samples. The true peaks are looked up over the whole frame,
+ * when starting it.
+ */
+static void process_ebur128(AVFilterContext *ctx, EBUR128Context *ebur128,
+                            const double *samples, int nb_frame_samples,
+                            int offset, int nb_samples)
+{
+    const int nb_channels = ebur128->nb_channels;
+    ThreadData td;
+
+    td.ebur128       = ebur128;
+    td.samples       = samples + offset * nb_channels;
+    td.nb_samples    = nb_samples;
+    td.tp_nb_samples = ebur128->peak_mode & PEAK_MODE_TRUE_PEAKS && !offset ? nb_frame_samples : 0;
+    ff_filter_execute(ctx, filter_channels, &td, NULL,
+                      FFMIN(nb_channels, ff_filter_get_nb_threads(ctx)));
+
+#define MOVE_TO_NEXT_CACHED_ENTRY(time) do {                \
+    ebur128->i##time.cache_pos += nb_samples;               \
+    while (ebur128->i##time.cache_pos >=                    \
+           ebur128->i##time.cache_size) {                   \
+        ebur128->i##time.filled     = 1;                    \
+        ebur128->i##time.cache_pos -= ebur128->i##time.cache_size; \
+    }                                                       \
+} while (0)
+
+    MOVE_TO_NEXT_CACHED_ENTRY(400);
+    MOVE_TO_NEXT_CACHED_ENTRY(3000);
+
 #define FIND_PEAK(global, sp, ptype) do {                        \
     int ch;                                                      \
     double maxpeak;                                              \
@@ -752,6 +821,17 @@ static void process_ebur128(EBUR128Context *ebur128, const double *samples)
     FIND_PEAK(ebur128->true_peak,   ebur128->true_peaks,   TRUE);
 }
 
+/**
+ * Number of samples to process from idx_insample before the next loudness
+ * refresh, every 100ms, or the end of the frame.
+ */
+static int block_samples(AVFilterLink *inlink, EBUR128Context *ebur128,
+                         int idx_insample, int nb_samples)
+{
+    return av_clip(inlink->sample_rate / 10 - ebur128->sample_count,
+                   1, nb_samples - idx_insample);
+}
+
 static void ebur128_loudness(AVFilterLink *inlink,
                              EBUR128Context *ebur128,
                              double *l400, double *l3000, double *integrated, double *peak)
@@ -872,12 +952,12 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *insamples)
     const double *samples = (const double *)insamples->data[0];
     AVFrame *pic;
 
-    ret = true_peaks_ebur128(ebur128, (const uint8_t **)insamples->data, nb_samples);
-    if (ret < 0)
-        return ret;
-
     for (idx_insample = ebur128->idx_insample; idx_insample < nb_samples; idx_insample++) {
-        process_ebur128(ebur128, samples + idx_insample * nb_channels);
+        const int nb = block_samples(inlink, ebur128, idx_insample, nb_samples);
+
+        process_ebur128(ctx, ebur128, samples, nb_samples, idx_insample, nb);
+        idx_insample += nb - 1;
+        ebur128->sample_count += nb - 1;
 
         /* For integrated loudness, gating blocks are 400ms long with 75%
          * overlap (see BS.1770-2 p5), so a re-computation is needed each 100ms
@@ -1122,10 +1202,7 @@ static av_cold void uninit_ebur128(AVFilterContext *ctx, EBUR128Context *ebur128
     av_freep(&ebur128->i400.cache);
     av_freep(&ebur128->i3000.cache);
     av_frame_free(&ebur128->outpicref);
-#if CONFIG_SWRESAMPLE
-    av_freep(&ebur128->swr_buf);
-    swr_free(&ebur128->swr_ctx);
-#endif
+    av_freep(&ebur128->tp_buf);
 }
 
 static av_cold void uninit(AVFilterContext *ctx)
@@ -1196,7 +1273,8 @@ const AVFilter ff_af_ebur128 = {
     FILTER_OUTPUTS(ebur128_outputs),
     FILTER_QUERY_FUNC2(query_formats),
     .priv_class    = &ebur128_class,
-    .flags         = AVFILTER_FLAG_DYNAMIC_OUTPUTS,
+    .flags         = AVFILTER_FLAG_DYNAMIC_OUTPUTS |
+                     AVFILTER_FLAG_SLICE_THREADS,
 };
 
 #define FIFO_SIZE 30
@@ -1485,16 +1563,13 @@ static int loudnorm_filter_frame(AVFilterLink *inlink, AVFrame *in)
     int nb_samples = in ? in->nb_samples : 0;
     const double *samples = in ? (const double *)in->data[0] : NULL;
     AVFrame *out;
-    int ret;
-
-    if (in) {
-        ret = true_peaks_ebur128(r128_in, (const uint8_t **)in->data, nb_samples);
-        if (ret < 0)
-            return ret;
-    }
 
     for (int idx_insample = r128_in->idx_insample; idx_insample < nb_samples; idx_insample++) {
-        process_ebur128(r128_in, samples + idx_insample * nb_channels);
+        const int nb = block_samples(inlink, r128_in, idx_insample, nb_samples);
+
+        process_ebur128(ctx, r128_in, samples, nb_samples, idx_insample, nb);
+        idx_insample += nb - 1;
+        r128_in->sample_count += nb - 1;
         if (++r128_in->sample_count == inlink->sample_rate / 10) {
             double peak;
 
@@ -1560,13 +1635,13 @@ static int loudnorm_filter_frame(AVFilterLink *inlink, AVFrame *in)
         }
     }
 
-    ret = true_peaks_ebur128(r128_out, (const uint8_t **)out->data, out->nb_samples);
-    if (ret < 0)
-        return ret;
-
     samples = (const double *)out->data[0];
     for (int idx_insample = r128_out->idx_insample; idx_insample < out->nb_samples; idx_insample++) {
-        process_ebur128(r128_out, samples + idx_insample * nb_channels);
+        const int nb = block_samples(inlink, r128_out, idx_insample, out->nb_samples);
+
+        process_ebur128(ctx, r128_out, samples, out->nb_samples, idx_insample, nb);
+        idx_insample += nb - 1;
+        r128_out->sample_count += nb - 1;
         if (++r128_out->sample_count == inlink->sample_rate / 10) {
             double loudness_400, loudness_3000, loudness_integrated, peak;
             ebur128_loudness(inlink, r128_out, &loudness_400, &loudness_3000, &loudness_integrated, &peak);
@@ -1692,4 +1767,5 @@ const AVFilter ff_af_loudnorm = {
     FILTER_INPUTS(loudnorm_inputs),
     FILTER_OUTPUTS(loudnorm_outputs),
     FILTER_SINGLE_SAMPLEFMT(AV_SAMPLE_FMT_DBL),
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -90,6 +90,9 @@ enum {
     FLAG_FC_DELTA = 1 << 14,
     FLAG_SC_DELTA = 1 << 15,
     FLAG_DISABLED = 1 << 16,
+    FLAG_MAX_QUEUE = 1 << 17,
+    FLAG_STATS = 1 << 18,
+    FLAG_COPIES = 1 << 19,
 };
 
 #define OFFSET(x) offsetof(GraphMonitorContext, x)
@@ -129,6 +132,9 @@ static const AVOption graphmonitor_options[] = {
         { "sample_count_out", NULL, 0, AV_OPT_TYPE_CONST, {.i64=FLAG_SCIN},    0, 0, VFR, .unit = "flags" },
         { "sample_count_delta",NULL,0, AV_OPT_TYPE_CONST, {.i64=FLAG_SC_DELTA},0, 0, VFR, .unit = "flags" },
         { "disabled",         NULL, 0, AV_OPT_TYPE_CONST, {.i64=FLAG_DISABLED},0, 0, VFR, .unit = "flags" },
+        { "max_queue",        NULL, 0, AV_OPT_TYPE_CONST, {.i64=FLAG_MAX_QUEUE},0,0, VFR, .unit = "flags" },
+        { "stats",            NULL, 0, AV_OPT_TYPE_CONST, {.i64=FLAG_STATS},   0, 0, VFR, .unit = "flags" },
+        { "copies",           NULL, 0, AV_OPT_TYPE_CONST, {.i64=FLAG_COPIES},  0, 0, VFR, .unit = "flags" },
     { "rate", "set video rate", OFFSET(frame_rate), AV_OPT_TYPE_VIDEO_RATE, {.str = "25"}, 0, INT_MAX, VF },
     { "r",    "set video rate", OFFSET(frame_rate), AV_OPT_TYPE_VIDEO_RATE, {.str = "25"}, 0, INT_MAX, VF },
     { NULL }
@@ -308,6 +314,16 @@ static int draw_items(AVFilterContext *ctx,
         drawtext(out, xpos, ypos, buffer, len, frames > 0 ? frames >= 10 ? frames >= 50 ? s->red : s->yellow : s->green : s->white);
         xpos += len * 8;
     }
+    if ((flags & FLAG_MAX_QUEUE) && (!(mode & MODE_NOZERO) || fl->max_queued_frames)) {
+        len = snprintf(buffer, sizeof(buffer)-1, " | max_queue: %"PRId64, fl->max_queued_frames);
+        drawtext(out, xpos, ypos, buffer, len, s->white);
+        xpos += len * 8;
+    }
+    if ((flags & FLAG_COPIES) && (!(mode & MODE_NOZERO) || fl->frame_copies)) {
+        len = snprintf(buffer, sizeof(buffer)-1, " | copies: %"PRId64, fl->frame_copies);
+        drawtext(out, xpos, ypos, buffer, len, fl->frame_copies ? s->yellow : s->white);
+        xpos += len * 8;
+    }
     if ((flags & FLAG_FCIN) && (!(mode & MODE_NOZERO) || fl->frame_count_in)) {
         len = snprintf(buffer, sizeof(buffer)-1, " | in: %"PRId64, fl->frame_count_in);
         drawtext(out, xpos, ypos, buffer, len, s->white);
@@ -418,6 +434,15 @@ static int create_frame(AVFilterContext *ctx, int64_t pts)
         xpos += len * 8 + 10;
         len = strlen(filter->filter->name);
         drawtext(out, xpos, ypos, filter->filter->name, len, s->white);
+        xpos += len * 8;
+        if (s->flags & FLAG_STATS) {
+            const AVFilterStats *st = avfilter_get_stats(filter);
+
+            len = snprintf(buffer, sizeof(buffer)-1, " | calls: %"PRId64" | busy: %.3fs | pool: %"PRId64"KiB",
+                           st->nb_activations, st->activate_time / 1000000.0,
+                           st->pool_bytes >> 10);
+            drawtext(out, xpos, ypos, buffer, len, s->white);
+        }
         ypos += 10;
         for (int j = 0; j < filter->nb_inputs; j++) {
             AVFilterLink *l = filter->inputs[j];
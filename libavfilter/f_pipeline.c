@@ -0,0 +1,658 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Run consecutive filter chains as pipeline stages on worker threads.
+ *
+ * Every stage is a private filtergraph driven by its own thread. Stages are
+ * joined by bounded frame queues, so while one stage works on frame N the
+ * previous one can already work on frame N+1.
+ */
+
+#include "config_components.h"
+
+#include "libavutil/avstring.h"
+#include "libavutil/channel_layout.h"
+#include "libavutil/mem.h"
+#include "libavutil/opt.h"
+#include "libavutil/pixdesc.h"
+#include "libavutil/thread.h"
+#include "audio.h"
+#include "avfilter.h"
+#include "buffersink.h"
+#include "buffersrc.h"
+#include "filters.h"
+#include "formats.h"
+#include "framequeue.h"
+#include "video.h"
+
+typedef struct PipelineStage {
+    struct PipelineContext *s;
+    int index;
+    char *desc;
+
+    AVFilterGraph *graph;
+    AVFilterContext *src;
+    AVFilterContext *sink;
+
+    /* frames waiting to enter this stage, protected by PipelineContext.lock */
+    FFFrameQueue queue;
+    int eof;
+    int64_t eof_pts;
+
+    pthread_t thread;
+    int thread_started;
+} PipelineStage;
+
+typedef struct PipelineContext {
+    const AVClass *class;
+    AVFilterContext *ctx;
+
+    char *stages_str;
+    int queue_size;
+    int nb_threads;
+
+    PipelineStage *stages;
+    int nb_stages;
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int lock_init;
+
+    FFFrameQueueGlobal fqg;
+    /* frames leaving the last stage */
+    FFFrameQueue out_queue;
+    int out_eof;
+    int64_t out_eof_pts;
+    int in_eof;
+    int error;
+    int quit;
+} PipelineContext;
+
+#define OFFSET(x) offsetof(PipelineContext, x)
+#define DEFINE_OPTIONS(filt_name, FLAGS)                                                                         \
+static const AVOption filt_name##_options[] = {                                                                  \
+    { "stages",  "set the '|'-separated list of filter chains", OFFSET(stages_str), AV_OPT_TYPE_STRING, {.str=NULL}, 0, 0, FLAGS }, \
+    { "queue",   "set the maximum number of frames queued per stage", OFFSET(queue_size), AV_OPT_TYPE_INT, {.i64=4}, 1, 1024, FLAGS }, \
+    { "threads", "set the number of slice threads of each stage", OFFSET(nb_threads), AV_OPT_TYPE_INT, {.i64=1}, 0, INT_MAX, FLAGS }, \
+    { NULL }                                                                                                     \
+}
+
+static av_cold int init(AVFilterContext *ctx)
+{
+    PipelineContext *s = ctx->priv;
+    const char *p = s->stages_str;
+
+    if (!p || !*p) {
+        av_log(ctx, AV_LOG_ERROR, "No stages specified.\n");
+        return AVERROR(EINVAL);
+    }
+
+    s->ctx         = ctx;
+    s->out_eof_pts = AV_NOPTS_VALUE;
+    ff_framequeue_global_init(&s->fqg);
+    ff_framequeue_init(&s->out_queue, &s->fqg);
+
+    if (pthread_mutex_init(&s->lock, NULL))
+        return AVERROR(ENOMEM);
+    if (pthread_cond_init(&s->cond, NULL)) {
+        pthread_mutex_destroy(&s->lock);
+        return AVERROR(ENOMEM);
+    }
+    s->lock_init = 1;
+
+    while (*p) {
+        PipelineStage *stages;
+        char *desc = av_get_token(&p, "|");
+
+        if (!desc)
+            return AVERROR(ENOMEM);
+        if (*p)
+            p++;
+        if (!*desc) {
+            av_free(desc);
+            continue;
+        }
+
+        stages = av_realloc_array(s->stages, s->nb_stages + 1, sizeof(*s->stages));
+        if (!stages) {
+            av_free(desc);
+            return AVERROR(ENOMEM);
+        }
+        s->stages = stages;
+        memset(&s->stages[s->nb_stages], 0, sizeof(*s->stages));
+        s->stages[s->nb_stages].s     = s;
+        s->stages[s->nb_stages].index = s->nb_stages;
+        s->stages[s->nb_stages].desc  = desc;
+        s->nb_stages++;
+    }
+
+    /* the queues are self-referential, so set them up once the array is final */
+    for (int i = 0; i < s->nb_stages; i++)
+        ff_framequeue_init(&s->stages[i].queue, &s->fqg);
+
+    if (!s->nb_stages) {
+        av_log(ctx, AV_LOG_ERROR, "No stages specified.\n");
+        return AVERROR(EINVAL);
+    }
+
+    return 0;
+}
+
+static int query_formats(const AVFilterContext *ctx,
+                         AVFilterFormatsConfig **cfg_in,
+                         AVFilterFormatsConfig **cfg_out)
+{
+    const enum AVMediaType type = ctx->inputs[0]->type;
+    int ret;
+
+    if ((ret = ff_formats_ref(ff_all_formats(type), &cfg_in[0]->formats)) < 0 ||
+        (ret = ff_formats_ref(ff_all_formats(type), &cfg_out[0]->formats)) < 0)
+        return ret;
+
+    if (type == AVMEDIA_TYPE_AUDIO) {
+        if ((ret = ff_formats_ref(ff_all_samplerates(), &cfg_in[0]->samplerates)) < 0 ||
+            (ret = ff_formats_ref(ff_all_samplerates(), &cfg_out[0]->samplerates)) < 0 ||
+            (ret = ff_channel_layouts_ref(ff_all_channel_counts(), &cfg_in[0]->channel_layouts)) < 0 ||
+            (ret = ff_channel_layouts_ref(ff_all_channel_counts(), &cfg_out[0]->channel_layouts)) < 0)
+            return ret;
+    } else {
+        if ((ret = ff_formats_ref(ff_all_color_spaces(), &cfg_in[0]->color_spaces)) < 0 ||
+            (ret = ff_formats_ref(ff_all_color_spaces(), &cfg_out[0]->color_spaces)) < 0 ||
+            (ret = ff_formats_ref(ff_all_color_ranges(), &cfg_in[0]->color_ranges)) < 0 ||
+            (ret = ff_formats_ref(ff_all_color_ranges(), &cfg_out[0]->color_ranges)) < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+static int set_sink_formats(AVFilterContext *sink, AVFilterLink *outlink)
+{
+    const int flags = AV_OPT_SEARCH_CHILDREN;
+    const int format = outlink->format;
+    int ret;
+
+    if (outlink->type == AVMEDIA_TYPE_AUDIO) {
+        if ((ret = av_opt_set_array(sink, "sample_formats", flags, 0, 1,
+                                    AV_OPT_TYPE_SAMPLE_FMT, &format)) < 0 ||
+            (ret = av_opt_set_array(sink, "samplerates", flags, 0, 1,
+                                    AV_OPT_TYPE_INT, &outlink->sample_rate)) < 0)
+            return ret;
+        return av_opt_set_array(sink, "channel_layouts", flags, 0, 1,
+                                AV_OPT_TYPE_CHLAYOUT, &outlink->ch_layout);
+    }
+
+    if ((ret = av_opt_set_array(sink, "pixel_formats", flags, 0, 1,
+                                AV_OPT_TYPE_PIXEL_FMT, &format)) < 0 ||
+        (ret = av_opt_set_array(sink, "colorspaces", flags, 0, 1,
+                                AV_OPT_TYPE_INT, &outlink->colorspace)) < 0)
+        return ret;
+    return av_opt_set_array(sink, "colorranges", flags, 0, 1,
+                            AV_OPT_TYPE_INT, &outlink->color_range);
+}
+
+static int config_stage(AVFilterContext *ctx, PipelineStage *st,
+                        AVBufferSrcParameters *par, AVFilterLink *outlink)
+{
+    PipelineContext *s = ctx->priv;
+    const int audio = outlink->type == AVMEDIA_TYPE_AUDIO;
+    const int last = st->index == s->nb_stages - 1;
+    AVFilterInOut *outputs = NULL, *inputs = NULL;
+    int ret;
+
+    st->graph = avfilter_graph_alloc();
+    if (!st->graph)
+        return AVERROR(ENOMEM);
+    st->graph->nb_threads = s->nb_threads;
+
+    /* converters inserted inside the stages behave like those of the parent graph */
+    if (ctx->graph->scale_sws_opts &&
+        !(st->graph->scale_sws_opts = av_strdup(ctx->graph->scale_sws_opts)))
+        return AVERROR(ENOMEM);
+    if (ctx->graph->aresample_swr_opts &&
+        !(st->graph->aresample_swr_opts = av_strdup(ctx->graph->aresample_swr_opts)))
+        return AVERROR(ENOMEM);
+
+    st->src  = avfilter_graph_alloc_filter(st->graph,
+                                           avfilter_get_by_name(audio ? "abuffer" : "buffer"), "in");
+    st->sink = avfilter_graph_alloc_filter(st->graph,
+                                           avfilter_get_by_name(audio ? "abuffersink" : "buffersink"), "out");
+    if (!st->src || !st->sink)
+        return AVERROR(ENOMEM);
+
+    if ((ret = av_buffersrc_parameters_set(st->src, par)) < 0 ||
+        (ret = avfilter_init_dict(st->src, NULL)) < 0)
+        return ret;
+
+    if (last && (ret = set_sink_formats(st->sink, outlink)) < 0)
+        return ret;
+    if ((ret = avfilter_init_dict(st->sink, NULL)) < 0)
+        return ret;
+
+    outputs = avfilter_inout_alloc();
+    inputs  = avfilter_inout_alloc();
+    if (!outputs || !inputs) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+
+    outputs->name       = av_strdup("in");
+    outputs->filter_ctx = st->src;
+    inputs->name        = av_strdup("out");
+    inputs->filter_ctx  = st->sink;
+    if (!outputs->name || !inputs->name) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+
+    if ((ret = avfilter_graph_parse_ptr(st->graph, st->desc, &inputs, &outputs, ctx)) < 0)
+        goto fail;
+
+    if ((ret = avfilter_graph_config(st->graph, ctx)) < 0)
+        goto fail;
+
+fail:
+    avfilter_inout_free(&inputs);
+    avfilter_inout_free(&outputs);
+    return ret;
+}
+
+static int config_output(AVFilterLink *outlink)
+{
+    AVFilterContext *ctx = outlink->src;
+    PipelineContext *s = ctx->priv;
+    AVFilterLink *inlink = ctx->inputs[0];
+    FilterLink *il = ff_filter_link(inlink);
+    FilterLink *ol = ff_filter_link(outlink);
+    AVBufferSrcParameters *par;
+    AVFilterContext *sink;
+    int ret = 0;
+
+    if (s->stages[0].thread_started) {
+        av_log(ctx, AV_LOG_ERROR, "Reconfiguring a running pipeline is not supported.\n");
+        return AVERROR(ENOSYS);
+    }
+
+    par = av_buffersrc_parameters_alloc();
+    if (!par)
+        return AVERROR(ENOMEM);
+
+    par->format              = inlink->format;
+    par->time_base           = inlink->time_base;
+    par->width               = inlink->w;
+    par->height              = inlink->h;
+    par->sample_aspect_ratio = inlink->sample_aspect_ratio;
+    par->frame_rate          = il->frame_rate;
+    par->hw_frames_ctx       = il->hw_frames_ctx;
+    par->sample_rate         = inlink->sample_rate;
+    par->color_space         = inlink->colorspace;
+    par->color_range         = inlink->color_range;
+    if ((ret = av_channel_layout_copy(&par->ch_layout, &inlink->ch_layout)) < 0)
+        goto fail;
+
+    for (int i = 0; i < s->nb_stages; i++) {
+        PipelineStage *st = &s->stages[i];
+
+        avfilter_graph_free(&st->graph);
+        ret = config_stage(ctx, st, par, outlink);
+        if (ret < 0) {
+            av_log(ctx, AV_LOG_ERROR, "Failed to configure stage %d.\n", i);
+            goto fail;
+        }
+
+        sink = st->sink;
+        av_channel_layout_uninit(&par->ch_layout);
+        par->format              = av_buffersink_get_format(sink);
+        par->time_base           = av_buffersink_get_time_base(sink);
+        par->width               = av_buffersink_get_w(sink);
+        par->height              = av_buffersink_get_h(sink);
+        par->sample_aspect_ratio = av_buffersink_get_sample_aspect_ratio(sink);
+        par->frame_rate          = av_buffersink_get_frame_rate(sink);
+        par->hw_frames_ctx       = av_buffersink_get_hw_frames_ctx(sink);
+        par->sample_rate         = av_buffersink_get_sample_rate(sink);
+        par->color_space         = av_buffersink_get_colorspace(sink);
+        par->color_range         = av_buffersink_get_color_range(sink);
+        if ((ret = av_buffersink_get_ch_layout(sink, &par->ch_layout)) < 0)
+            goto fail;
+    }
+
+    outlink->time_base = par->time_base;
+    if (outlink->type == AVMEDIA_TYPE_VIDEO) {
+        outlink->w                   = par->width;
+        outlink->h                   = par->height;
+        outlink->sample_aspect_ratio = par->sample_aspect_ratio;
+        ol->frame_rate               = par->frame_rate;
+        if (par->hw_frames_ctx) {
+            av_buffer_unref(&ol->hw_frames_ctx);
+            ol->hw_frames_ctx = av_buffer_ref(par->hw_frames_ctx);
+            if (!ol->hw_frames_ctx) {
+                ret = AVERROR(ENOMEM);
+                goto fail;
+            }
+        }
+    }
+
+    ret = 0;
+
+fail:
+    av_channel_layout_uninit(&par->ch_layout);
+    av_free(par);
+    return ret;
+}
+
+static int queue_frame(PipelineContext *s, FFFrameQueue *queue, AVFrame *frame)
+{
+    int ret;
+
+    pthread_mutex_lock(&s->lock);
+    while (!s->quit && ff_framequeue_queued_frames(queue) >= s->queue_size)
+        pthread_cond_wait(&s->cond, &s->lock);
+    if (s->quit) {
+        pthread_mutex_unlock(&s->lock);
+        av_frame_free(&frame);
+        return AVERROR_EXIT;
+    }
+    ret = ff_framequeue_add(queue, frame);
+    pthread_cond_broadcast(&s->cond);
+    pthread_mutex_unlock(&s->lock);
+    if (ret < 0)
+        av_frame_free(&frame);
+    return ret;
+}
+
+static void *stage_worker(void *arg)
+{
+    PipelineStage *st = arg;
+    PipelineContext *s = st->s;
+    PipelineStage *next = st->index + 1 < s->nb_stages ? &s->stages[st->index + 1] : NULL;
+    FFFrameQueue *out = next ? &next->queue : &s->out_queue;
+    int64_t eof_pts = AV_NOPTS_VALUE;
+    int ret = 0, eof = 0;
+
+    while (!eof) {
+        AVFrame *frame = NULL;
+
+        pthread_mutex_lock(&s->lock);
+        while (!s->quit && !st->eof && !ff_framequeue_queued_frames(&st->queue))
+            pthread_cond_wait(&s->cond, &s->lock);
+        if (s->quit) {
+            pthread_mutex_unlock(&s->lock);
+            break;
+        }
+        if (ff_framequeue_queued_frames(&st->queue)) {
+            frame = ff_framequeue_take(&st->queue);
+            pthread_cond_broadcast(&s->cond);
+            /* the filter can accept input again */
+            if (!st->index)
+                ff_filter_set_ready_async(s->ctx, 100);
+        }
+        pthread_mutex_unlock(&s->lock);
+
+        if (frame) {
+            ret = av_buffersrc_add_frame_flags(st->src, frame, 0);
+            av_frame_free(&frame);
+        } else {
+            ret = av_buffersrc_close(st->src, st->eof_pts, 0);
+        }
+        if (ret < 0)
+            break;
+
+        while (1) {
+            frame = av_frame_alloc();
+            if (!frame) {
+                ret = AVERROR(ENOMEM);
+                break;
+            }
+
+            ret = av_buffersink_get_frame(st->sink, frame);
+            if (ret == AVERROR(EAGAIN)) {
+                ret = 0;
+                av_frame_free(&frame);
+                break;
+            } else if (ret == AVERROR_EOF) {
+                ret = 0;
+                eof = 1;
+                av_frame_free(&frame);
+                /* the status pts of the sink input, in the time base of
+                 * the following stage or of the output */
+                eof_pts = ff_filter_link(st->sink->inputs[0])->current_pts;
+                break;
+            } else if (ret < 0) {
+                av_frame_free(&frame);
+                break;
+            }
+
+            ret = queue_frame(s, out, frame);
+            if (ret < 0)
+                break;
+            if (!next)
+                ff_filter_set_ready_async(s->ctx, 100);
+        }
+        if (ret < 0)
+            break;
+    }
+
+    pthread_mutex_lock(&s->lock);
+    if (ret < 0 && ret != AVERROR_EXIT && !s->error)
+        s->error = ret;
+    if (next) {
+        next->eof     = 1;
+        next->eof_pts = eof_pts;
+    } else {
+        s->out_eof     = 1;
+        s->out_eof_pts = eof_pts;
+    }
+    pthread_cond_broadcast(&s->cond);
+    /* the output reached EOF or an error must be reported */
+    if ((!next || s->error) && !s->quit)
+        ff_filter_set_ready_async(s->ctx, 100);
+    pthread_mutex_unlock(&s->lock);
+
+    return NULL;
+}
+
+static int start_workers(AVFilterContext *ctx)
+{
+    PipelineContext *s = ctx->priv;
+
+    for (int i = 0; i < s->nb_stages; i++) {
+        PipelineStage *st = &s->stages[i];
+        int ret = pthread_create(&st->thread, NULL, stage_worker, st);
+
+        if (ret) {
+            av_log(ctx, AV_LOG_ERROR, "Failed to start the thread of stage %d.\n", i);
+            return AVERROR(ret);
+        }
+        st->thread_started = 1;
+    }
+
+    return 0;
+}
+
+static int activate(AVFilterContext *ctx)
+{
+    PipelineContext *s = ctx->priv;
+    AVFilterLink *inlink = ctx->inputs[0];
+    AVFilterLink *outlink = ctx->outputs[0];
+    PipelineStage *first = &s->stages[0];
+    AVFrame *frame;
+    int64_t pts;
+    int ret, status;
+
+    ff_filter_set_async_wait(ctx, 0);
+
+    FF_FILTER_FORWARD_STATUS_BACK(outlink, inlink);
+
+    if (!first->thread_started) {
+        ret = start_workers(ctx);
+        if (ret < 0)
+            return ret;
+    }
+
+    pthread_mutex_lock(&s->lock);
+    if (ff_framequeue_queued_frames(&s->out_queue)) {
+        frame = ff_framequeue_take(&s->out_queue);
+        pthread_cond_broadcast(&s->cond);
+        pthread_mutex_unlock(&s->lock);
+        ff_filter_set_ready(ctx, 100);
+        return ff_filter_frame(outlink, frame);
+    }
+    if (s->error) {
+        ret = s->error;
+        pthread_mutex_unlock(&s->lock);
+        return ret;
+    }
+    if (s->out_eof) {
+        pthread_mutex_unlock(&s->lock);
+        ff_outlink_set_status(outlink, AVERROR_EOF, s->out_eof_pts);
+        return 0;
+    }
+    /* Nothing can be done before the workers make progress when the first
+     * queue is full or the input already reached EOF. They wake the filter
+     * up through ff_filter_set_ready_async(). */
+    if (s->in_eof || ff_framequeue_queued_frames(&first->queue) >= s->queue_size) {
+        pthread_mutex_unlock(&s->lock);
+        ff_filter_set_async_wait(ctx, 1);
+        return FFERROR_NOT_READY;
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    ret = ff_inlink_consume_frame(inlink, &frame);
+    if (ret < 0)
+        return ret;
+    if (ret > 0) {
+        pthread_mutex_lock(&s->lock);
+        ret = ff_framequeue_add(&first->queue, frame);
+        pthread_cond_broadcast(&s->cond);
+        pthread_mutex_unlock(&s->lock);
+        if (ret < 0) {
+            av_frame_free(&frame);
+            return ret;
+        }
+        ff_filter_set_ready(ctx, 100);
+        return 0;
+    }
+
+    if (ff_inlink_acknowledge_status(inlink, &status, &pts)) {
+        pthread_mutex_lock(&s->lock);
+        s->in_eof        = 1;
+        first->eof       = 1;
+        first->eof_pts   = pts;
+        pthread_cond_broadcast(&s->cond);
+        pthread_mutex_unlock(&s->lock);
+        ff_filter_set_ready(ctx, 100);
+        return 0;
+    }
+
+    FF_FILTER_FORWARD_WANTED(outlink, inlink);
+
+    return FFERROR_NOT_READY;
+}
+
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    PipelineContext *s = ctx->priv;
+
+    if (s->lock_init) {
+        pthread_mutex_lock(&s->lock);
+        s->quit = 1;
+        pthread_cond_broadcast(&s->cond);
+        pthread_mutex_unlock(&s->lock);
+    }
+
+    for (int i = 0; i < s->nb_stages; i++) {
+        PipelineStage *st = &s->stages[i];
+
+        if (st->thread_started)
+            pthread_join(st->thread, NULL);
+    }
+
+    for (int i = 0; i < s->nb_stages; i++) {
+        PipelineStage *st = &s->stages[i];
+
+        avfilter_graph_free(&st->graph);
+        av_freep(&st->desc);
+        ff_framequeue_free(&st->queue);
+    }
+    av_freep(&s->stages);
+    s->nb_stages = 0;
+
+    ff_framequeue_free(&s->out_queue);
+
+    if (s->lock_init) {
+        pthread_cond_destroy(&s->cond);
+        pthread_mutex_destroy(&s->lock);
+        s->lock_init = 0;
+    }
+}
+
+#if CONFIG_PIPELINE_FILTER
+
+DEFINE_OPTIONS(pipeline, AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_FILTERING_PARAM);
+AVFILTER_DEFINE_CLASS(pipeline);
+
+static const AVFilterPad pipeline_outputs[] = {
+    {
+        .name         = "default",
+        .type         = AVMEDIA_TYPE_VIDEO,
+        .config_props = config_output,
+    },
+};
+
+const AVFilter ff_vf_pipeline = {
+    .name          = "pipeline",
+    .description   = NULL_IF_CONFIG_SMALL("Run filter chains as pipelined stages on worker threads."),
+    .priv_class    = &pipeline_class,
+    .priv_size     = sizeof(PipelineContext),
+    .init          = init,
+    .uninit        = uninit,
+    .activate      = activate,
+    FILTER_INPUTS(ff_video_default_filterpad),
+    FILTER_OUTPUTS(pipeline_outputs),
+    FILTER_QUERY_FUNC2(query_formats),
+};
+#endif /* CONFIG_PIPELINE_FILTER */
+
+#if CONFIG_APIPELINE_FILTER
+
+DEFINE_OPTIONS(apipeline, AV_OPT_FLAG_AUDIO_PARAM|AV_OPT_FLAG_FILTERING_PARAM);
+AVFILTER_DEFINE_CLASS(apipeline);
+
+static const AVFilterPad apipeline_outputs[] = {
+    {
+        .name         = "default",
+        .type         = AVMEDIA_TYPE_AUDIO,
+        .config_props = config_output,
+    },
+};
+
+const AVFilter ff_af_apipeline = {
+    .name          = "apipeline",
+    .description   = NULL_IF_CONFIG_SMALL("Run audio filter chains as pipelined stages on worker threads."),
+    .priv_class    = &apipeline_class,
+    .priv_size     = sizeof(PipelineContext),
+    .init          = init,
+    .uninit        = uninit,
+    .activate      = activate,
+    FILTER_INPUTS(ff_audio_default_filterpad),
+    FILTER_OUTPUTS(apipeline_outputs),
+    FILTER_QUERY_FUNC2(query_formats),
+};
+#endif /* CONFIG_APIPELINE_FILTER */
@@ -149,6 +149,11 @@ typedef struct FilterLink {
      *
      * May be set by the link destination filter in its config_props().
      * If 0, all related fields are ignored.
+     *
+     * Filters which consume fixed-size blocks should set both min_samples
+     * and max_samples to the block size, even when using
+     * ff_inlink_consume_samples(): the size is then forwarded upstream and
+     * sources can produce frames that are passed on without re-chunking.
      */
     int min_samples;
 
@@ -170,6 +175,17 @@ typedef struct FilterLink {
      */
     int64_t sample_count_in, sample_count_out;
 
+    /**
+     * Largest number of frames that were queued on the link at once.
+     */
+    int64_t max_queued_frames;
+
+    /**
+     * Number of frames that were copied because they were shared when the
+     * destination filter had to write to them.
+     */
+    int64_t frame_copies;
+
     /**
      * Frame rate of the stream on the link, or 1/0 if unknown or variable.
      *
@@ -205,6 +221,13 @@ static inline FilterLink* ff_filter_link(AVFilterLink *link)
  */
 #define FF_FILTER_FLAG_HWFRAME_AWARE (1 << 0)
 
+/**
+ * The filter has a single audio input and output with the same sample rate,
+ * and its output does not depend on how the input is split into frames. A
+ * fixed frame size requested on its output is forwarded to its input.
+ */
+#define FF_FILTER_FLAG_FRAME_SIZE_PASSTHROUGH (1 << 1)
+
 /**
  * Find the index of a link.
  *
@@ -289,6 +312,26 @@ enum FilterFormatsState {
  */
 void ff_filter_set_ready(AVFilterContext *filter, unsigned priority);
 
+/**
+ * Mark a filter ready from a thread other than the one running the graph.
+ *
+ * The filter is scheduled for activation the next time the graph looks for
+ * a filter to activate. Unlike ff_filter_set_ready(), this may be called
+ * from any thread.
+ */
+void ff_filter_set_ready_async(AVFilterContext *filter, unsigned priority);
+
+/**
+ * Set whether the filter waits for one of its threads to call
+ * ff_filter_set_ready_async().
+ *
+ * While a filter waits and no filter of the graph is ready, running the graph
+ * blocks until that call instead of returning AVERROR(EAGAIN). Filters use
+ * this when they cannot make progress before their threads do, and must
+ * clear it once they are activated again.
+ */
+void ff_filter_set_async_wait(AVFilterContext *filter, int wait);
+
 /**
  * Get the number of frames available on the link.
  * @return the number of frames available in the link fifo.
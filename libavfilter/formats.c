@@ -52,7 +52,9 @@ do {                                                                       \
 } while (0)
 
 /**
- * Add all formats common to a and b to a, add b's refs to a and destroy b.
+ * Keep only the formats common to a and b, in the order of a, in the list
+ * with the most references, move the refs of the other list to it and
+ * destroy the other list.
  * If check is set, nothing is modified and it is only checked whether
  * the formats are compatible.
  * If empty_allowed is set and one of a,b->nb is zero, the lists are
@@ -88,6 +90,14 @@ do {                                                                       \
         a->nb = k;                                                         \
     }                                                                      \
                                                                            \
+    /* merging into a widely shared list must not move all its refs */   \
+    if (a->refcount < b->refcount) {                                       \
+        FFSWAP(type, *a, *b);                                              \
+        FFSWAP(unsigned, a->refcount, b->refcount);                        \
+        FFSWAP(type ***, a->refs, b->refs);                                \
+        FFSWAP(type *, a, b);                                              \
+    }                                                                      \
+                                                                           \
     MERGE_REF(a, b, fmts, type, return AVERROR(ENOMEM););                  \
 } while (0)
 
@@ -1166,6 +1176,7 @@ int ff_default_query_formats(AVFilterContext *ctx)
 
 static int check_list(void *log, const char *name, const AVFilterFormats *fmts)
 {
+    uint64_t seen[16] = { 0 };
     unsigned i, j;
 
     if (!fmts)
@@ -1174,15 +1185,28 @@ static int check_list(void *log, const char *name, const AVFilterFormats *fmts)
         av_log(log, AV_LOG_ERROR, "Empty %s list\n", name);
         return AVERROR(EINVAL);
     }
+    /* format ids are small, look for duplicates with a bitmap */
+    for (i = 0; i < fmts->nb_formats; i++) {
+        unsigned fmt = fmts->formats[i];
+        if (fmt >= FF_ARRAY_ELEMS(seen) * 64)
+            break;
+        if (seen[fmt >> 6] & (1ULL << (fmt & 63)))
+            goto dup;
+        seen[fmt >> 6] |= 1ULL << (fmt & 63);
+    }
+    if (i == fmts->nb_formats)
+        return 0;
+
     for (i = 0; i < fmts->nb_formats; i++) {
         for (j = i + 1; j < fmts->nb_formats; j++) {
-            if (fmts->formats[i] == fmts->formats[j]) {
-                av_log(log, AV_LOG_ERROR, "Duplicated %s\n", name);
-                return AVERROR(EINVAL);
-            }
+            if (fmts->formats[i] == fmts->formats[j])
+                goto dup;
         }
     }
     return 0;
+dup:
+    av_log(log, AV_LOG_ERROR, "Duplicated %s\n", name);
+    return AVERROR(EINVAL);
 }
 
 int ff_formats_check_pixel_formats(void *log, const AVFilterFormats *fmts)
@@ -18,6 +18,14 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include "config.h"
+
+#define _DEFAULT_SOURCE // needed for madvise()/MADV_HUGEPAGE
+#include <stdlib.h>
+#if HAVE_MADVISE
+#include <sys/mman.h>
+#endif
+
 #include "framepool.h"
 #include "libavutil/avassert.h"
 #include "libavutil/avutil.h"
@@ -49,6 +57,63 @@ struct FFFramePool {
 
 };
 
+#define HUGEPAGE_SIZE (2 << 20)
+
+#if HAVE_POSIX_MEMALIGN && HAVE_MADVISE && defined(MADV_HUGEPAGE)
+static void hugepage_free(void *opaque, uint8_t *data)
+{
+    free(data);
+}
+
+static AVBufferRef *hugepage_alloc(size_t size, int zero)
+{
+    AVBufferRef *buf;
+    void *data;
+
+    if (size < HUGEPAGE_SIZE)
+        return zero ? av_buffer_allocz(size) : av_buffer_alloc(size);
+
+    /* round up so that the tail of the buffer is backed by a full page too */
+    size = FFALIGN(size, HUGEPAGE_SIZE);
+    if (posix_memalign(&data, HUGEPAGE_SIZE, size))
+        return NULL;
+
+    /* advisory only; the kernel may decline, which is harmless */
+    madvise(data, size, MADV_HUGEPAGE);
+
+    if (zero)
+        memset(data, 0, size);
+
+    buf = av_buffer_create(data, size, hugepage_free, NULL, 0);
+    if (!buf)
+        free(data);
+    return buf;
+}
+
+static AVBufferRef *hugepage_buffer_alloc(size_t size)
+{
+    return hugepage_alloc(size, 0);
+}
+
+static AVBufferRef *hugepage_buffer_allocz(size_t size)
+{
+    return hugepage_alloc(size, 1);
+}
+#else
+#define hugepage_buffer_alloc  av_buffer_alloc
+#define hugepage_buffer_allocz av_buffer_allocz
+#endif
+
+AVBufferRef *(*ff_frame_pool_get_allocator(int flags))(size_t size)
+{
+    if (flags & FF_FRAME_POOL_FLAG_HUGEPAGES)
+        return flags & FF_FRAME_POOL_FLAG_NO_ZERO ? hugepage_buffer_alloc
+                                                  : hugepage_buffer_allocz;
+    if (flags & FF_FRAME_POOL_FLAG_NO_ZERO)
+        return av_buffer_alloc;
+    return CONFIG_MEMORY_POISONING ? NULL : av_buffer_allocz;
+}
+
 FFFramePool *ff_frame_pool_video_init(AVBufferRef* (*alloc)(size_t size),
                                       int width,
                                       int height,
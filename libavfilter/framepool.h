@@ -32,6 +32,30 @@
  */
 typedef struct FFFramePool FFFramePool;
 
+enum FFFramePoolFlags {
+    /**
+     * Back large buffers with 2 MiB aligned memory and ask the kernel to
+     * map them with transparent huge pages, reducing TLB pressure for
+     * high resolution frames.
+     */
+    FF_FRAME_POOL_FLAG_HUGEPAGES = 1 << 0,
+    /**
+     * Do not clear newly allocated buffers. The pages are then only
+     * faulted in by the first thread that writes to them, which on NUMA
+     * systems places them on the node of the producing filter thread.
+     */
+    FF_FRAME_POOL_FLAG_NO_ZERO   = 1 << 1,
+};
+
+/**
+ * Select the buffer allocator matching a combination of FFFramePoolFlags,
+ * suitable as the alloc parameter of ff_frame_pool_video_init() and
+ * ff_frame_pool_audio_init().
+ *
+ * @return an allocator, or NULL for the pool's default one
+ */
+AVBufferRef *(*ff_frame_pool_get_allocator(int flags))(size_t size);
+
 /**
  * Allocate and initialize a video frame pool.
  *
@@ -289,6 +289,141 @@ void avfilter_graph_segment_free(AVFilterGraphSegment **pseg)
     av_freep(pseg);
 }
 
+static int pad_params_dup(AVFilterPadParams *const *src, unsigned nb,
+                          AVFilterPadParams ***dst, unsigned *nb_dst)
+{
+    if (!nb)
+        return 0;
+
+    *dst = av_calloc(nb, sizeof(**dst));
+    if (!*dst)
+        return AVERROR(ENOMEM);
+    *nb_dst = nb;
+
+    for (unsigned i = 0; i < nb; i++) {
+        AVFilterPadParams *fpp = av_mallocz(sizeof(*fpp));
+        if (!fpp)
+            return AVERROR(ENOMEM);
+        (*dst)[i] = fpp;
+
+        if (src[i]->label) {
+            fpp->label = av_strdup(src[i]->label);
+            if (!fpp->label)
+                return AVERROR(ENOMEM);
+        }
+    }
+
+    return 0;
+}
+
+static int filter_params_dup(const AVFilterParams *src, AVFilterParams **pp)
+{
+    AVFilterParams *p;
+    int ret;
+
+    p = av_mallocz(sizeof(*p));
+    if (!p)
+        return AVERROR(ENOMEM);
+
+    if ((src->filter_name   && !(p->filter_name   = av_strdup(src->filter_name))) ||
+        (src->instance_name && !(p->instance_name = av_strdup(src->instance_name)))) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+
+    ret = av_dict_copy(&p->opts, src->opts, 0);
+    if (ret < 0)
+        goto fail;
+
+    ret = pad_params_dup(src->inputs, src->nb_inputs, &p->inputs, &p->nb_inputs);
+    if (ret < 0)
+        goto fail;
+
+    ret = pad_params_dup(src->outputs, src->nb_outputs, &p->outputs, &p->nb_outputs);
+    if (ret < 0)
+        goto fail;
+
+    *pp = p;
+    return 0;
+fail:
+    filter_params_free(&p);
+    return ret;
+}
+
+int avfilter_graph_segment_dup(const AVFilterGraphSegment *src,
+                               AVFilterGraph *graph, int flags,
+                               AVFilterGraphSegment **pdst)
+{
+    AVFilterGraphSegment *seg;
+    int ret;
+
+    *pdst = NULL;
+
+    if (flags)
+        return AVERROR(ENOSYS);
+
+    for (size_t i = 0; i < src->nb_chains; i++)
+        for (size_t j = 0; j < src->chains[i]->nb_filters; j++)
+            if (src->chains[i]->filters[j]->filter) {
+                av_log(graph, AV_LOG_ERROR, "Cannot copy a graph segment "
+                       "containing filter instances\n");
+                return AVERROR(EINVAL);
+            }
+
+    seg = av_mallocz(sizeof(*seg));
+    if (!seg)
+        return AVERROR(ENOMEM);
+
+    seg->graph = graph;
+
+    if (src->scale_sws_opts) {
+        seg->scale_sws_opts = av_strdup(src->scale_sws_opts);
+        if (!seg->scale_sws_opts) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+    }
+
+    seg->chains = av_calloc(src->nb_chains, sizeof(*seg->chains));
+    if (!seg->chains) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    seg->nb_chains = src->nb_chains;
+
+    for (size_t i = 0; i < src->nb_chains; i++) {
+        const AVFilterChain *ch_src = src->chains[i];
+        AVFilterChain *ch;
+
+        ch = av_mallocz(sizeof(*ch));
+        if (!ch) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+        seg->chains[i] = ch;
+
+        ch->filters = av_calloc(ch_src->nb_filters, sizeof(*ch->filters));
+        if (!ch->filters) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+        ch->nb_filters = ch_src->nb_filters;
+
+        for (size_t j = 0; j < ch_src->nb_filters; j++) {
+            ret = filter_params_dup(ch_src->filters[j], &ch->filters[j]);
+            if (ret < 0)
+                goto fail;
+        }
+    }
+
+    *pdst = seg;
+
+    return 0;
+fail:
+    avfilter_graph_segment_free(&seg);
+    return ret;
+}
+
 static int linklabels_parse(void *logctx, const char **linklabels,
                             AVFilterPadParams ***res, unsigned *nb_res)
 {
@@ -21,21 +21,18 @@
 #undef FABS
 #undef FEXP
 #undef SAMPLE_FORMAT
-#undef TX_TYPE
 #if DEPTH == 32
 #define ctype AVComplexFloat
 #define ftype float
 #define FABS fabsf
 #define FEXP expf
 #define SAMPLE_FORMAT flt
-#define TX_TYPE AV_TX_FLOAT_RDFT
 #else
 #define ctype AVComplexDouble
 #define ftype double
 #define FABS fabs
 #define FEXP exp
 #define SAMPLE_FORMAT dbl
-#define TX_TYPE AV_TX_DOUBLE_RDFT
 #endif
 
 #define F(x) ((ftype)(x))
@@ -137,7 +134,6 @@ static int fn(headphone_fast_convolute)(AVFilterContext *ctx, void *arg, int job
     const int planar = av_sample_fmt_is_planar(in->format);
     const int offset = planar ? 0 : jobnr;
     int *write = &s->write[jobnr];
-    ctype *hrtf = s->data_hrtf[jobnr];
     int *n_clippings = &td->n_clippings[jobnr];
     const int nb_samples = in->nb_samples;
     ftype *ringbuffer = s->ringbuffer[jobnr];
@@ -146,17 +142,9 @@ static int fn(headphone_fast_convolute)(AVFilterContext *ctx, void *arg, int job
     const int in_channels = in->ch_layout.nb_channels;
     const int buffer_length = s->buffer_length;
     const uint32_t modulo = (uint32_t)buffer_length - 1;
-    ctype *tx_out = s->out_tx[jobnr];
-    ftype *tx_in = s->in_tx[jobnr];
-    ctype *fft_acc = s->temp_afft[jobnr];
-    AVTXContext *itx_ctx = s->itx_ctx[jobnr];
-    AVTXContext *tx_ctx = s->tx_ctx[jobnr];
-    av_tx_fn tx_fn = s->tx_fn[jobnr];
-    av_tx_fn itx_fn = s->itx_fn[jobnr];
+    const ftype *conv_out = s->conv.out[jobnr];
     const int mult = planar ? 1 : 2;
-    const int n_tx = s->n_tx;
     const ftype gain_lfe = s->gain_lfe;
-    ctype *hrtf_offset;
     int wr = *write;
     int n_read;
 
@@ -174,48 +162,22 @@ static int fn(headphone_fast_convolute)(AVFilterContext *ctx, void *arg, int job
             dst[2 * j] = F(0.0);
     }
 
-    memset(fft_acc, 0, sizeof(ctype) * (n_tx/2+1));
-
-    for (int i = 0; i < in_channels; i++) {
+    if (s->lfe_channel >= 0) {
+        const int i = s->lfe_channel;
         const ftype *src = planar ? (const ftype *)in->extended_data[i] : ((const ftype *)in->data[0]) + i;
 
-        if (i == s->lfe_channel) {
-            if (planar) {
-                for (int j = 0; j < nb_samples; j++)
-                    dst[j] += src[j] * gain_lfe;
-            } else {
-                for (int j = 0; j < nb_samples; j++)
-                    dst[2 * j] += src[j * in_channels] * gain_lfe;
-            }
-            continue;
-        }
-
-        hrtf_offset = hrtf + s->hrir_map[i] * s->atx_len;
-
         if (planar) {
-            memcpy(tx_in, src, nb_samples * sizeof(*tx_in));
+            for (int j = 0; j < nb_samples; j++)
+                dst[j] += src[j] * gain_lfe;
         } else {
             for (int j = 0; j < nb_samples; j++)
-                tx_in[j] = src[j * in_channels];
-        }
-        memset(tx_in + nb_samples, 0, sizeof(ftype) * (n_tx - nb_samples));
-
-        tx_fn(tx_ctx, tx_out, tx_in, sizeof(*tx_in));
-
-        for (int j = 0; j < (n_tx/2+1); j++) {
-            const ctype *hcomplex = hrtf_offset + j;
-            const ftype re = tx_out[j].re;
-            const ftype im = tx_out[j].im;
-
-            fft_acc[j].re += re * hcomplex->re - im * hcomplex->im;
-            fft_acc[j].im += re * hcomplex->im + im * hcomplex->re;
+                dst[2 * j] += src[j * in_channels] * gain_lfe;
         }
     }
 
-    itx_fn(itx_ctx, tx_in, fft_acc, sizeof(*fft_acc));
-
+    /* the convolution of all other channels was done by the HRTF engine */
     for (int j = 0; j < nb_samples; j++) {
-        dst[mult * j] += tx_in[j];
+        dst[mult * j] += conv_out[j];
         if (FABS(dst[mult * j]) > 1)
             n_clippings[0]++;
     }
@@ -223,7 +185,7 @@ static int fn(headphone_fast_convolute)(AVFilterContext *ctx, void *arg, int job
     for (int j = 0; j < ir_len - 1; j++) {
         int write_pos = (wr + j) & modulo;
 
-        *(ringbuffer + write_pos) += tx_in[nb_samples + j];
+        *(ringbuffer + write_pos) += conv_out[nb_samples + j];
     }
 
     *write = wr;
@@ -239,6 +201,7 @@ static int fn(convert_coeffs)(AVFilterContext *ctx, AVFilterLink *inlink)
     int nb_input_channels = ctx->inputs[0]->ch_layout.nb_channels;
     const int nb_hrir_channels = s->nb_hrir_inputs == 1 ? ctx->inputs[1]->ch_layout.nb_channels : s->nb_hrir_inputs * 2;
     ftype gain_lin = FEXP((s->gain - 3 * nb_input_channels) / 20 * M_LN10);
+    ftype *tx_in[2] = { NULL };
     AVFrame *frame;
     int ret = 0;
     int n_tx;
@@ -251,30 +214,13 @@ static int fn(convert_coeffs)(AVFilterContext *ctx, AVFilterLink *inlink)
     s->n_tx = n_tx = 1 << (32 - ff_clz(ir_len + s->size));
 
     if (s->type == FREQUENCY_DOMAIN) {
-        const size_t cpu_align = av_cpu_max_align();
-        ftype scale = F(1.0);
-        ftype iscale = F(1.0) / s->n_tx;
-
-        s->atx_len = FFALIGN(n_tx/2+1, cpu_align);
-
-        ret = av_tx_init(&s->tx_ctx[0], &s->tx_fn[0], TX_TYPE, 0, s->n_tx, &scale, 0);
-        if (ret < 0)
-            goto fail;
-        ret = av_tx_init(&s->tx_ctx[1], &s->tx_fn[1], TX_TYPE, 0, s->n_tx, &scale, 0);
-        if (ret < 0)
-            goto fail;
-        ret = av_tx_init(&s->itx_ctx[0], &s->itx_fn[0], TX_TYPE, 1, s->n_tx, &iscale, 0);
-        if (ret < 0)
-            goto fail;
-        ret = av_tx_init(&s->itx_ctx[1], &s->itx_fn[1], TX_TYPE, 1, s->n_tx, &iscale, 0);
-        if (ret < 0)
-            goto fail;
-
-        if (!s->tx_ctx[0] || !s->tx_ctx[1] || !s->itx_ctx[0] || !s->itx_ctx[1]) {
+        ret = ff_hrtfconv_init(ctx, &s->conv, n_tx, nb_input_channels, DEPTH == 64);
+        if (ret < 0) {
             av_log(ctx, AV_LOG_ERROR, "Unable to create TX contexts of size %d.\n", s->n_tx);
-            ret = AVERROR(ENOMEM);
             goto fail;
         }
+
+        s->atx_len = s->conv.atx_len;
     }
 
     if (s->type == TIME_DOMAIN) {
@@ -283,15 +229,9 @@ static int fn(convert_coeffs)(AVFilterContext *ctx, AVFilterLink *inlink)
     } else {
         s->ringbuffer[0] = av_calloc(s->buffer_length, sizeof(ftype));
         s->ringbuffer[1] = av_calloc(s->buffer_length, sizeof(ftype));
-        s->out_tx[0] = av_calloc(s->n_tx/2+1, sizeof(ctype));
-        s->out_tx[1] = av_calloc(s->n_tx/2+1, sizeof(ctype));
-        s->in_tx[0] = av_calloc(s->n_tx, sizeof(ftype));
-        s->in_tx[1] = av_calloc(s->n_tx, sizeof(ftype));
-        s->temp_afft[0] = av_calloc(s->n_tx/2+1, sizeof(ctype));
-        s->temp_afft[1] = av_calloc(s->n_tx/2+1, sizeof(ctype));
-        if (!s->in_tx[0] || !s->in_tx[1] ||
-            !s->out_tx[0] || !s->out_tx[1] ||
-            !s->temp_afft[0] || !s->temp_afft[1]) {
+        tx_in[0] = av_calloc(s->n_tx, sizeof(ftype));
+        tx_in[1] = av_calloc(s->n_tx, sizeof(ftype));
+        if (!tx_in[0] || !tx_in[1]) {
             ret = AVERROR(ENOMEM);
             goto fail;
         }
@@ -358,16 +298,16 @@ static int fn(convert_coeffs)(AVFilterContext *ctx, AVFilterLink *inlink)
             } else {
                 ctype *tx_out_l = data_hrtf[0] + idx * s->atx_len;
                 ctype *tx_out_r = data_hrtf[1] + idx * s->atx_len;
-                ftype *tx_in_l = s->in_tx[0];
-                ftype *tx_in_r = s->in_tx[1];
+                ftype *tx_in_l = tx_in[0];
+                ftype *tx_in_r = tx_in[1];
 
                 for (int j = 0; j < len; j++) {
                     tx_in_l[j] = ptr_l[j * step] * gain_lin;
                     tx_in_r[j] = ptr_r[j * step] * gain_lin;
                 }
 
-                s->tx_fn[0](s->tx_ctx[0], tx_out_l, tx_in_l, sizeof(*tx_in_l));
-                s->tx_fn[0](s->tx_ctx[0], tx_out_r, tx_in_r, sizeof(*tx_in_r));
+                ff_hrtfconv_rdft(&s->conv, tx_out_l, tx_in_l);
+                ff_hrtfconv_rdft(&s->conv, tx_out_r, tx_in_r);
             }
         } else {
             const int N = ctx->inputs[1]->ch_layout.nb_channels;
@@ -399,16 +339,16 @@ static int fn(convert_coeffs)(AVFilterContext *ctx, AVFilterLink *inlink)
                 } else {
                     ctype *tx_out_l = data_hrtf[0] + idx * s->atx_len;
                     ctype *tx_out_r = data_hrtf[1] + idx * s->atx_len;
-                    ftype *tx_in_l = s->in_tx[0];
-                    ftype *tx_in_r = s->in_tx[1];
+                    ftype *tx_in_l = tx_in[0];
+                    ftype *tx_in_r = tx_in[1];
 
                     for (int j = 0; j < len; j++) {
                         tx_in_l[j] = ptr_l[j * M] * gain_lin;
                         tx_in_r[j] = ptr_r[j * M] * gain_lin;
                     }
 
-                    s->tx_fn[0](s->tx_ctx[0], tx_out_l, tx_in_l, sizeof(*tx_in_l));
-                    s->tx_fn[0](s->tx_ctx[0], tx_out_r, tx_in_r, sizeof(*tx_in_r));
+                    ff_hrtfconv_rdft(&s->conv, tx_out_l, tx_in_l);
+                    ff_hrtfconv_rdft(&s->conv, tx_out_r, tx_in_r);
                 }
             }
         }
@@ -417,5 +357,7 @@ static int fn(convert_coeffs)(AVFilterContext *ctx, AVFilterLink *inlink)
     s->have_hrirs = 1;
 
 fail:
+    av_freep(&tx_in[0]);
+    av_freep(&tx_in[1]);
     return ret;
 }
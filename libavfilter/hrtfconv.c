@@ -0,0 +1,143 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+
+#include "libavutil/avassert.h"
+#include "libavutil/common.h"
+#include "libavutil/cpu.h"
+#include "libavutil/mem.h"
+
+#include "filters.h"
+#include "hrtfconv.h"
+
+/* do not split the accumulation of one ear into slices smaller than this */
+#define MIN_BINS_PER_JOB 256
+
+#define DEPTH 32
+#include "hrtfconv_template.c"
+
+#undef DEPTH
+#define DEPTH 64
+#include "hrtfconv_template.c"
+
+int ff_hrtfconv_init(AVFilterContext *ctx, HRTFConvContext *s,
+                     int n_tx, int nb_inputs, int is_double)
+{
+    const enum AVTXType tx_type = is_double ? AV_TX_DOUBLE_RDFT : AV_TX_FLOAT_RDFT;
+    const size_t sample_size = is_double ? sizeof(double) : sizeof(float);
+    const size_t complex_size = 2 * sample_size;
+    const int nb_threads = ff_filter_get_nb_threads(ctx);
+    const int nb_bins = n_tx / 2 + 1;
+    const double dscale = 1.0, discale = 1.0 / n_tx;
+    const float fscale = 1.f, fiscale = 1.f / n_tx;
+    const void *scale  = is_double ? (const void *)&dscale  : (const void *)&fscale;
+    const void *iscale = is_double ? (const void *)&discale : (const void *)&fiscale;
+    int ret;
+
+    ff_hrtfconv_uninit(s);
+
+    s->is_double = is_double;
+    s->n_tx = n_tx;
+    s->atx_len = FFALIGN(nb_bins, av_cpu_max_align());
+    s->nb_inputs = FFMAX(nb_inputs, 1);
+    s->nb_tx = av_clip(nb_threads, 1, s->nb_inputs);
+    s->nb_bin_jobs = av_clip(nb_threads / HRTFCONV_NB_EARS, 1,
+                             FFMAX(nb_bins / MIN_BINS_PER_JOB, 1));
+
+    s->tx_ctx = av_calloc(s->nb_tx, sizeof(*s->tx_ctx));
+    s->tx_in  = av_calloc(s->nb_tx, sizeof(*s->tx_in));
+    if (!s->tx_ctx || !s->tx_in)
+        return AVERROR(ENOMEM);
+
+    for (int i = 0; i < s->nb_tx; i++) {
+        ret = av_tx_init(&s->tx_ctx[i], &s->tx_fn, tx_type, 0, n_tx, scale, 0);
+        if (ret < 0)
+            return ret;
+        s->tx_in[i] = av_calloc(n_tx, sample_size);
+        if (!s->tx_in[i])
+            return AVERROR(ENOMEM);
+    }
+
+    for (int i = 0; i < HRTFCONV_NB_EARS; i++) {
+        ret = av_tx_init(&s->itx_ctx[i], &s->itx_fn, tx_type, 1, n_tx, iscale, 0);
+        if (ret < 0)
+            return ret;
+        s->acc[i] = av_calloc(s->atx_len, complex_size);
+        s->out[i] = av_calloc(n_tx, sample_size);
+        if (!s->acc[i] || !s->out[i])
+            return AVERROR(ENOMEM);
+    }
+
+    s->spectra = av_calloc(s->nb_inputs * s->atx_len, complex_size);
+    if (!s->spectra)
+        return AVERROR(ENOMEM);
+
+    return 0;
+}
+
+void ff_hrtfconv_rdft(HRTFConvContext *s, void *dst, void *src)
+{
+    s->tx_fn(s->tx_ctx[0], dst, src, s->is_double ? sizeof(double) : sizeof(float));
+}
+
+int ff_hrtfconv_execute(AVFilterContext *ctx, HRTFConvContext *s,
+                        const void *const *src, int stride, int nb_src,
+                        int nb_samples, const void *const *hrtf,
+                        const int *hrtf_offset)
+{
+    av_assert1(nb_src <= s->nb_inputs && nb_samples <= s->n_tx);
+
+    s->src = src;
+    s->stride = stride;
+    s->nb_src = nb_src;
+    s->nb_samples = nb_samples;
+    s->hrtf = hrtf;
+    s->hrtf_offset = hrtf_offset;
+
+    if (nb_src > 0)
+        ff_filter_execute(ctx, s->is_double ? forward_dbl : forward_flt, s, NULL,
+                          FFMIN(nb_src, s->nb_tx));
+    ff_filter_execute(ctx, s->is_double ? accumulate_dbl : accumulate_flt, s, NULL,
+                      HRTFCONV_NB_EARS * s->nb_bin_jobs);
+    ff_filter_execute(ctx, s->is_double ? inverse_dbl : inverse_flt, s, NULL,
+                      HRTFCONV_NB_EARS);
+
+    return 0;
+}
+
+void ff_hrtfconv_uninit(HRTFConvContext *s)
+{
+    for (int i = 0; i < s->nb_tx; i++) {
+        if (s->tx_ctx)
+            av_tx_uninit(&s->tx_ctx[i]);
+        if (s->tx_in)
+            av_freep(&s->tx_in[i]);
+    }
+    av_freep(&s->tx_ctx);
+    av_freep(&s->tx_in);
+
+    for (int i = 0; i < HRTFCONV_NB_EARS; i++) {
+        av_tx_uninit(&s->itx_ctx[i]);
+        av_freep(&s->acc[i]);
+        av_freep(&s->out[i]);
+    }
+    av_freep(&s->spectra);
+
+    memset(s, 0, sizeof(*s));
+}
@@ -0,0 +1,103 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFILTER_HRTFCONV_H
+#define AVFILTER_HRTFCONV_H
+
+#include "libavutil/tx.h"
+
+#include "avfilter.h"
+
+#define HRTFCONV_NB_EARS 2
+
+/**
+ * Batched frequency-domain convolution of many sources with per-ear
+ * transfer functions, as used for binaural rendering.
+ *
+ * Every source block is transformed once and shared by both ears, the
+ * contributions of all sources are summed in the frequency domain and a
+ * single inverse transform is done per ear. Each stage is split over as
+ * many jobs as the filter has threads.
+ */
+typedef struct HRTFConvContext {
+    int is_double;
+    int n_tx;               ///< transform size
+    int atx_len;            ///< stride in complex values between spectra
+    int nb_inputs;          ///< maximum number of sources per call
+    int nb_tx;              ///< number of forward transform contexts
+    int nb_bin_jobs;        ///< jobs per ear for the accumulation
+
+    AVTXContext **tx_ctx;
+    av_tx_fn tx_fn;
+    AVTXContext *itx_ctx[HRTFCONV_NB_EARS];
+    av_tx_fn itx_fn;
+
+    void **tx_in;           ///< per forward context, n_tx samples
+    void *spectra;          ///< nb_inputs spectra of atx_len values
+    void *acc[HRTFCONV_NB_EARS];
+
+    /**
+     * Time-domain result of the last ff_hrtfconv_execute() call for each
+     * ear, n_tx samples.
+     */
+    void *out[HRTFCONV_NB_EARS];
+
+    /* parameters of the current call */
+    const void *const *src;
+    int stride;
+    int nb_src;
+    int nb_samples;
+    const void *const *hrtf;
+    const int *hrtf_offset;
+} HRTFConvContext;
+
+/**
+ * Initialize the engine.
+ *
+ * @param n_tx      transform size
+ * @param nb_inputs maximum number of sources passed to ff_hrtfconv_execute()
+ * @param is_double operate on double instead of float samples
+ */
+int ff_hrtfconv_init(AVFilterContext *ctx, HRTFConvContext *s,
+                     int n_tx, int nb_inputs, int is_double);
+
+/**
+ * Transform a zero padded impulse response of n_tx samples into the
+ * spectrum layout expected by ff_hrtfconv_execute(). Not thread-safe.
+ */
+void ff_hrtfconv_rdft(HRTFConvContext *s, void *dst, void *src);
+
+/**
+ * Convolve nb_samples samples of each source with its transfer function
+ * for both ears, leaving the result in s->out.
+ *
+ * @param src         per-source pointer to the first sample
+ * @param stride      distance in samples between consecutive samples
+ * @param nb_src      number of sources, at most nb_inputs
+ * @param hrtf        per-ear base of the transfer functions
+ * @param hrtf_offset per-source offset, in complex values, of its transfer
+ *                    function from the per-ear base
+ */
+int ff_hrtfconv_execute(AVFilterContext *ctx, HRTFConvContext *s,
+                        const void *const *src, int stride, int nb_src,
+                        int nb_samples, const void *const *hrtf,
+                        const int *hrtf_offset);
+
+void ff_hrtfconv_uninit(HRTFConvContext *s);
+
+#endif /* AVFILTER_HRTFCONV_H */
@@ -0,0 +1,102 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#undef ctype
+#undef ftype
+#undef SAMPLE_FORMAT
+#if DEPTH == 32
+#define ctype AVComplexFloat
+#define ftype float
+#define SAMPLE_FORMAT flt
+#else
+#define ctype AVComplexDouble
+#define ftype double
+#define SAMPLE_FORMAT dbl
+#endif
+
+#define fn3(a,b)   a##_##b
+#define fn2(a,b)   fn3(a,b)
+#define fn(a)      fn2(a, SAMPLE_FORMAT)
+
+static int fn(forward)(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    HRTFConvContext *s = arg;
+    const int start = (s->nb_src * jobnr) / nb_jobs;
+    const int end = (s->nb_src * (jobnr+1)) / nb_jobs;
+    AVTXContext *tx_ctx = s->tx_ctx[jobnr];
+    ftype *tx_in = s->tx_in[jobnr];
+    const int nb_samples = s->nb_samples;
+    const int stride = s->stride;
+    const int n_tx = s->n_tx;
+
+    for (int i = start; i < end; i++) {
+        const ftype *src = s->src[i];
+        ctype *dst = (ctype *)s->spectra + i * s->atx_len;
+
+        if (stride == 1) {
+            memcpy(tx_in, src, nb_samples * sizeof(*tx_in));
+        } else {
+            for (int j = 0; j < nb_samples; j++)
+                tx_in[j] = src[j * stride];
+        }
+        memset(tx_in + nb_samples, 0, (n_tx - nb_samples) * sizeof(*tx_in));
+
+        s->tx_fn(tx_ctx, dst, tx_in, sizeof(*tx_in));
+    }
+
+    return 0;
+}
+
+static int fn(accumulate)(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    HRTFConvContext *s = arg;
+    const int nb_bins = s->n_tx / 2 + 1;
+    const int ear = jobnr / s->nb_bin_jobs;
+    const int part = jobnr % s->nb_bin_jobs;
+    const int start = (nb_bins * part) / s->nb_bin_jobs;
+    const int end = (nb_bins * (part+1)) / s->nb_bin_jobs;
+    const ctype *hrtf = s->hrtf[ear];
+    ctype *acc = s->acc[ear];
+
+    memset(acc + start, 0, (end - start) * sizeof(*acc));
+
+    for (int i = 0; i < s->nb_src; i++) {
+        const ctype *spectrum = (const ctype *)s->spectra + i * s->atx_len;
+        const ctype *hcomplex = hrtf + s->hrtf_offset[i];
+
+        for (int j = start; j < end; j++) {
+            const ftype re = spectrum[j].re;
+            const ftype im = spectrum[j].im;
+
+            acc[j].re += re * hcomplex[j].re - im * hcomplex[j].im;
+            acc[j].im += re * hcomplex[j].im + im * hcomplex[j].re;
+        }
+    }
+
+    return 0;
+}
+
+static int fn(inverse)(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    HRTFConvContext *s = arg;
+    ctype *acc = s->acc[jobnr];
+
+    s->itx_fn(s->itx_ctx[jobnr], s->out[jobnr], acc, sizeof(*acc));
+
+    return 0;
+}
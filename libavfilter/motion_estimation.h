@@ -23,6 +23,8 @@
 
 #include <stdint.h>
 
+#include "libavutil/pixelutils.h"
+
 #define AV_ME_METHOD_ESA        1
 #define AV_ME_METHOD_TSS        2
 #define AV_ME_METHOD_TDLS       3
@@ -59,11 +61,19 @@ typedef struct AVMotionEstContext {
 
     uint64_t (*get_cost)(struct AVMotionEstContext *me_ctx, int x_mb, int y_mb,
                          int mv_x, int mv_y);
+
+    av_pixelutils_sad_fn sad[6];    ///< SAD of 1 << i square blocks, may be NULL
 } AVMotionEstContext;
 
 void ff_me_init_context(AVMotionEstContext *me_ctx, int mb_size, int search_param,
                         int width, int height, int x_min, int x_max, int y_min, int y_max);
 
+/**
+ * Compute the sum of absolute differences of two size x size blocks.
+ */
+uint64_t ff_me_sad(const AVMotionEstContext *me_ctx, const uint8_t *src1,
+                   const uint8_t *src2, int linesize, int size);
+
 uint64_t ff_me_cmp_sad(AVMotionEstContext *me_ctx, int x_mb, int y_mb, int x_mv, int y_mv);
 
 uint64_t ff_me_search_esa(AVMotionEstContext *me_ctx, int x_mb, int y_mb, int *mv);
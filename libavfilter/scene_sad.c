@@ -71,3 +71,17 @@ ff_scene_sad_fn ff_scene_sad_get_fn(int depth)
     return sad;
 }
 
+void ff_scene_hist_diff_c(const uint32_t *hist1, const uint32_t *hist2,
+                          ptrdiff_t nb_bins, uint64_t *sum)
+{
+    uint64_t diff = 0;
+
+    for (ptrdiff_t i = 0; i < nb_bins; i++)
+        diff += FFABS((int64_t)hist1[i] - hist2[i]);
+    *sum = diff;
+}
+
+ff_scene_hist_diff_fn ff_scene_hist_diff_get_fn(void)
+{
+    return ff_scene_hist_diff_c;
+}
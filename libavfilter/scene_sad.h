@@ -41,4 +41,16 @@ ff_scene_sad_fn ff_scene_sad_get_fn_x86(int depth);
 
 ff_scene_sad_fn ff_scene_sad_get_fn(int depth);
 
+/**
+ * Sum of the absolute differences of two histograms of nb_bins bins,
+ * nb_bins being a multiple of 32.
+ */
+typedef void (*ff_scene_hist_diff_fn)(const uint32_t *hist1, const uint32_t *hist2,
+                                      ptrdiff_t nb_bins, uint64_t *sum);
+
+void ff_scene_hist_diff_c(const uint32_t *hist1, const uint32_t *hist2,
+                          ptrdiff_t nb_bins, uint64_t *sum);
+
+ff_scene_hist_diff_fn ff_scene_hist_diff_get_fn(void);
+
 #endif /* AVFILTER_SCENE_SAD_H */
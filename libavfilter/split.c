@@ -79,7 +79,12 @@ static int activate(AVFilterContext *ctx)
     if (ret < 0)
         return ret;
     if (ret > 0) {
-        for (int i = 0; i < ctx->nb_outputs; i++) {
+        int last = ctx->nb_outputs - 1;
+
+        while (last > 0 && ff_outlink_get_status(ctx->outputs[last]))
+            last--;
+
+        for (int i = 0; i < last; i++) {
             AVFrame *buf_out;
 
             if (ff_outlink_get_status(ctx->outputs[i]))
@@ -95,7 +100,11 @@ static int activate(AVFilterContext *ctx)
                 break;
         }
 
-        av_frame_free(&in);
+        /* the last live output takes over our reference instead of a clone */
+        if (ret >= 0 && !ff_outlink_get_status(ctx->outputs[last]))
+            ret = ff_filter_frame(ctx->outputs[last], in);
+        else
+            av_frame_free(&in);
         if (ret < 0)
             return ret;
     }
@@ -82,6 +82,7 @@ typedef struct MovieContext {
     MovieStream *st; /**< array of all streams, one per output */
     int *out_index; /**< stream number -> output number map, or -1 */
     AVDictionary *format_opts;
+    AVDictionary *dec_opts;
 } MovieContext;
 
 #define OFFSET(x) offsetof(MovieContext, x)
@@ -106,6 +107,7 @@ static const AVOption movie_options[]= {
     { "discontinuity", "set discontinuity threshold", OFFSET(discontinuity_threshold), AV_OPT_TYPE_DURATION, {.i64 = 0}, 0, INT64_MAX, FLAGS },
     { "dec_threads",  "set the number of threads for decoding", OFFSET(dec_threads), AV_OPT_TYPE_INT, {.i64 =  0}, 0, INT_MAX, FLAGS },
     { "format_opts",  "set format options for the opened file", OFFSET(format_opts), AV_OPT_TYPE_DICT, {.str = NULL}, 0, 0, FLAGS},
+    { "dec_opts",     "set decoder options for the opened streams", OFFSET(dec_opts), AV_OPT_TYPE_DICT, {.str = NULL}, 0, 0, FLAGS},
     { "duration",     "estimated stream duration (seconds)", OFFSET(duration_d), AV_OPT_TYPE_DOUBLE, {.dbl = 0}, -DBL_MAX, DBL_MAX, FLAGS|X|R},
     { NULL },
 };
@@ -216,8 +218,11 @@ static int get_buffer(AVCodecContext *avctx, AVFrame *frame, int flags)
     return 0;
 }
 
-static int open_stream(AVFilterContext *ctx, MovieStream *st, int dec_threads)
+static int open_stream(AVFilterContext *ctx, MovieStream *st, int dec_threads,
+                       const AVDictionary *dec_opts)
 {
+    const AVDictionaryEntry *e;
+    AVDictionary *opts = NULL;
     const AVCodec *codec;
     int ret;
 
@@ -241,11 +246,22 @@ static int open_stream(AVFilterContext *ctx, MovieStream *st, int dec_threads)
         dec_threads = ff_filter_get_nb_threads(ctx);
     st->codec_ctx->thread_count = dec_threads;
 
-    if ((ret = avcodec_open2(st->codec_ctx, codec, NULL)) < 0) {
+    ret = av_dict_copy(&opts, dec_opts, 0);
+    if (ret < 0)
+        return ret;
+
+    ret = avcodec_open2(st->codec_ctx, codec, &opts);
+    if (ret < 0) {
         av_log(ctx, AV_LOG_ERROR, "Failed to open codec\n");
+        av_dict_free(&opts);
         return ret;
     }
 
+    e = NULL;
+    while ((e = av_dict_iterate(opts, e)))
+        av_log(ctx, AV_LOG_WARNING, "Decoder option '%s' not used\n", e->key);
+    av_dict_free(&opts);
+
     return 0;
 }
 
@@ -380,7 +396,7 @@ static av_cold int movie_common_init(AVFilterContext *ctx)
             if (ret < 0)
                 return ret;
         }
-        ret = open_stream(ctx, &movie->st[i], movie->dec_threads);
+        ret = open_stream(ctx, &movie->st[i], movie->dec_threads, movie->dec_opts);
         if (ret < 0)
             return ret;
     }
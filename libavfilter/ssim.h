@@ -29,8 +29,14 @@ typedef struct SSIMDSPContext {
                           const uint8_t *ref, ptrdiff_t ref_stride,
                           int (*sums)[4], int w);
     double (*ssim_end_line)(const int (*sum0)[4], const int (*sum1)[4], int w);
+    void (*ssim_4x4_line_16bit)(const uint8_t *buf, ptrdiff_t buf_stride,
+                                const uint8_t *ref, ptrdiff_t ref_stride,
+                                int64_t (*sums)[4], int w);
+    float (*ssim_end_line_16bit)(const int64_t (*sum0)[4], const int64_t (*sum1)[4],
+                                 int w, int max);
 } SSIMDSPContext;
 
+void ff_ssim_init(SSIMDSPContext *dsp);
 void ff_ssim_init_x86(SSIMDSPContext *dsp);
 
 #endif /* AVFILTER_SSIM_H */
@@ -190,122 +190,124 @@ static inline void fn(get_lfe)(int output_lfe, int n, ftype lowcut, ftype highcu
     }
 }
 
-static void fn(filter_stereo)(AVFilterContext *ctx)
+static void fn(positions)(AVFilterContext *ctx, const ctype *srcl, const ctype *srcr,
+                          int start, int end)
+{
+    AudioSurroundContext *s = ctx->priv;
+    ftype *xpos = s->x_pos;
+    ftype *ypos = s->y_pos;
+    ftype *zpos = s->z_pos;
+
+#if DEPTH == 32
+    if (s->accuracy == ACCURACY_FAST) {
+        const int len = (end - start) & ~3;
+
+        s->dsp.stereo_position(xpos + start, ypos + start, zpos + start,
+                               srcl + start, srcr + start, len);
+        start += len;
+        stereo_position_c(xpos + start, ypos + start, zpos + start,
+                          srcl + start, srcr + start, end - start);
+        return;
+    }
+#endif
+
+    for (int n = start; n < end; n++) {
+        ftype l_re = srcl[n].re, r_re = srcr[n].re;
+        ftype l_im = srcl[n].im, r_im = srcr[n].im;
+        ftype l_mag = HYPOT(l_re, l_im);
+        ftype r_mag = HYPOT(r_re, r_im);
+        ctype cor;
+
+        cor.re = l_re * r_re + l_im * r_im;
+        cor.im = r_re * l_im - r_im * l_re;
+
+        fn(stereo_position)(l_mag, r_mag, cor, &xpos[n], &ypos[n], &zpos[n]);
+    }
+}
+
+static void fn(filter_stereo)(AVFilterContext *ctx, int start, int end)
 {
     AudioSurroundContext *s = ctx->priv;
     const ctype *srcl = (const ctype *)s->input->extended_data[0];
     const ctype *srcr = (const ctype *)s->input->extended_data[1];
     const int output_lfe = s->output_lfe && s->create_lfe;
-    const int rdft_size = s->rdft_size;
     const int lfe_mode = s->lfe_mode;
     const ftype highcut = s->highcut;
     const ftype lowcut = s->lowcut;
-    ftype *xpos = s->x_pos;
-    ftype *ypos = s->y_pos;
-    ftype *zpos = s->z_pos;
     ctype *osum = s->sum;
     ctype *odif = s->dif;
     ctype *olfe = s->lfe;
 
-    for (int n = 0; n < rdft_size; n++) {
+    fn(positions)(ctx, srcl, srcr, start, end);
+
+    for (int n = start; n < end; n++) {
         ftype l_re = srcl[n].re, r_re = srcr[n].re;
         ftype l_im = srcl[n].im, r_im = srcr[n].im;
-        ftype l_mag = HYPOT(l_re, l_im);
-        ftype r_mag = HYPOT(r_re, r_im);
-        ctype sum, dif, lfe, cor;
-        ftype x, y, z;
-
-        cor.re = l_re * r_re + l_im * r_im;
-        cor.im = r_re * l_im - r_im * l_re;
+        ctype sum, dif, lfe;
 
         sum.re = (l_re + r_re) * F(0.5);
         sum.im = (l_im + r_im) * F(0.5);
         dif.re = (l_re - r_re) * F(0.5);
         dif.im = (l_im - r_im) * F(0.5);
 
-        fn(stereo_position)(l_mag, r_mag, cor, &x, &y, &z);
         fn(get_lfe)(output_lfe, n, lowcut, highcut, &lfe, sum, &sum, lfe_mode);
 
-        xpos[n] = x;
-        ypos[n] = y;
-        zpos[n] = z;
         osum[n] = sum;
         odif[n] = dif;
         olfe[n] = lfe;
     }
 }
 
-static void fn(filter_2_1)(AVFilterContext *ctx)
+static void fn(filter_2_1)(AVFilterContext *ctx, int start, int end)
 {
     AudioSurroundContext *s = ctx->priv;
     const ctype *srcl = (const ctype *)s->input->extended_data[0];
     const ctype *srcr = (const ctype *)s->input->extended_data[1];
     const ctype *srclfe = (const ctype *)s->input->extended_data[2];
-    const int rdft_size = s->rdft_size;
-    ftype *xpos = s->x_pos;
-    ftype *ypos = s->y_pos;
-    ftype *zpos = s->z_pos;
     ctype *osum = s->sum;
     ctype *odif = s->dif;
     ctype *olfe = s->lfe;
 
-    for (int n = 0; n < rdft_size; n++) {
+    fn(positions)(ctx, srcl, srcr, start, end);
+
+    for (int n = start; n < end; n++) {
         ftype l_re = srcl[n].re, r_re = srcr[n].re;
         ftype l_im = srcl[n].im, r_im = srcr[n].im;
-        ftype l_mag = HYPOT(l_re, l_im);
-        ftype r_mag = HYPOT(r_re, r_im);
-        ctype sum, dif, cor;
-        ftype x, y, z;
-
-        cor.re = l_re * r_re + l_im * r_im;
-        cor.im = r_re * l_im - r_im * l_re;
+        ctype sum, dif;
 
         sum.re = (l_re + r_re) * F(0.5);
         sum.im = (l_im + r_im) * F(0.5);
         dif.re = (l_re - r_re) * F(0.5);
         dif.im = (l_im - r_im) * F(0.5);
 
-        fn(stereo_position)(l_mag, r_mag, cor, &x, &y, &z);
-
-        xpos[n] = x;
-        ypos[n] = y;
-        zpos[n] = z;
         osum[n] = sum;
         odif[n] = dif;
         olfe[n] = srclfe[n];
     }
 }
 
-static void fn(filter_surround)(AVFilterContext *ctx)
+static void fn(filter_surround)(AVFilterContext *ctx, int start, int end)
 {
     AudioSurroundContext *s = ctx->priv;
     const ctype *srcl = (const ctype *)s->input->extended_data[0];
     const ctype *srcr = (const ctype *)s->input->extended_data[1];
     const ctype *srcc = (const ctype *)s->input->extended_data[2];
     const int output_lfe = s->output_lfe && s->create_lfe;
-    const int rdft_size = s->rdft_size;
     const int lfe_mode = s->lfe_mode;
     const ftype highcut = s->highcut;
     const ftype lowcut = s->lowcut;
-    ftype *xpos = s->x_pos;
-    ftype *ypos = s->y_pos;
-    ftype *zpos = s->z_pos;
     ctype *osum = s->sum;
     ctype *odif = s->dif;
     ctype *ocnt = s->cnt;
     ctype *olfe = s->lfe;
 
-    for (int n = 0; n < rdft_size; n++) {
+    fn(positions)(ctx, srcl, srcr, start, end);
+
+    for (int n = start; n < end; n++) {
         ftype l_re = srcl[n].re, r_re = srcr[n].re;
         ftype l_im = srcl[n].im, r_im = srcr[n].im;
         ftype c_re = srcc[n].re, c_im = srcc[n].im;
-        ftype l_mag = HYPOT(l_re, l_im);
-        ftype r_mag = HYPOT(r_re, r_im);
-        ctype sum, dif, cnt, lfe, cor;
-        ftype x, y, z;
-
-        cor.re = l_re * r_re + l_im * r_im;
-        cor.im = r_re * l_im - r_im * l_re;
+        ctype sum, dif, cnt, lfe;
 
         sum.re = (l_re + r_re) * F(0.5);
         sum.im = (l_im + r_im) * F(0.5);
@@ -315,12 +317,8 @@ static void fn(filter_surround)(AVFilterContext *ctx)
         cnt.re = c_re;
         cnt.im = c_im;
 
-        fn(stereo_position)(l_mag, r_mag, cor, &x, &y, &z);
         fn(get_lfe)(output_lfe, n, lowcut, highcut, &lfe, cnt, &sum, lfe_mode);
 
-        xpos[n] = x;
-        ypos[n] = y;
-        zpos[n] = z;
         osum[n] = sum;
         odif[n] = dif;
         ocnt[n] = cnt;
@@ -328,43 +326,30 @@ static void fn(filter_surround)(AVFilterContext *ctx)
     }
 }
 
-static void fn(filter_3_1)(AVFilterContext *ctx)
+static void fn(filter_3_1)(AVFilterContext *ctx, int start, int end)
 {
     AudioSurroundContext *s = ctx->priv;
     const ctype *srcl = (const ctype *)s->input->extended_data[0];
     const ctype *srcr = (const ctype *)s->input->extended_data[1];
     const ctype *srcc = (const ctype *)s->input->extended_data[2];
     const ctype *srclfe = (const ctype *)s->input->extended_data[3];
-    const int rdft_size = s->rdft_size;
-    ftype *xpos = s->x_pos;
-    ftype *ypos = s->y_pos;
-    ftype *zpos = s->z_pos;
     ctype *osum = s->sum;
     ctype *odif = s->dif;
     ctype *ocnt = s->cnt;
     ctype *olfe = s->lfe;
 
-    for (int n = 0; n < rdft_size; n++) {
+    fn(positions)(ctx, srcl, srcr, start, end);
+
+    for (int n = start; n < end; n++) {
         ftype l_re = srcl[n].re, r_re = srcr[n].re;
         ftype l_im = srcl[n].im, r_im = srcr[n].im;
-        ftype l_mag = HYPOT(l_re, l_im);
-        ftype r_mag = HYPOT(r_re, r_im);
-        ctype sum, dif, cor;
-        ftype x, y, z;
-
-        cor.re = l_re * r_re + l_im * r_im;
-        cor.im = r_re * l_im - r_im * l_re;
+        ctype sum, dif;
 
         sum.re = (l_re + r_re) * F(0.5);
         sum.im = (l_im + r_im) * F(0.5);
         dif.re = (l_re - r_re) * F(0.5);
         dif.im = (l_im - r_im) * F(0.5);
 
-        fn(stereo_position)(l_mag, r_mag, cor, &x, &y, &z);
-
-        xpos[n] = x;
-        ypos[n] = y;
-        zpos[n] = z;
         osum[n] = sum;
         odif[n] = dif;
         ocnt[n] = srcc[n];
@@ -560,7 +545,7 @@ static void fn(focus_transform)(ftype *x, ftype focus)
     x[0] = CLIP(COPYSIGN(POW(FABS(x[0]), focus), x[0]), F(-1.0), F(1.0));
 }
 
-static void fn(power_factors)(AVFilterContext *ctx, const int ch)
+static void fn(power_factors)(AVFilterContext *ctx, const int ch, int start, int end)
 {
     AudioSurroundContext *s = ctx->priv;
     const ftype f_x = -s->f_x[FFMIN(ch, s->nb_f_x-1)];
@@ -574,9 +559,22 @@ static void fn(power_factors)(AVFilterContext *ctx, const int ch)
     const ftype num_y = F(1.0) + FEXP(f_y * F(0.5));
     const ftype num_z = F(1.0) + FEXP(f_z * F(0.5));
     const ftype num = num_x * num_y * num_z;
-    const int rdft_size = s->rdft_size;
 
-    for (int n = 0; n < rdft_size; n++) {
+#if DEPTH == 32
+    if (s->accuracy == ACCURACY_FAST) {
+        const float coeffs[4] = { f_x, f_y, f_z, num };
+        const int len = (end - start) & ~3;
+
+        s->dsp.power_factors(factor + start, xin + start, yin + start,
+                             zin + start, coeffs, len);
+        start += len;
+        power_factors_c(factor + start, xin + start, yin + start,
+                        zin + start, coeffs, end - start);
+        return;
+    }
+#endif
+
+    for (int n = start; n < end; n++) {
         ftype x = xin[n];
         ftype y = yin[n];
         ftype z = zin[n];
@@ -590,13 +588,13 @@ static void fn(power_factors)(AVFilterContext *ctx, const int ch)
     }
 }
 
-static void fn(calculate_factors)(AVFilterContext *ctx, int ch, int chan)
+static void fn(calculate_factors)(AVFilterContext *ctx, int ch, int chan,
+                                  int start, int end)
 {
     AudioSurroundContext *s = ctx->priv;
     ftype *x_out = (ftype *)s->x_out->extended_data[ch];
     ftype *y_out = (ftype *)s->y_out->extended_data[ch];
     ftype *z_out = (ftype *)s->z_out->extended_data[ch];
-    const int rdft_size = s->rdft_size;
     const ftype *x = s->x_pos;
     const ftype *y = s->y_pos;
     const ftype *z = s->z_pos;
@@ -613,7 +611,7 @@ static void fn(calculate_factors)(AVFilterContext *ctx, int ch, int chan)
     case AV_CHAN_LOW_FREQUENCY:
     case AV_CHAN_LOW_FREQUENCY_2:
     case AV_CHAN_BOTTOM_FRONT_CENTER:
-        for (int n = 0; n < rdft_size; n++)
+        for (int n = start; n < end; n++)
             x_out[n] = F(1.0) - FMIN(FABS(x[n]*F(2.0)), F(1.0));
         break;
     case AV_CHAN_BOTTOM_FRONT_LEFT:
@@ -623,7 +621,7 @@ static void fn(calculate_factors)(AVFilterContext *ctx, int ch, int chan)
     case AV_CHAN_SIDE_LEFT:
     case AV_CHAN_TOP_SIDE_LEFT:
     case AV_CHAN_BACK_LEFT:
-        for (int n = 0; n < rdft_size; n++)
+        for (int n = start; n < end; n++)
             x_out[n] = FMAX(-x[n], F(0.0));
         break;
     case AV_CHAN_BOTTOM_FRONT_RIGHT:
@@ -633,19 +631,19 @@ static void fn(calculate_factors)(AVFilterContext *ctx, int ch, int chan)
     case AV_CHAN_SIDE_RIGHT:
     case AV_CHAN_TOP_SIDE_RIGHT:
     case AV_CHAN_BACK_RIGHT:
-        for (int n = 0; n < rdft_size; n++)
+        for (int n = start; n < end; n++)
             x_out[n] = FMAX(x[n], F(0.0));
         break;
     case AV_CHAN_FRONT_LEFT_OF_CENTER:
-        for (int n = 0; n < rdft_size; n++)
+        for (int n = start; n < end; n++)
             x_out[n] = F(1.0) - FMIN(FABS(x[n]+F(0.5)), F(1.0));
         break;
     case AV_CHAN_FRONT_RIGHT_OF_CENTER:
-        for (int n = 0; n < rdft_size; n++)
+        for (int n = start; n < end; n++)
             x_out[n] = F(1.0) - FMIN(FABS(x[n]-F(0.5)), F(1.0));
         break;
     default:
-        for (int n = 0; n < rdft_size; n++)
+        for (int n = start; n < end; n++)
             x_out[n] = x[n];
         break;
     }
@@ -662,7 +660,7 @@ static void fn(calculate_factors)(AVFilterContext *ctx, int ch, int chan)
     case AV_CHAN_BOTTOM_FRONT_RIGHT:
     case AV_CHAN_FRONT_LEFT_OF_CENTER:
     case AV_CHAN_FRONT_RIGHT_OF_CENTER:
-        for (int n = 0; n < rdft_size; n++)
+        for (int n = start; n < end; n++)
             y_out[n] = FMAX(y[n], F(0.0));
         break;
     case AV_CHAN_TOP_CENTER:
@@ -672,7 +670,7 @@ static void fn(calculate_factors)(AVFilterContext *ctx, int ch, int chan)
     case AV_CHAN_TOP_SIDE_RIGHT:
     case AV_CHAN_LOW_FREQUENCY:
     case AV_CHAN_LOW_FREQUENCY_2:
-        for (int n = 0; n < rdft_size; n++)
+        for (int n = start; n < end; n++)
             y_out[n] = F(1.0) - FMIN(FABS(y[n]*F(2.0)), F(1.0));
         break;
     case AV_CHAN_BACK_CENTER:
@@ -681,11 +679,11 @@ static void fn(calculate_factors)(AVFilterContext *ctx, int ch, int chan)
     case AV_CHAN_TOP_BACK_CENTER:
     case AV_CHAN_TOP_BACK_LEFT:
     case AV_CHAN_TOP_BACK_RIGHT:
-        for (int n = 0; n < rdft_size; n++)
+        for (int n = start; n < end; n++)
             y_out[n] = FMAX(-y[n], F(0.0));
         break;
     default:
-        for (int n = 0; n < rdft_size; n++)
+        for (int n = start; n < end; n++)
             y_out[n] = y[n];
         break;
     }
@@ -700,37 +698,37 @@ static void fn(calculate_factors)(AVFilterContext *ctx, int ch, int chan)
     case AV_CHAN_TOP_BACK_RIGHT:
     case AV_CHAN_TOP_SIDE_LEFT:
     case AV_CHAN_TOP_SIDE_RIGHT:
-        for (int n = 0; n < rdft_size; n++)
+        for (int n = start; n < end; n++)
             z_out[n] = FMAX(z[n], F(0.0));
         break;
     case AV_CHAN_BOTTOM_FRONT_LEFT:
     case AV_CHAN_BOTTOM_FRONT_CENTER:
     case AV_CHAN_BOTTOM_FRONT_RIGHT:
-        for (int n = 0; n < rdft_size; n++)
+        for (int n = start; n < end; n++)
             z_out[n] = FMAX(-z[n], F(0.0));
         break;
     default:
-        for (int n = 0; n < rdft_size; n++)
+        for (int n = start; n < end; n++)
             z_out[n] = F(1.0) - FABS(z[n]);
         break;
     }
 
-    fn(power_factors)(ctx, ch);
+    fn(power_factors)(ctx, ch, start, end);
 }
 
-static void fn(bypass_transform)(AVFilterContext *ctx, int ch, int is_lfe)
+static void fn(bypass_transform)(AVFilterContext *ctx, int ch, int is_lfe,
+                                 int start, int end)
 {
     AudioSurroundContext *s = ctx->priv;
     const ctype *cnt = s->cnt;
     const ctype *lfe = s->lfe;
     const ctype *src = is_lfe ? lfe : cnt;
     ctype *dst = (ctype *)s->output->extended_data[ch];
-    const int rdft_size = s->rdft_size;
 
-    memcpy(dst, src, rdft_size * sizeof(*dst));
+    memcpy(dst + start, src + start, (end - start) * sizeof(*dst));
 }
 
-static void fn(do_transform)(AVFilterContext *ctx, int ch)
+static void fn(do_transform)(AVFilterContext *ctx, int ch, int start, int end)
 {
     AudioSurroundContext *s = ctx->priv;
     const int chan = av_channel_layout_channel_from_index(&s->out_ch_layout, ch);
@@ -740,27 +738,26 @@ static void fn(do_transform)(AVFilterContext *ctx, int ch)
     const ctype *odif = (const ctype *)s->output_dif->extended_data[ch];
     const ctype *osum = (const ctype *)s->output_sum->extended_data[ch];
     ctype *dst = (ctype *)s->output->extended_data[ch];
-    const int rdft_size = s->rdft_size;
 
     if (chan == AV_CHAN_LOW_FREQUENCY ||
         chan == AV_CHAN_LOW_FREQUENCY_2) {
-        memcpy(dst, osum, rdft_size * sizeof(*dst));
+        memcpy(dst + start, osum + start, (end - start) * sizeof(*dst));
         return;
     }
 
     if (s->smooth_init) {
-        const ftype *smooth = smooth_levels + ch * rdft_size;
+        const ftype *smooth = smooth_levels + ch * s->rdft_size;
 
-        for (int n = 0; n < rdft_size; n++) {
+        for (int n = start; n < end; n++) {
             sfactor[n] = FMA(factor[n] - sfactor[n], smooth[n], sfactor[n]);
             sfactor[n] = isnormal(sfactor[n]) ? sfactor[n] : F(0.0);
         }
     } else {
-        memcpy(sfactor, factor, rdft_size * sizeof(*sfactor));
+        memcpy(sfactor + start, factor + start, (end - start) * sizeof(*sfactor));
     }
     factor = sfactor;
 
-    for (int n = 0; n < rdft_size; n++) {
+    for (int n = start; n < end; n++) {
         const ctype dif = odif[n];
         const ctype sum = osum[n];
         const ftype a = factor[n];
@@ -776,12 +773,9 @@ static void fn(do_transform)(AVFilterContext *ctx, int ch)
     }
 }
 
-static int fn(transform_xy)(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+static void fn(transform_xy)(AVFilterContext *ctx, int start, int end)
 {
     AudioSurroundContext *s = ctx->priv;
-    const int rdft_size = s->rdft_size;
-    const int start = (rdft_size * jobnr) / nb_jobs;
-    const int end = (rdft_size * (jobnr+1)) / nb_jobs;
     const ftype angle = s->angle;
     const ftype focus_x = s->focus[0];
     const ftype focus_y = s->focus[FFMIN(1, s->nb_focus-1)];
@@ -811,28 +805,26 @@ static int fn(transform_xy)(AVFilterContext *ctx, void *arg, int jobnr, int nb_j
         fn(focus_transform)(&y[n], focus_y);
         fn(focus_transform)(&z[n], focus_z);
     }
-
-    return 0;
 }
 
-static void fn(stereo_copy)(AVFilterContext *ctx, int ch, int chan)
+static void fn(stereo_copy)(AVFilterContext *ctx, int ch, int chan,
+                            int start, int end)
 {
     AudioSurroundContext *s = ctx->priv;
     ctype *odif = (ctype *)s->output_dif->extended_data[ch];
     ctype *osum = (ctype *)s->output_sum->extended_data[ch];
     const ftype dif_factor = ch_dif[sc_map[chan]];
-    const int rdft_size = s->rdft_size;
     const ctype *sum = s->sum;
     const ctype *dif = s->dif;
 
     if (chan == AV_CHAN_LOW_FREQUENCY ||
         chan == AV_CHAN_LOW_FREQUENCY_2) {
-        memcpy(osum, s->lfe, rdft_size * sizeof(*osum));
+        memcpy(osum + start, (const ctype *)s->lfe + start, (end - start) * sizeof(*osum));
         return;
     }
 
-    memcpy(osum, sum, rdft_size * sizeof(*osum));
-    for (int n = 0; n < rdft_size; n++) {
+    memcpy(osum + start, sum + start, (end - start) * sizeof(*osum));
+    for (int n = start; n < end; n++) {
         odif[n].re = dif[n].re * dif_factor;
         odif[n].im = dif[n].im * dif_factor;
     }
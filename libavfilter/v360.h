@@ -116,6 +116,8 @@ typedef struct SliceXYRemap {
     int16_t *u[2], *v[2];
     int16_t *ker[2];
     uint8_t *mask;
+    float *vec[2];          ///< output vectors before rotation
+    uint8_t *out_mask;      ///< output mask of the first plane
 } SliceXYRemap;
 
 typedef struct V360Context {
@@ -176,6 +178,10 @@ typedef struct V360Context {
     int max_value;
     int nb_threads;
 
+    int update_remap;       ///< remap data must be recalculated before the next frame
+    int cache_vec;          ///< keep the output vectors for later rotations
+    int vec_valid;          ///< the kept output vectors are up to date
+
     SliceXYRemap *slice_remap;
     unsigned map[AV_VIDEO_MAX_PLANES];
 
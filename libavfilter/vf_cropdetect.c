@@ -46,6 +46,9 @@ typedef struct CropDetectContext {
     int frame_nb;
     int max_pixsteps[4];
     int max_outliers;
+    int step;
+    int strip_x;          ///< first column of the strip in strip_sums, or -1
+    int strip_sums[16];   ///< sums of the columns of a strip, see checkcolumn()
     int mode;
     int window_size;
     int mv_threshold;
@@ -87,52 +90,38 @@ static int comp(const int *a,const int *b)
     return FFDIFFSIGN(*a, *b);
 }
 
-static int checkline(void *ctx, const unsigned char *src, int stride, int len, int bpp)
+/* Average of a line of pixels, using every step-th pixel */
+static int checkline(void *ctx, const unsigned char *src, int len, int bpp, int step)
 {
-    int total = 0;
-    int div = len;
     const uint16_t *src16 = (const uint16_t *)src;
+    int total = 0;
+    int div = (len + step - 1) / step;
+    int i;
 
+    // the step == 1 loops are kept trivial, so the compiler vectorizes them
     switch (bpp) {
     case 1:
-        while (len >= 8) {
-            total += src[       0] + src[  stride] + src[2*stride] + src[3*stride]
-                  +  src[4*stride] + src[5*stride] + src[6*stride] + src[7*stride];
-            src += 8*stride;
-            len -= 8;
-        }
-        while (--len >= 0) {
-            total += src[0];
-            src += stride;
+        if (step == 1) {
+            for (i = 0; i < len; i++)
+                total += src[i];
+        } else {
+            for (i = 0; i < len; i += step)
+                total += src[i];
         }
         break;
     case 2:
-        stride >>= 1;
-        while (len >= 8) {
-            total += src16[       0] + src16[  stride] + src16[2*stride] + src16[3*stride]
-                  +  src16[4*stride] + src16[5*stride] + src16[6*stride] + src16[7*stride];
-            src16 += 8*stride;
-            len -= 8;
-        }
-        while (--len >= 0) {
-            total += src16[0];
-            src16 += stride;
+        if (step == 1) {
+            for (i = 0; i < len; i++)
+                total += src16[i];
+        } else {
+            for (i = 0; i < len; i += step)
+                total += src16[i];
         }
         break;
     case 3:
     case 4:
-        while (len >= 4) {
-            total += src[0]        + src[1         ] + src[2         ]
-                  +  src[  stride] + src[1+  stride] + src[2+  stride]
-                  +  src[2*stride] + src[1+2*stride] + src[2+2*stride]
-                  +  src[3*stride] + src[1+3*stride] + src[2+3*stride];
-            src += 4*stride;
-            len -= 4;
-        }
-        while (--len >= 0) {
-            total += src[0] + src[1] + src[2];
-            src += stride;
-        }
+        for (i = 0; i < len; i += step)
+            total += src[bpp * i] + src[bpp * i + 1] + src[bpp * i + 2];
         div *= 3;
         break;
     }
@@ -142,6 +131,57 @@ static int checkline(void *ctx, const unsigned char *src, int stride, int len, i
     return total;
 }
 
+/**
+ * Average of column x, using every step-th line. Reading single columns
+ * top to bottom touches a new cache line for every pixel, so the sums of
+ * a whole strip of neighbouring columns are computed at once, row by row,
+ * and kept for the following calls.
+ */
+static int checkcolumn(AVFilterContext *ctx, const AVFrame *frame, int x, int bpp)
+{
+    CropDetectContext *s = ctx->priv;
+    const int nb_strip = FF_ARRAY_ELEMS(s->strip_sums);
+    const int x0 = x - x % nb_strip;
+    const int step = s->step;
+    int div = (frame->height + step - 1) / step;
+    int total;
+
+    if (x0 != s->strip_x) {
+        const int n = FFMIN(nb_strip, frame->width - x0);
+        int *sums = s->strip_sums;
+
+        memset(s->strip_sums, 0, sizeof(s->strip_sums));
+        for (int y = 0; y < frame->height; y += step) {
+            const uint8_t *src = frame->data[0] + y * frame->linesize[0] + x0 * bpp;
+            const uint16_t *src16 = (const uint16_t *)src;
+
+            switch (bpp) {
+            case 1:
+                for (int j = 0; j < n; j++)
+                    sums[j] += src[j];
+                break;
+            case 2:
+                for (int j = 0; j < n; j++)
+                    sums[j] += src16[j];
+                break;
+            case 3:
+            case 4:
+                for (int j = 0; j < n; j++)
+                    sums[j] += src[bpp * j] + src[bpp * j + 1] + src[bpp * j + 2];
+                break;
+            }
+        }
+        s->strip_x = x0;
+    }
+
+    if (bpp >= 3)
+        div *= 3;
+    total = s->strip_sums[x - x0] / div;
+
+    av_log(ctx, AV_LOG_DEBUG, "total:%d\n", total);
+    return total;
+}
+
 static int checkline_edge(void *ctx, const unsigned char *src, int stride, int len, int bpp)
 {
     const uint16_t *src16 = (const uint16_t *)src;
@@ -282,10 +322,10 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *frame)
             s->frame_nb = 1;
         }
 
-#define FIND(DST, FROM, NOEND, INC, STEP0, STEP1, LEN) \
+#define FIND(DST, FROM, NOEND, INC, CHECK) \
         outliers = 0;\
         for (last_y = y = FROM; NOEND; y = y INC) {\
-            if (checkline(ctx, frame->data[0] + STEP0 * y, STEP1, LEN, bpp) > limit_upscaled) {\
+            if (CHECK > limit_upscaled) {\
                 if (++outliers > s->max_outliers) { \
                     DST = last_y;\
                     break;\
@@ -295,10 +335,13 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *frame)
         }
 
         if (s->mode == MODE_BLACK) {
-            FIND(s->y1,                 0,               y < s->y1, +1, frame->linesize[0], bpp, frame->width);
-            FIND(s->y2, frame->height - 1, y > FFMAX(s->y2, s->y1), -1, frame->linesize[0], bpp, frame->width);
-            FIND(s->x1,                 0,               y < s->x1, +1, bpp, frame->linesize[0], frame->height);
-            FIND(s->x2,  frame->width - 1, y > FFMAX(s->x2, s->x1), -1, bpp, frame->linesize[0], frame->height);
+#define CHECK_ROW    checkline(ctx, frame->data[0] + frame->linesize[0] * y, frame->width, bpp, s->step)
+#define CHECK_COLUMN checkcolumn(ctx, frame, y, bpp)
+            s->strip_x = -1;
+            FIND(s->y1,                 0,               y < s->y1, +1, CHECK_ROW);
+            FIND(s->y2, frame->height - 1, y > FFMAX(s->y2, s->y1), -1, CHECK_ROW);
+            FIND(s->x1,                 0,               y < s->x1, +1, CHECK_COLUMN);
+            FIND(s->x2,  frame->width - 1, y > FFMAX(s->x2, s->x1), -1, CHECK_COLUMN);
         } else { // MODE_MV_EDGES
             sd = av_frame_get_side_data(frame, AV_FRAME_DATA_MOTION_VECTORS);
             s->x1 = 0;
@@ -475,6 +518,7 @@ static const AVOption cropdetect_options[] = {
     { "skip",  "Number of initial frames to skip",                    OFFSET(skip),        AV_OPT_TYPE_INT, { .i64 = 2 },  0, INT_MAX, FLAGS },
     { "reset_count", "Recalculate the crop area after this many frames",OFFSET(reset_count),AV_OPT_TYPE_INT,{ .i64 = 0 },  0, INT_MAX, FLAGS },
     { "max_outliers", "Threshold count of outliers",                  OFFSET(max_outliers),AV_OPT_TYPE_INT, { .i64 = 0 },  0, INT_MAX, FLAGS },
+    { "step", "Analyse only every step-th pixel of each line",        OFFSET(step),        AV_OPT_TYPE_INT, { .i64 = 1 },  1, 64, FLAGS },
     { "mode", "set mode", OFFSET(mode), AV_OPT_TYPE_INT, {.i64=MODE_BLACK}, 0, MODE_NB-1, FLAGS, .unit = "mode" },
         { "black",    "detect black pixels surrounding the video",     0, AV_OPT_TYPE_CONST, {.i64=MODE_BLACK},    0, 0, FLAGS, .unit = "mode" },
         { "mvedges",  "detect motion and edged surrounding the video", 0, AV_OPT_TYPE_CONST, {.i64=MODE_MV_EDGES}, 0, 0, FLAGS, .unit = "mode" },
@@ -84,44 +84,58 @@ static const AVOption decimate_options[] = {
 
 AVFILTER_DEFINE_CLASS(decimate);
 
-static void calc_diffs(const DecimateContext *dm, struct qitem *q,
-                       const AVFrame *f1, const AVFrame *f2)
+typedef struct ThreadData {
+    const AVFrame *f1, *f2;
+} ThreadData;
+
+static int calc_diffs_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    int64_t maxdiff = -1;
+    const DecimateContext *dm = ctx->priv;
+    const ThreadData *td = arg;
+    const AVFrame *f1 = td->f1;
+    const AVFrame *f2 = td->f2;
+    const int brow_start = (dm->nyblocks *  jobnr   ) / nb_jobs;
+    const int brow_end   = (dm->nyblocks * (jobnr+1)) / nb_jobs;
     int64_t *bdiffs = dm->bdiffs;
-    int plane, i, j;
+    int plane;
 
-    memset(bdiffs, 0, dm->bdiffsize * sizeof(*bdiffs));
+    memset(bdiffs + brow_start * dm->nxblocks, 0,
+           (brow_end - brow_start) * dm->nxblocks * sizeof(*bdiffs));
 
     for (plane = 0; plane < (dm->chroma && f1->data[2] ? 3 : 1); plane++) {
         int x, y, xl;
         const int linesize1 = f1->linesize[plane];
         const int linesize2 = f2->linesize[plane];
-        const uint8_t *f1p = f1->data[plane];
-        const uint8_t *f2p = f2->data[plane];
         int width    = plane ? AV_CEIL_RSHIFT(f1->width,  dm->hsub) : f1->width;
         int height   = plane ? AV_CEIL_RSHIFT(f1->height, dm->vsub) : f1->height;
         int hblockx  = dm->blockx / 2;
         int hblocky  = dm->blocky / 2;
+        int slice_start, slice_end;
+        const uint8_t *f1p, *f2p;
 
         if (plane) {
             hblockx >>= dm->hsub;
             hblocky >>= dm->vsub;
         }
 
-        for (y = 0; y < height; y++) {
-            int ydest = y / hblocky;
+        /* each job only touches the block rows it owns */
+        slice_start = FFMIN(brow_start * hblocky, height);
+        slice_end   = FFMIN(brow_end   * hblocky, height);
+        f1p = f1->data[plane] + slice_start * linesize1;
+        f2p = f2->data[plane] + slice_start * linesize2;
+
+        for (y = slice_start; y < slice_end; y++) {
+            int64_t *row = bdiffs + (y / hblocky) * dm->nxblocks;
             int xdest = 0;
 
 #define CALC_DIFF(nbits) do {                               \
     for (x = 0; x < width; x += hblockx) {                  \
-        int64_t acc = 0;                                    \
+        int acc = 0;                                        \
         int m = FFMIN(width, x + hblockx);                  \
         for (xl = x; xl < m; xl++)                          \
             acc += abs(((const uint##nbits##_t *)f1p)[xl] - \
                        ((const uint##nbits##_t *)f2p)[xl]); \
-        bdiffs[ydest * dm->nxblocks + xdest] += acc;        \
-        xdest++;                                            \
+        row[xdest++] += acc;                                \
     }                                                       \
 } while (0)
             if (dm->depth == 8) CALC_DIFF(8);
@@ -132,6 +146,23 @@ static void calc_diffs(const DecimateContext *dm, struct qitem *q,
         }
     }
 
+    return 0;
+}
+
+static void calc_diffs(AVFilterContext *ctx, struct qitem *q,
+                       const AVFrame *f1, const AVFrame *f2)
+{
+    const DecimateContext *dm = ctx->priv;
+    const int64_t *bdiffs = dm->bdiffs;
+    int64_t maxdiff = -1;
+    ThreadData td;
+    int i, j;
+
+    td.f1 = f1;
+    td.f2 = f2;
+    ff_filter_execute(ctx, calc_diffs_slice, &td, NULL,
+                      FFMIN(dm->nyblocks, ff_filter_get_nb_threads(ctx)));
+
     for (i = 0; i < dm->nyblocks - 1; i++) {
         for (j = 0; j < dm->nxblocks - 1; j++) {
             int64_t tmp = bdiffs[      i * dm->nxblocks + j    ]
@@ -180,7 +211,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
             dm->queue[dm->fid].maxbdiff = INT64_MAX;
             dm->queue[dm->fid].totdiff  = INT64_MAX;
         } else {
-            calc_diffs(dm, &dm->queue[dm->fid], prv, in);
+            calc_diffs(ctx, &dm->queue[dm->fid], prv, in);
         }
         if (++dm->fid != dm->cycle)
             return 0;
@@ -460,5 +491,5 @@ const AVFilter ff_vf_decimate = {
     FILTER_OUTPUTS(decimate_outputs),
     FILTER_PIXFMTS_ARRAY(pix_fmts),
     .priv_class    = &decimate_class,
-    .flags         = AVFILTER_FLAG_DYNAMIC_INPUTS,
+    .flags         = AVFILTER_FLAG_DYNAMIC_INPUTS | AVFILTER_FLAG_SLICE_THREADS,
 };
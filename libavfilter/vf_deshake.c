@@ -91,6 +91,8 @@ typedef struct DeshakeContext {
     int counts[2*MAX_R+1][2*MAX_R+1]; ///< Scratch buffer for motion search
     double *angles;            ///< Scratch buffer for block angles
     unsigned angles_size;
+    IntMotionVector *mvs;      ///< Motion vector of every block, filled by the slice threads
+    unsigned mvs_size;
     AVFrame *ref;              ///< Previous frame
     int rx;                    ///< Maximum horizontal shift
     int ry;                    ///< Maximum vertical shift
@@ -170,7 +172,7 @@ static double clean_mean(double *values, int count)
  * and ry attributes. Searches using a simple matrix of those shifts and
  * chooses the most likely shift by the smallest difference in blocks.
  */
-static void find_block_motion(DeshakeContext *deshake, uint8_t *src1,
+static void find_block_motion(const DeshakeContext *deshake, uint8_t *src1,
                               uint8_t *src2, int cx, int cy, int stride,
                               IntMotionVector *mv)
 {
@@ -263,7 +265,7 @@ static int block_contrast(uint8_t *src, int x, int y, int stride, int blocksize)
 /**
  * Find the rotation for a given block.
  */
-static double block_angle(int x, int y, int cx, int cy, IntMotionVector *shift)
+static double block_angle(int x, int y, int cx, int cy, const IntMotionVector *shift)
 {
     double a1, a2, diff;
 
@@ -277,6 +279,45 @@ static double block_angle(int x, int y, int cx, int cy, IntMotionVector *shift)
            diff;
 }
 
+typedef struct ThreadData {
+    uint8_t *src1, *src2;
+    int stride;
+    int blocks_w, blocks_h;
+} ThreadData;
+
+/**
+ * Search the motion vectors of a range of block rows. Blocks that are not
+ * usable (too little contrast, or no good match) get a vector of (-1, -1).
+ */
+static int find_motion_slice(AVFilterContext *ctx, void *arg, int jobnr,
+                             int nb_jobs)
+{
+    DeshakeContext *deshake = ctx->priv;
+    ThreadData *td = arg;
+    const int row_start = (td->blocks_h *  jobnr     ) / nb_jobs;
+    const int row_end   = (td->blocks_h * (jobnr + 1)) / nb_jobs;
+
+    for (int row = row_start; row < row_end; row++) {
+        const int y = deshake->ry + row * deshake->blocksize * 2;
+        IntMotionVector *mvs = deshake->mvs + row * td->blocks_w;
+
+        for (int col = 0; col < td->blocks_w; col++) {
+            const int x = deshake->rx + col * 16;
+
+            // If the contrast is too low, just skip this block as it probably
+            // won't be very useful to us.
+            if (block_contrast(td->src2, x, y, td->stride, deshake->blocksize) > deshake->contrast) {
+                mvs[col] = (IntMotionVector){ 0, 0 };
+                find_block_motion(deshake, td->src1, td->src2, x, y, td->stride, &mvs[col]);
+            } else {
+                mvs[col] = (IntMotionVector){ -1, -1 };
+            }
+        }
+    }
+
+    return 0;
+}
+
 /**
  * Find the estimated global motion for a scene given the most likely shift
  * for each block in the frame. The global motion is estimated to be the
@@ -284,19 +325,21 @@ static double block_angle(int x, int y, int cx, int cy, IntMotionVector *shift)
  * move one pixel to the right and two pixels down, this would yield a
  * motion vector (1, -2).
  */
-static void find_motion(DeshakeContext *deshake, uint8_t *src1, uint8_t *src2,
-                        int width, int height, int stride, Transform *t)
+static int find_motion(AVFilterContext *ctx, uint8_t *src1, uint8_t *src2,
+                       int width, int height, int stride, Transform *t)
 {
+    DeshakeContext *deshake = ctx->priv;
+    ThreadData td;
     int x, y;
-    IntMotionVector mv = {0, 0};
     int count_max_value = 0;
-    int contrast;
 
     int pos;
     int center_x = 0, center_y = 0;
     double p_x, p_y;
 
     av_fast_malloc(&deshake->angles, &deshake->angles_size, width * height / (16 * deshake->blocksize) * sizeof(*deshake->angles));
+    if (!deshake->angles)
+        return AVERROR(ENOMEM);
 
     // Reset counts to zero
     for (x = 0; x < deshake->rx * 2 + 1; x++) {
@@ -305,25 +348,37 @@ static void find_motion(DeshakeContext *deshake, uint8_t *src1, uint8_t *src2,
         }
     }
 
+    // We use a width of 16 here to match the sad function
+    td.src1     = src1;
+    td.src2     = src2;
+    td.stride   = stride;
+    td.blocks_w = FFMAX(0, (width  - 2 * deshake->rx - 16 + 15) / 16);
+    td.blocks_h = FFMAX(0, (height - 2 * deshake->ry - 1) / (deshake->blocksize * 2));
+
+    av_fast_malloc(&deshake->mvs, &deshake->mvs_size,
+                   td.blocks_w * td.blocks_h * sizeof(*deshake->mvs));
+    if (!deshake->mvs)
+        return AVERROR(ENOMEM);
+
+    // Find motion for every block, then store the motion vectors in the
+    // counts in raster order, so the result does not depend on threading
+    if (td.blocks_h && td.blocks_w)
+        ff_filter_execute(ctx, find_motion_slice, &td, NULL,
+                          FFMIN(td.blocks_h, ff_filter_get_nb_threads(ctx)));
+
     pos = 0;
-    // Find motion for every block and store the motion vector in the counts
-    for (y = deshake->ry; y < height - deshake->ry - (deshake->blocksize * 2); y += deshake->blocksize * 2) {
-        // We use a width of 16 here to match the sad function
-        for (x = deshake->rx; x < width - deshake->rx - 16; x += 16) {
-            // If the contrast is too low, just skip this block as it probably
-            // won't be very useful to us.
-            contrast = block_contrast(src2, x, y, stride, deshake->blocksize);
-            if (contrast > deshake->contrast) {
-                //av_log(NULL, AV_LOG_ERROR, "%d\n", contrast);
-                find_block_motion(deshake, src1, src2, x, y, stride, &mv);
-                if (mv.x != -1 && mv.y != -1) {
-                    deshake->counts[mv.x + deshake->rx][mv.y + deshake->ry] += 1;
-                    if (x > deshake->rx && y > deshake->ry)
-                        deshake->angles[pos++] = block_angle(x, y, 0, 0, &mv);
-
-                    center_x += mv.x;
-                    center_y += mv.y;
-                }
+    for (int row = 0; row < td.blocks_h; row++) {
+        y = deshake->ry + row * deshake->blocksize * 2;
+        for (int col = 0; col < td.blocks_w; col++) {
+            const IntMotionVector *mv = &deshake->mvs[row * td.blocks_w + col];
+            x = deshake->rx + col * 16;
+            if (mv->x != -1 && mv->y != -1) {
+                deshake->counts[mv->x + deshake->rx][mv->y + deshake->ry] += 1;
+                if (x > deshake->rx && y > deshake->ry)
+                    deshake->angles[pos++] = block_angle(x, y, 0, 0, mv);
+
+                center_x += mv->x;
+                center_y += mv->y;
             }
         }
     }
@@ -362,6 +417,7 @@ static void find_motion(DeshakeContext *deshake, uint8_t *src1, uint8_t *src2,
     t->angle = av_clipf(t->angle, -0.1, 0.1);
 
     //av_log(NULL, AV_LOG_ERROR, "%d x %d\n", avg->x, avg->y);
+    return 0;
 }
 
 static int deshake_transform_c(AVFilterContext *ctx,
@@ -449,6 +505,8 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_frame_free(&deshake->ref);
     av_freep(&deshake->angles);
     deshake->angles_size = 0;
+    av_freep(&deshake->mvs);
+    deshake->mvs_size = 0;
     if (deshake->fp)
         fclose(deshake->fp);
 }
@@ -485,7 +543,7 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
 
     if (deshake->cx < 0 || deshake->cy < 0 || deshake->cw < 0 || deshake->ch < 0) {
         // Find the most likely global motion for the current frame
-        find_motion(deshake, (deshake->ref == NULL) ? in->data[0] : deshake->ref->data[0], in->data[0], link->w, link->h, in->linesize[0], &t);
+        ret = find_motion(link->dst, (deshake->ref == NULL) ? in->data[0] : deshake->ref->data[0], in->data[0], link->w, link->h, in->linesize[0], &t);
     } else {
         uint8_t *src1 = (deshake->ref == NULL) ? in->data[0] : deshake->ref->data[0];
         uint8_t *src2 = in->data[0];
@@ -502,8 +560,10 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
         src1 += deshake->cy * in->linesize[0] + deshake->cx;
         src2 += deshake->cy * in->linesize[0] + deshake->cx;
 
-        find_motion(deshake, src1, src2, deshake->cw, deshake->ch, in->linesize[0], &t);
+        ret = find_motion(link->dst, src1, src2, deshake->cw, deshake->ch, in->linesize[0], &t);
     }
+    if (ret < 0)
+        goto fail;
 
 
     // Copy transform so we can output it later to compare to the smoothed value
@@ -599,4 +659,5 @@ const AVFilter ff_vf_deshake = {
     FILTER_OUTPUTS(ff_video_default_filterpad),
     FILTER_PIXFMTS_ARRAY(pix_fmts),
     .priv_class    = &deshake_class,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
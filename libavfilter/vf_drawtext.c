@@ -194,6 +194,7 @@ typedef struct GlyphInfo {
     int y;                          ///< the y position of the glyph
     int shift_x64;                  ///< the horizontal shift of the glyph in 26.6 units
     int shift_y64;                  ///< the vertical shift of the glyph in 26.6 units
+    const struct Glyph *glyph;      ///< the cached glyph
 } GlyphInfo;
 
 /** Information about a single line of text */
@@ -327,8 +328,24 @@ typedef struct DrawTextContext {
     int tab_count;                  ///< the number of tab characters
     int blank_advance64;            ///< the size of the space character
     int tab_warning_printed;        ///< ensure the tab warning to be printed only once
+
+    char *layout_text;              ///< the text the cached lines were measured for
+    unsigned int layout_fontsize;   ///< the font size the cached lines were measured for
+    TextMetrics layout_metrics;     ///< the metrics of the cached lines
+    int layout_x64, layout_y64;     ///< the position of the cached glyphs (in 26.6 units)
+    int layout_placed;              ///< tells if the glyphs of the cached lines are placed
 } DrawTextContext;
 
+typedef struct ThreadData {
+    AVFrame *frame;
+    TextMetrics *metrics;
+    FFDrawColor *fontcolor;
+    FFDrawColor *shadowcolor;
+    FFDrawColor *bordercolor;
+    FFDrawColor *boxcolor;
+    int y_start, y_end;
+} ThreadData;
+
 #define OFFSET(x) offsetof(DrawTextContext, x)
 #define FLAGS AV_OPT_FLAG_FILTERING_PARAM|AV_OPT_FLAG_VIDEO_PARAM
 #define TFLAGS AV_OPT_FLAG_FILTERING_PARAM|AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_RUNTIME_PARAM
@@ -1127,6 +1144,30 @@ static int glyph_enu_free(void *opaque, void *elem)
     return 0;
 }
 
+static void hb_destroy(HarfbuzzData *hb)
+{
+    hb_font_destroy(hb->font);
+    hb_buffer_destroy(hb->buf);
+    hb->buf = NULL;
+    hb->font = NULL;
+    hb->glyph_info = NULL;
+    hb->glyph_pos = NULL;
+}
+
+static void free_lines(DrawTextContext *s)
+{
+    for (int l = 0; s->lines && l < s->line_count; ++l) {
+        TextLine *line = &s->lines[l];
+        av_freep(&line->glyphs);
+        hb_destroy(&line->hb_data);
+    }
+    av_freep(&s->lines);
+    av_freep(&s->tab_clusters);
+    av_freep(&s->layout_text);
+    s->line_count = 0;
+    s->layout_placed = 0;
+}
+
 static av_cold void uninit(AVFilterContext *ctx)
 {
     DrawTextContext *s = ctx->priv;
@@ -1142,6 +1183,8 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_tree_destroy(s->glyphs);
     s->glyphs = NULL;
 
+    free_lines(s);
+
     FT_Done_Face(s->face);
     FT_Stroker_Done(s->stroker);
     FT_Done_FreeType(s->library);
@@ -1236,6 +1279,7 @@ static int command(AVFilterContext *ctx, const char *cmd, const char *arg, char
         if ((ret = ff_filter_process_command(ctx, cmd, arg, res, res_len, flags)) < 0) {
             return ret;
         }
+        free_lines(old);
         if (old->borderw != old_borderw) {
             FT_Stroker_Set(old->stroker, old->borderw << 6, FT_STROKER_LINECAP_ROUND,
                         FT_STROKER_LINEJOIN_ROUND, 0);
@@ -1277,20 +1321,21 @@ static void update_alpha(DrawTextContext *s)
         s->alpha = 256 * alpha;
 }
 
-static int draw_glyphs(DrawTextContext *s, AVFrame *frame,
-                       FFDrawColor *color,
-                       TextMetrics *metrics,
-                       int x, int y, int borderw)
+static void draw_glyphs(DrawTextContext *s, AVFrame *frame,
+                        FFDrawColor *color,
+                        TextMetrics *metrics,
+                        int x, int y, int borderw,
+                        int slice_start, int slice_end)
 {
     int g, l, x1, y1, w1, h1, idx;
     int dx = 0, dy = 0, pdx = 0;
     GlyphInfo *info;
-    Glyph dummy = { 0 }, *glyph;
+    const Glyph *glyph;
     FT_Bitmap bitmap;
     FT_BitmapGlyph b_glyph;
     uint8_t j_left = 0, j_right = 0, j_top = 0, j_bottom = 0;
     int line_w, offset_y = 0;
-    int clip_x = 0, clip_y = 0;
+    int clip_x = 0, clip_y = 0, clip_top = 0;
 
     j_left = !!(s->text_align & TA_LEFT);
     j_right = !!(s->text_align & TA_RIGHT);
@@ -1303,26 +1348,16 @@ static int draw_glyphs(DrawTextContext *s, AVFrame *frame,
         offset_y = s->box_height - metrics->height;
     }
 
-    if ((!j_left || j_right) && !s->tab_warning_printed && s->tab_count > 0) {
-        s->tab_warning_printed = 1;
-        av_log(s, AV_LOG_WARNING, "Tab characters are only supported with left horizontal alignment\n");
-    }
-
     clip_x = FFMIN(metrics->rect_x + s->box_width + s->bb_right, frame->width);
-    clip_y = FFMIN(metrics->rect_y + s->box_height + s->bb_bottom, frame->height);
+    clip_y = FFMIN3(metrics->rect_y + s->box_height + s->bb_bottom, frame->height, slice_end);
+    clip_top = FFMAX(metrics->rect_y - s->bb_top, slice_start);
 
     for (l = 0; l < s->line_count; ++l) {
         TextLine *line = &s->lines[l];
         line_w = POS_CEIL(line->width64, 64);
         for (g = 0; g < line->hb_data.glyph_count; ++g) {
             info = &line->glyphs[g];
-            dummy.fontsize = s->fontsize;
-            dummy.code = info->code;
-            glyph = av_tree_find(s->glyphs, &dummy, glyph_cmp, NULL);
-            if (!glyph) {
-                return AVERROR(EINVAL);
-            }
-
+            glyph = info->glyph;
             idx = get_subpixel_idx(info->shift_x64, info->shift_y64);
             b_glyph = borderw ? glyph->border_bglyph[idx] : glyph->bglyph[idx];
             bitmap = b_glyph->bitmap;
@@ -1343,9 +1378,9 @@ static int draw_glyphs(DrawTextContext *s, AVFrame *frame,
                 dx = metrics->rect_x - s->bb_left - x1;
                 x1 = metrics->rect_x - s->bb_left;
             }
-            if (y1 < metrics->rect_y - s->bb_top) {
-                dy = metrics->rect_y - s->bb_top - y1;
-                y1 = metrics->rect_y - s->bb_top;
+            if (y1 < clip_top) {
+                dy = clip_top - y1;
+                y1 = clip_top;
             }
 
             // check if the glyph is empty or out of the clipping region
@@ -1361,6 +1396,49 @@ static int draw_glyphs(DrawTextContext *s, AVFrame *frame,
                 bitmap.buffer + pdx, bitmap.pitch, w1, h1, 3, 0, x1, y1);
         }
     }
+}
+
+static int draw_text_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    DrawTextContext *s = ctx->priv;
+    ThreadData *td = arg;
+    AVFrame *frame = td->frame;
+    TextMetrics *metrics = td->metrics;
+    const int align_mask = (1 << s->dc.vsub_max) - 1;
+    const int h = td->y_end - td->y_start;
+    int slice_start = td->y_start, slice_end = td->y_end;
+
+    /* keep the slice edges on chroma rows so no chroma row is shared */
+    if (jobnr > 0)
+        slice_start = av_clip((td->y_start + h * jobnr / nb_jobs) & ~align_mask,
+                              td->y_start, td->y_end);
+    if (jobnr < nb_jobs - 1)
+        slice_end = av_clip((td->y_start + h * (jobnr + 1) / nb_jobs) & ~align_mask,
+                            td->y_start, td->y_end);
+    if (slice_start >= slice_end)
+        return 0;
+
+    if (s->draw_box) {
+        int rec_y0 = FFMAX(metrics->rect_y - s->bb_top, slice_start);
+        int rec_y1 = FFMIN(metrics->rect_y + s->box_height + s->bb_bottom, slice_end);
+
+        if (rec_y1 > rec_y0)
+            ff_blend_rectangle(&s->dc, td->boxcolor,
+                               frame->data, frame->linesize, frame->width, frame->height,
+                               metrics->rect_x - s->bb_left, rec_y0,
+                               s->box_width + s->bb_right + s->bb_left, rec_y1 - rec_y0);
+    }
+
+    if (s->shadowx || s->shadowy)
+        draw_glyphs(s, frame, td->shadowcolor, metrics,
+                    s->shadowx, s->shadowy, s->borderw, slice_start, slice_end);
+
+    if (s->borderw)
+        draw_glyphs(s, frame, td->bordercolor, metrics,
+                    0, 0, s->borderw, slice_start, slice_end);
+
+    draw_glyphs(s, frame, td->fontcolor, metrics,
+                0, 0, 0, slice_start, slice_end);
 
     return 0;
 }
@@ -1391,16 +1469,6 @@ static int shape_text_hb(DrawTextContext *s, HarfbuzzData* hb, const char* text,
     return 0;
 }
 
-static void hb_destroy(HarfbuzzData *hb)
-{
-    hb_font_destroy(hb->font);
-    hb_buffer_destroy(hb->buf);
-    hb->buf = NULL;
-    hb->font = NULL;
-    hb->glyph_info = NULL;
-    hb->glyph_pos = NULL;
-}
-
 static int measure_text(AVFilterContext *ctx, TextMetrics *metrics)
 {
     DrawTextContext *s = ctx->priv;
@@ -1582,11 +1650,11 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame)
 
     int width = frame->width;
     int height = frame->height;
-    int rec_x = 0, rec_y = 0, rec_width = 0, rec_height = 0;
     int is_outside = 0;
     int last_tab_idx = 0;
 
     TextMetrics metrics;
+    ThreadData td;
 
     av_bprint_clear(bp);
 
@@ -1635,9 +1703,20 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame)
         return ret;
     }
 
-    if ((ret = measure_text(ctx, &metrics)) < 0) {
-        return ret;
+    /* shaping only depends on the text and the font size, reuse the lines
+     * measured for a previous frame when both are unchanged */
+    if (!s->layout_text || s->layout_fontsize != s->fontsize ||
+        strcmp(s->layout_text, bp->str)) {
+        free_lines(s);
+        if ((ret = measure_text(ctx, &s->layout_metrics)) < 0) {
+            return ret;
+        }
+        s->layout_text = av_strdup(bp->str);
+        if (!s->layout_text)
+            return AVERROR(ENOMEM);
+        s->layout_fontsize = s->fontsize;
     }
+    metrics = s->layout_metrics;
 
     s->max_glyph_h = POS_CEIL(metrics.max_y64 - metrics.min_y64, 64);
     s->max_glyph_w = POS_CEIL(metrics.max_x64 - metrics.min_x64, 64);
@@ -1728,10 +1807,15 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame)
         y64 = (int)(s->y * 64. + metrics.offset_top64);
     }
 
-    for (int l = 0; l < s->line_count; ++l) {
+    for (int l = 0; l < s->line_count && (!s->layout_placed ||
+                    x64 != s->layout_x64 || y64 != s->layout_y64); ++l) {
         TextLine *line = &s->lines[l];
         HarfbuzzData *hb = &line->hb_data;
-        line->glyphs = av_mallocz(hb->glyph_count * sizeof(GlyphInfo));
+        if (!line->glyphs) {
+            line->glyphs = av_calloc(hb->glyph_count, sizeof(GlyphInfo));
+            if (!line->glyphs)
+                return AVERROR(ENOMEM);
+        }
 
         for (int t = 0; t < hb->glyph_count; ++t) {
             GlyphInfo *g_info = &line->glyphs[t];
@@ -1755,6 +1839,7 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame)
             g_info->y = ((y64 + true_y) >> 6) + (shift_y64 > 0 ? 1 : 0);
             g_info->shift_x64 = shift_x64;
             g_info->shift_y64 = shift_y64;
+            g_info->glyph = glyph;
 
             if (!is_tab) {
                 x += hb->glyph_pos[t].x_advance;
@@ -1768,6 +1853,9 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame)
         y += metrics.line_height64 + s->line_spacing * 64;
         x = 0;
     }
+    s->layout_placed = 1;
+    s->layout_x64 = x64;
+    s->layout_y64 = y64;
 
     metrics.rect_x = s->x;
     if (s->y_align == YA_BASELINE) {
@@ -1796,45 +1884,24 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame)
                     metrics.rect_y + s->box_height + s->bb_bottom <= 0;
 
     if (!is_outside) {
-        /* draw box */
-        if (s->draw_box) {
-            rec_x = metrics.rect_x - s->bb_left;
-            rec_y = metrics.rect_y - s->bb_top;
-            rec_width = s->box_width + s->bb_right + s->bb_left;
-            rec_height = s->box_height + s->bb_bottom + s->bb_top;
-            ff_blend_rectangle(&s->dc, &boxcolor,
-                frame->data, frame->linesize, width, height,
-                rec_x, rec_y, rec_width, rec_height);
+        if ((!(s->text_align & TA_LEFT) || (s->text_align & TA_RIGHT)) &&
+            !s->tab_warning_printed && s->tab_count > 0) {
+            s->tab_warning_printed = 1;
+            av_log(s, AV_LOG_WARNING, "Tab characters are only supported with left horizontal alignment\n");
         }
 
-        if (s->shadowx || s->shadowy) {
-            if ((ret = draw_glyphs(s, frame, &shadowcolor, &metrics,
-                    s->shadowx, s->shadowy, s->borderw)) < 0) {
-                return ret;
-            }
-        }
-
-        if (s->borderw) {
-            if ((ret = draw_glyphs(s, frame, &bordercolor, &metrics,
-                    0, 0, s->borderw)) < 0) {
-                return ret;
-            }
-        }
-
-        if ((ret = draw_glyphs(s, frame, &fontcolor, &metrics, 0,
-                0, 0)) < 0) {
-            return ret;
-        }
-    }
-
-    // FREE data structures
-    for (int l = 0; l < s->line_count; ++l) {
-        TextLine *line = &s->lines[l];
-        av_freep(&line->glyphs);
-        hb_destroy(&line->hb_data);
+        td.frame = frame;
+        td.metrics = &metrics;
+        td.fontcolor = &fontcolor;
+        td.shadowcolor = &shadowcolor;
+        td.bordercolor = &bordercolor;
+        td.boxcolor = &boxcolor;
+        td.y_start = FFMAX(metrics.rect_y - s->bb_top, 0);
+        td.y_end = FFMIN(metrics.rect_y + s->box_height + s->bb_bottom, height);
+        ff_filter_execute(ctx, draw_text_slice, &td, NULL,
+                          FFMAX(1, FFMIN((td.y_end - td.y_start) >> s->dc.vsub_max,
+                                         ff_filter_get_nb_threads(ctx))));
     }
-    av_freep(&s->lines);
-    av_freep(&s->tab_clusters);
 
     return 0;
 }
@@ -1929,5 +1996,5 @@ const AVFilter ff_vf_drawtext = {
     FILTER_OUTPUTS(ff_video_default_filterpad),
     FILTER_QUERY_FUNC2(query_formats),
     .process_command = command,
-    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC | AVFILTER_FLAG_SLICE_THREADS,
 };
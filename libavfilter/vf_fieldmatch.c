@@ -34,6 +34,7 @@
 
 #include "libavutil/avassert.h"
 #include "libavutil/imgutils.h"
+#include "libavutil/intreadwrite.h"
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "libavutil/timestamp.h"
@@ -109,10 +110,26 @@ typedef struct FieldMatchContext {
     uint8_t *cmask_data[4];
     int cmask_linesize[4];
     int *c_array;
+    int *cell_array;                ///< combed pixel count of every half block
+    int ncellx, ncelly;
     int tpitchy, tpitchuv;
     uint8_t *tbuffer;
+
+    int nb_threads;
+    int64_t *job_sad;
+    uint64_t (*job_accum)[6];
 } FieldMatchContext;
 
+typedef struct CompareThreadData {
+    const uint8_t *srcpf, *srcf, *srcnf;
+    const uint8_t *prvpf, *prvnf, *nxtpf, *nxtnf;
+    const uint8_t *dprvp, *dnxtp;   ///< fields the diff map is built from
+    uint8_t *mapp, *dmapp;
+    int srcf_linesize, prvf_linesize, nxtf_linesize, map_linesize;
+    int width, height, plane;
+    int startx, stopx, y0a, y1a;
+} CompareThreadData;
+
 #define OFFSET(x) offsetof(FieldMatchContext, x)
 #define FLAGS AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_FILTERING_PARAM
 
@@ -165,23 +182,44 @@ static int get_height(const FieldMatchContext *fm, const AVFrame *f, int plane,
     return plane ? AV_CEIL_RSHIFT(f->height, fm->vsub[input]) : f->height;
 }
 
-static int64_t luma_abs_diff(const AVFrame *f1, const AVFrame *f2)
+static int luma_abs_diff_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    int x, y;
-    const uint8_t *srcp1 = f1->data[0];
-    const uint8_t *srcp2 = f2->data[0];
-    const int src1_linesize = f1->linesize[0];
-    const int src2_linesize = f2->linesize[0];
-    const int width  = f1->width;
-    const int height = f1->height;
+    FieldMatchContext *fm = ctx->priv;
+    const AVFrame *const *f = arg;
+    const int width  = f[0]->width;
+    const int height = f[0]->height;
+    const int slice_start = (height *  jobnr   ) / nb_jobs;
+    const int slice_end   = (height * (jobnr+1)) / nb_jobs;
+    const int src1_linesize = f[0]->linesize[0];
+    const int src2_linesize = f[1]->linesize[0];
+    const uint8_t *srcp1 = f[0]->data[0] + slice_start * src1_linesize;
+    const uint8_t *srcp2 = f[1]->data[0] + slice_start * src2_linesize;
     int64_t acc = 0;
 
-    for (y = 0; y < height; y++) {
-        for (x = 0; x < width; x++)
-            acc += abs(srcp1[x] - srcp2[x]);
+    for (int y = slice_start; y < slice_end; y++) {
+        int row = 0;
+
+        for (int x = 0; x < width; x++)
+            row += abs(srcp1[x] - srcp2[x]);
+        acc += row;
         srcp1 += src1_linesize;
         srcp2 += src2_linesize;
     }
+    fm->job_sad[jobnr] = acc;
+
+    return 0;
+}
+
+static int64_t luma_abs_diff(AVFilterContext *ctx, const AVFrame *f1, const AVFrame *f2)
+{
+    FieldMatchContext *fm = ctx->priv;
+    const AVFrame *f[2] = { f1, f2 };
+    const int nb_jobs = FFMIN(f1->height, fm->nb_threads);
+    int64_t acc = 0;
+
+    ff_filter_execute(ctx, luma_abs_diff_slice, (void *)f, NULL, nb_jobs);
+    for (int i = 0; i < nb_jobs; i++)
+        acc += fm->job_sad[i];
     return acc;
 }
 
@@ -195,283 +233,384 @@ static void fill_buf(uint8_t *data, int w, int h, int linesize, uint8_t v)
     }
 }
 
-static int calc_combed_score(const FieldMatchContext *fm, const AVFrame *src)
+/**
+ * Mark the combed pixels of one line with the [1 -3 4 -3 1] vertical
+ * filter; the taps are mirrored at the top and bottom of the plane.
+ */
+static void comb_mask_line(uint8_t *cmkp, const uint8_t *srcp, int src_linesize,
+                           int width, int y, int height, int cthresh)
 {
-    int x, y, plane, max_v = 0;
-    const int cthresh = fm->cthresh;
     const int cthresh6 = cthresh * 6;
+    const ptrdiff_t m2 = (y > 1          ? -2 : 2) * (ptrdiff_t)src_linesize;
+    const ptrdiff_t m1 = (y > 0          ? -1 : 1) * (ptrdiff_t)src_linesize;
+    const ptrdiff_t p1 = (y < height - 1 ?  1 : -1) * (ptrdiff_t)src_linesize;
+    const ptrdiff_t p2 = (y < height - 2 ?  2 : -2) * (ptrdiff_t)src_linesize;
+
+    for (int x = 0; x < width; x++) {
+        const int s1 = abs(srcp[x] - srcp[x + m1]);
+        const int s2 = abs(srcp[x] - srcp[x + p1]);
+
+        cmkp[x] = s1 > cthresh && s2 > cthresh &&
+                  abs(  4 * srcp[x]
+                       -3 * (srcp[x + m1] + srcp[x + p1])
+                       +    (srcp[x + m2] + srcp[x + p2])) > cthresh6 ? 0xff : 0;
+    }
+}
 
-    for (plane = 0; plane < (fm->chroma ? 3 : 1); plane++) {
-        const uint8_t *srcp = src->data[plane];
+static int comb_mask_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    const FieldMatchContext *fm = ctx->priv;
+    const AVFrame *src = arg;
+
+    for (int plane = 0; plane < (fm->chroma ? 3 : 1); plane++) {
         const int src_linesize = src->linesize[plane];
+        const int cmk_linesize = fm->cmask_linesize[plane];
         const int width  = get_width (fm, src, plane, INPUT_MAIN);
         const int height = get_height(fm, src, plane, INPUT_MAIN);
-        uint8_t *cmkp = fm->cmask_data[plane];
-        const int cmk_linesize = fm->cmask_linesize[plane];
+        const int slice_start = (height *  jobnr   ) / nb_jobs;
+        const int slice_end   = (height * (jobnr+1)) / nb_jobs;
+        const uint8_t *srcp = src->data[plane] + slice_start * src_linesize;
+        uint8_t *cmkp = fm->cmask_data[plane] + slice_start * cmk_linesize;
 
-        if (cthresh < 0) {
-            fill_buf(cmkp, width, height, cmk_linesize, 0xff);
+        if (fm->cthresh < 0) {
+            fill_buf(cmkp, width, slice_end - slice_start, cmk_linesize, 0xff);
             continue;
         }
-        fill_buf(cmkp, width, height, cmk_linesize, 0);
-
-        /* [1 -3 4 -3 1] vertical filter */
-#define FILTER(xm2, xm1, xp1, xp2) \
-        abs(  4 * srcp[x] \
-             -3 * (srcp[x + (xm1)*src_linesize] + srcp[x + (xp1)*src_linesize]) \
-             +    (srcp[x + (xm2)*src_linesize] + srcp[x + (xp2)*src_linesize])) > cthresh6
-
-        /* first line */
-        for (x = 0; x < width; x++) {
-            const int s1 = abs(srcp[x] - srcp[x + src_linesize]);
-            if (s1 > cthresh && FILTER(2, 1, 1, 2))
-                cmkp[x] = 0xff;
-        }
-        srcp += src_linesize;
-        cmkp += cmk_linesize;
-
-        /* second line */
-        for (x = 0; x < width; x++) {
-            const int s1 = abs(srcp[x] - srcp[x - src_linesize]);
-            const int s2 = abs(srcp[x] - srcp[x + src_linesize]);
-            if (s1 > cthresh && s2 > cthresh && FILTER(2, -1, 1, 2))
-                cmkp[x] = 0xff;
-        }
-        srcp += src_linesize;
-        cmkp += cmk_linesize;
-
-        /* all lines minus first two and last two */
-        for (y = 2; y < height-2; y++) {
-            for (x = 0; x < width; x++) {
-                const int s1 = abs(srcp[x] - srcp[x - src_linesize]);
-                const int s2 = abs(srcp[x] - srcp[x + src_linesize]);
-                if (s1 > cthresh && s2 > cthresh && FILTER(-2, -1, 1, 2))
-                    cmkp[x] = 0xff;
-            }
+
+        for (int y = slice_start; y < slice_end; y++) {
+            comb_mask_line(cmkp, srcp, src_linesize, width, y, height, fm->cthresh);
             srcp += src_linesize;
             cmkp += cmk_linesize;
         }
-
-        /* before-last line */
-        for (x = 0; x < width; x++) {
-            const int s1 = abs(srcp[x] - srcp[x - src_linesize]);
-            const int s2 = abs(srcp[x] - srcp[x + src_linesize]);
-            if (s1 > cthresh && s2 > cthresh && FILTER(-2, -1, 1, -2))
-                cmkp[x] = 0xff;
-        }
-        srcp += src_linesize;
-        cmkp += cmk_linesize;
-
-        /* last line */
-        for (x = 0; x < width; x++) {
-            const int s1 = abs(srcp[x] - srcp[x - src_linesize]);
-            if (s1 > cthresh && FILTER(-2, -1, -1, -2))
-                cmkp[x] = 0xff;
-        }
     }
 
-    if (fm->chroma) {
-        uint8_t *cmkp  = fm->cmask_data[0];
-        uint8_t *cmkpU = fm->cmask_data[1];
-        uint8_t *cmkpV = fm->cmask_data[2];
-        const int width  = AV_CEIL_RSHIFT(src->width,  fm->hsub[INPUT_MAIN]);
-        const int height = AV_CEIL_RSHIFT(src->height, fm->vsub[INPUT_MAIN]);
-        const int cmk_linesize   = fm->cmask_linesize[0] << 1;
-        const int cmk_linesizeUV = fm->cmask_linesize[2];
-        uint8_t *cmkpp  = cmkp - (cmk_linesize>>1);
-        uint8_t *cmkpn  = cmkp + (cmk_linesize>>1);
-        uint8_t *cmkpnn = cmkp +  cmk_linesize;
-        for (y = 1; y < height - 1; y++) {
-            cmkpp  += cmk_linesize;
-            cmkp   += cmk_linesize;
-            cmkpn  += cmk_linesize;
-            cmkpnn += cmk_linesize;
-            cmkpV  += cmk_linesizeUV;
-            cmkpU  += cmk_linesizeUV;
-            for (x = 1; x < width - 1; x++) {
+    return 0;
+}
+
+/**
+ * Spread combed chroma pixels to the luma mask, assuming 2x2 subsampling.
+ * Every job owns the luma lines of its chroma lines, and reevaluates the
+ * chroma lines next to its range that also touch them.
+ */
+static int comb_chroma_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    const FieldMatchContext *fm = ctx->priv;
+    const AVFrame *src = arg;
+    const int width  = AV_CEIL_RSHIFT(src->width,  fm->hsub[INPUT_MAIN]);
+    const int height = AV_CEIL_RSHIFT(src->height, fm->vsub[INPUT_MAIN]);
+    const int slice_start = (height *  jobnr   ) / nb_jobs;
+    const int slice_end   = (height * (jobnr+1)) / nb_jobs;
+    const int line_start = 2 * slice_start;
+    const int line_end   = FFMIN(2 * slice_end, src->height);
+    const int xend = FFMIN(width - 1, src->width / 2);
+    const int cmk_linesize   = fm->cmask_linesize[0];
+    const int cmk_linesizeUV = fm->cmask_linesize[2];
+
+    for (int y = FFMAX(1, slice_start - 1); y <= FFMIN(height - 2, slice_end); y++) {
+        const uint8_t *cmkpU = fm->cmask_data[1] + y * cmk_linesizeUV;
+        const uint8_t *cmkpV = fm->cmask_data[2] + y * cmk_linesizeUV;
+        const int lines[3] = { 2 * y, 2 * y + 1, y & 1 ? 2 * y - 1 : 2 * y + 2 };
+
+        for (int x = 1; x < xend; x++) {
 #define HAS_FF_AROUND(p, lz) (p[(x)-1 - (lz)] == 0xff || p[(x) - (lz)] == 0xff || p[(x)+1 - (lz)] == 0xff || \
                               p[(x)-1       ] == 0xff ||                          p[(x)+1       ] == 0xff || \
                               p[(x)-1 + (lz)] == 0xff || p[(x) + (lz)] == 0xff || p[(x)+1 + (lz)] == 0xff)
-                if ((cmkpV[x] == 0xff && HAS_FF_AROUND(cmkpV, cmk_linesizeUV)) ||
-                    (cmkpU[x] == 0xff && HAS_FF_AROUND(cmkpU, cmk_linesizeUV))) {
-                    ((uint16_t*)cmkp)[x]  = 0xffff;
-                    ((uint16_t*)cmkpn)[x] = 0xffff;
-                    if (y&1) ((uint16_t*)cmkpp)[x]  = 0xffff;
-                    else     ((uint16_t*)cmkpnn)[x] = 0xffff;
+            if ((cmkpV[x] == 0xff && HAS_FF_AROUND(cmkpV, cmk_linesizeUV)) ||
+                (cmkpU[x] == 0xff && HAS_FF_AROUND(cmkpU, cmk_linesizeUV))) {
+                for (int i = 0; i < 3; i++) {
+                    if (lines[i] >= line_start && lines[i] < line_end)
+                        ((uint16_t*)(fm->cmask_data[0] + lines[i] * cmk_linesize))[x] = 0xffff;
                 }
             }
         }
     }
 
-    {
-        const int blockx = fm->blockx;
-        const int blocky = fm->blocky;
-        const int xhalf = blockx/2;
-        const int yhalf = blocky/2;
-        const int cmk_linesize = fm->cmask_linesize[0];
-        const uint8_t *cmkp    = fm->cmask_data[0] + cmk_linesize;
-        const int width  = src->width;
-        const int height = src->height;
-        const int xblocks = ((width+xhalf)/blockx) + 1;
-        const int xblocks4 = xblocks<<2;
-        const int yblocks = ((height+yhalf)/blocky) + 1;
-        int *c_array = fm->c_array;
-        const int arraysize = (xblocks*yblocks)<<2;
-        int      heighta = (height/(blocky/2))*(blocky/2);
-        const int widtha = (width /(blockx/2))*(blockx/2);
-        if (heighta == height)
-            heighta = height - yhalf;
-        memset(c_array, 0, arraysize * sizeof(*c_array));
-
-#define C_ARRAY_ADD(v) do {                         \
-    const int box1 = (x / blockx) * 4;              \
-    const int box2 = ((x + xhalf) / blockx) * 4;    \
-    c_array[temp1 + box1    ] += v;                 \
-    c_array[temp1 + box2 + 1] += v;                 \
-    c_array[temp2 + box1 + 2] += v;                 \
-    c_array[temp2 + box2 + 3] += v;                 \
-} while (0)
-
-#define VERTICAL_HALF(y_start, y_end) do {                                  \
-    for (y = y_start; y < y_end; y++) {                                     \
-        const int temp1 = (y / blocky) * xblocks4;                          \
-        const int temp2 = ((y + yhalf) / blocky) * xblocks4;                \
-        for (x = 0; x < width; x++)                                         \
-            if (cmkp[x - cmk_linesize] == 0xff &&                           \
-                cmkp[x               ] == 0xff &&                           \
-                cmkp[x + cmk_linesize] == 0xff)                             \
-                C_ARRAY_ADD(1);                                             \
-        cmkp += cmk_linesize;                                               \
-    }                                                                       \
-} while (0)
-
-        VERTICAL_HALF(1, yhalf);
-
-        for (y = yhalf; y < heighta; y += yhalf) {
-            const int temp1 = (y / blocky) * xblocks4;
-            const int temp2 = ((y + yhalf) / blocky) * xblocks4;
-
-            for (x = 0; x < widtha; x += xhalf) {
-                const uint8_t *cmkp_tmp = cmkp + x;
-                int u, v, sum = 0;
-                for (u = 0; u < yhalf; u++) {
-                    for (v = 0; v < xhalf; v++)
-                        if (cmkp_tmp[v - cmk_linesize] == 0xff &&
-                            cmkp_tmp[v               ] == 0xff &&
-                            cmkp_tmp[v + cmk_linesize] == 0xff)
-                            sum++;
-                    cmkp_tmp += cmk_linesize;
-                }
-                if (sum)
-                    C_ARRAY_ADD(sum);
-            }
+    return 0;
+}
 
-            for (x = widtha; x < width; x++) {
-                const uint8_t *cmkp_tmp = cmkp + x;
-                int u, sum = 0;
-                for (u = 0; u < yhalf; u++) {
-                    if (cmkp_tmp[-cmk_linesize] == 0xff &&
-                        cmkp_tmp[            0] == 0xff &&
-                        cmkp_tmp[ cmk_linesize] == 0xff)
-                        sum++;
-                    cmkp_tmp += cmk_linesize;
-                }
-                if (sum)
-                    C_ARRAY_ADD(sum);
+/**
+ * Count the pixels combed on three consecutive lines of the luma mask in
+ * every blockx/2 by blocky/2 cell.
+ */
+static int comb_count_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    const FieldMatchContext *fm = ctx->priv;
+    const AVFrame *src = arg;
+    const int xhalf = fm->blockx / 2;
+    const int yhalf = fm->blocky / 2;
+    const int width  = src->width;
+    const int height = src->height;
+    const int cmk_linesize = fm->cmask_linesize[0];
+    const int cell_start = (fm->ncelly *  jobnr   ) / nb_jobs;
+    const int cell_end   = (fm->ncelly * (jobnr+1)) / nb_jobs;
+    const int slice_start = FFMAX(1, cell_start * yhalf);
+    const int slice_end   = FFMIN(height - 1, cell_end * yhalf);
+    int *cells = fm->cell_array;
+
+    memset(cells + cell_start * fm->ncellx, 0,
+           (cell_end - cell_start) * fm->ncellx * sizeof(*cells));
+
+    for (int y = slice_start; y < slice_end; y++) {
+        const uint8_t *cmkp = fm->cmask_data[0] + y * cmk_linesize;
+        const uint8_t *cmkpp = cmkp - cmk_linesize;
+        const uint8_t *cmkpn = cmkp + cmk_linesize;
+        int *cellp = cells + (y / yhalf) * fm->ncellx;
+
+        for (int x = 0, cx = 0; x < width; x += xhalf, cx++) {
+            const int end = FFMIN(width, x + xhalf);
+            int v = x, sum = 0;
+
+            /* mask bytes are either 0 or 0xff, so the low bit of every
+             * byte of the combined mask counts one combed pixel */
+            if (end - v >= 8) {
+                uint64_t acc = 0;
+
+                for (; v + 8 <= end; v += 8)
+                    acc += AV_RN64(cmkpp + v) & AV_RN64(cmkp + v) &
+                           AV_RN64(cmkpn + v) & UINT64_C(0x0101010101010101);
+                acc = (acc & UINT64_C(0x00ff00ff00ff00ff)) + ((acc >> 8) & UINT64_C(0x00ff00ff00ff00ff));
+                sum = (acc * UINT64_C(0x0001000100010001)) >> 48;
             }
-
-            cmkp += cmk_linesize * yhalf;
+            for (; v < end; v++)
+                sum += cmkpp[v] & cmkp[v] & cmkpn[v] & 1;
+            cellp[cx] += sum;
         }
+    }
 
-        VERTICAL_HALF(heighta, height - 1);
+    return 0;
+}
 
-        for (x = 0; x < arraysize; x++)
-            if (c_array[x] > max_v)
-                max_v = c_array[x];
+static int calc_combed_score(AVFilterContext *ctx, const AVFrame *src)
+{
+    FieldMatchContext *fm = ctx->priv;
+    const int nb_jobs = FFMIN(fm->ncelly, fm->nb_threads);
+    const int width  = src->width;
+    const int height = src->height;
+    const int xblocks = ((width + fm->blockx/2) / fm->blockx) + 1;
+    const int xblocks4 = xblocks << 2;
+    const int yblocks = ((height + fm->blocky/2) / fm->blocky) + 1;
+    const int arraysize = (xblocks * yblocks) << 2;
+    const int *cellp = fm->cell_array;
+    int *c_array = fm->c_array;
+    int max_v = 0;
+
+    ff_filter_execute(ctx, comb_mask_slice, (void *)src, NULL,
+                      FFMIN(AV_CEIL_RSHIFT(height, fm->vsub[INPUT_MAIN]), fm->nb_threads));
+    if (fm->chroma)
+        ff_filter_execute(ctx, comb_chroma_slice, (void *)src, NULL,
+                          FFMIN(AV_CEIL_RSHIFT(height, fm->vsub[INPUT_MAIN]), fm->nb_threads));
+    ff_filter_execute(ctx, comb_count_slice, (void *)src, NULL, nb_jobs);
+
+    /* every cell belongs to the block it starts in and to the blocks
+     * shifted by half a block horizontally and/or vertically */
+    memset(c_array, 0, arraysize * sizeof(*c_array));
+    for (int cy = 0; cy < fm->ncelly; cy++) {
+        const int temp1 = (cy >> 1) * xblocks4;
+        const int temp2 = ((cy + 1) >> 1) * xblocks4;
+
+        for (int cx = 0; cx < fm->ncellx; cx++) {
+            const int v = cellp[cx];
+            const int box1 = (cx >> 1) * 4;
+            const int box2 = ((cx + 1) >> 1) * 4;
+
+            if (!v)
+                continue;
+            c_array[temp1 + box1    ] += v;
+            c_array[temp1 + box2 + 1] += v;
+            c_array[temp2 + box1 + 2] += v;
+            c_array[temp2 + box2 + 3] += v;
+        }
+        cellp += fm->ncellx;
     }
+
+    for (int x = 0; x < arraysize; x++)
+        if (c_array[x] > max_v)
+            max_v = c_array[x];
     return max_v;
 }
 
 // the secret is that tbuffer is an interlaced, offset subset of all the lines
-static void build_abs_diff_mask(const uint8_t *prvp, int prv_linesize,
-                                const uint8_t *nxtp, int nxt_linesize,
-                                uint8_t *tbuffer,    int tbuf_linesize,
-                                int width, int height)
+static int abs_diff_mask_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    int y, x;
-
-    prvp -= prv_linesize;
-    nxtp -= nxt_linesize;
-    for (y = 0; y < height; y++) {
-        for (x = 0; x < width; x++)
+    const FieldMatchContext *fm = ctx->priv;
+    const CompareThreadData *td = arg;
+    const int tpitch = td->plane ? fm->tpitchuv : fm->tpitchy;
+    const int height = td->height >> 1;
+    const int slice_start = (height *  jobnr   ) / nb_jobs;
+    const int slice_end   = (height * (jobnr+1)) / nb_jobs;
+    const uint8_t *prvp = td->dprvp + (slice_start - 1) * (ptrdiff_t)td->prvf_linesize;
+    const uint8_t *nxtp = td->dnxtp + (slice_start - 1) * (ptrdiff_t)td->nxtf_linesize;
+    uint8_t *tbuffer = fm->tbuffer + slice_start * tpitch;
+
+    for (int y = slice_start; y < slice_end; y++) {
+        for (int x = 0; x < td->width; x++)
             tbuffer[x] = FFABS(prvp[x] - nxtp[x]);
-        prvp += prv_linesize;
-        nxtp += nxt_linesize;
-        tbuffer += tbuf_linesize;
+        prvp += td->prvf_linesize;
+        nxtp += td->nxtf_linesize;
+        tbuffer += tpitch;
     }
+
+    return 0;
 }
 
 /**
- * Build a map over which pixels differ a lot/a little
+ * Build one line of the map over which pixels differ a lot/a little
  */
-static void build_diff_map(FieldMatchContext *fm,
-                           const uint8_t *prvp, int prv_linesize,
-                           const uint8_t *nxtp, int nxt_linesize,
-                           uint8_t *dstp, int dst_linesize, int height,
-                           int width, int plane)
+static void build_diff_map_line(const FieldMatchContext *fm, const uint8_t *dp,
+                                uint8_t *dstp, int y, int height, int width,
+                                int plane)
 {
-    int x, y, u, diff, count;
-    int tpitch = plane ? fm->tpitchuv : fm->tpitchy;
-    const uint8_t *dp = fm->tbuffer + tpitch;
-
-    build_abs_diff_mask(prvp, prv_linesize, nxtp, nxt_linesize,
-                        fm->tbuffer, tpitch, width, height>>1);
-
-    for (y = 2; y < height - 2; y += 2) {
-        for (x = 1; x < width - 1; x++) {
-            diff = dp[x];
-            if (diff > 3) {
-                for (count = 0, u = x-1; u < x+2 && count < 2; u++) {
-                    count += dp[u-tpitch] > 3;
-                    count += dp[u       ] > 3;
-                    count += dp[u+tpitch] > 3;
-                }
-                if (count > 1) {
-                    dstp[x] = 1;
-                    if (diff > 19) {
-                        int upper = 0, lower = 0;
-                        for (count = 0, u = x-1; u < x+2 && count < 6; u++) {
-                            if (dp[u-tpitch] > 19) { count++; upper = 1; }
-                            if (dp[u       ] > 19)   count++;
-                            if (dp[u+tpitch] > 19) { count++; lower = 1; }
-                        }
-                        if (count > 3) {
-                            if (upper && lower) {
-                                dstp[x] |= 1<<1;
-                            } else {
-                                int upper2 = 0, lower2 = 0;
-                                for (u = FFMAX(x-4,0); u < FFMIN(x+5,width); u++) {
-                                    if (y != 2 &&        dp[u-2*tpitch] > 19) upper2 = 1;
-                                    if (                 dp[u-  tpitch] > 19) upper  = 1;
-                                    if (                 dp[u+  tpitch] > 19) lower  = 1;
-                                    if (y != height-4 && dp[u+2*tpitch] > 19) lower2 = 1;
-                                }
-                                if ((upper && (lower || upper2)) ||
-                                    (lower && (upper || lower2)))
-                                    dstp[x] |= 1<<1;
-                                else if (count > 5)
-                                    dstp[x] |= 1<<2;
+    const int tpitch = plane ? fm->tpitchuv : fm->tpitchy;
+    int x, u, diff, count;
+
+    for (x = 1; x < width - 1; x++) {
+        /* skip runs of 8 small differences at once */
+        if (x + 8 < width && !(AV_RN64(dp + x) & UINT64_C(0xfcfcfcfcfcfcfcfc))) {
+            x += 7;
+            continue;
+        }
+        diff = dp[x];
+        if (diff > 3) {
+            for (count = 0, u = x-1; u < x+2 && count < 2; u++) {
+                count += dp[u-tpitch] > 3;
+                count += dp[u       ] > 3;
+                count += dp[u+tpitch] > 3;
+            }
+            if (count > 1) {
+                dstp[x] = 1;
+                if (diff > 19) {
+                    int upper = 0, lower = 0;
+                    for (count = 0, u = x-1; u < x+2 && count < 6; u++) {
+                        if (dp[u-tpitch] > 19) { count++; upper = 1; }
+                        if (dp[u       ] > 19)   count++;
+                        if (dp[u+tpitch] > 19) { count++; lower = 1; }
+                    }
+                    if (count > 3) {
+                        if (upper && lower) {
+                            dstp[x] |= 1<<1;
+                        } else {
+                            int upper2 = 0, lower2 = 0;
+                            for (u = FFMAX(x-4,0); u < FFMIN(x+5,width); u++) {
+                                if (y != 2 &&        dp[u-2*tpitch] > 19) upper2 = 1;
+                                if (                 dp[u-  tpitch] > 19) upper  = 1;
+                                if (                 dp[u+  tpitch] > 19) lower  = 1;
+                                if (y != height-4 && dp[u+2*tpitch] > 19) lower2 = 1;
                             }
+                            if ((upper && (lower || upper2)) ||
+                                (lower && (upper || lower2)))
+                                dstp[x] |= 1<<1;
+                            else if (count > 5)
+                                dstp[x] |= 1<<2;
                         }
                     }
                 }
             }
         }
-        dp += tpitch;
-        dstp += dst_linesize;
     }
 }
 
+static int diff_map_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    const FieldMatchContext *fm = ctx->priv;
+    const CompareThreadData *td = arg;
+    const int tpitch = td->plane ? fm->tpitchuv : fm->tpitchy;
+    const int nb_lines = FFMAX(0, (td->height - 3) / 2);
+    const int slice_start = (nb_lines *  jobnr   ) / nb_jobs;
+    const int slice_end   = (nb_lines * (jobnr+1)) / nb_jobs;
+    const uint8_t *dp = fm->tbuffer + (slice_start + 1) * tpitch;
+    uint8_t *dmapp = td->dmapp + slice_start * td->map_linesize;
+
+    for (int i = slice_start; i < slice_end; i++) {
+        memset(dmapp, 0, td->width);
+        build_diff_map_line(fm, dp, dmapp, 2 + 2 * i, td->height, td->width, td->plane);
+        dmapp += td->map_linesize;
+        dp    += tpitch;
+    }
+
+    return 0;
+}
+
+static int compare_fields_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    FieldMatchContext *fm = ctx->priv;
+    const CompareThreadData *td = arg;
+    const int nb_lines = FFMAX(0, (td->height - 3) / 2);
+    const int slice_start = (nb_lines *  jobnr   ) / nb_jobs;
+    const int slice_end   = (nb_lines * (jobnr+1)) / nb_jobs;
+    const int map_linesize = td->map_linesize;
+    const int startx = td->startx;
+    const int stopx  = td->stopx;
+    const uint8_t *srcpf = td->srcpf + slice_start * (ptrdiff_t)td->srcf_linesize;
+    const uint8_t *srcf  = td->srcf  + slice_start * (ptrdiff_t)td->srcf_linesize;
+    const uint8_t *srcnf = td->srcnf + slice_start * (ptrdiff_t)td->srcf_linesize;
+    const uint8_t *prvpf = td->prvpf + slice_start * (ptrdiff_t)td->prvf_linesize;
+    const uint8_t *prvnf = td->prvnf + slice_start * (ptrdiff_t)td->prvf_linesize;
+    const uint8_t *nxtpf = td->nxtpf + slice_start * (ptrdiff_t)td->nxtf_linesize;
+    const uint8_t *nxtnf = td->nxtnf + slice_start * (ptrdiff_t)td->nxtf_linesize;
+    const uint8_t *mapp  = td->mapp  + slice_start * map_linesize;
+    uint64_t accumPc = 0, accumPm = 0, accumPml = 0;
+    uint64_t accumNc = 0, accumNm = 0, accumNml = 0;
+    int temp1, temp2;
+
+    for (int i = slice_start; i < slice_end; i++) {
+        const int y = 2 + 2 * i;
+
+        if (td->y0a == td->y1a || y < td->y0a || y > td->y1a) {
+            for (int x = startx; x < stopx; x++) {
+                int m;
+
+                /* skip runs of 8 unmarked pixels at once */
+                if (x + 8 <= stopx &&
+                    !(AV_RN64(mapp + x) | AV_RN64(mapp + x + map_linesize))) {
+                    x += 7;
+                    continue;
+                }
+                m = mapp[x] | mapp[x + map_linesize];
+                if (m) {
+                    temp1 = srcpf[x] + (srcf[x] << 2) + srcnf[x]; // [1 4 1]
+
+                    temp2 = abs(3 * (prvpf[x] + prvnf[x]) - temp1);
+                    if (temp2 > 23 && (m & 1))
+                        accumPc += temp2;
+                    if (temp2 > 42) {
+                        if (m & 2)
+                            accumPm += temp2;
+                        if (m & 4)
+                            accumPml += temp2;
+                    }
+
+                    temp2 = abs(3 * (nxtpf[x] + nxtnf[x]) - temp1);
+                    if (temp2 > 23 && (m & 1))
+                        accumNc += temp2;
+                    if (temp2 > 42) {
+                        if (m & 2)
+                            accumNm += temp2;
+                        if (m & 4)
+                            accumNml += temp2;
+                    }
+                }
+            }
+        }
+        prvpf += td->prvf_linesize;
+        prvnf += td->prvf_linesize;
+        srcpf += td->srcf_linesize;
+        srcf  += td->srcf_linesize;
+        srcnf += td->srcf_linesize;
+        nxtpf += td->nxtf_linesize;
+        nxtnf += td->nxtf_linesize;
+        mapp  += map_linesize;
+    }
+
+    fm->job_accum[jobnr][0] = accumPc;
+    fm->job_accum[jobnr][1] = accumPm;
+    fm->job_accum[jobnr][2] = accumPml;
+    fm->job_accum[jobnr][3] = accumNc;
+    fm->job_accum[jobnr][4] = accumNm;
+    fm->job_accum[jobnr][5] = accumNml;
+
+    return 0;
+}
+
 enum { mP, mC, mN, mB, mU };
 
 static int get_field_base(int match, int field)
@@ -486,8 +625,9 @@ static AVFrame *select_frame(FieldMatchContext *fm, int match)
     else  /* match == mC */              return fm->src;
 }
 
-static int compare_fields(FieldMatchContext *fm, int match1, int match2, int field)
+static int compare_fields(AVFilterContext *ctx, int match1, int match2, int field)
 {
+    FieldMatchContext *fm = ctx->priv;
     int plane, ret;
     uint64_t accumPc = 0, accumPm = 0, accumPml = 0;
     uint64_t accumNc = 0, accumNm = 0, accumNml = 0;
@@ -496,7 +636,8 @@ static int compare_fields(FieldMatchContext *fm, int match1, int match2, int fie
     const AVFrame *src = fm->src;
 
     for (plane = 0; plane < (fm->mchroma ? 3 : 1); plane++) {
-        int x, y, temp1, temp2, fbase;
+        CompareThreadData td;
+        int fbase, nb_lines, nb_jobs;
         const AVFrame *prev, *next;
         uint8_t *mapp    = fm->map_data[plane];
         int map_linesize = fm->map_linesize[plane];
@@ -507,15 +648,9 @@ static int compare_fields(FieldMatchContext *fm, int match1, int match2, int fie
         int prvf_linesize, nxtf_linesize;
         const int width  = get_width (fm, src, plane, INPUT_MAIN);
         const int height = get_height(fm, src, plane, INPUT_MAIN);
-        const int y0a = fm->y0 >> (plane ? fm->vsub[INPUT_MAIN] : 0);
-        const int y1a = fm->y1 >> (plane ? fm->vsub[INPUT_MAIN] : 0);
-        const int startx = (plane == 0 ? 8 : 8 >> fm->hsub[INPUT_MAIN]);
-        const int stopx  = width - startx;
         const uint8_t *srcpf, *srcf, *srcnf;
         const uint8_t *prvpf, *prvnf, *nxtpf, *nxtnf;
 
-        fill_buf(mapp, width, height, map_linesize, 0);
-
         /* match1 */
         fbase = get_field_base(match1, field);
         srcf  = srcp + (fbase + 1) * src_linesize;
@@ -537,49 +672,52 @@ static int compare_fields(FieldMatchContext *fm, int match1, int match2, int fie
         nxtnf = nxtpf + nxtf_linesize;                      // next frame, next     field
 
         map_linesize <<= 1;
-        if ((match1 >= 3 && field == 1) || (match1 < 3 && field != 1))
-            build_diff_map(fm, prvpf, prvf_linesize, nxtpf, nxtf_linesize,
-                           mapp, map_linesize, height, width, plane);
-        else
-            build_diff_map(fm, prvnf, prvf_linesize, nxtnf, nxtf_linesize,
-                           mapp + map_linesize, map_linesize, height, width, plane);
-
-        for (y = 2; y < height - 2; y += 2) {
-            if (y0a == y1a || y < y0a || y > y1a) {
-                for (x = startx; x < stopx; x++) {
-                    if (mapp[x] > 0 || mapp[x + map_linesize] > 0) {
-                        temp1 = srcpf[x] + (srcf[x] << 2) + srcnf[x]; // [1 4 1]
-
-                        temp2 = abs(3 * (prvpf[x] + prvnf[x]) - temp1);
-                        if (temp2 > 23 && ((mapp[x]&1) || (mapp[x + map_linesize]&1)))
-                            accumPc += temp2;
-                        if (temp2 > 42) {
-                            if ((mapp[x]&2) || (mapp[x + map_linesize]&2))
-                                accumPm += temp2;
-                            if ((mapp[x]&4) || (mapp[x + map_linesize]&4))
-                                accumPml += temp2;
-                        }
 
-                        temp2 = abs(3 * (nxtpf[x] + nxtnf[x]) - temp1);
-                        if (temp2 > 23 && ((mapp[x]&1) || (mapp[x + map_linesize]&1)))
-                            accumNc += temp2;
-                        if (temp2 > 42) {
-                            if ((mapp[x]&2) || (mapp[x + map_linesize]&2))
-                                accumNm += temp2;
-                            if ((mapp[x]&4) || (mapp[x + map_linesize]&4))
-                                accumNml += temp2;
-                        }
-                    }
-                }
-            }
-            prvpf += prvf_linesize;
-            prvnf += prvf_linesize;
-            srcpf += srcf_linesize;
-            srcf  += srcf_linesize;
-            srcnf += srcf_linesize;
-            nxtpf += nxtf_linesize;
-            nxtnf += nxtf_linesize;
-            mapp  += map_linesize;
+        td = (CompareThreadData) {
+            .srcpf = srcpf, .srcf  = srcf,  .srcnf = srcnf,
+            .prvpf = prvpf, .prvnf = prvnf,
+            .nxtpf = nxtpf, .nxtnf = nxtnf,
+            .mapp  = mapp,
+            .srcf_linesize = srcf_linesize,
+            .prvf_linesize = prvf_linesize,
+            .nxtf_linesize = nxtf_linesize,
+            .map_linesize  = map_linesize,
+            .width  = width,
+            .height = height,
+            .plane  = plane,
+            .startx = plane == 0 ? 8 : 8 >> fm->hsub[INPUT_MAIN],
+            .y0a    = fm->y0 >> (plane ? fm->vsub[INPUT_MAIN] : 0),
+            .y1a    = fm->y1 >> (plane ? fm->vsub[INPUT_MAIN] : 0),
+        };
+        td.stopx = width - td.startx;
+        if ((match1 >= 3 && field == 1) || (match1 < 3 && field != 1)) {
+            td.dprvp = prvpf;
+            td.dnxtp = nxtpf;
+            td.dmapp = mapp;
+        } else {
+            td.dprvp = prvnf;
+            td.dnxtp = nxtnf;
+            td.dmapp = mapp + map_linesize;
+        }
+
+        nb_lines = FFMAX(0, (height - 3) / 2);
+        nb_jobs  = FFMAX(1, FFMIN(nb_lines, fm->nb_threads));
+
+        /* every accumulated line also looks at the map line below it; the
+         * one of those that no diff map line lands on has to be cleared */
+        memset(td.dmapp == mapp ? mapp + nb_lines * map_linesize : mapp, 0, width);
+
+        ff_filter_execute(ctx, abs_diff_mask_slice, &td, NULL,
+                          FFMAX(1, FFMIN(height >> 1, fm->nb_threads)));
+        ff_filter_execute(ctx, diff_map_slice, &td, NULL, nb_jobs);
+        ff_filter_execute(ctx, compare_fields_slice, &td, NULL, nb_jobs);
+        for (int i = 0; i < nb_jobs; i++) {
+            accumPc  += fm->job_accum[i][0];
+            accumPm  += fm->job_accum[i][1];
+            accumPml += fm->job_accum[i][2];
+            accumNc  += fm->job_accum[i][3];
+            accumNm  += fm->job_accum[i][4];
+            accumNml += fm->job_accum[i][5];
         }
     }
 
@@ -659,7 +797,7 @@ static int checkmm(AVFilterContext *ctx, int *combs, int m1, int m2,
             gen_frames[mid] = create_weave_frame(ctx, mid, field,               \
                                                  fm->prv, fm->src, fm->nxt,     \
                                                  INPUT_MAIN);                   \
-        combs[mid] = calc_combed_score(fm, gen_frames[mid]);                    \
+        combs[mid] = calc_combed_score(ctx, gen_frames[mid]);                   \
     }                                                                           \
 } while (0)
 
@@ -734,7 +872,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
                 ret = AVERROR(ENOMEM);
                 goto fail;
             }
-            combs[i] = calc_combed_score(fm, gen_frames[i]);
+            combs[i] = calc_combed_score(ctx, gen_frames[i]);
         }
         av_log(ctx, AV_LOG_INFO, "COMBS: %3d %3d %3d %3d %3d\n",
                combs[0], combs[1], combs[2], combs[3], combs[4]);
@@ -747,22 +885,22 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     }
 
     /* p/c selection and optional 3-way p/c/n matches */
-    match = compare_fields(fm, fxo[mC], fxo[mP], field);
+    match = compare_fields(ctx, fxo[mC], fxo[mP], field);
     if (fm->mode == MODE_PCN || fm->mode == MODE_PCN_UB)
-        match = compare_fields(fm, match, fxo[mN], field);
+        match = compare_fields(ctx, match, fxo[mN], field);
 
     /* scene change check */
     if (fm->combmatch == COMBMATCH_SC) {
         if (fm->lastn == outl->frame_count_in - 1) {
             if (fm->lastscdiff > fm->scthresh)
                 sc = 1;
-        } else if (luma_abs_diff(fm->prv, fm->src) > fm->scthresh) {
+        } else if (luma_abs_diff(ctx, fm->prv, fm->src) > fm->scthresh) {
             sc = 1;
         }
 
         if (!sc) {
             fm->lastn = outl->frame_count_in;
-            fm->lastscdiff = luma_abs_diff(fm->src, fm->nxt);
+            fm->lastscdiff = luma_abs_diff(ctx, fm->src, fm->nxt);
             sc = fm->lastscdiff > fm->scthresh;
         }
     }
@@ -980,13 +1118,20 @@ static int config_input(AVFilterLink *inlink)
     }
 
     fm->tpitchy  = FFALIGN(w,      16);
-    fm->tpitchuv = FFALIGN(w >> 1, 16);
+    fm->tpitchuv = FFALIGN(AV_CEIL_RSHIFT(w, fm->hsub[INPUT_MAIN]), 16);
 
     fm->tbuffer = av_calloc((h/2 + 4) * fm->tpitchy, sizeof(*fm->tbuffer));
     fm->c_array = av_malloc_array((((w + fm->blockx/2)/fm->blockx)+1) *
                             (((h + fm->blocky/2)/fm->blocky)+1),
                             4 * sizeof(*fm->c_array));
-    if (!fm->tbuffer || !fm->c_array)
+    fm->ncellx = (w + fm->blockx/2 - 1) / (fm->blockx/2);
+    fm->ncelly = (h + fm->blocky/2 - 1) / (fm->blocky/2);
+    fm->cell_array = av_malloc_array(fm->ncellx * fm->ncelly, sizeof(*fm->cell_array));
+    fm->nb_threads = ff_filter_get_nb_threads(ctx);
+    fm->job_sad   = av_calloc(fm->nb_threads, sizeof(*fm->job_sad));
+    fm->job_accum = av_calloc(fm->nb_threads, sizeof(*fm->job_accum));
+    if (!fm->tbuffer || !fm->c_array || !fm->cell_array ||
+        !fm->job_sad || !fm->job_accum)
         return AVERROR(ENOMEM);
 
     return 0;
@@ -1044,6 +1189,9 @@ static av_cold void fieldmatch_uninit(AVFilterContext *ctx)
     av_freep(&fm->cmask_data[0]);
     av_freep(&fm->tbuffer);
     av_freep(&fm->c_array);
+    av_freep(&fm->cell_array);
+    av_freep(&fm->job_sad);
+    av_freep(&fm->job_accum);
 }
 
 static int config_output(AVFilterLink *outlink)
@@ -1084,5 +1232,5 @@ const AVFilter ff_vf_fieldmatch = {
     FILTER_OUTPUTS(fieldmatch_outputs),
     FILTER_QUERY_FUNC2(query_formats),
     .priv_class     = &fieldmatch_class,
-    .flags          = AVFILTER_FLAG_DYNAMIC_INPUTS,
+    .flags          = AVFILTER_FLAG_DYNAMIC_INPUTS | AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -21,6 +21,7 @@
 #include "config_components.h"
 
 #include "libavutil/colorspace.h"
+#include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "libavutil/parseutils.h"
 #include "libavutil/pixdesc.h"
@@ -37,6 +38,8 @@ typedef struct HistogramContext {
     int            envelope;
     int            slide;
     unsigned       histogram[256*256];
+    unsigned      *histograms;          ///< per-job histograms, merged into histogram
+    int            nb_jobs;
     int            histogram_size;
     int            width;
     int            x_pos;
@@ -174,7 +177,8 @@ static const uint8_t blue_gbrp_color[4]  = {   0,   0, 255, 255 };
 
 static int config_input(AVFilterLink *inlink)
 {
-    HistogramContext *s = inlink->dst->priv;
+    AVFilterContext *ctx = inlink->dst;
+    HistogramContext *s = ctx->priv;
     int rgb = 0;
 
     s->desc  = av_pix_fmt_desc_get(inlink->format);
@@ -182,6 +186,12 @@ static int config_input(AVFilterLink *inlink)
     s->histogram_size = 1 << s->desc->comp[0].depth;
     s->mult = s->histogram_size / 256;
 
+    s->nb_jobs = FFMAX(1, FFMIN(inlink->h, ff_filter_get_nb_threads(ctx)));
+    av_freep(&s->histograms);
+    s->histograms = av_calloc(s->nb_jobs, s->histogram_size * sizeof(*s->histograms));
+    if (!s->histograms)
+        return AVERROR(ENOMEM);
+
     switch (inlink->format) {
     case AV_PIX_FMT_GBRAP12:
     case AV_PIX_FMT_GBRP12:
@@ -344,12 +354,48 @@ static int config_output(AVFilterLink *outlink)
     return 0;
 }
 
+typedef struct ThreadData {
+    const AVFrame *in;
+    int plane;
+} ThreadData;
+
+static int count_histogram(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    HistogramContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const int p = td->plane;
+    const int width = s->planewidth[p];
+    const int slice_start = (s->planeheight[p] *  jobnr     ) / nb_jobs;
+    const int slice_end   = (s->planeheight[p] * (jobnr + 1)) / nb_jobs;
+    const ptrdiff_t linesize = td->in->linesize[p];
+    unsigned *histogram = s->histograms + jobnr * s->histogram_size;
+
+    memset(histogram, 0, s->histogram_size * sizeof(*histogram));
+
+    if (s->histogram_size <= 256) {
+        for (int i = slice_start; i < slice_end; i++) {
+            const uint8_t *src = td->in->data[p] + i * linesize;
+            for (int j = 0; j < width; j++)
+                histogram[src[j]]++;
+        }
+    } else {
+        for (int i = slice_start; i < slice_end; i++) {
+            const uint16_t *src = (const uint16_t *)(td->in->data[p] + i * linesize);
+            for (int j = 0; j < width; j++)
+                histogram[src[j]]++;
+        }
+    }
+
+    return 0;
+}
+
 static int filter_frame(AVFilterLink *inlink, AVFrame *in)
 {
     HistogramContext *s   = inlink->dst->priv;
     AVFilterContext *ctx  = inlink->dst;
     AVFilterLink *outlink = ctx->outputs[0];
     AVFrame *out = s->out;
+    ThreadData td;
     int i, j, k, l, m;
 
     if (!s->thistogram || !out) {
@@ -386,7 +432,6 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
         const int p = s->desc->comp[k].plane;
         const int max_value = s->histogram_size - 1 - s->start[p];
         const int height = s->planeheight[p];
-        const int width = s->planewidth[p];
         const int mid = s->mid;
         double max_hval_log;
         unsigned max_hval = 0;
@@ -402,18 +447,15 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
             starty = m++ * (s->level_height + s->scale_height) * (s->display_mode == 2);
         }
 
-        if (s->histogram_size <= 256) {
-            for (i = 0; i < height; i++) {
-                const uint8_t *src = in->data[p] + i * in->linesize[p];
-                for (j = 0; j < width; j++)
-                    s->histogram[src[j]]++;
-            }
-        } else {
-            for (i = 0; i < height; i++) {
-                const uint16_t *src = (const uint16_t *)(in->data[p] + i * in->linesize[p]);
-                for (j = 0; j < width; j++)
-                    s->histogram[src[j]]++;
-            }
+        td.in    = in;
+        td.plane = p;
+        ff_filter_execute(ctx, count_histogram, &td, NULL,
+                          FFMIN(height, s->nb_jobs));
+
+        for (j = 0; j < FFMIN(height, s->nb_jobs); j++) {
+            const unsigned *histogram = s->histograms + j * s->histogram_size;
+            for (i = 0; i < s->histogram_size; i++)
+                s->histogram[i] += histogram[i];
         }
 
         for (i = 0; i < s->histogram_size; i++)
@@ -579,6 +621,15 @@ static const AVFilterPad outputs[] = {
     },
 };
 
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    HistogramContext *s = ctx->priv;
+
+    av_freep(&s->histograms);
+    if (s->thistogram)
+        av_frame_free(&s->out);
+}
+
 #if CONFIG_HISTOGRAM_FILTER
 
 const AVFilter ff_vf_histogram = {
@@ -588,20 +639,15 @@ const AVFilter ff_vf_histogram = {
     FILTER_INPUTS(inputs),
     FILTER_OUTPUTS(outputs),
     FILTER_QUERY_FUNC2(query_formats),
+    .uninit        = uninit,
     .priv_class    = &histogram_class,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
 
 #endif /* CONFIG_HISTOGRAM_FILTER */
 
 #if CONFIG_THISTOGRAM_FILTER
 
-static av_cold void uninit(AVFilterContext *ctx)
-{
-    HistogramContext *s = ctx->priv;
-
-    av_frame_free(&s->out);
-}
-
 static const AVOption thistogram_options[] = {
     { "width", "set width", OFFSET(width), AV_OPT_TYPE_INT, {.i64=0}, 0, 8192, FLAGS},
     { "w",     "set width", OFFSET(width), AV_OPT_TYPE_INT, {.i64=0}, 0, 8192, FLAGS},
@@ -632,6 +678,7 @@ const AVFilter ff_vf_thistogram = {
     FILTER_QUERY_FUNC2(query_formats),
     .uninit        = uninit,
     .priv_class    = &thistogram_class,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
 
 #endif /* CONFIG_THISTOGRAM_FILTER */
@@ -29,9 +29,11 @@
 #include <libvmaf.h>
 
 #include "libavutil/avstring.h"
+#include "libavutil/fifo.h"
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
+#include "libavutil/thread.h"
 #include "avfilter.h"
 #include "drawutils.h"
 #include "filters.h"
@@ -46,6 +48,12 @@
 #include "libavutil/hwcontext_cuda_internal.h"
 #endif
 
+typedef struct VMAFJob {
+    AVFrame *ref;
+    AVFrame *dist;
+    unsigned index;
+} VMAFJob;
+
 typedef struct LIBVMAFContext {
     const AVClass *class;
     FFFrameSync fs;
@@ -61,6 +69,17 @@ typedef struct LIBVMAFContext {
     unsigned model_cnt;
     unsigned frame_cnt;
     unsigned bpc;
+    int async;
+    int queue_size;
+#if HAVE_THREADS
+    pthread_t worker;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    AVFifo *jobs;
+    int worker_started;
+    int worker_eof;
+    int worker_err;
+#endif
 #if CONFIG_LIBVMAF_CUDA_FILTER
     VmafCudaState *cu_state;
 #endif
@@ -77,6 +96,8 @@ static const AVOption libvmaf_options[] = {
     {"n_subsample", "Set interval for frame subsampling used when computing vmaf.",     OFFSET(n_subsample), AV_OPT_TYPE_INT, {.i64=1}, 1, UINT_MAX, FLAGS},
     {"model",  "Set the model to be used for computing vmaf.",                          OFFSET(model_cfg), AV_OPT_TYPE_STRING, {.str="version=vmaf_v0.6.1"}, 0, 1, FLAGS},
     {"feature",  "Set the feature to be used for computing vmaf.",                      OFFSET(feature_cfg), AV_OPT_TYPE_STRING, {.str=NULL}, 0, 1, FLAGS},
+    {"async", "Submit pictures to libvmaf from a background thread.",                   OFFSET(async), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, FLAGS},
+    {"queue_size", "Set the number of frame pairs queued for the background thread.",   OFFSET(queue_size), AV_OPT_TYPE_INT, {.i64=8}, 1, 1024, FLAGS},
     { NULL }
 };
 
@@ -126,26 +147,12 @@ static int copy_picture_data(AVFrame *src, VmafPicture *dst, unsigned bpc)
     return 0;
 }
 
-static int do_vmaf(FFFrameSync *fs)
+static int read_pictures(AVFilterContext *ctx, AVFrame *ref, AVFrame *dist,
+                         unsigned index)
 {
-    AVFilterContext *ctx = fs->parent;
     LIBVMAFContext *s = ctx->priv;
     VmafPicture pic_ref, pic_dist;
-    AVFrame *ref, *dist;
-    int err = 0;
-
-    int ret = ff_framesync_dualinput_get(fs, &dist, &ref);
-    if (ret < 0)
-        return ret;
-    if (ctx->is_disabled || !ref)
-        return ff_filter_frame(ctx->outputs[0], dist);
-
-    if (dist->color_range != ref->color_range) {
-        av_log(ctx, AV_LOG_WARNING, "distorted and reference "
-               "frames use different color ranges (%s != %s)\n",
-               av_color_range_name(dist->color_range),
-               av_color_range_name(ref->color_range));
-    }
+    int err;
 
     err = copy_picture_data(ref, &pic_ref, s->bpc);
     if (err) {
@@ -160,12 +167,169 @@ static int do_vmaf(FFFrameSync *fs)
         return AVERROR(ENOMEM);
     }
 
-    err = vmaf_read_pictures(s->vmaf, &pic_ref, &pic_dist, s->frame_cnt++);
+    err = vmaf_read_pictures(s->vmaf, &pic_ref, &pic_dist, index);
     if (err) {
         av_log(s, AV_LOG_ERROR, "problem during vmaf_read_pictures.\n");
         return AVERROR(EINVAL);
     }
 
+    return 0;
+}
+
+#if HAVE_THREADS
+/* The worker owns the libvmaf context while it runs: it copies the queued
+ * frame pairs into VmafPictures and hands them to libvmaf in order, so the
+ * filter thread only takes new references to the frames. */
+static void *vmaf_worker(void *arg)
+{
+    AVFilterContext *ctx = arg;
+    LIBVMAFContext *s = ctx->priv;
+
+    pthread_mutex_lock(&s->lock);
+    while (1) {
+        VMAFJob job;
+        int err;
+
+        while (!av_fifo_can_read(s->jobs) && !s->worker_eof)
+            pthread_cond_wait(&s->cond, &s->lock);
+        if (av_fifo_read(s->jobs, &job, 1) < 0)
+            break;
+        pthread_cond_broadcast(&s->cond);
+        pthread_mutex_unlock(&s->lock);
+
+        err = s->worker_err ? 0 : read_pictures(ctx, job.ref, job.dist, job.index);
+        av_frame_free(&job.ref);
+        av_frame_free(&job.dist);
+
+        pthread_mutex_lock(&s->lock);
+        if (err < 0)
+            s->worker_err = err;
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    return NULL;
+}
+
+static int queue_pictures(AVFilterContext *ctx, AVFrame *ref, AVFrame *dist)
+{
+    LIBVMAFContext *s = ctx->priv;
+    VMAFJob job = {
+        .ref   = av_frame_clone(ref),
+        .dist  = av_frame_clone(dist),
+        .index = s->frame_cnt,
+    };
+    int err;
+
+    if (!job.ref || !job.dist) {
+        av_frame_free(&job.ref);
+        av_frame_free(&job.dist);
+        return AVERROR(ENOMEM);
+    }
+
+    pthread_mutex_lock(&s->lock);
+    while (!av_fifo_can_write(s->jobs) && !s->worker_err)
+        pthread_cond_wait(&s->cond, &s->lock);
+    err = s->worker_err;
+    if (!err) {
+        av_fifo_write(s->jobs, &job, 1);
+        pthread_cond_broadcast(&s->cond);
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    if (err < 0) {
+        av_frame_free(&job.ref);
+        av_frame_free(&job.dist);
+        return err;
+    }
+
+    s->frame_cnt++;
+    return 0;
+}
+
+static void stop_worker(LIBVMAFContext *s)
+{
+    VMAFJob job;
+
+    if (s->worker_started) {
+        pthread_mutex_lock(&s->lock);
+        s->worker_eof = 1;
+        pthread_cond_broadcast(&s->cond);
+        pthread_mutex_unlock(&s->lock);
+        pthread_join(s->worker, NULL);
+        pthread_cond_destroy(&s->cond);
+        pthread_mutex_destroy(&s->lock);
+        s->worker_started = 0;
+    }
+
+    while (s->jobs && av_fifo_read(s->jobs, &job, 1) >= 0) {
+        av_frame_free(&job.ref);
+        av_frame_free(&job.dist);
+    }
+    av_fifo_freep2(&s->jobs);
+}
+
+static int start_worker(AVFilterContext *ctx)
+{
+    LIBVMAFContext *s = ctx->priv;
+    int ret;
+
+    s->jobs = av_fifo_alloc2(s->queue_size, sizeof(VMAFJob), 0);
+    if (!s->jobs)
+        return AVERROR(ENOMEM);
+
+    ret = pthread_mutex_init(&s->lock, NULL);
+    if (ret)
+        return AVERROR(ret);
+    ret = pthread_cond_init(&s->cond, NULL);
+    if (ret) {
+        pthread_mutex_destroy(&s->lock);
+        return AVERROR(ret);
+    }
+
+    ret = pthread_create(&s->worker, NULL, vmaf_worker, ctx);
+    if (ret) {
+        pthread_cond_destroy(&s->cond);
+        pthread_mutex_destroy(&s->lock);
+        av_log(ctx, AV_LOG_ERROR, "Failed to start the libvmaf thread.\n");
+        return AVERROR(ret);
+    }
+    s->worker_started = 1;
+
+    return 0;
+}
+#endif
+
+static int do_vmaf(FFFrameSync *fs)
+{
+    AVFilterContext *ctx = fs->parent;
+    LIBVMAFContext *s = ctx->priv;
+    AVFrame *ref, *dist;
+    int err = 0;
+
+    int ret = ff_framesync_dualinput_get(fs, &dist, &ref);
+    if (ret < 0)
+        return ret;
+    if (ctx->is_disabled || !ref)
+        return ff_filter_frame(ctx->outputs[0], dist);
+
+    if (dist->color_range != ref->color_range) {
+        av_log(ctx, AV_LOG_WARNING, "distorted and reference "
+               "frames use different color ranges (%s != %s)\n",
+               av_color_range_name(dist->color_range),
+               av_color_range_name(ref->color_range));
+    }
+
+#if HAVE_THREADS
+    if (s->worker_started)
+        err = queue_pictures(ctx, ref, dist);
+    else
+#endif
+        err = read_pictures(ctx, ref, dist, s->frame_cnt++);
+    if (err < 0) {
+        av_frame_free(&dist);
+        return err;
+    }
+
     return ff_filter_frame(ctx->outputs[0], dist);
 }
 
@@ -449,6 +613,16 @@ static av_cold int init(AVFilterContext *ctx)
     if (err)
         return err;
 
+    if (s->async) {
+#if HAVE_THREADS
+        err = start_worker(ctx);
+        if (err < 0)
+            return err;
+#else
+        av_log(ctx, AV_LOG_WARNING, "async requires threading support, ignoring.\n");
+#endif
+    }
+
     s->fs.on_event = do_vmaf;
     return 0;
 }
@@ -558,6 +732,10 @@ static av_cold void uninit(AVFilterContext *ctx)
 
     ff_framesync_uninit(&s->fs);
 
+#if HAVE_THREADS
+    stop_worker(s);
+#endif
+
     if (!s->frame_cnt)
         goto clean_up;
 
@@ -72,6 +72,16 @@ typedef struct LutContext {
     int is_planar;
     int is_16bit;
     int step;
+    int lut_size;
+
+    /* adjacent lut filters are fused: the downstream one applies both
+     * tables composed and the upstream one passes its frames through */
+    AVFilterContext *prev;      ///< upstream lut filter folded into this one
+    uint16_t (*fused)[256 * 256]; ///< lut composed with the table of prev
+    unsigned gen;               ///< bumped whenever the applied table changes
+    unsigned fused_gen;
+    int was_fused;
+    const uint16_t (*tab)[256 * 256]; ///< table applied to the current frame
 } LutContext;
 
 #define Y 0
@@ -110,6 +120,7 @@ static av_cold void uninit(AVFilterContext *ctx)
         s->comp_expr[i] = NULL;
         av_freep(&s->comp_expr_str[i]);
     }
+    av_freep(&s->fused);
 }
 
 #define YUV_FORMATS                                         \
@@ -227,6 +238,7 @@ static int config_props(AVFilterLink *inlink)
     s->var_values[VAR_W] = inlink->w;
     s->var_values[VAR_H] = inlink->h;
     s->is_16bit = desc->comp[0].depth > 8;
+    s->lut_size = 1 << desc->comp[0].depth;
 
     switch (inlink->format) {
     case AV_PIX_FMT_YUV410P:
@@ -334,10 +346,56 @@ static int config_props(AVFilterLink *inlink)
             av_log(ctx, AV_LOG_DEBUG, "val[%d][%d] = %d\n", comp, val, s->lut[comp][val]);
         }
     }
+    s->gen++;
+
+    /* fold a directly preceding lut filter into this one */
+    if (!s->prev && inlink->src->filter->priv_class == ctx->filter->priv_class &&
+        inlink->src->nb_outputs == 1) {
+        s->fused = av_malloc(sizeof(*s->fused) * 4);
+        if (!s->fused)
+            return AVERROR(ENOMEM);
+        s->prev = inlink->src;
+        av_log(ctx, AV_LOG_VERBOSE, "fusing with %s\n", s->prev->name);
+    }
 
     return 0;
 }
 
+static int is_fused(AVFilterContext *ctx)
+{
+    LutContext *s = ctx->priv;
+
+    /* with timeline support each table has to be applied on its own */
+    return s->prev && !ctx->enable_str && !s->prev->enable_str;
+}
+
+static const uint16_t (*get_table(AVFilterContext *ctx))[256 * 256]
+{
+    LutContext *s = ctx->priv;
+    int fused = is_fused(ctx);
+
+    if (fused != s->was_fused) {
+        s->was_fused = fused;
+        s->gen++;
+    }
+
+    if (fused) {
+        const uint16_t (*prev_tab)[256 * 256] = get_table(s->prev);
+        LutContext *p = s->prev->priv;
+
+        if (s->fused_gen != s->gen + p->gen) {
+            for (int c = 0; c < 4; c++)
+                for (int val = 0; val < s->lut_size; val++)
+                    s->fused[c][val] = s->lut[c][prev_tab[c][val]];
+            s->gen++;
+            s->fused_gen = s->gen + p->gen;
+        }
+        return (const uint16_t (*)[256 * 256])s->fused;
+    }
+
+    return (const uint16_t (*)[256 * 256])s->lut;
+}
+
 struct thread_data {
     AVFrame *in;
     AVFrame *out;
@@ -355,7 +413,7 @@ struct thread_data {
     const int h = td->h;\
     AVFrame *in = td->in;\
     AVFrame *out = td->out;\
-    const uint16_t (*tab)[256*256] = (const uint16_t (*)[256*256])s->lut;\
+    const uint16_t (*tab)[256*256] = s->tab;\
     const int step = s->step;\
 \
     const int slice_start = (h *  jobnr   ) / nb_jobs;\
@@ -439,7 +497,7 @@ static int lut_packed_8bits(AVFilterContext *ctx, void *arg, int jobnr, int nb_j
         int hsub = plane == 1 || plane == 2 ? s->hsub : 0;\
         int h = AV_CEIL_RSHIFT(td->h, vsub);\
         int w = AV_CEIL_RSHIFT(td->w, hsub);\
-        const uint16_t *tab = s->lut[plane];\
+        const uint16_t *tab = s->tab[plane];\
 \
         const int slice_start = (h *  jobnr   ) / nb_jobs;\
         const int slice_end   = (h * (jobnr+1)) / nb_jobs;\
@@ -524,9 +582,15 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     AVFilterContext *ctx = inlink->dst;
     LutContext *s = ctx->priv;
     AVFilterLink *outlink = ctx->outputs[0];
+    AVFilterContext *next = outlink->dst;
     AVFrame *out;
     int direct = 0;
 
+    if (next->filter->priv_class == ctx->filter->priv_class && is_fused(next))
+        return ff_filter_frame(outlink, in);
+
+    s->tab = get_table(ctx);
+
     if (av_frame_is_writable(in)) {
         direct = 1;
         out = in;
@@ -22,16 +22,18 @@
 #include <float.h>
 
 #include "libavutil/common.h"
+#include "libavutil/crc.h"
 #include "libavutil/file_open.h"
-#include "libavutil/float_dsp.h"
 #include "libavutil/imgutils.h"
 #include "libavutil/mem.h"
 #include "libavutil/mem_internal.h"
 #include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
+#include "libavutil/thread.h"
 #include "avfilter.h"
 #include "filters.h"
 #include "video.h"
+#include "vf_nnedidsp.h"
 
 static const size_t NNEDI_WEIGHTS_SIZE = 13574928;
 static const uint8_t NNEDI_XDIM[] = { 8, 16, 32, 48, 8, 16, 32 };
@@ -39,7 +41,8 @@ static const uint8_t NNEDI_YDIM[] = { 6, 6, 6, 6, 4, 4, 4 };
 static const uint16_t NNEDI_NNS[] = { 16, 32, 64, 128, 256 };
 
 typedef struct PrescreenerCoefficients {
-    DECLARE_ALIGNED(32, float, kernel_l0)[4][16 * 4];
+    /* 4 filters interleaved, the other lanes are zero */
+    DECLARE_ALIGNED(32, float, kernel_l0)[16 * 4][NNEDI_LANES];
     DECLARE_ALIGNED(32, float, bias_l0)[4];
 
     DECLARE_ALIGNED(32, float, kernel_l1)[4][4];
@@ -51,6 +54,8 @@ typedef struct PrescreenerCoefficients {
 
 typedef struct PredictorCoefficients {
     int xdim, ydim, nns, nsize;
+    /* filters of a quality are interleaved, softmax ones followed by
+     * elliott ones, and so are their biases */
     float *data;
     float *softmax_q1;
     float *elliott_q1;
@@ -62,6 +67,16 @@ typedef struct PredictorCoefficients {
     float *elliott_bias_q2;
 } PredictorCoefficients;
 
+typedef struct NNEDIWeights { /* read-only once loaded, shared between instances */
+    struct NNEDIWeights *next;
+    unsigned refcount;
+    char *filename;
+    uint32_t file_crc;
+
+    PrescreenerCoefficients prescreener[4];
+    PredictorCoefficients coeffs[2][5][7];
+} NNEDIWeights;
+
 typedef struct NNEDIContext {
     const AVClass *class;
 
@@ -71,7 +86,7 @@ typedef struct NNEDIContext {
     int eof;
     int64_t pts;
 
-    AVFloatDSPContext *fdsp;
+    NNEDIDSPContext dsp;
     int depth;
     int nb_planes;
     int nb_threads;
@@ -80,10 +95,8 @@ typedef struct NNEDIContext {
     int planeheight[4];
     int field_n;
 
-    PrescreenerCoefficients prescreener[4];
-    PredictorCoefficients coeffs[2][5][7];
+    NNEDIWeights *weights;
 
-    float half;
     float in_scale;
     float out_scale;
 
@@ -208,16 +221,14 @@ static const enum AVPixelFormat pix_fmts[] = {
     AV_PIX_FMT_NONE
 };
 
-static float dot_dsp(const NNEDIContext *const s, const float *kernel, const float *input,
-                     int n, float scale, float bias)
+static float dot(const float *kernel, const float *input, int n, float bias)
 {
-    float sum, y;
-
-    sum = s->fdsp->scalarproduct_float(kernel, input, n);
+    float sum = 0.f;
 
-    y = sum * scale + bias + 1e-20f;
+    for (int i = 0; i < n; i++)
+        sum += kernel[i] * input[i];
 
-    return y;
+    return sum + bias + 1e-20f;
 }
 
 static float elliott(float x)
@@ -243,25 +254,26 @@ static void process_old(AVFilterContext *ctx,
     const float *window = src_p - 2 * src_stride - 5;
 
     for (int j = 0; j < N; j++) {
-        LOCAL_ALIGNED_32(float, input, [48]);
-        float state[12];
+        float input[48];
+        float state[NNEDI_LANES + 8];
 
         for (int i = 0; i < 4; i++)
             memcpy(input + i * 12, window + i * src_stride + j, 12 * sizeof(float));
 
         // Layer 0.
+        s->dsp.dot(state, &m_data->kernel_l0[0][0], input, 48, NNEDI_LANES);
         for (int n = 0; n < 4; n++)
-            state[n] = dot_dsp(s, m_data->kernel_l0[n], input, 48, 1.0f, m_data->bias_l0[n]);
+            state[n] = state[n] + m_data->bias_l0[n] + 1e-20f;
         transform_elliott(state + 1, 3);
 
         // Layer 1.
         for (int n = 0; n < 4; n++)
-            state[n + 4] = dot_dsp(s, m_data->kernel_l1[n], state, 4, 1.0f, m_data->bias_l1[n]);
+            state[n + 4] = dot(m_data->kernel_l1[n], state, 4, m_data->bias_l1[n]);
         transform_elliott(state + 4, 3);
 
         // Layer 2.
         for (int n = 0; n < 4; n++)
-            state[n + 8] = dot_dsp(s, m_data->kernel_l2[n], state, 8, 1.0f, m_data->bias_l2[n]);
+            state[n + 8] = dot(m_data->kernel_l2[n], state, 8, m_data->bias_l2[n]);
 
         prescreen[j] = FFMAX(state[10], state[11]) <= FFMAX(state[8], state[9]) ? 255 : 0;
     }
@@ -279,53 +291,25 @@ static void process_new(AVFilterContext *ctx,
     const float *window = src_p - 2 * src_stride - 6;
 
     for (int j = 0; j < N; j += 4) {
-        LOCAL_ALIGNED_32(float, input, [64]);
-        float state[8];
+        float input[64];
+        float state[NNEDI_LANES + 4];
 
         for (int i = 0; i < 4; i++)
             memcpy(input + i * 16, window + i * src_stride + j, 16 * sizeof(float));
 
+        s->dsp.dot(state, &m_data->kernel_l0[0][0], input, 64, NNEDI_LANES);
         for (int n = 0; n < 4; n++)
-            state[n] = dot_dsp(s, m_data->kernel_l0[n], input, 64, 1.0f, m_data->bias_l0[n]);
+            state[n] = state[n] + m_data->bias_l0[n] + 1e-20f;
         transform_elliott(state, 4);
 
         for (int n = 0; n < 4; n++)
-            state[n + 4] = dot_dsp(s, m_data->kernel_l1[n], state, 4, 1.0f, m_data->bias_l1[n]);
+            state[n + 4] = dot(m_data->kernel_l1[n], state, 4, m_data->bias_l1[n]);
 
         for (int n = 0; n < 4; n++)
             prescreen[j + n] = state[n + 4] > 0.f;
     }
 }
 
-static int filter_offset(int nn, const PredictorCoefficients *const model)
-{
-    return nn * model->nsize;
-}
-
-static const float *softmax_q1_filter(int nn,
-                                      const PredictorCoefficients *const model)
-{
-    return model->softmax_q1 + filter_offset(nn, model);
-}
-
-static const float *elliott_q1_filter(int nn,
-                                      const PredictorCoefficients *const model)
-{
-    return model->elliott_q1 + filter_offset(nn, model);
-}
-
-static const float *softmax_q2_filter(int nn,
-                                      const PredictorCoefficients *const model)
-{
-    return model->softmax_q2 + filter_offset(nn, model);
-}
-
-static const float *elliott_q2_filter(int nn,
-                                      const PredictorCoefficients *const model)
-{
-    return model->elliott_q2 + filter_offset(nn, model);
-}
-
 static void gather_input(const float *src, ptrdiff_t src_stride,
                          float *buf, float mstd[4],
                          const PredictorCoefficients *const model)
@@ -373,6 +357,12 @@ static void transform_softmax_exp(float *input, int size)
         input[i] = softmax_exp(input[i]);
 }
 
+static void scale_bias(float *activation, const float *bias, int n, float scale)
+{
+    for (int i = 0; i < n; i++)
+        activation[i] = activation[i] * scale + bias[i] + 1e-20f;
+}
+
 static void wae5(const float *softmax, const float *el,
                  int n, float mstd[4])
 {
@@ -404,7 +394,7 @@ static void predictor(AVFilterContext *ctx,
     const int nns = model->nns;
 
     for (int i = 0; i < N; i++) {
-        LOCAL_ALIGNED_32(float, input, [48 * 6]);
+        float input[48 * 6];
         float activation[256 * 2];
         float mstd[4];
         float scale;
@@ -415,21 +405,15 @@ static void predictor(AVFilterContext *ctx,
         gather_input(window + i, src_stride, input, mstd, model);
         scale = mstd[2];
 
-        for (int nn = 0; nn < nns; nn++)
-            activation[nn] = dot_dsp(s, softmax_q1_filter(nn, model), input, filter_size, scale, model->softmax_bias_q1[nn]);
-
-        for (int nn = 0; nn < nns; nn++)
-            activation[nns + nn] = dot_dsp(s, elliott_q1_filter(nn, model), input, filter_size, scale, model->elliott_bias_q1[nn]);
+        s->dsp.dot(activation, model->softmax_q1, input, filter_size, 2 * nns);
+        scale_bias(activation, model->softmax_bias_q1, 2 * nns, scale);
 
         transform_softmax_exp(activation, nns);
         wae5(activation, activation + nns, nns, mstd);
 
         if (use_q2) {
-            for (int nn = 0; nn < nns; nn++)
-                activation[nn] = dot_dsp(s, softmax_q2_filter(nn, model), input, filter_size, scale, model->softmax_bias_q2[nn]);
-
-            for (int nn = 0; nn < nns; nn++)
-                activation[nns + nn] = dot_dsp(s, elliott_q2_filter(nn, model), input, filter_size, scale, model->elliott_bias_q2[nn]);
+            s->dsp.dot(activation, model->softmax_q2, input, filter_size, 2 * nns);
+            scale_bias(activation, model->softmax_bias_q2, 2 * nns, scale);
 
             transform_softmax_exp(activation, nns);
             wae5(activation, activation + nns, nns, mstd);
@@ -635,14 +619,14 @@ static int filter_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
             if (s->pscrn > 0)
                 s->prescreen[s->pscrn > 1](ctx, srcbuf + (y / 2) * srcbuf_stride + 32,
                              srcbuf_stride, prescreen_buf, width,
-                             &s->prescreener[s->pscrn - 1]);
+                             &s->weights->prescreener[s->pscrn - 1]);
 
             predictor(ctx,
                       srcbuf + (y / 2) * srcbuf_stride + 32,
                       srcbuf_stride,
                       dstbuf + (y / 2) * dstbuf_stride,
                       prescreen_buf, width,
-                      &s->coeffs[s->etype][s->nnsparam][s->nsize], s->qual == 2);
+                      &s->weights->coeffs[s->etype][s->nnsparam][s->nsize], s->qual == 2);
 
             if (s->pscrn > 0)
                 interpolation(srcbuf + (y / 2) * srcbuf_stride + 32,
@@ -792,77 +776,6 @@ static int allocate_model(PredictorCoefficients *coeffs, int xdim, int ydim, int
     return 0;
 }
 
-static int read_weights(AVFilterContext *ctx, const float *bdata)
-{
-    NNEDIContext *s = ctx->priv;
-    int ret;
-
-    copy_weights(&s->prescreener[0].kernel_l0[0][0], 4 * 48, &bdata);
-    copy_weights(s->prescreener[0].bias_l0, 4, &bdata);
-
-    copy_weights(&s->prescreener[0].kernel_l1[0][0], 4 * 4, &bdata);
-    copy_weights(s->prescreener[0].bias_l1, 4, &bdata);
-
-    copy_weights(&s->prescreener[0].kernel_l2[0][0], 4 * 8, &bdata);
-    copy_weights(s->prescreener[0].bias_l2, 4, &bdata);
-
-    for (int i = 0; i < 3; i++) {
-        PrescreenerCoefficients *data = &s->prescreener[i + 1];
-        float kernel_l0_shuffled[4 * 64];
-        float kernel_l1_shuffled[4 * 4];
-
-        copy_weights(kernel_l0_shuffled, 4 * 64, &bdata);
-        copy_weights(data->bias_l0, 4, &bdata);
-
-        copy_weights(kernel_l1_shuffled, 4 * 4, &bdata);
-        copy_weights(data->bias_l1, 4, &bdata);
-
-        for (int n = 0; n < 4; n++) {
-            for (int k = 0; k < 64; k++)
-                data->kernel_l0[n][k] = kernel_l0_shuffled[(k / 8) * 32 + n * 8 + k % 8];
-            for (int k = 0; k < 4; k++)
-                data->kernel_l1[n][k] = kernel_l1_shuffled[k * 4 + n];
-        }
-    }
-
-    for (int m = 0; m < 2; m++) {
-        // Grouping by neuron count.
-        for (int i = 0; i < 5; i++) {
-            const int nns = NNEDI_NNS[i];
-
-            // Grouping by window size.
-            for (int j = 0; j < 7; j++) {
-                PredictorCoefficients *model = &s->coeffs[m][i][j];
-                const int xdim = NNEDI_XDIM[j];
-                const int ydim = NNEDI_YDIM[j];
-                const int filter_size = xdim * ydim;
-
-                ret = allocate_model(model, xdim, ydim, nns);
-                if (ret < 0)
-                    return ret;
-
-                // Quality 1 model. NNS[i] * (XDIM[j] * YDIM[j]) * 2 coefficients.
-                copy_weights(model->softmax_q1, nns * filter_size, &bdata);
-                copy_weights(model->elliott_q1, nns * filter_size, &bdata);
-
-                // Quality 1 model bias. NNS[i] * 2 coefficients.
-                copy_weights(model->softmax_bias_q1, nns, &bdata);
-                copy_weights(model->elliott_bias_q1, nns, &bdata);
-
-                // Quality 2 model. NNS[i] * (XDIM[j] * YDIM[j]) * 2 coefficients.
-                copy_weights(model->softmax_q2, nns * filter_size, &bdata);
-                copy_weights(model->elliott_q2, nns * filter_size, &bdata);
-
-                // Quality 2 model bias. NNS[i] * 2 coefficients.
-                copy_weights(model->softmax_bias_q2, nns, &bdata);
-                copy_weights(model->elliott_bias_q2, nns, &bdata);
-            }
-        }
-    }
-
-    return 0;
-}
-
 static float mean(const float *input, int size)
 {
     float sum = 0.f;
@@ -879,21 +792,12 @@ static void transform(float *input, int size, float mean, float half)
         input[i] = (input[i] - mean) / half;
 }
 
-static void subtract_mean_old(PrescreenerCoefficients *coeffs, float half)
+static void subtract_mean_prescreener(float (*kernel)[64], int size, float half)
 {
     for (int n = 0; n < 4; n++) {
-        float m = mean(coeffs->kernel_l0[n], 48);
+        float m = mean(kernel[n], size);
 
-        transform(coeffs->kernel_l0[n], 48, m, half);
-    }
-}
-
-static void subtract_mean_new(PrescreenerCoefficients *coeffs, float half)
-{
-    for (int n = 0; n < 4; n++) {
-        float m = mean(coeffs->kernel_l0[n], 64);
-
-        transform(coeffs->kernel_l0[n], 64, m, half);
+        transform(kernel[n], size, m, half);
     }
 }
 
@@ -957,6 +861,190 @@ static void subtract_mean_predictor(PredictorCoefficients *model)
     }
 }
 
+static void interleave_filters(float *dst, const float *src, int stride,
+                               int size, int nb)
+{
+    for (int n = 0; n < nb; n++) {
+        float *w = dst + (n / NNEDI_LANES) * size * NNEDI_LANES + n % NNEDI_LANES;
+
+        for (int k = 0; k < size; k++)
+            w[k * NNEDI_LANES] = src[n * stride + k];
+    }
+}
+
+static void interleave_model(PredictorCoefficients *model, float *tmp)
+{
+    const int size = 2 * model->nns * model->nsize;
+
+    memcpy(tmp, model->softmax_q1, size * sizeof(*tmp));
+    interleave_filters(model->softmax_q1, tmp, model->nsize, model->nsize, 2 * model->nns);
+
+    memcpy(tmp, model->softmax_q2, size * sizeof(*tmp));
+    interleave_filters(model->softmax_q2, tmp, model->nsize, model->nsize, 2 * model->nns);
+}
+
+static int read_weights(NNEDIWeights *w, const float *bdata)
+{
+    const float half = ((1 << 8) - 1) / 2.f;
+    float (*kernel)[64];
+    float *tmp;
+    int ret = 0;
+
+    tmp = av_calloc(2 * 256 * 48 * 6, sizeof(*tmp));
+    if (!tmp)
+        return AVERROR(ENOMEM);
+    kernel = (float (*)[64])tmp;
+
+    /* the rows of the original prescreener are read with the stride of
+     * the new ones, the last one staying zero */
+    copy_weights(tmp, 4 * 48, &bdata);
+    subtract_mean_prescreener(kernel, 48, half);
+    interleave_filters(&w->prescreener[0].kernel_l0[0][0], tmp, 64, 48, 4);
+    copy_weights(w->prescreener[0].bias_l0, 4, &bdata);
+
+    copy_weights(&w->prescreener[0].kernel_l1[0][0], 4 * 4, &bdata);
+    copy_weights(w->prescreener[0].bias_l1, 4, &bdata);
+
+    copy_weights(&w->prescreener[0].kernel_l2[0][0], 4 * 8, &bdata);
+    copy_weights(w->prescreener[0].bias_l2, 4, &bdata);
+
+    for (int i = 0; i < 3; i++) {
+        PrescreenerCoefficients *data = &w->prescreener[i + 1];
+        float kernel_l0_shuffled[4 * 64];
+        float kernel_l1_shuffled[4 * 4];
+
+        copy_weights(kernel_l0_shuffled, 4 * 64, &bdata);
+        copy_weights(data->bias_l0, 4, &bdata);
+
+        copy_weights(kernel_l1_shuffled, 4 * 4, &bdata);
+        copy_weights(data->bias_l1, 4, &bdata);
+
+        for (int n = 0; n < 4; n++) {
+            for (int k = 0; k < 64; k++)
+                kernel[n][k] = kernel_l0_shuffled[(k / 8) * 32 + n * 8 + k % 8];
+            for (int k = 0; k < 4; k++)
+                data->kernel_l1[n][k] = kernel_l1_shuffled[k * 4 + n];
+        }
+
+        subtract_mean_prescreener(kernel, 64, half);
+        interleave_filters(&data->kernel_l0[0][0], tmp, 64, 64, 4);
+    }
+
+    for (int m = 0; m < 2; m++) {
+        // Grouping by neuron count.
+        for (int i = 0; i < 5; i++) {
+            const int nns = NNEDI_NNS[i];
+
+            // Grouping by window size.
+            for (int j = 0; j < 7; j++) {
+                PredictorCoefficients *model = &w->coeffs[m][i][j];
+                const int xdim = NNEDI_XDIM[j];
+                const int ydim = NNEDI_YDIM[j];
+                const int filter_size = xdim * ydim;
+
+                ret = allocate_model(model, xdim, ydim, nns);
+                if (ret < 0)
+                    goto fail;
+
+                // Quality 1 model. NNS[i] * (XDIM[j] * YDIM[j]) * 2 coefficients.
+                copy_weights(model->softmax_q1, nns * filter_size, &bdata);
+                copy_weights(model->elliott_q1, nns * filter_size, &bdata);
+
+                // Quality 1 model bias. NNS[i] * 2 coefficients.
+                copy_weights(model->softmax_bias_q1, nns, &bdata);
+                copy_weights(model->elliott_bias_q1, nns, &bdata);
+
+                // Quality 2 model. NNS[i] * (XDIM[j] * YDIM[j]) * 2 coefficients.
+                copy_weights(model->softmax_q2, nns * filter_size, &bdata);
+                copy_weights(model->elliott_q2, nns * filter_size, &bdata);
+
+                // Quality 2 model bias. NNS[i] * 2 coefficients.
+                copy_weights(model->softmax_bias_q2, nns, &bdata);
+                copy_weights(model->elliott_bias_q2, nns, &bdata);
+
+                subtract_mean_predictor(model);
+                interleave_model(model, tmp);
+            }
+        }
+    }
+
+fail:
+    av_free(tmp);
+    return ret;
+}
+
+static AVMutex weights_cache_lock = AV_MUTEX_INITIALIZER;
+static NNEDIWeights *weights_cache;
+
+static void free_weights(NNEDIWeights *w)
+{
+    for (int i = 0; i < 2; i++) {
+        for (int j = 0; j < 5; j++) {
+            for (int k = 0; k < 7; k++)
+                av_freep(&w->coeffs[i][j][k].data);
+        }
+    }
+
+    av_freep(&w->filename);
+    av_free(w);
+}
+
+static void release_weights(NNEDIWeights *weights)
+{
+    if (!weights)
+        return;
+
+    ff_mutex_lock(&weights_cache_lock);
+    if (!--weights->refcount) {
+        for (NNEDIWeights **w = &weights_cache; *w; w = &(*w)->next) {
+            if (*w == weights) {
+                *w = weights->next;
+                break;
+            }
+        }
+        free_weights(weights);
+    }
+    ff_mutex_unlock(&weights_cache_lock);
+}
+
+static int open_weights(AVFilterContext *ctx, const float *bdata)
+{
+    NNEDIContext *s = ctx->priv;
+    const uint32_t crc = av_crc(av_crc_get_table(AV_CRC_32_IEEE), 0,
+                                (const uint8_t *)bdata, NNEDI_WEIGHTS_SIZE);
+    NNEDIWeights *w;
+    int ret = 0;
+
+    /* parsing the weights is slow and they are never modified afterwards,
+     * so they are shared by all instances using the same unchanged file */
+    ff_mutex_lock(&weights_cache_lock);
+    for (w = weights_cache; w; w = w->next) {
+        if (!strcmp(w->filename, s->weights_file) && w->file_crc == crc)
+            break;
+    }
+    if (w) {
+        w->refcount++;
+    } else if (!(w = av_mallocz(sizeof(*w)))) {
+        ret = AVERROR(ENOMEM);
+    } else if (!(w->filename = av_strdup(s->weights_file)) ||
+               (ret = read_weights(w, bdata)) < 0) {
+        free_weights(w);
+        ret = ret < 0 ? ret : AVERROR(ENOMEM);
+    } else {
+        w->file_crc = crc;
+        w->refcount = 1;
+        w->next = weights_cache;
+        weights_cache = w;
+    }
+    ff_mutex_unlock(&weights_cache_lock);
+    if (ret < 0)
+        return ret;
+
+    s->weights = w;
+
+    return 0;
+}
+
 static av_cold int init(AVFilterContext *ctx)
 {
     NNEDIContext *s = ctx->priv;
@@ -1012,15 +1100,9 @@ static av_cold int init(AVFilterContext *ctx)
 
     fclose(weights_file);
 
-    s->fdsp = avpriv_float_dsp_alloc(0);
-    if (!s->fdsp) {
-        ret = AVERROR(ENOMEM);
-        goto fail;
-    }
+    ff_nnedi_init(&s->dsp);
 
-    ret = read_weights(ctx, bdata);
-    if (ret < 0)
-        goto fail;
+    ret = open_weights(ctx, bdata);
 
 fail:
     av_free(bdata);
@@ -1045,7 +1127,6 @@ static int config_input(AVFilterLink *inlink)
     s->planeheight[1] = s->planeheight[2] = AV_CEIL_RSHIFT(inlink->h, desc->log2_chroma_h);
     s->planeheight[0] = s->planeheight[3] = inlink->h;
 
-    s->half = ((1 << 8) - 1) / 2.f;
     s->out_scale = 1 << (s->depth - 8);
     s->in_scale = 1.f / s->out_scale;
 
@@ -1060,21 +1141,9 @@ static int config_input(AVFilterLink *inlink)
         break;
     }
 
-    subtract_mean_old(&s->prescreener[0], s->half);
-    subtract_mean_new(&s->prescreener[1], s->half);
-    subtract_mean_new(&s->prescreener[2], s->half);
-    subtract_mean_new(&s->prescreener[3], s->half);
-
     s->prescreen[0] = process_old;
     s->prescreen[1] = process_new;
 
-    for (int i = 0; i < 2; i++) {
-        for (int j = 0; j < 5; j++) {
-            for (int k = 0; k < 7; k++)
-                subtract_mean_predictor(&s->coeffs[i][j][k]);
-        }
-    }
-
     s->input_size = (s->planewidth[0] + 64) * (s->planeheight[0] + 6);
     s->input_buf = av_calloc(s->nb_threads, sizeof(*s->input_buf));
     if (!s->input_buf)
@@ -1127,15 +1196,8 @@ static av_cold void uninit(AVFilterContext *ctx)
         av_freep(&s->output_buf[i]);
 
     av_freep(&s->output_buf);
-    av_freep(&s->fdsp);
 
-    for (int i = 0; i < 2; i++) {
-        for (int j = 0; j < 5; j++) {
-            for (int k = 0; k < 7; k++) {
-                av_freep(&s->coeffs[i][j][k].data);
-            }
-        }
-    }
+    release_weights(s->weights);
 
     av_frame_free(&s->prev);
 }
@@ -0,0 +1,70 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFILTER_NNEDIDSP_H
+#define AVFILTER_NNEDIDSP_H
+
+#include "config.h"
+#include "libavutil/attributes.h"
+
+/**
+ * Number of filters whose coefficients are interleaved together.
+ */
+#define NNEDI_LANES 8
+
+/**
+ * Neuron kernels of the nnedi filter.
+ *
+ * Filters are stored in groups of NNEDI_LANES, coefficient k of filter n
+ * of a group being at w[k * NNEDI_LANES + n], and the groups follow each
+ * other. Implementations may accumulate the products in any order.
+ *
+ * The weights must be 32-byte aligned, other pointers need no alignment.
+ */
+typedef struct NNEDIDSPContext {
+    /**
+     * Compute the scalar products of x with nb filters.
+     *
+     * @param len number of coefficients of a filter, a multiple of 4
+     * @param nb  number of filters, a multiple of NNEDI_LANES
+     */
+    void (*dot)(float *sum, const float *w, const float *x, int len, int nb);
+} NNEDIDSPContext;
+
+static void dot_c(float *sum, const float *w, const float *x, int len, int nb)
+{
+    for (int n = 0; n < nb; n += NNEDI_LANES) {
+        for (int i = 0; i < NNEDI_LANES; i++) {
+            float s = 0.f;
+
+            for (int k = 0; k < len; k++)
+                s += w[k * NNEDI_LANES + i] * x[k];
+
+            sum[n + i] = s;
+        }
+
+        w += len * NNEDI_LANES;
+    }
+}
+
+static av_unused void ff_nnedi_init(NNEDIDSPContext *dsp)
+{
+    dsp->dot = dot_c;
+}
+
+#endif /* AVFILTER_NNEDIDSP_H */
@@ -32,6 +32,7 @@
 #include "libavutil/avstring.h"
 #include "libavutil/pixdesc.h"
 #include "libavutil/imgutils.h"
+#include "libavutil/intreadwrite.h"
 #include "libavutil/mathematics.h"
 #include "libavutil/opt.h"
 #include "libavutil/timestamp.h"
@@ -358,6 +359,45 @@ static int config_output(AVFilterLink *outlink)
 // (((x) << 16) - ((x) << 9) + (x)) is a faster version of: 255 * 255 * x
 // ((((x) + (y)) << 8) - ((x) + (y)) - (y) * (x)) is a faster version of: 255 * (x + y)
 #define UNPREMULTIPLY_ALPHA(x, y) ((((x) << 16) - ((x) << 9) + (x)) / ((((x) + (y)) << 8) - ((x) + (y)) - (y) * (x)))
+// same as above for an arbitrary maximum alpha value
+#define UNPREMULTIPLY_ALPHA_MAX(x, y, max) ((max) * (max) * (x) / ((max) * ((x) + (y)) - (y) * (x)))
+
+/**
+ * Find the span of pixels with a non-zero alpha in one overlay row.
+ * Only the bytes selected by mask (repeating every 8 bytes) are tested,
+ * so runs of fully transparent pixels are skipped 8 bytes at a time.
+ *
+ * @param p     start of the row
+ * @param size  number of bytes to scan
+ * @param mask  alpha byte mask, in little-endian byte order
+ * @param shift log2 of the number of bytes per pixel
+ * @param lo    set to the first pixel with a non-zero alpha
+ * @param hi    set past the last pixel with a non-zero alpha, hi <= lo if
+ *              the whole row is transparent
+ */
+static av_always_inline void alpha_span(const uint8_t *p, int size, uint64_t mask,
+                                        int shift, int *lo, int *hi)
+{
+#define ALPHA_BYTE(b) (p[b] & (mask >> (8 * ((b) & 7))) & 0xff)
+    int b = 0, e = size;
+
+    while (b + 8 <= e && !(AV_RL64(p + b) & mask))
+        b += 8;
+    while (b < e && !ALPHA_BYTE(b))
+        b++;
+    while (e > b && (e & 7) && !ALPHA_BYTE(e - 1))
+        e--;
+    if (!(e & 7)) {
+        while (e - 8 >= b && !(AV_RL64(p + e - 8) & mask))
+            e -= 8;
+        while (e > b && !ALPHA_BYTE(e - 1))
+            e--;
+    }
+#undef ALPHA_BYTE
+
+    *lo = b >> shift;
+    *hi = (e + (1 << shift) - 1) >> shift;
+}
 
 /**
  * Blend image in src to destination buffer dst at position (x, y).
@@ -398,11 +438,20 @@ static av_always_inline void blend_slice_packed_rgb(AVFilterContext *ctx,
     dp = dst->data[0] + (y + slice_start) * dst->linesize[0];
 
     for (i = slice_start; i < slice_end; i++) {
+        int lo, hi;
+
         j = FFMAX(-x, 0);
+        jmax = FFMIN(-x + dst_w, src_w);
+
+        /* transparent pixels leave the main picture untouched */
+        alpha_span(sp + j * sstep, (jmax - j) * sstep,
+                   0xffULL << (8 * sa) | 0xffULL << (8 * (sa + 4)), 2, &lo, &hi);
+        jmax = j + hi;
+        j   += lo;
         S = sp + j     * sstep;
         d = dp + (x+j) * dstep;
 
-        for (jmax = FFMIN(-x + dst_w, src_w); j < jmax; j++) {
+        for (; j < jmax; j++) {
             alpha = S[sa];
 
             // if the main channel has an alpha channel, alpha has to be calculated
@@ -479,6 +528,8 @@ static av_always_inline void blend_plane_##depth##_##nbits##bits(AVFilterContext
     const uint##depth##_t max = (1 << nbits) - 1;                                                          \
     const uint##depth##_t mid = (1 << (nbits -1)) ;                                                        \
     int bytes = depth / 8;                                                                                 \
+    const ptrdiff_t alinesize  = src->linesize[3] / bytes;                                                 \
+    const ptrdiff_t dalinesize = dst->linesize[3] / bytes;                                                 \
                                                                                                            \
     dst_step /= bytes;                                                                                     \
     j = FFMAX(-yp, 0);                                                                                     \
@@ -502,7 +553,33 @@ static av_always_inline void blend_plane_##depth##_##nbits##bits(AVFilterContext
         da = dap + ((xp+k) << hsub);                                                                       \
         kmax = FFMIN(-xp + dst_wp, src_wp);                                                                \
                                                                                                            \
-        if (nbits == 8 && ((vsub && j+1 < src_hp) || !vsub) && octx->blend_row[i]) {                       \
+        /* with straight alpha, transparent pixels leave the main picture untouched */                     \
+        if (straight && k < kmax) {                                                                        \
+            const uint8_t *arow = (const uint8_t *)(ap + (k << hsub));                                     \
+            int asize = (FFMIN(kmax << hsub, src_w) - (k << hsub)) * bytes;                                \
+            int lo, hi, lo2, hi2;                                                                          \
+                                                                                                           \
+            alpha_span(arow, asize, UINT64_MAX, bytes - 1, &lo, &hi);                                      \
+            if (vsub && j+1 < src_hp && (j << vsub) + 1 < src_h) {                                         \
+                alpha_span(arow + src->linesize[3], asize, UINT64_MAX, bytes - 1, &lo2, &hi2);             \
+                if (hi2 > lo2) {                                                                           \
+                    lo = hi > lo ? FFMIN(lo, lo2) : lo2;                                                   \
+                    hi = FFMAX(hi, hi2);                                                                   \
+                }                                                                                          \
+            }                                                                                              \
+            if (hi > lo) {                                                                                 \
+                kmax = FFMIN(kmax, k + ((hi - 1) >> hsub) + 1);                                            \
+                k   += lo >> hsub;                                                                         \
+            } else {                                                                                       \
+                kmax = k;                                                                                  \
+            }                                                                                              \
+            d = dp + (xp+k) * dst_step;                                                                    \
+            s = sp + k;                                                                                    \
+            a = ap + (k<<hsub);                                                                            \
+            da = dap + ((xp+k) << hsub);                                                                   \
+        }                                                                                                  \
+                                                                                                           \
+        if (nbits == 8 && k < kmax && ((vsub && j+1 < src_hp) || !vsub) && octx->blend_row[i]) {           \
             int c = octx->blend_row[i]((uint8_t*)d, (uint8_t*)da, (uint8_t*)s,                             \
                     (uint8_t*)a, kmax - k, src->linesize[3]);                                              \
                                                                                                            \
@@ -517,13 +594,13 @@ static av_always_inline void blend_plane_##depth##_##nbits##bits(AVFilterContext
                                                                                                            \
             /* average alpha for color components, improve quality */                                      \
             if (hsub && vsub && j+1 < src_hp && k+1 < src_wp) {                                            \
-                alpha = (a[0] + a[src->linesize[3]] +                                                      \
-                         a[1] + a[src->linesize[3]+1]) >> 2;                                               \
+                alpha = (a[0] + a[alinesize] +                                                             \
+                         a[1] + a[alinesize+1]) >> 2;                                                      \
             } else if (hsub || vsub) {                                                                     \
                 alpha_h = hsub && k+1 < src_wp ?                                                           \
                     (a[0] + a[1]) >> 1 : a[0];                                                             \
                 alpha_v = vsub && j+1 < src_hp ?                                                           \
-                    (a[0] + a[src->linesize[3]]) >> 1 : a[0];                                              \
+                    (a[0] + a[alinesize]) >> 1 : a[0];                                                     \
                 alpha = (alpha_v + alpha_h) >> 1;                                                          \
             } else                                                                                         \
                 alpha = a[0];                                                                              \
@@ -531,19 +608,20 @@ static av_always_inline void blend_plane_##depth##_##nbits##bits(AVFilterContext
             /* to create an un-premultiplied (straight) alpha value */                                     \
             if (main_has_alpha && alpha != 0 && alpha != max) {                                            \
                 /* average alpha for color components, improve quality */                                  \
-                uint8_t alpha_d;                                                                           \
+                int alpha_d;                                                                               \
                 if (hsub && vsub && j+1 < src_hp && k+1 < src_wp) {                                        \
-                    alpha_d = (da[0] + da[dst->linesize[3]] +                                              \
-                               da[1] + da[dst->linesize[3]+1]) >> 2;                                       \
+                    alpha_d = (da[0] + da[dalinesize] +                                                    \
+                               da[1] + da[dalinesize+1]) >> 2;                                             \
                 } else if (hsub || vsub) {                                                                 \
                     alpha_h = hsub && k+1 < src_wp ?                                                       \
                         (da[0] + da[1]) >> 1 : da[0];                                                      \
                     alpha_v = vsub && j+1 < src_hp ?                                                       \
-                        (da[0] + da[dst->linesize[3]]) >> 1 : da[0];                                       \
+                        (da[0] + da[dalinesize]) >> 1 : da[0];                                             \
                     alpha_d = (alpha_v + alpha_h) >> 1;                                                    \
                 } else                                                                                     \
                     alpha_d = da[0];                                                                       \
-                alpha = UNPREMULTIPLY_ALPHA(alpha, alpha_d);                                               \
+                alpha = nbits > 8 ? UNPREMULTIPLY_ALPHA_MAX(alpha, alpha_d, max) :                         \
+                                    UNPREMULTIPLY_ALPHA(alpha, alpha_d);                                   \
             }                                                                                              \
             if (straight) {                                                                                \
                 if (nbits > 8)                                                                             \
@@ -609,8 +687,9 @@ static inline void alpha_composite_##depth##_##nbits##bits(const AVFrame *src, c
         for (jmax = FFMIN(-x + dst_w, src_w); j < jmax; j++) {                                             \
             alpha = *s;                                                                                    \
             if (alpha != 0 && alpha != max) {                                                              \
-                uint8_t alpha_d = *d;                                                                      \
-                alpha = UNPREMULTIPLY_ALPHA(alpha, alpha_d);                                               \
+                int alpha_d = *d;                                                                          \
+                alpha = nbits > 8 ? UNPREMULTIPLY_ALPHA_MAX(alpha, alpha_d, max) :                         \
+                                    UNPREMULTIPLY_ALPHA(alpha, alpha_d);                                   \
             }                                                                                              \
             if (alpha == max)                                                                              \
                 *d = *s;                                                                                   \
@@ -727,6 +806,12 @@ DEFINE_BLEND_SLICE_PLANAR_FMT(yuv444_pm,   yuv_8_8bits,   0, 0, 0, 0);
 DEFINE_BLEND_SLICE_PLANAR_FMT(yuva444_pm,  yuv_8_8bits,   0, 0, 1, 0);
 DEFINE_BLEND_SLICE_PLANAR_FMT(gbrp_pm,     planar_rgb,    0, 0, 0, 0);
 DEFINE_BLEND_SLICE_PLANAR_FMT(gbrap_pm,    planar_rgb,    0, 0, 1, 0);
+DEFINE_BLEND_SLICE_PLANAR_FMT(yuv420p10_pm,  yuv_16_10bits, 1, 1, 0, 0);
+DEFINE_BLEND_SLICE_PLANAR_FMT(yuva420p10_pm, yuv_16_10bits, 1, 1, 1, 0);
+DEFINE_BLEND_SLICE_PLANAR_FMT(yuv422p10_pm,  yuv_16_10bits, 1, 0, 0, 0);
+DEFINE_BLEND_SLICE_PLANAR_FMT(yuva422p10_pm, yuv_16_10bits, 1, 0, 1, 0);
+DEFINE_BLEND_SLICE_PLANAR_FMT(yuv444p10_pm,  yuv_16_10bits, 0, 0, 0, 0);
+DEFINE_BLEND_SLICE_PLANAR_FMT(yuva444p10_pm, yuv_16_10bits, 0, 0, 1, 0);
 
 #define DEFINE_BLEND_SLICE_PACKED_FMT(format_, blend_slice_fn_suffix_, main_has_alpha_, direct_) \
 static int blend_slice_##format_(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)        \
@@ -829,12 +914,21 @@ static int config_input_main(AVFilterLink *inlink)
     case OVERLAY_FORMAT_YUV420:
         s->blend_slice = s->main_has_alpha ? blend_slice_yuva420_pm : blend_slice_yuv420_pm;
         break;
+    case OVERLAY_FORMAT_YUV420P10:
+        s->blend_slice = s->main_has_alpha ? blend_slice_yuva420p10_pm : blend_slice_yuv420p10_pm;
+        break;
     case OVERLAY_FORMAT_YUV422:
         s->blend_slice = s->main_has_alpha ? blend_slice_yuva422_pm : blend_slice_yuv422_pm;
         break;
+    case OVERLAY_FORMAT_YUV422P10:
+        s->blend_slice = s->main_has_alpha ? blend_slice_yuva422p10_pm : blend_slice_yuv422p10_pm;
+        break;
     case OVERLAY_FORMAT_YUV444:
         s->blend_slice = s->main_has_alpha ? blend_slice_yuva444_pm : blend_slice_yuv444_pm;
         break;
+    case OVERLAY_FORMAT_YUV444P10:
+        s->blend_slice = s->main_has_alpha ? blend_slice_yuva444p10_pm : blend_slice_yuv444p10_pm;
+        break;
     case OVERLAY_FORMAT_RGB:
         s->blend_slice = s->main_has_alpha ? blend_slice_rgba_pm : blend_slice_rgb_pm;
         break;
@@ -846,12 +940,21 @@ static int config_input_main(AVFilterLink *inlink)
         case AV_PIX_FMT_YUVA420P:
             s->blend_slice = blend_slice_yuva420_pm;
             break;
+        case AV_PIX_FMT_YUVA420P10:
+            s->blend_slice = blend_slice_yuva420p10_pm;
+            break;
         case AV_PIX_FMT_YUVA422P:
             s->blend_slice = blend_slice_yuva422_pm;
             break;
+        case AV_PIX_FMT_YUVA422P10:
+            s->blend_slice = blend_slice_yuva422p10_pm;
+            break;
         case AV_PIX_FMT_YUVA444P:
             s->blend_slice = blend_slice_yuva444_pm;
             break;
+        case AV_PIX_FMT_YUVA444P10:
+            s->blend_slice = blend_slice_yuva444p10_pm;
+            break;
         case AV_PIX_FMT_ARGB:
         case AV_PIX_FMT_RGBA:
         case AV_PIX_FMT_BGRA:
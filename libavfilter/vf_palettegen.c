@@ -57,6 +57,7 @@ struct range_box {
 struct hist_node {
     struct color_ref *entries;
     int nb_entries;
+    int nb_allocated;
 };
 
 enum {
@@ -77,6 +78,9 @@ typedef struct PaletteGenContext {
 
     AVFrame *prev_frame;                    // previous frame used for the diff stats_mode
     struct hist_node histogram[HIST_SIZE];  // histogram/hashtable of the colors
+    struct hist_node (*slice_histograms)[HIST_SIZE]; // histograms of the slices other than the first
+    int *slice_ret;                         // return values of the slice jobs
+    int nb_threads;
     struct color_ref **refs;                // references of all the colors used in the stream
     int nb_refs;                            // number of color references (or number of different colors)
     struct range_box boxes[256];            // define the segmentation of the colorspace (the final palette)
@@ -391,6 +395,20 @@ static AVFrame *get_palette_frame(AVFilterContext *ctx)
     return out;
 }
 
+static struct color_ref *hist_node_add(struct hist_node *node)
+{
+    if (node->nb_entries >= node->nb_allocated) {
+        const int nb_allocated = FFMAX(2 * node->nb_allocated, 4);
+        struct color_ref *entries = av_realloc_array(node->entries, nb_allocated,
+                                                     sizeof(*entries));
+        if (!entries)
+            return NULL;
+        node->entries      = entries;
+        node->nb_allocated = nb_allocated;
+    }
+    return &node->entries[node->nb_entries++];
+}
+
 /**
  * Locate the color in the hash table and increment its counter.
  */
@@ -408,8 +426,7 @@ static int color_inc(struct hist_node *hist, uint32_t color)
         }
     }
 
-    e = av_dynarray2_add((void**)&node->entries, &node->nb_entries,
-                         sizeof(*node->entries), NULL);
+    e = hist_node_add(node);
     if (!e)
         return AVERROR(ENOMEM);
     e->color = color;
@@ -422,11 +439,12 @@ static int color_inc(struct hist_node *hist, uint32_t color)
  * Update histogram when pixels differ from previous frame.
  */
 static int update_histogram_diff(struct hist_node *hist,
-                                 const AVFrame *f1, const AVFrame *f2)
+                                 const AVFrame *f1, const AVFrame *f2,
+                                 int slice_start, int slice_end)
 {
     int x, y, ret, nb_diff_colors = 0;
 
-    for (y = 0; y < f1->height; y++) {
+    for (y = slice_start; y < slice_end; y++) {
         const uint32_t *p = (const uint32_t *)(f1->data[0] + y*f1->linesize[0]);
         const uint32_t *q = (const uint32_t *)(f2->data[0] + y*f2->linesize[0]);
 
@@ -445,11 +463,12 @@ static int update_histogram_diff(struct hist_node *hist,
 /**
  * Simple histogram of the frame.
  */
-static int update_histogram_frame(struct hist_node *hist, const AVFrame *f)
+static int update_histogram_frame(struct hist_node *hist, const AVFrame *f,
+                                  int slice_start, int slice_end)
 {
     int x, y, ret, nb_diff_colors = 0;
 
-    for (y = 0; y < f->height; y++) {
+    for (y = slice_start; y < slice_end; y++) {
         const uint32_t *p = (const uint32_t *)(f->data[0] + y*f->linesize[0]);
 
         for (x = 0; x < f->width; x++) {
@@ -462,6 +481,105 @@ static int update_histogram_frame(struct hist_node *hist, const AVFrame *f)
     return nb_diff_colors;
 }
 
+typedef struct ThreadData {
+    const AVFrame *prev, *in;
+    int nb_slices;
+} ThreadData;
+
+/**
+ * The first slice updates the main histogram directly, the others fill
+ * their own histogram which is merged afterwards.
+ */
+static int update_histogram_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    PaletteGenContext *s = ctx->priv;
+    ThreadData *td = arg;
+    struct hist_node *hist = jobnr ? s->slice_histograms[jobnr - 1] : s->histogram;
+    const int height = td->in->height;
+    const int slice_start = (height *  jobnr     ) / nb_jobs;
+    const int slice_end   = (height * (jobnr + 1)) / nb_jobs;
+
+    return td->prev ? update_histogram_diff(hist, td->prev, td->in, slice_start, slice_end)
+                    : update_histogram_frame(hist, td->in, slice_start, slice_end);
+}
+
+/**
+ * Merge the slice histograms into the main one, bucket by bucket. New
+ * colors are appended in slice order, so the histogram ends up identical to
+ * the one of a single pass over the frame.
+ */
+static int merge_histograms(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    PaletteGenContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const int start = (HIST_SIZE *  jobnr     ) / nb_jobs;
+    const int end   = (HIST_SIZE * (jobnr + 1)) / nb_jobs;
+    int nb_new_colors = 0;
+
+    for (int j = start; j < end; j++) {
+        struct hist_node *node = &s->histogram[j];
+
+        for (int k = 0; k < td->nb_slices - 1; k++) {
+            struct hist_node *slice_node = &s->slice_histograms[k][j];
+
+            for (int i = 0; i < slice_node->nb_entries; i++) {
+                const struct color_ref *src = &slice_node->entries[i];
+                struct color_ref *e = NULL;
+
+                for (int n = 0; n < node->nb_entries; n++) {
+                    if (node->entries[n].color == src->color) {
+                        e = &node->entries[n];
+                        break;
+                    }
+                }
+
+                if (e) {
+                    e->count += src->count;
+                    continue;
+                }
+
+                e = hist_node_add(node);
+                if (!e)
+                    return AVERROR(ENOMEM);
+                *e = *src;
+                nb_new_colors++;
+            }
+            slice_node->nb_entries = 0;
+        }
+    }
+
+    return nb_new_colors;
+}
+
+static int update_histogram(AVFilterContext *ctx, const AVFrame *prev, const AVFrame *in)
+{
+    PaletteGenContext *s = ctx->priv;
+    ThreadData td = { .prev = prev, .in = in };
+    int nb_new_colors = 0;
+
+    td.nb_slices = FFMIN(in->height, s->nb_threads);
+    ff_filter_execute(ctx, update_histogram_slice, &td, s->slice_ret, td.nb_slices);
+
+    for (int i = 0; i < td.nb_slices; i++)
+        if (s->slice_ret[i] < 0)
+            return s->slice_ret[i];
+    nb_new_colors += s->slice_ret[0];
+
+    if (td.nb_slices > 1) {
+        const int nb_jobs = s->nb_threads;
+
+        ff_filter_execute(ctx, merge_histograms, &td, s->slice_ret, nb_jobs);
+
+        for (int i = 0; i < nb_jobs; i++) {
+            if (s->slice_ret[i] < 0)
+                return s->slice_ret[i];
+            nb_new_colors += s->slice_ret[i];
+        }
+    }
+
+    return nb_new_colors;
+}
+
 /**
  * Update the histogram for each passing frame. No frame will be pushed here.
  */
@@ -474,8 +592,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     if (in->color_trc != AVCOL_TRC_UNSPECIFIED && in->color_trc != AVCOL_TRC_IEC61966_2_1)
         av_log(ctx, AV_LOG_WARNING, "The input frame is not in sRGB, colors may be off\n");
 
-    ret = s->prev_frame ? update_histogram_diff(s->histogram, s->prev_frame, in)
-                        : update_histogram_frame(s->histogram, in);
+    ret = update_histogram(ctx, s->prev_frame, in);
     if (ret > 0)
         s->nb_refs += ret;
 
@@ -523,6 +640,26 @@ static int request_frame(AVFilterLink *outlink)
     return r;
 }
 
+static int config_input(AVFilterLink *inlink)
+{
+    AVFilterContext *ctx = inlink->dst;
+    PaletteGenContext *s = ctx->priv;
+
+    s->nb_threads = ff_filter_get_nb_threads(ctx);
+
+    s->slice_ret = av_calloc(s->nb_threads, sizeof(*s->slice_ret));
+    if (!s->slice_ret)
+        return AVERROR(ENOMEM);
+
+    if (s->nb_threads > 1) {
+        s->slice_histograms = av_calloc(s->nb_threads - 1, sizeof(*s->slice_histograms));
+        if (!s->slice_histograms)
+            return AVERROR(ENOMEM);
+    }
+
+    return 0;
+}
+
 /**
  * The output is one simple 16x16 squared-pixels palette.
  */
@@ -552,6 +689,13 @@ static av_cold void uninit(AVFilterContext *ctx)
 
     for (i = 0; i < HIST_SIZE; i++)
         av_freep(&s->histogram[i].entries);
+    if (s->slice_histograms) {
+        for (int k = 0; k < s->nb_threads - 1; k++)
+            for (i = 0; i < HIST_SIZE; i++)
+                av_freep(&s->slice_histograms[k][i].entries);
+    }
+    av_freep(&s->slice_histograms);
+    av_freep(&s->slice_ret);
     av_freep(&s->refs);
     av_frame_free(&s->prev_frame);
 }
@@ -561,6 +705,7 @@ static const AVFilterPad palettegen_inputs[] = {
         .name         = "default",
         .type         = AVMEDIA_TYPE_VIDEO,
         .filter_frame = filter_frame,
+        .config_props = config_input,
     },
 };
 
@@ -583,4 +728,5 @@ const AVFilter ff_vf_palettegen = {
     FILTER_OUTPUTS(palettegen_outputs),
     FILTER_QUERY_FUNC2(query_formats),
     .priv_class    = &palettegen_class,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -24,6 +24,8 @@
  * Use a palette to downsample an input video stream.
  */
 
+#include <stdatomic.h>
+
 #include "libavutil/bprint.h"
 #include "libavutil/file_open.h"
 #include "libavutil/internal.h"
@@ -68,27 +70,30 @@ struct color_node {
     int left_id, right_id;
 };
 
-#define CACHE_SIZE (1<<15)
-
-struct cached_color {
-    uint32_t color;
-    uint8_t pal_entry;
-};
-
-struct cache_node {
-    struct cached_color *entries;
-    int nb_entries;
-};
+/**
+ * The lookup cache is a set associative table shared by all the threads.
+ * ff_lowbias32() is a bijection, so the set index and a tag made of the
+ * remaining hash bits identify a color exactly. Each slot is a single
+ * atomic word holding CACHE_VALID, the tag and the palette entry, so
+ * concurrent lookups and insertions never see a torn entry. An entry may
+ * be evicted at any time, which only costs a new search.
+ */
+#define CACHE_WAYS_BITS 2
+#define CACHE_SETS_BITS 16
+#define CACHE_WAYS (1 << CACHE_WAYS_BITS)
+#define CACHE_SIZE (1 << (CACHE_SETS_BITS + CACHE_WAYS_BITS))
+#define CACHE_VALID (1U << 31)
 
 struct PaletteUseContext;
 
-typedef int (*set_frame_func)(struct PaletteUseContext *s, AVFrame *out, AVFrame *in,
-                              int x_start, int y_start, int width, int height);
+typedef void (*set_frame_func)(struct PaletteUseContext *s, AVFrame *out, AVFrame *in,
+                               int x_start, int y_start, int width, int height,
+                               int jobnr, int nb_jobs);
 
 typedef struct PaletteUseContext {
     const AVClass *class;
     FFFrameSync fs;
-    struct cache_node cache[CACHE_SIZE];    /* lookup cache */
+    atomic_uint cache[CACHE_SIZE];          /* lookup cache */
     struct color_node map[AVPALETTE_COUNT]; /* 3D-Tree (KD-Tree with K=3) for reverse colormap */
     uint32_t palette[AVPALETTE_COUNT];
     int transparency_index; /* index in the palette of transparency. -1 if there is no transparency in the palette. */
@@ -103,6 +108,8 @@ typedef struct PaletteUseContext {
     AVFrame *last_in;
     AVFrame *last_out;
 
+    int nb_threads;
+
     /* debug options */
     char *dot_filename;
     int calc_mean_err;
@@ -242,30 +249,30 @@ struct stack_node {
 static av_always_inline int color_get(PaletteUseContext *s, uint32_t color)
 {
     struct color_info clrinfo;
-    const uint32_t hash = ff_lowbias32(color) & (CACHE_SIZE - 1);
-    struct cache_node *node = &s->cache[hash];
-    struct cached_color *e;
+    const uint32_t hash = ff_lowbias32(color);
+    const unsigned key = CACHE_VALID | (hash >> CACHE_SETS_BITS) << 8;
+    atomic_uint *set = &s->cache[(hash & ((1 << CACHE_SETS_BITS) - 1)) << CACHE_WAYS_BITS];
+    int way = (hash >> CACHE_SETS_BITS) & (CACHE_WAYS - 1);
+    uint8_t pal_entry;
 
     // first, check for transparency
     if (color>>24 < s->trans_thresh && s->transparency_index >= 0) {
         return s->transparency_index;
     }
 
-    for (int i = 0; i < node->nb_entries; i++) {
-        e = &node->entries[i];
-        if (e->color == color)
-            return e->pal_entry;
+    for (int i = 0; i < CACHE_WAYS; i++) {
+        const unsigned e = atomic_load_explicit(&set[i], memory_order_relaxed);
+        if ((e & ~0xffU) == key)
+            return e & 0xff;
+        if (!e)
+            way = i;
     }
 
-    e = av_dynarray2_add((void**)&node->entries, &node->nb_entries,
-                         sizeof(*node->entries), NULL);
-    if (!e)
-        return AVERROR(ENOMEM);
-    e->color = color;
     clrinfo = get_color_from_srgb(color);
-    e->pal_entry = colormap_nearest(s->map, &clrinfo, s->trans_thresh);
+    pal_entry = colormap_nearest(s->map, &clrinfo, s->trans_thresh);
+    atomic_store_explicit(&set[way], key | pal_entry, memory_order_relaxed);
 
-    return e->pal_entry;
+    return pal_entry;
 }
 
 static av_always_inline int get_dst_color_err(PaletteUseContext *s,
@@ -273,8 +280,6 @@ static av_always_inline int get_dst_color_err(PaletteUseContext *s,
 {
     uint32_t dstc;
     const int dstx = color_get(s, c);
-    if (dstx < 0)
-        return dstx;
     dstc = s->palette[dstx];
     if (dstx == s->transparency_index) {
         *er = *eg = *eb = 0;
@@ -289,19 +294,26 @@ static av_always_inline int get_dst_color_err(PaletteUseContext *s,
     return dstx;
 }
 
-static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFrame *in,
-                                      int x_start, int y_start, int w, int h,
-                                      enum dithering_mode dither)
+/**
+ * Without error diffusion the rows are split in slices. Error diffusion
+ * carries errors to the following rows, so it always runs as a single job.
+ */
+static av_always_inline void set_frame(PaletteUseContext *s, AVFrame *out, AVFrame *in,
+                                       int x_start, int y_start, int w, int h,
+                                       int jobnr, int nb_jobs,
+                                       enum dithering_mode dither)
 {
     const int src_linesize = in ->linesize[0] >> 2;
     const int dst_linesize = out->linesize[0];
-    uint32_t *src = ((uint32_t *)in ->data[0]) + y_start*src_linesize;
-    uint8_t  *dst =              out->data[0]  + y_start*dst_linesize;
+    const int slice_start = y_start + (h *  jobnr     ) / nb_jobs;
+    const int slice_end   = y_start + (h * (jobnr + 1)) / nb_jobs;
+    uint32_t *src = ((uint32_t *)in ->data[0]) + slice_start*src_linesize;
+    uint8_t  *dst =              out->data[0]  + slice_start*dst_linesize;
 
     w += x_start;
     h += y_start;
 
-    for (int y = y_start; y < h; y++) {
+    for (int y = slice_start; y < slice_end; y++) {
         for (int x = x_start; x < w; x++) {
             int er, eg, eb;
 
@@ -316,17 +328,11 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
                 const uint8_t b = av_clip_uint8(b8 + d);
                 const uint32_t color_new = (unsigned)(a8) << 24 | r << 16 | g << 8 | b;
                 const int color = color_get(s, color_new);
-
-                if (color < 0)
-                    return color;
                 dst[x] = color;
 
             } else if (dither == DITHERING_HECKBERT) {
                 const int right = x < w - 1, down = y < h - 1;
                 const int color = get_dst_color_err(s, src[x], &er, &eg, &eb);
-
-                if (color < 0)
-                    return color;
                 dst[x] = color;
 
                 if (right)         src[               x + 1] = dither_color(src[               x + 1], er, eg, eb, 3, 3);
@@ -336,9 +342,6 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
             } else if (dither == DITHERING_FLOYD_STEINBERG) {
                 const int right = x < w - 1, down = y < h - 1, left = x > x_start;
                 const int color = get_dst_color_err(s, src[x], &er, &eg, &eb);
-
-                if (color < 0)
-                    return color;
                 dst[x] = color;
 
                 if (right)         src[               x + 1] = dither_color(src[               x + 1], er, eg, eb, 7, 4);
@@ -350,9 +353,6 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
                 const int right  = x < w - 1, down  = y < h - 1, left  = x > x_start;
                 const int right2 = x < w - 2,                    left2 = x > x_start + 1;
                 const int color = get_dst_color_err(s, src[x], &er, &eg, &eb);
-
-                if (color < 0)
-                    return color;
                 dst[x] = color;
 
                 if (right)          src[                 x + 1] = dither_color(src[                 x + 1], er, eg, eb, 4, 4);
@@ -369,9 +369,6 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
             } else if (dither == DITHERING_SIERRA2_4A) {
                 const int right = x < w - 1, down = y < h - 1, left = x > x_start;
                 const int color = get_dst_color_err(s, src[x], &er, &eg, &eb);
-
-                if (color < 0)
-                    return color;
                 dst[x] = color;
 
                 if (right)         src[               x + 1] = dither_color(src[               x + 1], er, eg, eb, 2, 2);
@@ -382,9 +379,6 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
                 const int right  = x < w - 1, down  = y < h - 1, left  = x > x_start;
                 const int right2 = x < w - 2, down2 = y < h - 2, left2 = x > x_start + 1;
                 const int color = get_dst_color_err(s, src[x], &er, &eg, &eb);
-
-                if (color < 0)
-                    return color;
                 dst[x] = color;
 
                 if (right)         src[                 x + 1] = dither_color(src[                 x + 1], er, eg, eb, 5, 5);
@@ -408,9 +402,6 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
                 const int right  = x < w - 1, down  = y < h - 1, left  = x > x_start;
                 const int right2 = x < w - 2,                    left2 = x > x_start + 1;
                 const int color = get_dst_color_err(s, src[x], &er, &eg, &eb);
-
-                if (color < 0)
-                    return color;
                 dst[x] = color;
 
                 if (right)      src[                 x + 1] = dither_color(src[                 x + 1], er, eg, eb, 8, 5);
@@ -428,9 +419,6 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
                 const int right  = x < w - 1, down  = y < h - 1, left = x > x_start;
                 const int right2 = x < w - 2, down2 = y < h - 2;
                 const int color = get_dst_color_err(s, src[x], &er, &eg, &eb);
-
-                if (color < 0)
-                    return color;
                 dst[x] = color;
 
                 if (right)     src[                 x + 1] = dither_color(src[                 x + 1], er, eg, eb, 1, 3);
@@ -445,16 +433,12 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
 
             } else {
                 const int color = color_get(s, src[x]);
-
-                if (color < 0)
-                    return color;
                 dst[x] = color;
             }
         }
         src += src_linesize;
         dst += dst_linesize;
     }
-    return 0;
 }
 
 #define INDENT 4
@@ -767,9 +751,24 @@ static void set_processing_window(enum diff_mode diff_mode,
     *hp = height;
 }
 
+typedef struct ThreadData {
+    AVFrame *in, *out;
+    int x, y, w, h;
+} ThreadData;
+
+static int set_frame_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    PaletteUseContext *s = ctx->priv;
+    ThreadData *td = arg;
+
+    s->set_frame(s, td->out, td->in, td->x, td->y, td->w, td->h, jobnr, nb_jobs);
+    return 0;
+}
+
 static int apply_palette(AVFilterLink *inlink, AVFrame *in, AVFrame **outf)
 {
-    int x, y, w, h, ret;
+    int x, y, w, h, ret, nb_jobs;
+    ThreadData td;
     AVFilterContext *ctx = inlink->dst;
     PaletteUseContext *s = ctx->priv;
     AVFilterLink *outlink = inlink->dst->outputs[0];
@@ -795,12 +794,19 @@ static int apply_palette(AVFilterLink *inlink, AVFrame *in, AVFrame **outf)
     ff_dlog(ctx, "%dx%d rect: (%d;%d) -> (%d,%d) [area:%dx%d]\n",
             w, h, x, y, x+w, y+h, in->width, in->height);
 
-    ret = s->set_frame(s, out, in, x, y, w, h);
-    if (ret < 0) {
-        av_frame_free(&out);
-        *outf = NULL;
-        return ret;
-    }
+    td.in  = in;
+    td.out = out;
+    td.x = x;
+    td.y = y;
+    td.w = w;
+    td.h = h;
+
+    if (s->dither != DITHERING_NONE && s->dither != DITHERING_BAYER)
+        nb_jobs = 1;
+    else
+        nb_jobs = FFMIN(h, s->nb_threads);
+    ff_filter_execute(ctx, set_frame_slice, &td, NULL, nb_jobs);
+
     memcpy(out->data[1], s->palette, AVPALETTE_SIZE);
     *outf = out;
     return 0;
@@ -822,6 +828,8 @@ static int config_output(AVFilterLink *outlink)
     outlink->w = ctx->inputs[0]->w;
     outlink->h = ctx->inputs[0]->h;
 
+    s->nb_threads = ff_filter_get_nb_threads(ctx);
+
     outlink->time_base = ctx->inputs[0]->time_base;
     if ((ret = ff_framesync_configure(&s->fs)) < 0)
         return ret;
@@ -855,8 +863,7 @@ static void load_palette(PaletteUseContext *s, const AVFrame *palette_frame)
         memset(s->palette, 0, sizeof(s->palette));
         memset(s->map, 0, sizeof(s->map));
         for (i = 0; i < CACHE_SIZE; i++)
-            av_freep(&s->cache[i].entries);
-        memset(s->cache, 0, sizeof(s->cache));
+            atomic_init(&s->cache[i], 0);
     }
 
     i = 0;
@@ -904,10 +911,11 @@ static int load_apply_palette(FFFrameSync *fs)
 }
 
 #define DEFINE_SET_FRAME(name, value)                                           \
-static int set_frame_##name(PaletteUseContext *s, AVFrame *out, AVFrame *in,    \
-                            int x_start, int y_start, int w, int h)             \
+static void set_frame_##name(PaletteUseContext *s, AVFrame *out, AVFrame *in,   \
+                             int x_start, int y_start, int w, int h,            \
+                             int jobnr, int nb_jobs)                            \
 {                                                                               \
-    return set_frame(s, out, in, x_start, y_start, w, h, value);                \
+    set_frame(s, out, in, x_start, y_start, w, h, jobnr, nb_jobs, value);       \
 }
 
 DEFINE_SET_FRAME(none,            DITHERING_NONE)
@@ -972,8 +980,6 @@ static av_cold void uninit(AVFilterContext *ctx)
     PaletteUseContext *s = ctx->priv;
 
     ff_framesync_uninit(&s->fs);
-    for (int i = 0; i < CACHE_SIZE; i++)
-        av_freep(&s->cache[i].entries);
     av_frame_free(&s->last_in);
     av_frame_free(&s->last_out);
 }
@@ -1008,4 +1014,5 @@ const AVFilter ff_vf_paletteuse = {
     FILTER_OUTPUTS(paletteuse_outputs),
     FILTER_QUERY_FUNC2(query_formats),
     .priv_class    = &paletteuse_class,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -0,0 +1,478 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Calculate several full reference quality metrics between two input
+ * videos in a single pass over each frame pair.
+ *
+ * The frame is split in slices of 4 row groups, each slice computing the SSIM
+ * block sums and the PSNR squared errors of its rows while they are still in
+ * the cache. Results match the psnr and ssim filters.
+ */
+
+#include "libavutil/avstring.h"
+#include "libavutil/mem.h"
+#include "libavutil/opt.h"
+#include "libavutil/pixdesc.h"
+#include "avfilter.h"
+#include "drawutils.h"
+#include "filters.h"
+#include "framesync.h"
+#include "psnr.h"
+#include "ssim.h"
+
+#define METRIC_PSNR (1 << 0)
+#define METRIC_SSIM (1 << 1)
+
+typedef struct QualityMetricsContext {
+    const AVClass *class;
+    FFFrameSync fs;
+    int metrics;
+    int nb_components;
+    int nb_threads;
+    int depth;
+    int is_rgb;
+    uint8_t rgba_map[4];
+    int planewidth[4];
+    int planeheight[4];
+    double planeweight[4];
+    int max[4], average_max;
+    uint64_t nb_frames;
+    double mse, min_mse, max_mse, mse_comp[4];
+    double ssim[4], ssim_total;
+    uint64_t **sse;
+    double **score;
+    void **temp;
+    PSNRDSPContext psnr_dsp;
+    SSIMDSPContext ssim_dsp;
+} QualityMetricsContext;
+
+#define OFFSET(x) offsetof(QualityMetricsContext, x)
+#define FLAGS AV_OPT_FLAG_FILTERING_PARAM|AV_OPT_FLAG_VIDEO_PARAM
+
+static const AVOption qualitymetrics_options[] = {
+    { "metrics", "set the metrics to compute", OFFSET(metrics), AV_OPT_TYPE_FLAGS, {.i64=METRIC_PSNR|METRIC_SSIM}, 1, METRIC_PSNR|METRIC_SSIM, FLAGS, .unit = "metrics" },
+        { "psnr", "peak signal to noise ratio", 0, AV_OPT_TYPE_CONST, {.i64=METRIC_PSNR}, 0, 0, FLAGS, .unit = "metrics" },
+        { "ssim", "structural similarity",      0, AV_OPT_TYPE_CONST, {.i64=METRIC_SSIM}, 0, 0, FLAGS, .unit = "metrics" },
+    { NULL }
+};
+
+FRAMESYNC_DEFINE_CLASS(qualitymetrics, QualityMetricsContext, fs);
+
+static inline double get_psnr(double mse, uint64_t nb_frames, int max)
+{
+    return 10.0 * log10((double)max * max / (mse / nb_frames));
+}
+
+static double ssim_db(double ssim, double weight)
+{
+    return (fabs(weight - ssim) > 1e-9) ? 10.0 * log10(weight / (weight - ssim)) : INFINITY;
+}
+
+static void set_meta(AVDictionary **metadata, const char *key, char comp, float d)
+{
+    char value[128];
+    snprintf(value, sizeof(value), "%f", d);
+    if (comp) {
+        char key2[128];
+        snprintf(key2, sizeof(key2), "%s%c", key, comp);
+        av_dict_set(metadata, key2, value, 0);
+    } else {
+        av_dict_set(metadata, key, value, 0);
+    }
+}
+
+#define SUM_LEN(w) (((w) >> 2) + 3)
+
+typedef struct ThreadData {
+    AVFrame *main, *ref;
+} ThreadData;
+
+static uint64_t sse_rows(const QualityMetricsContext *s,
+                         const uint8_t *main_data, ptrdiff_t main_stride,
+                         const uint8_t *ref_data, ptrdiff_t ref_stride,
+                         int width, int y0, int y1)
+{
+    uint64_t m = 0;
+
+    main_data += y0 * main_stride;
+    ref_data  += y0 * ref_stride;
+    for (int y = y0; y < y1; y++) {
+        m += s->psnr_dsp.sse_line(main_data, ref_data, width);
+        main_data += main_stride;
+        ref_data  += ref_stride;
+    }
+
+    return m;
+}
+
+static int compute_metrics(AVFilterContext *ctx, void *arg,
+                           int jobnr, int nb_jobs)
+{
+    QualityMetricsContext *s = ctx->priv;
+    const SSIMDSPContext *dsp = &s->ssim_dsp;
+    const int do_psnr = s->metrics & METRIC_PSNR;
+    const int do_ssim = s->metrics & METRIC_SSIM;
+    const int high = s->depth > 8;
+    ThreadData *td = arg;
+    uint64_t *sse = s->sse[jobnr];
+    double *score = s->score[jobnr];
+    void *temp = s->temp[jobnr];
+
+    for (int c = 0; c < s->nb_components; c++) {
+        const uint8_t *main_data = td->main->data[c];
+        const uint8_t *ref_data = td->ref->data[c];
+        const ptrdiff_t main_stride = td->main->linesize[c];
+        const ptrdiff_t ref_stride = td->ref->linesize[c];
+        const int width = s->planewidth[c];
+        const int height = s->planeheight[c];
+        const int slice_start = ((height >> 2) * jobnr) / nb_jobs;
+        const int slice_end = ((height >> 2) * (jobnr+1)) / nb_jobs;
+        const int row_end = jobnr == nb_jobs - 1 ? height : 4 * slice_end;
+        const int ystart = FFMAX(1, slice_start);
+        const int w = width >> 2;
+        int psnr_row = 4 * slice_start;
+        int z = ystart - 1;
+        uint64_t m = 0;
+        double ssim = 0.0;
+        void *sum0 = temp;
+        void *sum1 = (uint8_t *)temp + SUM_LEN(width) * (high ? sizeof(int64_t[4]) : sizeof(int[4]));
+
+        for (int y = ystart; do_ssim && y < slice_end; y++) {
+            for (; z <= y; z++) {
+                const uint8_t *main_line = main_data + 4 * z * main_stride;
+                const uint8_t *ref_line = ref_data + 4 * z * ref_stride;
+
+                FFSWAP(void*, sum0, sum1);
+                if (high)
+                    dsp->ssim_4x4_line_16bit(main_line, main_stride, ref_line, ref_stride, sum0, w);
+                else
+                    dsp->ssim_4x4_line(main_line, main_stride, ref_line, ref_stride, sum0, w);
+
+                if (do_psnr && 4 * z >= psnr_row) {
+                    m += sse_rows(s, main_data, main_stride, ref_data, ref_stride,
+                                  width, 4 * z, 4 * z + 4);
+                    psnr_row = 4 * z + 4;
+                }
+            }
+
+            if (high)
+                ssim += dsp->ssim_end_line_16bit(sum0, sum1, w - 1, s->max[0]);
+            else
+                ssim += dsp->ssim_end_line(sum0, sum1, w - 1);
+        }
+
+        if (do_psnr) {
+            m += sse_rows(s, main_data, main_stride, ref_data, ref_stride,
+                          width, psnr_row, row_end);
+            sse[c] = m;
+        }
+        score[c] = ssim;
+    }
+
+    return 0;
+}
+
+static int do_qualitymetrics(FFFrameSync *fs)
+{
+    AVFilterContext *ctx = fs->parent;
+    QualityMetricsContext *s = ctx->priv;
+    AVFrame *master, *ref;
+    AVDictionary **metadata;
+    double comp_mse[4], mse = 0.;
+    double comp_ssim[4] = { 0 }, ssimv = 0.;
+    ThreadData td;
+    int ret;
+
+    ret = ff_framesync_dualinput_get(fs, &master, &ref);
+    if (ret < 0)
+        return ret;
+    if (ctx->is_disabled || !ref)
+        return ff_filter_frame(ctx->outputs[0], master);
+    metadata = &master->metadata;
+
+    if (master->color_range != ref->color_range) {
+        av_log(ctx, AV_LOG_WARNING, "master and reference "
+               "frames use different color ranges (%s != %s)\n",
+               av_color_range_name(master->color_range),
+               av_color_range_name(ref->color_range));
+    }
+
+    td.main = master;
+    td.ref = ref;
+    ff_filter_execute(ctx, compute_metrics, &td, NULL,
+                      FFMIN((s->planeheight[1] + 3) >> 2, s->nb_threads));
+
+    s->nb_frames++;
+
+    if (s->metrics & METRIC_PSNR) {
+        for (int c = 0; c < s->nb_components; c++) {
+            uint64_t sum = 0;
+
+            for (int j = 0; j < s->nb_threads; j++)
+                sum += s->sse[j][c];
+            comp_mse[c] = sum / ((double)s->planewidth[c] * s->planeheight[c]);
+            mse += comp_mse[c] * s->planeweight[c];
+            s->mse_comp[c] += comp_mse[c];
+        }
+
+        s->min_mse = FFMIN(s->min_mse, mse);
+        s->max_mse = FFMAX(s->max_mse, mse);
+        s->mse += mse;
+    }
+
+    if (s->metrics & METRIC_SSIM) {
+        for (int c = 0; c < s->nb_components; c++) {
+            for (int j = 0; j < s->nb_threads; j++)
+                comp_ssim[c] += s->score[j][c];
+            comp_ssim[c] = comp_ssim[c] / (((s->planewidth[c] >> 2) - 1) * ((s->planeheight[c] >> 2) - 1));
+            ssimv += s->planeweight[c] * comp_ssim[c];
+            s->ssim[c] += comp_ssim[c];
+        }
+
+        s->ssim_total += ssimv;
+    }
+
+    if (s->metrics & METRIC_PSNR) {
+        for (int j = 0; j < s->nb_components; j++) {
+            const int c = s->is_rgb ? s->rgba_map[j] : j;
+            const char comp = (s->is_rgb ? "rgba" : "yuva")[j];
+
+            set_meta(metadata, "lavfi.psnr.mse.", comp, comp_mse[c]);
+            set_meta(metadata, "lavfi.psnr.psnr.", comp, get_psnr(comp_mse[c], 1, s->max[c]));
+        }
+        set_meta(metadata, "lavfi.psnr.mse_avg", 0, mse);
+        set_meta(metadata, "lavfi.psnr.psnr_avg", 0, get_psnr(mse, 1, s->average_max));
+    }
+
+    if (s->metrics & METRIC_SSIM) {
+        for (int j = 0; j < s->nb_components; j++) {
+            const int c = s->is_rgb ? s->rgba_map[j] : j;
+
+            set_meta(metadata, "lavfi.ssim.", (s->is_rgb ? "RGBA" : "YUVA")[j], comp_ssim[c]);
+        }
+        set_meta(metadata, "lavfi.ssim.All", 0, ssimv);
+        set_meta(metadata, "lavfi.ssim.dB", 0, ssim_db(ssimv, 1.0));
+    }
+
+    return ff_filter_frame(ctx->outputs[0], master);
+}
+
+static av_cold int init(AVFilterContext *ctx)
+{
+    QualityMetricsContext *s = ctx->priv;
+
+    s->min_mse = +INFINITY;
+    s->max_mse = -INFINITY;
+
+    s->fs.on_event = do_qualitymetrics;
+    return 0;
+}
+
+static const enum AVPixelFormat pix_fmts[] = {
+    AV_PIX_FMT_GRAY8, AV_PIX_FMT_GRAY9, AV_PIX_FMT_GRAY10,
+    AV_PIX_FMT_GRAY12, AV_PIX_FMT_GRAY14, AV_PIX_FMT_GRAY16,
+    AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUV422P, AV_PIX_FMT_YUV444P,
+    AV_PIX_FMT_YUV440P, AV_PIX_FMT_YUV411P, AV_PIX_FMT_YUV410P,
+    AV_PIX_FMT_YUVJ411P, AV_PIX_FMT_YUVJ420P, AV_PIX_FMT_YUVJ422P,
+    AV_PIX_FMT_YUVJ440P, AV_PIX_FMT_YUVJ444P,
+    AV_PIX_FMT_GBRP,
+#define PF(suf) AV_PIX_FMT_YUV420##suf,  AV_PIX_FMT_YUV422##suf,  AV_PIX_FMT_YUV444##suf, AV_PIX_FMT_GBR##suf
+    PF(P9), PF(P10), PF(P12), PF(P14), PF(P16),
+    AV_PIX_FMT_NONE
+};
+
+static int config_input_ref(AVFilterLink *inlink)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(inlink->format);
+    AVFilterContext *ctx  = inlink->dst;
+    QualityMetricsContext *s = ctx->priv;
+    double average_max = 0;
+    size_t sum_size;
+    unsigned sum = 0;
+
+    s->nb_threads = ff_filter_get_nb_threads(ctx);
+    s->nb_components = desc->nb_components;
+    s->depth = desc->comp[0].depth;
+
+    if (ctx->inputs[0]->w != ctx->inputs[1]->w ||
+        ctx->inputs[0]->h != ctx->inputs[1]->h) {
+        av_log(ctx, AV_LOG_ERROR, "Width and height of input videos must be same.\n");
+        return AVERROR(EINVAL);
+    }
+
+    for (int c = 0; c < 4; c++)
+        s->max[c] = (1 << desc->comp[c].depth) - 1;
+
+    s->is_rgb = ff_fill_rgba_map(s->rgba_map, inlink->format) >= 0;
+
+    s->planeheight[1] = s->planeheight[2] = AV_CEIL_RSHIFT(inlink->h, desc->log2_chroma_h);
+    s->planeheight[0] = s->planeheight[3] = inlink->h;
+    s->planewidth[1]  = s->planewidth[2]  = AV_CEIL_RSHIFT(inlink->w, desc->log2_chroma_w);
+    s->planewidth[0]  = s->planewidth[3]  = inlink->w;
+    for (int c = 0; c < s->nb_components; c++)
+        sum += s->planeheight[c] * s->planewidth[c];
+    for (int c = 0; c < s->nb_components; c++) {
+        s->planeweight[c] = (double) s->planeheight[c] * s->planewidth[c] / sum;
+        average_max += s->max[c] * s->planeweight[c];
+    }
+    s->average_max = lrint(average_max);
+
+    ff_psnr_init(&s->psnr_dsp, s->depth);
+    ff_ssim_init(&s->ssim_dsp);
+
+    s->sse   = av_calloc(s->nb_threads, sizeof(*s->sse));
+    s->score = av_calloc(s->nb_threads, sizeof(*s->score));
+    s->temp  = av_calloc(s->nb_threads, sizeof(*s->temp));
+    if (!s->sse || !s->score || !s->temp)
+        return AVERROR(ENOMEM);
+
+    sum_size = s->depth > 8 ? sizeof(int64_t[4]) : sizeof(int[4]);
+    for (int t = 0; t < s->nb_threads; t++) {
+        s->sse[t]   = av_calloc(s->nb_components, sizeof(*s->sse[0]));
+        s->score[t] = av_calloc(s->nb_components, sizeof(*s->score[0]));
+        s->temp[t]  = av_calloc(2 * SUM_LEN(inlink->w), sum_size);
+        if (!s->sse[t] || !s->score[t] || !s->temp[t])
+            return AVERROR(ENOMEM);
+    }
+
+    return 0;
+}
+
+static int config_output(AVFilterLink *outlink)
+{
+    AVFilterContext *ctx = outlink->src;
+    QualityMetricsContext *s = ctx->priv;
+    AVFilterLink *mainlink = ctx->inputs[0];
+    FilterLink *il = ff_filter_link(mainlink);
+    FilterLink *ol = ff_filter_link(outlink);
+    int ret;
+
+    ret = ff_framesync_init_dualinput(&s->fs, ctx);
+    if (ret < 0)
+        return ret;
+    outlink->w = mainlink->w;
+    outlink->h = mainlink->h;
+    outlink->time_base = mainlink->time_base;
+    outlink->sample_aspect_ratio = mainlink->sample_aspect_ratio;
+    ol->frame_rate = il->frame_rate;
+
+    if ((ret = ff_framesync_configure(&s->fs)) < 0)
+        return ret;
+
+    outlink->time_base = s->fs.time_base;
+
+    if (av_cmp_q(mainlink->time_base, outlink->time_base) ||
+        av_cmp_q(ctx->inputs[1]->time_base, outlink->time_base))
+        av_log(ctx, AV_LOG_WARNING, "not matching timebases found between first input: %d/%d and second input %d/%d, results may be incorrect!\n",
+               mainlink->time_base.num, mainlink->time_base.den,
+               ctx->inputs[1]->time_base.num, ctx->inputs[1]->time_base.den);
+
+    return 0;
+}
+
+static int activate(AVFilterContext *ctx)
+{
+    QualityMetricsContext *s = ctx->priv;
+    return ff_framesync_activate(&s->fs);
+}
+
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    QualityMetricsContext *s = ctx->priv;
+
+    if (s->nb_frames > 0 && (s->metrics & METRIC_PSNR)) {
+        char buf[256];
+
+        buf[0] = 0;
+        for (int j = 0; j < s->nb_components; j++) {
+            const int c = s->is_rgb ? s->rgba_map[j] : j;
+            av_strlcatf(buf, sizeof(buf), " %c:%f", (s->is_rgb ? "rgba" : "yuva")[j],
+                        get_psnr(s->mse_comp[c], s->nb_frames, s->max[c]));
+        }
+        av_log(ctx, AV_LOG_INFO, "PSNR%s average:%f min:%f max:%f\n",
+               buf,
+               get_psnr(s->mse, s->nb_frames, s->average_max),
+               get_psnr(s->max_mse, 1, s->average_max),
+               get_psnr(s->min_mse, 1, s->average_max));
+    }
+
+    if (s->nb_frames > 0 && (s->metrics & METRIC_SSIM)) {
+        char buf[256];
+
+        buf[0] = 0;
+        for (int j = 0; j < s->nb_components; j++) {
+            const int c = s->is_rgb ? s->rgba_map[j] : j;
+            av_strlcatf(buf, sizeof(buf), " %c:%f (%f)", (s->is_rgb ? "RGBA" : "YUVA")[j],
+                        s->ssim[c] / s->nb_frames, ssim_db(s->ssim[c], s->nb_frames));
+        }
+        av_log(ctx, AV_LOG_INFO, "SSIM%s All:%f (%f)\n", buf,
+               s->ssim_total / s->nb_frames, ssim_db(s->ssim_total, s->nb_frames));
+    }
+
+    ff_framesync_uninit(&s->fs);
+
+    for (int t = 0; t < s->nb_threads; t++) {
+        if (s->sse)
+            av_freep(&s->sse[t]);
+        if (s->score)
+            av_freep(&s->score[t]);
+        if (s->temp)
+            av_freep(&s->temp[t]);
+    }
+    av_freep(&s->sse);
+    av_freep(&s->score);
+    av_freep(&s->temp);
+}
+
+static const AVFilterPad qualitymetrics_inputs[] = {
+    {
+        .name         = "main",
+        .type         = AVMEDIA_TYPE_VIDEO,
+    },{
+        .name         = "reference",
+        .type         = AVMEDIA_TYPE_VIDEO,
+        .config_props = config_input_ref,
+    },
+};
+
+static const AVFilterPad qualitymetrics_outputs[] = {
+    {
+        .name          = "default",
+        .type          = AVMEDIA_TYPE_VIDEO,
+        .config_props  = config_output,
+    },
+};
+
+const AVFilter ff_vf_qualitymetrics = {
+    .name          = "qualitymetrics",
+    .description   = NULL_IF_CONFIG_SMALL("Calculate PSNR and SSIM between two video streams in one pass."),
+    .preinit       = qualitymetrics_framesync_preinit,
+    .init          = init,
+    .uninit        = uninit,
+    .activate      = activate,
+    .priv_size     = sizeof(QualityMetricsContext),
+    .priv_class    = &qualitymetrics_class,
+    FILTER_INPUTS(qualitymetrics_inputs),
+    FILTER_OUTPUTS(qualitymetrics_outputs),
+    FILTER_PIXFMTS_ARRAY(pix_fmts),
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_INTERNAL |
+                     AVFILTER_FLAG_SLICE_THREADS             |
+                     AVFILTER_FLAG_METADATA_ONLY,
+};
@@ -712,6 +712,22 @@ static int request_frame_ref(AVFilterLink *outlink)
     return ff_request_frame(outlink->src->inputs[1]);
 }
 
+/* Attach pooled data buffers to a frame whose properties are already set */
+static int get_out_buffers(AVFilterLink *outlink, AVFrame *out)
+{
+    AVFrame *tmp = ff_get_video_buffer(outlink, out->width, out->height);
+    if (!tmp)
+        return AVERROR(ENOMEM);
+
+    memcpy(out->buf,      tmp->buf,      sizeof(out->buf));
+    memcpy(out->data,     tmp->data,     sizeof(out->data));
+    memcpy(out->linesize, tmp->linesize, sizeof(out->linesize));
+    memset(tmp->buf, 0, sizeof(tmp->buf));
+    av_frame_free(&tmp);
+
+    return 0;
+}
+
 /* Takes over ownership of *frame_in, passes ownership of *frame_out to caller */
 static int scale_frame(AVFilterLink *link, AVFrame **frame_in,
                        AVFrame **frame_out)
@@ -807,11 +823,13 @@ scale:
     scale->hsub = desc->log2_chroma_w;
     scale->vsub = desc->log2_chroma_h;
 
-    out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
+    /* data buffers are only attached once we know the conversion is needed */
+    out = av_frame_alloc();
     if (!out) {
         ret = AVERROR(ENOMEM);
         goto err;
     }
+    out->format = outlink->format;
 
     if (scale->in_color_matrix != -1)
         in->colorspace = scale->in_color_matrix;
@@ -845,6 +863,12 @@ scale:
         return 0;
     }
 
+    ret = get_out_buffers(outlink, out);
+    if (ret < 0) {
+        av_frame_free(&out);
+        goto err;
+    }
+
     if (out->format == AV_PIX_FMT_PAL8) {
         out->format = AV_PIX_FMT_BGR8;
         avpriv_set_systematic_pal2((uint32_t*) out->data[1], out->format);
@@ -22,6 +22,7 @@
  */
 
 #include "libavutil/imgutils.h"
+#include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
 #include "libavutil/timestamp.h"
@@ -31,6 +32,14 @@
 #include "scene_sad.h"
 #include "video.h"
 
+#define MAX_LOOKAHEAD 64
+
+enum SCDetMetric {
+    METRIC_SAD,
+    METRIC_HIST,
+    NB_METRICS
+};
+
 typedef struct SCDetContext {
     const AVClass *class;
 
@@ -39,11 +48,34 @@ typedef struct SCDetContext {
     int nb_planes;
     int bitdepth;
     ff_scene_sad_fn sad;
+    ff_scene_hist_diff_fn hist_diff;
     double prev_mafd;
     double scene_score;
     AVFrame *prev_picref;
     double threshold;
     int sc_pass;
+    int downscale;
+    int metric;
+    int lookahead;
+
+    int step;                       ///< interleaved components of a plane
+    ptrdiff_t ana_width[4];         ///< size of the analyzed planes, in samples
+    ptrdiff_t ana_height[4];
+    ptrdiff_t ana_linesize[4];
+    size_t ana_size;
+    int nb_bins;
+    uint64_t count;                 ///< number of analyzed samples of a frame
+
+    int nb_frames;
+    AVFrame *frames[MAX_LOOKAHEAD];
+    int valid[MAX_LOOKAHEAD];
+    uint64_t sums[MAX_LOOKAHEAD];
+    /* analysis of the previous frame followed by those of the queued frames */
+    uint8_t *ana[MAX_LOOKAHEAD + 1];
+    uint32_t *hist[MAX_LOOKAHEAD + 1];
+
+    int eof;
+    int64_t eof_pts;
 } SCDetContext;
 
 #define OFFSET(x) offsetof(SCDetContext, x)
@@ -55,6 +87,11 @@ static const AVOption scdet_options[] = {
     { "t",           "set scene change detect threshold",        OFFSET(threshold),  AV_OPT_TYPE_DOUBLE,   {.dbl = 10.},     0,  100., V|F },
     { "sc_pass",     "Set the flag to pass scene change frames", OFFSET(sc_pass),    AV_OPT_TYPE_BOOL,     {.i64 = 0  },     0,    1,  V|F },
     { "s",           "Set the flag to pass scene change frames", OFFSET(sc_pass),    AV_OPT_TYPE_BOOL,     {.i64 = 0  },     0,    1,  V|F },
+    { "downscale",   "set the downscaling factor of the analysis", OFFSET(downscale), AV_OPT_TYPE_INT,     {.i64 = 1  },     1,   16,  V|F },
+    { "metric",      "set the frame difference metric",          OFFSET(metric),     AV_OPT_TYPE_INT,      {.i64 = METRIC_SAD }, 0, NB_METRICS-1, V|F, .unit = "metric" },
+        { "sad",     "sum of absolute differences",              0,                  AV_OPT_TYPE_CONST,    {.i64 = METRIC_SAD },  0, 0, V|F, .unit = "metric" },
+        { "hist",    "histogram difference",                     0,                  AV_OPT_TYPE_CONST,    {.i64 = METRIC_HIST }, 0, 0, V|F, .unit = "metric" },
+    { "lookahead",   "set the number of frames analyzed together", OFFSET(lookahead), AV_OPT_TYPE_INT,     {.i64 = 1  },     1, MAX_LOOKAHEAD, V|F },
     {NULL}
 };
 
@@ -81,19 +118,49 @@ static int config_input(AVFilterLink *inlink)
     int is_yuv = !(desc->flags & AV_PIX_FMT_FLAG_RGB) &&
         (desc->flags & AV_PIX_FMT_FLAG_PLANAR) &&
         desc->nb_components >= 3;
+    const int f = s->downscale;
+    const int bps = (desc->comp[0].depth + 7) / 8;
 
     s->bitdepth = desc->comp[0].depth;
     s->nb_planes = is_yuv ? 1 : av_pix_fmt_count_planes(inlink->format);
+    s->step = desc->flags & AV_PIX_FMT_FLAG_PLANAR ? 1 : desc->comp[0].step / bps;
 
+    s->count = 0;
+    s->ana_size = 0;
     for (int plane = 0; plane < 4; plane++) {
         ptrdiff_t line_size = av_image_get_linesize(inlink->format, inlink->w, plane);
         s->width[plane] = line_size >> (s->bitdepth > 8);
         s->height[plane] = inlink->h >> ((plane == 1 || plane == 2) ? desc->log2_chroma_h : 0);
+
+        if (plane >= s->nb_planes)
+            continue;
+        s->ana_width[plane]    = (s->width[plane] / s->step + f - 1) / f * s->step;
+        s->ana_height[plane]   = (s->height[plane] + f - 1) / f;
+        s->ana_linesize[plane] = FFALIGN(s->ana_width[plane] * bps, 32);
+        s->ana_size += s->ana_linesize[plane] * s->ana_height[plane];
+        s->count    += s->ana_width[plane] * s->ana_height[plane];
     }
 
     s->sad = ff_scene_sad_get_fn(s->bitdepth == 8 ? 8 : 16);
     if (!s->sad)
         return AVERROR(EINVAL);
+    s->hist_diff = ff_scene_hist_diff_get_fn();
+    s->nb_bins = s->nb_planes * s->step * 256;
+
+    for (int i = 0; i <= s->lookahead; i++) {
+        if (f > 1) {
+            av_freep(&s->ana[i]);
+            s->ana[i] = av_malloc(s->ana_size);
+            if (!s->ana[i])
+                return AVERROR(ENOMEM);
+        }
+        if (s->metric == METRIC_HIST) {
+            av_freep(&s->hist[i]);
+            s->hist[i] = av_malloc_array(s->nb_bins, sizeof(*s->hist[i]));
+            if (!s->hist[i])
+                return AVERROR(ENOMEM);
+        }
+    }
 
     return 0;
 }
@@ -103,37 +170,182 @@ static av_cold void uninit(AVFilterContext *ctx)
     SCDetContext *s = ctx->priv;
 
     av_frame_free(&s->prev_picref);
+    for (int i = 0; i < s->nb_frames; i++)
+        av_frame_free(&s->frames[i]);
+    for (int i = 0; i <= MAX_LOOKAHEAD; i++) {
+        av_freep(&s->ana[i]);
+        av_freep(&s->hist[i]);
+    }
 }
 
-static double get_scene_score(AVFilterContext *ctx, AVFrame *frame)
+/* Planes analyzed for slot i, slot 0 being the previous frame. */
+static void get_planes(const SCDetContext *s, int i,
+                       const uint8_t *data[4], ptrdiff_t linesize[4])
 {
-    double ret = 0;
-    SCDetContext *s = ctx->priv;
-    AVFrame *prev_picref = s->prev_picref;
+    if (s->downscale > 1) {
+        const uint8_t *ptr = s->ana[i];
 
-    if (prev_picref && frame->height == prev_picref->height
-                    && frame->width  == prev_picref->width) {
-        uint64_t sad = 0;
-        double mafd, diff;
-        uint64_t count = 0;
+        for (int plane = 0; plane < s->nb_planes; plane++) {
+            data[plane] = ptr;
+            linesize[plane] = s->ana_linesize[plane];
+            ptr += s->ana_linesize[plane] * s->ana_height[plane];
+        }
+    } else {
+        const AVFrame *frame = i ? s->frames[i - 1] : s->prev_picref;
 
         for (int plane = 0; plane < s->nb_planes; plane++) {
-            uint64_t plane_sad;
-            s->sad(prev_picref->data[plane], prev_picref->linesize[plane],
-                    frame->data[plane], frame->linesize[plane],
-                    s->width[plane], s->height[plane], &plane_sad);
-            sad += plane_sad;
-            count += s->width[plane] * s->height[plane];
+            data[plane] = frame->data[plane];
+            linesize[plane] = frame->linesize[plane];
+        }
+    }
+}
+
+#define DECIMATE(name, type)                                                 \
+static void decimate_##name(uint8_t *dstp, ptrdiff_t dst_linesize,          \
+                            const uint8_t *srcp, ptrdiff_t src_linesize,    \
+                            int w, int h, int step, int f)                  \
+{                                                                            \
+    const type *src = (const type *)srcp;                                    \
+    type *dst = (type *)dstp;                                                \
+                                                                             \
+    src_linesize /= sizeof(type);                                            \
+    dst_linesize /= sizeof(type);                                            \
+                                                                             \
+    for (int y0 = 0; y0 < h; y0 += f) {                                      \
+        const int y1 = FFMIN(y0 + f, h);                                     \
+                                                                             \
+        for (int x0 = 0; x0 < w; x0 += f) {                                  \
+            const int x1 = FFMIN(x0 + f, w);                                 \
+            const unsigned cnt = (y1 - y0) * (x1 - x0);                      \
+                                                                             \
+            for (int c = 0; c < step; c++) {                                 \
+                const type *line = src + x0 * step + c;                      \
+                unsigned sum = 0;                                            \
+                                                                             \
+                for (int y = y0; y < y1; y++) {                              \
+                    for (int x = 0; x < x1 - x0; x++)                        \
+                        sum += line[x * step];                               \
+                    line += src_linesize;                                    \
+                }                                                            \
+                                                                             \
+                dst[(x0 / f) * step + c] = (sum + cnt / 2) / cnt;            \
+            }                                                                \
+        }                                                                    \
+                                                                             \
+        src += src_linesize * f;                                             \
+        dst += dst_linesize;                                                 \
+    }                                                                        \
+}
+
+DECIMATE(8,  uint8_t)
+DECIMATE(16, uint16_t)
+
+#define HISTOGRAM(name, type)                                                \
+static void histogram_##name(uint32_t *hist, const uint8_t *srcp,           \
+                             ptrdiff_t linesize, int w, int h,               \
+                             int step, int shift)                            \
+{                                                                            \
+    const type *src = (const type *)srcp;                                    \
+                                                                             \
+    linesize /= sizeof(type);                                                \
+                                                                             \
+    for (int y = 0; y < h; y++) {                                            \
+        for (int x = 0; x < w; x += step) {                                  \
+            for (int c = 0; c < step; c++)                                   \
+                hist[c * 256 + (src[x + c] >> shift)]++;                     \
+        }                                                                    \
+        src += linesize;                                                     \
+    }                                                                        \
+}
+
+HISTOGRAM(8,  uint8_t)
+HISTOGRAM(16, uint16_t)
+
+static int analyze_frames(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    SCDetContext *s = ctx->priv;
+
+    for (int i = jobnr; i < s->nb_frames; i += nb_jobs) {
+        const AVFrame *frame = s->frames[i];
+        const uint8_t *data[4];
+        ptrdiff_t linesize[4];
+
+        if (s->downscale > 1) {
+            uint8_t *dst = s->ana[i + 1];
+
+            for (int plane = 0; plane < s->nb_planes; plane++) {
+                (s->bitdepth > 8 ? decimate_16 : decimate_8)(dst, s->ana_linesize[plane],
+                                                             frame->data[plane], frame->linesize[plane],
+                                                             s->width[plane] / s->step, s->height[plane],
+                                                             s->step, s->downscale);
+                dst += s->ana_linesize[plane] * s->ana_height[plane];
+            }
         }
 
-        mafd = (double)sad * 100. / count / (1ULL << s->bitdepth);
-        diff = fabs(mafd - s->prev_mafd);
-        ret  = av_clipf(FFMIN(mafd, diff), 0, 100.);
-        s->prev_mafd = mafd;
-        av_frame_free(&prev_picref);
+        if (s->metric == METRIC_HIST) {
+            uint32_t *hist = s->hist[i + 1];
+
+            memset(hist, 0, s->nb_bins * sizeof(*hist));
+            get_planes(s, i + 1, data, linesize);
+            for (int plane = 0; plane < s->nb_planes; plane++) {
+                (s->bitdepth > 8 ? histogram_16 : histogram_8)(hist, data[plane], linesize[plane],
+                                                               s->ana_width[plane], s->ana_height[plane],
+                                                               s->step, s->bitdepth - 8);
+                hist += s->step * 256;
+            }
+        }
     }
-    s->prev_picref = av_frame_clone(frame);
-    return ret;
+
+    return 0;
+}
+
+static int compare_frames(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    SCDetContext *s = ctx->priv;
+
+    for (int i = jobnr; i < s->nb_frames; i += nb_jobs) {
+        const uint8_t *data1[4], *data2[4];
+        ptrdiff_t linesize1[4], linesize2[4];
+        uint64_t sum = 0;
+
+        if (!s->valid[i])
+            continue;
+
+        if (s->metric == METRIC_HIST) {
+            s->hist_diff(s->hist[i], s->hist[i + 1], s->nb_bins, &sum);
+        } else {
+            get_planes(s, i, data1, linesize1);
+            get_planes(s, i + 1, data2, linesize2);
+            for (int plane = 0; plane < s->nb_planes; plane++) {
+                uint64_t plane_sad;
+                s->sad(data1[plane], linesize1[plane],
+                       data2[plane], linesize2[plane],
+                       s->ana_width[plane], s->ana_height[plane], &plane_sad);
+                sum += plane_sad;
+            }
+        }
+
+        s->sums[i] = sum;
+    }
+
+    return 0;
+}
+
+static double get_scene_score(SCDetContext *s, int i)
+{
+    double mafd, diff;
+
+    if (!s->valid[i])
+        return 0;
+
+    if (s->metric == METRIC_HIST)
+        mafd = (double)s->sums[i] * 100. / (2 * s->count);
+    else
+        mafd = (double)s->sums[i] * 100. / s->count / (1ULL << s->bitdepth);
+    diff = fabs(mafd - s->prev_mafd);
+    s->prev_mafd = mafd;
+
+    return av_clipf(FFMIN(mafd, diff), 0, 100.);
 }
 
 static int set_meta(SCDetContext *s, AVFrame *frame, const char *key, const char *value)
@@ -141,23 +353,46 @@ static int set_meta(SCDetContext *s, AVFrame *frame, const char *key, const char
     return av_dict_set(&frame->metadata, key, value, 0);
 }
 
-static int activate(AVFilterContext *ctx)
+static int filter_frames(AVFilterContext *ctx)
 {
-    int ret;
     AVFilterLink *inlink = ctx->inputs[0];
     AVFilterLink *outlink = ctx->outputs[0];
     SCDetContext *s = ctx->priv;
-    AVFrame *frame;
+    const int nb_frames = s->nb_frames;
+    int ret = 0;
 
-    FF_FILTER_FORWARD_STATUS_BACK(outlink, inlink);
+    for (int i = 0; i < nb_frames; i++) {
+        const AVFrame *prev = i ? s->frames[i - 1] : s->prev_picref;
+        const AVFrame *frame = s->frames[i];
 
-    ret = ff_inlink_consume_frame(inlink, &frame);
-    if (ret < 0)
-        return ret;
+        s->valid[i] = prev && frame->height == prev->height
+                           && frame->width  == prev->width;
+    }
 
-    if (frame) {
+    /* a job per frame, first preparing each frame then comparing it with
+     * the preceding one */
+    ff_filter_execute(ctx, analyze_frames, NULL, NULL,
+                      FFMIN(nb_frames, ff_filter_get_nb_threads(ctx)));
+    ff_filter_execute(ctx, compare_frames, NULL, NULL,
+                      FFMIN(nb_frames, ff_filter_get_nb_threads(ctx)));
+
+    av_frame_free(&s->prev_picref);
+    s->prev_picref = av_frame_clone(s->frames[nb_frames - 1]);
+    FFSWAP(uint8_t *,  s->ana[0],  s->ana[nb_frames]);
+    FFSWAP(uint32_t *, s->hist[0], s->hist[nb_frames]);
+
+    s->nb_frames = 0;
+    for (int i = 0; i < nb_frames; i++) {
+        AVFrame *frame = s->frames[i];
         char buf[64];
-        s->scene_score = get_scene_score(ctx, frame);
+
+        s->frames[i] = NULL;
+        if (ret < 0) {
+            av_frame_free(&frame);
+            continue;
+        }
+
+        s->scene_score = get_scene_score(s, i);
         snprintf(buf, sizeof(buf), "%0.3f", s->prev_mafd);
         set_meta(s, frame, "lavfi.scd.mafd", buf);
         snprintf(buf, sizeof(buf), "%0.3f", s->scene_score);
@@ -171,15 +406,54 @@ static int activate(AVFilterContext *ctx)
         }
         if (s->sc_pass) {
             if (s->scene_score >= s->threshold)
-                return ff_filter_frame(outlink, frame);
+                ret = ff_filter_frame(outlink, frame);
             else {
                 av_frame_free(&frame);
             }
         } else
-            return ff_filter_frame(outlink, frame);
+            ret = ff_filter_frame(outlink, frame);
+    }
+
+    return ret;
+}
+
+static int activate(AVFilterContext *ctx)
+{
+    int ret, status;
+    AVFilterLink *inlink = ctx->inputs[0];
+    AVFilterLink *outlink = ctx->outputs[0];
+    SCDetContext *s = ctx->priv;
+    AVFrame *frame;
+    int64_t pts;
+
+    FF_FILTER_FORWARD_STATUS_BACK(outlink, inlink);
+
+    while (s->nb_frames < s->lookahead) {
+        ret = ff_inlink_consume_frame(inlink, &frame);
+        if (ret < 0)
+            return ret;
+        if (!ret)
+            break;
+        s->frames[s->nb_frames++] = frame;
+    }
+
+    if (!s->eof && ff_inlink_acknowledge_status(inlink, &status, &pts)) {
+        s->eof = 1;
+        s->eof_pts = pts;
+    }
+
+    if (s->nb_frames && (s->nb_frames == s->lookahead || s->eof)) {
+        ret = filter_frames(ctx);
+        if (ret >= 0 && (s->eof || ff_inlink_queued_frames(inlink)))
+            ff_filter_set_ready(ctx, 100);
+        return ret;
+    }
+
+    if (s->eof) {
+        ff_outlink_set_status(outlink, AVERROR_EOF, s->eof_pts);
+        return 0;
     }
 
-    FF_FILTER_FORWARD_STATUS(inlink, outlink);
     FF_FILTER_FORWARD_WANTED(outlink, inlink);
 
     return FFERROR_NOT_READY;
@@ -199,7 +473,7 @@ const AVFilter ff_vf_scdet = {
     .priv_size     = sizeof(SCDetContext),
     .priv_class    = &scdet_class,
     .uninit        = uninit,
-    .flags         = AVFILTER_FLAG_METADATA_ONLY,
+    .flags         = AVFILTER_FLAG_METADATA_ONLY | AVFILTER_FLAG_SLICE_THREADS,
     FILTER_INPUTS(scdet_inputs),
     FILTER_OUTPUTS(ff_video_default_filterpad),
     FILTER_PIXFMTS_ARRAY(pix_fmts),
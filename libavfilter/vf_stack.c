@@ -26,6 +26,7 @@
 #include "libavutil/opt.h"
 #include "libavutil/parseutils.h"
 #include "libavutil/pixdesc.h"
+#include "libavutil/video_hint.h"
 
 #include "avfilter.h"
 #include "drawutils.h"
@@ -34,12 +35,27 @@
 #include "framesync.h"
 #include "video.h"
 
+#define MAX_CANVASES 4
+
 typedef struct StackItem {
     int x[4], y[4];
     int linesize[4];
     int height[4];
+    AVVideoRect rect;
 } StackItem;
 
+/* frame the tile of an input was last copied from */
+typedef struct StackTile {
+    const uint8_t *data;
+    int64_t pts;
+} StackTile;
+
+/* output frame kept around to be updated with the changed tiles only */
+typedef struct StackCanvas {
+    AVFrame *frame;
+    StackTile *tiles;
+} StackCanvas;
+
 typedef struct StackContext {
     const AVClass *class;
     const AVPixFmtDescriptor *desc;
@@ -54,13 +70,21 @@ typedef struct StackContext {
     uint8_t fillcolor[4];
     char *fillcolor_str;
     int fillcolor_enable;
+    int incremental;
+    int hint;
 
     FFDrawContext draw;
     FFDrawColor color;
 
     StackItem *items;
     AVFrame **frames;
+    uint8_t *update;
+    StackTile *last;
     FFFrameSync fs;
+
+    StackCanvas canvases[MAX_CANVASES];
+    int nb_canvases;
+    int next_canvas;
 } StackContext;
 
 static int query_formats(const AVFilterContext *ctx,
@@ -128,6 +152,15 @@ static av_cold int init(AVFilterContext *ctx)
     if (!s->items)
         return AVERROR(ENOMEM);
 
+    s->update = av_malloc(s->nb_inputs);
+    if (!s->update)
+        return AVERROR(ENOMEM);
+    memset(s->update, 1, s->nb_inputs);
+
+    s->last = av_calloc(s->nb_inputs, sizeof(*s->last));
+    if (!s->last)
+        return AVERROR(ENOMEM);
+
     for (i = 0; i < s->nb_inputs; i++) {
         AVFilterPad pad = { 0 };
 
@@ -154,6 +187,8 @@ static int process_slice(AVFilterContext *ctx, void *arg, int job, int nb_jobs)
     for (int i = start; i < end; i++) {
         StackItem *item = &s->items[i];
 
+        if (!s->update[i])
+            continue;
         for (int p = 0; p < s->nb_planes; p++) {
             av_image_copy_plane(out->data[p] + out->linesize[p] * item->y[p] + item->x[p],
                                 out->linesize[p],
@@ -166,13 +201,116 @@ static int process_slice(AVFilterContext *ctx, void *arg, int job, int nb_jobs)
     return 0;
 }
 
+static AVFrame *new_output(AVFilterContext *ctx)
+{
+    AVFilterLink *outlink = ctx->outputs[0];
+    StackContext *s = ctx->priv;
+    AVFrame *out;
+
+    out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
+    if (!out)
+        return NULL;
+
+    if (s->fillcolor_enable)
+        ff_fill_rectangle(&s->draw, &s->color, out->data, out->linesize,
+                          0, 0, outlink->w, outlink->h);
+
+    return out;
+}
+
+/**
+ * Pick a canvas that is not referenced downstream anymore, or allocate a new
+ * one, and mark the tiles whose input frame changed since it was last drawn.
+ */
+static StackCanvas *get_canvas(AVFilterContext *ctx)
+{
+    StackContext *s = ctx->priv;
+    StackCanvas *c = NULL;
+
+    for (int i = 0; i < s->nb_canvases; i++) {
+        if (av_frame_is_writable(s->canvases[i].frame)) {
+            c = &s->canvases[i];
+            break;
+        }
+    }
+
+    if (!c) {
+        if (s->nb_canvases < MAX_CANVASES) {
+            c = &s->canvases[s->nb_canvases];
+            c->tiles = av_malloc_array(s->nb_inputs, sizeof(*c->tiles));
+            if (!c->tiles)
+                return NULL;
+            s->nb_canvases++;
+        } else {
+            c = &s->canvases[s->next_canvas];
+            s->next_canvas = (s->next_canvas + 1) % MAX_CANVASES;
+            av_frame_free(&c->frame);
+        }
+
+        c->frame = new_output(ctx);
+        if (!c->frame)
+            return NULL;
+        for (int i = 0; i < s->nb_inputs; i++)
+            c->tiles[i].data = NULL;
+    }
+
+    for (int i = 0; i < s->nb_inputs; i++) {
+        StackTile *tile = &c->tiles[i];
+
+        s->update[i] = tile->data != s->frames[i]->data[0] ||
+                       tile->pts  != s->fs.in[i].pts;
+        tile->data = s->frames[i]->data[0];
+        tile->pts  = s->fs.in[i].pts;
+    }
+
+    return c;
+}
+
+/**
+ * Attach the tiles whose input changed since the previous output as video
+ * hint side data.
+ */
+static int add_hint(AVFilterContext *ctx, AVFrame *out)
+{
+    StackContext *s = ctx->priv;
+    AVVideoHint *hint = NULL;
+    size_t nb_changed = 0;
+
+#define TILE_CHANGED(i) (s->last[i].data != s->frames[i]->data[0] || \
+                         s->last[i].pts  != s->fs.in[i].pts)
+
+    for (int i = 0; i < s->nb_inputs; i++)
+        nb_changed += TILE_CHANGED(i);
+
+    /* without side data the whole frame is considered changed, as it has to
+     * be for the first one */
+    if (s->last[0].data) {
+        hint = av_video_hint_create_side_data(out, nb_changed);
+        if (!hint)
+            return AVERROR(ENOMEM);
+        hint->type = AV_VIDEO_HINT_TYPE_CHANGED;
+    }
+
+    for (int i = 0, j = 0; i < s->nb_inputs; i++) {
+        if (!TILE_CHANGED(i))
+            continue;
+        if (hint)
+            *av_video_hint_get_rect(hint, j++) = s->items[i].rect;
+        s->last[i].data = s->frames[i]->data[0];
+        s->last[i].pts  = s->fs.in[i].pts;
+    }
+#undef TILE_CHANGED
+
+    return 0;
+}
+
 static int process_frame(FFFrameSync *fs)
 {
     AVFilterContext *ctx = fs->parent;
     AVFilterLink *outlink = ctx->outputs[0];
     StackContext *s = fs->opaque;
     AVFrame **in = s->frames;
-    AVFrame *out;
+    AVFrame *out, *dst;
     int i, ret;
 
     for (i = 0; i < s->nb_inputs; i++) {
@@ -180,19 +318,38 @@ static int process_frame(FFFrameSync *fs)
             return ret;
     }
 
-    out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
-    if (!out)
-        return AVERROR(ENOMEM);
-    out->pts = av_rescale_q(s->fs.pts, s->fs.time_base, outlink->time_base);
-    out->sample_aspect_ratio = outlink->sample_aspect_ratio;
-
-    if (s->fillcolor_enable)
-        ff_fill_rectangle(&s->draw, &s->color, out->data, out->linesize,
-                          0, 0, outlink->w, outlink->h);
+    if (s->incremental) {
+        StackCanvas *c = get_canvas(ctx);
+        if (!c)
+            return AVERROR(ENOMEM);
+        dst = c->frame;
+    } else {
+        dst = new_output(ctx);
+        if (!dst)
+            return AVERROR(ENOMEM);
+    }
 
-    ff_filter_execute(ctx, process_slice, out, NULL,
+    ff_filter_execute(ctx, process_slice, dst, NULL,
                       FFMIN(s->nb_inputs, ff_filter_get_nb_threads(ctx)));
 
+    if (s->incremental) {
+        out = av_frame_clone(dst);
+        if (!out)
+            return AVERROR(ENOMEM);
+    } else {
+        out = dst;
+    }
+
+    if (s->hint) {
+        ret = add_hint(ctx, out);
+        if (ret < 0) {
+            av_frame_free(&out);
+            return ret;
+        }
+    }
+    out->pts = av_rescale_q(s->fs.pts, s->fs.time_base, outlink->time_base);
+    out->sample_aspect_ratio = outlink->sample_aspect_ratio;
+
     return ff_filter_frame(outlink, out);
 }
 
@@ -259,6 +416,7 @@ static int config_output(AVFilterLink *outlink)
                     return ret;
                 }
 
+                item->rect.x = width;
                 width += ctx->inputs[i]->w;
             }
         }
@@ -291,6 +449,7 @@ static int config_output(AVFilterLink *outlink)
                 if ((ret = av_image_fill_linesizes(item->x, inlink->format, inw)) < 0) {
                     return ret;
                 }
+                item->rect.x = inw;
 
                 item->y[1] = item->y[2] = AV_CEIL_RSHIFT(inh, s->desc->log2_chroma_h);
                 item->y[0] = item->y[3] = inh;
@@ -376,6 +535,7 @@ static int config_output(AVFilterLink *outlink)
             if ((ret = av_image_fill_linesizes(item->x, inlink->format, inw)) < 0) {
                 return ret;
             }
+            item->rect.x = inw;
 
             item->y[1] = item->y[2] = AV_CEIL_RSHIFT(inh, s->desc->log2_chroma_h);
             item->y[0] = item->y[3] = inh;
@@ -387,6 +547,14 @@ static int config_output(AVFilterLink *outlink)
 
     s->nb_planes = av_pix_fmt_count_planes(outlink->format);
 
+    for (i = 0; i < s->nb_inputs; i++) {
+        StackItem *item = &s->items[i];
+
+        item->rect.y      = item->y[0];
+        item->rect.width  = ctx->inputs[i]->w;
+        item->rect.height = ctx->inputs[i]->h;
+    }
+
     outlink->w          = width;
     outlink->h          = height;
     ol->frame_rate      = frame_rate;
@@ -432,6 +600,13 @@ static av_cold void uninit(AVFilterContext *ctx)
     ff_framesync_uninit(&s->fs);
     av_freep(&s->frames);
     av_freep(&s->items);
+    av_freep(&s->update);
+    av_freep(&s->last);
+
+    for (int i = 0; i < s->nb_canvases; i++) {
+        av_frame_free(&s->canvases[i].frame);
+        av_freep(&s->canvases[i].tiles);
+    }
 }
 
 static int activate(AVFilterContext *ctx)
@@ -445,6 +620,8 @@ static int activate(AVFilterContext *ctx)
 static const AVOption stack_options[] = {
     { "inputs", "set number of inputs", OFFSET(nb_inputs), AV_OPT_TYPE_INT, {.i64=2}, 2, INT_MAX, .flags = FLAGS },
     { "shortest", "force termination when the shortest input terminates", OFFSET(shortest), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, .flags = FLAGS },
+    { "incremental", "only copy the inputs that changed", OFFSET(incremental), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, .flags = FLAGS },
+    { "hint", "attach video hints with the changed inputs", OFFSET(hint), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, .flags = FLAGS },
     { NULL },
 };
 
@@ -500,6 +677,8 @@ static const AVOption xstack_options[] = {
     { "grid", "set fixed size grid layout", OFFSET(nb_grid_columns), AV_OPT_TYPE_IMAGE_SIZE, {.str=NULL}, 0, 0, .flags = FLAGS },
     { "shortest", "force termination when the shortest input terminates", OFFSET(shortest), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, .flags = FLAGS },
     { "fill",  "set the color for unused pixels", OFFSET(fillcolor_str), AV_OPT_TYPE_STRING, {.str = "none"}, .flags = FLAGS },
+    { "incremental", "only copy the inputs that changed", OFFSET(incremental), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, .flags = FLAGS },
+    { "hint", "attach video hints with the changed inputs", OFFSET(hint), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, .flags = FLAGS },
     { NULL },
 };
 
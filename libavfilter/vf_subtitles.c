@@ -47,6 +47,11 @@
 
 #define FF_ASS_FEATURE_WRAP_UNICODE     (LIBASS_VERSION >= 0x01600010)
 
+typedef struct AssImage {
+    const ASS_Image *image;
+    FFDrawColor color;
+} AssImage;
+
 typedef struct AssContext {
     const AVClass *class;
     ASS_Library  *library;
@@ -64,6 +69,11 @@ typedef struct AssContext {
     int shaping;
     FFDrawContext draw;
     int wrap_unicode;
+
+    AssImage *images;          ///< images of the last rendered frame
+    unsigned int images_size;
+    int nb_images;
+    int y_start, y_end;        ///< rows covered by the images
 } AssContext;
 
 #define OFFSET(x) offsetof(AssContext, x)
@@ -170,6 +180,7 @@ static av_cold void uninit(AVFilterContext *ctx)
         ass_renderer_done(ass->renderer);
     if (ass->library)
         ass_library_done(ass->library);
+    av_freep(&ass->images);
 }
 
 static int query_formats(const AVFilterContext *ctx,
@@ -209,19 +220,72 @@ static int config_input(AVFilterLink *inlink)
 #define AB(c)  (((c)>>8) &0xFF)
 #define AA(c)  ((0xFF-(c)) &0xFF)
 
-static void overlay_ass_image(AssContext *ass, AVFrame *picref,
-                              const ASS_Image *image)
+static int update_images(AssContext *ass, const ASS_Image *image,
+                         int detect_change, int w, int h)
 {
+    int nb_images = 0;
+
+    ass->y_start = h;
+    ass->y_end = 0;
     for (; image; image = image->next) {
-        uint8_t rgba_color[] = {AR(image->color), AG(image->color), AB(image->color), AA(image->color)};
-        FFDrawColor color;
-        ff_draw_color(&ass->draw, &color, rgba_color);
-        ff_blend_mask(&ass->draw, &color,
+        AssImage *images = av_fast_realloc(ass->images, &ass->images_size,
+                                           (nb_images + 1) * sizeof(*images));
+        if (!images)
+            return AVERROR(ENOMEM);
+        ass->images = images;
+
+        /* the colors are unchanged as long as libass detects no change */
+        if (detect_change || nb_images >= ass->nb_images) {
+            uint8_t rgba_color[] = {AR(image->color), AG(image->color), AB(image->color), AA(image->color)};
+            ff_draw_color(&ass->draw, &images[nb_images].color, rgba_color);
+        }
+        images[nb_images].image = image;
+        nb_images++;
+
+        if (image->w > 0 && image->dst_x < w && image->dst_x + image->w > 0 &&
+            image->h > 0 && image->dst_y < h && image->dst_y + image->h > 0) {
+            ass->y_start = FFMIN(ass->y_start, FFMAX(image->dst_y, 0));
+            ass->y_end = FFMAX(ass->y_end, FFMIN(image->dst_y + image->h, h));
+        }
+    }
+    ass->nb_images = nb_images;
+
+    return 0;
+}
+
+static int overlay_ass_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    AssContext *ass = ctx->priv;
+    AVFrame *picref = arg;
+    const int align_mask = (1 << ass->draw.vsub_max) - 1;
+    const int h = ass->y_end - ass->y_start;
+    int slice_start = ass->y_start, slice_end = ass->y_end;
+
+    /* keep the slice edges on chroma rows so no chroma row is shared */
+    if (jobnr > 0)
+        slice_start = av_clip((ass->y_start + h * jobnr / nb_jobs) & ~align_mask,
+                              ass->y_start, ass->y_end);
+    if (jobnr < nb_jobs - 1)
+        slice_end = av_clip((ass->y_start + h * (jobnr + 1) / nb_jobs) & ~align_mask,
+                            ass->y_start, ass->y_end);
+
+    for (int i = 0; i < ass->nb_images; i++) {
+        const ASS_Image *image = ass->images[i].image;
+        const int y0 = FFMAX(image->dst_y, slice_start);
+        const int y1 = FFMIN(image->dst_y + image->h, slice_end);
+
+        if (y0 >= y1)
+            continue;
+
+        ff_blend_mask(&ass->draw, &ass->images[i].color,
                       picref->data, picref->linesize,
                       picref->width, picref->height,
-                      image->bitmap, image->stride, image->w, image->h,
-                      3, 0, image->dst_x, image->dst_y);
+                      image->bitmap + (y0 - image->dst_y) * image->stride,
+                      image->stride, image->w, y1 - y0,
+                      3, 0, image->dst_x, y0);
     }
+
+    return 0;
 }
 
 static int filter_frame(AVFilterLink *inlink, AVFrame *picref)
@@ -229,7 +293,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *picref)
     AVFilterContext *ctx = inlink->dst;
     AVFilterLink *outlink = ctx->outputs[0];
     AssContext *ass = ctx->priv;
-    int detect_change = 0;
+    int detect_change = 0, ret;
     double time_ms = picref->pts * av_q2d(inlink->time_base) * 1000;
     ASS_Image *image = ass_render_frame(ass->renderer, ass->track,
                                         time_ms, &detect_change);
@@ -237,7 +301,16 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *picref)
     if (detect_change)
         av_log(ctx, AV_LOG_DEBUG, "Change happened at time ms:%f\n", time_ms);
 
-    overlay_ass_image(ass, picref, image);
+    ret = update_images(ass, image, detect_change, picref->width, picref->height);
+    if (ret < 0) {
+        av_frame_free(&picref);
+        return ret;
+    }
+
+    if (ass->y_end > ass->y_start)
+        ff_filter_execute(ctx, overlay_ass_slice, picref, NULL,
+                          FFMAX(1, FFMIN((ass->y_end - ass->y_start) >> ass->draw.vsub_max,
+                                         ff_filter_get_nb_threads(ctx))));
 
     return ff_filter_frame(outlink, picref);
 }
@@ -296,6 +369,7 @@ const AVFilter ff_vf_ass = {
     FILTER_OUTPUTS(ff_video_default_filterpad),
     FILTER_QUERY_FUNC2(query_formats),
     .priv_class    = &ass_class,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
 #endif
 
@@ -551,5 +625,6 @@ const AVFilter ff_vf_subtitles = {
     FILTER_OUTPUTS(ff_video_default_filterpad),
     FILTER_QUERY_FUNC2(query_formats),
     .priv_class    = &subtitles_class,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
 #endif
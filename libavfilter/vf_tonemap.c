@@ -49,6 +49,8 @@ enum TonemapAlgorithm {
     TONEMAP_MAX,
 };
 
+#define LUT_SIZE 4096
+
 typedef struct TonemapContext {
     const AVClass *class;
 
@@ -58,6 +60,9 @@ typedef struct TonemapContext {
     double peak;
 
     const AVLumaCoefficients *coeffs;
+
+    float lut[LUT_SIZE + 1];
+    double lut_peak;
 } TonemapContext;
 
 static av_cold int init(AVFilterContext *ctx)
@@ -104,39 +109,8 @@ static float mobius(float in, float j, double peak)
     return (b * b + 2.0f * b * j + j * j) / (b - a) * (in + a) / (in + b);
 }
 
-#define MIX(x,y,a) (x) * (1 - (a)) + (y) * (a)
-static void tonemap(TonemapContext *s, AVFrame *out, const AVFrame *in,
-                    const AVPixFmtDescriptor *desc, int x, int y, double peak)
+static float tonemap_curve(const TonemapContext *s, float sig, double peak)
 {
-    int map[3] = { desc->comp[0].plane, desc->comp[1].plane, desc->comp[2].plane };
-    const float *r_in = (const float *)(in->data[map[0]] + x * desc->comp[map[0]].step + y * in->linesize[map[0]]);
-    const float *g_in = (const float *)(in->data[map[1]] + x * desc->comp[map[1]].step + y * in->linesize[map[1]]);
-    const float *b_in = (const float *)(in->data[map[2]] + x * desc->comp[map[2]].step + y * in->linesize[map[2]]);
-    float *r_out = (float *)(out->data[map[0]] + x * desc->comp[map[0]].step + y * out->linesize[map[0]]);
-    float *g_out = (float *)(out->data[map[1]] + x * desc->comp[map[1]].step + y * out->linesize[map[1]]);
-    float *b_out = (float *)(out->data[map[2]] + x * desc->comp[map[2]].step + y * out->linesize[map[2]]);
-    float sig, sig_orig;
-
-    /* load values */
-    *r_out = *r_in;
-    *g_out = *g_in;
-    *b_out = *b_in;
-
-    /* desaturate to prevent unnatural colors */
-    if (s->desat > 0) {
-        float luma = av_q2d(s->coeffs->cr) * *r_in + av_q2d(s->coeffs->cg) * *g_in + av_q2d(s->coeffs->cb) * *b_in;
-        float overbright = FFMAX(luma - s->desat, 1e-6) / FFMAX(luma, 1e-6);
-        *r_out = MIX(*r_in, luma, overbright);
-        *g_out = MIX(*g_in, luma, overbright);
-        *b_out = MIX(*b_in, luma, overbright);
-    }
-
-    /* pick the brightest component, reducing the value range as necessary
-     * to keep the entire signal in range and preventing discoloration due to
-     * out-of-bounds clipping */
-    sig = FFMAX(FFMAX3(*r_out, *g_out, *b_out), 1e-6);
-    sig_orig = sig;
-
     switch(s->tonemap) {
     default:
     case TONEMAP_NONE:
@@ -163,11 +137,85 @@ static void tonemap(TonemapContext *s, AVFrame *out, const AVFrame *in,
         break;
     }
 
-    /* apply the computed scale factor to the color,
-     * linearly to prevent discoloration */
-    *r_out *= sig / sig_orig;
-    *g_out *= sig / sig_orig;
-    *b_out *= sig / sig_orig;
+    return sig;
+}
+
+static int curve_uses_lut(enum TonemapAlgorithm tonemap)
+{
+    return tonemap == TONEMAP_GAMMA    || tonemap == TONEMAP_HABLE ||
+           tonemap == TONEMAP_REINHARD || tonemap == TONEMAP_MOBIUS;
+}
+
+/* sample the curve over [0, peak] with square-root spacing, so the dark
+ * part where most of the SDR signal lives gets the densest sampling; the
+ * curve only depends on the peak once the filter is configured, so the
+ * table is rebuilt only when the peak changes */
+static void update_lut(TonemapContext *s, double peak)
+{
+    if (!curve_uses_lut(s->tonemap) || s->lut_peak == peak)
+        return;
+
+    for (int i = 0; i <= LUT_SIZE; i++) {
+        double x = i / (double)LUT_SIZE;
+        s->lut[i] = tonemap_curve(s, FFMAX(x * x * peak, 1e-6), peak);
+    }
+    s->lut_peak = peak;
+}
+
+static av_always_inline float lut_curve(const TonemapContext *s, float sig,
+                                        float scale, double peak)
+{
+    float pos;
+    int i;
+
+    /* out of range values are rare, evaluate them exactly */
+    if (sig >= peak)
+        return tonemap_curve(s, sig, peak);
+
+    pos = sqrtf(sig * scale) * LUT_SIZE;
+    i = FFMIN(pos, LUT_SIZE - 1);
+    return s->lut[i] + (s->lut[i + 1] - s->lut[i]) * (pos - i);
+}
+
+#define MIX(x,y,a) (x) * (1 - (a)) + (y) * (a)
+static av_always_inline void tonemap_row(const TonemapContext *s,
+                                         float *r_out, float *g_out, float *b_out,
+                                         const float *r_in, const float *g_in,
+                                         const float *b_in, int width,
+                                         double peak, int use_lut)
+{
+    const float desat = s->desat;
+    const float cr = s->desat > 0 ? av_q2d(s->coeffs->cr) : 0.f;
+    const float cg = s->desat > 0 ? av_q2d(s->coeffs->cg) : 0.f;
+    const float cb = s->desat > 0 ? av_q2d(s->coeffs->cb) : 0.f;
+    const float scale = 1.0 / peak;
+
+    for (int x = 0; x < width; x++) {
+        float r = r_in[x], g = g_in[x], b = b_in[x];
+        float sig, gain;
+
+        /* desaturate to prevent unnatural colors */
+        if (desat > 0) {
+            float luma = cr * r + cg * g + cb * b;
+            float overbright = FFMAX(luma - desat, 1e-6) / FFMAX(luma, 1e-6);
+            r = MIX(r, luma, overbright);
+            g = MIX(g, luma, overbright);
+            b = MIX(b, luma, overbright);
+        }
+
+        /* pick the brightest component, reducing the value range as necessary
+         * to keep the entire signal in range and preventing discoloration due to
+         * out-of-bounds clipping */
+        sig = FFMAX(FFMAX3(r, g, b), 1e-6);
+        gain = (use_lut ? lut_curve(s, sig, scale, peak)
+                        : tonemap_curve(s, sig, peak)) / sig;
+
+        /* apply the computed scale factor to the color,
+         * linearly to prevent discoloration */
+        r_out[x] = r * gain;
+        g_out[x] = g * gain;
+        b_out[x] = b * gain;
+    }
 }
 
 typedef struct ThreadData {
@@ -185,11 +233,23 @@ static int tonemap_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs
     const AVPixFmtDescriptor *desc = td->desc;
     const int slice_start = (in->height * jobnr) / nb_jobs;
     const int slice_end = (in->height * (jobnr+1)) / nb_jobs;
+    const int use_lut = curve_uses_lut(s->tonemap);
+    const int map[3] = { desc->comp[0].plane, desc->comp[1].plane, desc->comp[2].plane };
     double peak = td->peak;
 
-    for (int y = slice_start; y < slice_end; y++)
-        for (int x = 0; x < out->width; x++)
-            tonemap(s, out, in, desc, x, y, peak);
+    for (int y = slice_start; y < slice_end; y++) {
+        const float *r_in = (const float *)(in->data[map[0]] + y * in->linesize[map[0]]);
+        const float *g_in = (const float *)(in->data[map[1]] + y * in->linesize[map[1]]);
+        const float *b_in = (const float *)(in->data[map[2]] + y * in->linesize[map[2]]);
+        float *r_out = (float *)(out->data[map[0]] + y * out->linesize[map[0]]);
+        float *g_out = (float *)(out->data[map[1]] + y * out->linesize[map[1]]);
+        float *b_out = (float *)(out->data[map[2]] + y * out->linesize[map[2]]);
+
+        if (use_lut)
+            tonemap_row(s, r_out, g_out, b_out, r_in, g_in, b_in, out->width, peak, 1);
+        else
+            tonemap_row(s, r_out, g_out, b_out, r_in, g_in, b_in, out->width, peak, 0);
+    }
 
     return 0;
 }
@@ -249,6 +309,8 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
         s->desat = 0;
     }
 
+    update_lut(s, peak);
+
     /* do the tone map */
     td.out = out;
     td.in = in;
@@ -28,6 +28,7 @@
  */
 
 #include "libavutil/avassert.h"
+#include "libavutil/buffer.h"
 #include "libavutil/imgutils.h"
 #include "libavutil/mem.h"
 #include "libavutil/mem_internal.h"
@@ -35,6 +36,7 @@
 #include "libavutil/pixdesc.h"
 #include "libavutil/video_enc_params.h"
 #include "libavcodec/avcodec.h"
+#include "libavcodec/avdct.h"
 
 #include "filters.h"
 #include "qp_table.h"
@@ -44,6 +46,12 @@
 #define MAX_LEVEL 8 /* quality levels */
 #define BLOCK 16
 
+enum mode {
+    MODE_CODEC,
+    MODE_DCT,
+    NB_MODES
+};
+
 typedef struct USPPContext {
     const AVClass *av_class;
     int log2_count;
@@ -51,12 +59,14 @@ typedef struct USPPContext {
     int hsub, vsub;
     int qp;
     char *codec_name;
+    int mode;
     enum AVVideoEncParamsType qscale_type;
     int temp_stride[3];
+    int plane_w[3], plane_h[3];
+    AVBufferRef *src_buf[3];
     uint8_t *src[3];
     uint16_t *temp[3];
-    int outbuf_size;
-    uint8_t *outbuf;
+    AVDCT *dct;
     AVCodecContext *avctx_enc[BLOCK*BLOCK];
     AVCodecContext *avctx_dec[BLOCK*BLOCK];
     AVPacket *pkt            [BLOCK*BLOCK];
@@ -66,6 +76,7 @@ typedef struct USPPContext {
     int non_b_qp_stride;
     int use_bframe_qp;
     int quality;
+    int job_ret[BLOCK*BLOCK];
 } USPPContext;
 
 #define OFFSET(x) offsetof(USPPContext, x)
@@ -75,6 +86,9 @@ static const AVOption uspp_options[] = {
     { "qp",            "force a constant quantizer parameter", OFFSET(qp),            AV_OPT_TYPE_INT, {.i64 = 0}, 0, 63,        FLAGS },
     { "use_bframe_qp", "use B-frames' QP",                     OFFSET(use_bframe_qp), AV_OPT_TYPE_BOOL,{.i64 = 0}, 0, 1,         FLAGS },
     { "codec",         "Codec name",                           OFFSET(codec_name),    AV_OPT_TYPE_STRING, {.str = "snow"}, 0, 0, FLAGS },
+    { "mode",          "set requantization mode",              OFFSET(mode),          AV_OPT_TYPE_INT, {.i64 = MODE_CODEC}, 0, NB_MODES - 1, FLAGS, .unit = "mode" },
+        { "codec", "encode and decode with the codec",   0, AV_OPT_TYPE_CONST, {.i64 = MODE_CODEC}, 0, 0, FLAGS, .unit = "mode" },
+        { "dct",   "requantize 8x8 DCT blocks directly", 0, AV_OPT_TYPE_CONST, {.i64 = MODE_DCT},   0, 0, FLAGS, .unit = "mode" },
     { NULL }
 };
 
@@ -193,37 +207,114 @@ static void store_slice_c(uint8_t *dst, const uint16_t *src,
     }
 }
 
+static void requantize_c(int16_t dst[64], const int16_t src[64],
+                         int qp, const uint8_t *permutation)
+{
+    const int step = qp << 4;
+    const int odd  = (qp & 1) - 1;
+
+    memset(dst, 0, 64 * sizeof(dst[0]));
+    dst[0] = ((src[0] + 32) >> 6) * 8;
+
+    for (int i = 1; i < 64; i++) {
+        const int level = src[i];
+        const int q = FFABS(level) / step;
+
+        if (q) {
+            const int v = (2 * q + 1) * qp + odd;
+
+            dst[permutation[i]] = level < 0 ? -v : v;
+        }
+    }
+}
+
+static int filter_dct_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    USPPContext *p = ctx->priv;
+    uint8_t **dst = arg;
+    const int count = p->count;
+    const int qp = FFMAX(1, p->quality / FF_QP2LAMBDA);
+    DECLARE_ALIGNED(16, int16_t, block)[64];
+    DECLARE_ALIGNED(16, int16_t, block2)[64];
+
+    for (int j = 0; j < 3; j++) {
+        const int is_chroma = !!j;
+        const int w = p->plane_w[j];
+        const int h = p->plane_h[j];
+        const int pad = BLOCK >> (is_chroma ? p->hsub : 0);
+        const int stride = p->temp_stride[j];
+        const int slice_start = pad + (h * jobnr) / nb_jobs;
+        const int slice_end   = pad + (h * (jobnr+1)) / nb_jobs;
+        uint16_t *temp = p->temp[j];
+
+        if (!dst[j])
+            continue;
+
+        for (int i = 0; i < count; i++) {
+            const int x1 = offset[i+count-1][0] >> (is_chroma ? p->hsub : 0);
+            const int y1 = offset[i+count-1][1] >> (is_chroma ? p->vsub : 0);
+
+            for (int by = y1 + ((slice_start - y1) & ~7); by < slice_end; by += 8) {
+                const int r0 = FFMAX(by, slice_start);
+                const int r1 = FFMIN(by + 8, slice_end);
+
+                for (int bx = x1; bx < pad + w; bx += 8) {
+                    const int c0 = FFMAX(bx, pad);
+                    const int c1 = FFMIN(bx + 8, pad + w);
+
+                    p->dct->get_pixels_unaligned(block, p->src[j] + bx + by * stride, stride);
+                    p->dct->fdct(block);
+                    requantize_c(block2, block, qp, p->dct->idct_permutation);
+                    p->dct->idct(block2);
+
+                    for (int y = r0; y < r1; y++) {
+                        uint16_t *t = temp + (y - pad) * stride - pad;
+                        const int16_t *b = block2 + (y - by) * 8;
+
+                        for (int x = c0; x < c1; x++)
+                            t[x] += av_clip_uint8(b[x - bx]);
+                    }
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
 static int filter_1phase(AVFilterContext *ctx, void *arg, int i, int nb_jobs)
 {
     USPPContext *p = ctx->priv;
-    int ret, x, y;
-    int width  = ctx->inputs[0]->w;
-    int height = ctx->inputs[0]->h;
+    int ret;
 
     const int x1 = offset[i+nb_jobs-1][0];
     const int y1 = offset[i+nb_jobs-1][1];
     const int x1c = x1 >> p->hsub;
     const int y1c = y1 >> p->vsub;
-    const int BLOCKc = BLOCK >> p->hsub;
-    int offset;
+    AVFrame *frame = p->frame[i];
     AVPacket *pkt = p->pkt[i];
 
-    av_packet_unref(pkt);
-    pkt->data = p->outbuf;
-    pkt->size = p->outbuf_size;
-
-    p->frame[i]->linesize[0] = p->temp_stride[0];
-    p->frame[i]->linesize[1] = p->temp_stride[1];
-    p->frame[i]->linesize[2] = p->temp_stride[2];
-    p->frame[i]->height = height + BLOCK;
-    p->frame[i]->width  = width + BLOCK;
-    p->frame[i]->data[0] = p->src[0] + x1   + y1   * p->frame[i]->linesize[0];
-    p->frame[i]->data[1] = p->src[1] + x1c  + y1c  * p->frame[i]->linesize[1];
-    p->frame[i]->data[2] = p->src[2] + x1c  + y1c  * p->frame[i]->linesize[2];
-    p->frame[i]->format  = p->avctx_enc[i]->pix_fmt;
-    p->frame[i]->quality = p->quality;
-
-    ret = avcodec_send_frame(p->avctx_enc[i], p->frame[i]);
+    /* every instance references the same padded planes, so the encoder
+     * does not have to make its own copy of the input */
+    for (int j = 0; j < 3; j++) {
+        const int xo = j ? x1c : x1;
+        const int yo = j ? y1c : y1;
+
+        frame->buf[j] = av_buffer_ref(p->src_buf[j]);
+        if (!frame->buf[j]) {
+            av_frame_unref(frame);
+            return AVERROR(ENOMEM);
+        }
+        frame->linesize[j] = p->temp_stride[j];
+        frame->data[j] = p->src[j] + xo + yo * frame->linesize[j];
+    }
+    frame->height  = ctx->inputs[0]->h + BLOCK;
+    frame->width   = ctx->inputs[0]->w + BLOCK;
+    frame->format  = p->avctx_enc[i]->pix_fmt;
+    frame->quality = p->quality;
+
+    ret = avcodec_send_frame(p->avctx_enc[i], frame);
+    av_frame_unref(frame);
     if (ret < 0) {
         av_log(p->avctx_enc[i], AV_LOG_ERROR, "Error sending a frame for encoding\n");
         return ret;
@@ -255,57 +346,89 @@ static int filter_1phase(AVFilterContext *ctx, void *arg, int i, int nb_jobs)
         }
     }
 
-    offset = (BLOCK-x1) + (BLOCK-y1) * p->frame_dec[i]->linesize[0];
+    return 0;
+}
 
-    for (y = 0; y < height; y++)
-        for (x = 0; x < width; x++)
-            p->temp[0][x + y * p->temp_stride[0]] += p->frame_dec[i]->data[0][x + y * p->frame_dec[i]->linesize[0] + offset];
+static int accumulate_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    USPPContext *p = ctx->priv;
+    uint8_t **dst = arg;
+    const int count = p->count;
+
+    for (int j = 0; j < 3; j++) {
+        const int is_chroma = !!j;
+        const int w = p->plane_w[j];
+        const int h = p->plane_h[j];
+        const int block = BLOCK >> (is_chroma ? p->hsub : 0);
+        const int slice_start = (h * jobnr) / nb_jobs;
+        const int slice_end   = (h * (jobnr+1)) / nb_jobs;
+        uint16_t *temp = p->temp[j] + slice_start * p->temp_stride[j];
 
+        if (!dst[j])
+            continue;
+
+        for (int i = 0; i < count; i++) {
+            const AVFrame *dec = p->frame_dec[i];
+            const int x1 = offset[i+count-1][0] >> (is_chroma ? p->hsub : 0);
+            const int y1 = offset[i+count-1][1] >> (is_chroma ? p->vsub : 0);
+            const ptrdiff_t linesize = dec->linesize[j];
+            const uint8_t *src;
+            uint16_t *t = temp;
 
-    if (!p->frame_dec[i]->data[2] || !p->temp[2])
-        return 0;
+            if (is_chroma && !dec->data[2])
+                break;
 
-    offset = (BLOCKc-x1c) + (BLOCKc-y1c) * p->frame_dec[i]->linesize[1];
+            src = dec->data[j] + (block - x1) + (block - y1 + slice_start) * linesize;
+            for (int y = slice_start; y < slice_end; y++) {
+                for (int x = 0; x < w; x++)
+                    t[x] += src[x];
 
-    for (y = 0; y < AV_CEIL_RSHIFT(height, p->vsub); y++) {
-        for (x = 0; x < AV_CEIL_RSHIFT(width, p->hsub); x++) {
-            p->temp[1][x + y * p->temp_stride[1]] += p->frame_dec[i]->data[1][x + y * p->frame_dec[i]->linesize[1] + offset];
-            p->temp[2][x + y * p->temp_stride[2]] += p->frame_dec[i]->data[2][x + y * p->frame_dec[i]->linesize[2] + offset];
+                t   += p->temp_stride[j];
+                src += linesize;
+            }
         }
     }
 
     return 0;
 }
 
-static void filter(AVFilterContext *ctx, uint8_t *dst[3], uint8_t *src[3],
-                   int dst_stride[3], int src_stride[3], int width,
-                   int height, uint8_t *qp_store, int qp_stride)
+static int filter(AVFilterContext *ctx, uint8_t *dst[3], uint8_t *src[3],
+                  int dst_stride[3], int src_stride[3], int width,
+                  int height, uint8_t *qp_store, int qp_stride)
 {
     USPPContext *p = ctx->priv;
-    int x, y, i, j;
+    const int nb_jobs = FFMIN(p->plane_h[0], ff_filter_get_nb_threads(ctx));
+    int x, y, i, j, ret;
 
     for (i = 0; i < 3; i++) {
         int is_chroma = !!i;
-        int w = AV_CEIL_RSHIFT(width,  is_chroma ? p->hsub : 0);
-        int h = AV_CEIL_RSHIFT(height, is_chroma ? p->vsub : 0);
+        int w = p->plane_w[i];
+        int h = p->plane_h[i];
         int stride = p->temp_stride[i];
         int block = BLOCK >> (is_chroma ? p->hsub : 0);
+        int pad = FFMAX(block, 8);
 
         if (!src[i] || !dst[i])
             continue;
+
+        ret = av_buffer_make_writable(&p->src_buf[i]);
+        if (ret < 0)
+            return ret;
+        p->src[i] = p->src_buf[i]->data;
+
         for (y = 0; y < h; y++) {
             int index = block + block * stride + y * stride;
 
             memcpy(p->src[i] + index, src[i] + y * src_stride[i], w );
-            for (x = 0; x < block; x++) {
+            for (x = 0; x < block; x++)
                 p->src[i][index     - x - 1] = p->src[i][index +     x    ];
-                p->src[i][index + w + x    ] = p->src[i][index + w - x - 1];
-            }
+            for (x = 0; x < pad; x++)
+                p->src[i][index + w + x    ] = p->src[i][index + FFMAX(w - x - 1, 0)];
         }
-        for (y = 0; y < block; y++) {
+        for (y = 0; y < block; y++)
             memcpy(p->src[i] + (  block-1-y) * stride, p->src[i] + (  y+block  ) * stride, stride);
-            memcpy(p->src[i] + (h+block  +y) * stride, p->src[i] + (h-y+block-1) * stride, stride);
-        }
+        for (y = 0; y < pad; y++)
+            memcpy(p->src[i] + (h+block  +y) * stride, p->src[i] + (FFMAX(h-y-1, 0)+block) * stride, stride);
 
         memset(p->temp[i], 0, (h + 2 * block) * stride * sizeof(int16_t));
     }
@@ -324,17 +447,25 @@ static void filter(AVFilterContext *ctx, uint8_t *dst[3], uint8_t *src[3],
     }
 //    init per MB qscale stuff FIXME
 
-    ff_filter_execute(ctx, filter_1phase, NULL, NULL, p->count);
+    if (p->mode == MODE_DCT) {
+        ff_filter_execute(ctx, filter_dct_slice, dst, NULL, nb_jobs);
+    } else {
+        ff_filter_execute(ctx, filter_1phase, NULL, p->job_ret, p->count);
+        for (i = 0; i < p->count; i++) {
+            if (p->job_ret[i] < 0)
+                return p->job_ret[i];
+        }
+        ff_filter_execute(ctx, accumulate_slice, dst, NULL, nb_jobs);
+    }
 
     for (j = 0; j < 3; j++) {
-        int is_chroma = !!j;
         if (!dst[j])
             continue;
         store_slice_c(dst[j], p->temp[j], dst_stride[j], p->temp_stride[j],
-                      AV_CEIL_RSHIFT(width,  is_chroma ? p->hsub : 0),
-                      AV_CEIL_RSHIFT(height, is_chroma ? p->vsub : 0),
-                      8-p->log2_count);
+                      p->plane_w[j], p->plane_h[j], 8-p->log2_count);
     }
+
+    return 0;
 }
 
 static const enum AVPixelFormat pix_fmts[] = {
@@ -355,17 +486,8 @@ static int config_input(AVFilterLink *inlink)
     const int height = inlink->h;
     const int width  = inlink->w;
     const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(inlink->format);
+    const AVCodec *enc, *dec;
     int i;
-    const AVCodec *enc = avcodec_find_encoder_by_name(uspp->codec_name);
-    const AVCodec *dec = avcodec_find_decoder_by_name(uspp->codec_name);
-    if (!enc) {
-        av_log(ctx, AV_LOG_ERROR, "encoder %s not found.\n", uspp->codec_name);
-        return AVERROR(EINVAL);
-    }
-    if (!dec) {
-        av_log(ctx, AV_LOG_ERROR, "decoder %s not found.\n", uspp->codec_name);
-        return AVERROR(EINVAL);
-    }
 
     uspp->hsub = desc->log2_chroma_w;
     uspp->vsub = desc->log2_chroma_h;
@@ -373,19 +495,41 @@ static int config_input(AVFilterLink *inlink)
 
     for (i = 0; i < 3; i++) {
         int is_chroma = !!i;
-        int w = (width  + 4 * BLOCK-1) & (~(2 * BLOCK-1));
-        int h = (height + 4 * BLOCK-1) & (~(2 * BLOCK-1));
+        /* leave room for the 8x8 blocks of the dct mode to run past the
+         * right and bottom borders of the subsampled planes */
+        int w = (width  + 6 * BLOCK-1) & (~(2 * BLOCK-1));
+        int h = (height + 6 * BLOCK-1) & (~(2 * BLOCK-1));
 
         if (is_chroma) {
             w = AV_CEIL_RSHIFT(w, uspp->hsub);
             h = AV_CEIL_RSHIFT(h, uspp->vsub);
         }
 
+        uspp->plane_w[i] = AV_CEIL_RSHIFT(width,  is_chroma ? uspp->hsub : 0);
+        uspp->plane_h[i] = AV_CEIL_RSHIFT(height, is_chroma ? uspp->vsub : 0);
         uspp->temp_stride[i] = w;
         if (!(uspp->temp[i] = av_malloc_array(uspp->temp_stride[i], h * sizeof(int16_t))))
             return AVERROR(ENOMEM);
-        if (!(uspp->src [i] = av_malloc_array(uspp->temp_stride[i], h * sizeof(uint8_t))))
+        if (!(uspp->src_buf[i] = av_buffer_allocz(uspp->temp_stride[i] * h)))
+            return AVERROR(ENOMEM);
+        uspp->src[i] = uspp->src_buf[i]->data;
+    }
+
+    if (uspp->mode == MODE_DCT) {
+        if (!(uspp->dct = avcodec_dct_alloc()))
             return AVERROR(ENOMEM);
+        return avcodec_dct_init(uspp->dct);
+    }
+
+    enc = avcodec_find_encoder_by_name(uspp->codec_name);
+    dec = avcodec_find_decoder_by_name(uspp->codec_name);
+    if (!enc) {
+        av_log(ctx, AV_LOG_ERROR, "encoder %s not found.\n", uspp->codec_name);
+        return AVERROR(EINVAL);
+    }
+    if (!dec) {
+        av_log(ctx, AV_LOG_ERROR, "decoder %s not found.\n", uspp->codec_name);
+        return AVERROR(EINVAL);
     }
 
     for (i = 0; i < uspp->count; i++) {
@@ -438,10 +582,6 @@ static int config_input(AVFilterLink *inlink)
             return AVERROR(ENOMEM);
     }
 
-    uspp->outbuf_size = (width + BLOCK) * (height + BLOCK) * 10;
-    if (!(uspp->outbuf = av_malloc(uspp->outbuf_size)))
-        return AVERROR(ENOMEM);
-
     return 0;
 }
 
@@ -500,8 +640,16 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
                 out->height = in->height;
             }
 
-            filter(ctx, out->data, in->data, out->linesize, in->linesize,
-                   inlink->w, inlink->h, qp_table, qp_stride);
+            ret = filter(ctx, out->data, in->data, out->linesize, in->linesize,
+                         inlink->w, inlink->h, qp_table, qp_stride);
+            if (ret < 0) {
+                if (out != in)
+                    av_frame_free(&out);
+                av_frame_free(&in);
+                if (qp_table != uspp->non_b_qp_table)
+                    av_free(qp_table);
+                return ret;
+            }
         }
     }
 
@@ -525,7 +673,7 @@ static av_cold void uninit(AVFilterContext *ctx)
 
     for (i = 0; i < 3; i++) {
         av_freep(&uspp->temp[i]);
-        av_freep(&uspp->src[i]);
+        av_buffer_unref(&uspp->src_buf[i]);
     }
 
     for (i = 0; i < uspp->count; i++) {
@@ -537,7 +685,7 @@ static av_cold void uninit(AVFilterContext *ctx)
     }
 
     av_freep(&uspp->non_b_qp_table);
-    av_freep(&uspp->outbuf);
+    av_freep(&uspp->dct);
 }
 
 static const AVFilterPad uspp_inputs[] = {
@@ -4259,6 +4259,19 @@ static int allocate_plane(V360Context *s, int sizeof_uv, int sizeof_ker, int siz
             if (!r->mask)
                 return AVERROR(ENOMEM);
         }
+
+        if (s->cache_vec) {
+            if (!r->vec[p])
+                r->vec[p] = av_calloc(s->pr_width[p] * height, 3 * sizeof(float));
+            if (!r->vec[p])
+                return AVERROR(ENOMEM);
+            if (sizeof_mask && !p) {
+                if (!r->out_mask)
+                    r->out_mask = av_calloc(s->pr_width[p], height);
+                if (!r->out_mask)
+                    return AVERROR(ENOMEM);
+            }
+        }
     }
 
     return 0;
@@ -4367,6 +4380,7 @@ static int v360_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
         const int slice_start = (height *  jobnr     ) / nb_jobs;
         const int slice_end   = (height * (jobnr + 1)) / nb_jobs;
         const int elements = s->elements;
+        const int vec_valid = s->vec_valid;
         float du, dv;
         float vec[3];
         XYRemap rmap;
@@ -4378,14 +4392,31 @@ static int v360_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
                 int16_t *ker = r->ker[p] + ((j - slice_start) * uv_linesize + i) * elements;
                 uint8_t *mask8 = p ? NULL : r->mask + ((j - slice_start) * s->pr_width[0] + i);
                 uint16_t *mask16 = p ? NULL : (uint16_t *)r->mask + ((j - slice_start) * s->pr_width[0] + i);
-                int in_mask, out_mask;
-
-                if (s->out_transpose)
-                    out_mask = s->out_transform(s, j, i, height, width, vec);
-                else
-                    out_mask = s->out_transform(s, i, j, width, height, vec);
-                offset_vector(vec, s->h_offset, s->v_offset);
-                normalize_vector(vec);
+                float *cvec = r->vec[p] ? r->vec[p] + ((j - slice_start) * width + i) * 3 : NULL;
+                uint8_t *cmask = p || !r->out_mask ? NULL : r->out_mask + ((j - slice_start) * width + i);
+                int in_mask, out_mask = 0;
+
+                if (vec_valid) {
+                    vec[0] = cvec[0];
+                    vec[1] = cvec[1];
+                    vec[2] = cvec[2];
+                    if (cmask)
+                        out_mask = cmask[0];
+                } else {
+                    if (s->out_transpose)
+                        out_mask = s->out_transform(s, j, i, height, width, vec);
+                    else
+                        out_mask = s->out_transform(s, i, j, width, height, vec);
+                    offset_vector(vec, s->h_offset, s->v_offset);
+                    normalize_vector(vec);
+                    if (cvec) {
+                        cvec[0] = vec[0];
+                        cvec[1] = vec[1];
+                        cvec[2] = vec[2];
+                    }
+                    if (cmask)
+                        cmask[0] = out_mask;
+                }
                 av_assert1(!isnan(vec[0]) && !isnan(vec[1]) && !isnan(vec[2]));
                 rotate(s->rot_quaternion, vec);
                 av_assert1(!isnan(vec[0]) && !isnan(vec[1]) && !isnan(vec[2]));
@@ -5027,11 +5058,20 @@ static int config_output(AVFilterLink *outlink)
 
     set_mirror_modifier(s->h_flip, s->v_flip, s->d_flip, s->output_mirror_modifier);
 
-    ff_filter_execute(ctx, v360_slice, NULL, NULL, s->nb_threads);
+    s->update_remap = 1;
 
     return 0;
 }
 
+static int update_remap_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    V360Context *s = ctx->priv;
+
+    v360_slice(ctx, NULL, jobnr, nb_jobs);
+
+    return s->remap_slice(ctx, arg, jobnr, nb_jobs);
+}
+
 static int filter_frame(AVFilterLink *inlink, AVFrame *in)
 {
     AVFilterContext *ctx = inlink->dst;
@@ -5050,7 +5090,14 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     td.in = in;
     td.out = out;
 
-    ff_filter_execute(ctx, s->remap_slice, &td, NULL, s->nb_threads);
+    if (s->update_remap) {
+        /* every slice recalculates the remap data it uses right away */
+        ff_filter_execute(ctx, update_remap_slice, &td, NULL, s->nb_threads);
+        s->vec_valid = !!s->cache_vec;
+        s->update_remap = 0;
+    } else {
+        ff_filter_execute(ctx, s->remap_slice, &td, NULL, s->nb_threads);
+    }
 
     av_frame_free(&in);
     return ff_filter_frame(outlink, out);
@@ -5080,6 +5127,13 @@ static int process_command(AVFilterContext *ctx, const char *cmd, const char *ar
     if (s->reset_rot)
         reset_rot(s);
 
+    /* the output vectors before rotation only depend on the output options */
+    s->cache_vec = 1;
+    if (!strcmp(cmd, "out_pad") || !strcmp(cmd, "fout_pad") ||
+        !strcmp(cmd, "h_fov") || !strcmp(cmd, "v_fov") || !strcmp(cmd, "d_fov") ||
+        !strcmp(cmd, "h_offset") || !strcmp(cmd, "v_offset"))
+        s->vec_valid = 0;
+
     return config_output(ctx->outputs[0]);
 }
 
@@ -5103,9 +5157,11 @@ static av_cold void uninit(AVFilterContext *ctx)
             av_freep(&r->u[p]);
             av_freep(&r->v[p]);
             av_freep(&r->ker[p]);
+            av_freep(&r->vec[p]);
         }
 
         av_freep(&r->mask);
+        av_freep(&r->out_mask);
     }
 
     av_freep(&s->slice_remap);
@@ -76,8 +76,10 @@ typedef struct VectorscopeContext {
     int cs;
     uint8_t *peak_memory;
     uint8_t **peak;
+    uint16_t *maps;
+    int nb_maps;
 
-    void (*vectorscope)(struct VectorscopeContext *s,
+    void (*vectorscope)(AVFilterContext *ctx,
                         AVFrame *in, AVFrame *out, int pd);
     void (*graticulef)(struct VectorscopeContext *s, AVFrame *out,
                        int X, int Y, int D, int P);
@@ -208,9 +210,14 @@ static int query_formats(const AVFilterContext *ctx,
     return ff_formats_ref(formats, &cfg_out[0]->formats);
 }
 
+/* Upper bound for the memory used by the per-thread plotting maps */
+#define MAX_MAPS_SIZE (128 << 20)
+
 static int config_output(AVFilterLink *outlink)
 {
-    VectorscopeContext *s = outlink->src->priv;
+    AVFilterContext *ctx = outlink->src;
+    VectorscopeContext *s = ctx->priv;
+    const size_t map_size = (size_t)s->size * s->size * sizeof(*s->maps);
     int i;
 
     outlink->h = outlink->w = s->size;
@@ -227,9 +234,162 @@ static int config_output(AVFilterLink *outlink)
     for (i = 0; i < s->size; i++)
         s->peak[i] = s->peak_memory + s->size * i;
 
+    s->nb_maps = FFMIN(ff_filter_get_nb_threads(ctx), FFMAX(MAX_MAPS_SIZE / map_size, 1));
+    s->maps = av_calloc(s->nb_maps, map_size);
+    if (!s->maps)
+        return AVERROR(ENOMEM);
+
     return 0;
 }
 
+typedef struct ThreadData {
+    AVFrame *in, *out;
+    int pd;
+} ThreadData;
+
+/*
+ * Plotting is split in two steps, so that it can run on several threads:
+ * every job first records the hits of its slice of input rows in its own
+ * map, then the maps are combined and the scope is drawn from the result.
+ * A map holds the saturated number of hits per position, or for COLOR4
+ * the largest hitting value plus one.
+ */
+#define PLOT_SLICE(name, type)                                                  \
+static int name(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)        \
+{                                                                               \
+    VectorscopeContext *s = ctx->priv;                                          \
+    ThreadData *td = arg;                                                       \
+    const AVFrame *in = td->in;                                                 \
+    const int px = s->x, py = s->y, pd = td->pd;                                \
+    const ptrdiff_t slinesizex = in->linesize[px] / sizeof(type);               \
+    const ptrdiff_t slinesizey = in->linesize[py] / sizeof(type);               \
+    const ptrdiff_t slinesized = in->linesize[pd] / sizeof(type);               \
+    const type *spx = (const type *)in->data[px];                               \
+    const type *spy = (const type *)in->data[py];                               \
+    const type *spd = (const type *)in->data[pd];                               \
+    const int size = s->size;                                                   \
+    const int max = size - 1;                                                   \
+    const int tmin = s->tmin;                                                   \
+    const int tmax = s->tmax;                                                   \
+    uint16_t *map = s->maps + jobnr * (size_t)size * size;                      \
+                                                                                \
+    memset(map, 0, size * (size_t)size * sizeof(*map));                        \
+                                                                                \
+    if (s->mode == COLOR4) {                                                    \
+        const int hsub = s->hsub;                                               \
+        const int vsub = s->vsub;                                               \
+        const int slice_start = (in->height *  jobnr     ) / nb_jobs;           \
+        const int slice_end   = (in->height * (jobnr + 1)) / nb_jobs;           \
+                                                                                \
+        for (int i = slice_start; i < slice_end; i++) {                         \
+            const ptrdiff_t iwx = (i >> vsub) * slinesizex;                     \
+            const ptrdiff_t iwy = (i >> vsub) * slinesizey;                     \
+            const ptrdiff_t iwd = i * slinesized;                               \
+            for (int j = 0; j < in->width; j++) {                               \
+                const int x = FFMIN(spx[iwx + (j >> hsub)], max);               \
+                const int y = FFMIN(spy[iwy + (j >> hsub)], max);               \
+                const int z = spd[iwd + j];                                     \
+                const ptrdiff_t pos = y * size + x;                             \
+                                                                                \
+                if (z < tmin || z > tmax)                                       \
+                    continue;                                                   \
+                                                                                \
+                map[pos] = FFMAX(map[pos], z + 1);                              \
+            }                                                                   \
+        }                                                                       \
+    } else {                                                                    \
+        const int w = s->planewidth[px];                                        \
+        const int slice_start = (s->planeheight[py] *  jobnr     ) / nb_jobs;   \
+        const int slice_end   = (s->planeheight[py] * (jobnr + 1)) / nb_jobs;   \
+                                                                                \
+        for (int i = slice_start; i < slice_end; i++) {                         \
+            const ptrdiff_t iwx = i * slinesizex;                               \
+            const ptrdiff_t iwy = i * slinesizey;                               \
+            const ptrdiff_t iwd = i * slinesized;                               \
+            for (int j = 0; j < w; j++) {                                       \
+                const int x = FFMIN(spx[iwx + j], max);                         \
+                const int y = FFMIN(spy[iwy + j], max);                         \
+                const int z = spd[iwd + j];                                     \
+                const ptrdiff_t pos = y * size + x;                             \
+                                                                                \
+                if (z < tmin || z > tmax)                                       \
+                    continue;                                                   \
+                                                                                \
+                map[pos] += map[pos] < UINT16_MAX;                              \
+            }                                                                   \
+        }                                                                       \
+    }                                                                           \
+                                                                                \
+    return 0;                                                                   \
+}
+
+PLOT_SLICE(plot_slice8,  uint8_t)
+PLOT_SLICE(plot_slice16, uint16_t)
+
+/*
+ * Adding the intensity n times with saturation is the same as adding
+ * n * intensity once, and n never needs to exceed size to saturate.
+ */
+#define DRAW_SLICE(name, type)                                                  \
+static int name(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)        \
+{                                                                               \
+    VectorscopeContext *s = ctx->priv;                                          \
+    ThreadData *td = arg;                                                       \
+    const AVFrame *out = td->out;                                               \
+    const ptrdiff_t dlinesize = out->linesize[0] / sizeof(type);                \
+    type *dpx = (type *)out->data[s->x];                                        \
+    type *dpy = (type *)out->data[s->y];                                        \
+    type *dpd = (type *)out->data[td->pd];                                      \
+    const int intensity = s->intensity;                                         \
+    const int size = s->size;                                                   \
+    const int max = size - 1;                                                   \
+    const int mid = size / 2;                                                   \
+    const int slice_start = (size *  jobnr     ) / nb_jobs;                     \
+    const int slice_end   = (size * (jobnr + 1)) / nb_jobs;                     \
+                                                                                \
+    for (int y = slice_start; y < slice_end; y++) {                             \
+        for (int x = 0; x < size; x++) {                                        \
+            const uint16_t *map = s->maps + y * size + x;                       \
+            const ptrdiff_t pos = y * dlinesize + x;                            \
+            unsigned v = 0;                                                     \
+                                                                                \
+            if (s->mode == COLOR4) {                                            \
+                for (int m = 0; m < s->nb_maps; m++)                            \
+                    v = FFMAX(v, map[m * (size_t)size * size]);                 \
+            } else {                                                            \
+                for (int m = 0; m < s->nb_maps; m++)                            \
+                    v += map[m * (size_t)size * size];                          \
+            }                                                                   \
+                                                                                \
+            if (!v)                                                             \
+                continue;                                                       \
+                                                                                \
+            switch (s->mode) {                                                  \
+            case COLOR4:                                                        \
+                dpd[pos] = FFMAX(v - 1, dpd[pos]);                              \
+                break;                                                          \
+            case COLOR2:                                                        \
+                if (!dpd[pos])                                                  \
+                    dpd[pos] = s->is_yuv ? FFABS(mid - x) + FFABS(mid - y)      \
+                                         : FFMIN(x + y, max);                   \
+                break;                                                          \
+            default:                                                            \
+                dpd[pos] = FFMIN(dpd[pos] + FFMIN(v, size) * intensity, max);   \
+            }                                                                   \
+                                                                                \
+            if (s->mode == COLOR2 || s->mode == COLOR3 || s->mode == COLOR4) {  \
+                dpx[pos] = x;                                                   \
+                dpy[pos] = y;                                                   \
+            }                                                                   \
+        }                                                                       \
+    }                                                                           \
+                                                                                \
+    return 0;                                                                   \
+}
+
+DRAW_SLICE(draw_slice8,  uint8_t)
+DRAW_SLICE(draw_slice16, uint16_t)
+
 static void envelope_instant16(VectorscopeContext *s, AVFrame *out)
 {
     const int dlinesize = out->linesize[0] / 2;
@@ -354,24 +514,14 @@ static void envelope(VectorscopeContext *s, AVFrame *out)
     }
 }
 
-static void vectorscope16(VectorscopeContext *s, AVFrame *in, AVFrame *out, int pd)
+static void vectorscope16(AVFilterContext *ctx, AVFrame *in, AVFrame *out, int pd)
 {
-    const uint16_t * const *src = (const uint16_t * const *)in->data;
-    const ptrdiff_t slinesizex = in->linesize[s->x] / 2;
-    const ptrdiff_t slinesizey = in->linesize[s->y] / 2;
-    const ptrdiff_t slinesized = in->linesize[pd] / 2;
+    VectorscopeContext *s = ctx->priv;
+    ThreadData td;
     const ptrdiff_t dlinesize = out->linesize[0] / 2;
-    const int intensity = s->intensity;
     const int px = s->x, py = s->y;
-    const int h = s->planeheight[py];
-    const int w = s->planewidth[px];
     const int oh = out->height;
     const int ow = out->width;
-    const uint16_t *spx = src[px];
-    const uint16_t *spy = src[py];
-    const uint16_t *spd = src[pd];
-    const int hsub = s->hsub;
-    const int vsub = s->vsub;
     uint16_t **dst = (uint16_t **)out->data;
     uint16_t *dpx = dst[px];
     uint16_t *dpy = dst[py];
@@ -380,8 +530,6 @@ static void vectorscope16(VectorscopeContext *s, AVFrame *in, AVFrame *out, int
     uint16_t *dp2 = dst[2];
     const int max = s->size - 1;
     const int mid = s->size / 2;
-    const int tmin = s->tmin;
-    const int tmax = s->tmax;
     int i, j, k;
 
     for (k = 0; k < 4 && dst[k]; k++) {
@@ -391,113 +539,12 @@ static void vectorscope16(VectorscopeContext *s, AVFrame *in, AVFrame *out, int
                         (s->mode == COLOR || s->mode == COLOR5) && k == s->pd ? 0 : s->bg_color[k]);
     }
 
-    switch (s->mode) {
-    case COLOR:
-    case COLOR5:
-    case TINT:
-        for (i = 0; i < h; i++) {
-            const ptrdiff_t iwx = i * slinesizex;
-            const ptrdiff_t iwy = i * slinesizey;
-            const ptrdiff_t iwd = i * slinesized;
-            for (j = 0; j < w; j++) {
-                const int x = FFMIN(spx[iwx + j], max);
-                const int y = FFMIN(spy[iwy + j], max);
-                const int z = spd[iwd + j];
-                const ptrdiff_t pos = y * dlinesize + x;
-
-                if (z < tmin || z > tmax)
-                    continue;
-
-                dpd[pos] = FFMIN(dpd[pos] + intensity, max);
-            }
-        }
-        break;
-    case COLOR2:
-        if (s->is_yuv) {
-            for (i = 0; i < h; i++) {
-                const ptrdiff_t iw1 = i * slinesizex;
-                const ptrdiff_t iw2 = i * slinesizey;
-                const ptrdiff_t iwd = i * slinesized;
-                for (j = 0; j < w; j++) {
-                    const int x = FFMIN(spx[iw1 + j], max);
-                    const int y = FFMIN(spy[iw2 + j], max);
-                    const int z = spd[iwd + j];
-                    const ptrdiff_t pos = y * dlinesize + x;
-
-                    if (z < tmin || z > tmax)
-                        continue;
-
-                    if (!dpd[pos])
-                        dpd[pos] = FFABS(mid - x) + FFABS(mid - y);
-                    dpx[pos] = x;
-                    dpy[pos] = y;
-                }
-            }
-        } else {
-            for (i = 0; i < h; i++) {
-                const ptrdiff_t iw1 = i * slinesizex;
-                const ptrdiff_t iw2 = i * slinesizey;
-                const ptrdiff_t iwd = i * slinesized;
-                for (j = 0; j < w; j++) {
-                    const int x = FFMIN(spx[iw1 + j], max);
-                    const int y = FFMIN(spy[iw2 + j], max);
-                    const int z = spd[iwd + j];
-                    const ptrdiff_t pos = y * dlinesize + x;
-
-                    if (z < tmin || z > tmax)
-                        continue;
-
-                    if (!dpd[pos])
-                        dpd[pos] = FFMIN(x + y, max);
-                    dpx[pos] = x;
-                    dpy[pos] = y;
-                }
-            }
-        }
-        break;
-    case COLOR3:
-        for (i = 0; i < h; i++) {
-            const ptrdiff_t iw1 = i * slinesizex;
-            const ptrdiff_t iw2 = i * slinesizey;
-            const ptrdiff_t iwd = i * slinesized;
-            for (j = 0; j < w; j++) {
-                const int x = FFMIN(spx[iw1 + j], max);
-                const int y = FFMIN(spy[iw2 + j], max);
-                const int z = spd[iwd + j];
-                const ptrdiff_t pos = y * dlinesize + x;
-
-                if (z < tmin || z > tmax)
-                    continue;
-
-                dpd[pos] = FFMIN(max, dpd[pos] + intensity);
-                dpx[pos] = x;
-                dpy[pos] = y;
-            }
-        }
-        break;
-    case COLOR4:
-        for (i = 0; i < in->height; i++) {
-            const ptrdiff_t iwx = (i >> vsub) * slinesizex;
-            const ptrdiff_t iwy = (i >> vsub) * slinesizey;
-            const ptrdiff_t iwd = i * slinesized;
-            for (j = 0; j < in->width; j++) {
-                const int x = FFMIN(spx[iwx + (j >> hsub)], max);
-                const int y = FFMIN(spy[iwy + (j >> hsub)], max);
-                const int z = spd[iwd + j];
-                const ptrdiff_t pos = y * dlinesize + x;
-
-                if (z < tmin || z > tmax)
-                    continue;
-
-                dpd[pos] = FFMAX(z, dpd[pos]);
-                dpx[pos] = x;
-                dpy[pos] = y;
-            }
-        }
-        break;
-    default:
-        av_assert0(0);
-    }
+    td.in  = in;
+    td.out = out;
+    td.pd  = pd;
+    ff_filter_execute(ctx, plot_slice16, &td, NULL, s->nb_maps);
+    ff_filter_execute(ctx, draw_slice16, &td, NULL,
+                      FFMIN(s->size, ff_filter_get_nb_threads(ctx)));
 
     envelope16(s, out);
 
@@ -560,32 +607,20 @@ static void vectorscope16(VectorscopeContext *s, AVFrame *in, AVFrame *out, int
     }
 }
 
-static void vectorscope8(VectorscopeContext *s, AVFrame *in, AVFrame *out, int pd)
+static void vectorscope8(AVFilterContext *ctx, AVFrame *in, AVFrame *out, int pd)
 {
-    const uint8_t * const *src = (const uint8_t * const *)in->data;
-    const ptrdiff_t slinesizex = in->linesize[s->x];
-    const ptrdiff_t slinesizey = in->linesize[s->y];
-    const ptrdiff_t slinesized = in->linesize[pd];
+    VectorscopeContext *s = ctx->priv;
+    ThreadData td;
     const ptrdiff_t dlinesize = out->linesize[0];
-    const int intensity = s->intensity;
     const int px = s->x, py = s->y;
-    const int h = s->planeheight[py];
-    const int w = s->planewidth[px];
     const int oh = out->height;
     const int ow = out->width;
-    const uint8_t *restrict spx = src[px];
-    const uint8_t *restrict spy = src[py];
-    const uint8_t *restrict spd = src[pd];
-    const int hsub = s->hsub;
-    const int vsub = s->vsub;
     uint8_t **dst = out->data;
     uint8_t *restrict dpx = dst[px];
     uint8_t *restrict dpy = dst[py];
     uint8_t *restrict dpd = dst[pd];
     uint8_t *restrict dp1 = dst[1];
     uint8_t *restrict dp2 = dst[2];
-    const int tmin = s->tmin;
-    const int tmax = s->tmax;
     int i, j, k;
 
     for (k = 0; k < 4 && dst[k]; k++)
@@ -593,113 +628,12 @@ static void vectorscope8(VectorscopeContext *s, AVFrame *in, AVFrame *out, int p
             memset(dst[k] + i * out->linesize[k],
                    (s->mode == COLOR || s->mode == COLOR5) && k == s->pd ? 0 : s->bg_color[k], ow);
 
-    switch (s->mode) {
-    case COLOR5:
-    case COLOR:
-    case TINT:
-        for (i = 0; i < h; i++) {
-            const ptrdiff_t iwx = i * slinesizex;
-            const ptrdiff_t iwy = i * slinesizey;
-            const ptrdiff_t iwd = i * slinesized;
-            for (j = 0; j < w; j++) {
-                const int x = spx[iwx + j];
-                const int y = spy[iwy + j];
-                const int z = spd[iwd + j];
-                const ptrdiff_t pos = y * dlinesize + x;
-
-                if (z < tmin || z > tmax)
-                    continue;
-
-                dpd[pos] = FFMIN(dpd[pos] + intensity, 255);
-            }
-        }
-        break;
-    case COLOR2:
-        if (s->is_yuv) {
-            for (i = 0; i < h; i++) {
-                const ptrdiff_t iw1 = i * slinesizex;
-                const ptrdiff_t iw2 = i * slinesizey;
-                const ptrdiff_t iwd = i * slinesized;
-                for (j = 0; j < w; j++) {
-                    const int x = spx[iw1 + j];
-                    const int y = spy[iw2 + j];
-                    const int z = spd[iwd + j];
-                    const ptrdiff_t pos = y * dlinesize + x;
-
-                    if (z < tmin || z > tmax)
-                        continue;
-
-                    if (!dpd[pos])
-                        dpd[pos] = FFABS(128 - x) + FFABS(128 - y);
-                    dpx[pos] = x;
-                    dpy[pos] = y;
-                }
-            }
-        } else {
-            for (i = 0; i < h; i++) {
-                const ptrdiff_t iw1 = i * slinesizex;
-                const ptrdiff_t iw2 = i * slinesizey;
-                const ptrdiff_t iwd = i * slinesized;
-                for (j = 0; j < w; j++) {
-                    const int x = spx[iw1 + j];
-                    const int y = spy[iw2 + j];
-                    const int z = spd[iwd + j];
-                    const ptrdiff_t pos = y * dlinesize + x;
-
-                    if (z < tmin || z > tmax)
-                        continue;
-
-                    if (!dpd[pos])
-                        dpd[pos] = FFMIN(x + y, 255);
-                    dpx[pos] = x;
-                    dpy[pos] = y;
-                }
-            }
-        }
-        break;
-    case COLOR3:
-        for (i = 0; i < h; i++) {
-            const ptrdiff_t iw1 = i * slinesizex;
-            const ptrdiff_t iw2 = i * slinesizey;
-            const ptrdiff_t iwd = i * slinesized;
-            for (j = 0; j < w; j++) {
-                const int x = spx[iw1 + j];
-                const int y = spy[iw2 + j];
-                const int z = spd[iwd + j];
-                const ptrdiff_t pos = y * dlinesize + x;
-
-                if (z < tmin || z > tmax)
-                    continue;
-
-                dpd[pos] = FFMIN(255, dpd[pos] + intensity);
-                dpx[pos] = x;
-                dpy[pos] = y;
-            }
-        }
-        break;
-    case COLOR4:
-        for (i = 0; i < in->height; i++) {
-            const ptrdiff_t iwx = (i >> vsub) * slinesizex;
-            const ptrdiff_t iwy = (i >> vsub) * slinesizey;
-            const ptrdiff_t iwd = i * slinesized;
-            for (j = 0; j < in->width; j++) {
-                const int x = spx[iwx + (j >> hsub)];
-                const int y = spy[iwy + (j >> hsub)];
-                const int z = spd[iwd + j];
-                const ptrdiff_t pos = y * dlinesize + x;
-
-                if (z < tmin || z > tmax)
-                    continue;
-
-                dpd[pos] = FFMAX(z, dpd[pos]);
-                dpx[pos] = x;
-                dpy[pos] = y;
-            }
-        }
-        break;
-    default:
-        av_assert0(0);
-    }
+    td.in  = in;
+    td.out = out;
+    td.pd  = pd;
+    ff_filter_execute(ctx, plot_slice8, &td, NULL, s->nb_maps);
+    ff_filter_execute(ctx, draw_slice8, &td, NULL,
+                      FFMIN(s->size, ff_filter_get_nb_threads(ctx)));
 
     envelope(s, out);
 
@@ -1430,7 +1364,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     }
     av_frame_copy_props(out, in);
 
-    s->vectorscope(s, in, out, s->pd);
+    s->vectorscope(ctx, in, out, s->pd);
     s->graticulef(s, out, s->x, s->y, s->pd, s->cs);
 
     for (plane = 0; plane < 4; plane++) {
@@ -1528,6 +1462,7 @@ static av_cold void uninit(AVFilterContext *ctx)
 
     av_freep(&s->peak);
     av_freep(&s->peak_memory);
+    av_freep(&s->maps);
 }
 
 static const AVFilterPad inputs[] = {
@@ -1556,5 +1491,6 @@ const AVFilter ff_vf_vectorscope = {
     FILTER_INPUTS(inputs),
     FILTER_OUTPUTS(outputs),
     FILTER_QUERY_FUNC2(query_formats),
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
     .process_command = ff_filter_process_command,
 };
@@ -126,6 +126,8 @@ static int config_input(AVFilterLink *inlink)
     // set values that are not initialized by the options
     s->conf.algo     = 1;
     s->conf.modName  = "vidstabdetect";
+    // let libvidstab search the fields of a frame with the filter's threads
+    s->conf.numThreads = ff_filter_get_nb_threads(ctx);
     if (vsMotionDetectInit(md, &s->conf, &fi) != VS_OK) {
         av_log(ctx, AV_LOG_ERROR, "initialization of Motion Detection failed, please report a BUG");
         return AVERROR(EINVAL);
@@ -49,6 +49,7 @@ AVFrame *ff_null_get_video_buffer(AVFilterLink *link, int w, int h)
 AVFrame *ff_default_get_video_buffer2(AVFilterLink *link, int w, int h, int align)
 {
     FilterLinkInternal *const li = ff_link_internal(link);
+    const int pool_flags = fffiltergraph(link->dst->graph)->frame_pool_flags;
     AVFrame *frame = NULL;
     int pool_width = 0;
     int pool_height = 0;
@@ -71,9 +72,7 @@ AVFrame *ff_default_get_video_buffer2(AVFilterLink *link, int w, int h, int alig
     }
 
     if (!li->frame_pool) {
-        li->frame_pool = ff_frame_pool_video_init(CONFIG_MEMORY_POISONING
-                                                     ? NULL
-                                                     : av_buffer_allocz,
+        li->frame_pool = ff_frame_pool_video_init(ff_frame_pool_get_allocator(pool_flags),
                                                   w, h, link->format, align);
         if (!li->frame_pool)
             return NULL;
@@ -88,9 +87,7 @@ AVFrame *ff_default_get_video_buffer2(AVFilterLink *link, int w, int h, int alig
             pool_format != link->format || pool_align != align) {
 
             ff_frame_pool_uninit(&li->frame_pool);
-            li->frame_pool = ff_frame_pool_video_init(CONFIG_MEMORY_POISONING
-                                                         ? NULL
-                                                         : av_buffer_allocz,
+            li->frame_pool = ff_frame_pool_video_init(ff_frame_pool_get_allocator(pool_flags),
                                                       w, h, link->format, align);
             if (!li->frame_pool)
                 return NULL;
@@ -101,6 +98,9 @@ AVFrame *ff_default_get_video_buffer2(AVFilterLink *link, int w, int h, int alig
     if (!frame)
         return NULL;
 
+    for (int i = 0; i < FF_ARRAY_ELEMS(frame->buf) && frame->buf[i]; i++)
+        fffilterctx(link->src)->stats.pool_bytes += frame->buf[i]->size;
+
     frame->sample_aspect_ratio = link->sample_aspect_ratio;
     frame->colorspace  = link->colorspace;
     frame->color_range = link->color_range;
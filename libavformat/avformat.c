@@ -66,6 +66,7 @@ FF_ENABLE_DEPRECATION_WARNINGS
     av_bsf_free(&sti->bsfc);
     av_freep(&sti->index_entries);
     av_freep(&sti->probe_data.buf);
+    avpriv_packet_list_free(&sti->interleave_queue);
 
     av_bsf_free(&sti->extract_extradata.bsf);
 
@@ -190,6 +191,8 @@ void avformat_free_context(AVFormatContext *s)
     av_freep(&s->stream_groups);
     if (s->iformat)
         ff_flush_packet_queue(s);
+    else if (s->oformat)
+        av_freep(&fci->interleave_heap);
     av_freep(&s->url);
     av_free(s);
 }
@@ -1900,6 +1900,22 @@ typedef struct AVFormatContext {
      * @see skip_estimate_duration_from_pts
      */
     int64_t duration_probesize;
+
+    /**
+     * Directory where the stream parameters found by
+     * avformat_find_stream_info() are cached. When the same local file is
+     * opened again, they are read from there instead of being probed.
+     * Demuxing only, set by the caller before avformat_find_stream_info().
+     */
+    char *probe_cache;
+
+    /**
+     * Number of threads used to decode the streams concurrently in
+     * avformat_find_stream_info(), 0 for automatic. With 1, the default,
+     * the streams are decoded in the calling thread.
+     * Demuxing only, set by the caller before avformat_find_stream_info().
+     */
+    int probe_threads;
 } AVFormatContext;
 
 #if FF_API_AVSTREAM_SIDE_DATA
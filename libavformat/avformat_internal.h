@@ -59,6 +59,14 @@ typedef struct FormatContextInternal {
             int (*interleave_packet)(struct AVFormatContext *s, AVPacket *pkt,
                                      int flush, int has_packet);
 
+            /**
+             * Binary min-heap of the streams with packets in their
+             * interleave_queue, ordered by the first packet of each queue.
+             */
+            struct FFStream **interleave_heap;
+            unsigned nb_interleave_heap;
+            unsigned interleave_heap_size;
+
 #if FF_API_COMPUTE_PKT_FIELDS2
             int missing_ts_warning;
 #endif
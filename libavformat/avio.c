@@ -19,10 +19,15 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#define _DEFAULT_SOURCE
+#define _BSD_SOURCE
+#include <sys/stat.h>
+
 #include "libavutil/avstring.h"
 #include "libavutil/dict.h"
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
+#include "libavutil/random_seed.h"
 #include "libavutil/time.h"
 #include "libavutil/avassert.h"
 #include "avio_internal.h"
@@ -115,6 +120,35 @@ URLContext *ffio_geturlcontext(AVIOContext *s)
         return NULL;
 }
 
+int ffio_read_buffer(AVIOContext *s, AVBufferRef **buf, int size)
+{
+    FFIOContext *const ctx = ffiocontext(s);
+    URLContext *h = ffio_geturlcontext(s);
+    int short_seek = ctx->short_seek_threshold;
+    int64_t ret;
+
+    if (!h || s->write_flag || s->update_checksum || size <= 0 ||
+        !(s->seekable & AVIO_SEEKABLE_NORMAL))
+        return AVERROR(ENOSYS);
+
+    if (ctx->short_seek_get)
+        short_seek = FFMAX(ctx->short_seek_get(s->opaque), short_seek);
+    if (size <= s->buf_end - s->buf_ptr + short_seek)
+        return AVERROR(ENOSYS);
+
+    ret = ffurl_get_buffer(h, avio_tell(s), size, buf);
+    if (ret < 0)
+        return ret;
+
+    ret = avio_seek(s, size, SEEK_CUR);
+    if (ret < 0) {
+        av_buffer_unref(buf);
+        return ret;
+    }
+
+    return size;
+}
+
 static int url_alloc_for_protocol(URLContext **puc, const URLProtocol *up,
                                   const char *filename, int flags,
                                   const AVIOInterruptCB *int_cb)
@@ -835,6 +869,13 @@ int ffurl_get_multi_file_handle(URLContext *h, int **handles, int *numhandles)
     return h->prot->url_get_multi_file_handle(h, handles, numhandles);
 }
 
+int ffurl_get_buffer(URLContext *h, int64_t pos, int size, AVBufferRef **buf)
+{
+    if (!h || !h->prot || !h->prot->url_get_buffer)
+        return AVERROR(ENOSYS);
+    return h->prot->url_get_buffer(h, pos, size, buf);
+}
+
 int ffurl_get_short_seek(void *urlcontext)
 {
     URLContext *h = urlcontext;
@@ -865,3 +906,50 @@ int ff_rename(const char *url_src, const char *url_dst, void *logctx)
         av_log(logctx, AV_LOG_ERROR, "failed to rename file %s to %s: %s\n", url_src, url_dst, av_err2str(ret));
     return ret;
 }
+
+int ff_file_id_get(AVIOContext *pb, FFFileId *id)
+{
+    int fd = pb ? ffurl_get_file_handle(ffio_geturlcontext(pb)) : -1;
+    struct stat st;
+
+    if (fd < 0 || fstat(fd, &st) < 0 || !st.st_ino)
+        return AVERROR(ENOSYS);
+
+    id->dev      = st.st_dev;
+    id->ino      = st.st_ino;
+    id->size     = st.st_size;
+    id->mtime_ns = st.st_mtime * INT64_C(1000000000);
+#if HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
+    id->mtime_ns += st.st_mtim.tv_nsec;
+#endif
+    return 0;
+}
+
+int ff_cache_entry_open(AVFormatContext *s, AVIOContext **pb,
+                        const char *path, char **tmp)
+{
+    int ret;
+
+    *tmp = av_asprintf("%s.%08"PRIx32"%08"PRIx32".tmp", path,
+                       av_get_random_seed(), av_get_random_seed());
+    if (!*tmp)
+        return AVERROR(ENOMEM);
+
+    ret = s->io_open(s, pb, *tmp, AVIO_FLAG_WRITE, NULL);
+    if (ret < 0)
+        av_freep(tmp);
+    return ret;
+}
+
+int ff_cache_entry_commit(AVFormatContext *s, AVIOContext **pb,
+                          const char *path, char **tmp)
+{
+    int ret = ff_format_io_close(s, pb);
+
+    if (ret >= 0)
+        ret = ff_rename(*tmp, path, s);
+    if (ret < 0)
+        ffurl_delete(*tmp);
+    av_freep(tmp);
+    return ret;
+}
@@ -21,6 +21,7 @@
 
 #include "avio.h"
 
+#include "libavutil/buffer.h"
 #include "libavutil/log.h"
 
 extern const AVClass ff_avio_class;
@@ -222,6 +223,19 @@ int ffio_open_dyn_packet_buf(AVIOContext **s, int max_packet_size);
  */
 struct URLContext *ffio_geturlcontext(AVIOContext *s);
 
+/**
+ * Return a reference to the next size bytes of s without copying them,
+ * and skip them, if the underlying protocol can lend them.
+ *
+ * This is only attempted when skipping the data results in a real seek,
+ * as smaller amounts are cheaper to read through the buffer.
+ * See ffurl_get_buffer() for the properties of the buffer.
+ *
+ * @return size on success, AVERROR(ENOSYS) if the data must be read or
+ *         another negative error code
+ */
+int ffio_read_buffer(AVIOContext *s, AVBufferRef **buf, int size);
+
 /**
  * Create and initialize a AVIOContext for accessing the
  * resource referenced by the URLContext h.
@@ -27,6 +27,7 @@
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "libavutil/avassert.h"
+#include "libavutil/trace.h"
 #include "libavcodec/defs.h"
 #include "avio.h"
 #include "avio_internal.h"
@@ -133,6 +134,7 @@ static void writeout(AVIOContext *s, const uint8_t *data, int len)
     FFIOContext *const ctx = ffiocontext(s);
     if (!s->error) {
         int ret = 0;
+        FF_TRACE_BEGIN("avio", "write", len);
         if (s->write_data_type)
             ret = s->write_data_type(s->opaque, data,
                                      len,
@@ -140,6 +142,7 @@ static void writeout(AVIOContext *s, const uint8_t *data, int len)
                                      ctx->last_time);
         else if (s->write_packet)
             ret = s->write_packet(s->opaque, data, len);
+        FF_TRACE_END("avio", "write");
         if (ret < 0) {
             s->error = ret;
         } else {
@@ -545,7 +548,9 @@ static void fill_buffer(AVIOContext *s)
         len = ctx->orig_buffer_size;
     }
 
+    FF_TRACE_BEGIN("avio", "read", len);
     len = read_packet_wrapper(s, dst, len);
+    FF_TRACE_END("avio", "read");
     if (len == AVERROR_EOF) {
         /* do not modify buffer if EOF reached so that a seek back can
            be done without rereading data */
@@ -20,16 +20,21 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 #include <libxml/parser.h>
+#include <stdatomic.h>
 #include <time.h>
+#include "config.h"
+#include "config_components.h"
 #include "libavutil/bprint.h"
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
+#include "libavutil/thread.h"
 #include "libavutil/time.h"
 #include "libavutil/parseutils.h"
 #include "internal.h"
 #include "avio_internal.h"
 #include "dash.h"
 #include "demux.h"
+#include "http.h"
 #include "url.h"
 
 #define INITIAL_BUFFER_SIZE 32768
@@ -71,6 +76,25 @@ struct timeline {
     int64_t duration;
 };
 
+enum PrefetchState {
+    PREFETCH_FREE,
+    PREFETCH_QUEUED,
+    PREFETCH_RUNNING,
+    PREFETCH_DONE,
+};
+
+/* A fragment downloaded into memory ahead of time by the prefetch thread. */
+struct prefetch {
+    enum PrefetchState state;
+    int64_t seq_no;
+    struct fragment *seg;   /* with an absolute URL */
+    AVDictionary *opts;
+    int ret;
+    uint8_t *data;
+    size_t data_len;
+    size_t reserved;        /* bytes accounted in the memory budget */
+};
+
 /*
  * Each playlist has its own demuxer. If it is currently active,
  * it has an opened AVIOContext too, and potentially an AVPacket
@@ -118,6 +142,18 @@ struct representation {
     uint32_t init_sec_buf_read_offset;
     int64_t cur_timestamp;
     int is_restart_needed;
+
+    /* Fragments following the current one, downloaded by a thread of
+     * the representation over a persistent connection. */
+    struct prefetch *prefetch;
+    struct prefetch *cur_prefetch;
+#if HAVE_THREADS
+    pthread_t prefetch_thread;
+    pthread_mutex_t prefetch_lock;
+    pthread_cond_t prefetch_cond;
+#endif
+    atomic_int prefetch_abort;
+    AVIOInterruptCB prefetch_interrupt_cb;
 };
 
 typedef struct DASHContext {
@@ -160,6 +196,9 @@ typedef struct DASHContext {
     int is_init_section_common_audio;
     int is_init_section_common_subtitle;
 
+    int prefetch_segments;
+    int64_t prefetch_max_size;
+    atomic_size_t prefetch_mem;
 } DASHContext;
 
 static int ishttp(char *url)
@@ -348,8 +387,11 @@ static void free_timelines_list(struct representation *pls)
     pls->n_timelines = 0;
 }
 
+static void prefetch_cancel(struct representation *pls);
+
 static void free_representation(struct representation *pls)
 {
+    prefetch_cancel(pls);
     free_fragment_list(pls);
     free_timelines_list(pls);
     free_fragment(&pls->cur_seg);
@@ -401,14 +443,11 @@ static void free_subtitle_list(DASHContext *c)
     c->n_subtitles = 0;
 }
 
-static int open_url(AVFormatContext *s, AVIOContext **pb, const char *url,
-                    AVDictionary **opts, AVDictionary *opts2, int *is_http)
+static int check_url(AVFormatContext *s, const char *url, int *is_http)
 {
     DASHContext *c = s->priv_data;
-    AVDictionary *tmp = NULL;
     const char *proto_name = NULL;
     int proto_name_len;
-    int ret;
 
     if (av_strstart(url, "crypto", NULL)) {
         if (url[6] == '+' || url[6] == ':')
@@ -443,6 +482,23 @@ static int open_url(AVFormatContext *s, AVIOContext **pb, const char *url,
     else if (strcmp(proto_name, "file") || !strncmp(url, "file,", 5))
         return AVERROR_INVALIDDATA;
 
+    if (is_http)
+        *is_http = av_strstart(proto_name, "http", NULL);
+
+    return 0;
+}
+
+static int open_url(AVFormatContext *s, AVIOContext **pb, const char *url,
+                    AVDictionary **opts, AVDictionary *opts2, int *is_http)
+{
+    DASHContext *c = s->priv_data;
+    AVDictionary *tmp = NULL;
+    int ret;
+
+    ret = check_url(s, url, is_http);
+    if (ret < 0)
+        return ret;
+
     av_freep(pb);
     av_dict_copy(&tmp, *opts, 0);
     av_dict_copy(&tmp, opts2, 0);
@@ -462,9 +518,6 @@ static int open_url(AVFormatContext *s, AVIOContext **pb, const char *url,
 
     av_dict_free(&tmp);
 
-    if (is_http)
-        *is_http = av_strstart(proto_name, "http", NULL);
-
     return ret;
 }
 
@@ -1582,6 +1635,20 @@ finish:
     return ret;
 }
 
+static char *get_template_url(struct representation *pls, int64_t seq_no)
+{
+    DASHContext *c = pls->parent->priv_data;
+    char *tmpfilename, *url;
+
+    tmpfilename = av_mallocz(c->max_url_size);
+    if (!tmpfilename)
+        return NULL;
+    ff_dash_fill_tmpl_params(tmpfilename, c->max_url_size, pls->url_template, 0, seq_no, 0, get_segment_start_time_based_on_timeline(pls, seq_no));
+    url = av_strireplace(pls->url_template, pls->url_template, tmpfilename);
+    av_free(tmpfilename);
+    return url;
+}
+
 static struct fragment *get_current_fragment(struct representation *pls)
 {
     int64_t min_seq_no = 0;
@@ -1635,30 +1702,21 @@ static struct fragment *get_current_fragment(struct representation *pls)
         }
     }
     if (seg) {
-        char *tmpfilename;
         if (!pls->url_template) {
             av_log(pls->parent, AV_LOG_ERROR, "Cannot get fragment, missing template URL\n");
             av_free(seg);
             return NULL;
         }
-        tmpfilename = av_mallocz(c->max_url_size);
-        if (!tmpfilename) {
-            av_free(seg);
-            return NULL;
-        }
-        ff_dash_fill_tmpl_params(tmpfilename, c->max_url_size, pls->url_template, 0, pls->cur_seq_no, 0, get_segment_start_time_based_on_timeline(pls, pls->cur_seq_no));
-        seg->url = av_strireplace(pls->url_template, pls->url_template, tmpfilename);
+        seg->url = get_template_url(pls, pls->cur_seq_no);
         if (!seg->url) {
             av_log(pls->parent, AV_LOG_WARNING, "Unable to resolve template url '%s', try to use origin template\n", pls->url_template);
             seg->url = av_strdup(pls->url_template);
             if (!seg->url) {
                 av_log(pls->parent, AV_LOG_ERROR, "Cannot resolve template url '%s'\n", pls->url_template);
-                av_free(tmpfilename);
                 av_free(seg);
                 return NULL;
             }
         }
-        av_free(tmpfilename);
         seg->size = -1;
     }
 
@@ -1674,7 +1732,14 @@ static int read_from_url(struct representation *pls, struct fragment *seg,
     if (seg->size >= 0)
         buf_size = FFMIN(buf_size, pls->cur_seg_size - pls->cur_seg_offset);
 
-    ret = avio_read(pls->input, buf, buf_size);
+    if (pls->cur_prefetch) {
+        const struct prefetch *p = pls->cur_prefetch;
+        ret = FFMIN(buf_size, p->data_len - pls->cur_seg_offset);
+        if (!ret)
+            return AVERROR_EOF;
+        memcpy(buf, p->data + pls->cur_seg_offset, ret);
+    } else
+        ret = avio_read(pls->input, buf, buf_size);
     if (ret > 0)
         pls->cur_seg_offset += ret;
 
@@ -1762,13 +1827,359 @@ static int update_init_section(struct representation *pls)
 static int64_t seek_data(void *opaque, int64_t offset, int whence)
 {
     struct representation *v = opaque;
-    if (v->n_fragments && !v->init_sec_data_len) {
+    if (v->n_fragments && !v->init_sec_data_len && v->input) {
         return avio_seek(v->input, offset, whence);
     }
 
     return AVERROR(ENOSYS);
 }
 
+static void prefetch_free(DASHContext *c, struct prefetch *p)
+{
+    atomic_fetch_sub(&c->prefetch_mem, p->reserved);
+    free_fragment(&p->seg);
+    av_dict_free(&p->opts);
+    av_freep(&p->data);
+    p->data_len = 0;
+    p->reserved = 0;
+    p->state    = PREFETCH_FREE;
+}
+
+/* Stop the prefetch thread and drop all prefetched data. */
+static void prefetch_cancel(struct representation *pls)
+{
+    DASHContext *c;
+
+    if (!pls->prefetch)
+        return;
+    c = pls->parent->priv_data;
+
+#if HAVE_THREADS
+    atomic_store(&pls->prefetch_abort, 1);
+    pthread_mutex_lock(&pls->prefetch_lock);
+    pthread_cond_signal(&pls->prefetch_cond);
+    pthread_mutex_unlock(&pls->prefetch_lock);
+    pthread_join(pls->prefetch_thread, NULL);
+    pthread_cond_destroy(&pls->prefetch_cond);
+    pthread_mutex_destroy(&pls->prefetch_lock);
+#endif
+
+    for (int i = 0; i < c->prefetch_segments; i++)
+        prefetch_free(c, &pls->prefetch[i]);
+    av_freep(&pls->prefetch);
+    pls->cur_prefetch = NULL;
+}
+
+static void close_input(struct representation *pls)
+{
+    ff_format_io_close(pls->parent, &pls->input);
+    if (pls->cur_prefetch) {
+        DASHContext *c = pls->parent->priv_data;
+#if HAVE_THREADS
+        pthread_mutex_lock(&pls->prefetch_lock);
+#endif
+        prefetch_free(c, pls->cur_prefetch);
+#if HAVE_THREADS
+        pthread_mutex_unlock(&pls->prefetch_lock);
+#endif
+        pls->cur_prefetch = NULL;
+    }
+}
+
+#if HAVE_THREADS
+static int prefetch_interrupt_cb(void *opaque)
+{
+    struct representation *pls = opaque;
+    DASHContext *c = pls->parent->priv_data;
+
+    return atomic_load(&pls->prefetch_abort) || ff_check_interrupt(c->interrupt_callback);
+}
+
+/* Download a fragment into memory, reusing the connection of the previous
+ * one when possible. */
+static int prefetch_read(struct representation *pls, AVIOContext **pb,
+                         struct prefetch *p)
+{
+    AVFormatContext *s = pls->parent;
+    DASHContext *c = s->priv_data;
+    const struct fragment *seg = p->seg;
+    AVDictionary *opts = NULL;
+    size_t size = 0, len = 0, max_size = SIZE_MAX;
+    int is_http, ret;
+
+    ret = check_url(s, seg->url, &is_http);
+    if (ret < 0)
+        return ret;
+
+    av_dict_copy(&opts, p->opts, 0);
+    if (seg->size >= 0) {
+        av_dict_set_int(&opts, "offset", seg->url_offset, 0);
+        av_dict_set_int(&opts, "end_offset", seg->url_offset + seg->size, 0);
+        max_size = seg->size;
+    }
+
+#if CONFIG_HTTP_PROTOCOL
+    if (*pb && is_http) {
+        ret = ff_http_do_new_request2(ffio_geturlcontext(*pb), seg->url, &opts);
+        if (ret < 0)
+            avio_closep(pb);
+        else
+            (*pb)->eof_reached = 0;
+    }
+#endif
+    if (!*pb) {
+        if (is_http)
+            av_dict_set(&opts, "multiple_requests", "1", 0);
+        /* the I/O callbacks of the user may not be thread-safe */
+        ret = ffio_open_whitelist(pb, seg->url, AVIO_FLAG_READ,
+                                  &pls->prefetch_interrupt_cb, &opts,
+                                  s->protocol_whitelist, s->protocol_blacklist);
+    }
+    av_dict_free(&opts);
+    if (ret < 0)
+        return ret;
+
+    if (!is_http && seg->url_offset) {
+        int64_t seekret = avio_seek(*pb, seg->url_offset, SEEK_SET);
+        if (seekret < 0) {
+            ret = seekret;
+            goto fail;
+        }
+    }
+
+    while (len < max_size) {
+        int chunk = FFMIN(max_size - len, 64 << 10);
+
+        if (len + chunk > size) {
+            size_t new_size = FFMIN(FFMAX(2 * size, len + chunk), max_size);
+            size_t grow     = new_size - size;
+            void *tmp;
+
+            /* stop at the memory budget, the fragment is then downloaded
+             * when it is needed, as without prefetching */
+            if (atomic_fetch_add(&c->prefetch_mem, grow) + grow > c->prefetch_max_size) {
+                atomic_fetch_sub(&c->prefetch_mem, grow);
+                ret = AVERROR(ENOSPC);
+                goto fail;
+            }
+            p->reserved += grow;
+
+            tmp = av_realloc(p->data, new_size);
+            if (!tmp) {
+                ret = AVERROR(ENOMEM);
+                goto fail;
+            }
+            p->data = tmp;
+            size    = new_size;
+        }
+
+        ret = avio_read(*pb, p->data + len, chunk);
+        if (ret == AVERROR_EOF)
+            break;
+        if (ret < 0)
+            goto fail;
+        len += ret;
+    }
+    p->data_len = len;
+
+    if (!is_http)
+        avio_closep(pb);
+    return 0;
+fail:
+    avio_closep(pb);
+    return ret;
+}
+
+static void *prefetch_thread(void *arg)
+{
+    struct representation *pls = arg;
+    DASHContext *c = pls->parent->priv_data;
+    AVIOContext *pb = NULL;
+
+    pthread_mutex_lock(&pls->prefetch_lock);
+    while (!atomic_load(&pls->prefetch_abort)) {
+        struct prefetch *p = NULL;
+        int ret;
+
+        for (int i = 0; i < c->prefetch_segments; i++) {
+            struct prefetch *q = &pls->prefetch[i];
+            if (q->state == PREFETCH_QUEUED && (!p || q->seq_no < p->seq_no))
+                p = q;
+        }
+        if (!p) {
+            pthread_cond_wait(&pls->prefetch_cond, &pls->prefetch_lock);
+            continue;
+        }
+
+        p->state = PREFETCH_RUNNING;
+        pthread_mutex_unlock(&pls->prefetch_lock);
+
+        av_log(pls->parent, AV_LOG_VERBOSE, "DASH prefetch for url '%s', offset %"PRId64"\n",
+               p->seg->url, p->seg->url_offset);
+        ret = prefetch_read(pls, &pb, p);
+
+        pthread_mutex_lock(&pls->prefetch_lock);
+        p->ret   = ret;
+        p->state = PREFETCH_DONE;
+        pthread_cond_broadcast(&pls->prefetch_cond);
+    }
+    pthread_mutex_unlock(&pls->prefetch_lock);
+
+    avio_closep(&pb);
+    return NULL;
+}
+
+/* The fragment with a given number, if it is known to be available. */
+static struct fragment *get_fragment(struct representation *pls, int64_t seq_no)
+{
+    DASHContext *c = pls->parent->priv_data;
+    struct fragment *seg;
+    char *url;
+
+    if (pls->n_fragments) {
+        if (seq_no >= pls->n_fragments)
+            return NULL;
+        url = pls->fragments[seq_no]->url;
+    } else if (pls->url_template) {
+        if (seq_no > (c->is_live ? calc_max_seg_no(pls, c) : pls->last_seq_no))
+            return NULL;
+        url = get_template_url(pls, seq_no);
+        if (!url)
+            return NULL;
+    } else
+        return NULL;
+
+    seg = av_mallocz(sizeof(*seg));
+    if (seg)
+        seg->url = av_mallocz(c->max_url_size);
+    if (seg && seg->url) {
+        ff_make_absolute_url(seg->url, c->max_url_size, c->base_url, url);
+        if (pls->n_fragments) {
+            seg->url_offset = pls->fragments[seq_no]->url_offset;
+            seg->size       = pls->fragments[seq_no]->size;
+        } else
+            seg->size       = -1;
+    } else
+        free_fragment(&seg);
+
+    if (!pls->n_fragments)
+        av_free(url);
+    return seg;
+}
+#endif
+
+/* Queue the fragments following the current one for download, within the
+ * limits of the prefetch_segments and prefetch_max_size options. */
+static void prefetch_schedule(DASHContext *c, struct representation *pls)
+{
+#if HAVE_THREADS
+    /* fragments read with seek_data() are not prefetched */
+    if (!c->prefetch_segments || (pls->n_fragments && !pls->init_sec_data_len && !c->is_live))
+        return;
+
+    if (!pls->prefetch) {
+        pls->prefetch = av_calloc(c->prefetch_segments, sizeof(*pls->prefetch));
+        if (!pls->prefetch)
+            return;
+        atomic_init(&pls->prefetch_abort, 0);
+        pls->prefetch_interrupt_cb.callback = prefetch_interrupt_cb;
+        pls->prefetch_interrupt_cb.opaque   = pls;
+        if (pthread_mutex_init(&pls->prefetch_lock, NULL)) {
+            av_freep(&pls->prefetch);
+            return;
+        }
+        if (pthread_cond_init(&pls->prefetch_cond, NULL)) {
+            pthread_mutex_destroy(&pls->prefetch_lock);
+            av_freep(&pls->prefetch);
+            return;
+        }
+        if (pthread_create(&pls->prefetch_thread, NULL, prefetch_thread, pls)) {
+            pthread_cond_destroy(&pls->prefetch_cond);
+            pthread_mutex_destroy(&pls->prefetch_lock);
+            av_freep(&pls->prefetch);
+            return;
+        }
+    }
+
+    pthread_mutex_lock(&pls->prefetch_lock);
+
+    /* drop the fragments that were skipped */
+    for (int i = 0; i < c->prefetch_segments; i++) {
+        struct prefetch *p = &pls->prefetch[i];
+        if (p != pls->cur_prefetch && p->seq_no <= pls->cur_seq_no &&
+            (p->state == PREFETCH_QUEUED || p->state == PREFETCH_DONE))
+            prefetch_free(c, p);
+    }
+
+    for (int64_t seq_no = pls->cur_seq_no + 1;
+         seq_no <= pls->cur_seq_no + c->prefetch_segments; seq_no++) {
+        struct prefetch *slot = NULL;
+        int i;
+
+        for (i = 0; i < c->prefetch_segments; i++) {
+            struct prefetch *p = &pls->prefetch[i];
+            if (p->state != PREFETCH_FREE && p->seq_no == seq_no)
+                break;
+            if (p->state == PREFETCH_FREE && !slot)
+                slot = p;
+        }
+        if (i < c->prefetch_segments)
+            continue;
+        if (!slot || atomic_load(&c->prefetch_mem) >= c->prefetch_max_size)
+            break;
+
+        slot->seg = get_fragment(pls, seq_no);
+        if (!slot->seg || av_dict_copy(&slot->opts, c->avio_opts, 0) < 0) {
+            prefetch_free(c, slot);
+            break;
+        }
+        slot->seq_no = seq_no;
+        slot->ret    = 0;
+        slot->state  = PREFETCH_QUEUED;
+    }
+
+    pthread_cond_signal(&pls->prefetch_cond);
+    pthread_mutex_unlock(&pls->prefetch_lock);
+#endif
+}
+
+/* Wait for and return the prefetched data of a fragment, if any. */
+static struct prefetch *prefetch_get(DASHContext *c, struct representation *pls,
+                                     const struct fragment *seg)
+{
+    struct prefetch *ret = NULL;
+#if HAVE_THREADS
+    char *url;
+
+    if (!pls->prefetch)
+        return NULL;
+
+    url = av_mallocz(c->max_url_size);
+    if (!url)
+        return NULL;
+    ff_make_absolute_url(url, c->max_url_size, c->base_url, seg->url);
+
+    pthread_mutex_lock(&pls->prefetch_lock);
+    for (int i = 0; i < c->prefetch_segments; i++) {
+        struct prefetch *p = &pls->prefetch[i];
+        if (p->state == PREFETCH_FREE || strcmp(p->seg->url, url) ||
+            p->seg->url_offset != seg->url_offset || p->seg->size != seg->size)
+            continue;
+        while (p->state != PREFETCH_DONE)
+            pthread_cond_wait(&pls->prefetch_cond, &pls->prefetch_lock);
+        if (p->ret < 0)
+            prefetch_free(c, p);
+        else
+            ret = p;
+        break;
+    }
+    pthread_mutex_unlock(&pls->prefetch_lock);
+
+    av_free(url);
+#endif
+    return ret;
+}
+
 static int read_data(void *opaque, uint8_t *buf, int buf_size)
 {
     int ret = 0;
@@ -1776,7 +2187,7 @@ static int read_data(void *opaque, uint8_t *buf, int buf_size)
     DASHContext *c = v->parent->priv_data;
 
 restart:
-    if (!v->input) {
+    if (!v->input && !v->cur_prefetch) {
         free_fragment(&v->cur_seg);
         v->cur_seg = get_current_fragment(v);
         if (!v->cur_seg) {
@@ -1789,7 +2200,14 @@ restart:
         if (ret)
             goto end;
 
-        ret = open_input(c, v, v->cur_seg);
+        v->cur_prefetch = prefetch_get(c, v, v->cur_seg);
+        if (v->cur_prefetch) {
+            v->cur_seg_offset = 0;
+            v->cur_seg_size   = v->cur_seg->size;
+            ret = 0;
+        } else {
+            ret = open_input(c, v, v->cur_seg);
+        }
         if (ret < 0) {
             if (ff_check_interrupt(c->interrupt_callback)) {
                 ret = AVERROR_EXIT;
@@ -1799,6 +2217,7 @@ restart:
             v->cur_seq_no++;
             goto restart;
         }
+        prefetch_schedule(c, v);
     }
 
     if (v->init_sec_buf_read_offset < v->init_sec_data_len) {
@@ -2022,6 +2441,7 @@ static int dash_read_header(AVFormatContext *s)
     int i;
 
     c->interrupt_callback = &s->interrupt_callback;
+    atomic_init(&c->prefetch_mem, 0);
 
     if ((ret = ffio_copy_url_options(s->pb, &c->avio_opts)) < 0)
         return ret;
@@ -2147,7 +2567,8 @@ static void recheck_discard_flags(AVFormatContext *s, struct representation **p,
             av_log(s, AV_LOG_INFO, "Now receiving stream_index %d\n", pls->stream_index);
         } else if (!needed && pls->ctx) {
             close_demux_for_component(pls);
-            ff_format_io_close(pls->parent, &pls->input);
+            close_input(pls);
+            prefetch_cancel(pls);
             av_log(s, AV_LOG_INFO, "No longer receiving stream_index %d\n", pls->stream_index);
         }
     }
@@ -2209,7 +2630,7 @@ static int dash_read_packet(AVFormatContext *s, AVPacket *pkt)
             cur->cur_seg_offset = 0;
             cur->init_sec_buf_read_offset = 0;
             cur->is_restart_needed = 0;
-            ff_format_io_close(cur->parent, &cur->input);
+            close_input(cur);
             ret = reopen_demux_for_component(s, cur);
         }
     }
@@ -2247,7 +2668,8 @@ static int dash_seek(AVFormatContext *s, struct representation *pls, int64_t see
         return av_seek_frame(pls->ctx, -1, seek_pos_msec * 1000, flags);
     }
 
-    ff_format_io_close(pls->parent, &pls->input);
+    close_input(pls);
+    prefetch_cancel(pls);
 
     // find the nearest fragment
     if (pls->n_timelines > 0 && pls->fragment_timescale > 0) {
@@ -2346,6 +2768,10 @@ static const AVOption dash_options[] = {
         {.str = "aac,m4a,m4s,m4v,mov,mp4,webm,ts"},
         INT_MIN, INT_MAX, FLAGS},
     { "cenc_decryption_key", "Media decryption key (hex)", OFFSET(cenc_decryption_key), AV_OPT_TYPE_STRING, {.str = NULL}, INT_MIN, INT_MAX, .flags = FLAGS },
+    { "prefetch_segments", "Number of fragments downloaded ahead of time in the background",
+        OFFSET(prefetch_segments), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 64, FLAGS },
+    { "prefetch_max_size", "Maximum amount of memory used by prefetched fragments",
+        OFFSET(prefetch_max_size), AV_OPT_TYPE_INT64, {.i64 = 64 << 20}, 0, INT64_MAX, FLAGS },
     {NULL}
 };
 
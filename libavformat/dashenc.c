@@ -37,6 +37,8 @@
 #include "libavutil/opt.h"
 #include "libavutil/parseutils.h"
 #include "libavutil/rational.h"
+#include "libavutil/fifo.h"
+#include "libavutil/thread.h"
 #include "libavutil/time.h"
 #include "libavutil/time_internal.h"
 
@@ -86,6 +88,30 @@ typedef struct Segment {
     int n;
 } Segment;
 
+#define UPLOAD_BUFFER_SIZE 32768
+#define UPLOAD_FIFO_SIZE   (1 << 20)
+
+/**
+ * Output file handed over to the upload threads. The muxer writes into
+ * the fifo while a thread sends its content over a connection of its own.
+ * A thread only holds the job while there is data to send, the connection
+ * stays open in the job in between.
+ */
+typedef struct UploadJob {
+    struct UploadJob *next;
+    struct DASHContext *c;
+    char url[1024];
+    AVDictionary *opts;
+    AVFifo *fifo;
+    AVIOContext *pb;
+    int opened;
+    int error;
+    int running;
+    int closed;             ///< no more data is going to be written
+    uint64_t close_order;   ///< order of closing by the muxer
+    uint64_t wait_closed;   ///< jobs closed up to this order must complete first
+} UploadJob;
+
 typedef struct AdaptationSet {
     int id;
     char *descriptor;
@@ -204,6 +230,17 @@ typedef struct DASHContext {
     AVRational min_playback_rate;
     AVRational max_playback_rate;
     int64_t update_period;
+    int upload_threads;
+#if HAVE_THREADS
+    pthread_t *upload_tids;
+    int nb_upload_tids;
+    pthread_mutex_t upload_lock;
+    pthread_cond_t upload_cond;
+    UploadJob *upload_jobs, **upload_jobs_tail;
+    uint64_t nb_upload_closed;
+    int upload_error;
+    int upload_quit;
+#endif
 } DASHContext;
 
 static const struct codec_string {
@@ -218,8 +255,8 @@ static const struct codec_string {
     { AV_CODEC_ID_NONE }
 };
 
-static int dashenc_io_open(AVFormatContext *s, AVIOContext **pb, char *filename,
-                           AVDictionary **options) {
+static int dashenc_url_open(AVFormatContext *s, AVIOContext **pb, const char *filename,
+                            AVDictionary **options) {
     DASHContext *c = s->priv_data;
     int http_base_proto = filename ? ff_is_http_proto(filename) : 0;
     int err = AVERROR_MUXER_NOT_FOUND;
@@ -237,7 +274,7 @@ static int dashenc_io_open(AVFormatContext *s, AVIOContext **pb, char *filename,
     return err;
 }
 
-static void dashenc_io_close(AVFormatContext *s, AVIOContext **pb, char *filename) {
+static void dashenc_url_close(AVFormatContext *s, AVIOContext **pb, const char *filename) {
     DASHContext *c = s->priv_data;
     int http_base_proto = filename ? ff_is_http_proto(filename) : 0;
 
@@ -256,6 +293,325 @@ static void dashenc_io_close(AVFormatContext *s, AVIOContext **pb, char *filenam
     }
 }
 
+#if HAVE_THREADS
+static int upload_job_runnable(DASHContext *c, const UploadJob *job)
+{
+    if (!job->closed && !av_fifo_can_read(job->fifo))
+        return 0;
+    for (const UploadJob *j = c->upload_jobs; j; j = j->next)
+        if (j->closed && j->close_order <= job->wait_closed)
+            return 0;
+    return 1;
+}
+
+static void upload_job_free(UploadJob **job)
+{
+    avio_closep(&(*job)->pb);
+    av_dict_free(&(*job)->opts);
+    av_fifo_freep2(&(*job)->fifo);
+    av_freep(job);
+}
+
+/*
+ * Open and close the connections of the upload threads like
+ * dashenc_url_open() and dashenc_url_close(), but without the I/O
+ * callbacks of the user, which need not be thread-safe.
+ */
+static int upload_url_open(AVFormatContext *s, AVIOContext **pb, const char *url,
+                           AVDictionary **options)
+{
+    DASHContext *c = s->priv_data;
+    int err;
+
+#if CONFIG_HTTP_PROTOCOL
+    if (*pb && ff_is_http_proto(url) && c->http_persistent) {
+        err = ff_http_do_new_request(ffio_geturlcontext(*pb), url);
+        if (err < 0)
+            avio_closep(pb);
+        return err;
+    }
+#endif
+    avio_closep(pb);
+    return ffio_open_whitelist(pb, url, AVIO_FLAG_WRITE, &s->interrupt_callback,
+                               options, s->protocol_whitelist, s->protocol_blacklist);
+}
+
+static void upload_url_close(AVFormatContext *s, AVIOContext **pb, const char *url,
+                             AVIOContext **idle)
+{
+    DASHContext *c = s->priv_data;
+
+#if CONFIG_HTTP_PROTOCOL
+    if (*pb && ff_is_http_proto(url) && c->http_persistent) {
+        avio_flush(*pb);
+        ffurl_shutdown(ffio_geturlcontext(*pb), AVIO_FLAG_WRITE);
+        /* keep the connection for the next file */
+        if (!*idle)
+            FFSWAP(AVIOContext *, *pb, *idle);
+    }
+#endif
+    avio_closep(pb);
+}
+
+static void *upload_thread(void *arg)
+{
+    AVFormatContext *s = arg;
+    DASHContext *c = s->priv_data;
+    AVIOContext *idle = NULL;
+    uint8_t buf[16384];
+
+    ff_thread_setname("dash-upload");
+
+    pthread_mutex_lock(&c->upload_lock);
+    for (;;) {
+        UploadJob *job, **prev;
+        size_t len;
+
+        for (job = c->upload_jobs; job; job = job->next)
+            if (!job->running && upload_job_runnable(c, job))
+                break;
+        if (!job) {
+            if (c->upload_quit && !c->upload_jobs)
+                break;
+            pthread_cond_wait(&c->upload_cond, &c->upload_lock);
+            continue;
+        }
+        job->running = 1;
+
+        if (!job->opened) {
+            job->opened = 1;
+            pthread_mutex_unlock(&c->upload_lock);
+            FFSWAP(AVIOContext *, job->pb, idle);
+            job->error = upload_url_open(s, &job->pb, job->url, &job->opts);
+            if (job->error < 0)
+                av_log(s, AV_LOG_ERROR, "Unable to open %s for writing: %s\n",
+                       job->url, av_err2str(job->error));
+            pthread_mutex_lock(&c->upload_lock);
+        }
+
+        /* Never wait for more data here: the muxer may be blocked on the
+         * fifo of another job, which needs a thread to be drained. */
+        while ((len = FFMIN(av_fifo_can_read(job->fifo), sizeof(buf)))) {
+            av_fifo_read(job->fifo, buf, len);
+            pthread_cond_broadcast(&c->upload_cond);
+            pthread_mutex_unlock(&c->upload_lock);
+            /* Keep draining the fifo after an error but drop the data. */
+            if (job->error >= 0) {
+                avio_write(job->pb, buf, len);
+                avio_flush(job->pb);
+                if (job->pb->error < 0) {
+                    job->error = job->pb->error;
+                    av_log(s, AV_LOG_ERROR, "Failed to upload %s: %s\n",
+                           job->url, av_err2str(job->error));
+                }
+            }
+            pthread_mutex_lock(&c->upload_lock);
+        }
+        if (!job->closed) {
+            job->running = 0;
+            continue;
+        }
+        pthread_mutex_unlock(&c->upload_lock);
+
+        if (job->error >= 0)
+            upload_url_close(s, &job->pb, job->url, &idle);
+        else
+            avio_closep(&job->pb);
+
+        pthread_mutex_lock(&c->upload_lock);
+        if (job->error < 0 && !c->upload_error)
+            c->upload_error = job->error;
+        prev = &c->upload_jobs;
+        while (*prev != job)
+            prev = &(*prev)->next;
+        *prev = job->next;
+        if (!*prev)
+            c->upload_jobs_tail = prev;
+        upload_job_free(&job);
+        pthread_cond_broadcast(&c->upload_cond);
+    }
+    pthread_mutex_unlock(&c->upload_lock);
+
+    avio_closep(&idle);
+    return NULL;
+}
+
+/* Block while the fifo is full: the upload threads drain it without
+ * waiting on the muxer, so the muxer goes on at the pace of the uploads. */
+static int upload_write(void *opaque, const uint8_t *buf, int size)
+{
+    UploadJob *job = opaque;
+    DASHContext *c = job->c;
+    int left = size;
+
+    pthread_mutex_lock(&c->upload_lock);
+    while (left > 0) {
+        size_t len = FFMIN(av_fifo_can_write(job->fifo), left);
+        if (!len) {
+            pthread_cond_wait(&c->upload_cond, &c->upload_lock);
+            continue;
+        }
+        av_fifo_write(job->fifo, buf, len);
+        buf  += len;
+        left -= len;
+        pthread_cond_broadcast(&c->upload_cond);
+    }
+    pthread_mutex_unlock(&c->upload_lock);
+
+    return size;
+}
+
+static int upload_open(AVFormatContext *s, AVIOContext **pb, const char *filename,
+                       AVDictionary **options, int barrier)
+{
+    DASHContext *c = s->priv_data;
+    UploadJob *job;
+    uint8_t *buf;
+    int ret;
+
+    pthread_mutex_lock(&c->upload_lock);
+    ret = c->upload_error;
+    c->upload_error = 0;
+    pthread_mutex_unlock(&c->upload_lock);
+    if (ret < 0 && !c->ignore_io_errors)
+        return ret;
+
+    job = av_mallocz(sizeof(*job));
+    if (!job)
+        return AVERROR(ENOMEM);
+    job->c    = c;
+    job->fifo = av_fifo_alloc2(UPLOAD_FIFO_SIZE, 1, 0);
+    buf       = av_malloc(UPLOAD_BUFFER_SIZE);
+    if (!job->fifo || !buf ||
+        !(*pb = avio_alloc_context(buf, UPLOAD_BUFFER_SIZE, 1, job, NULL, upload_write, NULL))) {
+        av_free(buf);
+        upload_job_free(&job);
+        return AVERROR(ENOMEM);
+    }
+    av_strlcpy(job->url, filename, sizeof(job->url));
+    if (options)
+        av_dict_copy(&job->opts, *options, 0);
+
+    pthread_mutex_lock(&c->upload_lock);
+    /* Manifests and deletions must not overtake the files closed before. */
+    job->wait_closed = barrier ? c->nb_upload_closed : 0;
+    *c->upload_jobs_tail = job;
+    c->upload_jobs_tail  = &job->next;
+    pthread_cond_broadcast(&c->upload_cond);
+    pthread_mutex_unlock(&c->upload_lock);
+
+    return 0;
+}
+
+static void upload_close(AVIOContext **pb)
+{
+    UploadJob *job = (*pb)->opaque;
+    DASHContext *c = job->c;
+
+    avio_flush(*pb);
+    pthread_mutex_lock(&c->upload_lock);
+    job->closed      = 1;
+    job->close_order = ++c->nb_upload_closed;
+    pthread_cond_broadcast(&c->upload_cond);
+    pthread_mutex_unlock(&c->upload_lock);
+
+    av_freep(&(*pb)->buffer);
+    avio_context_free(pb);
+}
+
+static int upload_init(AVFormatContext *s)
+{
+    DASHContext *c = s->priv_data;
+    int ret;
+
+    c->upload_tids = av_calloc(c->upload_threads, sizeof(*c->upload_tids));
+    if (!c->upload_tids)
+        return AVERROR(ENOMEM);
+    c->upload_jobs_tail = &c->upload_jobs;
+    if ((ret = pthread_mutex_init(&c->upload_lock, NULL))) {
+        av_freep(&c->upload_tids);
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_cond_init(&c->upload_cond, NULL))) {
+        pthread_mutex_destroy(&c->upload_lock);
+        av_freep(&c->upload_tids);
+        return AVERROR(ret);
+    }
+    for (; c->nb_upload_tids < c->upload_threads; c->nb_upload_tids++) {
+        ret = pthread_create(&c->upload_tids[c->nb_upload_tids], NULL, upload_thread, s);
+        if (ret) {
+            av_log(s, AV_LOG_ERROR, "pthread_create failed: %s\n", strerror(ret));
+            return AVERROR(ret);
+        }
+    }
+    return 0;
+}
+
+/* Wait for the pending uploads and stop the threads. */
+static void upload_uninit(AVFormatContext *s)
+{
+    DASHContext *c = s->priv_data;
+
+    if (!c->upload_tids)
+        return;
+
+    pthread_mutex_lock(&c->upload_lock);
+    c->upload_quit = 1;
+    pthread_cond_broadcast(&c->upload_cond);
+    pthread_mutex_unlock(&c->upload_lock);
+    for (int i = 0; i < c->nb_upload_tids; i++)
+        pthread_join(c->upload_tids[i], NULL);
+
+    /* Jobs are left only if no thread could be started. */
+    while (c->upload_jobs) {
+        UploadJob *job = c->upload_jobs;
+        c->upload_jobs = job->next;
+        upload_job_free(&job);
+    }
+    pthread_cond_destroy(&c->upload_cond);
+    pthread_mutex_destroy(&c->upload_lock);
+    av_freep(&c->upload_tids);
+    c->nb_upload_tids = 0;
+}
+#endif
+
+static int dashenc_io_open(AVFormatContext *s, AVIOContext **pb, char *filename,
+                           AVDictionary **options) {
+#if HAVE_THREADS
+    DASHContext *c = s->priv_data;
+
+    if (c->upload_tids) {
+        int barrier = 1;
+        for (int i = 0; i < s->nb_streams; i++)
+            if (pb == &c->streams[i].out)
+                barrier = 0;
+        return upload_open(s, pb, filename, options, barrier);
+    }
+#endif
+    return dashenc_url_open(s, pb, filename, options);
+}
+
+static void dashenc_io_close(AVFormatContext *s, AVIOContext **pb, char *filename) {
+#if HAVE_THREADS
+    if (*pb && (*pb)->write_packet == upload_write) {
+        upload_close(pb);
+        return;
+    }
+#endif
+    dashenc_url_close(s, pb, filename);
+}
+
+/* Release an output left open, e.g. on errors. */
+static void dashenc_io_free(AVFormatContext *s, AVIOContext **pb) {
+#if HAVE_THREADS
+    if (*pb && (*pb)->write_packet == upload_write) {
+        upload_close(pb);
+        return;
+    }
+#endif
+    ff_format_io_close(s, pb);
+}
+
 static const char *get_format_str(SegmentType segment_type)
 {
     switch (segment_type) {
@@ -621,7 +977,7 @@ static void dash_free(AVFormatContext *s)
             else
                 avio_close(os->ctx->pb);
         }
-        ff_format_io_close(s, &os->out);
+        dashenc_io_free(s, &os->out);
         avformat_free_context(os->ctx);
         avcodec_free_context(&os->parser_avctx);
         av_parser_close(os->parser);
@@ -634,9 +990,12 @@ static void dash_free(AVFormatContext *s)
     }
     av_freep(&c->streams);
 
-    ff_format_io_close(s, &c->mpd_out);
-    ff_format_io_close(s, &c->m3u8_out);
-    ff_format_io_close(s, &c->http_delete);
+    dashenc_io_free(s, &c->mpd_out);
+    dashenc_io_free(s, &c->m3u8_out);
+    dashenc_io_free(s, &c->http_delete);
+#if HAVE_THREADS
+    upload_uninit(s);
+#endif
 }
 
 static void output_segment_list(OutputStream *os, AVIOContext *out, AVFormatContext *s,
@@ -1459,6 +1818,21 @@ static int dash_init(AVFormatContext *s)
         c->min_playback_rate = c->max_playback_rate = (AVRational) {1, 1};
     }
 
+    if (c->upload_threads) {
+        const char *proto = avio_find_protocol_name(s->url);
+        if (!HAVE_THREADS) {
+            av_log(s, AV_LOG_WARNING, "Upload threads option will be ignored as threading is not available\n");
+        } else if (c->single_file) {
+            av_log(s, AV_LOG_WARNING, "Upload threads option will be ignored as single_file is enabled\n");
+        } else if (proto && !strcmp(proto, "file")) {
+            av_log(s, AV_LOG_WARNING, "Upload threads option will be ignored for file output\n");
+#if HAVE_THREADS
+        } else if ((ret = upload_init(s)) < 0) {
+            return ret;
+#endif
+        }
+    }
+
     av_strlcpy(c->dirname, s->url, sizeof(c->dirname));
     ptr = strrchr(c->dirname, '/');
     if (ptr) {
@@ -1583,7 +1957,7 @@ static int dash_init(AVFormatContext *s)
         if (!c->single_file) {
             if ((ret = avio_open_dyn_buf(&ctx->pb)) < 0)
                 return ret;
-            ret = s->io_open(s, &os->out, filename, AVIO_FLAG_WRITE, &opts);
+            ret = dashenc_io_open(s, &os->out, filename, &opts);
         } else {
             ctx->url = av_strdup(filename);
             ret = avio_open2(&ctx->pb, filename, AVIO_FLAG_WRITE, NULL, &opts);
@@ -2330,6 +2704,10 @@ static int dash_write_trailer(AVFormatContext *s)
         }
     }
 
+#if HAVE_THREADS
+    upload_uninit(s);
+#endif
+
     return 0;
 }
 
@@ -2397,6 +2775,7 @@ static const AVOption options[] = {
     { "target_latency", "Set desired target latency for Low-latency dash", OFFSET(target_latency), AV_OPT_TYPE_DURATION, { .i64 = 0 }, 0, INT_MAX, E },
     { "timeout", "set timeout for socket I/O operations", OFFSET(timeout), AV_OPT_TYPE_DURATION, { .i64 = -1 }, -1, INT_MAX, .flags = E },
     { "update_period", "Set the mpd update interval", OFFSET(update_period), AV_OPT_TYPE_INT64, {.i64 = 0}, 0, INT64_MAX, E},
+    { "upload_threads", "Number of threads uploading the output files asynchronously", OFFSET(upload_threads), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 64, E},
     { "use_template", "Use SegmentTemplate instead of SegmentList", OFFSET(use_template), AV_OPT_TYPE_BOOL, { .i64 = 1 }, 0, 1, E },
     { "use_timeline", "Use SegmentTimeline in SegmentTemplate", OFFSET(use_timeline), AV_OPT_TYPE_BOOL, { .i64 = 1 }, 0, 1, E },
     { "utc_timing_url", "URL of the page that will return the UTC timestamp in ISO format", OFFSET(utc_timing_url), AV_OPT_TYPE_STRING, { 0 }, 0, 0, E },
@@ -32,6 +32,7 @@
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "libavutil/pixfmt.h"
+#include "libavutil/slicethread.h"
 #include "libavutil/time.h"
 #include "libavutil/timestamp.h"
 
@@ -2522,6 +2523,404 @@ static int extract_extradata(FFFormatContext *si, AVStream *st, const AVPacket *
     return 0;
 }
 
+#define PROBE_CACHE_VERSION 2
+
+/**
+ * Write what identifies the input and the streams created by the demuxer
+ * before probing, a cache entry is only used when this matches.
+ */
+static int probe_cache_header(AVFormatContext *ic, int64_t offset,
+                              uint8_t **header, char **path)
+{
+    AVIOContext *pb;
+    FFFileId id;
+    int ret;
+
+    if (ff_file_id_get(ic->pb, &id) < 0)
+        return AVERROR(ENOSYS);
+
+    if ((ret = avio_open_dyn_buf(&pb)) < 0)
+        return ret;
+    avio_wl32(pb, MKTAG('F','P','R','C'));
+    avio_wl32(pb, PROBE_CACHE_VERSION);
+    avio_wl64(pb, id.size);
+    avio_wl64(pb, id.mtime_ns);
+    avio_wl64(pb, id.ino);
+    avio_wl64(pb, offset);
+    avio_put_str(pb, ic->iformat->name);
+    avio_wl32(pb, ic->nb_streams);
+    for (unsigned i = 0; i < ic->nb_streams; i++) {
+        const AVStream *const s = ic->streams[i];
+        avio_wl32(pb, s->codecpar->codec_type);
+        avio_wl32(pb, s->codecpar->codec_id);
+        avio_wl32(pb, s->time_base.num);
+        avio_wl32(pb, s->time_base.den);
+    }
+    ret = avio_close_dyn_buf(pb, header);
+    if (!*header)
+        return AVERROR(ENOMEM);
+
+    *path = av_asprintf("%s/%"PRIx64"-%"PRIx64".probe", ic->probe_cache, id.dev, id.ino);
+    if (!*path) {
+        av_freep(header);
+        return AVERROR(ENOMEM);
+    }
+    return ret;
+}
+
+static void probe_cache_write_rational(AVIOContext *pb, AVRational q)
+{
+    avio_wl32(pb, q.num);
+    avio_wl32(pb, q.den);
+}
+
+static AVRational probe_cache_read_rational(AVIOContext *pb)
+{
+    AVRational q;
+    q.num = avio_rl32(pb);
+    q.den = avio_rl32(pb);
+    return q;
+}
+
+static void probe_cache_write_stream(AVIOContext *pb, const AVStream *st)
+{
+    const AVCodecParameters *const par = st->codecpar;
+
+    avio_wl32(pb, par->codec_type);
+    avio_wl32(pb, par->codec_id);
+    avio_wl32(pb, par->codec_tag);
+    avio_wl32(pb, par->format);
+    avio_wl64(pb, par->bit_rate);
+    avio_wl32(pb, par->bits_per_coded_sample);
+    avio_wl32(pb, par->bits_per_raw_sample);
+    avio_wl32(pb, par->profile);
+    avio_wl32(pb, par->level);
+    avio_wl32(pb, par->width);
+    avio_wl32(pb, par->height);
+    probe_cache_write_rational(pb, par->sample_aspect_ratio);
+    probe_cache_write_rational(pb, par->framerate);
+    avio_wl32(pb, par->field_order);
+    avio_wl32(pb, par->color_range);
+    avio_wl32(pb, par->color_primaries);
+    avio_wl32(pb, par->color_trc);
+    avio_wl32(pb, par->color_space);
+    avio_wl32(pb, par->chroma_location);
+    avio_wl32(pb, par->video_delay);
+    avio_wl32(pb, par->ch_layout.order);
+    avio_wl32(pb, par->ch_layout.nb_channels);
+    avio_wl64(pb, par->ch_layout.u.mask);
+    avio_wl32(pb, par->sample_rate);
+    avio_wl32(pb, par->block_align);
+    avio_wl32(pb, par->frame_size);
+    avio_wl32(pb, par->initial_padding);
+    avio_wl32(pb, par->trailing_padding);
+    avio_wl32(pb, par->seek_preroll);
+    avio_wl32(pb, par->extradata_size);
+    avio_write(pb, par->extradata, par->extradata_size);
+    avio_wl32(pb, par->nb_coded_side_data);
+    for (int i = 0; i < par->nb_coded_side_data; i++) {
+        avio_wl32(pb, par->coded_side_data[i].type);
+        avio_wl32(pb, par->coded_side_data[i].size);
+        avio_write(pb, par->coded_side_data[i].data, par->coded_side_data[i].size);
+    }
+
+    probe_cache_write_rational(pb, st->sample_aspect_ratio);
+    probe_cache_write_rational(pb, st->r_frame_rate);
+    probe_cache_write_rational(pb, st->avg_frame_rate);
+    avio_wl64(pb, st->start_time);
+    avio_wl64(pb, st->duration);
+    avio_wl32(pb, st->disposition);
+    avio_wl32(pb, cffstream(st)->codec_info_nb_frames);
+}
+
+static uint8_t *probe_cache_read_data(AVIOContext *pb, int size)
+{
+    uint8_t *data;
+
+    if (size < 0 || size > INT_MAX - AV_INPUT_BUFFER_PADDING_SIZE)
+        return NULL;
+    data = av_mallocz(size + AV_INPUT_BUFFER_PADDING_SIZE);
+    if (data && ffio_read_size(pb, data, size) < 0)
+        av_freep(&data);
+    return data;
+}
+
+typedef struct ProbeCacheStream {
+    AVCodecParameters *par;
+    AVRational sample_aspect_ratio;
+    AVRational r_frame_rate;
+    AVRational avg_frame_rate;
+    int64_t start_time;
+    int64_t duration;
+    int disposition;
+    int codec_info_nb_frames;
+} ProbeCacheStream;
+
+static int probe_cache_read_stream(AVIOContext *pb, ProbeCacheStream *pcs)
+{
+    AVCodecParameters *const par = pcs->par;
+
+    par->codec_type             = avio_rl32(pb);
+    par->codec_id               = avio_rl32(pb);
+    par->codec_tag              = avio_rl32(pb);
+    par->format                 = (int)avio_rl32(pb);
+    par->bit_rate               = avio_rl64(pb);
+    par->bits_per_coded_sample  = avio_rl32(pb);
+    par->bits_per_raw_sample    = avio_rl32(pb);
+    par->profile                = (int)avio_rl32(pb);
+    par->level                  = (int)avio_rl32(pb);
+    par->width                  = avio_rl32(pb);
+    par->height                 = avio_rl32(pb);
+    par->sample_aspect_ratio    = probe_cache_read_rational(pb);
+    par->framerate              = probe_cache_read_rational(pb);
+    par->field_order            = avio_rl32(pb);
+    par->color_range            = avio_rl32(pb);
+    par->color_primaries        = avio_rl32(pb);
+    par->color_trc              = avio_rl32(pb);
+    par->color_space            = avio_rl32(pb);
+    par->chroma_location        = avio_rl32(pb);
+    par->video_delay            = avio_rl32(pb);
+    par->ch_layout.order        = avio_rl32(pb);
+    par->ch_layout.nb_channels  = avio_rl32(pb);
+    par->ch_layout.u.mask       = avio_rl64(pb);
+    par->sample_rate            = avio_rl32(pb);
+    par->block_align            = avio_rl32(pb);
+    par->frame_size             = avio_rl32(pb);
+    par->initial_padding        = avio_rl32(pb);
+    par->trailing_padding       = avio_rl32(pb);
+    par->seek_preroll           = avio_rl32(pb);
+
+    if (par->ch_layout.order != AV_CHANNEL_ORDER_UNSPEC &&
+        par->ch_layout.order != AV_CHANNEL_ORDER_NATIVE)
+        return AVERROR_INVALIDDATA;
+    if (par->ch_layout.nb_channels && !av_channel_layout_check(&par->ch_layout))
+        return AVERROR_INVALIDDATA;
+
+    par->extradata_size = avio_rl32(pb);
+    if (par->extradata_size) {
+        par->extradata = probe_cache_read_data(pb, par->extradata_size);
+        if (!par->extradata) {
+            par->extradata_size = 0;
+            return AVERROR_INVALIDDATA;
+        }
+    }
+
+    for (unsigned i = 0, nb = avio_rl32(pb); i < nb; i++) {
+        enum AVPacketSideDataType type = avio_rl32(pb);
+        int size = avio_rl32(pb);
+        uint8_t *data;
+
+        if (pb->eof_reached || !(data = probe_cache_read_data(pb, size)))
+            return AVERROR_INVALIDDATA;
+        if (!av_packet_side_data_add(&par->coded_side_data, &par->nb_coded_side_data,
+                                     type, data, size, 0)) {
+            av_free(data);
+            return AVERROR(ENOMEM);
+        }
+    }
+
+    pcs->sample_aspect_ratio  = probe_cache_read_rational(pb);
+    pcs->r_frame_rate         = probe_cache_read_rational(pb);
+    pcs->avg_frame_rate       = probe_cache_read_rational(pb);
+    pcs->start_time           = avio_rl64(pb);
+    pcs->duration             = avio_rl64(pb);
+    pcs->disposition          = avio_rl32(pb);
+    pcs->codec_info_nb_frames = avio_rl32(pb);
+
+    return pb->eof_reached ? AVERROR_INVALIDDATA : pb->error;
+}
+
+/**
+ * Fill the stream parameters from the cache entry of the input.
+ *
+ * @return 1 if they were found, 0 otherwise
+ */
+static int probe_cache_load(AVFormatContext *ic, const uint8_t *header,
+                            int size, const char *path)
+{
+    AVIOContext *pb = NULL;
+    ProbeCacheStream *streams = NULL;
+    uint8_t *buf = NULL;
+    int64_t start_time, duration, bit_rate;
+    int duration_estimation_method;
+    int ret = 0;
+
+    if (ic->io_open(ic, &pb, path, AVIO_FLAG_READ, NULL) < 0)
+        goto end;
+
+    buf     = av_malloc(size);
+    streams = av_calloc(ic->nb_streams, sizeof(*streams));
+    if (!buf || !streams ||
+        ffio_read_size(pb, buf, size) < 0 || memcmp(buf, header, size))
+        goto end;
+
+    start_time                 = avio_rl64(pb);
+    duration                   = avio_rl64(pb);
+    bit_rate                   = avio_rl64(pb);
+    duration_estimation_method = avio_rl32(pb);
+    for (unsigned i = 0; i < ic->nb_streams; i++) {
+        if (!(streams[i].par = avcodec_parameters_alloc()) ||
+            probe_cache_read_stream(pb, &streams[i]) < 0)
+            goto end;
+    }
+
+    for (unsigned i = 0; i < ic->nb_streams; i++) {
+        AVStream *const st  = ic->streams[i];
+        FFStream *const sti = ffstream(st);
+
+        if (avcodec_parameters_copy(st->codecpar, streams[i].par) < 0)
+            goto end;
+        st->sample_aspect_ratio   = streams[i].sample_aspect_ratio;
+        st->r_frame_rate          = streams[i].r_frame_rate;
+        st->avg_frame_rate        = streams[i].avg_frame_rate;
+        st->start_time            = streams[i].start_time;
+        st->duration              = streams[i].duration;
+        st->disposition           = streams[i].disposition;
+        sti->codec_info_nb_frames = streams[i].codec_info_nb_frames;
+        sti->need_context_update  = 1;
+        if (sti->request_probe > 0)
+            sti->request_probe = -1;
+    }
+    ic->start_time                 = start_time;
+    ic->duration                   = duration;
+    ic->bit_rate                   = bit_rate;
+    ic->duration_estimation_method = duration_estimation_method;
+    ret = 1;
+
+    av_log(ic, AV_LOG_VERBOSE, "Read stream parameters from %s\n", path);
+
+end:
+    for (unsigned i = 0; streams && i < ic->nb_streams; i++)
+        avcodec_parameters_free(&streams[i].par);
+    av_free(streams);
+    av_free(buf);
+    ff_format_io_close(ic, &pb);
+    return ret;
+}
+
+/**
+ * Store the stream parameters found for the input in its cache entry.
+ */
+static void probe_cache_save(AVFormatContext *ic, const uint8_t *header,
+                             int size, const char *path)
+{
+    AVIOContext *pb = NULL;
+    char *tmp = NULL;
+    int ret;
+
+    /* custom channel maps are not stored */
+    for (unsigned i = 0; i < ic->nb_streams; i++) {
+        const AVChannelLayout *ch_layout = &ic->streams[i]->codecpar->ch_layout;
+        if (ch_layout->order != AV_CHANNEL_ORDER_UNSPEC &&
+            ch_layout->order != AV_CHANNEL_ORDER_NATIVE)
+            return;
+    }
+
+    if ((ret = ff_cache_entry_open(ic, &pb, path, &tmp)) < 0)
+        goto fail;
+
+    avio_write(pb, header, size);
+    avio_wl64(pb, ic->start_time);
+    avio_wl64(pb, ic->duration);
+    avio_wl64(pb, ic->bit_rate);
+    avio_wl32(pb, ic->duration_estimation_method);
+    for (unsigned i = 0; i < ic->nb_streams; i++)
+        probe_cache_write_stream(pb, ic->streams[i]);
+    if ((ret = ff_cache_entry_commit(ic, &pb, path, &tmp)) >= 0)
+        return;
+
+fail:
+    av_log(ic, AV_LOG_WARNING, "Could not write probe cache %s: %s\n", path, av_err2str(ret));
+}
+
+#define PROBE_BATCH_SIZE 32
+
+/**
+ * Packets read while probing, decoded by a pool of threads with one job
+ * per stream. The calling thread waits for the whole batch, so the streams
+ * are never accessed concurrently with it.
+ */
+typedef struct ProbeDecodeContext {
+    AVFormatContext *ic;
+    AVDictionary **options;
+    int orig_nb_streams;
+    AVSliceThread *thread;
+
+    const AVPacket *pkts[PROBE_BATCH_SIZE];
+    /* codec_info_nb_frames of the stream when the packet was read */
+    int nb_frames[PROBE_BATCH_SIZE];
+    int nb_pkts;
+    int streams[PROBE_BATCH_SIZE];
+} ProbeDecodeContext;
+
+static void probe_decode_worker(void *priv, int jobnr, int threadnr,
+                                int nb_jobs, int nb_threads)
+{
+    ProbeDecodeContext *const pd = priv;
+    AVStream *const st  = pd->ic->streams[pd->streams[jobnr]];
+    FFStream *const sti = ffstream(st);
+    int nb_frames = sti->codec_info_nb_frames;
+
+    for (int i = 0; i < pd->nb_pkts; i++) {
+        if (pd->pkts[i]->stream_index != st->index)
+            continue;
+        /* decode as if the packet had just been read */
+        sti->codec_info_nb_frames = pd->nb_frames[i];
+        try_decode_frame(pd->ic, st, pd->pkts[i],
+                         (pd->options && st->index < pd->orig_nb_streams) ?
+                         &pd->options[st->index] : NULL);
+    }
+    sti->codec_info_nb_frames = nb_frames;
+}
+
+static void probe_decode_flush(ProbeDecodeContext *pd)
+{
+    int nb_streams = 0;
+
+    for (int i = 0; i < pd->nb_pkts; i++) {
+        int j;
+        for (j = 0; j < nb_streams; j++)
+            if (pd->streams[j] == pd->pkts[i]->stream_index)
+                break;
+        if (j == nb_streams)
+            pd->streams[nb_streams++] = pd->pkts[i]->stream_index;
+    }
+    if (nb_streams)
+        avpriv_slicethread_execute(pd->thread, nb_streams, 0);
+    pd->nb_pkts = 0;
+}
+
+static ProbeDecodeContext *probe_decode_alloc(AVFormatContext *ic, AVDictionary **options)
+{
+    ProbeDecodeContext *pd;
+
+    /* the packets must stay in the packet buffer until decoded */
+    if (ic->probe_threads == 1 || (ic->flags & AVFMT_FLAG_NOBUFFER))
+        return NULL;
+
+    pd = av_mallocz(sizeof(*pd));
+    if (!pd)
+        return NULL;
+    if (avpriv_slicethread_create(&pd->thread, pd, probe_decode_worker,
+                                  NULL, ic->probe_threads) <= 1) {
+        avpriv_slicethread_free(&pd->thread);
+        av_free(pd);
+        return NULL;
+    }
+    pd->ic              = ic;
+    pd->options         = options;
+    pd->orig_nb_streams = ic->nb_streams;
+    return pd;
+}
+
+static void probe_decode_free(ProbeDecodeContext **pd)
+{
+    if (!*pd)
+        return;
+    avpriv_slicethread_free(&(*pd)->thread);
+    av_freep(pd);
+}
+
 int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
 {
     FFFormatContext *const si = ffformatcontext(ic);
@@ -2537,6 +2936,20 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
     int64_t max_subtitle_analyze_duration;
     int64_t probesize = ic->probesize;
     int eof_reached = 0;
+    int incomplete = 0;
+    ProbeDecodeContext *pd = NULL;
+    uint8_t *cache_header = NULL;
+    char *cache_path = NULL;
+    int cache_header_size = -1;
+
+    if (ic->probe_cache) {
+        cache_header_size = probe_cache_header(ic, old_offset, &cache_header, &cache_path);
+        if (cache_header_size >= 0 &&
+            probe_cache_load(ic, cache_header, cache_header_size, cache_path)) {
+            ret = compute_chapters_end(ic);
+            goto find_stream_info_err;
+        }
+    }
 
     flush_codecs = probesize > 0;
 
@@ -2616,6 +3029,8 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
             av_dict_free(&thread_opt);
     }
 
+    pd = probe_decode_alloc(ic, options);
+
     read_size = 0;
     for (;;) {
         const AVPacket *pkt;
@@ -2844,8 +3259,14 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
          * least one frame of codec data, this makes sure the codec initializes
          * the channel configuration and does not only trust the values from
          * the container. */
-        try_decode_frame(ic, st, pkt,
-                         (options && i < orig_nb_streams) ? &options[i] : NULL);
+        if (pd) {
+            pd->pkts[pd->nb_pkts]        = pkt;
+            pd->nb_frames[pd->nb_pkts++] = sti->codec_info_nb_frames;
+            if (pd->nb_pkts == PROBE_BATCH_SIZE)
+                probe_decode_flush(pd);
+        } else
+            try_decode_frame(ic, st, pkt,
+                             (options && i < orig_nb_streams) ? &options[i] : NULL);
 
         if (ic->flags & AVFMT_FLAG_NOBUFFER)
             av_packet_unref(pkt1);
@@ -2854,6 +3275,9 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
         count++;
     }
 
+    if (pd)
+        probe_decode_flush(pd);
+
     if (eof_reached) {
         for (unsigned stream_index = 0; stream_index < ic->nb_streams; stream_index++) {
             AVStream *const st = ic->streams[stream_index];
@@ -3030,6 +3454,7 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
                    "Could not find codec parameters for stream %d (%s): %s\n"
                    "Consider increasing the value for the 'analyzeduration' (%"PRId64") and 'probesize' (%"PRId64") options\n",
                    i, buf, errmsg, ic->max_analyze_duration, ic->probesize);
+            incomplete = 1;
         } else {
             ret = 0;
         }
@@ -3099,7 +3524,14 @@ FF_ENABLE_DEPRECATION_WARNINGS
 #endif
     }
 
+    /* streams created while probing would be missing on a cache hit */
+    if (cache_header_size >= 0 && !incomplete && ic->nb_streams == orig_nb_streams)
+        probe_cache_save(ic, cache_header, cache_header_size, cache_path);
+
 find_stream_info_err:
+    probe_decode_free(&pd);
+    av_free(cache_header);
+    av_free(cache_path);
     for (unsigned i = 0; i < ic->nb_streams; i++) {
         AVStream *const st  = ic->streams[i];
         FFStream *const sti = ffstream(st);
@@ -83,6 +83,13 @@ typedef struct FifoContext {
     atomic_int_least64_t queue_duration;
     int64_t last_sent_dts;
     int64_t timeshift;
+
+    /* Queue statistics, packets received from the caller are counted by
+     * fifo_write_packet(), packets passed to the muxer by the consumer
+     * thread, which are only read once the thread has been joined. */
+    int64_t nb_pkts_received;
+    int64_t nb_pkts_written;
+    int max_queued;
 } FifoContext;
 
 typedef struct FifoThreadContext {
@@ -210,6 +217,7 @@ static int fifo_thread_write_packet(FifoThreadContext *ctx, AVPacket *pkt)
 
     ret = av_write_frame(avf2, pkt);
     if (ret >= 0) {
+        fifo->nb_pkts_written++;
         av_packet_unref(pkt);
     } else {
         // avoid scaling twice
@@ -585,11 +593,15 @@ static int fifo_write_packet(AVFormatContext *avf, AVPacket *pkt)
         ret = av_packet_ref(&msg.pkt,pkt);
         if (ret < 0)
             return ret;
+        fifo->nb_pkts_received++;
     }
 
     ret = av_thread_message_queue_send(fifo->queue, &msg,
                                        fifo->drop_pkts_on_overflow ?
                                        AV_THREAD_MESSAGE_NONBLOCK : 0);
+    if (ret >= 0)
+        fifo->max_queued = FFMAX(fifo->max_queued,
+                                 av_thread_message_queue_nb_elems(fifo->queue));
     if (ret == AVERROR(EAGAIN)) {
         uint8_t overflow_set = 0;
 
@@ -654,6 +666,12 @@ static int fifo_write_trailer(AVFormatContext *avf)
         return AVERROR(ret);
     }
 
+    av_log(avf, AV_LOG_VERBOSE, "%"PRId64" packets received, %"PRId64" written, "
+           "%"PRId64" dropped, queue peak %d/%d\n",
+           fifo->nb_pkts_received, fifo->nb_pkts_written,
+           fifo->nb_pkts_received - fifo->nb_pkts_written,
+           fifo->max_queued, fifo->queue_size);
+
     ret = fifo->write_trailer_ret;
     return ret;
 }
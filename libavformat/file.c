@@ -19,9 +19,12 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#define _GNU_SOURCE /* O_DIRECT */
+
 #include "config_components.h"
 
 #include "libavutil/avstring.h"
+#include "libavutil/buffer.h"
 #include "libavutil/file_open.h"
 #include "libavutil/internal.h"
 #include "libavutil/mem.h"
@@ -42,6 +45,19 @@
 #include "os_support.h"
 #include "url.h"
 
+#define USE_IO_URING (CONFIG_FILE_PROTOCOL && HAVE_LINUX_IO_URING_H && HAVE_MMAP)
+
+#if HAVE_MMAP
+#include <sys/mman.h>
+#endif
+#if USE_IO_URING
+#include <stdatomic.h>
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+#include "libavcodec/defs.h"
+
 /* Some systems may not have S_ISFIFO */
 #ifndef S_ISFIFO
 #  ifdef S_IFIFO
@@ -99,6 +115,13 @@ typedef struct FileContext {
 #if HAVE_DIRENT_H
     DIR *dir;
 #endif
+    int io_uring;
+    int io_uring_depth;
+    int io_uring_block_size;
+    int direct;
+    struct URing *ring;
+    int mmap;
+    AVBufferRef *map;
 } FileContext;
 
 static const AVOption file_options[] = {
@@ -106,6 +129,11 @@ static const AVOption file_options[] = {
     { "blocksize", "set I/O operation maximum block size", offsetof(FileContext, blocksize), AV_OPT_TYPE_INT, { .i64 = INT_MAX }, 1, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM },
     { "follow", "Follow a file as it is being written", offsetof(FileContext, follow), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
     { "seekable", "Sets if the file is seekable", offsetof(FileContext, seekable), AV_OPT_TYPE_INT, { .i64 = -1 }, -1, 0, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM },
+    { "io_uring", "read through io_uring with several requests in flight", offsetof(FileContext, io_uring), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
+    { "io_uring_depth", "set the maximum number of io_uring reads in flight", offsetof(FileContext, io_uring_depth), AV_OPT_TYPE_INT, { .i64 = 8 }, 1, 64, AV_OPT_FLAG_DECODING_PARAM },
+    { "io_uring_block_size", "set the size of io_uring reads", offsetof(FileContext, io_uring_block_size), AV_OPT_TYPE_INT, { .i64 = 1 << 20 }, 4096, 1 << 26, AV_OPT_FLAG_DECODING_PARAM },
+    { "direct", "bypass the page cache for io_uring reads", offsetof(FileContext, direct), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
+    { "mmap", "map the file to let demuxers reference its data", offsetof(FileContext, mmap), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
     { NULL }
 };
 
@@ -133,11 +161,384 @@ static const AVClass fd_class = {
     .version    = LIBAVUTIL_VERSION_INT,
 };
 
+#if USE_IO_URING
+/* io_uring reads, driven through the system calls directly */
+
+#define URING_ALIGN 4096
+
+typedef struct URingBlock {
+    int64_t pos;        ///< file offset of the read
+    int     len;        ///< number of bytes read or negative errno
+    int     pending;    ///< read in flight
+} URingBlock;
+
+typedef struct URing {
+    int fd;
+    int file_fd;
+
+    uint8_t *sq_ring, *cq_ring;
+    size_t sq_ring_size, cq_ring_size;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+    atomic_uint *sq_tail, *cq_head, *cq_tail;
+    unsigned *sq_array, sq_mask, cq_mask;
+    struct io_uring_cqe *cqes;
+
+    uint8_t *buf;
+    size_t buf_size;
+    int block_size;
+    int fixed;          ///< buffers are registered with the ring
+    struct iovec *iov;
+    URingBlock *blocks;
+    int nb_blocks;
+
+    int head;           ///< block holding the current position
+    int count;          ///< number of blocks read or in flight, from head
+    int window;         ///< number of blocks to keep ahead, grows while reading sequentially
+    int inflight;
+    int to_submit;
+    int off;            ///< current position inside the head block
+    int fresh;          ///< head block is the first one read after a restart
+    int64_t pos;        ///< current position when no block is queued
+    int64_t next_pos;   ///< file offset of the next block to queue
+} URing;
+
+static int uring_enter(URing *r, unsigned to_submit, unsigned min_complete)
+{
+    int ret = syscall(__NR_io_uring_enter, r->fd, to_submit, min_complete,
+                      min_complete ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+    return ret < 0 ? AVERROR(errno) : ret;
+}
+
+static void uring_queue(URing *r, int idx)
+{
+    URingBlock *b = &r->blocks[idx];
+    unsigned tail = atomic_load_explicit(r->sq_tail, memory_order_relaxed);
+    struct io_uring_sqe *sqe = &r->sqes[tail & r->sq_mask];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->fd  = r->file_fd;
+    sqe->off = b->pos;
+    if (r->fixed) {
+        sqe->opcode    = IORING_OP_READ_FIXED;
+        sqe->addr      = (uintptr_t)r->iov[idx].iov_base;
+        sqe->len       = r->block_size;
+        sqe->buf_index = idx;
+    } else {
+        sqe->opcode    = IORING_OP_READV;
+        sqe->addr      = (uintptr_t)&r->iov[idx];
+        sqe->len       = 1;
+    }
+    sqe->user_data = idx;
+
+    r->sq_array[tail & r->sq_mask] = tail & r->sq_mask;
+    atomic_store_explicit(r->sq_tail, tail + 1, memory_order_release);
+
+    b->pending = 1;
+    r->inflight++;
+    r->to_submit++;
+}
+
+static int uring_submit(URing *r)
+{
+    while (r->to_submit) {
+        int ret = uring_enter(r, r->to_submit, 0);
+        if (ret == AVERROR(EINTR))
+            continue;
+        if (ret <= 0)
+            return ret ? ret : AVERROR(EIO);
+        r->to_submit -= ret;
+    }
+    return 0;
+}
+
+/* Submit the queued reads and wait for at least one completion. */
+static int uring_wait(URing *r)
+{
+    for (;;) {
+        unsigned head = atomic_load_explicit(r->cq_head, memory_order_relaxed);
+        unsigned tail = atomic_load_explicit(r->cq_tail, memory_order_acquire);
+        int ret;
+
+        if (head != tail) {
+            for (; head != tail; head++) {
+                const struct io_uring_cqe *cqe = &r->cqes[head & r->cq_mask];
+                URingBlock *b = &r->blocks[cqe->user_data];
+
+                b->len     = cqe->res;
+                b->pending = 0;
+                r->inflight--;
+            }
+            atomic_store_explicit(r->cq_head, head, memory_order_release);
+            return 0;
+        }
+
+        ret = uring_enter(r, r->to_submit, 1);
+        if (ret == AVERROR(EINTR))
+            continue;
+        if (ret < 0)
+            return ret;
+        r->to_submit -= ret;
+    }
+}
+
+static int uring_fill(URing *r)
+{
+    while (r->count < r->window) {
+        int idx = (r->head + r->count) % r->nb_blocks;
+
+        r->blocks[idx].pos = r->next_pos;
+        r->next_pos += r->block_size;
+        uring_queue(r, idx);
+        r->count++;
+    }
+    return uring_submit(r);
+}
+
+static int64_t uring_tell(const URing *r)
+{
+    return r->count ? r->blocks[r->head].pos + r->off : r->pos;
+}
+
+/* Wait for all reads and drop the blocks, keeping the current position. */
+static int uring_reset(URing *r)
+{
+    int ret = 0;
+
+    while (r->inflight && ret >= 0)
+        ret = uring_wait(r);
+    r->pos    = uring_tell(r);
+    r->count  = 0;
+    r->window = 1;
+    return ret;
+}
+
+/* Copy from the blocks read so far, only waiting when nothing was copied. */
+static int uring_read(URing *r, unsigned char *buf, int size)
+{
+    int done = 0;
+
+    for (;;) {
+        URingBlock *b;
+        int ret;
+
+        if (!r->count) {
+            /* direct I/O needs aligned offsets */
+            r->next_pos = r->pos & ~(int64_t)(URING_ALIGN - 1);
+            r->off      = r->pos - r->next_pos;
+            r->head     = 0;
+            r->fresh    = 1;
+            if ((ret = uring_fill(r)) < 0)
+                return done ? done : ret;
+        }
+
+        b = &r->blocks[r->head];
+        if (b->pending && done)
+            return done;
+        while (b->pending)
+            if ((ret = uring_wait(r)) < 0)
+                return ret;
+
+        if (b->len == -EAGAIN || b->len == -EINTR) {
+            uring_queue(r, r->head);
+            if ((ret = uring_submit(r)) < 0)
+                return done ? done : ret;
+            continue;
+        } else if (b->len < 0) {
+            if (done)
+                return done;
+            ret = AVERROR(-b->len);
+            uring_reset(r);
+            return ret;
+        }
+
+        if (r->off < b->len) {
+            int len = FFMIN(size - done, b->len - r->off);
+            memcpy(buf + done, (uint8_t *)r->iov[r->head].iov_base + r->off, len);
+            r->off += len;
+            done   += len;
+            if (done == size)
+                return done;
+            continue;
+        }
+
+        if (b->len < r->block_size) {
+            /* A short read is normally the end of the file, restart from the
+             * current position to tell it apart from an interrupted read. */
+            if (done)
+                return done;
+            if (r->fresh)
+                return AVERROR_EOF;
+            if ((ret = uring_reset(r)) < 0)
+                return ret;
+            continue;
+        }
+
+        r->head   = (r->head + 1) % r->nb_blocks;
+        r->off    = 0;
+        r->fresh  = 0;
+        r->count--;
+        r->window = FFMIN(r->window * 2, r->nb_blocks);
+        if ((ret = uring_fill(r)) < 0)
+            return done ? done : ret;
+    }
+}
+
+static int64_t uring_seek(URing *r, int64_t pos)
+{
+    int ret;
+
+    if (r->count) {
+        int64_t start = r->blocks[r->head].pos;
+
+        if (pos >= start && pos < start + (int64_t)r->count * r->block_size) {
+            int n = (pos - start) / r->block_size;
+
+            for (int i = 0; i < n; i++) {
+                while (r->blocks[r->head].pending)
+                    if ((ret = uring_wait(r)) < 0)
+                        return ret;
+                r->head = (r->head + 1) % r->nb_blocks;
+                r->count--;
+                r->fresh = 0;
+            }
+            r->off = pos - r->blocks[r->head].pos;
+            if ((ret = uring_fill(r)) < 0)
+                return ret;
+            return pos;
+        }
+
+        if ((ret = uring_reset(r)) < 0)
+            return ret;
+    }
+
+    r->pos = pos;
+    return pos;
+}
+
+static void uring_free(URing **pr)
+{
+    URing *r = *pr;
+
+    if (!r)
+        return;
+
+    if (r->fd >= 0) {
+        while (r->inflight && uring_wait(r) >= 0)
+            ;
+        close(r->fd);
+    }
+    if (r->sq_ring)
+        munmap(r->sq_ring, r->sq_ring_size);
+    if (r->cq_ring && r->cq_ring != r->sq_ring)
+        munmap(r->cq_ring, r->cq_ring_size);
+    if (r->sqes)
+        munmap(r->sqes, r->sqes_size);
+    if (r->buf)
+        munmap(r->buf, r->buf_size);
+    av_freep(&r->iov);
+    av_freep(&r->blocks);
+    av_freep(pr);
+}
+
+static void *uring_mmap(size_t size, int fd, off_t offset)
+{
+    void *ptr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                     fd >= 0 ? MAP_SHARED : MAP_PRIVATE | MAP_ANONYMOUS,
+                     fd, offset);
+    return ptr == MAP_FAILED ? NULL : ptr;
+}
+
+static int uring_init(URLContext *h, FileContext *c)
+{
+    struct io_uring_params p = { 0 };
+    URing *r;
+
+    r = c->ring = av_mallocz(sizeof(*r));
+    if (!r)
+        return AVERROR(ENOMEM);
+    r->file_fd    = c->fd;
+    r->nb_blocks  = c->io_uring_depth;
+    r->block_size = FFALIGN(c->io_uring_block_size, URING_ALIGN);
+    r->window     = 1;
+
+    r->fd = syscall(__NR_io_uring_setup, r->nb_blocks, &p);
+    if (r->fd < 0)
+        goto fail;
+
+    r->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cq_ring_size = p.cq_off.cqes  + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+        r->sq_ring_size = r->cq_ring_size = FFMAX(r->sq_ring_size, r->cq_ring_size);
+    r->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+
+    r->sq_ring = uring_mmap(r->sq_ring_size, r->fd, IORING_OFF_SQ_RING);
+    if (!r->sq_ring)
+        goto fail;
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+        r->cq_ring = r->sq_ring;
+    else if (!(r->cq_ring = uring_mmap(r->cq_ring_size, r->fd, IORING_OFF_CQ_RING)))
+        goto fail;
+    r->sqes = uring_mmap(r->sqes_size, r->fd, IORING_OFF_SQES);
+    if (!r->sqes)
+        goto fail;
+
+    r->sq_tail  = (atomic_uint *)(r->sq_ring + p.sq_off.tail);
+    r->sq_mask  = *(unsigned *)  (r->sq_ring + p.sq_off.ring_mask);
+    r->sq_array = (unsigned *)   (r->sq_ring + p.sq_off.array);
+    r->cq_head  = (atomic_uint *)(r->cq_ring + p.cq_off.head);
+    r->cq_tail  = (atomic_uint *)(r->cq_ring + p.cq_off.tail);
+    r->cq_mask  = *(unsigned *)  (r->cq_ring + p.cq_off.ring_mask);
+    r->cqes     = (struct io_uring_cqe *)(r->cq_ring + p.cq_off.cqes);
+
+    /* page aligned, as needed for direct I/O */
+    r->buf_size = (size_t)r->nb_blocks * r->block_size;
+    r->buf      = uring_mmap(r->buf_size, -1, 0);
+    r->blocks   = av_calloc(r->nb_blocks, sizeof(*r->blocks));
+    r->iov      = av_calloc(r->nb_blocks, sizeof(*r->iov));
+    if (!r->buf || !r->blocks || !r->iov)
+        goto fail;
+    for (int i = 0; i < r->nb_blocks; i++) {
+        r->iov[i].iov_base = r->buf + (size_t)i * r->block_size;
+        r->iov[i].iov_len  = r->block_size;
+    }
+
+    /* Registered buffers are not mapped again for every read, but may be
+     * refused because of the locked memory limit. */
+    r->fixed = syscall(__NR_io_uring_register, r->fd, IORING_REGISTER_BUFFERS,
+                       r->iov, r->nb_blocks) >= 0;
+    if (!r->fixed)
+        av_log(h, AV_LOG_DEBUG, "Could not register io_uring buffers: %s\n",
+               av_err2str(AVERROR(errno)));
+
+#ifdef O_DIRECT
+    if (c->direct) {
+        int fl = fcntl(c->fd, F_GETFL);
+        if (fl == -1 || fcntl(c->fd, F_SETFL, fl | O_DIRECT) == -1)
+            av_log(h, AV_LOG_WARNING, "Could not enable direct I/O: %s\n",
+                   av_err2str(AVERROR(errno)));
+    }
+#endif
+
+    return 0;
+fail:
+    {
+        int ret = AVERROR(errno);
+        uring_free(&c->ring);
+        return ret;
+    }
+}
+#endif /* USE_IO_URING */
+
 static int file_read(URLContext *h, unsigned char *buf, int size)
 {
     FileContext *c = h->priv_data;
     int ret;
     size = FFMIN(size, c->blocksize);
+#if USE_IO_URING
+    if (c->ring)
+        return uring_read(c->ring, buf, size);
+#endif
     ret = read(c->fd, buf, size);
     if (ret == 0 && c->follow)
         return AVERROR(EAGAIN);
@@ -218,7 +619,12 @@ static int fd_dup(URLContext *h, int oldfd)
 static int file_close(URLContext *h)
 {
     FileContext *c = h->priv_data;
-    int ret = close(c->fd);
+    int ret;
+#if USE_IO_URING
+    uring_free(&c->ring);
+#endif
+    av_buffer_unref(&c->map);
+    ret = close(c->fd);
     return (ret == -1) ? AVERROR(errno) : 0;
 }
 
@@ -234,6 +640,24 @@ static int64_t file_seek(URLContext *h, int64_t pos, int whence)
         return ret < 0 ? AVERROR(errno) : (S_ISFIFO(st.st_mode) ? 0 : st.st_size);
     }
 
+#if USE_IO_URING
+    if (c->ring) {
+        if (whence == SEEK_CUR) {
+            pos += uring_tell(c->ring);
+        } else if (whence == SEEK_END) {
+            struct stat st;
+            if (fstat(c->fd, &st) < 0)
+                return AVERROR(errno);
+            pos += st.st_size;
+        } else if (whence != SEEK_SET) {
+            return AVERROR(EINVAL);
+        }
+        if (pos < 0)
+            return AVERROR(EINVAL);
+        return uring_seek(c->ring, pos);
+    }
+#endif
+
     ret = lseek(c->fd, pos, whence);
 
     return ret < 0 ? AVERROR(errno) : ret;
@@ -241,6 +665,51 @@ static int64_t file_seek(URLContext *h, int64_t pos, int whence)
 
 #if CONFIG_FILE_PROTOCOL
 
+#if HAVE_MMAP
+static void file_unmap(void *opaque, uint8_t *data)
+{
+    munmap(data, (size_t)(uintptr_t)opaque);
+}
+
+/* The mapping outlives the protocol while packets reference it. */
+static void file_map(URLContext *h, FileContext *c, int64_t size)
+{
+    void *ptr;
+
+    if (size <= AV_INPUT_BUFFER_PADDING_SIZE || size > SIZE_MAX)
+        return;
+
+    ptr = mmap(NULL, size, PROT_READ, MAP_SHARED, c->fd, 0);
+    if (ptr == MAP_FAILED) {
+        av_log(h, AV_LOG_VERBOSE, "Could not map the file: %s\n",
+               av_err2str(AVERROR(errno)));
+        return;
+    }
+
+    c->map = av_buffer_create(ptr, size, file_unmap, (void *)(uintptr_t)size,
+                              AV_BUFFER_FLAG_READONLY);
+    if (!c->map)
+        munmap(ptr, size);
+}
+
+static int file_get_buffer(URLContext *h, int64_t pos, int size, AVBufferRef **buf)
+{
+    FileContext *c = h->priv_data;
+
+    if (!c->map || pos < 0 || size <= 0 ||
+        pos + size > (int64_t)c->map->size - AV_INPUT_BUFFER_PADDING_SIZE)
+        return AVERROR(ENOSYS);
+
+    *buf = av_buffer_ref(c->map);
+    if (!*buf)
+        return AVERROR(ENOMEM);
+    (*buf)->data += pos;
+    (*buf)->size  = size + AV_INPUT_BUFFER_PADDING_SIZE;
+
+    return size;
+}
+#endif
+
 static int file_delete(URLContext *h)
 {
 #if HAVE_UNISTD_H
@@ -315,6 +784,22 @@ static int file_open(URLContext *h, const char *filename, int flags)
     if (c->seekable >= 0)
         h->is_streamed = !c->seekable;
 
+#if HAVE_MMAP
+    if (c->mmap && !(flags & AVIO_FLAG_WRITE) && !c->follow &&
+        !fstat(fd, &st) && S_ISREG(st.st_mode))
+        file_map(h, c, st.st_size);
+#endif
+
+#if USE_IO_URING
+    if (c->io_uring && !(flags & AVIO_FLAG_WRITE) && !c->follow &&
+        !fstat(fd, &st) && S_ISREG(st.st_mode)) {
+        int ret = uring_init(h, c);
+        if (ret < 0)
+            av_log(h, AV_LOG_VERBOSE, "io_uring not available, using read(): %s\n",
+                   av_err2str(ret));
+    }
+#endif
+
     return 0;
 }
 
@@ -410,6 +895,9 @@ const URLProtocol ff_file_protocol = {
     .url_seek            = file_seek,
     .url_close           = file_close,
     .url_get_file_handle = file_get_handle,
+#if HAVE_MMAP
+    .url_get_buffer      = file_get_buffer,
+#endif
     .url_check           = file_check,
     .url_delete          = file_delete,
     .url_move            = file_move,
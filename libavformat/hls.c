@@ -27,8 +27,11 @@
  * https://www.rfc-editor.org/rfc/rfc8216.txt
  */
 
+#include "config.h"
 #include "config_components.h"
 
+#include <stdatomic.h>
+
 #include "libavformat/http.h"
 #include "libavutil/aes.h"
 #include "libavutil/avstring.h"
@@ -38,6 +41,7 @@
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "libavutil/dict.h"
+#include "libavutil/thread.h"
 #include "libavutil/time.h"
 #include "avformat.h"
 #include "demux.h"
@@ -88,6 +92,51 @@ struct segment {
 
 struct rendition;
 
+/* Location of data downloaded by a prefetch thread. */
+struct prefetch_request {
+    char *url;
+    char *key;
+    enum KeyType key_type;
+    uint8_t iv[16];
+    int64_t url_offset;
+    int64_t size;
+};
+
+/*
+ * A segment (and its Media Initialization Section, if it differs from
+ * the one of the previous segment) downloaded into memory ahead of time
+ * by a background thread.
+ */
+struct prefetch {
+    AVFormatContext *parent;
+    int active;             /* the slot is in use */
+#if HAVE_THREADS
+    pthread_t thread;
+    int joinable;
+#endif
+    atomic_int abort;
+    AVIOInterruptCB interrupt_cb;
+
+    int64_t seq_no;
+    struct segment *init_section;
+    struct prefetch_request seg;
+    struct prefetch_request init;
+    AVDictionary *opts;
+
+    /* key of the segment, and whether the thread has to download it */
+    uint8_t key[16];
+    int key_fetch;
+
+    /* set by the thread */
+    int ret;
+    int init_ret;
+    uint8_t *data;
+    size_t data_len;
+    uint8_t *init_data;
+    size_t init_len;
+    size_t reserved;        /* bytes accounted in the memory budget */
+};
+
 enum PlaylistType {
     PLS_TYPE_UNSPECIFIED,
     PLS_TYPE_EVENT,
@@ -107,6 +156,8 @@ struct playlist {
     int input_read_done;
     AVIOContext *input_next;
     int input_next_requested;
+    struct prefetch *prefetch;      /* prefetch_segments slots */
+    struct prefetch *cur_prefetch;  /* data of the current segment, if prefetched */
     AVFormatContext *parent;
     int index;
     AVFormatContext *ctx;
@@ -228,6 +279,9 @@ typedef struct HLSContext {
     int http_multiple;
     int http_seekable;
     int seg_max_retry;
+    int prefetch_segments;
+    int64_t prefetch_max_size;
+    atomic_size_t prefetch_mem;
     AVIOContext *playlist_pb;
     HLSCryptoContext  crypto_ctx;
 } HLSContext;
@@ -261,6 +315,8 @@ static void free_init_section_list(struct playlist *pls)
     pls->n_init_sections = 0;
 }
 
+static void prefetch_cancel(struct playlist *pls);
+
 static void free_playlist_list(HLSContext *c)
 {
     int i;
@@ -280,6 +336,8 @@ static void free_playlist_list(HLSContext *c)
         pls->input_read_done = 0;
         ff_format_io_close(c->ctx, &pls->input_next);
         pls->input_next_requested = 0;
+        prefetch_cancel(pls);
+        av_freep(&pls->prefetch);
         if (pls->ctx) {
             pls->ctx->pb = NULL;
             avformat_close_input(&pls->ctx);
@@ -644,13 +702,10 @@ static int open_url_keepalive(AVFormatContext *s, AVIOContext **pb,
 #endif
 }
 
-static int open_url(AVFormatContext *s, AVIOContext **pb, const char *url,
-                    AVDictionary **opts, AVDictionary *opts2, int *is_http_out)
+static int check_url(AVFormatContext *s, const char *url, int *is_http_out)
 {
     HLSContext *c = s->priv_data;
-    AVDictionary *tmp = NULL;
     const char *proto_name = NULL;
-    int ret;
     int is_http = 0;
 
     if (av_strstart(url, "crypto", NULL)) {
@@ -692,6 +747,23 @@ static int open_url(AVFormatContext *s, AVIOContext **pb, const char *url,
     else if (strcmp(proto_name, "file") || !strncmp(url, "file,", 5))
         return AVERROR_INVALIDDATA;
 
+    *is_http_out = is_http;
+
+    return 0;
+}
+
+static int open_url(AVFormatContext *s, AVIOContext **pb, const char *url,
+                    AVDictionary **opts, AVDictionary *opts2, int *is_http_out)
+{
+    HLSContext *c = s->priv_data;
+    AVDictionary *tmp = NULL;
+    int ret;
+    int is_http;
+
+    ret = check_url(s, url, &is_http);
+    if (ret < 0)
+        return ret;
+
     av_dict_copy(&tmp, *opts, 0);
     av_dict_copy(&tmp, opts2, 0);
 
@@ -1072,7 +1144,14 @@ static int read_from_url(struct playlist *pls, struct segment *seg,
     if (seg->size >= 0)
         buf_size = FFMIN(buf_size, seg->size - pls->cur_seg_offset);
 
-    ret = avio_read(pls->input, buf, buf_size);
+    if (pls->cur_prefetch) {
+        const struct prefetch *p = pls->cur_prefetch;
+        ret = FFMIN(buf_size, p->data_len - pls->cur_seg_offset);
+        if (!ret)
+            return AVERROR_EOF;
+        memcpy(buf, p->data + pls->cur_seg_offset, ret);
+    } else
+        ret = avio_read(pls->input, buf, buf_size);
     if (ret > 0)
         pls->cur_seg_offset += ret;
 
@@ -1363,7 +1442,8 @@ cleanup:
     return ret;
 }
 
-static int update_init_section(struct playlist *pls, struct segment *seg)
+static int update_init_section(struct playlist *pls, struct segment *seg,
+                               const struct prefetch *p)
 {
     static const int max_init_section_size = 1024*1024;
     HLSContext *c = pls->parent->priv_data;
@@ -1379,6 +1459,15 @@ static int update_init_section(struct playlist *pls, struct segment *seg)
     if (!seg->init_section)
         return 0;
 
+    if (p && p->init_section == seg->init_section && p->init_ret >= 0) {
+        av_fast_malloc(&pls->init_sec_buf, &pls->init_sec_buf_size, p->init_len);
+        if (!pls->init_sec_buf)
+            return AVERROR(ENOMEM);
+        memcpy(pls->init_sec_buf, p->init_data, p->init_len);
+        ret = p->init_len;
+        goto done;
+    }
+
     ret = open_input(c, pls, seg->init_section, &pls->input);
     if (ret < 0) {
         av_log(pls->parent, AV_LOG_WARNING,
@@ -1409,6 +1498,7 @@ static int update_init_section(struct playlist *pls, struct segment *seg)
     if (ret < 0)
         return ret;
 
+done:
     pls->cur_init_section = seg->init_section;
     pls->init_sec_data_len = ret;
     pls->init_sec_buf_read_offset = 0;
@@ -1473,6 +1563,324 @@ static int playlist_needed(struct playlist *pls)
     return 0;
 }
 
+static void prefetch_request_free(struct prefetch_request *r)
+{
+    av_freep(&r->url);
+    av_freep(&r->key);
+}
+
+static int prefetch_request_init(struct prefetch_request *r, const struct segment *seg)
+{
+    r->url        = av_strdup(seg->url);
+    r->key        = seg->key ? av_strdup(seg->key) : NULL;
+    r->key_type   = seg->key_type;
+    r->url_offset = seg->url_offset;
+    r->size       = seg->size;
+    memcpy(r->iv, seg->iv, sizeof(r->iv));
+    if (!r->url || (seg->key && !r->key))
+        return AVERROR(ENOMEM);
+    return 0;
+}
+
+/* Join the thread of a slot and release everything it holds. */
+static void prefetch_free(struct prefetch *p)
+{
+    HLSContext *c = p->parent->priv_data;
+
+    if (!p->active)
+        return;
+
+#if HAVE_THREADS
+    if (p->joinable)
+        pthread_join(p->thread, NULL);
+    p->joinable = 0;
+#endif
+    atomic_fetch_sub(&c->prefetch_mem, p->reserved);
+    prefetch_request_free(&p->seg);
+    prefetch_request_free(&p->init);
+    av_dict_free(&p->opts);
+    av_freep(&p->data);
+    av_freep(&p->init_data);
+    p->reserved = 0;
+    p->active   = 0;
+}
+
+static void prefetch_cancel(struct playlist *pls)
+{
+    HLSContext *c = pls->parent->priv_data;
+
+    if (!pls->prefetch)
+        return;
+    for (int i = 0; i < c->prefetch_segments; i++)
+        atomic_store(&pls->prefetch[i].abort, 1);
+    for (int i = 0; i < c->prefetch_segments; i++)
+        prefetch_free(&pls->prefetch[i]);
+    pls->cur_prefetch = NULL;
+}
+
+#if HAVE_THREADS
+static int prefetch_interrupt_cb(void *opaque)
+{
+    struct prefetch *p = opaque;
+    HLSContext *c = p->parent->priv_data;
+
+    return atomic_load(&p->abort) || ff_check_interrupt(c->interrupt_callback);
+}
+
+static int prefetch_open(struct prefetch *p, AVIOContext **pb, const char *url,
+                         AVDictionary *opts2, int *is_http)
+{
+    AVFormatContext *s = p->parent;
+    AVDictionary *tmp = NULL;
+    int ret;
+
+    ret = check_url(s, url, is_http);
+    if (ret < 0)
+        return ret;
+
+    av_dict_copy(&tmp, p->opts, 0);
+    av_dict_copy(&tmp, opts2, 0);
+    /* the I/O callbacks of the user may not be thread-safe */
+    ret = ffio_open_whitelist(pb, url, AVIO_FLAG_READ, &p->interrupt_cb, &tmp,
+                              s->protocol_whitelist, s->protocol_blacklist);
+    av_dict_free(&tmp);
+    return ret;
+}
+
+/* Download the data of a request into memory, like open_input() and
+ * read_from_url() would. */
+static int prefetch_read(struct prefetch *p, const struct prefetch_request *r,
+                         size_t max_size, uint8_t **data, size_t *data_len)
+{
+    HLSContext *c = p->parent->priv_data;
+    AVDictionary *opts = NULL;
+    AVIOContext *pb = NULL;
+    char url[MAX_URL_SIZE];
+    size_t size = 0, len = 0;
+    int is_http, ret;
+
+    if (r->key_type != KEY_NONE && p->key_fetch) {
+        ret = prefetch_open(p, &pb, r->key, NULL, &is_http);
+        if (ret < 0)
+            return ret;
+        ret = avio_read(pb, p->key, sizeof(p->key));
+        avio_closep(&pb);
+        if (ret != sizeof(p->key))
+            return ret < 0 ? ret : AVERROR_INVALIDDATA;
+        p->key_fetch = 0;
+    }
+
+    if (r->size >= 0) {
+        av_dict_set_int(&opts, "offset", r->url_offset, 0);
+        av_dict_set_int(&opts, "end_offset", r->url_offset + r->size, 0);
+        max_size = FFMIN(max_size, r->size);
+    }
+
+    if (r->key_type == KEY_AES_128) {
+        char iv[33], key[33];
+        ff_data_to_hex(iv, r->iv, sizeof(r->iv), 0);
+        ff_data_to_hex(key, p->key, sizeof(p->key), 0);
+        if (strstr(r->url, "://"))
+            snprintf(url, sizeof(url), "crypto+%s", r->url);
+        else
+            snprintf(url, sizeof(url), "crypto:%s", r->url);
+        av_dict_set(&opts, "key", key, 0);
+        av_dict_set(&opts, "iv", iv, 0);
+    } else {
+        av_strlcpy(url, r->url, sizeof(url));
+    }
+
+    ret = prefetch_open(p, &pb, url, opts, &is_http);
+    av_dict_free(&opts);
+    if (ret < 0)
+        return ret;
+
+    if (!is_http && r->url_offset) {
+        int64_t seekret = avio_seek(pb, r->url_offset, SEEK_SET);
+        if (seekret < 0) {
+            ret = seekret;
+            goto end;
+        }
+    }
+
+    while (len < max_size) {
+        int chunk = FFMIN(max_size - len, 64 << 10);
+
+        if (len + chunk > size) {
+            size_t new_size = FFMIN(FFMAX(2 * size, len + chunk), max_size);
+            size_t grow     = new_size - size;
+            void *tmp;
+
+            /* stop at the memory budget, the segment is then downloaded
+             * when it is needed, as without prefetching */
+            if (atomic_fetch_add(&c->prefetch_mem, grow) + grow > c->prefetch_max_size) {
+                atomic_fetch_sub(&c->prefetch_mem, grow);
+                ret = AVERROR(ENOSPC);
+                goto end;
+            }
+            p->reserved += grow;
+
+            tmp = av_realloc(*data, new_size);
+            if (!tmp) {
+                ret = AVERROR(ENOMEM);
+                goto end;
+            }
+            *data = tmp;
+            size  = new_size;
+        }
+
+        ret = avio_read(pb, *data + len, chunk);
+        if (ret == AVERROR_EOF)
+            break;
+        if (ret < 0)
+            goto end;
+        len += ret;
+    }
+    *data_len = len;
+    ret = 0;
+
+end:
+    avio_closep(&pb);
+    return ret;
+}
+
+static void *prefetch_thread(void *arg)
+{
+    struct prefetch *p = arg;
+
+    if (p->init_section)
+        p->init_ret = prefetch_read(p, &p->init, 1024 * 1024,
+                                    &p->init_data, &p->init_len);
+    p->ret = prefetch_read(p, &p->seg, SIZE_MAX, &p->data, &p->data_len);
+    if (p->ret < 0 && p->ret != AVERROR_EXIT && !atomic_load(&p->abort))
+        av_log(p->parent, AV_LOG_VERBOSE, "Prefetching segment %"PRId64" failed: %s\n",
+               p->seq_no, av_err2str(p->ret));
+
+    return NULL;
+}
+
+static int prefetch_start(HLSContext *c, struct playlist *pls,
+                          struct prefetch *p, int64_t seq_no)
+{
+    struct segment *seg  = pls->segments[seq_no - pls->start_seq_no];
+    struct segment *prev = seq_no > pls->start_seq_no ?
+                           pls->segments[seq_no - pls->start_seq_no - 1]->init_section :
+                           pls->cur_init_section;
+    int ret;
+
+    memset(p, 0, sizeof(*p));
+    p->parent                = pls->parent;
+    p->seq_no                = seq_no;
+    p->interrupt_cb.callback = prefetch_interrupt_cb;
+    p->interrupt_cb.opaque   = p;
+    atomic_init(&p->abort, 0);
+
+    if ((ret = prefetch_request_init(&p->seg, seg)) < 0)
+        goto fail;
+    if (seg->init_section && seg->init_section != prev) {
+        p->init_section = seg->init_section;
+        if ((ret = prefetch_request_init(&p->init, seg->init_section)) < 0)
+            goto fail;
+    }
+    if (seg->key_type != KEY_NONE) {
+        p->key_fetch = strcmp(seg->key, pls->key_url);
+        if (!p->key_fetch)
+            memcpy(p->key, pls->key, sizeof(p->key));
+    }
+    if ((ret = av_dict_copy(&p->opts, c->avio_opts, 0)) < 0)
+        goto fail;
+
+    ret = AVERROR(pthread_create(&p->thread, NULL, prefetch_thread, p));
+    if (ret < 0)
+        goto fail;
+    p->active   = 1;
+    p->joinable = 1;
+
+    return 0;
+fail:
+    prefetch_request_free(&p->seg);
+    prefetch_request_free(&p->init);
+    av_dict_free(&p->opts);
+    return ret;
+}
+#endif
+
+/* Start downloading the segments following the current one, within the
+ * limits of the prefetch_segments and prefetch_max_size options. */
+static void prefetch_schedule(HLSContext *c, struct playlist *pls)
+{
+#if HAVE_THREADS
+    if (!c->prefetch_segments)
+        return;
+
+    if (!pls->prefetch) {
+        pls->prefetch = av_calloc(c->prefetch_segments, sizeof(*pls->prefetch));
+        if (!pls->prefetch)
+            return;
+    }
+
+    /* drop the segments that were skipped */
+    for (int i = 0; i < c->prefetch_segments; i++) {
+        struct prefetch *p = &pls->prefetch[i];
+        if (p->active && p != pls->cur_prefetch && p->seq_no <= pls->cur_seq_no) {
+            atomic_store(&p->abort, 1);
+            prefetch_free(p);
+        }
+    }
+
+    for (int64_t seq_no = pls->cur_seq_no + 1;
+         seq_no <= pls->cur_seq_no + c->prefetch_segments &&
+         seq_no <  pls->start_seq_no + pls->n_segments; seq_no++) {
+        struct prefetch *slot = NULL;
+        int i;
+
+        for (i = 0; i < c->prefetch_segments; i++) {
+            struct prefetch *p = &pls->prefetch[i];
+            if (p->active && p->seq_no == seq_no)
+                break;
+            if (!p->active && !slot)
+                slot = p;
+        }
+        if (i < c->prefetch_segments)
+            continue;
+        if (!slot || atomic_load(&c->prefetch_mem) >= c->prefetch_max_size ||
+            prefetch_start(c, pls, slot, seq_no) < 0)
+            break;
+    }
+#endif
+}
+
+/* Wait for and return the prefetched data of a segment, if any. */
+static struct prefetch *prefetch_get(struct playlist *pls, int64_t seq_no)
+{
+    HLSContext *c = pls->parent->priv_data;
+
+    if (!pls->prefetch)
+        return NULL;
+
+    for (int i = 0; i < c->prefetch_segments; i++) {
+        struct prefetch *p = &pls->prefetch[i];
+        if (!p->active || p->seq_no != seq_no)
+            continue;
+#if HAVE_THREADS
+        if (p->joinable)
+            pthread_join(p->thread, NULL);
+        p->joinable = 0;
+#endif
+        if (p->ret < 0) {
+            prefetch_free(p);
+            return NULL;
+        }
+        if (p->seg.key_type != KEY_NONE) {
+            memcpy(pls->key, p->key, sizeof(pls->key));
+            av_strlcpy(pls->key_url, p->seg.key, sizeof(pls->key_url));
+        }
+        return p;
+    }
+
+    return NULL;
+}
+
 static int read_data(void *opaque, uint8_t *buf, int buf_size)
 {
     struct playlist *v = opaque;
@@ -1482,12 +1890,14 @@ static int read_data(void *opaque, uint8_t *buf, int buf_size)
     int reload_count = 0;
     int segment_retries = 0;
     struct segment *seg;
+    struct prefetch *p;
 
 restart:
     if (!v->needed)
         return AVERROR_EOF;
 
-    if (!v->input || (c->http_persistent && v->input_read_done)) {
+    if (!v->cur_prefetch &&
+        (!v->input || (c->http_persistent && v->input_read_done))) {
         int64_t reload_interval;
 
         /* Check that the playlist is still needed before opening a new
@@ -1552,13 +1962,23 @@ reload:
 
         v->input_read_done = 0;
         seg = current_segment(v);
+        p   = prefetch_get(v, v->cur_seq_no);
 
         /* load/update Media Initialization Section, if any */
-        ret = update_init_section(v, seg);
-        if (ret)
+        ret = update_init_section(v, seg, p);
+        if (ret) {
+            if (p)
+                prefetch_free(p);
             return ret;
+        }
 
-        if (c->http_multiple == 1 && v->input_next_requested) {
+        if (p) {
+            v->cur_prefetch    = p;
+            v->cur_seg_offset  = 0;
+            /* a persistent connection is still idle */
+            v->input_read_done = 1;
+            ret = 0;
+        } else if (c->http_multiple == 1 && v->input_next_requested) {
             FFSWAP(AVIOContext *, v->input, v->input_next);
             v->cur_seg_offset = 0;
             v->input_next_requested = 0;
@@ -1585,6 +2005,7 @@ reload:
         }
         segment_retries = 0;
         just_opened = 1;
+        prefetch_schedule(c, v);
     }
 
     if (c->http_multiple == -1) {
@@ -1597,7 +2018,7 @@ reload:
     }
 
     seg = next_segment(v);
-    if (c->http_multiple == 1 && !v->input_next_requested &&
+    if (c->http_multiple == 1 && !v->input_next_requested && !c->prefetch_segments &&
         seg && seg->key_type == KEY_NONE && av_strstart(seg->url, "http", NULL)) {
         ret = open_input(c, v, seg, &v->input_next);
         if (ret < 0) {
@@ -1630,7 +2051,10 @@ reload:
 
         return ret;
     }
-    if (c->http_persistent &&
+    if (v->cur_prefetch) {
+        prefetch_free(v->cur_prefetch);
+        v->cur_prefetch = NULL;
+    } else if (c->http_persistent &&
         seg->key_type == KEY_NONE && av_strstart(seg->url, "http", NULL)) {
         v->input_read_done = 1;
     } else {
@@ -1939,6 +2363,7 @@ static int hls_read_header(AVFormatContext *s)
     c->first_packet = 1;
     c->first_timestamp = AV_NOPTS_VALUE;
     c->cur_timestamp = AV_NOPTS_VALUE;
+    atomic_init(&c->prefetch_mem, 0);
 
     if ((ret = ffio_copy_url_options(s->pb, &c->avio_opts)) < 0)
         return ret;
@@ -2085,6 +2510,7 @@ static int hls_read_header(AVFormatContext *s)
             ff_format_io_close(pls->parent, &pls->input_next);
             pls->input_next = NULL;
             pls->input_next_requested = 0;
+            prefetch_cancel(pls);
             pls->cur_seg_offset = 0;
             pls->cur_init_section = NULL;
             /* Reset EOF flag */
@@ -2242,6 +2668,7 @@ static int recheck_discard_flags(AVFormatContext *s, int first)
             pls->input_read_done = 0;
             ff_format_io_close(pls->parent, &pls->input_next);
             pls->input_next_requested = 0;
+            prefetch_cancel(pls);
             pls->needed = 0;
             changed = 1;
             av_log(s, AV_LOG_INFO, "No longer receiving playlist %d\n", i);
@@ -2498,6 +2925,7 @@ static int hls_read_seek(AVFormatContext *s, int stream_index,
         pls->input_read_done = 0;
         ff_format_io_close(pls->parent, &pls->input_next);
         pls->input_next_requested = 0;
+        prefetch_cancel(pls);
         av_packet_unref(pls->pkt);
         pb->eof_reached = 0;
         /* Clear any buffered data */
@@ -2590,6 +3018,10 @@ static const AVOption hls_options[] = {
         OFFSET(seg_format_opts), AV_OPT_TYPE_DICT, {.str = NULL}, 0, 0, FLAGS},
     {"seg_max_retry", "Maximum number of times to reload a segment on error.",
      OFFSET(seg_max_retry), AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX, FLAGS},
+    {"prefetch_segments", "Number of segments downloaded ahead of time in the background",
+        OFFSET(prefetch_segments), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 64, FLAGS},
+    {"prefetch_max_size", "Maximum amount of memory used by prefetched segments",
+        OFFSET(prefetch_max_size), AV_OPT_TYPE_INT64, {.i64 = 64 << 20}, 0, INT64_MAX, FLAGS},
     {NULL}
 };
 
@@ -36,6 +36,7 @@
 #include "libavutil/opt.h"
 #include "libavutil/time.h"
 #include "libavutil/parseutils.h"
+#include "libavutil/thread.h"
 
 #include "avformat.h"
 #include "http.h"
@@ -58,6 +59,7 @@
 #define HTTP_SINGLE   1
 #define HTTP_MUTLI    2
 #define MAX_DATE_LEN  19
+#define POOL_SIZE     16
 #define WHITESPACES " \n\t\r"
 typedef enum {
     LOWER_PROTO,
@@ -76,6 +78,8 @@ typedef struct HTTPContext {
     uint64_t chunksize;
     int chunkend;
     uint64_t off, end_off, filesize;
+    /* Offset at which the response body ends, -1 if unknown. */
+    uint64_t body_end;
     char *uri;
     char *location;
     HTTPAuthState auth_state;
@@ -143,6 +147,12 @@ typedef struct HTTPContext {
     unsigned int retry_after;
     int reconnect_max_retries;
     int reconnect_delay_total_max;
+    int connection_pool;
+    int pool_idle_timeout;
+    int pool_max_per_host;
+    char *pool_key;
+    /* options consumed when opening the pooled connection */
+    AVDictionary *pool_used;
 } HTTPContext;
 
 #define OFFSET(x) offsetof(HTTPContext, x)
@@ -188,6 +198,9 @@ static const AVOption options[] = {
     { "resource", "The resource requested by a client", OFFSET(resource), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, E },
     { "reply_code", "The http status code to return to a client", OFFSET(reply_code), AV_OPT_TYPE_INT, { .i64 = 200}, INT_MIN, 599, E},
     { "short_seek_size", "Threshold to favor readahead over seek.", OFFSET(short_seek_size), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, INT_MAX, D },
+    { "connection_pool", "share idle persistent connections between contexts", OFFSET(connection_pool), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, D },
+    { "pool_idle_timeout", "time in seconds after which an idle pooled connection is closed", OFFSET(pool_idle_timeout), AV_OPT_TYPE_INT, { .i64 = 15 }, 0, INT_MAX, D },
+    { "pool_max_per_host", "max number of idle pooled connections to the same host", OFFSET(pool_max_per_host), AV_OPT_TYPE_INT, { .i64 = 4 }, 1, POOL_SIZE, D },
     { NULL }
 };
 
@@ -207,6 +220,147 @@ void ff_http_init_auth_state(URLContext *dest, const URLContext *src)
            sizeof(HTTPAuthState));
 }
 
+/* Idle persistent connections shared by all contexts of the process. */
+static struct {
+    char *key;
+    int (*callback)(void *);
+    URLContext *hd;
+    AVDictionary *used;
+    int64_t expiry;
+} pool[POOL_SIZE];
+static AVMutex pool_mutex = AV_MUTEX_INITIALIZER;
+
+/**
+ * Return the key under which the connection to lower_url is pooled, or NULL
+ * if it must not be shared. The lower protocol contexts keep the interrupt
+ * callback they were opened with, so only contexts using the same callback
+ * without opaque data can share connections.
+ */
+static char *pool_key(URLContext *h, const char *lower_url, AVDictionary *options)
+{
+    HTTPContext *s = h->priv_data;
+    char *opts = NULL, *key;
+
+    if (!s->connection_pool || (h->flags & AVIO_FLAG_WRITE) ||
+        h->interrupt_callback.opaque)
+        return NULL;
+
+    if (av_dict_get_string(options, &opts, '=', ',') < 0)
+        return NULL;
+    key = av_asprintf("%s %"PRId64" %s", lower_url, h->rw_timeout, opts);
+    av_free(opts);
+    return key;
+}
+
+/* Must be called with pool_mutex held, the connections to close are
+ * returned in closed. */
+static void pool_remove(int i, URLContext **closed, int *nb_closed)
+{
+    closed[(*nb_closed)++] = pool[i].hd;
+    pool[i].hd = NULL;
+    av_freep(&pool[i].key);
+    av_dict_free(&pool[i].used);
+}
+
+static void pool_expire(URLContext **closed, int *nb_closed)
+{
+    int64_t now = av_gettime_relative();
+
+    for (int i = 0; i < POOL_SIZE; i++)
+        if (pool[i].hd && pool[i].expiry <= now)
+            pool_remove(i, closed, nb_closed);
+}
+
+static URLContext *pool_get(URLContext *h, AVDictionary **options)
+{
+    HTTPContext *s = h->priv_data;
+    URLContext *closed[POOL_SIZE], *hd = NULL;
+    int nb_closed = 0, best = -1;
+
+    ff_mutex_lock(&pool_mutex);
+    pool_expire(closed, &nb_closed);
+    for (int i = 0; i < POOL_SIZE; i++) {
+        if (pool[i].hd && !strcmp(pool[i].key, s->pool_key) &&
+            pool[i].callback == h->interrupt_callback.callback &&
+            (best < 0 || pool[i].expiry > pool[best].expiry))
+            best = i;
+    }
+    if (best >= 0) {
+        hd = pool[best].hd;
+        s->pool_used = pool[best].used;
+        pool[best].hd   = NULL;
+        pool[best].used = NULL;
+        av_freep(&pool[best].key);
+    }
+    ff_mutex_unlock(&pool_mutex);
+
+    /* consume the options as opening the connection did */
+    if (hd) {
+        const AVDictionaryEntry *e = NULL;
+        while ((e = av_dict_iterate(s->pool_used, e)))
+            av_dict_set(options, e->key, NULL, 0);
+    }
+
+    for (int i = 0; i < nb_closed; i++)
+        ffurl_closep(&closed[i]);
+    return hd;
+}
+
+/* Take ownership of s->hd, either keeping it in the pool or closing it. */
+static void pool_put(URLContext *h)
+{
+    HTTPContext *s = h->priv_data;
+    URLContext *closed[POOL_SIZE];
+    int nb_closed = 0, nb_host = 0, slot = -1, oldest = -1, oldest_host = -1;
+
+    ff_mutex_lock(&pool_mutex);
+    pool_expire(closed, &nb_closed);
+    for (int i = 0; i < POOL_SIZE; i++) {
+        if (!pool[i].hd) {
+            slot = i;
+            continue;
+        }
+        if (oldest < 0 || pool[i].expiry < pool[oldest].expiry)
+            oldest = i;
+        if (!strcmp(pool[i].key, s->pool_key) &&
+            pool[i].callback == h->interrupt_callback.callback) {
+            nb_host++;
+            if (oldest_host < 0 || pool[i].expiry < pool[oldest_host].expiry)
+                oldest_host = i;
+        }
+    }
+    if (nb_host >= s->pool_max_per_host)
+        slot = oldest_host;
+    else if (slot < 0)
+        slot = oldest;
+    if (pool[slot].hd)
+        pool_remove(slot, closed, &nb_closed);
+
+    pool[slot].key      = s->pool_key;
+    pool[slot].callback = h->interrupt_callback.callback;
+    pool[slot].hd       = s->hd;
+    pool[slot].used     = s->pool_used;
+    pool[slot].expiry   = av_gettime_relative() + s->pool_idle_timeout * 1000000LL;
+    s->pool_key  = NULL;
+    s->pool_used = NULL;
+    s->hd        = NULL;
+    ff_mutex_unlock(&pool_mutex);
+
+    for (int i = 0; i < nb_closed; i++)
+        ffurl_closep(&closed[i]);
+}
+
+/* Check whether the response was fully read and the connection can carry
+ * another request. */
+static int http_conn_reusable(HTTPContext *s)
+{
+    if (s->willclose || s->buf_ptr != s->buf_end)
+        return 0;
+    if (s->chunksize != UINT64_MAX)
+        return s->chunkend;
+    return s->off == s->body_end;
+}
+
 static int http_open_cnx_internal(URLContext *h, AVDictionary **options)
 {
     const char *path, *proxy_path, *lower_proto = "tcp", *local_path;
@@ -216,7 +370,8 @@ static int http_open_cnx_internal(URLContext *h, AVDictionary **options)
     char auth[1024], proxyauth[1024] = "";
     char path1[MAX_URL_SIZE], sanitized_path[MAX_URL_SIZE + 1];
     char buf[1024], urlbuf[MAX_URL_SIZE];
-    int port, use_proxy, err = 0;
+    int port, use_proxy, reused = 0, err = 0;
+    uint64_t off;
     HTTPContext *s = h->priv_data;
 
     av_url_split(proto, sizeof(proto), auth, sizeof(auth),
@@ -273,15 +428,51 @@ static int http_open_cnx_internal(URLContext *h, AVDictionary **options)
     ff_url_join(buf, sizeof(buf), lower_proto, NULL, hostname, port, NULL);
 
     if (!s->hd) {
+        av_freep(&s->pool_key);
+        av_dict_free(&s->pool_used);
+        s->pool_key = pool_key(h, buf, *options);
+        if (s->pool_key && (s->hd = pool_get(h, options))) {
+            av_log(h, AV_LOG_DEBUG, "Reusing pooled connection to %s\n", buf);
+            reused = 1;
+        }
+    }
+
+    off = s->off;
+    s->line_count = 0;
+retry:
+    if (!s->hd) {
+        AVDictionary *opts = NULL;
+        const AVDictionaryEntry *e = NULL;
+
+        if (s->pool_key && (err = av_dict_copy(&opts, *options, 0)) < 0)
+            goto end;
         err = ffurl_open_whitelist(&s->hd, buf, AVIO_FLAG_READ_WRITE,
                                    &h->interrupt_callback, options,
                                    h->protocol_whitelist, h->protocol_blacklist, h);
+        /* remember the options used, to consume them when reusing it */
+        while ((e = av_dict_iterate(opts, e)))
+            if (!av_dict_get(*options, e->key, NULL, 0))
+                av_dict_set(&s->pool_used, e->key, e->value, 0);
+        av_dict_free(&opts);
+        if (err < 0)
+            goto end;
+    }
+
+    err = http_connect(h, path, local_path, hoststr, auth, proxyauth);
+    /* The server may have closed the idle connection in the meantime. */
+    if (err < 0 && reused && !s->line_count) {
+        av_log(h, AV_LOG_DEBUG, "Pooled connection was closed, reconnecting\n");
+        ffurl_closep(&s->hd);
+        av_dict_copy(options, s->pool_used, 0);
+        av_dict_free(&s->pool_used);
+        s->off = off;
+        reused = 0;
+        goto retry;
     }
 
 end:
     freeenv_utf8(env_http_proxy);
-    return err < 0 ? err : http_connect(
-        h, path, local_path, hoststr, auth, proxyauth);
+    return err;
 }
 
 static int http_should_reconnect(HTTPContext *s, int err)
@@ -757,6 +948,8 @@ bail_out:
         av_dict_free(&s->redirect_cache);
         av_freep(&s->new_location);
         av_freep(&s->uri);
+        av_freep(&s->pool_key);
+        av_dict_free(&s->pool_used);
     }
     return ret;
 }
@@ -1210,6 +1403,7 @@ static int process_line(URLContext *h, char *line, int line_count, int *parsed_h
         } else if (!av_strcasecmp(tag, "Content-Length") &&
                    s->filesize == UINT64_MAX) {
             s->filesize = strtoull(p, NULL, 10);
+            s->body_end = s->filesize;
         } else if (!av_strcasecmp(tag, "Content-Range")) {
             parse_content_range(h, p);
         } else if (!av_strcasecmp(tag, "Accept-Ranges") &&
@@ -1380,6 +1574,7 @@ static int http_read_header(URLContext *h)
     s->expires = 0;
     s->chunksize = UINT64_MAX;
     s->filesize_from_content_range = UINT64_MAX;
+    s->body_end = UINT64_MAX;
 
     for (;;) {
         int parsed_http_code = 0;
@@ -1408,6 +1603,14 @@ static int http_read_header(URLContext *h)
     if (http_err)
         return http_err;
 
+    /* body_end holds the Content-Length so far, the body starts at the
+     * offset given by Content-Range */
+    if (s->http_code == 204 || s->http_code == 304 ||
+        (s->method && !av_strcasecmp(s->method, "HEAD")))
+        s->body_end = s->off;
+    else if (s->body_end != UINT64_MAX)
+        s->body_end += s->off;
+
     // filesize from Content-Range can always be used, even if using chunked Transfer-Encoding
     if (s->filesize_from_content_range != UINT64_MAX)
         s->filesize = s->filesize_from_content_range;
@@ -1532,7 +1735,8 @@ static int http_connect(URLContext *h, const char *path, const char *local_path,
         av_bprintf(&request, "Expect: 100-continue\r\n");
 
     if (!has_header(s->headers, "\r\nConnection: "))
-        av_bprintf(&request, "Connection: %s\r\n", s->multiple_requests ? "keep-alive" : "close");
+        av_bprintf(&request, "Connection: %s\r\n",
+                   s->multiple_requests || s->pool_key ? "keep-alive" : "close");
 
     if (!has_header(s->headers, "\r\nHost: "))
         av_bprintf(&request, "Host: %s\r\n", hoststr);
@@ -1637,7 +1841,7 @@ static int http_buf_read(URLContext *h, uint8_t *buf, int size)
                    "Chunked encoding data size: %"PRIu64"\n",
                     s->chunksize);
 
-            if (!s->chunksize && s->multiple_requests) {
+            if (!s->chunksize && (s->multiple_requests || s->pool_key)) {
                 http_get_line(s, line, sizeof(line)); // read empty chunk
                 s->chunkend = 1;
                 return 0;
@@ -1947,8 +2151,12 @@ static int http_close(URLContext *h)
         /* Close the write direction by sending the end of chunked encoding. */
         ret = http_shutdown(h, h->flags);
 
+    if (s->hd && s->pool_key && !ret && http_conn_reusable(s))
+        pool_put(h);
     if (s->hd)
         ffurl_closep(&s->hd);
+    av_freep(&s->pool_key);
+    av_dict_free(&s->pool_used);
     av_dict_free(&s->chained_options);
     av_dict_free(&s->cookie_dict);
     av_dict_free(&s->redirect_cache);
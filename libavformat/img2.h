@@ -62,6 +62,9 @@ typedef struct VideoDemuxData {
     int frame_size;
     int ts_from_file;
     int export_path_metadata; /**< enabled when set to 1. */
+    int readahead;          /**< number of files read ahead in the background */
+    int64_t readahead_max_size; /**< memory budget of the files read ahead */
+    struct ImgReadahead *ra;
 } VideoDemuxData;
 
 typedef struct IdStrMap {
@@ -24,6 +24,7 @@
 
 #define _DEFAULT_SOURCE
 #define _BSD_SOURCE
+#include <stdatomic.h>
 #include <sys/stat.h>
 #include "libavutil/avassert.h"
 #include "libavutil/avstring.h"
@@ -32,6 +33,7 @@
 #include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
 #include "libavutil/intreadwrite.h"
+#include "libavutil/thread.h"
 #include "libavcodec/gif.h"
 #include "avformat.h"
 #include "avio_internal.h"
@@ -44,6 +46,7 @@
 #include "libavcodec/vbn.h"
 #include "libavcodec/xwd.h"
 #include "subtitles.h"
+#include "url.h"
 
 #if HAVE_GLOB
 /* Locally define as 0 (bitwise-OR no-op) any missing glob options that
@@ -186,6 +189,295 @@ static int img_read_probe(const AVProbeData *p)
     return 0;
 }
 
+static int get_filename(VideoDemuxData *s, int number,
+                        char *buf, int buf_size, char **filename)
+{
+    *filename = buf;
+    if (s->pattern_type == PT_NONE) {
+        av_strlcpy(buf, s->path, buf_size);
+    } else if (s->use_glob) {
+#if HAVE_GLOB
+        *filename = s->globstate.gl_pathv[number];
+#endif
+    } else {
+        if (av_get_frame_filename(buf, buf_size, s->path, number) < 0 && number > 1)
+            return AVERROR(EIO);
+    }
+    return 0;
+}
+
+#if HAVE_THREADS
+enum ReadaheadState {
+    RA_EMPTY,
+    RA_QUEUED,
+    RA_RUNNING,
+    RA_DONE,
+};
+
+/* A file of the sequence read into memory by a readahead thread. */
+typedef struct ReadaheadSlot {
+    enum ReadaheadState state;
+    int number;
+    char filename[1024];
+    AVBufferRef *buf;
+    int ret;                ///< bytes read or error code, set by the thread
+    int64_t reserved;       ///< bytes accounted in the memory budget
+} ReadaheadSlot;
+
+typedef struct ImgReadahead {
+    AVFormatContext *s1;
+    ReadaheadSlot *slots;
+    int nb_slots;
+    pthread_t *tids;
+    int nb_tids;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int quit;
+    atomic_int abort;
+    AVIOInterruptCB interrupt_cb;
+    atomic_int_least64_t mem;
+} ImgReadahead;
+
+static ReadaheadSlot *readahead_slot(ImgReadahead *ra, int number)
+{
+    return &ra->slots[(number % ra->nb_slots + ra->nb_slots) % ra->nb_slots];
+}
+
+static void readahead_slot_reset(ImgReadahead *ra, ReadaheadSlot *slot)
+{
+    av_buffer_unref(&slot->buf);
+    atomic_fetch_sub(&ra->mem, slot->reserved);
+    slot->reserved = 0;
+    slot->state    = RA_EMPTY;
+}
+
+static int readahead_interrupt_cb(void *opaque)
+{
+    ImgReadahead *ra = opaque;
+
+    return atomic_load(&ra->abort) || ff_check_interrupt(&ra->s1->interrupt_callback);
+}
+
+static int readahead_file(ImgReadahead *ra, ReadaheadSlot *slot)
+{
+    AVFormatContext *s1 = ra->s1;
+    VideoDemuxData *s = s1->priv_data;
+    AVIOContext *pb = NULL;
+    int64_t size;
+    int ret;
+
+    ret = ffio_open_whitelist(&pb, slot->filename, AVIO_FLAG_READ, &ra->interrupt_cb,
+                              NULL, s1->protocol_whitelist, s1->protocol_blacklist);
+    if (ret < 0)
+        return ret;
+
+    size = avio_size(pb);
+    if (size <= 0 || size > INT_MAX - AV_INPUT_BUFFER_PADDING_SIZE) {
+        ret = size < 0 ? size : AVERROR(EINVAL);
+        goto end;
+    }
+    /* Files not fitting in the budget are left to the demuxing thread. */
+    if (atomic_fetch_add(&ra->mem, size) + size > s->readahead_max_size) {
+        atomic_fetch_sub(&ra->mem, size);
+        ret = AVERROR(ENOSPC);
+        goto end;
+    }
+    slot->reserved = size;
+
+    slot->buf = av_buffer_alloc(size + AV_INPUT_BUFFER_PADDING_SIZE);
+    if (!slot->buf) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    ret = avio_read(pb, slot->buf->data, size);
+    if (ret >= 0)
+        memset(slot->buf->data + ret, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+
+end:
+    avio_closep(&pb);
+    return ret;
+}
+
+static void *readahead_thread(void *arg)
+{
+    ImgReadahead *ra = arg;
+
+    ff_thread_setname("img2-readahead");
+
+    pthread_mutex_lock(&ra->lock);
+    for (;;) {
+        ReadaheadSlot *slot = NULL;
+        int ret;
+
+        for (int i = 0; i < ra->nb_slots; i++)
+            if (ra->slots[i].state == RA_QUEUED &&
+                (!slot || ra->slots[i].number < slot->number))
+                slot = &ra->slots[i];
+        if (!slot) {
+            if (ra->quit)
+                break;
+            pthread_cond_wait(&ra->cond, &ra->lock);
+            continue;
+        }
+        slot->state = RA_RUNNING;
+        pthread_mutex_unlock(&ra->lock);
+
+        ret = readahead_file(ra, slot);
+
+        pthread_mutex_lock(&ra->lock);
+        slot->ret   = ret;
+        slot->state = RA_DONE;
+        pthread_cond_broadcast(&ra->cond);
+    }
+    pthread_mutex_unlock(&ra->lock);
+
+    return NULL;
+}
+
+/* Queue the files following the current one, must be called locked. */
+static void readahead_schedule(AVFormatContext *s1)
+{
+    VideoDemuxData *s = s1->priv_data;
+    ImgReadahead *ra = s->ra;
+
+    for (int n = s->img_number; n <= s->img_last && n - s->img_number < ra->nb_slots; n++) {
+        ReadaheadSlot *slot = readahead_slot(ra, n);
+        char *filename;
+
+        if (slot->number == n && slot->state != RA_EMPTY)
+            continue;
+        /* still busy with a file that is not needed anymore */
+        if (slot->state == RA_RUNNING)
+            continue;
+        readahead_slot_reset(ra, slot);
+        if (get_filename(s, n, slot->filename, sizeof(slot->filename), &filename) < 0)
+            break;
+        if (filename != slot->filename)
+            av_strlcpy(slot->filename, filename, sizeof(slot->filename));
+        slot->number = n;
+        slot->state  = RA_QUEUED;
+    }
+    pthread_cond_broadcast(&ra->cond);
+}
+
+/**
+ * Get the data of the current file from the readahead threads.
+ *
+ * @return AVERROR(EAGAIN) if the file has to be read by the caller
+ */
+static int readahead_get(AVFormatContext *s1, AVPacket *pkt)
+{
+    VideoDemuxData *s = s1->priv_data;
+    ImgReadahead *ra = s->ra;
+    ReadaheadSlot *slot = readahead_slot(ra, s->img_number);
+    int ret = AVERROR(EAGAIN);
+
+    pthread_mutex_lock(&ra->lock);
+    readahead_schedule(s1);
+    if (slot->number == s->img_number && slot->state != RA_EMPTY) {
+        while (slot->state != RA_DONE)
+            pthread_cond_wait(&ra->cond, &ra->lock);
+        if (slot->ret > 0) {
+            pkt->buf  = slot->buf;
+            pkt->data = slot->buf->data;
+            pkt->size = slot->ret;
+            slot->buf = NULL;
+            ret = 0;
+        }
+        readahead_slot_reset(ra, slot);
+    }
+    pthread_mutex_unlock(&ra->lock);
+
+    return ret;
+}
+
+/* Drop the files read ahead, e.g. on seeking. */
+static void readahead_flush(ImgReadahead *ra)
+{
+    int running;
+
+    atomic_store(&ra->abort, 1);
+    pthread_mutex_lock(&ra->lock);
+    do {
+        running = 0;
+        for (int i = 0; i < ra->nb_slots; i++) {
+            if (ra->slots[i].state == RA_RUNNING)
+                running = 1;
+            else
+                readahead_slot_reset(ra, &ra->slots[i]);
+        }
+        if (running)
+            pthread_cond_wait(&ra->cond, &ra->lock);
+    } while (running);
+    pthread_mutex_unlock(&ra->lock);
+    atomic_store(&ra->abort, 0);
+}
+
+static void readahead_uninit(VideoDemuxData *s)
+{
+    ImgReadahead *ra = s->ra;
+
+    if (!ra)
+        return;
+
+    atomic_store(&ra->abort, 1);
+    pthread_mutex_lock(&ra->lock);
+    ra->quit = 1;
+    for (int i = 0; i < ra->nb_slots; i++)
+        if (ra->slots[i].state == RA_QUEUED)
+            ra->slots[i].state = RA_EMPTY;
+    pthread_cond_broadcast(&ra->cond);
+    pthread_mutex_unlock(&ra->lock);
+    for (int i = 0; i < ra->nb_tids; i++)
+        pthread_join(ra->tids[i], NULL);
+
+    for (int i = 0; i < ra->nb_slots; i++)
+        readahead_slot_reset(ra, &ra->slots[i]);
+    pthread_cond_destroy(&ra->cond);
+    pthread_mutex_destroy(&ra->lock);
+    av_freep(&ra->slots);
+    av_freep(&ra->tids);
+    av_freep(&s->ra);
+}
+
+static int readahead_init(AVFormatContext *s1)
+{
+    VideoDemuxData *s = s1->priv_data;
+    ImgReadahead *ra;
+    int ret;
+
+    ra = s->ra = av_mallocz(sizeof(*ra));
+    if (!ra)
+        return AVERROR(ENOMEM);
+    ra->s1       = s1;
+    ra->nb_slots = s->readahead;
+    ra->slots    = av_calloc(ra->nb_slots, sizeof(*ra->slots));
+    ra->tids     = av_calloc(ra->nb_slots, sizeof(*ra->tids));
+    if (!ra->slots || !ra->tids) {
+        av_freep(&ra->slots);
+        av_freep(&ra->tids);
+        av_freep(&s->ra);
+        return AVERROR(ENOMEM);
+    }
+    ra->interrupt_cb.callback = readahead_interrupt_cb;
+    ra->interrupt_cb.opaque   = ra;
+    atomic_init(&ra->abort, 0);
+    atomic_init(&ra->mem, 0);
+    pthread_mutex_init(&ra->lock, NULL);
+    pthread_cond_init(&ra->cond, NULL);
+
+    for (; ra->nb_tids < ra->nb_slots; ra->nb_tids++) {
+        ret = pthread_create(&ra->tids[ra->nb_tids], NULL, readahead_thread, ra);
+        if (ret) {
+            av_log(s1, AV_LOG_ERROR, "pthread_create failed: %s\n", strerror(ret));
+            readahead_uninit(s);
+            return AVERROR(ret);
+        }
+    }
+    return 0;
+}
+#endif
+
 int ff_img_read_header(AVFormatContext *s1)
 {
     VideoDemuxData *s = s1->priv_data;
@@ -381,6 +673,16 @@ int ff_img_read_header(AVFormatContext *s1)
         pix_fmt != AV_PIX_FMT_NONE)
         st->codecpar->format = pix_fmt;
 
+    if (s->readahead && !s->is_pipe && !s1->pb && !s->split_planes) {
+#if HAVE_THREADS
+        int ret = readahead_init(s1);
+        if (ret < 0)
+            return ret;
+#else
+        av_log(s1, AV_LOG_WARNING, "Readahead requires threads, ignoring\n");
+#endif
+    }
+
     return 0;
 }
 
@@ -410,6 +712,44 @@ static int add_filename_as_pkt_side_data(char *filename, AVPacket *pkt) {
     return 0;
 }
 
+static int set_packet_props(AVFormatContext *s1, AVPacket *pkt, char *filename)
+{
+    VideoDemuxData *s = s1->priv_data;
+    int res;
+
+    pkt->stream_index = 0;
+    pkt->flags       |= AV_PKT_FLAG_KEY;
+    if (s->ts_from_file) {
+        struct stat img_stat;
+        av_assert0(!s->is_pipe); // The ts_from_file option is not supported by piped input demuxers
+        if (stat(filename, &img_stat))
+            return AVERROR(EIO);
+        pkt->pts = (int64_t)img_stat.st_mtime;
+#if HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
+        if (s->ts_from_file == 2)
+            pkt->pts = 1000000000*pkt->pts + img_stat.st_mtim.tv_nsec;
+#endif
+        av_add_index_entry(s1->streams[0], s->img_number, pkt->pts, 0, 0, AVINDEX_KEYFRAME);
+    } else if (!s->is_pipe) {
+        pkt->pts      = s->pts;
+    }
+
+    if (s->is_pipe)
+        pkt->pos = avio_tell(s1->pb);
+
+    /*
+     * export_path_metadata must be explicitly enabled via
+     * command line options for path metadata to be exported
+     * as packet side_data.
+     */
+    if (!s->is_pipe && s->export_path_metadata == 1) {
+        res = add_filename_as_pkt_side_data(filename, pkt);
+        if (res < 0)
+            return res;
+    }
+    return 0;
+}
+
 int ff_img_read_packet(AVFormatContext *s1, AVPacket *pkt)
 {
     VideoDemuxData *s = s1->priv_data;
@@ -427,18 +767,26 @@ int ff_img_read_packet(AVFormatContext *s1, AVPacket *pkt)
         }
         if (s->img_number > s->img_last)
             return AVERROR_EOF;
-        if (s->pattern_type == PT_NONE) {
-            av_strlcpy(filename_bytes, s->path, sizeof(filename_bytes));
-        } else if (s->use_glob) {
-#if HAVE_GLOB
-            filename = s->globstate.gl_pathv[s->img_number];
-#endif
-        } else {
-        if (av_get_frame_filename(filename_bytes, sizeof(filename_bytes),
-                                  s->path,
-                                  s->img_number) < 0 && s->img_number > 1)
-            return AVERROR(EIO);
+        res = get_filename(s, s->img_number, filename_bytes, sizeof(filename_bytes),
+                           &filename);
+        if (res < 0)
+            return res;
+#if HAVE_THREADS
+        /* The codec may still have to be probed from the first file. */
+        if (s->ra && par->codec_id != AV_CODEC_ID_NONE &&
+            !(par->codec_id == AV_CODEC_ID_RAWVIDEO && !par->width)) {
+            res = readahead_get(s1, pkt);
+            if (res >= 0) {
+                res = set_packet_props(s1, pkt, filename);
+                if (res < 0)
+                    return res;
+                s->img_count++;
+                s->img_number++;
+                s->pts++;
+                return 0;
+            }
         }
+#endif
         for (i = 0; i < 3; i++) {
             if (s1->pb &&
                 !strcmp(filename_bytes, s->path) &&
@@ -501,38 +849,9 @@ int ff_img_read_packet(AVFormatContext *s1, AVPacket *pkt)
     if (res < 0) {
         goto fail;
     }
-    pkt->stream_index = 0;
-    pkt->flags       |= AV_PKT_FLAG_KEY;
-    if (s->ts_from_file) {
-        struct stat img_stat;
-        av_assert0(!s->is_pipe); // The ts_from_file option is not supported by piped input demuxers
-        if (stat(filename, &img_stat)) {
-            res = AVERROR(EIO);
-            goto fail;
-        }
-        pkt->pts = (int64_t)img_stat.st_mtime;
-#if HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
-        if (s->ts_from_file == 2)
-            pkt->pts = 1000000000*pkt->pts + img_stat.st_mtim.tv_nsec;
-#endif
-        av_add_index_entry(s1->streams[0], s->img_number, pkt->pts, 0, 0, AVINDEX_KEYFRAME);
-    } else if (!s->is_pipe) {
-        pkt->pts      = s->pts;
-    }
-
-    if (s->is_pipe)
-        pkt->pos = avio_tell(f[0]);
-
-    /*
-     * export_path_metadata must be explicitly enabled via
-     * command line options for path metadata to be exported
-     * as packet side_data.
-     */
-    if (!s->is_pipe && s->export_path_metadata == 1) {
-        res = add_filename_as_pkt_side_data(filename, pkt);
-        if (res < 0)
-            goto fail;
-    }
+    res = set_packet_props(s1, pkt, filename);
+    if (res < 0)
+        goto fail;
 
     pkt->size = 0;
     for (i = 0; i < 3; i++) {
@@ -582,8 +901,11 @@ fail:
 
 static int img_read_close(struct AVFormatContext* s1)
 {
-#if HAVE_GLOB
     VideoDemuxData *s = s1->priv_data;
+#if HAVE_THREADS
+    readahead_uninit(s);
+#endif
+#if HAVE_GLOB
     if (s->use_glob) {
         globfree(&s->globstate);
     }
@@ -596,6 +918,11 @@ static int img_read_seek(AVFormatContext *s, int stream_index, int64_t timestamp
     VideoDemuxData *s1 = s->priv_data;
     AVStream *st = s->streams[0];
 
+#if HAVE_THREADS
+    if (s1->ra)
+        readahead_flush(s1->ra);
+#endif
+
     if (s1->ts_from_file) {
         int index = av_index_search_timestamp(st, timestamp, flags);
         if(index < 0)
@@ -634,6 +961,8 @@ const AVOption ff_img_options[] = {
     { "sec",  "second precision",       0, AV_OPT_TYPE_CONST,    {.i64 = 1   }, 0, 2,       DEC, .unit = "ts_type" },
     { "ns",   "nano second precision",  0, AV_OPT_TYPE_CONST,    {.i64 = 2   }, 0, 2,       DEC, .unit = "ts_type" },
     { "export_path_metadata", "enable metadata containing input path information", OFFSET(export_path_metadata), AV_OPT_TYPE_BOOL,   {.i64 = 0   }, 0, 1,       DEC }, \
+    { "readahead",    "set number of files read ahead in the background", OFFSET(readahead), AV_OPT_TYPE_INT, {.i64 = 0 }, 0, 64, DEC },
+    { "readahead_max_size", "set maximum memory used by the files read ahead", OFFSET(readahead_max_size), AV_OPT_TYPE_INT64, {.i64 = 256 << 20 }, 0, INT64_MAX, DEC },
     COMMON_OPTIONS
 };
 
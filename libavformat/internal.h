@@ -313,6 +313,12 @@ typedef struct FFStream {
      */
     PacketListEntry *last_in_packet_buffer;
 
+    /**
+     * Packets of this stream waiting in the default per-dts interleaver,
+     * in dts order. Muxing only.
+     */
+    PacketList interleave_queue;
+
     int64_t last_IP_pts;
     int last_IP_duration;
 
@@ -479,6 +485,16 @@ int ff_get_line(AVIOContext *s, char *buf, int maxlen);
  */
 int ff_get_chomp_line(AVIOContext *s, char *buf, int maxlen);
 
+/**
+ * Same as av_get_packet(), but reference the data instead of copying it
+ * when the protocol can lend it, see ffio_read_buffer(), and the codec of
+ * the stream does not need the packet padding to be zeroed. This is the
+ * case for uncompressed video.
+ *
+ * @param st the stream the packet belongs to
+ */
+int ff_get_packet_ref(AVIOContext *s, const AVStream *st, AVPacket *pkt, int size);
+
 #define SPACE_CHARS " \t\r\n"
 
 /**
@@ -579,6 +595,40 @@ AVStream *ff_stream_clone(AVFormatContext *dst_ctx, const AVStream *src);
  */
 int ff_rename(const char *url_src, const char *url_dst, void *logctx);
 
+/**
+ * Identity of a local file, used as the key of on-disk cache entries.
+ */
+typedef struct FFFileId {
+    uint64_t dev;
+    uint64_t ino;
+    uint64_t size;
+    int64_t  mtime_ns; ///< modification time in nanoseconds
+} FFFileId;
+
+/**
+ * Get the identity of the local file read by pb.
+ *
+ * @return 0 on success, AVERROR(ENOSYS) if pb does not read a local file
+ */
+int ff_file_id_get(AVIOContext *pb, FFFileId *id);
+
+/**
+ * Open a new, uniquely named temporary file next to path for writing a cache
+ * entry. The entry must then be published with ff_cache_entry_commit(), so
+ * that concurrent readers never see a partially written entry.
+ *
+ * @param tmp set to the name of the temporary file on success
+ */
+int ff_cache_entry_open(AVFormatContext *s, AVIOContext **pb,
+                        const char *path, char **tmp);
+
+/**
+ * Close a cache entry opened with ff_cache_entry_open() and rename it to path.
+ * The temporary file is deleted on failure and *tmp is freed in any case.
+ */
+int ff_cache_entry_commit(AVFormatContext *s, AVIOContext **pb,
+                          const char *path, char **tmp);
+
 /**
  * Allocate extradata with additional AV_INPUT_BUFFER_PADDING_SIZE at end
  * which is always set to 0.
@@ -4313,6 +4313,208 @@ static int matroska_read_packet(AVFormatContext *s, AVPacket *pkt)
     return 0;
 }
 
+static int matroska_scan_read_id(MatroskaDemuxContext *matroska,
+                                 AVIOContext *pb, uint32_t *id)
+{
+    uint64_t num;
+    int res = ebml_read_num(matroska, pb, 4, &num, 0);
+    if (res < 0)
+        return res;
+    *id = num | 1ULL << 7 * res;
+    return 0;
+}
+
+static int matroska_scan_is_level1(uint32_t id)
+{
+    return id == MATROSKA_ID_INFO     || id == MATROSKA_ID_TRACKS      ||
+           id == MATROSKA_ID_CUES     || id == MATROSKA_ID_TAGS        ||
+           id == MATROSKA_ID_SEEKHEAD || id == MATROSKA_ID_ATTACHMENTS ||
+           id == MATROSKA_ID_CLUSTER  || id == MATROSKA_ID_CHAPTERS;
+}
+
+/*
+ * Add an index entry for a (Simple)Block without reading its payload.
+ * This mirrors the indexing done in matroska_parse_block().
+ */
+static int matroska_scan_block(MatroskaDemuxContext *matroska, uint64_t size,
+                               uint64_t cluster_time, int is_keyframe,
+                               int64_t cluster_pos)
+{
+    AVIOContext *pb = matroska->ctx->pb;
+    int64_t end = avio_tell(pb) + size;
+    MatroskaTrack *track;
+    AVStream *st;
+    int16_t block_time;
+    uint64_t num;
+    int n, flags;
+
+    if ((n = ebml_read_num(matroska, pb, 8, &num, 1)) < 0)
+        return n;
+    if (size < n + 3)
+        return AVERROR_INVALIDDATA;
+    block_time = sign_extend(avio_rb16(pb), 16);
+    flags      = avio_r8(pb);
+    if (is_keyframe == -1)
+        is_keyframe = flags & 0x80;
+
+    track = matroska_find_track_by_num(matroska, num);
+    if (!track)
+        return AVERROR_INVALIDDATA;
+    st = track->stream;
+
+    if (is_keyframe && st && st->discard < AVDISCARD_ALL &&
+        track->type != MATROSKA_TRACK_TYPE_SUBTITLE &&
+        cluster_time != (uint64_t) -1 &&
+        (block_time >= 0 || cluster_time >= -block_time)) {
+        uint64_t timecode_cluster_in_track_tb = (double) cluster_time / track->time_scale;
+        uint64_t timecode = timecode_cluster_in_track_tb + block_time - track->codec_delay_in_track_tb;
+        ff_reduce_index(matroska->ctx, st->index);
+        av_add_index_entry(st, cluster_pos, timecode, 0, 0, AVINDEX_KEYFRAME);
+    }
+
+    return avio_seek(pb, end, SEEK_SET) < 0 ? AVERROR(EIO) : 0;
+}
+
+static int matroska_scan_blockgroup(MatroskaDemuxContext *matroska, uint64_t size,
+                                    uint64_t cluster_time, int64_t cluster_pos)
+{
+    AVIOContext *pb = matroska->ctx->pb;
+    int64_t end = avio_tell(pb) + size, block_pos = -1;
+    uint64_t block_size = 0, length;
+    int is_keyframe = 1, res;
+    uint32_t id;
+
+    while (avio_tell(pb) < end) {
+        if ((res = matroska_scan_read_id(matroska, pb, &id)) < 0 ||
+            (res = ebml_read_length(matroska, pb, &length)) < 0)
+            return res;
+        if (length == EBML_UNKNOWN_LENGTH)
+            return AVERROR_INVALIDDATA;
+        if (id == MATROSKA_ID_BLOCK) {
+            block_pos  = avio_tell(pb);
+            block_size = length;
+        } else if (id == MATROSKA_ID_BLOCKREFERENCE)
+            is_keyframe = 0;
+        if (avio_skip(pb, length) < 0)
+            return AVERROR(EIO);
+    }
+
+    if (block_pos < 0)
+        return 0;
+    if (avio_seek(pb, block_pos, SEEK_SET) < 0)
+        return AVERROR(EIO);
+    res = matroska_scan_block(matroska, block_size, cluster_time,
+                              is_keyframe, cluster_pos);
+    if (res < 0)
+        return res;
+    return avio_seek(pb, end, SEEK_SET) < 0 ? AVERROR(EIO) : 0;
+}
+
+/*
+ * Index the keyframes of the clusters following the last index entry
+ * of the given stream until the timestamp is covered, only reading the
+ * element headers. This is used on seeks beyond the known index, e.g. in
+ * files without Cues, and allows such seeks to be resolved by a binary
+ * search afterwards.
+ * Returns 0 once the timestamp is covered, AVERROR_EOF at the end of the
+ * segment and another negative error code if the data could not be
+ * scanned, in which case the clusters have to be parsed normally.
+ */
+static int matroska_scan_clusters(MatroskaDemuxContext *matroska, AVStream *st,
+                                  int64_t timestamp, int flags)
+{
+    AVIOContext *pb = matroska->ctx->pb;
+    FFStream *const sti = ffstream(st);
+    int64_t pos = sti->index_entries[sti->nb_index_entries - 1].pos;
+    int64_t segment_end = INT64_MAX;
+    uint32_t id;
+    int res, index;
+
+    if (matroska->levels[0].length != EBML_UNKNOWN_LENGTH)
+        segment_end = matroska->levels[0].start + matroska->levels[0].length;
+
+    if (avio_seek(pb, pos, SEEK_SET) < 0)
+        return AVERROR(EIO);
+    if ((res = matroska_scan_read_id(matroska, pb, &id)) < 0)
+        return res;
+
+    while ((index = av_index_search_timestamp(st, timestamp, flags)) < 0 ||
+           index == sti->nb_index_entries - 1) {
+        uint64_t length, cluster_time = -1;
+        int64_t cluster_pos, end;
+
+        if (pos >= segment_end || avio_feof(pb))
+            return AVERROR_EOF;
+        if (!matroska_scan_is_level1(id))
+            return AVERROR_INVALIDDATA;
+        if ((res = ebml_read_length(matroska, pb, &length)) < 0)
+            return res;
+
+        if (id != MATROSKA_ID_CLUSTER) {
+            if (length == EBML_UNKNOWN_LENGTH ||
+                avio_seek(pb, length, SEEK_CUR) < 0)
+                return AVERROR_INVALIDDATA;
+            pos = avio_tell(pb);
+            if (pos >= segment_end)
+                return AVERROR_EOF;
+            if ((res = matroska_scan_read_id(matroska, pb, &id)) < 0)
+                return res;
+            continue;
+        }
+
+        cluster_pos = pos;
+        end = length == EBML_UNKNOWN_LENGTH ? INT64_MAX : avio_tell(pb) + length;
+        id  = 0;
+        while ((pos = avio_tell(pb)) < FFMIN(end, segment_end)) {
+            uint64_t size;
+            uint32_t child;
+
+            if ((res = matroska_scan_read_id(matroska, pb, &child)) < 0)
+                return res;
+            if (matroska_scan_is_level1(child)) {
+                /* End of a cluster of unknown length. */
+                if (end != INT64_MAX)
+                    return AVERROR_INVALIDDATA;
+                id = child;
+                break;
+            }
+            if ((res = ebml_read_length(matroska, pb, &size)) < 0)
+                return res;
+            if (size == EBML_UNKNOWN_LENGTH)
+                return AVERROR_INVALIDDATA;
+
+            switch (child) {
+            case MATROSKA_ID_CLUSTERTIMECODE:
+                if (size > 8)
+                    return AVERROR_INVALIDDATA;
+                ebml_read_uint(pb, size, 0, &cluster_time);
+                break;
+            case MATROSKA_ID_SIMPLEBLOCK:
+                res = matroska_scan_block(matroska, size, cluster_time,
+                                          -1, cluster_pos);
+                break;
+            case MATROSKA_ID_BLOCKGROUP:
+                res = matroska_scan_blockgroup(matroska, size, cluster_time,
+                                               cluster_pos);
+                break;
+            default:
+                res = avio_skip(pb, size) < 0 ? AVERROR(EIO) : 0;
+            }
+            if (res < 0)
+                return res;
+        }
+
+        if (!id) {
+            if (pos >= segment_end)
+                return AVERROR_EOF;
+            if ((res = matroska_scan_read_id(matroska, pb, &id)) < 0)
+                return res;
+        }
+    }
+
+    return 0;
+}
+
 static int matroska_read_seek(AVFormatContext *s, int stream_index,
                               int64_t timestamp, int flags)
 {
@@ -4334,13 +4536,22 @@ static int matroska_read_seek(AVFormatContext *s, int stream_index,
 
     if ((index = av_index_search_timestamp(st, timestamp, flags)) < 0 ||
          index == sti->nb_index_entries - 1) {
-        matroska_reset_status(matroska, 0, sti->index_entries[sti->nb_index_entries - 1].pos);
-        while ((index = av_index_search_timestamp(st, timestamp, flags)) < 0 ||
-               index == sti->nb_index_entries - 1) {
-            matroska_clear_queue(matroska);
-            if (matroska_parse_cluster(matroska) < 0)
-                break;
+        MatroskaTrack *track = matroska->tracks.elem;
+        int res = AVERROR(ENOSYS);
+
+        for (i = 0; i < matroska->tracks.nb_elem; i++)
+            if (track[i].stream == st && track[i].type != MATROSKA_TRACK_TYPE_SUBTITLE)
+                res = matroska_scan_clusters(matroska, st, timestamp, flags);
+        if (res < 0 && res != AVERROR_EOF) {
+            matroska_reset_status(matroska, 0, sti->index_entries[sti->nb_index_entries - 1].pos);
+            while ((index = av_index_search_timestamp(st, timestamp, flags)) < 0 ||
+                   index == sti->nb_index_entries - 1) {
+                matroska_clear_queue(matroska);
+                if (matroska_parse_cluster(matroska) < 0)
+                    break;
+            }
         }
+        index = av_index_search_timestamp(st, timestamp, flags);
     }
 
     matroska_clear_queue(matroska);
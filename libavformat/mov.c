@@ -1552,6 +1552,149 @@ static int mov_read_ftyp(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     return 0;
 }
 
+#define MOV_CACHE_HEADER_SIZE 48
+/* bytes at the start of the moov atom compared against the cached copy */
+#define MOV_CACHE_CHECK_SIZE  4096
+
+/**
+ * Fill the header of the moov cache entry of the file read by pb, which
+ * identifies the file and the position of the moov atom.
+ */
+static int mov_cache_header(MOVContext *c, AVIOContext *pb, int64_t size,
+                            uint8_t *header, char **path)
+{
+    FFFileId id;
+
+    if (ff_file_id_get(pb, &id) < 0 || size > INT_MAX - AV_INPUT_BUFFER_PADDING_SIZE)
+        return AVERROR(ENOSYS);
+
+    AV_WL32(header,      MKTAG('F','M','O','C'));
+    AV_WL32(header +  4, 2);
+    AV_WL64(header +  8, id.size);
+    AV_WL64(header + 16, id.mtime_ns);
+    AV_WL64(header + 24, id.ino);
+    AV_WL64(header + 32, avio_tell(pb));
+    AV_WL64(header + 40, size);
+
+    *path = av_asprintf("%s/%"PRIx64"-%"PRIx64".moov", c->moov_cache, id.dev, id.ino);
+    return *path ? 0 : AVERROR(ENOMEM);
+}
+
+static int mov_load_moov_cache(MOVContext *c, AVIOContext *pb, const char *path,
+                               const uint8_t *header, int size, uint8_t **data)
+{
+    AVFormatContext *s = c->fc;
+    AVIOContext *cache = NULL;
+    uint8_t buf[MOV_CACHE_CHECK_SIZE];
+    int64_t pos = avio_tell(pb);
+    int check = FFMIN(size, sizeof(buf));
+    int ret;
+
+    if ((ret = s->io_open(s, &cache, path, AVIO_FLAG_READ, NULL)) < 0)
+        return ret;
+
+    ret = ffio_read_size(cache, buf, MOV_CACHE_HEADER_SIZE);
+    if (ret >= 0 && memcmp(buf, header, MOV_CACHE_HEADER_SIZE))
+        ret = AVERROR_INVALIDDATA;
+    if (ret >= 0 && !(*data = av_malloc(size + AV_INPUT_BUFFER_PADDING_SIZE)))
+        ret = AVERROR(ENOMEM);
+    if (ret >= 0)
+        ret = ffio_read_size(cache, *data, size);
+    ff_format_io_close(s, &cache);
+
+    /* the file may have been rewritten in place without changing its size
+     * or timestamp, so compare the start of the moov atom as well */
+    if (ret >= 0) {
+        ret = ffio_read_size(pb, buf, check);
+        if (avio_seek(pb, pos, SEEK_SET) < 0 && ret >= 0)
+            ret = AVERROR(EIO);
+        if (ret >= 0 && memcmp(buf, *data, check))
+            ret = AVERROR_INVALIDDATA;
+    }
+    if (ret < 0)
+        av_freep(data);
+
+    return ret;
+}
+
+static void mov_save_moov_cache(MOVContext *c, AVIOContext *pb, const char *path,
+                                const uint8_t *header, int size)
+{
+    AVFormatContext *s = c->fc;
+    AVIOContext *cache = NULL;
+    int64_t pos = avio_tell(pb);
+    int64_t start = AV_RL64(header + 32);
+    uint8_t *data;
+    char *tmp = NULL;
+    int ret;
+
+    /* encryption info is looked up outside of the moov atom */
+    for (int i = 0; i < s->nb_streams; i++) {
+        MOVStreamContext *sc = s->streams[i]->priv_data;
+        if (sc->cenc.encryption_index)
+            return;
+    }
+
+    data = av_malloc(size);
+    if (!data)
+        return;
+
+    if ((ret = avio_seek(pb, start, SEEK_SET)) < 0 ||
+        (ret = ffio_read_size(pb, data, size)) < 0 ||
+        (ret = avio_seek(pb, pos, SEEK_SET)) < 0)
+        goto fail;
+
+    if ((ret = ff_cache_entry_open(s, &cache, path, &tmp)) < 0)
+        goto fail;
+    avio_write(cache, header, MOV_CACHE_HEADER_SIZE);
+    avio_write(cache, data, size);
+    if ((ret = ff_cache_entry_commit(s, &cache, path, &tmp)) < 0)
+        goto fail;
+    goto end;
+
+fail:
+    av_log(s, AV_LOG_WARNING, "Could not write moov cache %s: %s\n", path, av_err2str(ret));
+end:
+    av_free(data);
+}
+
+/**
+ * Parse the moov atom from the cache if it has been stored for this file,
+ * and store it otherwise.
+ */
+static int mov_read_moov_cached(MOVContext *c, AVIOContext *pb, MOVAtom atom)
+{
+    uint8_t header[MOV_CACHE_HEADER_SIZE];
+    uint8_t *data = NULL;
+    char *path = NULL;
+    int ret;
+
+    if (!(pb->seekable & AVIO_SEEKABLE_NORMAL) ||
+        mov_cache_header(c, pb, atom.size, header, &path) < 0)
+        return mov_read_default(c, pb, atom);
+
+    if (mov_load_moov_cache(c, pb, path, header, atom.size, &data) >= 0) {
+        FFIOContext ctx;
+
+        av_log(c->fc, AV_LOG_VERBOSE, "Reading moov atom from %s\n", path);
+        ffio_init_read_context(&ctx, data, atom.size);
+        ctx.pub.seekable = AVIO_SEEKABLE_NORMAL;
+        /* keep the offsets of the file */
+        ctx.pub.pos = avio_tell(pb) + atom.size;
+        ret = mov_read_default(c, &ctx.pub, atom);
+        if (ret >= 0)
+            ret = avio_skip(pb, atom.size);
+        av_free(data);
+    } else {
+        ret = mov_read_default(c, pb, atom);
+        if (ret >= 0)
+            mov_save_moov_cache(c, pb, path, header, atom.size);
+    }
+
+    av_free(path);
+    return ret < 0 ? ret : 0;
+}
+
 /* this atom should contain all header atoms */
 static int mov_read_moov(MOVContext *c, AVIOContext *pb, MOVAtom atom)
 {
@@ -1563,7 +1706,11 @@ static int mov_read_moov(MOVContext *c, AVIOContext *pb, MOVAtom atom)
         return 0;
     }
 
-    if ((ret = mov_read_default(c, pb, atom)) < 0)
+    if (c->moov_cache)
+        ret = mov_read_moov_cached(c, pb, atom);
+    else
+        ret = mov_read_default(c, pb, atom);
+    if (ret < 0)
         return ret;
     /* we parsed the 'moov' atom, we can terminate the parsing as soon as we find the 'mdat' */
     /* so we don't parse the whole file if over a network */
@@ -9555,6 +9702,7 @@ static int mov_probe(const AVProbeData *p)
             if (tag == MKTAG('f','t','y','p') &&
                        (   AV_RL32(p->buf + offset + 8) == MKTAG('j','p','2',' ')
                         || AV_RL32(p->buf + offset + 8) == MKTAG('j','p','x',' ')
+                        || AV_RL32(p->buf + offset + 8) == MKTAG('j','p','h',' ')
                         || AV_RL32(p->buf + offset + 8) == MKTAG('j','x','l',' ')
                     )) {
                 score = FFMAX(score, 5);
@@ -10910,7 +11058,7 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
         }
 #endif
         else
-            ret = av_get_packet(sc->pb, pkt, sample->size);
+            ret = ff_get_packet_ref(sc->pb, st, pkt, sample->size);
         if (ret < 0) {
             if (should_retry(sc->pb, ret)) {
                 mov_current_sample_dec(sc);
@@ -11234,6 +11382,7 @@ static const AVOption mov_options[] = {
         {.i64 = 0}, 0, 1, FLAGS },
     { "max_stts_delta", "treat offsets above this value as invalid", OFFSET(max_stts_delta), AV_OPT_TYPE_INT, {.i64 = UINT_MAX-48000*10 }, 0, UINT_MAX, .flags = AV_OPT_FLAG_DECODING_PARAM },
     { "interleaved_read", "Interleave packets from multiple tracks at demuxer level", OFFSET(interleaved_read), AV_OPT_TYPE_BOOL, {.i64 = 1 }, 0, 1, .flags = AV_OPT_FLAG_DECODING_PARAM },
+    { "moov_cache", "Directory where the moov atoms of local files are cached", OFFSET(moov_cache), AV_OPT_TYPE_STRING, .flags = AV_OPT_FLAG_DECODING_PARAM },
 
     { NULL },
 };
@@ -104,6 +104,7 @@ static const AVOption options[] = {
       { "negative_cts_offsets", "Use negative CTS offsets (reducing the need for edit lists)", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_NEGATIVE_CTS_OFFSETS}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, .unit = "movflags" },
       { "omit_tfhd_offset", "Omit the base data offset in tfhd atoms", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_OMIT_TFHD_OFFSET}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, .unit = "movflags" },
       { "prefer_icc", "If writing colr atom prioritise usage of ICC profile if it exists in stream packet side data", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_PREFER_ICC}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, .unit = "movflags" },
+      { "reserve_moov", "With faststart, reserve space for the moov atom estimated from the duration instead of moving the data", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_RESERVE_MOOV}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, .unit = "movflags" },
       { "rtphint", "Add RTP hint tracks", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_RTP_HINT}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, .unit = "movflags" },
       { "separate_moof", "Write separate moof/mdat atoms for each track", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_SEPARATE_MOOF}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, .unit = "movflags" },
       { "skip_sidx", "Skip writing of sidx atom", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_SKIP_SIDX}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, .unit = "movflags" },
@@ -113,6 +114,7 @@ static const AVOption options[] = {
       { "write_gama", "Write deprecated gama atom", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_WRITE_GAMA}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, .unit = "movflags" },
       { "hybrid_fragmented", "For recoverability, write a fragmented file that is converted to non-fragmented at the end.", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_HYBRID_FRAGMENTED}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, .unit = "movflags" },
     { "min_frag_duration", "Minimum fragment duration", offsetof(MOVMuxContext, min_fragment_duration), AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM},
+    { "moov_reserve_duration", "Expected duration for reserve_moov, the longest stream duration if unset", offsetof(MOVMuxContext, moov_reserve_duration), AV_OPT_TYPE_DURATION, {.i64 = 0}, 0, INT64_MAX, AV_OPT_FLAG_ENCODING_PARAM},
     { "mov_gamma", "gamma value for gama atom", offsetof(MOVMuxContext, gamma), AV_OPT_TYPE_FLOAT, {.dbl = 0.0 }, 0.0, 10, AV_OPT_FLAG_ENCODING_PARAM},
     { "movie_timescale", "set movie timescale", offsetof(MOVMuxContext, movie_timescale), AV_OPT_TYPE_INT, {.i64 = MOV_TIMESCALE}, 1, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM},
     FF_RTP_FLAG_OPTS(MOVMuxContext, rtp_flags),
@@ -6167,6 +6169,61 @@ static int mov_flush_fragment_interleaving(AVFormatContext *s, MOVTrack *track)
     return 0;
 }
 
+static int64_t mov_track_mdat_size(const MOVTrack *track)
+{
+    return track->mdat_queue_size + (track->mdat_buf ? avio_tell(track->mdat_buf) : 0);
+}
+
+/**
+ * Append the payload of a refcounted packet to the fragment data of a track
+ * by reference. Anything already written to the track's mdat_buf is moved
+ * to the queue first to keep the payload in order, mdat_buf is replaced by
+ * an empty one in that case.
+ */
+static int mov_queue_mdat_packet(MOVTrack *track, const AVPacket *pkt, int size)
+{
+    int ret;
+
+    if (track->mdat_buf && avio_tell(track->mdat_buf)) {
+        AVPacket *chunk = av_packet_alloc();
+        uint8_t *buf;
+        int buf_size;
+
+        if (!chunk)
+            return AVERROR(ENOMEM);
+        buf_size = avio_close_dyn_buf(track->mdat_buf, &buf);
+        track->mdat_buf = NULL;
+        /* dynamic buffers are zero padded, so they can back a packet */
+        if ((ret = av_packet_from_data(chunk, buf, buf_size)) < 0) {
+            av_free(buf);
+            av_packet_free(&chunk);
+            return ret;
+        }
+        ret = avpriv_packet_list_put(&track->mdat_queue, chunk, NULL, 0);
+        av_packet_free(&chunk);
+        if (ret < 0)
+            return ret;
+        track->mdat_queue_size += buf_size;
+        if ((ret = avio_open_dyn_buf(&track->mdat_buf)) < 0)
+            return ret;
+    }
+
+    if ((ret = avpriv_packet_list_put(&track->mdat_queue, (AVPacket *)pkt,
+                                      av_packet_ref, 0)) < 0)
+        return ret;
+    track->mdat_queue.tail->pkt.size = size;
+    track->mdat_queue_size += size;
+    return 0;
+}
+
+static void mov_write_mdat_queue(AVIOContext *pb, MOVTrack *track)
+{
+    for (PacketListEntry *entry = track->mdat_queue.head; entry; entry = entry->next)
+        avio_write(pb, entry->pkt.data, entry->pkt.size);
+    avpriv_packet_list_free(&track->mdat_queue);
+    track->mdat_queue_size = 0;
+}
+
 static int mov_write_squashed_packet(AVFormatContext *s, MOVTrack *track)
 {
     MOVMuxContext *mov = s->priv_data;
@@ -6403,8 +6460,7 @@ static int mov_flush_fragment(AVFormatContext *s, int force)
         }
         if (!track->entry)
             continue;
-        if (track->mdat_buf)
-            mdat_size += avio_tell(track->mdat_buf);
+        mdat_size += mov_track_mdat_size(track);
         if (first_track < 0)
             first_track = i;
     }
@@ -6424,7 +6480,7 @@ static int mov_flush_fragment(AVFormatContext *s, int force)
         if (mov->flags & FF_MOV_FLAG_SEPARATE_MOOF) {
             if (!track->entry)
                 continue;
-            mdat_size = avio_tell(track->mdat_buf);
+            mdat_size = mov_track_mdat_size(track);
             moof_tracks = i;
         } else {
             write_moof = i == first_track;
@@ -6443,6 +6499,7 @@ static int mov_flush_fragment(AVFormatContext *s, int force)
 
         mov_finish_fragment(mov, &mov->tracks[i], mdat_start);
         if (!mov->frag_interleave) {
+            mov_write_mdat_queue(s->pb, track);
             if (!track->mdat_buf)
                 continue;
             buf_size = avio_close_dyn_buf(track->mdat_buf, &buf);
@@ -6743,6 +6800,12 @@ int ff_mov_write_packet(AVFormatContext *s, AVPacket *pkt)
             if (ret) {
                 goto err;
             }
+        } else if (pb == trk->mdat_buf && !mov->frag_interleave && pkt->buf) {
+            /* Fragment payload is referenced until the fragment is
+             * written rather than copied into mdat_buf. */
+            if ((ret = mov_queue_mdat_packet(trk, pkt, size)) < 0)
+                goto err;
+            pb = trk->mdat_buf;
         } else {
             avio_write(pb, pkt->data, size);
         }
@@ -6759,7 +6822,10 @@ int ff_mov_write_packet(AVFormatContext *s, AVPacket *pkt)
         trk->cluster_capacity = new_capacity;
     }
 
-    trk->cluster[trk->entry].pos              = avio_tell(pb) - size;
+    if (pb == trk->mdat_buf)
+        trk->cluster[trk->entry].pos          = mov_track_mdat_size(trk) - size;
+    else
+        trk->cluster[trk->entry].pos          = avio_tell(pb) - size;
     trk->cluster[trk->entry].samples_in_chunk = samples_in_chunk;
     trk->cluster[trk->entry].chunkNum         = 0;
     trk->cluster[trk->entry].size             = size;
@@ -7441,6 +7507,7 @@ static void mov_free(AVFormatContext *s)
 
         ff_mov_cenc_free(&track->cenc);
         ffio_free_dyn_buf(&track->mdat_buf);
+        avpriv_packet_list_free(&track->mdat_queue);
 
 #if CONFIG_IAMFENC
         ffio_free_dyn_buf(&track->iamf_buf);
@@ -8067,6 +8134,63 @@ static int mov_init(AVFormatContext *s)
     return 0;
 }
 
+/*
+ * Estimate an upper bound of the moov size for the given duration, so that
+ * faststart can reserve the space up front instead of shifting the data.
+ * The per sample costs cover stsz, stts, ctts and stss entries plus one
+ * chunk (stsc and co64 entries) for every video frame.
+ */
+static int64_t estimate_moov_size(AVFormatContext *s, int64_t duration)
+{
+    MOVMuxContext *mov = s->priv_data;
+    int64_t size = 4096 + s->nb_chapters * 64;
+
+    for (int i = 0; i < mov->nb_tracks; i++) {
+        const MOVTrack *track = &mov->tracks[i];
+        const AVCodecParameters *par = track->par;
+        AVRational rate;
+
+        size += 1024;
+        if (!par || !track->st)
+            continue;
+        size += par->extradata_size;
+
+        switch (par->codec_type) {
+        case AVMEDIA_TYPE_VIDEO:
+            rate = track->st->avg_frame_rate;
+            if (rate.num <= 0 || rate.den <= 0)
+                rate = (AVRational){ 60, 1 };
+            size += 44 * av_rescale_q(duration, AV_TIME_BASE_Q, av_inv_q(rate));
+            break;
+        case AVMEDIA_TYPE_AUDIO:
+            size += 16 * av_rescale(duration, par->sample_rate,
+                                    (int64_t)AV_TIME_BASE * (par->frame_size > 0 ? par->frame_size : 1024));
+            break;
+        default:
+            size += 16 * (duration / AV_TIME_BASE + 1);
+            break;
+        }
+    }
+
+    return size;
+}
+
+static int64_t mov_expected_duration(AVFormatContext *s)
+{
+    MOVMuxContext *mov = s->priv_data;
+    int64_t duration = mov->moov_reserve_duration;
+
+    if (!duration) {
+        for (int i = 0; i < s->nb_streams; i++) {
+            const AVStream *st = s->streams[i];
+            if (st->duration > 0)
+                duration = FFMAX(duration, av_rescale_q(st->duration, st->time_base, AV_TIME_BASE_Q));
+        }
+    }
+
+    return duration;
+}
+
 static int mov_write_header(AVFormatContext *s)
 {
     AVIOContext *pb = s->pb;
@@ -8147,6 +8271,21 @@ static int mov_write_header(AVFormatContext *s)
             return ret;
     }
 
+    /* with a known duration, reserve space for the moov instead of moving
+     * the data in the trailer, which falls back to it if the space is short */
+    if (mov->flags & FF_MOV_FLAG_FASTSTART && mov->flags & FF_MOV_FLAG_RESERVE_MOOV &&
+        !(mov->flags & FF_MOV_FLAG_FRAGMENT) && mov->mode != MODE_AVIF) {
+        int64_t duration = mov_expected_duration(s);
+
+        if (duration > 0) {
+            int64_t size = estimate_moov_size(s, duration);
+            if (size <= INT_MAX) {
+                av_log(s, AV_LOG_VERBOSE, "Reserving %"PRId64" bytes for the moov atom\n", size);
+                mov->reserved_moov_size = size;
+            }
+        }
+    }
+
     if (mov->reserved_moov_size){
         mov->reserved_header_pos = avio_tell(pb);
         if (mov->reserved_moov_size > 0)
@@ -8166,7 +8305,7 @@ static int mov_write_header(AVFormatContext *s)
             mov->mdat_pos = avio_tell(pb);
         }
     } else if (mov->mode != MODE_AVIF) {
-        if (mov->flags & FF_MOV_FLAG_FASTSTART)
+        if (mov->flags & FF_MOV_FLAG_FASTSTART && mov->reserved_moov_size < 0)
             mov->reserved_header_pos = avio_tell(pb);
         mov_write_mdat_tag(pb, mov);
     }
@@ -8405,9 +8544,25 @@ static int mov_write_trailer(AVFormatContext *s)
             ffio_wfourcc(pb, "mdat");
             avio_wb64(pb, mov->mdat_size + 16);
         }
+
+        if (mov->flags & FF_MOV_FLAG_FASTSTART && mov->reserved_moov_size > 0) {
+            res = get_moov_size(s);
+            if (res < 0)
+                return res;
+            if (res > mov->reserved_moov_size - 8) {
+                /* the estimate was too small: turn the reserved space into a
+                 * free atom and move the data as without reservation */
+                av_log(s, AV_LOG_INFO, "Reserved %d bytes for a moov atom of %d bytes\n",
+                       mov->reserved_moov_size, res);
+                avio_seek(pb, mov->reserved_header_pos, SEEK_SET);
+                avio_wb32(pb, mov->reserved_moov_size);
+                ffio_wfourcc(pb, "free");
+                mov->reserved_moov_size = -1;
+            }
+        }
         avio_seek(pb, mov->reserved_moov_size > 0 ? mov->reserved_header_pos : moov_pos, SEEK_SET);
 
-        if (mov->flags & FF_MOV_FLAG_FASTSTART) {
+        if (mov->flags & FF_MOV_FLAG_FASTSTART && mov->reserved_moov_size < 0) {
             av_log(s, AV_LOG_INFO, "Starting second pass: moving the moov atom to the beginning of the file\n");
             res = shift_data(s);
             if (res < 0)
@@ -141,6 +141,8 @@ typedef struct MOVTrack {
     AVPacket *cover_image;
 
     AVIOContext *mdat_buf;
+    PacketList  mdat_queue;      ///< fragment payload preceding mdat_buf, referenced instead of copied
+    int64_t     mdat_queue_size;
     int64_t     data_offset;
     int         frag_discont;
     int         entries_flushed;
@@ -222,6 +224,7 @@ typedef struct MOVMuxContext {
 
     int reserved_moov_size; ///< 0 for disabled, -1 for automatic, size otherwise
     int64_t reserved_header_pos;
+    int64_t moov_reserve_duration;
 
     char *major_brand;
 
@@ -284,6 +287,7 @@ typedef struct MOVMuxContext {
 #define FF_MOV_FLAG_CMAF                  (1 << 22)
 #define FF_MOV_FLAG_PREFER_ICC            (1 << 23)
 #define FF_MOV_FLAG_HYBRID_FRAGMENTED     (1 << 24)
+#define FF_MOV_FLAG_RESERVE_MOOV          (1 << 25)
 
 int ff_mov_write_packet(AVFormatContext *s, AVPacket *pkt);
 
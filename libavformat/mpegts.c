@@ -175,6 +175,12 @@ struct MpegTSContext {
     struct Program *prg;
 
     int8_t crc_validity[NB_PID_MAX];
+    /** pids only comprised in discarded programs, see discard_pid() */
+    uint64_t discard_map[NB_PID_MAX / 64];
+    /** AVProgram.discard == AVDISCARD_ALL for each program, as of discard_map */
+    uint8_t *discard_programs;
+    unsigned int nb_discard_programs;
+    int discard_map_valid;
     /** filters for various streams specified by PMT + for the PAT and PMT */
     MpegTSFilter *pids[NB_PID_MAX];
     int current_pid;
@@ -379,39 +385,59 @@ static void update_av_program_info(AVFormatContext *s, unsigned int programid,
  */
 static int discard_pid(MpegTSContext *ts, unsigned int pid)
 {
+    AVFormatContext *s = ts->stream;
     int i, j, k;
-    int used = 0, discarded = 0;
-    struct Program *p;
 
     if (pid == PAT_PID)
         return 0;
 
-    /* If none of the programs have .discard=AVDISCARD_ALL then there's
-     * no way we have to discard this packet */
-    for (k = 0; k < ts->stream->nb_programs; k++)
-        if (ts->stream->programs[k]->discard == AVDISCARD_ALL)
-            break;
-    if (k == ts->stream->nb_programs)
-        return 0;
+    /* The map only needs to be rebuilt when the programs or their
+     * selection change, which is rare compared to the packet rate. */
+    if (ts->discard_map_valid && ts->nb_discard_programs == s->nb_programs) {
+        for (k = 0; k < s->nb_programs; k++)
+            if (ts->discard_programs[k] != (s->programs[k]->discard == AVDISCARD_ALL))
+                break;
+        if (k < s->nb_programs)
+            ts->discard_map_valid = 0;
+    } else
+        ts->discard_map_valid = 0;
+
+    if (!ts->discard_map_valid) {
+        uint64_t used[NB_PID_MAX / 64] = { 0 };
+        int discarded = 0;
+
+        memset(ts->discard_map, 0, sizeof(ts->discard_map));
+        if (av_reallocp_array(&ts->discard_programs, s->nb_programs,
+                              sizeof(*ts->discard_programs)) < 0) {
+            ts->nb_discard_programs = 0;
+            return 0;
+        }
+        ts->nb_discard_programs = s->nb_programs;
 
-    for (i = 0; i < ts->nb_prg; i++) {
-        p = &ts->prg[i];
-        for (j = 0; j < p->nb_pids; j++) {
-            if (p->pids[j] != pid)
-                continue;
-            // is program with id p->id set to be discarded?
-            for (k = 0; k < ts->stream->nb_programs; k++) {
-                if (ts->stream->programs[k]->id == p->id) {
-                    if (ts->stream->programs[k]->discard == AVDISCARD_ALL)
-                        discarded++;
-                    else
-                        used++;
-                }
+        for (k = 0; k < s->nb_programs; k++) {
+            ts->discard_programs[k] = s->programs[k]->discard == AVDISCARD_ALL;
+            discarded |= ts->discard_programs[k];
+        }
+
+        /* If none of the programs have .discard=AVDISCARD_ALL then there's
+         * no way we have to discard this packet */
+        for (i = 0; discarded && i < ts->nb_prg; i++) {
+            const struct Program *p = &ts->prg[i];
+            for (k = 0; k < s->nb_programs; k++) {
+                // is program with id p->id set to be discarded?
+                uint64_t *map = ts->discard_programs[k] ? ts->discard_map : used;
+                if (s->programs[k]->id != p->id)
+                    continue;
+                for (j = 0; j < p->nb_pids; j++)
+                    map[p->pids[j] >> 6] |= 1ULL << (p->pids[j] & 63);
             }
         }
+        for (i = 0; i < FF_ARRAY_ELEMS(used); i++)
+            ts->discard_map[i] &= ~used[i];
+        ts->discard_map_valid = 1;
     }
 
-    return !used && discarded;
+    return ts->discard_map[pid >> 6] >> (pid & 63) & 1;
 }
 
 /**
@@ -2371,6 +2397,7 @@ static void pmt_cb(MpegTSFilter *filter, const uint8_t *section, int section_len
         clear_avprogram(ts, h->id);
     clear_program(prg);
     add_pid_to_program(prg, ts->current_pid);
+    ts->discard_map_valid = 0;
 
     pcr_pid = get16(&p, p_end);
     if (pcr_pid < 0)
@@ -2565,6 +2592,7 @@ static void pat_cb(MpegTSFilter *filter, const uint8_t *section, int section_len
     if (skip_identical(h, tssf))
         return;
     ts->id = h->id;
+    ts->discard_map_valid = 0;
 
     for (;;) {
         sid = get16(&p, p_end);
@@ -3290,6 +3318,7 @@ static void mpegts_free(MpegTSContext *ts)
     int i;
 
     clear_programs(ts);
+    av_freep(&ts->discard_programs);
 
     for (i = 0; i < FF_ARRAY_ELEMS(ts->pools); i++)
         av_buffer_pool_uninit(&ts->pools[i]);
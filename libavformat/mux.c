@@ -673,20 +673,25 @@ static void handle_avoid_negative_ts(FFFormatContext *si, FFStream *sti,
 
         ts -= sti->lowest_ts_allowed;
 
-        /* Peek into the muxing queue to improve our estimate
+        /* Peek into the muxing queues to improve our estimate
          * of the lowest timestamp if av_interleaved_write_frame() is used. */
-        for (const PacketListEntry *pktl = si->packet_buffer.head;
-             pktl; pktl = pktl->next) {
-            AVRational cmp_tb = s->streams[pktl->pkt.stream_index]->time_base;
-            int64_t cmp_ts = use_pts ? pktl->pkt.pts : pktl->pkt.dts;
-            if (cmp_ts == AV_NOPTS_VALUE)
-                continue;
-            cmp_ts -= ffstream(s->streams[pktl->pkt.stream_index])->lowest_ts_allowed;
-            if (s->output_ts_offset)
-                cmp_ts += av_rescale_q(s->output_ts_offset, AV_TIME_BASE_Q, cmp_tb);
-            if (av_compare_ts(cmp_ts, cmp_tb, ts, tb) < 0) {
-                ts = cmp_ts;
-                tb = cmp_tb;
+        for (unsigned i = 0; i <= s->nb_streams; i++) {
+            const PacketList *const queue = i < s->nb_streams ?
+                &ffstream(s->streams[i])->interleave_queue : &si->packet_buffer;
+
+            for (const PacketListEntry *pktl = queue->head;
+                 pktl; pktl = pktl->next) {
+                AVRational cmp_tb = s->streams[pktl->pkt.stream_index]->time_base;
+                int64_t cmp_ts = use_pts ? pktl->pkt.pts : pktl->pkt.dts;
+                if (cmp_ts == AV_NOPTS_VALUE)
+                    continue;
+                cmp_ts -= ffstream(s->streams[pktl->pkt.stream_index])->lowest_ts_allowed;
+                if (s->output_ts_offset)
+                    cmp_ts += av_rescale_q(s->output_ts_offset, AV_TIME_BASE_Q, cmp_tb);
+                if (av_compare_ts(cmp_ts, cmp_tb, ts, tb) < 0) {
+                    ts = cmp_ts;
+                    tb = cmp_tb;
+                }
             }
         }
 
@@ -957,8 +962,13 @@ static int interleave_compare_dts(AVFormatContext *s, const AVPacket *next,
     return comp > 0;
 }
 
-int ff_interleave_packet_per_dts(AVFormatContext *s, AVPacket *pkt,
-                                 int flush, int has_packet)
+/**
+ * Interleave per dts through the single sorted packet_buffer list.
+ * Used for chunked interleaving and for muxers that fill the list with
+ * their own comparison function.
+ */
+static int interleave_packet_list(AVFormatContext *s, AVPacket *pkt,
+                                  int flush, int has_packet)
 {
     FormatContextInternal *const fci = ff_fc_internal(s);
     FFFormatContext *const si = &fci->fc;
@@ -1078,6 +1088,196 @@ int ff_interleave_packet_per_dts(AVFormatContext *s, AVPacket *pkt,
     }
 }
 
+/* Whether the first packet of a's queue is to be muxed before b's. */
+static int interleave_heap_before(AVFormatContext *s,
+                                  const FFStream *a, const FFStream *b)
+{
+    return interleave_compare_dts(s, &b->interleave_queue.head->pkt,
+                                     &a->interleave_queue.head->pkt);
+}
+
+static void interleave_heap_sift_down(AVFormatContext *s, unsigned i)
+{
+    FormatContextInternal *const fci = ff_fc_internal(s);
+    FFStream **const heap = fci->interleave_heap;
+    const unsigned n = fci->nb_interleave_heap;
+
+    for (;;) {
+        unsigned min = i, l = 2 * i + 1, r = 2 * i + 2;
+
+        if (l < n && interleave_heap_before(s, heap[l], heap[min]))
+            min = l;
+        if (r < n && interleave_heap_before(s, heap[r], heap[min]))
+            min = r;
+        if (min == i)
+            break;
+        FFSWAP(FFStream *, heap[i], heap[min]);
+        i = min;
+    }
+}
+
+static int interleave_heap_push(AVFormatContext *s, FFStream *sti)
+{
+    FormatContextInternal *const fci = ff_fc_internal(s);
+    FFStream **heap = fci->interleave_heap;
+    unsigned i = fci->nb_interleave_heap;
+
+    if (i >= fci->interleave_heap_size) {
+        heap = av_realloc_array(heap, s->nb_streams, sizeof(*heap));
+        if (!heap)
+            return AVERROR(ENOMEM);
+        fci->interleave_heap      = heap;
+        fci->interleave_heap_size = s->nb_streams;
+    }
+
+    heap[fci->nb_interleave_heap++] = sti;
+    while (i) {
+        unsigned parent = (i - 1) / 2;
+
+        if (!interleave_heap_before(s, heap[i], heap[parent]))
+            break;
+        FFSWAP(FFStream *, heap[i], heap[parent]);
+        i = parent;
+    }
+
+    return 0;
+}
+
+/* Remove the first packet of the stream at the top of the heap. */
+static void interleave_heap_pop(AVFormatContext *s, AVPacket *pkt)
+{
+    FormatContextInternal *const fci = ff_fc_internal(s);
+    FFStream *const sti = fci->interleave_heap[0];
+
+    avpriv_packet_list_get(&sti->interleave_queue, pkt);
+    if (!sti->interleave_queue.head)
+        fci->interleave_heap[0] = fci->interleave_heap[--fci->nb_interleave_heap];
+    interleave_heap_sift_down(s, 0);
+}
+
+int ff_interleave_packet_per_dts(AVFormatContext *s, AVPacket *pkt,
+                                 int flush, int has_packet)
+{
+    FormatContextInternal *const fci = ff_fc_internal(s);
+    FFFormatContext *const si = &fci->fc;
+    const AVPacket *top_pkt;
+    int stream_count;
+    int ret;
+    int eof = flush;
+
+    /* Every stream has its own queue of packets in dts order and a heap
+     * keeps track of which queue holds the next packet to mux, so that
+     * queueing and taking out a packet do not depend on how many
+     * packets of other streams are waiting. */
+    if (s->max_chunk_size || s->max_chunk_duration || si->packet_buffer.head)
+        return interleave_packet_list(s, pkt, flush, has_packet);
+
+    if (has_packet) {
+        FFStream *const sti = ffstream(s->streams[pkt->stream_index]);
+        int was_empty = !sti->interleave_queue.head;
+
+        ret = avpriv_packet_list_put(&sti->interleave_queue, pkt, NULL, 0);
+        if (ret < 0) {
+            av_packet_unref(pkt);
+            return ret;
+        }
+        if (was_empty && (ret = interleave_heap_push(s, sti)) < 0) {
+            avpriv_packet_list_free(&sti->interleave_queue);
+            return ret;
+        }
+    }
+
+    stream_count = fci->nb_interleave_heap;
+    if (!stream_count)
+        return 0;
+    top_pkt = &fci->interleave_heap[0]->interleave_queue.head->pkt;
+
+    if (fci->nb_interleaved_streams == stream_count)
+        flush = 1;
+
+    if (s->max_interleave_delta > 0 &&
+        top_pkt->dts != AV_NOPTS_VALUE &&
+        !flush) {
+        int noninterleaved_count = 0;
+
+        for (unsigned i = 0; i < s->nb_streams; i++) {
+            const AVStream *const st  = s->streams[i];
+            const FFStream *const sti = cffstream(st);
+            const AVCodecParameters *const par = st->codecpar;
+            if (!sti->interleave_queue.head &&
+                par->codec_type != AVMEDIA_TYPE_ATTACHMENT &&
+                par->codec_id != AV_CODEC_ID_VP8 &&
+                par->codec_id != AV_CODEC_ID_VP9 &&
+                par->codec_id != AV_CODEC_ID_SMPTE_2038)
+                ++noninterleaved_count;
+        }
+
+        if (fci->nb_interleaved_streams == stream_count + noninterleaved_count) {
+            int64_t delta_dts = INT64_MIN;
+            int64_t top_dts = av_rescale_q(top_pkt->dts,
+                                           s->streams[top_pkt->stream_index]->time_base,
+                                           AV_TIME_BASE_Q);
+
+            for (unsigned i = 0; i < s->nb_streams; i++) {
+                const AVStream *const st  = s->streams[i];
+                const FFStream *const sti = cffstream(st);
+                const PacketListEntry *const last = sti->interleave_queue.tail;
+                int64_t last_dts;
+
+                if (!sti->interleave_queue.head ||
+                    st->codecpar->codec_type == AVMEDIA_TYPE_SUBTITLE)
+                    continue;
+
+                last_dts = av_rescale_q(last->pkt.dts,
+                                        st->time_base,
+                                        AV_TIME_BASE_Q);
+                delta_dts = FFMAX(delta_dts, last_dts - top_dts);
+            }
+
+            if (delta_dts > s->max_interleave_delta) {
+                av_log(s, AV_LOG_DEBUG,
+                       "Delay between the first packet and last packet in the "
+                       "muxing queue is %"PRId64" > %"PRId64": forcing output\n",
+                       delta_dts, s->max_interleave_delta);
+                flush = 1;
+            }
+        }
+    }
+
+#if FF_API_LAVF_SHORTEST
+    if (eof &&
+        (s->flags & AVFMT_FLAG_SHORTEST) &&
+        fci->shortest_end == AV_NOPTS_VALUE) {
+        fci->shortest_end = av_rescale_q(top_pkt->dts,
+                                         s->streams[top_pkt->stream_index]->time_base,
+                                         AV_TIME_BASE_Q);
+    }
+
+    if (fci->shortest_end != AV_NOPTS_VALUE) {
+        while (fci->nb_interleave_heap) {
+            FFStream *const sti = fci->interleave_heap[0];
+            AVPacket *const next = &sti->interleave_queue.head->pkt;
+            int64_t top_dts = av_rescale_q(next->dts, sti->pub.time_base,
+                                           AV_TIME_BASE_Q);
+
+            if (fci->shortest_end + 1 >= top_dts)
+                break;
+
+            interleave_heap_pop(s, pkt);
+            av_packet_unref(pkt);
+            flush = 0;
+        }
+    }
+#endif
+
+    if (flush) {
+        interleave_heap_pop(s, pkt);
+        return 1;
+    } else {
+        return 0;
+    }
+}
+
 int ff_interleave_packet_passthrough(AVFormatContext *s, AVPacket *pkt,
                                      int flush, int has_packet)
 {
@@ -1103,7 +1303,11 @@ int ff_get_muxer_ts_offset(AVFormatContext *s, int stream_index, int64_t *offset
 const AVPacket *ff_interleaved_peek(AVFormatContext *s, int stream)
 {
     FFFormatContext *const si = ffformatcontext(s);
+    const FFStream *const sti = cffstream(s->streams[stream]);
     PacketListEntry *pktl = si->packet_buffer.head;
+
+    if (sti->interleave_queue.head)
+        return &sti->interleave_queue.head->pkt;
     while (pktl) {
         if (pktl->pkt.stream_index == stream) {
             return &pktl->pkt;
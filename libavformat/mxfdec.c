@@ -4131,7 +4131,7 @@ static int mxf_read_packet(AVFormatContext *s, AVPacket *pkt)
                     return ret;
                 }
             } else {
-                ret = av_get_packet(s->pb, pkt, klv.length);
+                ret = ff_get_packet_ref(s->pb, st, pkt, klv.length);
                 if (ret < 0) {
                     mxf->current_klv_data = (KLVPacket){{0}};
                     return ret;
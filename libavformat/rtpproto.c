@@ -61,6 +61,9 @@ typedef struct RTPContext {
     char *fec_options_str;
     int64_t rw_timeout;
     char *localaddr;
+    int64_t bitrate;
+    int64_t burst_bits;
+    int send_batch;
 } RTPContext;
 
 #define OFFSET(x) offsetof(RTPContext, x)
@@ -81,6 +84,9 @@ static const AVOption options[] = {
     { "block",              "Block list",                                                       OFFSET(block),           AV_OPT_TYPE_STRING, { .str = NULL },               .flags = D|E },
     { "fec",                "FEC",                                                              OFFSET(fec_options_str), AV_OPT_TYPE_STRING, { .str = NULL },               .flags = E },
     { "localaddr",          "Local address",                                                    OFFSET(localaddr),       AV_OPT_TYPE_STRING, { .str = NULL },               .flags = D|E },
+    { "bitrate",            "Pace the RTP packets to this number of bits per second",           OFFSET(bitrate),         AV_OPT_TYPE_INT64,  { .i64 =  0 },     0, INT64_MAX, .flags = E },
+    { "burst_bits",         "Max length of bursts in bits (when using bitrate)",                OFFSET(burst_bits),      AV_OPT_TYPE_INT64,  { .i64 =  0 },     0, INT64_MAX, .flags = E },
+    { "send_batch",         "Max number of paced packets sent at once",                         OFFSET(send_batch),      AV_OPT_TYPE_INT,    { .i64 = -1 },    -1, 256,     .flags = E },
     { NULL }
 };
 
@@ -176,7 +182,8 @@ static void build_udp_url(RTPContext *s,
                           const char *localaddr,
                           int port, int local_port,
                           const char *include_sources,
-                          const char *exclude_sources)
+                          const char *exclude_sources,
+                          int paced)
 {
     ff_url_join(buf, buf_size, "udp", NULL, hostname, port, NULL);
     if (local_port >= 0)
@@ -191,7 +198,15 @@ static void build_udp_url(RTPContext *s,
         url_add_option(buf, buf_size, "connect=1");
     if (s->dscp >= 0)
         url_add_option(buf, buf_size, "dscp=%d", s->dscp);
-    url_add_option(buf, buf_size, "fifo_size=0");
+    if (paced && s->bitrate > 0) {
+        /* the UDP transmitting thread needs its FIFO */
+        url_add_option(buf, buf_size, "bitrate=%"PRId64, s->bitrate);
+        if (s->burst_bits > 0)
+            url_add_option(buf, buf_size, "burst_bits=%"PRId64, s->burst_bits);
+        if (s->send_batch > 0)
+            url_add_option(buf, buf_size, "send_batch=%d", s->send_batch);
+    } else
+        url_add_option(buf, buf_size, "fifo_size=0");
     if (include_sources && include_sources[0])
         url_add_option(buf, buf_size, "sources=%s", include_sources);
     if (exclude_sources && exclude_sources[0])
@@ -212,6 +227,9 @@ static void build_udp_url(RTPContext *s,
  *         'block=ip[,ip]'    : list disallowed source IP addresses
  *         'write_to_source=0/1' : send packets to the source address of the latest received packet
  *         'dscp=n'           : set DSCP value to n (QoS)
+ *         'bitrate=n'        : pace the outgoing RTP packets to n bits per second
+ *         'burst_bits=n'     : max length of bursts in bits when pacing
+ *         'send_batch=n'     : max number of paced packets sent at once
  * deprecated option:
  *         'localport=n'      : set the local port to n
  *
@@ -273,6 +291,15 @@ static int rtp_open(URLContext *h, const char *uri, int flags)
         if (av_find_info_tag(buf, sizeof(buf), "timeout", p)) {
             s->rw_timeout = strtol(buf, NULL, 10);
         }
+        if (av_find_info_tag(buf, sizeof(buf), "bitrate", p)) {
+            s->bitrate = strtoll(buf, NULL, 10);
+        }
+        if (av_find_info_tag(buf, sizeof(buf), "burst_bits", p)) {
+            s->burst_bits = strtoll(buf, NULL, 10);
+        }
+        if (av_find_info_tag(buf, sizeof(buf), "send_batch", p)) {
+            s->send_batch = strtol(buf, NULL, 10);
+        }
         if (av_find_info_tag(buf, sizeof(buf), "sources", p)) {
             av_strlcpy(include_sources, buf, sizeof(include_sources));
             ff_ip_parse_sources(h, buf, &s->filters);
@@ -324,7 +351,7 @@ static int rtp_open(URLContext *h, const char *uri, int flags)
     for (i = 0; i < max_retry_count; i++) {
         build_udp_url(s, buf, sizeof(buf),
                       hostname, s->localaddr, rtp_port, s->local_rtpport,
-                      sources, block);
+                      sources, block, !(flags & AVIO_FLAG_READ));
         if (ffurl_open_whitelist(&s->rtp_hd, buf, flags, &h->interrupt_callback,
                                  NULL, h->protocol_whitelist, h->protocol_blacklist, h) < 0)
             goto fail;
@@ -338,7 +365,7 @@ static int rtp_open(URLContext *h, const char *uri, int flags)
             s->local_rtcpport = s->local_rtpport + 1;
             build_udp_url(s, buf, sizeof(buf),
                           hostname, s->localaddr, s->rtcp_port, s->local_rtcpport,
-                          sources, block);
+                          sources, block, 0);
             if (ffurl_open_whitelist(&s->rtcp_hd, buf, rtcpflags,
                                      &h->interrupt_callback, NULL,
                                      h->protocol_whitelist, h->protocol_blacklist, h) < 0) {
@@ -349,7 +376,7 @@ static int rtp_open(URLContext *h, const char *uri, int flags)
         }
         build_udp_url(s, buf, sizeof(buf),
                       hostname, s->localaddr, s->rtcp_port, s->local_rtcpport,
-                      sources, block);
+                      sources, block, 0);
         if (ffurl_open_whitelist(&s->rtcp_hd, buf, rtcpflags, &h->interrupt_callback,
                                  NULL, h->protocol_whitelist, h->protocol_blacklist, h) < 0)
             goto fail;
@@ -26,6 +26,7 @@
 
 #include "config_components.h"
 
+#include <stdatomic.h>
 #include <time.h>
 
 #include "avformat.h"
@@ -40,6 +41,8 @@
 #include "libavutil/avstring.h"
 #include "libavutil/parseutils.h"
 #include "libavutil/mathematics.h"
+#include "libavutil/thread.h"
+#include "libavutil/threadmessage.h"
 #include "libavutil/time.h"
 #include "libavutil/timecode.h"
 #include "libavutil/time_internal.h"
@@ -68,6 +71,18 @@ typedef enum {
 #define SEGMENT_LIST_FLAG_CACHE 1
 #define SEGMENT_LIST_FLAG_LIVE  2
 
+/**
+ * Ended segment handed over to the finalization thread, which writes its
+ * trailer, closes it and then adds it to the segment list.
+ */
+typedef struct SegmentFinalizeJob {
+    AVFormatContext *oc;   ///< context to write the trailer of and free, or NULL
+    AVIOContext *pb;       ///< segment output, if oc is NULL
+    SegmentListEntry entry;
+    int segment_count;
+    int is_last;
+} SegmentFinalizeJob;
+
 typedef struct SegmentContext {
     const AVClass *class;  /**< Class for private options. */
     int segment_idx;       ///< index of the segment file to write, starting from 0
@@ -127,6 +142,13 @@ typedef struct SegmentContext {
     SegmentListEntry cur_entry;
     SegmentListEntry *segment_list_entries;
     SegmentListEntry *segment_list_entries_end;
+
+    int async_finalize;    ///< number of ended segments that may be pending finalization
+    AVThreadMessageQueue *finalize_queue;
+#if HAVE_THREADS
+    pthread_t finalize_tid;
+#endif
+    atomic_int finalize_error;
 } SegmentContext;
 
 static void print_csv_escaped_str(AVIOContext *ctx, const char *str)
@@ -344,6 +366,131 @@ static void segment_list_print_entry(AVIOContext      *list_ioctx,
     }
 }
 
+/* Append an ended segment to the list and write it out. */
+static int segment_list_update(AVFormatContext *s, const SegmentListEntry *cur_entry,
+                               int segment_count, int is_last)
+{
+    SegmentContext *seg = s->priv_data;
+    int ret;
+
+    if (seg->list_size || seg->list_type == LIST_TYPE_M3U8) {
+        SegmentListEntry *entry = av_mallocz(sizeof(*entry));
+        if (!entry)
+            return AVERROR(ENOMEM);
+
+        /* append new element */
+        memcpy(entry, cur_entry, sizeof(*entry));
+        entry->next = NULL;
+        entry->filename = av_strdup(entry->filename);
+        if (!seg->segment_list_entries)
+            seg->segment_list_entries = seg->segment_list_entries_end = entry;
+        else
+            seg->segment_list_entries_end->next = entry;
+        seg->segment_list_entries_end = entry;
+
+        /* drop first item */
+        if (seg->list_size && segment_count >= seg->list_size) {
+            entry = seg->segment_list_entries;
+            seg->segment_list_entries = seg->segment_list_entries->next;
+            av_freep(&entry->filename);
+            av_freep(&entry);
+        }
+
+        if ((ret = segment_list_open(s)) < 0)
+            return ret;
+        for (entry = seg->segment_list_entries; entry; entry = entry->next)
+            segment_list_print_entry(seg->list_pb, seg->list_type, entry, s);
+        if (seg->list_type == LIST_TYPE_M3U8 && is_last)
+            avio_printf(seg->list_pb, "#EXT-X-ENDLIST\n");
+        ff_format_io_close(s, &seg->list_pb);
+        if (seg->use_rename)
+            ff_rename(seg->temp_list_filename, seg->list, s);
+    } else {
+        segment_list_print_entry(seg->list_pb, seg->list_type, cur_entry, s);
+        avio_flush(seg->list_pb);
+    }
+    return 0;
+}
+
+#if HAVE_THREADS
+static void segment_finalize_job_free(void *msg)
+{
+    SegmentFinalizeJob *job = msg;
+
+    if (job->oc) {
+        ff_format_io_close(job->oc, &job->oc->pb);
+        avformat_free_context(job->oc);
+        job->oc = NULL;
+    }
+    av_freep(&job->entry.filename);
+}
+
+static void *segment_finalize_thread(void *arg)
+{
+    AVFormatContext *s = arg;
+    SegmentContext *seg = s->priv_data;
+    SegmentFinalizeJob job;
+    int expected = 0;
+
+    ff_thread_setname("segment-finalize");
+
+    while (av_thread_message_queue_recv(seg->finalize_queue, &job, 0) >= 0) {
+        int ret = 0, err;
+
+        if (job.oc) {
+            ret = av_write_trailer(job.oc);
+            if (ret < 0)
+                av_log(s, AV_LOG_ERROR, "Failure occurred when ending segment '%s'\n",
+                       job.oc->url);
+            ff_format_io_close(job.oc, &job.oc->pb);
+        } else {
+            ff_format_io_close(s, &job.pb);
+        }
+        if (seg->list && (err = segment_list_update(s, &job.entry, job.segment_count,
+                                                    job.is_last)) < 0)
+            ret = err;
+        segment_finalize_job_free(&job);
+        if (ret < 0)
+            atomic_compare_exchange_strong(&seg->finalize_error, &expected, ret);
+    }
+    return NULL;
+}
+
+static int segment_finalize_init(AVFormatContext *s)
+{
+    SegmentContext *seg = s->priv_data;
+    int ret;
+
+    ret = av_thread_message_queue_alloc(&seg->finalize_queue, seg->async_finalize,
+                                        sizeof(SegmentFinalizeJob));
+    if (ret < 0)
+        return ret;
+    av_thread_message_queue_set_free_func(seg->finalize_queue, segment_finalize_job_free);
+
+    ret = pthread_create(&seg->finalize_tid, NULL, segment_finalize_thread, s);
+    if (ret) {
+        av_log(s, AV_LOG_ERROR, "pthread_create failed: %s\n", strerror(ret));
+        av_thread_message_queue_free(&seg->finalize_queue);
+        return AVERROR(ret);
+    }
+    return 0;
+}
+
+/* Wait for the pending segments to be finalized and stop the thread. */
+static int segment_finalize_uninit(AVFormatContext *s)
+{
+    SegmentContext *seg = s->priv_data;
+
+    if (!seg->finalize_queue)
+        return 0;
+
+    av_thread_message_queue_set_err_recv(seg->finalize_queue, AVERROR_EOF);
+    pthread_join(seg->finalize_tid, NULL);
+    av_thread_message_queue_free(&seg->finalize_queue);
+    return atomic_load(&seg->finalize_error);
+}
+#endif
+
 static int segment_end(AVFormatContext *s, int write_trailer, int is_last)
 {
     SegmentContext *seg = s->priv_data;
@@ -358,57 +505,55 @@ static int segment_end(AVFormatContext *s, int write_trailer, int is_last)
 
     if (!oc || !oc->pb)
         return AVERROR(EINVAL);
+    if ((ret = atomic_load(&seg->finalize_error)) < 0)
+        return ret;
 
     av_write_frame(oc, NULL); /* Flush any buffered data (fragmented mp4) */
-    if (write_trailer)
-        ret = av_write_trailer(oc);
-
-    if (ret < 0)
-        av_log(s, AV_LOG_ERROR, "Failure occurred when ending segment '%s'\n",
-               oc->url);
 
-    if (seg->list) {
-        if (seg->list_size || seg->list_type == LIST_TYPE_M3U8) {
-            SegmentListEntry *entry = av_mallocz(sizeof(*entry));
-            if (!entry) {
-                ret = AVERROR(ENOMEM);
-                goto end;
-            }
+    if (seg->finalize_queue) {
+        /* The context is not used anymore once its trailer is written, so
+         * the thread takes it over; otherwise only the output is handed
+         * over and the context goes on with the next segment. */
+        SegmentFinalizeJob job = {
+            .oc            = write_trailer ? oc : NULL,
+            .pb            = write_trailer ? NULL : oc->pb,
+            .entry         = seg->cur_entry,
+            .segment_count = seg->segment_count,
+            .is_last       = is_last,
+        };
+        job.entry.next     = NULL;
+        job.entry.filename = av_strdup(seg->cur_entry.filename);
+        if (!job.entry.filename)
+            return AVERROR(ENOMEM);
+        av_log(s, AV_LOG_VERBOSE, "segment:'%s' count:%d ended\n",
+               oc->url, seg->segment_count);
+        ret = av_thread_message_queue_send(seg->finalize_queue, &job, 0);
+        if (ret < 0) {
+            av_freep(&job.entry.filename);
+            return ret;
+        }
+        if (write_trailer)
+            seg->avf = NULL;
+        else
+            oc->pb = NULL;
+        oc = NULL;
+    } else {
+        if (write_trailer)
+            ret = av_write_trailer(oc);
 
-            /* append new element */
-            memcpy(entry, &seg->cur_entry, sizeof(*entry));
-            entry->filename = av_strdup(entry->filename);
-            if (!seg->segment_list_entries)
-                seg->segment_list_entries = seg->segment_list_entries_end = entry;
-            else
-                seg->segment_list_entries_end->next = entry;
-            seg->segment_list_entries_end = entry;
-
-            /* drop first item */
-            if (seg->list_size && seg->segment_count >= seg->list_size) {
-                entry = seg->segment_list_entries;
-                seg->segment_list_entries = seg->segment_list_entries->next;
-                av_freep(&entry->filename);
-                av_freep(&entry);
-            }
+        if (ret < 0)
+            av_log(s, AV_LOG_ERROR, "Failure occurred when ending segment '%s'\n",
+                   oc->url);
 
-            if ((ret = segment_list_open(s)) < 0)
-                goto end;
-            for (entry = seg->segment_list_entries; entry; entry = entry->next)
-                segment_list_print_entry(seg->list_pb, seg->list_type, entry, s);
-            if (seg->list_type == LIST_TYPE_M3U8 && is_last)
-                avio_printf(seg->list_pb, "#EXT-X-ENDLIST\n");
-            ff_format_io_close(s, &seg->list_pb);
-            if (seg->use_rename)
-                ff_rename(seg->temp_list_filename, seg->list, s);
-        } else {
-            segment_list_print_entry(seg->list_pb, seg->list_type, &seg->cur_entry, s);
-            avio_flush(seg->list_pb);
+        if (seg->list && (err = segment_list_update(s, &seg->cur_entry,
+                                                    seg->segment_count, is_last)) < 0) {
+            ret = err;
+            goto end;
         }
-    }
 
-    av_log(s, AV_LOG_VERBOSE, "segment:'%s' count:%d ended\n",
-           seg->avf->url, seg->segment_count);
+        av_log(s, AV_LOG_VERBOSE, "segment:'%s' count:%d ended\n",
+               seg->avf->url, seg->segment_count);
+    }
     seg->segment_count++;
 
     if (seg->increment_tc) {
@@ -451,7 +596,8 @@ static int segment_end(AVFormatContext *s, int write_trailer, int is_last)
     }
 
 end:
-    ff_format_io_close(oc, &oc->pb);
+    if (oc)
+        ff_format_io_close(oc, &oc->pb);
 
     return ret;
 }
@@ -647,6 +793,9 @@ static void seg_free(AVFormatContext *s)
     SegmentContext *seg = s->priv_data;
     SegmentListEntry *cur;
 
+#if HAVE_THREADS
+    segment_finalize_uninit(s);
+#endif
     ff_format_io_close(s, &seg->list_pb);
     if (seg->avf) {
         if (seg->is_nullctx)
@@ -814,6 +963,16 @@ static int seg_init(AVFormatContext *s)
     if (oc->avoid_negative_ts > 0 && s->avoid_negative_ts < 0)
         s->avoid_negative_ts = 1;
 
+    if (seg->async_finalize) {
+#if HAVE_THREADS
+        int err = segment_finalize_init(s);
+        if (err < 0)
+            return err;
+#else
+        av_log(s, AV_LOG_WARNING, "Asynchronous finalization requires threads, ignoring\n");
+#endif
+    }
+
     return ret;
 }
 
@@ -1009,6 +1168,13 @@ static int seg_write_trailer(struct AVFormatContext *s)
     } else {
         ret = segment_end(s, 1, 1);
     }
+#if HAVE_THREADS
+    if (seg->finalize_queue) {
+        int err = segment_finalize_uninit(s);
+        if (ret >= 0)
+            ret = err;
+    }
+#endif
     return ret;
 }
 
@@ -1075,6 +1241,7 @@ static const AVOption options[] = {
     { "reset_timestamps", "reset timestamps at the beginning of each segment", OFFSET(reset_timestamps), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, E },
     { "initial_offset", "set initial timestamp offset", OFFSET(initial_offset), AV_OPT_TYPE_DURATION, {.i64 = 0}, -INT64_MAX, INT64_MAX, E },
     { "write_empty_segments", "allow writing empty 'filler' segments", OFFSET(write_empty), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, E },
+    { "segment_async_finalize", "set the number of ended segments that may be finalized in the background", OFFSET(async_finalize), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 64, E },
     { NULL },
 };
 
@@ -115,6 +115,27 @@ static int parse_slave_fifo_options(const char *fifo_options, TeeSlave *tee_slav
     return av_dict_parse_string(&tee_slave->fifo_options, fifo_options, "=", ":", 0);
 }
 
+static int parse_slave_overflow_policy(const char *opt, TeeSlave *tee_slave)
+{
+    const char *drop;
+
+    if (!av_strcasecmp("block", opt))
+        drop = "0";
+    else if (!av_strcasecmp("drop", opt))
+        drop = "1";
+    else
+        return AVERROR(EINVAL);
+
+    tee_slave->use_fifo = 1;
+    return av_dict_set(&tee_slave->fifo_options, "drop_pkts_on_overflow", drop, 0);
+}
+
+static int parse_slave_queue_size(const char *opt, TeeSlave *tee_slave)
+{
+    tee_slave->use_fifo = 1;
+    return av_dict_set(&tee_slave->fifo_options, "queue_size", opt, 0);
+}
+
 static int close_slave(TeeSlave *tee_slave)
 {
     AVFormatContext *avf;
@@ -195,6 +216,12 @@ static int open_slave(AVFormatContext *avf, char *slave, TeeSlave *tee_slave)
                           av_err2str(ret)););
     PROCESS_OPTION("fifo_options",
                    parse_slave_fifo_options(value, tee_slave), ;);
+    PROCESS_OPTION("overflow",
+                   parse_slave_overflow_policy(value, tee_slave),
+                   av_log(avf, AV_LOG_ERROR, "Invalid overflow option value, "
+                          "valid options are 'block' and 'drop'\n"););
+    PROCESS_OPTION("queue_size",
+                   parse_slave_queue_size(value, tee_slave), ;);
     entry = NULL;
     while ((entry = av_dict_get(options, "bsfs", entry, AV_DICT_IGNORE_SUFFIX))) {
         /* trim out strlen("bsfs") characters from key */
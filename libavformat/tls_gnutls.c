@@ -147,6 +147,34 @@ static ssize_t gnutls_url_push(gnutls_transport_ptr_t transport,
     return -1;
 }
 
+#if GNUTLS_VERSION_NUMBER >= 0x030200
+static int set_alpn(URLContext *h, gnutls_session_t session, const char *alpn)
+{
+    gnutls_datum_t protos[16];
+    unsigned nb_protos = 0;
+    int ret;
+
+    for (const char *q = alpn; ; ) {
+        size_t len = strcspn(q, ",");
+        if (!len || len > 255 || nb_protos == FF_ARRAY_ELEMS(protos)) {
+            av_log(h, AV_LOG_ERROR, "Invalid ALPN protocol list %s\n", alpn);
+            return AVERROR(EINVAL);
+        }
+        protos[nb_protos].data   = (unsigned char *)q;
+        protos[nb_protos++].size = len;
+        q += len;
+        if (!*q++)
+            break;
+    }
+    ret = gnutls_alpn_set_protocols(session, protos, nb_protos, 0);
+    if (ret < 0) {
+        av_log(h, AV_LOG_ERROR, "%s\n", gnutls_strerror(ret));
+        return AVERROR(EIO);
+    }
+    return 0;
+}
+#endif
+
 static int tls_open(URLContext *h, const char *uri, int flags, AVDictionary **options)
 {
     TLSContext *p = h->priv_data;
@@ -161,6 +189,14 @@ static int tls_open(URLContext *h, const char *uri, int flags, AVDictionary **op
     gnutls_init(&p->session, c->listen ? GNUTLS_SERVER : GNUTLS_CLIENT);
     if (!c->listen && !c->numerichost)
         gnutls_server_name_set(p->session, GNUTLS_NAME_DNS, c->host, strlen(c->host));
+    if (!c->listen && c->alpn) {
+#if GNUTLS_VERSION_NUMBER >= 0x030200
+        if ((ret = set_alpn(h, p->session, c->alpn)) < 0)
+            goto fail;
+#else
+        av_log(h, AV_LOG_WARNING, "ALPN is not supported by this GnuTLS version\n");
+#endif
+    }
     gnutls_certificate_allocate_credentials(&p->cred);
     if (c->ca_file) {
         ret = gnutls_certificate_set_x509_trust_file(p->cred, c->ca_file, GNUTLS_X509_FMT_PEM);
@@ -204,6 +240,16 @@ static int tls_open(URLContext *h, const char *uri, int flags, AVDictionary **op
         }
     } while (ret);
     p->need_shutdown = 1;
+#if GNUTLS_VERSION_NUMBER >= 0x030200
+    if (!c->listen && c->alpn) {
+        gnutls_datum_t proto;
+        if (gnutls_alpn_get_selected_protocol(p->session, &proto) < 0)
+            proto.size = 0;
+        av_log(h, AV_LOG_DEBUG, "ALPN selected protocol: %.*s\n",
+               proto.size ? (int)proto.size : 4,
+               proto.size ? (const char *)proto.data : "none");
+    }
+#endif
     if (c->verify) {
         unsigned int status, cert_list_size;
         gnutls_x509_crt_t cert;
@@ -19,11 +19,17 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include "avformat.h"
 #include "network.h"
 #include "os_support.h"
 #include "url.h"
 #include "tls.h"
+#include "libavutil/avstring.h"
+#include "libavutil/mem.h"
 #include "libavutil/opt.h"
+#include "libavutil/thread.h"
+
+#include <time.h>
 
 #include <openssl/bio.h>
 #include <openssl/ssl.h>
@@ -38,23 +44,97 @@ typedef struct TLSContext {
     BIO_METHOD* url_bio_method;
 #endif
     int io_err;
+    int session_reuse;
+    char *session_key;
 } TLSContext;
 
+/* Client sessions are kept process wide, so that later connections to
+ * the same server with the same settings can skip the full handshake.
+ * Entries are freed as soon as their session has expired. */
+#define SESSION_CACHE_SIZE 16
+
+static AVMutex session_mutex = AV_MUTEX_INITIALIZER;
+static struct {
+    char *key;
+    SSL_SESSION *session;
+} session_cache[SESSION_CACHE_SIZE];
+static unsigned session_cache_next;
+
+/* Must be called with session_mutex held. */
+static void session_cache_expire(void)
+{
+    const int64_t now = time(NULL);
+
+    for (int i = 0; i < SESSION_CACHE_SIZE; i++) {
+        SSL_SESSION *session = session_cache[i].session;
+        if (session && now - SSL_SESSION_get_time(session) >= SSL_SESSION_get_timeout(session)) {
+            SSL_SESSION_free(session);
+            session_cache[i].session = NULL;
+            av_freep(&session_cache[i].key);
+        }
+    }
+}
+
+/* Takes ownership of the session reference. */
+static void session_cache_store(const char *key, SSL_SESSION *session)
+{
+    int i;
+
+    ff_mutex_lock(&session_mutex);
+    session_cache_expire();
+    for (i = 0; i < SESSION_CACHE_SIZE; i++)
+        if (session_cache[i].key && !strcmp(session_cache[i].key, key))
+            break;
+    if (i == SESSION_CACHE_SIZE) {
+        char *k = av_strdup(key);
+        if (!k) {
+            ff_mutex_unlock(&session_mutex);
+            SSL_SESSION_free(session);
+            return;
+        }
+        i = session_cache_next++ % SESSION_CACHE_SIZE;
+        av_free(session_cache[i].key);
+        session_cache[i].key = k;
+    }
+    if (session_cache[i].session)
+        SSL_SESSION_free(session_cache[i].session);
+    session_cache[i].session = session;
+    ff_mutex_unlock(&session_mutex);
+}
+
+static void session_cache_resume(SSL *ssl, const char *key)
+{
+    ff_mutex_lock(&session_mutex);
+    session_cache_expire();
+    for (int i = 0; i < SESSION_CACHE_SIZE; i++) {
+        if (session_cache[i].key && !strcmp(session_cache[i].key, key)) {
+            SSL_set_session(ssl, session_cache[i].session);
+            break;
+        }
+    }
+    ff_mutex_unlock(&session_mutex);
+}
+
+static int tls_new_session(SSL *ssl, SSL_SESSION *session)
+{
+    TLSContext *p = SSL_get_app_data(ssl);
+
+    session_cache_store(p->session_key, session);
+    return 1;
+}
+
 /* OpenSSL 1.0.2 or below, then you would use SSL_library_init. If you are
  * using OpenSSL 1.1.0 or above, then the library will initialize
  * itself automatically.
  * https://wiki.openssl.org/index.php/Library_Initialization
  */
 #if OPENSSL_VERSION_NUMBER < 0x10100000L
-#include "libavutil/thread.h"
-
 static AVMutex openssl_mutex = AV_MUTEX_INITIALIZER;
 
 static int openssl_init;
 
 #if HAVE_THREADS
 #include <openssl/crypto.h>
-#include "libavutil/mem.h"
 
 pthread_mutex_t *openssl_mutexes;
 static void openssl_lock(int mode, int type, const char *file, int line)
@@ -154,6 +234,7 @@ static int tls_close(URLContext *h)
     }
     if (c->ctx)
         SSL_CTX_free(c->ctx);
+    av_freep(&c->session_key);
     ffurl_closep(&c->tls_shared.tcp);
 #if OPENSSL_VERSION_NUMBER >= 0x1010000fL
     if (c->url_bio_method)
@@ -250,6 +331,41 @@ static BIO_METHOD url_bio_method = {
 };
 #endif
 
+#if OPENSSL_VERSION_NUMBER >= 0x10002000L
+/* Offer the comma separated protocols in the ALPN wire format, each name
+ * prefixed by its length. */
+static int set_alpn(URLContext *h, SSL *ssl, const char *alpn)
+{
+    size_t len = strlen(alpn);
+    unsigned char *protos = av_malloc(len + 1), *start = protos, *p = protos + 1;
+    int ret = 0;
+
+    if (!protos)
+        return AVERROR(ENOMEM);
+    for (const char *q = alpn; ; q++) {
+        if (*q && *q != ',') {
+            *p++ = *q;
+            continue;
+        }
+        if (p - start - 1 < 1 || p - start - 1 > 255) {
+            av_log(h, AV_LOG_ERROR, "Invalid ALPN protocol list %s\n", alpn);
+            ret = AVERROR(EINVAL);
+            break;
+        }
+        *start = p - start - 1;
+        if (!*q)
+            break;
+        start = p++;
+    }
+    if (!ret && SSL_set_alpn_protos(ssl, protos, p - protos)) {
+        av_log(h, AV_LOG_ERROR, "%s\n", ERR_error_string(ERR_get_error(), NULL));
+        ret = AVERROR(EIO);
+    }
+    av_free(protos);
+    return ret;
+}
+#endif
+
 static int tls_open(URLContext *h, const char *uri, int flags, AVDictionary **options)
 {
     TLSContext *p = h->priv_data;
@@ -296,12 +412,31 @@ static int tls_open(URLContext *h, const char *uri, int flags, AVDictionary **op
     // the requested hostname.
     if (c->verify)
         SSL_CTX_set_verify(p->ctx, SSL_VERIFY_PEER|SSL_VERIFY_FAIL_IF_NO_PEER_CERT, NULL);
+    if (!c->listen && p->session_reuse) {
+        int port;
+        av_url_split(NULL, 0, NULL, 0, NULL, 0, &port, NULL, 0, uri);
+        // A session must only be resumed with the settings it was verified with.
+        p->session_key = av_asprintf("%s:%d %s %d %s %s", c->underlying_host, port,
+                                     c->host, c->verify, c->ca_file ? c->ca_file : "",
+                                     c->cert_file ? c->cert_file : "");
+        if (!p->session_key) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+        SSL_CTX_set_session_cache_mode(p->ctx, SSL_SESS_CACHE_CLIENT |
+                                               SSL_SESS_CACHE_NO_INTERNAL_STORE);
+        SSL_CTX_sess_set_new_cb(p->ctx, tls_new_session);
+    }
     p->ssl = SSL_new(p->ctx);
     if (!p->ssl) {
         av_log(h, AV_LOG_ERROR, "%s\n", ERR_error_string(ERR_get_error(), NULL));
         ret = AVERROR(EIO);
         goto fail;
     }
+    if (p->session_key) {
+        SSL_set_app_data(p->ssl, p);
+        session_cache_resume(p->ssl, p->session_key);
+    }
 #if OPENSSL_VERSION_NUMBER >= 0x1010000fL
     p->url_bio_method = BIO_meth_new(BIO_TYPE_SOURCE_SINK, "urlprotocol bio");
     BIO_meth_set_write(p->url_bio_method, url_bio_bwrite);
@@ -319,6 +454,14 @@ static int tls_open(URLContext *h, const char *uri, int flags, AVDictionary **op
     SSL_set_bio(p->ssl, bio, bio);
     if (!c->listen && !c->numerichost)
         SSL_set_tlsext_host_name(p->ssl, c->host);
+    if (!c->listen && c->alpn) {
+#if OPENSSL_VERSION_NUMBER >= 0x10002000L
+        if ((ret = set_alpn(h, p->ssl, c->alpn)) < 0)
+            goto fail;
+#else
+        av_log(h, AV_LOG_WARNING, "ALPN is not supported by this OpenSSL version\n");
+#endif
+    }
     ret = c->listen ? SSL_accept(p->ssl) : SSL_connect(p->ssl);
     if (ret == 0) {
         av_log(h, AV_LOG_ERROR, "Unable to negotiate TLS/SSL session\n");
@@ -328,6 +471,17 @@ static int tls_open(URLContext *h, const char *uri, int flags, AVDictionary **op
         ret = print_tls_error(h, ret);
         goto fail;
     }
+    if (SSL_session_reused(p->ssl))
+        av_log(h, AV_LOG_DEBUG, "Resumed TLS session\n");
+#if OPENSSL_VERSION_NUMBER >= 0x10002000L
+    if (!c->listen && c->alpn) {
+        const unsigned char *proto;
+        unsigned int len;
+        SSL_get0_alpn_selected(p->ssl, &proto, &len);
+        av_log(h, AV_LOG_DEBUG, "ALPN selected protocol: %.*s\n",
+               len ? (int)len : 4, len ? (const char *)proto : "none");
+    }
+#endif
 
     return 0;
 fail:
@@ -379,6 +533,7 @@ static int tls_get_short_seek(URLContext *h)
 
 static const AVOption options[] = {
     TLS_COMMON_OPTIONS(TLSContext, tls_shared),
+    { "session_reuse", "Resume sessions of earlier connections to the same server", offsetof(TLSContext, session_reuse), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, TLS_OPTFL },
     { NULL }
 };
 
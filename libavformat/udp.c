@@ -26,6 +26,7 @@
 
 #define _DEFAULT_SOURCE
 #define _BSD_SOURCE     /* Needed for using struct ip_mreq with recent glibc */
+#define _GNU_SOURCE     /* recvmmsg(), sendmmsg() */
 
 #include "avformat.h"
 #include "libavutil/avassert.h"
@@ -108,6 +109,19 @@ typedef struct UDPContext {
     int thread_started;
 #endif
     uint8_t tmp[UDP_MAX_PKT_SIZE+4];
+    int recv_batch;
+    int send_batch;
+#if HAVE_RECVMMSG || HAVE_SENDMMSG
+    /* datagrams received or sent at once by the circular buffer thread */
+    uint8_t *batch_buf;
+    struct mmsghdr *batch_msgs;
+    struct iovec *batch_iov;
+    struct sockaddr_storage *batch_addr;
+#endif
+    /* transmission statistics */
+    int64_t tx_packets;
+    int64_t tx_calls;
+    int64_t tx_behind;
     int remaining_in_dg;
     char *localaddr;
     int timeout;
@@ -136,6 +150,8 @@ static const AVOption options[] = {
     { "connect",        "set if connect() should be called on socket",     OFFSET(is_connected),   AV_OPT_TYPE_BOOL,   { .i64 =  0 },     0, 1,       .flags = D|E },
     { "fifo_size",      "set the UDP receiving circular buffer size, expressed as a number of packets with size of 188 bytes", OFFSET(circular_buffer_size), AV_OPT_TYPE_INT, {.i64 = 7*4096}, 0, INT_MAX, D },
     { "overrun_nonfatal", "survive in case of UDP receiving circular buffer overrun", OFFSET(overrun_nonfatal), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1,    D },
+    { "recv_batch",     "set the maximum number of packets received at once by the circular buffer thread", OFFSET(recv_batch), AV_OPT_TYPE_INT, {.i64 = 16}, 1, 256, D },
+    { "send_batch",     "set the maximum number of packets sent at once by the circular buffer thread", OFFSET(send_batch), AV_OPT_TYPE_INT, {.i64 = 16}, 1, 256, E },
     { "timeout",        "set raise error timeout, in microseconds (only in read mode)",OFFSET(timeout),         AV_OPT_TYPE_INT,  {.i64 = 0}, 0, INT_MAX, D },
     { "sources",        "Source list",                                     OFFSET(sources),        AV_OPT_TYPE_STRING, { .str = NULL },               .flags = D|E },
     { "block",          "Block list",                                      OFFSET(block),          AV_OPT_TYPE_STRING, { .str = NULL },               .flags = D|E },
@@ -476,7 +492,45 @@ static int udp_get_file_handle(URLContext *h)
     return s->udp_fd;
 }
 
+static void udp_free_batch(UDPContext *s)
+{
+#if HAVE_RECVMMSG || HAVE_SENDMMSG
+    av_freep(&s->batch_buf);
+    av_freep(&s->batch_msgs);
+    av_freep(&s->batch_iov);
+    av_freep(&s->batch_addr);
+#endif
+}
+
 #if HAVE_PTHREAD_CANCEL
+static int udp_alloc_batch(UDPContext *s, int is_output)
+{
+#if HAVE_RECVMMSG || HAVE_SENDMMSG
+    int nb = is_output ? s->send_batch : s->recv_batch;
+
+    if (nb <= 1 || (is_output ? !HAVE_SENDMMSG : !HAVE_RECVMMSG))
+        return 0;
+
+    s->batch_buf  = av_malloc_array(nb, UDP_MAX_PKT_SIZE + 4);
+    s->batch_msgs = av_calloc(nb, sizeof(*s->batch_msgs));
+    s->batch_iov  = av_calloc(nb, sizeof(*s->batch_iov));
+    s->batch_addr = av_calloc(nb, sizeof(*s->batch_addr));
+    if (!s->batch_buf || !s->batch_msgs || !s->batch_iov || !s->batch_addr) {
+        udp_free_batch(s);
+        return AVERROR(ENOMEM);
+    }
+
+    for (int i = 0; i < nb; i++) {
+        s->batch_iov[i].iov_base = s->batch_buf + i * (UDP_MAX_PKT_SIZE + 4) + 4;
+        s->batch_iov[i].iov_len  = UDP_MAX_PKT_SIZE;
+        s->batch_msgs[i].msg_hdr.msg_iov    = &s->batch_iov[i];
+        s->batch_msgs[i].msg_hdr.msg_iovlen = 1;
+        s->batch_msgs[i].msg_hdr.msg_name   = &s->batch_addr[i];
+    }
+#endif
+    return 0;
+}
+
 static void *circular_buffer_task_rx( void *_URLContext)
 {
     URLContext *h = _URLContext;
@@ -493,7 +547,7 @@ static void *circular_buffer_task_rx( void *_URLContext)
         goto end;
     }
     while(1) {
-        int len;
+        int len, nb = 1;
         struct sockaddr_storage addr;
         socklen_t addr_len = sizeof(addr);
 
@@ -502,6 +556,15 @@ static void *circular_buffer_task_rx( void *_URLContext)
            see "General Information" / "Thread Cancelation Overview"
            in Single Unix. */
         pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &old_cancelstate);
+#if HAVE_RECVMMSG
+        if (s->batch_msgs) {
+            for (int i = 0; i < s->recv_batch; i++)
+                s->batch_msgs[i].msg_hdr.msg_namelen = sizeof(*s->batch_addr);
+            /* Wait for one packet, then take whatever else is pending. */
+            len = nb = recvmmsg(s->udp_fd, s->batch_msgs, s->recv_batch,
+                                MSG_WAITFORONE, NULL);
+        } else
+#endif
         len = recvfrom(s->udp_fd, s->tmp+4, sizeof(s->tmp)-4, 0, (struct sockaddr *)&addr, &addr_len);
         pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancelstate);
         pthread_mutex_lock(&s->mutex);
@@ -512,25 +575,37 @@ static void *circular_buffer_task_rx( void *_URLContext)
             }
             continue;
         }
-        if (ff_ip_check_source_lists(&addr, &s->filters))
-            continue;
-        AV_WL32(s->tmp, len);
-
-        if (av_fifo_can_write(s->fifo) < len + 4) {
-            /* No Space left */
-            if (s->overrun_nonfatal) {
-                av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
-                        "Surviving due to overrun_nonfatal option\n");
+        for (int i = 0; i < nb; i++) {
+            uint8_t *buf = s->tmp;
+            struct sockaddr_storage *src = &addr;
+
+#if HAVE_RECVMMSG
+            if (s->batch_msgs) {
+                buf = s->batch_buf + i * (UDP_MAX_PKT_SIZE + 4);
+                src = &s->batch_addr[i];
+                len = s->batch_msgs[i].msg_len;
+            }
+#endif
+            if (ff_ip_check_source_lists(src, &s->filters))
                 continue;
-            } else {
-                av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
-                        "To avoid, increase fifo_size URL option. "
-                        "To survive in such case, use overrun_nonfatal option\n");
-                s->circular_buffer_error = AVERROR(EIO);
-                goto end;
+            AV_WL32(buf, len);
+
+            if (av_fifo_can_write(s->fifo) < len + 4) {
+                /* No Space left */
+                if (s->overrun_nonfatal) {
+                    av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
+                            "Surviving due to overrun_nonfatal option\n");
+                    continue;
+                } else {
+                    av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
+                            "To avoid, increase fifo_size URL option. "
+                            "To survive in such case, use overrun_nonfatal option\n");
+                    s->circular_buffer_error = AVERROR(EIO);
+                    goto end;
+                }
             }
+            av_fifo_write(s->fifo, buf, len + 4);
         }
-        av_fifo_write(s->fifo, s->tmp, len + 4);
         pthread_cond_signal(&s->cond);
     }
 
@@ -540,15 +615,105 @@ end:
     return NULL;
 }
 
+typedef struct TXPacing {
+    int64_t start_timestamp;
+    int64_t target_timestamp;
+    int64_t sent_bits;
+    int64_t burst_interval;
+    int64_t max_delay;
+} TXPacing;
+
+/**
+ * Account for a packet of len bytes in the rate control of the
+ * transmitting thread.
+ * @return how long to wait before sending it, in microseconds
+ */
+static int64_t tx_pace(UDPContext *s, TXPacing *pc, int len, int64_t timestamp)
+{
+    int64_t delay = 0;
+
+    if (timestamp < pc->target_timestamp) {
+        delay = pc->target_timestamp - timestamp;
+        if (delay > pc->max_delay) {
+            delay = pc->max_delay;
+            pc->start_timestamp = timestamp + delay;
+            pc->sent_bits = 0;
+        }
+    } else {
+        if (timestamp - pc->burst_interval > pc->target_timestamp) {
+            pc->start_timestamp = timestamp - pc->burst_interval;
+            pc->sent_bits = 0;
+            s->tx_behind++;
+        }
+    }
+    pc->sent_bits += len * 8;
+    pc->target_timestamp = pc->start_timestamp + pc->sent_bits * 1000000 / s->bitrate;
+
+    return delay;
+}
+
+static int tx_send(UDPContext *s, const uint8_t *p, int len)
+{
+    while (len) {
+        int ret;
+        av_assert0(len > 0);
+        if (!s->is_connected) {
+            ret = sendto (s->udp_fd, p, len, 0,
+                        (struct sockaddr *) &s->dest_addr,
+                        s->dest_addr_len);
+        } else
+            ret = send(s->udp_fd, p, len, 0);
+        s->tx_calls++;
+        if (ret >= 0) {
+            len -= ret;
+            p   += ret;
+        } else {
+            ret = ff_neterrno();
+            if (ret != AVERROR(EAGAIN) && ret != AVERROR(EINTR))
+                return ret;
+        }
+    }
+    return 0;
+}
+
+#if HAVE_SENDMMSG
+static int tx_send_batch(UDPContext *s, int nb)
+{
+    for (int i = 0; i < nb; i++) {
+        s->batch_msgs[i].msg_hdr.msg_name    = s->is_connected ? NULL : &s->dest_addr;
+        s->batch_msgs[i].msg_hdr.msg_namelen = s->is_connected ? 0    : s->dest_addr_len;
+    }
+    for (int i = 0; i < nb;) {
+        int ret = sendmmsg(s->udp_fd, s->batch_msgs + i, nb - i, 0);
+        s->tx_calls++;
+        if (ret >= 0) {
+            i += ret;
+        } else {
+            ret = ff_neterrno();
+            if (ret != AVERROR(EAGAIN) && ret != AVERROR(EINTR))
+                return ret;
+        }
+    }
+    return 0;
+}
+#endif
+
 static void *circular_buffer_task_tx( void *_URLContext)
 {
     URLContext *h = _URLContext;
     UDPContext *s = h->priv_data;
-    int64_t target_timestamp = av_gettime_relative();
-    int64_t start_timestamp = av_gettime_relative();
-    int64_t sent_bits = 0;
-    int64_t burst_interval = s->bitrate ? (s->burst_bits * 1000000 / s->bitrate) : 0;
-    int64_t max_delay = s->bitrate ?  ((int64_t)h->max_packet_size * 8 * 1000000 / s->bitrate + 1) : 0;
+    TXPacing pc = {
+        .start_timestamp  = av_gettime_relative(),
+        .target_timestamp = av_gettime_relative(),
+        .burst_interval   = s->bitrate ? (s->burst_bits * 1000000 / s->bitrate) : 0,
+        .max_delay        = s->bitrate ? ((int64_t)h->max_packet_size * 8 * 1000000 / s->bitrate + 1) : 0,
+    };
+    int max_batch = 1;
+
+#if HAVE_SENDMMSG
+    if (s->batch_msgs)
+        max_batch = s->send_batch;
+#endif
 
     ff_thread_setname("udp-tx");
 
@@ -561,10 +726,8 @@ static void *circular_buffer_task_tx( void *_URLContext)
     }
 
     for(;;) {
-        int len;
-        const uint8_t *p;
+        int len, nb = 0, ret;
         uint8_t tmp[4];
-        int64_t timestamp;
 
         len = av_fifo_can_read(s->fifo);
 
@@ -575,58 +738,53 @@ static void *circular_buffer_task_tx( void *_URLContext)
             len = av_fifo_can_read(s->fifo);
         }
 
-        av_fifo_read(s->fifo, tmp, 4);
-        len = AV_RL32(tmp);
-
-        av_assert0(len >= 0);
-        av_assert0(len <= sizeof(s->tmp));
+        /* Take the next packet, wait until it is due, then take along the
+           following ones which are already due too. */
+        do {
+            uint8_t *buf = s->tmp;
 
-        av_fifo_read(s->fifo, s->tmp, len);
+#if HAVE_SENDMMSG
+            if (s->batch_msgs)
+                buf = s->batch_iov[nb].iov_base;
+#endif
+            av_fifo_read(s->fifo, tmp, 4);
+            len = AV_RL32(tmp);
 
-        pthread_mutex_unlock(&s->mutex);
+            av_assert0(len >= 0);
+            av_assert0(len <= UDP_MAX_PKT_SIZE);
 
-        if (s->bitrate) {
-            timestamp = av_gettime_relative();
-            if (timestamp < target_timestamp) {
-                int64_t delay = target_timestamp - timestamp;
-                if (delay > max_delay) {
-                    delay = max_delay;
-                    start_timestamp = timestamp + delay;
-                    sent_bits = 0;
-                }
-                av_usleep(delay);
-            } else {
-                if (timestamp - burst_interval > target_timestamp) {
-                    start_timestamp = timestamp - burst_interval;
-                    sent_bits = 0;
-                }
-            }
-            sent_bits += len * 8;
-            target_timestamp = start_timestamp + sent_bits * 1000000 / s->bitrate;
-        }
+            av_fifo_read(s->fifo, buf, len);
+#if HAVE_SENDMMSG
+            if (s->batch_msgs)
+                s->batch_iov[nb].iov_len = len;
+#endif
 
-        p = s->tmp;
-        while (len) {
-            int ret;
-            av_assert0(len > 0);
-            if (!s->is_connected) {
-                ret = sendto (s->udp_fd, p, len, 0,
-                            (struct sockaddr *) &s->dest_addr,
-                            s->dest_addr_len);
-            } else
-                ret = send(s->udp_fd, p, len, 0);
-            if (ret >= 0) {
-                len -= ret;
-                p   += ret;
-            } else {
-                ret = ff_neterrno();
-                if (ret != AVERROR(EAGAIN) && ret != AVERROR(EINTR)) {
-                    pthread_mutex_lock(&s->mutex);
-                    s->circular_buffer_error = ret;
+            if (s->bitrate) {
+                int64_t delay = tx_pace(s, &pc, len, av_gettime_relative());
+                if (delay) {
                     pthread_mutex_unlock(&s->mutex);
-                    return NULL;
+                    av_usleep(delay);
+                    pthread_mutex_lock(&s->mutex);
                 }
             }
+            nb++;
+        } while (nb < max_batch && av_fifo_can_read(s->fifo) >= 4 &&
+                 (!s->bitrate || av_gettime_relative() >= pc.target_timestamp));
+
+        pthread_mutex_unlock(&s->mutex);
+
+        s->tx_packets += nb;
+#if HAVE_SENDMMSG
+        if (s->batch_msgs)
+            ret = tx_send_batch(s, nb);
+        else
+#endif
+        ret = tx_send(s, s->tmp, len);
+        if (ret < 0) {
+            pthread_mutex_lock(&s->mutex);
+            s->circular_buffer_error = ret;
+            pthread_mutex_unlock(&s->mutex);
+            return NULL;
         }
 
         pthread_mutex_lock(&s->mutex);
@@ -733,6 +891,9 @@ static int udp_open(URLContext *h, const char *uri, int flags)
         if (av_find_info_tag(buf, sizeof(buf), "burst_bits", p)) {
             s->burst_bits = strtoll(buf, NULL, 10);
         }
+        if (av_find_info_tag(buf, sizeof(buf), "send_batch", p)) {
+            s->send_batch = av_clip(strtol(buf, NULL, 10), 1, 256);
+        }
         if (av_find_info_tag(buf, sizeof(buf), "localaddr", p)) {
             av_freep(&s->localaddr);
             s->localaddr = av_strdup(buf);
@@ -938,6 +1099,8 @@ static int udp_open(URLContext *h, const char *uri, int flags)
             ret = AVERROR(ENOMEM);
             goto fail;
         }
+        if ((ret = udp_alloc_batch(s, is_output)) < 0)
+            goto fail;
         ret = pthread_mutex_init(&s->mutex, NULL);
         if (ret != 0) {
             av_log(h, AV_LOG_ERROR, "pthread_mutex_init failed : %s\n", strerror(ret));
@@ -971,6 +1134,7 @@ static int udp_open(URLContext *h, const char *uri, int flags)
     if (udp_fd >= 0)
         closesocket(udp_fd);
     av_fifo_freep2(&s->fifo);
+    udp_free_batch(s);
     ff_ip_reset_filters(&s->filters);
     return ret;
 }
@@ -1095,6 +1259,8 @@ static int udp_write(URLContext *h, const uint8_t *buf, int size)
                       s->dest_addr_len);
     } else
         ret = send(s->udp_fd, buf, size, 0);
+    s->tx_calls++;
+    s->tx_packets += ret >= 0;
 
     return ret < 0 ? ff_neterrno() : ret;
 }
@@ -1138,8 +1304,13 @@ static int udp_close(URLContext *h)
         pthread_cond_destroy(&s->cond);
     }
 #endif
+    if (!(h->flags & AVIO_FLAG_READ) && s->tx_packets)
+        av_log(h, AV_LOG_VERBOSE, "%"PRId64" packets sent with %"PRId64" system calls, "
+               "%"PRId64" times behind schedule\n",
+               s->tx_packets, s->tx_calls, s->tx_behind);
     closesocket(s->udp_fd);
     av_fifo_freep2(&s->fifo);
+    udp_free_batch(s);
     ff_ip_reset_filters(&s->filters);
     return 0;
 }
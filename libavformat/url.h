@@ -26,6 +26,7 @@
 
 #include "avio.h"
 
+#include "libavutil/buffer.h"
 #include "libavutil/dict.h"
 #include "libavutil/log.h"
 
@@ -83,6 +84,7 @@ typedef struct URLProtocol {
     int (*url_get_multi_file_handle)(URLContext *h, int **handles,
                                      int *numhandles);
     int (*url_get_short_seek)(URLContext *h);
+    int (*url_get_buffer)(URLContext *h, int64_t pos, int size, AVBufferRef **buf);
     int (*url_shutdown)(URLContext *h, int flags);
     const AVClass *priv_data_class;
     int priv_data_size;
@@ -263,6 +265,18 @@ int ffurl_get_multi_file_handle(URLContext *h, int **handles, int *numhandles);
  */
 int ffurl_get_short_seek(void *urlcontext);
 
+/**
+ * Return a reference to size bytes of the resource starting at pos,
+ * without copying them and independently of the read position.
+ *
+ * The data is followed by AV_INPUT_BUFFER_PADDING_SIZE readable bytes,
+ * which are not necessarily zero. The buffer is read-only.
+ *
+ * @return size on success, AVERROR(ENOSYS) if the protocol cannot lend
+ *         this range or another negative error code
+ */
+int ffurl_get_buffer(URLContext *h, int64_t pos, int size, AVBufferRef **buf);
+
 /**
  * Signal the URLContext that we are done reading or writing the stream.
  *
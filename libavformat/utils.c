@@ -104,6 +104,47 @@ FF_ENABLE_DEPRECATION_WARNINGS
     return append_packet_chunked(s, pkt, size);
 }
 
+static int codec_ignores_padding(const AVCodecParameters *par)
+{
+    switch (par->codec_id) {
+    case AV_CODEC_ID_RAWVIDEO:
+        // the decoder rewrites these in place, keep them in writable memory
+        return par->codec_tag != MKTAG('b','6','4','a') &&
+               par->codec_tag != MKTAG('y','u','v','2');
+    case AV_CODEC_ID_BITPACKED:
+    case AV_CODEC_ID_V210:
+    case AV_CODEC_ID_V210X:
+    case AV_CODEC_ID_V308:
+    case AV_CODEC_ID_V408:
+    case AV_CODEC_ID_V410:
+    case AV_CODEC_ID_R210:
+    case AV_CODEC_ID_R10K:
+    case AV_CODEC_ID_Y41P:
+    case AV_CODEC_ID_YUV4:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+int ff_get_packet_ref(AVIOContext *s, const AVStream *st, AVPacket *pkt, int size)
+{
+    int64_t pos = avio_tell(s);
+    AVBufferRef *buf;
+
+    if (!codec_ignores_padding(st->codecpar) ||
+        ffio_read_buffer(s, &buf, size) < 0)
+        return av_get_packet(s, pkt, size);
+
+    av_packet_unref(pkt);
+    pkt->buf  = buf;
+    pkt->data = buf->data;
+    pkt->size = size;
+    pkt->pos  = pos;
+
+    return size;
+}
+
 int av_append_packet(AVIOContext *s, AVPacket *pkt, int size)
 {
     if (!pkt->size)
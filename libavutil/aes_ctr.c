@@ -24,11 +24,14 @@
 #include "aes_ctr.h"
 #include "aes.h"
 #include "aes_internal.h"
+#include "intreadwrite.h"
 #include "macros.h"
 #include "mem.h"
 #include "random_seed.h"
 
 #define AES_BLOCK_SIZE (16)
+/* number of counter blocks encrypted with one av_aes_crypt() call */
+#define AES_CTR_BATCH  (16)
 
 typedef struct AVAESCTR {
     uint8_t counter[AES_BLOCK_SIZE];
@@ -111,6 +114,23 @@ void av_aes_ctr_crypt(struct AVAESCTR *a, uint8_t *dst, const uint8_t *src, int
     uint8_t* encrypted_counter_pos;
 
     while (src < src_end) {
+        if (a->block_offset == 0 && src_end - src >= AES_BLOCK_SIZE) {
+            uint8_t keystream[AES_BLOCK_SIZE * AES_CTR_BATCH];
+            int size = FFMIN((src_end - src) / AES_BLOCK_SIZE, AES_CTR_BATCH) * AES_BLOCK_SIZE;
+
+            for (int i = 0; i < size; i += AES_BLOCK_SIZE) {
+                memcpy(keystream + i, a->counter, AES_BLOCK_SIZE);
+                av_aes_ctr_increment_be64(a->counter + 8);
+            }
+            av_aes_crypt(&a->aes, keystream, keystream, size / AES_BLOCK_SIZE, NULL, 0);
+
+            for (int i = 0; i < size; i += 8)
+                AV_WN64(dst + i, AV_RN64(src + i) ^ AV_RN64(keystream + i));
+            src += size;
+            dst += size;
+            continue;
+        }
+
         if (a->block_offset == 0) {
             av_aes_crypt(&a->aes, a->encrypted_counter, a->counter, 1, NULL, 0);
 
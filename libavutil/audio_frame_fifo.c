@@ -0,0 +1,313 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Audio frame FIFO
+ */
+
+#include <limits.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+#include "audio_frame_fifo.h"
+#include "channel_layout.h"
+#include "common.h"
+#include "error.h"
+#include "frame.h"
+#include "mathematics.h"
+#include "mem.h"
+#include "samplefmt.h"
+
+struct AVAudioFrameFifo {
+    AVFrame **frames;               /**< ring of queued frames */
+    unsigned nb_slots;              /**< size of the ring, a power of 2 */
+
+    /* head is only modified by the reader, tail by the writer */
+    atomic_uint head;               /**< index of the first queued frame */
+    atomic_uint tail;               /**< index one past the last queued frame */
+    atomic_int nb_samples;          /**< number of samples available for reading */
+    int offset;                     /**< samples already read from the first queued frame */
+
+    int channels;                   /**< number of channels */
+    enum AVSampleFormat sample_fmt; /**< sample format */
+    int nb_planes;                  /**< number of data planes */
+    int sample_size;                /**< size, in bytes, of one sample in a plane */
+    uintptr_t align_mask;           /**< alignment required for zero-copy reads, minus 1 */
+    unsigned flags;
+};
+
+AVAudioFrameFifo *av_audio_frame_fifo_alloc(enum AVSampleFormat sample_fmt,
+                                            int channels, int nb_frames,
+                                            int align, unsigned flags)
+{
+    AVAudioFrameFifo *aff;
+    unsigned nb_slots = 1;
+
+    if (av_get_bytes_per_sample(sample_fmt) <= 0 || channels <= 0 ||
+        nb_frames <= 0 || nb_frames > INT_MAX / 2 ||
+        align < 0 || (align & (align - 1)))
+        return NULL;
+
+    while (nb_slots < nb_frames)
+        nb_slots <<= 1;
+
+    aff = av_mallocz(sizeof(*aff));
+    if (!aff)
+        return NULL;
+
+    aff->frames = av_calloc(nb_slots, sizeof(*aff->frames));
+    if (!aff->frames) {
+        av_free(aff);
+        return NULL;
+    }
+
+    aff->nb_slots    = nb_slots;
+    aff->channels    = channels;
+    aff->sample_fmt  = sample_fmt;
+    aff->nb_planes   = av_sample_fmt_is_planar(sample_fmt) ? channels : 1;
+    aff->sample_size = av_get_bytes_per_sample(sample_fmt) *
+                       (av_sample_fmt_is_planar(sample_fmt) ? 1 : channels);
+    aff->align_mask  = align > 1 ? align - 1 : 0;
+    aff->flags       = flags;
+    atomic_init(&aff->head, 0);
+    atomic_init(&aff->tail, 0);
+    atomic_init(&aff->nb_samples, 0);
+
+    return aff;
+}
+
+void av_audio_frame_fifo_reset(AVAudioFrameFifo *aff)
+{
+    unsigned head = atomic_load(&aff->head);
+    unsigned tail = atomic_load(&aff->tail);
+
+    for (; head != tail; head++)
+        av_frame_free(&aff->frames[head & (aff->nb_slots - 1)]);
+
+    atomic_store(&aff->head, 0);
+    atomic_store(&aff->tail, 0);
+    atomic_store(&aff->nb_samples, 0);
+    aff->offset = 0;
+}
+
+void av_audio_frame_fifo_freep(AVAudioFrameFifo **paff)
+{
+    AVAudioFrameFifo *aff = *paff;
+
+    if (!aff)
+        return;
+
+    av_audio_frame_fifo_reset(aff);
+    av_freep(&aff->frames);
+    av_freep(paff);
+}
+
+static int grow(AVAudioFrameFifo *aff)
+{
+    unsigned head = atomic_load(&aff->head);
+    unsigned tail = atomic_load(&aff->tail);
+    AVFrame **frames;
+
+    if (aff->nb_slots > INT_MAX / 2)
+        return AVERROR(ENOMEM);
+
+    frames = av_calloc(aff->nb_slots * 2, sizeof(*frames));
+    if (!frames)
+        return AVERROR(ENOMEM);
+
+    for (unsigned i = 0; i < tail - head; i++)
+        frames[i] = aff->frames[(head + i) & (aff->nb_slots - 1)];
+
+    av_free(aff->frames);
+    aff->frames    = frames;
+    aff->nb_slots *= 2;
+    atomic_store(&aff->head, 0);
+    atomic_store(&aff->tail, tail - head);
+
+    return 0;
+}
+
+int av_audio_frame_fifo_write(AVAudioFrameFifo *aff, const AVFrame *frame)
+{
+    unsigned head, tail;
+    AVFrame *ref;
+    int ret;
+
+    if (frame->format != aff->sample_fmt ||
+        frame->ch_layout.nb_channels != aff->channels ||
+        frame->nb_samples < 0)
+        return AVERROR(EINVAL);
+    if (!frame->nb_samples)
+        return 0;
+    if (frame->nb_samples > INT_MAX - av_audio_frame_fifo_size(aff))
+        return AVERROR(EINVAL);
+
+    tail = atomic_load_explicit(&aff->tail, memory_order_relaxed);
+    head = atomic_load_explicit(&aff->head, memory_order_acquire);
+    if (tail - head == aff->nb_slots) {
+        if (aff->flags & AV_AUDIO_FRAME_FIFO_FLAG_SPSC)
+            return AVERROR(EAGAIN);
+        ret = grow(aff);
+        if (ret < 0)
+            return ret;
+        tail = atomic_load_explicit(&aff->tail, memory_order_relaxed);
+    }
+
+    ref = av_frame_clone(frame);
+    if (!ref)
+        return AVERROR(ENOMEM);
+
+    aff->frames[tail & (aff->nb_slots - 1)] = ref;
+    atomic_store_explicit(&aff->tail, tail + 1, memory_order_release);
+    atomic_fetch_add_explicit(&aff->nb_samples, frame->nb_samples, memory_order_release);
+
+    return 0;
+}
+
+static AVFrame *peek(AVAudioFrameFifo *aff)
+{
+    unsigned head = atomic_load_explicit(&aff->head, memory_order_relaxed);
+
+    return aff->frames[head & (aff->nb_slots - 1)];
+}
+
+static void advance(AVAudioFrameFifo *aff, int nb_samples)
+{
+    unsigned head = atomic_load_explicit(&aff->head, memory_order_relaxed);
+    AVFrame **src = &aff->frames[head & (aff->nb_slots - 1)];
+
+    aff->offset += nb_samples;
+    if (aff->offset == (*src)->nb_samples) {
+        av_frame_free(src);
+        aff->offset = 0;
+        atomic_store_explicit(&aff->head, head + 1, memory_order_release);
+    }
+    atomic_fetch_sub_explicit(&aff->nb_samples, nb_samples, memory_order_release);
+}
+
+static void set_timing(AVFrame *frame, const AVFrame *src, int offset, int nb_samples)
+{
+    AVRational sr;
+
+    if (src->sample_rate <= 0 || src->time_base.num <= 0 || src->time_base.den <= 0)
+        return;
+
+    sr = av_make_q(1, src->sample_rate);
+    if (src->pts != AV_NOPTS_VALUE)
+        frame->pts = src->pts + av_rescale_q(offset, sr, src->time_base);
+    frame->duration = av_rescale_q(nb_samples, sr, src->time_base);
+}
+
+static int view_is_aligned(const AVAudioFrameFifo *aff, const AVFrame *src)
+{
+    const size_t bytes = (size_t)aff->offset * aff->sample_size;
+
+    for (int p = 0; p < aff->nb_planes; p++) {
+        if ((uintptr_t)(src->extended_data[p] + bytes) & aff->align_mask)
+            return 0;
+    }
+
+    return 1;
+}
+
+static int read_view(AVAudioFrameFifo *aff, AVFrame *frame, AVFrame *src, int nb_samples)
+{
+    const size_t bytes = (size_t)aff->offset * aff->sample_size;
+    int ret;
+
+    ret = av_frame_ref(frame, src);
+    if (ret < 0)
+        return ret;
+
+    set_timing(frame, src, aff->offset, nb_samples);
+    frame->nb_samples  = nb_samples;
+    frame->linesize[0] -= bytes;
+    for (int p = 0; p < aff->nb_planes; p++)
+        frame->extended_data[p] += bytes;
+    for (int p = 0; p < aff->nb_planes && p < AV_NUM_DATA_POINTERS; p++)
+        frame->data[p] = frame->extended_data[p];
+
+    advance(aff, nb_samples);
+
+    return nb_samples;
+}
+
+int av_audio_frame_fifo_read(AVAudioFrameFifo *aff, AVFrame *frame, int nb_samples)
+{
+    AVFrame *src;
+    int ret;
+
+    if (nb_samples < 0)
+        return AVERROR(EINVAL);
+
+    nb_samples = FFMIN(nb_samples, av_audio_frame_fifo_size(aff));
+    if (!nb_samples)
+        return 0;
+
+    src = peek(aff);
+    if (src->nb_samples - aff->offset >= nb_samples && view_is_aligned(aff, src))
+        return read_view(aff, frame, src, nb_samples);
+
+    frame->format      = aff->sample_fmt;
+    frame->nb_samples  = nb_samples;
+    frame->sample_rate = src->sample_rate;
+    ret = av_channel_layout_copy(&frame->ch_layout, &src->ch_layout);
+    if (ret < 0)
+        goto fail;
+    ret = av_frame_get_buffer(frame, 0);
+    if (ret < 0)
+        goto fail;
+    ret = av_frame_copy_props(frame, src);
+    if (ret < 0)
+        goto fail;
+    set_timing(frame, src, aff->offset, nb_samples);
+
+    for (int pos = 0; pos < nb_samples;) {
+        const int n = FFMIN(peek(aff)->nb_samples - aff->offset, nb_samples - pos);
+
+        av_samples_copy(frame->extended_data, peek(aff)->extended_data, pos,
+                        aff->offset, n, aff->channels, aff->sample_fmt);
+        advance(aff, n);
+        pos += n;
+    }
+
+    return nb_samples;
+fail:
+    av_frame_unref(frame);
+    return ret;
+}
+
+int av_audio_frame_fifo_drain(AVAudioFrameFifo *aff, int nb_samples)
+{
+    nb_samples = av_clip(nb_samples, 0, av_audio_frame_fifo_size(aff));
+
+    for (int pos = 0; pos < nb_samples;) {
+        const int n = FFMIN(peek(aff)->nb_samples - aff->offset, nb_samples - pos);
+
+        advance(aff, n);
+        pos += n;
+    }
+
+    return nb_samples;
+}
+
+int av_audio_frame_fifo_size(const AVAudioFrameFifo *aff)
+{
+    return atomic_load_explicit((atomic_int *)&aff->nb_samples, memory_order_acquire);
+}
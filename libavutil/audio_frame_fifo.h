@@ -0,0 +1,128 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Audio frame FIFO
+ */
+
+#ifndef AVUTIL_AUDIO_FRAME_FIFO_H
+#define AVUTIL_AUDIO_FRAME_FIFO_H
+
+#include "frame.h"
+#include "samplefmt.h"
+
+/**
+ * @addtogroup lavu_audio
+ * @{
+ * @defgroup lavu_audioframefifo Audio Frame FIFO
+ * @{
+ */
+
+/**
+ * FIFO of reference-counted audio frames.
+ *
+ * Unlike AVAudioFifo, samples are not copied on write: the FIFO keeps a
+ * reference to every frame written to it. On read, the output frame
+ * references the queued buffers directly whenever the requested samples
+ * lie within a single queued frame and the resulting data pointers satisfy
+ * the alignment requested at allocation. Samples are only copied when a
+ * read spans frame boundaries or would break the alignment.
+ */
+typedef struct AVAudioFrameFifo AVAudioFrameFifo;
+
+/**
+ * Make the FIFO safe for exactly one writing thread and one reading thread
+ * operating concurrently, without locking. The FIFO then has a fixed
+ * capacity in frames and av_audio_frame_fifo_write() returns
+ * AVERROR(EAGAIN) when it is full.
+ */
+#define AV_AUDIO_FRAME_FIFO_FLAG_SPSC (1 << 0)
+
+/**
+ * Allocate an AVAudioFrameFifo.
+ *
+ * @param sample_fmt  sample format of the frames
+ * @param channels    number of channels of the frames
+ * @param nb_frames   initial capacity in frames, or the fixed capacity when
+ *                    AV_AUDIO_FRAME_FIFO_FLAG_SPSC is set
+ * @param align       required alignment in bytes of the data pointers of
+ *                    frames returned without copying, must be a power of 2;
+ *                    0 or 1 allows any sample-aligned pointer
+ * @param flags       a combination of AV_AUDIO_FRAME_FIFO_FLAG_*
+ * @return            newly allocated AVAudioFrameFifo, or NULL on error
+ */
+AVAudioFrameFifo *av_audio_frame_fifo_alloc(enum AVSampleFormat sample_fmt,
+                                            int channels, int nb_frames,
+                                            int align, unsigned flags);
+
+/**
+ * Free an AVAudioFrameFifo and all queued frames, and set the pointer to NULL.
+ */
+void av_audio_frame_fifo_freep(AVAudioFrameFifo **aff);
+
+/**
+ * Queue a new reference to the given frame. The caller keeps its own
+ * reference.
+ *
+ * Frames must match the sample format and channel count the FIFO was
+ * allocated with; all other properties of the first frame queued are
+ * used for the frames returned by av_audio_frame_fifo_read().
+ *
+ * @return 0 on success, AVERROR(EAGAIN) if an SPSC FIFO is full, or
+ *         another negative AVERROR code on failure
+ */
+int av_audio_frame_fifo_write(AVAudioFrameFifo *aff, const AVFrame *frame);
+
+/**
+ * Read up to nb_samples samples into frame.
+ *
+ * The frame must be clean (freshly allocated or unreferenced). It may
+ * reference the buffers of a queued frame, in which case it is not writable.
+ * If the source frame has a valid pts, sample_rate and time_base, pts and
+ * duration of the returned frame are adjusted to the samples it contains.
+ *
+ * @return number of samples read, 0 if the FIFO is empty, or a negative
+ *         AVERROR code on failure
+ */
+int av_audio_frame_fifo_read(AVAudioFrameFifo *aff, AVFrame *frame, int nb_samples);
+
+/**
+ * Discard up to nb_samples samples.
+ *
+ * @return number of samples discarded
+ */
+int av_audio_frame_fifo_drain(AVAudioFrameFifo *aff, int nb_samples);
+
+/**
+ * Discard all queued frames. Must not be called concurrently with any other
+ * function on the same FIFO.
+ */
+void av_audio_frame_fifo_reset(AVAudioFrameFifo *aff);
+
+/**
+ * @return the number of samples available for reading
+ */
+int av_audio_frame_fifo_size(const AVAudioFrameFifo *aff);
+
+/**
+ * @}
+ * @}
+ */
+
+#endif /* AVUTIL_AUDIO_FRAME_FIFO_H */
@@ -274,6 +274,7 @@ AVBufferPool *av_buffer_pool_init2(size_t size, void *opaque,
     pool->alloc2    = alloc;
     pool->alloc     = av_buffer_alloc; // fallback
     pool->pool_free = pool_free;
+    pool->max_free  = SIZE_MAX;
 
     atomic_init(&pool->refcount, 1);
 
@@ -293,6 +294,7 @@ AVBufferPool *av_buffer_pool_init(size_t size, AVBufferRef* (*alloc)(size_t size
 
     pool->size     = size;
     pool->alloc    = alloc ? alloc : av_buffer_alloc;
+    pool->max_free = SIZE_MAX;
 
     atomic_init(&pool->refcount, 1);
 
@@ -308,6 +310,7 @@ static void buffer_pool_flush(AVBufferPool *pool)
         buf->free(buf->opaque, buf->data);
         av_freep(&buf);
     }
+    pool->nb_free = 0;
 }
 
 /*
@@ -348,10 +351,20 @@ static void pool_release_buffer(void *opaque, uint8_t *data)
     AVBufferPool *pool = buf->pool;
 
     ff_mutex_lock(&pool->mutex);
-    buf->next = pool->pool;
-    pool->pool = buf;
+    if (pool->nb_free < pool->max_free) {
+        buf->next = pool->pool;
+        pool->pool = buf;
+        pool->nb_free++;
+        buf = NULL;
+    }
     ff_mutex_unlock(&pool->mutex);
 
+    /* the AVBuffer embedded in buf is no longer accessed by the caller */
+    if (buf) {
+        buf->free(buf->opaque, buf->data);
+        av_free(buf);
+    }
+
     if (atomic_fetch_sub_explicit(&pool->refcount, 1, memory_order_acq_rel) == 1)
         buffer_pool_free(pool);
 }
@@ -400,11 +413,14 @@ AVBufferRef *av_buffer_pool_get(AVBufferPool *pool)
                             pool_release_buffer, buf, 0);
         if (ret) {
             pool->pool = buf->next;
+            pool->nb_free--;
+            pool->nb_hits++;
             buf->next = NULL;
             buf->buffer.flags_internal |= BUFFER_FLAG_NO_FREE;
         }
     } else {
         ret = pool_alloc_buffer(pool);
+        pool->nb_misses++;
     }
     ff_mutex_unlock(&pool->mutex);
 
@@ -414,6 +430,39 @@ AVBufferRef *av_buffer_pool_get(AVBufferPool *pool)
     return ret;
 }
 
+void av_buffer_pool_set_max_free(AVBufferPool *pool, size_t max_free)
+{
+    BufferPoolEntry *to_free = NULL;
+
+    ff_mutex_lock(&pool->mutex);
+    pool->max_free = max_free;
+    while (pool->nb_free > max_free) {
+        BufferPoolEntry *buf = pool->pool;
+        pool->pool = buf->next;
+        pool->nb_free--;
+        buf->next = to_free;
+        to_free   = buf;
+    }
+    ff_mutex_unlock(&pool->mutex);
+
+    while (to_free) {
+        BufferPoolEntry *buf = to_free;
+        to_free = buf->next;
+        buf->free(buf->opaque, buf->data);
+        av_free(buf);
+    }
+}
+
+void av_buffer_pool_get_stats(AVBufferPool *pool, AVBufferPoolStats *stats)
+{
+    ff_mutex_lock(&pool->mutex);
+    stats->nb_hits    = pool->nb_hits;
+    stats->nb_misses  = pool->nb_misses;
+    stats->nb_free    = pool->nb_free;
+    stats->bytes_held = pool->nb_free * pool->size;
+    ff_mutex_unlock(&pool->mutex);
+}
+
 void *av_buffer_pool_buffer_get_opaque(const AVBufferRef *ref)
 {
     BufferPoolEntry *buf = ref->buffer->opaque;
@@ -302,6 +302,52 @@ void av_buffer_pool_uninit(AVBufferPool **pool);
  */
 AVBufferRef *av_buffer_pool_get(AVBufferPool *pool);
 
+/**
+ * Limit the number of unused buffers kept by the pool. Buffers returned to
+ * the pool while it already holds max_free unused buffers are freed instead,
+ * as are the unused buffers above the new limit. By default the number of
+ * unused buffers is not limited.
+ * This function may be called simultaneously from multiple threads.
+ *
+ * @param pool     the pool to limit
+ * @param max_free maximum number of unused buffers to keep
+ */
+void av_buffer_pool_set_max_free(AVBufferPool *pool, size_t max_free);
+
+/**
+ * Usage statistics of a buffer pool.
+ */
+typedef struct AVBufferPoolStats {
+    /**
+     * Number of av_buffer_pool_get() calls served by reusing a buffer.
+     */
+    uint64_t nb_hits;
+
+    /**
+     * Number of av_buffer_pool_get() calls that allocated a new buffer.
+     */
+    uint64_t nb_misses;
+
+    /**
+     * Number of unused buffers currently held by the pool.
+     */
+    size_t nb_free;
+
+    /**
+     * Total size in bytes of the unused buffers currently held by the pool.
+     */
+    size_t bytes_held;
+} AVBufferPoolStats;
+
+/**
+ * Get the usage statistics of a buffer pool.
+ * This function may be called simultaneously from multiple threads.
+ *
+ * @param pool  the pool to query
+ * @param stats filled with the current statistics
+ */
+void av_buffer_pool_get_stats(AVBufferPool *pool, AVBufferPoolStats *stats);
+
 /**
  * Query the original opaque parameter of an allocated buffer in the pool.
  *
@@ -102,6 +102,15 @@ struct AVBufferPool {
 
     size_t size;
     void *opaque;
+
+    /* statistics, protected by mutex */
+    uint64_t nb_hits;
+    uint64_t nb_misses;
+    size_t   nb_free;
+
+    /* number of unused buffers kept at most, protected by mutex */
+    size_t   max_free;
+
     AVBufferRef* (*alloc)(size_t size);
     AVBufferRef* (*alloc2)(void *opaque, size_t size);
     void         (*pool_free)(void *opaque);
@@ -19,6 +19,7 @@
  */
 
 #include <inttypes.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -31,11 +32,110 @@
 #include "time_internal.h"
 #include "bprint.h"
 
+/* Dictionaries with at least this many entries get a hash index */
+#define INDEX_THRESHOLD 32
+
 struct AVDictionary {
     int count;
     AVDictionaryEntry *elems;
+    /* open addressing hash table of the case folded keys, used for
+     * lookups of whole keys; a slot holds an elems index + 1, 0 if empty */
+    unsigned *index;
+    unsigned index_mask;
+    /* number of owners besides the first one, av_dict_copy() into an
+     * empty dictionary shares the source instead of duplicating it and
+     * a shared dictionary is duplicated before being modified */
+    atomic_uint refs;
+    /* set once AV_DICT_MULTIKEY was used, such a dictionary is never
+     * shared as copying it entry by entry would merge duplicate keys */
+    int multikey;
 };
 
+static unsigned key_hash(const char *key)
+{
+    unsigned h = 2166136261U;
+
+    while (*key)
+        h = (h ^ av_toupper(*key++)) * 16777619U;
+    return h;
+}
+
+static unsigned *index_slot(const AVDictionary *m, int idx)
+{
+    unsigned i = key_hash(m->elems[idx].key) & m->index_mask;
+
+    while (m->index[i] != idx + 1)
+        i = (i + 1) & m->index_mask;
+    return &m->index[i];
+}
+
+static void index_insert(AVDictionary *m, int idx)
+{
+    unsigned i = key_hash(m->elems[idx].key) & m->index_mask;
+
+    while (m->index[i])
+        i = (i + 1) & m->index_mask;
+    m->index[i] = idx + 1;
+}
+
+static void index_remove(AVDictionary *m, int idx)
+{
+    unsigned i = index_slot(m, idx) - m->index, j = i;
+
+    /* move later entries of the probe sequence into the hole unless
+     * their home slot lies cyclically in (i, j] */
+    while (m->index[j = (j + 1) & m->index_mask]) {
+        unsigned k = key_hash(m->elems[m->index[j] - 1].key) & m->index_mask;
+        if (i <= j ? i < k && k <= j : i < k || k <= j)
+            continue;
+        m->index[i] = m->index[j];
+        i = j;
+    }
+    m->index[i] = 0;
+}
+
+/* Add the last entry to the index, (re)building it if needed. */
+static void index_add(AVDictionary *m)
+{
+    unsigned size = 2 * INDEX_THRESHOLD;
+
+    if (m->index && 2 * m->count <= m->index_mask + 1) {
+        index_insert(m, m->count - 1);
+        return;
+    }
+    if (m->count < INDEX_THRESHOLD)
+        return;
+
+    while (size < 4 * m->count)
+        size <<= 1;
+    av_freep(&m->index);
+    /* without an index lookups just fall back to a linear search */
+    m->index = av_calloc(size, sizeof(*m->index));
+    if (!m->index)
+        return;
+    m->index_mask = size - 1;
+    for (int i = 0; i < m->count; i++)
+        index_insert(m, i);
+}
+
+static AVDictionaryEntry *index_get(const AVDictionary *m, const char *key,
+                                    int flags)
+{
+    unsigned i = key_hash(key) & m->index_mask;
+    int match = m->count;
+
+    /* with AV_DICT_MULTIKEY a key can be present more than once, return
+     * the first one in iteration order like the linear search would */
+    for (; m->index[i]; i = (i + 1) & m->index_mask) {
+        int idx = m->index[i] - 1;
+        const char *s = m->elems[idx].key;
+        if (idx < match &&
+            !(flags & AV_DICT_MATCH_CASE ? strcmp(s, key) : av_strcasecmp(s, key)))
+            match = idx;
+    }
+    return match < m->count ? &m->elems[match] : NULL;
+}
+
 int av_dict_count(const AVDictionary *m)
 {
     return m ? m->count : 0;
@@ -59,6 +159,57 @@ const AVDictionaryEntry *av_dict_iterate(const AVDictionary *m,
     return &m->elems[i];
 }
 
+static void dict_free(AVDictionary *m)
+{
+    while (m->count--) {
+        av_freep(&m->elems[m->count].key);
+        av_freep(&m->elems[m->count].value);
+    }
+    av_freep(&m->elems);
+    av_freep(&m->index);
+    av_free(m);
+}
+
+/* Give *pm a private copy of a shared dictionary. */
+static int dict_make_writable(AVDictionary **pm)
+{
+    const AVDictionary *m = *pm;
+    AVDictionary *copy;
+
+    if (!m || !atomic_load_explicit(&m->refs, memory_order_acquire))
+        return 0;
+
+    copy = av_mallocz(sizeof(*copy));
+    if (!copy)
+        return AVERROR(ENOMEM);
+    copy->elems = av_malloc_array(m->count, sizeof(*copy->elems));
+    if (!copy->elems)
+        goto fail;
+    for (; copy->count < m->count; copy->count++) {
+        AVDictionaryEntry *e = &copy->elems[copy->count];
+        e->key   = av_strdup(m->elems[copy->count].key);
+        e->value = av_strdup(m->elems[copy->count].value);
+        if (!e->key || !e->value) {
+            av_free(e->key);
+            av_free(e->value);
+            goto fail;
+        }
+    }
+    if (m->index) {
+        /* without an index lookups just fall back to a linear search */
+        copy->index = av_memdup(m->index, (m->index_mask + 1) * sizeof(*m->index));
+        copy->index_mask = m->index_mask;
+    }
+    copy->multikey = m->multikey;
+
+    av_dict_free(pm);
+    *pm = copy;
+    return 0;
+fail:
+    dict_free(copy);
+    return AVERROR(ENOMEM);
+}
+
 AVDictionaryEntry *av_dict_get(const AVDictionary *m, const char *key,
                                const AVDictionaryEntry *prev, int flags)
 {
@@ -68,6 +219,9 @@ AVDictionaryEntry *av_dict_get(const AVDictionary *m, const char *key,
     if (!key)
         return NULL;
 
+    if (m && m->index && !prev && !(flags & AV_DICT_IGNORE_SUFFIX))
+        return index_get(m, key, flags);
+
     while ((entry = av_dict_iterate(m, entry))) {
         const char *s = entry->key;
         if (flags & AV_DICT_MATCH_CASE)
@@ -101,17 +255,28 @@ int av_dict_set(AVDictionary **pm, const char *key, const char *value,
         err = AVERROR(EINVAL);
         goto err_out;
     }
-    if (!(flags & AV_DICT_MULTIKEY)) {
-        tag = av_dict_get(m, key, NULL, flags);
-    }
     if (flags & AV_DICT_DONT_STRDUP_KEY)
         copy_key = (void *)key;
     else
         copy_key = av_strdup(key);
+    if (!(flags & AV_DICT_MULTIKEY)) {
+        tag = av_dict_get(m, key, NULL, flags);
+    }
+    /* a shared dictionary is only copied if this call changes it */
+    if (m && (tag ? !(flags & AV_DICT_DONT_OVERWRITE) : !!copy_value)) {
+        int idx = tag ? tag - m->elems : 0;
+        if (dict_make_writable(pm) < 0)
+            goto enomem;
+        m = *pm;
+        if (tag)
+            tag = &m->elems[idx];
+    }
     if (!m)
         m = *pm = av_mallocz(sizeof(*m));
     if (!m || !copy_key || (value && !copy_value))
         goto enomem;
+    if (flags & AV_DICT_MULTIKEY)
+        m->multikey = 1;
 
     if (tag) {
         if (flags & AV_DICT_DONT_OVERWRITE) {
@@ -131,6 +296,12 @@ int av_dict_set(AVDictionary **pm, const char *key, const char *value,
             copy_value = newval;
         } else
             av_free(tag->value);
+        if (m->index) {
+            int idx = tag - m->elems;
+            index_remove(m, idx);
+            if (idx != m->count - 1)
+                *index_slot(m, m->count - 1) = idx + 1;
+        }
         av_free(tag->key);
         *tag = m->elems[--m->count];
     } else if (copy_value) {
@@ -144,6 +315,7 @@ int av_dict_set(AVDictionary **pm, const char *key, const char *value,
         m->elems[m->count].key = copy_key;
         m->elems[m->count].value = copy_value;
         m->count++;
+        index_add(m);
     } else {
         err = 0;
         goto end;
@@ -158,6 +330,7 @@ err_out:
 end:
     if (m && !m->count) {
         av_freep(&m->elems);
+        av_freep(&m->index);
         av_freep(pm);
     }
     av_free(copy_key);
@@ -224,20 +397,21 @@ void av_dict_free(AVDictionary **pm)
 {
     AVDictionary *m = *pm;
 
-    if (m) {
-        while (m->count--) {
-            av_freep(&m->elems[m->count].key);
-            av_freep(&m->elems[m->count].value);
-        }
-        av_freep(&m->elems);
-    }
-    av_freep(pm);
+    if (m && !atomic_fetch_sub_explicit(&m->refs, 1, memory_order_acq_rel))
+        dict_free(m);
+    *pm = NULL;
 }
 
 int av_dict_copy(AVDictionary **dst, const AVDictionary *src, int flags)
 {
     const AVDictionaryEntry *t = NULL;
 
+    if (!*dst && src && !flags && !src->multikey) {
+        atomic_fetch_add_explicit(&((AVDictionary *)src)->refs, 1, memory_order_relaxed);
+        *dst = (AVDictionary *)src;
+        return 0;
+    }
+
     while ((t = av_dict_iterate(src, t))) {
         int ret = av_dict_set(dst, t->key, t->value, flags);
         if (ret < 0)
@@ -198,6 +198,10 @@ int av_dict_parse_string(AVDictionary **pm, const char *str,
  *
  * @note Metadata is read using the ::AV_DICT_IGNORE_SUFFIX flag
  *
+ * @note When *dst is NULL and flags is 0, the entries may be shared with src
+ *       instead of being duplicated; either dictionary then gets its own copy
+ *       the first time it is modified. This is invisible to the caller.
+ *
  * @param dst   Pointer to a pointer to a AVDictionary struct to copy into. If *dst is NULL,
  *              this function will allocate a struct for you and put it in *dst
  * @param src   Pointer to the source AVDictionary struct to copy items from.
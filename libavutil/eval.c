@@ -32,6 +32,7 @@
 #include "common.h"
 #include "eval.h"
 #include "ffmath.h"
+#include "intfloat.h"
 #include "log.h"
 #include "mathematics.h"
 #include "mem.h"
@@ -154,6 +155,46 @@ static int strmatch(const char *s, const char *prefix)
     return !IS_IDENTIFIER_CHAR(s[i]);
 }
 
+/**
+ * Opcodes of the compiled form of an expression. Unless noted otherwise
+ * each one computes the AVExpr type of the same name.
+ */
+enum ExprOp {
+    OP_CONST, OP_FUNC0, OP_FUNC1, OP_FUNC2,
+    OP_SQUISH, OP_GAUSS, OP_LD, OP_ISNAN, OP_ISINF,
+    OP_MOD, OP_MAX, OP_MIN, OP_EQ, OP_GT, OP_GTE, OP_LTE, OP_LT,
+    OP_POW, OP_MUL, OP_DIV, OP_ADD,
+    OP_ST, OP_FLOOR, OP_CEIL, OP_TRUNC, OP_ROUND,
+    OP_SQRT, OP_NOT, OP_HYPOT, OP_GCD,
+    OP_BITAND, OP_BITOR, OP_BETWEEN, OP_CLIP, OP_ATAN2, OP_LERP, OP_SGN,
+    OP_MOV,     ///< dst = value * src[0]
+    OP_JZ,      ///< jump to a.index if src[0] is 0
+    OP_JNZ,     ///< jump to a.index if src[0] is not 0
+    OP_JMP,     ///< jump to a.index
+    OP_TREE,    ///< evaluate the node a.tree with eval_expr()
+};
+
+/**
+ * Instruction of a compiled expression. Every register is written by a
+ * single instruction except the result of a conditional, the first
+ * nb_consts registers hold the folded constants.
+ */
+typedef struct ExprInsn {
+    uint8_t op;
+    uint16_t dst;
+    uint16_t src[3];
+    double value;
+    union {
+        double (*func0)(double);
+        double (*func1)(void *, double);
+        double (*func2)(void *, double, double);
+        AVExpr *tree;
+        int index;
+    } a;
+} ExprInsn;
+
+#define MAX_REGS 256
+
 struct AVExpr {
     enum {
         e_value, e_const, e_func0, e_func1, e_func2,
@@ -175,6 +216,11 @@ struct AVExpr {
     struct AVExpr *param[3];
     double *var;
     FFSFC64 *prng_state;
+    int flags;
+    unsigned hash;
+    ExprInsn *code;
+    double *consts;
+    int nb_code, nb_consts, result;
 };
 
 static double etime(double v)
@@ -189,7 +235,10 @@ static double eval_expr(Parser *p, AVExpr *e)
         case e_const:  return e->value * p->const_values[e->const_index];
         case e_func0:  return e->value * e->a.func0(eval_expr(p, e->param[0]));
         case e_func1:  return e->value * e->a.func1(p->opaque, eval_expr(p, e->param[0]));
-        case e_func2:  return e->value * e->a.func2(p->opaque, eval_expr(p, e->param[0]), eval_expr(p, e->param[1]));
+        case e_func2: {
+            double d = eval_expr(p, e->param[0]);
+            return e->value * e->a.func2(p->opaque, d, eval_expr(p, e->param[1]));
+        }
         case e_squish: return 1/(1+exp(4*eval_expr(p, e->param[0])));
         case e_gauss: { double d = eval_expr(p, e->param[0]); return exp(-d*d/2)/sqrt(2*M_PI); }
         case e_ld:     return e->value * p->var[av_clip(eval_expr(p, e->param[0]), 0, VARS-1)];
@@ -199,7 +248,7 @@ static double eval_expr(Parser *p, AVExpr *e)
         case e_ceil :  return e->value * ceil (eval_expr(p, e->param[0]));
         case e_trunc:  return e->value * trunc(eval_expr(p, e->param[0]));
         case e_round:  return e->value * round(eval_expr(p, e->param[0]));
-        case e_sgn:    return e->value * FFDIFFSIGN(eval_expr(p, e->param[0]), 0);
+        case e_sgn: { double d = eval_expr(p, e->param[0]); return e->value * FFDIFFSIGN(d, 0); }
         case e_sqrt:   return e->value * sqrt (eval_expr(p, e->param[0]));
         case e_not:    return e->value * (eval_expr(p, e->param[0]) == 0);
         case e_if:     return e->value * (eval_expr(p, e->param[0]) ? eval_expr(p, e->param[1]) :
@@ -211,7 +260,7 @@ static double eval_expr(Parser *p, AVExpr *e)
             double min = eval_expr(p, e->param[1]), max = eval_expr(p, e->param[2]);
             if (isnan(min) || isnan(max) || isnan(x) || min > max)
                 return NAN;
-            return e->value * av_clipd(eval_expr(p, e->param[0]), min, max);
+            return e->value * av_clipd(x, min, max);
         }
         case e_between: {
             double d = eval_expr(p, e->param[0]);
@@ -362,6 +411,8 @@ void av_expr_free(AVExpr *e)
     av_expr_free(e->param[2]);
     av_freep(&e->var);
     av_freep(&e->prng_state);
+    av_freep(&e->code);
+    av_freep(&e->consts);
     av_freep(&e);
 }
 
@@ -706,6 +757,354 @@ static int verify_expr(AVExpr *e)
     }
 }
 
+#define EXPR_SIDE_EFFECTS 1 ///< evaluating the node may change state
+#define EXPR_VARYING      2 ///< the node is not a constant
+#define EXPR_NO_CSE       4 ///< two evaluations of the node may differ
+
+static void expr_analyze(AVExpr *e)
+{
+    unsigned hash = e->type * 0x9E3779B1U;
+    int flags = 0;
+    uint64_t v = av_double2int(e->value);
+
+    for (int i = 0; i < 3 && e->param[i]; i++) {
+        expr_analyze(e->param[i]);
+        flags |= e->param[i]->flags;
+        hash = hash * 31 + e->param[i]->hash;
+    }
+
+    switch (e->type) {
+    case e_func1:
+    case e_func2:
+    case e_st:
+    case e_random:
+    case e_randomi:
+    case e_print:
+    case e_while:
+        flags |= EXPR_SIDE_EFFECTS | EXPR_VARYING | EXPR_NO_CSE;
+        break;
+    case e_ld:
+    case e_taylor:
+    case e_root:
+        flags |= EXPR_VARYING | EXPR_NO_CSE;
+        break;
+    case e_const:
+        flags |= EXPR_VARYING;
+        break;
+    case e_func0:
+        if (e->a.func0 == etime)
+            flags |= EXPR_VARYING | EXPR_NO_CSE;
+        break;
+    }
+
+    e->flags = flags;
+    e->hash  = hash * 31 + (unsigned)(v ^ v >> 32) + e->const_index;
+}
+
+static int expr_equal(const AVExpr *a, const AVExpr *b)
+{
+    if (a == b)
+        return 1;
+    if (!a || !b || a->hash != b->hash || a->type != b->type ||
+        a->value != b->value || a->const_index != b->const_index ||
+        a->a.func0 != b->a.func0)
+        return 0;
+    return expr_equal(a->param[0], b->param[0]) &&
+           expr_equal(a->param[1], b->param[1]) &&
+           expr_equal(a->param[2], b->param[2]);
+}
+
+typedef struct ExprCompiler {
+    ExprInsn *code;
+    int nb_code;
+    unsigned code_size;
+    int nb_regs;
+    uint8_t is_const[MAX_REGS];
+    double consts[MAX_REGS];
+    struct {
+        const AVExpr *e;
+        int reg;
+    } cse[MAX_REGS];
+    int nb_cse;
+} ExprCompiler;
+
+static int new_reg(ExprCompiler *c)
+{
+    if (c->nb_regs >= MAX_REGS)
+        return AVERROR(ENOSPC);
+    return c->nb_regs++;
+}
+
+static int add_const(ExprCompiler *c, double d)
+{
+    int reg;
+
+    for (reg = 0; reg < c->nb_regs; reg++)
+        if (c->is_const[reg] && av_double2int(c->consts[reg]) == av_double2int(d))
+            return reg;
+
+    if ((reg = new_reg(c)) < 0)
+        return reg;
+    c->is_const[reg] = 1;
+    c->consts[reg]   = d;
+    return reg;
+}
+
+static int emit(ExprCompiler *c, enum ExprOp op, double value, int dst,
+                int src0, int src1, int src2)
+{
+    ExprInsn *in;
+
+    in = av_fast_realloc(c->code, &c->code_size, (c->nb_code + 1) * sizeof(*c->code));
+    if (!in)
+        return AVERROR(ENOMEM);
+    c->code = in;
+    in += c->nb_code;
+    memset(in, 0, sizeof(*in));
+    in->op     = op;
+    in->value  = value;
+    in->dst    = dst;
+    in->src[0] = src0;
+    in->src[1] = src1;
+    in->src[2] = src2;
+    return c->nb_code++;
+}
+
+static int compile_expr(ExprCompiler *c, AVExpr *e);
+
+/* emit the code computing e and return the register holding the result */
+static int compile_node(ExprCompiler *c, AVExpr *e)
+{
+    enum ExprOp op;
+    int r[3] = { 0 }, dst, ret;
+
+    switch (e->type) {
+    case e_value:
+        return add_const(c, e->value);
+    case e_const:
+        if ((dst = new_reg(c)) < 0)
+            return dst;
+        if ((ret = emit(c, OP_CONST, e->value, dst, 0, 0, 0)) < 0)
+            return ret;
+        c->code[ret].a.index = e->const_index;
+        return dst;
+    case e_last:
+        if (e->param[0]->flags & EXPR_SIDE_EFFECTS &&
+            (ret = compile_expr(c, e->param[0])) < 0)
+            return ret;
+        if ((r[0] = compile_expr(c, e->param[1])) < 0 || e->value == 1)
+            return r[0];
+        if ((dst = new_reg(c)) < 0)
+            return dst;
+        if ((ret = emit(c, OP_MOV, e->value, dst, r[0], 0, 0)) < 0)
+            return ret;
+        return dst;
+    case e_if:
+    case e_ifnot: {
+        int jz, jmp, nb_cse;
+
+        if (!(e->param[0]->flags & EXPR_VARYING)) {
+            Parser p = { 0 };
+            int cond = !!eval_expr(&p, e->param[0]) == (e->type == e_if);
+            AVExpr *branch = cond ? e->param[1] : e->param[2];
+
+            r[0] = branch ? compile_expr(c, branch) : add_const(c, 0);
+            if (r[0] < 0 || e->value == 1)
+                return r[0];
+            if ((dst = new_reg(c)) < 0)
+                return dst;
+            if ((ret = emit(c, OP_MOV, e->value, dst, r[0], 0, 0)) < 0)
+                return ret;
+            return dst;
+        }
+
+        if ((r[0] = compile_expr(c, e->param[0])) < 0)
+            return r[0];
+        if ((dst = new_reg(c)) < 0)
+            return dst;
+        if ((jz = emit(c, e->type == e_if ? OP_JZ : OP_JNZ, 1, 0, r[0], 0, 0)) < 0)
+            return jz;
+
+        nb_cse = c->nb_cse;
+        if ((r[1] = compile_expr(c, e->param[1])) < 0)
+            return r[1];
+        if ((ret = emit(c, OP_MOV, e->value, dst, r[1], 0, 0)) < 0)
+            return ret;
+        if ((jmp = emit(c, OP_JMP, 1, 0, 0, 0, 0)) < 0)
+            return jmp;
+        c->nb_cse = nb_cse;
+
+        c->code[jz].a.index = c->nb_code;
+        r[2] = e->param[2] ? compile_expr(c, e->param[2]) : add_const(c, 0);
+        if (r[2] < 0)
+            return r[2];
+        if ((ret = emit(c, OP_MOV, e->value, dst, r[2], 0, 0)) < 0)
+            return ret;
+        c->nb_cse = nb_cse;
+
+        c->code[jmp].a.index = c->nb_code;
+        return dst;
+    }
+    case e_between:
+        /* the upper bound is only evaluated if the lower one holds */
+        if (!(e->param[2]->flags & EXPR_SIDE_EFFECTS))
+            break;
+        /* fall through */
+    case e_random:
+    case e_randomi:
+    case e_print:
+    case e_while:
+    case e_taylor:
+    case e_root:
+        if ((dst = new_reg(c)) < 0)
+            return dst;
+        if ((ret = emit(c, OP_TREE, 1, dst, 0, 0, 0)) < 0)
+            return ret;
+        c->code[ret].a.tree = e;
+        return dst;
+    }
+
+    switch (e->type) {
+    case e_func0:   op = OP_FUNC0;   break;
+    case e_func1:   op = OP_FUNC1;   break;
+    case e_func2:   op = OP_FUNC2;   break;
+    case e_squish:  op = OP_SQUISH;  break;
+    case e_gauss:   op = OP_GAUSS;   break;
+    case e_ld:      op = OP_LD;      break;
+    case e_isnan:   op = OP_ISNAN;   break;
+    case e_isinf:   op = OP_ISINF;   break;
+    case e_mod:     op = OP_MOD;     break;
+    case e_max:     op = OP_MAX;     break;
+    case e_min:     op = OP_MIN;     break;
+    case e_eq:      op = OP_EQ;      break;
+    case e_gt:      op = OP_GT;      break;
+    case e_gte:     op = OP_GTE;     break;
+    case e_lte:     op = OP_LTE;     break;
+    case e_lt:      op = OP_LT;      break;
+    case e_pow:     op = OP_POW;     break;
+    case e_mul:     op = OP_MUL;     break;
+    case e_div:     op = OP_DIV;     break;
+    case e_add:     op = OP_ADD;     break;
+    case e_st:      op = OP_ST;      break;
+    case e_floor:   op = OP_FLOOR;   break;
+    case e_ceil:    op = OP_CEIL;    break;
+    case e_trunc:   op = OP_TRUNC;   break;
+    case e_round:   op = OP_ROUND;   break;
+    case e_sqrt:    op = OP_SQRT;    break;
+    case e_not:     op = OP_NOT;     break;
+    case e_hypot:   op = OP_HYPOT;   break;
+    case e_gcd:     op = OP_GCD;     break;
+    case e_bitand:  op = OP_BITAND;  break;
+    case e_bitor:   op = OP_BITOR;   break;
+    case e_between: op = OP_BETWEEN; break;
+    case e_clip:    op = OP_CLIP;    break;
+    case e_atan2:   op = OP_ATAN2;   break;
+    case e_lerp:    op = OP_LERP;    break;
+    case e_sgn:     op = OP_SGN;     break;
+    default:
+        return AVERROR_BUG;
+    }
+
+    for (int i = 0; i < 3 && e->param[i]; i++)
+        if ((r[i] = compile_expr(c, e->param[i])) < 0)
+            return r[i];
+    if ((dst = new_reg(c)) < 0)
+        return dst;
+    if ((ret = emit(c, op, e->value, dst, r[0], r[1], r[2])) < 0)
+        return ret;
+    if (op == OP_FUNC0)
+        c->code[ret].a.func0 = e->a.func0;
+    else if (op == OP_FUNC1)
+        c->code[ret].a.func1 = e->a.func1;
+    else if (op == OP_FUNC2)
+        c->code[ret].a.func2 = e->a.func2;
+    return dst;
+}
+
+static int compile_expr(ExprCompiler *c, AVExpr *e)
+{
+    int reg;
+
+    if (!(e->flags & EXPR_VARYING)) {
+        Parser p = { 0 };
+        return add_const(c, eval_expr(&p, e));
+    }
+
+    if (!(e->flags & EXPR_NO_CSE)) {
+        for (int i = 0; i < c->nb_cse; i++)
+            if (expr_equal(c->cse[i].e, e))
+                return c->cse[i].reg;
+    }
+
+    if ((reg = compile_node(c, e)) < 0)
+        return reg;
+
+    if (!(e->flags & EXPR_NO_CSE) && c->nb_cse < MAX_REGS) {
+        c->cse[c->nb_cse].e   = e;
+        c->cse[c->nb_cse].reg = reg;
+        c->nb_cse++;
+    }
+    return reg;
+}
+
+/**
+ * Compile e into a flat sequence of instructions on registers, folding
+ * constant subexpressions, dropping unused ones without side effects and
+ * computing common subexpressions once. The result of each operation is
+ * identical to the one of eval_expr(). Expressions needing more than
+ * MAX_REGS registers are left to eval_expr().
+ */
+static int expr_compile(AVExpr *e)
+{
+    ExprCompiler *c = av_mallocz(sizeof(*c));
+    uint16_t map[MAX_REGS];
+    int ret, nb_consts = 0, nb_vars = 0;
+
+    if (!c)
+        return AVERROR(ENOMEM);
+
+    expr_analyze(e);
+    ret = compile_expr(c, e);
+    if (ret == AVERROR(ENOSPC)) {
+        ret = 0;
+        goto end;
+    }
+    if (ret < 0)
+        goto end;
+
+    /* move the constants in front of the other registers */
+    for (int i = 0; i < c->nb_regs; i++)
+        nb_consts += c->is_const[i];
+    for (int i = 0; i < c->nb_regs; i++)
+        map[i] = c->is_const[i] ? e->nb_consts++ : nb_consts + nb_vars++;
+
+    e->consts = av_malloc_array(FFMAX(nb_consts, 1), sizeof(*e->consts));
+    if (!e->consts) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    for (int i = 0; i < c->nb_regs; i++)
+        if (c->is_const[i])
+            e->consts[map[i]] = c->consts[i];
+    for (int i = 0; i < c->nb_code; i++) {
+        ExprInsn *in = &c->code[i];
+
+        in->dst = map[in->dst];
+        for (int j = 0; j < 3; j++)
+            in->src[j] = map[in->src[j]];
+    }
+
+    e->result  = map[ret];
+    e->nb_code = c->nb_code;
+    e->code    = c->code;
+    c->code    = NULL;
+    ret = 0;
+end:
+    av_freep(&c->code);
+    av_free(c);
+    return ret;
+}
+
 int av_expr_parse(AVExpr **expr, const char *s,
                   const char * const *const_names,
                   const char * const *func1_names, double (* const *funcs1)(void *, double),
@@ -754,6 +1153,8 @@ int av_expr_parse(AVExpr **expr, const char *s,
         ret = AVERROR(ENOMEM);
         goto end;
     }
+    if ((ret = expr_compile(e)) < 0)
+        goto end;
     *expr = e;
     e = NULL;
 end:
@@ -788,6 +1189,82 @@ int av_expr_count_func(AVExpr *e, unsigned *counter, int size, int arg)
     return expr_count(e, counter, size, ((int[]){e_const, e_func1, e_func2})[arg]);
 }
 
+static double eval_code(Parser *p, const AVExpr *e)
+{
+    const ExprInsn *const code = e->code;
+    const ExprInsn *in = code, *const end = code + e->nb_code;
+    double r[MAX_REGS];
+
+    memcpy(r, e->consts, e->nb_consts * sizeof(*r));
+
+#define A r[in->src[0]]
+#define B r[in->src[1]]
+#define C r[in->src[2]]
+#define D r[in->dst]
+    for (; in < end; in++) {
+        switch (in->op) {
+        case OP_CONST:  D = in->value * p->const_values[in->a.index]; break;
+        case OP_FUNC0:  D = in->value * in->a.func0(A); break;
+        case OP_FUNC1:  D = in->value * in->a.func1(p->opaque, A); break;
+        case OP_FUNC2:  D = in->value * in->a.func2(p->opaque, A, B); break;
+        case OP_SQUISH: D = 1/(1+exp(4*A)); break;
+        case OP_GAUSS:  D = exp(-A*A/2)/sqrt(2*M_PI); break;
+        case OP_LD:     D = in->value * p->var[av_clip(A, 0, VARS-1)]; break;
+        case OP_ISNAN:  D = in->value * !!isnan(A); break;
+        case OP_ISINF:  D = in->value * !!isinf(A); break;
+        case OP_FLOOR:  D = in->value * floor(A); break;
+        case OP_CEIL:   D = in->value * ceil (A); break;
+        case OP_TRUNC:  D = in->value * trunc(A); break;
+        case OP_ROUND:  D = in->value * round(A); break;
+        case OP_SGN:    D = in->value * FFDIFFSIGN(A, 0); break;
+        case OP_SQRT:   D = in->value * sqrt (A); break;
+        case OP_NOT:    D = in->value * (A == 0); break;
+        case OP_MOD:    D = in->value * (A - floor(B ? A / B : A * INFINITY) * B); break;
+        case OP_GCD:    D = in->value * av_gcd(A, B); break;
+        case OP_MAX:    D = in->value * (A >  B ?   A : B); break;
+        case OP_MIN:    D = in->value * (A <  B ?   A : B); break;
+        case OP_EQ:     D = in->value * (A == B ? 1.0 : 0.0); break;
+        case OP_GT:     D = in->value * (A >  B ? 1.0 : 0.0); break;
+        case OP_GTE:    D = in->value * (A >= B ? 1.0 : 0.0); break;
+        case OP_LT:     D = in->value * (A <  B ? 1.0 : 0.0); break;
+        case OP_LTE:    D = in->value * (A <= B ? 1.0 : 0.0); break;
+        case OP_POW:    D = in->value * pow(A, B); break;
+        case OP_MUL:    D = in->value * (A * B); break;
+        case OP_DIV:    D = in->value * (B ? (A / B) : A * INFINITY); break;
+        case OP_ADD:    D = in->value * (A + B); break;
+        case OP_ST: {
+            int index = av_clip(A, 0, VARS-1);
+            p->prng_state[index].counter = 0;
+            D = in->value * (p->var[index] = B);
+            break;
+        }
+        case OP_HYPOT:  D = in->value * hypot(A, B); break;
+        case OP_ATAN2:  D = in->value * atan2(A, B); break;
+        case OP_BITAND: D = isnan(A) || isnan(B) ? NAN : in->value * ((long int)A & (long int)B); break;
+        case OP_BITOR:  D = isnan(A) || isnan(B) ? NAN : in->value * ((long int)A | (long int)B); break;
+        case OP_BETWEEN:D = in->value * (A >= B && A <= C); break;
+        case OP_CLIP:
+            if (isnan(B) || isnan(C) || isnan(A) || B > C)
+                D = NAN;
+            else
+                D = in->value * av_clipd(A, B, C);
+            break;
+        case OP_LERP:   D = A + (B - A) * C; break;
+        case OP_MOV:    D = in->value * A; break;
+        case OP_JZ:     if (!A) in = code + in->a.index - 1; break;
+        case OP_JNZ:    if ( A) in = code + in->a.index - 1; break;
+        case OP_JMP:    in = code + in->a.index - 1; break;
+        case OP_TREE:   D = eval_expr(p, in->a.tree); break;
+        }
+    }
+#undef A
+#undef B
+#undef C
+#undef D
+
+    return r[e->result];
+}
+
 double av_expr_eval(AVExpr *e, const double *const_values, void *opaque)
 {
     Parser p = { 0 };
@@ -796,7 +1273,7 @@ double av_expr_eval(AVExpr *e, const double *const_values, void *opaque)
 
     p.const_values = const_values;
     p.opaque     = opaque;
-    return eval_expr(&p, e);
+    return e->consts ? eval_code(&p, e) : eval_expr(&p, e);
 }
 
 int av_expr_parse_and_eval(double *d, const char *s,
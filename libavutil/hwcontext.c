@@ -18,8 +18,11 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include "avassert.h"
 #include "buffer.h"
+#include "buffer_internal.h"
 #include "common.h"
 #include "hwcontext.h"
 #include "hwcontext_internal.h"
@@ -279,6 +282,9 @@ AVBufferRef *av_hwframe_ctx_alloc(AVBufferRef *device_ref_in)
     ctx->sw_format  = AV_PIX_FMT_NONE;
 
     ctxi->hw_type = hw_type;
+    atomic_init(&ctxi->nb_allocated, 0);
+    atomic_init(&ctxi->nb_failed, 0);
+    atomic_init(&ctxi->max_in_use, 0);
 
     return buf;
 
@@ -486,7 +492,7 @@ int av_hwframe_transfer_data(AVFrame *dst, const AVFrame *src, int flags)
     return 0;
 }
 
-int av_hwframe_get_buffer(AVBufferRef *hwframe_ref, AVFrame *frame, int flags)
+static int hwframe_get_buffer(AVBufferRef *hwframe_ref, AVFrame *frame, int flags)
 {
     FFHWFramesContext *ctxi = (FFHWFramesContext*)hwframe_ref->data;
     AVHWFramesContext *ctx  = &ctxi->p;
@@ -550,6 +556,66 @@ int av_hwframe_get_buffer(AVBufferRef *hwframe_ref, AVFrame *frame, int flags)
     return 0;
 }
 
+/* Number of frames allocated from the pool and not yet released. */
+static int pool_in_use(AVBufferPool *pool)
+{
+    return atomic_load_explicit(&pool->refcount, memory_order_relaxed) - 1;
+}
+
+int av_hwframe_get_buffer(AVBufferRef *hwframe_ref, AVFrame *frame, int flags)
+{
+    FFHWFramesContext *ctxi = (FFHWFramesContext*)hwframe_ref->data;
+    AVHWFramesContext *ctx  = &ctxi->p;
+    AVBufferPool *pool = ctxi->source_frames ? NULL : ctx->pool;
+    int ret;
+
+    if (pool && ctx->max_pool_size > 0 &&
+        pool_in_use(pool) >= ctx->max_pool_size) {
+        atomic_fetch_add_explicit(&ctxi->nb_failed, 1, memory_order_relaxed);
+        return AVERROR(EAGAIN);
+    }
+
+    ret = hwframe_get_buffer(hwframe_ref, frame, flags);
+    if (ret < 0) {
+        atomic_fetch_add_explicit(&ctxi->nb_failed, 1, memory_order_relaxed);
+        return ret;
+    }
+    atomic_fetch_add_explicit(&ctxi->nb_allocated, 1, memory_order_relaxed);
+
+    if (pool) {
+        int in_use = pool_in_use(pool);
+        int max    = atomic_load_explicit(&ctxi->max_in_use, memory_order_relaxed);
+        while (in_use > max &&
+               !atomic_compare_exchange_weak_explicit(&ctxi->max_in_use, &max, in_use,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed))
+            ;
+    }
+
+    return 0;
+}
+
+void av_hwframe_ctx_get_stats(AVBufferRef *hwframe_ref, AVHWFramesStats *stats)
+{
+    FFHWFramesContext *ctxi = (FFHWFramesContext*)hwframe_ref->data;
+    AVBufferPool *pool = ctxi->source_frames ? NULL : ctxi->p.pool;
+
+    memset(stats, 0, sizeof(*stats));
+    stats->nb_allocated = atomic_load_explicit(&ctxi->nb_allocated, memory_order_relaxed);
+    stats->nb_failed    = atomic_load_explicit(&ctxi->nb_failed,    memory_order_relaxed);
+    stats->max_in_use   = atomic_load_explicit(&ctxi->max_in_use,   memory_order_relaxed);
+
+    if (pool) {
+        AVBufferPoolStats pool_stats;
+
+        av_buffer_pool_get_stats(pool, &pool_stats);
+        stats->nb_reused  = pool_stats.nb_hits;
+        stats->nb_created = pool_stats.nb_misses;
+        stats->nb_free    = pool_stats.nb_free;
+        stats->nb_in_use  = pool_in_use(pool);
+    }
+}
+
 void *av_hwdevice_hwconfig_alloc(AVBufferRef *ref)
 {
     FFHWDeviceContext *ctx = (FFHWDeviceContext*)ref->data;
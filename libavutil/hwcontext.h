@@ -215,6 +215,20 @@ typedef struct AVHWFramesContext {
      * Must be set by the user before calling av_hwframe_ctx_init().
      */
     int width, height;
+
+    /**
+     * Maximum number of frames from this context that may be in use at the
+     * same time. When the limit is reached, av_hwframe_get_buffer() fails
+     * with AVERROR(EAGAIN) until a frame is released. 0 means no limit.
+     *
+     * This is mainly useful for device types with dynamically growing pools
+     * (e.g. CUDA, Vulkan, or VAAPI with initial_pool_size 0), to bound the
+     * device memory used by one context. The limit is not enforced exactly
+     * when frames are allocated from several threads concurrently.
+     *
+     * May be set by the caller at any time.
+     */
+    int max_pool_size;
 } AVHWFramesContext;
 
 /**
@@ -369,6 +383,53 @@ int av_hwframe_ctx_init(AVBufferRef *ref);
  */
 int av_hwframe_get_buffer(AVBufferRef *hwframe_ctx, AVFrame *frame, int flags);
 
+/**
+ * Usage statistics of an AVHWFramesContext.
+ */
+typedef struct AVHWFramesStats {
+    /**
+     * Number of successful av_hwframe_get_buffer() calls.
+     */
+    uint64_t nb_allocated;
+
+    /**
+     * Number of av_hwframe_get_buffer() calls that failed, e.g. because a
+     * fixed-size pool was exhausted or max_pool_size was reached.
+     */
+    uint64_t nb_failed;
+
+    /**
+     * Number of frames that were served by reusing a released surface, and
+     * number of surfaces that had to be created.
+     *
+     * These and all the following fields are 0 for derived contexts, which
+     * allocate their frames from the source context.
+     */
+    uint64_t nb_reused;
+    uint64_t nb_created;
+
+    /**
+     * Number of frames currently in use, and the largest number of frames
+     * that were in use at the same time.
+     */
+    int nb_in_use;
+    int max_in_use;
+
+    /**
+     * Number of released surfaces currently held by the pool for reuse.
+     */
+    int nb_free;
+} AVHWFramesStats;
+
+/**
+ * Get the usage statistics of an AVHWFramesContext.
+ * This function may be called simultaneously from multiple threads.
+ *
+ * @param hwframe_ctx a reference to an AVHWFramesContext
+ * @param stats       filled with the current statistics
+ */
+void av_hwframe_ctx_get_stats(AVBufferRef *hwframe_ctx, AVHWFramesStats *stats);
+
 /**
  * Copy data to or from a hw surface. At least one of dst/src must have an
  * AVHWFramesContext attached.
@@ -19,6 +19,7 @@
 #ifndef AVUTIL_HWCONTEXT_INTERNAL_H
 #define AVUTIL_HWCONTEXT_INTERNAL_H
 
+#include <stdatomic.h>
 #include <stddef.h>
 
 #include "buffer.h"
@@ -110,6 +111,11 @@ typedef struct FFHWFramesContext {
      * frame context when trying to allocate in the derived context.
      */
     int source_allocation_map_flags;
+
+    /* usage statistics, see AVHWFramesStats */
+    atomic_uint_least64_t nb_allocated;
+    atomic_uint_least64_t nb_failed;
+    atomic_int max_in_use;
 } FFHWFramesContext;
 
 static inline FFHWFramesContext *ffhwframesctx(AVHWFramesContext *ctx)
@@ -34,9 +34,11 @@
 #endif
 #include <inttypes.h>
 #include <stdarg.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "avstring.h"
 #include "bprint.h"
 #include "common.h"
 #include "internal.h"
@@ -350,14 +352,263 @@ int av_log_format_line2(void *ptr, int level, const char *fmt, va_list vl,
     return ret;
 }
 
+static int repeat_count;
+
+/* Print one formatted message, must be called with mutex held. */
+static void output_line(int level, unsigned tint, const int type[2],
+                        char *part[4], int print_prefix)
+{
+    static char prev[LINE_SZ];
+    static int is_atty;
+    char line[LINE_SZ];
+
+    snprintf(line, sizeof(line), "%s%s%s%s", part[0], part[1], part[2], part[3]);
+
+#if HAVE_ISATTY
+    if (!is_atty)
+        is_atty = isatty(2) ? 1 : -1;
+#endif
+
+    if (print_prefix && (flags & AV_LOG_SKIP_REPEATED) && !strcmp(line, prev) &&
+        *line && line[strlen(line) - 1] != '\r'){
+        repeat_count++;
+        if (is_atty == 1)
+            fprintf(stderr, "    Last message repeated %d times\r", repeat_count);
+        return;
+    }
+    if (repeat_count > 0) {
+        fprintf(stderr, "    Last message repeated %d times\n", repeat_count);
+        repeat_count = 0;
+    }
+    strcpy(prev, line);
+    sanitize(part[0]);
+    colored_fputs(type[0], 0, part[0]);
+    sanitize(part[1]);
+    colored_fputs(type[1], 0, part[1]);
+    sanitize(part[2]);
+    colored_fputs(av_clip(level >> 3, 0, NB_LEVELS - 1), tint >> 8, part[2]);
+    sanitize(part[3]);
+    colored_fputs(av_clip(level >> 3, 0, NB_LEVELS - 1), tint >> 8, part[3]);
+}
+
+#if HAVE_THREADS
+/* Asynchronous output (AV_LOG_ASYNC): callers format their message and
+ * push it into a bounded ring, a single writer thread prints the entries in
+ * order and takes care of repeat detection. Producers are serialized by
+ * producer_lock, which also protects the print_prefix state. Messages that
+ * do not fit into a slot, and warnings and errors finding the ring full,
+ * are printed by the caller once the writer has caught up. */
+#define ASYNC_SLOTS 256
+
+typedef struct AsyncEntry {
+    atomic_uint seq;
+    int level;
+    unsigned tint;
+    int type[2];
+    int print_prefix;
+    unsigned short part[4];
+    char text[LINE_SZ + 4];
+} AsyncEntry;
+
+static struct {
+    AsyncEntry ring[ASYNC_SLOTS];
+    unsigned write_pos;
+    unsigned read_pos;
+    int print_prefix;
+    atomic_uint dropped;
+    atomic_int running;
+    atomic_int idle;
+    atomic_int stop;
+    atomic_int waiters;
+    int initialized;
+    pthread_t thread;
+    AVMutex producer_lock;
+    AVMutex lock;
+    AVCond cond;        ///< signals new entries to the idle writer
+    AVCond space;       ///< signals consumed entries to waiting producers
+} async_log = {
+    .producer_lock = AV_MUTEX_INITIALIZER,
+    .lock          = AV_MUTEX_INITIALIZER,
+    .print_prefix  = 1,
+};
+
+static void async_report_dropped(void)
+{
+    unsigned dropped = atomic_exchange_explicit(&async_log.dropped, 0,
+                                                memory_order_relaxed);
+    if (dropped) {
+        if (repeat_count > 0) {
+            fprintf(stderr, "    Last message repeated %d times\n", repeat_count);
+            repeat_count = 0;
+        }
+        fprintf(stderr, "    %u log messages dropped\n", dropped);
+    }
+}
+
+static void *async_writer(void *arg)
+{
+    ff_thread_setname("av:log");
+
+    for (;;) {
+        AsyncEntry *e = &async_log.ring[async_log.read_pos % ASYNC_SLOTS];
+        int batch = 0;
+
+        if (atomic_load(&e->seq) != async_log.read_pos + 1) {
+            if (atomic_load(&async_log.stop))
+                break;
+            ff_mutex_lock(&async_log.lock);
+            atomic_store(&async_log.idle, 1);
+            while (atomic_load(&e->seq) != async_log.read_pos + 1 &&
+                   !atomic_load(&async_log.stop))
+                ff_cond_wait(&async_log.cond, &async_log.lock);
+            atomic_store(&async_log.idle, 0);
+            ff_mutex_unlock(&async_log.lock);
+            continue;
+        }
+
+        ff_mutex_lock(&mutex);
+        async_report_dropped();
+        do {
+            char *part[4];
+            for (int i = 0; i < 4; i++)
+                part[i] = e->text + e->part[i];
+            output_line(e->level, e->tint, e->type, part, e->print_prefix);
+            atomic_store_explicit(&e->seq, async_log.read_pos + ASYNC_SLOTS,
+                                  memory_order_release);
+            async_log.read_pos++;
+            e = &async_log.ring[async_log.read_pos % ASYNC_SLOTS];
+        } while (++batch < 64 &&
+                 atomic_load_explicit(&e->seq, memory_order_acquire) ==
+                 async_log.read_pos + 1);
+        ff_mutex_unlock(&mutex);
+
+        if (atomic_load(&async_log.waiters)) {
+            ff_mutex_lock(&async_log.lock);
+            ff_cond_broadcast(&async_log.space);
+            ff_mutex_unlock(&async_log.lock);
+        }
+    }
+
+    ff_mutex_lock(&mutex);
+    async_report_dropped();
+    ff_mutex_unlock(&mutex);
+    return NULL;
+}
+
+/* Wait until the writer has printed the entry at pos, must be called with
+ * producer_lock held. */
+static void async_wait(unsigned pos)
+{
+    const AsyncEntry *e = &async_log.ring[pos % ASYNC_SLOTS];
+
+    atomic_fetch_add(&async_log.waiters, 1);
+    ff_mutex_lock(&async_log.lock);
+    while (atomic_load(&e->seq) != pos + ASYNC_SLOTS && !atomic_load(&async_log.stop))
+        ff_cond_wait(&async_log.space, &async_log.lock);
+    ff_mutex_unlock(&async_log.lock);
+    atomic_fetch_sub(&async_log.waiters, 1);
+}
+
+static void async_push(void *ptr, int level, unsigned tint,
+                       const char *fmt, va_list vl)
+{
+    AVBPrint part[4];
+    AsyncEntry *e;
+    unsigned pos;
+    int type[2], print_prefix;
+    size_t len = 0;
+
+    ff_mutex_lock(&async_log.producer_lock);
+    format_line(ptr, level, fmt, vl, part, &async_log.print_prefix, type);
+    print_prefix = async_log.print_prefix;
+    for (int i = 0; i < 4; i++)
+        len += strlen(part[i].str) + 1;
+
+    pos = async_log.write_pos;
+    e   = &async_log.ring[pos % ASYNC_SLOTS];
+    if (len > sizeof(e->text) ||
+        (level <= AV_LOG_WARNING && atomic_load_explicit(&e->seq, memory_order_acquire) != pos)) {
+        /* print it here, after everything queued before it */
+        async_wait(pos - 1);
+        ff_mutex_lock(&mutex);
+        async_report_dropped();
+        output_line(level, tint, type,
+                    (char *[4]){ part[0].str, part[1].str, part[2].str, part[3].str },
+                    print_prefix);
+        ff_mutex_unlock(&mutex);
+        goto end;
+    }
+    if (atomic_load_explicit(&e->seq, memory_order_acquire) != pos) {
+        /* the writer is behind, drop rather than block the caller */
+        atomic_fetch_add_explicit(&async_log.dropped, 1, memory_order_relaxed);
+        goto end;
+    }
+    async_log.write_pos = pos + 1;
+
+    e->level        = level;
+    e->tint         = tint;
+    e->type[0]      = type[0];
+    e->type[1]      = type[1];
+    e->print_prefix = print_prefix;
+    len = 0;
+    for (int i = 0; i < 4; i++) {
+        size_t part_len = strlen(part[i].str) + 1;
+        e->part[i] = len;
+        memcpy(e->text + len, part[i].str, part_len);
+        len += part_len;
+    }
+    atomic_store(&e->seq, pos + 1);
+
+    if (atomic_load(&async_log.idle)) {
+        ff_mutex_lock(&async_log.lock);
+        ff_cond_signal(&async_log.cond);
+        ff_mutex_unlock(&async_log.lock);
+    }
+end:
+    ff_mutex_unlock(&async_log.producer_lock);
+    av_bprint_finalize(part+3, NULL);
+}
+
+static void async_start(void)
+{
+    if (!async_log.initialized) {
+        for (unsigned i = 0; i < ASYNC_SLOTS; i++)
+            atomic_init(&async_log.ring[i].seq, i);
+        async_log.initialized = 1;
+    }
+    if (ff_cond_init(&async_log.cond, NULL))
+        return;
+    if (ff_cond_init(&async_log.space, NULL)) {
+        ff_cond_destroy(&async_log.cond);
+        return;
+    }
+    if (pthread_create(&async_log.thread, NULL, async_writer, NULL)) {
+        ff_cond_destroy(&async_log.space);
+        ff_cond_destroy(&async_log.cond);
+        return;
+    }
+    atomic_store(&async_log.running, 1);
+}
+
+static void async_stop(void)
+{
+    atomic_store(&async_log.running, 0);
+    ff_mutex_lock(&async_log.lock);
+    atomic_store(&async_log.stop, 1);
+    ff_cond_signal(&async_log.cond);
+    ff_cond_broadcast(&async_log.space);
+    ff_mutex_unlock(&async_log.lock);
+    pthread_join(async_log.thread, NULL);
+    atomic_store(&async_log.stop, 0);
+    ff_cond_destroy(&async_log.space);
+    ff_cond_destroy(&async_log.cond);
+}
+#endif
+
 void av_log_default_callback(void* ptr, int level, const char* fmt, va_list vl)
 {
     static int print_prefix = 1;
-    static int count;
-    static char prev[LINE_SZ];
     AVBPrint part[4];
-    char line[LINE_SZ];
-    static int is_atty;
     int type[2];
     unsigned tint = 0;
 
@@ -368,42 +619,25 @@ void av_log_default_callback(void* ptr, int level, const char* fmt, va_list vl)
 
     if (level > av_log_level)
         return;
-    ff_mutex_lock(&mutex);
 
-    format_line(ptr, level, fmt, vl, part, &print_prefix, type);
-    snprintf(line, sizeof(line), "%s%s%s%s", part[0].str, part[1].str, part[2].str, part[3].str);
-
-#if HAVE_ISATTY
-    if (!is_atty)
-        is_atty = isatty(2) ? 1 : -1;
+#if HAVE_THREADS
+    if (atomic_load_explicit(&async_log.running, memory_order_relaxed)) {
+        async_push(ptr, level, tint, fmt, vl);
+        return;
+    }
 #endif
 
-    if (print_prefix && (flags & AV_LOG_SKIP_REPEATED) && !strcmp(line, prev) &&
-        *line && line[strlen(line) - 1] != '\r'){
-        count++;
-        if (is_atty == 1)
-            fprintf(stderr, "    Last message repeated %d times\r", count);
-        goto end;
-    }
-    if (count > 0) {
-        fprintf(stderr, "    Last message repeated %d times\n", count);
-        count = 0;
-    }
-    strcpy(prev, line);
-    sanitize(part[0].str);
-    colored_fputs(type[0], 0, part[0].str);
-    sanitize(part[1].str);
-    colored_fputs(type[1], 0, part[1].str);
-    sanitize(part[2].str);
-    colored_fputs(av_clip(level >> 3, 0, NB_LEVELS - 1), tint >> 8, part[2].str);
-    sanitize(part[3].str);
-    colored_fputs(av_clip(level >> 3, 0, NB_LEVELS - 1), tint >> 8, part[3].str);
+    ff_mutex_lock(&mutex);
+
+    format_line(ptr, level, fmt, vl, part, &print_prefix, type);
+    output_line(level, tint, type,
+                (char *[4]){ part[0].str, part[1].str, part[2].str, part[3].str },
+                print_prefix);
 
 #if CONFIG_VALGRIND_BACKTRACE
     if (level <= BACKTRACE_LOGLEVEL)
         VALGRIND_PRINTF_BACKTRACE("%s", "");
 #endif
-end:
     av_bprint_finalize(part+3, NULL);
     ff_mutex_unlock(&mutex);
 }
@@ -451,6 +685,13 @@ void av_log_set_level(int level)
 
 void av_log_set_flags(int arg)
 {
+#if HAVE_THREADS
+    int running = atomic_load(&async_log.running);
+    if ((arg & AV_LOG_ASYNC) && !running)
+        async_start();
+    else if (!(arg & AV_LOG_ASYNC) && running)
+        async_stop();
+#endif
     flags = arg;
 }
 
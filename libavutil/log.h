@@ -406,6 +406,21 @@ int av_log_format_line2(void *ptr, int level, const char *fmt, va_list vl,
  */
 #define AV_LOG_PRINT_LEVEL 2
 
+/**
+ * Let av_log_default_callback() hand messages to a background thread for
+ * output instead of writing them under a global lock. Messages are still
+ * formatted by the calling thread. The queue is bounded; when the output
+ * falls behind, messages below AV_LOG_WARNING are dropped and the number of
+ * dropped messages is reported. Warnings and errors are never dropped, the
+ * calling thread waits for the queue to drain and prints them itself, as it
+ * does for messages too long for the queue.
+ *
+ * Clearing this flag again writes out all pending messages and stops the
+ * thread. Applications should do so before exiting, at a point where no
+ * other thread is logging anymore.
+ */
+#define AV_LOG_ASYNC 4
+
 void av_log_set_flags(int arg);
 int av_log_get_flags(void);
 
@@ -22,6 +22,7 @@
 #include "slicethread.h"
 #include "mem.h"
 #include "thread.h"
+#include "trace.h"
 #include "avassert.h"
 
 #define MAX_AUTO_THREADS 16
@@ -61,9 +62,11 @@ static int run_jobs(AVSliceThread *ctx)
     unsigned first_job    = atomic_fetch_add_explicit(&ctx->first_job, 1, memory_order_acq_rel);
     unsigned current_job  = first_job;
 
+    FF_TRACE_BEGIN("slicethread", "jobs", nb_jobs);
     do {
         ctx->worker_func(ctx->priv, current_job, first_job, nb_jobs, nb_active_threads);
     } while ((current_job = atomic_fetch_add_explicit(&ctx->current_job, 1, memory_order_acq_rel)) < nb_jobs);
+    FF_TRACE_END("slicethread", "jobs");
 
     return current_job == nb_jobs + nb_active_threads - 1;
 }
@@ -0,0 +1,175 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+
+#include "libavutil/audio_frame_fifo.h"
+#include "libavutil/channel_layout.h"
+#include "libavutil/error.h"
+#include "libavutil/frame.h"
+#include "libavutil/macros.h"
+
+#define NB_FRAMES 24
+
+static int make_frame(AVFrame *frame, enum AVSampleFormat fmt, int nb_samples, int *counter)
+{
+    const int planar = av_sample_fmt_is_planar(fmt);
+    int ret;
+
+    frame->format      = fmt;
+    frame->nb_samples  = nb_samples;
+    frame->sample_rate = 48000;
+    frame->time_base   = (AVRational){ 1, 48000 };
+    frame->pts         = *counter;
+    av_channel_layout_default(&frame->ch_layout, 2);
+    ret = av_frame_get_buffer(frame, 0);
+    if (ret < 0)
+        return ret;
+
+    for (int i = 0; i < nb_samples; i++, (*counter)++) {
+        for (int ch = 0; ch < 2; ch++) {
+            if (planar)
+                ((int16_t *)frame->extended_data[ch])[i] = *counter + ch;
+            else
+                ((int16_t *)frame->data[0])[2 * i + ch] = *counter + ch;
+        }
+    }
+
+    return 0;
+}
+
+static int check_frame(const AVFrame *frame, int *counter)
+{
+    const int planar = av_sample_fmt_is_planar(frame->format);
+
+    if (frame->pts != *counter)
+        return 0;
+
+    for (int i = 0; i < frame->nb_samples; i++, (*counter)++) {
+        for (int ch = 0; ch < 2; ch++) {
+            int16_t v = planar ? ((const int16_t *)frame->extended_data[ch])[i]
+                               : ((const int16_t *)frame->data[0])[2 * i + ch];
+            if (v != (int16_t)(*counter + ch))
+                return 0;
+        }
+    }
+
+    return 1;
+}
+
+static int test_rechunk(enum AVSampleFormat fmt, int in_size, int out_size)
+{
+    AVAudioFrameFifo *aff = av_audio_frame_fifo_alloc(fmt, 2, 1, 0, 0);
+    AVFrame *frame = av_frame_alloc();
+    AVFrame *in[NB_FRAMES] = { NULL };
+    int wcounter = 0, rcounter = 0, views = 0, copies = 0, ret = 0;
+
+    if (!aff || !frame) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    /* keep a reference to every input frame, so that a frame returned
+     * without copying is never writable */
+    for (int n = 0; n < NB_FRAMES; n++) {
+        in[n] = av_frame_alloc();
+        if (!in[n]) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        ret = make_frame(in[n], fmt, in_size, &wcounter);
+        if (ret >= 0)
+            ret = av_audio_frame_fifo_write(aff, in[n]);
+        if (ret < 0)
+            goto end;
+
+        while (av_audio_frame_fifo_size(aff) >= out_size) {
+            ret = av_audio_frame_fifo_read(aff, frame, out_size);
+            if (ret != out_size || !check_frame(frame, &rcounter)) {
+                printf("mismatch at sample %d\n", rcounter);
+                ret = AVERROR_BUG;
+                goto end;
+            }
+            if (av_frame_is_writable(frame))
+                copies++;
+            else
+                views++;
+            av_frame_unref(frame);
+        }
+    }
+
+    printf("%s %d -> %d: %d views, %d copies, %d samples left\n",
+           av_get_sample_fmt_name(fmt), in_size, out_size,
+           views, copies, av_audio_frame_fifo_size(aff));
+    ret = 0;
+end:
+    for (int n = 0; n < NB_FRAMES; n++)
+        av_frame_free(&in[n]);
+    av_frame_free(&frame);
+    av_audio_frame_fifo_freep(&aff);
+    return ret;
+}
+
+static int test_spsc(void)
+{
+    AVAudioFrameFifo *aff = av_audio_frame_fifo_alloc(AV_SAMPLE_FMT_S16P, 2, 4, 0,
+                                                      AV_AUDIO_FRAME_FIFO_FLAG_SPSC);
+    AVFrame *frame = av_frame_alloc();
+    int counter = 0, ret = 0, written = 0;
+
+    if (!aff || !frame) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    ret = make_frame(frame, AV_SAMPLE_FMT_S16P, 256, &counter);
+    if (ret < 0)
+        goto end;
+    while ((ret = av_audio_frame_fifo_write(aff, frame)) >= 0)
+        written++;
+    printf("spsc: %d frames written, then %s\n", written,
+           ret == AVERROR(EAGAIN) ? "EAGAIN" : "error");
+    av_frame_unref(frame);
+
+    printf("spsc: drained %d\n", av_audio_frame_fifo_drain(aff, 300));
+    ret = make_frame(frame, AV_SAMPLE_FMT_S16P, 256, &counter);
+    if (ret >= 0)
+        ret = av_audio_frame_fifo_write(aff, frame);
+    printf("spsc: write after drain %s, %d samples queued\n",
+           ret >= 0 ? "ok" : "failed", av_audio_frame_fifo_size(aff));
+    ret = 0;
+end:
+    av_frame_free(&frame);
+    av_audio_frame_fifo_freep(&aff);
+    return ret;
+}
+
+int main(void)
+{
+    static const int sizes[][2] = {
+        { 1024, 960 }, { 960, 1024 }, { 1024, 480 }, { 960, 480 }, { 480, 1024 },
+    };
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(sizes); i++) {
+        if (test_rechunk(AV_SAMPLE_FMT_S16P, sizes[i][0], sizes[i][1]) < 0 ||
+            test_rechunk(AV_SAMPLE_FMT_S16,  sizes[i][0], sizes[i][1]) < 0)
+            return 1;
+    }
+
+    return test_spsc() < 0;
+}
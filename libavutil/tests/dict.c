@@ -42,6 +42,33 @@ static const AVDictionaryEntry *dict_iterate(const AVDictionary *m,
     return dict_iterate;
 }
 
+static const AVDictionaryEntry *linear_get(const AVDictionary *m, const char *key,
+                                           int flags)
+{
+    for (int i = 0; i < av_dict_count(m); i++)
+        if (!(flags & AV_DICT_MATCH_CASE ? strcmp(m->elems[i].key, key)
+                                         : av_strcasecmp(m->elems[i].key, key)))
+            return &m->elems[i];
+    return NULL;
+}
+
+static void test_index(AVDictionary *m, int n)
+{
+    char key[16];
+
+    for (int i = 0; i < n; i++) {
+        for (int upper = 0; upper < 2; upper++) {
+            snprintf(key, sizeof(key), upper ? "KEY%d" : "key%d", i);
+            for (int flags = 0; flags <= AV_DICT_MATCH_CASE; flags += AV_DICT_MATCH_CASE) {
+                const AVDictionaryEntry *e = av_dict_get(m, key, NULL, flags);
+                if (e != linear_get(m, key, flags))
+                    printf("Indexed lookup of %s with flags %d yields %s\n",
+                           key, flags, e ? e->value : "N/A");
+            }
+        }
+    }
+}
+
 static void print_dict(const AVDictionary *m)
 {
     const AVDictionaryEntry *t = NULL;
@@ -163,5 +190,71 @@ int main(void)
     printf("%s\n", e->value);
     av_dict_free(&dict);
 
+    printf("\nTesting av_dict_get() with a hash index\n");
+    for (int i = 0; i < 300; i++) {
+        char key[16], val[16];
+        snprintf(key, sizeof(key), "key%d", i);
+        snprintf(val, sizeof(val), "%d", i);
+        av_dict_set(&dict, key, val, 0);
+    }
+    printf("%d entries, index %s\n", av_dict_count(dict), dict->index ? "yes" : "no");
+    for (int i = 0; i < 300; i += 3) {
+        char key[16];
+        snprintf(key, sizeof(key), "key%d", i);
+        av_dict_set(&dict, key, NULL, 0);
+    }
+    for (int i = 0; i < 300; i += 5) {
+        char key[16];
+        snprintf(key, sizeof(key), "KEY%d", i);
+        av_dict_set(&dict, key, "upper", 0);
+    }
+    av_dict_set(&dict, "KEY7", "multi", AV_DICT_MULTIKEY);
+    av_dict_set(&dict, "key7", "multi", AV_DICT_MULTIKEY);
+    av_dict_set(&dict, "key8", "append", AV_DICT_APPEND);
+    av_dict_set(&dict, "key10", "keep", AV_DICT_DONT_OVERWRITE);
+    test_index(dict, 310);
+    e = av_dict_get(dict, "Key8", NULL, 0);
+    printf("%d entries, %s %s\n", av_dict_count(dict), e->key, e->value);
+    e = av_dict_get(dict, "key7", NULL, AV_DICT_MATCH_CASE);
+    printf("%s %s\n", e->key, e->value);
+    av_dict_free(&dict);
+
+    printf("\nTesting av_dict_copy() of a shared dictionary\n");
+    {
+        AVDictionary *copy = NULL, *copy2 = NULL;
+        for (int i = 0; i < 300; i++)
+            av_dict_set_int(&dict, av_asprintf("key%d", i), i, AV_DICT_DONT_STRDUP_KEY);
+        av_dict_copy(&copy, dict, 0);
+        for (int i = 0; i < 300; i += 7)
+            av_dict_set(&copy, av_asprintf("key%d", i), NULL, AV_DICT_DONT_STRDUP_KEY);
+        test_index(copy, 310);
+        printf("%d %d entries\n", av_dict_count(dict), av_dict_count(copy));
+        av_dict_free(&copy);
+        av_dict_free(&dict);
+
+        av_dict_set(&dict, "a", "a", 0);
+        av_dict_set(&dict, "b", "b", 0);
+        av_dict_copy(&copy, dict, 0);
+        av_dict_copy(&copy2, copy, 0);
+        av_dict_set(&copy, "a", "changed", 0);
+        av_dict_set(&copy2, "c", "c", 0);
+        av_dict_set(&dict, "b", NULL, 0);
+        print_dict(dict);
+        print_dict(copy);
+        print_dict(copy2);
+        av_dict_free(&copy);
+        av_dict_copy(&copy, copy2, 0);
+        av_dict_free(&copy2);
+        print_dict(copy);
+        av_dict_free(&copy);
+
+        av_dict_copy(&copy, dict, 0);
+        av_dict_set(&copy, "a", "changed", AV_DICT_DONT_OVERWRITE);
+        av_dict_set(&copy, "missing", NULL, 0);
+        printf("no-op changes, shared %s\n", copy == dict ? "yes" : "no");
+        av_dict_free(&copy);
+        av_dict_free(&dict);
+    }
+
     return 0;
 }
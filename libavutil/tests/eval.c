@@ -138,6 +138,11 @@ int main(int argc, char **argv)
         "clip(0, 2, 1)",
         "clip(0/0, 1, 2)",
         "clip(0, 0/0, 1)",
+        "clip(st(0, ld(0)+1), 0, 10); ld(0)",
+        "sgn(st(0, ld(0)-1)) + ld(0)",
+        "if(lt(PI, 4), PI*2+1, PI*2-1) + PI*2",
+        "ifnot(gt(E, 3), st(1, E*E), st(1, 1)); ld(1) + E*E",
+        "(1+2)*(PI+1)/(PI+1)",
         NULL
     };
     int ret;
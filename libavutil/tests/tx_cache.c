@@ -0,0 +1,163 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * This test program checks that contexts created with AV_TX_REUSE are
+ * handed out again after av_tx_uninit(), that they still compute the same
+ * transform, and that the cache can be used from several threads at once.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/lfg.h"
+#include "libavutil/macros.h"
+#include "libavutil/mem_internal.h"
+#include "libavutil/thread.h"
+#include "libavutil/tx.h"
+
+#define NB_THREADS    4
+#define NB_ITERATIONS 200
+#define MAX_LEN       1024
+
+static const int lens[] = { 64, 240, 512, 1024 };
+
+static AVComplexFloat input[MAX_LEN];
+static AVComplexFloat ref[2][FF_ARRAY_ELEMS(lens)][MAX_LEN];
+
+static int run_tx(AVComplexFloat *out, int inv, int len, uint64_t flags,
+                  AVTXContext **keep)
+{
+    DECLARE_ALIGNED(32, AVComplexFloat, in)[MAX_LEN];
+    AVTXContext *ctx;
+    av_tx_fn fn;
+    int ret;
+
+    ret = av_tx_init(&ctx, &fn, AV_TX_FLOAT_FFT, inv, len, NULL, flags);
+    if (ret < 0)
+        return ret;
+
+    memcpy(in, input, len * sizeof(*in));
+    fn(ctx, out, in, sizeof(*in));
+
+    if (keep)
+        *keep = ctx;
+    else
+        av_tx_uninit(&ctx);
+
+    return 0;
+}
+
+static int check_output(const AVComplexFloat *out, int inv, int idx)
+{
+    return memcmp(out, ref[inv][idx], lens[idx] * sizeof(*out)) ? -1 : 0;
+}
+
+static void *thread_main(void *arg)
+{
+    DECLARE_ALIGNED(32, AVComplexFloat, out)[MAX_LEN];
+    intptr_t n = (intptr_t)arg;
+
+    for (int i = 0; i < NB_ITERATIONS; i++) {
+        int idx = (i + n) % FF_ARRAY_ELEMS(lens);
+        int inv = (i / FF_ARRAY_ELEMS(lens) + n) & 1;
+
+        if (run_tx(out, inv, lens[idx], AV_TX_REUSE, NULL) < 0 ||
+            check_output(out, inv, idx) < 0)
+            return (void *)1;
+    }
+
+    return NULL;
+}
+
+int main(void)
+{
+    DECLARE_ALIGNED(32, AVComplexFloat, out)[MAX_LEN];
+    AVTXContext *first, *again, *other[4];
+    pthread_t threads[NB_THREADS];
+    AVLFG lfg;
+    int ret;
+
+    av_lfg_init(&lfg, 0xdeadbeef);
+    for (int i = 0; i < MAX_LEN; i++) {
+        input[i].re = av_lfg_get(&lfg) / (float)UINT32_MAX - 0.5f;
+        input[i].im = av_lfg_get(&lfg) / (float)UINT32_MAX - 0.5f;
+    }
+
+    /* Reference output from contexts which never enter the cache. */
+    for (int inv = 0; inv < 2; inv++)
+        for (int i = 0; i < FF_ARRAY_ELEMS(lens); i++)
+            if (run_tx(ref[inv][i], inv, lens[i], 0, NULL) < 0)
+                return 1;
+
+    /* A released context must be handed out again for the same parameters,
+     * even while other contexts with these parameters are allocated. */
+    if (run_tx(out, 0, lens[3], AV_TX_REUSE, &first) < 0)
+        return 1;
+    again = first;
+    av_tx_uninit(&first);
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(other); i++)
+        if (run_tx(out, 0, lens[3], 0, &other[i]) < 0)
+            return 1;
+    if (run_tx(out, 0, lens[3], AV_TX_REUSE, &first) < 0)
+        return 1;
+    if (first != again) {
+        fprintf(stderr, "released context was not reused\n");
+        return 2;
+    }
+    if (check_output(out, 0, 3) < 0) {
+        fprintf(stderr, "reused context gives a different result\n");
+        return 3;
+    }
+
+    /* Different parameters must not match the cached context. */
+    av_tx_uninit(&first);
+    if (run_tx(out, 1, lens[3], AV_TX_REUSE, &first) < 0)
+        return 1;
+    if (first == again) {
+        fprintf(stderr, "cached context used for a different transform\n");
+        return 4;
+    }
+    if (check_output(out, 1, 3) < 0)
+        return 3;
+    av_tx_uninit(&first);
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(other); i++)
+        av_tx_uninit(&other[i]);
+
+    for (intptr_t i = 0; i < NB_THREADS; i++) {
+        if ((ret = pthread_create(&threads[i], NULL, thread_main, (void *)i))) {
+            fprintf(stderr, "pthread_create failed: %s.\n", strerror(ret));
+            return 1;
+        }
+    }
+    ret = 0;
+    for (int i = 0; i < NB_THREADS; i++) {
+        void *thread_ret;
+        pthread_join(threads[i], &thread_ret);
+        if (thread_ret)
+            ret = 5;
+    }
+    if (ret) {
+        fprintf(stderr, "wrong result from a shared cache\n");
+        return ret;
+    }
+
+    return 0;
+}
@@ -0,0 +1,72 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "thread.h"
+#include "time.h"
+#include "trace.h"
+
+static AVOnce trace_once = AV_ONCE_INIT;
+static FILE *trace_file;
+static int64_t trace_start;
+
+static void trace_open(void)
+{
+    const char *path = getenv("FFMPEG_TRACE");
+
+    if (!path || !(trace_file = fopen(path, "w")))
+        return;
+
+    trace_start = av_gettime_relative();
+    /* the closing bracket is optional in the array format, which allows
+     * the trace to be read even if the process does not exit cleanly */
+    fputs("[\n", trace_file);
+}
+
+void avpriv_trace_event(const char *cat, const char *name, int64_t arg, char phase)
+{
+    char buf[64];
+    int i;
+
+    ff_thread_once(&trace_once, trace_open);
+    if (!trace_file)
+        return;
+
+    for (i = 0; name[i] && i < sizeof(buf) - 1; i++)
+        buf[i] = name[i] == '"' || name[i] == '\\' || name[i] < ' ' ? '_' : name[i];
+    buf[i] = 0;
+
+    /* stdio locks the stream for each call, so events are never interleaved */
+    if (phase == 'B')
+        fprintf(trace_file,
+                "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"B\",\"ts\":%"PRId64","
+                "\"pid\":%d,\"tid\":%"PRIuPTR",\"args\":{\"n\":%"PRId64"}},\n",
+                buf, cat, av_gettime_relative() - trace_start,
+                (int)getpid(), (uintptr_t)pthread_self(), arg);
+    else
+        fprintf(trace_file,
+                "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"E\",\"ts\":%"PRId64","
+                "\"pid\":%d,\"tid\":%"PRIuPTR"},\n",
+                buf, cat, av_gettime_relative() - trace_start,
+                (int)getpid(), (uintptr_t)pthread_self());
+}
@@ -0,0 +1,62 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Trace points for timeline profiling.
+ *
+ * With --enable-trace-events, FF_TRACE_BEGIN() and FF_TRACE_END() write
+ * duration events in the Chrome trace event format to the file named by
+ * the FFMPEG_TRACE environment variable, which can be loaded into
+ * chrome://tracing or ui.perfetto.dev. Otherwise they compile to nothing.
+ *
+ * Begin and end events must be emitted in pairs by the same thread, the
+ * end event closes the most recent open one.
+ */
+
+#ifndef AVUTIL_TRACE_H
+#define AVUTIL_TRACE_H
+
+#include <stdint.h>
+
+#include "config.h"
+
+#if CONFIG_TRACE_EVENTS
+
+/**
+ * Write one trace event.
+ *
+ * @param cat   category, a string literal
+ * @param name  event name, characters that would need escaping are replaced
+ * @param arg   free form integer shown with the event, e.g. a frame or job
+ *              number; ignored for end events
+ * @param phase 'B' for the begin and 'E' for the end of a duration
+ */
+void avpriv_trace_event(const char *cat, const char *name, int64_t arg, char phase);
+
+#define FF_TRACE_BEGIN(cat, name, arg) avpriv_trace_event(cat, name, arg, 'B')
+#define FF_TRACE_END(cat, name)        avpriv_trace_event(cat, name, 0, 'E')
+
+#else
+
+#define FF_TRACE_BEGIN(cat, name, arg) do { } while (0)
+#define FF_TRACE_END(cat, name)        do { } while (0)
+
+#endif
+
+#endif /* AVUTIL_TRACE_H */
@@ -22,6 +22,7 @@
 #include "mem.h"
 #include "qsort.h"
 #include "bprint.h"
+#include "thread.h"
 
 #include "tx_priv.h"
 
@@ -292,13 +293,107 @@ void ff_tx_clear_ctx(AVTXContext *s)
     reset_ctx(s, 0);
 }
 
+/* Idle root contexts created with AV_TX_REUSE, kept around so identical
+ * transforms need not be rebuilt. Oldest entries come first. */
+static AVMutex      plan_cache_lock = AV_MUTEX_INITIALIZER;
+static AVTXContext *plan_cache[TX_MAX_CACHED_PLANS];
+static int          plan_cache_nb;
+static size_t       plan_cache_bytes;
+
+/* Upper bound of the memory held by a context and its subtransforms,
+ * assuming lookup tables and buffers of at most len entries. */
+static size_t plan_size(const AVTXContext *s)
+{
+    size_t size = 0;
+
+    if (s->sub) {
+        size += TX_MAX_SUB*sizeof(*s->sub);
+        for (int i = 0; i < s->nb_sub; i++)
+            size += plan_size(&s->sub[i]);
+    }
+    if (s->map)
+        size += s->len*sizeof(*s->map);
+    if (s->exp)
+        size += s->len*sizeof(AVComplexDouble);
+    if (s->tmp)
+        size += s->len*sizeof(AVComplexDouble);
+
+    return size;
+}
+
+static int plan_key_equal(const FFTXPlanKey *a, const FFTXPlanKey *b)
+{
+    return a->type  == b->type  && a->inv   == b->inv   &&
+           a->len   == b->len   && a->flags == b->flags &&
+           a->scale == b->scale && a->cpu_flags == b->cpu_flags;
+}
+
+static AVTXContext *plan_cache_get(const FFTXPlanKey *key)
+{
+    AVTXContext *s = NULL;
+
+    ff_mutex_lock(&plan_cache_lock);
+    for (int i = plan_cache_nb - 1; i >= 0; i--) {
+        if (plan_key_equal(&plan_cache[i]->plan_key, key)) {
+            s = plan_cache[i];
+            memmove(&plan_cache[i], &plan_cache[i + 1],
+                    (plan_cache_nb - i - 1)*sizeof(*plan_cache));
+            plan_cache_nb--;
+            plan_cache_bytes -= s->plan_bytes;
+            break;
+        }
+    }
+    ff_mutex_unlock(&plan_cache_lock);
+
+    return s;
+}
+
+/* Takes ownership of s, returns the number of contexts to free in evicted,
+ * which may include s itself if it is too large to be kept */
+static int plan_cache_put(AVTXContext *s, AVTXContext **evicted)
+{
+    int nb_evicted = 0;
+
+    if (s->plan_bytes > TX_MAX_CACHED_BYTES) {
+        evicted[0] = s;
+        return 1;
+    }
+
+    ff_mutex_lock(&plan_cache_lock);
+    while (plan_cache_nb == TX_MAX_CACHED_PLANS ||
+           plan_cache_bytes + s->plan_bytes > TX_MAX_CACHED_BYTES) {
+        evicted[nb_evicted++] = plan_cache[0];
+        plan_cache_bytes -= plan_cache[0]->plan_bytes;
+        memmove(&plan_cache[0], &plan_cache[1],
+                (plan_cache_nb - 1)*sizeof(*plan_cache));
+        plan_cache_nb--;
+    }
+    plan_cache[plan_cache_nb++] = s;
+    plan_cache_bytes += s->plan_bytes;
+    ff_mutex_unlock(&plan_cache_lock);
+
+    return nb_evicted;
+}
+
 av_cold void av_tx_uninit(AVTXContext **ctx)
 {
-    if (!(*ctx))
+    AVTXContext *s = *ctx;
+    AVTXContext *evicted[TX_MAX_CACHED_PLANS];
+    int nb_evicted = 1;
+
+    if (!s)
         return;
 
-    reset_ctx(*ctx, 1);
-    av_freep(ctx);
+    *ctx = NULL;
+
+    evicted[0] = s;
+    if (s->plan_cacheable)
+        nb_evicted = plan_cache_put(s, evicted);
+
+    for (int i = 0; i < nb_evicted; i++) {
+        reset_ctx(evicted[i], 1);
+        av_free(evicted[i]);
+    }
 }
 
 static av_cold int ff_tx_null_init(AVTXContext *s, const FFTXCodelet *cd,
@@ -928,12 +1023,17 @@ av_cold int av_tx_init(AVTXContext **ctx, av_tx_fn *tx, enum AVTXType type,
 {
     int ret;
     AVTXContext tmp = { 0 };
+    AVTXContext *s;
+    FFTXPlanKey key;
     const double default_scale_d = 1.0;
     const float  default_scale_f = 1.0f;
+    const int reuse = !!(flags & AV_TX_REUSE);
 
     if (!len || type >= AV_TX_NB || !ctx || !tx)
         return AVERROR(EINVAL);
 
+    flags &= ~AV_TX_REUSE;
+
     if (!(flags & AV_TX_UNALIGNED))
         flags |= FF_TX_ALIGNED;
     if (!(flags & AV_TX_INPLACE))
@@ -946,11 +1046,38 @@ av_cold int av_tx_init(AVTXContext **ctx, av_tx_fn *tx, enum AVTXType type,
     else if (!scale && !TYPE_IS(FFT, type))
         scale = &default_scale_f;
 
+    key = (FFTXPlanKey) {
+        .type      = type,
+        .inv       = inv,
+        .len       = len,
+        .flags     = flags,
+        .cpu_flags = av_get_cpu_flags(),
+    };
+    if (!TYPE_IS(FFT, type))
+        key.scale = (type == AV_TX_DOUBLE_MDCT ||
+                     type == AV_TX_DOUBLE_DCT  ||
+                     type == AV_TX_DOUBLE_DCT_I ||
+                     type == AV_TX_DOUBLE_DST_I ||
+                     type == AV_TX_DOUBLE_RDFT) ? *(const double *)scale :
+                                                  *(const float  *)scale;
+
+    if (reuse && (s = plan_cache_get(&key))) {
+        *ctx = s;
+        *tx  = s->plan_fn;
+        return 0;
+    }
+
     ret = ff_tx_init_subtx(&tmp, type, flags, NULL, len, inv, scale);
     if (ret < 0)
         return ret;
 
-    *ctx = &tmp.sub[0];
+    s = &tmp.sub[0];
+    s->plan_cacheable = reuse;
+    s->plan_bytes     = plan_size(s);
+    s->plan_key       = key;
+    s->plan_fn        = tmp.fn[0];
+
+    *ctx = s;
     *tx  = tmp.fn[0];
 
 #if !CONFIG_SMALL
@@ -960,3 +1087,63 @@ av_cold int av_tx_init(AVTXContext **ctx, av_tx_fn *tx, enum AVTXType type,
 
     return ret;
 }
+
+/* Runs the same transform over all elements of a batch */
+static void ff_tx_batch(AVTXContext *s, void *_out, void *_in, ptrdiff_t stride)
+{
+    uint8_t *out = _out;
+    uint8_t *in  = _in;
+
+    for (int i = 0; i < s->batch_count; i++) {
+        s->fn[0](&s->sub[0], out, in, stride);
+        out += s->batch_out_dist;
+        in  += s->batch_in_dist;
+    }
+}
+
+av_cold int av_tx_init_batch(AVTXContext **ctx, av_tx_fn *tx, enum AVTXType type,
+                             int inv, int len, const void *scale, uint64_t flags,
+                             int count, ptrdiff_t in_dist, ptrdiff_t out_dist)
+{
+    AVTXContext *s, *sub;
+    av_tx_fn fn;
+    int ret;
+
+    if (count <= 0 || !ctx || !tx)
+        return AVERROR(EINVAL);
+
+    ret = av_tx_init(&sub, &fn, type, inv, len, scale, flags);
+    if (ret < 0)
+        return ret;
+
+    if (count == 1) {
+        *ctx = sub;
+        *tx  = fn;
+        return 0;
+    }
+
+    s = av_mallocz(sizeof(*s));
+    if (!s) {
+        av_tx_uninit(&sub);
+        return AVERROR(ENOMEM);
+    }
+
+    s->len            = len;
+    s->inv            = inv;
+    s->type           = type;
+    s->flags          = sub->flags;
+    s->scale_f        = sub->scale_f;
+    s->scale_d        = sub->scale_d;
+    s->sub            = sub;
+    s->fn[0]          = fn;
+    s->cd[0]          = sub->cd_self;
+    s->nb_sub         = 1;
+    s->batch_count    = count;
+    s->batch_in_dist  = in_dist;
+    s->batch_out_dist = out_dist;
+
+    *ctx = s;
+    *tx  = ff_tx_batch;
+
+    return 0;
+}
@@ -183,6 +183,14 @@ enum AVTXFlags {
      */
     AV_TX_REAL_TO_REAL      = 1ULL << 3,
     AV_TX_REAL_TO_IMAGINARY = 1ULL << 4,
+
+    /**
+     * Allows av_tx_uninit() to keep the context in a process-wide cache,
+     * from which a later av_tx_init() call with identical parameters and
+     * this flag may take it instead of building a new one.
+     * The cache holds a few MiB of contexts at most.
+     */
+    AV_TX_REUSE = 1ULL << 5,
 };
 
 /**
@@ -202,8 +210,33 @@ enum AVTXFlags {
 int av_tx_init(AVTXContext **ctx, av_tx_fn *tx, enum AVTXType type,
                int inv, int len, const void *scale, uint64_t flags);
 
+/**
+ * Initialize a transform context running several transforms of the same
+ * configuration at once.
+ *
+ * The function set in tx performs count transforms per call, the input and
+ * output arrays of transform i being at in + i * in_dist and
+ * out + i * out_dist. The stride argument applies to each transform as with
+ * av_tx_init().
+ *
+ * @param count number of transforms per call, must be at least 1
+ * @param in_dist distance in bytes between the inputs of successive transforms
+ * @param out_dist distance in bytes between the outputs of successive transforms
+ *
+ * All other parameters are as in av_tx_init(). The context must be freed
+ * with av_tx_uninit().
+ *
+ * @return 0 on success, negative error code on failure
+ */
+int av_tx_init_batch(AVTXContext **ctx, av_tx_fn *tx, enum AVTXType type,
+                     int inv, int len, const void *scale, uint64_t flags,
+                     int count, ptrdiff_t in_dist, ptrdiff_t out_dist);
+
 /**
  * Frees a context and sets *ctx to NULL, does nothing when *ctx == NULL.
+ *
+ * Contexts created by av_tx_init() with AV_TX_REUSE may instead be kept
+ * internally, to be handed out again by a later av_tx_init() call.
  */
 void av_tx_uninit(AVTXContext **ctx);
 
@@ -196,6 +196,21 @@ typedef struct FFTXCodeletOptions {
 /* Maximum number of returned results for ff_tx_decompose_length. Arbitrary. */
 #define TX_MAX_DECOMPOSITIONS 512
 
+/* Maximum number and estimated total size of the idle root contexts kept
+ * for reuse by av_tx_init(). Arbitrary. */
+#define TX_MAX_CACHED_PLANS 16
+#define TX_MAX_CACHED_BYTES (4 << 20)
+
+/* Parameters a root context was created with, used to find reusable plans */
+typedef struct FFTXPlanKey {
+    enum AVTXType type;
+    int           inv;
+    int           len;
+    uint64_t      flags;          /* Flags as given to av_tx_init() */
+    double        scale;          /* Scale as given, 0.0 for FFTs */
+    int           cpu_flags;      /* av_get_cpu_flags() at creation time */
+} FFTXPlanKey;
+
 typedef struct FFTXCodelet {
     const char    *name;          /* Codelet name, for debugging */
     av_tx_fn       function;      /* Codelet function, != NULL */
@@ -266,6 +281,17 @@ struct AVTXContext {
     float              scale_f;
     double             scale_d;
     void              *opaque;          /* Free to use by implementations */
+
+    /* Batched transforms, see av_tx_init_batch() */
+    int                batch_count;     /* Number of transforms per call */
+    ptrdiff_t          batch_in_dist;   /* Distance between inputs in bytes */
+    ptrdiff_t          batch_out_dist;  /* Distance between outputs in bytes */
+
+    /* Plan cache, only set on root contexts returned by av_tx_init() */
+    int                plan_cacheable;  /* If the context may be reused */
+    size_t             plan_bytes;      /* Estimated memory it holds */
+    FFTXPlanKey        plan_key;        /* Parameters it was created with */
+    av_tx_fn           plan_fn;         /* Function returned with it */
 };
 
 /* This function embeds a Ruritanian PFA input map into an existing lookup table
@@ -453,6 +453,7 @@ av_cold int swri_rematrix_init(SwrContext *s){
     int nb_out = s->out.ch_count;
 
     s->mix_any_f = NULL;
+    s->mix_add_1_f = NULL;
 
     if (!s->rematrix_custom) {
         int r = auto_matrix(s);
@@ -498,6 +499,7 @@ av_cold int swri_rematrix_init(SwrContext *s){
         *((float*)s->native_one) = 1.0;
         s->mix_1_1_f = (mix_1_1_func_type*)copy_float;
         s->mix_2_1_f = (mix_2_1_func_type*)sum2_float;
+        s->mix_add_1_f = (mix_1_1_func_type*)add_float;
         s->mix_any_f = (mix_any_func_type*)get_mix_any_func_float(s);
     }else if(s->midbuf.fmt == AV_SAMPLE_FMT_DBLP){
         s->native_matrix = av_calloc(nb_in * nb_out, sizeof(double));
@@ -510,6 +512,7 @@ av_cold int swri_rematrix_init(SwrContext *s){
         *((double*)s->native_one) = 1.0;
         s->mix_1_1_f = (mix_1_1_func_type*)copy_double;
         s->mix_2_1_f = (mix_2_1_func_type*)sum2_double;
+        s->mix_add_1_f = (mix_1_1_func_type*)add_double;
         s->mix_any_f = (mix_any_func_type*)get_mix_any_func_double(s);
     }else if(s->midbuf.fmt == AV_SAMPLE_FMT_S32P){
         s->native_one    = av_mallocz(sizeof(int));
@@ -608,23 +611,21 @@ int swri_rematrix(SwrContext *s, AudioData *out, AudioData *in, int len, int mus
                 s->mix_2_1_f   (out->ch[out_i]+off, in->ch[in_i1]+off, in->ch[in_i2]+off, s->native_matrix, in->ch_count*out_i + in_i1, in->ch_count*out_i + in_i2, len-len1);
             break;}
         default:
-            if(s->int_sample_fmt == AV_SAMPLE_FMT_FLTP){
-                for(i=0; i<len; i++){
-                    float v=0;
-                    for(j=0; j<s->matrix_ch[out_i][0]; j++){
-                        in_i= s->matrix_ch[out_i][1+j];
-                        v+= ((float*)in->ch[in_i])[i] * s->matrix_flt[out_i][in_i];
-                    }
-                    ((float*)out->ch[out_i])[i]= v;
-                }
-            }else if(s->int_sample_fmt == AV_SAMPLE_FMT_DBLP){
-                for(i=0; i<len; i++){
-                    double v=0;
-                    for(j=0; j<s->matrix_ch[out_i][0]; j++){
-                        in_i= s->matrix_ch[out_i][1+j];
-                        v+= ((double*)in->ch[in_i])[i] * s->matrix[out_i][in_i];
-                    }
-                    ((double*)out->ch[out_i])[i]= v;
+            if(s->mix_add_1_f){
+                /* Mix the first two inputs, then accumulate the others one
+                 * channel at a time, in the same order a per sample sum
+                 * would add them. */
+                int in_i1 = s->matrix_ch[out_i][1];
+                int in_i2 = s->matrix_ch[out_i][2];
+                if(s->mix_2_1_simd && len1)
+                    s->mix_2_1_simd(out->ch[out_i]    , in->ch[in_i1]    , in->ch[in_i2]    , s->native_simd_matrix, in->ch_count*out_i + in_i1, in->ch_count*out_i + in_i2, len1);
+                else
+                    s->mix_2_1_f   (out->ch[out_i]    , in->ch[in_i1]    , in->ch[in_i2]    , s->native_matrix, in->ch_count*out_i + in_i1, in->ch_count*out_i + in_i2, len1);
+                if(len != len1)
+                    s->mix_2_1_f   (out->ch[out_i]+off, in->ch[in_i1]+off, in->ch[in_i2]+off, s->native_matrix, in->ch_count*out_i + in_i1, in->ch_count*out_i + in_i2, len-len1);
+                for(j=2; j<s->matrix_ch[out_i][0]; j++){
+                    in_i= s->matrix_ch[out_i][1+j];
+                    s->mix_add_1_f(out->ch[out_i], in->ch[in_i], s->native_matrix, in->ch_count*out_i + in_i, len);
                 }
             }else{
                 for(i=0; i<len; i++){
@@ -67,6 +67,15 @@ static void RENAME(copy)(SAMPLE *out, const SAMPLE *in, COEFF *coeffp, integer i
         out[i] = R(coeff*in[i]);
 }
 
+#if defined(TEMPLATE_REMATRIX_FLT) || defined(TEMPLATE_REMATRIX_DBL)
+static void RENAME(add)(SAMPLE *out, const SAMPLE *in, COEFF *coeffp, integer index, integer len){
+    int i;
+    INTER coeff = coeffp[index];
+    for(i=0; i<len; i++)
+        out[i] += coeff*in[i];
+}
+#endif
+
 static void RENAME(mix6to2)(SAMPLE **out, const SAMPLE **in, COEFF *coeffp, integer len){
     int i;
 
@@ -30,6 +30,10 @@
 
 #define ALIGN 32
 
+/* Number of samples passed through all stages at once when not resampling,
+ * small enough for the intermediate buffers to stay in the L1 cache */
+#define SWR_BLOCK_SIZE 256
+
 int swr_set_channel_mapping(struct SwrContext *s, const int *channel_map){
     if(!s || s->in_convert) // s needs to be allocated but not initialized
         return AVERROR(EINVAL);
@@ -712,6 +716,40 @@ static int swr_convert_internal(struct SwrContext *s, AudioData *out, int out_co
     return out_count;
 }
 
+/**
+ * Convert count samples without resampling. Every stage then works sample
+ * by sample, so the conversion is done in blocks of SWR_BLOCK_SIZE samples
+ * instead of running each stage over the whole input in turn. Dithering
+ * keeps single calls, as its noise position depends on the call sizes.
+ *
+ * @return number of samples output per channel
+ */
+static int swr_convert_blocks(struct SwrContext *s, AudioData *out,
+                              AudioData *in, int count){
+    AudioData out_block, in_block;
+    int ret, done = 0;
+
+    if(s->dither.method || count <= SWR_BLOCK_SIZE)
+        return swr_convert_internal(s, out, count, in, count);
+
+    out_block = *out;
+    in_block  = *in;
+    while(done < count){
+        int size = FFMIN(count - done, SWR_BLOCK_SIZE);
+
+        ret = swr_convert_internal(s, &out_block, size, &in_block, size);
+        if(ret < 0)
+            return ret;
+        done += ret;
+        if(ret < size)
+            break;
+        buf_set(&out_block, &out_block, ret);
+        buf_set(&in_block , &in_block , ret);
+    }
+
+    return done;
+}
+
 int swr_is_initialized(struct SwrContext *s) {
     return !!s->in_buffer.ch_count;
 }
@@ -784,7 +822,7 @@ int attribute_align_arg swr_convert(struct SwrContext *s,
         size = FFMIN(out_count, s->in_buffer_count);
         if(size){
             buf_set(&tmp, &s->in_buffer, s->in_buffer_index);
-            ret= swr_convert_internal(s, out, size, &tmp, size);
+            ret= swr_convert_blocks(s, out, &tmp, size);
             if(ret<0)
                 return ret;
             ret2= ret;
@@ -812,7 +850,7 @@ int attribute_align_arg swr_convert(struct SwrContext *s,
 
             if(out_count){
                 size = FFMIN(in_count, out_count);
-                ret= swr_convert_internal(s, out, size, in, size);
+                ret= swr_convert_blocks(s, out, in, size);
                 if(ret<0)
                     return ret;
                 buf_set(in, in, ret);
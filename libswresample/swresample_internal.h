@@ -180,6 +180,8 @@ struct SwrContext {
     mix_2_1_func_type *mix_2_1_f;
     mix_2_1_func_type *mix_2_1_simd;
 
+    mix_1_1_func_type *mix_add_1_f;                 ///< out += coeff * in, NULL if the format needs a single final rounding
+
     mix_any_func_type *mix_any_f;
 
     /* TODO: callbacks for ASM optimizations */
@@ -33,6 +33,18 @@
 #include "swscale_internal.h"
 #include "graph.h"
 
+/* Approximate amount of intermediate data per thread that a tiled chain of
+ * passes keeps in flight, chosen to comfortably fit into L2 */
+#define TILE_BYTES (128 << 10)
+
+/* Slices queued per thread, so that threads finishing early can pick up
+ * the remaining work instead of idling at the end of each pass */
+#define SLICES_PER_THREAD 4
+
+/* Lower bound for slice heights, to keep the per-slice overhead (e.g. the
+ * input lines re-filtered by the vertical scaler) negligible */
+#define MIN_SLICE_H 16
+
 static int pass_alloc_output(SwsPass *pass)
 {
     if (!pass || pass->output.fmt != AV_PIX_FMT_NONE)
@@ -60,6 +72,7 @@ static SwsPass *pass_add(SwsGraph *graph, void *priv, enum AVPixelFormat fmt,
     pass->height = h;
     pass->input  = input;
     pass->output.fmt = AV_PIX_FMT_NONE;
+    pass->slice_align = slice_align;
 
     ret = pass_alloc_output(input);
     if (ret < 0) {
@@ -67,11 +80,22 @@ static SwsPass *pass_add(SwsGraph *graph, void *priv, enum AVPixelFormat fmt,
         return NULL;
     }
 
-    if (!slice_align) {
+    if (!slice_align || graph->num_threads == 1) {
         pass->slice_h = pass->height;
         pass->num_slices = 1;
     } else {
-        pass->slice_h = (pass->height + graph->num_threads - 1) / graph->num_threads;
+        /* slices must start on a line that exists in every plane */
+        const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(fmt);
+        enum AVPixelFormat in_fmt = input ? input->format : graph->src.format;
+        const AVPixFmtDescriptor *in_desc = av_pix_fmt_desc_get(in_fmt);
+        const int max_slices = graph->num_threads * SLICES_PER_THREAD;
+        slice_align = FFMAX(slice_align, 1 << desc->log2_chroma_h);
+        if (in_desc)
+            slice_align = FFMAX(slice_align, 1 << in_desc->log2_chroma_h);
+        pass->slice_align = slice_align;
+
+        pass->slice_h = (pass->height + max_slices - 1) / max_slices;
+        pass->slice_h = FFMAX(pass->slice_h, MIN_SLICE_H);
         pass->slice_h = FFALIGN(pass->slice_h, slice_align);
         pass->num_slices = (pass->height + pass->slice_h - 1) / pass->slice_h;
     }
@@ -110,7 +134,7 @@ static SwsImg shift_img(const SwsImg *img_base, int y)
 }
 
 static void run_copy(const SwsImg *out_base, const SwsImg *in_base,
-                     int y, int h, const SwsPass *pass)
+                     int y, int h, int thread, const SwsPass *pass)
 {
     SwsImg in  = shift_img(in_base,  y);
     SwsImg out = shift_img(out_base, y);
@@ -131,7 +155,7 @@ static void run_copy(const SwsImg *out_base, const SwsImg *in_base,
 }
 
 static void run_rgb0(const SwsImg *out, const SwsImg *in, int y, int h,
-                     const SwsPass *pass)
+                     int thread, const SwsPass *pass)
 {
     SwsInternal *c = pass->priv;
     const int x0 = c->src0Alpha - 1;
@@ -152,7 +176,7 @@ static void run_rgb0(const SwsImg *out, const SwsImg *in, int y, int h,
 }
 
 static void run_xyz2rgb(const SwsImg *out, const SwsImg *in, int y, int h,
-                        const SwsPass *pass)
+                        int thread, const SwsPass *pass)
 {
     ff_xyz12Torgb48(pass->priv, out->data[0] + y * out->linesize[0], out->linesize[0],
                     in->data[0] + y * in->linesize[0], in->linesize[0],
@@ -160,7 +184,7 @@ static void run_xyz2rgb(const SwsImg *out, const SwsImg *in, int y, int h,
 }
 
 static void run_rgb2xyz(const SwsImg *out, const SwsImg *in, int y, int h,
-                        const SwsPass *pass)
+                        int thread, const SwsPass *pass)
 {
     ff_rgb48Toxyz12(pass->priv, out->data[0] + y * out->linesize[0], out->linesize[0],
                     in->data[0] + y * in->linesize[0], in->linesize[0],
@@ -193,15 +217,15 @@ static void setup_legacy_swscale(const SwsImg *out, const SwsImg *in,
         ff_update_palette(c, (const uint32_t *) in->data[1]);
 }
 
-static inline SwsContext *slice_ctx(const SwsPass *pass, int y)
+static inline SwsContext *slice_ctx(const SwsPass *pass, int thread)
 {
     SwsContext *sws = pass->priv;
     SwsInternal *parent = sws_internal(sws);
-    if (pass->num_slices == 1)
+    if (!parent->nb_slice_ctx)
         return sws;
 
-    av_assert1(parent->nb_slice_ctx == pass->num_slices);
-    sws = parent->slice_ctx[y / pass->slice_h];
+    av_assert1(thread < parent->nb_slice_ctx);
+    sws = parent->slice_ctx[thread];
 
     if (usePal(sws->src_format)) {
         SwsInternal *sub = sws_internal(sws);
@@ -213,9 +237,9 @@ static inline SwsContext *slice_ctx(const SwsPass *pass, int y)
 }
 
 static void run_legacy_unscaled(const SwsImg *out, const SwsImg *in_base,
-                                int y, int h, const SwsPass *pass)
+                                int y, int h, int thread, const SwsPass *pass)
 {
-    SwsContext *sws = slice_ctx(pass, y);
+    SwsContext *sws = slice_ctx(pass, thread);
     SwsInternal *c = sws_internal(sws);
     const SwsImg in = shift_img(in_base, y);
 
@@ -224,9 +248,9 @@ static void run_legacy_unscaled(const SwsImg *out, const SwsImg *in_base,
 }
 
 static void run_legacy_swscale(const SwsImg *out_base, const SwsImg *in,
-                               int y, int h, const SwsPass *pass)
+                               int y, int h, int thread, const SwsPass *pass)
 {
-    SwsContext *sws = slice_ctx(pass, y);
+    SwsContext *sws = slice_ctx(pass, thread);
     SwsInternal *c = sws_internal(sws);
     const SwsImg out = shift_img(out_base, y);
 
@@ -323,12 +347,14 @@ static int init_legacy_subpass(SwsGraph *graph, SwsContext *sws, int cascaded,
         ret = pass_append(graph, c, AV_PIX_FMT_RGBA, src_w, src_h, &input, 1, run_rgb0);
         if (ret < 0)
             return ret;
+        input->row_local = 1;
     }
 
     if (c->srcXYZ && !(c->dstXYZ && unscaled)) {
         ret = pass_append(graph, c, AV_PIX_FMT_RGB48, src_w, src_h, &input, 1, run_xyz2rgb);
         if (ret < 0)
             return ret;
+        input->row_local = 1;
     }
 
     pass = pass_add(graph, sws, sws->dst_format, dst_w, dst_h, input, align,
@@ -336,6 +362,7 @@ static int init_legacy_subpass(SwsGraph *graph, SwsContext *sws, int cascaded,
     if (!pass)
         return AVERROR(ENOMEM);
     pass->setup = setup_legacy_swscale;
+    pass->row_local = !!c->convert_unscaled;
     if (!cascaded) /* parent context frees this automatically */
         pass->free = free_legacy_swscale;
 
@@ -347,11 +374,13 @@ static int init_legacy_subpass(SwsGraph *graph, SwsContext *sws, int cascaded,
      */
 
     if (pass->num_slices > 1) {
-        c->slice_ctx = av_calloc(pass->num_slices, sizeof(*c->slice_ctx));
+        /* slices are claimed dynamically, so each thread needs its own */
+        const int nb_ctx = FFMIN(pass->num_slices, graph->num_threads);
+        c->slice_ctx = av_calloc(nb_ctx, sizeof(*c->slice_ctx));
         if (!c->slice_ctx)
             return AVERROR(ENOMEM);
 
-        for (int i = 0; i < pass->num_slices; i++) {
+        for (int i = 0; i < nb_ctx; i++) {
             SwsContext *slice;
             SwsInternal *c2;
             slice = c->slice_ctx[i] = sws_alloc_context();
@@ -386,6 +415,7 @@ static int init_legacy_subpass(SwsGraph *graph, SwsContext *sws, int cascaded,
         ret = pass_append(graph, c, AV_PIX_FMT_RGB48, dst_w, dst_h, &pass, 1, run_rgb2xyz);
         if (ret < 0)
             return ret;
+        pass->row_local = 1;
     }
 
     *output = pass;
@@ -487,11 +517,129 @@ static int init_passes(SwsGraph *graph)
         pass = pass_add(graph, NULL, dst.format, dst.width, dst.height, pass, 1, run_copy);
         if (!pass)
             return AVERROR(ENOMEM);
+        pass->row_local = 1;
     }
 
     return 0;
 }
 
+static int can_fuse(const SwsGraph *graph, const SwsPass *a, const SwsPass *b)
+{
+    if (b->input != a || !a->row_local || !b->row_local)
+        return 0;
+    if (!a->slice_align || !b->slice_align)
+        return 0;
+    if (a->height != b->height || a->slice_h != b->slice_h ||
+        a->num_slices != b->num_slices)
+        return 0;
+
+    /* the intermediate must not be needed by any other pass */
+    for (int i = 0; i < graph->num_passes; i++) {
+        const SwsPass *pass = graph->passes[i];
+        if (pass != b && pass->input == a)
+            return 0;
+    }
+
+    return 1;
+}
+
+static int init_tiles(SwsGraph *graph, SwsPass *first)
+{
+    int align = 1, row_bytes = 0;
+    int ret;
+
+    for (const SwsPass *pass = first; pass; pass = pass->fused_next) {
+        const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(pass->format);
+        align = FFMAX(align, pass->slice_align);
+        if (pass->fused_next) {
+            int linesize[4];
+            ret = av_image_fill_linesizes(linesize, pass->format, pass->width);
+            if (ret < 0)
+                return ret;
+            align = FFMAX(align, 1 << desc->log2_chroma_h);
+            for (int i = 0; i < 4; i++)
+                row_bytes += FFALIGN(linesize[i], 64);
+        }
+    }
+
+    first->tile_h = FFMAX(TILE_BYTES / FFMAX(row_bytes, 1), align);
+    first->tile_h = FFMIN(first->tile_h & ~(align - 1), first->slice_h);
+
+    for (SwsPass *pass = first; pass->fused_next; pass = pass->fused_next) {
+        /* replace the full frame intermediate by one tile per thread */
+        if (pass->output.fmt != AV_PIX_FMT_NONE) {
+            av_freep(&pass->output.data[0]);
+            pass->output.fmt = AV_PIX_FMT_NONE;
+        }
+
+        pass->tiles = av_calloc(graph->num_threads, sizeof(*pass->tiles));
+        if (!pass->tiles)
+            return AVERROR(ENOMEM);
+
+        for (int i = 0; i < graph->num_threads; i++) {
+            SwsImg *tile = &pass->tiles[i];
+            ret = av_image_alloc(tile->data, tile->linesize, pass->width,
+                                 first->tile_h, pass->format, 64);
+            if (ret < 0)
+                return ret;
+            tile->fmt = pass->format;
+        }
+    }
+
+    return 0;
+}
+
+/* Chain consecutive row-local passes, so they are run tile by tile */
+static int fuse_passes(SwsGraph *graph)
+{
+    int ret;
+
+    for (int i = 1; i < graph->num_passes; i++) {
+        SwsPass *prev = graph->passes[i - 1];
+        SwsPass *pass = graph->passes[i];
+        if (can_fuse(graph, prev, pass)) {
+            prev->fused_next = pass;
+            pass->fused = 1;
+        }
+    }
+
+    for (int i = 0; i < graph->num_passes; i++) {
+        SwsPass *pass = graph->passes[i];
+        if (pass->fused || !pass->fused_next)
+            continue;
+        ret = init_tiles(graph, pass);
+        if (ret < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+static void run_fused(const SwsGraph *graph, const SwsPass *first, int jobnr,
+                      int threadnr)
+{
+    const int slice_y   = jobnr * first->slice_h;
+    const int slice_end = FFMIN(slice_y + first->slice_h, first->height);
+
+    for (int y = slice_y; y < slice_end; y += first->tile_h) {
+        const int h = FFMIN(first->tile_h, slice_end - y);
+        SwsImg in = first->input ? first->input->output : graph->exec.input;
+
+        for (const SwsPass *pass = first; pass; pass = pass->fused_next) {
+            SwsImg out;
+            if (pass->fused_next) {
+                /* make line y land on the first line of the tile */
+                out = shift_img(&pass->tiles[threadnr], -y);
+            } else {
+                out = pass->output.fmt != AV_PIX_FMT_NONE ? pass->output
+                                                          : graph->exec.output;
+            }
+            pass->run(&out, &in, y, h, threadnr, pass);
+            in = out;
+        }
+    }
+}
+
 static void sws_graph_worker(void *priv, int jobnr, int threadnr, int nb_jobs,
                              int nb_threads)
 {
@@ -502,7 +650,12 @@ static void sws_graph_worker(void *priv, int jobnr, int threadnr, int nb_jobs,
     const int slice_y = jobnr * pass->slice_h;
     const int slice_h = FFMIN(pass->slice_h, pass->height - slice_y);
 
-    pass->run(output, input, slice_y, slice_h, pass);
+    if (pass->fused_next) {
+        run_fused(graph, pass, jobnr, threadnr);
+        return;
+    }
+
+    pass->run(output, input, slice_y, slice_h, threadnr, pass);
 }
 
 int sws_graph_create(SwsContext *ctx, const SwsFormat *dst, const SwsFormat *src,
@@ -535,6 +688,10 @@ int sws_graph_create(SwsContext *ctx, const SwsFormat *dst, const SwsFormat *src
     if (ret < 0)
         goto error;
 
+    ret = fuse_passes(graph);
+    if (ret < 0)
+        goto error;
+
     *out_graph = graph;
     return 0;
 
@@ -557,6 +714,11 @@ void sws_graph_free(SwsGraph **pgraph)
             pass->free(pass->priv);
         if (pass->output.fmt != AV_PIX_FMT_NONE)
             av_free(pass->output.data[0]);
+        if (pass->tiles) {
+            for (int j = 0; j < graph->num_threads; j++)
+                av_free(pass->tiles[j].data[0]);
+            av_free(pass->tiles);
+        }
         av_free(pass);
     }
     av_free(graph->passes);
@@ -609,9 +771,13 @@ void sws_graph_run(SwsGraph *graph, uint8_t *const out_data[4],
 
     for (int i = 0; i < graph->num_passes; i++) {
         const SwsPass *pass = graph->passes[i];
+        if (pass->fused)
+            continue; /* run together with the first pass of its chain */
         graph->exec.pass = pass;
-        if (pass->setup)
-            pass->setup(out, in, pass);
+        for (const SwsPass *p = pass; p; p = p->fused_next) {
+            if (p->setup)
+                p->setup(out, in, p);
+        }
         avpriv_slicethread_execute(graph->slicethread, pass->num_slices, 0);
     }
 }
@@ -39,10 +39,12 @@ typedef struct SwsGraph SwsGraph;
 
 /**
  * Output `h` lines of filtered data. `out` and `in` point to the
- * start of the image buffer for this pass.
+ * start of the image buffer for this pass. `thread` is the index of the
+ * calling thread, below SwsGraph.num_threads, and may be used to select
+ * per-thread scratch state.
  */
 typedef void (*sws_filter_run_t)(const SwsImg *out, const SwsImg *in,
-                                 int y, int h, const SwsPass *pass);
+                                 int y, int h, int thread, const SwsPass *pass);
 
 /**
  * Represents a single filter pass in the scaling graph. Each filter will
@@ -56,13 +58,23 @@ struct SwsPass {
      * Filter main execution function. Called from multiple threads, with
      * the granularity dictated by `slice_h`. Individual slices sent to `run`
      * are always equal to (or smaller than, for the last slice) `slice_h`.
+     * There are several slices per thread; they are claimed dynamically by
+     * whichever thread becomes idle first, in no particular order.
      */
     sws_filter_run_t run;
     enum AVPixelFormat format; /* new pixel format */
     int width, height; /* new output size */
     int slice_h;       /* filter granularity */
+    int slice_align;   /* alignment of slice_h, or 0 if not slice threaded */
     int num_slices;
 
+    /**
+     * Set if output lines only depend on the same input lines (rounded to
+     * the chroma subsampling), i.e. the pass can also be run on lines of
+     * an intermediate whose earlier lines no longer exist.
+     */
+    int row_local;
+
     /**
      * Filter input. This pass's output will be resolved to form this pass's.
      * input. If NULL, the original input image is used.
@@ -74,6 +86,18 @@ struct SwsPass {
      */
     SwsImg output;
 
+    /**
+     * Passes fused into a single tiled execution: each slice of the first
+     * pass is processed in tiles of `tile_h` lines, running the whole chain
+     * over one tile before moving on to the next. The output of every pass
+     * except the last only exists as a tile sized buffer per thread, instead
+     * of a full frame, so it stays in the cache until it is consumed.
+     */
+    SwsPass *fused_next; /* next pass in the fused chain, if any */
+    int fused;           /* set if this pass is run as part of a previous one */
+    int tile_h;          /* tile height, set on the first pass of a chain */
+    SwsImg *tiles;       /* intermediate output, one tile per thread */
+
     /**
      * Called once from the main thread before running the filter. Optional.
      * `out` and `in` always point to the main image input/output, regardless
@@ -430,6 +430,150 @@ static const ScaleAlgorithm scale_algorithms[] = {
     { SWS_X,             "experimental",                    8 },
 };
 
+/**
+ * Process-wide cache of the filters built by initFilter(), so that contexts
+ * created with the same parameters skip the coefficient computation. Each
+ * context gets its own copy of the tables, which it may modify.
+ * The entries hold at most FILTER_CACHE_MAX_SIZE bytes in total, and are
+ * all released when the last context is freed.
+ */
+#define FILTER_CACHE_ENTRIES  32
+#define FILTER_CACHE_MAX_SIZE (4 << 20)
+
+typedef struct FilterCacheKey {
+    double param[2];
+    int xInc, srcW, dstW;
+    int filterAlign, one;
+    int flags, cpu_flags;
+    int srcPos, dstPos;
+} FilterCacheKey;
+
+typedef struct FilterCacheEntry {
+    FilterCacheKey key;
+    int16_t *filter;
+    int32_t *filterPos;
+    int filterSize;
+    size_t size;
+    unsigned last_use;
+} FilterCacheEntry;
+
+static AVMutex filter_cache_mutex = AV_MUTEX_INITIALIZER;
+static FilterCacheEntry filter_cache[FILTER_CACHE_ENTRIES];
+static unsigned filter_cache_clock;
+static size_t filter_cache_size;
+static unsigned filter_cache_users;  ///< number of allocated contexts
+
+static size_t filter_cache_filter_size(const FilterCacheKey *key, int filterSize)
+{
+    return (size_t)filterSize * (key->dstW + 3) * sizeof(int16_t);
+}
+
+/* Must be called with filter_cache_mutex held. */
+static void filter_cache_entry_free(FilterCacheEntry *e)
+{
+    filter_cache_size -= e->size;
+    av_freep(&e->filter);
+    av_freep(&e->filterPos);
+    e->size = 0;
+}
+
+static void filter_cache_ref(void)
+{
+    ff_mutex_lock(&filter_cache_mutex);
+    filter_cache_users++;
+    ff_mutex_unlock(&filter_cache_mutex);
+}
+
+static void filter_cache_unref(void)
+{
+    ff_mutex_lock(&filter_cache_mutex);
+    if (!--filter_cache_users) {
+        for (int i = 0; i < FILTER_CACHE_ENTRIES; i++)
+            filter_cache_entry_free(&filter_cache[i]);
+    }
+    ff_mutex_unlock(&filter_cache_mutex);
+}
+
+static av_cold int filter_cache_get(const FilterCacheKey *key, int16_t **outFilter,
+                                    int32_t **filterPos, int *outFilterSize)
+{
+    int ret = AVERROR(ENOENT);
+
+    ff_mutex_lock(&filter_cache_mutex);
+    for (int i = 0; i < FILTER_CACHE_ENTRIES; i++) {
+        FilterCacheEntry *e = &filter_cache[i];
+        if (!e->filter || memcmp(&e->key, key, sizeof(*key)))
+            continue;
+
+        *filterPos = av_memdup(e->filterPos, (key->dstW + 3) * sizeof(**filterPos));
+        *outFilter = av_memdup(e->filter, filter_cache_filter_size(key, e->filterSize));
+        if (!*filterPos || !*outFilter) {
+            av_freep(filterPos);
+            av_freep(outFilter);
+            ret = AVERROR(ENOMEM);
+            break;
+        }
+        *outFilterSize = e->filterSize;
+        e->last_use    = ++filter_cache_clock;
+        ret = 0;
+        break;
+    }
+    ff_mutex_unlock(&filter_cache_mutex);
+
+    return ret;
+}
+
+static av_cold void filter_cache_add(const FilterCacheKey *key, const int16_t *filter,
+                                     const int32_t *filterPos, int filterSize)
+{
+    const size_t size = filter_cache_filter_size(key, filterSize) +
+                        (key->dstW + 3) * sizeof(*filterPos);
+    FilterCacheEntry *e;
+    int16_t *new_filter;
+    int32_t *new_pos;
+
+    if (size > FILTER_CACHE_MAX_SIZE)
+        return;
+
+    new_filter = av_memdup(filter, filter_cache_filter_size(key, filterSize));
+    new_pos    = av_memdup(filterPos, (key->dstW + 3) * sizeof(*filterPos));
+    if (!new_filter || !new_pos) {
+        av_free(new_filter);
+        av_free(new_pos);
+        return;
+    }
+
+    ff_mutex_lock(&filter_cache_mutex);
+    /* drop the least recently used entries until the new one fits */
+    while (filter_cache_size + size > FILTER_CACHE_MAX_SIZE) {
+        FilterCacheEntry *lru = NULL;
+        for (int i = 0; i < FILTER_CACHE_ENTRIES; i++)
+            if (filter_cache[i].filter &&
+                (!lru || filter_cache[i].last_use < lru->last_use))
+                lru = &filter_cache[i];
+        filter_cache_entry_free(lru);
+    }
+    /* take a free slot or replace the least recently used entry */
+    e = &filter_cache[0];
+    for (int i = 0; i < FILTER_CACHE_ENTRIES; i++) {
+        if (!filter_cache[i].filter) {
+            e = &filter_cache[i];
+            break;
+        }
+        if (filter_cache[i].last_use < e->last_use)
+            e = &filter_cache[i];
+    }
+    filter_cache_entry_free(e);
+    e->key        = *key;
+    e->filter     = new_filter;
+    e->filterPos  = new_pos;
+    e->filterSize = filterSize;
+    e->size       = size;
+    e->last_use   = ++filter_cache_clock;
+    filter_cache_size += size;
+    ff_mutex_unlock(&filter_cache_mutex);
+}
+
 static av_cold int initFilter(int16_t **outFilter, int32_t **filterPos,
                               int *outFilterSize, int xInc, int srcW,
                               int dstW, int filterAlign, int one,
@@ -445,9 +589,32 @@ static av_cold int initFilter(int16_t **outFilter, int32_t **filterPos,
     int64_t *filter2   = NULL;
     const int64_t fone = 1LL << (54 - FFMIN(av_log2(srcW/dstW), 8));
     int ret            = -1;
+    /* filters with custom vectors are not cached */
+    const int cacheable = !srcFilter && !dstFilter;
+    FilterCacheKey key;
 
     emms_c(); // FIXME should not be required but IS (even for non-MMX versions)
 
+    if (cacheable) {
+        memset(&key, 0, sizeof(key));
+        key.param[0]    = param[0];
+        key.param[1]    = param[1];
+        key.xInc        = xInc;
+        key.srcW        = srcW;
+        key.dstW        = dstW;
+        key.filterAlign = filterAlign;
+        key.one         = one;
+        key.flags       = flags;
+        key.cpu_flags   = cpu_flags;
+        key.srcPos      = srcPos;
+        key.dstPos      = dstPos;
+
+        ret = filter_cache_get(&key, outFilter, filterPos, outFilterSize);
+        if (ret != AVERROR(ENOENT))
+            return ret;
+        ret = -1;
+    }
+
     // NOTE: the +3 is for the MMX(+1) / SSE(+3) scaler which reads over the end
     if (!FF_ALLOC_TYPED_ARRAY(*filterPos, dstW + 3))
         goto nomem;
@@ -826,6 +993,9 @@ static av_cold int initFilter(int16_t **outFilter, int32_t **filterPos,
         (*outFilter)[k + 3 * (*outFilterSize)] = (*outFilter)[k];
     }
 
+    if (cacheable)
+        filter_cache_add(&key, *outFilter, *filterPos, *outFilterSize);
+
     ret = 0;
     goto done;
 nomem:
@@ -1234,6 +1404,7 @@ SwsContext *sws_alloc_context(void)
     av_opt_set_defaults(c);
     atomic_init(&c->stride_unaligned_warned, 0);
     atomic_init(&c->data_unaligned_warned,   0);
+    filter_cache_ref();
 
     return &c->opts;
 }
@@ -2521,6 +2692,7 @@ void sws_freeContext(SwsContext *sws)
     ff_free_filters(c);
 
     av_free(c);
+    filter_cache_unref();
 }
 
 void sws_free_context(SwsContext **pctx)
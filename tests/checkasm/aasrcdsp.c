@@ -0,0 +1,132 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#include "libavfilter/aasrcdsp.h"
+#include "libavutil/mem_internal.h"
+#include "checkasm.h"
+
+#define N (2 * AASRC_NB_POLES)
+#define LEN 37
+
+static double randd(void)
+{
+    return (rnd() & 0xFFFF) / 32767.5 - 1.0;
+}
+
+#define TEST_FUNCS(ftype, name, eps, near_array)                                    \
+static void test_filter_##name(AASRCDSPContext *dsp)                                \
+{                                                                                   \
+    LOCAL_ALIGNED_32(ftype, poles, [N]);                                            \
+    LOCAL_ALIGNED_32(ftype, src, [LEN + 1]);                                        \
+    LOCAL_ALIGNED_32(ftype, state, [N]);                                            \
+    LOCAL_ALIGNED_32(ftype, state_ref, [N]);                                        \
+    LOCAL_ALIGNED_32(ftype, state_new, [N]);                                        \
+    LOCAL_ALIGNED_32(ftype, hat_ref, [LEN * N]);                                    \
+    LOCAL_ALIGNED_32(ftype, hat_new, [LEN * N]);                                    \
+                                                                                    \
+    declare_func(void, ftype *hat, ftype *state, const ftype *poles,                \
+                 const ftype *src, int len);                                        \
+                                                                                    \
+    /* stable poles, as set up by the filter */                                     \
+    for (int k = 0; k < AASRC_NB_POLES; k++) {                                      \
+        poles[k] = randd() * 0.7;                                                   \
+        poles[AASRC_NB_POLES + k] = randd() * 0.7;                                  \
+    }                                                                               \
+    for (int i = 0; i < N; i++)                                                     \
+        state[i] = randd();                                                         \
+    for (int i = 0; i <= LEN; i++)                                                  \
+        src[i] = randd();                                                           \
+                                                                                    \
+    if (check_func(dsp->filter_##name, "filter_" #name)) {                          \
+        memcpy(state_ref, state, sizeof(*state) * N);                               \
+        memcpy(state_new, state, sizeof(*state) * N);                               \
+        /* the input planes of a frame need not be aligned */                       \
+        call_ref(hat_ref, state_ref, poles, src + 1, LEN);                          \
+        call_new(hat_new, state_new, poles, src + 1, LEN);                          \
+        if (!near_array(hat_ref, hat_new, eps, LEN * N) ||                          \
+            !near_array(state_ref, state_new, eps, N))                              \
+            fail();                                                                 \
+        bench_new(hat_new, state_new, poles, src, LEN);                             \
+    }                                                                               \
+                                                                                    \
+    report("filter_" #name);                                                        \
+}                                                                                   \
+                                                                                    \
+static void test_interp_##name(AASRCDSPContext *dsp)                                \
+{                                                                                   \
+    LOCAL_ALIGNED_32(ftype, steps, [3 * N]);                                        \
+    LOCAL_ALIGNED_32(ftype, hat, [LEN * N]);                                        \
+    LOCAL_ALIGNED_32(ftype, phasors, [N]);                                          \
+    LOCAL_ALIGNED_32(ftype, phasors_ref, [N]);                                      \
+    LOCAL_ALIGNED_32(ftype, phasors_new, [N]);                                      \
+    ftype dst_ref[LEN], dst_new[LEN];                                               \
+    const ftype *h[LEN], *adv[LEN];                                                 \
+                                                                                    \
+    declare_func(void, ftype *dst, const ftype *const *h,                           \
+                 const ftype *const *adv, ftype *phasors, int len);                 \
+                                                                                    \
+    /* steps of unit magnitude keep the phasors bounded */                          \
+    for (int i = 0; i < 3; i++) {                                                   \
+        for (int k = 0; k < AASRC_NB_POLES; k++) {                                  \
+            const double phi = randd() * M_PI;                                      \
+                                                                                    \
+            steps[i * N + k] = cos(phi);                                            \
+            steps[i * N + AASRC_NB_POLES + k] = sin(phi);                           \
+        }                                                                           \
+    }                                                                               \
+    for (int i = 0; i < LEN * N; i++)                                               \
+        hat[i] = randd();                                                           \
+    for (int i = 0; i < N; i++)                                                     \
+        phasors[i] = randd();                                                       \
+    for (int n = 0; n < LEN; n++) {                                                 \
+        h[n] = hat + (rnd() % LEN) * N;                                             \
+        adv[n] = steps + (rnd() % 3) * N;                                           \
+    }                                                                               \
+                                                                                    \
+    if (check_func(dsp->interp_##name, "interp_" #name)) {                          \
+        memcpy(phasors_ref, phasors, sizeof(*phasors) * N);                         \
+        memcpy(phasors_new, phasors, sizeof(*phasors) * N);                         \
+        call_ref(dst_ref, h, adv, phasors_ref, LEN);                                \
+        call_new(dst_new, h, adv, phasors_new, LEN);                                \
+        if (!near_array(dst_ref, dst_new, eps, LEN) ||                              \
+            !near_array(phasors_ref, phasors_new, eps, N))                          \
+            fail();                                                                 \
+        bench_new(dst_new, h, adv, phasors_new, 32);                                \
+    }                                                                               \
+                                                                                    \
+    report("interp_" #name);                                                        \
+}
+
+TEST_FUNCS(float,  float,  64 * FLT_EPSILON, float_near_abs_eps_array)
+TEST_FUNCS(double, double, 64 * DBL_EPSILON, double_near_abs_eps_array)
+
+void checkasm_check_aasrcdsp(void)
+{
+    AASRCDSPContext dsp = { 0 };
+
+    ff_aasrc_init(&dsp);
+
+    test_filter_float(&dsp);
+    test_filter_double(&dsp);
+    test_interp_float(&dsp);
+    test_interp_double(&dsp);
+}
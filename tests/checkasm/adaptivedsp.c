@@ -0,0 +1,170 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <float.h>
+#include <string.h>
+
+#include "libavfilter/adaptivedsp.h"
+#include "libavutil/mem_internal.h"
+#include "checkasm.h"
+
+#define LEN 67
+#define BUF_SIZE (LEN + 1)
+
+static const int lens[] = { 1, 3, 8, 13, 16, 31, LEN };
+
+static double randd(void)
+{
+    return (rnd() & 0xFFFF) / 32767.5 - 1.0;
+}
+
+#define TEST_FUNCS(ftype, name, eps, near, near_array)                              \
+static void test_dot_##name(AudioAdaptiveDSPContext *dsp)                           \
+{                                                                                   \
+    LOCAL_ALIGNED_32(ftype, a, [BUF_SIZE]);                                         \
+    LOCAL_ALIGNED_32(ftype, b, [BUF_SIZE]);                                         \
+    ftype ref, new;                                                                 \
+                                                                                    \
+    declare_func_float(ftype, const ftype *a, const ftype *b, int len);            \
+                                                                                    \
+    for (int i = 0; i < BUF_SIZE; i++) {                                            \
+        a[i] = randd();                                                             \
+        b[i] = randd();                                                             \
+    }                                                                               \
+                                                                                    \
+    if (check_func(dsp->dot_##name, "dot_" #name)) {                                \
+        for (int n = 0; n < FF_ARRAY_ELEMS(lens); n++) {                            \
+            const int len = lens[n];                                                \
+                                                                                    \
+            /* the delay line windows are not aligned */                            \
+            ref = call_ref(a + 1, b, len);                                          \
+            new = call_new(a + 1, b, len);                                          \
+            if (!near(ref, new, eps)) {                                             \
+                fprintf(stderr, "%d: %- .12f - %- .12f = % .12g\n",                 \
+                        len, (double)ref, (double)new, (double)(ref - new));        \
+                fail();                                                             \
+                break;                                                              \
+            }                                                                       \
+        }                                                                           \
+        bench_new(a, b, LEN);                                                       \
+    }                                                                               \
+                                                                                    \
+    report("dot_" #name);                                                           \
+}                                                                                   \
+                                                                                    \
+static void test_axpy_##name(AudioAdaptiveDSPContext *dsp)                          \
+{                                                                                   \
+    LOCAL_ALIGNED_32(ftype, x, [BUF_SIZE]);                                         \
+    LOCAL_ALIGNED_32(ftype, y, [BUF_SIZE]);                                         \
+    LOCAL_ALIGNED_32(ftype, ref, [BUF_SIZE]);                                       \
+    LOCAL_ALIGNED_32(ftype, new, [BUF_SIZE]);                                       \
+    const ftype a = randd();                                                        \
+                                                                                    \
+    declare_func(void, ftype *y, const ftype *x, ftype a, int len);                 \
+                                                                                    \
+    for (int i = 0; i < BUF_SIZE; i++) {                                            \
+        x[i] = randd();                                                             \
+        y[i] = randd();                                                             \
+    }                                                                               \
+                                                                                    \
+    if (check_func(dsp->axpy_##name, "axpy_" #name)) {                              \
+        for (int n = 0; n < FF_ARRAY_ELEMS(lens); n++) {                            \
+            const int len = lens[n];                                                \
+                                                                                    \
+            memcpy(ref, y, sizeof(*y) * BUF_SIZE);                                  \
+            memcpy(new, y, sizeof(*y) * BUF_SIZE);                                  \
+            call_ref(ref, x + 1, a, len);                                           \
+            call_new(new, x + 1, a, len);                                           \
+            if (!near_array(ref, new, eps, BUF_SIZE)) {                             \
+                fail();                                                             \
+                break;                                                              \
+            }                                                                       \
+        }                                                                           \
+        bench_new(new, x, a, LEN);                                                  \
+    }                                                                               \
+                                                                                    \
+    report("axpy_" #name);                                                          \
+}                                                                                   \
+                                                                                    \
+static void test_rank1_##name(AudioAdaptiveDSPContext *dsp)                         \
+{                                                                                   \
+    LOCAL_ALIGNED_32(ftype, m, [LEN * BUF_SIZE]);                                   \
+    LOCAL_ALIGNED_32(ftype, ref, [LEN * BUF_SIZE]);                                 \
+    LOCAL_ALIGNED_32(ftype, new, [LEN * BUF_SIZE]);                                 \
+    LOCAL_ALIGNED_32(ftype, u, [BUF_SIZE]);                                         \
+    LOCAL_ALIGNED_32(ftype, v, [BUF_SIZE]);                                         \
+    const ftype scale = randd(), mul = randd();                                     \
+                                                                                    \
+    declare_func(void, ftype *A, ptrdiff_t stride, const ftype *u, const ftype *v,  \
+                 ftype s, ftype a, int rows, int len);                              \
+                                                                                    \
+    for (int i = 0; i < LEN; i++) {                                                 \
+        for (int k = 0; k <= i; k++)                                                \
+            m[i * BUF_SIZE + k + 1] = m[k * BUF_SIZE + i + 1] = randd();            \
+        m[i * BUF_SIZE] = randd();                                                  \
+    }                                                                               \
+    for (int i = 0; i < BUF_SIZE; i++) {                                            \
+        u[i] = randd();                                                             \
+        v[i] = randd();                                                             \
+    }                                                                               \
+                                                                                    \
+    if (check_func(dsp->rank1_##name, "rank1_" #name)) {                            \
+        for (int n = 0; n < FF_ARRAY_ELEMS(lens); n++) {                            \
+            const int len = lens[n];                                                \
+                                                                                    \
+            memcpy(ref, m, sizeof(*m) * LEN * BUF_SIZE);                            \
+            memcpy(new, m, sizeof(*m) * LEN * BUF_SIZE);                            \
+            call_ref(ref + 1, BUF_SIZE, u, v, scale, mul, len, len);                \
+            call_new(new + 1, BUF_SIZE, u, v, scale, mul, len, len);                \
+            if (!near_array(ref, new, eps, LEN * BUF_SIZE)) {                       \
+                fail();                                                             \
+                break;                                                              \
+            }                                                                       \
+                                                                                    \
+            /* the filters rely on the update keeping a matrix symmetric */         \
+            memcpy(new, m, sizeof(*m) * LEN * BUF_SIZE);                            \
+            call_new(new + 1, BUF_SIZE, u, u, scale, mul, len, len);                \
+            for (int i = 0; i < len; i++) {                                         \
+                for (int k = 0; k < i; k++) {                                       \
+                    if (new[i * BUF_SIZE + k + 1] != new[k * BUF_SIZE + i + 1])     \
+                        fail();                                                     \
+                }                                                                   \
+            }                                                                       \
+        }                                                                           \
+        bench_new(new, BUF_SIZE, u, v, scale, mul, LEN, LEN);                       \
+    }                                                                               \
+                                                                                    \
+    report("rank1_" #name);                                                         \
+}
+
+TEST_FUNCS(float,  float,  LEN * 2 * FLT_EPSILON, float_near_abs_eps,  float_near_abs_eps_array)
+TEST_FUNCS(double, double, LEN * 2 * DBL_EPSILON, double_near_abs_eps, double_near_abs_eps_array)
+
+void checkasm_check_adaptivedsp(void)
+{
+    AudioAdaptiveDSPContext dsp = { 0 };
+
+    ff_adaptive_init(&dsp);
+
+    test_dot_float(&dsp);
+    test_dot_double(&dsp);
+    test_axpy_float(&dsp);
+    test_axpy_double(&dsp);
+    test_rank1_float(&dsp);
+    test_rank1_double(&dsp);
+}
@@ -0,0 +1,109 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "libavfilter/af_anlmdndsp.h"
+#include "libavutil/mem_internal.h"
+#include "checkasm.h"
+
+#define MAX_K 96
+#define MAX_S 64
+#define BUF_LEN (4 * (MAX_K + MAX_S) + 64)
+
+static float randf(void)
+{
+    return (rnd() & 0xFFFF) / 65535.f * 2.f - 1.f;
+}
+
+static void test_compute_distance_ssd(const AudioNLMDNDSPContext *dsp)
+{
+    LOCAL_ALIGNED_32(float, buf, [BUF_LEN]);
+    static const int sizes[] = { 1, 2, 3, 7, 8, 24, MAX_K };
+    float ref, new;
+
+    declare_func_float(float, const float *f1, const float *f2, ptrdiff_t K);
+
+    for (int i = 0; i < BUF_LEN; i++)
+        buf[i] = randf();
+
+    for (int n = 0; n < FF_ARRAY_ELEMS(sizes); n++) {
+        const int K = sizes[n];
+        /* the patches are centered on f1 and f2 and span 2 * K + 1 samples */
+        const float *f1 = buf + MAX_K + 1;
+        const float *f2 = buf + 3 * MAX_K + (rnd() & 31);
+
+        if (check_func(dsp->compute_distance_ssd, "compute_distance_ssd_%d", K)) {
+            ref = call_ref(f1, f2, K);
+            new = call_new(f1, f2, K);
+            if (!float_near_abs_eps(ref, new, fabsf(ref) * 1e-5f)) {
+                fprintf(stderr, "K=%d: %- .12f - %- .12f = % .12g\n",
+                        K, ref, new, ref - new);
+                fail();
+            }
+            bench_new(f1, f2, K);
+        }
+    }
+
+    report("compute_distance_ssd");
+}
+
+static void test_compute_cache(const AudioNLMDNDSPContext *dsp)
+{
+    LOCAL_ALIGNED_32(float, f, [BUF_LEN]);
+    LOCAL_ALIGNED_32(float, cache, [MAX_S]);
+    LOCAL_ALIGNED_32(float, cache_ref, [MAX_S]);
+    LOCAL_ALIGNED_32(float, cache_new, [MAX_S]);
+    const ptrdiff_t K = 24, S = MAX_S;
+    const ptrdiff_t i = K + 1 + 2 * S;
+
+    declare_func(void, float *cache, const float *f, ptrdiff_t S, ptrdiff_t K,
+                 ptrdiff_t i, ptrdiff_t jj);
+
+    for (int n = 0; n < BUF_LEN; n++)
+        f[n] = randf();
+    for (int n = 0; n < MAX_S; n++)
+        cache[n] = fabsf(randf()) * 2 * K;
+
+    /* the two calls made per sample: the window before and after i */
+    for (int side = 0; side < 2; side++) {
+        const ptrdiff_t jj = side ? i + 1 : i - S;
+
+        if (check_func(dsp->compute_cache, "compute_cache_%s", side ? "after" : "before")) {
+            memcpy(cache_ref, cache, sizeof(*cache) * S);
+            memcpy(cache_new, cache, sizeof(*cache) * S);
+            call_ref(cache_ref, f, S, K, i, jj);
+            call_new(cache_new, f, S, K, i, jj);
+            if (!float_near_abs_eps_array(cache_ref, cache_new, 1e-5f, S))
+                fail();
+            bench_new(cache_new, f, S, K, i, jj);
+        }
+    }
+
+    report("compute_cache");
+}
+
+void checkasm_check_af_anlmdn(void)
+{
+    AudioNLMDNDSPContext dsp = { 0 };
+
+    ff_anlmdn_init(&dsp);
+    test_compute_distance_ssd(&dsp);
+    test_compute_cache(&dsp);
+}
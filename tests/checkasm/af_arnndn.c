@@ -0,0 +1,109 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <float.h>
+
+#include "libavfilter/af_arnndndsp.h"
+#include "libavutil/mem_internal.h"
+#include "checkasm.h"
+
+#define LEN 120
+
+#define EPS (LEN * 2 * FLT_EPSILON)
+
+static float randf(void)
+{
+    return (rnd() & 0xFFFF) / 32767.5f - 1.f;
+}
+
+static void test_dot(AudioRNNDSPContext *dsp)
+{
+    LOCAL_ALIGNED_32(float, w, [LEN]);
+    LOCAL_ALIGNED_32(float, x, [LEN]);
+    float ref, new;
+
+    declare_func(void, float *sum, const float *w, const float *x, int len);
+
+    for (int i = 0; i < LEN; i++) {
+        w[i] = randf();
+        x[i] = randf();
+    }
+
+    if (check_func(dsp->dot, "dot")) {
+        for (int len = ARNNDN_ALIGN; len <= LEN; len += ARNNDN_ALIGN) {
+            call_ref(&ref, w, x, len);
+            call_new(&new, w, x, len);
+            if (!float_near_abs_eps(ref, new, EPS)) {
+                fprintf(stderr, "%d: %- .12f - %- .12f = % .12g\n",
+                        len, ref, new, ref - new);
+                fail();
+                break;
+            }
+        }
+        bench_new(&new, w, x, LEN);
+    }
+
+    report("dot");
+}
+
+static void test_dot4(AudioRNNDSPContext *dsp)
+{
+    LOCAL_ALIGNED_32(float, w, [LEN]);
+    LOCAL_ALIGNED_32(float, x, [4], [LEN]);
+    const float *xp[4] = { x[0], x[1], x[2], x[3] };
+    float ref[4], new[4];
+
+    declare_func(void, float *sum, const float *w, const float *const *x, int len);
+
+    for (int i = 0; i < LEN; i++) {
+        w[i] = randf();
+        for (int n = 0; n < 4; n++)
+            x[n][i] = randf();
+    }
+
+    if (check_func(dsp->dot4, "dot4")) {
+        for (int len = ARNNDN_ALIGN; len <= LEN; len += ARNNDN_ALIGN) {
+            call_ref(ref, w, xp, len);
+            call_new(new, w, xp, len);
+            for (int n = 0; n < 4; n++) {
+                float sum;
+
+                /* batching must not change the result of a channel */
+                dsp->dot(&sum, w, x[n], len);
+                if (!float_near_abs_eps(ref[n], new[n], EPS) || sum != new[n]) {
+                    fprintf(stderr, "%d/%d: %- .12f - %- .12f = % .12g, dot %- .12f\n",
+                            len, n, ref[n], new[n], ref[n] - new[n], sum);
+                    fail();
+                    break;
+                }
+            }
+        }
+        bench_new(new, w, xp, LEN);
+    }
+
+    report("dot4");
+}
+
+void checkasm_check_af_arnndn(void)
+{
+    AudioRNNDSPContext dsp = { 0 };
+
+    ff_arnndn_init(&dsp);
+    test_dot(&dsp);
+    test_dot4(&dsp);
+}
@@ -0,0 +1,174 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "libavfilter/af_biquadsdsp.h"
+#include "libavutil/mem_internal.h"
+#include "checkasm.h"
+
+#define LEN 256
+#define L   BIQUADS_DSP_LANES
+
+static const char *const type_names[NB_TTYPE] = {
+    [DI]   = "di",
+    [DII]  = "dii",
+    [TDI]  = "tdi",
+    [TDII] = "tdii",
+    [LATT] = "latt",
+    [SVF]  = "svf",
+    [ZDF]  = "zdf",
+    [WDF]  = "wdf",
+};
+
+static double randf(void)
+{
+    return (rnd() & 0xFFFF) / 65535.0;
+}
+
+/* stable lowpass coefficients converted to the layout of the given transform */
+static void make_coeffs(double *c, int type)
+{
+    const double f = 0.01 + 0.4 * randf();
+    const double q = 0.5 + 2.0 * randf();
+    const double w0 = 2.0 * M_PI * f;
+    const double alpha = sin(w0) / (2.0 * q);
+    const double a0 = 1.0 + alpha;
+    const double a1 = -2.0 * cos(w0) / a0;
+    const double a2 = (1.0 - alpha) / a0;
+    const double b0 = (1.0 - cos(w0)) / 2.0 / a0;
+    const double b1 = (1.0 - cos(w0)) / a0;
+    const double b2 = b0;
+    double g, k, k0, k1, v1, v2;
+
+    c[BQ_A0]  =  1.0;
+    c[BQ_WET] = randf();
+    c[BQ_DRY] = 1.0 - c[BQ_WET];
+
+    switch (type) {
+    case DII:
+    case TDI:
+    case TDII:
+        c[BQ_A1] = -a1;
+        c[BQ_A2] = -a2;
+        c[BQ_B0] = b0;
+        c[BQ_B1] = b1;
+        c[BQ_B2] = b2;
+        break;
+    case LATT:
+        k1 = a2;
+        k0 = a1 / (1.0 + k1);
+        v2 = b2;
+        v1 = b1 - v2 * a1;
+        c[BQ_A1] = k0;
+        c[BQ_A2] = k1;
+        c[BQ_B0] = b0 - v1 * k0 - v2 * k1;
+        c[BQ_B1] = v1;
+        c[BQ_B2] = v2;
+        break;
+    case SVF:
+        c[BQ_A1] = -a1;
+        c[BQ_A2] = -a2;
+        c[BQ_B0] = b1 - a1 * b0;
+        c[BQ_B1] = b2 - a2 * b0;
+        c[BQ_B2] = b0;
+        break;
+    case WDF:
+        c[BQ_A1] = (a2 - a1 - 1.0) * 0.5;
+        c[BQ_A2] = (1.0 - a1 - a2) * 0.5;
+        c[BQ_B0] = b0;
+        c[BQ_B1] = -(b2 - b1 - b0) * 0.5;
+        c[BQ_B2] = -(b0 - b1 - b2) * 0.5;
+        break;
+    case ZDF:
+        g = tan(M_PI * f);
+        k = 1.0 / q;
+        c[BQ_A0] = 1.0 / (1.0 + g * (g + k));
+        c[BQ_A1] = g * c[BQ_A0];
+        c[BQ_A2] = g * c[BQ_A1];
+        c[BQ_B0] = 0.0;
+        c[BQ_B1] = 0.0;
+        c[BQ_B2] = 1.0;
+        break;
+    }
+}
+
+#define CHECK_BIQUAD(ftype, fns, suffix)                                           \
+static void check_biquad_##suffix(const BiquadsDSPContext *dsp)                    \
+{                                                                                  \
+    LOCAL_ALIGNED_16(ftype, src,      [L], [LEN]);                                 \
+    LOCAL_ALIGNED_16(ftype, dst_ref,  [L], [LEN]);                                 \
+    LOCAL_ALIGNED_16(ftype, dst_new,  [L], [LEN]);                                 \
+    LOCAL_ALIGNED_16(ftype, st_ref,   [BIQUADS_DSP_NB_STATE * L]);                 \
+    LOCAL_ALIGNED_16(ftype, st_new,   [BIQUADS_DSP_NB_STATE * L]);                 \
+    LOCAL_ALIGNED_16(ftype, coeffs,   [BQ_NB_COEFFS * L]);                         \
+    const ftype *srcp[L];                                                          \
+    ftype *dst_refp[L], *dst_newp[L];                                              \
+                                                                                   \
+    declare_func(void, ftype *const *dst, const ftype *const *src,                 \
+                 ptrdiff_t len, ftype *state, const ftype *coeffs);                \
+                                                                                   \
+    for (int l = 0; l < L; l++) {                                                  \
+        srcp[l]     = src[l];                                                      \
+        dst_refp[l] = dst_ref[l];                                                  \
+        dst_newp[l] = dst_new[l];                                                  \
+    }                                                                              \
+                                                                                   \
+    for (int type = 0; type < NB_TTYPE; type++) {                                  \
+        double c[BQ_NB_COEFFS];                                                    \
+                                                                                   \
+        if (!dsp->fns[type])                                                       \
+            continue;                                                              \
+                                                                                   \
+        make_coeffs(c, type);                                                      \
+        for (int n = 0; n < BQ_NB_COEFFS; n++)                                     \
+            for (int l = 0; l < L; l++)                                            \
+                coeffs[n * L + l] = c[n];                                          \
+        for (int l = 0; l < L; l++)                                                \
+            for (int i = 0; i < LEN; i++)                                          \
+                src[l][i] = randf() * 2.0 - 1.0;                                   \
+        for (int n = 0; n < BIQUADS_DSP_NB_STATE * L; n++)                         \
+            st_ref[n] = st_new[n] = (randf() - 0.5) * 0.1;                         \
+                                                                                   \
+        if (check_func(dsp->fns[type], "biquad_%s_" #suffix, type_names[type])) {  \
+            call_ref(dst_refp, srcp, LEN, st_ref, coeffs);                         \
+            call_new(dst_newp, srcp, LEN, st_new, coeffs);                         \
+            if (memcmp(dst_ref, dst_new, sizeof(ftype) * L * LEN) ||               \
+                memcmp(st_ref, st_new, sizeof(ftype) * BIQUADS_DSP_NB_STATE * L))  \
+                fail();                                                            \
+            bench_new(dst_newp, srcp, LEN, st_new, coeffs);                        \
+        }                                                                          \
+    }                                                                              \
+}
+
+CHECK_BIQUAD(float,  filter_flt, flt)
+CHECK_BIQUAD(double, filter_dbl, dbl)
+
+void checkasm_check_af_biquads(void)
+{
+    BiquadsDSPContext dsp;
+
+    ff_biquads_dsp_init(&dsp);
+
+    check_biquad_flt(&dsp);
+    report("biquads_flt");
+
+    check_biquad_dbl(&dsp);
+    report("biquads_dbl");
+}
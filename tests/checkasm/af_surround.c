@@ -0,0 +1,125 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#include "libavfilter/af_surrounddsp.h"
+#include "libavutil/mem_internal.h"
+#include "checkasm.h"
+
+#define LEN 256
+
+static float randf(void)
+{
+    return (rnd() & 0xFFFF) / 65535.f;
+}
+
+static void test_stereo_position(AudioSurroundDSPContext *dsp)
+{
+    LOCAL_ALIGNED_32(AVComplexFloat, l, [LEN]);
+    LOCAL_ALIGNED_32(AVComplexFloat, r, [LEN]);
+    LOCAL_ALIGNED_32(float, x_ref, [LEN]);
+    LOCAL_ALIGNED_32(float, y_ref, [LEN]);
+    LOCAL_ALIGNED_32(float, z_ref, [LEN]);
+    LOCAL_ALIGNED_32(float, x_new, [LEN]);
+    LOCAL_ALIGNED_32(float, y_new, [LEN]);
+    LOCAL_ALIGNED_32(float, z_new, [LEN]);
+
+    declare_func(void, float *x, float *y, float *z,
+                 const AVComplexFloat *l, const AVComplexFloat *r,
+                 ptrdiff_t len);
+
+    for (int i = 0; i < LEN; i++) {
+        l[i].re = randf() * 2.f - 1.f;
+        l[i].im = randf() * 2.f - 1.f;
+        r[i].re = randf() * 2.f - 1.f;
+        r[i].im = randf() * 2.f - 1.f;
+    }
+    /* silent, identical, opposite and mono bins */
+    memset(&l[0], 0, sizeof(l[0]));
+    memset(&r[0], 0, sizeof(r[0]));
+    r[1] = l[1];
+    r[2].re = -l[2].re;
+    r[2].im = -l[2].im;
+    memset(&r[3], 0, sizeof(r[3]));
+    l[4].im = r[4].im = 0.f;
+
+    if (check_func(dsp->stereo_position, "stereo_position")) {
+        call_ref(x_ref, y_ref, z_ref, l, r, LEN);
+        call_new(x_new, y_new, z_new, l, r, LEN);
+        if (!float_near_abs_eps_array(x_ref, x_new, 1e-6f, LEN) ||
+            !float_near_abs_eps_array(y_ref, y_new, 1e-6f, LEN) ||
+            !float_near_abs_eps_array(z_ref, z_new, 1e-6f, LEN))
+            fail();
+        bench_new(x_new, y_new, z_new, l, r, LEN);
+    }
+
+    report("stereo_position");
+}
+
+static void test_power_factors(AudioSurroundDSPContext *dsp)
+{
+    LOCAL_ALIGNED_32(float, x, [LEN]);
+    LOCAL_ALIGNED_32(float, y, [LEN]);
+    LOCAL_ALIGNED_32(float, z, [LEN]);
+    LOCAL_ALIGNED_32(float, ref, [LEN]);
+    LOCAL_ALIGNED_32(float, new, [LEN]);
+    float coeffs[4];
+
+    declare_func(void, float *factor, const float *x, const float *y,
+                 const float *z, const float *coeffs, ptrdiff_t len);
+
+    for (int i = 0; i < 3; i++)
+        coeffs[i] = -15.f * randf();
+    coeffs[3] = (1.f + expf(coeffs[0] * 0.5f)) *
+                (1.f + expf(coeffs[1] * 0.5f)) *
+                (1.f + expf(coeffs[2] * 0.5f));
+
+    for (int i = 0; i < LEN; i++) {
+        x[i] = randf();
+        y[i] = randf();
+        z[i] = randf();
+    }
+
+    if (check_func(dsp->power_factors, "power_factors")) {
+        call_ref(ref, x, y, z, coeffs, LEN);
+        call_new(new, x, y, z, coeffs, LEN);
+        for (int i = 0; i < LEN; i++) {
+            if (!float_near_abs_eps(ref[i], new[i], fabsf(ref[i]) * 1e-5f)) {
+                fprintf(stderr, "%d: %- .12f - %- .12f = % .12g\n",
+                        i, ref[i], new[i], ref[i] - new[i]);
+                fail();
+                break;
+            }
+        }
+        bench_new(new, x, y, z, coeffs, LEN);
+    }
+
+    report("power_factors");
+}
+
+void checkasm_check_af_surround(void)
+{
+    AudioSurroundDSPContext dsp = { 0 };
+
+    ff_surround_init(&dsp);
+    test_stereo_position(&dsp);
+    test_power_factors(&dsp);
+}
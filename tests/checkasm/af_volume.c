@@ -0,0 +1,74 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "libavfilter/af_volume.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem_internal.h"
+#include "checkasm.h"
+
+#define LEN 1024
+
+static void test_scale_samples(enum AVSampleFormat fmt, int volume_i, const char *name)
+{
+    LOCAL_ALIGNED_32(uint8_t, src,     [LEN * 4]);
+    LOCAL_ALIGNED_32(uint8_t, dst_ref, [LEN * 4]);
+    LOCAL_ALIGNED_32(uint8_t, dst_new, [LEN * 4]);
+    const int bps = av_get_bytes_per_sample(fmt);
+    VolumeContext vol = { .sample_fmt = fmt, .volume_i = volume_i };
+    int len;
+
+    declare_func(void, uint8_t *dst, const uint8_t *src, int nb_samples, int volume);
+
+    ff_volume_init(&vol);
+    /* the filter pads the number of samples to the alignment of the function */
+    len = FFALIGN(LEN - 1 - (rnd() & 255), vol.samples_align);
+
+    for (int i = 0; i < LEN * 4; i += 4)
+        AV_WN32A(src + i, rnd());
+    /* full scale samples, to check the clipping */
+    if (fmt == AV_SAMPLE_FMT_S16) {
+        AV_WN16A(src, INT16_MAX);
+        AV_WN16A(src + 2, INT16_MIN);
+    } else if (fmt == AV_SAMPLE_FMT_S32) {
+        AV_WN32A(src, INT32_MAX);
+        AV_WN32A(src + 4, INT32_MIN);
+    }
+
+    if (check_func(vol.scale_samples, "scale_samples_%s", name)) {
+        memset(dst_ref, 0, LEN * 4);
+        memset(dst_new, 0, LEN * 4);
+        call_ref(dst_ref, src, len, volume_i);
+        call_new(dst_new, src, len, volume_i);
+        if (memcmp(dst_ref, dst_new, len * bps))
+            fail();
+        bench_new(dst_new, src, len, volume_i);
+    }
+}
+
+void checkasm_check_af_volume(void)
+{
+    /* volume_i is the gain in 24.8 fixed point */
+    test_scale_samples(AV_SAMPLE_FMT_U8,  0x180,     "u8_small");
+    test_scale_samples(AV_SAMPLE_FMT_U8,  0x1000000, "u8");
+    test_scale_samples(AV_SAMPLE_FMT_S16, 0x180,     "s16_small");
+    test_scale_samples(AV_SAMPLE_FMT_S16, 0x10000,   "s16");
+    test_scale_samples(AV_SAMPLE_FMT_S32, 0x180,     "s32");
+    report("scale_samples");
+}
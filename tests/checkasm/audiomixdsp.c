@@ -0,0 +1,154 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <float.h>
+#include <string.h>
+
+#include "libavfilter/audiomixdsp.h"
+#include "libavutil/mem_internal.h"
+#include "checkasm.h"
+
+#define LEN 67
+#define BUF_SIZE (LEN + 1)
+
+static const int lens[] = { 1, 3, 8, 13, 16, 31, LEN };
+
+static double randd(void)
+{
+    return (rnd() & 0xFFFF) / 32767.5 - 1.0;
+}
+
+#define TEST_FUNCS(ftype, name, eps, near_array)                                    \
+static void test_scale_##name(AudioMixDSPContext *dsp)                              \
+{                                                                                   \
+    LOCAL_ALIGNED_32(ftype, src, [BUF_SIZE]);                                       \
+    LOCAL_ALIGNED_32(ftype, ref, [BUF_SIZE]);                                       \
+    LOCAL_ALIGNED_32(ftype, new, [BUF_SIZE]);                                       \
+    const ftype gain = randd();                                                     \
+                                                                                    \
+    declare_func(void, ftype *dst, const ftype *src, ftype gain, int len);          \
+                                                                                    \
+    for (int i = 0; i < BUF_SIZE; i++)                                              \
+        src[i] = randd();                                                           \
+                                                                                    \
+    if (check_func(dsp->scale_##name, "scale_" #name)) {                            \
+        for (int n = 0; n < FF_ARRAY_ELEMS(lens); n++) {                            \
+            const int len = lens[n];                                                \
+                                                                                    \
+            memset(ref, 0, sizeof(*ref) * BUF_SIZE);                                \
+            memset(new, 0, sizeof(*new) * BUF_SIZE);                                \
+            call_ref(ref, src + 1, gain, len);                                      \
+            call_new(new, src + 1, gain, len);                                      \
+            if (memcmp(ref, new, sizeof(*ref) * BUF_SIZE)) {                        \
+                fail();                                                             \
+                break;                                                              \
+            }                                                                       \
+        }                                                                           \
+        bench_new(new, src, gain, LEN);                                             \
+    }                                                                               \
+                                                                                    \
+    report("scale_" #name);                                                         \
+}                                                                                   \
+                                                                                    \
+static void test_gain_##name(AudioMixDSPContext *dsp)                               \
+{                                                                                   \
+    LOCAL_ALIGNED_32(ftype, src, [BUF_SIZE]);                                       \
+    LOCAL_ALIGNED_32(ftype, gain, [BUF_SIZE]);                                      \
+    LOCAL_ALIGNED_32(ftype, ref, [BUF_SIZE]);                                       \
+    LOCAL_ALIGNED_32(ftype, new, [BUF_SIZE]);                                       \
+                                                                                    \
+    declare_func(void, ftype *dst, const ftype *src, const ftype *gain, int len);   \
+                                                                                    \
+    for (int i = 0; i < BUF_SIZE; i++) {                                            \
+        src[i]  = randd();                                                          \
+        gain[i] = randd();                                                          \
+    }                                                                               \
+                                                                                    \
+    if (check_func(dsp->gain_##name, "gain_" #name)) {                              \
+        for (int n = 0; n < FF_ARRAY_ELEMS(lens); n++) {                            \
+            const int len = lens[n];                                                \
+                                                                                    \
+            memset(ref, 0, sizeof(*ref) * BUF_SIZE);                                \
+            memset(new, 0, sizeof(*new) * BUF_SIZE);                                \
+            call_ref(ref + 1, src + 1, gain, len);                                  \
+            call_new(new + 1, src + 1, gain, len);                                  \
+            if (memcmp(ref, new, sizeof(*ref) * BUF_SIZE)) {                        \
+                fail();                                                             \
+                break;                                                              \
+            }                                                                       \
+        }                                                                           \
+        bench_new(new, src, gain, LEN);                                             \
+    }                                                                               \
+                                                                                    \
+    report("gain_" #name);                                                          \
+}                                                                                   \
+                                                                                    \
+static void test_crossfade_##name(AudioMixDSPContext *dsp)                          \
+{                                                                                   \
+    LOCAL_ALIGNED_32(ftype, src0, [BUF_SIZE]);                                      \
+    LOCAL_ALIGNED_32(ftype, src1, [BUF_SIZE]);                                      \
+    LOCAL_ALIGNED_32(ftype, gain0, [BUF_SIZE]);                                     \
+    LOCAL_ALIGNED_32(ftype, gain1, [BUF_SIZE]);                                     \
+    LOCAL_ALIGNED_32(ftype, ref, [BUF_SIZE]);                                       \
+    LOCAL_ALIGNED_32(ftype, new, [BUF_SIZE]);                                       \
+                                                                                    \
+    declare_func(void, ftype *dst, const ftype *src0, const ftype *gain0,           \
+                 const ftype *src1, const ftype *gain1, int len);                   \
+                                                                                    \
+    for (int i = 0; i < BUF_SIZE; i++) {                                            \
+        src0[i]  = randd();                                                         \
+        src1[i]  = randd();                                                         \
+        gain0[i] = randd();                                                         \
+        gain1[i] = randd();                                                         \
+    }                                                                               \
+                                                                                    \
+    if (check_func(dsp->crossfade_##name, "crossfade_" #name)) {                    \
+        for (int n = 0; n < FF_ARRAY_ELEMS(lens); n++) {                            \
+            const int len = lens[n];                                                \
+                                                                                    \
+            memset(ref, 0, sizeof(*ref) * BUF_SIZE);                                \
+            memset(new, 0, sizeof(*new) * BUF_SIZE);                                \
+            call_ref(ref, src0 + 1, gain0, src1, gain1 + 1, len);                   \
+            call_new(new, src0 + 1, gain0, src1, gain1 + 1, len);                   \
+            if (!near_array(ref, new, eps, BUF_SIZE)) {                             \
+                fail();                                                             \
+                break;                                                              \
+            }                                                                       \
+        }                                                                           \
+        bench_new(new, src0, gain0, src1, gain1, LEN);                              \
+    }                                                                               \
+                                                                                    \
+    report("crossfade_" #name);                                                     \
+}
+
+TEST_FUNCS(float,  float,  2 * FLT_EPSILON, float_near_abs_eps_array)
+TEST_FUNCS(double, double, 2 * DBL_EPSILON, double_near_abs_eps_array)
+
+void checkasm_check_audiomixdsp(void)
+{
+    AudioMixDSPContext dsp = { 0 };
+
+    ff_audio_mix_init(&dsp);
+
+    test_scale_float(&dsp);
+    test_scale_double(&dsp);
+    test_gain_float(&dsp);
+    test_gain_double(&dsp);
+    test_crossfade_float(&dsp);
+    test_crossfade_double(&dsp);
+}
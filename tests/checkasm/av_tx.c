@@ -51,6 +51,15 @@ static const int rdft_check_lens[] = {
 static AVTXContext *tx_refs[AV_TX_NB][2 /* Direction */][FF_ARRAY_ELEMS(check_lens)] = { 0 };
 static int init = 0;
 
+static int int32_near_abs_eps_array(const int32_t *a, const int32_t *b,
+                                    int eps, unsigned len)
+{
+    for (unsigned i = 0; i < len; i++)
+        if (FFABS((int64_t)a[i] - b[i]) > eps)
+            return 0;
+    return 1;
+}
+
 static void free_tx_refs(void)
 {
     for (int i = 0; i < FF_ARRAY_ELEMS(tx_refs); i++)
@@ -121,10 +130,38 @@ void checkasm_check_av_tx(void)
     CHECK_TEMPLATE("float_r2c", AV_TX_FLOAT_RDFT, 0, float, float, rdft_check_lens,
                    !float_near_abs_eps_array(out_ref, out_new, EPS, len));
 
+    CHECK_TEMPLATE("float_dctI", AV_TX_FLOAT_DCT_I, 0, float, float, rdft_check_lens,
+                   !float_near_abs_eps_array(out_ref, out_new, EPS, len));
+
+    CHECK_TEMPLATE("float_dstI", AV_TX_FLOAT_DST_I, 0, float, float, rdft_check_lens,
+                   !float_near_abs_eps_array(out_ref, out_new, EPS, len));
+
     randomize_complex(in, 16384, AVComplexDouble, SCALE_NOOP);
     CHECK_TEMPLATE("double_fft", AV_TX_DOUBLE_FFT, 0, AVComplexDouble, double, check_lens,
                    !double_near_abs_eps_array(out_ref, out_new, EPS, len*2));
 
+    CHECK_TEMPLATE("double_imdct", AV_TX_DOUBLE_MDCT, 1, double, double, check_lens,
+                   !double_near_abs_eps_array(out_ref, out_new, EPS, len));
+
+    CHECK_TEMPLATE("double_r2c", AV_TX_DOUBLE_RDFT, 0, double, double, rdft_check_lens,
+                   !double_near_abs_eps_array(out_ref, out_new, EPS, len));
+
+    CHECK_TEMPLATE("double_dctI", AV_TX_DOUBLE_DCT_I, 0, double, double, rdft_check_lens,
+                   !double_near_abs_eps_array(out_ref, out_new, EPS, len));
+
+    CHECK_TEMPLATE("double_dstI", AV_TX_DOUBLE_DST_I, 0, double, double, rdft_check_lens,
+                   !double_near_abs_eps_array(out_ref, out_new, EPS, len));
+
+    randomize_complex(in, 16384, AVComplexInt32, SCALE_INT20);
+    CHECK_TEMPLATE("int32_fft", AV_TX_INT32_FFT, 0, AVComplexInt32, float, check_lens,
+                   !int32_near_abs_eps_array(out_ref, out_new, 16, len*2));
+
+    CHECK_TEMPLATE("int32_imdct", AV_TX_INT32_MDCT, 1, int32_t, float, check_lens,
+                   !int32_near_abs_eps_array(out_ref, out_new, 16, len));
+
+    CHECK_TEMPLATE("int32_r2c", AV_TX_INT32_RDFT, 0, int32_t, float, rdft_check_lens,
+                   !int32_near_abs_eps_array(out_ref, out_new, 16, len));
+
     av_free(in);
     av_free(out_ref);
     av_free(out_new);
@@ -0,0 +1,100 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "libavfilter/avf_showcqt.h"
+#include "libavutil/mem.h"
+#include "libavutil/mem_internal.h"
+#include "checkasm.h"
+
+#define FFT_LEN   4096
+#define CQT_LEN   96
+#define MAX_CLEN  256
+/* multiple of every alignment the implementations ask for */
+#define ALIGN     8
+
+static float randf(void)
+{
+    return (rnd() & 0xFFFF) / 65535.f * 2.f - 1.f;
+}
+
+void checkasm_check_avf_showcqt(void)
+{
+    LOCAL_ALIGNED_32(AVComplexFloat, src, [FFT_LEN + 64]);
+    LOCAL_ALIGNED_32(AVComplexFloat, dst_ref, [CQT_LEN]);
+    LOCAL_ALIGNED_32(AVComplexFloat, dst_new, [CQT_LEN]);
+    Coeffs coeffs_ref[CQT_LEN] = { 0 }, coeffs_new[CQT_LEN] = { 0 };
+    ShowCQTContext s = { 0 };
+
+    declare_func(void, AVComplexFloat *dst, const AVComplexFloat *src,
+                 const Coeffs *coeffs, int len, int fft_len);
+
+    for (int i = 0; i < FFT_LEN + 64; i++) {
+        src[i].re = randf();
+        src[i].im = randf();
+    }
+
+    /* kernels of growing length and position, like the real ones */
+    for (int k = 0; k < CQT_LEN; k++) {
+        const int len = FFALIGN(1 + (rnd() % MAX_CLEN), ALIGN);
+        const int start = FFALIGN(k * (FFT_LEN / 2 - MAX_CLEN) / CQT_LEN, ALIGN);
+
+        coeffs_ref[k].start = coeffs_new[k].start = start;
+        coeffs_ref[k].len   = coeffs_new[k].len   = len;
+        coeffs_ref[k].val = av_malloc_array(len, sizeof(float));
+        coeffs_new[k].val = av_malloc_array(len, sizeof(float));
+        if (!coeffs_ref[k].val || !coeffs_new[k].val)
+            goto end;
+        for (int x = 0; x < len; x++)
+            coeffs_ref[k].val[x] = randf() / FFT_LEN;
+    }
+    /* a silent bin */
+    memset(coeffs_ref[0].val, 0, coeffs_ref[0].len * sizeof(float));
+
+    ff_showcqt_init_dsp(&s);
+    if (check_func(s.cqt_calc, "cqt_calc")) {
+        /* the implementation may want its own coefficient order */
+        for (int k = 0; k < CQT_LEN; k++) {
+            memcpy(coeffs_new[k].val, coeffs_ref[k].val, coeffs_ref[k].len * sizeof(float));
+            if (s.permute_coeffs)
+                s.permute_coeffs(coeffs_new[k].val, coeffs_new[k].len);
+        }
+
+        call_ref(dst_ref, src, coeffs_ref, CQT_LEN, FFT_LEN);
+        call_new(dst_new, src, coeffs_new, CQT_LEN, FFT_LEN);
+        for (int k = 0; k < CQT_LEN; k++) {
+            if (!float_near_abs_eps(dst_ref[k].re, dst_new[k].re, fabsf(dst_ref[k].re) * 1e-4f + 1e-12f) ||
+                !float_near_abs_eps(dst_ref[k].im, dst_new[k].im, fabsf(dst_ref[k].im) * 1e-4f + 1e-12f)) {
+                fprintf(stderr, "%d: %g %g - %g %g\n", k,
+                        dst_ref[k].re, dst_ref[k].im, dst_new[k].re, dst_new[k].im);
+                fail();
+                break;
+            }
+        }
+        bench_new(dst_new, src, coeffs_new, CQT_LEN, FFT_LEN);
+    }
+    report("cqt_calc");
+
+end:
+    for (int k = 0; k < CQT_LEN; k++) {
+        av_freep(&coeffs_ref[k].val);
+        av_freep(&coeffs_new[k].val);
+    }
+}
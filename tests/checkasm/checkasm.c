@@ -143,6 +143,9 @@ static const struct {
     #if CONFIG_DIRAC_DECODER
         { "diracdsp", checkasm_check_diracdsp },
     #endif
+    #if CONFIG_DPX_DECODER
+        { "dpxdsp", checkasm_check_dpxdsp },
+    #endif
     #if CONFIG_EXR_DECODER
         { "exrdsp", checkasm_check_exrdsp },
     #endif
@@ -207,12 +210,15 @@ static const struct {
     #if CONFIG_MPEGVIDEOENC
         { "mpegvideoencdsp", checkasm_check_mpegvideoencdsp },
     #endif
-    #if CONFIG_OPUS_DECODER
+    #if CONFIG_OPUS_DECODER || CONFIG_OPUS_ENCODER
         { "opusdsp", checkasm_check_opusdsp },
     #endif
     #if CONFIG_PIXBLOCKDSP
         { "pixblockdsp", checkasm_check_pixblockdsp },
     #endif
+    #if CONFIG_PRORES_KS_ENCODER
+        { "proresencdsp", checkasm_check_proresencdsp },
+    #endif
     #if CONFIG_RV34DSP
         { "rv34dsp", checkasm_check_rv34dsp },
     #endif
@@ -252,12 +258,44 @@ static const struct {
     #if CONFIG_VVC_DECODER
         { "vvc_alf", checkasm_check_vvc_alf },
         { "vvc_mc",  checkasm_check_vvc_mc  },
+        { "vvc_sao", checkasm_check_vvc_sao },
     #endif
 #endif
 #if CONFIG_AVFILTER
+    #if CONFIG_AASRC_FILTER
+        { "aasrcdsp", checkasm_check_aasrcdsp },
+    #endif
+    #if CONFIG_AAP_FILTER || CONFIG_AKALMAN_FILTER || CONFIG_ANLMF_FILTER || \
+        CONFIG_ANLMS_FILTER || CONFIG_ARLS_FILTER
+        { "adaptivedsp", checkasm_check_adaptivedsp },
+    #endif
+    #if CONFIG_ACOMPRESSOR_FILTER || CONFIG_AGATE_FILTER
+        { "dynamicsdsp", checkasm_check_dynamicsdsp },
+    #endif
+    #if CONFIG_ACROSSFADE_FILTER || CONFIG_AFADE_FILTER
+        { "audiomixdsp", checkasm_check_audiomixdsp },
+    #endif
     #if CONFIG_AFIR_FILTER
         { "af_afir", checkasm_check_afir },
     #endif
+    #if CONFIG_ANLMDN_FILTER
+        { "af_anlmdn", checkasm_check_af_anlmdn },
+    #endif
+    #if CONFIG_ARNNDN_FILTER
+        { "af_arnndn", checkasm_check_af_arnndn },
+    #endif
+    #if CONFIG_BIQUAD_FILTER
+        { "af_biquads", checkasm_check_af_biquads },
+    #endif
+    #if CONFIG_SURROUND_FILTER
+        { "af_surround", checkasm_check_af_surround },
+    #endif
+    #if CONFIG_VOLUME_FILTER
+        { "af_volume", checkasm_check_af_volume },
+    #endif
+    #if CONFIG_SHOWCQT_FILTER
+        { "avf_showcqt", checkasm_check_avf_showcqt },
+    #endif
     #if CONFIG_BLEND_FILTER
         { "vf_blend", checkasm_check_blend },
     #endif
@@ -279,6 +317,9 @@ static const struct {
     #if CONFIG_NLMEANS_FILTER
         { "vf_nlmeans", checkasm_check_nlmeans },
     #endif
+    #if CONFIG_NNEDI_FILTER
+        { "vf_nnedi", checkasm_check_vf_nnedi },
+    #endif
     #if CONFIG_THRESHOLD_FILTER
         { "vf_threshold", checkasm_check_vf_threshold },
     #endif
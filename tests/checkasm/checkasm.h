@@ -75,16 +75,27 @@ typedef sigjmp_buf checkasm_context;
 
 void checkasm_check_aacencdsp(void);
 void checkasm_check_aacpsdsp(void);
+void checkasm_check_aasrcdsp(void);
 void checkasm_check_ac3dsp(void);
+void checkasm_check_adaptivedsp(void);
 void checkasm_check_afir(void);
+void checkasm_check_af_anlmdn(void);
+void checkasm_check_af_arnndn(void);
+void checkasm_check_af_biquads(void);
+void checkasm_check_af_surround(void);
+void checkasm_check_af_volume(void);
 void checkasm_check_alacdsp(void);
 void checkasm_check_audiodsp(void);
+void checkasm_check_audiomixdsp(void);
 void checkasm_check_av_tx(void);
+void checkasm_check_avf_showcqt(void);
 void checkasm_check_blend(void);
 void checkasm_check_blockdsp(void);
 void checkasm_check_bswapdsp(void);
 void checkasm_check_colorspace(void);
 void checkasm_check_diracdsp(void);
+void checkasm_check_dpxdsp(void);
+void checkasm_check_dynamicsdsp(void);
 void checkasm_check_exrdsp(void);
 void checkasm_check_fdctdsp(void);
 void checkasm_check_fixed_dsp(void);
@@ -115,6 +126,7 @@ void checkasm_check_mpegvideoencdsp(void);
 void checkasm_check_nlmeans(void);
 void checkasm_check_opusdsp(void);
 void checkasm_check_pixblockdsp(void);
+void checkasm_check_proresencdsp(void);
 void checkasm_check_sbrdsp(void);
 void checkasm_check_rv34dsp(void);
 void checkasm_check_rv40dsp(void);
@@ -135,6 +147,7 @@ void checkasm_check_vf_bwdif(void);
 void checkasm_check_vf_eq(void);
 void checkasm_check_vf_gblur(void);
 void checkasm_check_vf_hflip(void);
+void checkasm_check_vf_nnedi(void);
 void checkasm_check_vf_threshold(void);
 void checkasm_check_vf_sobel(void);
 void checkasm_check_vp8dsp(void);
@@ -143,6 +156,7 @@ void checkasm_check_videodsp(void);
 void checkasm_check_vorbisdsp(void);
 void checkasm_check_vvc_alf(void);
 void checkasm_check_vvc_mc(void);
+void checkasm_check_vvc_sao(void);
 
 struct CheckasmPerf;
 
@@ -0,0 +1,98 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "checkasm.h"
+#include "libavcodec/defs.h"
+#include "libavcodec/dpxdsp.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem_internal.h"
+
+#define NB_WORDS 1024
+#define SRC_SIZE (NB_WORDS * 4 + AV_INPUT_BUFFER_PADDING_SIZE)
+#define DST_SIZE (NB_WORDS * 3 + 32)
+
+static void randomize_buffer(uint8_t *src)
+{
+    for (int i = 0; i < SRC_SIZE; i += 4)
+        AV_WN32A(src + i, rnd());
+}
+
+static void check_unpack10(DPXDSPContext *c)
+{
+    static const int shifts[][3] = {
+        { 20, 10,  0 }, { 22, 12,  2 }, { 0, 10, 20 }, { 2, 12, 22 },
+    };
+    LOCAL_ALIGNED_16(uint8_t,  src,     [SRC_SIZE]);
+    LOCAL_ALIGNED_16(uint16_t, dst_ref, [DST_SIZE]);
+    LOCAL_ALIGNED_16(uint16_t, dst_new, [DST_SIZE]);
+
+    declare_func(void, uint16_t *dst, const uint8_t *src, int nb_words,
+                 const int shifts[3]);
+
+    for (int be = 0; be < 2; be++) {
+        for (int s = 0; s < FF_ARRAY_ELEMS(shifts); s++) {
+            if (check_func(c->unpack10[be], "dpx_unpack10_%s_%d",
+                           be ? "be" : "le", shifts[s][0])) {
+                const int nb_words = 1 + rnd() % NB_WORDS;
+
+                randomize_buffer(src);
+                call_ref(dst_ref, src, nb_words, shifts[s]);
+                call_new(dst_new, src, nb_words, shifts[s]);
+                if (memcmp(dst_ref, dst_new, nb_words * 3 * sizeof(*dst_ref)))
+                    fail();
+                bench_new(dst_new, src, NB_WORDS, shifts[s]);
+            }
+        }
+    }
+    report("unpack10");
+}
+
+static void check_unpack12(DPXDSPContext *c)
+{
+    LOCAL_ALIGNED_16(uint8_t,  src,     [SRC_SIZE]);
+    LOCAL_ALIGNED_16(uint16_t, dst_ref, [DST_SIZE]);
+    LOCAL_ALIGNED_16(uint16_t, dst_new, [DST_SIZE]);
+
+    declare_func(void, uint16_t *dst, const uint8_t *src, int nb_samples);
+
+    for (int be = 0; be < 2; be++) {
+        if (check_func(c->unpack12[be], "dpx_unpack12_%s", be ? "be" : "le")) {
+            const int nb_samples = 1 + rnd() % (NB_WORDS * 8 / 3 - 8);
+
+            randomize_buffer(src);
+            call_ref(dst_ref, src, nb_samples);
+            call_new(dst_new, src, nb_samples);
+            if (memcmp(dst_ref, dst_new, nb_samples * sizeof(*dst_ref)))
+                fail();
+            bench_new(dst_new, src, NB_WORDS * 8 / 3 - 8);
+        }
+    }
+    report("unpack12");
+}
+
+void checkasm_check_dpxdsp(void)
+{
+    DPXDSPContext c;
+
+    ff_dpxdsp_init(&c);
+
+    check_unpack10(&c);
+    check_unpack12(&c);
+}
@@ -0,0 +1,126 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "libavfilter/dynamicsdsp.h"
+#include "libavutil/mem_internal.h"
+#include "checkasm.h"
+
+#define LEN 259
+#define BUF_SIZE (LEN + 1)
+
+static const int lens[] = { 1, 3, 8, 13, 16, 31, 64, LEN };
+
+static double randd(void)
+{
+    return (rnd() & 0xFFFF) / 32767.5 - 1.0;
+}
+
+#define TEST_ABS(ftype, name, op)                                                   \
+static void test_##op##_##name(AudioDynamicsDSPContext *dsp)                        \
+{                                                                                   \
+    LOCAL_ALIGNED_32(ftype, src, [BUF_SIZE]);                                       \
+    LOCAL_ALIGNED_32(ftype, dst, [BUF_SIZE]);                                       \
+    LOCAL_ALIGNED_32(ftype, ref, [BUF_SIZE]);                                       \
+    LOCAL_ALIGNED_32(ftype, new, [BUF_SIZE]);                                       \
+    const ftype level = randd() * 4;                                                \
+                                                                                    \
+    declare_func(void, ftype *dst, const ftype *src, ftype level, int len);         \
+                                                                                    \
+    for (int i = 0; i < BUF_SIZE; i++) {                                            \
+        src[i] = randd();                                                           \
+        dst[i] = randd();                                                           \
+    }                                                                               \
+                                                                                    \
+    if (check_func(dsp->op##_##name, #op "_" #name)) {                              \
+        for (int n = 0; n < FF_ARRAY_ELEMS(lens); n++) {                            \
+            const int len = lens[n];                                                \
+                                                                                    \
+            /* the planes of a sidechain frame need not be aligned */               \
+            memcpy(ref, dst, sizeof(*dst) * BUF_SIZE);                              \
+            memcpy(new, dst, sizeof(*dst) * BUF_SIZE);                              \
+            call_ref(ref, src + 1, level, len);                                     \
+            call_new(new, src + 1, level, len);                                     \
+            if (memcmp(ref, new, sizeof(*ref) * BUF_SIZE)) {                        \
+                fail();                                                             \
+                break;                                                              \
+            }                                                                       \
+        }                                                                           \
+        bench_new(new, src, level, LEN);                                            \
+    }                                                                               \
+                                                                                    \
+    report(#op "_" #name);                                                          \
+}
+
+#define TEST_FUNCS(ftype, name)                                                     \
+TEST_ABS(ftype, name, abs)                                                          \
+TEST_ABS(ftype, name, abs_max)                                                      \
+TEST_ABS(ftype, name, abs_add)                                                      \
+                                                                                    \
+static void test_mul_##name(AudioDynamicsDSPContext *dsp)                           \
+{                                                                                   \
+    LOCAL_ALIGNED_32(ftype, src, [BUF_SIZE]);                                       \
+    LOCAL_ALIGNED_32(ftype, gain, [BUF_SIZE]);                                      \
+    LOCAL_ALIGNED_32(ftype, ref, [BUF_SIZE]);                                       \
+    LOCAL_ALIGNED_32(ftype, new, [BUF_SIZE]);                                       \
+                                                                                    \
+    declare_func(void, ftype *dst, const ftype *src, const ftype *gain, int len);   \
+                                                                                    \
+    for (int i = 0; i < BUF_SIZE; i++) {                                            \
+        src[i] = randd();                                                           \
+        gain[i] = randd();                                                          \
+    }                                                                               \
+                                                                                    \
+    if (check_func(dsp->mul_##name, "mul_" #name)) {                                \
+        for (int n = 0; n < FF_ARRAY_ELEMS(lens); n++) {                            \
+            const int len = lens[n];                                                \
+                                                                                    \
+            memset(ref, 0, sizeof(*ref) * BUF_SIZE);                                \
+            memset(new, 0, sizeof(*new) * BUF_SIZE);                                \
+            call_ref(ref + 1, src + 1, gain, len);                                  \
+            call_new(new + 1, src + 1, gain, len);                                  \
+            if (memcmp(ref, new, sizeof(*ref) * BUF_SIZE)) {                        \
+                fail();                                                             \
+                break;                                                              \
+            }                                                                       \
+        }                                                                           \
+        bench_new(new, src, gain, LEN);                                             \
+    }                                                                               \
+                                                                                    \
+    report("mul_" #name);                                                           \
+}
+
+TEST_FUNCS(float,  float)
+TEST_FUNCS(double, double)
+
+void checkasm_check_dynamicsdsp(void)
+{
+    AudioDynamicsDSPContext dsp = { 0 };
+
+    ff_dynamics_init(&dsp);
+
+    test_abs_float(&dsp);
+    test_abs_double(&dsp);
+    test_abs_max_float(&dsp);
+    test_abs_max_double(&dsp);
+    test_abs_add_float(&dsp);
+    test_abs_add_double(&dsp);
+    test_mul_float(&dsp);
+    test_mul_double(&dsp);
+}
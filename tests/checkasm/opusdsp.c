@@ -16,9 +16,12 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include "config_components.h"
+
 #include "libavutil/mem_internal.h"
 
 #include "libavcodec/opus/dsp.h"
+#include "libavcodec/opus/pvq.h"
 #include "libavcodec/opus/tab.h"
 
 #include "checkasm.h"
@@ -34,6 +37,7 @@
 #define EPS 0.005
 #define MAX_SIZE (960)
 
+#if CONFIG_OPUS_DECODER
 /* period is between 15 and 1022, inclusive */
 static void test_postfilter(int period)
 {
@@ -83,8 +87,42 @@ static void test_deemphasis(void)
     bench_new(dst1, src, coeff1, ff_opus_deemph_weights, MAX_SIZE);
 }
 
+#endif
+
+#if CONFIG_OPUS_ENCODER
+/* The implementations may settle on different vectors, so only check
+ * that the result is a valid one for the input. */
+static void test_pvq_search(int N, int K)
+{
+    LOCAL_ALIGNED(32, float, X, [256]);
+    LOCAL_ALIGNED(32, int, y0, [256]);
+    LOCAL_ALIGNED(32, int, y1, [256]);
+    float norm;
+    int pulses = 0, y_norm = 0;
+
+    declare_func_float(float, float *X, int *y, int K, int N);
+
+    randomize_float(X, 256);
+
+    call_ref(X, y0, K, N);
+    norm = call_new(X, y1, K, N);
+
+    for (int i = 0; i < N; i++) {
+        pulses += FFABS(y1[i]);
+        y_norm += y1[i] * y1[i];
+        if ((y1[i] > 0 && X[i] < 0.0f) || (y1[i] < 0 && X[i] > 0.0f))
+            fail();
+    }
+    if (pulses != K || norm != (float)y_norm)
+        fail();
+
+    bench_new(X, y1, K, N);
+}
+#endif
+
 void checkasm_check_opusdsp(void)
 {
+#if CONFIG_OPUS_DECODER
     OpusDSP ctx;
     ff_opus_dsp_init(&ctx);
 
@@ -103,4 +141,23 @@ void checkasm_check_opusdsp(void)
     if (check_func(ctx.deemphasis, "deemphasis"))
         test_deemphasis();
     report("deemphasis");
+#endif
+
+#if CONFIG_OPUS_ENCODER
+    {
+        static const int sizes[][2] = { { 4, 1 }, { 11, 3 }, { 16, 40 }, { 96, 12 }, { 176, 57 } };
+        CeltPVQ *pvq;
+
+        if (ff_celt_pvq_init(&pvq, 1) < 0)
+            return;
+
+        for (int i = 0; i < FF_ARRAY_ELEMS(sizes); i++) {
+            if (check_func(pvq->pvq_search, "pvq_search_%d", sizes[i][0]))
+                test_pvq_search(sizes[i][0], sizes[i][1]);
+        }
+        report("pvq_search");
+
+        ff_celt_pvq_uninit(&pvq);
+    }
+#endif
 }
@@ -0,0 +1,76 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "libavutil/mem_internal.h"
+
+#include "libavcodec/proresencdsp.h"
+
+#include "checkasm.h"
+
+#define MAX_BLOCKS 32
+
+static void test_quantize_ac(ProresEncDSPContext *s)
+{
+    LOCAL_ALIGNED_16(int16_t, src, [MAX_BLOCKS * 64]);
+    LOCAL_ALIGNED_16(int16_t, dst0, [MAX_BLOCKS * 64]);
+    LOCAL_ALIGNED_16(int16_t, dst1, [MAX_BLOCKS * 64]);
+    int16_t qmat[64];
+
+    declare_func(int, int16_t *dst, const int16_t *src,
+                 const int16_t *qmat, int nb_blocks);
+
+    if (check_func(s->quantize_ac, "prores_quantize_ac")) {
+        for (int n = 0; n < 4; n++) {
+            int nb_blocks = n ? 1 + rnd() % MAX_BLOCKS : MAX_BLOCKS;
+            int r0, r1;
+
+            /* ProRes quantizers, then arbitrary ones */
+            for (int i = 0; i < 64; i++)
+                qmat[i] = n < 2 ? (4 + rnd() % 60) * (1 + rnd() % 127)
+                                : 1 + rnd() % 32767;
+            for (int i = 0; i < MAX_BLOCKS * 64; i++) {
+                switch (rnd() & 3) {
+                case 0:  src[i] = (int16_t)rnd(); break;
+                case 1:  src[i] = (int)(rnd() % 65) - 32; break;
+                case 2:  src[i] = (int)(rnd() % 9 - 4) * qmat[i & 63]; break;
+                default: src[i] = rnd() & 1 ? INT16_MIN : INT16_MAX; break;
+                }
+            }
+            memset(dst0, 0x55, MAX_BLOCKS * 64 * sizeof(*dst0));
+            memset(dst1, 0x55, MAX_BLOCKS * 64 * sizeof(*dst1));
+
+            r0 = call_ref(dst0, src, qmat, nb_blocks);
+            r1 = call_new(dst1, src, qmat, nb_blocks);
+            if (r0 != r1 || memcmp(dst0, dst1, MAX_BLOCKS * 64 * sizeof(*dst0)))
+                fail();
+        }
+        bench_new(dst1, src, qmat, MAX_BLOCKS);
+    }
+
+    report("quantize_ac");
+}
+
+void checkasm_check_proresencdsp(void)
+{
+    ProresEncDSPContext s = { 0 };
+    ff_proresencdsp_init(&s);
+
+    test_quantize_ac(&s);
+}
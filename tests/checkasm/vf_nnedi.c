@@ -0,0 +1,78 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <float.h>
+
+#include "libavfilter/vf_nnedidsp.h"
+#include "libavutil/mem_internal.h"
+#include "checkasm.h"
+
+#define LEN 288
+#define NB  32
+
+#define EPS (LEN * 2 * FLT_EPSILON)
+
+static float randf(void)
+{
+    return (rnd() & 0xFFFF) / 32767.5f - 1.f;
+}
+
+static void test_dot(NNEDIDSPContext *dsp)
+{
+    static const int lens[] = { 32, 48, 64, 96, 128, 192, 288 };
+    LOCAL_ALIGNED_32(float, w, [LEN * NB]);
+    LOCAL_ALIGNED_32(float, x, [LEN]);
+    float ref[NB], new[NB];
+
+    declare_func(void, float *sum, const float *w, const float *x, int len, int nb);
+
+    for (int i = 0; i < LEN * NB; i++)
+        w[i] = randf();
+    for (int i = 0; i < LEN; i++)
+        x[i] = randf();
+
+    if (check_func(dsp->dot, "dot")) {
+        for (int l = 0; l < FF_ARRAY_ELEMS(lens); l++) {
+            for (int nb = NNEDI_LANES; nb <= NB; nb += NNEDI_LANES) {
+                const int len = lens[l];
+
+                call_ref(ref, w, x, len, nb);
+                call_new(new, w, x, len, nb);
+                for (int n = 0; n < nb; n++) {
+                    if (!float_near_abs_eps(ref[n], new[n], EPS)) {
+                        fprintf(stderr, "%d/%d/%d: %- .12f - %- .12f = % .12g\n",
+                                len, nb, n, ref[n], new[n], ref[n] - new[n]);
+                        fail();
+                        break;
+                    }
+                }
+            }
+        }
+        bench_new(new, w, x, LEN, NB);
+    }
+
+    report("dot");
+}
+
+void checkasm_check_vf_nnedi(void)
+{
+    NNEDIDSPContext dsp = { 0 };
+
+    ff_nnedi_init(&dsp);
+    test_dot(&dsp);
+}
@@ -1,13 +1,24 @@
 FATE_CHECKASM = fate-checkasm-aacencdsp                                 \
                 fate-checkasm-aacpsdsp                                  \
+                fate-checkasm-aasrcdsp                                  \
                 fate-checkasm-ac3dsp                                    \
+                fate-checkasm-adaptivedsp                               \
                 fate-checkasm-af_afir                                   \
+                fate-checkasm-af_anlmdn                                 \
+                fate-checkasm-af_arnndn                                 \
+                fate-checkasm-af_biquads                                \
+                fate-checkasm-af_surround                               \
+                fate-checkasm-af_volume                                 \
                 fate-checkasm-alacdsp                                   \
                 fate-checkasm-audiodsp                                  \
+                fate-checkasm-audiomixdsp                               \
                 fate-checkasm-av_tx                                     \
+                fate-checkasm-avf_showcqt                               \
                 fate-checkasm-blockdsp                                  \
                 fate-checkasm-bswapdsp                                  \
                 fate-checkasm-diracdsp                                  \
+                fate-checkasm-dpxdsp                                    \
+                fate-checkasm-dynamicsdsp                               \
                 fate-checkasm-exrdsp                                    \
                 fate-checkasm-fdctdsp                                   \
                 fate-checkasm-fixed_dsp                                 \
@@ -37,6 +48,7 @@ FATE_CHECKASM = fate-checkasm-aacencdsp                                 \
                 fate-checkasm-mpegvideoencdsp                           \
                 fate-checkasm-opusdsp                                   \
                 fate-checkasm-pixblockdsp                               \
+                fate-checkasm-proresencdsp                              \
                 fate-checkasm-sbrdsp                                    \
                 fate-checkasm-rv34dsp                                   \
                 fate-checkasm-rv40dsp                                   \
@@ -60,6 +72,7 @@ FATE_CHECKASM = fate-checkasm-aacencdsp                                 \
                 fate-checkasm-vf_gblur                                  \
                 fate-checkasm-vf_hflip                                  \
                 fate-checkasm-vf_nlmeans                                \
+                fate-checkasm-vf_nnedi                                  \
                 fate-checkasm-vf_threshold                              \
                 fate-checkasm-vf_sobel                                  \
                 fate-checkasm-videodsp                                  \
@@ -68,6 +81,7 @@ FATE_CHECKASM = fate-checkasm-aacencdsp                                 \
                 fate-checkasm-vp9dsp                                    \
                 fate-checkasm-vvc_alf                                   \
                 fate-checkasm-vvc_mc                                    \
+                fate-checkasm-vvc_sao                                   \
 
 $(FATE_CHECKASM): tests/checkasm/checkasm$(EXESUF)
 $(FATE_CHECKASM): CMD = run tests/checkasm/checkasm$(EXESUF) --test=$(@:fate-checkasm-%=%)
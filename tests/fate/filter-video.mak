@@ -761,6 +761,9 @@ fate-filter-refcmp-psnr-rgb: CMD = refcmp_metadata psnr rgb24 0.002
 FATE_FILTER_REFCMP_METADATA-$(CONFIG_PSNR_FILTER) += fate-filter-refcmp-psnr-yuv
 fate-filter-refcmp-psnr-yuv: CMD = refcmp_metadata psnr yuv422p 0.0015
 
+FATE_FILTER_REFCMP_METADATA-$(CONFIG_QUALITYMETRICS_FILTER) += fate-filter-refcmp-qualitymetrics-yuv
+fate-filter-refcmp-qualitymetrics-yuv: CMD = refcmp_metadata qualitymetrics yuv422p 0.015
+
 FATE_FILTER_REFCMP_METADATA-$(call ALLYES, SSIM_FILTER SCALE_FILTER) += fate-filter-refcmp-ssim-rgb
 fate-filter-refcmp-ssim-rgb: CMD = refcmp_metadata ssim rgb24 0.015
 
@@ -31,6 +31,10 @@ FATE_LIBAVUTIL += fate-audio_fifo
 fate-audio_fifo: libavutil/tests/audio_fifo$(EXESUF)
 fate-audio_fifo: CMD = run libavutil/tests/audio_fifo$(EXESUF)
 
+FATE_LIBAVUTIL += fate-audio_frame_fifo
+fate-audio_frame_fifo: libavutil/tests/audio_frame_fifo$(EXESUF)
+fate-audio_frame_fifo: CMD = run libavutil/tests/audio_frame_fifo$(EXESUF)
+
 FATE_LIBAVUTIL += fate-avstring
 fate-avstring: libavutil/tests/avstring$(EXESUF)
 fate-avstring: CMD = run libavutil/tests/avstring$(EXESUF)
@@ -157,6 +161,11 @@ fate-tree: libavutil/tests/tree$(EXESUF)
 fate-tree: CMD = run libavutil/tests/tree$(EXESUF)
 fate-tree: CMP = null
 
+FATE_LIBAVUTIL-$(HAVE_THREADS) += fate-tx_cache
+fate-tx_cache: libavutil/tests/tx_cache$(EXESUF)
+fate-tx_cache: CMD = run libavutil/tests/tx_cache$(EXESUF)
+fate-tx_cache: CMP = null
+
 FATE_LIBAVUTIL += fate-twofish
 fate-twofish: libavutil/tests/twofish$(EXESUF)
 fate-twofish: CMD = run libavutil/tests/twofish$(EXESUF)
@@ -0,0 +1,87 @@
+# Performance regression workloads. They are not part of "make fate", run
+# them with "make fate-perf" without -j on an otherwise idle machine. The
+# results are written to tests/data/perf/results.json, one JSON object per
+# line, and the target fails if any workload got slower than its baseline.
+#
+# PERF_RUNS       number of runs per workload, the median is reported (3)
+# PERF_BASELINE   results of an earlier run to compare against
+# PERF_TOLERANCE  slowdown in percent tolerated against the baseline (10)
+#
+# "make fate-perf-baseline PERF_BASELINE=file" stores the results of a run
+# as a new baseline. Baselines are only meaningful on the machine and with
+# the configuration they were recorded with.
+
+PERF_VSRC = testsrc2=s=1920x1080:r=25:d=8
+PERF_ASRC = anoisesrc=r=48000:d=120:seed=1
+
+# swscale conversions
+FATE_PERF-$(call ALLYES, TESTSRC2_FILTER FORMAT_FILTER SCALE_FILTER WRAPPED_AVFRAME_ENCODER NULL_MUXER) += fate-perf-sws-yuv420p-rgb24
+fate-perf-sws-yuv420p-rgb24: ARGS = -filter_complex "$(PERF_VSRC),format=yuv420p,scale=flags=bicubic,format=rgb24" -f null -
+
+FATE_PERF-$(call ALLYES, TESTSRC2_FILTER FORMAT_FILTER SCALE_FILTER WRAPPED_AVFRAME_ENCODER NULL_MUXER) += fate-perf-sws-rgb24-yuv420p-720p
+fate-perf-sws-rgb24-yuv420p-720p: ARGS = -filter_complex "$(PERF_VSRC),format=rgb24,scale=1280:720:flags=bicubic,format=yuv420p" -f null -
+
+FATE_PERF-$(call ALLYES, TESTSRC2_FILTER FORMAT_FILTER SCALE_FILTER WRAPPED_AVFRAME_ENCODER NULL_MUXER) += fate-perf-sws-yuv420p10-yuv420p
+fate-perf-sws-yuv420p10-yuv420p: ARGS = -filter_complex "$(PERF_VSRC),format=yuv420p10,scale=flags=bicubic,format=yuv420p" -f null -
+
+# audio filters
+FATE_PERF-$(call ALLYES, ANOISESRC_FILTER ARESAMPLE_FILTER PCM_S16LE_ENCODER NULL_MUXER) += fate-perf-aresample-44100
+fate-perf-aresample-44100: ARGS = -filter_complex "$(PERF_ASRC),aresample=44100" -f null -
+
+FATE_PERF-$(call ALLYES, ANOISESRC_FILTER LOUDNORM_FILTER PCM_S16LE_ENCODER NULL_MUXER) += fate-perf-loudnorm
+fate-perf-loudnorm: ARGS = -filter_complex "anoisesrc=r=48000:d=20:seed=1,loudnorm" -f null -
+
+# encoding
+FATE_PERF-$(call ALLYES, TESTSRC2_FILTER FORMAT_FILTER MPEG4_ENCODER NULL_MUXER) += fate-perf-enc-mpeg4
+fate-perf-enc-mpeg4: ARGS = -filter_complex "$(PERF_VSRC),format=yuv420p" -c:v mpeg4 -q:v 3 -f null -
+
+FATE_PERF-$(call ALLYES, TESTSRC2_FILTER FORMAT_FILTER FFV1_ENCODER NULL_MUXER) += fate-perf-enc-ffv1
+fate-perf-enc-ffv1: ARGS = -filter_complex "$(PERF_VSRC),format=yuv420p" -c:v ffv1 -f null -
+
+FATE_PERF-$(call ALLYES, ANOISESRC_FILTER AFORMAT_FILTER FLAC_ENCODER PCM_S16LE_ENCODER NULL_MUXER) += fate-perf-enc-flac
+fate-perf-enc-flac: ARGS = -filter_complex "$(PERF_ASRC),aformat=s16" -c:a flac -f null -
+
+# decoding and (de)muxing of a file generated by ffmpeg itself
+tests/data/perf/mpeg4.avi: TAG = GEN
+tests/data/perf/mpeg4.avi: ffmpeg$(PROGSSUF)$(EXESUF) | tests/data/perf
+	$(M)./$< -nostdin -v error -y -filter_complex "$(PERF_VSRC),format=yuv420p" -c:v mpeg4 -q:v 3 $@
+
+PERF_MPEG4 = TESTSRC2_FILTER FORMAT_FILTER MPEG4_ENCODER AVI_MUXER FILE_PROTOCOL AVI_DEMUXER
+
+FATE_PERF-$(call ALLYES, $(PERF_MPEG4) MPEG4_DECODER WRAPPED_AVFRAME_ENCODER NULL_MUXER) += fate-perf-dec-mpeg4
+fate-perf-dec-mpeg4: tests/data/perf/mpeg4.avi
+fate-perf-dec-mpeg4: ARGS = -stream_loop 4 -i $(TARGET_PATH)/tests/data/perf/mpeg4.avi -f null -
+
+FATE_PERF-$(call ALLYES, $(PERF_MPEG4) MATROSKA_MUXER) += fate-perf-remux-avi-mkv
+fate-perf-remux-avi-mkv: tests/data/perf/mpeg4.avi
+fate-perf-remux-avi-mkv: ARGS = -stream_loop 49 -i $(TARGET_PATH)/tests/data/perf/mpeg4.avi -c copy -y $(TARGET_PATH)/tests/data/perf/remux.mkv
+
+# decoding of conformance samples
+FATE_PERF_SAMPLES-$(call ALLYES, FILE_PROTOCOL H264_DEMUXER H264_PARSER H264_DECODER WRAPPED_AVFRAME_ENCODER NULL_MUXER) += fate-perf-dec-h264
+fate-perf-dec-h264: ARGS = -stream_loop 9 -i $(TARGET_SAMPLES)/h264-conformance/CABA3_TOSHIBA_E.264 -f null -
+
+FATE_PERF_SAMPLES-$(call ALLYES, FILE_PROTOCOL HEVC_DEMUXER HEVC_PARSER HEVC_DECODER WRAPPED_AVFRAME_ENCODER NULL_MUXER) += fate-perf-dec-hevc
+fate-perf-dec-hevc: ARGS = -stream_loop 9 -i $(TARGET_SAMPLES)/hevc-conformance/WPP_A_ericsson_MAIN10_2.bit -f null -
+
+ifdef SAMPLES
+FATE_PERF-yes += $(FATE_PERF_SAMPLES-yes)
+endif
+
+FATE_PERF = $(FATE_PERF-yes)
+
+$(FATE_PERF): export PROGSUF = $(PROGSSUF)
+$(FATE_PERF): export EXECSUF = $(EXESUF)
+$(FATE_PERF): ffmpeg$(PROGSSUF)$(EXESUF) | tests/data/perf
+	@echo "PERF    $(@:fate-perf-%=%)"
+	$(Q)$(SRC_PATH)/tests/perf.sh $@ "$(TARGET_EXEC)" "$(TARGET_PATH)" '$(ARGS)' '$(PERF_RUNS)' '$(PERF_BASELINE)' '$(PERF_TOLERANCE)' > tests/data/perf/$(@:fate-perf-%=%).json
+
+fate-perf: $(FATE_PERF)
+	$(Q)cat $(FATE_PERF:fate-perf-%=tests/data/perf/%.json) > tests/data/perf/results.json
+	$(Q)! grep '"status":"slower"' tests/data/perf/results.json
+
+fate-perf-baseline: $(FATE_PERF)
+	$(if $(PERF_BASELINE),,$(error PERF_BASELINE must be set))
+	$(Q)cat $(FATE_PERF:fate-perf-%=tests/data/perf/%.json) > $(PERF_BASELINE)
+
+fate-perf-list:
+	@printf '%s\n' $(sort $(FATE_PERF))
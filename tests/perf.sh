@@ -0,0 +1,63 @@
+#!/bin/sh
+#
+# Run one fate-perf workload and print the result as a single line of JSON.
+#
+# The workload is run $runs times with -benchmark and the run with the
+# median user time is reported. If a baseline file is given, the user time
+# is compared against the line of the same test in it (baselines are the
+# concatenated output of an earlier run) and the result is marked "slower"
+# when it is more than $tolerance percent above it.
+
+export LC_ALL=C
+
+test="${1#fate-perf-}"
+target_exec=$2
+target_path=$3
+args=$4
+runs=${5:-3}
+baseline=$6
+tolerance=${7:-10}
+
+outdir="tests/data/perf"
+errfile="${outdir}/${test}.err"
+benchfile="${outdir}/${test}.bench"
+
+: > "$benchfile"
+i=0
+while [ $i -lt $runs ]; do
+    eval $target_exec $target_path/ffmpeg${PROGSUF}${EXECSUF} \
+        -nostdin -hide_banner -nostats -benchmark -threads 1 $args > "$errfile" 2>&1 || {
+        tail -n 5 "$errfile" >&2
+        printf '{"test":"%s","status":"error"}\n' "$test"
+        exit 1
+    }
+    sed -n 's/^bench: utime=\([0-9.]*\)s stime=\([0-9.]*\)s rtime=\([0-9.]*\)s/\1 \2 \3/p;
+            s/^bench: maxrss=\([0-9]*\)KiB/maxrss \1/p' "$errfile" |
+        awk '$1 == "maxrss" { rss = $2; next } { t = $0 } END { print t, rss }' >> "$benchfile"
+    i=$((i + 1))
+done
+
+ref=
+if [ -n "$baseline" ] && [ -f "$baseline" ]; then
+    ref=$(sed -n "s/^{\"test\":\"${test}\",.*\"utime_us\":\([0-9]*\),.*/\1/p" "$baseline")
+fi
+
+sort -n "$benchfile" | awk -v test="$test" -v runs="$runs" -v ref="$ref" -v tol="$tolerance" '
+    { u[NR] = $1; s[NR] = $2; r[NR] = $3; m[NR] = $4 }
+    END {
+        k = int((NR + 1) / 2)
+        printf "{\"test\":\"%s\",\"runs\":%d,\"utime_us\":%d,\"stime_us\":%d,\"rtime_us\":%d,\"maxrss_kb\":%d",
+               test, runs, u[k] * 1e6 + 0.5, s[k] * 1e6 + 0.5, r[k] * 1e6 + 0.5, m[k]
+        status = "ok"
+        if (ref == "") {
+            status = "new"
+        } else {
+            ratio = ref > 0 ? (u[k] * 1e6) / ref : 1
+            printf ",\"baseline_us\":%d,\"ratio\":%.3f", ref, ratio
+            if (ratio > 1 + tol / 100)
+                status = "slower"
+            else if (ratio < 1 - tol / 100)
+                status = "faster"
+        }
+        printf ",\"status\":\"%s\"}\n", status
+    }'
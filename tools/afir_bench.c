@@ -0,0 +1,295 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Benchmark the afir filter for a range of partition layouts.
+ *
+ * For every minp/maxp pair a graph with a random, exponentially decaying
+ * impulse response is run and the cost of the steady state convolution
+ * is reported per sample and channel. The last line shows the layout
+ * selected by minp=auto:maxp=auto for the same configuration.
+ */
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "config.h"
+
+#include "libavutil/channel_layout.h"
+#include "libavutil/error.h"
+#include "libavutil/frame.h"
+#include "libavutil/lfg.h"
+#include "libavutil/mem.h"
+#include "libavutil/opt.h"
+#include "libavutil/samplefmt.h"
+#include "libavutil/time.h"
+#include "libavutil/timer.h"
+#include "libavfilter/avfilter.h"
+#include "libavfilter/buffersink.h"
+#include "libavfilter/buffersrc.h"
+
+#ifndef AV_READ_TIME
+#define AV_READ_TIME(x) 0
+#endif
+
+#if HAVE_UNISTD_H
+#include <unistd.h> /* for getopt */
+#endif
+#if !HAVE_GETOPT
+#include "compat/getopt.c"
+#endif
+
+#define FRAME_SIZE 1024
+
+static int sample_rate = 48000;
+static int nb_channels = 2;
+static double ir_length = 1.;
+static double duration = 10.;
+static int threads = 1;
+static int is_double;
+
+static void fill_noise(AVFrame *frame, AVLFG *lfg, double decay)
+{
+    for (int ch = 0; ch < frame->ch_layout.nb_channels; ch++) {
+        for (int n = 0; n < frame->nb_samples; n++) {
+            double v = (av_lfg_get(lfg) / (double)UINT_MAX - 0.5) *
+                       exp(-decay * n / sample_rate);
+
+            if (is_double)
+                ((double *)frame->extended_data[ch])[n] = v;
+            else
+                ((float *)frame->extended_data[ch])[n] = v;
+        }
+    }
+}
+
+static AVFrame *alloc_frame(int channels, int nb_samples)
+{
+    AVFrame *frame = av_frame_alloc();
+
+    if (!frame)
+        return NULL;
+
+    frame->format      = is_double ? AV_SAMPLE_FMT_DBLP : AV_SAMPLE_FMT_FLTP;
+    frame->sample_rate = sample_rate;
+    frame->nb_samples  = nb_samples;
+    av_channel_layout_default(&frame->ch_layout, channels);
+    if (av_frame_get_buffer(frame, 0) < 0)
+        av_frame_free(&frame);
+
+    return frame;
+}
+
+static int create_src(AVFilterGraph *graph, AVFilterContext **src,
+                      const char *name, int channels)
+{
+    AVChannelLayout layout;
+    char args[256], buf[64];
+
+    av_channel_layout_default(&layout, channels);
+    av_channel_layout_describe(&layout, buf, sizeof(buf));
+    snprintf(args, sizeof(args), "sample_rate=%d:sample_fmt=%s:channel_layout=%s",
+             sample_rate, is_double ? "dblp" : "fltp", buf);
+
+    return avfilter_graph_create_filter(src, avfilter_get_by_name("abuffer"),
+                                        name, args, NULL, graph);
+}
+
+static int drain(AVFilterContext *sink, AVFrame *out, int *got)
+{
+    int ret;
+
+    while ((ret = av_buffersink_get_frame(sink, out)) >= 0) {
+        *got = 1;
+        av_frame_unref(out);
+    }
+
+    return ret == AVERROR(EAGAIN) || ret == AVERROR_EOF ? 0 : ret;
+}
+
+static int run_layout(const char *minp, const char *maxp,
+                      const AVFrame *ir_frame, AVFrame *in_frame)
+{
+    AVFilterContext *src = NULL, *ir = NULL, *afir = NULL, *sink = NULL;
+    AVFilterGraph *graph;
+    AVFrame *out = NULL;
+    uint64_t start_cycles, cycles;
+    int64_t start_time, elapsed, nb_samples = 0, pts = 0;
+    int64_t sel_minp = 0, sel_maxp = 0;
+    int64_t total = duration * sample_rate;
+    char args[256];
+    int ret, got = 0;
+
+    graph = avfilter_graph_alloc();
+    out = av_frame_alloc();
+    if (!graph || !out) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    graph->nb_threads = threads;
+
+    snprintf(args, sizeof(args), "minp=%s:maxp=%s:irfmt=mono:precision=%s",
+             minp, maxp, is_double ? "double" : "float");
+
+    if ((ret = create_src(graph, &src, "in", nb_channels)) < 0 ||
+        (ret = create_src(graph, &ir, "ir", 1)) < 0 ||
+        (ret = avfilter_graph_create_filter(&afir, avfilter_get_by_name("afir"),
+                                            "afir", args, NULL, graph)) < 0 ||
+        (ret = avfilter_graph_create_filter(&sink, avfilter_get_by_name("abuffersink"),
+                                            "out", NULL, NULL, graph)) < 0)
+        goto end;
+
+    if ((ret = avfilter_link(src, 0, afir, 0)) < 0 ||
+        (ret = avfilter_link(ir, 0, afir, 1)) < 0 ||
+        (ret = avfilter_link(afir, 0, sink, 0)) < 0 ||
+        (ret = avfilter_graph_config(graph, NULL)) < 0)
+        goto end;
+
+    if ((ret = av_buffersrc_add_frame_flags(ir, (AVFrame *)ir_frame,
+                                            AV_BUFFERSRC_FLAG_KEEP_REF)) < 0 ||
+        (ret = av_buffersrc_add_frame(ir, NULL)) < 0)
+        goto end;
+
+    /* warm up until the IR is loaded and output is produced */
+    while (!got) {
+        in_frame->pts = pts;
+        pts += in_frame->nb_samples;
+        if ((ret = av_buffersrc_add_frame_flags(src, in_frame, AV_BUFFERSRC_FLAG_KEEP_REF)) < 0 ||
+            (ret = drain(sink, out, &got)) < 0)
+            goto end;
+    }
+
+    start_time = av_gettime_relative();
+    start_cycles = AV_READ_TIME();
+    while (nb_samples < total) {
+        in_frame->pts = pts;
+        pts += in_frame->nb_samples;
+        nb_samples += in_frame->nb_samples;
+        if ((ret = av_buffersrc_add_frame_flags(src, in_frame, AV_BUFFERSRC_FLAG_KEEP_REF)) < 0 ||
+            (ret = drain(sink, out, &got)) < 0)
+            goto end;
+    }
+    cycles = AV_READ_TIME() - start_cycles;
+    elapsed = av_gettime_relative() - start_time;
+
+    if ((ret = av_buffersrc_add_frame(src, NULL)) < 0 ||
+        (ret = drain(sink, out, &got)) < 0)
+        goto end;
+
+    av_opt_get_int(afir, "minp", AV_OPT_SEARCH_CHILDREN, &sel_minp);
+    av_opt_get_int(afir, "maxp", AV_OPT_SEARCH_CHILDREN, &sel_maxp);
+
+    nb_samples *= nb_channels;
+    printf("%5"PRId64" %5"PRId64" %14.2f %10.2f%s\n", sel_minp, sel_maxp,
+           cycles / (double)nb_samples, elapsed * 1000. / nb_samples,
+           strcmp(minp, "auto") ? "" : " (auto)");
+    fflush(stdout);
+
+end:
+    if (ret < 0)
+        fprintf(stderr, "minp=%s maxp=%s: %s\n", minp, maxp, av_err2str(ret));
+    av_frame_free(&out);
+    avfilter_graph_free(&graph);
+    return ret;
+}
+
+static void usage(const char *name)
+{
+    printf("Usage: %s [options]\n"
+           "-r rate      sample rate (default %d)\n"
+           "-c channels  number of channels (default %d)\n"
+           "-l seconds   IR length (default %g)\n"
+           "-d seconds   audio processed per layout (default %g)\n"
+           "-m min       smallest min partition size (default 16)\n"
+           "-M max       largest min partition size (default 8192)\n"
+           "-t threads   number of filter threads (default %d)\n"
+           "-D           use double precision\n",
+           name, sample_rate, nb_channels, ir_length, duration, threads);
+}
+
+int main(int argc, char **argv)
+{
+    AVFrame *ir_frame = NULL, *in_frame = NULL;
+    int min_part = 16, max_part = 8192;
+    int nb_taps, ret = 0, opt;
+    AVLFG lfg;
+
+    while ((opt = getopt(argc, argv, "hr:c:l:d:m:M:t:D")) != -1) {
+        switch (opt) {
+        case 'r': sample_rate = atoi(optarg);  break;
+        case 'c': nb_channels = atoi(optarg);  break;
+        case 'l': ir_length   = atof(optarg);  break;
+        case 'd': duration    = atof(optarg);  break;
+        case 'm': min_part    = atoi(optarg);  break;
+        case 'M': max_part    = atoi(optarg);  break;
+        case 't': threads     = atoi(optarg);  break;
+        case 'D': is_double   = 1;             break;
+        case 'h':
+            usage(argv[0]);
+            return 0;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    nb_taps = ir_length * sample_rate;
+    if (sample_rate <= 0 || nb_channels <= 0 || nb_taps <= 0 || duration <= 0 ||
+        min_part <= 0 || max_part < min_part || max_part > 65536) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    av_lfg_init(&lfg, 0xdeadbeef);
+    ir_frame = alloc_frame(1, nb_taps);
+    in_frame = alloc_frame(nb_channels, FRAME_SIZE);
+    if (!ir_frame || !in_frame) {
+        ret = 1;
+        goto end;
+    }
+    fill_noise(ir_frame, &lfg, 8. / ir_length);
+    fill_noise(in_frame, &lfg, 0.);
+
+    printf("IR: %d taps, %d channels, %d Hz, %s\n", nb_taps, nb_channels,
+           sample_rate, is_double ? "double" : "float");
+    printf(" minp  maxp cycles/sample  ns/sample\n");
+
+    for (int minp = min_part; minp <= max_part; minp *= 2) {
+        for (int maxp = FFMAX(minp, 8); maxp <= 65536; maxp *= 2) {
+            char minp_str[16], maxp_str[16];
+
+            snprintf(minp_str, sizeof(minp_str), "%d", minp);
+            snprintf(maxp_str, sizeof(maxp_str), "%d", maxp);
+            if (run_layout(minp_str, maxp_str, ir_frame, in_frame) < 0)
+                ret = 1;
+            /* larger partitions than the IR change nothing */
+            if (maxp >= nb_taps)
+                break;
+        }
+    }
+
+    if (run_layout("auto", "auto", ir_frame, in_frame) < 0)
+        ret = 1;
+
+end:
+    av_frame_free(&ir_frame);
+    av_frame_free(&in_frame);
+    return ret;
+}
@@ -77,6 +77,7 @@ struct hash_impl {
 #include "libavutil/sha512.h"
 #include "libavutil/ripemd.h"
 #include "libavutil/aes.h"
+#include "libavutil/aes_ctr.h"
 #include "libavutil/blowfish.h"
 #include "libavutil/camellia.h"
 #include "libavutil/cast5.h"
@@ -121,6 +122,27 @@ static void run_lavu_aes128(uint8_t *output,
     av_aes_crypt(aes, output, input, size >> 4, NULL, 0);
 }
 
+static void run_lavu_aes128cbc(uint8_t *output,
+                               const uint8_t *input, unsigned size)
+{
+    static struct AVAES *aes;
+    uint8_t iv[16] = { 0 };
+    if (!aes && !(aes = av_aes_alloc()))
+        fatal_error("out of memory");
+    av_aes_init(aes, hardcoded_key, 128, 0);
+    av_aes_crypt(aes, output, input, size >> 4, iv, 0);
+}
+
+static void run_lavu_aes128ctr(uint8_t *output,
+                               const uint8_t *input, unsigned size)
+{
+    static struct AVAESCTR *aes;
+    if (!aes && !(aes = av_aes_ctr_alloc()))
+        fatal_error("out of memory");
+    av_aes_ctr_init(aes, hardcoded_key);
+    av_aes_ctr_crypt(aes, output, input, size);
+}
+
 static void run_lavu_blowfish(uint8_t *output,
                               const uint8_t *input, unsigned size)
 {
@@ -233,6 +255,16 @@ static void run_crypto_aes128(uint8_t *output,
         AES_encrypt(input + i, output + i, &aes);
 }
 
+static void run_crypto_aes128cbc(uint8_t *output,
+                                 const uint8_t *input, unsigned size)
+{
+    AES_KEY aes;
+    uint8_t iv[16] = { 0 };
+
+    AES_set_encrypt_key(hardcoded_key, 128, &aes);
+    AES_cbc_encrypt(input, output, size & ~15, &aes, iv, AES_ENCRYPT);
+}
+
 static void run_crypto_blowfish(uint8_t *output,
                                 const uint8_t *input, unsigned size)
 {
@@ -648,6 +680,9 @@ struct hash_impl implementations[] = {
     IMPL(tomcrypt, "RIPEMD-128", ripemd128, "9ab8bfba2ddccc5d99c9d4cdfb844a5f")
     IMPL_ALL("RIPEMD-160", ripemd160, "62a5321e4fc8784903bb43ab7752c75f8b25af00")
     IMPL_ALL("AES-128",    aes128,    "crc:ff6bc888")
+    IMPL(lavu,     "AES-128-CBC", aes128cbc, "crc:0efebabe")
+    IMPL(crypto,   "AES-128-CBC", aes128cbc, "crc:0efebabe")
+    IMPL(lavu,     "AES-128-CTR", aes128ctr, "crc:b9fd39aa")
     IMPL_ALL("CAMELLIA",   camellia,  "crc:7abb59a7")
     IMPL(lavu,     "CAST-128", cast128, "crc:456aa584")
     IMPL(crypto,   "CAST-128", cast128, "crc:456aa584")
@@ -0,0 +1,539 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Benchmark a single filter on synthetic input.
+ *
+ * For every combination of thread count, format and frame size (video) or
+ * channel count (audio), a few input frames are rendered with testsrc2 or
+ * anoisesrc and then fed to the filter through buffer sources, the same
+ * frames to every input. Only the time spent in the filter graph is
+ * measured: making a fresh writable copy of each input frame happens
+ * outside of the timed section, so that filters working in place are not
+ * charged for it.
+ *
+ * Results are printed as a JSON array with one object per configuration.
+ * Video costs are given per pixel of one input frame, audio costs per
+ * sample and channel. Filters without inputs are benchmarked by pulling
+ * frames from their outputs.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+
+#if HAVE_GETRUSAGE
+#include <sys/time.h>
+#include <sys/resource.h>
+#endif
+
+#include "libavutil/avstring.h"
+#include "libavutil/channel_layout.h"
+#include "libavutil/error.h"
+#include "libavutil/frame.h"
+#include "libavutil/mem.h"
+#include "libavutil/parseutils.h"
+#include "libavutil/pixdesc.h"
+#include "libavutil/samplefmt.h"
+#include "libavutil/time.h"
+#include "libavutil/timer.h"
+#include "libavfilter/avfilter.h"
+#include "libavfilter/buffersink.h"
+#include "libavfilter/buffersrc.h"
+
+#ifndef AV_READ_TIME
+#define AV_READ_TIME(x) 0
+#endif
+
+#if HAVE_UNISTD_H
+#include <unistd.h> /* for getopt */
+#endif
+#if !HAVE_GETOPT
+#include "compat/getopt.c"
+#endif
+
+#define NB_INPUT_FRAMES 4
+#define MAX_INPUTS      16
+#define FRAME_RATE      25
+
+static int nb_frames   = 100;
+static int nb_warmup   = 10;
+static int sample_rate = 48000;
+static int nb_samples  = 1024;
+
+typedef struct BenchConfig {
+    int threads;
+    const char *format;
+    int w, h;
+    int channels;
+} BenchConfig;
+
+typedef struct BenchResult {
+    int64_t elapsed;    /* microseconds */
+    uint64_t cycles;
+    int64_t nb_units;   /* pixels or samples * channels */
+    int frames_in;
+    int frames_out;
+} BenchResult;
+
+static void print_json_string(const char *str)
+{
+    putchar('"');
+    for (; *str; str++) {
+        if (*str == '"' || *str == '\\')
+            printf("\\%c", *str);
+        else if ((unsigned char)*str < 0x20)
+            printf("\\u%04x", *str);
+        else
+            putchar(*str);
+    }
+    putchar('"');
+}
+
+static int64_t get_maxrss(void)
+{
+#if HAVE_GETRUSAGE && HAVE_STRUCT_RUSAGE_RU_MAXRSS
+    struct rusage rusage;
+
+    getrusage(RUSAGE_SELF, &rusage);
+    return rusage.ru_maxrss;
+#else
+    return 0;
+#endif
+}
+
+static int create_sink(AVFilterGraph *graph, AVFilterContext **sink,
+                       enum AVMediaType type, int idx)
+{
+    char name[32];
+
+    snprintf(name, sizeof(name), "out%d", idx);
+    return avfilter_graph_create_filter(sink, avfilter_get_by_name(type == AVMEDIA_TYPE_VIDEO ?
+                                                                   "buffersink" : "abuffersink"),
+                                        name, NULL, NULL, graph);
+}
+
+static int render_input(enum AVMediaType type, const BenchConfig *cfg, AVFrame **frames)
+{
+    AVFilterGraph *graph = avfilter_graph_alloc();
+    AVFilterInOut *inputs = NULL, *outputs = NULL;
+    AVFilterContext *sink;
+    char desc[256];
+    int ret;
+
+    if (!graph)
+        return AVERROR(ENOMEM);
+
+    if (type == AVMEDIA_TYPE_VIDEO) {
+        snprintf(desc, sizeof(desc), "testsrc2=s=%dx%d:r=%d,format=pix_fmts=%s",
+                 cfg->w, cfg->h, FRAME_RATE, cfg->format);
+    } else {
+        AVChannelLayout layout;
+        char buf[64];
+
+        av_channel_layout_default(&layout, cfg->channels);
+        av_channel_layout_describe(&layout, buf, sizeof(buf));
+        snprintf(desc, sizeof(desc), "anoisesrc=r=%d:n=%d:c=pink:seed=1,"
+                 "aformat=sample_fmts=%s:channel_layouts=%s",
+                 sample_rate, nb_samples, cfg->format, buf);
+    }
+
+    if ((ret = avfilter_graph_parse2(graph, desc, &inputs, &outputs)) < 0 ||
+        (ret = create_sink(graph, &sink, type, 0)) < 0 ||
+        (ret = avfilter_link(outputs->filter_ctx, outputs->pad_idx, sink, 0)) < 0 ||
+        (ret = avfilter_graph_config(graph, NULL)) < 0)
+        goto end;
+
+    for (int n = 0; n < NB_INPUT_FRAMES; n++) {
+        if (!(frames[n] = av_frame_alloc())) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        if ((ret = av_buffersink_get_frame(sink, frames[n])) < 0)
+            goto end;
+    }
+
+end:
+    avfilter_inout_free(&inputs);
+    avfilter_inout_free(&outputs);
+    avfilter_graph_free(&graph);
+    return ret;
+}
+
+static int create_src(AVFilterGraph *graph, AVFilterContext **src,
+                      const AVFrame *frame, enum AVMediaType type, int idx)
+{
+    AVBufferSrcParameters *par = av_buffersrc_parameters_alloc();
+    char name[32];
+    int ret;
+
+    if (!par)
+        return AVERROR(ENOMEM);
+
+    snprintf(name, sizeof(name), "in%d", idx);
+    *src = avfilter_graph_alloc_filter(graph, avfilter_get_by_name(type == AVMEDIA_TYPE_VIDEO ?
+                                                                   "buffer" : "abuffer"), name);
+    if (!*src) {
+        av_free(par);
+        return AVERROR(ENOMEM);
+    }
+
+    par->format = frame->format;
+    if (type == AVMEDIA_TYPE_VIDEO) {
+        par->time_base           = av_make_q(1, FRAME_RATE);
+        par->width               = frame->width;
+        par->height              = frame->height;
+        par->sample_aspect_ratio = frame->sample_aspect_ratio;
+    } else {
+        par->time_base   = av_make_q(1, sample_rate);
+        par->sample_rate = frame->sample_rate;
+        par->ch_layout   = frame->ch_layout;
+    }
+    ret = av_buffersrc_parameters_set(*src, par);
+    av_free(par);
+    if (ret < 0)
+        return ret;
+
+    return avfilter_init_str(*src, NULL);
+}
+
+static AVFrame *writable_copy(const AVFrame *src)
+{
+    AVFrame *frame = av_frame_alloc();
+
+    if (!frame)
+        return NULL;
+
+    frame->format = src->format;
+    frame->width  = src->width;
+    frame->height = src->height;
+    frame->nb_samples = src->nb_samples;
+    if (av_channel_layout_copy(&frame->ch_layout, &src->ch_layout) < 0 ||
+        av_frame_get_buffer(frame, 0) < 0 ||
+        av_frame_copy(frame, src) < 0 ||
+        av_frame_copy_props(frame, src) < 0)
+        av_frame_free(&frame);
+
+    return frame;
+}
+
+static int drain(AVFilterContext **sinks, int nb_sinks, AVFrame *out, int *nb_out)
+{
+    for (int i = 0; i < nb_sinks; i++) {
+        int ret;
+
+        while ((ret = av_buffersink_get_frame(sinks[i], out)) >= 0) {
+            *nb_out += i == 0;
+            av_frame_unref(out);
+        }
+        if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF)
+            return ret;
+    }
+
+    return 0;
+}
+
+static int run_config(const char *name, const char *args, const BenchConfig *cfg,
+                      BenchResult *res)
+{
+    const AVFilter *f = avfilter_get_by_name(name);
+    AVFilterContext *filter, **srcs = NULL, **sinks = NULL;
+    AVFrame *frames[NB_INPUT_FRAMES] = { NULL };
+    AVFilterGraph *graph;
+    AVFrame *out = NULL;
+    enum AVMediaType type;
+    int nb_inputs, nb_outputs, ret;
+
+    graph = avfilter_graph_alloc();
+    out = av_frame_alloc();
+    if (!graph || !out) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    graph->nb_threads = cfg->threads;
+
+    if ((ret = avfilter_graph_create_filter(&filter, f, "bench", args, NULL, graph)) < 0)
+        goto end;
+
+    /* dynamic inputs and outputs are only known once the filter is initialized */
+    nb_inputs  = filter->nb_inputs;
+    nb_outputs = filter->nb_outputs;
+    if (!nb_outputs) {
+        ret = AVERROR(ENOSYS);
+        goto end;
+    }
+    if (nb_inputs > MAX_INPUTS) {
+        ret = AVERROR(ENOSYS);
+        goto end;
+    }
+    type = avfilter_pad_get_type(nb_inputs ? filter->input_pads : filter->output_pads, 0);
+    for (int i = 1; i < nb_inputs; i++) {
+        if (avfilter_pad_get_type(filter->input_pads, i) != type) {
+            ret = AVERROR(ENOSYS);
+            goto end;
+        }
+    }
+
+    srcs  = av_calloc(nb_inputs,  sizeof(*srcs));
+    sinks = av_calloc(nb_outputs, sizeof(*sinks));
+    if ((nb_inputs && !srcs) || !sinks) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    if (nb_inputs && (ret = render_input(type, cfg, frames)) < 0)
+        goto end;
+
+    for (int i = 0; i < nb_inputs; i++) {
+        if ((ret = create_src(graph, &srcs[i], frames[0], type, i)) < 0 ||
+            (ret = avfilter_link(srcs[i], 0, filter, i)) < 0)
+            goto end;
+    }
+    for (int i = 0; i < nb_outputs; i++) {
+        if ((ret = create_sink(graph, &sinks[i], avfilter_pad_get_type(filter->output_pads, i), i)) < 0 ||
+            (ret = avfilter_link(filter, i, sinks[i], 0)) < 0)
+            goto end;
+    }
+    if ((ret = avfilter_graph_config(graph, NULL)) < 0)
+        goto end;
+
+    for (int n = 0; n < nb_warmup + nb_frames; n++) {
+        const int timed = n >= nb_warmup;
+        AVFrame *in[MAX_INPUTS] = { NULL };
+        int64_t start_time;
+        uint64_t start_cycles;
+        int nb_out = 0;
+
+        for (int i = 0; i < nb_inputs; i++) {
+            if (!(in[i] = writable_copy(frames[n % NB_INPUT_FRAMES]))) {
+                ret = AVERROR(ENOMEM);
+                goto end;
+            }
+            in[i]->pts = type == AVMEDIA_TYPE_VIDEO ? n : (int64_t)n * in[i]->nb_samples;
+            in[i]->duration = type == AVMEDIA_TYPE_VIDEO ? 1 : in[i]->nb_samples;
+        }
+
+        start_time = av_gettime_relative();
+        start_cycles = AV_READ_TIME();
+        if (nb_inputs) {
+            for (int i = 0; i < nb_inputs && ret >= 0; i++)
+                ret = av_buffersrc_add_frame_flags(srcs[i], in[i], AV_BUFFERSRC_FLAG_PUSH);
+            if (ret >= 0)
+                ret = drain(sinks, nb_outputs, out, &nb_out);
+        } else {
+            ret = av_buffersink_get_frame(sinks[0], out);
+            if (ret >= 0) {
+                res->nb_units += timed ? (int64_t)out->width * out->height +
+                                         (int64_t)out->nb_samples * out->ch_layout.nb_channels : 0;
+                res->frames_out += timed;
+                av_frame_unref(out);
+            }
+        }
+        if (timed) {
+            res->cycles  += AV_READ_TIME() - start_cycles;
+            res->elapsed += av_gettime_relative() - start_time;
+            res->frames_out += nb_out;
+        }
+        for (int i = 0; i < nb_inputs; i++)
+            av_frame_free(&in[i]);
+        if (ret < 0)
+            goto end;
+
+        if (timed && nb_inputs) {
+            const AVFrame *frame = frames[n % NB_INPUT_FRAMES];
+
+            res->nb_units += type == AVMEDIA_TYPE_VIDEO ?
+                             (int64_t)frame->width * frame->height :
+                             (int64_t)frame->nb_samples * frame->ch_layout.nb_channels;
+            res->frames_in++;
+        }
+    }
+
+    /* flush whatever the filter still buffers */
+    if (nb_inputs) {
+        int64_t start_time = av_gettime_relative();
+        uint64_t start_cycles = AV_READ_TIME();
+
+        for (int i = 0; i < nb_inputs && ret >= 0; i++)
+            ret = av_buffersrc_add_frame_flags(srcs[i], NULL, AV_BUFFERSRC_FLAG_PUSH);
+        if (ret >= 0)
+            ret = drain(sinks, nb_outputs, out, &res->frames_out);
+        res->cycles  += AV_READ_TIME() - start_cycles;
+        res->elapsed += av_gettime_relative() - start_time;
+    }
+
+end:
+    for (int n = 0; n < NB_INPUT_FRAMES; n++)
+        av_frame_free(&frames[n]);
+    av_frame_free(&out);
+    av_freep(&srcs);
+    av_freep(&sinks);
+    avfilter_graph_free(&graph);
+    return ret;
+}
+
+static void print_result(const char *name, const char *args, enum AVMediaType type,
+                         const BenchConfig *cfg, const BenchResult *res, int ret, int first)
+{
+    const double units = FFMAX(res->nb_units, 1);
+
+    printf("%s  {\"filter\": ", first ? "" : ",\n");
+    print_json_string(name);
+    printf(", \"args\": ");
+    print_json_string(args ? args : "");
+    printf(", \"threads\": %d", cfg->threads);
+    if (cfg->format) {
+        printf(", \"format\": ");
+        print_json_string(cfg->format);
+    }
+    if (type == AVMEDIA_TYPE_VIDEO && cfg->w)
+        printf(", \"width\": %d, \"height\": %d", cfg->w, cfg->h);
+    else if (type == AVMEDIA_TYPE_AUDIO && cfg->channels)
+        printf(", \"channels\": %d, \"sample_rate\": %d", cfg->channels, sample_rate);
+
+    if (ret < 0) {
+        printf(", \"error\": ");
+        print_json_string(av_err2str(ret));
+        printf("}");
+        return;
+    }
+
+    printf(", \"frames_in\": %d, \"frames_out\": %d, \"time_us\": %"PRId64,
+           res->frames_in, res->frames_out, res->elapsed);
+    printf(", \"fps\": %.2f", res->elapsed ?
+           (res->frames_in ? res->frames_in : res->frames_out) * 1e6 / res->elapsed : 0.);
+    printf(", \"%s\": %.4f", type == AVMEDIA_TYPE_VIDEO ? "ns_per_pixel" : "ns_per_sample",
+           res->elapsed * 1e3 / units);
+    if (res->cycles)
+        printf(", \"%s\": %.4f", type == AVMEDIA_TYPE_VIDEO ? "cycles_per_pixel" : "cycles_per_sample",
+               res->cycles / units);
+    printf(", \"maxrss_kb\": %"PRId64"}", get_maxrss());
+}
+
+static void usage(const char *name)
+{
+    printf("Usage: %s [options] filter[=options]\n"
+           "-t threads   comma separated thread counts (default 1, 0 = auto)\n"
+           "-f formats   comma separated pixel or sample formats (default yuv420p / fltp)\n"
+           "-s sizes     comma separated video sizes (default 1280x720)\n"
+           "-c channels  comma separated audio channel counts (default 2)\n"
+           "-r rate      audio sample rate (default %d)\n"
+           "-b samples   audio samples per frame (default %d)\n"
+           "-n frames    measured frames per configuration (default %d)\n"
+           "-w frames    warm-up frames per configuration (default %d)\n",
+           name, sample_rate, nb_samples, nb_frames, nb_warmup);
+}
+
+int main(int argc, char **argv)
+{
+    const char *threads_list = "1", *formats_list = NULL;
+    const char *sizes_list = "1280x720", *channels_list = "2";
+    char *name = NULL, *args, *threads_buf = NULL, *formats_buf = NULL;
+    char *sizes_buf = NULL, *channels_buf = NULL;
+    char *tsave, *fsave, *ssave, *csave;
+    const AVFilter *f;
+    enum AVMediaType type;
+    int opt, ret = 0, first = 1, is_source;
+
+    while ((opt = getopt(argc, argv, "ht:f:s:c:r:b:n:w:")) != -1) {
+        switch (opt) {
+        case 't': threads_list  = optarg;        break;
+        case 'f': formats_list  = optarg;        break;
+        case 's': sizes_list    = optarg;        break;
+        case 'c': channels_list = optarg;        break;
+        case 'r': sample_rate   = atoi(optarg);  break;
+        case 'b': nb_samples    = atoi(optarg);  break;
+        case 'n': nb_frames     = atoi(optarg);  break;
+        case 'w': nb_warmup     = atoi(optarg);  break;
+        case 'h':
+            usage(argv[0]);
+            return 0;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (optind != argc - 1 || sample_rate <= 0 || nb_samples <= 0 ||
+        nb_frames <= 0 || nb_warmup < 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (!(name = av_strdup(argv[optind])))
+        return 1;
+    if ((args = strchr(name, '=')))
+        *args++ = 0;
+
+    if (!(f = avfilter_get_by_name(name))) {
+        fprintf(stderr, "Unknown filter '%s'\n", name);
+        av_free(name);
+        return 1;
+    }
+    type = avfilter_filter_pad_count(f, 0) ? avfilter_pad_get_type(f->inputs, 0) :
+           avfilter_filter_pad_count(f, 1) ? avfilter_pad_get_type(f->outputs, 0) :
+                                             AVMEDIA_TYPE_VIDEO;
+    if (!formats_list)
+        formats_list = type == AVMEDIA_TYPE_VIDEO ? "yuv420p" : "fltp";
+
+    /* sources generate their own frames, only the thread count applies */
+    is_source = !avfilter_filter_pad_count(f, 0) && !(f->flags & AVFILTER_FLAG_DYNAMIC_INPUTS);
+    if (is_source)
+        formats_list = sizes_list = channels_list = "-";
+
+    printf("[\n");
+    threads_buf = av_strdup(threads_list);
+    for (char *t = av_strtok(threads_buf, ",", &tsave); t; t = av_strtok(NULL, ",", &tsave)) {
+        formats_buf = av_strdup(formats_list);
+        for (char *fmt = av_strtok(formats_buf, ",", &fsave); fmt; fmt = av_strtok(NULL, ",", &fsave)) {
+            const char *dims = type == AVMEDIA_TYPE_VIDEO ? sizes_list : channels_list;
+            char **buf = type == AVMEDIA_TYPE_VIDEO ? &sizes_buf : &channels_buf;
+            char **save = type == AVMEDIA_TYPE_VIDEO ? &ssave : &csave;
+
+            *buf = av_strdup(dims);
+            for (char *d = av_strtok(*buf, ",", save); d; d = av_strtok(NULL, ",", save)) {
+                BenchConfig cfg = { .threads = atoi(t), .format = is_source ? NULL : fmt };
+                BenchResult res = { 0 };
+                int err;
+
+                if (is_source)
+                    err = 0;
+                else if (type == AVMEDIA_TYPE_VIDEO)
+                    err = av_parse_video_size(&cfg.w, &cfg.h, d);
+                else
+                    err = (cfg.channels = atoi(d)) > 0 ? 0 : AVERROR(EINVAL);
+                if (err >= 0)
+                    err = run_config(name, args, &cfg, &res);
+                if (err < 0)
+                    ret = 1;
+                print_result(name, args, type, &cfg, &res, err, first);
+                fflush(stdout);
+                first = 0;
+            }
+            av_freep(buf);
+        }
+        av_freep(&formats_buf);
+    }
+    printf("\n]\n");
+
+    av_free(threads_buf);
+    av_free(name);
+    return ret;
+}